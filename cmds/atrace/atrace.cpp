@@ -31,7 +31,10 @@
 #include <zlib.h>
 
 #include <fstream>
+#include <future>
+#include <map>
 #include <memory>
+#include <unordered_map>
 
 #include <binder/IBinder.h>
 #include <binder/IServiceManager.h>
@@ -299,6 +302,9 @@ static const char* g_outputFile = nullptr;
 
 /* Global state */
 static bool g_tracePdx = false;
+static bool g_fastStart = false;
+static bool g_armOnly = false;
+static std::future<bool> g_pdxPoke;
 static bool g_traceAborted = false;
 static bool g_categoryEnables[arraysize(k_categories)] = {};
 static std::string g_traceFolder;
@@ -360,9 +366,16 @@ static bool fileExists(const char* filename) {
     return access((g_traceFolder + filename).c_str(), F_OK) != -1;
 }
 
-// Check whether a file is writable.
+// Check whether a file is writable. Category checks and set up ask about the
+// same few hundred files several times, so the answers are cached.
 static bool fileIsWritable(const char* filename) {
-    return access((g_traceFolder + filename).c_str(), W_OK) != -1;
+    static std::unordered_map<std::string, bool> writable;
+    auto it = writable.find(filename);
+    if (it == writable.end()) {
+        bool result = access((g_traceFolder + filename).c_str(), W_OK) != -1;
+        it = writable.emplace(filename, result).first;
+    }
+    return it->second;
 }
 
 // Truncate a file.
@@ -444,11 +457,25 @@ static void writeClockSyncMarker()
   close(fd);
 }
 
+// Write a string to a file, unless the file already holds it. Used by
+// --fast_start, where reading a file is much cheaper than a write that makes
+// the kernel reconfigure tracing.
+static bool writeStrIfChanged(const char* filename, const char* str)
+{
+    std::string current;
+    if (g_fastStart &&
+            android::base::ReadFileToString(g_traceFolder + filename, &current) &&
+            android::base::Trim(current) == str) {
+        return true;
+    }
+    return writeStr(filename, str);
+}
+
 // Enable or disable a kernel option by writing a "1" or a "0" into a /sys
 // file.
 static bool setKernelOptionEnable(const char* filename, bool enable)
 {
-    return writeStr(filename, enable ? "1" : "0");
+    return writeStrIfChanged(filename, enable ? "1" : "0");
 }
 
 // Check whether the category is supported on the device with the current
@@ -515,7 +542,11 @@ static bool setTraceOverwriteEnable(bool enable)
 // Set the user initiated trace property
 static bool setUserInitiatedTraceProperty(bool enable)
 {
-    if (!android::base::SetProperty(k_userInitiatedTraceProperty, enable ? "1" : "")) {
+    const char* value = enable ? "1" : "";
+    if (g_fastStart && android::base::GetProperty(k_userInitiatedTraceProperty, "") == value) {
+        return true;
+    }
+    if (!android::base::SetProperty(k_userInitiatedTraceProperty, value)) {
         fprintf(stderr, "error setting user initiated strace system property\n");
         return false;
     }
@@ -542,7 +573,7 @@ static bool setTraceBufferSizeKB(int size)
         size = 1;
     }
     snprintf(str, 32, "%d", size);
-    return writeStr(k_traceBufferSizePath, str);
+    return writeStrIfChanged(k_traceBufferSizePath, str);
 }
 
 #if 0
@@ -603,6 +634,9 @@ static bool setPrintTgidEnableIfPresent(bool enable)
 static bool setTagsProperty(uint64_t tags)
 {
     std::string value = android::base::StringPrintf("%#" PRIx64, tags);
+    if (g_fastStart && android::base::GetProperty(k_traceTagsProperty, "") == value) {
+        return true;
+    }
     if (!android::base::SetProperty(k_traceTagsProperty, value)) {
         fprintf(stderr, "error setting trace tags system property\n");
         return false;
@@ -713,7 +747,7 @@ static bool setKernelTraceFuncs(const char* funcs)
     if (funcs == nullptr || funcs[0] == '\0') {
         // Disable kernel function tracing.
         if (fileIsWritable(k_currentTracerPath)) {
-            ok &= writeStr(k_currentTracerPath, "nop");
+            ok &= writeStrIfChanged(k_currentTracerPath, "nop");
         }
         if (fileIsWritable(k_ftraceFilterPath)) {
             ok &= truncateFile(k_ftraceFilterPath);
@@ -841,12 +875,23 @@ static bool setUpUserspaceTracing()
     ok &= setAppCmdlineProperty(&packageList[0]);
     ok &= setTagsProperty(tags);
     if (g_tracePdx) {
-        ok &= ServiceUtility::PokeServices();
+        if (g_fastStart) {
+            // Let the services pick up the tags while the kernel is set up.
+            g_pdxPoke = std::async(std::launch::async, ServiceUtility::PokeServices);
+        } else {
+            ok &= ServiceUtility::PokeServices();
+        }
     }
 
     return ok;
 }
 
+// Wait for the services poked in the background by setUpUserspaceTracing.
+static bool finishUserspaceTracingSetUp()
+{
+    return g_pdxPoke.valid() ? g_pdxPoke.get() : true;
+}
+
 static void cleanUpUserspaceTracing()
 {
     setTagsProperty(0);
@@ -858,6 +903,40 @@ static void cleanUpUserspaceTracing()
 }
 
 
+// Bring every /sys/ enable file to the state the enabled categories need,
+// writing only the ones that differ from it.
+static bool setKernelTraceEventsIfChanged()
+{
+    bool ok = true;
+    std::map<std::string, bool> enables;
+    for (size_t i = 0; i < arraysize(k_categories); i++) {
+        const TracingCategory &c = k_categories[i];
+        for (int j = 0; j < MAX_SYS_FILES; j++) {
+            const char* path = c.sysfiles[j].path;
+            if (path == nullptr) {
+                continue;
+            }
+            if (fileIsWritable(path)) {
+                enables[path] |= g_categoryEnables[i];
+            } else if (g_categoryEnables[i] && c.sysfiles[j].required == REQ) {
+                fprintf(stderr, "error writing file %s\n", path);
+                ok = false;
+            }
+        }
+    }
+    for (const TracingVendorFileCategory& c : g_vendorFileCategories) {
+        for (const std::string& path : c.ftrace_enable_paths) {
+            if (fileIsWritable(path.c_str())) {
+                enables[path] |= c.enabled;
+            }
+        }
+    }
+    for (const auto& [path, enable] : enables) {
+        ok &= setKernelOptionEnable(path.c_str(), enable);
+    }
+    return ok;
+}
+
 // Set all the kernel tracing settings to the desired state for this trace
 // capture.
 static bool setUpKernelTracing()
@@ -876,6 +955,12 @@ static bool setUpKernelTracing()
     ok &= setPrintTgidEnableIfPresent(true);
     ok &= setKernelTraceFuncs(g_kernelTraceFuncs);
 
+    if (g_fastStart) {
+        // Only touch the enables whose state changes, instead of disabling
+        // all of them and enabling the requested ones again.
+        return ok && setKernelTraceEventsIfChanged();
+    }
+
     // Disable all the sysfs enables.  This is done as a separate loop from
     // the enables to allow the same enable to exist in multiple categories.
     ok &= disableKernelTraceEvents();
@@ -1122,6 +1207,11 @@ static void showHelp(const char *cmd)
                     "  --async_dump    dump the current contents of circular trace buffer\n"
                     "  --async_stop    stop tracing and dump the current contents of circular\n"
                     "                    trace buffer\n"
+                    "  --fast_start    only write the settings that differ from the current ones,\n"
+                    "                    and poke services while the kernel is set up\n"
+                    "  --arm           set up a circular trace like --async_start without\n"
+                    "                    starting it, so that a later --async_start --fast_start\n"
+                    "                    with the same options only has to turn tracing on\n"
                     "  --stream        stream trace to stdout as it enters the trace buffer\n"
                     "                    Note: this can take significant CPU time, and is best\n"
                     "                    used for measuring things that are not affected by\n"
@@ -1296,6 +1386,8 @@ int main(int argc, char **argv)
             {"only_userspace",    no_argument, nullptr,  0 },
             {"list_categories",   no_argument, nullptr,  0 },
             {"stream",            no_argument, nullptr,  0 },
+            {"fast_start",        no_argument, nullptr,  0 },
+            {"arm",               no_argument, nullptr,  0 },
             {nullptr,                       0, nullptr,  0 }
         };
 
@@ -1363,6 +1455,14 @@ int main(int argc, char **argv)
                     async = true;
                     traceStart = false;
                     traceStop = false;
+                } else if (!strcmp(long_options[option_index].name, "fast_start")) {
+                    g_fastStart = true;
+                } else if (!strcmp(long_options[option_index].name, "arm")) {
+                    async = true;
+                    traceStop = false;
+                    traceDump = false;
+                    g_traceOverwrite = true;
+                    g_armOnly = true;
                 } else if (!strcmp(long_options[option_index].name, "only_userspace")) {
                     onlyUserspace = true;
                 } else if (!strcmp(long_options[option_index].name, "stream")) {
@@ -1405,8 +1505,13 @@ int main(int argc, char **argv)
     if (ok && traceStart && !onlyUserspace) {
         ok &= setUpKernelTracing();
         ok &= setUpVendorTracingWithHal();
+        ok &= finishUserspaceTracingSetUp();
+        if (g_armOnly) {
+            return ok ? 0 : 1;
+        }
         ok &= startTrace();
     }
+    ok &= finishUserspaceTracingSetUp();
 
     if (ok && traceStart) {
 
@@ -18,9 +18,13 @@
 
 #include "DumpPool.h"
 
+#include <algorithm>
 #include <array>
+#include <limits>
 #include <thread>
 
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
 #include <log/log.h>
 
 #include "dumpstate.h"
@@ -32,6 +36,7 @@ namespace os {
 namespace dumpstate {
 
 const std::string DumpPool::PREFIX_TMPFILE_NAME = "dump-tmp.";
+const std::string DumpPool::DURATIONS_FILE_NAME = "dump-durations.txt";
 
 
 void WaitForTask(std::future<std::string> future, const std::string& title, int out_fd) {
@@ -48,17 +53,19 @@ void WaitForTask(std::future<std::string> future, const std::string& title, int
 }
 
 DumpPool::DumpPool(const std::string& tmp_root) : tmp_root_(tmp_root), shutdown_(false),
-        log_duration_(true) {
+        held_(false), log_duration_(true), next_sequence_(0), durations_changed_(false) {
     assert(!tmp_root.empty());
     deleteTempFiles(tmp_root_);
+    loadDurations();
 }
 
 DumpPool::~DumpPool() {
     std::unique_lock lock(lock_);
     if (shutdown_ || threads_.empty()) {
+        saveDurations();
         return;
     }
-    while (!tasks_.empty()) tasks_.pop();
+    tasks_.clear();
 
     shutdown_ = true;
     condition_variable_.notify_all();
@@ -69,6 +76,8 @@ DumpPool::~DumpPool() {
     }
     threads_.clear();
     deleteTempFiles(tmp_root_);
+    lock.lock();
+    saveDurations();
     MYLOGI("shutdown thread pool\n");
 }
 
@@ -88,10 +97,83 @@ void DumpPool::start(int thread_counts) {
     }
 }
 
+void DumpPool::holdTasks() {
+    std::unique_lock lock(lock_);
+    held_ = true;
+}
+
+void DumpPool::releaseTasks() {
+    std::unique_lock lock(lock_);
+    held_ = false;
+    condition_variable_.notify_all();
+}
+
 void DumpPool::deleteTempFiles() {
     deleteTempFiles(tmp_root_);
 }
 
+int64_t DumpPool::expectedDurationLocked(const std::string& duration_title) {
+    auto it = durations_.find(duration_title);
+    if (it == durations_.end()) {
+        return std::numeric_limits<int64_t>::max();
+    }
+    return it->second;
+}
+
+void DumpPool::recordDuration(const std::string& duration_title,
+                              std::chrono::steady_clock::duration duration) {
+    if (duration_title.empty()) {
+        return;
+    }
+    int64_t duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    std::unique_lock lock(lock_);
+    auto it = durations_.find(duration_title);
+    if (it == durations_.end()) {
+        durations_[duration_title] = duration_ms;
+    } else {
+        // Average with the previous runs, so a single outlier doesn't reorder the tasks.
+        it->second = (it->second + duration_ms) / 2;
+    }
+    durations_changed_ = true;
+}
+
+void DumpPool::loadDurations() {
+    std::string content;
+    if (!android::base::ReadFileToString(tmp_root_ + "/" + DURATIONS_FILE_NAME, &content)) {
+        return;
+    }
+    // One "<milliseconds> <title>" line per task.
+    for (const auto& line : android::base::Split(content, "\n")) {
+        size_t space = line.find(' ');
+        int64_t duration_ms;
+        if (space == std::string::npos ||
+            !android::base::ParseInt(line.substr(0, space), &duration_ms, int64_t(0))) {
+            continue;
+        }
+        durations_[line.substr(space + 1)] = duration_ms;
+    }
+}
+
+void DumpPool::saveDurations() {
+    if (!durations_changed_) {
+        return;
+    }
+    std::string content;
+    for (const auto& [title, duration_ms] : durations_) {
+        content += std::to_string(duration_ms) + " " + title + "\n";
+    }
+    // Replace the file atomically, it's read by the next bugreport.
+    std::string path = tmp_root_ + "/" + DURATIONS_FILE_NAME;
+    std::string tmp_path = path + ".tmp";
+    if (!android::base::WriteStringToFile(content, tmp_path) ||
+        rename(tmp_path.c_str(), path.c_str())) {
+        MYLOGE("Failed to save task durations to %s: %s\n", path.c_str(), strerror(errno));
+        unlink(tmp_path.c_str());
+        return;
+    }
+    durations_changed_ = false;
+}
+
 void DumpPool::setLogDuration(bool log_duration) {
     log_duration_ = log_duration;
 }
@@ -166,12 +248,20 @@ void DumpPool::setThreadName(const pthread_t thread, int id) {
 void DumpPool::loop() {
     std::unique_lock lock(lock_);
     while (!shutdown_) {
-        if (tasks_.empty()) {
+        if (tasks_.empty() || held_) {
             condition_variable_.wait(lock);
             continue;
         } else {
-            std::packaged_task<std::string()> task = std::move(tasks_.front());
-            tasks_.pop();
+            // Longest expected task first, in enqueue order otherwise.
+            auto next = std::min_element(tasks_.begin(), tasks_.end(),
+                    [](const QueuedTask& left, const QueuedTask& right) {
+                        if (left.expected_duration_ms != right.expected_duration_ms) {
+                            return left.expected_duration_ms > right.expected_duration_ms;
+                        }
+                        return left.sequence < right.sequence;
+                    });
+            std::packaged_task<std::string()> task = std::move(next->task);
+            tasks_.erase(next);
             lock.unlock();
             std::invoke(task);
             lock.lock();
@@ -17,9 +17,11 @@
 #ifndef FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
 #define FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
 
+#include <chrono>
 #include <future>
-#include <queue>
+#include <map>
 #include <string>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/macros.h>
@@ -71,6 +73,10 @@ inline void WaitForTask(std::future<std::string> future) {
  *
  * std::futures returned by `enqueueTask*()` must all have their `get` methods
  * called, or have been destroyed before the DumpPool itself is destroyed.
+ *
+ * The pool remembers how long each titled task took in the previous bugreports
+ * and runs the tasks that are expected to take the longest first. Tasks that
+ * never ran before are considered the longest, in the order they're enqueued.
  */
 class DumpPool {
   friend class android::os::dumpstate::DumpPoolTest;
@@ -139,12 +145,25 @@ class DumpPool {
         return future;
     }
 
+    /*
+     * Holds back the tasks enqueued from now on until releaseTasks() is
+     * called, so that a batch of tasks can be ordered by duration before any
+     * of them starts.
+     */
+    void holdTasks();
+
+    /*
+     * Lets the threads run the tasks held back since holdTasks().
+     */
+    void releaseTasks();
+
     /*
      * Deletes temporary files created by DumpPool.
      */
     void deleteTempFiles();
 
     static const std::string PREFIX_TMPFILE_NAME;
+    static const std::string DURATIONS_FILE_NAME;
 
   private:
     using Task = std::packaged_task<std::string()>;
@@ -158,17 +177,34 @@ class DumpPool {
             if (!tmp_file_ptr) {
                 return std::string("");
             }
+            auto start = std::chrono::steady_clock::now();
             invokeTask(dump_func, duration_title, tmp_file_ptr->fd.get());
+            recordDuration(duration_title, std::chrono::steady_clock::now() - start);
             fsync(tmp_file_ptr->fd.get());
             return std::string(tmp_file_ptr->path);
         });
         std::unique_lock lock(lock_);
         auto future = packaged_task.get_future();
-        tasks_.push(std::move(packaged_task));
-        condition_variable_.notify_one();
+        tasks_.push_back({std::move(packaged_task), expectedDurationLocked(duration_title),
+                          next_sequence_++});
+        if (!held_) {
+            condition_variable_.notify_one();
+        }
         return future;
     }
 
+    struct QueuedTask {
+        Task task;
+        int64_t expected_duration_ms;
+        uint64_t sequence;
+    };
+
+    int64_t expectedDurationLocked(const std::string& duration_title);
+    void recordDuration(const std::string& duration_title,
+                        std::chrono::steady_clock::duration duration);
+    void loadDurations();
+    void saveDurations();
+
     typedef struct {
       android::base::unique_fd fd;
       char path[1024];
@@ -193,12 +229,18 @@ class DumpPool {
     /* A path to a temporary folder for threads to create temporary files. */
     std::string tmp_root_;
     bool shutdown_;
+    bool held_;
     bool log_duration_; // For test purpose only, the default value is true.
-    std::mutex lock_;  // A lock for the tasks_.
+    std::mutex lock_;  // A lock for the tasks_ and durations_.
     std::condition_variable condition_variable_;
 
     std::vector<std::thread> threads_;
-    std::queue<Task> tasks_;
+    std::vector<QueuedTask> tasks_;
+    uint64_t next_sequence_;
+
+    /* Duration of each task title in milliseconds, learned from previous runs. */
+    std::map<std::string, int64_t> durations_;
+    bool durations_changed_;
 
     DISALLOW_COPY_AND_ASSIGN(DumpPool);
 };
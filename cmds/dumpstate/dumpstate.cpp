@@ -839,24 +839,58 @@ static const std::set<std::string> PROBLEMATIC_FILE_EXTENSIONS = {
       ".shb", ".sys", ".vb",  ".vbe", ".vbs", ".vxd", ".wsc", ".wsf", ".wsh"
 };
 
+// Files that are compressed already and wouldn't get any smaller in the zip.
+static const std::set<std::string> COMPRESSED_FILE_EXTENSIONS = {
+      ".7z", ".apk", ".br", ".bz2", ".gz", ".jpeg", ".jpg", ".lz4", ".png", ".webp", ".xz",
+      ".zip", ".zst"
+};
+
+static std::string GetLowerCaseExtension(const std::string& entry_name) {
+    size_t idx = entry_name.rfind('.');
+    if (idx == std::string::npos) {
+        return "";
+    }
+    std::string extension = entry_name.substr(idx);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
+/*
+ * Returns the ZipWriter flags for a new entry. Entries that are compressed already are stored as
+ * they are, since deflating them again only costs time on the single zip writer thread. The other
+ * entries use the level set by the dumpstate.zip_compression property: "best" trades time for a
+ * smaller bugreport, "store" skips compression and "default" (or nothing) is in between.
+ */
+static size_t GetZipEntryFlags(const std::string& extension) {
+    static const size_t flags = [] {
+        std::string level = android::base::GetProperty("dumpstate.zip_compression", "default");
+        if (level == "store") {
+            return size_t(0);
+        } else if (level == "best") {
+            return size_t(ZipWriter::kCompress);
+        }
+        return size_t(ZipWriter::kCompress | ZipWriter::kDefaultCompression);
+    }();
+    if (COMPRESSED_FILE_EXTENSIONS.count(extension) != 0) {
+        return 0;
+    }
+    return flags;
+}
+
 status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
                                       std::chrono::milliseconds timeout = 0ms) {
     std::string valid_name = entry_name;
 
     // Rename extension if necessary.
-    size_t idx = entry_name.rfind('.');
-    if (idx != std::string::npos) {
-        std::string extension = entry_name.substr(idx);
-        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
-        if (PROBLEMATIC_FILE_EXTENSIONS.count(extension) != 0) {
-            valid_name = entry_name + ".renamed";
-            MYLOGI("Renaming entry %s to %s\n", entry_name.c_str(), valid_name.c_str());
-        }
+    std::string extension = GetLowerCaseExtension(entry_name);
+    if (PROBLEMATIC_FILE_EXTENSIONS.count(extension) != 0) {
+        valid_name = entry_name + ".renamed";
+        MYLOGI("Renaming entry %s to %s\n", entry_name.c_str(), valid_name.c_str());
     }
 
     // Logging statement  below is useful to time how long each entry takes, but it's too verbose.
     // MYLOGD("Adding zip entry %s\n", entry_name.c_str());
-    size_t flags = ZipWriter::kCompress | ZipWriter::kDefaultCompression;
+    size_t flags = GetZipEntryFlags(extension);
     int32_t err = zip_writer_->StartEntryWithTime(valid_name.c_str(), flags,
                                                   get_mtime(fd, ds.now_));
     if (err != 0) {
@@ -949,7 +983,7 @@ void Dumpstate::AddDir(const std::string& dir, bool recursive) {
 
 bool Dumpstate::AddTextZipEntry(const std::string& entry_name, const std::string& content) {
     MYLOGD("Adding zip text entry %s\n", entry_name.c_str());
-    size_t flags = ZipWriter::kCompress | ZipWriter::kDefaultCompression;
+    size_t flags = GetZipEntryFlags(GetLowerCaseExtension(entry_name));
     int32_t err = zip_writer_->StartEntryWithTime(entry_name.c_str(), flags, ds.now_);
     if (err != 0) {
         MYLOGE("zip_writer_->StartEntryWithTime(%s): %s\n", entry_name.c_str(),
@@ -1640,6 +1674,8 @@ Dumpstate::RunStatus Dumpstate::dumpstate() {
         // drop root user. Restarts it.
         ds.dump_pool_->start(/* thread_counts = */3);
 
+        // Let the pool start the tasks that took the longest last time first.
+        ds.dump_pool_->holdTasks();
         dump_hals = ds.dump_pool_->enqueueTaskWithFd(DUMP_HALS_TASK, &DumpHals, _1);
         dump_incident_report = ds.dump_pool_->enqueueTask(
             DUMP_INCIDENT_REPORT_TASK, &DumpIncidentReport);
@@ -1650,6 +1686,7 @@ Dumpstate::RunStatus Dumpstate::dumpstate() {
         dump_checkins = ds.dump_pool_->enqueueTaskWithFd(DUMP_CHECKINS_TASK, &DumpCheckins, _1);
         post_process_ui_traces = ds.dump_pool_->enqueueTask(
             POST_PROCESS_UI_TRACES_TASK, &Dumpstate::MaybePostProcessUiTraces, &ds);
+        ds.dump_pool_->releaseTasks();
     }
 
     // Dump various things. Note that anything that takes "long" (i.e. several seconds) should
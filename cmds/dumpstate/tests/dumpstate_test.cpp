@@ -51,6 +51,7 @@ namespace dumpstate {
 
 using DumpstateDeviceAidl = ::aidl::android::hardware::dumpstate::IDumpstateDevice;
 using ::android::hardware::dumpstate::V1_1::DumpstateMode;
+using ::testing::ElementsAre;
 using ::testing::EndsWith;
 using ::testing::Eq;
 using ::testing::HasSubstr;
@@ -1779,6 +1780,31 @@ TEST_F(DumpPoolTest, EnqueueTask_withDurationLog) {
     EXPECT_THAT(getTempFileCounts(kTestDataPath), Eq(0));
 }
 
+TEST_F(DumpPoolTest, EnqueueTask_longestFirst) {
+    // Learn the durations of the tasks in a first pool.
+    dump_pool_->start(/* thread_counts = */1);
+    setLogDuration(/* log_duration = */false);
+    auto t1 = dump_pool_->enqueueTask("short", []() {});
+    auto t2 = dump_pool_->enqueueTask("long", []() { usleep(200000); });
+    WaitForTask(std::move(t1), "", out_fd_.get());
+    WaitForTask(std::move(t2), "", out_fd_.get());
+    dump_pool_.reset();
+    dump_pool_ = std::make_unique<DumpPool>(kTestDataPath);
+
+    std::vector<std::string> order;
+    dump_pool_->start(/* thread_counts = */1);
+    setLogDuration(/* log_duration = */false);
+    dump_pool_->holdTasks();
+    t1 = dump_pool_->enqueueTask("short", [&]() { order.push_back("short"); });
+    t2 = dump_pool_->enqueueTask("long", [&]() { order.push_back("long"); });
+    dump_pool_->releaseTasks();
+    WaitForTask(std::move(t1), "", out_fd_.get());
+    WaitForTask(std::move(t2), "", out_fd_.get());
+
+    EXPECT_THAT(order, ElementsAre("long", "short"));
+    unlink((kTestDataPath + DumpPool::DURATIONS_FILE_NAME).c_str());
+}
+
 class TaskQueueTest : public DumpstateBaseTest {
 public:
     void SetUp() {
@@ -15,8 +15,11 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <iomanip>
+#include <mutex>
 #include <thread>
 
 #include <android-base/file.h>
@@ -39,6 +42,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -65,11 +69,14 @@ static void usage() {
         "usage: dumpsys\n"
         "         To dump all services.\n"
         "or:\n"
-        "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--clients] [--dump] [--pid] [--thread] "
+        "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--parallel N] [--clients] [--dump] [--pid] "
+        "[--thread] "
         "[--help | "
         "-l | --skip SERVICES "
         "| SERVICE [ARGS]]\n"
         "         --help: shows this help\n"
+        "         --parallel N: dumps up to N services at the same time, in the usual order,\n"
+        "               followed by a table of how long each one took\n"
         "         -l: only list services, do not dump them\n"
         "         -t TIMEOUT_SEC: TIMEOUT to use in seconds instead of default 10 seconds\n"
         "         -T TIMEOUT_MS: TIMEOUT to use in milliseconds instead of default 10 seconds\n"
@@ -135,13 +142,15 @@ int Dumpsys::main(int argc, char* const argv[]) {
     bool asProto = false;
     int dumpTypeFlags = 0;
     int timeoutArgMs = 10000;
+    int parallelDumps = 1;
     int priorityFlags = IServiceManager::DUMP_FLAG_PRIORITY_ALL;
     static struct option longOptions[] = {
         {"help", no_argument, 0, 0},           {"clients", no_argument, 0, 0},
         {"dump", no_argument, 0, 0},           {"pid", no_argument, 0, 0},
         {"priority", required_argument, 0, 0}, {"proto", no_argument, 0, 0},
         {"skip", no_argument, 0, 0},           {"stability", no_argument, 0, 0},
-        {"thread", no_argument, 0, 0},         {0, 0, 0, 0}};
+        {"thread", no_argument, 0, 0},         {"parallel", required_argument, 0, 0},
+        {0, 0, 0, 0}};
 
     // Must reset optind, otherwise subsequent calls will fail (wouldn't happen on main.cpp, but
     // happens on test cases).
@@ -172,6 +181,13 @@ int Dumpsys::main(int argc, char* const argv[]) {
                     usage();
                     return -1;
                 }
+            } else if (!strcmp(longOptions[optionIndex].name, "parallel")) {
+                char* endptr;
+                parallelDumps = strtol(optarg, &endptr, 10);
+                if (*endptr != '\0' || parallelDumps <= 0) {
+                    fprintf(stderr, "Error: invalid number of parallel dumps: '%s'\n", optarg);
+                    return -1;
+                }
             } else if (!strcmp(longOptions[optionIndex].name, "dump")) {
                 dumpTypeFlags |= TYPE_DUMP;
             } else if (!strcmp(longOptions[optionIndex].name, "pid")) {
@@ -271,6 +287,12 @@ int Dumpsys::main(int argc, char* const argv[]) {
         return 0;
     }
 
+    if (parallelDumps > 1 && N > 1) {
+        dumpInParallel(services, skippedServices, dumpTypeFlags, args, priorityFlags,
+                       std::chrono::milliseconds(timeoutArgMs), asProto, parallelDumps);
+        return 0;
+    }
+
     for (size_t i = 0; i < N; i++) {
         const String16& serviceName = services[i];
         if (IsSkipped(skippedServices, serviceName)) continue;
@@ -304,6 +326,131 @@ int Dumpsys::main(int argc, char* const argv[]) {
     return 0;
 }
 
+static void dumpServiceToFd(const sp<IBinder>& service, int dumpTypeFlags,
+                            const String16& serviceName, const Vector<String16>& args,
+                            const unique_fd& fd);
+
+namespace {
+
+// A service dumped by Dumpsys::dumpInParallel.
+struct ParallelDump {
+    String16 serviceName;
+    bool started = false;
+    bool finished = false;
+    // Holds the dump until it's its turn to be written out.
+    unique_fd buffer;
+    status_t status = OK;
+    std::chrono::duration<double> elapsedDuration{0};
+    // Time spent in the binder calls, or negative if they didn't return in time.
+    std::chrono::duration<double> binderDuration{-1};
+    size_t bytesWritten = 0;
+};
+
+}  // namespace
+
+void Dumpsys::dumpInParallel(const Vector<String16>& services,
+                             const Vector<String16>& skippedServices, int dumpTypeFlags,
+                             const Vector<String16>& args, int priorityFlags,
+                             std::chrono::milliseconds timeout, bool asProto, int parallelDumps) {
+    std::vector<ParallelDump> dumps;
+    for (const auto& serviceName : services) {
+        if (IsSkipped(skippedServices, serviceName)) continue;
+        dumps.emplace_back();
+        dumps.back().serviceName = serviceName;
+    }
+
+    std::mutex lock;
+    std::condition_variable finished;
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t i; (i = next++) < dumps.size();) {
+            ParallelDump& dump = dumps[i];
+            unique_fd buffer(memfd_create("dumpsys", MFD_CLOEXEC));
+            sp<IBinder> service = sm_->checkService(dump.serviceName);
+            int sfd[2];
+            if (service == nullptr) {
+                std::cerr << "Can't find service: " << dump.serviceName << std::endl;
+            } else if (buffer.get() == -1 || pipe(sfd) != 0) {
+                std::cerr << "Failed to create pipe to dump service info for "
+                          << dump.serviceName << ": " << strerror(errno) << std::endl;
+            } else {
+                unique_fd local_end(sfd[0]);
+                unique_fd remote_end(sfd[1]);
+                // The thread is left behind if the service doesn't finish in time, so it
+                // only gets copies.
+                auto binderDuration = std::make_shared<std::atomic<int64_t>>(-1);
+                String16 serviceName = dump.serviceName;
+                std::thread thread([=, remote_end{std::move(remote_end)}]() mutable {
+                    auto start = std::chrono::steady_clock::now();
+                    dumpServiceToFd(service, dumpTypeFlags, serviceName, args, remote_end);
+                    *binderDuration = std::chrono::duration_cast<std::chrono::microseconds>(
+                                              std::chrono::steady_clock::now() - start)
+                                              .count();
+                });
+                dump.status = copyDump(local_end.get(), buffer.get(), dump.serviceName, timeout,
+                                       asProto, dump.elapsedDuration, dump.bytesWritten);
+                if (dump.status == OK) {
+                    thread.join();
+                } else {
+                    thread.detach();
+                }
+                if (*binderDuration >= 0) {
+                    dump.binderDuration = std::chrono::microseconds(binderDuration->load());
+                }
+                dump.started = true;
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            dump.buffer = std::move(buffer);
+            dump.finished = true;
+            finished.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < parallelDumps && i < static_cast<int>(dumps.size()); i++) {
+        threads.emplace_back(work);
+    }
+
+    // Write the dumps out in the usual order, each one as soon as it's complete.
+    for (auto& dump : dumps) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            finished.wait(guard, [&dump] { return dump.finished; });
+        }
+        if (!dump.started) continue;
+
+        writeDumpHeader(STDOUT_FILENO, dump.serviceName, priorityFlags);
+        lseek(dump.buffer.get(), 0, SEEK_SET);
+        std::string content;
+        android::base::ReadFdToString(dump.buffer.get(), &content);
+        WriteFully(STDOUT_FILENO, content.data(), content.size());
+        dump.buffer.reset();
+        if (dump.status == TIMED_OUT) {
+            WriteStringToFd(StringPrintf("\n*** SERVICE '%s' DUMP TIMEOUT (%llums) EXPIRED ***\n\n",
+                                         String8(dump.serviceName).c_str(), timeout.count()),
+                            STDOUT_FILENO);
+        }
+        writeDumpFooter(STDOUT_FILENO, dump.serviceName, dump.elapsedDuration);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (asProto) return;
+    std::string table = StringPrintf(
+            "--------- dumpsys timing with %d parallel dumps\n%-40s %10s %10s %12s\n",
+            parallelDumps, "SERVICE", "TOTAL", "BINDER", "BYTES");
+    for (const auto& dump : dumps) {
+        if (!dump.started) continue;
+        std::string binder = dump.binderDuration.count() < 0
+                ? "-"
+                : StringPrintf("%.3fs", dump.binderDuration.count());
+        StringAppendF(&table, "%-40s %9.3fs %10s %12zu\n", String8(dump.serviceName).c_str(),
+                      dump.elapsedDuration.count(), binder.c_str(), dump.bytesWritten);
+    }
+    WriteStringToFd(table, STDOUT_FILENO);
+}
+
 Vector<String16> Dumpsys::listServices(int priorityFilterFlags, bool filterByProto) const {
     Vector<String16> services = sm_->listServices(priorityFilterFlags);
     services.sort(sort_func);
@@ -413,6 +560,33 @@ static void reportDumpError(const String16& serviceName, status_t error, const c
               << statusToString(error) << std::endl;
 }
 
+static void dumpServiceToFd(const sp<IBinder>& service, int dumpTypeFlags,
+                            const String16& serviceName, const Vector<String16>& args,
+                            const unique_fd& fd) {
+    if (dumpTypeFlags & Dumpsys::TYPE_PID) {
+        status_t err = dumpPidToFd(service, fd, dumpTypeFlags == Dumpsys::TYPE_PID);
+        reportDumpError(serviceName, err, "dumping PID");
+    }
+    if (dumpTypeFlags & Dumpsys::TYPE_STABILITY) {
+        status_t err = dumpStabilityToFd(service, fd);
+        reportDumpError(serviceName, err, "dumping stability");
+    }
+    if (dumpTypeFlags & Dumpsys::TYPE_THREAD) {
+        status_t err = dumpThreadsToFd(service, fd);
+        reportDumpError(serviceName, err, "dumping thread info");
+    }
+    if (dumpTypeFlags & Dumpsys::TYPE_CLIENTS) {
+        status_t err = dumpClientsToFd(service, fd);
+        reportDumpError(serviceName, err, "dumping clients info");
+    }
+
+    // other types always act as a header, this is usually longer
+    if (dumpTypeFlags & Dumpsys::TYPE_DUMP) {
+        status_t err = service->dump(fd.get(), args);
+        reportDumpError(serviceName, err, "dumping");
+    }
+}
+
 status_t Dumpsys::startDumpThread(int dumpTypeFlags, const String16& serviceName,
                                   const Vector<String16>& args) {
     sp<IBinder> service = sm_->checkService(serviceName);
@@ -434,28 +608,7 @@ status_t Dumpsys::startDumpThread(int dumpTypeFlags, const String16& serviceName
 
     // dump blocks until completion, so spawn a thread..
     activeThread_ = std::thread([=, remote_end{std::move(remote_end)}]() mutable {
-        if (dumpTypeFlags & TYPE_PID) {
-            status_t err = dumpPidToFd(service, remote_end, dumpTypeFlags == TYPE_PID);
-            reportDumpError(serviceName, err, "dumping PID");
-        }
-        if (dumpTypeFlags & TYPE_STABILITY) {
-            status_t err = dumpStabilityToFd(service, remote_end);
-            reportDumpError(serviceName, err, "dumping stability");
-        }
-        if (dumpTypeFlags & TYPE_THREAD) {
-            status_t err = dumpThreadsToFd(service, remote_end);
-            reportDumpError(serviceName, err, "dumping thread info");
-        }
-        if (dumpTypeFlags & TYPE_CLIENTS) {
-            status_t err = dumpClientsToFd(service, remote_end);
-            reportDumpError(serviceName, err, "dumping clients info");
-        }
-
-        // other types always act as a header, this is usually longer
-        if (dumpTypeFlags & TYPE_DUMP) {
-            status_t err = service->dump(remote_end.get(), args);
-            reportDumpError(serviceName, err, "dumping");
-        }
+        dumpServiceToFd(service, dumpTypeFlags, serviceName, args, remote_end);
     });
     return OK;
 }
@@ -489,15 +642,21 @@ void Dumpsys::writeDumpHeader(int fd, const String16& serviceName, int priorityF
 status_t Dumpsys::writeDump(int fd, const String16& serviceName, std::chrono::milliseconds timeout,
                             bool asProto, std::chrono::duration<double>& elapsedDuration,
                             size_t& bytesWritten) const {
-    status_t status = OK;
-    size_t totalBytes = 0;
-    auto start = std::chrono::steady_clock::now();
-    auto end = start + timeout;
-
     int serviceDumpFd = redirectFd_.get();
     if (serviceDumpFd == -1) {
         return INVALID_OPERATION;
     }
+    return copyDump(serviceDumpFd, fd, serviceName, timeout, asProto, elapsedDuration,
+                    bytesWritten);
+}
+
+status_t Dumpsys::copyDump(int serviceDumpFd, int fd, const String16& serviceName,
+                           std::chrono::milliseconds timeout, bool asProto,
+                           std::chrono::duration<double>& elapsedDuration, size_t& bytesWritten) {
+    status_t status = OK;
+    size_t totalBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + timeout;
 
     struct pollfd pfd = {.fd = serviceDumpFd, .events = POLLIN};
 
@@ -521,7 +680,7 @@ status_t Dumpsys::writeDump(int fd, const String16& serviceName, std::chrono::mi
         }
 
         char buf[4096];
-        rc = TEMP_FAILURE_RETRY(read(redirectFd_.get(), buf, sizeof(buf)));
+        rc = TEMP_FAILURE_RETRY(read(serviceDumpFd, buf, sizeof(buf)));
         if (rc < 0) {
             std::cerr << "Failed to read while dumping service " << serviceName << ": "
                  << strerror(errno) << std::endl;
@@ -126,6 +126,24 @@ class Dumpsys {
     }
 
   private:
+    /**
+     * Dumps services on up to {@code parallelDumps} threads at the same time, each into its own
+     * buffer and with its own timeout. The dumps are written to stdout in the order of
+     * {@code services}, followed by a table of how long each one took.
+     */
+    void dumpInParallel(const Vector<String16>& services, const Vector<String16>& skippedServices,
+                        int dumpTypeFlags, const Vector<String16>& args, int priorityFlags,
+                        std::chrono::milliseconds timeout, bool asProto, int parallelDumps);
+
+    /**
+     * Copies a service dump from {@code serviceDumpFd} to {@code fd} until the service closes
+     * its end or the timeout expires. See {@code writeDump}.
+     */
+    static status_t copyDump(int serviceDumpFd, int fd, const String16& serviceName,
+                             std::chrono::milliseconds timeout, bool asProto,
+                             std::chrono::duration<double>& elapsedDuration,
+                             size_t& bytesWritten);
+
     android::IServiceManager* sm_;
     std::thread activeThread_;
     mutable android::base::unique_fd redirectFd_;
@@ -454,6 +454,25 @@ TEST_F(DumpsysTest, DumpMultipleServices) {
     AssertDumped("running3", "dump3");
 }
 
+// Tests 'dumpsys --parallel 2', which should keep the order of the services
+TEST_F(DumpsysTest, DumpMultipleServicesInParallel) {
+    ExpectListServices({"running1", "stopped2", "running3"});
+    ExpectDumpAndHang("running1", 1, "dump1");
+    ExpectCheckService("stopped2", false);
+    ExpectDump("running3", "dump3");
+
+    CallMain({"--parallel", "2"});
+
+    AssertRunningServices({"running1", "running3"});
+    AssertDumped("running1", "dump1");
+    AssertStopped("stopped2");
+    AssertDumped("running3", "dump3");
+    AssertOutputFormat("(.|\n)*dump1(.|\n)*dump3(.|\n)*dumpsys timing with 2 parallel dumps\n"
+                       "SERVICE +TOTAL +BINDER +BYTES\n"
+                       "running1 +[0-9.]+s +[0-9.]+s +5\n"
+                       "running3 +[0-9.]+s +[0-9.]+s +5\n");
+}
+
 // Tests 'dumpsys --skip skipped3 skipped5', which should skip these services
 TEST_F(DumpsysTest, DumpWithSkip) {
     ExpectListServices({"running1", "stopped2", "skipped3", "running4", "skipped5"});
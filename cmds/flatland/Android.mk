@@ -4,6 +4,7 @@ include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES:=   \
     Composers.cpp   \
+    Compositions.cpp \
     GLHelper.cpp    \
     Renderers.cpp   \
     Main.cpp        \
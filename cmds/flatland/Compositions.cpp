@@ -0,0 +1,393 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Composition scenarios: rather than measuring how fast the GPU composes layers the way
+// SurfaceFlinger would, these put real layer stacks on the display and measure what SurfaceFlinger
+// and the composer HAL actually do with them, through the frame timestamps of the surfaces.
+
+#include <gui/Surface.h>
+#include <gui/SurfaceComposerClient.h>
+#include <gui/SurfaceControl.h>
+#include <system/window.h>
+#include <ui/DisplayMode.h>
+#include <utils/Timers.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "Flatland.h"
+
+namespace android {
+
+enum { NUM_WARM_UP_FRAMES = 30 };
+enum { NUM_MEASURED_FRAMES = 120 };
+
+// How long to keep waiting for the timestamps of the last frames after the last one was posted.
+static const nsecs_t kDrainTimeout = ms2ns(500);
+
+struct CompositionDesc {
+    // The name of the scenario.
+    const char* name;
+
+    // Whether a translucent shade blurring the layers below it covers the display.
+    bool blurredShade;
+
+    // Whether a picture-in-picture layer with rounded corners is shown above the other layers.
+    bool roundedPip;
+};
+
+static const CompositionDesc compositions[] = {
+    { "Video Layers", false, false },
+    { "Video Layers + Blurred Shade", true, false },
+    { "Video Layers + Rounded PiP", false, true },
+};
+
+// The number of video layers with which each scenario is run.
+static const uint32_t videoLayerCounts[] = { 1, 2, 4, 8 };
+
+// The timestamps of a frame of the first video layer, which every frame of the scenario updates
+// along with the other layers.
+struct FrameSample {
+    uint64_t frameNumber;
+    nsecs_t postTime;
+};
+
+struct FrameResult {
+    bool clientComposition;
+    nsecs_t sfTime;
+    nsecs_t gpuTime;
+    nsecs_t presentLatency;
+};
+
+class CompositionRunner {
+public:
+    CompositionRunner(const CompositionDesc& desc, uint32_t numVideoLayers,
+            const sp<IBinder>& displayToken) :
+        mDesc(desc),
+        mNumVideoLayers(numVideoLayers),
+        mDisplayToken(displayToken),
+        mFrame(0),
+        mLostFrames(0) {
+    }
+
+    bool setUp() {
+        mClient = new SurfaceComposerClient;
+        status_t err = mClient->initCheck();
+        if (err != NO_ERROR) {
+            fprintf(stderr, "SurfaceComposerClient::initCheck error: %#x\n", err);
+            return false;
+        }
+
+        ui::DisplayMode mode;
+        err = mClient->getActiveDisplayMode(mDisplayToken, &mode);
+        if (err != NO_ERROR) {
+            fprintf(stderr, "SurfaceComposer::getActiveDisplayMode failed: %#x\n", err);
+            return false;
+        }
+        const uint32_t displayWidth = mode.resolution.getWidth();
+        const uint32_t displayHeight = mode.resolution.getHeight();
+
+        // Tile the display with the video layers, like a video call grid.
+        const uint32_t columns = uint32_t(ceil(sqrt(double(mNumVideoLayers))));
+        const uint32_t rows = (mNumVideoLayers + columns - 1) / columns;
+        const uint32_t tileWidth = displayWidth / columns;
+        const uint32_t tileHeight = displayHeight / rows;
+
+        SurfaceComposerClient::Transaction t;
+        int32_t z = 0x7FFFFFF0;
+        for (uint32_t i = 0; i < mNumVideoLayers; i++) {
+            sp<SurfaceControl> sc;
+            if (!createBufferLayer("Video", tileWidth, tileHeight, &sc)) {
+                return false;
+            }
+            t.setLayer(sc, z++)
+                    .setPosition(sc, float((i % columns) * tileWidth),
+                            float((i / columns) * tileHeight))
+                    .show(sc);
+            mBufferLayers.push_back(sc);
+        }
+
+        if (mDesc.blurredShade) {
+            mShade = mClient->createSurface(String8("Shade"), 0, 0, PIXEL_FORMAT_RGBA_8888,
+                    ISurfaceComposerClient::eFXSurfaceEffect);
+            if (mShade == nullptr || !mShade->isValid()) {
+                fprintf(stderr, "Failed to create the shade SurfaceControl.\n");
+                return false;
+            }
+            t.setLayer(mShade, z++)
+                    .setCrop(mShade, Rect(0, 0, displayWidth, displayHeight))
+                    .setColor(mShade, half3(0.1f, 0.1f, 0.1f))
+                    .setAlpha(mShade, 0.5f)
+                    .setBackgroundBlurRadius(mShade, 60)
+                    .show(mShade);
+        }
+
+        if (mDesc.roundedPip) {
+            const uint32_t pipWidth = displayWidth / 3;
+            const uint32_t pipHeight = pipWidth * 9 / 16;
+            sp<SurfaceControl> sc;
+            if (!createBufferLayer("PiP", pipWidth, pipHeight, &sc)) {
+                return false;
+            }
+            t.setLayer(sc, z++)
+                    .setPosition(sc, float(displayWidth - pipWidth - displayWidth / 20),
+                            float(displayHeight - pipHeight - displayHeight / 20))
+                    .setCornerRadius(sc, float(pipHeight) / 8.0f)
+                    .show(sc);
+            mBufferLayers.push_back(sc);
+        }
+
+        t.apply(true);
+
+        // The frames of the first video layer stand for the frames of the scenario.
+        mProbe = mBufferLayers[0]->getSurface();
+        mProbe->enableFrameTimestamps(true);
+
+        return true;
+    }
+
+    void tearDown() {
+        SurfaceComposerClient::Transaction t;
+        for (const sp<SurfaceControl>& sc : mBufferLayers) {
+            t.reparent(sc, nullptr);
+        }
+        if (mShade != nullptr) {
+            t.reparent(mShade, nullptr);
+        }
+        t.apply(true);
+
+        mProbe.clear();
+        mBufferLayers.clear();
+        mShade.clear();
+        mClient.clear();
+    }
+
+    // Posts the frames and collects the timestamps of the measured ones.  Returns false on error.
+    bool run(std::vector<FrameResult>* results) {
+        for (uint32_t i = 0; i < NUM_WARM_UP_FRAMES + NUM_MEASURED_FRAMES; i++) {
+            const uint64_t frameNumber = mProbe->getNextFrameNumber();
+            const nsecs_t postTime = systemTime();
+            for (const sp<SurfaceControl>& sc : mBufferLayers) {
+                if (!drawFrame(sc->getSurface())) {
+                    return false;
+                }
+            }
+            mFrame++;
+
+            if (i >= NUM_WARM_UP_FRAMES) {
+                mPending.push_back({frameNumber, postTime});
+            }
+            // The surface only keeps the timestamps of its last few frames, so collect them as
+            // the frames are presented rather than at the end.
+            collect(results);
+        }
+
+        const nsecs_t deadline = systemTime() + kDrainTimeout;
+        while (!mPending.empty() && systemTime() < deadline) {
+            usleep(5000);
+            collect(results);
+        }
+        mLostFrames += mPending.size();
+        mPending.clear();
+
+        return true;
+    }
+
+    size_t getLostFrames() const { return mLostFrames; }
+
+private:
+    bool createBufferLayer(const char* name, uint32_t w, uint32_t h, sp<SurfaceControl>* out) {
+        sp<SurfaceControl> sc = mClient->createSurface(String8(name), w, h,
+                PIXEL_FORMAT_RGBX_8888, ISurfaceComposerClient::eOpaque);
+        if (sc == nullptr || !sc->isValid()) {
+            fprintf(stderr, "Failed to create the %s SurfaceControl.\n", name);
+            return false;
+        }
+        *out = sc;
+        return true;
+    }
+
+    // Draws a moving gradient with the CPU, the way a software video decoder would fill a frame.
+    bool drawFrame(const sp<Surface>& surface) {
+        ANativeWindow_Buffer buffer;
+        status_t err = surface->lock(&buffer, nullptr);
+        if (err != NO_ERROR) {
+            fprintf(stderr, "Surface::lock error: %#x\n", err);
+            return false;
+        }
+
+        uint32_t* row = static_cast<uint32_t*>(buffer.bits);
+        for (int32_t y = 0; y < buffer.height; y++) {
+            const uint32_t luma = (uint32_t(y) + mFrame * 4) & 0xff;
+            std::fill(row, row + buffer.width, 0xff000000 | luma << 16 | luma << 8 | luma);
+            row += buffer.stride;
+        }
+
+        err = surface->unlockAndPost();
+        if (err != NO_ERROR) {
+            fprintf(stderr, "Surface::unlockAndPost error: %#x\n", err);
+            return false;
+        }
+        return true;
+    }
+
+    void collect(std::vector<FrameResult>* results) {
+        while (!mPending.empty()) {
+            const FrameSample& sample = mPending.front();
+            nsecs_t latchTime;
+            nsecs_t refreshStartTime;
+            nsecs_t gpuCompositionDoneTime;
+            nsecs_t presentTime;
+            status_t err = mProbe->getFrameTimestamps(sample.frameNumber, nullptr, nullptr,
+                    &latchTime, &refreshStartTime, nullptr, &gpuCompositionDoneTime,
+                    &presentTime, nullptr, nullptr);
+            if (err != NO_ERROR) {
+                // The frame fell out of the history before it was presented, e.g. because it
+                // was dropped.
+                mLostFrames++;
+                mPending.pop_front();
+                continue;
+            }
+            if (latchTime == NATIVE_WINDOW_TIMESTAMP_PENDING ||
+                    refreshStartTime == NATIVE_WINDOW_TIMESTAMP_PENDING ||
+                    gpuCompositionDoneTime == NATIVE_WINDOW_TIMESTAMP_PENDING ||
+                    presentTime == NATIVE_WINDOW_TIMESTAMP_PENDING) {
+                return;
+            }
+
+            // The composition done fence is only valid if the display composed the frame with
+            // the GPU, i.e. if any layer fell back to client composition.
+            FrameResult result;
+            result.clientComposition = gpuCompositionDoneTime > 0;
+            result.sfTime = refreshStartTime - latchTime;
+            result.gpuTime = result.clientComposition ?
+                    gpuCompositionDoneTime - refreshStartTime : 0;
+            result.presentLatency = presentTime > 0 ? presentTime - sample.postTime : -1;
+            results->push_back(result);
+            mPending.pop_front();
+        }
+    }
+
+    const CompositionDesc& mDesc;
+    const uint32_t mNumVideoLayers;
+    sp<IBinder> mDisplayToken;
+
+    sp<SurfaceComposerClient> mClient;
+    std::vector<sp<SurfaceControl>> mBufferLayers;
+    sp<SurfaceControl> mShade;
+    sp<Surface> mProbe;
+
+    uint32_t mFrame;
+    std::deque<FrameSample> mPending;
+    size_t mLostFrames;
+};
+
+// Returns the median of the values selected from the results, in ms, or -1 if none was selected.
+template <typename Select>
+static double median(const std::vector<FrameResult>& results, Select select) {
+    std::vector<nsecs_t> values;
+    for (const FrameResult& result : results) {
+        nsecs_t value;
+        if (select(result, &value)) {
+            values.push_back(value);
+        }
+    }
+    if (values.empty()) {
+        return -1.0;
+    }
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return double(values[values.size() / 2]) / 1e6;
+}
+
+static void printMs(double ms) {
+    if (ms < 0.0) {
+        printf(" |     n/a");
+    } else {
+        printf(" | %7.3f", ms);
+    }
+}
+
+static bool runComposition(const CompositionDesc& desc, uint32_t numVideoLayers,
+        const sp<IBinder>& displayToken, int nameLen) {
+    printf(" %-*s | %6u | ", nameLen, desc.name, numVideoLayers);
+    fflush(stdout);
+
+    CompositionRunner r(desc, numVideoLayers, displayToken);
+    std::vector<FrameResult> results;
+    bool success = r.setUp() && r.run(&results);
+    r.tearDown();
+    if (!success) {
+        printf("\n");
+        return false;
+    }
+
+    if (results.empty()) {
+        printf("no frames presented\n");
+        return true;
+    }
+
+    size_t clientFrames = 0;
+    for (const FrameResult& result : results) {
+        clientFrames += result.clientComposition ? 1 : 0;
+    }
+    const char* composition = clientFrames == 0 ? "device" :
+            clientFrames == results.size() ? "client" : "mixed ";
+    printf("%s", composition);
+
+    printMs(median(results, [](const FrameResult& result, nsecs_t* value) {
+        *value = result.sfTime;
+        return true;
+    }));
+    printMs(median(results, [](const FrameResult& result, nsecs_t* value) {
+        *value = result.gpuTime;
+        return result.clientComposition;
+    }));
+    printMs(median(results, [](const FrameResult& result, nsecs_t* value) {
+        *value = result.presentLatency;
+        return result.presentLatency >= 0;
+    }));
+    printf(" | %3zu/%zu\n", clientFrames, results.size() + r.getLostFrames());
+    fflush(stdout);
+
+    return true;
+}
+
+bool runCompositions(const sp<IBinder>& displayToken) {
+    size_t nameLen = 0;
+    for (size_t i = 0; i < NELEMS(compositions); i++) {
+        nameLen = std::max(nameLen, strlen(compositions[i].name));
+    }
+
+    printf(" %-*s | Layers | Comp.  |      SF |     GPU | Present | Client frames\n",
+            static_cast<int>(nameLen), "Scenario");
+    for (size_t i = 0; i < NELEMS(compositions); i++) {
+        for (size_t j = 0; j < NELEMS(videoLayerCounts); j++) {
+            if (!runComposition(compositions[i], videoLayerCounts[j], displayToken,
+                    static_cast<int>(nameLen))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace android
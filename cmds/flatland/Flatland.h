@@ -68,4 +68,7 @@ public:
 
 Renderer* staticGradient();
 
+// Runs the composition scenarios on the display, and prints their results.
+bool runCompositions(const sp<IBinder>& displayToken);
+
 } // namespace android
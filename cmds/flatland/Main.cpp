@@ -37,6 +37,7 @@ using namespace ::android;
 
 static uint32_t    g_SleepBetweenSamplesMs = 0;
 static bool        g_PresentToWindow       = false;
+static bool        g_RunCompositions       = false;
 static size_t      g_BenchmarkNameLen      = 0;
 static sp<IBinder> g_DisplayToken          = nullptr;
 
@@ -727,6 +728,8 @@ static void showHelp(const char* cmd) {
       "options include:\n"
       "  -s N            sleep for N ms between samples\n"
       "  -d              display the test frame to a window\n"
+      "  -c              run the composition scenarios, which measure how\n"
+      "                  SurfaceFlinger composes real layer stacks\n"
       "  -i display-id   specify a display ID to use for multi-display device\n"
       "                  see \"dumpsys SurfaceFlinger --display-id\" for valid "
       "display IDs\n"
@@ -755,7 +758,7 @@ int main(int argc, char** argv) {
             {     0,               0, 0,  0 }
         };
 
-        ret = getopt_long(argc, argv, "ds:i:",
+        ret = getopt_long(argc, argv, "dcs:i:",
                           long_options, &option_index);
 
         if (ret < 0) {
@@ -767,6 +770,10 @@ int main(int argc, char** argv) {
                 g_PresentToWindow = true;
             break;
 
+            case 'c':
+                g_RunCompositions = true;
+            break;
+
             case 's':
                 g_SleepBetweenSamplesMs = atoi(optarg);
             break;
@@ -816,6 +823,14 @@ int main(int argc, char** argv) {
     }
     printf("\n");
 
+    if (g_RunCompositions) {
+        if (!runCompositions(g_DisplayToken)) {
+            fprintf(stderr, "exiting due to error.\n");
+            return 1;
+        }
+        return 0;
+    }
+
     if (!runTests()) {
         fprintf(stderr, "exiting due to error.\n");
         return 1;
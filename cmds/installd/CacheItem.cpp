@@ -36,8 +36,9 @@ CacheItem::CacheItem(FTSENT* p) {
     size = p->fts_statp->st_blocks * 512;
     modified = p->fts_statp->st_mtime;
 
-    mParent = static_cast<CacheItem*>(p->fts_parent->fts_pointer);
-    if (mParent) {
+    auto parent = static_cast<CacheItem*>(p->fts_parent->fts_pointer);
+    if (parent) {
+        mParent = parent->shared_from_this();
         group = mParent->group;
         tombstone = mParent->tombstone;
         mName = p->fts_name;
@@ -58,10 +59,10 @@ std::string CacheItem::toString() {
 
 std::string CacheItem::buildPath() {
     std::string res = mName;
-    CacheItem* parent = mParent;
+    CacheItem* parent = mParent.get();
     while (parent) {
         res.insert(0, parent->mName);
-        parent = parent->mParent;
+        parent = parent->mParent.get();
     }
     return res;
 }
@@ -34,7 +34,7 @@ namespace installd {
  * isolated file, or an entire directory tree that should be deleted as a
  * group.
  */
-class CacheItem {
+class CacheItem : public std::enable_shared_from_this<CacheItem> {
 public:
     CacheItem(FTSENT* p);
     ~CacheItem();
@@ -52,7 +52,8 @@ public:
     time_t modified;
 
 private:
-    CacheItem* mParent;
+    // Parents are shared so that items outlive the directories a tracker chose not to keep
+    std::shared_ptr<CacheItem> mParent;
     std::string mName;
 
     DISALLOW_COPY_AND_ASSIGN(CacheItem);
@@ -19,6 +19,7 @@
 #include "CacheTracker.h"
 
 #include <fts.h>
+#include <algorithm>
 #include <sys/xattr.h>
 #include <utils/Trace.h>
 
@@ -33,12 +34,35 @@ using android::base::StringPrintf;
 namespace android {
 namespace installd {
 
+// Whether left should be purged after right. Items are kept newest first.
+static bool isPurgedLater(const std::shared_ptr<CacheItem>& left,
+                          const std::shared_ptr<CacheItem>& right) {
+    // TODO: sort dotfiles last
+    // TODO: sort code_cache last
+    if (left->modified != right->modified) {
+        return (left->modified > right->modified);
+    }
+    if (left->level != right->level) {
+        return (left->level < right->level);
+    }
+    return left->directory && !right->directory;
+}
+
+// Heap order with the item that would be purged last on top.
+static bool isPurgedSooner(const std::shared_ptr<CacheItem>& left,
+                           const std::shared_ptr<CacheItem>& right) {
+    return isPurgedLater(right, left);
+}
+
 CacheTracker::CacheTracker(userid_t userId, appid_t appId, const std::string& uuid)
       : cacheUsed(0),
         cacheQuota(0),
         mUserId(userId),
         mAppId(appId),
         mItemsLoaded(false),
+        mItemsTruncated(false),
+        mItemsBudget(-1),
+        mItemsSize(0),
         mUuid(uuid) {
 }
 
@@ -94,6 +118,23 @@ bool CacheTracker::loadQuotaStats() {
     }
 }
 
+void CacheTracker::addItem(std::shared_ptr<CacheItem> item) {
+    mItemsSize += item->size;
+    items.push_back(std::move(item));
+    if (mItemsBudget < 0) {
+        return;
+    }
+
+    // Drop the newest items for as long as the remaining ones still cover the budget.
+    std::push_heap(items.begin(), items.end(), isPurgedSooner);
+    while (items.size() > 1 && mItemsSize - items.front()->size >= mItemsBudget) {
+        std::pop_heap(items.begin(), items.end(), isPurgedSooner);
+        mItemsSize -= items.back()->size;
+        items.pop_back();
+        mItemsTruncated = true;
+    }
+}
+
 void CacheTracker::loadItemsFrom(const std::string& path) {
     FTS *fts;
     FTSENT *p;
@@ -102,25 +143,28 @@ void CacheTracker::loadItemsFrom(const std::string& path) {
         PLOG(WARNING) << "Failed to fts_open " << path;
         return;
     }
+    // Directories being walked, which their children still refer to, even
+    // when they end up not being kept themselves
+    std::vector<std::shared_ptr<CacheItem>> openDirs;
     while ((p = fts_read(fts)) != nullptr) {
         if (p->fts_level == 0) continue;
 
         // Create tracking nodes for everything we encounter
+        std::shared_ptr<CacheItem> created;
         switch (p->fts_info) {
         case FTS_D:
         case FTS_DEFAULT:
         case FTS_F:
         case FTS_SL:
         case FTS_SLNONE: {
-            auto item = std::shared_ptr<CacheItem>(new CacheItem(p));
-            p->fts_pointer = static_cast<void*>(item.get());
-            items.push_back(item);
+            created = std::shared_ptr<CacheItem>(new CacheItem(p));
+            p->fts_pointer = static_cast<void*>(created.get());
         }
         }
 
         switch (p->fts_info) {
         case FTS_D: {
-            auto item = static_cast<CacheItem*>(p->fts_pointer);
+            auto item = created.get();
             item->group |= (getxattr(p->fts_path, kXattrCacheGroup, nullptr, 0) >= 0);
             item->tombstone |= (getxattr(p->fts_path, kXattrCacheTombstone, nullptr, 0) >= 0);
 
@@ -138,11 +182,13 @@ void CacheTracker::loadItemsFrom(const std::string& path) {
                         item->modified = std::max(item->modified, p->fts_statp->st_mtime);
                     }
                 }
+            } else {
+                openDirs.push_back(created);
             }
         }
         }
 
-        // Bubble up modified time to parent
+        // Bubble up modified time to parent; the item itself is complete now
         CHECK(p != nullptr);
         switch (p->fts_info) {
         case FTS_DP:
@@ -155,14 +201,22 @@ void CacheTracker::loadItemsFrom(const std::string& path) {
             if (parent) {
                 parent->modified = std::max(parent->modified, item->modified);
             }
+            auto complete = item->shared_from_this();
+            if (!openDirs.empty() && openDirs.back() == complete) {
+                openDirs.pop_back();
+            }
+            addItem(std::move(complete));
         }
         }
     }
     fts_close(fts);
 }
 
-void CacheTracker::loadItems() {
+void CacheTracker::loadItems(int64_t budget) {
     items.clear();
+    mItemsBudget = budget;
+    mItemsSize = 0;
+    mItemsTruncated = false;
 
     ATRACE_BEGIN("loadItems");
     for (const auto& path : mDataPaths) {
@@ -172,26 +226,19 @@ void CacheTracker::loadItems() {
     ATRACE_END();
 
     ATRACE_BEGIN("sortItems");
-    auto cmp = [](std::shared_ptr<CacheItem> left, std::shared_ptr<CacheItem> right) {
-        // TODO: sort dotfiles last
-        // TODO: sort code_cache last
-        if (left->modified != right->modified) {
-            return (left->modified > right->modified);
-        }
-        if (left->level != right->level) {
-            return (left->level < right->level);
-        }
-        return left->directory;
-    };
-    std::stable_sort(items.begin(), items.end(), cmp);
+    std::stable_sort(items.begin(), items.end(), isPurgedLater);
     ATRACE_END();
 }
 
-void CacheTracker::ensureItems() {
+void CacheTracker::loadMoreItems() {
+    loadItems(mItemsBudget > 0 ? mItemsBudget * 2 : -1);
+}
+
+void CacheTracker::ensureItems(int64_t budget) {
     if (mItemsLoaded) {
         return;
     } else {
-        loadItems();
+        loadItems(budget);
         mItemsLoaded = true;
     }
 }
@@ -47,9 +47,18 @@ public:
     void addDataPath(const std::string& dataPath);
 
     void loadStats();
-    void loadItems();
-
-    void ensureItems();
+    /*
+     * Loads the items that can be purged, oldest last. With a non-negative
+     * budget only the oldest items adding up to at least budget bytes are
+     * kept, so that large caches don't have to be held in memory entirely.
+     */
+    void loadItems(int64_t budget = -1);
+    // Loads again after all the items of a budgeted load were consumed, with twice the budget.
+    void loadMoreItems();
+
+    void ensureItems(int64_t budget = -1);
+    // Whether the last load left out items because of its budget.
+    bool hasMoreItems() const { return mItemsTruncated; }
 
     int getCacheRatio();
 
@@ -62,12 +71,16 @@ private:
     userid_t mUserId;
     appid_t mAppId;
     bool mItemsLoaded;
+    bool mItemsTruncated;
+    int64_t mItemsBudget;
+    int64_t mItemsSize;
     const std::string& mUuid;
 
     std::vector<std::string> mDataPaths;
 
     bool loadQuotaStats();
     void loadItemsFrom(const std::string& path);
+    void addItem(std::shared_ptr<CacheItem> item);
 
     DISALLOW_COPY_AND_ASSIGN(CacheTracker);
 };
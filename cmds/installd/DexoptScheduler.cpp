@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DexoptScheduler.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <android-base/logging.h>
+
+namespace android {
+namespace installd {
+
+DexoptScheduler::Slot::~Slot() {
+    if (mScheduler != nullptr) {
+        mScheduler->release();
+    }
+}
+
+DexoptScheduler::DexoptScheduler()
+      : mLimit(0),
+        mRunning(0),
+        mPeakRunning(0),
+        mNextTicket(0),
+        mNowServing(0),
+        mQueued(0),
+        mTotalWaitMs(0),
+        mMaxWaitMs(0) {}
+
+size_t DexoptScheduler::getDefaultLimit() {
+    // dex2oat is multi-threaded itself, so leave half the CPUs to the rest of the system.
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 1 ? static_cast<size_t>(cpus / 2) : 1;
+}
+
+size_t DexoptScheduler::getLimitLocked() const {
+    return mLimit != 0 ? mLimit : getDefaultLimit();
+}
+
+DexoptScheduler::Slot DexoptScheduler::acquire() {
+    std::unique_lock lock(mLock);
+    const uint64_t ticket = mNextTicket++;
+    auto canRun = [&] { return ticket == mNowServing && mRunning < getLimitLocked(); };
+    if (!canRun()) {
+        auto start = std::chrono::steady_clock::now();
+        mCondition.wait(lock, canRun);
+        int64_t waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+        mQueued++;
+        mTotalWaitMs += waitMs;
+        mMaxWaitMs = std::max(mMaxWaitMs, waitMs);
+    }
+    mNowServing++;
+    mRunning++;
+    mPeakRunning = std::max(mPeakRunning, mRunning);
+    // The next caller may be able to run as well.
+    mCondition.notify_all();
+    return Slot(this);
+}
+
+void DexoptScheduler::release() {
+    std::lock_guard lock(mLock);
+    CHECK_GT(mRunning, 0u);
+    mRunning--;
+    mCondition.notify_all();
+}
+
+void DexoptScheduler::setLimit(size_t limit) {
+    std::lock_guard lock(mLock);
+    mLimit = limit;
+    mCondition.notify_all();
+}
+
+DexoptScheduler::Stats DexoptScheduler::getStats() const {
+    std::lock_guard lock(mLock);
+    return Stats{
+            .limit = getLimitLocked(),
+            .running = mRunning,
+            .waiting = static_cast<size_t>(mNextTicket - mNowServing),
+            .peakRunning = mPeakRunning,
+            .admitted = mNowServing,
+            .queued = mQueued,
+            .totalWaitMs = mTotalWaitMs,
+            .maxWaitMs = mMaxWaitMs,
+    };
+}
+
+void DexoptScheduler::dump(int fd) const {
+    Stats stats = getStats();
+    dprintf(fd, "Dexopt scheduler:\n");
+    dprintf(fd, "    limit=%zu running=%zu waiting=%zu peak_running=%zu\n", stats.limit,
+            stats.running, stats.waiting, stats.peakRunning);
+    dprintf(fd,
+            "    admitted=%" PRIu64 " queued=%" PRIu64 " total_wait_ms=%" PRId64
+            " max_wait_ms=%" PRId64 "\n",
+            stats.admitted, stats.queued, stats.totalWaitMs, stats.maxWaitMs);
+}
+
+}  // namespace installd
+}  // namespace android
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_INSTALLD_DEXOPT_SCHEDULER_H
+#define ANDROID_INSTALLD_DEXOPT_SCHEDULER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace installd {
+
+/**
+ * Bounds the number of dex2oat invocations that run at the same time.
+ *
+ * Every binder thread of installd can run a dexopt, and bulk optimization used
+ * to either run one package at a time or oversubscribe the CPUs. Callers take a
+ * Slot before doing any CPU heavy compilation; slots are handed out in arrival
+ * order, and the I/O heavy operations that don't take a slot (profile merging,
+ * app data creation, restorecon) keep running on the other binder threads.
+ *
+ * The limit can be changed at any time, e.g. by the system server when the
+ * thermal status changes. A limit of 0 selects the default, which is derived
+ * from the number of online CPUs.
+ */
+class DexoptScheduler {
+public:
+    struct Stats {
+        size_t limit;
+        size_t running;
+        size_t waiting;
+        size_t peakRunning;
+        uint64_t admitted;
+        // Number of admissions that had to wait for a slot.
+        uint64_t queued;
+        int64_t totalWaitMs;
+        int64_t maxWaitMs;
+    };
+
+    class Slot {
+    public:
+        Slot(Slot&& other) noexcept : mScheduler(other.mScheduler) { other.mScheduler = nullptr; }
+        ~Slot();
+
+    private:
+        friend class DexoptScheduler;
+        explicit Slot(DexoptScheduler* scheduler) : mScheduler(scheduler) {}
+        DexoptScheduler* mScheduler;
+
+        DISALLOW_COPY_AND_ASSIGN(Slot);
+    };
+
+    DexoptScheduler();
+
+    // Block until fewer than limit compilations are running and all the
+    // earlier callers were admitted.
+    Slot acquire();
+
+    void setLimit(size_t limit);
+    Stats getStats() const;
+
+    void dump(int fd) const;
+
+    // The limit used when none was set explicitly.
+    static size_t getDefaultLimit();
+
+private:
+    void release();
+    size_t getLimitLocked() const;
+
+    mutable std::mutex mLock;
+    std::condition_variable mCondition;
+
+    size_t mLimit;
+    size_t mRunning;
+    size_t mPeakRunning;
+    uint64_t mNextTicket;
+    uint64_t mNowServing;
+    uint64_t mQueued;
+    int64_t mTotalWaitMs;
+    int64_t mMaxWaitMs;
+
+    DISALLOW_COPY_AND_ASSIGN(DexoptScheduler);
+};
+
+}  // namespace installd
+}  // namespace android
+
+#endif  // ANDROID_INSTALLD_DEXOPT_SCHEDULER_H
@@ -35,10 +35,14 @@
 #include <sys/xattr.h>
 #include <unistd.h>
 #include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <map>
+#include <mutex>
 #include <regex>
+#include <thread>
 #include <unordered_set>
 
 #include <android-base/file.h>
@@ -104,6 +108,14 @@ static constexpr const char* kMiscMirrorDePath = "/data_mirror/misc_de";
 
 static constexpr const int MIN_RESTRICTED_HOME_SDK_VERSION = 24; // > M
 
+// Size measurements taking longer than this are logged
+static constexpr const int64_t kSlowSizeMeasurementMs = 200;
+
+// Number of threads, including the calling one, restoreconAppDataBatched uses
+static constexpr const size_t kRestoreconThreads = 4;
+// restoreconAppDataBatched calls slower than this are logged
+static constexpr const int64_t kSlowRestoreconMs = 1000;
+
 static constexpr const char* PKG_LIB_POSTFIX = "/lib";
 static constexpr const char* CACHE_DIR_POSTFIX = "/cache";
 static constexpr const char* CODE_CACHE_DIR_POSTFIX = "/code_cache";
@@ -405,6 +417,16 @@ status_t InstalldNativeService::dump(int fd, const Vector<String16>& /* args */)
     }
 
     dprintf(fd, "is_dexopt_blocked:%d\n", android::installd::is_dexopt_blocked());
+    mDexoptScheduler.dump(fd);
+
+    dprintf(fd, "Batched restorecon:\n");
+    dprintf(fd,
+            "    batches=%" PRIu64 " paths=%" PRIu64 " recursive=%" PRIu64 " skipped=%" PRIu64
+            " label_cache_hits=%" PRIu64 " failures=%" PRIu64 " total_ms=%" PRId64 "\n",
+            mRestoreconStats.batches.load(), mRestoreconStats.paths.load(),
+            mRestoreconStats.recursive.load(), mRestoreconStats.skipped.load(),
+            mRestoreconStats.labelCacheHits.load(), mRestoreconStats.failures.load(),
+            mRestoreconStats.totalMs.load());
 
     return NO_ERROR;
 }
@@ -2066,13 +2088,19 @@ binder::Status InstalldNativeService::freeCache(const std::optional<std::string>
                     queue.push(active);
                 }
                 active = queue.top(); queue.pop();
-                active->ensureItems();
+                // Only the oldest items that can free up what's still needed are loaded
+                active->ensureItems(defy_target ? -1 : needed);
                 continue;
             }
 
-            // If no items remain, go find another tracker
+            // If no items remain, go back for the ones left out of the last
+            // load, or find another tracker
             if (active->items.empty()) {
-                active = nullptr;
+                if (active->hasMoreItems()) {
+                    active->loadMoreItems();
+                } else {
+                    active = nullptr;
+                }
                 continue;
             } else {
                 auto item = active->items.back();
@@ -2400,6 +2428,7 @@ binder::Status InstalldNativeService::getAppSize(const std::optional<std::string
         const std::vector<std::string>& codePaths, std::vector<int64_t>* _aidl_return) {
     ENFORCE_UID(AID_SYSTEM);
     CHECK_ARGUMENT_UUID(uuid);
+    ScopedPmTrace trace("getAppSize", kSlowSizeMeasurementMs);
     if (packageNames.size() != ceDataInodes.size()) {
         return exception(binder::Status::EX_ILLEGAL_ARGUMENT,
                          "packageNames/ceDataInodes size mismatch.");
@@ -2645,6 +2674,7 @@ binder::Status InstalldNativeService::getUserSize(const std::optional<std::strin
         std::vector<int64_t>* _aidl_return) {
     ENFORCE_UID(AID_SYSTEM);
     CHECK_ARGUMENT_UUID(uuid);
+    ScopedPmTrace trace("getUserSize", kSlowSizeMeasurementMs);
     // NOTE: Locking is relaxed on this method, since it's limited to
     // read-only measurements without mutation.
 
@@ -2784,6 +2814,7 @@ binder::Status InstalldNativeService::getExternalSize(const std::optional<std::s
         std::vector<int64_t>* _aidl_return) {
     ENFORCE_UID(AID_SYSTEM);
     CHECK_ARGUMENT_UUID(uuid);
+    ScopedPmTrace trace("getExternalSize", kSlowSizeMeasurementMs);
     // NOTE: Locking is relaxed on this method, since it's limited to
     // read-only measurements without mutation.
 
@@ -3098,6 +3129,9 @@ binder::Status InstalldNativeService::dexopt(
     CHECK_ARGUMENT_PATH(outputPath);
     CHECK_ARGUMENT_PATH(dexMetadataPath);
     const auto userId = multiuser_get_user_id(uid);
+    // Wait for a compilation slot before taking the package lock, so that other operations on
+    // the package are not held up while this call is queued.
+    auto slot = mDexoptScheduler.acquire();
     LOCK_PACKAGE_USER();
 
     const char* oat_dir = getCStr(outputPath);
@@ -3131,6 +3165,16 @@ binder::Status InstalldNativeService::controlDexOptBlocking(bool block) {
     return ok();
 }
 
+binder::Status InstalldNativeService::setDexoptConcurrencyLimit(int32_t limit) {
+    ENFORCE_UID(AID_SYSTEM);
+    if (limit < 0) {
+        return exception(binder::Status::EX_ILLEGAL_ARGUMENT,
+                         StringPrintf("Invalid dexopt concurrency limit %d", limit));
+    }
+    mDexoptScheduler.setLimit(static_cast<size_t>(limit));
+    return ok();
+}
+
 binder::Status InstalldNativeService::compileLayouts(const std::string& apkPath,
                                                      const std::string& packageName,
                                                      const std ::string& outDexFile, int uid,
@@ -3275,6 +3319,146 @@ binder::Status InstalldNativeService::restoreconAppDataLocked(
     return res;
 }
 
+/**
+ * Labels given to package directories during one restoreconAppDataBatched call. The label of a
+ * package directory only depends on the seinfo and the uid, which determines the MLS categories,
+ * so the CE and DE directories of a package share it. Once one of them was restored, the others
+ * can be checked against the cached label instead of asking libselinux again.
+ */
+class RestoreconLabelCache {
+public:
+    bool get(const std::string& seInfo, uid_t uid, std::string* label) {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto it = mLabels.find(std::make_pair(seInfo, uid));
+        if (it == mLabels.end()) {
+            return false;
+        }
+        *label = it->second;
+        return true;
+    }
+
+    void put(const std::string& seInfo, uid_t uid, const std::string& label) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mLabels[std::make_pair(seInfo, uid)] = label;
+    }
+
+private:
+    std::mutex mLock;
+    std::map<std::pair<std::string, uid_t>, std::string> mLabels;
+};
+
+static bool get_file_label(const std::string& path, std::string* label) {
+    char* context = nullptr;
+    if (lgetfilecon(path.c_str(), &context) < 0) {
+        PLOG(ERROR) << "Failed to getfilecon for " << path;
+        return false;
+    }
+    *label = context;
+    freecon(context);
+    return true;
+}
+
+binder::Status InstalldNativeService::restoreconAppDataBatched(
+        const std::vector<android::os::RestoreconAppDataArgs>& args, bool skipUnchanged) {
+    ENFORCE_UID(AID_SYSTEM);
+    for (const auto& arg : args) {
+        CHECK_ARGUMENT_UUID(arg.uuid);
+        CHECK_ARGUMENT_PACKAGE_NAME(arg.packageName);
+    }
+    // Locking is performed per package in restoreconAppDataBatchItem.
+    ScopedPmTrace trace("restoreconAppDataBatched", kSlowRestoreconMs);
+    auto start = std::chrono::steady_clock::now();
+
+    RestoreconLabelCache cache;
+    std::atomic<size_t> next(0);
+    std::mutex resLock;
+    binder::Status res = ok();
+    auto work = [&]() {
+        size_t i;
+        while ((i = next++) < args.size()) {
+            auto status = restoreconAppDataBatchItem(args[i], skipUnchanged, &cache);
+            if (!status.isOk()) {
+                std::lock_guard<std::mutex> lock(resLock);
+                res = status;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(kRestoreconThreads, args.size()); i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    mRestoreconStats.batches++;
+    mRestoreconStats.totalMs += std::chrono::duration_cast<std::chrono::milliseconds>(
+                                        std::chrono::steady_clock::now() - start)
+                                        .count();
+    return res;
+}
+
+binder::Status InstalldNativeService::restoreconAppDataBatchItem(
+        const android::os::RestoreconAppDataArgs& args, bool skipUnchanged,
+        RestoreconLabelCache* cache) {
+    const auto& packageName = args.packageName;
+    const auto userId = args.userId;
+    LOCK_PACKAGE_USER();
+
+    binder::Status res = ok();
+    const char* uuid_ = args.uuid ? args.uuid->c_str() : nullptr;
+    const char* seinfo = args.seInfo.c_str();
+    uid_t uid = multiuser_get_uid(userId, args.appId);
+
+    std::vector<std::string> paths;
+    if (args.flags & FLAG_STORAGE_CE) {
+        paths.push_back(create_data_user_ce_package_path(uuid_, userId, packageName.c_str()));
+    }
+    if (args.flags & FLAG_STORAGE_DE) {
+        paths.push_back(create_data_user_de_package_path(uuid_, userId, packageName.c_str()));
+    }
+
+    for (const auto& path : paths) {
+        mRestoreconStats.paths++;
+        if (skipUnchanged) {
+            // Only walk the tree when its top-level label is wrong, like
+            // restorecon_app_data_lazy does.
+            std::string before;
+            std::string after;
+            if (!get_file_label(path, &before)) {
+                mRestoreconStats.failures++;
+                res = error("restorecon failed for " + path);
+                continue;
+            }
+            if (cache->get(args.seInfo, uid, &after) && before == after) {
+                mRestoreconStats.labelCacheHits++;
+                mRestoreconStats.skipped++;
+                continue;
+            }
+            if (selinux_android_restorecon_pkgdir(path.c_str(), seinfo, uid, 0) < 0 ||
+                !get_file_label(path, &after)) {
+                mRestoreconStats.failures++;
+                res = error("restorecon failed for " + path);
+                continue;
+            }
+            cache->put(args.seInfo, uid, after);
+            if (before == after) {
+                mRestoreconStats.skipped++;
+                continue;
+            }
+        }
+        mRestoreconStats.recursive++;
+        if (selinux_android_restorecon_pkgdir(path.c_str(), seinfo, uid,
+                                              SELINUX_ANDROID_RESTORECON_RECURSE) < 0) {
+            mRestoreconStats.failures++;
+            res = error("restorecon failed for " + path);
+        }
+    }
+    return res;
+}
+
 binder::Status InstalldNativeService::restoreconSdkDataLocked(
         const std::optional<std::string>& uuid, const std::string& packageName, int32_t userId,
         int32_t flags, int32_t appId, const std::string& seInfo) {
@@ -21,6 +21,7 @@
 #include <inttypes.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <shared_mutex>
 #include <unordered_map>
 #include <vector>
@@ -29,12 +30,15 @@
 #include <binder/BinderService.h>
 #include <cutils/multiuser.h>
 
+#include "DexoptScheduler.h"
 #include "android/os/BnInstalld.h"
 #include "installd_constants.h"
 
 namespace android {
 namespace installd {
 
+class RestoreconLabelCache;
+
 class InstalldNativeService : public BinderService<InstalldNativeService>, public os::BnInstalld {
 public:
     static status_t start();
@@ -63,6 +67,8 @@ public:
     binder::Status restoreconAppData(const std::optional<std::string>& uuid,
             const std::string& packageName, int32_t userId, int32_t flags, int32_t appId,
             const std::string& seInfo);
+    binder::Status restoreconAppDataBatched(
+            const std::vector<android::os::RestoreconAppDataArgs>& args, bool skipUnchanged);
 
     binder::Status migrateAppData(const std::optional<std::string>& uuid,
             const std::string& packageName, int32_t userId, int32_t flags);
@@ -125,6 +131,7 @@ public:
                           const std::optional<std::string>& compilationReason, bool* aidl_return);
 
     binder::Status controlDexOptBlocking(bool block);
+    binder::Status setDexoptConcurrencyLimit(int32_t limit);
 
     binder::Status compileLayouts(const std::string& apkPath, const std::string& packageName,
                                   const std::string& outDexFile, int uid, bool* _aidl_return);
@@ -200,6 +207,20 @@ private:
     std::recursive_mutex mMountsLock;
     std::recursive_mutex mQuotasLock;
 
+    DexoptScheduler mDexoptScheduler;
+
+    /* Totals over all restoreconAppDataBatched calls */
+    struct RestoreconStats {
+        std::atomic<uint64_t> batches{0};
+        std::atomic<uint64_t> paths{0};
+        std::atomic<uint64_t> recursive{0};
+        std::atomic<uint64_t> skipped{0};
+        std::atomic<uint64_t> labelCacheHits{0};
+        std::atomic<uint64_t> failures{0};
+        std::atomic<int64_t> totalMs{0};
+    };
+    RestoreconStats mRestoreconStats;
+
     /* Map of all storage mounts from source to target */
     std::unordered_map<std::string, std::string> mStorageMounts;
 
@@ -216,6 +237,8 @@ private:
     binder::Status restoreconAppDataLocked(const std::optional<std::string>& uuid,
                                            const std::string& packageName, int32_t userId,
                                            int32_t flags, int32_t appId, const std::string& seInfo);
+    binder::Status restoreconAppDataBatchItem(const android::os::RestoreconAppDataArgs& args,
+                                              bool skipUnchanged, RestoreconLabelCache* cache);
 
     binder::Status createSdkSandboxDataPackageDirectory(const std::optional<std::string>& uuid,
                                                         const std::string& packageName,
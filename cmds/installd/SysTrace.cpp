@@ -17,6 +17,8 @@
 #define ATRACE_TAG ATRACE_TAG_PACKAGE_MANAGER
 
 #include "SysTrace.h"
+#include <android-base/logging.h>
+#include <utils/SystemClock.h>
 #include <utils/Trace.h>
 
 namespace android::installd {
@@ -27,4 +29,17 @@ void atrace_pm_begin(const char* name) {
 void atrace_pm_end() {
     ATRACE_END();
 }
+
+ScopedPmTrace::ScopedPmTrace(const char* name, int64_t slowThresholdMs)
+      : mName(name), mSlowThresholdMs(slowThresholdMs), mStartTimeMs(uptimeMillis()) {
+    atrace_pm_begin(name);
+}
+
+ScopedPmTrace::~ScopedPmTrace() {
+    atrace_pm_end();
+    int64_t durationMs = uptimeMillis() - mStartTimeMs;
+    if (durationMs >= mSlowThresholdMs) {
+        LOG(INFO) << mName << " took " << durationMs << "ms";
+    }
+}
 } /* namespace android::installd */
@@ -16,7 +16,22 @@
 
 #pragma once
 
+#include <stdint.h>
+
 namespace android::installd {
 void atrace_pm_begin(const char*);
 void atrace_pm_end();
+
+// Traces a section for the lifetime of the object, and logs how long it took if it took longer than
+// slowThresholdMs.
+class ScopedPmTrace {
+public:
+    ScopedPmTrace(const char* name, int64_t slowThresholdMs);
+    ~ScopedPmTrace();
+
+private:
+    const char* mName;
+    const int64_t mSlowThresholdMs;
+    const int64_t mStartTimeMs;
+};
 } /* namespace android::installd */
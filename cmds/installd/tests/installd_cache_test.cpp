@@ -237,6 +237,26 @@ TEST_F(CacheTest, FreeCache_Age) {
     EXPECT_EQ(-1, exists("com.example/cache/foo/two"));
 }
 
+TEST_F(CacheTest, FreeCache_AgeMany) {
+    LOG(INFO) << "FreeCache_AgeMany";
+
+    mkdir("com.example");
+    mkdir("com.example/cache");
+    mkdir("com.example/cache/foo");
+    touch("com.example/cache/foo/one", kMbInBytes, 60);
+    touch("com.example/cache/foo/two", kMbInBytes, 120);
+    touch("com.example/cache/foo/three", kMbInBytes, 180);
+    touch("com.example/cache/foo/four", kMbInBytes, 240);
+
+    service->freeCache(testUuid, free() + kMbInBytes + kKbInBytes,
+            FLAG_FREE_CACHE_V2 | FLAG_FREE_CACHE_V2_DEFY_QUOTA);
+
+    EXPECT_EQ(-1, exists("com.example/cache/foo/one"));
+    EXPECT_EQ(-1, exists("com.example/cache/foo/two"));
+    EXPECT_EQ(0, exists("com.example/cache/foo/three"));
+    EXPECT_EQ(0, exists("com.example/cache/foo/four"));
+}
+
 TEST_F(CacheTest, FreeCache_Tombstone) {
     LOG(INFO) << "FreeCache_Tombstone";
 
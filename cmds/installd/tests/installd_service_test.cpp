@@ -469,6 +469,44 @@ TEST_F(ServiceTest, CalculateCache) {
     EXPECT_TRUE(create_cache_path(buf, "/path/to/file.apk", "isa"));
     EXPECT_EQ("/data/dalvik-cache/isa/path@to@file.apk@classes.dex", std::string(buf));
 }
+
+TEST_F(ServiceTest, DexoptScheduler_Limit) {
+    DexoptScheduler scheduler;
+    EXPECT_EQ(DexoptScheduler::getDefaultLimit(), scheduler.getStats().limit);
+
+    scheduler.setLimit(2);
+    {
+        auto first = scheduler.acquire();
+        auto second = scheduler.acquire();
+        auto stats = scheduler.getStats();
+        EXPECT_EQ(2u, stats.limit);
+        EXPECT_EQ(2u, stats.running);
+        EXPECT_EQ(0u, stats.waiting);
+    }
+    auto stats = scheduler.getStats();
+    EXPECT_EQ(0u, stats.running);
+    EXPECT_EQ(2u, stats.peakRunning);
+    EXPECT_EQ(2u, stats.admitted);
+    EXPECT_EQ(0u, stats.queued);
+}
+
+TEST_F(ServiceTest, RestoreconAppDataBatched_InvalidPackageName) {
+    android::os::RestoreconAppDataArgs args;
+    args.uuid = kTestUuid;
+    args.packageName = "../com.example";
+    args.userId = 0;
+    args.flags = FLAG_STORAGE_CE | FLAG_STORAGE_DE;
+    args.appId = 10000;
+    args.seInfo = "default";
+    EXPECT_BINDER_FAIL(service->restoreconAppDataBatched({args}, true));
+    ASSERT_BINDER_SUCCESS(service->restoreconAppDataBatched({}, true));
+}
+
+TEST_F(ServiceTest, SetDexoptConcurrencyLimit) {
+    ASSERT_BINDER_SUCCESS(service->setDexoptConcurrencyLimit(1));
+    ASSERT_BINDER_SUCCESS(service->setDexoptConcurrencyLimit(0));
+    EXPECT_BINDER_FAIL(service->setDexoptConcurrencyLimit(-1));
+}
 TEST_F(ServiceTest, GetAppSizeManualForMedia) {
     struct stat s;
 
@@ -15,12 +15,15 @@
  */
 
 #include <errno.h>
+#include <ftw.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/scopeguard.h>
+#include <android-base/stringprintf.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -754,5 +757,49 @@ TEST_F(UtilsTest, RemoveFileAtFd) {
     close(fd);
 }
 
+static int64_t gExpectedTreeSize;
+
+static int addToExpectedTreeSize(const char*, const struct stat* s, int, struct FTW*) {
+    gExpectedTreeSize += s->st_blocks * 512;
+    return 0;
+}
+
+TEST_F(UtilsTest, CalculateTreeSize) {
+    std::string root = "/data/local/tmp/tree-size-XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(root.data()));
+    auto cleanup = android::base::make_scope_guard(
+            [&root] { delete_dir_contents_and_dir(root, /*ignore_if_missing=*/true); });
+
+    // Enough directories for the walk to be shared with the helper threads
+    const std::string content(4096, 'x');
+    for (int i = 0; i < 50; i++) {
+        std::string dir = android::base::StringPrintf("%s/dir%d", root.c_str(), i);
+        ASSERT_EQ(0, mkdir(dir.c_str(), 0700));
+        ASSERT_EQ(0, mkdir((dir + "/sub").c_str(), 0700));
+        ASSERT_TRUE(android::base::WriteStringToFile(content, dir + "/sub/file"));
+    }
+    ASSERT_EQ(0, symlink("/system", (root + "/link").c_str()));
+
+    gExpectedTreeSize = 0;
+    ASSERT_EQ(0, nftw(root.c_str(), addToExpectedTreeSize, 16, FTW_PHYS | FTW_MOUNT));
+    ASSERT_GT(gExpectedTreeSize, 50 * 4096);
+
+    int64_t size = 0;
+    EXPECT_EQ(0, calculate_tree_size(root, &size));
+    EXPECT_EQ(gExpectedTreeSize, size);
+
+    size = 0;
+    EXPECT_EQ(0, calculate_tree_size(root, &size, /*include_gid=*/getgid()));
+    EXPECT_EQ(gExpectedTreeSize, size);
+
+    size = 0;
+    EXPECT_EQ(0, calculate_tree_size(root, &size, /*include_gid=*/-1, /*exclude_gid=*/getgid()));
+    EXPECT_EQ(0, size);
+
+    size = 0;
+    EXPECT_EQ(0, calculate_tree_size(root + "/missing", &size));
+    EXPECT_EQ(0, size);
+}
+
 }  // namespace installd
 }  // namespace android
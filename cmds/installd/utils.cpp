@@ -25,11 +25,19 @@
 #include <sys/pidfd.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <sys/xattr.h>
 #include <unistd.h>
 #include <uuid/uuid.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
@@ -464,47 +472,211 @@ int set_quota_project_id(const std::string& path, long project_id, bool set_inhe
     return 0;
 }
 
-int calculate_tree_size(const std::string& path, int64_t* size,
-        int32_t include_gid, int32_t exclude_gid, bool exclude_apps) {
-    FTS *fts;
-    FTSENT *p;
-    int64_t matchedSize = 0;
-    char *argv[] = { (char*) path.c_str(), nullptr };
-    if (!(fts = fts_open(argv, FTS_PHYSICAL | FTS_NOCHDIR | FTS_XDEV, nullptr))) {
-        if (errno != ENOENT) {
-            PLOG(ERROR) << "Failed to fts_open " << path;
+// Number of threads helping calculate_tree_size measure large trees, besides the caller
+static constexpr size_t kTreeSizeHelperThreads = 3;
+// Directory entries are read in batches of this size
+static constexpr size_t kDirentBufferSize = 32 * 1024;
+
+namespace {
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// A tree measured by calculate_tree_size. The threads measuring it share the directories left to
+// read. This has the same semantics as the fts walk it replaces: symlinks aren't followed, other
+// file systems aren't entered and directories that can't be read only count for themselves.
+class TreeSizeWalk : public std::enable_shared_from_this<TreeSizeWalk> {
+public:
+    TreeSizeWalk(dev_t dev, int32_t includeGid, int32_t excludeGid, bool excludeApps)
+          : mDev(dev),
+            mIncludeGid(includeGid),
+            mExcludeGid(excludeGid),
+            mExcludeApps(excludeApps) {}
+
+    bool isExcluded(const struct stat& s) const {
+        if (!mExcludeApps) return false;
+        int32_t user_uid = multiuser_get_app_id(s.st_uid);
+        int32_t user_gid = multiuser_get_app_id(s.st_gid);
+        return (user_uid >= AID_APP_START && user_uid <= AID_APP_END)
+                || (user_gid >= AID_CACHE_GID_START && user_gid <= AID_CACHE_GID_END)
+                || (user_gid >= AID_SHARED_GID_START && user_gid <= AID_SHARED_GID_END);
+    }
+
+    int64_t measure(const struct stat& s) const {
+        int32_t gid = s.st_gid;
+        if (mIncludeGid != -1 && gid != mIncludeGid) return 0;
+        if (mExcludeGid != -1 && gid == mExcludeGid) return 0;
+        return s.st_blocks * 512;
+    }
+
+    void addDirectory(std::string path) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mPending.push_back(std::move(path));
+    }
+
+    // Reads directories until the whole tree is measured. Can be called by several threads.
+    void work();
+
+    int64_t size() const { return mSize; }
+
+private:
+    void readDirectory(const std::string& path, linux_dirent64* buffer,
+                       std::vector<std::string>* subdirs);
+
+    const dev_t mDev;
+    const int32_t mIncludeGid;
+    const int32_t mExcludeGid;
+    const bool mExcludeApps;
+    std::atomic<int64_t> mSize{0};
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    // Directories left to read
+    std::vector<std::string> mPending;
+    // Number of threads reading a directory
+    size_t mActive = 0;
+};
+
+// Threads that help measuring trees with many directories.
+class TreeSizeHelpers {
+public:
+    static TreeSizeHelpers& get() {
+        static TreeSizeHelpers* helpers = new TreeSizeHelpers();
+        return *helpers;
+    }
+
+    // Let up to count idle threads help with the walk.
+    void offer(const std::shared_ptr<TreeSizeWalk>& walk, size_t count) {
+        std::lock_guard<std::mutex> lock(mLock);
+        while (mStarted < kTreeSizeHelperThreads) {
+            mStarted++;
+            mIdle++;
+            std::thread([this] { loop(); }).detach();
+        }
+        for (; count > 0 && mWalks.size() < mIdle; count--) {
+            mWalks.push_back(walk);
+            mCondition.notify_one();
         }
-        return -1;
     }
-    while ((p = fts_read(fts)) != nullptr) {
-        switch (p->fts_info) {
-        case FTS_D:
-        case FTS_DEFAULT:
-        case FTS_F:
-        case FTS_SL:
-        case FTS_SLNONE:
-            int32_t uid = p->fts_statp->st_uid;
-            int32_t gid = p->fts_statp->st_gid;
-            int32_t user_uid = multiuser_get_app_id(uid);
-            int32_t user_gid = multiuser_get_app_id(gid);
-            if (exclude_apps && ((user_uid >= AID_APP_START && user_uid <= AID_APP_END)
-                    || (user_gid >= AID_CACHE_GID_START && user_gid <= AID_CACHE_GID_END)
-                    || (user_gid >= AID_SHARED_GID_START && user_gid <= AID_SHARED_GID_END))) {
-                // Don't traverse inside or measure
-                fts_set(fts, p, FTS_SKIP);
-                break;
+
+private:
+    void loop() {
+        std::unique_lock<std::mutex> lock(mLock);
+        while (true) {
+            mCondition.wait(lock, [this] { return !mWalks.empty(); });
+            std::shared_ptr<TreeSizeWalk> walk = std::move(mWalks.front());
+            mWalks.pop_front();
+            mIdle--;
+            lock.unlock();
+            walk->work();
+            walk.reset();
+            lock.lock();
+            mIdle++;
+        }
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<std::shared_ptr<TreeSizeWalk>> mWalks;
+    size_t mStarted = 0;
+    size_t mIdle = 0;
+};
+
+void TreeSizeWalk::work() {
+    std::unique_ptr<linux_dirent64, decltype(&free)> buffer(
+            static_cast<linux_dirent64*>(malloc(kDirentBufferSize)), &free);
+    std::vector<std::string> subdirs;
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        if (mPending.empty()) {
+            if (mActive == 0) return;
+            mCondition.wait(lock);
+            continue;
+        }
+        std::string path = std::move(mPending.back());
+        mPending.pop_back();
+        mActive++;
+        lock.unlock();
+
+        subdirs.clear();
+        readDirectory(path, buffer.get(), &subdirs);
+
+        lock.lock();
+        mActive--;
+        for (std::string& subdir : subdirs) {
+            mPending.push_back(std::move(subdir));
+        }
+        // Wake up the threads waiting for directories, or for the walk to end.
+        mCondition.notify_all();
+        if (mPending.size() > 1) {
+            size_t helpers = mPending.size() - 1;
+            lock.unlock();
+            TreeSizeHelpers::get().offer(shared_from_this(), helpers);
+            lock.lock();
+        }
+    }
+}
+
+void TreeSizeWalk::readDirectory(const std::string& path, linux_dirent64* buffer,
+                                 std::vector<std::string>* subdirs) {
+    unique_fd fd(open(path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+    if (fd == -1) {
+        return;
+    }
+
+    int64_t size = 0;
+    long count;
+    while ((count = syscall(SYS_getdents64, fd.get(), buffer, kDirentBufferSize)) > 0) {
+        for (long offset = 0; offset < count;) {
+            const linux_dirent64* de =
+                    reinterpret_cast<const linux_dirent64*>(
+                            reinterpret_cast<const char*>(buffer) + offset);
+            offset += de->d_reclen;
+            const char* name = de->d_name;
+            if (!strcmp(name, ".") || !strcmp(name, "..")) {
+                continue;
             }
-            if (include_gid != -1 && gid != include_gid) {
-                break;
+
+            struct stat s;
+            if (fstatat(fd.get(), name, &s, AT_SYMLINK_NOFOLLOW) != 0 || isExcluded(s)) {
+                continue;
             }
-            if (exclude_gid != -1 && gid == exclude_gid) {
-                break;
+            if (S_ISDIR(s.st_mode)) {
+                // Like FTS_XDEV, mount points are neither entered nor measured
+                if (s.st_dev != mDev) continue;
+                subdirs->push_back(path + "/" + name);
             }
-            matchedSize += (p->fts_statp->st_blocks * 512);
-            break;
+            size += measure(s);
+        }
+    }
+    mSize += size;
+}
+
+} // namespace
+
+int calculate_tree_size(const std::string& path, int64_t* size,
+        int32_t include_gid, int32_t exclude_gid, bool exclude_apps) {
+    struct stat s;
+    if (lstat(path.c_str(), &s) != 0) {
+        // Nothing to measure
+        return 0;
+    }
+
+    auto walk = std::make_shared<TreeSizeWalk>(s.st_dev, include_gid, exclude_gid, exclude_apps);
+    int64_t matchedSize = 0;
+    if (!walk->isExcluded(s)) {
+        matchedSize = walk->measure(s);
+        if (S_ISDIR(s.st_mode)) {
+            walk->addDirectory(path);
+            walk->work();
+            matchedSize += walk->size();
         }
     }
-    fts_close(fts);
 #if MEASURE_DEBUG
     if ((include_gid == -1) && (exclude_gid == -1)) {
         LOG(DEBUG) << "Measured " << path << " size " << matchedSize;
@@ -19,6 +19,7 @@
 #include <getopt.h>
 
 #include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <functional>
 #include <iomanip>
@@ -26,6 +27,7 @@
 #include <map>
 #include <regex>
 #include <sstream>
+#include <thread>
 
 #include <android-base/file.h>
 #include <android-base/hex.h>
@@ -54,6 +56,26 @@ using ::android::hidl::manager::V1_0::IServiceManager;
 namespace android {
 namespace lshal {
 
+// Number of services queried at the same time. Most of the time spent on a service is
+// waiting for its process to answer, so this is not bound to the number of CPUs.
+static constexpr size_t kMaxFetchThreads = 8;
+
+// Calls func(i) for every i in [0, count) on up to kMaxFetchThreads threads.
+static void forEachIndexInParallel(size_t count, const std::function<void(size_t)>& func) {
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < std::min(count, kMaxFetchThreads); ++t) {
+        threads.emplace_back([&] {
+            for (size_t i = next++; i < count; i = next++) {
+                func(i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
 vintf::SchemaType toSchemaType(Partition p) {
     return (p == Partition::SYSTEM) ? vintf::SchemaType::FRAMEWORK : vintf::SchemaType::DEVICE;
 }
@@ -211,13 +233,17 @@ bool ListCommand::getPidInfo(
 }
 
 const BinderPidInfo* ListCommand::getPidInfoCached(pid_t serverPid) {
-    auto pair = mCachedPidInfos.insert({serverPid, BinderPidInfo{}});
-    if (pair.second /* did insertion take place? */) {
-        if (!getPidInfo(serverPid, &pair.first->second)) {
-            return nullptr;
-        }
+    CachedPidInfo* cached;
+    {
+        std::lock_guard<std::mutex> lock(mCachedPidInfosLock);
+        auto& slot = mCachedPidInfos[serverPid];
+        if (slot == nullptr) slot = std::make_unique<CachedPidInfo>();
+        cached = slot.get();
     }
-    return &pair.first->second;
+    // Many services live in the same process; parse its binder state only once, even when
+    // several fetch threads ask for it at the same time.
+    std::call_once(cached->once, [&] { cached->valid = getPidInfo(serverPid, &cached->info); });
+    return cached->valid ? &cached->info : nullptr;
 }
 
 bool ListCommand::shouldFetchHalType(const HalType &type) const {
@@ -469,7 +495,29 @@ void ListCommand::dumpTable(const NullableOStream<std::ostream>& out) const {
         return;
     }
 
-    forEachTable([this, &out](const Table &table) {
+    // Collect the debug info of all services up front and in parallel; each IBase::debug
+    // call may take a while, and the table below is written in order anyway.
+    std::map<std::string, std::string> debugInfos;
+    if (mEmitDebugInfo) {
+        std::vector<std::string> interfaceNames;
+        for (const auto& entry : mServicesTable) {
+            interfaceNames.push_back(entry.interfaceName);
+        }
+        std::vector<std::string> outputs(interfaceNames.size());
+        forEachIndexInParallel(interfaceNames.size(), [&](size_t i) {
+            std::stringstream ss;
+            auto pair = splitFirst(interfaceNames[i], '/');
+            mLshal.emitDebugInfo(pair.first, pair.second, {},
+                                 ParentDebugInfoLevel::FQNAME_ONLY, ss,
+                                 NullableOStream<std::ostream>(nullptr));
+            outputs[i] = ss.str();
+        });
+        for (size_t i = 0; i < interfaceNames.size(); ++i) {
+            debugInfos.emplace(interfaceNames[i], std::move(outputs[i]));
+        }
+    }
+
+    forEachTable([this, &out, &debugInfos](const Table &table) {
 
         // We're only interested in dumping debug info for already
         // instantiated services. There's little value in dumping the
@@ -477,13 +525,9 @@ void ListCommand::dumpTable(const NullableOStream<std::ostream>& out) const {
         // on the "mServicesTable".
         std::function<std::string(const std::string&)> emitDebugInfo = nullptr;
         if (mEmitDebugInfo && &table == &mServicesTable) {
-            emitDebugInfo = [this](const auto& iName) {
-                std::stringstream ss;
-                auto pair = splitFirst(iName, '/');
-                mLshal.emitDebugInfo(pair.first, pair.second, {},
-                                     ParentDebugInfoLevel::FQNAME_ONLY, ss,
-                                     NullableOStream<std::ostream>(nullptr));
-                return ss.str();
+            emitDebugInfo = [&debugInfos](const auto& iName) {
+                auto it = debugInfos.find(iName);
+                return it == debugInfos.end() ? std::string() : it->second;
             };
         }
         table.createTextTable(mNeat, emitDebugInfo).dump(out.buf());
@@ -613,7 +657,6 @@ Status ListCommand::fetchBinderized(const sp<IServiceManager> &manager) {
         return DUMP_BINDERIZED_ERROR;
     }
 
-    Status status = OK;
     std::map<std::string, TableEntry> allTableEntries;
     for (const auto& fqInstanceName : *fqInstanceNames) {
         // create entry and default assign all fields.
@@ -621,8 +664,24 @@ Status ListCommand::fetchBinderized(const sp<IServiceManager> &manager) {
         entry.interfaceName = fqInstanceName;
         entry.transport = mode;
         entry.serviceStatus = ServiceStatus::NON_RESPONSIVE;
+    }
 
-        status |= fetchBinderizedEntry(manager, &entry);
+    // Query the services in parallel. Warnings are buffered per entry so that they are not
+    // interleaved and come out in a stable order.
+    std::vector<TableEntry*> entries;
+    for (auto& pair : allTableEntries) {
+        entries.push_back(&pair.second);
+    }
+    std::vector<Status> statuses(entries.size(), OK);
+    std::vector<std::stringstream> warnings(entries.size());
+    forEachIndexInParallel(entries.size(), [&](size_t i) {
+        statuses[i] = fetchBinderizedEntry(manager, entries[i], warnings[i]);
+    });
+
+    Status status = OK;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        err() << warnings[i].str();
+        status |= statuses[i];
     }
 
     for (auto& pair : allTableEntries) {
@@ -632,10 +691,10 @@ Status ListCommand::fetchBinderized(const sp<IServiceManager> &manager) {
 }
 
 Status ListCommand::fetchBinderizedEntry(const sp<IServiceManager> &manager,
-                                         TableEntry *entry) {
+                                         TableEntry *entry, std::ostream &warnings) {
     Status status = OK;
     const auto handleError = [&](Status additionalError, const std::string& msg) {
-        err() << "Warning: Skipping \"" << entry->interfaceName << "\": " << msg << std::endl;
+        warnings << "Warning: Skipping \"" << entry->interfaceName << "\": " << msg << std::endl;
         status |= DUMP_BINDERIZED_ERROR | additionalError;
     };
 
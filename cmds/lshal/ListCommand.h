@@ -20,6 +20,9 @@
 #include <stdint.h>
 
 #include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -99,14 +102,16 @@ protected:
     Status fetchManifestHals();
     Status fetchLazyHals();
 
+    // May be called from several threads at once; warnings are written to 'warnings'.
     Status fetchBinderizedEntry(const sp<::android::hidl::manager::V1_0::IServiceManager> &manager,
-                                TableEntry *entry);
+                                TableEntry *entry, std::ostream &warnings);
 
     // Get relevant information for a PID by parsing files under
     // /dev/binderfs/binder_logs or /d/binder.
     // It is a virtual member function so that it can be mocked.
     virtual bool getPidInfo(pid_t serverPid, BinderPidInfo *info) const;
-    // Retrieve from mCachedPidInfos and call getPidInfo if necessary.
+    // Retrieve from mCachedPidInfos and call getPidInfo if necessary. Thread safe; getPidInfo
+    // is called at most once per PID.
     const BinderPidInfo* getPidInfoCached(pid_t serverPid);
 
     void dumpTable(const NullableOStream<std::ostream>& out) const;
@@ -186,7 +191,13 @@ protected:
     std::map<pid_t, std::string> mCmdlines;
 
     // Cache for getPidInfo.
-    std::map<pid_t, BinderPidInfo> mCachedPidInfos;
+    struct CachedPidInfo {
+        std::once_flag once;
+        bool valid = false;
+        BinderPidInfo info;
+    };
+    std::mutex mCachedPidInfosLock;
+    std::map<pid_t, std::unique_ptr<CachedPidInfo>> mCachedPidInfos;
 
     // Cache for getPartition.
     std::map<pid_t, Partition> mPartitions;
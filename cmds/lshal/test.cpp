@@ -453,6 +453,18 @@ TEST_F(ListTest, GetPidInfoCached) {
     EXPECT_NE(nullptr, mockList->getPidInfoCached(5));
 }
 
+TEST_F(ListTest, GetPidInfoCachedConcurrently) {
+    EXPECT_CALL(*mockList, getPidInfo(5, _)).Times(1);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([this] { EXPECT_NE(nullptr, mockList->getPidInfoCached(5)); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
 TEST_F(ListTest, Fetch) {
     optind = 1; // mimic Lshal::parseArg()
     ASSERT_EQ(0u, mockList->parseArgs(createArg({"lshal"})));
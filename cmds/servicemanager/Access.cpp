@@ -44,11 +44,14 @@ static std::string getPidcon(pid_t pid) {
     return result;
 }
 
-static struct selabel_handle* getSehandle() {
+// Sets *reloaded when the handle had to be reopened because the policy or the enforcing mode
+// changed, which invalidates any access decision made before.
+static struct selabel_handle* getSehandle(bool* reloaded = nullptr) {
     static struct selabel_handle* gSehandle = nullptr;
     if (gSehandle != nullptr && selinux_status_updated()) {
         selabel_close(gSehandle);
         gSehandle = nullptr;
+        if (reloaded) *reloaded = true;
     }
 
     if (gSehandle == nullptr) {
@@ -80,7 +83,7 @@ static int auditCallback(void *data, security_class_t /*cls*/, char *buf, size_t
 }
 #endif
 
-Access::Access() {
+Access::Access(size_t findDecisionCacheCapacity) : mFindDecisions(findDecisionCacheCapacity) {
 #ifdef __ANDROID__
     union selinux_callback cb;
 
@@ -117,8 +120,66 @@ Access::CallingContext Access::getCallingContext() {
 #endif
 }
 
+std::string FindDecisionCache::makeKey(const std::string& sid, const std::string& name) {
+    std::string key;
+    key.reserve(sid.size() + 1 + name.size());
+    key.append(sid).push_back('\0');
+    key.append(name);
+    return key;
+}
+
+bool FindDecisionCache::lookup(const std::string& sid, const std::string& name) {
+    auto it = mEntries.find(makeKey(sid, name));
+    if (it == mEntries.end()) {
+        mMisses++;
+        return false;
+    }
+    mLru.splice(mLru.begin(), mLru, it->second);
+    mHits++;
+    return true;
+}
+
+void FindDecisionCache::insert(const std::string& sid, const std::string& name) {
+    if (mCapacity == 0) return;
+
+    std::string key = makeKey(sid, name);
+    if (auto it = mEntries.find(key); it != mEntries.end()) {
+        mLru.splice(mLru.begin(), mLru, it->second);
+        return;
+    }
+    if (mEntries.size() >= mCapacity) {
+        mEntries.erase(mLru.back());
+        mLru.pop_back();
+    }
+    mLru.push_front(std::move(key));
+    mEntries.emplace(mLru.front(), mLru.begin());
+}
+
+void FindDecisionCache::clear() {
+    mEntries.clear();
+    mLru.clear();
+}
+
 bool Access::canFind(const CallingContext& ctx,const std::string& name) {
+#ifdef __ANDROID__
+    bool reloaded = false;
+    getSehandle(&reloaded);
+    if (reloaded) {
+        mFindDecisions.clear();
+    }
+    // The sid is all the access check depends on, the pid and uid are only used for auditing.
+    if (mFindDecisions.lookup(ctx.sid, name)) {
+        return true;
+    }
+
+    bool allowed = actionAllowedFromLookup(ctx, name, "find");
+    if (allowed) {
+        mFindDecisions.insert(ctx.sid, name);
+    }
+    return allowed;
+#else
     return actionAllowedFromLookup(ctx, name, "find");
+#endif
 }
 
 bool Access::canAdd(const CallingContext& ctx, const std::string& name) {
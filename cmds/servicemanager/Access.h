@@ -16,15 +16,51 @@
 
 #pragma once
 
+#include <list>
 #include <string>
 #include <sys/types.h>
+#include <unordered_map>
 
 namespace android {
 
+// LRU of the granted find decisions, keyed by (calling context, service name).
+//
+// Looking up a service is the most common servicemanager transaction, and every one of them does
+// a service_contexts lookup and an access check. Only granted decisions are kept so that
+// denials still go through the access check and get audited. Not thread-safe, servicemanager
+// serves all of its transactions from a single thread.
+class FindDecisionCache {
+public:
+    static constexpr size_t kDefaultCapacity = 512;
+
+    explicit FindDecisionCache(size_t capacity = kDefaultCapacity) : mCapacity(capacity) {}
+
+    // Returns true if a granted decision is cached, and marks it as the most recently used.
+    bool lookup(const std::string& sid, const std::string& name);
+    // Records a granted decision, evicting the least recently used one if the cache is full.
+    void insert(const std::string& sid, const std::string& name);
+    void clear();
+
+    size_t size() const { return mEntries.size(); }
+    uint64_t hits() const { return mHits; }
+    uint64_t misses() const { return mMisses; }
+
+private:
+    static std::string makeKey(const std::string& sid, const std::string& name);
+
+    const size_t mCapacity;
+    // Most recently used first
+    std::list<std::string> mLru;
+    std::unordered_map<std::string, std::list<std::string>::iterator> mEntries;
+    uint64_t mHits = 0;
+    uint64_t mMisses = 0;
+};
+
 // singleton
 class Access {
 public:
-    Access();
+    // A capacity of 0 disables the caching of find decisions.
+    explicit Access(size_t findDecisionCacheCapacity = FindDecisionCache::kDefaultCapacity);
     virtual ~Access();
 
     Access(const Access&) = delete;
@@ -44,6 +80,8 @@ public:
     virtual bool canAdd(const CallingContext& ctx, const std::string& name);
     virtual bool canList(const CallingContext& ctx);
 
+    const FindDecisionCache& getFindDecisionCache() const { return mFindDecisions; }
+
 private:
     bool actionAllowed(const CallingContext& sctx, const char* tctx, const char* perm,
             const std::string& tname);
@@ -51,6 +89,7 @@ private:
             const char *perm);
 
     char* mThisProcessContext = nullptr;
+    FindDecisionCache mFindDecisions;
 };
 
 };
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <binder/IServiceManager.h>
+#include <binder/ProcessState.h>
+
+#include <string>
+#include <vector>
+
+#include "Access.h"
+
+using android::Access;
+using android::defaultServiceManager;
+using android::FindDecisionCache;
+using android::IBinder;
+using android::ProcessState;
+using android::sp;
+using android::String16;
+
+// Access check for the calling context of this process, with the decision cache disabled (Arg(0))
+// and enabled.
+static void BM_canFind(benchmark::State& state) {
+    Access access(state.range(0) ? FindDecisionCache::kDefaultCapacity : 0);
+    const Access::CallingContext ctx = access.getCallingContext();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(access.canFind(ctx, "manager"));
+    }
+}
+BENCHMARK(BM_canFind)->Arg(0)->Arg(1);
+
+// Cost of the cache itself when it is full, for lookups that hit (Arg(1)) and miss.
+static void BM_findDecisionCacheLookup(benchmark::State& state) {
+    const std::string sid = "u:r:system_server:s0";
+    FindDecisionCache cache;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < FindDecisionCache::kDefaultCapacity; i++) {
+        names.push_back("service" + std::to_string(i));
+        cache.insert(sid, names.back());
+    }
+    if (!state.range(0)) {
+        for (std::string& name : names) name += "_missing";
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.lookup(sid, names[i]));
+        i = (i + 1) % names.size();
+    }
+}
+BENCHMARK(BM_findDecisionCacheLookup)->Arg(0)->Arg(1);
+
+// Round trip to servicemanager for a service held by the process, so that the client side cache
+// can be used once the threadpool is started.
+static void BM_checkService(benchmark::State& state) {
+    if (state.range(0)) {
+        ProcessState::self()->startThreadPool();
+    }
+    sp<android::IServiceManager> sm = defaultServiceManager();
+    sp<IBinder> held = sm->checkService(String16("manager"));
+    if (held == nullptr) {
+        state.SkipWithError("servicemanager is not available");
+        return;
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sm->checkService(String16("manager")));
+    }
+}
+// The threadpool can't be stopped, so the uncached run needs to go first.
+BENCHMARK(BM_checkService)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -30,6 +30,7 @@
 using android::sp;
 using android::Access;
 using android::BBinder;
+using android::FindDecisionCache;
 using android::IBinder;
 using android::ServiceManager;
 using android::binder::Status;
@@ -513,3 +514,48 @@ TEST(ServiceNotifications, GetMultipleNotification) {
     EXPECT_THAT(cb->registrations, ElementsAre("asdfasdf", "asdfasdf"));
     EXPECT_THAT(cb->registrations, ElementsAre("asdfasdf", "asdfasdf"));
 }
+
+TEST(FindDecisionCache, HitsAfterInsert) {
+    FindDecisionCache cache;
+
+    EXPECT_FALSE(cache.lookup("u:r:foo:s0", "foo"));
+    cache.insert("u:r:foo:s0", "foo");
+    EXPECT_TRUE(cache.lookup("u:r:foo:s0", "foo"));
+    EXPECT_FALSE(cache.lookup("u:r:bar:s0", "foo"));
+    EXPECT_FALSE(cache.lookup("u:r:foo:s0", "bar"));
+
+    EXPECT_EQ(1u, cache.size());
+    EXPECT_EQ(1u, cache.hits());
+    EXPECT_EQ(3u, cache.misses());
+}
+
+TEST(FindDecisionCache, KeysDoNotAlias) {
+    FindDecisionCache cache;
+
+    cache.insert("ab", "c");
+    EXPECT_FALSE(cache.lookup("a", "bc"));
+}
+
+TEST(FindDecisionCache, EvictsLeastRecentlyUsed) {
+    FindDecisionCache cache(2);
+
+    cache.insert("ctx", "a");
+    cache.insert("ctx", "b");
+    EXPECT_TRUE(cache.lookup("ctx", "a"));
+    cache.insert("ctx", "c");
+
+    EXPECT_EQ(2u, cache.size());
+    EXPECT_TRUE(cache.lookup("ctx", "a"));
+    EXPECT_FALSE(cache.lookup("ctx", "b"));
+    EXPECT_TRUE(cache.lookup("ctx", "c"));
+}
+
+TEST(FindDecisionCache, Clear) {
+    FindDecisionCache cache;
+
+    cache.insert("ctx", "a");
+    cache.clear();
+
+    EXPECT_EQ(0u, cache.size());
+    EXPECT_FALSE(cache.lookup("ctx", "a"));
+}
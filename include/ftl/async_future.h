@@ -0,0 +1,334 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ftl/details/async_future.h>
+#include <ftl/executor.h>
+#include <ftl/optional.h>
+
+namespace android::ftl {
+
+template <typename>
+class Promise;
+
+// Future whose continuations are scheduled onto an ftl::Executor when the value is set, rather than
+// run on get() like those of ftl::Future. Chaining work therefore does not park a thread waiting on
+// each step, e.g. a GPU fence can be waited on in RenderEngine, then its result be post-processed in
+// the background and handed to the main thread.
+//
+// A future completes once, either with a value set through its ftl::Promise, or by cancellation.
+// Cancelling a future cancels the pending futures that it depends on, so that their producers can
+// skip the work (see Promise<T>::cancelled), and cancels the futures that depend on it, whose
+// continuations do not run. A Promise destroyed without setting a value cancels its future.
+//
+// Futures are move-only. Dropping a future detaches it: its continuations still run.
+//
+// Example usage:
+//
+//   ftl::Promise<int> promise;
+//   ftl::AsyncFuture<int> future = promise.get_future();
+//
+//   ftl::AsyncFuture<std::string> chain =
+//       std::move(future)
+//           .then(backgroundExecutor, [](int x) { return x * 2; })
+//           .then(mainThreadExecutor, [](int x) { return std::to_string(x); });
+//
+//   promise.set_value(21);
+//   assert(std::move(chain).get() == "42");
+//
+template <typename T>
+class AsyncFuture final {
+  using State = details::AsyncState<T>;
+
+ public:
+  using value_type = T;
+
+  // Constructs an invalid future.
+  AsyncFuture() = default;
+
+  bool valid() const { return state_ != nullptr; }
+
+  // Returns whether the future completed, with a value or by cancellation. The future must be valid.
+  bool ready() const { return state_->ready(); }
+
+  // Cancels the future unless it already completed, and returns whether it did. The future must be
+  // valid, and remains so.
+  bool cancel() { return state_->cancel(); }
+
+  // Blocks until the future completes, and returns its value, or std::nullopt if it was cancelled.
+  // The future becomes invalid.
+  Optional<T> get() && { return std::exchange(state_, nullptr)->wait_and_take(); }
+
+  // Attaches a continuation that runs on the executor once the value is set. The continuation is a
+  // function that maps T to either R or ftl::AsyncFuture<R>. In the latter case, the returned future
+  // completes along with the inner one.
+  //
+  // The executor must outlive the continuation. The future becomes invalid.
+  //
+  template <typename F, typename R = std::invoke_result_t<F, T>>
+  auto then(Executor& executor, F&& op) && -> AsyncFuture<details::async_result_t<R>> {
+    using U = details::async_result_t<R>;
+
+    auto next = std::make_shared<details::AsyncState<U>>();
+    next->set_cancel_handler(cancel_handler(state_));
+
+    std::exchange(state_, nullptr)
+        ->set_callback([&executor, next,
+                        op = std::make_shared<std::decay_t<F>>(std::forward<F>(op))](
+                               std::shared_ptr<State> state) {
+          if (state->cancelled()) {
+            next->cancel();
+            return;
+          }
+
+          executor.execute([next, op, state = std::move(state)] {
+            // The continuation was cancelled while queued.
+            if (next->cancelled()) return;
+
+            if constexpr (std::is_same_v<R, U>) {
+              next->set_value(std::invoke(*op, *state->take()));
+            } else {
+              forward(std::invoke(*op, *state->take()), next);
+            }
+          });
+        });
+
+    return AsyncFuture<U>(std::move(next));
+  }
+
+ private:
+  template <typename>
+  friend class AsyncFuture;
+
+  friend class Promise<T>;
+
+  template <typename... Ts>
+  friend AsyncFuture<std::tuple<Ts...>> when_all(AsyncFuture<Ts>...);
+
+  template <typename V>
+  friend AsyncFuture<std::vector<V>> when_all(std::vector<AsyncFuture<V>>);
+
+  explicit AsyncFuture(std::shared_ptr<State> state) : state_(std::move(state)) {}
+
+  // Cancelling a future only cancels what it depends on, so the handler must not keep it alive.
+  static std::function<void()> cancel_handler(const std::shared_ptr<State>& state) {
+    return [weak = std::weak_ptr(state)] {
+      if (const auto state = weak.lock()) state->cancel();
+    };
+  }
+
+  // Completes `to` along with `from`.
+  template <typename U>
+  static void forward(AsyncFuture<U> from, const std::shared_ptr<details::AsyncState<U>>& to) {
+    if (!from.valid()) {
+      to->cancel();
+      return;
+    }
+
+    to->set_cancel_handler(AsyncFuture<U>::cancel_handler(from.state_));
+    from.state_->set_callback([to](auto state) {
+      if (auto value = state->take()) {
+        to->set_value(std::move(*value));
+      } else {
+        to->cancel();
+      }
+    });
+  }
+
+  std::shared_ptr<State> state_;
+};
+
+// Producer side of an ftl::AsyncFuture.
+template <typename T>
+class Promise final {
+  using State = details::AsyncState<T>;
+
+ public:
+  Promise() : state_(std::make_shared<State>()) {}
+
+  Promise(Promise&&) = default;
+
+  Promise& operator=(Promise&& other) {
+    if (this != &other) {
+      abandon();
+      state_ = std::move(other.state_);
+      retrieved_ = other.retrieved_;
+    }
+    return *this;
+  }
+
+  ~Promise() { abandon(); }
+
+  // Returns the future on the first call, or an invalid future thereafter.
+  AsyncFuture<T> get_future() {
+    if (std::exchange(retrieved_, true)) return {};
+    return AsyncFuture<T>(state_);
+  }
+
+  // Sets the value by forwarding the arguments to its constructor, and schedules the continuations.
+  // Returns false if the future was cancelled, in which case the value is not constructed.
+  template <typename... Args>
+  bool set_value(Args&&... args) {
+    return state_->set_value(std::forward<Args>(args)...);
+  }
+
+  // Returns whether the future was cancelled, so the producer can skip work whose result would be
+  // discarded.
+  bool cancelled() const { return state_->cancelled(); }
+
+ private:
+  void abandon() {
+    if (state_) state_->cancel();
+  }
+
+  std::shared_ptr<State> state_;
+  bool retrieved_ = false;
+};
+
+// Creates a future that already holds a value.
+//
+//   auto future = ftl::make_ready_future(42);
+//   assert(std::move(future).get() == 42);
+//
+template <typename V>
+inline AsyncFuture<std::decay_t<V>> make_ready_future(V&& value) {
+  Promise<std::decay_t<V>> promise;
+  promise.set_value(std::forward<V>(value));
+  return promise.get_future();
+}
+
+// Runs a function on the executor, and returns a future for its result. Like a continuation, the
+// function may return an ftl::AsyncFuture, which is then flattened.
+//
+//   auto future = ftl::async(executor, [](int x) { return x + 1; }, 99);
+//   assert(std::move(future).get() == 100);
+//
+template <typename F, typename... Args>
+inline auto async(Executor& executor, F&& f, Args&&... args) {
+  return make_ready_future(std::make_tuple(std::forward<Args>(args)...))
+      .then(executor, [f = std::forward<F>(f)](auto&& args) mutable {
+        return std::apply(f, std::move(args));
+      });
+}
+
+// Returns a future that completes with the values of all futures once they have been set, or that
+// is cancelled as soon as any of them is. Cancelling it cancels the futures. The futures must be
+// valid.
+//
+//   ftl::Promise<int> promise;
+//   auto future = ftl::when_all(promise.get_future(), ftl::make_ready_future('!'));
+//
+//   promise.set_value(7);
+//   assert(std::move(future).get() == std::make_tuple(7, '!'));
+//
+template <typename... Ts>
+AsyncFuture<std::tuple<Ts...>> when_all(AsyncFuture<Ts>... futures) {
+  using Result = std::tuple<Ts...>;
+
+  if constexpr (sizeof...(Ts) == 0) {
+    return make_ready_future(Result());
+  } else {
+    struct Join {
+      std::tuple<std::optional<Ts>...> values;
+      std::atomic<std::size_t> pending{sizeof...(Ts)};
+      const std::shared_ptr<details::AsyncState<Result>> state =
+          std::make_shared<details::AsyncState<Result>>();
+    };
+
+    const auto join = std::make_shared<Join>();
+    join->state->set_cancel_handler(
+        [handlers = std::vector{AsyncFuture<Ts>::cancel_handler(futures.state_)...}] {
+          for (const auto& handler : handlers) handler();
+        });
+
+    const auto on_complete = [&join](auto& future, auto& value) {
+      future.state_->set_callback([join, &value](auto state) {
+        if (auto result = state->take()) {
+          value = std::move(result);
+          if (join->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            join->state->set_value(std::apply(
+                [](auto&... values) { return Result(std::move(*values)...); }, join->values));
+          }
+        } else {
+          join->state->cancel();
+        }
+      });
+    };
+
+    std::apply([&](auto&... values) { (on_complete(futures, values), ...); }, join->values);
+    return AsyncFuture<Result>(join->state);
+  }
+}
+
+// Overload for a dynamic number of futures of the same type.
+template <typename V>
+AsyncFuture<std::vector<V>> when_all(std::vector<AsyncFuture<V>> futures) {
+  using Result = std::vector<V>;
+
+  if (futures.empty()) {
+    return make_ready_future(Result());
+  }
+
+  struct Join {
+    explicit Join(std::size_t size) : values(size), pending(size) {}
+
+    std::vector<std::optional<V>> values;
+    std::atomic<std::size_t> pending;
+    const std::shared_ptr<details::AsyncState<Result>> state =
+        std::make_shared<details::AsyncState<Result>>();
+  };
+
+  const auto join = std::make_shared<Join>(futures.size());
+
+  std::vector<std::function<void()>> handlers;
+  handlers.reserve(futures.size());
+  for (const auto& future : futures) {
+    handlers.push_back(AsyncFuture<V>::cancel_handler(future.state_));
+  }
+  join->state->set_cancel_handler([handlers = std::move(handlers)] {
+    for (const auto& handler : handlers) handler();
+  });
+
+  for (std::size_t i = 0; i < futures.size(); i++) {
+    futures[i].state_->set_callback([join, i](auto state) {
+      if (auto result = state->take()) {
+        join->values[i] = std::move(result);
+        if (join->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          Result values;
+          values.reserve(join->values.size());
+          for (auto& value : join->values) values.push_back(std::move(*value));
+          join->state->set_value(std::move(values));
+        }
+      } else {
+        join->state->cancel();
+      }
+    });
+  }
+
+  return AsyncFuture<Result>(join->state);
+}
+
+}  // namespace android::ftl
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace android::ftl {
+
+template <typename>
+class AsyncFuture;
+
+namespace details {
+
+template <typename T>
+struct async_result {
+  using type = T;
+};
+
+template <typename T>
+struct async_result<AsyncFuture<T>> {
+  using type = T;
+};
+
+template <typename T>
+using async_result_t = typename async_result<T>::type;
+
+// State shared by an ftl::Promise and its ftl::AsyncFuture. It completes once, either with a value
+// or by cancellation. Callbacks are invoked without holding the lock, so they may complete other
+// states.
+template <typename T>
+class AsyncState final : public std::enable_shared_from_this<AsyncState<T>> {
+ public:
+  // Invoked once, on the thread that completes the state.
+  using Callback = std::function<void(std::shared_ptr<AsyncState>)>;
+
+  template <typename... Args>
+  bool set_value(Args&&... args) {
+    Callback callback;
+    {
+      std::lock_guard lock(mutex_);
+      if (status_ != Status::kPending) return false;
+
+      value_.emplace(std::forward<Args>(args)...);
+      status_ = Status::kReady;
+      callback = std::move(callback_);
+      cancel_handler_ = nullptr;
+    }
+    cv_.notify_all();
+    if (callback) callback(this->shared_from_this());
+    return true;
+  }
+
+  // Returns false if the state already completed.
+  bool cancel() {
+    Callback callback;
+    std::function<void()> cancel_handler;
+    {
+      std::lock_guard lock(mutex_);
+      if (status_ != Status::kPending) return false;
+
+      status_ = Status::kCancelled;
+      callback = std::move(callback_);
+      cancel_handler = std::move(cancel_handler_);
+    }
+    cv_.notify_all();
+    if (cancel_handler) cancel_handler();
+    if (callback) callback(this->shared_from_this());
+    return true;
+  }
+
+  bool ready() const {
+    std::lock_guard lock(mutex_);
+    return status_ != Status::kPending;
+  }
+
+  bool cancelled() const {
+    std::lock_guard lock(mutex_);
+    return status_ == Status::kCancelled;
+  }
+
+  // Sets the callback for completion, or invokes it now if the state already completed.
+  void set_callback(Callback callback) {
+    {
+      std::lock_guard lock(mutex_);
+      if (status_ == Status::kPending) {
+        callback_ = std::move(callback);
+        return;
+      }
+    }
+    callback(this->shared_from_this());
+  }
+
+  // Sets the handler that propagates cancellation to whatever produces the value, or invokes it now
+  // if the state was already cancelled.
+  void set_cancel_handler(std::function<void()> handler) {
+    {
+      std::lock_guard lock(mutex_);
+      if (status_ == Status::kPending) {
+        cancel_handler_ = std::move(handler);
+        return;
+      }
+      if (status_ == Status::kReady) return;
+    }
+    handler();
+  }
+
+  // Moves out the value, or returns std::nullopt if the state was cancelled or is still pending.
+  std::optional<T> take() {
+    std::lock_guard lock(mutex_);
+    if (status_ != Status::kReady) return {};
+    return std::move(value_);
+  }
+
+  std::optional<T> wait_and_take() {
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this] { return status_ != Status::kPending; });
+    if (status_ != Status::kReady) return {};
+    return std::move(value_);
+  }
+
+ private:
+  enum class Status { kPending, kReady, kCancelled };
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+
+  Status status_ = Status::kPending;
+  std::optional<T> value_;
+
+  Callback callback_;
+  std::function<void()> cancel_handler_;
+};
+
+}  // namespace details
+}  // namespace android::ftl
@@ -0,0 +1,280 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ftl/enum.h>
+#include <ftl/optional.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+namespace android::ftl {
+
+// Associative container keyed by an enum with a known range (see ftl::enum_size_v), with the API of
+// ftl::SmallMap. Every enumerator has its own slot, indexed by its offset from ftl::enum_begin_v, so
+// lookup is a bounds check and an array access, and the map never allocates. Values outside of the
+// enum's range are never contained, and cannot be emplaced.
+//
+// Iteration is in enumerator order.
+//
+// Example usage:
+//
+//   enum class Stage { kRead, kDispatch, kPresent, ftl_last = kPresent };
+//
+//   ftl::EnumMap<Stage, int> map;
+//   assert(map.empty());
+//   assert(map.max_size() == 3u);
+//
+//   map.try_emplace(Stage::kPresent, 3);
+//   map.try_emplace(Stage::kRead, 1);
+//   assert(map.size() == 2u);
+//   assert(map.begin()->first == Stage::kRead);
+//
+//   assert(map.get(Stage::kPresent) == 3);
+//   assert(!map.contains(Stage::kDispatch));
+//
+template <typename E, typename V>
+class EnumMap final {
+  static constexpr std::size_t kCapacity = enum_size_v<E>;
+  using Slot = std::optional<std::pair<const E, V>>;
+  using Slots = std::array<Slot, kCapacity>;
+
+  template <bool Const>
+  class Iterator {
+    using SlotIterator =
+        std::conditional_t<Const, typename Slots::const_iterator, typename Slots::iterator>;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<const E, V>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+    using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+    Iterator() = default;
+    Iterator(SlotIterator it, SlotIterator end) : it_(it), end_(end) { skip_empty(); }
+
+    // Converts an iterator to a const_iterator.
+    template <bool C = Const, typename = std::enable_if_t<C>>
+    Iterator(const Iterator<false>& other) : it_(other.it_), end_(other.end_) {}
+
+    reference operator*() const { return **it_; }
+    pointer operator->() const { return &**it_; }
+
+    Iterator& operator++() {
+      ++it_;
+      skip_empty();
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator it = *this;
+      ++*this;
+      return it;
+    }
+
+    bool operator==(const Iterator& other) const { return it_ == other.it_; }
+    bool operator!=(const Iterator& other) const { return it_ != other.it_; }
+
+   private:
+    friend class EnumMap;
+    friend class Iterator<true>;
+
+    void skip_empty() {
+      while (it_ != end_ && !it_->has_value()) ++it_;
+    }
+
+    SlotIterator it_{};
+    SlotIterator end_{};
+  };
+
+ public:
+  using key_type = E;
+  using mapped_type = V;
+
+  using value_type = std::pair<const E, V>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  using reference = value_type&;
+  using iterator = Iterator<false>;
+
+  using const_reference = const value_type&;
+  using const_iterator = Iterator<true>;
+
+  // Creates an empty map.
+  EnumMap() = default;
+
+  static constexpr size_type max_size() { return kCapacity; }
+  size_type size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // For parity with ftl::SmallMap. The storage is always static.
+  static constexpr bool dynamic() { return false; }
+
+  iterator begin() { return {slots_.begin(), slots_.end()}; }
+  const_iterator begin() const { return cbegin(); }
+  const_iterator cbegin() const { return {slots_.cbegin(), slots_.cend()}; }
+
+  iterator end() { return {slots_.end(), slots_.end()}; }
+  const_iterator end() const { return cend(); }
+  const_iterator cend() const { return {slots_.cend(), slots_.cend()}; }
+
+  // Returns whether a mapping exists for the given key.
+  bool contains(key_type key) const { return slot(key) != nullptr; }
+
+  // Returns a reference to the value for the given key, or std::nullopt if the key was not found.
+  auto get(key_type key) const -> Optional<std::reference_wrapper<const mapped_type>> {
+    if (const Slot* const s = slot(key)) {
+      return std::cref((*s)->second);
+    }
+    return {};
+  }
+
+  auto get(key_type key) -> Optional<std::reference_wrapper<mapped_type>> {
+    if (Slot* const s = slot(key)) {
+      return std::ref((*s)->second);
+    }
+    return {};
+  }
+
+  // Returns an iterator to an existing mapping for the given key, or the end() iterator otherwise.
+  const_iterator find(key_type key) const { return const_cast<EnumMap&>(*this).find(key); }
+
+  iterator find(key_type key) {
+    const auto i = index(key);
+    if (i >= kCapacity || !slots_[i]) return end();
+    return {slots_.begin() + i, slots_.end()};
+  }
+
+  // Inserts a mapping unless it exists, or the key is out of range. Returns an iterator to the
+  // inserted or existing mapping, and whether the mapping was inserted.
+  //
+  // Iterators remain valid.
+  //
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type key, Args&&... args) {
+    const auto i = index(key);
+    if (i >= kCapacity) return {end(), false};
+
+    const iterator it{slots_.begin() + i, slots_.end()};
+    if (slots_[i]) return {it, false};
+
+    slots_[i].emplace(std::piecewise_construct, std::forward_as_tuple(key),
+                      std::forward_as_tuple(std::forward<Args>(args)...));
+    size_++;
+    return {it, true};
+  }
+
+  // Replaces a mapping if it exists, and returns an iterator to it. Returns the end() iterator
+  // otherwise.
+  //
+  // The value is replaced via move constructor, so type V does not need to define copy/move
+  // assignment, e.g. its data members may be const.
+  //
+  // The arguments may directly or indirectly refer to the mapping being replaced.
+  //
+  // Iterators remain valid.
+  //
+  template <typename... Args>
+  iterator try_replace(key_type key, Args&&... args) {
+    const auto it = find(key);
+    if (it == end()) return it;
+    replace(*it.it_, key, std::forward<Args>(args)...);
+    return it;
+  }
+
+  // In-place counterpart of std::unordered_map's insert_or_assign. Returns true on emplace, or
+  // false on replace.
+  //
+  // Iterators remain valid.
+  //
+  template <typename... Args>
+  std::pair<iterator, bool> emplace_or_replace(key_type key, Args&&... args) {
+    const auto [it, ok] = try_emplace(key, std::forward<Args>(args)...);
+    if (ok || it == end()) return {it, ok};
+    replace(*it.it_, key, std::forward<Args>(args)...);
+    return {it, ok};
+  }
+
+  // Removes a mapping if it exists, and returns whether it did.
+  //
+  // Iterators to the erased mapping are invalidated.
+  //
+  bool erase(key_type key) {
+    const auto i = index(key);
+    if (i >= kCapacity || !slots_[i]) return false;
+    slots_[i].reset();
+    size_--;
+    return true;
+  }
+
+  // Removes all mappings.
+  void clear() {
+    for (Slot& s : slots_) s.reset();
+    size_ = 0;
+  }
+
+ private:
+  // Out of range keys map to kCapacity or above.
+  static constexpr std::size_t index(key_type key) {
+    return static_cast<std::size_t>(to_underlying(key) - to_underlying(enum_begin_v<E>));
+  }
+
+  const Slot* slot(key_type key) const {
+    const auto i = index(key);
+    return i < kCapacity && slots_[i] ? &slots_[i] : nullptr;
+  }
+
+  Slot* slot(key_type key) {
+    return const_cast<Slot*>(std::as_const(*this).slot(key));
+  }
+
+  template <typename... Args>
+  static void replace(Slot& s, key_type key, Args&&... args) {
+    value_type pair(std::piecewise_construct, std::forward_as_tuple(key),
+                    std::forward_as_tuple(std::forward<Args>(args)...));
+    s.reset();
+    s.emplace(std::move(pair));
+  }
+
+  Slots slots_{};
+  size_type size_ = 0;
+};
+
+// Returns whether the key-value pairs of two maps are equal.
+template <typename E, typename V, typename W>
+bool operator==(const EnumMap<E, V>& lhs, const EnumMap<E, W>& rhs) {
+  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                    [](const auto& l, const auto& r) {
+                      return l.first == r.first && l.second == r.second;
+                    });
+}
+
+// TODO: Remove in C++20.
+template <typename E, typename V, typename W>
+inline bool operator!=(const EnumMap<E, V>& lhs, const EnumMap<E, W>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace android::ftl
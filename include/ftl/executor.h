@@ -0,0 +1,49 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+
+namespace android::ftl {
+
+// Interface for a context that runs tasks, e.g. a thread with a work queue. Implementations must be
+// safe to call from any thread, and must outlive the tasks that are scheduled onto them.
+//
+// See also ftl::AsyncFuture, whose continuations are scheduled onto an executor.
+//
+class Executor {
+ public:
+  virtual ~Executor() = default;
+
+  // Schedules a task to run, without waiting for it.
+  virtual void execute(std::function<void()> task) = 0;
+};
+
+// Executor that runs tasks immediately on the calling thread. For ftl::AsyncFuture continuations,
+// this is the thread that completes the antecedent future, so the continuation must be cheap and
+// must not block.
+class InlineExecutor final : public Executor {
+ public:
+  static InlineExecutor& instance() {
+    static InlineExecutor executor;
+    return executor;
+  }
+
+  void execute(std::function<void()> task) override { task(); }
+};
+
+}  // namespace android::ftl
@@ -0,0 +1,297 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ftl/initializer_list.h>
+#include <ftl/optional.h>
+#include <ftl/small_vector.h>
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace android::ftl {
+
+// Associative container with unique keys kept in sorted order. Like ftl::SmallMap, key-value pairs
+// are stored in contiguous storage that is allocated statically until the size exceeds N, and the
+// API is the same. Lookup scans small maps linearly, and switches to binary search once the size
+// exceeds kLinearSearchMaxSize, so it stays fast for maps that outgrow a handful of entries. In
+// exchange, emplacing and erasing shift the mappings that follow, and keys need to be ordered by
+// Compare rather than only be equality comparable.
+//
+// Iteration is in key order.
+//
+// Example usage:
+//
+//   ftl::SmallFlatMap<int, std::string, 3> map;
+//   assert(map.empty());
+//   assert(!map.dynamic());
+//
+//   map = ftl::init::map<int, std::string>(123, "abc")(-1)(42, 3u, '?');
+//   assert(map.size() == 3u);
+//   assert(!map.dynamic());
+//
+//   assert(map.begin()->first == -1);
+//   assert(map.contains(123));
+//   assert(map.get(42).transform([](const std::string& s) { return s.size(); }) == 3u);
+//
+//   map.emplace_or_replace(0, "vanilla", 2u, 3u);
+//   assert(map.dynamic());
+//
+//   assert(map == SmallFlatMap(ftl::init::map(-1, ""sv)(0, "nil"sv)(42, "???"sv)(123, "abc"sv)));
+//
+template <typename K, typename V, std::size_t N, typename Compare = std::less<K>>
+class SmallFlatMap final {
+  using Map = SmallVector<std::pair<const K, V>, N>;
+
+  template <typename, typename, std::size_t, typename>
+  friend class SmallFlatMap;
+
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using key_compare = Compare;
+
+  using value_type = typename Map::value_type;
+  using size_type = typename Map::size_type;
+  using difference_type = typename Map::difference_type;
+
+  using reference = typename Map::reference;
+  using iterator = typename Map::iterator;
+
+  using const_reference = typename Map::const_reference;
+  using const_iterator = typename Map::const_iterator;
+
+  // Above this size, lookup uses binary search rather than a linear scan.
+  static constexpr size_type kLinearSearchMaxSize = 8;
+
+  // Creates an empty map.
+  SmallFlatMap() = default;
+
+  // Constructs at most N key-value pairs in place by forwarding per-pair constructor arguments, as
+  // for ftl::SmallMap. If a key is listed more than once, its first pair is kept.
+  template <typename U, std::size_t... Sizes, typename... Types>
+  SmallFlatMap(InitializerList<U, std::index_sequence<Sizes...>, Types...>&& list)
+      : map_(std::move(list)) {
+    sort_and_deduplicate();
+  }
+
+  // Copies or moves key-value pairs from a convertible map.
+  template <typename Q, typename W, std::size_t M>
+  SmallFlatMap(SmallFlatMap<Q, W, M, Compare> other) : map_(std::move(other.map_)) {}
+
+  size_type max_size() const { return map_.max_size(); }
+  size_type size() const { return map_.size(); }
+  bool empty() const { return map_.empty(); }
+
+  // Returns whether the map is backed by static or dynamic storage.
+  bool dynamic() const { return map_.dynamic(); }
+
+  iterator begin() { return map_.begin(); }
+  const_iterator begin() const { return cbegin(); }
+  const_iterator cbegin() const { return map_.cbegin(); }
+
+  iterator end() { return map_.end(); }
+  const_iterator end() const { return cend(); }
+  const_iterator cend() const { return map_.cend(); }
+
+  // Returns whether a mapping exists for the given key.
+  bool contains(const key_type& key) const { return find(key) != end(); }
+
+  // Returns a reference to the value for the given key, or std::nullopt if the key was not found.
+  auto get(const key_type& key) const -> Optional<std::reference_wrapper<const mapped_type>> {
+    if (const auto it = find(key); it != end()) {
+      return std::cref(it->second);
+    }
+    return {};
+  }
+
+  auto get(const key_type& key) -> Optional<std::reference_wrapper<mapped_type>> {
+    if (const auto it = find(key); it != end()) {
+      return std::ref(it->second);
+    }
+    return {};
+  }
+
+  // Returns an iterator to an existing mapping for the given key, or the end() iterator otherwise.
+  const_iterator find(const key_type& key) const {
+    return const_cast<SmallFlatMap&>(*this).find(key);
+  }
+
+  iterator find(const key_type& key) {
+    const auto it = lower_bound(key);
+    return it != end() && !Compare{}(key, it->first) ? it : end();
+  }
+
+  // Inserts a mapping unless it exists. Returns an iterator to the inserted or existing mapping,
+  // and whether the mapping was inserted.
+  //
+  // On emplace, all iterators are invalidated.
+  //
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+    const auto it = lower_bound(key);
+    if (it != end() && !Compare{}(key, it->first)) {
+      return {it, false};
+    }
+
+    return {insert_at(it - begin(), std::piecewise_construct, std::forward_as_tuple(key),
+                      std::forward_as_tuple(std::forward<Args>(args)...)),
+            true};
+  }
+
+  // Replaces a mapping if it exists, and returns an iterator to it. Returns the end() iterator
+  // otherwise.
+  //
+  // The value is replaced via move constructor, so type V does not need to define copy/move
+  // assignment, e.g. its data members may be const.
+  //
+  // The arguments may directly or indirectly refer to the mapping being replaced.
+  //
+  // Iterators to the replaced mapping point to its replacement, and others remain valid.
+  //
+  template <typename... Args>
+  iterator try_replace(const key_type& key, Args&&... args) {
+    const auto it = find(key);
+    if (it == end()) return it;
+    map_.replace(it, std::piecewise_construct, std::forward_as_tuple(key),
+                 std::forward_as_tuple(std::forward<Args>(args)...));
+    return it;
+  }
+
+  // In-place counterpart of std::map's insert_or_assign. Returns true on emplace, or false on
+  // replace.
+  //
+  // On emplace, all iterators are invalidated. On replace, iterators to the replaced mapping point
+  // to its replacement, and others remain valid.
+  //
+  template <typename... Args>
+  std::pair<iterator, bool> emplace_or_replace(const key_type& key, Args&&... args) {
+    const auto [it, ok] = try_emplace(key, std::forward<Args>(args)...);
+    if (ok) return {it, ok};
+    map_.replace(it, std::piecewise_construct, std::forward_as_tuple(key),
+                 std::forward_as_tuple(std::forward<Args>(args)...));
+    return {it, ok};
+  }
+
+  // Removes a mapping if it exists, and returns whether it did.
+  //
+  // Iterators to the erased mapping and those that follow it are invalidated.
+  //
+  bool erase(const key_type& key) {
+    const auto it = find(key);
+    if (it == end()) return false;
+    erase_at(it - begin());
+    return true;
+  }
+
+  // Removes all mappings.
+  //
+  // All iterators are invalidated.
+  //
+  void clear() { map_.clear(); }
+
+ private:
+  // Returns an iterator to the first mapping whose key is not less than the given key.
+  iterator lower_bound(const key_type& key) {
+    const auto comp = [&key](const auto& pair) { return Compare{}(pair.first, key); };
+    if (size() <= kLinearSearchMaxSize) {
+      return std::find_if_not(begin(), end(), comp);
+    }
+    return std::partition_point(begin(), end(), comp);
+  }
+
+  // Shifts the mappings from the given index onwards up by one, and constructs the new mapping in
+  // the resulting gap. Keys are const, so mappings are moved by reconstruction.
+  template <typename... Args>
+  iterator insert_at(difference_type index, Args&&... args) {
+    if (index == static_cast<difference_type>(size())) {
+      auto& ref = map_.emplace_back(std::forward<Args>(args)...);
+      return &ref;
+    }
+
+    // The back may move on emplace, so move it out first.
+    value_type back = std::move(map_.back());
+    map_.emplace_back(std::move(back));
+    for (auto it = end() - 2; it != begin() + index; --it) {
+      map_.replace(it, std::move(*(it - 1)));
+    }
+    return &map_.replace(begin() + index, std::forward<Args>(args)...);
+  }
+
+  void erase_at(difference_type index) {
+    for (auto it = begin() + index; it + 1 != end(); ++it) {
+      map_.replace(it, std::move(*(it + 1)));
+    }
+    map_.pop_back();
+  }
+
+  void sort_and_deduplicate() {
+    // Insertion sort, since pairs with const keys cannot be assigned. It is stable, so the first of
+    // duplicate keys comes first.
+    for (auto it = begin(); it != end(); ++it) {
+      auto pos = std::upper_bound(begin(), it, it->first, [](const key_type& key, const auto& pair) {
+        return Compare{}(key, pair.first);
+      });
+      if (pos == it) continue;
+
+      value_type pair = std::move(*it);
+      for (auto shift = it; shift != pos; --shift) {
+        map_.replace(shift, std::move(*(shift - 1)));
+      }
+      map_.replace(pos, std::move(pair));
+    }
+
+    if (empty()) return;
+    auto last = begin();
+    for (auto it = begin() + 1; it != end(); ++it) {
+      if (Compare{}(last->first, it->first)) {
+        ++last;
+        if (last != it) map_.replace(last, std::move(*it));
+      }
+    }
+    while (end() != last + 1) {
+      map_.pop_back();
+    }
+  }
+
+  Map map_;
+};
+
+// Deduction guide for in-place constructor.
+template <typename K, typename V, typename E, std::size_t... Sizes, typename... Types>
+SmallFlatMap(InitializerList<KeyValue<K, V, E>, std::index_sequence<Sizes...>, Types...>&&)
+    -> SmallFlatMap<K, V, sizeof...(Sizes)>;
+
+// Returns whether the key-value pairs of two maps are equal.
+template <typename K, typename V, std::size_t N, typename Q, typename W, std::size_t M, typename C>
+bool operator==(const SmallFlatMap<K, V, N, C>& lhs, const SmallFlatMap<Q, W, M, C>& rhs) {
+  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                    [](const auto& l, const auto& r) {
+                      return !C{}(l.first, r.first) && !C{}(r.first, l.first) &&
+                             l.second == r.second;
+                    });
+}
+
+// TODO: Remove in C++20.
+template <typename K, typename V, std::size_t N, typename Q, typename W, std::size_t M, typename C>
+inline bool operator!=(const SmallFlatMap<K, V, N, C>& lhs, const SmallFlatMap<Q, W, M, C>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace android::ftl
@@ -28,8 +28,11 @@
  * The InputConsumer is used by the application to receive events from the input dispatcher.
  */
 
+#include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <android-base/chrono_utils.h>
 #include <android-base/result.h>
@@ -236,11 +239,29 @@ struct InputMessage {
  */
 class InputChannel : public Parcelable {
 public:
+    /*
+     * How messages travel between the two endpoints of a channel pair.
+     */
+    enum class Transport {
+        // Every message is written to the socket.
+        SOCKET,
+        // Messages are written to a ring buffer in memory shared by both endpoints. The socket is
+        // only used to wake up an endpoint that is waiting for messages, and as a fallback for
+        // endpoints that have not mapped the shared memory.
+        SHARED_MEMORY,
+
+        ftl_last = SHARED_MEMORY
+    };
+
     static std::unique_ptr<InputChannel> create(const std::string& name,
                                                 android::base::unique_fd fd, sp<IBinder> token);
     InputChannel() = default;
     InputChannel(const InputChannel& other)
-          : mName(other.mName), mFd(::dup(other.mFd)), mToken(other.mToken){};
+          : mName(other.mName),
+            mFd(::dup(other.mFd)),
+            mToken(other.mToken),
+            mSharedMemory(other.mSharedMemory),
+            mIsServer(other.mIsServer){};
     InputChannel(const std::string name, android::base::unique_fd fd, sp<IBinder> token);
     ~InputChannel() override;
     /**
@@ -248,16 +269,27 @@ public:
      * The two returned input channels are equivalent, and are labeled as "server" and "client"
      * for convenience. The two input channels share the same token.
      *
+     * If SHARED_MEMORY is requested but the shared memory cannot be set up, the channels silently
+     * fall back to using the socket.
+     *
      * Return OK on success.
      */
     static status_t openInputChannelPair(const std::string& name,
                                          std::unique_ptr<InputChannel>& outServerChannel,
-                                         std::unique_ptr<InputChannel>& outClientChannel);
+                                         std::unique_ptr<InputChannel>& outClientChannel,
+                                         Transport transport = Transport::SOCKET);
 
     inline std::string getName() const { return mName; }
     inline const android::base::unique_fd& getFd() const { return mFd; }
     inline sp<IBinder> getToken() const { return mToken; }
 
+    /* Return the transport currently used to send messages to the other endpoint.
+     *
+     * A SHARED_MEMORY channel keeps using the socket until the other endpoint starts reading from
+     * the shared memory, e.g. if it was recreated from the socket fd alone.
+     */
+    Transport getTransport() const;
+
     /* Send a message to the other endpoint.
      *
      * If the channel is full then the message is guaranteed not to have been sent at all.
@@ -271,6 +303,20 @@ public:
      */
     status_t sendMessage(const InputMessage* msg);
 
+    /* Send several messages to the other endpoint, using as few system calls as possible.
+     *
+     * Every message is still written as its own packet, so the other endpoint receives exactly
+     * what it would have received from one sendMessage() call per message.
+     * The number of messages that were sent is returned in outSentCount. When an error is
+     * returned, the messages starting at index *outSentCount are guaranteed not to have been sent.
+     *
+     * Return OK if all messages were sent.
+     * Return WOULD_BLOCK if the channel became full.
+     * Return DEAD_OBJECT if the channel's peer has been closed.
+     * Other errors probably indicate that the channel is broken.
+     */
+    status_t sendMessages(const InputMessage* msgs, size_t count, size_t* outSentCount);
+
     /* Receive a message sent by the other endpoint.
      *
      * If there is no message present, try again after poll() indicates that the fd
@@ -319,12 +365,23 @@ public:
     }
 
 private:
+    struct SharedMemory;
+
     base::unique_fd dupFd() const;
+    std::optional<status_t> sendToSharedMemory(const InputMessage& msg);
+    status_t receiveFromSharedMemory(InputMessage* msg);
+    status_t receiveFromSocket(InputMessage* msg);
+    status_t sendDoorbell(uint8_t doorbell);
 
     std::string mName;
     android::base::unique_fd mFd;
 
     sp<IBinder> mToken;
+
+    // Set for SHARED_MEMORY channels. Shared by all the copies of this endpoint in this process.
+    std::shared_ptr<SharedMemory> mSharedMemory;
+    // Which endpoint of the pair this is, which decides the ring buffers it writes and reads.
+    bool mIsServer = false;
 };
 
 /*
@@ -409,6 +466,28 @@ public:
      */
     status_t publishTouchModeEvent(uint32_t seq, int32_t eventId, bool isInTouchMode);
 
+    /* Starts batching published events.
+     *
+     * Until endBatch() is called, the publish methods only validate and queue the events, and
+     * return OK instead of the result of writing them to the channel. This lets callers that
+     * publish several events at once, e.g. multiple motion samples for the same connection, pay a
+     * single system call for all of them.
+     */
+    void beginBatch();
+
+    /* Writes all the events published since beginBatch() to the input channel.
+     *
+     * The number of events that were written is returned in outPublishedCount. Events are
+     * written in the order they were published; when an error is returned, the events starting at
+     * index *outPublishedCount were not written and must be published again.
+     *
+     * Returns OK on success.
+     * Returns WOULD_BLOCK if the channel became full.
+     * Returns DEAD_OBJECT if the channel's peer has been closed.
+     * Other errors probably indicate that the channel is broken.
+     */
+    status_t endBatch(size_t* outPublishedCount);
+
     struct Finished {
         uint32_t seq;
         bool handled;
@@ -446,6 +525,10 @@ public:
 private:
     std::shared_ptr<InputChannel> mChannel;
     InputVerifier mInputVerifier;
+    bool mBatching = false;
+    std::vector<InputMessage> mBatch;
+
+    status_t sendMessage(const InputMessage& msg);
 };
 
 /*
@@ -533,11 +616,38 @@ private:
     // call to consume and that still needs to be handled.
     bool mMsgDeferred;
 
-    // Batched motion events per device and source.
-    struct Batch {
-        std::vector<InputMessage> samples;
+    // Batched motion events per device and source, in a ring of samples. The ring only grows
+    // when a batch outlasts its capacity, and the rings of consumed batches are kept in
+    // mSpareBatches for reuse, so batching doesn't allocate once the rings fit the input rate.
+    class Batch {
+    public:
+        bool empty() const { return mSize == 0; }
+        size_t size() const { return mSize; }
+
+        InputMessage& operator[](size_t i) { return mSamples[(mHead + i) & (capacity() - 1)]; }
+        const InputMessage& operator[](size_t i) const {
+            return mSamples[(mHead + i) & (capacity() - 1)];
+        }
+
+        void push(const InputMessage& msg);
+        // Removes the oldest count samples.
+        void pop(size_t count);
+        void clear() {
+            mHead = 0;
+            mSize = 0;
+        }
+
+    private:
+        // Always a power of 2, once the first sample was pushed.
+        size_t capacity() const { return mSamples.size(); }
+        void grow();
+
+        std::vector<InputMessage> mSamples;
+        size_t mHead = 0;
+        size_t mSize = 0;
     };
     std::vector<Batch> mBatches;
+    std::vector<Batch> mSpareBatches;
 
     // Touch state per device and source, only for sources of class pointer.
     struct History {
@@ -652,6 +762,8 @@ private:
     void resampleTouchState(nsecs_t frameTime, MotionEvent* event,
             const InputMessage *next);
 
+    void startBatch(const InputMessage& msg);
+    void removeBatch(size_t index);
     ssize_t findBatch(int32_t deviceId, int32_t source) const;
     ssize_t findTouchState(int32_t deviceId, int32_t source) const;
 
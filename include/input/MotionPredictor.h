@@ -16,11 +16,16 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <cstdint>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <android-base/result.h>
 #include <android-base/thread_annotations.h>
@@ -54,9 +59,21 @@ static inline bool isMotionPredictionEnabled() {
  * The offset is used to provide additional flexibility to the caller, in case the default present
  * time (typically provided by the choreographer) does not account for some delays, or to simply
  * reduce the aggressiveness of the prediction. Offset can be positive or negative.
+ *
+ * In ASYNCHRONOUS mode, the model runs on a dedicated thread whenever new samples are recorded, and
+ * predict() returns the most recent completed prediction, so that callers never wait for the
+ * model. The prediction may then be based on slightly older samples: predicted samples that are
+ * not later than the latest recorded event are dropped, so the result only contains the future.
  */
 class MotionPredictor {
 public:
+    enum class InferenceMode {
+        // The model runs on the thread calling predict().
+        SYNCHRONOUS,
+        // The model runs on a dedicated thread, see above.
+        ASYNCHRONOUS,
+    };
+
     /**
      * Parameters:
      * predictionTimestampOffsetNanos: additional, constant shift to apply to the target
@@ -68,9 +85,14 @@ public:
      *
      * checkEnableMotionPredition: the function to check whether the prediction should run. Used to
      * provide an additional way of turning prediction on and off. Can be toggled at runtime.
+     *
+     * inferenceMode: whether the model runs on the thread calling predict(), or on a dedicated
+     * thread.
      */
     MotionPredictor(nsecs_t predictionTimestampOffsetNanos,
-                    std::function<bool()> checkEnableMotionPrediction = isMotionPredictionEnabled);
+                    std::function<bool()> checkEnableMotionPrediction = isMotionPredictionEnabled,
+                    InferenceMode inferenceMode = InferenceMode::SYNCHRONOUS);
+    ~MotionPredictor();
 
     /**
      * Record the actual motion received by the view. This event will be used for calculating the
@@ -86,15 +108,60 @@ public:
     bool isPredictionAvailable(int32_t deviceId, int32_t source);
 
 private:
+    // A completed run of the model, along with the axis of the samples it was run on.
+    struct ModelResult {
+        TfLiteMotionPredictorSample::Point axisFrom;
+        TfLiteMotionPredictorSample::Point axisTo;
+        int64_t lastTimestamp;
+        std::vector<float> r;
+        std::vector<float> phi;
+        std::vector<float> pressure;
+        nsecs_t invokeDuration;
+    };
+
+    struct PendingSample {
+        int64_t timestamp;
+        TfLiteMotionPredictorSample sample;
+    };
+
     const nsecs_t mPredictionTimestampOffsetNanos;
     const std::function<bool()> mCheckMotionPredictionEnabled;
+    const InferenceMode mInferenceMode;
 
+    // Only used by mInferenceThread once it is started.
     std::unique_ptr<TfLiteMotionPredictorModel> mModel;
 
     std::unique_ptr<TfLiteMotionPredictorBuffers> mBuffers;
     std::optional<MotionEvent> mLastEvent;
 
     std::optional<MotionPredictorMetricsManager> mMetricsManager;
+
+    // State shared with mInferenceThread, in ASYNCHRONOUS mode.
+    std::thread mInferenceThread;
+    std::mutex mLock;
+    std::condition_variable mInferenceRequested;
+    bool mStopInference GUARDED_BY(mLock) = false;
+    // Samples recorded since the inference thread last ran.
+    std::vector<PendingSample> mPendingSamples GUARDED_BY(mLock);
+    // Set when the gesture ended since the inference thread last ran.
+    bool mPendingReset GUARDED_BY(mLock) = false;
+    // Incremented when the gesture ends, so that results for the previous gesture are dropped.
+    uint64_t mGestureId GUARDED_BY(mLock) = 0;
+    std::optional<ModelResult> mLatestResult GUARDED_BY(mLock);
+    bool mLatestResultReported GUARDED_BY(mLock) = false;
+
+    void startInferenceThread();
+    void runInferenceLoop();
+
+    // Builds the prediction event from the model output. Predicted samples that are not later than
+    // notBefore are skipped.
+    std::unique_ptr<MotionEvent> createPrediction(TfLiteMotionPredictorSample::Point axisFrom,
+                                                  TfLiteMotionPredictorSample::Point axisTo,
+                                                  int64_t lastTimestamp,
+                                                  std::span<const float> predictedR,
+                                                  std::span<const float> predictedPhi,
+                                                  std::span<const float> predictedPressure,
+                                                  nsecs_t timestamp, int64_t notBefore);
 };
 
 } // namespace android
@@ -55,6 +55,22 @@ public:
     // MotionEvent that will be returned by MotionPredictor::predict.
     void onPredict(const MotionEvent& predictionEvent);
 
+    // This method should be called once for each run of the prediction model, receiving the time
+    // TfLiteMotionPredictorModel::invoke took.
+    void onModelInvoke(nsecs_t invokeDuration);
+
+    struct InvokeTimePercentiles {
+        nsecs_t p50;
+        nsecs_t p90;
+        nsecs_t p99;
+    };
+
+    // Percentiles of the model invoke times of the current stroke, over the most recent
+    // MAX_INVOKE_TIME_SAMPLES runs. Empty if the model wasn't run during this stroke.
+    std::optional<InvokeTimePercentiles> getInvokeTimePercentiles() const;
+
+    static constexpr size_t MAX_INVOKE_TIME_SAMPLES = 512;
+
     // Simple structs to hold relevant touch input information. Public so they can be used in tests.
 
     struct TouchPoint {
@@ -172,6 +188,9 @@ private:
     std::vector<AggregatedStrokeMetrics> mAggregatedMetrics;
     std::vector<AtomFields> mAtomFields;
 
+    // Model invoke times of the current stroke.
+    RingBuffer<nsecs_t> mInvokeDurations;
+
     // Non-owning pointer to the location of mock AtomFields. If present, will be filled with the
     // values reported to stats_write on each batch of reported metrics.
     //
@@ -215,11 +215,15 @@ private:
     };
 
     float chooseWeight(int32_t pointerId, uint32_t index) const;
+    std::optional<VelocityTracker::Estimator> computeEstimator(
+            int32_t pointerId, const std::array<Movement, HISTORY_SIZE>& movements) const;
 
     const uint32_t mDegree;
     const Weighting mWeighting;
     std::map<int32_t /*pointerId*/, size_t /*positionInArray*/> mIndex;
     std::map<int32_t /*pointerId*/, std::array<Movement, HISTORY_SIZE>> mMovements;
+    // Estimators computed from the current movements, reset whenever a movement is added.
+    mutable std::map<int32_t /*pointerId*/, std::optional<VelocityTracker::Estimator>> mEstimators;
 };
 
 
@@ -24,6 +24,12 @@
 #include <android/hardware/power/Mode.h>
 #include <powermanager/PowerHalWrapper.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <set>
+#include <thread>
+
 namespace android {
 
 namespace power {
@@ -46,15 +52,29 @@ public:
 // This relies on HalConnector to connect to the underlying Power HAL
 // service and reconnects to it after each failed api call. This also ensures
 // connecting to the service is thread-safe.
+//
+// Boosts and modes can also be requested asynchronously, in which case they are sent to the HAL
+// by a dispatcher thread. Repeated requests for the same boost are coalesced, and each boost is
+// sent at most once per boost interval, so callers can request them at any rate.
 class PowerHalController : public HalWrapper {
 public:
+    static constexpr std::chrono::milliseconds kDefaultBoostInterval{10};
+
     PowerHalController() : PowerHalController(std::make_unique<HalConnector>()) {}
-    explicit PowerHalController(std::unique_ptr<HalConnector> connector)
-          : mHalConnector(std::move(connector)) {}
-    virtual ~PowerHalController() = default;
+    explicit PowerHalController(std::unique_ptr<HalConnector> connector,
+                                std::chrono::milliseconds boostInterval = kDefaultBoostInterval)
+          : mHalConnector(std::move(connector)), mBoostInterval(boostInterval) {}
+    virtual ~PowerHalController();
 
     virtual void init();
 
+    // Requests a boost without blocking on the HAL. Requests for a boost that is still pending
+    // are merged into it, keeping the longest duration.
+    virtual void setBoostAsync(hardware::power::Boost boost, int32_t durationMs);
+    // Requests a mode without blocking on the HAL. Only the latest pending request for each mode
+    // is sent.
+    virtual void setModeAsync(hardware::power::Mode mode, bool enabled);
+
     virtual HalResult<void> setBoost(hardware::power::Boost boost, int32_t durationMs) override;
     virtual HalResult<void> setMode(hardware::power::Mode mode, bool enabled) override;
     virtual HalResult<sp<hardware::power::IPowerHintSession>> createHintSession(
@@ -71,9 +91,26 @@ private:
     std::shared_ptr<HalWrapper> mConnectedHal GUARDED_BY(mConnectedHalMutex) = nullptr;
     const std::shared_ptr<HalWrapper> mDefaultHal = std::make_shared<EmptyHalWrapper>();
 
+    const std::chrono::milliseconds mBoostInterval;
+
+    std::mutex mDispatchMutex;
+    std::condition_variable mDispatchCondition;
+    std::thread mDispatchThread GUARDED_BY(mDispatchMutex);
+    bool mDispatchStopped GUARDED_BY(mDispatchMutex) = false;
+    std::map<hardware::power::Boost, int32_t> mPendingBoosts GUARDED_BY(mDispatchMutex);
+    std::map<hardware::power::Boost, std::chrono::steady_clock::time_point> mLastBoostTimes
+            GUARDED_BY(mDispatchMutex);
+    std::map<hardware::power::Mode, bool> mPendingModes GUARDED_BY(mDispatchMutex);
+    // Requests the HAL does not support are dropped instead of being dispatched.
+    std::set<hardware::power::Boost> mUnsupportedBoosts GUARDED_BY(mDispatchMutex);
+    std::set<hardware::power::Mode> mUnsupportedModes GUARDED_BY(mDispatchMutex);
+
     std::shared_ptr<HalWrapper> initHal();
     template <typename T>
     HalResult<T> processHalResult(HalResult<T> result, const char* functionName);
+
+    void startDispatchLocked() REQUIRES(mDispatchMutex);
+    void dispatchLoop();
 };
 
 // -------------------------------------------------------------------------------------------------
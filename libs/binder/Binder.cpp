@@ -43,6 +43,7 @@
 
 #include "BuildFlags.h"
 #include "RpcState.h"
+#include "TransactionRecorder.h"
 
 namespace android {
 
@@ -274,7 +275,7 @@ public:
     std::set<sp<RpcServerLink>> mRpcServerLinks;
     BpBinder::ObjectManager mObjects;
 
-    android::base::unique_fd mRecordingFd;
+    std::shared_ptr<binder::debug::TransactionRecorder> mRecorder;
 };
 
 // ---------------------------------------------------------------------------
@@ -311,10 +312,20 @@ status_t BBinder::startRecordingTransactions(const Parcel& data) {
         LOG(INFO) << "Could not start Binder recording. Another is already in progress.";
         return INVALID_OPERATION;
     } else {
-        status_t readStatus = data.readUniqueFileDescriptor(&(e->mRecordingFd));
+        android::base::unique_fd fd;
+        status_t readStatus = data.readUniqueFileDescriptor(&fd);
         if (readStatus != OK) {
             return readStatus;
         }
+        // Older clients only send the file descriptor.
+        binder::debug::RecordingOptions options;
+        if (data.dataAvail() > 0) {
+            if (status_t status = options.readFromParcel(data); status != OK) {
+                return status;
+            }
+        }
+        e->mRecorder = std::make_shared<binder::debug::TransactionRecorder>(std::move(fd),
+                                                                            std::move(options));
         mRecordingOn = true;
         LOG(INFO) << "Started Binder recording.";
         return NO_ERROR;
@@ -336,16 +347,34 @@ status_t BBinder::stopRecordingTransactions() {
         return PERMISSION_DENIED;
     }
     Extras* e = getOrCreateExtras();
-    AutoMutex lock(e->mLock);
-    if (mRecordingOn) {
-        e->mRecordingFd.reset();
+    std::shared_ptr<binder::debug::TransactionRecorder> recorder;
+    {
+        AutoMutex lock(e->mLock);
+        if (!mRecordingOn) {
+            LOG(INFO) << "Could not stop Binder recording. One is not in progress.";
+            return INVALID_OPERATION;
+        }
+        recorder = std::move(e->mRecorder);
         mRecordingOn = false;
-        LOG(INFO) << "Stopped Binder recording.";
-        return NO_ERROR;
-    } else {
-        LOG(INFO) << "Could not stop Binder recording. One is not in progress.";
+    }
+    // Transactions still being recorded hold their own reference. The file is closed once all
+    // of them, and anything queued for the async writer, have been written.
+    recorder.reset();
+    LOG(INFO) << "Stopped Binder recording.";
+    return NO_ERROR;
+}
+
+status_t BBinder::getRecordingStats(binder::debug::RecordingStats* stats) {
+    Extras* e = mExtras.load(std::memory_order_acquire);
+    if (e == nullptr) {
+        return INVALID_OPERATION;
+    }
+    AutoMutex lock(e->mLock);
+    if (!mRecordingOn) {
         return INVALID_OPERATION;
     }
+    *stats = e->mRecorder->getStats();
+    return NO_ERROR;
 }
 
 const String16& BBinder::getInterfaceDescriptor() const
@@ -404,21 +433,17 @@ status_t BBinder::transact(
 
     if (CC_UNLIKELY(kEnableKernelIpc && mRecordingOn && code != START_RECORDING_TRANSACTION)) {
         Extras* e = mExtras.load(std::memory_order_acquire);
-        AutoMutex lock(e->mLock);
-        if (mRecordingOn) {
+        std::shared_ptr<binder::debug::TransactionRecorder> recorder;
+        {
+            // Only hold the lock to pick up the recorder, so that transactions on other threads
+            // are not serialized behind this one's write.
+            AutoMutex lock(e->mLock);
+            recorder = e->mRecorder;
+        }
+        if (recorder != nullptr && recorder->shouldRecord(code)) {
             Parcel emptyReply;
-            timespec ts;
-            timespec_get(&ts, TIME_UTC);
-            auto transaction = android::binder::debug::RecordedTransaction::
-                    fromDetails(getInterfaceDescriptor(), code, flags, ts, data,
-                                reply ? *reply : emptyReply, err);
-            if (transaction) {
-                if (status_t err = transaction->dumpToFile(e->mRecordingFd); err != NO_ERROR) {
-                    LOG(INFO) << "Failed to dump RecordedTransaction to file with error " << err;
-                }
-            } else {
-                LOG(INFO) << "Failed to create RecordedTransaction object.";
-            }
+            recorder->record(getInterfaceDescriptor(), code, flags, data,
+                             reply ? *reply : emptyReply, err);
         }
     }
 
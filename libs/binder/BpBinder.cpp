@@ -21,6 +21,7 @@
 
 #include <binder/IPCThreadState.h>
 #include <binder/IResultReceiver.h>
+#include <binder/RecordedTransaction.h>
 #include <binder/RpcSession.h>
 #include <binder/Stability.h>
 #include <cutils/compiler.h>
@@ -309,6 +310,16 @@ status_t BpBinder::startRecordingBinder(const android::base::unique_fd& fd) {
     return transact(START_RECORDING_TRANSACTION, send, &reply);
 }
 
+status_t BpBinder::startRecordingBinder(const android::base::unique_fd& fd,
+                                        const binder::debug::RecordingOptions& options) {
+    Parcel send, reply;
+    send.writeUniqueFileDescriptor(fd);
+    if (status_t status = options.writeToParcel(&send); status != OK) {
+        return status;
+    }
+    return transact(START_RECORDING_TRANSACTION, send, &reply);
+}
+
 status_t BpBinder::stopRecordingBinder() {
     Parcel data, reply;
     data.markForBinder(sp<BpBinder>::fromExisting(this));
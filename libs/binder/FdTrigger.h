@@ -58,6 +58,14 @@ public:
     [[nodiscard]] status_t triggerablePoll(const android::RpcTransportFd& transportFd,
                                            int16_t event);
 
+#ifndef BINDER_RPC_SINGLE_THREADED
+    /**
+     * The read end of the pipe, which receives POLLHUP once triggered, e.g. to
+     * wait for the trigger together with other FDs.
+     */
+    base::borrowed_fd pollFd() const { return mRead; }
+#endif
+
 private:
 #ifdef BINDER_RPC_SINGLE_THREADED
     bool mTriggered = false;
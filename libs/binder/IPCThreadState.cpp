@@ -28,6 +28,7 @@
 #include <utils/Log.h>
 #include <utils/SystemClock.h>
 
+#include <algorithm>
 #include <atomic>
 #include <errno.h>
 #include <inttypes.h>
@@ -564,6 +565,48 @@ ProcessState::CallRestriction IPCThreadState::getCallRestriction() const {
     return mCallRestriction;
 }
 
+void IPCThreadState::corkOnewayTransactions() {
+    mOnewayCorkDepth++;
+}
+
+status_t IPCThreadState::uncorkOnewayTransactions() {
+    LOG_ALWAYS_FATAL_IF(mOnewayCorkDepth == 0, "uncorkOnewayTransactions without a cork");
+    if (--mOnewayCorkDepth > 0) {
+        return NO_ERROR;
+    }
+    status_t err = flushCorkedTransactions();
+    if (mCorkedError != NO_ERROR) {
+        err = mCorkedError;
+        mCorkedError = NO_ERROR;
+    }
+    return err;
+}
+
+status_t IPCThreadState::flushCorkedTransactions() {
+    status_t result = NO_ERROR;
+    // The first wait writes all of the corked commands in a single BINDER_WRITE_READ. The rest
+    // consume one BR_TRANSACTION_COMPLETE (or error) each without talking to the driver again
+    // while mIn still holds returns.
+    for (size_t i = 0; i < mCorkedTransactions.size(); i++) {
+        const status_t err = waitForResponse(nullptr, nullptr);
+        if (err != NO_ERROR && result == NO_ERROR) {
+            result = err;
+        }
+    }
+    mCorkedTransactions.clear();
+    return result;
+}
+
+void IPCThreadState::setParcelBufferPoolEnabled(bool enabled) {
+    LOG_ALWAYS_FATAL_IF(selfOrNull() != this,
+                        "setParcelBufferPoolEnabled must be called on the owning thread");
+    Parcel::setThreadBufferPoolEnabled(enabled);
+}
+
+bool IPCThreadState::isParcelBufferPoolEnabled() const {
+    return selfOrNull() == this && Parcel::isThreadBufferPoolEnabled();
+}
+
 void IPCThreadState::restoreCallingIdentity(int64_t token)
 {
     mCallingUid = unpackCallingUid(token);
@@ -629,11 +672,15 @@ status_t IPCThreadState::getAndExecuteCommand()
     status_t result;
     int32_t cmd;
 
+    // Only measured for the adaptive thread pool
+    const bool measureIdleTime = mIsLooper && mProcess->mIdleTimeoutMs != 0;
+    const int64_t waitStartMs = measureIdleTime ? uptimeMillis() : 0;
     result = talkWithDriver();
     if (result >= NO_ERROR) {
         size_t IN = mIn.dataAvail();
         if (IN < sizeof(int32_t)) return result;
         cmd = mIn.readInt32();
+        mLastIdleTimeMs = measureIdleTime ? uptimeMillis() - waitStartMs : 0;
         IF_LOG_COMMANDS() {
             std::ostringstream logStream;
             logStream << "Processing top-level Command: " << getReturnString(cmd) << "\n";
@@ -643,6 +690,9 @@ status_t IPCThreadState::getAndExecuteCommand()
 
         pthread_mutex_lock(&mProcess->mThreadCountLock);
         mProcess->mExecutingThreadsCount++;
+        mProcess->mExecutedCommands++;
+        mProcess->mPeakExecutingThreadsCount =
+                std::max(mProcess->mPeakExecutingThreadsCount, mProcess->mExecutingThreadsCount);
         if (mProcess->mExecutingThreadsCount >= mProcess->mMaxThreads &&
                 mProcess->mStarvationStartTimeMs == 0) {
             mProcess->mStarvationStartTimeMs = uptimeMillis();
@@ -661,6 +711,7 @@ status_t IPCThreadState::getAndExecuteCommand()
                       mProcess->mMaxThreads, starvationTimeMs);
             }
             mProcess->mStarvationStartTimeMs = 0;
+            mProcess->onStarvationEndedLocked(starvationTimeMs);
         }
 
         // Cond broadcast can be expensive, so don't send it every time a binder
@@ -749,6 +800,21 @@ void IPCThreadState::joinThreadPool(bool isMain)
         if(result == TIMED_OUT && !isMain) {
             break;
         }
+
+        // The adaptive thread pool retires threads that were idle for a while, once they
+        // processed all of the commands they read.
+        if (!isMain && result >= NO_ERROR && mLastIdleTimeMs != 0 &&
+            mIn.dataPosition() >= mIn.dataSize()) {
+            pthread_mutex_lock(&mProcess->mThreadCountLock);
+            bool retire = mProcess->shouldRetireThreadLocked(mLastIdleTimeMs);
+            pthread_mutex_unlock(&mProcess->mThreadCountLock);
+            if (retire) {
+                LOG_THREADPOOL("**** THREAD %p (PID %d) WAS IDLE FOR %" PRId64 " ms\n",
+                               (void*)pthread_self(), getpid(), mLastIdleTimeMs);
+                processPendingDerefs();
+                break;
+            }
+        }
     } while (result != -ECONNREFUSED && result != -EBADF);
 
     LOG_THREADPOOL("**** THREAD %p (PID %d) IS LEAVING THE THREAD POOL err=%d\n",
@@ -824,13 +890,37 @@ status_t IPCThreadState::transact(int32_t handle,
 
     LOG_ONEWAY(">>>> SEND from pid %d uid %d %s", getpid(), getuid(),
         (flags & TF_ONE_WAY) == 0 ? "READ REPLY" : "ONE WAY");
-    err = writeTransactionData(BC_TRANSACTION, flags, handle, code, data, nullptr);
+
+    const bool corked = (flags & TF_ONE_WAY) != 0 && mOnewayCorkDepth > 0;
+    std::unique_ptr<Parcel> corkedData;
+    if (corked) {
+        // The BC_TRANSACTION only points at the data, which the caller may free before the
+        // driver sees it, so keep a copy until we uncork.
+        corkedData = std::make_unique<Parcel>();
+        err = corkedData->appendFrom(&data, 0, data.dataSize());
+        if (err != NO_ERROR) {
+            return (mLastError = err);
+        }
+    } else if (!mCorkedTransactions.empty()) {
+        // Keep the pending oneway transactions ahead of this one, and make sure their
+        // completions aren't mistaken for this transaction's.
+        const status_t corkedErr = flushCorkedTransactions();
+        if (mCorkedError == NO_ERROR) mCorkedError = corkedErr;
+    }
+
+    err = writeTransactionData(BC_TRANSACTION, flags, handle, code,
+                               corked ? *corkedData : data, nullptr);
 
     if (err != NO_ERROR) {
         if (reply) reply->setError(err);
         return (mLastError = err);
     }
 
+    if (corked) {
+        mCorkedTransactions.push_back(std::move(corkedData));
+        return NO_ERROR;
+    }
+
     if ((flags & TF_ONE_WAY) == 0) {
         if (UNLIKELY(mCallRestriction != ProcessState::CallRestriction::NONE)) {
             if (mCallRestriction == ProcessState::CallRestriction::ERROR_IF_NOT_ONEWAY) {
@@ -977,9 +1067,12 @@ IPCThreadState::IPCThreadState()
         mPropagateWorkSource(false),
         mIsLooper(false),
         mIsFlushing(false),
+        mLastIdleTimeMs(0),
         mStrictModePolicy(0),
         mLastTransactionBinderFlags(0),
-        mCallRestriction(mProcess->mCallRestriction) {
+        mCallRestriction(mProcess->mCallRestriction),
+        mOnewayCorkDepth(0),
+        mCorkedError(NO_ERROR) {
     pthread_setspecific(gTLS, this);
     clearCaller();
     mHasExplicitIdentity = false;
@@ -989,6 +1082,9 @@ IPCThreadState::IPCThreadState()
 
 IPCThreadState::~IPCThreadState()
 {
+    // Release any cached parcel buffers. This runs on the owning thread as it exits, and mIn/mOut
+    // are freed straight to the heap once the pool is disabled.
+    Parcel::setThreadBufferPoolEnabled(false);
 }
 
 status_t IPCThreadState::sendReply(const Parcel& reply, uint32_t flags)
@@ -21,6 +21,8 @@
 #include <inttypes.h>
 #include <unistd.h>
 
+#include <set>
+
 #include <android-base/properties.h>
 #include <android/os/BnServiceCallback.h>
 #include <android/os/IServiceManager.h>
@@ -66,6 +68,120 @@ const String16& IServiceManager::getInterfaceDescriptor() const {
 IServiceManager::IServiceManager() {}
 IServiceManager::~IServiceManager() {}
 
+std::vector<sp<IBinder>> IServiceManager::waitForServices(const std::vector<String16>& names) {
+    std::vector<sp<IBinder>> services;
+    services.reserve(names.size());
+    for (const String16& name : names) {
+        services.push_back(waitForService(name));
+    }
+    return services;
+}
+
+// Cache of the services returned by checkService.
+//
+// Entries are weak references: the cache must not keep a lazy service running, so a lookup only
+// hits while something else in the process still holds the service. The cache registers for
+// notifications on every name it has seen, so it learns about new registrations of the name,
+// and it drops entries when their service dies. Both need the threadpool to be started, the
+// cache isn't used otherwise.
+class ServiceCache : public android::os::BnServiceCallback, public IBinder::DeathRecipient {
+public:
+    // Returns the cached service, or nullptr on a miss. *generation is set on a miss, it needs to
+    // be passed to insert().
+    sp<IBinder> lookup(const std::string& name, uint64_t* generation) {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto it = mEntries.find(name);
+        if (it == mEntries.end()) {
+            *generation = 0;
+            return nullptr;
+        }
+        if (sp<IBinder> binder = promoteLocked(it->second)) {
+            return binder;
+        }
+        *generation = it->second.generation;
+        return nullptr;
+    }
+
+    // Records a service returned by servicemanager. Returns true if the caller needs to register
+    // the cache for notifications on the name.
+    bool insert(const std::string& name, const sp<IBinder>& binder, uint64_t generation) {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto [it, inserted] = mEntries.try_emplace(name);
+        if (inserted) {
+            // Wait for the notification, it is delivered as soon as the cache registers and it
+            // can't be older than the binder we got.
+            return true;
+        }
+        // Skip if a notification came in while the service was looked up, it is more recent.
+        if (!it->second.disabled && it->second.generation == generation) {
+            setLocked(it->second, binder);
+        }
+        return false;
+    }
+
+    // Called if registering for notifications failed, the name is never cached then.
+    void disable(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mLock);
+        Entry& entry = mEntries[name];
+        entry.binder = nullptr;
+        entry.disabled = true;
+    }
+
+    Status onRegistration(const std::string& name, const sp<IBinder>& binder) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto it = mEntries.find(name);
+        if (it == mEntries.end() || it->second.disabled) return Status::ok();
+        it->second.generation++;
+        if (it->second.binder != binder || promoteLocked(it->second) == nullptr) {
+            setLocked(it->second, binder);
+        }
+        return Status::ok();
+    }
+
+    void binderDied(const wp<IBinder>& who) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (auto& [name, entry] : mEntries) {
+            if (entry.binder == who) {
+                entry.binder = nullptr;
+                entry.isRemote = false;
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        wp<IBinder> binder;
+        bool isRemote = false;
+        bool disabled = false;
+        // Number of notifications received for the name
+        uint64_t generation = 0;
+    };
+
+    sp<IBinder> promoteLocked(const Entry& entry) {
+        if (entry.binder == nullptr) return nullptr;
+        // Proxies outlive their last strong reference and promoting them would then ask the
+        // driver, which isn't supported. Only promote proxies that are still strongly held.
+        if (entry.isRemote && entry.binder.get_refs()->refBase()->getStrongCount() == 0) {
+            return nullptr;
+        }
+        return entry.binder.promote();
+    }
+
+    // Proxies drop their death recipients along with their last strong reference, so this links
+    // again even if the binder didn't change.
+    void setLocked(Entry& entry, const sp<IBinder>& binder) {
+        entry.binder = binder;
+        entry.isRemote = binder != nullptr && binder->remoteBinder() != nullptr;
+        if (entry.isRemote && binder->linkToDeath(sp<DeathRecipient>::fromExisting(this)) != OK) {
+            entry.binder = nullptr;
+            entry.isRemote = false;
+        }
+    }
+
+    std::mutex mLock;
+    std::map<std::string, Entry> mEntries;
+};
+
 // From the old libbinder IServiceManager interface to IServiceManager.
 class ServiceManagerShim : public IServiceManager
 {
@@ -78,6 +194,7 @@ public:
                         bool allowIsolated, int dumpsysPriority) override;
     Vector<String16> listServices(int dumpsysPriority) override;
     sp<IBinder> waitForService(const String16& name16) override;
+    std::vector<sp<IBinder>> waitForServices(const std::vector<String16>& names) override;
     bool isDeclared(const String16& name) override;
     Vector<String16> getDeclaredInstances(const String16& interface) override;
     std::optional<String16> updatableViaApex(const String16& name) override;
@@ -121,6 +238,8 @@ protected:
     ServiceCallbackMap mNameToRegistrationCallback;
     std::mutex mNameToRegistrationLock;
 
+    sp<ServiceCache> mServiceCache = sp<ServiceCache>::make();
+
     void removeRegistrationCallbackLocked(const sp<AidlRegistrationCallback>& cb,
                                           ServiceCallbackMap::iterator* it,
                                           sp<RegistrationWaiter>* waiter);
@@ -317,10 +436,24 @@ sp<IBinder> ServiceManagerShim::getService(const String16& name) const
 
 sp<IBinder> ServiceManagerShim::checkService(const String16& name) const
 {
+    const std::string nameStr = String8(name).c_str();
+    uint64_t generation;
+    if (sp<IBinder> cached = mServiceCache->lookup(nameStr, &generation)) {
+        return cached;
+    }
+
     sp<IBinder> ret;
-    if (!mTheRealServiceManager->checkService(String8(name).c_str(), &ret).isOk()) {
+    if (!mTheRealServiceManager->checkService(nameStr, &ret).isOk()) {
         return nullptr;
     }
+    if (ret != nullptr && ProcessState::self()->isThreadPoolStarted() &&
+        mServiceCache->insert(nameStr, ret, generation)) {
+        if (Status status = mTheRealServiceManager->registerForNotifications(nameStr,
+                                                                             mServiceCache);
+            !status.isOk()) {
+            mServiceCache->disable(nameStr);
+        }
+    }
     return ret;
 }
 
@@ -440,6 +573,139 @@ sp<IBinder> ServiceManagerShim::waitForService(const String16& name16)
     }
 }
 
+std::vector<sp<IBinder>> ServiceManagerShim::waitForServices(const std::vector<String16>& names16)
+{
+    class Waiter : public android::os::BnServiceCallback {
+        Status onRegistration(const std::string& name, const sp<IBinder>& binder) override {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if (auto it = mBinders.find(name); it != mBinders.end() && it->second == nullptr) {
+                it->second = binder;
+                mMissing--;
+            }
+            lock.unlock();
+            // Flushing here helps ensure the service's ref count remains accurate
+            IPCThreadState::self()->flushCommands();
+            mCv.notify_one();
+            return Status::ok();
+        }
+    public:
+        // Only the names we are waiting for
+        std::map<std::string, sp<IBinder>> mBinders;
+        size_t mMissing = 0;
+        std::mutex mMutex;
+        std::condition_variable mCv;
+    };
+
+    std::vector<std::string> names;
+    names.reserve(names16.size());
+    for (const String16& name16 : names16) {
+        names.push_back(String8(name16).c_str());
+    }
+
+    // Start looking up all of the services before waiting for any of them, so that lazy services
+    // are started in parallel.
+    std::map<std::string, sp<IBinder>> found;
+    std::set<std::string> missing;
+    for (const std::string& name : names) {
+        if (found.count(name) || missing.count(name)) continue;
+        sp<IBinder> out;
+        if (Status status = realGetService(name, &out); !status.isOk()) {
+            ALOGW("Failed to getService in waitForServices for %s: %s", name.c_str(),
+                  status.toString8().c_str());
+            found[name] = nullptr;
+        } else if (out != nullptr) {
+            found[name] = out;
+        } else {
+            missing.insert(name);
+        }
+    }
+
+    sp<Waiter> waiter = sp<Waiter>::make();
+    std::vector<std::string> registered;
+    {
+        std::lock_guard<std::mutex> lock(waiter->mMutex);
+        for (const std::string& name : missing) {
+            waiter->mBinders[name] = nullptr;
+            waiter->mMissing++;
+        }
+    }
+    for (const std::string& name : missing) {
+        if (Status status = mTheRealServiceManager->registerForNotifications(name, waiter);
+            !status.isOk()) {
+            ALOGW("Failed to registerForNotifications in waitForServices for %s: %s",
+                  name.c_str(), status.toString8().c_str());
+            std::lock_guard<std::mutex> lock(waiter->mMutex);
+            waiter->mBinders.erase(name);
+            waiter->mMissing--;
+            found[name] = nullptr;
+            continue;
+        }
+        registered.push_back(name);
+    }
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(waiter->mMutex);
+            using std::literals::chrono_literals::operator""s;
+            waiter->mCv.wait_for(lock, 1s, [&] { return waiter->mMissing == 0; });
+            if (waiter->mMissing == 0) break;
+        }
+
+        // Same as in waitForService, request the services again to handle the race with dying
+        // lazy services.
+        std::vector<std::string> stillMissing;
+        {
+            std::lock_guard<std::mutex> lock(waiter->mMutex);
+            for (const auto& [name, binder] : waiter->mBinders) {
+                if (binder == nullptr) stillMissing.push_back(name);
+            }
+        }
+        ALOGW("Waited one second for %zu service(s), including %s (Number of threads started in "
+              "the threadpool: %zu. Are binder threads started and available?)",
+              stillMissing.size(), stillMissing.empty() ? "" : stillMissing[0].c_str(),
+              ProcessState::self()->getThreadPoolMaxTotalThreadCount());
+
+        for (const std::string& name : stillMissing) {
+            sp<IBinder> out;
+            Status status = realGetService(name, &out);
+            if (!status.isOk()) {
+                ALOGW("Failed to getService in waitForServices on later try for %s: %s",
+                      name.c_str(), status.toString8().c_str());
+            }
+            if (!status.isOk() || out != nullptr) {
+                std::lock_guard<std::mutex> lock(waiter->mMutex);
+                auto it = waiter->mBinders.find(name);
+                if (it == waiter->mBinders.end() || it->second != nullptr) continue;
+                waiter->mMissing--;
+                if (status.isOk()) {
+                    it->second = out;
+                } else {
+                    // Not waited for anymore, stays nullptr
+                    waiter->mBinders.erase(it);
+                    found[name] = nullptr;
+                }
+            }
+        }
+    }
+
+    for (const std::string& name : registered) {
+        mTheRealServiceManager->unregisterForNotifications(name, waiter);
+    }
+    {
+        std::lock_guard<std::mutex> lock(waiter->mMutex);
+        for (const auto& [name, binder] : waiter->mBinders) {
+            found.try_emplace(name, binder);
+        }
+    }
+
+    std::vector<sp<IBinder>> services;
+    services.reserve(names.size());
+    for (const std::string& name : names) {
+        services.push_back(found[name]);
+    }
+    return services;
+}
+
 bool ServiceManagerShim::isDeclared(const String16& name) {
     bool declared;
     if (Status status = mTheRealServiceManager->isDeclared(String8(name).c_str(), &declared);
@@ -24,11 +24,17 @@
 #include <android/os/IServiceManager.h>
 #include <utils/Log.h>
 
+#include <condition_variable>
+#include <optional>
+#include <thread>
+
 namespace android {
 namespace binder {
 namespace internal {
 
 using AidlServiceManager = android::os::IServiceManager;
+using LingerPolicy = LazyServiceRegistrar::LingerPolicy;
+using std::chrono_literals::operator""ms;
 
 class ClientCounterCallbackImpl : public ::android::os::BnClientCallback {
 public:
@@ -40,6 +46,8 @@ public:
 
     void setActiveServicesCallback(const std::function<bool(bool)>& activeServicesCallback);
 
+    void setLingerPolicy(const LingerPolicy& policy);
+
     bool tryUnregisterLocked();
 
     void reRegisterLocked();
@@ -81,6 +89,20 @@ private:
      */
     void maybeTryShutdownLocked();
 
+    /**
+     * Shut down once the linger time elapsed, unless a client comes back in the meantime.
+     */
+    void scheduleShutdownLocked();
+
+    /**
+     * Called when a service got a client while a shutdown was scheduled.
+     */
+    void cancelShutdownLocked();
+
+    void lingerLoop();
+
+    using Clock = std::chrono::steady_clock;
+
     // for below
     std::mutex mMutex;
 
@@ -97,6 +119,16 @@ private:
 
     // Callback used to report if there are services with clients
     std::function<bool(bool)> mActiveServicesCallback;
+
+    LingerPolicy mLingerPolicy;
+    // current linger time, between the min and max of the policy
+    std::chrono::milliseconds mLinger{0};
+    // last time mLinger changed
+    Clock::time_point mLingerUpdateTime;
+    // set while waiting to shut down
+    std::optional<Clock::time_point> mShutdownDeadline;
+    std::condition_variable mLingerCondition;
+    bool mLingerThreadStarted = false;
 };
 
 class ClientCounterCallback {
@@ -113,6 +145,8 @@ public:
 
     void setActiveServicesCallback(const std::function<bool(bool)>& activeServicesCallback);
 
+    void setLingerPolicy(const LingerPolicy& policy);
+
     bool tryUnregister();
 
     void reRegister();
@@ -236,7 +270,69 @@ void ClientCounterCallbackImpl::maybeTryShutdownLocked() {
     // client count change event, try to shutdown the process if its services
     // have no clients.
     if (!handledInCallback && mNumConnectedServices == 0) {
-        tryShutdownLocked();
+        if (mLingerPolicy.minLinger > 0ms) {
+            scheduleShutdownLocked();
+        } else {
+            tryShutdownLocked();
+        }
+    }
+}
+
+void ClientCounterCallbackImpl::scheduleShutdownLocked() {
+    if (mShutdownDeadline) return;
+
+    Clock::time_point now = Clock::now();
+    if (mLingerPolicy.decayPeriod > 0ms) {
+        for (; mLinger > mLingerPolicy.minLinger &&
+             now - mLingerUpdateTime >= mLingerPolicy.decayPeriod;
+             mLingerUpdateTime += mLingerPolicy.decayPeriod) {
+            mLinger /= 2;
+        }
+    }
+    if (mLinger <= mLingerPolicy.minLinger) {
+        mLinger = mLingerPolicy.minLinger;
+        mLingerUpdateTime = now;
+    }
+
+    ALOGI("No clients in use for any service in process, shutting down in %lld ms.",
+          static_cast<long long>(mLinger.count()));
+    mShutdownDeadline = now + mLinger;
+    if (!mLingerThreadStarted) {
+        mLingerThreadStarted = true;
+        std::thread([self = sp<ClientCounterCallbackImpl>::fromExisting(this)] {
+            self->lingerLoop();
+        }).detach();
+    }
+    mLingerCondition.notify_all();
+}
+
+void ClientCounterCallbackImpl::cancelShutdownLocked() {
+    if (!mShutdownDeadline) return;
+
+    mShutdownDeadline.reset();
+    mLinger = std::min(mLinger * 2, mLingerPolicy.maxLinger);
+    mLingerUpdateTime = Clock::now();
+    ALOGI("Service got a client while lingering, lingering for %lld ms next time.",
+          static_cast<long long>(mLinger.count()));
+    mLingerCondition.notify_all();
+}
+
+void ClientCounterCallbackImpl::lingerLoop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        if (!mShutdownDeadline) {
+            mLingerCondition.wait(lock);
+            continue;
+        }
+        if (Clock::now() < *mShutdownDeadline) {
+            mLingerCondition.wait_until(lock, *mShutdownDeadline);
+            continue;
+        }
+
+        mShutdownDeadline.reset();
+        if (!mForcePersist && mNumConnectedServices == 0) {
+            tryShutdownLocked();
+        }
     }
 }
 
@@ -262,6 +358,10 @@ Status ClientCounterCallbackImpl::onClients(const sp<IBinder>& service, bool cli
     ALOGI("Process has %zu (of %zu available) client(s) in use after notification %s has clients: %d",
           mNumConnectedServices, mRegisteredServices.size(), name.c_str(), clients);
 
+    if (mNumConnectedServices != 0) {
+        cancelShutdownLocked();
+    }
+
     maybeTryShutdownLocked();
     return Status::ok();
 }
@@ -283,6 +383,14 @@ void ClientCounterCallbackImpl::setActiveServicesCallback(const std::function<bo
     mActiveServicesCallback = activeServicesCallback;
 }
 
+void ClientCounterCallbackImpl::setLingerPolicy(const LingerPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLingerPolicy = policy;
+    mLingerPolicy.maxLinger = std::max(policy.minLinger, policy.maxLinger);
+    mLinger = mLingerPolicy.minLinger;
+    mLingerUpdateTime = Clock::now();
+}
+
 ClientCounterCallback::ClientCounterCallback() {
       mImpl = sp<ClientCounterCallbackImpl>::make();
 }
@@ -301,6 +409,10 @@ void ClientCounterCallback::setActiveServicesCallback(const std::function<bool(b
     mImpl->setActiveServicesCallback(activeServicesCallback);
 }
 
+void ClientCounterCallback::setLingerPolicy(const LingerPolicy& policy) {
+    mImpl->setLingerPolicy(policy);
+}
+
 bool ClientCounterCallback::tryUnregister() {
     // see comments in header, this should only be called from the active
     // services callback, see also b/191781736
@@ -341,6 +453,10 @@ void LazyServiceRegistrar::setActiveServicesCallback(const std::function<bool(bo
     mClientCC->setActiveServicesCallback(activeServicesCallback);
 }
 
+void LazyServiceRegistrar::setLingerPolicy(const LingerPolicy& policy) {
+    mClientCC->setLingerPolicy(policy);
+}
+
 bool LazyServiceRegistrar::tryUnregister() {
     return mClientCC->tryUnregister();
 }
@@ -24,6 +24,9 @@
 #include <utils/SortedVector.h>
 #include <utils/String8.h>
 
+#include <algorithm>
+#include <unordered_map>
+
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -119,22 +122,43 @@ private:
 
 // ----------------------------------------------------------------------------
 
-class SimpleBestFitAllocator
+class MemoryDealerAllocator
+{
+public:
+    virtual ~MemoryDealerAllocator() = default;
+
+    // Returns the offset of the allocation in the heap, or NO_MEMORY.
+    virtual ssize_t     allocate(size_t size) = 0;
+    virtual status_t    deallocate(size_t offset) = 0;
+    virtual MemoryDealer::Stats getStats() const = 0;
+    virtual void        dump(const char* what) const = 0;
+    virtual void        dump(String8& res, const char* what) const = 0;
+
+    // align all the memory blocks on a cache-line boundary
+    static constexpr size_t kMemoryAlign = 32;
+
+protected:
+    static void dumpStats(String8& res, const MemoryDealer::Stats& stats);
+};
+
+// ----------------------------------------------------------------------------
+
+class SimpleBestFitAllocator : public MemoryDealerAllocator
 {
     enum {
         PAGE_ALIGNED = 0x00000001
     };
 public:
     explicit SimpleBestFitAllocator(size_t size);
-    ~SimpleBestFitAllocator();
+    ~SimpleBestFitAllocator() override;
 
-    size_t      allocate(size_t size, uint32_t flags = 0);
-    status_t    deallocate(size_t offset);
+    ssize_t     allocate(size_t size) override { return allocate(size, 0); }
+    ssize_t     allocate(size_t size, uint32_t flags);
+    status_t    deallocate(size_t offset) override;
     size_t      size() const;
-    void        dump(const char* what) const;
-    void        dump(String8& res, const char* what) const;
-
-    static size_t getAllocationAlignment() { return kMemoryAlign; }
+    MemoryDealer::Stats getStats() const override;
+    void        dump(const char* what) const override;
+    void        dump(String8& res, const char* what) const override;
 
 private:
 
@@ -154,7 +178,6 @@ private:
     void     dump_l(const char* what) const;
     void     dump_l(String8& res, const char* what) const;
 
-    static const int    kMemoryAlign;
     mutable Mutex       mLock;
     LinkedList<chunk_t> mList;
     size_t              mHeapSize;
@@ -162,6 +185,66 @@ private:
 
 // ----------------------------------------------------------------------------
 
+/*
+ * A two-level segregated fit (TLSF) allocator. Free blocks are kept in lists by size class, with
+ * a bitmap of the non-empty lists, so that finding a block that fits, splitting it, and merging
+ * it back with its neighbors when it is freed all take constant time.
+ *
+ * The heap is shared with other processes, so the block headers are kept on the side rather
+ * than in the heap itself.
+ */
+class SegregatedFitAllocator : public MemoryDealerAllocator
+{
+public:
+    explicit SegregatedFitAllocator(size_t size);
+    ~SegregatedFitAllocator() override;
+
+    ssize_t     allocate(size_t size) override;
+    status_t    deallocate(size_t offset) override;
+    MemoryDealer::Stats getStats() const override;
+    void        dump(const char* what) const override;
+    void        dump(String8& res, const char* what) const override;
+
+private:
+    // Offsets and sizes are in units of kMemoryAlign.
+    struct block_t {
+        size_t      start;
+        size_t      size;
+        bool        free;
+        // The blocks right before and after this one in the heap.
+        block_t*    prevPhys;
+        block_t*    nextPhys;
+        // The other free blocks in the same size class.
+        block_t*    prevFree;
+        block_t*    nextFree;
+    };
+
+    // Each power of two is split into 2^kSecondLevelLog2 size classes. Sizes below
+    // 2^kSecondLevelLog2 each get their own class in the first row.
+    static constexpr size_t kSecondLevelLog2 = 4;
+    static constexpr size_t kSecondLevelCount = 1 << kSecondLevelLog2;
+    static constexpr size_t kFirstLevelCount = sizeof(size_t) * 8 - kSecondLevelLog2 + 1;
+    static_assert(kFirstLevelCount <= 64);
+
+    static void mapping(size_t size, size_t* fl, size_t* sl);
+    block_t*    findFree_l(size_t size) const;
+    void        insertFree_l(block_t* block);
+    void        removeFree_l(block_t* block);
+    MemoryDealer::Stats getStats_l() const;
+
+    mutable Mutex       mLock;
+    size_t              mHeapSize;
+    block_t*            mFirstBlock;
+    uint64_t            mFirstLevelMap = 0;
+    uint32_t            mSecondLevelMap[kFirstLevelCount] = {};
+    block_t*            mFreeLists[kFirstLevelCount][kSecondLevelCount] = {};
+    size_t              mFreeBlockCount = 0;
+    std::unordered_map<size_t, block_t*> mAllocated;
+    size_t              mAllocatedSize = 0;
+};
+
+// ----------------------------------------------------------------------------
+
 Allocation::Allocation(
         const sp<MemoryDealer>& dealer,
         const sp<IMemoryHeap>& heap, ssize_t offset, size_t size)
@@ -227,8 +310,21 @@ Allocation::~Allocation()
 // ----------------------------------------------------------------------------
 
 MemoryDealer::MemoryDealer(size_t size, const char* name, uint32_t flags)
-      : mHeap(sp<MemoryHeapBase>::make(size, flags, name)),
-        mAllocator(new SimpleBestFitAllocator(size)) {}
+      : MemoryDealer(size, name, flags, AllocatorType::BEST_FIT) {}
+
+MemoryDealer::MemoryDealer(size_t size, const char* name, uint32_t flags,
+                           AllocatorType allocatorType)
+      : mHeap(sp<MemoryHeapBase>::make(size, flags, name)) {
+    switch (allocatorType) {
+        case AllocatorType::SEGREGATED_FIT:
+            mAllocator = new SegregatedFitAllocator(size);
+            break;
+        case AllocatorType::BEST_FIT:
+        default:
+            mAllocator = new SimpleBestFitAllocator(size);
+            break;
+    }
+}
 
 MemoryDealer::~MemoryDealer()
 {
@@ -255,24 +351,38 @@ void MemoryDealer::dump(const char* what) const
     allocator()->dump(what);
 }
 
+MemoryDealer::Stats MemoryDealer::getStats() const
+{
+    return allocator()->getStats();
+}
+
 const sp<IMemoryHeap>& MemoryDealer::heap() const {
     return mHeap;
 }
 
-SimpleBestFitAllocator* MemoryDealer::allocator() const {
+MemoryDealerAllocator* MemoryDealer::allocator() const {
     return mAllocator;
 }
 
 // static
 size_t MemoryDealer::getAllocationAlignment()
 {
-    return SimpleBestFitAllocator::getAllocationAlignment();
+    return MemoryDealerAllocator::kMemoryAlign;
 }
 
 // ----------------------------------------------------------------------------
 
-// align all the memory blocks on a cache-line boundary
-const int SimpleBestFitAllocator::kMemoryAlign = 32;
+void MemoryDealerAllocator::dumpStats(String8& result, const MemoryDealer::Stats& stats)
+{
+    result.appendFormat("  size allocated: %zu (%zu KB) in %zu allocations\n",
+            stats.allocatedSize, stats.allocatedSize / 1024, stats.allocationCount);
+    result.appendFormat("  largest free block: %zu (%zu KB) of %zu KB free in %zu blocks, "
+            "fragmentation %.1f%%\n",
+            stats.largestFreeBlock, stats.largestFreeBlock / 1024, stats.freeSize / 1024,
+            stats.freeBlockCount, stats.fragmentation() * 100.f);
+}
+
+// ----------------------------------------------------------------------------
 
 SimpleBestFitAllocator::SimpleBestFitAllocator(size_t size)
 {
@@ -303,7 +413,7 @@ size_t SimpleBestFitAllocator::size() const
     return mHeapSize;
 }
 
-size_t SimpleBestFitAllocator::allocate(size_t size, uint32_t flags)
+ssize_t SimpleBestFitAllocator::allocate(size_t size, uint32_t flags)
 {
     Mutex::Autolock _l(mLock);
     ssize_t offset = alloc(size, flags);
@@ -418,6 +528,25 @@ SimpleBestFitAllocator::chunk_t* SimpleBestFitAllocator::dealloc(size_t start)
     return nullptr;
 }
 
+MemoryDealer::Stats SimpleBestFitAllocator::getStats() const
+{
+    Mutex::Autolock _l(mLock);
+    MemoryDealer::Stats stats;
+    stats.heapSize = mHeapSize;
+    for (chunk_t const* cur = mList.head(); cur; cur = cur->next) {
+        const size_t size = cur->size * kMemoryAlign;
+        if (cur->free) {
+            stats.freeSize += size;
+            stats.freeBlockCount++;
+            stats.largestFreeBlock = std::max(stats.largestFreeBlock, size);
+        } else {
+            stats.allocatedSize += size;
+            stats.allocationCount++;
+        }
+    }
+    return stats;
+}
+
 void SimpleBestFitAllocator::dump(const char* what) const
 {
     Mutex::Autolock _l(mLock);
@@ -441,7 +570,8 @@ void SimpleBestFitAllocator::dump(String8& result,
 void SimpleBestFitAllocator::dump_l(String8& result,
         const char* what) const
 {
-    size_t size = 0;
+    MemoryDealer::Stats stats;
+    stats.heapSize = mHeapSize;
     int32_t i = 0;
     chunk_t const* cur = mList.head();
     
@@ -466,15 +596,240 @@ void SimpleBestFitAllocator::dump_l(String8& result,
         
         result.append(buffer);
 
-        if (!cur->free)
-            size += cur->size*kMemoryAlign;
+        const size_t size = cur->size*kMemoryAlign;
+        if (cur->free) {
+            stats.freeSize += size;
+            stats.freeBlockCount++;
+            stats.largestFreeBlock = std::max(stats.largestFreeBlock, size);
+        } else {
+            stats.allocatedSize += size;
+            stats.allocationCount++;
+        }
 
         i++;
         cur = cur->next;
     }
-    snprintf(buffer, SIZE,
-            "  size allocated: %u (%u KB)\n", int(size), int(size/1024));
-    result.append(buffer);
+    dumpStats(result, stats);
+}
+
+// ----------------------------------------------------------------------------
+
+SegregatedFitAllocator::SegregatedFitAllocator(size_t size)
+{
+    size_t pagesize = getpagesize();
+    mHeapSize = ((size + pagesize-1) & ~(pagesize-1));
+
+    mFirstBlock = new block_t{0, mHeapSize / kMemoryAlign, true, nullptr, nullptr, nullptr,
+                              nullptr};
+    if (mFirstBlock->size > 0) {
+        insertFree_l(mFirstBlock);
+    }
+}
+
+SegregatedFitAllocator::~SegregatedFitAllocator()
+{
+    block_t* cur = mFirstBlock;
+    while (cur) {
+        block_t* const next = cur->nextPhys;
+        delete cur;
+        cur = next;
+    }
+}
+
+void SegregatedFitAllocator::mapping(size_t size, size_t* fl, size_t* sl)
+{
+    if (size < kSecondLevelCount) {
+        *fl = 0;
+        *sl = size;
+    } else {
+        const size_t msb = sizeof(size_t) * 8 - 1 - __builtin_clzl(size);
+        *fl = msb - kSecondLevelLog2 + 1;
+        *sl = (size >> (msb - kSecondLevelLog2)) - kSecondLevelCount;
+    }
+}
+
+SegregatedFitAllocator::block_t* SegregatedFitAllocator::findFree_l(size_t size) const
+{
+    // Look in the classes that only hold blocks at least as large as the request, so that the
+    // first block found fits.
+    size_t rounded = size;
+    if (size >= kSecondLevelCount) {
+        const size_t msb = sizeof(size_t) * 8 - 1 - __builtin_clzl(size);
+        rounded += (size_t(1) << (msb - kSecondLevelLog2)) - 1;
+    }
+    size_t fl, sl;
+    mapping(rounded, &fl, &sl);
+    if (fl < kFirstLevelCount) {
+        uint32_t slMap = mSecondLevelMap[fl] & (~0u << sl);
+        if (!slMap) {
+            const uint64_t flMap = mFirstLevelMap & (~uint64_t(0) << (fl + 1));
+            if (flMap) {
+                fl = __builtin_ctzll(flMap);
+                slMap = mSecondLevelMap[fl];
+            }
+        }
+        if (slMap) {
+            return mFreeLists[fl][__builtin_ctz(slMap)];
+        }
+    }
+
+    // Close to running out: the request's own class may still have a block that is large
+    // enough.
+    mapping(size, &fl, &sl);
+    for (block_t* cur = mFreeLists[fl][sl]; cur; cur = cur->nextFree) {
+        if (cur->size >= size) {
+            return cur;
+        }
+    }
+    return nullptr;
+}
+
+void SegregatedFitAllocator::insertFree_l(block_t* block)
+{
+    size_t fl, sl;
+    mapping(block->size, &fl, &sl);
+    block->free = true;
+    block->prevFree = nullptr;
+    block->nextFree = mFreeLists[fl][sl];
+    if (block->nextFree) {
+        block->nextFree->prevFree = block;
+    }
+    mFreeLists[fl][sl] = block;
+    mSecondLevelMap[fl] |= 1u << sl;
+    mFirstLevelMap |= uint64_t(1) << fl;
+    mFreeBlockCount++;
+}
+
+void SegregatedFitAllocator::removeFree_l(block_t* block)
+{
+    size_t fl, sl;
+    mapping(block->size, &fl, &sl);
+    if (block->prevFree) {
+        block->prevFree->nextFree = block->nextFree;
+    } else {
+        mFreeLists[fl][sl] = block->nextFree;
+        if (!block->nextFree) {
+            mSecondLevelMap[fl] &= ~(1u << sl);
+            if (!mSecondLevelMap[fl]) {
+                mFirstLevelMap &= ~(uint64_t(1) << fl);
+            }
+        }
+    }
+    if (block->nextFree) {
+        block->nextFree->prevFree = block->prevFree;
+    }
+    block->free = false;
+    mFreeBlockCount--;
+}
+
+ssize_t SegregatedFitAllocator::allocate(size_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    if (size > mHeapSize) {
+        return NO_MEMORY;
+    }
+    size = (size + kMemoryAlign-1) / kMemoryAlign;
+
+    Mutex::Autolock _l(mLock);
+    block_t* const block = findFree_l(size);
+    if (!block) {
+        return NO_MEMORY;
+    }
+    removeFree_l(block);
+    if (block->size > size) {
+        block_t* const split = new block_t{block->start + size, block->size - size, true, block,
+                                           block->nextPhys, nullptr, nullptr};
+        if (block->nextPhys) {
+            block->nextPhys->prevPhys = split;
+        }
+        block->nextPhys = split;
+        block->size = size;
+        insertFree_l(split);
+    }
+    mAllocated.emplace(block->start, block);
+    mAllocatedSize += block->size;
+    return block->start * kMemoryAlign;
+}
+
+status_t SegregatedFitAllocator::deallocate(size_t offset)
+{
+    Mutex::Autolock _l(mLock);
+    const auto it = mAllocated.find(offset / kMemoryAlign);
+    if (offset % kMemoryAlign || it == mAllocated.end()) {
+        return NAME_NOT_FOUND;
+    }
+    block_t* block = it->second;
+    mAllocated.erase(it);
+    mAllocatedSize -= block->size;
+
+    // merge freed blocks together
+    if (block_t* const prev = block->prevPhys; prev && prev->free) {
+        removeFree_l(prev);
+        prev->size += block->size;
+        prev->nextPhys = block->nextPhys;
+        if (block->nextPhys) {
+            block->nextPhys->prevPhys = prev;
+        }
+        delete block;
+        block = prev;
+    }
+    if (block_t* const next = block->nextPhys; next && next->free) {
+        removeFree_l(next);
+        block->size += next->size;
+        block->nextPhys = next->nextPhys;
+        if (next->nextPhys) {
+            next->nextPhys->prevPhys = block;
+        }
+        delete next;
+    }
+    insertFree_l(block);
+    return NO_ERROR;
+}
+
+MemoryDealer::Stats SegregatedFitAllocator::getStats() const
+{
+    Mutex::Autolock _l(mLock);
+    return getStats_l();
+}
+
+MemoryDealer::Stats SegregatedFitAllocator::getStats_l() const
+{
+    MemoryDealer::Stats stats;
+    stats.heapSize = mHeapSize;
+    stats.allocatedSize = mAllocatedSize * kMemoryAlign;
+    stats.allocationCount = mAllocated.size();
+    stats.freeSize = mHeapSize - stats.allocatedSize;
+    stats.freeBlockCount = mFreeBlockCount;
+    if (mFirstLevelMap) {
+        // The largest free block is in the highest non-empty class.
+        const size_t fl = 63 - __builtin_clzll(mFirstLevelMap);
+        const size_t sl = 31 - __builtin_clz(mSecondLevelMap[fl]);
+        for (block_t const* cur = mFreeLists[fl][sl]; cur; cur = cur->nextFree) {
+            stats.largestFreeBlock = std::max(stats.largestFreeBlock, cur->size * kMemoryAlign);
+        }
+    }
+    return stats;
+}
+
+void SegregatedFitAllocator::dump(const char* what) const
+{
+    String8 result;
+    dump(result, what);
+    ALOGD("%s", result.string());
+}
+
+void SegregatedFitAllocator::dump(String8& result, const char* what) const
+{
+    Mutex::Autolock _l(mLock);
+    result.appendFormat("  %s (%p, size=%zu, segregated fit)\n", what, this, mHeapSize);
+    int32_t i = 0;
+    for (block_t const* cur = mFirstBlock; cur; cur = cur->nextPhys) {
+        result.appendFormat("  %3d: %p | 0x%08zX | 0x%08zX | %s\n", i++, cur,
+                cur->start * kMemoryAlign, cur->size * kMemoryAlign, cur->free ? "F" : "A");
+    }
+    dumpStats(result, getStats_l());
 }
 
 
@@ -102,6 +102,7 @@ static_assert(sizeof(Parcel) == 60);
 
 static std::atomic<size_t> gParcelGlobalAllocCount;
 static std::atomic<size_t> gParcelGlobalAllocSize;
+static std::atomic<size_t> gParcelGlobalPoolReuseCount;
 
 // Maximum number of file descriptors per Parcel.
 constexpr size_t kMaxFds = 1024;
@@ -365,6 +366,10 @@ size_t Parcel::getGlobalAllocCount() {
     return gParcelGlobalAllocCount.load();
 }
 
+size_t Parcel::getGlobalPoolReuseCount() {
+    return gParcelGlobalPoolReuseCount.load();
+}
+
 const uint8_t* Parcel::data() const
 {
     return mData;
@@ -1119,7 +1124,7 @@ restart_write:
 status_t Parcel::writeUtf8AsUtf16(const std::string& str) {
     const uint8_t* strData = (uint8_t*)str.data();
     const size_t strLen= str.length();
-    const ssize_t utf16Len = utf8_to_utf16_length(strData, strLen);
+    const ssize_t utf16Len = utf8ToUtf16Length(strData, strLen);
     if (utf16Len < 0 || utf16Len > std::numeric_limits<int32_t>::max()) {
         return BAD_VALUE;
     }
@@ -1135,7 +1140,7 @@ status_t Parcel::writeUtf8AsUtf16(const std::string& str) {
         return NO_MEMORY;
     }
 
-    utf8_to_utf16(strData, strLen, (char16_t*)dst, (size_t) utf16Len + 1);
+    utf8ToUtf16(strData, strLen, (char16_t*)dst, (size_t) utf16Len + 1);
 
     return NO_ERROR;
 }
@@ -1536,8 +1541,17 @@ status_t Parcel::writeBlob(size_t len, bool mutableCopy, WritableBlob* outBlob)
         return BAD_VALUE;
     }
 
+    // Large blobs are shared through memory, which needs a file descriptor. Over RPC binder that
+    // only works if the session carries file descriptors (e.g. over unix domain sockets).
+    bool canShareFd = mAllowFds;
+    if (const auto* rpcFields = maybeRpcFields()) {
+        canShareFd = canShareFd &&
+                rpcFields->mSession->getFileDescriptorTransportMode() !=
+                        RpcSession::FileDescriptorTransportMode::NONE;
+    }
+
     status_t status;
-    if (!mAllowFds || len <= BLOB_INPLACE_LIMIT) {
+    if (!canShareFd || len <= BLOB_INPLACE_LIMIT) {
         ALOGV("writeBlob: write in place");
         status = writeInt32(BLOB_INPLACE);
         if (status) return status;
@@ -2058,14 +2072,11 @@ status_t Parcel::readUtf8FromUtf16(std::string* str) const {
     }
 
     // Allow for closing '\0'
-    ssize_t utf8Size = utf16_to_utf8_length(src, utf16Size) + 1;
-    if (utf8Size < 1) {
-        return BAD_VALUE;
-    }
+    size_t utf8Size = utf16ToUtf8Length(src, utf16Size) + 1;
     // Note that while it is probably safe to assume string::resize keeps a
     // spare byte around for the trailing null, we still pass the size including the trailing null
     str->resize(utf8Size);
-    utf16_to_utf8(src, utf16Size, &((*str)[0]), utf8Size);
+    utf16ToUtf8(src, utf16Size, &((*str)[0]), utf8Size);
     str->resize(utf8Size - 1);
     return NO_ERROR;
 }
@@ -2729,6 +2740,102 @@ void Parcel::acquireObjects()
 #endif // BINDER_WITH_KERNEL_IPC
 }
 
+// Per-thread cache of parcel data buffers, see Parcel::setThreadBufferPoolEnabled().
+//
+// Buffers are bucketed in power-of-two size classes from 128 bytes (the minimum allocation made
+// by growData()) to 4KB. A pooled buffer is always allocated with the full size of its class, so
+// a parcel can grow within its class without reallocating. Larger buffers bypass the pool.
+//
+// This is trivially destructible on purpose: parcels owned by other thread-local state (e.g.
+// IPCThreadState::mIn/mOut) may be freed after thread_local destructors have run. Threads must
+// disable the pool before exiting to release the cached buffers; IPCThreadState does this.
+namespace {
+class ParcelBufferPool {
+public:
+    static constexpr size_t kNumClasses = 6;
+    static constexpr size_t kMaxBuffersPerClass = 8;
+    // High-water mark for the bytes cached by one thread.
+    static constexpr size_t kMaxCachedBytes = 32 * 1024;
+
+    // Returns the size class holding |size| bytes, or kNumClasses if it is too large to pool.
+    static size_t classOf(size_t size) {
+        size_t sizeClass = 0;
+        while (sizeClass < kNumClasses && classSize(sizeClass) < size) sizeClass++;
+        return sizeClass;
+    }
+    static size_t classSize(size_t sizeClass) { return size_t(128) << sizeClass; }
+
+    bool isEnabled() const { return mEnabled; }
+
+    void setEnabled(bool enabled) {
+        mEnabled = enabled;
+        if (enabled) return;
+        for (size_t sizeClass = 0; sizeClass < kNumClasses; sizeClass++) {
+            while (mCounts[sizeClass] > 0) {
+                free(mBuffers[sizeClass][--mCounts[sizeClass]]);
+            }
+        }
+        mCachedBytes = 0;
+    }
+
+    uint8_t* acquire(size_t sizeClass) {
+        if (mCounts[sizeClass] > 0) {
+            mCachedBytes -= classSize(sizeClass);
+            gParcelGlobalPoolReuseCount++;
+            return mBuffers[sizeClass][--mCounts[sizeClass]];
+        }
+        return static_cast<uint8_t*>(malloc(classSize(sizeClass)));
+    }
+
+    void release(uint8_t* data, size_t sizeClass) {
+        if (!mEnabled || mCounts[sizeClass] == kMaxBuffersPerClass ||
+            mCachedBytes + classSize(sizeClass) > kMaxCachedBytes) {
+            free(data);
+            return;
+        }
+        mBuffers[sizeClass][mCounts[sizeClass]++] = data;
+        mCachedBytes += classSize(sizeClass);
+    }
+
+private:
+    bool mEnabled;
+    size_t mCachedBytes;
+    size_t mCounts[kNumClasses];
+    uint8_t* mBuffers[kNumClasses][kMaxBuffersPerClass];
+};
+} // namespace
+static_assert(std::is_trivially_destructible_v<ParcelBufferPool>);
+
+static thread_local ParcelBufferPool tParcelBufferPool;
+
+// Allocates |capacity| bytes of parcel data. *outPooled is set if the buffer came from the
+// calling thread's pool, and must be passed back to freeParcelData().
+static uint8_t* allocParcelData(size_t capacity, bool* outPooled) {
+    const size_t sizeClass = ParcelBufferPool::classOf(capacity);
+    if (tParcelBufferPool.isEnabled() && sizeClass < ParcelBufferPool::kNumClasses) {
+        *outPooled = true;
+        return tParcelBufferPool.acquire(sizeClass);
+    }
+    *outPooled = false;
+    return (uint8_t*)malloc(capacity);
+}
+
+static void freeParcelData(uint8_t* data, size_t capacity, bool pooled) {
+    if (pooled) {
+        tParcelBufferPool.release(data, ParcelBufferPool::classOf(capacity));
+    } else {
+        free(data);
+    }
+}
+
+void Parcel::setThreadBufferPoolEnabled(bool enabled) {
+    tParcelBufferPool.setEnabled(enabled);
+}
+
+bool Parcel::isThreadBufferPoolEnabled() {
+    return tParcelBufferPool.isEnabled();
+}
+
 void Parcel::freeData()
 {
     freeDataNoInit();
@@ -2755,7 +2862,7 @@ void Parcel::freeDataNoInit()
             if (mDeallocZero) {
                 zeroMemory(mData, mDataSize);
             }
-            free(mData);
+            freeParcelData(mData, mDataCapacity, mPooledData);
         }
         auto* kernelFields = maybeKernelFields();
         if (kernelFields && kernelFields->mObjects) free(kernelFields->mObjects);
@@ -2793,6 +2900,41 @@ static uint8_t* reallocZeroFree(uint8_t* data, size_t oldCapacity, size_t newCap
     return newData;
 }
 
+// Like reallocZeroFree(), but keeps |data| in the calling thread's buffer pool if it came from
+// there or the pool is enabled. *inOutPooled tracks whether the buffer is pooled.
+static uint8_t* reallocParcelData(uint8_t* data, size_t oldCapacity, size_t newCapacity, bool zero,
+                                  bool* inOutPooled) {
+    if (*inOutPooled) {
+        // Pooled buffers are allocated with their full class size.
+        if (newCapacity > 0 &&
+            ParcelBufferPool::classOf(newCapacity) == ParcelBufferPool::classOf(oldCapacity)) {
+            return data;
+        }
+    } else if (!tParcelBufferPool.isEnabled()) {
+        return reallocZeroFree(data, oldCapacity, newCapacity, zero);
+    }
+
+    uint8_t* newData = nullptr;
+    bool newPooled = false;
+    if (newCapacity > 0) {
+        newData = allocParcelData(newCapacity, &newPooled);
+        if (!newData) {
+            return nullptr;
+        }
+    }
+    if (data) {
+        if (newData) {
+            memcpy(newData, data, std::min(oldCapacity, newCapacity));
+        }
+        if (zero) {
+            zeroMemory(data, oldCapacity);
+        }
+        freeParcelData(data, oldCapacity, *inOutPooled);
+    }
+    *inOutPooled = newPooled;
+    return newData;
+}
+
 status_t Parcel::restartWrite(size_t desired)
 {
     if (desired > INT32_MAX) {
@@ -2806,7 +2948,8 @@ status_t Parcel::restartWrite(size_t desired)
         return continueWrite(desired);
     }
 
-    uint8_t* data = reallocZeroFree(mData, mDataCapacity, desired, mDeallocZero);
+    bool pooled = mPooledData;
+    uint8_t* data = reallocParcelData(mData, mDataCapacity, desired, mDeallocZero, &pooled);
     if (!data && desired > mDataCapacity) {
         mError = NO_MEMORY;
         return NO_MEMORY;
@@ -2827,6 +2970,7 @@ status_t Parcel::restartWrite(size_t desired)
         }
         mData = data;
         mDataCapacity = desired;
+        mPooledData = pooled;
     }
 
     mDataSize = mDataPos = 0;
@@ -2892,7 +3036,8 @@ status_t Parcel::continueWrite(size_t desired)
 
         // If there is a different owner, we need to take
         // posession.
-        uint8_t* data = (uint8_t*)malloc(desired);
+        bool pooled = false;
+        uint8_t* data = allocParcelData(desired, &pooled);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -2902,7 +3047,7 @@ status_t Parcel::continueWrite(size_t desired)
         if (kernelFields && objectsSize) {
             objects = (binder_size_t*)calloc(objectsSize, sizeof(binder_size_t));
             if (!objects) {
-                free(data);
+                freeParcelData(data, desired, pooled);
 
                 mError = NO_MEMORY;
                 return NO_MEMORY;
@@ -2917,7 +3062,7 @@ status_t Parcel::continueWrite(size_t desired)
         }
         if (rpcFields) {
             if (status_t status = truncateRpcObjects(objectsSize); status != OK) {
-                free(data);
+                freeParcelData(data, desired, pooled);
                 return status;
             }
         }
@@ -2946,6 +3091,7 @@ status_t Parcel::continueWrite(size_t desired)
         mDataSize = (mDataSize < desired) ? mDataSize : desired;
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
         mDataCapacity = desired;
+        mPooledData = pooled;
         if (kernelFields) {
             kernelFields->mObjects = objects;
             kernelFields->mObjectsSize = kernelFields->mObjectsCapacity = objectsSize;
@@ -2996,7 +3142,8 @@ status_t Parcel::continueWrite(size_t desired)
 
         // We own the data, so we can just do a realloc().
         if (desired > mDataCapacity) {
-            uint8_t* data = reallocZeroFree(mData, mDataCapacity, desired, mDeallocZero);
+            uint8_t* data =
+                    reallocParcelData(mData, mDataCapacity, desired, mDeallocZero, &mPooledData);
             if (data) {
                 LOG_ALLOC("Parcel %p: continue from %zu to %zu capacity", this, mDataCapacity,
                         desired);
@@ -3021,7 +3168,8 @@ status_t Parcel::continueWrite(size_t desired)
 
     } else {
         // This is the first data.  Easy!
-        uint8_t* data = (uint8_t*)malloc(desired);
+        bool pooled = false;
+        uint8_t* data = allocParcelData(desired, &pooled);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -3044,6 +3192,7 @@ status_t Parcel::continueWrite(size_t desired)
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
         ALOGV("continueWrite Setting data pos of %p to %zu", this, mDataPos);
         mDataCapacity = desired;
+        mPooledData = pooled;
     }
 
     return NO_ERROR;
@@ -3093,6 +3242,7 @@ void Parcel::initState()
     mDeallocZero = false;
     mOwner = nullptr;
     mEnforceNoDataAvail = true;
+    mPooledData = false;
 }
 
 void Parcel::scanForFds() const {
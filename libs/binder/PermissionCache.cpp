@@ -36,42 +36,55 @@ PermissionCache::PermissionCache() {
 
 status_t PermissionCache::check(bool* granted,
         const String16& permission, uid_t uid) const {
-    Mutex::Autolock _l(mLock);
+    const Shard& shard = mShards[getShard(uid)];
+    Mutex::Autolock _l(shard.lock);
     Entry e;
     e.name = permission;
     e.uid  = uid;
-    ssize_t index = mCache.indexOf(e);
+    ssize_t index = shard.cache.indexOf(e);
     if (index >= 0) {
-        *granted = mCache.itemAt(index).granted;
-        return NO_ERROR;
+        const Entry& entry = shard.cache.itemAt(index);
+        if (systemTime() - entry.time < kCacheTimeout) {
+            *granted = entry.granted;
+            mHits.fetch_add(1, std::memory_order_relaxed);
+            return NO_ERROR;
+        }
+        mExpirations.fetch_add(1, std::memory_order_relaxed);
     }
+    mMisses.fetch_add(1, std::memory_order_relaxed);
     return NAME_NOT_FOUND;
 }
 
 void PermissionCache::cache(const String16& permission,
         uid_t uid, bool granted) {
-    Mutex::Autolock _l(mLock);
     Entry e;
-    ssize_t index = mPermissionNamesPool.indexOf(permission);
-    if (index > 0) {
-        e.name = mPermissionNamesPool.itemAt(index);
-    } else {
-        mPermissionNamesPool.add(permission);
-        e.name = permission;
+    { // scope for the pool lock
+        Mutex::Autolock _l(mLock);
+        ssize_t index = mPermissionNamesPool.indexOf(permission);
+        if (index >= 0) {
+            e.name = mPermissionNamesPool.itemAt(index);
+        } else {
+            mPermissionNamesPool.add(permission);
+            e.name = permission;
+        }
     }
     // note, we don't need to store the pid, which is not actually used in
     // permission checks
     e.uid  = uid;
     e.granted = granted;
-    index = mCache.indexOf(e);
-    if (index < 0) {
-        mCache.add(e);
-    }
+    e.time = systemTime();
+
+    Shard& shard = mShards[getShard(uid)];
+    Mutex::Autolock _l(shard.lock);
+    // replaces an expired decision
+    shard.cache.add(e);
 }
 
 void PermissionCache::purge() {
-    Mutex::Autolock _l(mLock);
-    mCache.clear();
+    for (Shard& shard : mShards) {
+        Mutex::Autolock _l(shard.lock);
+        shard.cache.clear();
+    }
 }
 
 bool PermissionCache::checkCallingPermission(const String16& permission) {
@@ -114,5 +127,11 @@ void PermissionCache::purgeCache() {
     pc.purge();
 }
 
+PermissionCache::Stats PermissionCache::getStats() {
+    const PermissionCache& pc(PermissionCache::getInstance());
+    return {pc.mHits.load(std::memory_order_relaxed), pc.mMisses.load(std::memory_order_relaxed),
+            pc.mExpirations.load(std::memory_order_relaxed)};
+}
+
 // ---------------------------------------------------------------------------
 } // namespace android
@@ -36,6 +36,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -49,6 +50,8 @@
 #define BINDER_VM_SIZE ((1 * 1024 * 1024) - sysconf(_SC_PAGE_SIZE) * 2)
 #define DEFAULT_MAX_BINDER_THREADS 15
 #define DEFAULT_ENABLE_ONEWAY_SPAM_DETECTION 1
+// Starvation longer than this makes the adaptive thread pool grow
+#define ADAPTIVE_GROW_STARVATION_MS 5
 
 #ifdef __ANDROID_VNDK__
 const char* kDefaultDriver = "/dev/vndbinder";
@@ -429,6 +432,75 @@ status_t ProcessState::setThreadPoolMaxThreadCount(size_t maxThreads) {
     return result;
 }
 
+status_t ProcessState::enableAdaptiveThreadPool(size_t maxThreads,
+                                                std::chrono::milliseconds idleTimeout) {
+    LOG_ALWAYS_FATAL_IF(mThreadPoolStarted,
+                        "Adaptive threadpool must be enabled before starting the threadpool");
+    if (maxThreads < mMaxThreads || idleTimeout.count() <= 0) {
+        ALOGE("Invalid adaptive threadpool config: %zu max threads (currently %zu), %lld ms",
+              maxThreads, mMaxThreads, static_cast<long long>(idleTimeout.count()));
+        return BAD_VALUE;
+    }
+    pthread_mutex_lock(&mThreadCountLock);
+    mAdaptiveMaxThreads = maxThreads;
+    mIdleTimeoutMs = idleTimeout.count();
+    pthread_mutex_unlock(&mThreadCountLock);
+    return NO_ERROR;
+}
+
+void ProcessState::onStarvationEndedLocked(int64_t starvationTimeMs) {
+    mTotalStarvationTimeMs += starvationTimeMs;
+    if (starvationTimeMs < ADAPTIVE_GROW_STARVATION_MS || mMaxThreads >= mAdaptiveMaxThreads) {
+        return;
+    }
+    mMaxThreads++;
+    if (updateDriverMaxThreadsLocked() != NO_ERROR) {
+        mMaxThreads--;
+        return;
+    }
+    ALOGI("binder thread pool starved for %" PRId64 " ms, growing to %zu threads",
+          starvationTimeMs, mMaxThreads);
+}
+
+bool ProcessState::shouldRetireThreadLocked(int64_t idleTimeMs) {
+    if (mIdleTimeoutMs == 0 || idleTimeMs < mIdleTimeoutMs) return false;
+    // Only leave if another thread is still waiting for work.
+    if (mCurrentThreads - mExecutingThreadsCount < 2) return false;
+    mRetiredThreads++;
+    if (updateDriverMaxThreadsLocked() != NO_ERROR) {
+        mRetiredThreads--;
+        return false;
+    }
+    return true;
+}
+
+status_t ProcessState::updateDriverMaxThreadsLocked() {
+    // The driver counts the threads it asked to start over the lifetime of the process, not the
+    // threads that are still running, so retired threads are added to its limit.
+    uint32_t driverMaxThreads = static_cast<uint32_t>(mMaxThreads + mRetiredThreads);
+    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &driverMaxThreads) == -1) {
+        status_t result = -errno;
+        ALOGE("Binder ioctl to set max threads failed: %s", strerror(-result));
+        return result;
+    }
+    return NO_ERROR;
+}
+
+ProcessState::ThreadPoolStats ProcessState::getThreadPoolStats() const {
+    pthread_mutex_lock(&mThreadCountLock);
+    ThreadPoolStats stats = {
+            .maxThreads = mMaxThreads,
+            .currentThreads = mCurrentThreads,
+            .executingThreads = mExecutingThreadsCount,
+            .peakExecutingThreads = mPeakExecutingThreadsCount,
+            .retiredThreads = mRetiredThreads,
+            .commands = mExecutedCommands,
+            .starvationTimeMs = mTotalStarvationTimeMs,
+    };
+    pthread_mutex_unlock(&mThreadCountLock);
+    return stats;
+}
+
 size_t ProcessState::getThreadPoolMaxTotalThreadCount() const {
     pthread_mutex_lock(&mThreadCountLock);
     base::ScopeGuard detachGuard = [&]() { pthread_mutex_unlock(&mThreadCountLock); };
@@ -538,6 +610,12 @@ ProcessState::ProcessState(const char* driver)
         mCurrentThreads(0),
         mKernelStartedThreads(0),
         mStarvationStartTimeMs(0),
+        mPeakExecutingThreadsCount(0),
+        mExecutedCommands(0),
+        mTotalStarvationTimeMs(0),
+        mAdaptiveMaxThreads(0),
+        mIdleTimeoutMs(0),
+        mRetiredThreads(0),
         mForked(false),
         mThreadPoolStarted(false),
         mThreadPoolSeq(1),
@@ -112,22 +112,37 @@ RecordedTransaction::RecordedTransaction(RecordedTransaction&& t) noexcept {
     mReply.setData(t.getReplyParcel().data(), t.getReplyParcel().dataSize());
 }
 
+RecordedTransaction::TransactionHeader RecordedTransaction::makeHeader(uint32_t code,
+                                                                       uint32_t flags,
+                                                                       timespec timestamp,
+                                                                       const Parcel& dataParcel,
+                                                                       status_t err) {
+    return {code,
+            flags,
+            static_cast<int32_t>(err),
+            dataParcel.isForRpc() ? static_cast<uint32_t>(1) : static_cast<uint32_t>(0),
+            static_cast<int64_t>(timestamp.tv_sec),
+            static_cast<int32_t>(timestamp.tv_nsec),
+            0};
+}
+
+static bool toInterfaceName(const android::String16& interfaceName, std::string* out) {
+    *out = std::string(android::String8(interfaceName).string());
+    if (interfaceName.size() != out->size()) {
+        LOG(ERROR) << "Interface Name is not valid. Contains characters that aren't single byte "
+                      "utf-8.";
+        return false;
+    }
+    return true;
+}
+
 std::optional<RecordedTransaction> RecordedTransaction::fromDetails(
         const String16& interfaceName, uint32_t code, uint32_t flags, timespec timestamp,
         const Parcel& dataParcel, const Parcel& replyParcel, status_t err) {
     RecordedTransaction t;
-    t.mData.mHeader = {code,
-                       flags,
-                       static_cast<int32_t>(err),
-                       dataParcel.isForRpc() ? static_cast<uint32_t>(1) : static_cast<uint32_t>(0),
-                       static_cast<int64_t>(timestamp.tv_sec),
-                       static_cast<int32_t>(timestamp.tv_nsec),
-                       0};
-
-    t.mData.mInterfaceName = std::string(String8(interfaceName).string());
-    if (interfaceName.size() != t.mData.mInterfaceName.size()) {
-        LOG(ERROR) << "Interface Name is not valid. Contains characters that aren't single byte "
-                      "utf-8.";
+    t.mData.mHeader = makeHeader(code, flags, timestamp, dataParcel, err);
+
+    if (!toInterfaceName(interfaceName, &t.mData.mInterfaceName)) {
         return std::nullopt;
     }
 
@@ -297,11 +312,11 @@ std::optional<RecordedTransaction> RecordedTransaction::fromFile(const unique_fd
     return std::optional<RecordedTransaction>(std::move(t));
 }
 
-android::status_t RecordedTransaction::writeChunk(borrowed_fd fd, uint32_t chunkType,
-                                                  size_t byteCount, const uint8_t* data) const {
+static android::status_t appendChunk(std::vector<std::byte>* buffer, uint32_t chunkType,
+                                     size_t byteCount, const uint8_t* data) {
     if (byteCount > kMaxChunkDataSize) {
         LOG(ERROR) << "Chunk data exceeds maximum size";
-        return BAD_VALUE;
+        return android::BAD_VALUE;
     }
     ChunkDescriptor descriptor = {.chunkType = chunkType,
                                   .dataSize = static_cast<uint32_t>(byteCount)};
@@ -309,56 +324,91 @@ android::status_t RecordedTransaction::writeChunk(borrowed_fd fd, uint32_t chunk
     const std::byte* descriptorBytes = reinterpret_cast<const std::byte*>(&descriptor);
     const std::byte* dataBytes = reinterpret_cast<const std::byte*>(data);
 
-    // Add Chunk to intermediate buffer, except checksum
-    std::vector<std::byte> buffer;
-    buffer.insert(buffer.end(), descriptorBytes, descriptorBytes + sizeof(ChunkDescriptor));
-    buffer.insert(buffer.end(), dataBytes, dataBytes + byteCount);
+    // Add Chunk to buffer, except checksum
+    const size_t chunkStart = buffer->size();
+    buffer->insert(buffer->end(), descriptorBytes, descriptorBytes + sizeof(ChunkDescriptor));
+    buffer->insert(buffer->end(), dataBytes, dataBytes + byteCount);
     std::byte zero{0};
-    buffer.insert(buffer.end(), PADDING8(byteCount), zero);
+    buffer->insert(buffer->end(), PADDING8(byteCount), zero);
 
-    // Calculate checksum from buffer
-    transaction_checksum_t* checksumData = reinterpret_cast<transaction_checksum_t*>(buffer.data());
+    // Calculate checksum from buffer. Chunks are multiples of 8 bytes, so they all start aligned.
+    const transaction_checksum_t* checksumData =
+            reinterpret_cast<const transaction_checksum_t*>(buffer->data() + chunkStart);
     transaction_checksum_t checksumValue = 0;
-    for (size_t idx = 0; idx < (buffer.size() / sizeof(transaction_checksum_t)); idx++) {
+    for (size_t idx = 0; idx < ((buffer->size() - chunkStart) / sizeof(transaction_checksum_t));
+         idx++) {
         checksumValue ^= checksumData[idx];
     }
 
     // Write checksum to buffer
     std::byte* checksumBytes = reinterpret_cast<std::byte*>(&checksumValue);
-    buffer.insert(buffer.end(), checksumBytes, checksumBytes + sizeof(transaction_checksum_t));
-
-    // Write buffer to file
-    if (!android::base::WriteFully(fd, buffer.data(), buffer.size())) {
-        LOG(ERROR) << "Failed to write chunk fd " << fd.get();
-        return UNKNOWN_ERROR;
-    }
-    return NO_ERROR;
+    buffer->insert(buffer->end(), checksumBytes, checksumBytes + sizeof(transaction_checksum_t));
+    return android::NO_ERROR;
 }
 
-android::status_t RecordedTransaction::dumpToFile(const unique_fd& fd) const {
+android::status_t RecordedTransaction::appendTransaction(const TransactionHeader& header,
+                                                         const std::string& interfaceName,
+                                                         const Parcel& sent, const Parcel& reply,
+                                                         std::vector<std::byte>* buffer) {
+    // Every chunk adds a descriptor and a checksum, and pads its data to 8 bytes.
+    constexpr size_t kChunkOverhead = sizeof(ChunkDescriptor) + sizeof(transaction_checksum_t) + 7;
+    buffer->reserve(buffer->size() + 5 * kChunkOverhead + sizeof(TransactionHeader) +
+                    interfaceName.size() + sent.dataBufferSize() + reply.dataBufferSize());
+
     if (NO_ERROR !=
-        writeChunk(fd, HEADER_CHUNK, sizeof(TransactionHeader),
-                   reinterpret_cast<const uint8_t*>(&(mData.mHeader)))) {
-        LOG(ERROR) << "Failed to write transactionHeader to fd " << fd.get();
+        appendChunk(buffer, HEADER_CHUNK, sizeof(TransactionHeader),
+                    reinterpret_cast<const uint8_t*>(&header))) {
+        LOG(ERROR) << "Failed to write transactionHeader";
         return UNKNOWN_ERROR;
     }
     if (NO_ERROR !=
-        writeChunk(fd, INTERFACE_NAME_CHUNK, mData.mInterfaceName.size() * sizeof(uint8_t),
-                   reinterpret_cast<const uint8_t*>(mData.mInterfaceName.c_str()))) {
-        LOG(INFO) << "Failed to write Interface Name Chunk to fd " << fd.get();
+        appendChunk(buffer, INTERFACE_NAME_CHUNK, interfaceName.size() * sizeof(uint8_t),
+                    reinterpret_cast<const uint8_t*>(interfaceName.c_str()))) {
+        LOG(INFO) << "Failed to write Interface Name Chunk";
         return UNKNOWN_ERROR;
     }
 
-    if (NO_ERROR != writeChunk(fd, DATA_PARCEL_CHUNK, mSent.dataBufferSize(), mSent.data())) {
-        LOG(ERROR) << "Failed to write sent Parcel to fd " << fd.get();
+    if (NO_ERROR != appendChunk(buffer, DATA_PARCEL_CHUNK, sent.dataBufferSize(), sent.data())) {
+        LOG(ERROR) << "Failed to write sent Parcel";
         return UNKNOWN_ERROR;
     }
-    if (NO_ERROR != writeChunk(fd, REPLY_PARCEL_CHUNK, mReply.dataBufferSize(), mReply.data())) {
-        LOG(ERROR) << "Failed to write reply Parcel to fd " << fd.get();
+    if (NO_ERROR != appendChunk(buffer, REPLY_PARCEL_CHUNK, reply.dataBufferSize(), reply.data())) {
+        LOG(ERROR) << "Failed to write reply Parcel";
+        return UNKNOWN_ERROR;
+    }
+    if (NO_ERROR != appendChunk(buffer, END_CHUNK, 0, NULL)) {
+        LOG(ERROR) << "Failed to write end chunk";
+        return UNKNOWN_ERROR;
+    }
+    return NO_ERROR;
+}
+
+android::status_t RecordedTransaction::encode(const String16& interfaceName, uint32_t code,
+                                              uint32_t flags, timespec timestamp,
+                                              const Parcel& data, const Parcel& reply,
+                                              status_t err, std::vector<std::byte>* buffer) {
+    std::string name;
+    if (!toInterfaceName(interfaceName, &name)) {
+        return BAD_VALUE;
+    }
+    const size_t start = buffer->size();
+    if (status_t status = appendTransaction(makeHeader(code, flags, timestamp, data, err), name,
+                                            data, reply, buffer);
+        status != NO_ERROR) {
+        buffer->resize(start);
+        return status;
+    }
+    return NO_ERROR;
+}
+
+android::status_t RecordedTransaction::dumpToFile(const unique_fd& fd) const {
+    std::vector<std::byte> buffer;
+    if (NO_ERROR != appendTransaction(mData.mHeader, mData.mInterfaceName, mSent, mReply, &buffer)) {
+        LOG(ERROR) << "Failed to encode transaction for fd " << fd.get();
         return UNKNOWN_ERROR;
     }
-    if (NO_ERROR != writeChunk(fd, END_CHUNK, 0, NULL)) {
-        LOG(ERROR) << "Failed to write end chunk to fd " << fd.get();
+    if (!android::base::WriteFully(fd, buffer.data(), buffer.size())) {
+        LOG(ERROR) << "Failed to write transaction to fd " << fd.get();
         return UNKNOWN_ERROR;
     }
     return NO_ERROR;
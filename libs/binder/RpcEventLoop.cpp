@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RpcEventLoop"
+
+#include "RpcEventLoop.h"
+
+#include <inttypes.h>
+
+#ifndef BINDER_RPC_SINGLE_THREADED
+#include <sys/epoll.h>
+#endif
+
+#include <log/log.h>
+
+#include "FdTrigger.h"
+#include "RpcState.h"
+
+namespace android {
+
+#ifndef BINDER_RPC_SINGLE_THREADED
+
+// epoll data of the shutdown trigger of the loop. Connections and sessions
+// have IDs from 1, which are never reused.
+constexpr uint64_t kShutdownId = 0;
+constexpr int kMaxEvents = 64;
+
+std::unique_ptr<RpcEventLoop> RpcEventLoop::make(size_t workerThreads) {
+    LOG_ALWAYS_FATAL_IF(workerThreads == 0, "RpcEventLoop is useless without threads");
+
+    std::unique_ptr<RpcEventLoop> loop(new RpcEventLoop());
+    loop->mEpollFd.reset(epoll_create1(EPOLL_CLOEXEC));
+    if (!loop->mEpollFd.ok()) {
+        ALOGE("Could not create epoll set: %s", strerror(errno));
+        return nullptr;
+    }
+
+    loop->mShutdownTrigger = FdTrigger::make();
+    if (loop->mShutdownTrigger == nullptr) return nullptr;
+
+    epoll_event event{.events = EPOLLIN, .data = {.u64 = kShutdownId}};
+    if (epoll_ctl(loop->mEpollFd.get(), EPOLL_CTL_ADD, loop->mShutdownTrigger->pollFd().get(),
+                  &event) != 0) {
+        ALOGE("Could not watch shutdown trigger: %s", strerror(errno));
+        return nullptr;
+    }
+
+    RpcEventLoop* loopPtr = loop.get();
+    loop->mThreads.emplace_back([loopPtr] { loopPtr->pollLoop(); });
+    for (size_t i = 0; i < workerThreads; i++) {
+        loop->mThreads.emplace_back(
+                [loopPtr] { RpcSession::runEventLoopThread([loopPtr] { loopPtr->workerLoop(); }); });
+    }
+    return loop;
+}
+
+RpcEventLoop::~RpcEventLoop() {
+    {
+        RpcMutexLockGuard _l(mLock);
+        mShuttingDown = true;
+    }
+    mShutdownTrigger->trigger();
+    mReadyCv.notify_all();
+
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+status_t RpcEventLoop::addConnection(const sp<RpcSession>& session,
+                                     const sp<RpcSession::RpcConnection>& connection, int fd) {
+    RpcMutexLockGuard _l(mLock);
+
+    uint64_t sessionId;
+    if (auto it = mSessionIds.find(session.get()); it != mSessionIds.end()) {
+        sessionId = it->second;
+    } else {
+        sessionId = mNextId++;
+        // Without this, a parked connection would only notice that its session
+        // is shut down once the client sends something.
+        epoll_event event{.events = EPOLLIN, .data = {.u64 = sessionId}};
+        if (epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, session->mShutdownTrigger->pollFd().get(),
+                      &event) != 0) {
+            int savedErrno = errno;
+            ALOGE("Could not watch session shutdown trigger: %s", strerror(savedErrno));
+            return -savedErrno;
+        }
+        mSessionIds[session.get()] = sessionId;
+        mSessions[sessionId].session = session;
+    }
+    Session& parent = mSessions.at(sessionId);
+
+    uint64_t connectionId = mNextId++;
+    epoll_event event{.events = EPOLLIN | EPOLLONESHOT, .data = {.u64 = connectionId}};
+    if (epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, fd, &event) != 0) {
+        int savedErrno = errno;
+        ALOGE("Could not watch connection fd %d: %s", fd, strerror(savedErrno));
+        if (parent.connectionIds.empty()) {
+            if (!parent.triggered) {
+                (void)epoll_ctl(mEpollFd.get(), EPOLL_CTL_DEL,
+                                session->mShutdownTrigger->pollFd().get(), nullptr);
+            }
+            mSessionIds.erase(session.get());
+            mSessions.erase(sessionId);
+        }
+        return -savedErrno;
+    }
+
+    parent.connectionIds.insert(connectionId);
+    Connection& added = mConnections[connectionId] = Connection{
+            .sessionId = sessionId,
+            .connection = connection,
+            .fd = fd,
+            .parked = true,
+    };
+    // RpcSession::preJoinSetup assigned the connection to the connecting
+    // thread, which is about to exit.
+    session->clearConnectionTid(connection);
+
+    if (parent.triggered) queueLocked(connectionId, added);
+    return OK;
+}
+
+void RpcEventLoop::queueLocked(uint64_t connectionId, Connection& connection) {
+    connection.parked = false;
+    mReady.push_back(connectionId);
+    mReadyCv.notify_one();
+}
+
+void RpcEventLoop::pollLoop() {
+    epoll_event events[kMaxEvents];
+    while (true) {
+        int count = TEMP_FAILURE_RETRY(epoll_wait(mEpollFd.get(), events, kMaxEvents, -1));
+        LOG_ALWAYS_FATAL_IF(count < 0, "epoll_wait failed: %s", strerror(errno));
+
+        RpcMutexLockGuard _l(mLock);
+        for (int i = 0; i < count; i++) {
+            uint64_t id = events[i].data.u64;
+            if (id == kShutdownId) return;
+
+            if (auto it = mConnections.find(id); it != mConnections.end()) {
+                // Not parked if the session was shut down in the meantime,
+                // which queued the connection already.
+                if (it->second.parked) queueLocked(id, it->second);
+            } else if (auto it = mSessions.find(id); it != mSessions.end()) {
+                // The trigger stays signaled, so stop watching it, and serve
+                // the connections of the session until they fail.
+                Session& session = it->second;
+                session.triggered = true;
+                (void)epoll_ctl(mEpollFd.get(), EPOLL_CTL_DEL,
+                                session.session->mShutdownTrigger->pollFd().get(), nullptr);
+                for (uint64_t connectionId : session.connectionIds) {
+                    Connection& connection = mConnections.at(connectionId);
+                    if (connection.parked) queueLocked(connectionId, connection);
+                }
+            }
+            // Otherwise, the connection or session ended after the event.
+        }
+    }
+}
+
+void RpcEventLoop::workerLoop() {
+    while (true) {
+        uint64_t connectionId;
+        sp<RpcSession> session;
+        sp<RpcSession::RpcConnection> connection;
+        {
+            RpcMutexUniqueLock _l(mLock);
+            mReadyCv.wait(_l, [this] { return mShuttingDown || !mReady.empty(); });
+            if (mShuttingDown) return;
+
+            connectionId = mReady.front();
+            mReady.pop_front();
+            const Connection& ready = mConnections.at(connectionId);
+            session = mSessions.at(ready.sessionId).session;
+            connection = ready.connection;
+        }
+
+        status_t status = RpcSession::serveIncomingCommand(session, connection);
+        if (status == OK) {
+            // The transport may have read ahead, e.g. a whole TLS record, which
+            // epoll can't see.
+            status = connection->rpcTransport->pollRead();
+            if (status == OK) {
+                // To the back of the queue, so a busy connection can't starve
+                // the others.
+                RpcMutexLockGuard _l(mLock);
+                queueLocked(connectionId, mConnections.at(connectionId));
+                continue;
+            }
+            if (status == WOULD_BLOCK) {
+                parkConnection(connectionId);
+                continue;
+            }
+        }
+
+        LOG_RPC_DETAIL("Binder connection closing w/ status %s", statusToString(status).c_str());
+        removeConnection(connectionId);
+        RpcSession::endIncomingConnection(std::move(session), connection);
+    }
+}
+
+void RpcEventLoop::parkConnection(uint64_t connectionId) {
+    RpcMutexLockGuard _l(mLock);
+    Connection& connection = mConnections.at(connectionId);
+    if (mSessions.at(connection.sessionId).triggered) {
+        queueLocked(connectionId, connection);
+        return;
+    }
+
+    connection.parked = true;
+    epoll_event event{.events = EPOLLIN | EPOLLONESHOT, .data = {.u64 = connectionId}};
+    LOG_ALWAYS_FATAL_IF(epoll_ctl(mEpollFd.get(), EPOLL_CTL_MOD, connection.fd, &event) != 0,
+                        "Could not park connection fd %d: %s", connection.fd, strerror(errno));
+}
+
+void RpcEventLoop::removeConnection(uint64_t connectionId) {
+    RpcMutexLockGuard _l(mLock);
+    auto it = mConnections.find(connectionId);
+    LOG_ALWAYS_FATAL_IF(it == mConnections.end(), "Unknown connection %" PRIu64, connectionId);
+
+    // This must happen before the transport closes the fd.
+    (void)epoll_ctl(mEpollFd.get(), EPOLL_CTL_DEL, it->second.fd, nullptr);
+
+    auto sessionIt = mSessions.find(it->second.sessionId);
+    mConnections.erase(it);
+
+    Session& session = sessionIt->second;
+    session.connectionIds.erase(connectionId);
+    if (session.connectionIds.empty()) {
+        if (!session.triggered) {
+            (void)epoll_ctl(mEpollFd.get(), EPOLL_CTL_DEL,
+                            session.session->mShutdownTrigger->pollFd().get(), nullptr);
+        }
+        mSessionIds.erase(session.session.get());
+        mSessions.erase(sessionIt);
+    }
+}
+
+#else // BINDER_RPC_SINGLE_THREADED
+
+std::unique_ptr<RpcEventLoop> RpcEventLoop::make(size_t) {
+    return nullptr;
+}
+
+RpcEventLoop::~RpcEventLoop() {}
+
+status_t RpcEventLoop::addConnection(const sp<RpcSession>&, const sp<RpcSession::RpcConnection>&,
+                                     int) {
+    LOG_ALWAYS_FATAL("RpcEventLoop is not supported on single-threaded libbinder");
+    return INVALID_OPERATION;
+}
+
+#endif // BINDER_RPC_SINGLE_THREADED
+
+} // namespace android
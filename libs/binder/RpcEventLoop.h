@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <android-base/unique_fd.h>
+#include <binder/RpcSession.h>
+#include <binder/RpcThreads.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+class FdTrigger;
+
+/**
+ * Serves the incoming connections of RpcServer sessions from a fixed pool of
+ * worker threads, instead of a thread per connection.
+ *
+ * Idle connections are parked in an epoll set, and a connection is only
+ * handed to a worker once it is readable. The worker processes one command,
+ * and parks the connection again. A connection is in the epoll set with
+ * EPOLLONESHOT, so at most one worker serves it at any time, and its commands
+ * are processed in order, exactly as by a dedicated thread. Ordering across
+ * the connections of a session is left to RpcState, as before.
+ *
+ * A worker is busy for the whole duration of a transaction, including nested
+ * calls back to the client, so the pool must be at least as large as the
+ * number of transactions that may block at the same time.
+ *
+ * Not available in single-threaded builds, where make() returns nullptr.
+ */
+class RpcEventLoop {
+public:
+    static std::unique_ptr<RpcEventLoop> make(size_t workerThreads);
+
+    /**
+     * Stops and joins the threads. Connections still being served are dropped
+     * without being ended, so RpcServer only destroys the loop after all of its
+     * sessions ended.
+     */
+    ~RpcEventLoop();
+
+    /**
+     * Takes over a connection, once RpcSession::preJoinSetup succeeded for it
+     * on the connecting thread. fd is the socket of its transport. If this
+     * fails, the caller still owns the connection.
+     */
+    [[nodiscard]] status_t addConnection(const sp<RpcSession>& session,
+                                         const sp<RpcSession::RpcConnection>& connection,
+                                         int fd);
+
+private:
+#ifndef BINDER_RPC_SINGLE_THREADED
+    // Sessions and connections are referred to by ID from the epoll set, so
+    // that events for ones that are gone already can be told apart.
+    struct Connection {
+        uint64_t sessionId;
+        sp<RpcSession::RpcConnection> connection;
+        int fd;
+        // Whether the connection is waiting in the epoll set, rather than
+        // queued or being served.
+        bool parked;
+    };
+    struct Session {
+        sp<RpcSession> session;
+        std::set<uint64_t> connectionIds;
+        // The shutdown trigger of the session fired, so its connections are
+        // served until they fail instead of being parked.
+        bool triggered = false;
+    };
+
+    RpcEventLoop() = default;
+
+    void pollLoop();
+    void workerLoop();
+    // Requires mLock.
+    void queueLocked(uint64_t connectionId, Connection& connection);
+    void parkConnection(uint64_t connectionId);
+    void removeConnection(uint64_t connectionId);
+
+    base::unique_fd mEpollFd;
+    std::unique_ptr<FdTrigger> mShutdownTrigger;
+    std::vector<RpcMaybeThread> mThreads;
+
+    RpcMutex mLock; // for below
+    RpcConditionVariable mReadyCv;
+    bool mShuttingDown = false;
+    uint64_t mNextId = 1;
+    std::map<uint64_t, Connection> mConnections;
+    std::map<uint64_t, Session> mSessions;
+    std::map<const RpcSession*, uint64_t> mSessionIds;
+    std::deque<uint64_t> mReady;
+#endif // BINDER_RPC_SINGLE_THREADED
+};
+
+} // namespace android
@@ -34,6 +34,7 @@
 
 #include "BuildFlags.h"
 #include "FdTrigger.h"
+#include "RpcEventLoop.h"
 #include "OS.h"
 #include "RpcSocketAddress.h"
 #include "RpcState.h"
@@ -123,6 +124,13 @@ size_t RpcServer::getMaxThreads() {
     return mMaxThreads;
 }
 
+void RpcServer::setEventLoopThreads(size_t threads) {
+    LOG_ALWAYS_FATAL_IF(!kEnableRpcThreads && threads > 0,
+                        "Event loop is not supported on single-threaded libbinder");
+    LOG_ALWAYS_FATAL_IF(mJoinThreadRunning, "Cannot set event loop threads while running");
+    mEventLoopThreads = threads;
+}
+
 void RpcServer::setProtocolVersion(uint32_t version) {
     mProtocolVersion = version;
 }
@@ -238,6 +246,10 @@ void RpcServer::join() {
         mJoinThreadRunning = true;
         mShutdownTrigger = FdTrigger::make();
         LOG_ALWAYS_FATAL_IF(mShutdownTrigger == nullptr, "Cannot create join signaler");
+        if (mEventLoopThreads > 0) {
+            mEventLoop = RpcEventLoop::make(mEventLoopThreads);
+            LOG_ALWAYS_FATAL_IF(mEventLoop == nullptr, "Cannot create event loop");
+        }
     }
 
     status_t status;
@@ -338,6 +350,12 @@ bool RpcServer::shutdown() {
     LOG_RPC_DETAIL("Finished waiting on shutdown.");
 
     mShutdownTrigger = nullptr;
+
+    // All sessions ended, so its threads are idle. They may still be returning
+    // from the callbacks of the last session though, so join them unlocked.
+    std::unique_ptr<RpcEventLoop> eventLoop = std::move(mEventLoop);
+    _l.unlock();
+    eventLoop.reset();
     return true;
 }
 
@@ -367,14 +385,14 @@ void RpcServer::establishConnection(
 
     status_t status = OK;
 
-    int clientFdForLog = clientFd.fd.get();
+    int clientFdNum = clientFd.fd.get();
     auto client = server->mCtx->newTransport(std::move(clientFd), server->mShutdownTrigger.get());
     if (client == nullptr) {
         ALOGE("Dropping accept4()-ed socket because sslAccept fails");
         status = DEAD_OBJECT;
         // still need to cleanup before we can return
     } else {
-        LOG_RPC_DETAIL("Created RpcTransport %p for client fd %d", client.get(), clientFdForLog);
+        LOG_RPC_DETAIL("Created RpcTransport %p for client fd %d", client.get(), clientFdNum);
     }
 
     RpcConnectionHeader header;
@@ -437,6 +455,7 @@ void RpcServer::establishConnection(
 
     RpcMaybeThread thisThread;
     sp<RpcSession> session;
+    RpcEventLoop* eventLoop = nullptr;
     {
         RpcMutexUniqueLock _l(server->mLock);
 
@@ -533,12 +552,30 @@ void RpcServer::establishConnection(
             return;
         }
 
-        detachGuard.Disable();
-        session->preJoinThreadOwnership(std::move(thisThread));
+        eventLoop = server->mEventLoop.get();
+        if (eventLoop == nullptr) {
+            detachGuard.Disable();
+            session->preJoinThreadOwnership(std::move(thisThread));
+        }
     }
 
     auto setupResult = session->preJoinSetup(std::move(client));
 
+    if (eventLoop != nullptr) {
+        // This thread is detached already. The event loop outlives the session,
+        // which can't end before the connection is removed from it.
+        if (setupResult.status == OK) {
+            setupResult.status =
+                    eventLoop->addConnection(session, setupResult.connection, clientFdNum);
+        }
+        if (setupResult.status != OK) {
+            ALOGE("Connection failed to init, closing with status %s",
+                  statusToString(setupResult.status).c_str());
+            RpcSession::endIncomingConnection(std::move(session), setupResult.connection);
+        }
+        return;
+    }
+
     // avoid strong cycle
     server = nullptr;
 
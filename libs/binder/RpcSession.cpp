@@ -475,6 +475,51 @@ void RpcSession::join(sp<RpcSession>&& session, PreJoinSetupResult&& setupResult
     }
 }
 
+void RpcSession::runEventLoopThread(const std::function<void()>& loop) {
+    [[maybe_unused]] JavaThreadAttacher javaThreadAttacher;
+    loop();
+}
+
+status_t RpcSession::serveIncomingCommand(const sp<RpcSession>& session,
+                                          const sp<RpcConnection>& connection) {
+    // Nested calls made while processing the command find the connection by
+    // the thread serving it, see ExclusiveConnection::find.
+    {
+        RpcMutexLockGuard _l(session->mMutex);
+        connection->exclusiveTid = rpcGetThreadId();
+    }
+    status_t status =
+            session->state()->getAndExecuteCommand(connection, session, RpcState::CommandType::ANY);
+    {
+        // Incoming connections are never handed out as available, so there is
+        // no waiting thread to notify, unlike clearConnectionTid.
+        RpcMutexLockGuard _l(session->mMutex);
+        connection->exclusiveTid = std::nullopt;
+    }
+    return status;
+}
+
+void RpcSession::endIncomingConnection(sp<RpcSession>&& session,
+                                       const sp<RpcConnection>& connection) {
+    sp<RpcSession::EventListener> listener;
+    {
+        RpcMutexLockGuard _l(session->mMutex);
+        listener = session->mEventListener.promote();
+    }
+
+    // done after all cleanup, since session shutdown progresses via callbacks here
+    if (connection != nullptr) {
+        LOG_ALWAYS_FATAL_IF(!session->removeIncomingConnection(connection),
+                            "bad state: connection object guaranteed to be in list");
+    }
+
+    session = nullptr;
+
+    if (listener != nullptr) {
+        listener->onSessionIncomingThreadEnded();
+    }
+}
+
 sp<RpcServer> RpcSession::server() {
     RpcServer* unsafeServer = mForServer.unsafe_get();
     sp<RpcServer> server = mForServer.promote();
@@ -19,6 +19,8 @@
 
 #include <poll.h>
 
+#include <mutex>
+
 #include <openssl/bn.h>
 #include <openssl/ssl.h>
 
@@ -450,6 +452,8 @@ public:
 
 protected:
     static ssl_verify_result_t sslCustomVerify(SSL* ssl, uint8_t* outAlert);
+    // Called by create() with the SSL_CTX that is about to be owned by this object.
+    virtual void configureCtx(SSL_CTX*) {}
     virtual void preHandshake(Ssl* ssl) const = 0;
     bssl::UniquePtr<SSL_CTX> mCtx;
     std::shared_ptr<RpcCertificateVerifier> mCertVerifier;
@@ -510,6 +514,7 @@ std::unique_ptr<RpcTransportCtxTls> RpcTransportCtxTls::create(
     auto ret = std::make_unique<Impl>();
     // RpcTransportCtxTls* -> void*
     TEST_AND_RETURN(nullptr, SSL_CTX_set_app_data(ctx.get(), reinterpret_cast<void*>(ret.get())));
+    ret->configureCtx(ctx.get());
     ret->mCtx = std::move(ctx);
     ret->mCertVerifier = std::move(verifier);
     return ret;
@@ -533,11 +538,52 @@ protected:
     }
 };
 
+// A client context belongs to a single RpcSession. It keeps the last session ticket that the server
+// sent, so that the other connections of the RpcSession resume the TLS session instead of doing a
+// full handshake. A resumed handshake does not call sslCustomVerify() again; the ticket can only be
+// used with the server whose certificate was verified when the ticket was issued.
+//
+// TLS 1.3 tickets should be single use so that connections can't be linked to each other. This
+// doesn't matter here, because all connections of an RpcSession carry the same session ID anyway.
 class RpcTransportCtxTlsClient : public RpcTransportCtxTls {
 protected:
+    void configureCtx(SSL_CTX* ctx) override {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL);
+        SSL_CTX_sess_set_new_cb(ctx, onNewSession);
+    }
+
     void preHandshake(Ssl* ssl) const override {
         ssl->call(SSL_set_connect_state).errorQueue.clear();
+
+        std::lock_guard<std::mutex> _l(mSessionMutex);
+        if (mSession == nullptr) return;
+        auto [ret, errorQueue] = ssl->call(SSL_set_session, mSession.get());
+        if (ret != 1) {
+            // Not fatal, the handshake is just a full one.
+            ALOGW("SSL_set_session(): %s", errorQueue.toString().c_str());
+            return;
+        }
+        errorQueue.clear();
     }
+
+private:
+    // Called when a ticket is received, which in TLS 1.3 happens after the handshake, from
+    // within SSL_read(). Takes ownership of |session| by returning 1.
+    static int onNewSession(SSL* ssl, SSL_SESSION* session) {
+        auto ctx = SSL_get_SSL_CTX(ssl); // Does not set error queue
+        LOG_ALWAYS_FATAL_IF(ctx == nullptr);
+        // void* -> RpcTransportCtxTlsClient*
+        auto client = reinterpret_cast<RpcTransportCtxTlsClient*>(SSL_CTX_get_app_data(ctx));
+        LOG_ALWAYS_FATAL_IF(client == nullptr);
+
+        LOG_TLS_DETAIL("Client: Received session ticket.");
+        std::lock_guard<std::mutex> _l(client->mSessionMutex);
+        client->mSession.reset(session);
+        return 1;
+    }
+
+    mutable std::mutex mSessionMutex;
+    bssl::UniquePtr<SSL_SESSION> mSession; // guarded by mSessionMutex
 };
 
 } // namespace
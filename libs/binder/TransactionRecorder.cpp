@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TransactionRecorder.h"
+
+#include <limits.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+
+using android::base::borrowed_fd;
+using android::base::unique_fd;
+
+namespace android::binder::debug {
+
+namespace {
+
+/**
+ * A bounded multi-producer, single-consumer ring of encoded transactions, shared by all the async
+ * recordings of the process. Binder threads only copy the transaction into the ring, and a
+ * background thread writes out whatever has been queued in batches.
+ */
+class AsyncWriter {
+public:
+    static AsyncWriter& get() {
+        static AsyncWriter* writer = new AsyncWriter();
+        return *writer;
+    }
+
+    // Starts the writer thread for the first user, and stops it after the last one.
+    void acquire();
+    void release();
+
+    // Never blocks. Returns false if the ring is full.
+    bool enqueue(const std::shared_ptr<TransactionRecorder::Sink>& sink,
+                 std::vector<std::byte>&& bytes);
+    // Waits for everything enqueued before the call to be written.
+    void flush();
+
+private:
+    static constexpr size_t kCapacity = 1024;
+    static_assert((kCapacity & (kCapacity - 1)) == 0);
+    // Bounds the memory held by the ring when large parcels are being recorded.
+    static constexpr size_t kMaxQueuedBytes = 32 * 1024 * 1024;
+    // How long transactions wait to be batched with others when the ring is not filling up.
+    static constexpr std::chrono::milliseconds kFlushInterval{100};
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        std::shared_ptr<TransactionRecorder::Sink> sink;
+        std::vector<std::byte> bytes;
+    };
+
+    AsyncWriter() {
+        for (size_t i = 0; i < kCapacity; i++) {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    void threadMain();
+    size_t drain();
+
+    Slot mSlots[kCapacity];
+    alignas(64) std::atomic<size_t> mEnqueuePos = 0;
+    alignas(64) size_t mDequeuePos = 0; // only used by the writer thread
+    std::atomic<size_t> mQueuedBytes = 0;
+
+    std::mutex mLock;
+    std::condition_variable mWakeWriter;
+    std::condition_variable mWritten;
+    size_t mWrittenPos = 0;
+    bool mStopping = false;
+
+    std::mutex mThreadLock; // for below
+    size_t mUsers = 0;
+    std::thread mThread;
+};
+
+void AsyncWriter::acquire() {
+    std::lock_guard threadLock(mThreadLock);
+    if (mUsers++ == 0) {
+        {
+            std::lock_guard lock(mLock);
+            mStopping = false;
+        }
+        mThread = std::thread(&AsyncWriter::threadMain, this);
+    }
+}
+
+void AsyncWriter::release() {
+    std::lock_guard threadLock(mThreadLock);
+    CHECK_GT(mUsers, 0u) << "Unbalanced AsyncWriter::release";
+    if (--mUsers == 0) {
+        {
+            std::lock_guard lock(mLock);
+            mStopping = true;
+        }
+        mWakeWriter.notify_one();
+        mThread.join();
+    }
+}
+
+bool AsyncWriter::enqueue(const std::shared_ptr<TransactionRecorder::Sink>& sink,
+                          std::vector<std::byte>&& bytes) {
+    const size_t size = bytes.size();
+    if (mQueuedBytes.fetch_add(size, std::memory_order_relaxed) + size > kMaxQueuedBytes) {
+        mQueuedBytes.fetch_sub(size, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &mSlots[pos & (kCapacity - 1)];
+        const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // The writer has not consumed this slot yet.
+            mQueuedBytes.fetch_sub(size, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->sink = sink;
+    slot->bytes = std::move(bytes);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    // Wake the writer every half ring rather than leaving the ring to fill up until the next
+    // flush interval.
+    if (pos % (kCapacity / 2) == 0) {
+        mWakeWriter.notify_one();
+    }
+    return true;
+}
+
+void AsyncWriter::flush() {
+    const size_t target = mEnqueuePos.load(std::memory_order_acquire);
+    std::unique_lock lock(mLock);
+    mWakeWriter.notify_one();
+    mWritten.wait(lock, [&] { return mWrittenPos >= target; });
+}
+
+// Writes the iovecs in order, resuming after partial writes.
+static bool writeFully(borrowed_fd fd, iovec* iov, size_t count) {
+    while (count > 0) {
+        const int batch = static_cast<int>(std::min<size_t>(count, IOV_MAX));
+        ssize_t written = TEMP_FAILURE_RETRY(writev(fd.get(), iov, batch));
+        if (written < 0) {
+            return false;
+        }
+        while (count > 0 && static_cast<size_t>(written) >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (written > 0) {
+            iov->iov_base = static_cast<std::byte*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+size_t AsyncWriter::drain() {
+    struct Batch {
+        std::shared_ptr<TransactionRecorder::Sink> sink;
+        std::vector<iovec> iovecs;
+    };
+    std::vector<Batch> batches;
+    std::vector<std::vector<std::byte>> buffers;
+    size_t queuedBytes = 0;
+
+    while (buffers.size() < kCapacity) {
+        Slot& slot = mSlots[mDequeuePos & (kCapacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != mDequeuePos + 1) {
+            break;
+        }
+        // Usually all the queued transactions go to the same recording.
+        auto batch = std::find_if(batches.begin(), batches.end(),
+                                  [&](const Batch& b) { return b.sink == slot.sink; });
+        if (batch == batches.end()) {
+            batch = batches.insert(batches.end(), Batch{std::move(slot.sink), {}});
+        }
+        slot.sink.reset();
+        queuedBytes += slot.bytes.size();
+        buffers.push_back(std::move(slot.bytes));
+        batch->iovecs.push_back({buffers.back().data(), buffers.back().size()});
+        slot.sequence.store(mDequeuePos + kCapacity, std::memory_order_release);
+        mDequeuePos++;
+    }
+    mQueuedBytes.fetch_sub(queuedBytes, std::memory_order_relaxed);
+
+    for (Batch& batch : batches) {
+        const size_t count = batch.iovecs.size();
+        if (writeFully(batch.sink->fd, batch.iovecs.data(), count)) {
+            batch.sink->recorded.fetch_add(count, std::memory_order_relaxed);
+        } else {
+            PLOG(ERROR) << "Failed to write recorded transactions to fd " << batch.sink->fd.get();
+            batch.sink->failed.fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    return buffers.size();
+}
+
+void AsyncWriter::threadMain() {
+    std::unique_lock lock(mLock);
+    while (true) {
+        lock.unlock();
+        const size_t drained = drain();
+        lock.lock();
+        mWrittenPos = mDequeuePos;
+        mWritten.notify_all();
+        if (drained > 0) {
+            continue;
+        }
+        if (mStopping) {
+            break;
+        }
+        mWakeWriter.wait_for(lock, kFlushInterval);
+    }
+}
+
+} // namespace
+
+TransactionRecorder::TransactionRecorder(unique_fd fd, RecordingOptions options)
+      : mSink(std::make_shared<Sink>()), mOptions(std::move(options)) {
+    mSink->fd = std::move(fd);
+    if (mOptions.async) {
+        AsyncWriter::get().acquire();
+    }
+}
+
+TransactionRecorder::~TransactionRecorder() {
+    if (mOptions.async) {
+        AsyncWriter::get().flush();
+        AsyncWriter::get().release();
+    }
+}
+
+bool TransactionRecorder::shouldRecord(uint32_t code) {
+    if (!mOptions.codes.empty() &&
+        std::find(mOptions.codes.begin(), mOptions.codes.end(), code) == mOptions.codes.end()) {
+        mFilteredCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (mMatchedCount.fetch_add(1, std::memory_order_relaxed) % mOptions.sampleInterval != 0) {
+        mSampledOutCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void TransactionRecorder::record(const String16& interfaceName, uint32_t code, uint32_t flags,
+                                 const Parcel& data, const Parcel& reply, status_t err) {
+    timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    std::vector<std::byte> bytes;
+    if (RecordedTransaction::encode(interfaceName, code, flags, ts, data, reply, err, &bytes) !=
+        NO_ERROR) {
+        LOG(INFO) << "Failed to encode RecordedTransaction.";
+        mSink->failed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (mOptions.async) {
+        if (!AsyncWriter::get().enqueue(mSink, std::move(bytes))) {
+            mSink->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    std::lock_guard lock(mSink->writeLock);
+    if (android::base::WriteFully(mSink->fd, bytes.data(), bytes.size())) {
+        mSink->recorded.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        LOG(INFO) << "Failed to dump RecordedTransaction to file.";
+        mSink->failed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+RecordingStats TransactionRecorder::getStats() const {
+    return {
+            .recorded = mSink->recorded.load(std::memory_order_relaxed),
+            .filtered = mFilteredCount.load(std::memory_order_relaxed),
+            .sampledOut = mSampledOutCount.load(std::memory_order_relaxed),
+            .dropped = mSink->dropped.load(std::memory_order_relaxed),
+            .failed = mSink->failed.load(std::memory_order_relaxed),
+    };
+}
+
+} // namespace android::binder::debug
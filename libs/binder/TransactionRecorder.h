@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include <android-base/unique_fd.h>
+#include <binder/RecordedTransaction.h>
+
+namespace android::binder::debug {
+
+/**
+ * Records the transactions of one BBinder to a file, either directly from the binder thread or
+ * through the process-wide async writer, depending on RecordingOptions::async.
+ */
+class TransactionRecorder {
+public:
+    TransactionRecorder(android::base::unique_fd fd, RecordingOptions options);
+    /** Waits for the async writer to write out this recorder's pending transactions. */
+    ~TransactionRecorder();
+
+    /** Applies the code filter and sampling. Threadsafe. */
+    bool shouldRecord(uint32_t code);
+    /** Threadsafe. */
+    void record(const String16& interfaceName, uint32_t code, uint32_t flags, const Parcel& data,
+                const Parcel& reply, status_t err);
+
+    RecordingStats getStats() const;
+
+    /** Where the transactions are written. Shared with the entries queued in the async writer. */
+    struct Sink {
+        android::base::unique_fd fd;
+        std::mutex writeLock; // only used by synchronous recording
+        std::atomic<uint64_t> recorded = 0;
+        std::atomic<uint64_t> dropped = 0;
+        std::atomic<uint64_t> failed = 0;
+    };
+
+private:
+    const std::shared_ptr<Sink> mSink;
+    const RecordingOptions mOptions;
+    std::atomic<uint64_t> mMatchedCount = 0;
+    std::atomic<uint64_t> mFilteredCount = 0;
+    std::atomic<uint64_t> mSampledOutCount = 0;
+};
+
+} // namespace android::binder::debug
@@ -18,10 +18,230 @@
 
 #include <string.h>
 
+#include <algorithm>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BINDER_UTF_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BINDER_UTF_SSE2
+#endif
+
 namespace android {
 
 void zeroMemory(uint8_t* data, size_t size) {
     memset(data, 0, size);
 }
 
+namespace {
+
+// Package names, interface descriptors and most window titles are pure ASCII, so the transcoders
+// below skip over ASCII in bulk and only decode the other code points one at a time.
+
+// Returns the length of the run of ASCII characters at the start of src.
+size_t asciiPrefixLength(const uint8_t* src, size_t len) {
+    size_t i = 0;
+#if defined(BINDER_UTF_NEON)
+    for (; i + 16 <= len; i += 16) {
+        if (vmaxvq_u8(vld1q_u8(src + i)) >= 0x80) break;
+    }
+#elif defined(BINDER_UTF_SSE2)
+    for (; i + 16 <= len; i += 16) {
+        if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))) != 0) {
+            break;
+        }
+    }
+#else
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, src + i, sizeof(word));
+        if ((word & 0x8080808080808080ull) != 0) break;
+    }
+#endif
+    while (i < len && src[i] < 0x80) i++;
+    return i;
+}
+
+size_t asciiPrefixLength(const char16_t* src, size_t len) {
+    size_t i = 0;
+#if defined(BINDER_UTF_NEON)
+    const uint16_t* units = reinterpret_cast<const uint16_t*>(src);
+    for (; i + 16 <= len; i += 16) {
+        if (vmaxvq_u16(vorrq_u16(vld1q_u16(units + i), vld1q_u16(units + i + 8))) >= 0x80) break;
+    }
+#elif defined(BINDER_UTF_SSE2)
+    const __m128i nonAsciiBits = _mm_set1_epi16(static_cast<int16_t>(0xff80));
+    for (; i + 16 <= len; i += 16) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+        const __m128i bits = _mm_and_si128(_mm_or_si128(lo, hi), nonAsciiBits);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(bits, _mm_setzero_si128())) != 0xffff) break;
+    }
+#else
+    for (; i + 4 <= len; i += 4) {
+        uint64_t word;
+        memcpy(&word, src + i, sizeof(word));
+        if ((word & 0xff80ff80ff80ff80ull) != 0) break;
+    }
+#endif
+    while (i < len && src[i] < 0x80) i++;
+    return i;
+}
+
+// The helpers below are the ones from libutils' Unicode.cpp, so that malformed strings are
+// handled exactly like before.
+
+size_t utf8CodepointLength(uint8_t ch) {
+    return ((0xe5000000 >> ((ch >> 3) & 0x1e)) & 3) + 1;
+}
+
+uint32_t utf8ToUtf32Codepoint(const uint8_t* src, size_t length) {
+    uint32_t codepoint;
+    switch (length) {
+        case 1:
+            return src[0];
+        case 2:
+            codepoint = src[0] & 0x1f;
+            break;
+        case 3:
+            codepoint = src[0] & 0x0f;
+            break;
+        case 4:
+            codepoint = src[0] & 0x07;
+            break;
+        default:
+            return 0xffff;
+    }
+    for (size_t i = 1; i < length; i++) {
+        codepoint = (codepoint << 6) | (src[i] & 0x3f);
+    }
+    return codepoint;
+}
+
+size_t utf32CodepointUtf8Length(uint32_t codepoint) {
+    if (codepoint < 0x80) return 1;
+    if (codepoint < 0x800) return 2;
+    if (codepoint < 0x10000) return 3;
+    if (codepoint < 0x200000) return 4;
+    return 0;
+}
+
+void utf32CodepointToUtf8(uint8_t* dst, uint32_t codepoint, size_t bytes) {
+    static constexpr uint8_t kFirstByteMark[] = {0x00, 0x00, 0xc0, 0xe0, 0xf0};
+    for (size_t i = bytes; i > 1; i--) {
+        dst[i - 1] = static_cast<uint8_t>((codepoint | 0x80) & 0xbf);
+        codepoint >>= 6;
+    }
+    dst[0] = static_cast<uint8_t>(codepoint | kFirstByteMark[bytes]);
+}
+
+bool isSurrogatePair(const char16_t* src, const char16_t* end) {
+    return (src[0] & 0xfc00) == 0xd800 && src + 1 < end && (src[1] & 0xfc00) == 0xdc00;
+}
+
+} // namespace
+
+ssize_t utf8ToUtf16Length(const uint8_t* src, size_t srcLen) {
+    size_t i = 0;
+    size_t utf16Len = 0;
+    while (i < srcLen) {
+        const size_t ascii = asciiPrefixLength(src + i, srcLen - i);
+        i += ascii;
+        utf16Len += ascii;
+        if (i == srcLen) break;
+
+        const size_t charLen = utf8CodepointLength(src[i]);
+        if (charLen > srcLen - i) {
+            return -1;
+        }
+        utf16Len += utf8ToUtf32Codepoint(src + i, charLen) > 0xffff ? 2 : 1;
+        i += charLen;
+    }
+    return static_cast<ssize_t>(utf16Len);
+}
+
+void utf8ToUtf16(const uint8_t* src, size_t srcLen, char16_t* dst, size_t dstLen) {
+    if (dstLen == 0) return;
+    const uint8_t* const srcEnd = src + srcLen;
+    const char16_t* const dstEnd = dst + dstLen - 1;
+    while (src < srcEnd && dst < dstEnd) {
+        const size_t ascii = asciiPrefixLength(src, std::min<size_t>(srcEnd - src, dstEnd - dst));
+        for (size_t i = 0; i < ascii; i++) {
+            dst[i] = src[i];
+        }
+        src += ascii;
+        dst += ascii;
+        if (src == srcEnd || dst == dstEnd) break;
+
+        const size_t charLen = utf8CodepointLength(*src);
+        uint32_t codepoint = utf8ToUtf32Codepoint(src, charLen);
+        if (codepoint <= 0xffff) {
+            *dst++ = static_cast<char16_t>(codepoint);
+        } else {
+            codepoint -= 0x10000;
+            if (dst + 1 == dstEnd) {
+                // No room for the surrogate pair.
+                break;
+            }
+            *dst++ = static_cast<char16_t>((codepoint >> 10) + 0xd800);
+            *dst++ = static_cast<char16_t>((codepoint & 0x3ff) + 0xdc00);
+        }
+        src += charLen;
+    }
+    *dst = 0;
+}
+
+size_t utf16ToUtf8Length(const char16_t* src, size_t srcLen) {
+    const char16_t* const end = src + srcLen;
+    size_t utf8Len = 0;
+    while (src < end) {
+        const size_t ascii = asciiPrefixLength(src, end - src);
+        src += ascii;
+        utf8Len += ascii;
+        if (src == end) break;
+
+        if (isSurrogatePair(src, end)) {
+            utf8Len += 4;
+            src += 2;
+        } else {
+            utf8Len += utf32CodepointUtf8Length(*src++);
+        }
+    }
+    return utf8Len;
+}
+
+void utf16ToUtf8(const char16_t* src, size_t srcLen, char* dst, size_t dstLen) {
+    const char16_t* const end = src + srcLen;
+    uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+    while (src < end) {
+        const size_t ascii = asciiPrefixLength(src, end - src);
+        LOG_ALWAYS_FATAL_IF(dstLen < ascii, "%zu < %zu", dstLen, ascii);
+        for (size_t i = 0; i < ascii; i++) {
+            out[i] = static_cast<uint8_t>(src[i]);
+        }
+        src += ascii;
+        out += ascii;
+        dstLen -= ascii;
+        if (src == end) break;
+
+        uint32_t codepoint;
+        if (isSurrogatePair(src, end)) {
+            codepoint = ((static_cast<uint32_t>(src[0]) - 0xd800) << 10 |
+                         (static_cast<uint32_t>(src[1]) - 0xdc00)) +
+                    0x10000;
+            src += 2;
+        } else {
+            codepoint = *src++;
+        }
+        const size_t len = utf32CodepointUtf8Length(codepoint);
+        LOG_ALWAYS_FATAL_IF(dstLen < len, "%zu < %zu", dstLen, len);
+        utf32CodepointToUtf8(out, codepoint, len);
+        out += len;
+        dstLen -= len;
+    }
+    LOG_ALWAYS_FATAL_IF(dstLen < 1, "dst_len < 1: %zu < 1", dstLen);
+    *out = '\0';
+}
+
 } // namespace android
@@ -15,6 +15,7 @@
  */
 
 #include <stddef.h>
+#include <sys/types.h>
 #include <sys/uio.h>
 #include <cstdint>
 #include <optional>
@@ -35,6 +36,22 @@ namespace android {
 // avoid optimizations
 void zeroMemory(uint8_t* data, size_t size);
 
+// UTF-8 <-> UTF-16 transcoding for the Parcel string paths. These give the same results as
+// utf8_to_utf16_length/utf8_to_utf16 and utf16_to_utf8_length/utf16_to_utf8 from libutils,
+// including for malformed input, but convert runs of ASCII a vector at a time.
+//
+// Returns the number of UTF-16 code units needed for src, or -1 if a code point is cut off by the
+// end of src.
+ssize_t utf8ToUtf16Length(const uint8_t* src, size_t srcLen);
+// Converts src into dst, which holds dstLen code units including the terminating NUL. Stops early
+// if dst is too small.
+void utf8ToUtf16(const uint8_t* src, size_t srcLen, char16_t* dst, size_t dstLen);
+// Returns the number of bytes needed for src, not including the terminating NUL. Unpaired
+// surrogates are encoded on their own, like libutils does.
+size_t utf16ToUtf8Length(const char16_t* src, size_t srcLen);
+// Converts src into dst, which must hold utf16ToUtf8Length(src, srcLen) + 1 bytes.
+void utf16ToUtf8(const char16_t* src, size_t srcLen, char* dst, size_t dstLen);
+
 // View of contiguous sequence. Similar to std::span.
 template <typename T>
 struct Span {
@@ -27,6 +27,10 @@ namespace internal {
 class Stability;
 }
 
+namespace binder::debug {
+struct RecordingStats;
+}
+
 class BBinder : public IBinder
 {
 public:
@@ -110,6 +114,8 @@ public:
     [[nodiscard]] status_t startRecordingTransactions(const Parcel& data);
     // Stop the current recording.
     [[nodiscard]] status_t stopRecordingTransactions();
+    // Counters of the current recording, including the transactions it dropped.
+    [[nodiscard]] status_t getRecordingStats(binder::debug::RecordingStats* stats);
 
 protected:
     virtual             ~BBinder();
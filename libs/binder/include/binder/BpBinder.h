@@ -32,6 +32,9 @@ class RpcState;
 namespace internal {
 class Stability;
 }
+namespace binder::debug {
+struct RecordingOptions;
+}
 class ProcessState;
 
 using binder_proxy_limit_callback = void(*)(int);
@@ -93,6 +96,8 @@ public:
     // Start recording transactions to the unique_fd.
     // See RecordedTransaction.h for more details.
     status_t startRecordingBinder(const android::base::unique_fd& fd);
+    status_t startRecordingBinder(const android::base::unique_fd& fd,
+                                  const binder::debug::RecordingOptions& options);
     // Stop the current recording.
     status_t stopRecordingBinder();
 
@@ -21,6 +21,9 @@
 #include <binder/ProcessState.h>
 #include <utils/Vector.h>
 
+#include <memory>
+#include <vector>
+
 #if defined(_WIN32)
 typedef  int  uid_t;
 #endif
@@ -136,6 +139,44 @@ public:
             void                setCallRestriction(CallRestriction restriction);
             CallRestriction     getCallRestriction() const;
 
+            /**
+             * Opt in to caching the data buffers of parcels freed on this thread so that later
+             * parcels, such as transaction data and replies, reuse them instead of going to the
+             * heap. Small buffers are kept in size classes up to a fixed per-thread byte cap.
+             * Disabling releases the cached buffers. Must be called on the thread owning this
+             * IPCThreadState. See Parcel::getGlobalPoolReuseCount.
+             */
+            void                setParcelBufferPoolEnabled(bool enabled);
+            bool                isParcelBufferPoolEnabled() const;
+
+            /**
+             * While corked, oneway transactions made on this thread are queued in the out buffer
+             * instead of each costing a BINDER_WRITE_READ, and the matching uncork sends them all
+             * to the driver at once. Useful when fanning out a callback to many listeners.
+             *
+             * Corking nests. The data of each corked transaction is copied, so callers may reuse
+             * or destroy their parcels right away. A synchronous transaction made while corked
+             * sends the pending oneway ones first, so the order of calls is preserved.
+             *
+             * uncorkOnewayTransactions returns the first error reported for any of the corked
+             * transactions since the outermost cork.
+             */
+            void                corkOnewayTransactions();
+            status_t            uncorkOnewayTransactions();
+
+            class ScopedOnewayCork {
+            public:
+                ScopedOnewayCork() : mState(IPCThreadState::self()) {
+                    mState->corkOnewayTransactions();
+                }
+                ~ScopedOnewayCork() { mState->uncorkOnewayTransactions(); }
+                ScopedOnewayCork(const ScopedOnewayCork&) = delete;
+                ScopedOnewayCork& operator=(const ScopedOnewayCork&) = delete;
+
+            private:
+                IPCThreadState* mState;
+            };
+
             int64_t             clearCallingIdentity();
             // Restores PID/UID (not SID)
             void                restoreCallingIdentity(int64_t token);
@@ -216,6 +257,7 @@ private:
             status_t            executeCommand(int32_t command);
             void                processPendingDerefs();
             void                processPostWriteDerefs();
+            status_t            flushCorkedTransactions();
 
             void                clearCaller();
 
@@ -245,9 +287,16 @@ private:
             bool                mIsLooper;
             bool mIsFlushing;
             bool mHasExplicitIdentity;
+            // Time spent waiting in the driver before the last command, if measured
+            int64_t             mLastIdleTimeMs;
             int32_t             mStrictModePolicy;
             int32_t             mLastTransactionBinderFlags;
             CallRestriction     mCallRestriction;
+            // Oneway transactions queued in mOut while corked. Their data must outlive the
+            // BC_TRANSACTION commands that point to it.
+            uint32_t            mOnewayCorkDepth;
+            std::vector<std::unique_ptr<Parcel>> mCorkedTransactions;
+            status_t            mCorkedError;
 };
 
 } // namespace android
@@ -147,6 +147,16 @@ public:
         int pid;
     };
     virtual std::vector<ServiceDebugInfo> getServiceDebugInfo() = 0;
+
+    /**
+     * Efficiently wait for several services at once.
+     *
+     * All of the services are requested up front, so that lazy services start in parallel, and a
+     * single callback is registered for the notifications on all of them. Returns the services in
+     * the order of names. Like waitForService, an entry is nullptr only for a permission problem or
+     * a fatal error.
+     */
+    virtual std::vector<sp<IBinder>> waitForServices(const std::vector<String16>& names);
 };
 
 sp<IServiceManager> defaultServiceManager();
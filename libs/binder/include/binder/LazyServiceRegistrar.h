@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 
 #include <binder/IServiceManager.h>
@@ -93,6 +94,28 @@ class LazyServiceRegistrar {
       */
      void reRegister();
 
+     struct LingerPolicy {
+         // How long the process stays up after its services lost their last client. 0 means
+         // that it shuts down right away.
+         std::chrono::milliseconds minLinger{0};
+         // The linger time doubles, up to this, every time a client comes back while the process
+         // lingers.
+         std::chrono::milliseconds maxLinger{0};
+         // The linger time halves again for every period of this length without such a client.
+         std::chrono::milliseconds decayPeriod{60000};
+     };
+
+     /**
+      * Keep the process running for a while when its services have no clients anymore, instead
+      * of shutting it down right away. This avoids restarting the process every few seconds
+      * for services whose clients come and go. The linger time adapts to how often clients come
+      * back, see LingerPolicy.
+      *
+      * This doesn't apply if the active services callback handles the shutdown. Like the
+      * callback, this method should be called before 'registerService' to avoid races.
+      */
+     void setLingerPolicy(const LingerPolicy& policy);
+
    private:
      std::shared_ptr<internal::ClientCounterCallback> mClientCC;
      LazyServiceRegistrar();
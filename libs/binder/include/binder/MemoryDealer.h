@@ -25,19 +25,48 @@
 namespace android {
 // ----------------------------------------------------------------------------
 
-class SimpleBestFitAllocator;
+class MemoryDealerAllocator;
 
 // ----------------------------------------------------------------------------
 
 class MemoryDealer : public RefBase
 {
 public:
+    enum class AllocatorType {
+        // Keeps a list of chunks and picks the best fit. Allocating and freeing scan the list, so
+        // they get slower as the number of allocations grows.
+        BEST_FIT,
+        // Two-level segregated fit (TLSF). Allocating and freeing take constant time, which
+        // suits clients that carve many small regions out of one heap.
+        SEGREGATED_FIT,
+    };
+
+    // A snapshot of how the heap is used. All sizes are in bytes.
+    struct Stats {
+        size_t heapSize = 0;
+        size_t allocatedSize = 0;
+        size_t allocationCount = 0;
+        size_t freeSize = 0;
+        size_t freeBlockCount = 0;
+        // The largest allocation that can currently succeed.
+        size_t largestFreeBlock = 0;
+
+        // The share of the free memory that cannot be used by an allocation of the largest
+        // possible size, from 0 (no fragmentation) to 1.
+        float fragmentation() const {
+            return freeSize == 0 ? 0.f : 1.f - float(largestFreeBlock) / float(freeSize);
+        }
+    };
+
     explicit MemoryDealer(size_t size, const char* name = nullptr,
             uint32_t flags = 0 /* or bits such as MemoryHeapBase::READ_ONLY */ );
+    MemoryDealer(size_t size, const char* name, uint32_t flags, AllocatorType allocatorType);
 
     virtual sp<IMemory> allocate(size_t size);
     virtual void        dump(const char* what) const;
 
+    Stats getStats() const;
+
     // allocations are aligned to some value. return that value so clients can account for it.
     static size_t      getAllocationAlignment();
 
@@ -50,10 +79,10 @@ private:
     friend class Allocation;
     virtual void                deallocate(size_t offset);
     const sp<IMemoryHeap>&      heap() const;
-    SimpleBestFitAllocator*     allocator() const;
+    MemoryDealerAllocator*      allocator() const;
 
     sp<IMemoryHeap>             mHeap;
-    SimpleBestFitAllocator*     mAllocator;
+    MemoryDealerAllocator*      mAllocator;
 };
 
 
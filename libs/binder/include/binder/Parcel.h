@@ -593,6 +593,9 @@ public:
     // Debugging: get metrics on current allocations.
     static size_t       getGlobalAllocSize();
     static size_t       getGlobalAllocCount();
+    // Debugging: number of data buffers served from a thread's buffer pool rather than the heap.
+    // See IPCThreadState::setParcelBufferPoolEnabled.
+    static size_t       getGlobalPoolReuseCount();
 
     bool                replaceCallingWorkSourceUid(uid_t uid);
     // Returns the work source provided by the caller. This can only be trusted for trusted calling
@@ -634,6 +637,9 @@ private:
     uintptr_t           readPointer() const;
     void                freeDataNoInit();
     void                initState();
+    // Per-thread data buffer pool, exposed through IPCThreadState::setParcelBufferPoolEnabled.
+    static void         setThreadBufferPoolEnabled(bool enabled);
+    static bool         isThreadBufferPoolEnabled();
     void                scanForFds() const;
     status_t            validateReadData(size_t len) const;
 
@@ -1336,6 +1342,9 @@ private:
     // Set this to false to skip dataAvail checks.
     bool mEnforceNoDataAvail;
 
+    // Whether mData came from the per-thread buffer pool and is sized to its pool class.
+    bool mPooledData;
+
     release_func        mOwner;
 
     size_t mReserved;
@@ -24,6 +24,9 @@
 #include <utils/String16.h>
 #include <utils/Singleton.h>
 #include <utils/SortedVector.h>
+#include <utils/Timers.h>
+
+#include <atomic>
 
 namespace android {
 // ---------------------------------------------------------------------------
@@ -37,6 +40,10 @@ namespace android {
  * IMPORTANT: for the reason stated above, only system permissions are safe
  * to cache. This restriction may be lifted at a later time.
  *
+ * Decisions expire after kCacheTimeout, which bounds how long a change goes
+ * unnoticed. The cache is sharded by uid, so that checks for different
+ * callers do not contend on the same lock.
+ *
  */
 
 class PermissionCache : Singleton<PermissionCache> {
@@ -44,16 +51,30 @@ class PermissionCache : Singleton<PermissionCache> {
         String16    name;
         uid_t       uid;
         bool        granted;
+        nsecs_t     time;
         inline bool operator < (const Entry& e) const {
             return (uid == e.uid) ? (name < e.name) : (uid < e.uid);
         }
     };
+    struct Shard {
+        mutable Mutex lock;
+        // this is our cache per say. it stores pooled names.
+        SortedVector< Entry > cache;
+    };
+    static constexpr size_t kShardCount = 8;
+    static constexpr nsecs_t kCacheTimeout = s2ns(60);
+
     mutable Mutex mLock;
     // we pool all the permission names we see, as many permissions checks
     // will have identical names
     SortedVector< String16 > mPermissionNamesPool;
-    // this is our cache per say. it stores pooled names.
-    SortedVector< Entry > mCache;
+    Shard mShards[kShardCount];
+
+    mutable std::atomic<uint64_t> mHits{0};
+    mutable std::atomic<uint64_t> mMisses{0};
+    mutable std::atomic<uint64_t> mExpirations{0};
+
+    static size_t getShard(uid_t uid) { return uid % kShardCount; }
 
     // free the whole cache, but keep the permission name pool
     void purge();
@@ -64,6 +85,13 @@ class PermissionCache : Singleton<PermissionCache> {
     void cache(const String16& permission, uid_t uid, bool granted);
 
 public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        // misses due to decisions older than kCacheTimeout
+        uint64_t expirations;
+    };
+
     PermissionCache();
 
     static bool checkCallingPermission(const String16& permission);
@@ -75,6 +103,8 @@ public:
             pid_t pid, uid_t uid);
 
     static void purgeCache();
+
+    static Stats getStats();
 };
 
 // ---------------------------------------------------------------------------
@@ -24,6 +24,8 @@
 
 #include <pthread.h>
 
+#include <chrono>
+
 // ---------------------------------------------------------------------------
 namespace android {
 
@@ -67,6 +69,33 @@ public:
     status_t setThreadPoolMaxThreadCount(size_t maxThreads);
     status_t enableOnewaySpamDetection(bool enable);
 
+    /**
+     * Let the thread pool adapt to the load. The max thread count set with
+     * setThreadPoolMaxThreadCount is the starting point. It grows, up to maxThreads, when
+     * transactions keep finding all of the threads busy. Threads started by the kernel leave the
+     * pool when they were idle for longer than idleTimeout and other threads are still waiting
+     * for work. This must be called before the thread pool is started.
+     *
+     * For main functions - dangerous for libraries to use
+     */
+    status_t enableAdaptiveThreadPool(size_t maxThreads, std::chrono::milliseconds idleTimeout);
+
+    struct ThreadPoolStats {
+        // Max number of threads the kernel may start, it grows in adaptive mode
+        size_t maxThreads;
+        // Threads currently in the thread pool, and how many of them are executing a command
+        size_t currentThreads;
+        size_t executingThreads;
+        size_t peakExecutingThreads;
+        // Threads that left the pool in adaptive mode because they were idle
+        size_t retiredThreads;
+        // Commands executed by the thread pool
+        uint64_t commands;
+        // Total time during which all of the threads were busy
+        int64_t starvationTimeMs;
+    };
+    ThreadPoolStats getThreadPoolStats() const;
+
     // Set the name of the current thread to look like a threadpool
     // thread. Typically this is called before joinThreadPool.
     //
@@ -160,6 +189,21 @@ private:
     size_t mKernelStartedThreads;
     // Time when thread pool was emptied
     int64_t mStarvationStartTimeMs;
+    // Stats for getThreadPoolStats
+    size_t mPeakExecutingThreadsCount;
+    uint64_t mExecutedCommands;
+    int64_t mTotalStarvationTimeMs;
+    // Adaptive thread pool, mAdaptiveMaxThreads is 0 unless enabled. These are only written
+    // before the thread pool starts.
+    size_t mAdaptiveMaxThreads;
+    int64_t mIdleTimeoutMs;
+    // Threads retired by the adaptive thread pool
+    size_t mRetiredThreads;
+
+    // Called with mThreadCountLock held by the adaptive thread pool
+    void onStarvationEndedLocked(int64_t starvationTimeMs);
+    bool shouldRetireThreadLocked(int64_t idleTimeMs);
+    status_t updateDriverMaxThreadsLocked();
 
     mutable Mutex mLock; // protects everything below.
 
@@ -18,7 +18,9 @@
 
 #include <android-base/unique_fd.h>
 #include <binder/Parcel.h>
+#include <cstddef>
 #include <mutex>
+#include <vector>
 
 namespace android {
 
@@ -28,6 +30,48 @@ namespace binder::debug {
 // non-stable format. A detailed description of the recording format can be found in
 // RecordedTransaction.cpp.
 
+// How BBinder::startRecordingTransactions records. The defaults record every transaction,
+// written from the binder thread that handled it.
+struct RecordingOptions {
+    // Copy transactions into a process-wide ring that a background thread writes out in
+    // batches, instead of writing each of them to the file from the binder thread. Transactions
+    // are dropped rather than blocking the binder thread if the writer falls behind.
+    bool async = false;
+    // Record one of every sampleInterval transactions that pass the code filter.
+    uint32_t sampleInterval = 1;
+    // Only record the transactions with these codes. Empty records all of them.
+    std::vector<uint32_t> codes;
+
+    // Defined inline, as BpBinder sends these in builds that leave recording out.
+    status_t writeToParcel(Parcel* parcel) const {
+        if (status_t status = parcel->writeBool(async); status != OK) return status;
+        if (status_t status = parcel->writeUint32(sampleInterval); status != OK) return status;
+        return parcel->writeInt32Vector(std::vector<int32_t>(codes.begin(), codes.end()));
+    }
+    status_t readFromParcel(const Parcel& parcel) {
+        if (status_t status = parcel.readBool(&async); status != OK) return status;
+        if (status_t status = parcel.readUint32(&sampleInterval); status != OK) return status;
+        if (sampleInterval == 0) return BAD_VALUE;
+        std::vector<int32_t> codesVector;
+        if (status_t status = parcel.readInt32Vector(&codesVector); status != OK) return status;
+        codes.assign(codesVector.begin(), codesVector.end());
+        return OK;
+    }
+};
+
+struct RecordingStats {
+    // Transactions written to the file.
+    uint64_t recorded = 0;
+    // Transactions skipped because of RecordingOptions::codes.
+    uint64_t filtered = 0;
+    // Transactions skipped because of RecordingOptions::sampleInterval.
+    uint64_t sampledOut = 0;
+    // Transactions lost because the async writer was full.
+    uint64_t dropped = 0;
+    // Transactions that could not be encoded or written.
+    uint64_t failed = 0;
+};
+
 class RecordedTransaction {
 public:
     // Filled with the first transaction from fd.
@@ -39,6 +83,13 @@ public:
                                                           const Parcel& reply, status_t err);
     RecordedTransaction(RecordedTransaction&& t) noexcept;
 
+    // Appends a transaction to buffer in the format of dumpToFile, without the copies of the
+    // parcels that fromDetails makes.
+    [[nodiscard]] static status_t encode(const String16& interfaceName, uint32_t code,
+                                         uint32_t flags, timespec timestamp, const Parcel& data,
+                                         const Parcel& reply, status_t err,
+                                         std::vector<std::byte>* buffer);
+
     [[nodiscard]] status_t dumpToFile(const android::base::unique_fd& fd) const;
 
     const std::string& getInterfaceName() const;
@@ -53,8 +104,6 @@ public:
 private:
     RecordedTransaction() = default;
 
-    android::status_t writeChunk(const android::base::borrowed_fd, uint32_t chunkType,
-                                 size_t byteCount, const uint8_t* data) const;
 
 #pragma clang diagnostic push
 #pragma clang diagnostic error "-Wpadded"
@@ -71,6 +120,12 @@ private:
     static_assert(sizeof(TransactionHeader) == 32);
     static_assert(sizeof(TransactionHeader) % 8 == 0);
 
+    static TransactionHeader makeHeader(uint32_t code, uint32_t flags, timespec timestamp,
+                                        const Parcel& data, status_t err);
+    static status_t appendTransaction(const TransactionHeader& header,
+                                      const std::string& interfaceName, const Parcel& data,
+                                      const Parcel& reply, std::vector<std::byte>* buffer);
+
     struct MovableData { // movable
         TransactionHeader mHeader;
         std::string mInterfaceName;
@@ -29,6 +29,7 @@
 namespace android {
 
 class FdTrigger;
+class RpcEventLoop;
 class RpcServerTrusty;
 class RpcSocketAddress;
 
@@ -132,6 +133,23 @@ public:
     void setMaxThreads(size_t threads);
     size_t getMaxThreads();
 
+    /**
+     * By default, each incoming connection of a session is served by a thread
+     * of its own, which waits for the next command while the client is idle.
+     * If this is set to a non-zero value before join(), the connections of all
+     * sessions are instead parked in a single poller, and served by a pool of
+     * this many threads, one command at a time. The commands of each
+     * connection are still processed in order.
+     *
+     * A thread of the pool is busy for the whole duration of a transaction,
+     * including nested calls, so this must be at least the number of
+     * transactions that may block at the same time. setMaxThreads still limits
+     * the connections of each session.
+     *
+     * Not supported on single-threaded libbinder.
+     */
+    void setEventLoopThreads(size_t threads);
+
     /**
      * By default, the latest protocol version which is supported by a client is
      * used. However, this can be used in order to prevent newer protocol
@@ -262,6 +280,8 @@ private:
     std::unique_ptr<RpcMaybeThread> mJoinThread;
     bool mJoinThreadRunning = false;
     std::map<RpcMaybeThread::id, RpcMaybeThread> mConnectingThreads;
+    size_t mEventLoopThreads = 0;
+    std::unique_ptr<RpcEventLoop> mEventLoop;
 
     sp<IBinder> mRootObject;
     wp<IBinder> mRootObjectWeak;
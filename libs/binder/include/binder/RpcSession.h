@@ -23,6 +23,7 @@
 #include <utils/Errors.h>
 #include <utils/RefBase.h>
 
+#include <functional>
 #include <map>
 #include <optional>
 #include <vector>
@@ -30,6 +31,7 @@
 namespace android {
 
 class Parcel;
+class RpcEventLoop;
 class RpcServer;
 class RpcServerTrusty;
 class RpcSocketAddress;
@@ -219,6 +221,7 @@ public:
 
 private:
     friend sp<RpcSession>;
+    friend RpcEventLoop;
     friend RpcServer;
     friend RpcServerTrusty;
     friend RpcState;
@@ -282,6 +285,15 @@ private:
     // join on thread passed to preJoinThreadOwnership
     static void join(sp<RpcSession>&& session, PreJoinSetupResult&& result);
 
+    // Instead of join, an RpcEventLoop serves the connection returned by
+    // preJoinSetup one command at a time from its own threads, and cleans up
+    // with endIncomingConnection once a command fails.
+    static void runEventLoopThread(const std::function<void()>& loop);
+    [[nodiscard]] static status_t serveIncomingCommand(const sp<RpcSession>& session,
+                                                       const sp<RpcConnection>& connection);
+    static void endIncomingConnection(sp<RpcSession>&& session,
+                                      const sp<RpcConnection>& connection);
+
     [[nodiscard]] status_t setupClient(
             const std::function<status_t(const std::vector<uint8_t>& sessionId, bool incoming)>&
                     connectAndInit);
@@ -86,9 +86,29 @@ static std::string SanitizeString(const String16& str) {
     return sanitized;
 }
 
+// Local binders return the String16 of their class object, and String16 copies share their
+// storage, so most descriptors being compared are the same object.
+static bool DescriptorsEqual(const String16& lhs, const String16& rhs) {
+    if (lhs.string() == rhs.string()) return true;
+    return lhs.size() == rhs.size() &&
+            memcmp(lhs.string(), rhs.string(), lhs.size() * sizeof(char16_t)) == 0;
+}
+
+static bool DescriptorsEqual(const AIBinder_Class* lhs, const AIBinder_Class* rhs) {
+    return lhs->getInterfaceDescriptorHash() == rhs->getInterfaceDescriptorHash() &&
+            DescriptorsEqual(lhs->getInterfaceDescriptor(), rhs->getInterfaceDescriptor());
+}
+
 bool AIBinder::associateClass(const AIBinder_Class* clazz) {
     if (clazz == nullptr) return false;
 
+    // Generated code associates the class every time it wraps the binder, so check for that
+    // before looking up the descriptor of the binder, which takes a lock of its own.
+    {
+        std::lock_guard<std::mutex> lock(mClazzMutex);
+        if (mClazz == clazz) return true;
+    }
+
     // If mClazz is non-null, this must have been called and cached
     // already. So, we can safely call this first. Due to the implementation
     // of getInterfaceDescriptor (at time of writing), two simultaneous calls
@@ -118,7 +138,7 @@ bool AIBinder::associateClass(const AIBinder_Class* clazz) {
     // a different stability level.
     if (mClazz != nullptr && !asABpBinder()) {
         const String16& currentDescriptor = mClazz->getInterfaceDescriptor();
-        if (newDescriptor == currentDescriptor) {
+        if (DescriptorsEqual(clazz, mClazz)) {
             LOG(ERROR) << __func__ << ": Class descriptors '" << currentDescriptor
                        << "' match during associateClass, but they are different class objects ("
                        << clazz << " vs " << mClazz << "). Class descriptor collision?";
@@ -137,7 +157,7 @@ bool AIBinder::associateClass(const AIBinder_Class* clazz) {
     // since it's an error condition. Do the comparison after we take the lock and
     // check the pointer equality fast path. By always taking the lock, it's also
     // more flake-proof. However, the check is not dependent on the lock.
-    if (descriptor != newDescriptor) {
+    if (!DescriptorsEqual(descriptor, newDescriptor)) {
         if (getBinder()->isBinderAlive()) {
             LOG(ERROR) << __func__ << ": Expecting binder to have class '" << newDescriptor
                        << "' but descriptor is actually '" << SanitizeString(descriptor) << "'.";
@@ -352,7 +372,8 @@ AIBinder_Class::AIBinder_Class(const char* interfaceDescriptor, AIBinder_Class_o
       onDestroy(onDestroy),
       onTransact(onTransact),
       mInterfaceDescriptor(interfaceDescriptor),
-      mWideInterfaceDescriptor(interfaceDescriptor) {}
+      mWideInterfaceDescriptor(interfaceDescriptor),
+      mInterfaceDescriptorHash(std::hash<std::string>{}(mInterfaceDescriptor)) {}
 
 AIBinder_Class* AIBinder_Class_define(const char* interfaceDescriptor,
                                       AIBinder_Class_onCreate onCreate,
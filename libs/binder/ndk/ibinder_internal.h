@@ -116,6 +116,9 @@ struct AIBinder_Class {
 
     const ::android::String16& getInterfaceDescriptor() const { return mWideInterfaceDescriptor; }
     const char* getInterfaceDescriptorUtf8() const { return mInterfaceDescriptor.c_str(); }
+    // Hash of the descriptor, so that different class objects can usually be told apart without
+    // comparing their descriptors.
+    size_t getInterfaceDescriptorHash() const { return mInterfaceDescriptorHash; }
 
     // whether a transaction header should be written
     bool writeHeader = true;
@@ -135,6 +138,7 @@ struct AIBinder_Class {
     // This must be a String16 since BBinder virtual getInterfaceDescriptor returns a reference to
     // one.
     const ::android::String16 mWideInterfaceDescriptor;
+    const size_t mInterfaceDescriptorHash;
 };
 
 // Ownership is like this (when linked to death):
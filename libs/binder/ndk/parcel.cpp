@@ -22,6 +22,7 @@
 #include "status_internal.h"
 
 #include <limits>
+#include <type_traits>
 
 #include <android-base/logging.h>
 #include <android-base/unique_fd.h>
@@ -80,39 +81,60 @@ static binder_status_t ReadAndValidateArraySize(const AParcel* parcel, int32_t*
     return STATUS_OK;
 }
 
+// Whether arrays of T are laid out in the parcel exactly like in memory, so that they can be
+// copied in bulk. Other primitives, like char16_t and bool, take an int32_t each on the wire.
 template <typename T>
-binder_status_t WriteArray(AParcel* parcel, const T* array, int32_t length) {
-    binder_status_t status = WriteAndValidateArraySize(parcel, array == nullptr, length);
-    if (status != STATUS_OK) return status;
-    if (length <= 0) return STATUS_OK;
+static inline constexpr bool is_trivially_parcelable_v =
+        std::is_same_v<T, int8_t> || std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> ||
+        std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t> || std::is_same_v<T, float> ||
+        std::is_same_v<T, double>;
 
-    int32_t size = 0;
-    if (__builtin_smul_overflow(sizeof(T), length, &size)) return STATUS_NO_MEMORY;
-
-    void* const data = parcel->get()->writeInplace(size);
-    if (data == nullptr) return STATUS_NO_MEMORY;
+template <typename T>
+static constexpr size_t ParcelElementSize() {
+    return is_trivially_parcelable_v<T> ? sizeof(T) : sizeof(int32_t);
+}
 
-    memcpy(data, array, size);
+// Reserves the space for length elements of T in one go, rather than growing the parcel once per
+// element.
+template <typename T>
+static void* WriteArrayInplace(AParcel* parcel, int32_t length) {
+    int32_t size = 0;
+    if (__builtin_smul_overflow(ParcelElementSize<T>(), length, &size)) return nullptr;
+    return parcel->get()->writeInplace(size);
+}
 
-    return STATUS_OK;
+template <typename T>
+static const void* ReadArrayInplace(const AParcel* parcel, int32_t length,
+                                    binder_status_t* outStatus) {
+    int32_t size = 0;
+    if (__builtin_smul_overflow(ParcelElementSize<T>(), length, &size)) {
+        *outStatus = STATUS_NO_MEMORY;
+        return nullptr;
+    }
+    const void* data = parcel->get()->readInplace(size);
+    if (data == nullptr) {
+        // Reading the elements one by one would have run out of data.
+        *outStatus = is_trivially_parcelable_v<T> ? STATUS_NO_MEMORY : STATUS_NOT_ENOUGH_DATA;
+    }
+    return data;
 }
 
-// Each element in a char16_t array is converted to an int32_t (not packed).
-template <>
-binder_status_t WriteArray<char16_t>(AParcel* parcel, const char16_t* array, int32_t length) {
+template <typename T>
+binder_status_t WriteArray(AParcel* parcel, const T* array, int32_t length) {
     binder_status_t status = WriteAndValidateArraySize(parcel, array == nullptr, length);
     if (status != STATUS_OK) return status;
     if (length <= 0) return STATUS_OK;
 
-    int32_t size = 0;
-    if (__builtin_smul_overflow(sizeof(char16_t), length, &size)) return STATUS_NO_MEMORY;
-
-    Parcel* rawParcel = parcel->get();
-
-    for (int32_t i = 0; i < length; i++) {
-        status = rawParcel->writeChar(array[i]);
+    void* const data = WriteArrayInplace<T>(parcel, length);
+    if (data == nullptr) return STATUS_NO_MEMORY;
 
-        if (status != STATUS_OK) return PruneStatusT(status);
+    if constexpr (is_trivially_parcelable_v<T>) {
+        memcpy(data, array, sizeof(T) * length);
+    } else {
+        int32_t* const elements = static_cast<int32_t*>(data);
+        for (int32_t i = 0; i < length; i++) {
+            elements[i] = static_cast<int32_t>(array[i]);
+        }
     }
 
     return STATUS_OK;
@@ -121,8 +143,6 @@ binder_status_t WriteArray<char16_t>(AParcel* parcel, const char16_t* array, int
 template <typename T>
 binder_status_t ReadArray(const AParcel* parcel, void* arrayData,
                           ContiguousArrayAllocator<T> allocator) {
-    const Parcel* rawParcel = parcel->get();
-
     int32_t length;
     if (binder_status_t status = ReadAndValidateArraySize(parcel, &length); status != STATUS_OK) {
         return status;
@@ -140,67 +160,38 @@ binder_status_t ReadArray(const AParcel* parcel, void* arrayData,
     if (length <= 0) return STATUS_OK;
     if (array == nullptr) return STATUS_NO_MEMORY;
 
-    int32_t size = 0;
-    if (__builtin_smul_overflow(sizeof(T), length, &size)) return STATUS_NO_MEMORY;
-
-    const void* data = rawParcel->readInplace(size);
-    if (data == nullptr) return STATUS_NO_MEMORY;
-
-    memcpy(array, data, size);
+    binder_status_t status = STATUS_OK;
+    const void* data = ReadArrayInplace<T>(parcel, length, &status);
+    if (data == nullptr) return status;
 
-    return STATUS_OK;
-}
-
-// Each element in a char16_t array is converted to an int32_t (not packed)
-template <>
-binder_status_t ReadArray<char16_t>(const AParcel* parcel, void* arrayData,
-                                    ContiguousArrayAllocator<char16_t> allocator) {
-    const Parcel* rawParcel = parcel->get();
-
-    int32_t length;
-    if (binder_status_t status = ReadAndValidateArraySize(parcel, &length); status != STATUS_OK) {
-        return status;
-    }
-
-    char16_t* array;
-    if (!allocator(arrayData, length, &array)) {
-        if (length < 0) {
-            return STATUS_UNEXPECTED_NULL;
-        } else {
-            return STATUS_NO_MEMORY;
+    if constexpr (is_trivially_parcelable_v<T>) {
+        memcpy(array, data, sizeof(T) * length);
+    } else {
+        const int32_t* const elements = static_cast<const int32_t*>(data);
+        for (int32_t i = 0; i < length; i++) {
+            array[i] = static_cast<T>(elements[i]);
         }
     }
 
-    if (length <= 0) return STATUS_OK;
-    if (array == nullptr) return STATUS_NO_MEMORY;
-
-    int32_t size = 0;
-    if (__builtin_smul_overflow(sizeof(char16_t), length, &size)) return STATUS_NO_MEMORY;
-
-    for (int32_t i = 0; i < length; i++) {
-        status_t status = rawParcel->readChar(array + i);
-
-        if (status != STATUS_OK) return PruneStatusT(status);
-    }
-
     return STATUS_OK;
 }
 
+// For arrays that are not contiguous in memory, like std::vector<bool>. Each element is written
+// as an int32_t, like Parcel::writeBool does.
 template <typename T>
 binder_status_t WriteArray(AParcel* parcel, const void* arrayData, int32_t length,
-                           ArrayGetter<T> getter, status_t (Parcel::*write)(T)) {
+                           ArrayGetter<T> getter) {
     // we have no clue if arrayData represents a null object or not, we can only infer from length
     bool arrayIsNull = length < 0;
     binder_status_t status = WriteAndValidateArraySize(parcel, arrayIsNull, length);
     if (status != STATUS_OK) return status;
     if (length <= 0) return STATUS_OK;
 
-    Parcel* rawParcel = parcel->get();
+    int32_t* const elements = static_cast<int32_t*>(WriteArrayInplace<T>(parcel, length));
+    if (elements == nullptr) return STATUS_NO_MEMORY;
 
     for (int32_t i = 0; i < length; i++) {
-        status = (rawParcel->*write)(getter(arrayData, i));
-
-        if (status != STATUS_OK) return PruneStatusT(status);
+        elements[i] = static_cast<int32_t>(getter(arrayData, i));
     }
 
     return STATUS_OK;
@@ -208,9 +199,7 @@ binder_status_t WriteArray(AParcel* parcel, const void* arrayData, int32_t lengt
 
 template <typename T>
 binder_status_t ReadArray(const AParcel* parcel, void* arrayData, ArrayAllocator<T> allocator,
-                          ArraySetter<T> setter, status_t (Parcel::*read)(T*) const) {
-    const Parcel* rawParcel = parcel->get();
-
+                          ArraySetter<T> setter) {
     int32_t length;
     if (binder_status_t status = ReadAndValidateArraySize(parcel, &length); status != STATUS_OK) {
         return status;
@@ -226,12 +215,17 @@ binder_status_t ReadArray(const AParcel* parcel, void* arrayData, ArrayAllocator
 
     if (length <= 0) return STATUS_OK;
 
-    for (int32_t i = 0; i < length; i++) {
-        T readTarget;
-        status_t status = (rawParcel->*read)(&readTarget);
-        if (status != STATUS_OK) return PruneStatusT(status);
+    binder_status_t status = STATUS_OK;
+    const int32_t* const elements =
+            static_cast<const int32_t*>(ReadArrayInplace<T>(parcel, length, &status));
+    if (elements == nullptr) return status;
 
-        setter(arrayData, i, readTarget);
+    for (int32_t i = 0; i < length; i++) {
+        if constexpr (std::is_same_v<T, bool>) {
+            setter(arrayData, i, elements[i] != 0);
+        } else {
+            setter(arrayData, i, static_cast<T>(elements[i]));
+        }
     }
 
     return STATUS_OK;
@@ -612,7 +606,7 @@ binder_status_t AParcel_writeDoubleArray(AParcel* parcel, const double* arrayDat
 
 binder_status_t AParcel_writeBoolArray(AParcel* parcel, const void* arrayData, int32_t length,
                                        AParcel_boolArrayGetter getter) {
-    return WriteArray<bool>(parcel, arrayData, length, getter, &Parcel::writeBool);
+    return WriteArray<bool>(parcel, arrayData, length, getter);
 }
 
 binder_status_t AParcel_writeCharArray(AParcel* parcel, const char16_t* arrayData, int32_t length) {
@@ -656,7 +650,7 @@ binder_status_t AParcel_readDoubleArray(const AParcel* parcel, void* arrayData,
 binder_status_t AParcel_readBoolArray(const AParcel* parcel, void* arrayData,
                                       AParcel_boolArrayAllocator allocator,
                                       AParcel_boolArraySetter setter) {
-    return ReadArray<bool>(parcel, arrayData, allocator, setter, &Parcel::readBool);
+    return ReadArray<bool>(parcel, arrayData, allocator, setter);
 }
 
 binder_status_t AParcel_readCharArray(const AParcel* parcel, void* arrayData,
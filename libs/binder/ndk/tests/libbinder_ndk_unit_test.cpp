@@ -760,6 +760,42 @@ TEST(NdkBinder, ConvertToPlatformParcel) {
     EXPECT_EQ(42, pparcel->readInt32());
 }
 
+TEST(NdkBinder, WidenedArraysMatchPlatformParcel) {
+    const std::vector<char16_t> chars = {u'a', u'\0', 0xffff, 0x8000};
+    const std::vector<bool> bools = {true, false, true};
+
+    ndk::ScopedAParcel parcel = ndk::ScopedAParcel(AParcel_create());
+    EXPECT_EQ(STATUS_OK, ndk::AParcel_writeVector(parcel.get(), chars));
+    EXPECT_EQ(STATUS_OK, ndk::AParcel_writeVector(parcel.get(), bools));
+
+    android::Parcel* pparcel = AParcel_viewPlatformParcel(parcel.get());
+    pparcel->setDataPosition(0);
+    std::vector<char16_t> platformChars;
+    std::vector<bool> platformBools;
+    EXPECT_EQ(OK, pparcel->readCharVector(&platformChars));
+    EXPECT_EQ(OK, pparcel->readBoolVector(&platformBools));
+    EXPECT_EQ(chars, platformChars);
+    EXPECT_EQ(bools, platformBools);
+
+    pparcel->setDataSize(0);
+    EXPECT_EQ(OK, pparcel->writeCharVector(chars));
+    EXPECT_EQ(OK, pparcel->writeBoolVector(bools));
+    pparcel->setDataPosition(0);
+    std::vector<char16_t> ndkChars;
+    std::vector<bool> ndkBools;
+    EXPECT_EQ(STATUS_OK, ndk::AParcel_readVector(parcel.get(), &ndkChars));
+    EXPECT_EQ(STATUS_OK, ndk::AParcel_readVector(parcel.get(), &ndkBools));
+    EXPECT_EQ(chars, ndkChars);
+    EXPECT_EQ(bools, ndkBools);
+
+    // A truncated array fails like it did when the elements were read one by one.
+    pparcel->setDataSize(0);
+    EXPECT_EQ(OK, pparcel->writeInt32(3));
+    EXPECT_EQ(OK, pparcel->writeInt32(u'a'));
+    pparcel->setDataPosition(0);
+    EXPECT_EQ(STATUS_NOT_ENOUGH_DATA, ndk::AParcel_readVector(parcel.get(), &ndkChars));
+}
+
 TEST(NdkBinder, GetAndVerifyScopedAIBinder_Weak) {
     for (const ndk::SpAIBinder& binder :
          {// remote
@@ -16,6 +16,7 @@
 
 #include <android-base/logging.h>
 #include <binder/Binder.h>
+#include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
 #include <binder/Parcel.h>
 #include <binder/RpcServer.h>
@@ -133,6 +134,7 @@ DestructionAction ScopeDisallowMalloc() {
 using android::BBinder;
 using android::defaultServiceManager;
 using android::IBinder;
+using android::IPCThreadState;
 using android::IServiceManager;
 using android::OK;
 using android::Parcel;
@@ -209,6 +211,43 @@ TEST(BinderAllocation, SmallTransaction) {
     EXPECT_EQ(mallocs, 1);
 }
 
+TEST(BinderAllocation, ParcelBufferPool) {
+    IPCThreadState::self()->setParcelBufferPoolEnabled(true);
+    const size_t reusesBefore = Parcel::getGlobalPoolReuseCount();
+    {
+        Parcel p; // first use of each size class allocates
+        p.setDataCapacity(64);
+        p.setDataCapacity(300);
+    }
+    {
+        const auto m = ScopeDisallowMalloc();
+        for (int i = 0; i < 10; i++) {
+            Parcel p;
+            p.setDataCapacity(64);
+            p.writeInt32(i);
+            // grows within the 128 byte class, then moves to the cached 512 byte buffer
+            p.setDataCapacity(100);
+            p.setDataCapacity(300);
+            imaginary_use = p.data();
+        }
+    }
+    EXPECT_EQ(Parcel::getGlobalPoolReuseCount() - reusesBefore, 20u);
+    IPCThreadState::self()->setParcelBufferPoolEnabled(false);
+}
+
+TEST(BinderAllocation, SmallTransactionWithParcelBufferPool) {
+    String16 empty_descriptor = String16("");
+    sp<IServiceManager> manager = defaultServiceManager();
+
+    IPCThreadState::self()->setParcelBufferPoolEnabled(true);
+    manager->checkService(empty_descriptor); // warms up the pool
+    {
+        const auto m = ScopeDisallowMalloc();
+        manager->checkService(empty_descriptor);
+    }
+    IPCThreadState::self()->setParcelBufferPoolEnabled(false);
+}
+
 TEST(RpcBinderAllocation, SetupRpcServer) {
     std::string tmp = getenv("TMPDIR") ?: "/tmp";
     std::string addr = tmp + "/binderRpcBenchmark";
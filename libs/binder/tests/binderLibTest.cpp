@@ -456,6 +456,17 @@ TEST_F(BinderLibTest, AddManagerToManager) {
     EXPECT_EQ(NO_ERROR, sm->addService(String16("binderLibTest-manager"), binder));
 }
 
+TEST_F(BinderLibTest, WaitForServices) {
+    sp<IServiceManager> sm = defaultServiceManager();
+    std::vector<sp<IBinder>> services =
+            sm->waitForServices({String16("manager"), binderLibTestServiceName,
+                                 String16("manager")});
+    ASSERT_EQ(3u, services.size());
+    EXPECT_EQ(IInterface::asBinder(sm), services[0]);
+    EXPECT_EQ(m_server, services[1]);
+    EXPECT_EQ(services[0], services[2]);
+}
+
 TEST_F(BinderLibTest, WasParceled) {
     auto binder = sp<BBinder>::make();
     EXPECT_FALSE(binder->wasParceled());
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <binder/MemoryDealer.h>
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+// Usage: atest binderMemoryDealerBenchmark
+
+using android::IMemory;
+using android::MemoryDealer;
+using android::sp;
+
+static constexpr size_t kHeapSize = 16 * 1024 * 1024;
+
+// Keeps state.range(0) small allocations alive, and replaces a random one of them on every
+// iteration, like a client that carves short-lived buffers out of one heap.
+static void BM_MemoryDealerChurn(benchmark::State& state, MemoryDealer::AllocatorType type) {
+    const sp<MemoryDealer> dealer =
+            sp<MemoryDealer>::make(kHeapSize, "binderMemoryDealerBenchmark", 0, type);
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<size_t> sizes(16, 1024);
+    std::vector<sp<IMemory>> live(state.range(0));
+    for (sp<IMemory>& memory : live) {
+        memory = dealer->allocate(sizes(rng));
+    }
+    std::uniform_int_distribution<size_t> victims(0, live.size() - 1);
+
+    for (auto _ : state) {
+        sp<IMemory>& memory = live[victims(rng)];
+        memory.clear();
+        memory = dealer->allocate(sizes(rng));
+        benchmark::DoNotOptimize(memory.get());
+    }
+    state.counters["fragmentation"] = dealer->getStats().fragmentation();
+}
+BENCHMARK_CAPTURE(BM_MemoryDealerChurn, best_fit, MemoryDealer::AllocatorType::BEST_FIT)
+        ->RangeMultiplier(4)
+        ->Range(16, 4096);
+BENCHMARK_CAPTURE(BM_MemoryDealerChurn, segregated_fit,
+                  MemoryDealer::AllocatorType::SEGREGATED_FIT)
+        ->RangeMultiplier(4)
+        ->Range(16, 4096);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <binder/MemoryDealer.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <vector>
+
+using namespace android;
+
+static constexpr size_t kHeapSize = 64 * 1024;
+
+class MemoryDealerTest : public testing::TestWithParam<MemoryDealer::AllocatorType> {
+protected:
+    sp<MemoryDealer> makeDealer() {
+        return sp<MemoryDealer>::make(kHeapSize, "MemoryDealerTest", 0, GetParam());
+    }
+};
+
+TEST_P(MemoryDealerTest, AllocationsDoNotOverlap) {
+    sp<MemoryDealer> dealer = makeDealer();
+    std::map<ssize_t, sp<IMemory>> allocations;
+    for (size_t size = 1; size < 2048; size += 61) {
+        sp<IMemory> memory = dealer->allocate(size);
+        ASSERT_NE(memory, nullptr) << "size " << size;
+        EXPECT_EQ(memory->size(), size);
+        EXPECT_EQ(memory->offset() % MemoryDealer::getAllocationAlignment(), 0u);
+        allocations[memory->offset()] = memory;
+    }
+    ssize_t end = 0;
+    for (const auto& [offset, memory] : allocations) {
+        EXPECT_GE(offset, end);
+        end = offset + memory->size();
+    }
+    EXPECT_LE(end, ssize_t(kHeapSize));
+}
+
+TEST_P(MemoryDealerTest, FailsWhenFull) {
+    sp<MemoryDealer> dealer = makeDealer();
+    sp<IMemory> all = dealer->allocate(kHeapSize);
+    ASSERT_NE(all, nullptr);
+    EXPECT_EQ(dealer->allocate(1), nullptr);
+    all.clear();
+    EXPECT_NE(dealer->allocate(1), nullptr);
+}
+
+TEST_P(MemoryDealerTest, FreedBlocksAreMerged) {
+    sp<MemoryDealer> dealer = makeDealer();
+    std::vector<sp<IMemory>> allocations;
+    for (size_t i = 0; i < 64; i++) {
+        allocations.push_back(dealer->allocate(100 + i));
+        ASSERT_NE(allocations.back(), nullptr);
+    }
+    // Free every other block first, so that the rest have free blocks on both sides.
+    for (size_t i = 0; i < allocations.size(); i += 2) {
+        allocations[i].clear();
+    }
+    EXPECT_GE(dealer->getStats().freeBlockCount, allocations.size() / 2);
+    allocations.clear();
+
+    MemoryDealer::Stats stats = dealer->getStats();
+    EXPECT_EQ(stats.allocationCount, 0u);
+    EXPECT_EQ(stats.allocatedSize, 0u);
+    EXPECT_EQ(stats.freeBlockCount, 1u);
+    EXPECT_EQ(stats.largestFreeBlock, kHeapSize);
+    EXPECT_EQ(stats.fragmentation(), 0.f);
+    EXPECT_NE(dealer->allocate(kHeapSize), nullptr);
+}
+
+TEST_P(MemoryDealerTest, Stats) {
+    sp<MemoryDealer> dealer = makeDealer();
+    const size_t alignment = MemoryDealer::getAllocationAlignment();
+    sp<IMemory> a = dealer->allocate(1);
+    sp<IMemory> b = dealer->allocate(alignment * 4);
+    sp<IMemory> c = dealer->allocate(alignment + 1);
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    ASSERT_NE(c, nullptr);
+
+    MemoryDealer::Stats stats = dealer->getStats();
+    EXPECT_EQ(stats.heapSize, kHeapSize);
+    EXPECT_EQ(stats.allocationCount, 3u);
+    EXPECT_EQ(stats.allocatedSize, alignment * 7);
+    EXPECT_EQ(stats.freeSize, kHeapSize - alignment * 7);
+    EXPECT_EQ(stats.largestFreeBlock, stats.freeSize);
+
+    // Freeing the block in the middle leaves a hole.
+    b.clear();
+    stats = dealer->getStats();
+    EXPECT_EQ(stats.allocationCount, 2u);
+    EXPECT_EQ(stats.freeSize, kHeapSize - alignment * 3);
+    EXPECT_EQ(stats.freeBlockCount, 2u);
+    EXPECT_EQ(stats.largestFreeBlock, kHeapSize - alignment * 7);
+    EXPECT_GT(stats.fragmentation(), 0.f);
+}
+
+INSTANTIATE_TEST_SUITE_P(MemoryDealer, MemoryDealerTest,
+                         testing::Values(MemoryDealer::AllocatorType::BEST_FIT,
+                                         MemoryDealer::AllocatorType::SEGREGATED_FIT),
+                         [](const testing::TestParamInfo<MemoryDealer::AllocatorType>& info) {
+                             return info.param == MemoryDealer::AllocatorType::BEST_FIT
+                                     ? "BestFit"
+                                     : "SegregatedFit";
+                         });
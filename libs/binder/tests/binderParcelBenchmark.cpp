@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <android/binder_ibinder.h>
+#include <android/binder_parcel_utils.h>
 #include <binder/Parcel.h>
 #include <benchmark/benchmark.h>
 
@@ -169,4 +171,150 @@ BENCHMARK(BM_CharVector)->Apply(VectorArgs);
 BENCHMARK(BM_Int32Vector)->Apply(VectorArgs);
 BENCHMARK(BM_Int64Vector)->Apply(VectorArgs);
 
+// Strings as they show up in AIDL calls: package names and descriptors, window titles, and
+// localized labels.
+static const std::vector<std::string> kStringMixes = {
+        "com.google.android.apps.nexuslauncher",
+        "com.android.systemui/com.android.systemui.statusbar.phone.StatusBarWindowView#0",
+        "Paramètres du réseau et d'Internet — Wi‑Fi",
+        "設定 - ネットワークとインターネット",
+        "Chat 💬 with the team 👩‍💻",
+};
+
+static void StringMixArgs(benchmark::internal::Benchmark* b) {
+    for (size_t i = 0; i < kStringMixes.size(); ++i) {
+        b->Args({static_cast<int64_t>(i)});
+    }
+}
+
+/*
+  UTF-8 strings written as UTF-16, which is how AIDL sends std::string and @utf8InCpp String.
+*/
+static void BM_Utf8AsUtf16(benchmark::State& state) {
+    const std::string& s = kStringMixes[state.range(0)];
+    android::Parcel p;
+    while (state.KeepRunning()) {
+        p.setDataPosition(0);
+        p.writeUtf8AsUtf16(s);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * s.size());
+}
+
+static void BM_Utf8FromUtf16(benchmark::State& state) {
+    const std::string& s = kStringMixes[state.range(0)];
+    android::Parcel p;
+    p.writeUtf8AsUtf16(s);
+    std::string out;
+    while (state.KeepRunning()) {
+        p.setDataPosition(0);
+        p.readUtf8FromUtf16(&out);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * s.size());
+}
+
+BENCHMARK(BM_Utf8AsUtf16)->Apply(StringMixArgs);
+BENCHMARK(BM_Utf8FromUtf16)->Apply(StringMixArgs);
+
+/*
+  The same arrays through the NDK, which AIDL's ndk backend uses. char16_t and bool elements are
+  widened to an int32_t each, which the NDK does in bulk. The element-wise variants write the same
+  bytes one AParcel call at a time, for comparison.
+*/
+template <typename T>
+static void BM_NdkParcelVector(benchmark::State& state) {
+    const std::vector<T> v1(state.range(0));
+    std::vector<T> v2;
+    AParcel* p = AParcel_create();
+    while (state.KeepRunning()) {
+        AParcel_setDataPosition(p, 0);
+        ndk::AParcel_writeVector(p, v1);
+
+        AParcel_setDataPosition(p, 0);
+        ndk::AParcel_readVector(p, &v2);
+
+        benchmark::DoNotOptimize(v2.data());
+        benchmark::ClobberMemory();
+    }
+    AParcel_delete(p);
+    state.SetComplexityN(state.range(0));
+}
+
+template <typename T>
+static void BM_NdkParcelVectorElementwise(benchmark::State& state) {
+    const std::vector<T> v1(state.range(0));
+    std::vector<T> v2;
+    AParcel* p = AParcel_create();
+    while (state.KeepRunning()) {
+        AParcel_setDataPosition(p, 0);
+        AParcel_writeInt32(p, static_cast<int32_t>(v1.size()));
+        for (T value : v1) {
+            if constexpr (std::is_same_v<T, bool>) {
+                AParcel_writeBool(p, value);
+            } else {
+                AParcel_writeChar(p, value);
+            }
+        }
+
+        AParcel_setDataPosition(p, 0);
+        int32_t size = 0;
+        AParcel_readInt32(p, &size);
+        v2.resize(size);
+        for (int32_t i = 0; i < size; i++) {
+            T value;
+            if constexpr (std::is_same_v<T, bool>) {
+                AParcel_readBool(p, &value);
+            } else {
+                AParcel_readChar(p, &value);
+            }
+            v2[i] = value;
+        }
+
+        benchmark::DoNotOptimize(v2.data());
+        benchmark::ClobberMemory();
+    }
+    AParcel_delete(p);
+    state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_NdkParcelVector, bool)->Apply(VectorArgs);
+BENCHMARK_TEMPLATE(BM_NdkParcelVectorElementwise, bool)->Apply(VectorArgs);
+BENCHMARK_TEMPLATE(BM_NdkParcelVector, char16_t)->Apply(VectorArgs);
+BENCHMARK_TEMPLATE(BM_NdkParcelVectorElementwise, char16_t)->Apply(VectorArgs);
+BENCHMARK_TEMPLATE(BM_NdkParcelVector, int32_t)->Apply(VectorArgs);
+
+/*
+  The interface checks that every incoming transaction and every NDK interface wrapper goes
+  through.
+*/
+static const char kDescriptor[] = "android.os.IBinderParcelBenchmarkInterface";
+
+static void BM_EnforceInterface(benchmark::State& state) {
+    const android::String16 descriptor(kDescriptor);
+    android::Parcel p;
+    p.writeInterfaceToken(descriptor);
+    while (state.KeepRunning()) {
+        p.setDataPosition(0);
+        benchmark::DoNotOptimize(p.enforceInterface(descriptor));
+    }
+}
+
+static void BM_NdkAssociateClass(benchmark::State& state) {
+    AIBinder_Class* clazz =
+            AIBinder_Class_define(kDescriptor, [](void* args) { return args; }, [](void*) {},
+                                  [](AIBinder*, transaction_code_t, const AParcel*, AParcel*) {
+                                      return STATUS_UNKNOWN_TRANSACTION;
+                                  });
+    AIBinder* binder = AIBinder_new(clazz, nullptr);
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(AIBinder_associateClass(binder, clazz));
+    }
+    AIBinder_decStrong(binder);
+}
+
+BENCHMARK(BM_EnforceInterface);
+BENCHMARK(BM_NdkAssociateClass);
+
 BENCHMARK_MAIN();
@@ -16,6 +16,7 @@
 
 #include <binder/IPCThreadState.h>
 #include <binder/Parcel.h>
+#include <binder/RpcSession.h>
 #include <binder/Status.h>
 #include <cutils/ashmem.h>
 #include <gtest/gtest.h>
@@ -25,6 +26,7 @@ using android::IBinder;
 using android::IPCThreadState;
 using android::OK;
 using android::Parcel;
+using android::RpcSession;
 using android::sp;
 using android::status_t;
 using android::String16;
@@ -154,6 +156,34 @@ TEST(Parcel, Utf8AsUtf16Write) {
     });
 }
 
+TEST(Parcel, Utf8Utf16RoundTripMatchesLibutils) {
+    // Long enough to go through the vectorized ASCII runs, with code points of every length
+    // around and inside them.
+    const std::vector<std::string> tokens = {
+            "com.android.systemui/com.android.systemui.statusbar.phone.StatusBarWindowView",
+            "Paramètres du réseau et d'Internet — Wi‑Fi",
+            "設定 - ネットワークとインターネット",
+            "0123456789abcdef💬0123456789abcdef👩‍💻",
+    };
+    for (const std::string& token : tokens) {
+        const String16 token16(token.c_str(), token.size());
+        parcelOpSameLength([&] (Parcel* p) {
+            p->writeUtf8AsUtf16(token);
+        }, [&] (Parcel* p) {
+            String16 s;
+            EXPECT_EQ(OK, p->readString16(&s));
+            EXPECT_EQ(token16, s);
+        });
+        parcelOpSameLength([&] (Parcel* p) {
+            p->writeString16(token16);
+        }, [&] (Parcel* p) {
+            std::string s;
+            EXPECT_EQ(OK, p->readUtf8FromUtf16(&s));
+            EXPECT_EQ(token, s);
+        });
+    }
+}
+
 template <typename T>
 using readFunc = status_t (Parcel::*)(T* out) const;
 template <typename T>
@@ -214,3 +244,23 @@ TEST(Parcel, GetOpenAshmemSize) {
         ASSERT_EQ((kSize * (i + 1)), p.getOpenAshmemSize());
     }
 }
+
+TEST(Parcel, LargeBlobOverRpcWithoutFds) {
+    constexpr size_t kBlobSize = 64 * 1024;
+
+    Parcel p;
+    p.markForRpc(RpcSession::make());
+
+    Parcel::WritableBlob writeBlob;
+    ASSERT_EQ(OK, p.writeBlob(kBlobSize, false /*mutableCopy*/, &writeBlob));
+    // the session can't carry file descriptors, so the blob must be written in place
+    EXPECT_EQ(-1, writeBlob.fd());
+    memset(writeBlob.data(), 'a', kBlobSize);
+    writeBlob.release();
+
+    p.setDataPosition(0);
+    Parcel::ReadableBlob readBlob;
+    ASSERT_EQ(OK, p.readBlob(kBlobSize, &readBlob));
+    EXPECT_EQ('a', static_cast<const char*>(readBlob.data())[kBlobSize - 1]);
+    readBlob.release();
+}
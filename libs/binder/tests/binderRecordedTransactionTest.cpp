@@ -18,10 +18,15 @@
 #include <gtest/gtest.h>
 #include <utils/Errors.h>
 
+#include "../TransactionRecorder.h"
+
 using android::Parcel;
 using android::status_t;
 using android::base::unique_fd;
 using android::binder::debug::RecordedTransaction;
+using android::binder::debug::RecordingOptions;
+using android::binder::debug::RecordingStats;
+using android::binder::debug::TransactionRecorder;
 
 TEST(BinderRecordedTransaction, RoundTripEncoding) {
     android::String16 interfaceName("SampleInterface");
@@ -138,3 +143,64 @@ TEST(BinderRecordedTransaction, PayloadsExceedPageBoundaries) {
         EXPECT_EQ(retrievedTransaction->getReplyParcel().readInt32(), 99);
     }
 }
+
+TEST(BinderRecordedTransaction, EncodeMatchesDumpToFile) {
+    android::String16 interfaceName("SampleInterface");
+    Parcel d;
+    d.writeInt32(12);
+    d.writeInt64(2);
+    Parcel r;
+    r.writeInt32(99);
+    timespec ts = {1232456, 567890};
+    auto transaction = RecordedTransaction::fromDetails(interfaceName, 1, 42, ts, d, r, 0);
+    ASSERT_TRUE(transaction.has_value());
+
+    auto file = std::tmpfile();
+    auto fd = unique_fd(fcntl(fileno(file), F_DUPFD, 1));
+    ASSERT_EQ(android::NO_ERROR, transaction->dumpToFile(fd));
+    std::vector<std::byte> dumped(lseek(fd.get(), 0, SEEK_END));
+    ASSERT_EQ(pread(fd.get(), dumped.data(), dumped.size(), 0), ssize_t(dumped.size()));
+
+    std::vector<std::byte> encoded;
+    ASSERT_EQ(android::NO_ERROR,
+              RecordedTransaction::encode(interfaceName, 1, 42, ts, d, r, 0, &encoded));
+    EXPECT_EQ(encoded, dumped);
+}
+
+TEST(BinderRecordedTransaction, AsyncRecorderFiltersAndSamples) {
+    android::String16 interfaceName("SampleInterface");
+    auto file = std::tmpfile();
+    auto fd = unique_fd(fcntl(fileno(file), F_DUPFD, 1));
+
+    RecordingOptions options;
+    options.async = true;
+    options.sampleInterval = 2;
+    options.codes = {1, 3};
+    RecordingStats stats;
+    {
+        auto recorder = std::make_unique<TransactionRecorder>(unique_fd(dup(fd.get())), options);
+        for (int32_t i = 0; i < 100; i++) {
+            const uint32_t code = i % 4;
+            if (recorder->shouldRecord(code)) {
+                Parcel d;
+                d.writeInt32(i);
+                recorder->record(interfaceName, code, 0, d, Parcel(), 0);
+            }
+        }
+        stats = recorder->getStats();
+        // Destroying the recorder waits for the writer.
+    }
+    EXPECT_EQ(stats.filtered, 50u);
+    EXPECT_EQ(stats.sampledOut, 25u);
+    EXPECT_EQ(stats.dropped, 0u);
+    EXPECT_EQ(stats.failed, 0u);
+
+    std::rewind(file);
+    for (int32_t i = 1; i < 100; i += 4) {
+        auto retrievedTransaction = RecordedTransaction::fromFile(fd);
+        ASSERT_TRUE(retrievedTransaction.has_value());
+        EXPECT_EQ(retrievedTransaction->getCode(), uint32_t(i % 4));
+        EXPECT_EQ(retrievedTransaction->getDataParcel().readInt32(), i);
+    }
+    EXPECT_FALSE(RecordedTransaction::fromFile(fd).has_value());
+}
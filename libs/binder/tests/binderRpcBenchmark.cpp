@@ -91,10 +91,22 @@ static const std::initializer_list<int64_t> kTransportList = {
 };
 
 std::unique_ptr<RpcTransportCtxFactory> makeFactoryTls() {
-    auto pkey = android::makeKeyPairForSelfSignedCert();
-    CHECK_NE(pkey.get(), nullptr);
-    auto cert = android::makeSelfSignedCert(pkey.get(), android::kCertValidSeconds);
-    CHECK_NE(cert.get(), nullptr);
+    // Generating a key is slow and would dominate BM_setupSession, which makes a factory per
+    // session, so all factories share one.
+    static EVP_PKEY* sPkey = [] {
+        auto pkey = android::makeKeyPairForSelfSignedCert();
+        CHECK_NE(pkey.get(), nullptr);
+        return pkey.release();
+    }();
+    static X509* sCert = [] {
+        auto cert = android::makeSelfSignedCert(sPkey, android::kCertValidSeconds);
+        CHECK_NE(cert.get(), nullptr);
+        return cert.release();
+    }();
+    CHECK_EQ(1, EVP_PKEY_up_ref(sPkey));
+    bssl::UniquePtr<EVP_PKEY> pkey(sPkey);
+    CHECK_EQ(1, X509_up_ref(sCert));
+    bssl::UniquePtr<X509> cert(sCert);
 
     auto verifier = std::make_shared<RpcCertificateVerifierNoOp>(OK);
     auto auth = std::make_unique<RpcAuthPreSigned>(std::move(pkey), std::move(cert));
@@ -107,6 +119,14 @@ static sp<IBinder> gRpcBinder;
 // Skip certificate validation to simplify the setup process.
 static sp<RpcSession> gSessionTls = RpcSession::make(makeFactoryTls());
 static sp<IBinder> gRpcTlsBinder;
+// Session whose server has a thread (and so the client a connection) per concurrent caller.
+static constexpr size_t kMaxConcurrency = 64;
+static sp<RpcSession> gSessionConcurrent = RpcSession::make();
+static sp<IBinder> gRpcConcurrentBinder;
+// Servers that allow enough threads for every connection that BM_setupSession makes.
+static constexpr size_t kMaxSetupConnections = 8;
+static std::string gSetupAddr;
+static std::string gSetupTlsAddr;
 #ifdef __BIONIC__
 static const String16 kKernelBinderInstance = String16(u"binderRpcBenchmark-control");
 static sp<IBinder> gKernelBinder;
@@ -204,6 +224,54 @@ void BM_repeatBinder(benchmark::State& state) {
 }
 BENCHMARK(BM_repeatBinder)->ArgsProduct({kTransportList});
 
+// Synchronous calls from 1/8/64 threads at once. RPC binder dedicates a connection to each
+// outstanding synchronous call, so this compares a session with a single connection against one
+// with a connection per caller. Real time per iteration is the per-call latency seen by each
+// thread, and items_per_second is the aggregate throughput.
+void BM_concurrentRepeatString(benchmark::State& state) {
+    sp<IBinder> binder = state.range(0) == 1 ? gRpcBinder : gRpcConcurrentBinder;
+    sp<IBinderRpcBenchmark> iface = interface_cast<IBinderRpcBenchmark>(binder);
+    CHECK(iface != nullptr);
+
+    std::string str(64, 'a');
+    std::string out;
+    while (state.KeepRunning()) {
+        Status ret = iface->repeatString(str, &out);
+        CHECK(ret.isOk()) << ret;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_concurrentRepeatString)
+        ->ArgName("connections")
+        ->Arg(1)
+        ->Arg(kMaxConcurrency)
+        ->Threads(1)
+        ->Threads(8)
+        ->Threads(kMaxConcurrency)
+        ->UseRealTime();
+
+// Sets up (and shuts down) a session with 1/8 connections. With TLS, each connection does a
+// handshake, and all but the first resume the TLS session of the first.
+void BM_setupSession(benchmark::State& state) {
+    Transport transport = static_cast<Transport>(state.range(0));
+    size_t connections = state.range(1);
+
+    while (state.KeepRunning()) {
+        sp<RpcSession> session =
+                transport == RPC_TLS ? RpcSession::make(makeFactoryTls()) : RpcSession::make();
+        session->setMaxOutgoingConnections(connections);
+        const std::string& addr = transport == RPC_TLS ? gSetupTlsAddr : gSetupAddr;
+        status_t status = session->setupUnixDomainClient(addr.c_str());
+        CHECK_EQ(status, OK) << statusToString(status);
+
+        state.PauseTiming();
+        CHECK(session->shutdownAndWait(true));
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_setupSession)
+        ->ArgsProduct({{Transport::RPC, Transport::RPC_TLS}, {1, kMaxSetupConnections}});
+
 void forkRpcServer(const char* addr, const sp<RpcServer>& server) {
     if (0 == fork()) {
         prctl(PR_SET_PDEATHSIG, SIGHUP); // racey, okay
@@ -264,6 +332,35 @@ int main(int argc, char** argv) {
     setupClient(gSessionTls, tlsAddr.c_str());
     gRpcTlsBinder = gSessionTls->getRootObject();
 
+    std::string concurrentAddr = tmp + "/binderRpcConcurrentBenchmark";
+    (void)unlink(concurrentAddr.c_str());
+    sp<RpcServer> concurrentServer = RpcServer::make(RpcTransportCtxFactoryRaw::make());
+    concurrentServer->setMaxThreads(kMaxConcurrency);
+    forkRpcServer(concurrentAddr.c_str(), concurrentServer);
+    gSessionConcurrent->setMaxOutgoingConnections(kMaxConcurrency);
+    setupClient(gSessionConcurrent, concurrentAddr.c_str());
+    gRpcConcurrentBinder = gSessionConcurrent->getRootObject();
+
+    gSetupAddr = tmp + "/binderRpcSetupBenchmark";
+    (void)unlink(gSetupAddr.c_str());
+    sp<RpcServer> setupServer = RpcServer::make(RpcTransportCtxFactoryRaw::make());
+    setupServer->setMaxThreads(kMaxSetupConnections);
+    forkRpcServer(gSetupAddr.c_str(), setupServer);
+
+    gSetupTlsAddr = tmp + "/binderRpcSetupTlsBenchmark";
+    (void)unlink(gSetupTlsAddr.c_str());
+    sp<RpcServer> setupTlsServer = RpcServer::make(makeFactoryTls());
+    setupTlsServer->setMaxThreads(kMaxSetupConnections);
+    forkRpcServer(gSetupTlsAddr.c_str(), setupTlsServer);
+
+    // BM_setupSession doesn't retry, so wait for both servers to listen.
+    sp<RpcSession> setupSession = RpcSession::make();
+    setupClient(setupSession, gSetupAddr.c_str());
+    CHECK(setupSession->shutdownAndWait(true));
+    sp<RpcSession> setupTlsSession = RpcSession::make(makeFactoryTls());
+    setupClient(setupTlsSession, gSetupTlsAddr.c_str());
+    CHECK(setupTlsSession->shutdownAndWait(true));
+
     ::benchmark::RunSpecifiedBenchmarks();
     return 0;
 }
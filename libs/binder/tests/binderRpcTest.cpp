@@ -1392,6 +1392,43 @@ TEST_P(BinderRpcServerOnly, Shutdown) {
             << "After server->shutdown() returns true, join() did not stop after 2s";
 }
 
+TEST(BinderRpc, EventLoopServesIdleSessions) {
+    if constexpr (!kEnableRpcThreads) {
+        GTEST_SKIP() << "Test skipped because threads were disabled at build time";
+    }
+
+    auto addr = allocateSocketAddress();
+    auto server = RpcServer::make();
+    server->setMaxThreads(2);
+    server->setEventLoopThreads(2);
+    server->setRootObject(sp<BBinder>::make());
+    ASSERT_EQ(OK, server->setupUnixDomainServer(addr.c_str()));
+    server->start();
+
+    // Many more connections than the event loop has threads, which are idle
+    // most of the time.
+    std::vector<sp<RpcSession>> sessions;
+    for (size_t i = 0; i < 16; i++) {
+        auto session = RpcSession::make();
+        session->setMaxOutgoingConnections(2);
+        ASSERT_EQ(OK, session->setupUnixDomainClient(addr.c_str()));
+        sessions.push_back(session);
+    }
+    for (size_t round = 0; round < 2; round++) {
+        for (const auto& session : sessions) {
+            auto root = session->getRootObject();
+            ASSERT_NE(nullptr, root);
+            EXPECT_EQ(OK, root->pingBinder());
+        }
+    }
+    EXPECT_EQ(sessions.size(), server->listSessions().size());
+
+    for (const auto& session : sessions) {
+        EXPECT_TRUE(session->shutdownAndWait(true));
+    }
+    EXPECT_TRUE(server->shutdown());
+}
+
 INSTANTIATE_TEST_CASE_P(BinderRpc, BinderRpcServerOnly,
                         ::testing::Combine(::testing::ValuesIn(RpcSecurityValues()),
                                            ::testing::ValuesIn(testVersions())),
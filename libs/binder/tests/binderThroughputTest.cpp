@@ -21,6 +21,15 @@ enum BinderWorkerServiceCode {
     BINDER_NOP = IBinder::FIRST_CALL_TRANSACTION,
 };
 
+enum class CallMode {
+    // One synchronous call to a single worker per iteration.
+    SYNC,
+    // A oneway call to every other server per iteration, one ioctl per call.
+    ONEWAY_FANOUT,
+    // Like ONEWAY_FANOUT, but corked so that each iteration is a single ioctl.
+    CORKED_ONEWAY_FANOUT,
+};
+
 #define ASSERT_TRUE(cond) \
 do { \
     if (!(cond)) {\
@@ -168,6 +177,23 @@ struct ProcResults {
     }
 };
 
+status_t fan_out_oneway(const vector<sp<IBinder> >& targets, const Parcel& data, bool corked)
+{
+    if (corked) {
+        IPCThreadState::self()->corkOnewayTransactions();
+    }
+    status_t ret = NO_ERROR;
+    for (const sp<IBinder>& target : targets) {
+        status_t err = target->transact(BINDER_NOP, data, nullptr, IBinder::FLAG_ONEWAY);
+        if (ret == NO_ERROR) ret = err;
+    }
+    if (corked) {
+        status_t err = IPCThreadState::self()->uncorkOnewayTransactions();
+        if (ret == NO_ERROR) ret = err;
+    }
+    return ret;
+}
+
 String16 generateServiceName(int num)
 {
     char num_str[32];
@@ -181,6 +207,7 @@ void worker_fx(int num,
                int iterations,
                int payload_size,
                bool cs_pair,
+               CallMode mode,
                Pipe p)
 {
     // Create BinderWorkerService and for go.
@@ -220,7 +247,12 @@ void worker_fx(int num,
             sz -= sizeof(uint32_t);
         }
         start = chrono::high_resolution_clock::now();
-        status_t ret = workers[target]->transact(BINDER_NOP, data, &reply);
+        status_t ret;
+        if (mode == CallMode::SYNC) {
+            ret = workers[target]->transact(BINDER_NOP, data, &reply);
+        } else {
+            ret = fan_out_oneway(workers, data, mode == CallMode::CORKED_ONEWAY_FANOUT);
+        }
         end = chrono::high_resolution_clock::now();
 
         uint64_t cur_time = uint64_t(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
@@ -243,7 +275,8 @@ void worker_fx(int num,
     exit(EXIT_SUCCESS);
 }
 
-Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bool cs_pair)
+Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bool cs_pair,
+                 CallMode mode)
 {
     auto pipe_pair = Pipe::createPipePair();
     pid_t pid = fork();
@@ -252,7 +285,7 @@ Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bo
         return std::move(get<0>(pipe_pair));
     } else {
         /* child */
-        worker_fx(num, worker_count, iterations, payload_size, cs_pair,
+        worker_fx(num, worker_count, iterations, payload_size, cs_pair, mode,
                   std::move(get<1>(pipe_pair)));
         /* never get here */
         return std::move(get<0>(pipe_pair));
@@ -278,12 +311,13 @@ void run_main(int iterations,
               int workers,
               int payload_size,
               int cs_pair,
+              CallMode mode,
               bool training_round=false)
 {
     vector<Pipe> pipes;
     // Create all the workers and wait for them to spawn.
     for (int i = 0; i < workers; i++) {
-        pipes.push_back(make_worker(i, iterations, workers, payload_size, cs_pair));
+        pipes.push_back(make_worker(i, iterations, workers, payload_size, cs_pair, mode));
     }
     wait_all(pipes);
 
@@ -337,6 +371,7 @@ int main(int argc, char *argv[])
     int payload_size = 0;
     bool cs_pair = false;
     bool training_round = false;
+    CallMode mode = CallMode::SYNC;
     (void)argc;
     (void)argv;
 
@@ -344,8 +379,10 @@ int main(int argc, char *argv[])
     for (int i = 1; i < argc; i++) {
         if (string(argv[i]) == "--help") {
             cout << "Usage: binderThroughputTest [OPTIONS]" << endl;
+            cout << "\t-c      : Like -o, but cork each fan-out into a single ioctl." << endl;
             cout << "\t-i N    : Specify number of iterations." << endl;
             cout << "\t-m N    : Specify expected max latency in microseconds." << endl;
+            cout << "\t-o      : Send a oneway call to every other server per iteration." << endl;
             cout << "\t-p      : Split workers into client/server pairs." << endl;
             cout << "\t-s N    : Specify payload size." << endl;
             cout << "\t-t N    : Run training round." << endl;
@@ -366,6 +403,12 @@ int main(int argc, char *argv[])
             payload_size = atoi(argv[i+1]);
             i++;
         }
+        if (string(argv[i]) == "-o") {
+            mode = CallMode::ONEWAY_FANOUT;
+        }
+        if (string(argv[i]) == "-c") {
+            mode = CallMode::CORKED_ONEWAY_FANOUT;
+        }
         if (string(argv[i]) == "-p") {
             // client/server pairs instead of spreading
             // requests to all workers. If true, half
@@ -393,10 +436,10 @@ int main(int argc, char *argv[])
 
     if (training_round) {
         cout << "Start training round" << endl;
-        run_main(iterations, workers, payload_size, cs_pair, training_round=true);
+        run_main(iterations, workers, payload_size, cs_pair, mode, training_round=true);
         cout << "Completed training round" << endl << endl;
     }
 
-    run_main(iterations, workers, payload_size, cs_pair);
+    run_main(iterations, workers, payload_size, cs_pair, mode);
     return 0;
 }
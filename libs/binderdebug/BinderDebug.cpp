@@ -18,6 +18,8 @@
 #include <android-base/parseint.h>
 #include <android-base/strings.h>
 #include <binder/Binder.h>
+#include <inttypes.h>
+#include <stdio.h>
 #include <sys/types.h>
 #include <fstream>
 #include <regex>
@@ -199,4 +201,171 @@ status_t getBinderClientPids(BinderDebugContext context, pid_t pid, pid_t servic
     return ret;
 }
 
+static status_t scanBinderStats(const std::string& contextName,
+                                std::function<void(pid_t, const std::string&)> eachLine) {
+    std::ifstream ifs("/dev/binderfs/binder_logs/stats");
+    if (!ifs.is_open()) {
+        ifs.open("/d/binder/stats");
+        if (!ifs.is_open()) {
+            return -errno;
+        }
+    }
+
+    pid_t pid = -1;
+    bool isDesiredContext = false;
+    std::string line;
+    while (getline(ifs, line)) {
+        if (base::StartsWith(line, "proc ")) {
+            if (!base::ParseInt(line.substr(5), &pid)) {
+                pid = -1;
+            }
+            isDesiredContext = false;
+            continue;
+        }
+        if (pid == -1) {
+            continue;
+        }
+        if (base::StartsWith(line, "context")) {
+            isDesiredContext = base::Split(line, " ").back() == contextName;
+            continue;
+        }
+        if (!isDesiredContext) {
+            continue;
+        }
+        eachLine(pid, line);
+    }
+    return OK;
+}
+
+// Examples of what we are looking at, in the stats file:
+// proc 1773
+// context binder
+//   threads: 18
+//   requested threads: 0+11/15
+//   ready threads 4
+//   free async space 520192
+//   nodes: 41
+//   refs: 87 s 87 w 87
+//   buffers: 0
+//   pages: 0:2:254
+//   pending transactions: 0
+//   BC_TRANSACTION: 2052
+//   BR_REPLY: 2052
+// Returns true if the line is the threads line, which every process has.
+static bool parseProcStatsLine(const std::string& line, BinderProcStats* stats) {
+    if (sscanf(line.c_str(), "  threads: %" SCNu32, &stats->threadPool.threadCount) == 1) {
+        return true;
+    }
+    if (sscanf(line.c_str(), "  requested threads: %" SCNu32 "+%" SCNu32 "/%" SCNu32,
+               &stats->threadPool.requestedThreads, &stats->threadPool.requestedThreadsStarted,
+               &stats->threadPool.maxThreads) == 3 ||
+        sscanf(line.c_str(), "  ready threads %" SCNu32, &stats->threadPool.readyThreads) == 1 ||
+        sscanf(line.c_str(), "  free async space %" SCNu64, &stats->freeAsyncSpace) == 1 ||
+        sscanf(line.c_str(), "  nodes: %" SCNu32, &stats->nodes) == 1 ||
+        sscanf(line.c_str(), "  refs: %" SCNu32, &stats->refs) == 1 ||
+        sscanf(line.c_str(), "  buffers: %" SCNu32, &stats->buffers) == 1 ||
+        sscanf(line.c_str(), "  pending transactions: %" SCNu32,
+               &stats->pendingTransactions) == 1) {
+        return false;
+    }
+    if (base::StartsWith(line, "  BC_") || base::StartsWith(line, "  BR_")) {
+        auto pos = line.find(": ");
+        uint64_t count;
+        if (pos != std::string::npos && base::ParseUint(line.substr(pos + 2), &count)) {
+            stats->commands[line.substr(2, pos - 2)] = count;
+        }
+    }
+    return false;
+}
+
+status_t getBinderThreadPoolInfo(BinderDebugContext context, pid_t pid,
+                                 BinderThreadPoolInfo* info) {
+    BinderProcStats stats = {};
+    stats.threadPool = *info;
+    bool found = false;
+    status_t ret = scanBinderStats(contextToString(context),
+                                   [&](pid_t linePid, const std::string& line) {
+        if (linePid == pid) {
+            found |= parseProcStatsLine(line, &stats);
+        }
+    });
+    if (ret != OK) {
+        return ret;
+    }
+    *info = stats.threadPool;
+    return found ? OK : NAME_NOT_FOUND;
+}
+
+status_t getBinderProcStats(BinderDebugContext context, std::map<pid_t, BinderProcStats>* stats) {
+    stats->clear();
+    return scanBinderStats(contextToString(context), [&](pid_t pid, const std::string& line) {
+        parseProcStatsLine(line, &(*stats)[pid]);
+    });
+}
+
+// Examples of what we are looking at:
+// node 66730: u00007590061890e0 c0000759036130950 pri 0:120 hs 1 hw 1 ls 0 lw 0 is 2 iw 2 tr 1 proc 2300 1790
+status_t getBinderNodeStats(BinderDebugContext context, pid_t pid,
+                            std::vector<BinderNodeStats>* nodes) {
+    std::string contextStr = contextToString(context);
+    return scanBinderContext(pid, contextStr, [&](const std::string& line) {
+        if (!base::StartsWith(line, "  node")) return;
+
+        std::vector<std::string> splitString = base::Tokenize(line, " ");
+        if (splitString.size() < 2) return;
+
+        BinderNodeStats node = {};
+        // remove the colon
+        const std::string nodeString = splitString[1].substr(0, splitString[1].size() - 1);
+        if (!::android::base::ParseInt(nodeString.c_str(), &node.id)) {
+            LOG(ERROR) << "Failed to parse node int: " << nodeString;
+            return;
+        }
+        bool pidsSection = false;
+        for (size_t i = 2; i < splitString.size(); ++i) {
+            const std::string& token = splitString[i];
+            if (pidsSection) {
+                int32_t clientPid;
+                if (::android::base::ParseInt(token.c_str(), &clientPid)) {
+                    node.clientPids.push_back(clientPid);
+                }
+            } else if (token == "proc") {
+                pidsSection = true;
+            } else if (token == "tr" && i + 1 < splitString.size()) {
+                ::android::base::ParseUint(splitString[++i].c_str(), &node.pendingAsync);
+            } else if (base::StartsWith(token, "u")) {
+                ::android::base::ParseUint(("0x" + token.substr(1)).c_str(), &node.ptr);
+            }
+        }
+        nodes->push_back(std::move(node));
+    });
+}
+
+status_t BinderStatsMonitor::poll(std::map<pid_t, BinderProcStats>* deltas) {
+    std::map<pid_t, BinderProcStats> current;
+    status_t ret = getBinderProcStats(mContext, &current);
+    if (ret != OK) {
+        return ret;
+    }
+
+    *deltas = current;
+    for (auto& [pid, delta] : *deltas) {
+        auto last = mLast.find(pid);
+        if (last == mLast.end()) {
+            continue;
+        }
+        for (auto it = delta.commands.begin(); it != delta.commands.end();) {
+            auto lastCount = last->second.commands.find(it->first);
+            if (lastCount != last->second.commands.end()) {
+                // A pid reused by a new process starts counting from zero again.
+                it->second = it->second >= lastCount->second ? it->second - lastCount->second
+                                                             : it->second;
+            }
+            it = it->second == 0 ? delta.commands.erase(it) : std::next(it);
+        }
+    }
+    mLast = std::move(current);
+    return OK;
+}
+
 } // namespace  android
@@ -18,6 +18,7 @@
 #include <utils/Errors.h>
 
 #include <map>
+#include <string>
 #include <vector>
 
 namespace android {
@@ -28,6 +29,34 @@ struct BinderPidInfo {
     uint32_t threadCount;                           // number of threads total
 };
 
+// Thread pool of a process as seen by the driver
+struct BinderThreadPoolInfo {
+    uint32_t threadCount;             // number of threads known to the driver
+    uint32_t requestedThreads;        // looper threads requested but not started yet
+    uint32_t requestedThreadsStarted; // looper threads started on request of the driver
+    uint32_t maxThreads;              // max number of looper threads the driver requests
+    uint32_t readyThreads;            // threads waiting for work
+};
+
+// Counters and gauges of a process as seen by the driver
+struct BinderProcStats {
+    BinderThreadPoolInfo threadPool;
+    uint64_t freeAsyncSpace;                  // bytes left for incoming oneway transactions
+    uint32_t nodes;                           // binder objects hosted by the process
+    uint32_t refs;                            // references to binder objects of other processes
+    uint32_t buffers;                         // transaction buffers in use
+    uint32_t pendingTransactions;             // transactions queued for the process
+    std::map<std::string, uint64_t> commands; // e.g. BC_TRANSACTION -> count since start
+};
+
+// Binder object hosted by a process
+struct BinderNodeStats {
+    int32_t id;                    // debug id of the node
+    uint64_t ptr;                  // address of the object in the hosting process
+    uint32_t pendingAsync;         // oneway transactions queued on the node
+    std::vector<pid_t> clientPids; // processes which hold a reference to the node
+};
+
 enum class BinderDebugContext {
     BINDER,
     HWBINDER,
@@ -44,4 +73,39 @@ status_t getBinderPidInfo(BinderDebugContext context, pid_t pid, BinderPidInfo*
 status_t getBinderClientPids(BinderDebugContext context, pid_t pid, pid_t servicePid,
                              int32_t handle, std::vector<pid_t>* pids);
 
+/**
+ * pid is the pid of the process whose thread pool is looked up
+ */
+status_t getBinderThreadPoolInfo(BinderDebugContext context, pid_t pid,
+                                 BinderThreadPoolInfo* info);
+
+/**
+ * Reads the stats of all processes with one pass over the binder stats file.
+ */
+status_t getBinderProcStats(BinderDebugContext context, std::map<pid_t, BinderProcStats>* stats);
+
+/**
+ * pid is the pid of the process whose nodes are listed
+ */
+status_t getBinderNodeStats(BinderDebugContext context, pid_t pid,
+                            std::vector<BinderNodeStats>* nodes);
+
+/**
+ * Polls getBinderProcStats and reports what changed since the previous poll, to monitor
+ * binder hot spots continuously. Not thread safe.
+ */
+class BinderStatsMonitor {
+public:
+    explicit BinderStatsMonitor(BinderDebugContext context) : mContext(context) {}
+
+    // For every process, commands holds the counts since the previous call (since the
+    // process started on the first call) and omits commands that were not sent. The
+    // other fields are current values.
+    status_t poll(std::map<pid_t, BinderProcStats>* deltas);
+
+private:
+    BinderDebugContext mContext;
+    std::map<pid_t, BinderProcStats> mLast;
+};
+
 } // namespace  android
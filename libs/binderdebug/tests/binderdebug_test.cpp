@@ -60,6 +60,50 @@ TEST(BinderDebugTests, BinderThreads) {
     EXPECT_GE(pidInfo.threadCount, 1);
 }
 
+TEST(BinderDebugTests, BinderThreadPool) {
+    BinderThreadPoolInfo info = {};
+    const auto& status = getBinderThreadPoolInfo(BinderDebugContext::BINDER, getpid(), &info);
+    ASSERT_EQ(status, OK);
+    EXPECT_EQ(info.maxThreads, ProcessState::self()->getThreadPoolStats().maxThreads);
+    EXPECT_LE(info.readyThreads, info.threadCount);
+}
+
+TEST(BinderDebugTests, BinderProcStats) {
+    std::map<pid_t, BinderProcStats> stats;
+    const auto& status = getBinderProcStats(BinderDebugContext::BINDER, &stats);
+    ASSERT_EQ(status, OK);
+    auto it = stats.find(getpid());
+    ASSERT_NE(it, stats.end());
+    EXPECT_EQ(it->second.threadPool.maxThreads,
+              ProcessState::self()->getThreadPoolStats().maxThreads);
+    // The child process called into us.
+    EXPECT_GT(it->second.commands["BR_TRANSACTION"], 0u);
+}
+
+TEST(BinderDebugTests, BinderNodeStats) {
+    std::vector<BinderNodeStats> nodes;
+    const auto& status = getBinderNodeStats(BinderDebugContext::BINDER, getpid(), &nodes);
+    ASSERT_EQ(status, OK);
+    // At least the Control service is hosted here, and servicemanager holds it.
+    ASSERT_FALSE(nodes.empty());
+    bool hasClient = false;
+    for (const auto& node : nodes) {
+        hasClient |= !node.clientPids.empty();
+    }
+    EXPECT_TRUE(hasClient);
+}
+
+TEST(BinderDebugTests, BinderStatsMonitor) {
+    BinderStatsMonitor monitor(BinderDebugContext::BINDER);
+    std::map<pid_t, BinderProcStats> deltas;
+    ASSERT_EQ(monitor.poll(&deltas), OK);
+    EXPECT_GT(deltas[getpid()].commands["BR_TRANSACTION"], 0u);
+
+    ASSERT_EQ(monitor.poll(&deltas), OK);
+    // Nothing called into this process in between.
+    EXPECT_EQ(deltas[getpid()].commands.count("BR_TRANSACTION"), 0u);
+}
+
 extern "C" {
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
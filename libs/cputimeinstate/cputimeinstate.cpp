@@ -22,8 +22,13 @@
 #include <dirent.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <linux/bpf.h>
+#include <string.h>
+#include <sys/syscall.h>
 #include <sys/sysinfo.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <mutex>
 #include <numeric>
 #include <optional>
@@ -62,6 +67,8 @@ static unique_fd gTisMapFd;
 static unique_fd gConcurrentMapFd;
 static unique_fd gUidLastUpdateMapFd;
 static unique_fd gPidTisMapFd;
+// Cleared once the kernel rejects BPF_MAP_LOOKUP_BATCH, which needs Linux 5.6.
+static std::atomic<bool> gBatchLookupSupported = true;
 
 static std::optional<std::vector<uint32_t>> readNumbersFromFile(const std::string &path) {
     std::string data;
@@ -296,6 +303,99 @@ std::optional<std::vector<std::vector<uint64_t>>> getTotalCpuFreqTimes() {
 
     return out;
 }
+
+static bool uidUpdatedSince(uint64_t uidLastUpdate, uint64_t lastUpdate,
+                            uint64_t *newLastUpdate) {
+    // Updates that occurred during the previous read may have been missed. To mitigate
+    // this, don't ignore entries updated up to 1s before *lastUpdate
+    constexpr uint64_t NSEC_PER_SEC = 1000000000;
+    if (uidLastUpdate + NSEC_PER_SEC < lastUpdate) return false;
+    if (uidLastUpdate > *newLastUpdate) *newLastUpdate = uidLastUpdate;
+    return true;
+}
+
+// Reads the uid_last_update_map with BPF_MAP_LOOKUP_BATCH, a few hundred entries per syscall.
+// Returns false if the kernel does not support batched lookups of the map.
+static bool readUidLastUpdatesBatched(std::vector<std::pair<uint32_t, uint64_t>> *out) {
+    constexpr uint32_t kBatchSize = 256;
+    std::vector<uint32_t> keys(kBatchSize);
+    std::vector<uint64_t> values(kBatchSize);
+    uint32_t inBatch = 0, outBatch = 0;
+    bool first = true;
+    while (true) {
+        union bpf_attr attr = {};
+        attr.batch.map_fd = gUidLastUpdateMapFd.get();
+        attr.batch.in_batch = first ? 0 : reinterpret_cast<uintptr_t>(&inBatch);
+        attr.batch.out_batch = reinterpret_cast<uintptr_t>(&outBatch);
+        attr.batch.keys = reinterpret_cast<uintptr_t>(keys.data());
+        attr.batch.values = reinterpret_cast<uintptr_t>(values.data());
+        attr.batch.count = kBatchSize;
+        const int ret = syscall(__NR_bpf, BPF_MAP_LOOKUP_BATCH, &attr, sizeof(attr));
+        // The count holds the number of entries read, even when the end of the map was reached.
+        if (ret == 0 || errno == ENOENT) {
+            for (uint32_t i = 0; i < attr.batch.count; ++i) out->emplace_back(keys[i], values[i]);
+        }
+        if (ret != 0) return errno == ENOENT;
+        inBatch = outBatch;
+        first = false;
+    }
+}
+
+// Retrieve the uids that have run since lastUpdate from the uid_last_update_map, which holds one
+// timestamp per uid, rather than looking up the last update of each entry of the per-cpu maps.
+static std::optional<std::vector<uint32_t>> getUidsUpdatedSince(uint64_t lastUpdate,
+                                                                uint64_t *newLastUpdate) {
+    std::vector<std::pair<uint32_t, uint64_t>> lastUpdates;
+    if (gBatchLookupSupported) {
+        if (!readUidLastUpdatesBatched(&lastUpdates)) {
+            // e.g. EINVAL on kernels without batch operations, or ENOSPC if a hash bucket
+            // overflows the batch.
+            ALOGI("Batched lookup of uid_last_update_map failed (%s), iterating it instead",
+                  strerror(errno));
+            gBatchLookupSupported = false;
+            lastUpdates.clear();
+        }
+    }
+    if (!gBatchLookupSupported) {
+        uint32_t uid, prevUid;
+        if (getFirstMapKey(gUidLastUpdateMapFd, &uid)) {
+            if (errno == ENOENT) return std::vector<uint32_t>();
+            return {};
+        }
+        do {
+            uint64_t uidLastUpdate;
+            if (findMapEntry(gUidLastUpdateMapFd, &uid, &uidLastUpdate)) {
+                // The uid was cleared since its key was read.
+                if (errno == ENOENT) continue;
+                return {};
+            }
+            lastUpdates.emplace_back(uid, uidLastUpdate);
+        } while (prevUid = uid, !getNextMapKey(gUidLastUpdateMapFd, &prevUid, &uid));
+        if (errno != ENOENT) return {};
+    }
+
+    std::vector<uint32_t> uids;
+    for (const auto &[uid, uidLastUpdate] : lastUpdates) {
+        if (uidUpdatedSince(uidLastUpdate, lastUpdate, newLastUpdate)) uids.push_back(uid);
+    }
+    return uids;
+}
+
+static void addUidCpuFreqTimes(uint32_t bucket, const std::vector<tis_val_t> &vals,
+                               std::vector<std::vector<uint64_t>> *out) {
+    auto offset = bucket * FREQS_PER_ENTRY;
+    auto nextOffset = (bucket + 1) * FREQS_PER_ENTRY;
+    for (uint32_t i = 0; i < gNPolicies; ++i) {
+        if (offset >= gPolicyFreqs[i].size()) continue;
+        auto begin = (*out)[i].begin() + offset;
+        auto end = nextOffset < gPolicyFreqs[i].size() ? begin + FREQS_PER_ENTRY : (*out)[i].end();
+        for (const auto &cpu : gPolicyCpus[i]) {
+            std::transform(begin, end, std::begin(vals[gCpuIndexMap[cpu]].ar), begin,
+                           std::plus<uint64_t>());
+        }
+    }
+}
+
 // Retrieve the times in ns that uid spent running at each CPU frequency.
 // Return contains no value on error, otherwise it contains a vector of vectors using the format:
 // [[t0_0, t0_1, ...],
@@ -320,35 +420,12 @@ std::optional<std::vector<std::vector<uint64_t>>> getUidCpuFreqTimes(uint32_t ui
             continue;
         }
 
-        auto offset = i * FREQS_PER_ENTRY;
-        auto nextOffset = (i + 1) * FREQS_PER_ENTRY;
-        for (uint32_t j = 0; j < gNPolicies; ++j) {
-            if (offset >= gPolicyFreqs[j].size()) continue;
-            auto begin = out[j].begin() + offset;
-            auto end = nextOffset < gPolicyFreqs[j].size() ? begin + FREQS_PER_ENTRY : out[j].end();
-
-            for (const auto &cpu : gPolicyCpus[j]) {
-                std::transform(begin, end, std::begin(vals[gCpuIndexMap[cpu]].ar), begin,
-                               std::plus<uint64_t>());
-            }
-        }
+        addUidCpuFreqTimes(i, vals, &out);
     }
 
     return out;
 }
 
-static std::optional<bool> uidUpdatedSince(uint32_t uid, uint64_t lastUpdate,
-                                           uint64_t *newLastUpdate) {
-    uint64_t uidLastUpdate;
-    if (findMapEntry(gUidLastUpdateMapFd, &uid, &uidLastUpdate)) return {};
-    // Updates that occurred during the previous read may have been missed. To mitigate
-    // this, don't ignore entries updated up to 1s before *lastUpdate
-    constexpr uint64_t NSEC_PER_SEC = 1000000000;
-    if (uidLastUpdate + NSEC_PER_SEC < lastUpdate) return false;
-    if (uidLastUpdate > *newLastUpdate) *newLastUpdate = uidLastUpdate;
-    return true;
-}
-
 // Retrieve the times in ns that each uid spent running at each CPU freq.
 // Return contains no value on error, otherwise it contains a map from uids to vectors of vectors
 // using the format:
@@ -368,44 +445,75 @@ getUidsUpdatedCpuFreqTimes(uint64_t *lastUpdate) {
     if (!gInitialized && !initGlobals()) return {};
     time_key_t key, prevKey;
     std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>> map;
-    if (getFirstMapKey(gTisMapFd, &key)) {
-        if (errno == ENOENT) return map;
-        return std::nullopt;
-    }
 
+    uint32_t maxFreqCount = 0;
     std::vector<std::vector<uint64_t>> mapFormat;
-    for (const auto &freqList : gPolicyFreqs) mapFormat.emplace_back(freqList.size(), 0);
+    for (const auto &freqList : gPolicyFreqs) {
+        if (freqList.size() > maxFreqCount) maxFreqCount = freqList.size();
+        mapFormat.emplace_back(freqList.size(), 0);
+    }
 
-    uint64_t newLastUpdate = lastUpdate ? *lastUpdate : 0;
     std::vector<tis_val_t> vals(gNCpus);
-    do {
-        if (lastUpdate) {
-            auto uidUpdated = uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate);
-            if (!uidUpdated.has_value()) return {};
-            if (!*uidUpdated) continue;
+    if (lastUpdate) {
+        // Only look up the buckets of the uids that ran, which are usually a small fraction of
+        // the uids in the map.
+        uint64_t newLastUpdate = *lastUpdate;
+        auto uids = getUidsUpdatedSince(*lastUpdate, &newLastUpdate);
+        if (!uids) return {};
+        for (uint32_t uid : *uids) {
+            for (uint32_t bucket = 0; bucket <= (maxFreqCount - 1) / FREQS_PER_ENTRY; ++bucket) {
+                key = {.uid = uid, .bucket = bucket};
+                if (findMapEntry(gTisMapFd, &key, vals.data())) {
+                    if (errno == ENOENT) continue;
+                    return {};
+                }
+                if (map.find(uid) == map.end()) map.emplace(uid, mapFormat);
+                addUidCpuFreqTimes(bucket, vals, &map[uid]);
+            }
         }
+        if (newLastUpdate > *lastUpdate) *lastUpdate = newLastUpdate;
+        return map;
+    }
+
+    if (getFirstMapKey(gTisMapFd, &key)) {
+        if (errno == ENOENT) return map;
+        return std::nullopt;
+    }
+    do {
         if (findMapEntry(gTisMapFd, &key, vals.data())) return {};
         if (map.find(key.uid) == map.end()) map.emplace(key.uid, mapFormat);
-
-        auto offset = key.bucket * FREQS_PER_ENTRY;
-        auto nextOffset = (key.bucket + 1) * FREQS_PER_ENTRY;
-        for (uint32_t i = 0; i < gNPolicies; ++i) {
-            if (offset >= gPolicyFreqs[i].size()) continue;
-            auto begin = map[key.uid][i].begin() + offset;
-            auto end = nextOffset < gPolicyFreqs[i].size() ? begin + FREQS_PER_ENTRY :
-                map[key.uid][i].end();
-            for (const auto &cpu : gPolicyCpus[i]) {
-                std::transform(begin, end, std::begin(vals[gCpuIndexMap[cpu]].ar), begin,
-                               std::plus<uint64_t>());
-            }
-        }
-        prevKey = key;
+        addUidCpuFreqTimes(key.bucket, vals, &map[key.uid]);
     } while (prevKey = key, !getNextMapKey(gTisMapFd, &prevKey, &key));
     if (errno != ENOENT) return {};
-    if (lastUpdate && newLastUpdate > *lastUpdate) *lastUpdate = newLastUpdate;
     return map;
 }
 
+static void addUidConcurrentTimes(uint32_t bucket, const std::vector<concurrent_val_t> &vals,
+                                  concurrent_time_t *out) {
+    auto offset = bucket * CPUS_PER_ENTRY;
+    auto nextOffset = (bucket + 1) * CPUS_PER_ENTRY;
+
+    auto activeBegin = out->active.begin() + offset;
+    auto activeEnd = nextOffset < gNCpus ? activeBegin + CPUS_PER_ENTRY : out->active.end();
+
+    for (uint32_t cpu = 0; cpu < gNCpus; ++cpu) {
+        std::transform(activeBegin, activeEnd, std::begin(vals[cpu].active), activeBegin,
+                       std::plus<uint64_t>());
+    }
+
+    for (uint32_t policy = 0; policy < gNPolicies; ++policy) {
+        if (offset >= gPolicyCpus[policy].size()) continue;
+        auto policyBegin = out->policy[policy].begin() + offset;
+        auto policyEnd = nextOffset < gPolicyCpus[policy].size() ? policyBegin + CPUS_PER_ENTRY
+                                                                 : out->policy[policy].end();
+
+        for (const auto &cpu : gPolicyCpus[policy]) {
+            std::transform(policyBegin, policyEnd, std::begin(vals[gCpuIndexMap[cpu]].policy),
+                           policyBegin, std::plus<uint64_t>());
+        }
+    }
+}
+
 static bool verifyConcurrentTimes(const concurrent_time_t &ct) {
     uint64_t activeSum = std::accumulate(ct.active.begin(), ct.active.end(), (uint64_t)0);
     uint64_t policySum = 0;
@@ -433,28 +541,7 @@ std::optional<concurrent_time_t> getUidConcurrentTimes(uint32_t uid, bool retry)
             if (errno != ENOENT || getFirstMapKey(gConcurrentMapFd, &tmpKey)) return {};
             continue;
         }
-        auto offset = key.bucket * CPUS_PER_ENTRY;
-        auto nextOffset = (key.bucket + 1) * CPUS_PER_ENTRY;
-
-        auto activeBegin = ret.active.begin() + offset;
-        auto activeEnd = nextOffset < gNCpus ? activeBegin + CPUS_PER_ENTRY : ret.active.end();
-
-        for (uint32_t cpu = 0; cpu < gNCpus; ++cpu) {
-            std::transform(activeBegin, activeEnd, std::begin(vals[cpu].active), activeBegin,
-                           std::plus<uint64_t>());
-        }
-
-        for (uint32_t policy = 0; policy < gNPolicies; ++policy) {
-            if (offset >= gPolicyCpus[policy].size()) continue;
-            auto policyBegin = ret.policy[policy].begin() + offset;
-            auto policyEnd = nextOffset < gPolicyCpus[policy].size() ? policyBegin + CPUS_PER_ENTRY
-                                                                     : ret.policy[policy].end();
-
-            for (const auto &cpu : gPolicyCpus[policy]) {
-                std::transform(policyBegin, policyEnd, std::begin(vals[gCpuIndexMap[cpu]].policy),
-                               policyBegin, std::plus<uint64_t>());
-            }
-        }
+        addUidConcurrentTimes(key.bucket, vals, &ret);
     }
     if (!verifyConcurrentTimes(ret) && retry)  return getUidConcurrentTimes(uid, false);
     return ret;
@@ -480,52 +567,41 @@ std::optional<std::unordered_map<uint32_t, concurrent_time_t>> getUidsUpdatedCon
     if (!gInitialized && !initGlobals()) return {};
     time_key_t key, prevKey;
     std::unordered_map<uint32_t, concurrent_time_t> ret;
-    if (getFirstMapKey(gConcurrentMapFd, &key)) {
-        if (errno == ENOENT) return ret;
-        return {};
-    }
 
     concurrent_time_t retFormat = {.active = std::vector<uint64_t>(gNCpus, 0)};
     for (const auto &cpuList : gPolicyCpus) retFormat.policy.emplace_back(cpuList.size(), 0);
 
     std::vector<concurrent_val_t> vals(gNCpus);
-    std::vector<uint64_t>::iterator activeBegin, activeEnd, policyBegin, policyEnd;
-
     uint64_t newLastUpdate = lastUpdate ? *lastUpdate : 0;
-    do {
-        if (key.bucket > (gNCpus - 1) / CPUS_PER_ENTRY) return {};
-        if (lastUpdate) {
-            auto uidUpdated = uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate);
-            if (!uidUpdated.has_value()) return {};
-            if (!*uidUpdated) continue;
+    if (lastUpdate) {
+        // Only look up the buckets of the uids that ran, see getUidsUpdatedCpuFreqTimes().
+        auto uids = getUidsUpdatedSince(*lastUpdate, &newLastUpdate);
+        if (!uids) return {};
+        for (uint32_t uid : *uids) {
+            for (uint32_t bucket = 0; bucket <= (gNCpus - 1) / CPUS_PER_ENTRY; ++bucket) {
+                key = {.uid = uid, .bucket = bucket};
+                if (findMapEntry(gConcurrentMapFd, &key, vals.data())) {
+                    if (errno == ENOENT) continue;
+                    return {};
+                }
+                if (ret.find(uid) == ret.end()) ret.emplace(uid, retFormat);
+                addUidConcurrentTimes(bucket, vals, &ret[uid]);
+            }
         }
-        if (findMapEntry(gConcurrentMapFd, &key, vals.data())) return {};
-        if (ret.find(key.uid) == ret.end()) ret.emplace(key.uid, retFormat);
-
-        auto offset = key.bucket * CPUS_PER_ENTRY;
-        auto nextOffset = (key.bucket + 1) * CPUS_PER_ENTRY;
-
-        activeBegin = ret[key.uid].active.begin();
-        activeEnd = nextOffset < gNCpus ? activeBegin + CPUS_PER_ENTRY : ret[key.uid].active.end();
-
-        for (uint32_t cpu = 0; cpu < gNCpus; ++cpu) {
-            std::transform(activeBegin, activeEnd, std::begin(vals[cpu].active), activeBegin,
-                           std::plus<uint64_t>());
+    } else {
+        if (getFirstMapKey(gConcurrentMapFd, &key)) {
+            if (errno == ENOENT) return ret;
+            return {};
         }
+        do {
+            if (key.bucket > (gNCpus - 1) / CPUS_PER_ENTRY) return {};
+            if (findMapEntry(gConcurrentMapFd, &key, vals.data())) return {};
+            if (ret.find(key.uid) == ret.end()) ret.emplace(key.uid, retFormat);
+            addUidConcurrentTimes(key.bucket, vals, &ret[key.uid]);
+        } while (prevKey = key, !getNextMapKey(gConcurrentMapFd, &prevKey, &key));
+        if (errno != ENOENT) return {};
+    }
 
-        for (uint32_t policy = 0; policy < gNPolicies; ++policy) {
-            if (offset >= gPolicyCpus[policy].size()) continue;
-            policyBegin = ret[key.uid].policy[policy].begin() + offset;
-            policyEnd = nextOffset < gPolicyCpus[policy].size() ? policyBegin + CPUS_PER_ENTRY
-                                                                : ret[key.uid].policy[policy].end();
-
-            for (const auto &cpu : gPolicyCpus[policy]) {
-                std::transform(policyBegin, policyEnd, std::begin(vals[gCpuIndexMap[cpu]].policy),
-                               policyBegin, std::plus<uint64_t>());
-            }
-        }
-    } while (prevKey = key, !getNextMapKey(gConcurrentMapFd, &prevKey, &key));
-    if (errno != ENOENT) return {};
     for (const auto &[key, value] : ret) {
         if (!verifyConcurrentTimes(value)) {
             auto val = getUidConcurrentTimes(key, false);
@@ -0,0 +1,319 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ftl/async_future.h>
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace android::test {
+namespace {
+
+// Runs tasks when told to, on the calling thread.
+class ManualExecutor final : public ftl::Executor {
+ public:
+  void execute(std::function<void()> task) override { tasks_.push_back(std::move(task)); }
+
+  std::size_t pending() const { return tasks_.size(); }
+
+  void run_all() {
+    while (!tasks_.empty()) {
+      auto task = std::move(tasks_.front());
+      tasks_.pop_front();
+      task();
+    }
+  }
+
+ private:
+  std::deque<std::function<void()>> tasks_;
+};
+
+// Runs tasks on its own thread, in order.
+class ThreadExecutor final : public ftl::Executor {
+ public:
+  ThreadExecutor() : thread_([this] { loop(); }) {}
+
+  ~ThreadExecutor() {
+    {
+      std::lock_guard lock(mutex_);
+      done_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+  void execute(std::function<void()> task) override {
+    {
+      std::lock_guard lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+
+  std::thread::id id() const { return thread_.get_id(); }
+
+ private:
+  void loop() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] { return done_ || !tasks_.empty(); });
+      if (tasks_.empty()) return;
+
+      auto task = std::move(tasks_.front());
+      tasks_.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  bool done_ = false;
+  std::thread thread_;
+};
+
+}  // namespace
+
+// Keep in sync with example usage in header file.
+TEST(AsyncFuture, Example) {
+  ThreadExecutor backgroundExecutor;
+  ThreadExecutor mainThreadExecutor;
+  {
+    ftl::Promise<int> promise;
+    ftl::AsyncFuture<int> future = promise.get_future();
+
+    ftl::AsyncFuture<std::string> chain =
+        std::move(future)
+            .then(backgroundExecutor, [](int x) { return x * 2; })
+            .then(mainThreadExecutor, [](int x) { return std::to_string(x); });
+
+    promise.set_value(21);
+    EXPECT_EQ(std::move(chain).get(), "42");
+  }
+  {
+    auto future = ftl::make_ready_future(42);
+    EXPECT_EQ(std::move(future).get(), 42);
+  }
+  {
+    auto future = ftl::async(backgroundExecutor, [](int x) { return x + 1; }, 99);
+    EXPECT_EQ(std::move(future).get(), 100);
+  }
+  {
+    ftl::Promise<int> promise;
+    auto future = ftl::when_all(promise.get_future(), ftl::make_ready_future('!'));
+
+    promise.set_value(7);
+    EXPECT_EQ(std::move(future).get(), std::make_tuple(7, '!'));
+  }
+}
+
+TEST(AsyncFuture, ThenRunsOnExecutor) {
+  ThreadExecutor executor;
+  ftl::Promise<int> promise;
+
+  std::thread::id id;
+  auto future = promise.get_future().then(executor, [&id](int x) {
+    id = std::this_thread::get_id();
+    return x + 1;
+  });
+
+  // Setting the value does not run the continuation on this thread.
+  ManualExecutor manual;
+  ftl::Promise<int> manualPromise;
+  auto manualFuture = manualPromise.get_future().then(manual, [](int x) { return x; });
+  manualPromise.set_value(1);
+  EXPECT_EQ(manual.pending(), 1u);
+  EXPECT_FALSE(manualFuture.ready());
+  manual.run_all();
+  EXPECT_TRUE(manualFuture.ready());
+  EXPECT_EQ(std::move(manualFuture).get(), 1);
+
+  promise.set_value(1);
+  EXPECT_EQ(std::move(future).get(), 2);
+  EXPECT_EQ(id, executor.id());
+}
+
+TEST(AsyncFuture, Flatten) {
+  ManualExecutor executor;
+  ftl::Promise<std::string> inner;
+
+  auto future = ftl::make_ready_future(3).then(executor, [&inner](int x) {
+    return inner.get_future().then(ftl::InlineExecutor::instance(),
+                                   [x](std::string str) { return str.size() + x; });
+  });
+
+  executor.run_all();
+  EXPECT_FALSE(future.ready());
+
+  inner.set_value("abc");
+  EXPECT_TRUE(future.ready());
+  EXPECT_EQ(std::move(future).get(), 6u);
+}
+
+TEST(AsyncFuture, MoveOnly) {
+  auto future = ftl::make_ready_future(std::make_unique<char>('?'))
+                    .then(ftl::InlineExecutor::instance(),
+                          [](std::unique_ptr<char> ptr) { return std::string(1, *ptr); });
+
+  EXPECT_EQ(std::move(future).get(), "?");
+}
+
+TEST(AsyncFuture, GetFutureOnce) {
+  ftl::Promise<int> promise;
+  EXPECT_TRUE(promise.get_future().valid());
+  EXPECT_FALSE(promise.get_future().valid());
+}
+
+TEST(AsyncFuture, BrokenPromise) {
+  ManualExecutor executor;
+  bool ran = false;
+
+  ftl::AsyncFuture<int> future;
+  {
+    ftl::Promise<int> promise;
+    future = promise.get_future().then(executor, [&ran](int x) {
+      ran = true;
+      return x;
+    });
+  }
+
+  EXPECT_TRUE(future.ready());
+  EXPECT_EQ(executor.pending(), 0u);
+  EXPECT_EQ(std::move(future).get(), std::nullopt);
+  EXPECT_FALSE(ran);
+}
+
+TEST(AsyncFuture, CancelUpstream) {
+  ManualExecutor executor;
+  ftl::Promise<int> promise;
+
+  auto future = promise.get_future()
+                    .then(executor, [](int x) { return x; })
+                    .then(executor, [](int x) { return x; });
+
+  EXPECT_FALSE(promise.cancelled());
+  EXPECT_TRUE(future.cancel());
+  EXPECT_FALSE(future.cancel());
+  EXPECT_TRUE(promise.cancelled());
+  EXPECT_FALSE(promise.set_value(1));
+
+  EXPECT_EQ(executor.pending(), 0u);
+  EXPECT_EQ(std::move(future).get(), std::nullopt);
+}
+
+TEST(AsyncFuture, CancelQueued) {
+  ManualExecutor executor;
+  bool ran = false;
+
+  auto future = ftl::make_ready_future(1).then(executor, [&ran](int x) {
+    ran = true;
+    return x;
+  });
+
+  EXPECT_EQ(executor.pending(), 1u);
+  EXPECT_TRUE(future.cancel());
+  executor.run_all();
+
+  EXPECT_FALSE(ran);
+  EXPECT_EQ(std::move(future).get(), std::nullopt);
+}
+
+TEST(AsyncFuture, CancelInner) {
+  ManualExecutor executor;
+  ftl::Promise<int> inner;
+
+  auto future =
+      ftl::make_ready_future(0).then(executor, [&inner](int) { return inner.get_future(); });
+  executor.run_all();
+
+  EXPECT_TRUE(future.cancel());
+  EXPECT_TRUE(inner.cancelled());
+}
+
+TEST(AsyncFuture, WhenAll) {
+  ThreadExecutor executor;
+  ftl::Promise<int> first;
+  ftl::Promise<std::string> second;
+
+  auto future = ftl::when_all(first.get_future(), second.get_future())
+                    .then(executor, [](const std::tuple<int, std::string>& values) {
+                      const auto& [count, str] = values;
+                      return std::string(count, str.front());
+                    });
+
+  std::thread thread([&second] { second.set_value("ab"); });
+  first.set_value(3);
+  thread.join();
+
+  EXPECT_EQ(std::move(future).get(), "aaa");
+}
+
+TEST(AsyncFuture, WhenAllCancel) {
+  ftl::Promise<int> first;
+  ftl::Promise<int> second;
+  ftl::Promise<int> third;
+
+  auto future = ftl::when_all(first.get_future(), second.get_future(), third.get_future());
+
+  first.set_value(1);
+  EXPECT_FALSE(future.ready());
+
+  // Cancelling the joined future cancels the pending inputs.
+  EXPECT_TRUE(future.cancel());
+  EXPECT_TRUE(second.cancelled());
+  EXPECT_TRUE(third.cancelled());
+  EXPECT_EQ(std::move(future).get(), std::nullopt);
+
+  ftl::Promise<int> fourth;
+  ftl::Promise<int> fifth;
+  auto other = ftl::when_all(fourth.get_future(), fifth.get_future());
+
+  // Cancelling an input cancels the joined future, and in turn the other inputs.
+  fourth = ftl::Promise<int>();
+
+  EXPECT_TRUE(other.ready());
+  EXPECT_TRUE(fifth.cancelled());
+}
+
+TEST(AsyncFuture, WhenAllVector) {
+  std::vector<ftl::Promise<int>> promises(5);
+  std::vector<ftl::AsyncFuture<int>> futures;
+  for (auto& promise : promises) {
+    futures.push_back(promise.get_future());
+  }
+
+  auto future = ftl::when_all(std::move(futures));
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < promises.size(); i++) {
+    threads.emplace_back([&promises, i] { promises[i].set_value(static_cast<int>(i * i)); });
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(std::move(future).get(), (std::vector{0, 1, 4, 9, 16}));
+  EXPECT_EQ(ftl::when_all(std::vector<ftl::AsyncFuture<int>>()).get(), std::vector<int>());
+}
+
+}  // namespace android::test
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ftl/enum_map.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+
+namespace android::test {
+
+using ftl::EnumMap;
+
+namespace {
+
+enum class Stage { kRead, kDispatch, kPresent, ftl_last = kPresent };
+
+enum class Offset : int8_t { kA = -2, kB, kC, ftl_first = kA, ftl_last = kC };
+
+}  // namespace
+
+// Keep in sync with example usage in header file.
+TEST(EnumMap, Example) {
+  ftl::EnumMap<Stage, int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.max_size(), 3u);
+
+  map.try_emplace(Stage::kPresent, 3);
+  map.try_emplace(Stage::kRead, 1);
+  EXPECT_EQ(map.size(), 2u);
+  EXPECT_EQ(map.begin()->first, Stage::kRead);
+
+  EXPECT_EQ(map.get(Stage::kPresent), 3);
+  EXPECT_FALSE(map.contains(Stage::kDispatch));
+}
+
+TEST(EnumMap, Iterate) {
+  EnumMap<Stage, std::string> map;
+  map.try_emplace(Stage::kPresent, "present");
+  map.try_emplace(Stage::kRead, 2u, 'r');
+
+  std::vector<Stage> keys;
+  for (const auto& [key, value] : map) {
+    keys.push_back(key);
+  }
+  EXPECT_EQ(keys, (std::vector{Stage::kRead, Stage::kPresent}));
+
+  for (auto& [key, value] : map) {
+    value += "!";
+  }
+  EXPECT_EQ(map.get(Stage::kRead)->get(), "rr!");
+  EXPECT_EQ(map.find(Stage::kDispatch), map.end());
+}
+
+TEST(EnumMap, ReplaceAndErase) {
+  EnumMap<Stage, std::string> map;
+  EXPECT_EQ(map.try_replace(Stage::kRead, "read"), map.end());
+
+  EXPECT_TRUE(map.emplace_or_replace(Stage::kRead, "read").second);
+  EXPECT_FALSE(map.emplace_or_replace(Stage::kRead, "reread").second);
+  EXPECT_EQ(map.get(Stage::kRead)->get(), "reread");
+
+  // Replace with a reference to the value being replaced.
+  map.try_replace(Stage::kRead, map.get(Stage::kRead)->get() + "!");
+  EXPECT_EQ(map.get(Stage::kRead)->get(), "reread!");
+
+  EXPECT_TRUE(map.erase(Stage::kRead));
+  EXPECT_FALSE(map.erase(Stage::kRead));
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.begin(), map.end());
+}
+
+TEST(EnumMap, Range) {
+  EnumMap<Offset, char> map;
+  EXPECT_EQ(map.max_size(), 3u);
+
+  EXPECT_TRUE(map.try_emplace(Offset::kA, 'a').second);
+  EXPECT_TRUE(map.try_emplace(Offset::kC, 'c').second);
+  EXPECT_EQ(map.get(Offset::kA), 'a');
+  EXPECT_EQ(map.get(Offset::kC), 'c');
+
+  // Values out of the enum's range are never contained.
+  EXPECT_FALSE(map.try_emplace(static_cast<Offset>(1), '?').second);
+  EXPECT_FALSE(map.contains(static_cast<Offset>(-3)));
+  EXPECT_EQ(map.size(), 2u);
+}
+
+TEST(EnumMap, Equal) {
+  EnumMap<Stage, int> map1;
+  EnumMap<Stage, int> map2;
+  map1.try_emplace(Stage::kRead, 1);
+  EXPECT_NE(map1, map2);
+
+  map2.try_emplace(Stage::kRead, 1);
+  EXPECT_EQ(map1, map2);
+
+  map2.try_replace(Stage::kRead, 2);
+  EXPECT_NE(map1, map2);
+}
+
+}  // namespace android::test
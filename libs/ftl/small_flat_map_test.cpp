@@ -0,0 +1,147 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ftl/small_flat_map.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <string_view>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace android::test {
+
+using ftl::SmallFlatMap;
+
+// Keep in sync with example usage in header file.
+TEST(SmallFlatMap, Example) {
+  ftl::SmallFlatMap<int, std::string, 3> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.dynamic());
+
+  map = ftl::init::map<int, std::string>(123, "abc")(-1)(42, 3u, '?');
+  EXPECT_EQ(map.size(), 3u);
+  EXPECT_FALSE(map.dynamic());
+
+  EXPECT_EQ(map.begin()->first, -1);
+  EXPECT_TRUE(map.contains(123));
+  EXPECT_EQ(map.get(42).transform([](const std::string& s) { return s.size(); }), 3u);
+
+  map.emplace_or_replace(0, "vanilla", 2u, 3u);
+  EXPECT_TRUE(map.dynamic());
+
+  EXPECT_EQ(map,
+            SmallFlatMap(ftl::init::map(-1, ""sv)(0, "nil"sv)(42, "???"sv)(123, "abc"sv)));
+}
+
+TEST(SmallFlatMap, Construct) {
+  {
+    // Keys are sorted, and the first of duplicate keys is kept.
+    const SmallFlatMap map = ftl::init::map('c', 'C')('a', 'A')('b', 'B')('a', 'x')('c', 'y');
+
+    EXPECT_EQ(map.size(), 3u);
+    EXPECT_EQ(map.max_size(), 5u);
+    EXPECT_TRUE(std::is_sorted(map.begin(), map.end()));
+    EXPECT_EQ(map, SmallFlatMap(ftl::init::map('a', 'A')('b', 'B')('c', 'C')));
+  }
+  {
+    // Custom order.
+    const SmallFlatMap<int, char, 3, std::greater<int>> map =
+        ftl::init::map(1, 'a')(3, 'c')(2, 'b');
+
+    EXPECT_EQ(map.begin()->first, 3);
+    EXPECT_EQ(map.get(1), 'a');
+  }
+}
+
+TEST(SmallFlatMap, TryEmplace) {
+  SmallFlatMap<int, std::string, 3> map;
+  using Pair = decltype(map)::value_type;
+
+  {
+    const auto [it, ok] = map.try_emplace(123, "abc");
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(*it, Pair(123, "abc"s));
+  }
+  {
+    const auto [it, ok] = map.try_emplace(-1, 3u, '?');
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(*it, Pair(-1, "???"s));
+  }
+  {
+    const auto [it, ok] = map.try_emplace(123, "ignored");
+    ASSERT_FALSE(ok);
+    EXPECT_EQ(*it, Pair(123, "abc"s));
+  }
+
+  EXPECT_EQ(map, SmallFlatMap(ftl::init::map(-1, "???"sv)(123, "abc"sv)));
+}
+
+TEST(SmallFlatMap, TryReplace) {
+  SmallFlatMap map = ftl::init::map<int, std::string>(1, "a")(2, "B");
+
+  EXPECT_EQ(map.try_replace(3, "c"), map.end());
+  const auto it = map.try_replace(2, 1u, 'b');
+  ASSERT_NE(it, map.end());
+  EXPECT_EQ(it->second, "b");
+
+  // Replace with a reference to the value being replaced.
+  map.try_replace(1, map.get(1)->get() + "!");
+  EXPECT_EQ(map, SmallFlatMap(ftl::init::map(1, "a!"sv)(2, "b"sv)));
+}
+
+TEST(SmallFlatMap, Erase) {
+  SmallFlatMap map = ftl::init::map(1, '1')(2, '2')(3, '3')(4, '4');
+
+  EXPECT_TRUE(map.erase(2));
+  EXPECT_FALSE(map.erase(2));
+  EXPECT_EQ(map, SmallFlatMap(ftl::init::map(1, '1')(3, '3')(4, '4')));
+
+  EXPECT_TRUE(map.erase(4));
+  EXPECT_TRUE(map.erase(1));
+  EXPECT_EQ(map, SmallFlatMap(ftl::init::map(3, '3')));
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+}
+
+// Cross-check against std::map across the linear and binary search sizes, and the promotion to
+// dynamic storage.
+TEST(SmallFlatMap, MatchesStdMap) {
+  SmallFlatMap<int, int, 16> map;
+  std::map<int, int> reference;
+
+  for (int i = 0; i < 200; i++) {
+    const int key = (i * 37) % 61;
+    if (i % 3 == 2) {
+      EXPECT_EQ(map.erase(key), reference.erase(key) > 0);
+    } else {
+      EXPECT_EQ(map.try_emplace(key, i).second, reference.try_emplace(key, i).second);
+    }
+
+    ASSERT_EQ(map.size(), reference.size());
+    EXPECT_TRUE(std::equal(map.begin(), map.end(), reference.begin(), reference.end()));
+    for (int k = -1; k < 62; k++) {
+      EXPECT_EQ(map.contains(k), reference.count(k) > 0) << k;
+    }
+  }
+  EXPECT_TRUE(map.dynamic());
+}
+
+}  // namespace android::test
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ftl/enum_map.h>
+#include <ftl/small_flat_map.h>
+#include <ftl/small_map.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Usage: atest ftl_benchmark
+
+namespace android {
+namespace {
+
+constexpr std::size_t kMaxSize = 64;
+
+enum class Key : int { ftl_last = kMaxSize - 1 };
+
+template <typename M>
+struct MapTraits;
+
+template <std::size_t N>
+struct MapTraits<ftl::SmallMap<int, int, N>> {
+  using key_type = int;
+};
+
+template <std::size_t N>
+struct MapTraits<ftl::SmallFlatMap<int, int, N>> {
+  using key_type = int;
+};
+
+template <>
+struct MapTraits<ftl::EnumMap<Key, int>> {
+  using key_type = Key;
+};
+
+template <>
+struct MapTraits<std::unordered_map<int, int>> {
+  using key_type = int;
+};
+
+// The keys 0 to size - 1, in a fixed random order.
+template <typename K>
+std::vector<K> makeKeys(std::size_t size) {
+  std::vector<int> keys(size);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(size));
+  std::vector<K> result;
+  std::transform(keys.begin(), keys.end(), std::back_inserter(result),
+                 [](int key) { return static_cast<K>(key); });
+  return result;
+}
+
+template <typename M>
+bool lookup(const M& map, typename MapTraits<M>::key_type key) {
+  if constexpr (std::is_same_v<M, std::unordered_map<int, int>>) {
+    return map.find(key) != map.end();
+  } else {
+    return map.contains(key);
+  }
+}
+
+template <typename M>
+void BM_Lookup(benchmark::State& state) {
+  using K = typename MapTraits<M>::key_type;
+  const std::vector<K> keys = makeKeys<K>(state.range(0));
+  M map;
+  for (K key : keys) {
+    map.try_emplace(key, 0);
+  }
+
+  for (auto _ : state) {
+    for (K key : keys) {
+      benchmark::DoNotOptimize(lookup(map, key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template <typename M>
+void BM_LookupMiss(benchmark::State& state) {
+  using K = typename MapTraits<M>::key_type;
+  const std::vector<K> keys = makeKeys<K>(state.range(0));
+  M map;
+  // Leave out the last key, so that a lookup of it misses.
+  std::for_each(keys.begin(), keys.end() - 1, [&map](K key) { map.try_emplace(key, 0); });
+  const K missing = keys.back();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lookup(map, missing));
+  }
+}
+
+template <typename M>
+void BM_InsertErase(benchmark::State& state) {
+  using K = typename MapTraits<M>::key_type;
+  const std::vector<K> keys = makeKeys<K>(state.range(0));
+
+  for (auto _ : state) {
+    M map;
+    for (K key : keys) {
+      map.try_emplace(key, 0);
+    }
+    for (K key : keys) {
+      map.erase(key);
+    }
+    benchmark::DoNotOptimize(map);
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Map sizes from 1 to kMaxSize, in powers of two.
+void sizes(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(2)->Range(1, kMaxSize);
+}
+
+#define FTL_MAP_BENCHMARK(bm)                                                   \
+  BENCHMARK_TEMPLATE(bm, ftl::SmallMap<int, int, kMaxSize>)->Apply(sizes);     \
+  BENCHMARK_TEMPLATE(bm, ftl::SmallFlatMap<int, int, kMaxSize>)->Apply(sizes); \
+  BENCHMARK_TEMPLATE(bm, ftl::EnumMap<Key, int>)->Apply(sizes);                \
+  BENCHMARK_TEMPLATE(bm, std::unordered_map<int, int>)->Apply(sizes)
+
+FTL_MAP_BENCHMARK(BM_Lookup);
+FTL_MAP_BENCHMARK(BM_LookupMiss);
+FTL_MAP_BENCHMARK(BM_InsertErase);
+
+}  // namespace
+}  // namespace android
+
+BENCHMARK_MAIN();
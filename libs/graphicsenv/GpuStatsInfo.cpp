@@ -96,6 +96,10 @@ status_t GpuStatsAppInfo::writeToParcel(Parcel* parcel) const {
     if ((status = parcel->writeUint64(vulkanDeviceFeaturesEnabled)) != OK) return status;
     if ((status = parcel->writeInt32Vector(vulkanInstanceExtensions)) != OK) return status;
     if ((status = parcel->writeInt32Vector(vulkanDeviceExtensions)) != OK) return status;
+    if ((status = parcel->writeBool(glDriverPreloaded)) != OK) return status;
+    if ((status = parcel->writeInt64Vector(eglGetDisplayTime)) != OK) return status;
+    if ((status = parcel->writeInt64Vector(vkLayerDiscoveryTime)) != OK) return status;
+    if ((status = parcel->writeInt64Vector(vkSwapchainCreateTime)) != OK) return status;
 
     return OK;
 }
@@ -118,6 +122,10 @@ status_t GpuStatsAppInfo::readFromParcel(const Parcel* parcel) {
     if ((status = parcel->readUint64(&vulkanDeviceFeaturesEnabled)) != OK) return status;
     if ((status = parcel->readInt32Vector(&vulkanInstanceExtensions)) != OK) return status;
     if ((status = parcel->readInt32Vector(&vulkanDeviceExtensions)) != OK) return status;
+    if ((status = parcel->readBool(&glDriverPreloaded)) != OK) return status;
+    if ((status = parcel->readInt64Vector(&eglGetDisplayTime)) != OK) return status;
+    if ((status = parcel->readInt64Vector(&vkLayerDiscoveryTime)) != OK) return status;
+    if ((status = parcel->readInt64Vector(&vkSwapchainCreateTime)) != OK) return status;
 
     return OK;
 }
@@ -133,6 +141,7 @@ std::string GpuStatsAppInfo::toString() const {
     StringAppendF(&result, "createdGlesContext = %d\n", createdGlesContext);
     StringAppendF(&result, "createdVulkanDevice = %d\n", createdVulkanDevice);
     StringAppendF(&result, "createdVulkanSwapchain = %d\n", createdVulkanSwapchain);
+    StringAppendF(&result, "glDriverPreloaded = %d\n", glDriverPreloaded);
     StringAppendF(&result, "vulkanApiVersion = 0x%" PRIx32 "\n", vulkanApiVersion);
     StringAppendF(&result, "vulkanDeviceFeaturesEnabled = 0x%" PRIx64 "\n",
                   vulkanDeviceFeaturesEnabled);
@@ -151,6 +160,21 @@ std::string GpuStatsAppInfo::toString() const {
         StringAppendF(&result, " %d", loadingTime);
     }
     result.append("\n");
+    result.append("eglGetDisplayTime:");
+    for (int64_t getDisplayTime : eglGetDisplayTime) {
+        StringAppendF(&result, " %" PRId64, getDisplayTime);
+    }
+    result.append("\n");
+    result.append("vkLayerDiscoveryTime:");
+    for (int64_t discoveryTime : vkLayerDiscoveryTime) {
+        StringAppendF(&result, " %" PRId64, discoveryTime);
+    }
+    result.append("\n");
+    result.append("vkSwapchainCreateTime:");
+    for (int64_t createTime : vkSwapchainCreateTime) {
+        StringAppendF(&result, " %" PRId64, createTime);
+    }
+    result.append("\n");
     result.append("vulkanInstanceExtensions:");
     for (int32_t extension : vulkanInstanceExtensions) {
         StringAppendF(&result, " 0x%x", extension);
@@ -164,4 +188,22 @@ std::string GpuStatsAppInfo::toString() const {
     return result;
 }
 
+status_t GpuMemInfo::writeToParcel(Parcel* parcel) const {
+    status_t status;
+    if ((status = parcel->writeUint32(gpuId)) != OK) return status;
+    if ((status = parcel->writeUint32(pid)) != OK) return status;
+    if ((status = parcel->writeUint64(size)) != OK) return status;
+    if ((status = parcel->writeUint64(peakSize)) != OK) return status;
+    return OK;
+}
+
+status_t GpuMemInfo::readFromParcel(const Parcel* parcel) {
+    status_t status;
+    if ((status = parcel->readUint32(&gpuId)) != OK) return status;
+    if ((status = parcel->readUint32(&pid)) != OK) return status;
+    if ((status = parcel->readUint64(&size)) != OK) return status;
+    if ((status = parcel->readUint64(&peakSize)) != OK) return status;
+    return OK;
+}
+
 } // namespace android
@@ -98,6 +98,24 @@ public:
         }
         return driverPath;
     }
+
+    status_t getGpuMemSnapshot(std::vector<GpuMemInfo>* outGpuMemInfos) override {
+        if (!outGpuMemInfos) return UNEXPECTED_NULL;
+
+        Parcel data, reply;
+        status_t status;
+        if ((status = data.writeInterfaceToken(IGpuService::getInterfaceDescriptor())) != OK)
+            return status;
+
+        status = remote()->transact(BnGpuService::GET_GPU_MEM_SNAPSHOT, data, &reply);
+        if (status != OK) return status;
+
+        int32_t result = 0;
+        if ((status = reply.readInt32(&result)) != OK) return status;
+        if (result != OK) return result;
+
+        return reply.readParcelableVector(outGpuMemInfos);
+    }
 };
 
 IMPLEMENT_META_INTERFACE(GpuService, "android.graphicsenv.IGpuService");
@@ -207,6 +225,17 @@ status_t BnGpuService::onTransact(uint32_t code, const Parcel& data, Parcel* rep
             toggleAngleAsSystemDriver(enableAngleAsSystemDriver);
             return OK;
         }
+        case GET_GPU_MEM_SNAPSHOT: {
+            CHECK_INTERFACE(IGpuService, data, reply);
+
+            std::vector<GpuMemInfo> gpuMemInfos;
+            const status_t result = getGpuMemSnapshot(&gpuMemInfos);
+
+            if ((status = reply->writeInt32(result)) != OK) return status;
+            if (result != OK) return OK;
+
+            return reply->writeParcelableVector(gpuMemInfos);
+        }
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
@@ -73,6 +73,9 @@ public:
     std::vector<int64_t> glDriverLoadingTime = {};
     std::vector<int64_t> vkDriverLoadingTime = {};
     std::vector<int64_t> angleDriverLoadingTime = {};
+    std::vector<int64_t> eglGetDisplayTime = {};
+    std::vector<int64_t> vkLayerDiscoveryTime = {};
+    std::vector<int64_t> vkSwapchainCreateTime = {};
     bool cpuVulkanInUse = false;
     bool falsePrerotation = false;
     bool gles1InUse = false;
@@ -80,6 +83,7 @@ public:
     bool createdGlesContext = false;
     bool createdVulkanDevice = false;
     bool createdVulkanSwapchain = false;
+    bool glDriverPreloaded = false;
     uint32_t vulkanApiVersion = 0;
     uint64_t vulkanDeviceFeaturesEnabled = 0;
     std::vector<int32_t> vulkanInstanceExtensions = {};
@@ -88,6 +92,25 @@ public:
     std::chrono::time_point<std::chrono::system_clock> lastAccessTime;
 };
 
+/*
+ * class for transporting the gpu memory usage of a process from GpuService to authorized
+ * recipients. This class is intended to be a data container.
+ */
+class GpuMemInfo : public Parcelable {
+public:
+    GpuMemInfo() = default;
+    GpuMemInfo(const GpuMemInfo&) = default;
+    virtual ~GpuMemInfo() = default;
+    virtual status_t writeToParcel(Parcel* parcel) const;
+    virtual status_t readFromParcel(const Parcel* parcel);
+
+    uint32_t gpuId = 0;
+    // pid 0 holds the global total of the gpu.
+    uint32_t pid = 0;
+    uint64_t size = 0;
+    uint64_t peakSize = 0;
+};
+
 /*
  * class for holding the gpu stats in GraphicsEnv before sending to GpuService.
  */
@@ -118,6 +141,10 @@ public:
         VULKAN_DEVICE_FEATURES_ENABLED = 7,
         VULKAN_INSTANCE_EXTENSION = 8,
         VULKAN_DEVICE_EXTENSION = 9,
+        GL_DRIVER_PRELOADED = 10,
+        EGL_GET_DISPLAY_TIME = 11,
+        VULKAN_LAYER_DISCOVERY_TIME = 12,
+        VULKAN_SWAPCHAIN_CREATE_TIME = 13,
     };
 
     GpuStatsInfo() = default;
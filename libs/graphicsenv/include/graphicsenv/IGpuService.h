@@ -53,6 +53,9 @@ public:
 
     // sets ANGLE as system GLES driver if enabled==true by setting persist.graphics.egl to true.
     virtual void toggleAngleAsSystemDriver(bool enabled) = 0;
+
+    // get a snapshot of the gpu memory totals of every process, read from the eBPF maps.
+    virtual status_t getGpuMemSnapshot(std::vector<GpuMemInfo>* outGpuMemInfos) = 0;
 };
 
 class BnGpuService : public BnInterface<IGpuService> {
@@ -63,6 +66,7 @@ public:
         SET_UPDATABLE_DRIVER_PATH,
         GET_UPDATABLE_DRIVER_PATH,
         TOGGLE_ANGLE_AS_SYSTEM_DRIVER,
+        GET_GPU_MEM_SNAPSHOT,
         // Always append new enum to the end.
     };
 
@@ -77,6 +77,7 @@ void BLASTBufferItemConsumer::onDisconnect() {
         mDisconnectEvents.push(mCurrentFrameNumber);
     }
     mFrameEventHistory.onDisconnect();
+    mFrameEventsGeneration.fetch_add(1, std::memory_order_release);
 }
 
 void BLASTBufferItemConsumer::addAndGetFrameTimestamps(const NewFrameEventsEntry* newTimestamps,
@@ -87,6 +88,7 @@ void BLASTBufferItemConsumer::addAndGetFrameTimestamps(const NewFrameEventsEntry
         // queueBuffer
         mCurrentFrameNumber = newTimestamps->frameNumber;
         mFrameEventHistory.addQueue(*newTimestamps);
+        mFrameEventsGeneration.fetch_add(1, std::memory_order_release);
     }
     if (outDelta) {
         // frame event histories will be processed
@@ -96,6 +98,8 @@ void BLASTBufferItemConsumer::addAndGetFrameTimestamps(const NewFrameEventsEntry
         mPreviouslyConnected = mCurrentlyConnected;
         mCurrentlyConnected = true;
         mFrameEventHistory.getAndResetDelta(outDelta);
+        mFetchedFrameEventsGeneration.store(mFrameEventsGeneration.load(std::memory_order_relaxed),
+                                            std::memory_order_release);
     }
 }
 
@@ -121,6 +125,7 @@ void BLASTBufferItemConsumer::updateFrameTimestamps(
         mFrameEventHistory.addRelease(previousFrameNumber, dequeueReadyTime,
                                       std::move(releaseFenceTime));
     }
+    mFrameEventsGeneration.fetch_add(1, std::memory_order_release);
 }
 
 void BLASTBufferItemConsumer::getConnectionEvents(uint64_t frameNumber, bool* needsDisconnect) {
@@ -873,11 +878,15 @@ private:
     std::mutex mMutex;
     sp<BLASTBufferQueue> mBbq GUARDED_BY(mMutex);
     bool mDestroyed GUARDED_BY(mMutex) = false;
+    const sp<BLASTBufferItemConsumer> mBufferItemConsumer;
 
 public:
     BBQSurface(const sp<IGraphicBufferProducer>& igbp, bool controlledByApp,
-               const sp<IBinder>& scHandle, const sp<BLASTBufferQueue>& bbq)
-          : Surface(igbp, controlledByApp, scHandle), mBbq(bbq) {}
+               const sp<IBinder>& scHandle, const sp<BLASTBufferQueue>& bbq,
+               const sp<BLASTBufferItemConsumer>& bufferItemConsumer)
+          : Surface(igbp, controlledByApp, scHandle),
+            mBbq(bbq),
+            mBufferItemConsumer(bufferItemConsumer) {}
 
     void allocateBuffers() override {
         uint32_t reqWidth = mReqWidth ? mReqWidth : mUserWidth;
@@ -913,6 +922,12 @@ public:
         return mBbq->setFrameTimelineInfo(frameNumber, frameTimelineInfo);
     }
 
+    // The consumer lives in this process, so we can tell without a binder call or a lock
+    // whether fetching a frame event delta would return anything new.
+    bool hasPendingFrameTimestamps() const override {
+        return mBufferItemConsumer == nullptr || mBufferItemConsumer->hasPendingFrameTimestamps();
+    }
+
     void destroy() override {
         Surface::destroy();
 
@@ -954,7 +969,7 @@ sp<Surface> BLASTBufferQueue::getSurface(bool includeSurfaceControlHandle) {
     if (includeSurfaceControlHandle && mSurfaceControl) {
         scHandle = mSurfaceControl->getHandle();
     }
-    return new BBQSurface(mProducer, true, scHandle, this);
+    return new BBQSurface(mProducer, true, scHandle, this, mBufferItemConsumer);
 }
 
 void BLASTBufferQueue::mergeWithNextTransaction(SurfaceComposerClient::Transaction* t,
@@ -1092,11 +1107,89 @@ public:
                                             producerControlledByApp, output);
     }
 
-    // We want to resize the frame history when changing the size of the buffer queue
+    status_t dequeueBuffer(int* outSlot, sp<Fence>* outFence, uint32_t width, uint32_t height,
+                           PixelFormat format, uint64_t usage, uint64_t* outBufferAge,
+                           FrameEventHistoryDelta* outTimestamps) override {
+        const nsecs_t startTime = systemTime();
+        status_t status = BufferQueueProducer::dequeueBuffer(outSlot, outFence, width, height,
+                                                             format, usage, outBufferAge,
+                                                             outTimestamps);
+        // Allocations are not waits on the consumer, don't count them.
+        if (status >= 0 && !(status & BUFFER_NEEDS_REALLOCATION)) {
+            onDequeueFinished(systemTime() - startTime);
+        }
+        return status;
+    }
+
+    // The extra buffers of the adaptive buffer count always come on top of what the producer
+    // asked for.
     status_t setMaxDequeuedBufferCount(int maxDequeuedBufferCount) override {
+        uint32_t extraBuffers;
+        {
+            std::lock_guard lock(mAdaptiveMutex);
+            mRequestedMaxDequeuedBufferCount = maxDequeuedBufferCount;
+            extraBuffers = mAdaptiveStats.extraBuffers;
+        }
+        if (extraBuffers == 0) {
+            return applyMaxDequeuedBufferCount(maxDequeuedBufferCount);
+        }
+        status_t status = applyMaxDequeuedBufferCount(maxDequeuedBufferCount + extraBuffers);
+        if (status != OK) {
+            // The extra buffers must never make a valid request fail.
+            status = applyMaxDequeuedBufferCount(maxDequeuedBufferCount);
+            if (status == OK) {
+                std::lock_guard lock(mAdaptiveMutex);
+                mAdaptiveStats.extraBuffers = 0;
+            }
+        }
+        return status;
+    }
+
+    int query(int what, int* value) override {
+        if (what == NATIVE_WINDOW_QUEUES_TO_WINDOW_COMPOSER) {
+            *value = 1;
+            return NO_ERROR;
+        }
+        return BufferQueueProducer::query(what, value);
+    }
+
+    void setAdaptiveBufferCount(uint32_t maxExtraBuffers, const std::string& name) {
+        uint32_t extraBuffers;
+        {
+            std::lock_guard lock(mAdaptiveMutex);
+            mMaxExtraBuffers = maxExtraBuffers;
+            mExtraBuffersTrace = "AdaptiveExtraBuffers - " + name;
+            mWindowDequeueCount = 0;
+            mWindowBlockedCount = 0;
+            mQuietWindowCount = 0;
+            extraBuffers = mAdaptiveStats.extraBuffers;
+        }
+        if (extraBuffers > maxExtraBuffers) {
+            setExtraBuffers(maxExtraBuffers);
+        }
+    }
+
+    BLASTBufferQueue::AdaptiveBufferCountStats getAdaptiveBufferCountStats() const {
+        std::lock_guard lock(mAdaptiveMutex);
+        return mAdaptiveStats;
+    }
+
+private:
+    // A dequeueBuffer call that takes longer than this is considered to have blocked on the
+    // consumer.
+    static constexpr nsecs_t BLOCKED_DEQUEUE_THRESHOLD = 2'000'000; // 2ms
+    // The adaptive buffer count is reevaluated after every window of this many dequeues.
+    static constexpr uint32_t WINDOW_SIZE = 60;
+    // A buffer is added after a window in which at least this many dequeues blocked.
+    static constexpr uint32_t BLOCKED_DEQUEUES_TO_GROW = 3;
+    // A buffer is taken away after this many consecutive windows without a blocked dequeue.
+    static constexpr uint32_t QUIET_WINDOWS_TO_SHRINK = 5;
+
+    status_t applyMaxDequeuedBufferCount(int maxDequeuedBufferCount) {
         int maxBufferCount;
         status_t status = BufferQueueProducer::setMaxDequeuedBufferCount(maxDequeuedBufferCount,
                                                                          &maxBufferCount);
+        // We want to resize the frame history when changing the size of the buffer queue
         // if we can't determine the max buffer count, then just skip growing the history size
         if (status == OK) {
             size_t newFrameHistorySize = maxBufferCount + 2; // +2 because triple buffer rendering
@@ -1112,16 +1205,77 @@ public:
         return status;
     }
 
-    int query(int what, int* value) override {
-        if (what == NATIVE_WINDOW_QUEUES_TO_WINDOW_COMPOSER) {
-            *value = 1;
-            return NO_ERROR;
+    void onDequeueFinished(nsecs_t waitTime) {
+        std::optional<uint32_t> newExtraBuffers;
+        {
+            std::lock_guard lock(mAdaptiveMutex);
+            if (mMaxExtraBuffers == 0) {
+                return;
+            }
+            if (waitTime >= BLOCKED_DEQUEUE_THRESHOLD) {
+                mWindowBlockedCount++;
+                mAdaptiveStats.blockedDequeueCount++;
+                mAdaptiveStats.maxDequeueWaitTime =
+                        std::max(mAdaptiveStats.maxDequeueWaitTime, waitTime);
+            }
+            if (++mWindowDequeueCount < WINDOW_SIZE) {
+                return;
+            }
+            const uint32_t extraBuffers = mAdaptiveStats.extraBuffers;
+            if (mWindowBlockedCount >= BLOCKED_DEQUEUES_TO_GROW) {
+                mQuietWindowCount = 0;
+                if (extraBuffers < mMaxExtraBuffers) {
+                    newExtraBuffers = extraBuffers + 1;
+                }
+            } else if (mWindowBlockedCount > 0) {
+                mQuietWindowCount = 0;
+            } else if (++mQuietWindowCount >= QUIET_WINDOWS_TO_SHRINK) {
+                mQuietWindowCount = 0;
+                if (extraBuffers > 0) {
+                    newExtraBuffers = extraBuffers - 1;
+                }
+            }
+            mWindowDequeueCount = 0;
+            mWindowBlockedCount = 0;
+        }
+        if (newExtraBuffers) {
+            setExtraBuffers(*newExtraBuffers);
         }
-        return BufferQueueProducer::query(what, value);
     }
 
-private:
+    void setExtraBuffers(uint32_t extraBuffers) {
+        int requestedMaxDequeuedBufferCount;
+        {
+            std::lock_guard lock(mAdaptiveMutex);
+            requestedMaxDequeuedBufferCount = mRequestedMaxDequeuedBufferCount;
+        }
+        // Taking buffers away fails while the producer has more buffers dequeued than it would
+        // be allowed to, try again after the next window in that case. Freed slots release their
+        // GraphicBuffers.
+        if (applyMaxDequeuedBufferCount(requestedMaxDequeuedBufferCount + extraBuffers) != OK) {
+            return;
+        }
+        std::lock_guard lock(mAdaptiveMutex);
+        if (extraBuffers > mAdaptiveStats.extraBuffers) {
+            mAdaptiveStats.growCount++;
+        } else if (extraBuffers < mAdaptiveStats.extraBuffers) {
+            mAdaptiveStats.shrinkCount++;
+        }
+        mAdaptiveStats.extraBuffers = extraBuffers;
+        ATRACE_INT(mExtraBuffersTrace.c_str(), extraBuffers);
+    }
+
     const wp<BLASTBufferQueue> mBLASTBufferQueue;
+
+    mutable std::mutex mAdaptiveMutex;
+    // The max dequeued buffer count last requested by the producer.
+    int mRequestedMaxDequeuedBufferCount GUARDED_BY(mAdaptiveMutex) = 1;
+    uint32_t mMaxExtraBuffers GUARDED_BY(mAdaptiveMutex) = 0;
+    uint32_t mWindowDequeueCount GUARDED_BY(mAdaptiveMutex) = 0;
+    uint32_t mWindowBlockedCount GUARDED_BY(mAdaptiveMutex) = 0;
+    uint32_t mQuietWindowCount GUARDED_BY(mAdaptiveMutex) = 0;
+    BLASTBufferQueue::AdaptiveBufferCountStats mAdaptiveStats GUARDED_BY(mAdaptiveMutex);
+    std::string mExtraBuffersTrace GUARDED_BY(mAdaptiveMutex);
 };
 
 // Similar to BufferQueue::createBufferQueue but creates an adapter specific bufferqueue producer.
@@ -1192,6 +1346,15 @@ bool BLASTBufferQueue::isSameSurfaceControl(const sp<SurfaceControl>& surfaceCon
     return SurfaceControl::isSameSurface(mSurfaceControl, surfaceControl);
 }
 
+void BLASTBufferQueue::setAdaptiveBufferCount(uint32_t maxExtraBuffers) {
+    static_cast<BBQBufferQueueProducer*>(mProducer.get())
+            ->setAdaptiveBufferCount(maxExtraBuffers, mName);
+}
+
+BLASTBufferQueue::AdaptiveBufferCountStats BLASTBufferQueue::getAdaptiveBufferCountStats() const {
+    return static_cast<BBQBufferQueueProducer*>(mProducer.get())->getAdaptiveBufferCountStats();
+}
+
 void BLASTBufferQueue::setTransactionHangCallback(
         std::function<void(const std::string&)> callback) {
     std::lock_guard _lock{mMutex};
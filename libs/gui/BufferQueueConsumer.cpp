@@ -296,7 +296,7 @@ status_t BufferQueueConsumer::acquireBuffer(BufferItem* outBuffer,
         // We might have freed a slot while dropping old buffers, or the producer
         // may be blocked waiting for the number of buffers in the queue to
         // decrease.
-        mCore->mDequeueCondition.notify_all();
+        mCore->notifyDequeueConditionLocked();
 
         ATRACE_INT(mCore->mConsumerName.string(),
                 static_cast<int32_t>(mCore->mQueue.size()));
@@ -345,7 +345,7 @@ status_t BufferQueueConsumer::detachBuffer(int slot) {
     mCore->mActiveBuffers.erase(slot);
     mCore->mFreeSlots.insert(slot);
     mCore->clearBufferSlotLocked(slot);
-    mCore->mDequeueCondition.notify_all();
+    mCore->notifyDequeueConditionLocked();
     VALIDATE_CONSISTENCY();
 
     return NO_ERROR;
@@ -496,7 +496,7 @@ status_t BufferQueueConsumer::releaseBuffer(int slot, uint64_t frameNumber,
         }
         BQ_LOGV("releaseBuffer: releasing slot %d", slot);
 
-        mCore->mDequeueCondition.notify_all();
+        mCore->notifyDequeueConditionLocked();
         VALIDATE_CONSISTENCY();
     } // Autolock scope
 
@@ -550,7 +550,7 @@ status_t BufferQueueConsumer::disconnect() {
     mCore->mQueue.clear();
     mCore->freeAllBuffersLocked();
     mCore->mSharedBufferSlot = BufferQueueCore::INVALID_BUFFER_SLOT;
-    mCore->mDequeueCondition.notify_all();
+    mCore->notifyDequeueConditionLocked();
     return NO_ERROR;
 }
 
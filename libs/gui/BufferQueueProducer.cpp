@@ -198,7 +198,7 @@ status_t BufferQueueProducer::setMaxDequeuedBufferCount(int maxDequeuedBuffers,
         if (delta < 0) {
             listener = mCore->mConsumerListener;
         }
-        mCore->mDequeueCondition.notify_all();
+        mCore->notifyDequeueConditionLocked();
     } // Autolock scope
 
     // Call back without lock held
@@ -250,7 +250,7 @@ status_t BufferQueueProducer::setAsyncMode(bool async) {
         }
         mCore->mAsyncMode = async;
         VALIDATE_CONSISTENCY();
-        mCore->mDequeueCondition.notify_all();
+        mCore->notifyDequeueConditionLocked();
         if (delta < 0) {
             listener = mCore->mConsumerListener;
         }
@@ -372,14 +372,17 @@ status_t BufferQueueProducer::waitForFreeSlotThenRelock(FreeSlotCaller caller,
                     (acquiredCount <= mCore->mMaxAcquiredBufferCount)) {
                 return WOULD_BLOCK;
             }
+            mCore->mDequeueWaiterCount++;
             if (mDequeueTimeout >= 0) {
                 std::cv_status result = mCore->mDequeueCondition.wait_for(lock,
                         std::chrono::nanoseconds(mDequeueTimeout));
+                mCore->mDequeueWaiterCount--;
                 if (result == std::cv_status::timeout) {
                     return TIMED_OUT;
                 }
             } else {
                 mCore->mDequeueCondition.wait(lock);
+                mCore->mDequeueWaiterCount--;
             }
         }
     } // while (tryAgain)
@@ -700,7 +703,7 @@ status_t BufferQueueProducer::detachBuffer(int slot) {
         mCore->mActiveBuffers.erase(slot);
         mCore->mFreeSlots.insert(slot);
         mCore->clearBufferSlotLocked(slot);
-        mCore->mDequeueCondition.notify_all();
+        mCore->notifyDequeueConditionLocked();
         VALIDATE_CONSISTENCY();
     }
 
@@ -1037,7 +1040,7 @@ status_t BufferQueueProducer::queueBuffer(int slot,
         }
 
         mCore->mBufferHasBeenQueued = true;
-        mCore->mDequeueCondition.notify_all();
+        mCore->notifyDequeueConditionLocked();
         mCore->mLastQueuedSlot = slot;
 
         output->width = mCore->mDefaultWidth;
@@ -1174,7 +1177,7 @@ status_t BufferQueueProducer::cancelBuffer(int slot, const sp<Fence>& fence) {
             bufferId = gb->getId();
         }
         mSlots[slot].mFence = fence;
-        mCore->mDequeueCondition.notify_all();
+        mCore->notifyDequeueConditionLocked();
         listener = mCore->mConsumerListener;
         VALIDATE_CONSISTENCY();
     }
@@ -1407,7 +1410,7 @@ status_t BufferQueueProducer::disconnect(int api, DisconnectMode mode) {
                     mCore->mConnectedApi = BufferQueueCore::NO_CONNECTED_API;
                     mCore->mConnectedPid = -1;
                     mCore->mSidebandStream.clear();
-                    mCore->mDequeueCondition.notify_all();
+                    mCore->notifyDequeueConditionLocked();
                     mCore->mAutoPrerotation = false;
                     listener = mCore->mConsumerListener;
                 } else if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
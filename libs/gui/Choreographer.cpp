@@ -21,6 +21,10 @@
 #include <gui/TraceUtils.h>
 #include <jni.h>
 
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
 #undef LOG_TAG
 #define LOG_TAG "AChoreographer"
 
@@ -113,6 +117,11 @@ Choreographer::Choreographer(const sp<Looper>& looper, const sp<IBinder>& layerH
 }
 
 Choreographer::~Choreographer() {
+    PostedFrameCallback* posted = mPostedCallbacks.exchange(nullptr, std::memory_order_acquire);
+    while (posted != nullptr) {
+        delete std::exchange(posted, posted->next);
+    }
+
     std::lock_guard<std::mutex> _l(gChoreographers.lock);
     gChoreographers.ptrs.erase(std::remove_if(gChoreographers.ptrs.begin(),
                                               gChoreographers.ptrs.end(),
@@ -145,21 +154,22 @@ void Choreographer::postFrameCallbackDelayed(AChoreographer_frameCallback cb,
                                              AChoreographer_vsyncCallback vsyncCallback, void* data,
                                              nsecs_t delay) {
     nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
-    FrameCallback callback{cb, cb64, vsyncCallback, data, now + delay};
-    {
-        std::lock_guard<std::mutex> _l{mLock};
-        mFrameCallbacks.push(callback);
+    auto* posted = new PostedFrameCallback{{cb, cb64, vsyncCallback, data, now + delay}, nullptr};
+    posted->next = mPostedCallbacks.load(std::memory_order_relaxed);
+    while (!mPostedCallbacks.compare_exchange_weak(posted->next, posted, std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
     }
-    if (callback.dueTime <= now) {
-        if (std::this_thread::get_id() != mThreadId) {
-            if (mLooper != nullptr) {
-                Message m{MSG_SCHEDULE_VSYNC};
-                mLooper->sendMessage(this, m);
-            } else {
-                scheduleVsync();
-            }
+
+    if (delay <= 0) {
+        if (mVsyncRequested.exchange(true, std::memory_order_acq_rel)) {
+            // The callback will run on the vsync that was already requested.
+            return;
+        }
+        if (std::this_thread::get_id() != mThreadId && mLooper != nullptr) {
+            Message m{MSG_SCHEDULE_VSYNC};
+            mLooper->sendMessage(this, m);
         } else {
-            scheduleVsync();
+            scheduleVsyncForCallbacks();
         }
     } else {
         if (mLooper != nullptr) {
@@ -249,6 +259,7 @@ void Choreographer::scheduleCallbacks() {
     nsecs_t dueTime;
     {
         std::lock_guard<std::mutex> _l{mLock};
+        drainPostedCallbacks();
         // If there are no pending callbacks then don't schedule a vsync
         if (mFrameCallbacks.empty()) {
             return;
@@ -256,13 +267,43 @@ void Choreographer::scheduleCallbacks() {
         dueTime = mFrameCallbacks.top().dueTime;
     }
 
-    if (dueTime <= now) {
+    if (dueTime <= now && !mVsyncRequested.exchange(true, std::memory_order_acq_rel)) {
         ALOGV("choreographer %p ~ scheduling vsync", this);
-        scheduleVsync();
+        scheduleVsyncForCallbacks();
         return;
     }
 }
 
+void Choreographer::scheduleVsyncForCallbacks() {
+    if (scheduleVsync() != OK) {
+        // Let the next callback try again.
+        mVsyncRequested.store(false, std::memory_order_release);
+    }
+}
+
+void Choreographer::drainPostedCallbacks() {
+    PostedFrameCallback* posted = mPostedCallbacks.exchange(nullptr, std::memory_order_acquire);
+    while (posted != nullptr) {
+        mFrameCallbacks.push(posted->callback);
+        delete std::exchange(posted, posted->next);
+    }
+}
+
+void Choreographer::recordCallbackLatency(nsecs_t latency) {
+    const auto it = std::upper_bound(kCallbackLatencyBucketLimitsUs.begin(),
+                                     kCallbackLatencyBucketLimitsUs.end(), ns2us(latency));
+    mCallbackLatencyHistogram[std::distance(kCallbackLatencyBucketLimitsUs.begin(), it)]
+            .fetch_add(1, std::memory_order_relaxed);
+}
+
+Choreographer::CallbackLatencyHistogram Choreographer::getCallbackLatencyHistogram() const {
+    CallbackLatencyHistogram histogram;
+    for (size_t i = 0; i < histogram.size(); i++) {
+        histogram[i] = mCallbackLatencyHistogram[i].load(std::memory_order_relaxed);
+    }
+    return histogram;
+}
+
 void Choreographer::handleRefreshRateUpdates() {
     std::vector<RefreshRateCallback> callbacks{};
     const nsecs_t pendingPeriod = gChoreographers.mLastKnownVsync.load();
@@ -287,17 +328,28 @@ void Choreographer::handleRefreshRateUpdates() {
 
 void Choreographer::dispatchVsync(nsecs_t timestamp, PhysicalDisplayId, uint32_t,
                                   VsyncEventData vsyncEventData) {
-    std::vector<FrameCallback> callbacks{};
+    // Callbacks posted from now on, including by the callbacks below, need another vsync.
+    mVsyncRequested.store(false, std::memory_order_release);
+
+    // Take the callbacks that are due, and run them without holding mLock, so that they can post
+    // callbacks for the next frame.
+    std::vector<FrameCallback> callbacks = std::move(mDueCallbacks);
     {
         std::lock_guard<std::mutex> _l{mLock};
+        drainPostedCallbacks();
         nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
-        while (!mFrameCallbacks.empty() && mFrameCallbacks.top().dueTime < now) {
+        while (!mFrameCallbacks.empty() && mFrameCallbacks.top().dueTime <= now) {
             callbacks.push_back(mFrameCallbacks.top());
             mFrameCallbacks.pop();
         }
     }
     mLastVsyncEventData = vsyncEventData;
+    nsecs_t maxLatency = 0;
     for (const auto& cb : callbacks) {
+        const nsecs_t latency = systemTime(SYSTEM_TIME_MONOTONIC) - cb.dueTime;
+        recordCallbackLatency(latency);
+        maxLatency = std::max(maxLatency, latency);
+
         if (cb.vsyncCallback != nullptr) {
             ATRACE_FORMAT("AChoreographer_vsyncCallback %" PRId64,
                           vsyncEventData.preferredVsyncId());
@@ -317,6 +369,12 @@ void Choreographer::dispatchVsync(nsecs_t timestamp, PhysicalDisplayId, uint32_t
             cb.callback(timestamp, cb.data);
         }
     }
+    if (!callbacks.empty()) {
+        ATRACE_INT64("AChoreographer callback latency (us)", ns2us(maxLatency));
+    }
+
+    callbacks.clear();
+    mDueCallbacks = std::move(callbacks);
 }
 
 void Choreographer::dispatchHotplug(nsecs_t, PhysicalDisplayId displayId, bool connected) {
@@ -344,7 +402,7 @@ void Choreographer::handleMessage(const Message& message) {
             scheduleCallbacks();
             break;
         case MSG_SCHEDULE_VSYNC:
-            scheduleVsync();
+            scheduleVsyncForCallbacks();
             break;
         case MSG_HANDLE_REFRESH_RATE_UPDATES:
             handleRefreshRateUpdates();
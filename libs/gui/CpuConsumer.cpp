@@ -23,6 +23,8 @@
 #include <gui/BufferItem.h>
 #include <utils/Log.h>
 
+#include <algorithm>
+
 #define CC_LOGV(x, ...) ALOGV("[%s] " x, mName.string(), ##__VA_ARGS__)
 //#define CC_LOGD(x, ...) ALOGD("[%s] " x, mName.string(), ##__VA_ARGS__)
 //#define CC_LOGI(x, ...) ALOGI("[%s] " x, mName.string(), ##__VA_ARGS__)
@@ -35,8 +37,11 @@ CpuConsumer::CpuConsumer(const sp<IGraphicBufferConsumer>& bq,
         size_t maxLockedBuffers, bool controlledByApp) :
     ConsumerBase(bq, controlledByApp),
     mMaxLockedBuffers(maxLockedBuffers),
-    mCurrentLockedBuffers(0)
+    mCurrentLockedBuffers(0),
+    mLockLatencyHistogram{}
 {
+    mSlotMappings.fill(Mapping::Unknown);
+
     // Create tracking entries for locked buffers
     mAcquiredBuffers.insertAt(0, maxLockedBuffers);
 
@@ -88,7 +93,42 @@ static bool isPossiblyYUV(PixelFormat format) {
     }
 }
 
-status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer) const {
+bool CpuConsumer::isBufferLockedLocked(const sp<GraphicBuffer>& buffer) const {
+    for (size_t i = 0; i < mMaxLockedBuffers; i++) {
+        if (mAcquiredBuffers[i].mGraphicBuffer == buffer) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CpuConsumer::keepBufferMappedLocked(int slot, const sp<GraphicBuffer>& buffer) {
+    if (slot < 0 || slot >= BufferQueueDefs::NUM_BUFFER_SLOTS ||
+        mSlotMappings[slot] != Mapping::Unknown || mSlots[slot].mGraphicBuffer != buffer) {
+        return;
+    }
+    // Not every buffer can stay mapped, e.g. if it is not backed by a dma-buf, in which case it
+    // keeps being mapped by every lock.
+    if (buffer->setPersistentCpuMapping(true) == OK) {
+        mSlotMappings[slot] = Mapping::Persistent;
+    } else {
+        CC_LOGV("buffer in slot %d cannot stay mapped", slot);
+        mSlotMappings[slot] = Mapping::Unsupported;
+    }
+}
+
+void CpuConsumer::freeBufferLocked(int slotIndex) {
+    const sp<GraphicBuffer>& buffer = mSlots[slotIndex].mGraphicBuffer;
+    if (mSlotMappings[slotIndex] == Mapping::Persistent && buffer != nullptr &&
+        !isBufferLockedLocked(buffer)) {
+        buffer->setPersistentCpuMapping(false);
+    }
+    mSlotMappings[slotIndex] = Mapping::Unknown;
+    ConsumerBase::freeBufferLocked(slotIndex);
+}
+
+status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer) {
+    const nsecs_t lockStart = systemTime();
     android_ycbcr ycbcr = android_ycbcr();
 
     PixelFormat format = item.mGraphicBuffer->getPixelFormat();
@@ -117,6 +157,9 @@ status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBu
         outBuffer->chromaStep = static_cast<uint32_t>(ycbcr.chroma_step);
     } else {
         // not flexible YUV; try lockAsync
+        if (!isPossiblyYUV(format)) {
+            keepBufferMappedLocked(item.mSlot, item.mGraphicBuffer);
+        }
         void* bufferPointer = nullptr;
         int fenceFd = item.mFence.get() ? item.mFence->dup() : -1;
         status_t err = item.mGraphicBuffer->lockAsync(GraphicBuffer::USAGE_SW_READ_OFTEN,
@@ -146,16 +189,49 @@ status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBu
     outBuffer->dataSpace = item.mDataSpace;
     outBuffer->frameNumber = item.mFrameNumber;
 
+    outBuffer->lockDuration = systemTime() - lockStart;
+    const auto it = std::upper_bound(kLockLatencyBucketLimitsUs.begin(),
+                                     kLockLatencyBucketLimitsUs.end(),
+                                     ns2us(outBuffer->lockDuration));
+    mLockLatencyHistogram[std::distance(kLockLatencyBucketLimitsUs.begin(), it)]++;
+
     return OK;
 }
 
 status_t CpuConsumer::lockNextBuffer(LockedBuffer *nativeBuffer) {
-    status_t err;
-
     if (!nativeBuffer) return BAD_VALUE;
 
+    Mutex::Autolock _l(mMutex);
+    return lockNextBufferLocked(nativeBuffer);
+}
+
+status_t CpuConsumer::lockNextBuffers(LockedBuffer* nativeBuffers, size_t count,
+                                      size_t* outCount) {
+    if (!nativeBuffers || !count || !outCount) return BAD_VALUE;
+
     Mutex::Autolock _l(mMutex);
 
+    *outCount = 0;
+    while (*outCount < count) {
+        status_t err = lockNextBufferLocked(&nativeBuffers[*outCount]);
+        if (err != OK) {
+            // The buffers locked so far are still returned, and the next call reports the error
+            // if it persists.
+            return *outCount > 0 ? OK : err;
+        }
+        (*outCount)++;
+    }
+    return OK;
+}
+
+CpuConsumer::LockLatencyHistogram CpuConsumer::getLockLatencyHistogram() const {
+    Mutex::Autolock _l(mMutex);
+    return mLockLatencyHistogram;
+}
+
+status_t CpuConsumer::lockNextBufferLocked(LockedBuffer* nativeBuffer) {
+    status_t err;
+
     if (mCurrentLockedBuffers == mMaxLockedBuffers) {
         CC_LOGW("Max buffers have been locked (%zd), cannot lock anymore.",
                 mMaxLockedBuffers);
@@ -175,6 +251,9 @@ status_t CpuConsumer::lockNextBuffer(LockedBuffer *nativeBuffer) {
 
     if (b.mGraphicBuffer == nullptr) {
         b.mGraphicBuffer = mSlots[b.mSlot].mGraphicBuffer;
+    } else {
+        // A new buffer in the slot, which has not been mapped yet.
+        mSlotMappings[b.mSlot] = Mapping::Unknown;
     }
 
     err = lockBufferItem(b, nativeBuffer);
@@ -221,6 +300,11 @@ status_t CpuConsumer::unlockBuffer(const LockedBuffer &nativeBuffer) {
     addReleaseFenceLocked(ab.mSlot, ab.mGraphicBuffer, fence);
     releaseBufferLocked(ab.mSlot, ab.mGraphicBuffer);
 
+    // The slot was freed while the buffer was locked, so the buffer is not mapped for it anymore.
+    if (mSlots[ab.mSlot].mGraphicBuffer != ab.mGraphicBuffer) {
+        ab.mGraphicBuffer->setPersistentCpuMapping(false);
+    }
+
     ab.reset();
 
     mCurrentLockedBuffers--;
@@ -22,6 +22,7 @@
 
 #include <gui/DisplayEventReceiver.h>
 #include <gui/VsyncEventData.h>
+#include <gui/VsyncTimeline.h>
 
 #include <private/gui/ComposerServiceAIDL.h>
 
@@ -33,6 +34,10 @@ namespace android {
 
 // ---------------------------------------------------------------------------
 
+// Shorter than the interval at which SurfaceFlinger resyncs to hardware vsync
+// when asked to, see Scheduler::resync.
+static constexpr nsecs_t kBinderVsyncRequestInterval = ms2ns(500);
+
 DisplayEventReceiver::DisplayEventReceiver(gui::ISurfaceComposer::VsyncSource vsyncSource,
                                            EventRegistrationFlags eventRegistration,
                                            const sp<IBinder>& layerHandle) {
@@ -53,6 +58,12 @@ DisplayEventReceiver::DisplayEventReceiver(gui::ISurfaceComposer::VsyncSource vs
                 mInitError = std::make_optional<status_t>(status.transactionError());
                 mDataChannel.reset();
                 mEventConnection.clear();
+            } else {
+                std::optional<os::ParcelFileDescriptor> timelineFd;
+                status = mEventConnection->getVsyncTimeline(&timelineFd);
+                if (status.isOk() && timelineFd) {
+                    mTimeline = gui::VsyncTimeline::fromFd(timelineFd->release());
+                }
             }
         } else {
             ALOGE("DisplayEventConnection creation failed: status=%s", status.toString8().c_str());
@@ -88,6 +99,12 @@ status_t DisplayEventReceiver::setVsyncRate(uint32_t count) {
 
 status_t DisplayEventReceiver::requestNextVsync() {
     if (mEventConnection != nullptr) {
+        const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (mTimeline && now - mLastBinderVsyncRequestTime < kBinderVsyncRequestInterval &&
+            mTimeline->requestNextVsync()) {
+            return NO_ERROR;
+        }
+        mLastBinderVsyncRequestTime = now;
         mEventConnection->requestNextVsync();
         return NO_ERROR;
     }
@@ -97,6 +114,14 @@ status_t DisplayEventReceiver::requestNextVsync() {
 status_t DisplayEventReceiver::getLatestVsyncEventData(
         ParcelableVsyncEventData* outVsyncEventData) const {
     if (mEventConnection != nullptr) {
+        gui::VsyncTimeline::Snapshot snapshot;
+        if (mTimeline && mTimeline->read(&snapshot) &&
+            gui::VsyncTimeline::getLatestVsyncEventData(snapshot,
+                                                        systemTime(SYSTEM_TIME_MONOTONIC),
+                                                        &outVsyncEventData->vsync)) {
+            return NO_ERROR;
+        }
+
         auto status = mEventConnection->getLatestVsyncEventData(outVsyncEventData);
         if (!status.isOk()) {
             ALOGE("Failed to get latest vsync event data: %s", status.exceptionMessage().c_str());
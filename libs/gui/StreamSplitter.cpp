@@ -33,6 +33,8 @@
 
 #include <system/window.h>
 
+#include <algorithm>
+
 namespace android {
 
 status_t StreamSplitter::createSplitter(
@@ -62,9 +64,12 @@ StreamSplitter::StreamSplitter(const sp<IGraphicBufferConsumer>& inputQueue)
 
 StreamSplitter::~StreamSplitter() {
     mInput->consumerDisconnect();
-    Vector<sp<IGraphicBufferProducer> >::iterator output = mOutputs.begin();
-    for (; output != mOutputs.end(); ++output) {
-        (*output)->disconnect(NATIVE_WINDOW_API_CPU);
+    for (const sp<Output>& output : mOutputs) {
+        output->stop();
+        output->getProducer()->disconnect(NATIVE_WINDOW_API_CPU);
+    }
+    for (const sp<Output>& output : mOutputs) {
+        output->join();
     }
 
     if (mBuffers.size() > 0) {
@@ -73,7 +78,7 @@ StreamSplitter::~StreamSplitter() {
 }
 
 status_t StreamSplitter::addOutput(
-        const sp<IGraphicBufferProducer>& outputQueue) {
+        const sp<IGraphicBufferProducer>& outputQueue, DropPolicy dropPolicy) {
     if (outputQueue == nullptr) {
         ALOGE("addOutput: outputQueue must not be NULL");
         return BAD_VALUE;
@@ -91,11 +96,43 @@ status_t StreamSplitter::addOutput(
         return status;
     }
 
-    mOutputs.push_back(outputQueue);
+    if (dropPolicy == DropPolicy::DropOldest) {
+        // Fail to attach rather than wait for a free slot, and replace the
+        // queued buffer that the consumer has not acquired yet.
+        status = outputQueue->setDequeueTimeout(0);
+        if (status == NO_ERROR) {
+            status = outputQueue->setAsyncMode(true);
+        }
+        if (status != NO_ERROR) {
+            ALOGE("addOutput: failed to set up dropping buffers (%d)", status);
+            outputQueue->disconnect(NATIVE_WINDOW_API_CPU);
+            return status;
+        }
+    }
+
+    mOutputs.push_back(new Output(this, outputQueue, dropPolicy));
 
     return NO_ERROR;
 }
 
+status_t StreamSplitter::getOutputStats(
+        const sp<IGraphicBufferProducer>& outputQueue,
+        OutputStats* outStats) const {
+    if (outputQueue == nullptr || outStats == nullptr) {
+        return BAD_VALUE;
+    }
+
+    Mutex::Autolock lock(mMutex);
+    for (const sp<Output>& output : mOutputs) {
+        if (IInterface::asBinder(output->getProducer()) ==
+                IInterface::asBinder(outputQueue)) {
+            *outStats = output->getStats();
+            return NO_ERROR;
+        }
+    }
+    return NAME_NOT_FOUND;
+}
+
 void StreamSplitter::setName(const String8 &name) {
     Mutex::Autolock lock(mMutex);
     mInput->setConsumerName(name);
@@ -103,97 +140,82 @@ void StreamSplitter::setName(const String8 &name) {
 
 void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
     ATRACE_CALL();
-    Mutex::Autolock lock(mMutex);
-
-    // The current policy is that if any one consumer is consuming buffers too
-    // slowly, the splitter will stall the rest of the outputs by not acquiring
-    // any more buffers from the input. This will cause back pressure on the
-    // input queue, slowing down its producer.
-
-    // If there are too many outstanding buffers, we block until a buffer is
-    // released back to the input in onBufferReleased
-    while (mOutstandingBuffers >= MAX_OUTSTANDING_BUFFERS) {
-        mReleaseCondition.wait(mMutex);
-
-        // If the splitter is abandoned while we are waiting, the release
-        // condition variable will be broadcast, and we should just return
-        // without attempting to do anything more (since the input queue will
-        // also be abandoned).
-        if (mIsAbandoned) {
-            return;
+    const nsecs_t receivedTime = systemTime();
+    Vector<sp<Output> > blockingOutputs;
+    Vector<uint64_t> blockingSequences;
+
+    {
+        Mutex::Autolock lock(mMutex);
+
+        // The current policy is that if any one consumer is holding on to
+        // buffers for too long, the splitter will stall the rest of the outputs
+        // by not acquiring any more buffers from the input. This will cause
+        // back pressure on the input queue, slowing down its producer. Outputs
+        // that drop buffers only hold on to the buffers that they acquired.
+
+        // If there are too many outstanding buffers, we block until a buffer is
+        // released back to the input in onBufferReleased
+        while (mOutstandingBuffers >= MAX_OUTSTANDING_BUFFERS) {
+            mReleaseCondition.wait(mMutex);
+
+            // If the splitter is abandoned while we are waiting, the release
+            // condition variable will be broadcast, and we should just return
+            // without attempting to do anything more (since the input queue will
+            // also be abandoned).
+            if (mIsAbandoned) {
+                return;
+            }
         }
-    }
-    ++mOutstandingBuffers;
+        ++mOutstandingBuffers;
 
-    // Acquire and detach the buffer from the input
-    BufferItem bufferItem;
-    status_t status = mInput->acquireBuffer(&bufferItem, /* presentWhen */ 0);
-    LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
-            "acquiring buffer from input failed (%d)", status);
-
-    ALOGV("acquired buffer %#" PRIx64 " from input",
-            bufferItem.mGraphicBuffer->getId());
-
-    status = mInput->detachBuffer(bufferItem.mSlot);
-    LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
-            "detaching buffer from input failed (%d)", status);
+        // Acquire and detach the buffer from the input
+        BufferItem bufferItem;
+        status_t status = mInput->acquireBuffer(&bufferItem, /* presentWhen */ 0);
+        LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
+                "acquiring buffer from input failed (%d)", status);
 
-    // Initialize our reference count for this buffer
-    mBuffers.add(bufferItem.mGraphicBuffer->getId(),
-            new BufferTracker(bufferItem.mGraphicBuffer));
+        ALOGV("acquired buffer %#" PRIx64 " from input",
+                bufferItem.mGraphicBuffer->getId());
 
-    IGraphicBufferProducer::QueueBufferInput queueInput(
-            bufferItem.mTimestamp, bufferItem.mIsAutoTimestamp,
-            bufferItem.mDataSpace, bufferItem.mCrop,
-            static_cast<int32_t>(bufferItem.mScalingMode),
-            bufferItem.mTransform, bufferItem.mFence);
-
-    // Attach and queue the buffer to each of the outputs
-    Vector<sp<IGraphicBufferProducer> >::iterator output = mOutputs.begin();
-    for (; output != mOutputs.end(); ++output) {
-        int slot;
-        status = (*output)->attachBuffer(&slot, bufferItem.mGraphicBuffer);
-        if (status == NO_INIT) {
-            // If we just discovered that this output has been abandoned, note
-            // that, increment the release count so that we still release this
-            // buffer eventually, and move on to the next output
-            onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
-            continue;
-        } else {
-            LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
-                    "attaching buffer to output failed (%d)", status);
-        }
-
-        IGraphicBufferProducer::QueueBufferOutput queueOutput;
-        status = (*output)->queueBuffer(slot, queueInput, &queueOutput);
-        if (status == NO_INIT) {
-            // If we just discovered that this output has been abandoned, note
-            // that, increment the release count so that we still release this
-            // buffer eventually, and move on to the next output
-            onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
-            continue;
-        } else {
-            LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
-                    "queueing buffer to output failed (%d)", status);
+        status = mInput->detachBuffer(bufferItem.mSlot);
+        LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
+                "detaching buffer from input failed (%d)", status);
+
+        // Initialize our reference count for this buffer
+        mBuffers.add(bufferItem.mGraphicBuffer->getId(),
+                new BufferTracker(bufferItem.mGraphicBuffer));
+
+        // Hand the buffer to each of the outputs, which attach and queue it on
+        // their own threads
+        for (const sp<Output>& output : mOutputs) {
+            Vector<sp<GraphicBuffer> > dropped;
+            const uint64_t sequence = output->enqueue(bufferItem, receivedTime, &dropped);
+            for (const sp<GraphicBuffer>& buffer : dropped) {
+                ALOGV("dropped buffer %#" PRIx64 " for output %p", buffer->getId(),
+                        output->getProducer().get());
+                releaseBufferLocked(buffer->getId(), Fence::NO_FENCE);
+            }
+            if (output->getDropPolicy() == DropPolicy::Block) {
+                blockingOutputs.push_back(output);
+                blockingSequences.push_back(sequence);
+            }
         }
+    }
 
-        ALOGV("queued buffer %#" PRIx64 " to output %p",
-                bufferItem.mGraphicBuffer->getId(), output->get());
+    for (size_t i = 0; i < blockingOutputs.size(); ++i) {
+        blockingOutputs[i]->waitUntilQueued(blockingSequences[i]);
     }
 }
 
 void StreamSplitter::onBufferReleasedByOutput(
         const sp<IGraphicBufferProducer>& from) {
     ATRACE_CALL();
-    Mutex::Autolock lock(mMutex);
 
     sp<GraphicBuffer> buffer;
     sp<Fence> fence;
     status_t status = from->detachNextBuffer(&buffer, &fence);
+
+    Mutex::Autolock lock(mMutex);
     if (status == NO_INIT) {
         // If we just discovered that this output has been abandoned, note that,
         // but we can't do anything else, since buffer is invalid
@@ -207,7 +229,29 @@ void StreamSplitter::onBufferReleasedByOutput(
     ALOGV("detached buffer %#" PRIx64 " from output %p",
           buffer->getId(), from.get());
 
-    const sp<BufferTracker>& tracker = mBuffers.editValueFor(buffer->getId());
+    releaseBufferLocked(buffer->getId(), fence);
+}
+
+void StreamSplitter::onBufferSkippedByOutput(const sp<GraphicBuffer>& buffer,
+        bool abandoned) {
+    Mutex::Autolock lock(mMutex);
+    if (abandoned) {
+        // If we just discovered that this output has been abandoned, note
+        // that, and still count it as releasing this buffer so that the buffer
+        // is released eventually
+        onAbandonedLocked();
+    }
+    releaseBufferLocked(buffer->getId(), Fence::NO_FENCE);
+}
+
+void StreamSplitter::releaseBufferLocked(uint64_t bufferId,
+        const sp<Fence>& fence) {
+    ssize_t index = mBuffers.indexOfKey(bufferId);
+    if (index < 0) {
+        ALOGE("buffer %#" PRIx64 " is not tracked", bufferId);
+        return;
+    }
+    const sp<BufferTracker> tracker = mBuffers.valueAt(static_cast<size_t>(index));
 
     // Merge the release fence of the incoming buffer so that the fence we send
     // back to the input includes all of the outputs' fences
@@ -215,7 +259,7 @@ void StreamSplitter::onBufferReleasedByOutput(
 
     // Check to see if this is the last outstanding reference to this buffer
     size_t releaseCount = tracker->incrementReleaseCountLocked();
-    ALOGV("buffer %#" PRIx64 " reference count %zu (of %zu)", buffer->getId(),
+    ALOGV("buffer %#" PRIx64 " reference count %zu (of %zu)", bufferId,
             releaseCount, mOutputs.size());
     if (releaseCount < mOutputs.size()) {
         return;
@@ -224,13 +268,13 @@ void StreamSplitter::onBufferReleasedByOutput(
     // If we've been abandoned, we can't return the buffer to the input, so just
     // stop tracking it and move on
     if (mIsAbandoned) {
-        mBuffers.removeItem(buffer->getId());
+        mBuffers.removeItem(bufferId);
         return;
     }
 
     // Attach and release the buffer back to the input
     int consumerSlot;
-    status = mInput->attachBuffer(&consumerSlot, tracker->getBuffer());
+    status_t status = mInput->attachBuffer(&consumerSlot, tracker->getBuffer());
     LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
             "attaching buffer to input failed (%d)", status);
 
@@ -239,11 +283,11 @@ void StreamSplitter::onBufferReleasedByOutput(
     LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
             "releasing buffer to input failed (%d)", status);
 
-    ALOGV("released buffer %#" PRIx64 " to input", buffer->getId());
+    ALOGV("released buffer %#" PRIx64 " to input", bufferId);
 
     // We no longer need to track the buffer once it has been returned to the
     // input
-    mBuffers.removeItem(buffer->getId());
+    mBuffers.removeItem(bufferId);
 
     // Notify any waiting onFrameAvailable calls
     --mOutstandingBuffers;
@@ -275,6 +319,151 @@ void StreamSplitter::OutputListener::binderDied(const wp<IBinder>& /* who */) {
     mSplitter->onAbandonedLocked();
 }
 
+StreamSplitter::Output::Output(StreamSplitter* splitter,
+        const sp<IGraphicBufferProducer>& producer, DropPolicy dropPolicy)
+      : mSplitter(splitter), mProducer(producer), mDropPolicy(dropPolicy),
+        mThread([this] { threadMain(); }) {}
+
+StreamSplitter::Output::~Output() {
+    stop();
+    join();
+}
+
+uint64_t StreamSplitter::Output::enqueue(const BufferItem& item,
+        nsecs_t receivedTime, Vector<sp<GraphicBuffer> >* outDropped) {
+    Mutex::Autolock lock(mMutex);
+    if (mDropPolicy == DropPolicy::DropOldest) {
+        // Only the latest buffer waits for the output
+        while (!mPending.empty()) {
+            outDropped->push_back(mPending.front().item.mGraphicBuffer);
+            mPending.pop_front();
+            mStats.droppedFrames++;
+        }
+    }
+
+    Frame frame;
+    frame.sequence = ++mNextSequence;
+    frame.item = item;
+    frame.receivedTime = receivedTime;
+    mPending.push_back(std::move(frame));
+    mPendingCondition.signal();
+    return mNextSequence;
+}
+
+void StreamSplitter::Output::waitUntilQueued(uint64_t sequence) {
+    Mutex::Autolock lock(mMutex);
+    while (!mStopped && mQueuedSequence < sequence) {
+        mQueuedCondition.wait(mMutex);
+    }
+}
+
+StreamSplitter::OutputStats StreamSplitter::Output::getStats() const {
+    Mutex::Autolock lock(mMutex);
+    return mStats;
+}
+
+void StreamSplitter::Output::stop() {
+    Mutex::Autolock lock(mMutex);
+    mStopped = true;
+    mPendingCondition.signal();
+    mQueuedCondition.broadcast();
+}
+
+void StreamSplitter::Output::join() {
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void StreamSplitter::Output::threadMain() {
+    while (true) {
+        Frame frame;
+        {
+            Mutex::Autolock lock(mMutex);
+            while (!mStopped && mPending.empty()) {
+                mPendingCondition.wait(mMutex);
+            }
+            if (mStopped) {
+                return;
+            }
+            frame = std::move(mPending.front());
+            mPending.pop_front();
+        }
+
+        bool replaced = false;
+        const status_t status = attachAndQueue(frame.item, &replaced);
+        const nsecs_t latency = systemTime() - frame.receivedTime;
+        {
+            Mutex::Autolock lock(mMutex);
+            if (mStopped) {
+                return;
+            }
+            if (status == NO_ERROR) {
+                mStats.queuedFrames++;
+                mStats.lastLatency = latency;
+                mStats.maxLatency = std::max(mStats.maxLatency, latency);
+                mStats.totalLatency += latency;
+            } else if (status != NO_INIT) {
+                mStats.droppedFrames++;
+            }
+            if (replaced) {
+                mStats.droppedFrames++;
+            }
+        }
+
+        if (status != NO_ERROR) {
+            mSplitter->onBufferSkippedByOutput(frame.item.mGraphicBuffer,
+                    status == NO_INIT);
+        }
+        if (replaced) {
+            // The output freed the buffer that this one replaced without
+            // releasing it, so detach it as if it was released
+            mSplitter->onBufferReleasedByOutput(mProducer);
+        }
+
+        Mutex::Autolock lock(mMutex);
+        mQueuedSequence = frame.sequence;
+        mQueuedCondition.broadcast();
+    }
+}
+
+status_t StreamSplitter::Output::attachAndQueue(const BufferItem& item,
+        bool* outReplaced) {
+    ATRACE_CALL();
+    int slot;
+    status_t status = mProducer->attachBuffer(&slot, item.mGraphicBuffer);
+    if (status == NO_INIT) {
+        return status;
+    }
+    if (mDropPolicy == DropPolicy::DropOldest &&
+            (status == WOULD_BLOCK || status == TIMED_OUT)) {
+        ALOGV("output %p has no free slot, dropping buffer %#" PRIx64,
+                mProducer.get(), item.mGraphicBuffer->getId());
+        return status;
+    }
+    LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
+            "attaching buffer to output failed (%d)", status);
+
+    IGraphicBufferProducer::QueueBufferInput queueInput(
+            item.mTimestamp, item.mIsAutoTimestamp,
+            item.mDataSpace, item.mCrop,
+            static_cast<int32_t>(item.mScalingMode),
+            item.mTransform, item.mFence);
+
+    IGraphicBufferProducer::QueueBufferOutput queueOutput;
+    status = mProducer->queueBuffer(slot, queueInput, &queueOutput);
+    if (status == NO_INIT) {
+        return status;
+    }
+    LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
+            "queueing buffer to output failed (%d)", status);
+
+    ALOGV("queued buffer %#" PRIx64 " to output %p",
+            item.mGraphicBuffer->getId(), mProducer.get());
+    *outReplaced = queueOutput.bufferReplaced;
+    return NO_ERROR;
+}
+
 StreamSplitter::BufferTracker::BufferTracker(const sp<GraphicBuffer>& buffer)
       : mBuffer(buffer), mMergedFence(Fence::NO_FENCE), mReleaseCount(0) {}
 
@@ -130,6 +130,18 @@ Surface::~Surface() {
     if (mConnectedToCpu) {
         Surface::disconnect(NATIVE_WINDOW_API_CPU);
     }
+    if (mDequeueAheadThread.joinable()) {
+        {
+            Mutex::Autolock lock(mMutex);
+            cancelDequeuedAheadBufferLocked();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mDequeueAheadMutex);
+            mDequeueAheadThreadExit = true;
+        }
+        mDequeueAheadCondition.notify_all();
+        mDequeueAheadThread.join();
+    }
 }
 
 sp<ISurfaceComposer> Surface::composerService() const {
@@ -180,6 +192,104 @@ status_t Surface::setDequeueTimeout(nsecs_t timeout) {
     return mGraphicBufferProducer->setDequeueTimeout(timeout);
 }
 
+void Surface::setDequeueAhead(bool enable) {
+    ATRACE_CALL();
+    Mutex::Autolock lock(mMutex);
+    if (mDequeueAheadEnabled == enable) {
+        return;
+    }
+    mDequeueAheadEnabled = enable;
+    if (!enable) {
+        cancelDequeuedAheadBufferLocked();
+    } else if (!mDequeueAheadThread.joinable()) {
+        // The thread inherits the scheduling policy of the caller, typically the render thread.
+        mDequeueAheadThread = std::thread(&Surface::dequeueAheadThreadMain, this);
+        pthread_setname_np(mDequeueAheadThread.native_handle(), "DequeueAhead");
+    }
+}
+
+nsecs_t Surface::getLastDequeueAheadDuration() const {
+    Mutex::Autolock lock(mMutex);
+    return mLastDequeueAheadDuration;
+}
+
+void Surface::dequeueAheadThreadMain() {
+    std::unique_lock<std::mutex> lock(mDequeueAheadMutex);
+    while (true) {
+        mDequeueAheadCondition.wait(lock, [this] {
+            return mDequeueAheadThreadExit || mDequeueAheadRequest.has_value();
+        });
+        if (mDequeueAheadThreadExit) {
+            return;
+        }
+        DequeuedAheadBuffer dequeued{.input = *mDequeueAheadRequest};
+        mDequeueAheadRequest.reset();
+        lock.unlock();
+
+        ATRACE_FORMAT("dequeueBuffer ahead - %s", getDebugName());
+        const nsecs_t startTime = systemTime();
+        const auto& input = dequeued.input;
+        dequeued.result =
+                mGraphicBufferProducer->dequeueBuffer(&dequeued.slot, &dequeued.fence, input.width,
+                                                      input.height, input.format, input.usage,
+                                                      &dequeued.bufferAge,
+                                                      input.getTimestamps
+                                                              ? &dequeued.frameTimestamps
+                                                              : nullptr);
+        dequeued.duration = systemTime() - startTime;
+
+        lock.lock();
+        mDequeuedAheadBuffer = std::move(dequeued);
+        mDequeueAheadCondition.notify_all();
+    }
+}
+
+void Surface::dequeueAheadLocked() {
+    if (!mDequeueAheadEnabled || mSharedBufferMode ||
+        static_cast<int>(mDequeuedSlots.size()) >= mMaxDequeuedBufferCount) {
+        return;
+    }
+
+    IGraphicBufferProducer::DequeueBufferInput input;
+    getDequeueBufferInputLocked(&input);
+
+    std::lock_guard<std::mutex> lock(mDequeueAheadMutex);
+    if (mDequeueAheadPending) {
+        return;
+    }
+    mDequeueAheadPending = true;
+    mDequeueAheadRequest = input;
+    mDequeueAheadCondition.notify_all();
+}
+
+std::optional<Surface::DequeuedAheadBuffer> Surface::takeDequeuedAheadBuffer() {
+    std::unique_lock<std::mutex> lock(mDequeueAheadMutex);
+    if (!mDequeueAheadPending) {
+        return std::nullopt;
+    }
+    mDequeueAheadCondition.wait(lock, [this] { return mDequeuedAheadBuffer.has_value(); });
+    mDequeueAheadPending = false;
+    auto dequeued = std::move(mDequeuedAheadBuffer);
+    mDequeuedAheadBuffer.reset();
+    return dequeued;
+}
+
+void Surface::cancelDequeuedAheadBufferLocked() {
+    if (const auto dequeued = takeDequeuedAheadBuffer()) {
+        cancelDequeuedAheadBufferLocked(*dequeued);
+    }
+}
+
+void Surface::cancelDequeuedAheadBufferLocked(const DequeuedAheadBuffer& dequeued) {
+    if (dequeued.result < 0) {
+        return;
+    }
+    mGraphicBufferProducer->cancelBuffer(dequeued.slot, dequeued.fence);
+    if (dequeued.result & IGraphicBufferProducer::RELEASE_ALL_BUFFERS) {
+        freeAllBuffers();
+    }
+}
+
 status_t Surface::getLastQueuedBuffer(sp<GraphicBuffer>* outBuffer,
         sp<Fence>* outFence, float outTransformMatrix[16]) {
     return mGraphicBufferProducer->getLastQueuedBuffer(outBuffer, outFence,
@@ -319,11 +429,13 @@ status_t Surface::getFrameTimestamps(uint64_t frameNumber,
         return NAME_NOT_FOUND;
     }
 
-    // Update our cache of events if the requested events are not available.
+    // Update our cache of events if the requested events are not available and the consumer
+    // may have something new for us.
     if (checkConsumerForUpdates(events, mLastFrameNumber,
             outLatchTime, outFirstRefreshStartTime, outLastRefreshStartTime,
             outGpuCompositionDoneTime, outDisplayPresentTime,
-            outDequeueReadyTime, outReleaseTime)) {
+            outDequeueReadyTime, outReleaseTime) &&
+        hasPendingFrameTimestamps()) {
         FrameEventHistoryDelta delta;
         mGraphicBufferProducer->getFrameTimestamps(&delta);
         mFrameEventHistory->applyDelta(delta);
@@ -588,11 +700,33 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
     nsecs_t startTime = systemTime();
 
     FrameEventHistoryDelta frameTimestamps;
-    status_t result = mGraphicBufferProducer->dequeueBuffer(&buf, &fence, dqInput.width,
-                                                            dqInput.height, dqInput.format,
-                                                            dqInput.usage, &mBufferAge,
-                                                            dqInput.getTimestamps ?
-                                                                    &frameTimestamps : nullptr);
+    status_t result = NO_INIT;
+    nsecs_t dequeueAheadDuration = 0;
+    if (auto dequeued = takeDequeuedAheadBuffer()) {
+        const auto& input = dequeued->input;
+        const bool inputChanged = input.width != dqInput.width ||
+                input.height != dqInput.height || input.format != dqInput.format ||
+                input.usage != dqInput.usage || input.getTimestamps != dqInput.getTimestamps;
+        if (dequeued->result >= 0 && !inputChanged) {
+            buf = dequeued->slot;
+            fence = std::move(dequeued->fence);
+            mBufferAge = dequeued->bufferAge;
+            frameTimestamps = std::move(dequeued->frameTimestamps);
+            result = dequeued->result;
+            dequeueAheadDuration = dequeued->duration;
+        } else {
+            // The buffer was dequeued before the geometry, format or usage changed.
+            Mutex::Autolock lock(mMutex);
+            cancelDequeuedAheadBufferLocked(*dequeued);
+        }
+    }
+    if (buf < 0) {
+        result = mGraphicBufferProducer->dequeueBuffer(&buf, &fence, dqInput.width,
+                                                       dqInput.height, dqInput.format,
+                                                       dqInput.usage, &mBufferAge,
+                                                       dqInput.getTimestamps ? &frameTimestamps
+                                                                             : nullptr);
+    }
     mLastDequeueDuration = systemTime() - startTime;
 
     if (result < 0) {
@@ -612,6 +746,7 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
 
     // Write this while holding the mutex
     mLastDequeueStartTime = startTime;
+    mLastDequeueAheadDuration = dequeueAheadDuration;
 
     sp<GraphicBuffer>& gbuf(mSlots[buf].buffer);
 
@@ -695,6 +830,7 @@ int Surface::dequeueBuffers(std::vector<BatchBuffer>* buffers) {
 
     {
         Mutex::Autolock lock(mMutex);
+        cancelDequeuedAheadBufferLocked();
         if (mReportRemovedBuffers) {
             mRemovedBuffers.clear();
         }
@@ -777,7 +913,8 @@ int Surface::dequeueBuffers(std::vector<BatchBuffer>* buffers) {
     for (const auto& output : dequeueOutput) {
         // Collect slots that needs requesting buffer
         sp<GraphicBuffer>& gbuf(mSlots[output.slot].buffer);
-        if ((result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) || gbuf == nullptr) {
+        if ((output.result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) ||
+            gbuf == nullptr) {
             if (mReportRemovedBuffers && (gbuf != nullptr)) {
                 mRemovedBuffers.push_back(gbuf);
             }
@@ -1127,6 +1264,9 @@ int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
     }
 
     onBufferQueuedLocked(i, fence, output);
+    if (err == OK) {
+        dequeueAheadLocked();
+    }
     return err;
 }
 
@@ -1450,6 +1590,12 @@ int Surface::perform(int operation, va_list args)
     case NATIVE_WINDOW_SET_FRAME_TIMELINE_INFO:
         res = dispatchSetFrameTimelineInfo(args);
         break;
+    case NATIVE_WINDOW_SET_DEQUEUE_AHEAD:
+        res = dispatchSetDequeueAhead(args);
+        break;
+    case NATIVE_WINDOW_GET_LAST_DEQUEUE_AHEAD_DURATION:
+        res = dispatchGetLastDequeueAheadDuration(args);
+        break;
     default:
         res = NAME_NOT_FOUND;
         break;
@@ -1678,6 +1824,18 @@ int Surface::dispatchGetLastQueueDuration(va_list args) {
     return NO_ERROR;
 }
 
+int Surface::dispatchSetDequeueAhead(va_list args) {
+    bool dequeueAhead = va_arg(args, int);
+    setDequeueAhead(dequeueAhead);
+    return NO_ERROR;
+}
+
+int Surface::dispatchGetLastDequeueAheadDuration(va_list args) {
+    int64_t* lastDequeueAheadDuration = va_arg(args, int64_t*);
+    *lastDequeueAheadDuration = getLastDequeueAheadDuration();
+    return NO_ERROR;
+}
+
 int Surface::dispatchSetFrameRate(va_list args) {
     float frameRate = static_cast<float>(va_arg(args, double));
     int8_t compatibility = static_cast<int8_t>(va_arg(args, int));
@@ -1875,7 +2033,13 @@ int Surface::disconnect(int api, IGraphicBufferProducer::DisconnectMode mode) {
     mSharedBufferHasBeenQueued = false;
     freeAllBuffers();
     int err = mGraphicBufferProducer->disconnect(api, mode);
-    if (!err) {
+    if (err) {
+        cancelDequeuedAheadBufferLocked();
+    } else {
+        // Disconnecting frees the buffer dequeued ahead, and wakes up the dequeue-ahead thread
+        // if it is waiting for a buffer.
+        takeDequeuedAheadBuffer();
+
         mReqFormat = 0;
         mReqWidth = 0;
         mReqHeight = 0;
@@ -1909,6 +2073,7 @@ int Surface::detachNextBuffer(sp<GraphicBuffer>* outBuffer,
     if (mReportRemovedBuffers) {
         mRemovedBuffers.clear();
     }
+    cancelDequeuedAheadBufferLocked();
 
     sp<GraphicBuffer> buffer(nullptr);
     sp<Fence> fence(nullptr);
@@ -1947,6 +2112,7 @@ int Surface::attachBuffer(ANativeWindowBuffer* buffer)
     if (mReportRemovedBuffers) {
         mRemovedBuffers.clear();
     }
+    cancelDequeuedAheadBufferLocked();
 
     sp<GraphicBuffer> graphicBuffer(static_cast<GraphicBuffer*>(buffer));
     uint32_t priorGeneration = graphicBuffer->mGenerationNumber;
@@ -2002,10 +2168,14 @@ int Surface::setBufferCount(int bufferCount)
     ATRACE_CALL();
     ALOGV("Surface::setBufferCount");
     Mutex::Autolock lock(mMutex);
+    cancelDequeuedAheadBufferLocked();
 
     status_t err = NO_ERROR;
     if (bufferCount == 0) {
         err = mGraphicBufferProducer->setMaxDequeuedBufferCount(1);
+        if (err == NO_ERROR) {
+            mMaxDequeuedBufferCount = 1;
+        }
     } else {
         int minUndequeuedBuffers = 0;
         err = mGraphicBufferProducer->query(
@@ -2014,6 +2184,9 @@ int Surface::setBufferCount(int bufferCount)
             err = mGraphicBufferProducer->setMaxDequeuedBufferCount(
                     bufferCount - minUndequeuedBuffers);
         }
+        if (err == NO_ERROR) {
+            mMaxDequeuedBufferCount = bufferCount - minUndequeuedBuffers;
+        }
     }
 
     ALOGE_IF(err, "IGraphicBufferProducer::setBufferCount(%d) returned %s",
@@ -2026,9 +2199,13 @@ int Surface::setMaxDequeuedBufferCount(int maxDequeuedBuffers) {
     ATRACE_CALL();
     ALOGV("Surface::setMaxDequeuedBufferCount");
     Mutex::Autolock lock(mMutex);
+    cancelDequeuedAheadBufferLocked();
 
     status_t err = mGraphicBufferProducer->setMaxDequeuedBufferCount(
             maxDequeuedBuffers);
+    if (err == NO_ERROR) {
+        mMaxDequeuedBufferCount = maxDequeuedBuffers;
+    }
     ALOGE_IF(err, "IGraphicBufferProducer::setMaxDequeuedBufferCount(%d) "
             "returned %s", maxDequeuedBuffers, strerror(-err));
 
@@ -2039,6 +2216,7 @@ int Surface::setAsyncMode(bool async) {
     ATRACE_CALL();
     ALOGV("Surface::setAsyncMode");
     Mutex::Autolock lock(mMutex);
+    cancelDequeuedAheadBufferLocked();
 
     status_t err = mGraphicBufferProducer->setAsyncMode(async);
     ALOGE_IF(err, "IGraphicBufferProducer::setAsyncMode(%d) returned %s",
@@ -2051,6 +2229,7 @@ int Surface::setSharedBufferMode(bool sharedBufferMode) {
     ATRACE_CALL();
     ALOGV("Surface::setSharedBufferMode (%d)", sharedBufferMode);
     Mutex::Autolock lock(mMutex);
+    cancelDequeuedAheadBufferLocked();
 
     status_t err = mGraphicBufferProducer->setSharedBufferMode(
             sharedBufferMode);
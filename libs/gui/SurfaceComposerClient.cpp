@@ -20,6 +20,10 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <atomic>
+#include <map>
+#include <mutex>
+
 #include <android/gui/BnWindowInfosReportedListener.h>
 #include <android/gui/DisplayState.h>
 #include <android/gui/ISurfaceComposerClient.h>
@@ -1148,11 +1152,107 @@ private:
     timespec mTimeoutTimespec;
 };
 
+// Transactions applied while frame coalescing is enabled, merged per apply token.
+struct SurfaceComposerClient::Transaction::Coalescer {
+    struct Pending {
+        Transaction transaction;
+        // Only sent one way if all the merged transactions were applied one way.
+        bool oneWay = true;
+    };
+
+    std::mutex mutex;
+    bool enabled GUARDED_BY(mutex) = false;
+    std::map<sp<IBinder>, Pending> pending GUARDED_BY(mutex);
+
+    std::atomic<uint64_t> applied = 0;
+    std::atomic<uint64_t> sent = 0;
+
+    status_t flushLocked(const sp<IBinder>& applyToken) REQUIRES(mutex) {
+        auto it = pending.find(applyToken);
+        if (it == pending.end()) {
+            return NO_ERROR;
+        }
+        status_t status = it->second.transaction.applyNow(/*synchronous=*/false, it->second.oneWay);
+        pending.erase(it);
+        return status;
+    }
+
+    status_t flushAllLocked() REQUIRES(mutex) {
+        status_t status = NO_ERROR;
+        for (auto& [applyToken, p] : pending) {
+            status_t flushStatus = p.transaction.applyNow(/*synchronous=*/false, p.oneWay);
+            if (status == NO_ERROR) {
+                status = flushStatus;
+            }
+        }
+        pending.clear();
+        return status;
+    }
+};
+
+SurfaceComposerClient::Transaction::Coalescer& SurfaceComposerClient::Transaction::getCoalescer() {
+    static Coalescer* sCoalescer = new Coalescer;
+    return *sCoalescer;
+}
+
+void SurfaceComposerClient::Transaction::setFrameCoalescingEnabled(bool enabled) {
+    Coalescer& coalescer = getCoalescer();
+    std::scoped_lock lock(coalescer.mutex);
+    if (!enabled) {
+        coalescer.flushAllLocked();
+    }
+    coalescer.enabled = enabled;
+}
+
+status_t SurfaceComposerClient::Transaction::flushCoalescedTransactions() {
+    ATRACE_CALL();
+    Coalescer& coalescer = getCoalescer();
+    std::scoped_lock lock(coalescer.mutex);
+    return coalescer.flushAllLocked();
+}
+
+SurfaceComposerClient::Transaction::CoalescingStats
+SurfaceComposerClient::Transaction::getCoalescingStats() {
+    Coalescer& coalescer = getCoalescer();
+    return {.applied = coalescer.applied, .sent = coalescer.sent};
+}
+
 status_t SurfaceComposerClient::Transaction::apply(bool synchronous, bool oneWay) {
     if (mStatus != NO_ERROR) {
         return mStatus;
     }
 
+    Coalescer& coalescer = getCoalescer();
+    coalescer.applied++;
+    std::unique_lock lock(coalescer.mutex);
+    if (!coalescer.enabled) {
+        lock.unlock();
+        return applyNow(synchronous, oneWay);
+    }
+
+    const sp<IBinder> applyToken = mApplyToken ? mApplyToken : sApplyToken;
+    // Buffers and desired present times are kept in their own transactions: merging could
+    // drop a frame or present changes at the wrong time.
+    if (!synchronous && mIsAutoTimestamp && !mMayContainBuffer) {
+        auto& pending = coalescer.pending[applyToken];
+        const bool animation = mAnimation;
+        pending.transaction.merge(std::move(*this));
+        pending.transaction.mAnimation |= animation;
+        pending.transaction.mApplyToken = applyToken;
+        pending.oneWay &= oneWay;
+        mId = generateId();
+        return NO_ERROR;
+    }
+
+    coalescer.flushLocked(applyToken);
+    if (synchronous) {
+        // Do not block other threads while waiting for the commit.
+        lock.unlock();
+    }
+    return applyNow(synchronous, oneWay);
+}
+
+status_t SurfaceComposerClient::Transaction::applyNow(bool synchronous, bool oneWay) {
     std::shared_ptr<SyncCallback> syncCallback = std::make_shared<SyncCallback>();
     if (synchronous) {
         syncCallback->init();
@@ -1227,6 +1327,7 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous, bool oneWay
                             mInputWindowCommands, mDesiredPresentTime, mIsAutoTimestamp,
                             mUncacheBuffers, hasListenerCallbacks, listenerCallbacks, mId,
                             mMergedTransactionIds);
+    getCoalescer().sent++;
     mId = generateId();
 
     // Clear the current states and flags
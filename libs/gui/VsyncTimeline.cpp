@@ -0,0 +1,176 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VsyncTimeline"
+
+#include <gui/VsyncTimeline.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+
+#include <cutils/ashmem.h>
+#include <log/log.h>
+
+namespace android::gui {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x5653544c; // 'VSTL'
+
+// Readers give up after this many attempts, rather than spinning while the writer is descheduled.
+constexpr int kMaxReadAttempts = 4;
+
+enum Request : uint32_t {
+    kRequestsRejected = 0,
+    kRequestsAccepted = 1,
+    kRequested = 2,
+};
+
+} // namespace
+
+struct VsyncTimeline::Page {
+    uint32_t magic;
+    // Odd while the writer updates the snapshot, 0 until the first one was published.
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> request;
+    VsyncTimeline::Snapshot snapshot;
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "the timeline must be usable across processes");
+static_assert(std::is_trivially_copyable_v<VsyncTimeline::Snapshot>);
+
+std::unique_ptr<VsyncTimeline> VsyncTimeline::create() {
+    base::unique_fd fd(ashmem_create_region("VsyncTimeline", sizeof(Page)));
+    if (!fd.ok()) {
+        ALOGE("Could not create shared memory: %s", strerror(errno));
+        return nullptr;
+    }
+    auto timeline = map(std::move(fd));
+    if (timeline) {
+        timeline->mPage->magic = kMagic;
+    }
+    return timeline;
+}
+
+std::unique_ptr<VsyncTimeline> VsyncTimeline::fromFd(base::unique_fd fd) {
+    const int size = ashmem_get_size_region(fd.get());
+    if (size < 0 || static_cast<size_t>(size) < sizeof(Page)) {
+        ALOGE("Shared memory is too small: %d", size);
+        return nullptr;
+    }
+    auto timeline = map(std::move(fd));
+    if (timeline && timeline->mPage->magic != kMagic) {
+        ALOGE("Invalid magic %#x", timeline->mPage->magic);
+        return nullptr;
+    }
+    return timeline;
+}
+
+std::unique_ptr<VsyncTimeline> VsyncTimeline::map(base::unique_fd fd) {
+    void* address = mmap(nullptr, sizeof(Page), PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (address == MAP_FAILED) {
+        ALOGE("Could not map shared memory: %s", strerror(errno));
+        return nullptr;
+    }
+    return std::unique_ptr<VsyncTimeline>(new VsyncTimeline(std::move(fd), address));
+}
+
+VsyncTimeline::VsyncTimeline(base::unique_fd fd, void* address)
+      : mFd(std::move(fd)), mPage(static_cast<Page*>(address)) {}
+
+VsyncTimeline::~VsyncTimeline() {
+    munmap(mPage, sizeof(Page));
+}
+
+void VsyncTimeline::publish(const Snapshot& snapshot) {
+    mPage->sequence.store(++mSequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&mPage->snapshot, &snapshot, sizeof(Snapshot));
+    mPage->sequence.store(++mSequence, std::memory_order_release);
+}
+
+void VsyncTimeline::acceptRequests() {
+    mPage->request.store(kRequestsAccepted, std::memory_order_release);
+}
+
+bool VsyncTimeline::consumeRequest() {
+    return mPage->request.exchange(kRequestsRejected, std::memory_order_acq_rel) == kRequested;
+}
+
+bool VsyncTimeline::read(Snapshot* outSnapshot) const {
+    for (int attempt = 0; attempt < kMaxReadAttempts; attempt++) {
+        const uint32_t sequence = mPage->sequence.load(std::memory_order_acquire);
+        if (sequence == 0) {
+            return false;
+        }
+        if (sequence & 1) {
+            continue;
+        }
+        memcpy(outSnapshot, &mPage->snapshot, sizeof(Snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mPage->sequence.load(std::memory_order_relaxed) == sequence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool VsyncTimeline::requestNextVsync() {
+    uint32_t expected = kRequestsAccepted;
+    return mPage->request.compare_exchange_strong(expected, kRequested,
+                                                  std::memory_order_acq_rel) ||
+            expected == kRequested;
+}
+
+bool VsyncTimeline::getLatestVsyncEventData(const Snapshot& snapshot, nsecs_t now,
+                                            VsyncEventData* outVsyncEventData) {
+    // Like EventThread::getLatestVsyncEventData, only list the frame timelines whose deadline is
+    // in the future, and prefer the first one that leaves the work duration to draw.
+    const auto& vsyncData = snapshot.vsyncData;
+    const uint32_t length =
+            std::min(vsyncData.frameTimelinesLength,
+                     static_cast<uint32_t>(VsyncEventData::kFrameTimelinesCapacity));
+
+    VsyncEventData result{};
+    result.frameInterval = vsyncData.frameInterval;
+    bool hasPreferred = false;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        const auto& frameTimeline = vsyncData.frameTimelines[i];
+        if (frameTimeline.deadlineTimestamp <= now) {
+            continue;
+        }
+        if (!hasPreferred && frameTimeline.deadlineTimestamp - snapshot.workDuration >= now) {
+            result.preferredFrameTimelineIndex = count;
+            hasPreferred = true;
+        }
+        result.frameTimelines[count++] = frameTimeline;
+    }
+
+    if (!hasPreferred) {
+        return false;
+    }
+    result.frameTimelinesLength = count;
+    *outVsyncEventData = result;
+    return true;
+}
+
+} // namespace android::gui
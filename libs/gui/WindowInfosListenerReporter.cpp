@@ -19,6 +19,8 @@
 #include <gui/WindowInfosListenerReporter.h>
 #include "gui/WindowInfosUpdate.h"
 
+#include <cinttypes>
+
 namespace android {
 
 using gui::DisplayInfo;
@@ -78,6 +80,7 @@ status_t WindowInfosListenerReporter::removeWindowInfosListener(
             // stale values
             mLastWindowInfos.clear();
             mLastDisplayInfos.clear();
+            mLastVsyncId = -1;
         }
 
         if (status == OK) {
@@ -92,19 +95,37 @@ binder::Status WindowInfosListenerReporter::onWindowInfosChanged(
         const gui::WindowInfosUpdate& update) {
     std::unordered_set<sp<WindowInfosListener>, gui::SpHash<WindowInfosListener>>
             windowInfosListeners;
+    // Local listeners always get all windows.
+    std::optional<gui::WindowInfosUpdate> fullUpdate;
 
     {
         std::scoped_lock lock(mListenersMutex);
+        if (update.isDelta) {
+            std::vector<gui::WindowInfo> windowInfos;
+            if (update.baseVsyncId != mLastVsyncId ||
+                update.applyDelta(mLastWindowInfos, &windowInfos) != OK) {
+                ALOGE("Dropping window infos delta for vsync id %" PRId64 " based on %" PRId64
+                      ", last update was %" PRId64,
+                      update.vsyncId, update.baseVsyncId, mLastVsyncId);
+                mWindowInfosPublisher->requestWindowInfosKeyframe(mListenerId);
+                mWindowInfosPublisher->ackWindowInfosReceived(update.vsyncId, mListenerId);
+                return binder::Status::ok();
+            }
+            fullUpdate.emplace(std::move(windowInfos), update.displayInfos, update.vsyncId,
+                               update.timestamp);
+        }
+
         for (auto listener : mWindowInfosListeners) {
             windowInfosListeners.insert(listener);
         }
 
-        mLastWindowInfos = update.windowInfos;
+        mLastWindowInfos = fullUpdate ? fullUpdate->windowInfos : update.windowInfos;
         mLastDisplayInfos = update.displayInfos;
+        mLastVsyncId = update.vsyncId;
     }
 
     for (auto listener : windowInfosListeners) {
-        listener->onWindowInfosChanged(update);
+        listener->onWindowInfosChanged(fullUpdate ? *fullUpdate : update);
     }
 
     mWindowInfosPublisher->ackWindowInfosReceived(update.vsyncId, mListenerId);
@@ -17,8 +17,71 @@
 #include <gui/WindowInfosUpdate.h>
 #include <private/gui/ParcelUtils.h>
 
+#include <cinttypes>
+#include <unordered_map>
+#include <unordered_set>
+
 namespace android::gui {
 
+// WindowInfo::operator== skips some of the fields that are sent to the listeners.
+static bool isSameWindow(const WindowInfo& a, const WindowInfo& b) {
+    return a == b && a.alpha == b.alpha && a.windowToken == b.windowToken &&
+            a.touchableRegionCropHandle == b.touchableRegionCropHandle &&
+            a.focusTransferTarget == b.focusTransferTarget;
+}
+
+std::optional<WindowInfosUpdate> WindowInfosUpdate::makeDelta(
+        const std::vector<WindowInfo>& baseWindows, int64_t baseVsyncId,
+        const WindowInfosUpdate& update) {
+    std::unordered_map<int32_t, const WindowInfo*> baseWindowsById;
+    for (const auto& windowInfo : baseWindows) {
+        if (!baseWindowsById.emplace(windowInfo.id, &windowInfo).second) {
+            return std::nullopt;
+        }
+    }
+
+    WindowInfosUpdate delta{{}, update.displayInfos, update.vsyncId, update.timestamp};
+    delta.isDelta = true;
+    delta.baseVsyncId = baseVsyncId;
+    delta.windowIds.reserve(update.windowInfos.size());
+    std::unordered_set<int32_t> seenIds;
+    for (const auto& windowInfo : update.windowInfos) {
+        if (!seenIds.insert(windowInfo.id).second) {
+            return std::nullopt;
+        }
+        delta.windowIds.push_back(windowInfo.id);
+        auto it = baseWindowsById.find(windowInfo.id);
+        if (it == baseWindowsById.end() || !isSameWindow(*it->second, windowInfo)) {
+            delta.windowInfos.push_back(windowInfo);
+        }
+    }
+    return delta;
+}
+
+status_t WindowInfosUpdate::applyDelta(const std::vector<WindowInfo>& baseWindows,
+                                       std::vector<WindowInfo>* outWindows) const {
+    std::unordered_map<int32_t, const WindowInfo*> windowsById;
+    for (const auto& windowInfo : baseWindows) {
+        windowsById[windowInfo.id] = &windowInfo;
+    }
+    for (const auto& windowInfo : windowInfos) {
+        windowsById[windowInfo.id] = &windowInfo;
+    }
+
+    std::vector<WindowInfo> windows;
+    windows.reserve(windowIds.size());
+    for (int32_t id : windowIds) {
+        auto it = windowsById.find(id);
+        if (it == windowsById.end()) {
+            ALOGE("%s: Window %" PRId32 " is neither in the delta nor in its base", __func__, id);
+            return BAD_VALUE;
+        }
+        windows.push_back(*it->second);
+    }
+    *outWindows = std::move(windows);
+    return OK;
+}
+
 status_t WindowInfosUpdate::readFromParcel(const android::Parcel* parcel) {
     if (parcel == nullptr) {
         ALOGE("%s: Null parcel", __func__);
@@ -44,6 +107,12 @@ status_t WindowInfosUpdate::readFromParcel(const android::Parcel* parcel) {
     SAFE_PARCEL(parcel->readInt64, &vsyncId);
     SAFE_PARCEL(parcel->readInt64, &timestamp);
 
+    SAFE_PARCEL(parcel->readBool, &isDelta);
+    if (isDelta) {
+        SAFE_PARCEL(parcel->readInt64, &baseVsyncId);
+        SAFE_PARCEL(parcel->readInt32Vector, &windowIds);
+    }
+
     return OK;
 }
 
@@ -66,6 +135,12 @@ status_t WindowInfosUpdate::writeToParcel(android::Parcel* parcel) const {
     SAFE_PARCEL(parcel->writeInt64, vsyncId);
     SAFE_PARCEL(parcel->writeInt64, timestamp);
 
+    SAFE_PARCEL(parcel->writeBool, isDelta);
+    if (isDelta) {
+        SAFE_PARCEL(parcel->writeInt64, baseVsyncId);
+        SAFE_PARCEL(parcel->writeInt32Vector, windowIds);
+    }
+
     return OK;
 }
 
@@ -27,6 +27,7 @@
 #include <utils/RefBase.h>
 
 #include <system/window.h>
+#include <atomic>
 #include <thread>
 #include <queue>
 
@@ -56,6 +57,14 @@ public:
 
     void resizeFrameEventHistory(size_t newSize);
 
+    // Returns true if frame events were recorded since the producer last fetched a delta.
+    // This does not take mMutex, so the producer can poll it cheaply before paying for
+    // getFrameTimestamps.
+    bool hasPendingFrameTimestamps() const {
+        return mFrameEventsGeneration.load(std::memory_order_acquire) !=
+                mFetchedFrameEventsGeneration.load(std::memory_order_acquire);
+    }
+
 protected:
     void onSidebandStreamChanged() override EXCLUDES(mMutex);
 
@@ -69,6 +78,12 @@ private:
     std::queue<uint64_t> mDisconnectEvents GUARDED_BY(mMutex);
     bool mCurrentlyConnected GUARDED_BY(mMutex);
     bool mPreviouslyConnected GUARDED_BY(mMutex);
+
+    // Bumped whenever mFrameEventHistory gains new events, and copied into
+    // mFetchedFrameEventsGeneration when the producer takes a delta. Only written with mMutex
+    // held.
+    std::atomic<uint64_t> mFrameEventsGeneration = 0;
+    std::atomic<uint64_t> mFetchedFrameEventsGeneration = 0;
 };
 
 class BLASTBufferQueue : public ConsumerBase::FrameAvailableListener {
@@ -122,6 +137,28 @@ public:
      */
     void setTransactionHangCallback(std::function<void(const std::string&)> callback);
 
+    /**
+     * Lets the BLASTBufferQueue adapt the number of buffers the producer can dequeue to how the
+     * producer behaves. While the producer keeps blocking in dequeueBuffer, up to
+     * maxExtraBuffers buffers are added on top of the max dequeued buffer count it requested.
+     * Once it stops blocking for a while, the extra buffers are taken away again one at a time,
+     * which frees their GraphicBuffers. Passing 0, the default, disables the adaptation and drops
+     * any extra buffers.
+     */
+    void setAdaptiveBufferCount(uint32_t maxExtraBuffers);
+
+    struct AdaptiveBufferCountStats {
+        // Number of buffers currently added on top of the producer's max dequeued buffer count.
+        uint32_t extraBuffers = 0;
+        // Number of times a buffer was added or taken away.
+        uint64_t growCount = 0;
+        uint64_t shrinkCount = 0;
+        // Number of dequeueBuffer calls that blocked, and the longest time one blocked for.
+        uint64_t blockedDequeueCount = 0;
+        nsecs_t maxDequeueWaitTime = 0;
+    };
+    AdaptiveBufferCountStats getAdaptiveBufferCountStats() const;
+
     virtual ~BLASTBufferQueue();
 
 private:
@@ -130,6 +130,10 @@ private:
     // waitWhileAllocatingLocked blocks until mIsAllocating is false.
     void waitWhileAllocatingLocked(std::unique_lock<std::mutex>& lock) const;
 
+    // notifyDequeueConditionLocked wakes up all producers blocked in
+    // dequeueBuffer, if there are any.
+    void notifyDequeueConditionLocked() const;
+
 #if DEBUG_ONLY_CODE
     // validateConsistencyLocked ensures that the free lists are in sync with
     // the information stored in mSlots
@@ -219,6 +223,11 @@ private:
     // synchronous mode.
     mutable std::condition_variable mDequeueCondition;
 
+    // mDequeueWaiterCount is the number of threads currently waiting on
+    // mDequeueCondition. A broadcast always costs a futex wake, even when
+    // nobody is waiting, and most queues never block in dequeueBuffer.
+    mutable int mDequeueWaiterCount;
+
     // mDequeueBufferCannotBlock indicates whether dequeueBuffer is allowed to
     // block. This flag is set during connect when both the producer and
     // consumer are controlled by the application.
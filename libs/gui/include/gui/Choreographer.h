@@ -21,9 +21,12 @@
 #include <jni.h>
 #include <utils/Looper.h>
 
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <vector>
 
 namespace android {
 using gui::VsyncEventData;
@@ -104,6 +107,16 @@ public:
     int64_t getFrameInterval() const;
     bool inCallback() const;
 
+    // Histogram of how late frame callbacks ran compared to when they were due. Bucket i counts the
+    // callbacks that were less than kCallbackLatencyBucketLimitsUs[i] late, and the last bucket the
+    // ones that were later than all limits.
+    static constexpr std::array<int64_t, 7> kCallbackLatencyBucketLimitsUs = {100,  500,   1000,
+                                                                              4000, 8000,  16000,
+                                                                              32000};
+    using CallbackLatencyHistogram =
+            std::array<uint32_t, kCallbackLatencyBucketLimitsUs.size() + 1>;
+    CallbackLatencyHistogram getCallbackLatencyHistogram() const;
+
 private:
     Choreographer(const Choreographer&) = delete;
 
@@ -118,6 +131,21 @@ private:
 
     void scheduleCallbacks();
 
+    // Requests a vsync for the callbacks that are due, which mVsyncRequested was set for.
+    void scheduleVsyncForCallbacks();
+
+    // A frame callback posted from any thread, until the processing thread moves it to
+    // mFrameCallbacks.
+    struct PostedFrameCallback {
+        FrameCallback callback;
+        PostedFrameCallback* next;
+    };
+
+    // Moves the callbacks posted since the last call to mFrameCallbacks.
+    void drainPostedCallbacks() REQUIRES(mLock);
+
+    void recordCallbackLatency(nsecs_t latency);
+
     ChoreographerFrameCallbackDataImpl createFrameCallbackData(nsecs_t timestamp) const;
     void registerStartTime() const;
 
@@ -126,6 +154,20 @@ private:
     std::priority_queue<FrameCallback> mFrameCallbacks;
     std::vector<RefreshRateCallback> mRefreshRateCallbacks;
 
+    // Callbacks are pushed here without taking mLock, most recently posted first, so that threads
+    // posting callbacks don't contend with each other or with the dispatch of the previous frame.
+    std::atomic<PostedFrameCallback*> mPostedCallbacks = nullptr;
+
+    // Set once a vsync was requested for callbacks that are due, until that vsync is dispatched.
+    // Callbacks posted in between share that vsync, rather than each sending a looper message.
+    std::atomic<bool> mVsyncRequested = false;
+
+    // The callbacks of the frame being dispatched. Kept to reuse its storage.
+    std::vector<FrameCallback> mDueCallbacks;
+
+    std::array<std::atomic<uint32_t>, kCallbackLatencyBucketLimitsUs.size() + 1>
+            mCallbackLatencyHistogram{};
+
     nsecs_t mLatestVsyncPeriod = -1;
     VsyncEventData mLastVsyncEventData;
     bool mInCallback = false;
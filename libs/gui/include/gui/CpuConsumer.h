@@ -21,9 +21,13 @@
 
 #include <gui/ConsumerBase.h>
 #include <gui/BufferQueue.h>
+#include <gui/BufferQueueDefs.h>
 
+#include <utils/Timers.h>
 #include <utils/Vector.h>
 
+#include <array>
+
 
 namespace android {
 
@@ -68,6 +72,8 @@ class CpuConsumer : public ConsumerBase
         uint8_t    *dataCr;
         uint32_t    chromaStride;
         uint32_t    chromaStep;
+        // How long it took to map the buffer, including the wait for its fence.
+        nsecs_t     lockDuration;
 
         LockedBuffer() :
             data(nullptr),
@@ -85,7 +91,8 @@ class CpuConsumer : public ConsumerBase
             dataCb(nullptr),
             dataCr(nullptr),
             chromaStride(0),
-            chromaStep(0)
+            chromaStep(0),
+            lockDuration(0)
         {}
     };
 
@@ -105,12 +112,29 @@ class CpuConsumer : public ConsumerBase
     // by calling unlockBuffer before more buffers can be acquired.
     status_t lockNextBuffer(LockedBuffer *nativeBuffer);
 
+    // Locks up to count of the pending buffers at once, oldest first, into nativeBuffers, and
+    // sets outCount to how many were locked. Returns BAD_VALUE if no new buffer is available,
+    // and NOT_ENOUGH_DATA if the maximum number of buffers is already locked. Stops early without
+    // an error once no more buffers are available or can be locked.
+    status_t lockNextBuffers(LockedBuffer* nativeBuffers, size_t count, size_t* outCount);
+
     // Returns a locked buffer to the queue, allowing it to be reused. Since
     // only a fixed number of buffers may be locked at a time, old buffers must
     // be released by calling unlockBuffer to ensure new buffers can be acquired by
     // lockNextBuffer.
     status_t unlockBuffer(const LockedBuffer &nativeBuffer);
 
+    // Histogram of LockedBuffer::lockDuration. Bucket i counts the locks that took less than
+    // kLockLatencyBucketLimitsUs[i], and the last bucket the ones that took longer than all limits.
+    static constexpr std::array<int64_t, 7> kLockLatencyBucketLimitsUs = {50,   100,  250, 500,
+                                                                          1000, 2000, 4000};
+    using LockLatencyHistogram = std::array<uint32_t, kLockLatencyBucketLimitsUs.size() + 1>;
+    LockLatencyHistogram getLockLatencyHistogram() const;
+
+  protected:
+    // Unmaps the buffer of the slot if it was kept mapped.
+    void freeBufferLocked(int slotIndex) override;
+
   private:
     // Maximum number of buffers that can be locked at a time
     const size_t mMaxLockedBuffers;
@@ -140,12 +164,24 @@ class CpuConsumer : public ConsumerBase
 
     size_t findAcquiredBufferLocked(uintptr_t id) const;
 
-    status_t lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer) const;
+    status_t lockNextBufferLocked(LockedBuffer* nativeBuffer);
+
+    status_t lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer);
+
+    // Keeps the buffer of a slot mapped across acquires if it supports it, so that locking it
+    // again only maintains the CPU caches. See GraphicBuffer::setPersistentCpuMapping.
+    void keepBufferMappedLocked(int slot, const sp<GraphicBuffer>& buffer);
+    bool isBufferLockedLocked(const sp<GraphicBuffer>& buffer) const;
 
     Vector<AcquiredBuffer> mAcquiredBuffers;
 
     // Count of currently locked buffers
     size_t mCurrentLockedBuffers;
+
+    enum class Mapping { Unknown, Persistent, Unsupported };
+    std::array<Mapping, BufferQueueDefs::NUM_BUFFER_SLOTS> mSlotMappings;
+
+    LockLatencyHistogram mLockLatencyHistogram;
 };
 
 } // namespace android
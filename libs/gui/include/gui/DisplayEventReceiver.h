@@ -46,6 +46,7 @@ using gui::VsyncEventData;
 
 namespace gui {
 class BitTube;
+class VsyncTimeline;
 } // namespace gui
 
 static inline constexpr uint32_t fourcc(char c1, char c2, char c3, char c4) {
@@ -168,17 +169,26 @@ public:
     /*
      * requestNextVsync() schedules the next Event::VSync. It has no effect
      * if the vsync rate is > 0.
+     * While handling a vsync that was requested, the next one is requested
+     * through the vsync timeline shared with SurfaceFlinger, rather than
+     * through binder.
      */
     status_t requestNextVsync();
 
     /**
-     * getLatestVsyncEventData() gets the latest vsync event data.
+     * getLatestVsyncEventData() gets the latest vsync event data. It is
+     * derived from the vsync timeline shared with SurfaceFlinger while one of
+     * the frame timelines that was last dispatched can still be taken.
      */
     status_t getLatestVsyncEventData(ParcelableVsyncEventData* outVsyncEventData) const;
 
 private:
     sp<IDisplayEventConnection> mEventConnection;
     std::unique_ptr<gui::BitTube> mDataChannel;
+    std::unique_ptr<gui::VsyncTimeline> mTimeline;
+    // Requests through binder also resync SurfaceFlinger to hardware vsync,
+    // so they are still sent regularly while requesting through the timeline.
+    nsecs_t mLastBinderVsyncRequestTime = 0;
     std::optional<status_t> mInitError;
 };
 
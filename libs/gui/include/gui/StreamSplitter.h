@@ -17,6 +17,7 @@
 #ifndef ANDROID_GUI_STREAMSPLITTER_H
 #define ANDROID_GUI_STREAMSPLITTER_H
 
+#include <gui/BufferItem.h>
 #include <gui/IConsumerListener.h>
 #include <gui/IProducerListener.h>
 
@@ -24,6 +25,10 @@
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
+
+#include <deque>
+#include <thread>
 
 namespace android {
 
@@ -37,8 +42,35 @@ class IGraphicBufferProducer;
 // BufferQueue, where each buffer queued to the input is available to be
 // acquired by each of the outputs, and is able to be dequeued by the input
 // again only once all of the outputs have released it.
+//
+// Each output attaches and queues the buffers on its own thread, so that a slow
+// output does not delay the others.
 class StreamSplitter : public BnConsumerListener {
 public:
+    enum class DropPolicy {
+        // Every buffer queued to the input is queued to the output, and the
+        // input waits for it to be queued. If the output is slow to release
+        // its buffers, this slows down the producer of the input, e.g. for an
+        // encoder.
+        Block,
+        // The output only gets the latest buffer. Buffers are dropped for it
+        // rather than waiting for it to free a slot, and a buffer that it has
+        // not acquired yet is replaced by the next one, e.g. for a preview.
+        DropOldest,
+    };
+
+    struct OutputStats {
+        uint64_t queuedFrames = 0;
+        // Frames that were skipped, or replaced before the output acquired
+        // them, because of DropPolicy::DropOldest.
+        uint64_t droppedFrames = 0;
+        // Time from a frame being available on the input to it being queued
+        // to the output.
+        nsecs_t lastLatency = 0;
+        nsecs_t maxLatency = 0;
+        nsecs_t totalLatency = 0;
+    };
+
     // createSplitter creates a new splitter, outSplitter, using inputQueue as
     // the input BufferQueue. Output BufferQueues must be added using addOutput
     // before queueing any buffers to the input.
@@ -61,7 +93,13 @@ public:
     // outputQueue has not been added to the splitter. BAD_VALUE is returned if
     // outputQueue is NULL. See IGraphicBufferProducer::connect for explanations
     // of other error codes.
-    status_t addOutput(const sp<IGraphicBufferProducer>& outputQueue);
+    status_t addOutput(const sp<IGraphicBufferProducer>& outputQueue,
+            DropPolicy dropPolicy = DropPolicy::Block);
+
+    // getOutputStats returns the counters of an output added with addOutput.
+    // NAME_NOT_FOUND is returned if outputQueue is not an output.
+    status_t getOutputStats(const sp<IGraphicBufferProducer>& outputQueue,
+            OutputStats* outStats) const;
 
     // setName sets the consumer name of the input queue
     void setName(const String8& name);
@@ -70,10 +108,11 @@ private:
     // From IConsumerListener
     //
     // During this callback, we store some tracking information, detach the
-    // buffer from the input, and attach it to each of the outputs. This call
-    // can block if there are too many outstanding buffers. If it blocks, it
-    // will resume when onBufferReleasedByOutput releases a buffer back to the
-    // input.
+    // buffer from the input, and hand it to each of the outputs, which attach
+    // it in parallel. This call can block if there are too many outstanding
+    // buffers. If it blocks, it will resume when onBufferReleasedByOutput
+    // releases a buffer back to the input. It then waits for the
+    // DropPolicy::Block outputs to queue the buffer.
     virtual void onFrameAvailable(const BufferItem& item);
 
     // From IConsumerListener
@@ -97,6 +136,15 @@ private:
     // onFrameAvailable call to proceed.
     void onBufferReleasedByOutput(const sp<IGraphicBufferProducer>& from);
 
+    // Called by an output that did not queue a buffer, either because it
+    // dropped it or because it was abandoned, which counts as releasing it.
+    void onBufferSkippedByOutput(const sp<GraphicBuffer>& buffer, bool abandoned);
+
+    // Counts a release of the buffer by one of the outputs, and releases it
+    // back to the input once all of them did. This must be called with mMutex
+    // locked.
+    void releaseBufferLocked(uint64_t bufferId, const sp<Fence>& fence);
+
     // When this is called, the splitter disconnects from (i.e., abandons) its
     // input queue and signals any waiting onFrameAvailable calls to wake up.
     // It still processes callbacks from other outputs, but only detaches their
@@ -126,6 +174,63 @@ private:
         sp<IGraphicBufferProducer> mOutput;
     };
 
+    // The queue of buffers waiting to be attached to one output, and the
+    // thread that attaches and queues them.
+    class Output : public LightRefBase<Output> {
+    public:
+        Output(StreamSplitter* splitter,
+                const sp<IGraphicBufferProducer>& producer,
+                DropPolicy dropPolicy);
+
+        const sp<IGraphicBufferProducer>& getProducer() const { return mProducer; }
+        DropPolicy getDropPolicy() const { return mDropPolicy; }
+
+        // Hands a buffer to the thread of the output, and returns the
+        // sequence to pass to waitUntilQueued. The buffers that are dropped
+        // to make room for it are returned in outDropped.
+        uint64_t enqueue(const BufferItem& item, nsecs_t receivedTime,
+                Vector<sp<GraphicBuffer> >* outDropped);
+
+        // Waits until the buffer of the sequence was queued or skipped.
+        void waitUntilQueued(uint64_t sequence);
+
+        OutputStats getStats() const;
+
+        // Stops the thread without queueing the pending buffers. join must
+        // be called once the output was disconnected, which unblocks the
+        // thread if it is waiting for a free slot.
+        void stop();
+        void join();
+
+    private:
+        friend LightRefBase<Output>;
+        ~Output();
+
+        struct Frame {
+            uint64_t sequence = 0;
+            BufferItem item;
+            nsecs_t receivedTime = 0;
+        };
+
+        void threadMain();
+        status_t attachAndQueue(const BufferItem& item, bool* outReplaced);
+
+        StreamSplitter* const mSplitter;
+        const sp<IGraphicBufferProducer> mProducer;
+        const DropPolicy mDropPolicy;
+
+        mutable Mutex mMutex;
+        Condition mPendingCondition;
+        Condition mQueuedCondition;
+        std::deque<Frame> mPending;
+        uint64_t mNextSequence = 0;
+        uint64_t mQueuedSequence = 0;
+        bool mStopped = false;
+        OutputStats mStats;
+
+        std::thread mThread;
+    };
+
     class BufferTracker : public LightRefBase<BufferTracker> {
     public:
         explicit BufferTracker(const sp<GraphicBuffer>& buffer);
@@ -167,11 +272,13 @@ private:
     // communicate with it further.
     bool mIsAbandoned;
 
-    Mutex mMutex;
+    // Guards the input and the tracking of the buffers, but is never held
+    // while calling into the outputs.
+    mutable Mutex mMutex;
     Condition mReleaseCondition;
     int mOutstandingBuffers;
     sp<IGraphicBufferConsumer> mInput;
-    Vector<sp<IGraphicBufferProducer> > mOutputs;
+    Vector<sp<Output> > mOutputs;
 
     // Map of GraphicBuffer IDs (GraphicBuffer::getId()) to buffer tracking
     // objects (which are mostly for counting how many outputs have released the
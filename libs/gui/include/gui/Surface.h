@@ -30,7 +30,11 @@
 #include <utils/Mutex.h>
 #include <utils/RefBase.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <optional>
 #include <shared_mutex>
+#include <thread>
 #include <unordered_set>
 
 namespace android {
@@ -173,6 +177,20 @@ public:
     // See IGraphicBufferProducer::setDequeueTimeout
     status_t setDequeueTimeout(nsecs_t timeout);
 
+    /* Enables or disables dequeue-ahead, see NATIVE_WINDOW_SET_DEQUEUE_AHEAD. When enabled, the
+     * next buffer is dequeued on a helper thread as soon as a buffer is queued, so that the
+     * following dequeueBuffer does not wait for the consumer to release a buffer. No buffer is
+     * dequeued ahead if the producer already holds its maximum number of dequeued buffers, or in
+     * shared buffer mode. When the buffer size is driven by the consumer, a resize only applies
+     * to the buffer after the one dequeued ahead. It is disabled by default.
+     */
+    void setDequeueAhead(bool enable);
+
+    // Returns how long the IGraphicBufferProducer::dequeueBuffer call behind the last
+    // dequeueBuffer took on the helper thread, or 0 if that buffer was not dequeued ahead.
+    // Only the wait for the helper is counted towards NATIVE_WINDOW_GET_LAST_DEQUEUE_DURATION.
+    nsecs_t getLastDequeueAheadDuration() const;
+
     /*
      * Wait for frame number to increase past lastFrame for at most
      * timeoutNs. Useful for one thread to wait for another unknown
@@ -223,6 +241,11 @@ protected:
     virtual sp<gui::ISurfaceComposer> composerServiceAIDL() const;
     virtual nsecs_t now() const;
 
+    // Returns false only when the consumer is known to have no frame events this Surface has
+    // not fetched yet, letting getFrameTimestamps skip the round trip to the consumer.
+    // Surfaces that cannot tell cheaply always ask.
+    virtual bool hasPendingFrameTimestamps() const { return true; }
+
 private:
     // can't be copied
     Surface& operator = (const Surface& rhs);
@@ -302,6 +325,8 @@ private:
     int dispatchGetLastQueuedBuffer(va_list args);
     int dispatchGetLastQueuedBuffer2(va_list args);
     int dispatchSetFrameTimelineInfo(va_list args);
+    int dispatchSetDequeueAhead(va_list args);
+    int dispatchGetLastDequeueAheadDuration(va_list args);
 
     std::mutex mNameMutex;
     std::string mName;
@@ -437,6 +462,28 @@ protected:
     void onBufferQueuedLocked(int slot, sp<Fence> fence,
             const IGraphicBufferProducer::QueueBufferOutput& output);
 
+    // The result of an IGraphicBufferProducer::dequeueBuffer call made by the dequeue-ahead
+    // thread.
+    struct DequeuedAheadBuffer {
+        IGraphicBufferProducer::DequeueBufferInput input;
+        status_t result = NO_INIT;
+        int slot = -1;
+        sp<Fence> fence;
+        uint64_t bufferAge = 0;
+        FrameEventHistoryDelta frameTimestamps;
+        nsecs_t duration = 0;
+    };
+
+    // Dequeues the next buffer on the dequeue-ahead thread, if dequeue-ahead is enabled and the
+    // producer may dequeue another buffer.
+    void dequeueAheadLocked();
+    // Waits for the buffer being dequeued ahead, if any, and takes it.
+    std::optional<DequeuedAheadBuffer> takeDequeuedAheadBuffer();
+    // Returns the buffer dequeued ahead, if any, so that the producer can be reconfigured.
+    void cancelDequeuedAheadBufferLocked();
+    void cancelDequeuedAheadBufferLocked(const DequeuedAheadBuffer&);
+    void dequeueAheadThreadMain();
+
     struct BufferSlot {
         sp<GraphicBuffer> buffer;
         Region dirtyRegion;
@@ -638,6 +685,22 @@ protected:
 
     // Buffers that are successfully dequeued/attached and handed to clients
     std::unordered_set<int> mDequeuedSlots;
+
+    // The limit set through setMaxDequeuedBufferCount or setBufferCount, which is 1 by default.
+    int mMaxDequeuedBufferCount = 1;
+
+    // Dequeue-ahead state. mDequeueAheadEnabled is guarded by mMutex, the rest by
+    // mDequeueAheadMutex, which may be locked while holding mMutex but not the other way around.
+    bool mDequeueAheadEnabled = false;
+    std::thread mDequeueAheadThread;
+    std::mutex mDequeueAheadMutex;
+    std::condition_variable mDequeueAheadCondition;
+    // Set from the time a buffer is requested until the dequeued buffer is taken.
+    bool mDequeueAheadPending = false;
+    std::optional<IGraphicBufferProducer::DequeueBufferInput> mDequeueAheadRequest;
+    std::optional<DequeuedAheadBuffer> mDequeuedAheadBuffer;
+    bool mDequeueAheadThreadExit = false;
+    nsecs_t mLastDequeueAheadDuration = 0;
 };
 
 } // namespace android
@@ -425,6 +425,11 @@ public:
         void releaseBufferIfOverwriting(const layer_state_t& state);
         static void mergeFrameTimelineInfo(FrameTimelineInfo& t, const FrameTimelineInfo& other);
 
+        struct Coalescer;
+        static Coalescer& getCoalescer();
+        // Sends the transaction to SurfaceFlinger, bypassing frame coalescing.
+        status_t applyNow(bool synchronous, bool oneWay);
+
     protected:
         std::unordered_map<sp<IBinder>, ComposerState, IBinderHash> mComposerStates;
         SortedVector<DisplayState> mDisplayStates;
@@ -770,6 +775,21 @@ public:
         static void setDefaultApplyToken(sp<IBinder> applyToken);
 
         static status_t sendSurfaceFlushJankDataTransaction(const sp<SurfaceControl>& sc);
+
+        // Frame-scoped coalescing. While enabled, apply() does not send asynchronous
+        // transactions that have no buffer and no desired present time right away. They are
+        // merged with the other transactions applied on the same apply token until
+        // flushCoalescedTransactions() is called, typically at the end of a Choreographer frame.
+        // Any other transaction first flushes the ones pending on its apply token, so
+        // SurfaceFlinger sees the same order. Disabling coalescing flushes all pending ones.
+        static void setFrameCoalescingEnabled(bool enabled);
+        static status_t flushCoalescedTransactions();
+
+        struct CoalescingStats {
+            uint64_t applied = 0; // calls to apply()
+            uint64_t sent = 0;    // transactions sent to SurfaceFlinger
+        };
+        static CoalescingStats getCoalescingStats();
     };
 
     status_t clearLayerFrameStats(const sp<IBinder>& token) const;
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <android-base/unique_fd.h>
+#include <gui/VsyncEventData.h>
+#include <ui/DisplayId.h>
+#include <utils/Timers.h>
+
+namespace android::gui {
+
+// The latest vsync event of a display event connection, in shared memory.
+//
+// SurfaceFlinger publishes every vsync event it dispatches to the connection, so that the client
+// can read the latest frame timelines without a binder call. The page is guarded by a seqlock:
+// the writer makes the sequence odd while it writes, and readers retry if the sequence was odd or
+// changed while they copied the data. The BitTube of the connection is still what wakes up the
+// looper of the client.
+//
+// The page also holds the vsync request of the client while SurfaceFlinger is still waking up for
+// the frame after a vsync it dispatched for requestNextVsync. During that frame, the client can
+// request the next vsync by setting a flag rather than through binder.
+//
+// The page is shared with a single client, so SurfaceFlinger never trusts what it reads from it:
+// it keeps its own sequence, and only ever reads the request flag.
+class VsyncTimeline {
+public:
+    struct Snapshot {
+        PhysicalDisplayId displayId;
+        nsecs_t timestamp = 0;
+        uint32_t count = 0;
+        // The duration before the deadline of a frame timeline that the client is given to draw.
+        // A frame timeline can only be taken if its deadline is at least this far away.
+        nsecs_t workDuration = 0;
+        VsyncEventData vsyncData{};
+    };
+
+    // Creates a timeline to publish vsync events to.
+    static std::unique_ptr<VsyncTimeline> create();
+
+    // Maps a timeline created by another process.
+    static std::unique_ptr<VsyncTimeline> fromFd(base::unique_fd fd);
+
+    ~VsyncTimeline();
+
+    int getFd() const { return mFd.get(); }
+
+    // Writer side. Publishes a vsync event.
+    void publish(const Snapshot&);
+
+    // Writer side. Allows the client to request the next vsync through the page, until
+    // consumeRequest is called.
+    void acceptRequests();
+
+    // Writer side. Returns whether the client requested the next vsync since acceptRequests, and
+    // stops accepting requests.
+    bool consumeRequest();
+
+    // Reader side. Copies the latest vsync event. Returns false if nothing was published yet, or if
+    // the writer kept updating it.
+    bool read(Snapshot* outSnapshot) const;
+
+    // Reader side. Returns whether the next vsync was requested, otherwise it has to be requested
+    // through binder.
+    bool requestNextVsync();
+
+    // Reader side. Derives the vsync data that the client would get from
+    // IDisplayEventConnection::getLatestVsyncEventData at the given time, from the frame timelines
+    // of a snapshot. Returns false if none of them can be taken anymore.
+    static bool getLatestVsyncEventData(const Snapshot&, nsecs_t now,
+                                        VsyncEventData* outVsyncEventData);
+
+private:
+    struct Page;
+
+    VsyncTimeline(base::unique_fd fd, void* address);
+
+    static std::unique_ptr<VsyncTimeline> map(base::unique_fd fd);
+
+    base::unique_fd mFd;
+    Page* const mPage;
+
+    // Writer side only.
+    uint32_t mSequence = 0;
+};
+
+} // namespace android::gui
@@ -46,6 +46,8 @@ private:
 
     std::vector<gui::WindowInfo> mLastWindowInfos GUARDED_BY(mListenersMutex);
     std::vector<gui::DisplayInfo> mLastDisplayInfos GUARDED_BY(mListenersMutex);
+    // Base of the next delta update.
+    int64_t mLastVsyncId GUARDED_BY(mListenersMutex) = -1;
 
     sp<gui::IWindowInfosPublisher> mWindowInfosPublisher;
     int64_t mListenerId;
@@ -20,6 +20,8 @@
 #include <gui/DisplayInfo.h>
 #include <gui/WindowInfo.h>
 
+#include <optional>
+
 namespace android::gui {
 
 struct WindowInfosUpdate : public Parcelable {
@@ -37,6 +39,23 @@ struct WindowInfosUpdate : public Parcelable {
     int64_t vsyncId;
     int64_t timestamp;
 
+    // A delta update only carries, in windowInfos, the windows that were added or changed
+    // since the update with vsync id baseVsyncId. windowIds lists the ids of all windows in
+    // order; windows of the base update that are not listed were removed.
+    bool isDelta = false;
+    int64_t baseVsyncId = -1;
+    std::vector<int32_t> windowIds;
+
+    // Returns the delta from the windows of the update with vsync id baseVsyncId to the
+    // windows of 'update', or nullopt if the windows cannot be identified by id.
+    static std::optional<WindowInfosUpdate> makeDelta(const std::vector<WindowInfo>& baseWindows,
+                                                      int64_t baseVsyncId,
+                                                      const WindowInfosUpdate& update);
+
+    // Rebuilds the full list of windows of a delta update from the windows of its base update.
+    status_t applyDelta(const std::vector<WindowInfo>& baseWindows,
+                        std::vector<WindowInfo>* outWindows) const;
+
     status_t writeToParcel(android::Parcel*) const override;
     status_t readFromParcel(const android::Parcel*) override;
 };
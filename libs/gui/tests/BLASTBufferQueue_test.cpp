@@ -148,6 +148,18 @@ public:
         return mBlastBufferQueueAdapter->getSurface(false /* includeSurfaceControlHandle */);
     }
 
+    void setAdaptiveBufferCount(uint32_t maxExtraBuffers) {
+        mBlastBufferQueueAdapter->setAdaptiveBufferCount(maxExtraBuffers);
+    }
+
+    BLASTBufferQueue::AdaptiveBufferCountStats getAdaptiveBufferCountStats() {
+        return mBlastBufferQueueAdapter->getAdaptiveBufferCountStats();
+    }
+
+    bool hasPendingFrameTimestamps() {
+        return mBlastBufferQueueAdapter->mBufferItemConsumer->hasPendingFrameTimestamps();
+    }
+
     void waitForCallbacks() {
         std::unique_lock lock{mBlastBufferQueueAdapter->mMutex};
         // Wait until all but one of the submitted buffers have been released.
@@ -1323,6 +1335,27 @@ TEST_F(BLASTBufferQueueTest, QueryNativeWindowQueuesToWindowComposer) {
     ASSERT_EQ(queuesToNativeWindow, 1);
 }
 
+TEST_F(BLASTBufferQueueTest, AdaptiveBufferCountKeepsRequestedCountUntilProducerBlocks) {
+    BLASTBufferQueueHelper adapter(mSurfaceControl, mDisplayWidth, mDisplayHeight);
+    adapter.setAdaptiveBufferCount(2);
+
+    sp<IGraphicBufferProducer> igbProducer;
+    setUpProducer(adapter, igbProducer, 3);
+    for (int i = 0; i < 3; i++) {
+        queueBuffer(igbProducer, 0, 255, 0, 0);
+    }
+
+    // Far fewer dequeues than a full evaluation window, nothing may have been added.
+    BLASTBufferQueue::AdaptiveBufferCountStats stats = adapter.getAdaptiveBufferCountStats();
+    EXPECT_EQ(0u, stats.extraBuffers);
+    EXPECT_EQ(0u, stats.growCount);
+    EXPECT_EQ(0u, stats.shrinkCount);
+
+    adapter.setAdaptiveBufferCount(0);
+    ASSERT_EQ(NO_ERROR, igbProducer->setMaxDequeuedBufferCount(2));
+    EXPECT_EQ(0u, adapter.getAdaptiveBufferCountStats().extraBuffers);
+}
+
 // Test a slow producer doesn't hold up a faster producer from the same client. Essentially tests
 // BBQ uses separate transaction queues.
 TEST_F(BLASTBufferQueueTest, OutOfOrderTransactionTest) {
@@ -1714,6 +1747,34 @@ TEST_F(BLASTFrameEventHistoryTest, FrameEventHistory_Basic) {
     adapter.waitForCallbacks();
 }
 
+TEST_F(BLASTFrameEventHistoryTest, FrameEventHistory_PendingTimestamps) {
+    BLASTBufferQueueHelper adapter(mSurfaceControl, mDisplayWidth, mDisplayHeight);
+    sp<IGraphicBufferProducer> igbProducer;
+    setUpProducer(adapter, igbProducer);
+
+    ProducerFrameEventHistory history;
+    IGraphicBufferProducer::QueueBufferOutput qbOutput;
+    nsecs_t requestedPresentTime = 0;
+    nsecs_t postedTime = 0;
+    setUpAndQueueBuffer(igbProducer, &requestedPresentTime, &postedTime, &qbOutput, true);
+    history.applyDelta(qbOutput.frameTimestamps);
+
+    // Once the frame is latched, its events are pending until the producer fetches them.
+    adapter.waitForCallback(1);
+    ASSERT_TRUE(adapter.hasPendingFrameTimestamps());
+
+    FrameEventHistoryDelta delta;
+    igbProducer->getFrameTimestamps(&delta);
+    history.applyDelta(delta);
+    ASSERT_FALSE(adapter.hasPendingFrameTimestamps());
+
+    FrameEvents* events = history.getFrame(1);
+    ASSERT_NE(nullptr, events);
+    ASSERT_GE(events->latchTime, postedTime);
+
+    adapter.waitForCallbacks();
+}
+
 TEST_F(BLASTFrameEventHistoryTest, FrameEventHistory_DroppedFrame) {
     BLASTBufferQueueHelper adapter(mSurfaceControl, mDisplayWidth, mDisplayHeight);
     sp<IGraphicBufferProducer> igbProducer;
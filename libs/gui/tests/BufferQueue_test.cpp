@@ -797,6 +797,50 @@ TEST_F(BufferQueueTest, TestTimeouts) {
     ASSERT_GE(systemTime() - startTime, TIMEOUT);
 }
 
+TEST_F(BufferQueueTest, BlockedDequeueIsWokenUpByRelease) {
+    createBufferQueue();
+    sp<MockConsumer> mc(new MockConsumer);
+    ASSERT_EQ(OK, mConsumer->consumerConnect(mc, false));
+    IGraphicBufferProducer::QueueBufferOutput output;
+    ASSERT_EQ(OK,
+              mProducer->connect(new StubProducerListener, NATIVE_WINDOW_API_CPU, false, &output));
+    // Fail instead of hanging if the producer is never woken up.
+    mProducer->setDequeueTimeout(ms2ns(5000));
+
+    // Queue both buffers, so that there is no free slot left.
+    for (int i = 0; i < 2; ++i) {
+        int slot = BufferQueue::INVALID_BUFFER_SLOT;
+        sp<Fence> fence = Fence::NO_FENCE;
+        auto result = mProducer->dequeueBuffer(&slot, &fence, 0, 0, 0, TEST_PRODUCER_USAGE_BITS,
+                                               nullptr, nullptr);
+        ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION, result);
+        sp<GraphicBuffer> buffer;
+        ASSERT_EQ(OK, mProducer->requestBuffer(slot, &buffer));
+        IGraphicBufferProducer::QueueBufferInput input(0ull, true,
+                HAL_DATASPACE_UNKNOWN, Rect::INVALID_RECT,
+                NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+        ASSERT_EQ(OK, mProducer->queueBuffer(slot, input, &output));
+    }
+
+    status_t dequeueResult = NO_INIT;
+    std::thread producerThread([&]() {
+        int slot = BufferQueue::INVALID_BUFFER_SLOT;
+        sp<Fence> fence = Fence::NO_FENCE;
+        dequeueResult = mProducer->dequeueBuffer(&slot, &fence, 0, 0, 0,
+                                                 TEST_PRODUCER_USAGE_BITS, nullptr, nullptr);
+    });
+
+    // Give the producer a chance to block before a slot is freed.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BufferItem item;
+    ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 0));
+    ASSERT_EQ(OK,
+              mConsumer->releaseBuffer(item.mSlot, item.mFrameNumber, EGL_NO_DISPLAY,
+                                       EGL_NO_SYNC_KHR, Fence::NO_FENCE));
+    producerThread.join();
+    ASSERT_EQ(OK, dequeueResult);
+}
+
 TEST_F(BufferQueueTest, CanAttachWhileDisallowingAllocation) {
     createBufferQueue();
     sp<MockConsumer> mc(new MockConsumer);
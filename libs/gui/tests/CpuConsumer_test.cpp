@@ -682,6 +682,59 @@ TEST_P(CpuConsumerTest, FromCpuLockMax) {
     }
 }
 
+TEST_P(CpuConsumerTest, FromCpuLockBatch) {
+    status_t err;
+    CpuConsumerTestParams params = GetParam();
+
+    ASSERT_NO_FATAL_FAILURE(configureANW(mANW, params, params.maxLockedBuffers + 1));
+
+    uint32_t stride;
+    for (int i = 0; i < params.maxLockedBuffers + 1; i++) {
+        ASSERT_NO_FATAL_FAILURE(produceOneFrame(mANW, params, static_cast<int64_t>(i), &stride));
+    }
+
+    // Only maxLockedBuffers of the pending frames can be locked at once.
+    std::vector<CpuConsumer::LockedBuffer> b(params.maxLockedBuffers + 1);
+    size_t count = 0;
+    err = mCC->lockNextBuffers(b.data(), b.size(), &count);
+    ASSERT_NO_ERROR(err, "lockNextBuffers error: ");
+    ASSERT_EQ(static_cast<size_t>(params.maxLockedBuffers), count);
+
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_TRUE(b[i].data != nullptr);
+        EXPECT_EQ(stride, b[i].stride);
+        EXPECT_EQ(static_cast<int64_t>(i), b[i].timestamp);
+        EXPECT_GE(b[i].lockDuration, 0);
+        checkAnyBuffer(b[i], GetParam().format);
+    }
+
+    size_t tooMany = 0;
+    err = mCC->lockNextBuffers(&b[count], 1, &tooMany);
+    ASSERT_EQ(NOT_ENOUGH_DATA, err) << "Allowing too many locks";
+
+    for (size_t i = 0; i < count; i++) {
+        err = mCC->unlockBuffer(b[i]);
+        ASSERT_NO_ERROR(err, "Could not unlock buffer: ");
+    }
+
+    // The remaining frame is returned even though more were asked for.
+    err = mCC->lockNextBuffers(b.data(), b.size(), &count);
+    ASSERT_NO_ERROR(err, "lockNextBuffers error: ");
+    ASSERT_EQ(1u, count);
+    EXPECT_EQ(static_cast<int64_t>(params.maxLockedBuffers), b[0].timestamp);
+    checkAnyBuffer(b[0], GetParam().format);
+    mCC->unlockBuffer(b[0]);
+
+    err = mCC->lockNextBuffers(b.data(), b.size(), &count);
+    ASSERT_EQ(BAD_VALUE, err) << "Not out of buffers somehow";
+
+    size_t locks = 0;
+    for (uint32_t bucket : mCC->getLockLatencyHistogram()) {
+        locks += bucket;
+    }
+    EXPECT_EQ(static_cast<size_t>(params.maxLockedBuffers + 1), locks);
+}
+
 TEST_P(CpuConsumerTest, FromCpuInvalid) {
     status_t err = mCC->lockNextBuffer(nullptr);
     ASSERT_EQ(BAD_VALUE, err) << "lockNextBuffer did not fail";
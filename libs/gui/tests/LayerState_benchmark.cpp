@@ -0,0 +1,110 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <binder/Parcel.h>
+#include <gui/LayerState.h>
+
+#include <vector>
+
+// Usage: atest LayerState_benchmark
+
+namespace android {
+namespace {
+
+// What an animation changes on every frame.
+constexpr uint64_t kAnimationChanges = layer_state_t::ePositionChanged |
+        layer_state_t::eAlphaChanged | layer_state_t::eMatrixChanged;
+
+// What a window gets when it is first set up.
+constexpr uint64_t kSetupChanges = kAnimationChanges | layer_state_t::eLayerChanged |
+        layer_state_t::eLayerStackChanged | layer_state_t::eFlagsChanged |
+        layer_state_t::eCropChanged | layer_state_t::eInputInfoChanged |
+        layer_state_t::eTransparentRegionChanged | layer_state_t::eCornerRadiusChanged |
+        layer_state_t::eMetadataChanged | layer_state_t::eFrameRateChanged;
+
+std::vector<layer_state_t> makeLayerStates(int64_t numLayers, uint64_t what) {
+    std::vector<layer_state_t> states(numLayers);
+    for (int64_t i = 0; i < numLayers; i++) {
+        layer_state_t& state = states[i];
+        state.layerId = static_cast<int32_t>(i);
+        state.what = what;
+        state.x = static_cast<float>(i);
+        state.y = static_cast<float>(i * 2);
+        state.color.a = 0.5f;
+        state.crop = Rect(0, 0, 1080, 2400);
+        state.transparentRegion = Region(Rect(0, 0, 100, 100));
+        state.windowInfoHandle->editInfo()->name = "window " + std::to_string(i);
+    }
+    return states;
+}
+
+void writeLayerStates(const std::vector<layer_state_t>& states, Parcel* parcel) {
+    for (const auto& state : states) {
+        state.write(*parcel);
+    }
+}
+
+void encode(benchmark::State& benchState, uint64_t what) {
+    const auto states = makeLayerStates(benchState.range(0), what);
+    size_t bytes = 0;
+    for (auto _ : benchState) {
+        Parcel parcel;
+        writeLayerStates(states, &parcel);
+        bytes = parcel.dataSize();
+        benchmark::DoNotOptimize(parcel);
+    }
+    benchState.counters["parcel_bytes"] = static_cast<double>(bytes);
+}
+
+void decode(benchmark::State& benchState, uint64_t what) {
+    Parcel parcel;
+    writeLayerStates(makeLayerStates(benchState.range(0), what), &parcel);
+    for (auto _ : benchState) {
+        parcel.setDataPosition(0);
+        for (int64_t i = 0; i < benchState.range(0); i++) {
+            layer_state_t state;
+            state.read(parcel);
+            benchmark::DoNotOptimize(state);
+        }
+    }
+    benchState.counters["parcel_bytes"] = static_cast<double>(parcel.dataSize());
+}
+
+void BM_EncodeAnimation(benchmark::State& state) {
+    encode(state, kAnimationChanges);
+}
+BENCHMARK(BM_EncodeAnimation)->Arg(1)->Arg(16)->Arg(64);
+
+void BM_DecodeAnimation(benchmark::State& state) {
+    decode(state, kAnimationChanges);
+}
+BENCHMARK(BM_DecodeAnimation)->Arg(1)->Arg(16)->Arg(64);
+
+void BM_EncodeSetup(benchmark::State& state) {
+    encode(state, kSetupChanges);
+}
+BENCHMARK(BM_EncodeSetup)->Arg(1)->Arg(16);
+
+void BM_DecodeSetup(benchmark::State& state) {
+    decode(state, kSetupChanges);
+}
+BENCHMARK(BM_DecodeSetup)->Arg(1)->Arg(16);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
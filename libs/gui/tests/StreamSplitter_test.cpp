@@ -28,6 +28,9 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <thread>
+
 namespace android {
 
 class StreamSplitterTest : public ::testing::Test {};
@@ -180,6 +183,85 @@ TEST_F(StreamSplitterTest, OneInputMultipleOutputs) {
                                            nullptr, nullptr));
 }
 
+TEST_F(StreamSplitterTest, DropOldestOutputDoesNotBlockInput) {
+    const int NUM_FRAMES = 5;
+
+    sp<IGraphicBufferProducer> inputProducer;
+    sp<IGraphicBufferConsumer> inputConsumer;
+    BufferQueue::createBufferQueue(&inputProducer, &inputConsumer);
+
+    sp<IGraphicBufferProducer> encoderProducer;
+    sp<IGraphicBufferConsumer> encoderConsumer;
+    BufferQueue::createBufferQueue(&encoderProducer, &encoderConsumer);
+    ASSERT_EQ(OK, encoderConsumer->consumerConnect(new FakeListener, false));
+
+    sp<IGraphicBufferProducer> previewProducer;
+    sp<IGraphicBufferConsumer> previewConsumer;
+    BufferQueue::createBufferQueue(&previewProducer, &previewConsumer);
+    ASSERT_EQ(OK, previewConsumer->consumerConnect(new FakeListener, false));
+
+    sp<StreamSplitter> splitter;
+    status_t status = StreamSplitter::createSplitter(inputConsumer, &splitter);
+    ASSERT_EQ(OK, status);
+    ASSERT_EQ(OK, splitter->addOutput(encoderProducer));
+    ASSERT_EQ(OK, splitter->addOutput(previewProducer, StreamSplitter::DropPolicy::DropOldest));
+
+    IGraphicBufferProducer::QueueBufferOutput qbOutput;
+    ASSERT_EQ(OK,
+              inputProducer->connect(new StubProducerListener, NATIVE_WINDOW_API_CPU, false,
+                                     &qbOutput));
+
+    // The preview never acquires anything, which would stall the input after
+    // MAX_OUTSTANDING_BUFFERS frames if it kept the frames queued to it.
+    for (int frame = 1; frame <= NUM_FRAMES; ++frame) {
+        int slot;
+        sp<Fence> fence;
+        status = inputProducer->dequeueBuffer(&slot, &fence, 0, 0, 0,
+                GRALLOC_USAGE_SW_WRITE_OFTEN, nullptr, nullptr);
+        ASSERT_GE(status, OK);
+        sp<GraphicBuffer> buffer;
+        ASSERT_EQ(OK, inputProducer->requestBuffer(slot, &buffer));
+
+        IGraphicBufferProducer::QueueBufferInput qbInput(frame, false,
+                HAL_DATASPACE_UNKNOWN, Rect(0, 0, 1, 1),
+                NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+        ASSERT_EQ(OK, inputProducer->queueBuffer(slot, qbInput, &qbOutput));
+
+        // Block outputs have the frame queued once the input has queued it
+        BufferItem item;
+        ASSERT_EQ(OK, encoderConsumer->acquireBuffer(&item, 0));
+        ASSERT_EQ(frame, item.mTimestamp);
+        ASSERT_EQ(OK, encoderConsumer->releaseBuffer(item.mSlot,
+                item.mFrameNumber, EGL_NO_DISPLAY, EGL_NO_SYNC_KHR,
+                Fence::NO_FENCE));
+    }
+
+    StreamSplitter::OutputStats stats;
+    ASSERT_EQ(OK, splitter->getOutputStats(encoderProducer, &stats));
+    EXPECT_EQ(static_cast<uint64_t>(NUM_FRAMES), stats.queuedFrames);
+    EXPECT_EQ(0u, stats.droppedFrames);
+    EXPECT_GE(stats.maxLatency, stats.lastLatency);
+
+    // The preview only gets the latest frame, once its thread queued it
+    BufferItem item;
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        status = previewConsumer->acquireBuffer(&item, 0);
+        if (status == OK && item.mTimestamp == NUM_FRAMES) {
+            break;
+        }
+        if (status == OK) {
+            ASSERT_EQ(OK, previewConsumer->releaseBuffer(item.mSlot,
+                    item.mFrameNumber, EGL_NO_DISPLAY, EGL_NO_SYNC_KHR,
+                    Fence::NO_FENCE));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(OK, status);
+    EXPECT_EQ(NUM_FRAMES, item.mTimestamp);
+
+    ASSERT_EQ(NAME_NOT_FOUND, splitter->getOutputStats(inputProducer, &stats));
+}
+
 TEST_F(StreamSplitterTest, OutputAbandonment) {
     sp<IGraphicBufferProducer> inputProducer;
     sp<IGraphicBufferConsumer> inputConsumer;
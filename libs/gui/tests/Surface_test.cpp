@@ -310,6 +310,28 @@ TEST_F(SurfaceTest, ScreenshotsOfProtectedBuffersDontSucceed) {
     ASSERT_EQ(NO_ERROR, captureDisplay(captureArgs, captureResults));
 }
 
+TEST_F(SurfaceTest, CoalescesTransactionsUntilFlush) {
+    Transaction::setFrameCoalescingEnabled(true);
+    const auto before = Transaction::getCoalescingStats();
+
+    Transaction().setAlpha(mSurfaceControl, 0.5f).apply();
+    Transaction().setPosition(mSurfaceControl, 10, 20).apply();
+    Transaction().setLayer(mSurfaceControl, 0x7fffffff).apply();
+    auto stats = Transaction::getCoalescingStats();
+    EXPECT_EQ(before.applied + 3, stats.applied);
+    EXPECT_EQ(before.sent, stats.sent);
+
+    ASSERT_EQ(NO_ERROR, Transaction::flushCoalescedTransactions());
+    stats = Transaction::getCoalescingStats();
+    EXPECT_EQ(before.sent + 1, stats.sent);
+
+    // Synchronous transactions are never held back.
+    Transaction().setAlpha(mSurfaceControl, 1.0f).apply(true);
+    EXPECT_EQ(before.sent + 2, Transaction::getCoalescingStats().sent);
+
+    Transaction::setFrameCoalescingEnabled(false);
+}
+
 TEST_F(SurfaceTest, ConcreteTypeIsSurface) {
     sp<ANativeWindow> anw(mSurface);
     int result = -123;
@@ -2174,6 +2196,62 @@ TEST_F(SurfaceTest, DefaultMaxBufferCountSetAndUpdated) {
     EXPECT_EQ(BufferQueueDefs::NUM_BUFFER_SLOTS, count);
 }
 
+TEST_F(SurfaceTest, DequeueAhead) {
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+
+    sp<MockConsumer> mockConsumer(new MockConsumer);
+    consumer->consumerConnect(mockConsumer, false);
+
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+    ASSERT_EQ(NO_ERROR, native_window_api_connect(window.get(), NATIVE_WINDOW_API_CPU));
+    ASSERT_EQ(NO_ERROR, native_window_set_buffers_dimensions(window.get(), 10, 10));
+    ASSERT_EQ(NO_ERROR, native_window_set_usage(window.get(), TEST_PRODUCER_USAGE_BITS));
+    ASSERT_EQ(NO_ERROR, native_window_set_dequeue_ahead(window.get(), true));
+
+    int fence;
+    ANativeWindowBuffer* buffer;
+    int64_t dequeueAheadDuration = -1;
+    const auto consumeBuffer = [&] {
+        BufferItem item;
+        ASSERT_EQ(NO_ERROR, consumer->acquireBuffer(&item, 0));
+        ASSERT_EQ(NO_ERROR,
+                  consumer->releaseBuffer(item.mSlot, item.mFrameNumber, EGL_NO_DISPLAY,
+                                          EGL_NO_SYNC_KHR, Fence::NO_FENCE));
+    };
+
+    // The first buffer cannot have been dequeued ahead.
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    ASSERT_EQ(NO_ERROR,
+              native_window_get_last_dequeue_ahead_duration(window.get(), &dequeueAheadDuration));
+    EXPECT_EQ(0, dequeueAheadDuration);
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+    consumeBuffer();
+
+    // Queueing the buffer dequeued the next one.
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    EXPECT_EQ(10, buffer->width);
+    ASSERT_EQ(NO_ERROR,
+              native_window_get_last_dequeue_ahead_duration(window.get(), &dequeueAheadDuration));
+    EXPECT_GT(dequeueAheadDuration, 0);
+    ASSERT_EQ(NO_ERROR, window->cancelBuffer(window.get(), buffer, fence));
+
+    // A buffer dequeued ahead with the previous dimensions is not returned.
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+    consumeBuffer();
+    ASSERT_EQ(NO_ERROR, native_window_set_buffers_dimensions(window.get(), 20, 20));
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    EXPECT_EQ(20, buffer->width);
+    EXPECT_EQ(20, buffer->height);
+    EXPECT_EQ(0, surface->getLastDequeueAheadDuration());
+    ASSERT_EQ(NO_ERROR, window->cancelBuffer(window.get(), buffer, fence));
+
+    ASSERT_EQ(NO_ERROR, native_window_api_disconnect(window.get(), NATIVE_WINDOW_API_CPU));
+}
+
 TEST_F(SurfaceTest, BatchOperations) {
     const int BUFFER_COUNT = 16;
     const int BATCH_SIZE = 8;
@@ -2226,6 +2304,40 @@ TEST_F(SurfaceTest, BatchOperations) {
     ASSERT_EQ(NO_ERROR, surface->disconnect(NATIVE_WINDOW_API_CPU));
 }
 
+TEST_F(SurfaceTest, BatchDequeueRequestsReallocatedBuffers) {
+    const int BUFFER_COUNT = 16;
+    const int BATCH_SIZE = 8;
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+
+    sp<CpuConsumer> cpuConsumer = new CpuConsumer(consumer, 1);
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+    sp<StubProducerListener> listener = new StubProducerListener();
+
+    ASSERT_EQ(OK, surface->connect(NATIVE_WINDOW_API_CPU, /*listener*/listener,
+            /*reportBufferRemoval*/false));
+
+    ASSERT_EQ(NO_ERROR, native_window_set_buffer_count(window.get(), BUFFER_COUNT));
+
+    std::vector<Surface::BatchBuffer> buffers(BATCH_SIZE);
+
+    ASSERT_EQ(NO_ERROR, native_window_set_buffers_dimensions(window.get(), 100, 100));
+    ASSERT_EQ(NO_ERROR, surface->dequeueBuffers(&buffers));
+    ASSERT_EQ(NO_ERROR, surface->cancelBuffers(buffers));
+
+    // The slots are reused, but their buffers have to be reallocated with the new size.
+    ASSERT_EQ(NO_ERROR, native_window_set_buffers_dimensions(window.get(), 200, 100));
+    ASSERT_EQ(NO_ERROR, surface->dequeueBuffers(&buffers));
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+        EXPECT_EQ(200, buffers[i].buffer->width);
+    }
+    ASSERT_EQ(NO_ERROR, surface->cancelBuffers(buffers));
+
+    ASSERT_EQ(NO_ERROR, surface->disconnect(NATIVE_WINDOW_API_CPU));
+}
+
 TEST_F(SurfaceTest, BatchIllegalOperations) {
     const int BUFFER_COUNT = 16;
     const int BATCH_SIZE = 8;
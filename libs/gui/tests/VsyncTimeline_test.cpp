@@ -0,0 +1,125 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <gui/VsyncTimeline.h>
+
+namespace android {
+
+using gui::VsyncEventData;
+using gui::VsyncTimeline;
+using FrameTimeline = gui::VsyncEventData::FrameTimeline;
+
+namespace test {
+
+class VsyncTimelineTest : public testing::Test {
+protected:
+    void SetUp() override {
+        mWriter = VsyncTimeline::create();
+        ASSERT_NE(nullptr, mWriter);
+        mReader = VsyncTimeline::fromFd(base::unique_fd(dup(mWriter->getFd())));
+        ASSERT_NE(nullptr, mReader);
+    }
+
+    // Frame timelines 10 ns apart, with a work duration of 5 ns.
+    static VsyncTimeline::Snapshot makeSnapshot() {
+        VsyncTimeline::Snapshot snapshot;
+        snapshot.timestamp = 100;
+        snapshot.count = 3;
+        snapshot.workDuration = 5;
+        snapshot.vsyncData.frameInterval = 10;
+        snapshot.vsyncData.preferredFrameTimelineIndex = 0;
+        snapshot.vsyncData.frameTimelinesLength = 3;
+        snapshot.vsyncData.frameTimelines[0] = FrameTimeline{1, 110, 120};
+        snapshot.vsyncData.frameTimelines[1] = FrameTimeline{2, 120, 130};
+        snapshot.vsyncData.frameTimelines[2] = FrameTimeline{3, 130, 140};
+        return snapshot;
+    }
+
+    std::unique_ptr<VsyncTimeline> mWriter;
+    std::unique_ptr<VsyncTimeline> mReader;
+};
+
+TEST_F(VsyncTimelineTest, readsPublishedSnapshot) {
+    VsyncTimeline::Snapshot snapshot;
+    EXPECT_FALSE(mReader->read(&snapshot));
+
+    mWriter->publish(makeSnapshot());
+    ASSERT_TRUE(mReader->read(&snapshot));
+    EXPECT_EQ(100, snapshot.timestamp);
+    EXPECT_EQ(3u, snapshot.count);
+    EXPECT_EQ(3u, snapshot.vsyncData.frameTimelinesLength);
+    EXPECT_EQ(2, snapshot.vsyncData.frameTimelines[1].vsyncId);
+
+    auto next = makeSnapshot();
+    next.count = 4;
+    mWriter->publish(next);
+    ASSERT_TRUE(mReader->read(&snapshot));
+    EXPECT_EQ(4u, snapshot.count);
+}
+
+TEST_F(VsyncTimelineTest, rejectsFdOtherThanSharedMemory) {
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    base::unique_fd writeEnd(fds[1]);
+    EXPECT_EQ(nullptr, VsyncTimeline::fromFd(base::unique_fd(fds[0])));
+}
+
+TEST_F(VsyncTimelineTest, requestsNextVsyncOnlyWhileAccepted) {
+    EXPECT_FALSE(mReader->requestNextVsync());
+    EXPECT_FALSE(mWriter->consumeRequest());
+
+    mWriter->acceptRequests();
+    EXPECT_FALSE(mWriter->consumeRequest());
+    EXPECT_FALSE(mReader->requestNextVsync());
+
+    mWriter->acceptRequests();
+    EXPECT_TRUE(mReader->requestNextVsync());
+    EXPECT_TRUE(mReader->requestNextVsync());
+    EXPECT_TRUE(mWriter->consumeRequest());
+    EXPECT_FALSE(mWriter->consumeRequest());
+    EXPECT_FALSE(mReader->requestNextVsync());
+}
+
+TEST_F(VsyncTimelineTest, derivesLatestVsyncEventData) {
+    const auto snapshot = makeSnapshot();
+    VsyncEventData data;
+
+    // The first frame timeline leaves the work duration to draw.
+    ASSERT_TRUE(VsyncTimeline::getLatestVsyncEventData(snapshot, 102, &data));
+    EXPECT_EQ(3u, data.frameTimelinesLength);
+    EXPECT_EQ(1, data.preferredVsyncId());
+
+    // The first frame timeline can still be listed, but not taken.
+    ASSERT_TRUE(VsyncTimeline::getLatestVsyncEventData(snapshot, 108, &data));
+    EXPECT_EQ(3u, data.frameTimelinesLength);
+    EXPECT_EQ(2, data.preferredVsyncId());
+    EXPECT_EQ(10, data.frameInterval);
+
+    // The first frame timeline is in the past.
+    ASSERT_TRUE(VsyncTimeline::getLatestVsyncEventData(snapshot, 112, &data));
+    EXPECT_EQ(2u, data.frameTimelinesLength);
+    EXPECT_EQ(2, data.preferredVsyncId());
+
+    // None of the frame timelines leaves the work duration to draw.
+    EXPECT_FALSE(VsyncTimeline::getLatestVsyncEventData(snapshot, 126, &data));
+}
+
+} // namespace test
+} // namespace android
@@ -20,6 +20,7 @@
 #include <binder/Parcel.h>
 
 #include <gui/WindowInfo.h>
+#include <gui/WindowInfosUpdate.h>
 
 using std::chrono_literals::operator""s;
 
@@ -28,6 +29,7 @@ namespace android {
 using gui::InputApplicationInfo;
 using gui::TouchOcclusionMode;
 using gui::WindowInfo;
+using gui::WindowInfosUpdate;
 
 namespace test {
 
@@ -119,5 +121,40 @@ TEST(InputApplicationInfo, Parcelling) {
     ASSERT_EQ(i, i2);
 }
 
+static WindowInfo makeWindow(int32_t id, const std::string& name) {
+    WindowInfo info;
+    info.id = id;
+    info.name = name;
+    return info;
+}
+
+TEST(WindowInfosUpdate, DeltaParcelling) {
+    std::vector<WindowInfo> base{makeWindow(1, "a"), makeWindow(2, "b"), makeWindow(3, "c")};
+    WindowInfosUpdate update{{makeWindow(4, "d"), makeWindow(3, "c"), makeWindow(1, "a2")},
+                             {},
+                             /*vsyncId=*/11,
+                             /*timestamp=*/0};
+
+    auto delta = WindowInfosUpdate::makeDelta(base, /*baseVsyncId=*/10, update);
+    ASSERT_TRUE(delta);
+    // Window 3 is unchanged, window 2 was removed.
+    ASSERT_EQ(2u, delta->windowInfos.size());
+
+    Parcel p;
+    ASSERT_EQ(OK, delta->writeToParcel(&p));
+    p.setDataPosition(0);
+    WindowInfosUpdate received;
+    ASSERT_EQ(OK, received.readFromParcel(&p));
+    ASSERT_TRUE(received.isDelta);
+    ASSERT_EQ(10, received.baseVsyncId);
+
+    std::vector<WindowInfo> windows;
+    ASSERT_EQ(OK, received.applyDelta(base, &windows));
+    ASSERT_EQ(update.windowInfos, windows);
+
+    // The delta cannot be applied on top of a base without window 3.
+    ASSERT_NE(OK, received.applyDelta({makeWindow(1, "a")}, &windows));
+}
+
 } // namespace test
 } // namespace android
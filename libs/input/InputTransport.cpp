@@ -10,14 +10,19 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <math.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+
 #include <android-base/logging.h>
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 #include <binder/Parcel.h>
+#include <cutils/ashmem.h>
 #include <cutils/properties.h>
 #include <ftl/enum.h>
 #include <log/log.h>
@@ -93,6 +98,24 @@ namespace android {
 // behind processing touches.
 static const size_t SOCKET_BUFFER_SIZE = 32 * 1024;
 
+// Maximum number of messages written with a single system call by InputChannel::sendMessages.
+// The socket buffer only fits about a dozen large motion events anyway.
+static const size_t MAX_SEND_BATCH_SIZE = 16;
+
+// Number of messages each ring buffer of a SHARED_MEMORY channel can hold. Must be a power of two.
+// Like the socket buffer, it only needs to absorb a burst of events while the app is busy.
+static constexpr uint32_t SHARED_MEMORY_RING_CAPACITY = 16;
+
+// Single byte packets sent on the socket of a SHARED_MEMORY channel. They are never confused with
+// input messages, which are always much larger.
+// Sent once, before the first message written to the ring buffer. Everything written to the
+// socket before it must be read before switching to the ring buffer.
+static constexpr uint8_t DOORBELL_SWITCH_TO_SHARED_MEMORY = 1;
+// Sent when a message is written to the ring buffer while the reader is waiting for messages.
+static constexpr uint8_t DOORBELL_WAKE = 2;
+// Returned by InputChannel::receiveFromSocket when it read a doorbell. Never returned to callers.
+static constexpr status_t DOORBELL_RECEIVED = 1;
+
 // Nanoseconds per milliseconds.
 static const nsecs_t NANOS_PER_MS = 1000000;
 
@@ -111,6 +134,10 @@ static const nsecs_t RESAMPLE_MAX_DELTA = 20 * NANOS_PER_MS;
 // far into the future.  This time is further bounded by 50% of the last time delta.
 static const nsecs_t RESAMPLE_MAX_PREDICTION = 8 * NANOS_PER_MS;
 
+// Initial number of samples held by the ring of a batch, before it needs to grow. Enough for a
+// 480Hz device on a 60Hz display.
+static constexpr size_t INITIAL_BATCH_CAPACITY = 8;
+
 /**
  * System property for enabling / disabling touch resampling.
  * Resampling extrapolates / interpolates the reported touch event coordinates to better
@@ -218,11 +245,12 @@ size_t InputMessage::size() const {
 }
 
 /**
- * There could be non-zero bytes in-between InputMessage fields. Force-initialize the entire
- * memory to zero, then only copy the valid bytes on a per-field basis.
+ * There could be non-zero bytes in-between InputMessage fields. Force-initialize the memory that
+ * will be sent to zero, then only copy the valid bytes on a per-field basis. The bytes past size()
+ * are never sent, so there is no need to clear the unused pointers of a motion event.
  */
 void InputMessage::getSanitizedCopy(InputMessage* msg) const {
-    memset(msg, 0, sizeof(*msg));
+    memset(msg, 0, size());
 
     // Write the header
     msg->header.type = header.type;
@@ -367,6 +395,81 @@ void InputMessage::getSanitizedCopy(InputMessage* msg) const {
 
 // --- InputChannel ---
 
+/**
+ * The memory shared by the two endpoints of a SHARED_MEMORY channel: one single-producer,
+ * single-consumer ring buffer for each direction.
+ *
+ * Neither endpoint trusts the other one, so indices and message sizes read from the shared memory
+ * are always validated before they are used.
+ */
+struct InputChannel::SharedMemory {
+    struct Slot {
+        uint32_t size;
+        InputMessage message;
+    };
+
+    struct Ring {
+        // Written by the writer only.
+        alignas(64) std::atomic<uint32_t> head;
+        std::atomic<uint32_t> writerSwitched;
+        // Written by the reader only.
+        alignas(64) std::atomic<uint32_t> tail;
+        std::atomic<uint32_t> readerAttached;
+        std::atomic<uint32_t> readerSwitched;
+        // Set by the reader before it goes to sleep, cleared by whoever rings the doorbell.
+        std::atomic<uint32_t> readerWaiting;
+        alignas(64) Slot slots[SHARED_MEMORY_RING_CAPACITY];
+    };
+    static_assert(std::atomic<uint32_t>::is_always_lock_free,
+                  "ring buffer indices must be usable across processes");
+    static_assert((SHARED_MEMORY_RING_CAPACITY & (SHARED_MEMORY_RING_CAPACITY - 1)) == 0);
+
+    // Messages sent by the server are in rings[0], messages sent by the client in rings[1].
+    struct Layout {
+        Ring rings[2];
+    };
+
+    base::unique_fd fd;
+    Layout* layout = nullptr;
+
+    ~SharedMemory() {
+        if (layout != nullptr) {
+            munmap(layout, sizeof(Layout));
+        }
+    }
+
+    Ring& txRing(bool isServer) { return layout->rings[isServer ? 0 : 1]; }
+    Ring& rxRing(bool isServer) { return layout->rings[isServer ? 1 : 0]; }
+
+    static std::shared_ptr<SharedMemory> create(const std::string& name) {
+        base::unique_fd fd(ashmem_create_region(name.c_str(), sizeof(Layout)));
+        if (!fd.ok()) {
+            ALOGW("channel '%s' ~ Could not create shared memory: %s", name.c_str(),
+                  strerror(errno));
+            return nullptr;
+        }
+        return map(std::move(fd));
+    }
+
+    static std::shared_ptr<SharedMemory> map(base::unique_fd fd) {
+        const int size = ashmem_get_size_region(fd.get());
+        if (size < 0 || static_cast<size_t>(size) < sizeof(Layout)) {
+            ALOGE("Input channel shared memory is too small: %d", size);
+            return nullptr;
+        }
+        void* address = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED,
+                             fd.get(), 0);
+        if (address == MAP_FAILED) {
+            ALOGE("Could not map input channel shared memory: %s", strerror(errno));
+            return nullptr;
+        }
+        auto sharedMemory = std::make_shared<SharedMemory>();
+        sharedMemory->fd = std::move(fd);
+        sharedMemory->layout = static_cast<Layout*>(address);
+        return sharedMemory;
+    }
+};
+
 std::unique_ptr<InputChannel> InputChannel::create(const std::string& name,
                                                    android::base::unique_fd fd, sp<IBinder> token) {
     const int result = fcntl(fd, F_SETFL, O_NONBLOCK);
@@ -392,7 +495,8 @@ InputChannel::~InputChannel() {
 
 status_t InputChannel::openInputChannelPair(const std::string& name,
                                             std::unique_ptr<InputChannel>& outServerChannel,
-                                            std::unique_ptr<InputChannel>& outClientChannel) {
+                                            std::unique_ptr<InputChannel>& outClientChannel,
+                                            Transport transport) {
     int sockets[2];
     if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets)) {
         status_t result = -errno;
@@ -418,10 +522,103 @@ status_t InputChannel::openInputChannelPair(const std::string& name,
     std::string clientChannelName = name + " (client)";
     android::base::unique_fd clientFd(sockets[1]);
     outClientChannel = InputChannel::create(clientChannelName, std::move(clientFd), token);
+
+    if (transport == Transport::SHARED_MEMORY) {
+        std::shared_ptr<SharedMemory> sharedMemory = SharedMemory::create(name);
+        if (sharedMemory != nullptr) {
+            outServerChannel->mSharedMemory = sharedMemory;
+            outServerChannel->mIsServer = true;
+            outClientChannel->mSharedMemory = std::move(sharedMemory);
+            outClientChannel->mIsServer = false;
+        }
+    }
+    return OK;
+}
+
+InputChannel::Transport InputChannel::getTransport() const {
+    if (mSharedMemory != nullptr &&
+        mSharedMemory->txRing(mIsServer).writerSwitched.load(std::memory_order_relaxed)) {
+        return Transport::SHARED_MEMORY;
+    }
+    return Transport::SOCKET;
+}
+
+status_t InputChannel::sendDoorbell(uint8_t doorbell) {
+    ssize_t nWrite;
+    do {
+        nWrite = ::send(getFd(), &doorbell, sizeof(doorbell), MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (nWrite == -1 && errno == EINTR);
+    if (nWrite < 0) {
+        return sendErrorToStatus(errno);
+    }
+    return OK;
+}
+
+/**
+ * Write the message to the ring buffer, or return nullopt if the reader hasn't mapped the shared
+ * memory and the message should be sent on the socket instead.
+ */
+std::optional<status_t> InputChannel::sendToSharedMemory(const InputMessage& msg) {
+    SharedMemory::Ring& ring = mSharedMemory->txRing(mIsServer);
+    const uint32_t head = ring.head.load(std::memory_order_relaxed);
+    const uint32_t tail = ring.tail.load(std::memory_order_acquire);
+    const bool switched = ring.writerSwitched.load(std::memory_order_relaxed);
+    if (!switched && !ring.readerAttached.load(std::memory_order_acquire)) {
+        return std::nullopt;
+    }
+    if (head - tail >= SHARED_MEMORY_RING_CAPACITY) {
+        // Full, or corrupted by the other end. Either way, the reader has to catch up first.
+        return WOULD_BLOCK;
+    }
+    if (!switched) {
+        // Everything the reader finds on the socket before this was sent before the ring buffer
+        // was used, so the order of the messages is preserved.
+        if (status_t status = sendDoorbell(DOORBELL_SWITCH_TO_SHARED_MEMORY); status != OK) {
+            return status;
+        }
+        ring.writerSwitched.store(1, std::memory_order_relaxed);
+    }
+
+    SharedMemory::Slot& slot = ring.slots[head % SHARED_MEMORY_RING_CAPACITY];
+    slot.size = msg.size();
+    msg.getSanitizedCopy(&slot.message);
+    ring.head.store(head + 1, std::memory_order_release);
+
+    // Pairs with the fence in receiveFromSharedMemory: either the reader sees the new head before
+    // going to sleep, or we see that it is waiting and wake it up. Only the first writer to see the
+    // reader waiting rings the doorbell, so a burst of messages costs a single wakeup.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ring.readerWaiting.exchange(0, std::memory_order_seq_cst) != 0) {
+        status_t status = sendDoorbell(DOORBELL_WAKE);
+        if (status == WOULD_BLOCK) {
+            // The socket already has unread doorbells, so the reader will wake up anyway.
+            return OK;
+        }
+        return status;
+    }
     return OK;
 }
 
+static status_t sendErrorToStatus(int error) {
+    if (error == EAGAIN || error == EWOULDBLOCK) {
+        return WOULD_BLOCK;
+    }
+    if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
+        return DEAD_OBJECT;
+    }
+    return -error;
+}
+
 status_t InputChannel::sendMessage(const InputMessage* msg) {
+    if (mSharedMemory != nullptr) {
+        if (std::optional<status_t> status = sendToSharedMemory(*msg); status) {
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                     "channel '%s' ~ wrote message of type %s to shared memory, status=%d",
+                     mName.c_str(), ftl::enum_string(msg->header.type).c_str(), *status);
+            return *status;
+        }
+    }
+
     const size_t msgLength = msg->size();
     InputMessage cleanMsg;
     msg->getSanitizedCopy(&cleanMsg);
@@ -434,13 +631,7 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
         int error = errno;
         ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ error sending message of type %s, %s",
                  mName.c_str(), ftl::enum_string(msg->header.type).c_str(), strerror(error));
-        if (error == EAGAIN || error == EWOULDBLOCK) {
-            return WOULD_BLOCK;
-        }
-        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
-            return DEAD_OBJECT;
-        }
-        return -error;
+        return sendErrorToStatus(error);
     }
 
     if (size_t(nWrite) != msgLength) {
@@ -462,7 +653,163 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
     return OK;
 }
 
+status_t InputChannel::sendMessages(const InputMessage* msgs, size_t count,
+                                    size_t* outSentCount) {
+    *outSentCount = 0;
+    if (mSharedMemory != nullptr) {
+        // Writing to the ring buffer doesn't need any system call, and the doorbells of a batch are
+        // coalesced anyway.
+        for (; *outSentCount < count; (*outSentCount)++) {
+            status_t status = sendMessage(&msgs[*outSentCount]);
+            if (status != OK) {
+                return status;
+            }
+        }
+        return OK;
+    }
+#if defined(__linux__)
+    // Each message is written as its own packet, so the receiving end sees exactly the same stream
+    // as it would with one sendMessage() call per message.
+    // Not value-initialized: getSanitizedCopy clears every byte that is sent.
+    std::unique_ptr<InputMessage[]> cleanMsgs(
+            new InputMessage[std::min(count, MAX_SEND_BATCH_SIZE)]);
+    std::array<iovec, MAX_SEND_BATCH_SIZE> iovs;
+    std::array<mmsghdr, MAX_SEND_BATCH_SIZE> hdrs;
+    while (*outSentCount < count) {
+        const size_t batchSize = std::min(count - *outSentCount, MAX_SEND_BATCH_SIZE);
+        for (size_t i = 0; i < batchSize; i++) {
+            const InputMessage& msg = msgs[*outSentCount + i];
+            msg.getSanitizedCopy(&cleanMsgs[i]);
+            iovs[i].iov_base = &cleanMsgs[i];
+            iovs[i].iov_len = msg.size();
+            hdrs[i] = {};
+            hdrs[i].msg_hdr.msg_iov = &iovs[i];
+            hdrs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int nSent;
+        do {
+            nSent = ::sendmmsg(getFd(), hdrs.data(), static_cast<unsigned int>(batchSize),
+                               MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (nSent == -1 && errno == EINTR);
+
+        if (nSent < 0) {
+            int error = errno;
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                     "channel '%s' ~ error sending batch of %zu messages after %zu, %s",
+                     mName.c_str(), batchSize, *outSentCount, strerror(error));
+            return sendErrorToStatus(error);
+        }
+        for (int i = 0; i < nSent; i++) {
+            if (hdrs[i].msg_len != iovs[i].iov_len) {
+                ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                         "channel '%s' ~ error sending message type %s, send was incomplete",
+                         mName.c_str(),
+                         ftl::enum_string(msgs[*outSentCount].header.type).c_str());
+                return DEAD_OBJECT;
+            }
+            (*outSentCount)++;
+        }
+        if (size_t(nSent) < batchSize) {
+            // The kernel stops at the first message that doesn't fit, which means the channel is
+            // full. Report it the same way sendMessage() would.
+            return WOULD_BLOCK;
+        }
+    }
+
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ sent batch of %zu messages", mName.c_str(),
+             count);
+    if (ATRACE_ENABLED()) {
+        std::string message = StringPrintf("sendMessages(inputChannel=%s, count=%zu)",
+                                           mName.c_str(), count);
+        ATRACE_NAME(message.c_str());
+    }
+    return OK;
+#else
+    for (; *outSentCount < count; (*outSentCount)++) {
+        status_t status = sendMessage(&msgs[*outSentCount]);
+        if (status != OK) {
+            return status;
+        }
+    }
+    return OK;
+#endif
+}
+
 status_t InputChannel::receiveMessage(InputMessage* msg) {
+    if (mSharedMemory != nullptr) {
+        SharedMemory::Ring& ring = mSharedMemory->rxRing(mIsServer);
+        if (!ring.readerAttached.load(std::memory_order_relaxed)) {
+            // Let the writer know that this end reads from the shared memory.
+            ring.readerAttached.store(1, std::memory_order_release);
+        }
+        if (ring.readerSwitched.load(std::memory_order_relaxed)) {
+            return receiveFromSharedMemory(msg);
+        }
+    }
+    status_t status = receiveFromSocket(msg);
+    if (status == DOORBELL_RECEIVED) {
+        return receiveFromSharedMemory(msg);
+    }
+    return status;
+}
+
+status_t InputChannel::receiveFromSharedMemory(InputMessage* msg) {
+    SharedMemory::Ring& ring = mSharedMemory->rxRing(mIsServer);
+    const auto pop = [&](status_t& outStatus) {
+        const uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+        const uint32_t head = ring.head.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        if (head - tail > SHARED_MEMORY_RING_CAPACITY) {
+            ALOGE("channel '%s' ~ shared memory ring buffer is corrupted, head=%" PRIu32
+                  " tail=%" PRIu32,
+                  mName.c_str(), head, tail);
+            outStatus = BAD_VALUE;
+            return true;
+        }
+        // Copy the message out before validating it, the writer could still be modifying it.
+        const SharedMemory::Slot& slot = ring.slots[tail % SHARED_MEMORY_RING_CAPACITY];
+        const uint32_t size = slot.size;
+        if (size > sizeof(InputMessage)) {
+            outStatus = BAD_VALUE;
+        } else {
+            memcpy(msg, &slot.message, size);
+            outStatus = msg->isValid(size) ? OK : BAD_VALUE;
+        }
+        ring.tail.store(tail + 1, std::memory_order_release);
+        if (outStatus != OK) {
+            ALOGE("channel '%s' ~ received invalid message of size %" PRIu32 " in shared memory",
+                  mName.c_str(), size);
+        }
+        return true;
+    };
+
+    status_t status;
+    for (;;) {
+        if (pop(status)) {
+            return status;
+        }
+        // Announce that we are about to wait, then check again so that a message written just
+        // before the announcement isn't missed.
+        ring.readerWaiting.store(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (pop(status)) {
+            ring.readerWaiting.store(0, std::memory_order_relaxed);
+            return status;
+        }
+
+        // The ring buffer is empty. Consume the doorbells that woke us up, and find out whether
+        // the peer is gone.
+        status = receiveFromSocket(msg);
+        if (status != DOORBELL_RECEIVED) {
+            return status;
+        }
+    }
+}
+
+status_t InputChannel::receiveFromSocket(InputMessage* msg) {
     ssize_t nRead;
     do {
         nRead = ::recv(getFd(), msg, sizeof(InputMessage), MSG_DONTWAIT);
@@ -487,6 +834,19 @@ status_t InputChannel::receiveMessage(InputMessage* msg) {
         return DEAD_OBJECT;
     }
 
+    if (nRead == 1 && mSharedMemory != nullptr) {
+        SharedMemory::Ring& ring = mSharedMemory->rxRing(mIsServer);
+        const uint8_t doorbell = *reinterpret_cast<const uint8_t*>(msg);
+        if (doorbell == DOORBELL_SWITCH_TO_SHARED_MEMORY) {
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ switching to shared memory",
+                     mName.c_str());
+            ring.readerSwitched.store(1, std::memory_order_relaxed);
+        }
+        if (ring.readerSwitched.load(std::memory_order_relaxed)) {
+            return DOORBELL_RECEIVED;
+        }
+    }
+
     if (!msg->isValid(nRead)) {
         ALOGE("channel '%s' ~ received invalid message of size %zd", mName.c_str(), nRead);
         return BAD_VALUE;
@@ -506,13 +866,21 @@ status_t InputChannel::receiveMessage(InputMessage* msg) {
 
 std::unique_ptr<InputChannel> InputChannel::dup() const {
     base::unique_fd newFd(dupFd());
-    return InputChannel::create(getName(), std::move(newFd), getConnectionToken());
+    std::unique_ptr<InputChannel> channel =
+            InputChannel::create(getName(), std::move(newFd), getConnectionToken());
+    if (channel != nullptr) {
+        channel->mSharedMemory = mSharedMemory;
+        channel->mIsServer = mIsServer;
+    }
+    return channel;
 }
 
 void InputChannel::copyTo(InputChannel& outChannel) const {
     outChannel.mName = getName();
     outChannel.mFd = dupFd();
     outChannel.mToken = getConnectionToken();
+    outChannel.mSharedMemory = mSharedMemory;
+    outChannel.mIsServer = mIsServer;
 }
 
 status_t InputChannel::writeToParcel(android::Parcel* parcel) const {
@@ -520,8 +888,13 @@ status_t InputChannel::writeToParcel(android::Parcel* parcel) const {
         ALOGE("%s: Null parcel", __func__);
         return BAD_VALUE;
     }
-    return parcel->writeStrongBinder(mToken)
-            ?: parcel->writeUtf8AsUtf16(mName) ?: parcel->writeUniqueFileDescriptor(mFd);
+    status_t status = parcel->writeStrongBinder(mToken)
+            ?: parcel->writeUtf8AsUtf16(mName) ?: parcel->writeUniqueFileDescriptor(mFd)
+            ?: parcel->writeBool(mSharedMemory != nullptr);
+    if (status != OK || mSharedMemory == nullptr) {
+        return status;
+    }
+    return parcel->writeUniqueFileDescriptor(mSharedMemory->fd) ?: parcel->writeBool(mIsServer);
 }
 
 status_t InputChannel::readFromParcel(const android::Parcel* parcel) {
@@ -530,7 +903,22 @@ status_t InputChannel::readFromParcel(const android::Parcel* parcel) {
         return BAD_VALUE;
     }
     mToken = parcel->readStrongBinder();
-    return parcel->readUtf8FromUtf16(&mName) ?: parcel->readUniqueFileDescriptor(&mFd);
+    bool hasSharedMemory = false;
+    status_t status = parcel->readUtf8FromUtf16(&mName) ?: parcel->readUniqueFileDescriptor(&mFd)
+            ?: parcel->readBool(&hasSharedMemory);
+    mSharedMemory = nullptr;
+    if (status != OK || !hasSharedMemory) {
+        return status;
+    }
+    base::unique_fd sharedMemoryFd;
+    status = parcel->readUniqueFileDescriptor(&sharedMemoryFd) ?: parcel->readBool(&mIsServer);
+    if (status != OK) {
+        return status;
+    }
+    // If the shared memory can't be mapped, this end keeps using the socket, and so does the
+    // other end since this end will never start reading from the shared memory.
+    mSharedMemory = SharedMemory::map(std::move(sharedMemoryFd));
+    return OK;
 }
 
 sp<IBinder> InputChannel::getConnectionToken() const {
@@ -562,6 +950,29 @@ InputPublisher::InputPublisher(const std::shared_ptr<InputChannel>& channel)
 InputPublisher::~InputPublisher() {
 }
 
+void InputPublisher::beginBatch() {
+    mBatching = true;
+}
+
+status_t InputPublisher::endBatch(size_t* outPublishedCount) {
+    mBatching = false;
+    status_t status = OK;
+    *outPublishedCount = 0;
+    if (!mBatch.empty()) {
+        status = mChannel->sendMessages(mBatch.data(), mBatch.size(), outPublishedCount);
+        mBatch.clear();
+    }
+    return status;
+}
+
+status_t InputPublisher::sendMessage(const InputMessage& msg) {
+    if (mBatching) {
+        mBatch.push_back(msg);
+        return OK;
+    }
+    return mChannel->sendMessage(&msg);
+}
+
 status_t InputPublisher::publishKeyEvent(uint32_t seq, int32_t eventId, int32_t deviceId,
                                          int32_t source, int32_t displayId,
                                          std::array<uint8_t, 32> hmac, int32_t action,
@@ -604,7 +1015,7 @@ status_t InputPublisher::publishKeyEvent(uint32_t seq, int32_t eventId, int32_t
     msg.body.key.repeatCount = repeatCount;
     msg.body.key.downTime = downTime;
     msg.body.key.eventTime = eventTime;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishMotionEvent(
@@ -696,7 +1107,7 @@ status_t InputPublisher::publishMotionEvent(
         msg.body.motion.pointers[i].coords.copyFrom(pointerCoords[i]);
     }
 
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishFocusEvent(uint32_t seq, int32_t eventId, bool hasFocus) {
@@ -713,7 +1124,7 @@ status_t InputPublisher::publishFocusEvent(uint32_t seq, int32_t eventId, bool h
     msg.header.seq = seq;
     msg.body.focus.eventId = eventId;
     msg.body.focus.hasFocus = hasFocus;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishCaptureEvent(uint32_t seq, int32_t eventId,
@@ -733,7 +1144,7 @@ status_t InputPublisher::publishCaptureEvent(uint32_t seq, int32_t eventId,
     msg.header.seq = seq;
     msg.body.capture.eventId = eventId;
     msg.body.capture.pointerCaptureEnabled = pointerCaptureEnabled;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishDragEvent(uint32_t seq, int32_t eventId, float x, float y,
@@ -755,7 +1166,7 @@ status_t InputPublisher::publishDragEvent(uint32_t seq, int32_t eventId, float x
     msg.body.drag.isExiting = isExiting;
     msg.body.drag.x = x;
     msg.body.drag.y = y;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishTouchModeEvent(uint32_t seq, int32_t eventId, bool isInTouchMode) {
@@ -774,7 +1185,7 @@ status_t InputPublisher::publishTouchModeEvent(uint32_t seq, int32_t eventId, bo
     msg.header.seq = seq;
     msg.body.touchMode.eventId = eventId;
     msg.body.touchMode.isInTouchMode = isInTouchMode;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 android::base::Result<InputPublisher::ConsumerResponse> InputPublisher::receiveConsumerResponse() {
@@ -886,7 +1297,7 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                 if (batchIndex >= 0) {
                     Batch& batch = mBatches[batchIndex];
                     if (canAddSample(batch, &mMsg)) {
-                        batch.samples.push_back(mMsg);
+                        batch.push(mMsg);
                         ALOGD_IF(DEBUG_TRANSPORT_CONSUMER,
                                  "channel '%s' consumer ~ appended to batch event",
                                  mChannel->getName().c_str());
@@ -894,20 +1305,17 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                     } else if (isPointerEvent(mMsg.body.motion.source) &&
                                mMsg.body.motion.action == AMOTION_EVENT_ACTION_CANCEL) {
                         // No need to process events that we are going to cancel anyways
-                        const size_t count = batch.samples.size();
-                        for (size_t i = 0; i < count; i++) {
-                            const InputMessage& msg = batch.samples[i];
-                            sendFinishedSignal(msg.header.seq, false);
+                        for (size_t i = 0; i < batch.size(); i++) {
+                            sendFinishedSignal(batch[i].header.seq, false);
                         }
-                        batch.samples.erase(batch.samples.begin(), batch.samples.begin() + count);
-                        mBatches.erase(mBatches.begin() + batchIndex);
+                        removeBatch(batchIndex);
                     } else {
                         // We cannot append to the batch in progress, so we need to consume
                         // the previous batch right now and defer the new message until later.
                         mMsgDeferred = true;
-                        status_t result = consumeSamples(factory, batch, batch.samples.size(),
-                                                         outSeq, outEvent);
-                        mBatches.erase(mBatches.begin() + batchIndex);
+                        status_t result =
+                                consumeSamples(factory, batch, batch.size(), outSeq, outEvent);
+                        removeBatch(batchIndex);
                         if (result) {
                             return result;
                         }
@@ -922,9 +1330,7 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                 // Start a new batch if needed.
                 if (mMsg.body.motion.action == AMOTION_EVENT_ACTION_MOVE ||
                     mMsg.body.motion.action == AMOTION_EVENT_ACTION_HOVER_MOVE) {
-                    Batch batch;
-                    batch.samples.push_back(mMsg);
-                    mBatches.push_back(batch);
+                    startBatch(mMsg);
                     ALOGD_IF(DEBUG_TRANSPORT_CONSUMER,
                              "channel '%s' consumer ~ started batch event",
                              mChannel->getName().c_str());
@@ -1004,8 +1410,8 @@ status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
         i--;
         Batch& batch = mBatches[i];
         if (frameTime < 0) {
-            result = consumeSamples(factory, batch, batch.samples.size(), outSeq, outEvent);
-            mBatches.erase(mBatches.begin() + i);
+            result = consumeSamples(factory, batch, batch.size(), outSeq, outEvent);
+            removeBatch(i);
             return result;
         }
 
@@ -1020,11 +1426,11 @@ status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
 
         result = consumeSamples(factory, batch, split + 1, outSeq, outEvent);
         const InputMessage* next;
-        if (batch.samples.empty()) {
-            mBatches.erase(mBatches.begin() + i);
+        if (batch.empty()) {
+            removeBatch(i);
             next = nullptr;
         } else {
-            next = &batch.samples[0];
+            next = &batch[0];
         }
         if (!result && mResampleTouch) {
             resampleTouchState(sampleTime, static_cast<MotionEvent*>(*outEvent), next);
@@ -1042,7 +1448,7 @@ status_t InputConsumer::consumeSamples(InputEventFactoryInterface* factory,
 
     uint32_t chain = 0;
     for (size_t i = 0; i < count; i++) {
-        InputMessage& msg = batch.samples[i];
+        InputMessage& msg = batch[i];
         updateTouchState(msg);
         if (i) {
             SeqChain seqChain;
@@ -1055,7 +1461,7 @@ status_t InputConsumer::consumeSamples(InputEventFactoryInterface* factory,
         }
         chain = msg.header.seq;
     }
-    batch.samples.erase(batch.samples.begin(), batch.samples.begin() + count);
+    batch.pop(count);
 
     *outSeq = chain;
     *outEvent = motionEvent;
@@ -1403,14 +1809,53 @@ int32_t InputConsumer::getPendingBatchSource() const {
     }
 
     const Batch& batch = mBatches[0];
-    const InputMessage& head = batch.samples[0];
+    const InputMessage& head = batch[0];
     return head.body.motion.source;
 }
 
+void InputConsumer::Batch::push(const InputMessage& msg) {
+    if (mSize == capacity()) {
+        grow();
+    }
+    (*this)[mSize++] = msg;
+}
+
+void InputConsumer::Batch::pop(size_t count) {
+    LOG_ALWAYS_FATAL_IF(count > mSize, "Cannot pop %zu of %zu samples", count, mSize);
+    mSize -= count;
+    mHead = mSize == 0 ? 0 : (mHead + count) & (capacity() - 1);
+}
+
+void InputConsumer::Batch::grow() {
+    std::vector<InputMessage> samples(std::max(capacity() * 2, INITIAL_BATCH_CAPACITY));
+    for (size_t i = 0; i < mSize; i++) {
+        samples[i] = (*this)[i];
+    }
+    mSamples = std::move(samples);
+    mHead = 0;
+}
+
+void InputConsumer::startBatch(const InputMessage& msg) {
+    if (mSpareBatches.empty()) {
+        mBatches.emplace_back();
+    } else {
+        mBatches.push_back(std::move(mSpareBatches.back()));
+        mSpareBatches.pop_back();
+    }
+    mBatches.back().push(msg);
+}
+
+void InputConsumer::removeBatch(size_t index) {
+    Batch& batch = mBatches[index];
+    batch.clear();
+    mSpareBatches.push_back(std::move(batch));
+    mBatches.erase(mBatches.begin() + index);
+}
+
 ssize_t InputConsumer::findBatch(int32_t deviceId, int32_t source) const {
     for (size_t i = 0; i < mBatches.size(); i++) {
         const Batch& batch = mBatches[i];
-        const InputMessage& head = batch.samples[0];
+        const InputMessage& head = batch[0];
         if (head.body.motion.deviceId == deviceId && head.body.motion.source == source) {
             return i;
         }
@@ -1492,7 +1937,7 @@ void InputConsumer::addSample(MotionEvent* event, const InputMessage* msg) {
 }
 
 bool InputConsumer::canAddSample(const Batch& batch, const InputMessage *msg) {
-    const InputMessage& head = batch.samples[0];
+    const InputMessage& head = batch[0];
     uint32_t pointerCount = msg->body.motion.pointerCount;
     if (head.body.motion.pointerCount != pointerCount
             || head.body.motion.action != msg->body.motion.action) {
@@ -1508,9 +1953,9 @@ bool InputConsumer::canAddSample(const Batch& batch, const InputMessage *msg) {
 }
 
 ssize_t InputConsumer::findSampleNoLaterThan(const Batch& batch, nsecs_t time) {
-    size_t numSamples = batch.samples.size();
+    size_t numSamples = batch.size();
     size_t index = 0;
-    while (index < numSamples && batch.samples[index].body.motion.eventTime <= time) {
+    while (index < numSamples && batch[index].body.motion.eventTime <= time) {
         index += 1;
     }
     return ssize_t(index) - 1;
@@ -1527,7 +1972,8 @@ std::string InputConsumer::dump() const {
     out += "Batches:\n";
     for (const Batch& batch : mBatches) {
         out += "    Batch:\n";
-        for (const InputMessage& msg : batch.samples) {
+        for (size_t sample = 0; sample < batch.size(); sample++) {
+            const InputMessage& msg = batch[sample];
             out += android::base::StringPrintf("        Message %" PRIu32 ": %s ", msg.header.seq,
                                                ftl::enum_string(msg.header.type).c_str());
             switch (msg.header.type) {
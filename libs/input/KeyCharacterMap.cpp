@@ -34,6 +34,8 @@
 #include <utils/Timers.h>
 #include <utils/Tokenizer.h>
 
+#include "KeymapFileCache.h"
+
 // Enables debug output for the parser.
 #define DEBUG_PARSER 0
 
@@ -87,8 +89,24 @@ static String8 toString(const char16_t* chars, size_t numChars) {
 
 KeyCharacterMap::KeyCharacterMap(const std::string& filename) : mLoadFileName(filename) {}
 
+// Base maps parsed from files. Callers get their own copy, since overlays modify the map.
+static KeymapFileCache<KeyCharacterMap>& getBaseFileCache() {
+    static KeymapFileCache<KeyCharacterMap> cache;
+    return cache;
+}
+
 base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::load(const std::string& filename,
                                                                      Format format) {
+    std::optional<KeymapFileCache<KeyCharacterMap>::FileStamp> stamp;
+    if (format == Format::BASE) {
+        stamp = KeymapFileCache<KeyCharacterMap>::stamp(filename);
+        if (stamp) {
+            if (const auto base = getBaseFileCache().find(filename, *stamp)) {
+                return std::make_shared<KeyCharacterMap>(*base);
+            }
+        }
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
     if (status) {
@@ -103,6 +121,9 @@ base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::load(const std::
     std::unique_ptr<Tokenizer> t(tokenizer);
     status = map->load(t.get(), format);
     if (status == OK) {
+        if (stamp) {
+            getBaseFileCache().insert(filename, *stamp, std::make_shared<KeyCharacterMap>(*map));
+        }
         return map;
     }
     return Errorf("Load KeyCharacterMap failed {}.", status);
@@ -158,6 +179,16 @@ void KeyCharacterMap::clear() {
 
 status_t KeyCharacterMap::reloadBaseFromFile() {
     clear();
+    if (const auto stamp = KeymapFileCache<KeyCharacterMap>::stamp(mLoadFileName)) {
+        if (const auto base = getBaseFileCache().find(mLoadFileName, *stamp)) {
+            mKeys = base->mKeys;
+            mType = base->mType;
+            mKeysByScanCode = base->mKeysByScanCode;
+            mKeysByUsageCode = base->mKeysByUsageCode;
+            return OK;
+        }
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(String8(mLoadFileName.c_str()), &tokenizer);
     if (status) {
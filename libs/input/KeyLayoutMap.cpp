@@ -35,6 +35,8 @@
 #include <string_view>
 #include <unordered_map>
 
+#include "KeymapFileCache.h"
+
 /**
  * Log debug output for the parser.
  * Enable this via "adb shell setprop log.tag.KeyLayoutMapParser DEBUG" (requires restart)
@@ -129,6 +131,11 @@ bool kernelConfigsArePresent(const std::set<std::string>& configs) {
 KeyLayoutMap::KeyLayoutMap() = default;
 KeyLayoutMap::~KeyLayoutMap() = default;
 
+static KeymapFileCache<KeyLayoutMap>& getFileCache() {
+    static KeymapFileCache<KeyLayoutMap> cache;
+    return cache;
+}
+
 base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::loadContents(const std::string& filename,
                                                                        const char* contents) {
     return load(filename, contents);
@@ -136,6 +143,17 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::loadContents(const std
 
 base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string& filename,
                                                                const char* contents) {
+    // Maps are immutable once loaded, so devices with the same layout file can share one.
+    std::optional<KeymapFileCache<KeyLayoutMap>::FileStamp> stamp;
+    if (contents == nullptr) {
+        stamp = KeymapFileCache<KeyLayoutMap>::stamp(filename);
+        if (stamp) {
+            if (auto map = getFileCache().find(filename, *stamp)) {
+                return std::const_pointer_cast<KeyLayoutMap>(map);
+            }
+        }
+    }
+
     Tokenizer* tokenizer;
     status_t status;
     if (contents == nullptr) {
@@ -159,6 +177,9 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string
         return Errorf("Missing kernel config");
     }
     map->mLoadFileName = filename;
+    if (stamp) {
+        getFileCache().insert(filename, *stamp, map);
+    }
     return ret;
 }
 
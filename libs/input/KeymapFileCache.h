@@ -0,0 +1,92 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/stat.h>
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace android {
+
+/**
+ * A process-wide cache of parsed key map files, so that devices sharing a layout do not parse the
+ * same file again on every open. Entries are keyed by path and are only returned while the file
+ * on disk is unchanged.
+ */
+template <typename T>
+class KeymapFileCache {
+public:
+    struct FileStamp {
+        dev_t device;
+        ino_t inode;
+        off_t size;
+        int64_t mtimeNs;
+
+        bool operator==(const FileStamp&) const = default;
+    };
+
+    static std::optional<FileStamp> stamp(const std::string& filename) {
+        struct stat st;
+        if (stat(filename.c_str(), &st) != 0) {
+            return std::nullopt;
+        }
+#if defined(__APPLE__)
+        const timespec& mtime = st.st_mtimespec;
+#else
+        const timespec& mtime = st.st_mtim;
+#endif
+        return FileStamp{st.st_dev, st.st_ino, st.st_size,
+                         static_cast<int64_t>(mtime.tv_sec) * 1'000'000'000 + mtime.tv_nsec};
+    }
+
+    std::shared_ptr<const T> find(const std::string& filename, const FileStamp& stamp) const {
+        std::scoped_lock lock(mLock);
+        const auto it = mEntries.find(filename);
+        if (it == mEntries.end() || !(it->second.stamp == stamp)) {
+            return nullptr;
+        }
+        return it->second.map;
+    }
+
+    void insert(const std::string& filename, const FileStamp& stamp,
+                std::shared_ptr<const T> map) {
+        std::scoped_lock lock(mLock);
+        // There are only a few hundred key map files on a device, but bound the cache in case
+        // files keep being replaced.
+        if (mEntries.size() >= kMaxEntries && mEntries.find(filename) == mEntries.end()) {
+            mEntries.clear();
+        }
+        mEntries[filename] = {stamp, std::move(map)};
+    }
+
+private:
+    static constexpr size_t kMaxEntries = 512;
+
+    struct Entry {
+        FileStamp stamp;
+        std::shared_ptr<const T> map;
+    };
+
+    mutable std::mutex mLock;
+    std::unordered_map<std::string, Entry> mEntries;
+};
+
+} // namespace android
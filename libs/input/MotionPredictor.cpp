@@ -18,6 +18,9 @@
 
 #include <input/MotionPredictor.h>
 
+#include <pthread.h>
+#include <sys/resource.h>
+
 #include <cinttypes>
 #include <cmath>
 #include <cstddef>
@@ -28,6 +31,8 @@
 #include <android-base/strings.h>
 #include <android/input.h>
 #include <log/log.h>
+#include <system/thread_defs.h>
+#include <utils/Timers.h>
 
 #include <attestation/HmacKeyManager.h>
 #include <ftl/enum.h>
@@ -60,9 +65,22 @@ TfLiteMotionPredictorSample::Point convertPrediction(
 // --- MotionPredictor ---
 
 MotionPredictor::MotionPredictor(nsecs_t predictionTimestampOffsetNanos,
-                                 std::function<bool()> checkMotionPredictionEnabled)
+                                 std::function<bool()> checkMotionPredictionEnabled,
+                                 InferenceMode inferenceMode)
       : mPredictionTimestampOffsetNanos(predictionTimestampOffsetNanos),
-        mCheckMotionPredictionEnabled(std::move(checkMotionPredictionEnabled)) {}
+        mCheckMotionPredictionEnabled(std::move(checkMotionPredictionEnabled)),
+        mInferenceMode(inferenceMode) {}
+
+MotionPredictor::~MotionPredictor() {
+    if (mInferenceThread.joinable()) {
+        {
+            std::scoped_lock lock(mLock);
+            mStopInference = true;
+        }
+        mInferenceRequested.notify_all();
+        mInferenceThread.join();
+    }
+}
 
 android::base::Result<void> MotionPredictor::record(const MotionEvent& event) {
     if (mLastEvent && mLastEvent->getDeviceId() != event.getDeviceId()) {
@@ -90,11 +108,27 @@ android::base::Result<void> MotionPredictor::record(const MotionEvent& event) {
         mBuffers = std::make_unique<TfLiteMotionPredictorBuffers>(mModel->inputLength());
     }
 
+    if (!mMetricsManager) {
+        mMetricsManager.emplace(mModel->config().predictionInterval, mModel->outputLength());
+    }
+
+    // The model is only used by the inference thread from now on.
+    if (mInferenceMode == InferenceMode::ASYNCHRONOUS && !mInferenceThread.joinable()) {
+        startInferenceThread();
+    }
+
     const int32_t action = event.getActionMasked();
     if (action == AMOTION_EVENT_ACTION_UP || action == AMOTION_EVENT_ACTION_CANCEL) {
         ALOGD_IF(isDebug(), "End of event stream");
         mBuffers->reset();
         mLastEvent.reset();
+        if (mInferenceMode == InferenceMode::ASYNCHRONOUS) {
+            std::scoped_lock lock(mLock);
+            mPendingSamples.clear();
+            mPendingReset = true;
+            mGestureId++;
+            mLatestResult.reset();
+        }
         return {};
     } else if (action != AMOTION_EVENT_ACTION_DOWN && action != AMOTION_EVENT_ACTION_MOVE) {
         ALOGD_IF(isDebug(), "Skipping unsupported %s action",
@@ -114,20 +148,28 @@ android::base::Result<void> MotionPredictor::record(const MotionEvent& event) {
         return {};
     }
 
-    for (size_t i = 0; i <= event.getHistorySize(); ++i) {
-        if (event.isResampled(0, i)) {
-            continue;
+    {
+        std::scoped_lock lock(mLock);
+        for (size_t i = 0; i <= event.getHistorySize(); ++i) {
+            if (event.isResampled(0, i)) {
+                continue;
+            }
+            const PointerCoords* coords = event.getHistoricalRawPointerCoords(0, i);
+            const TfLiteMotionPredictorSample sample{
+                    .position.x = coords->getAxisValue(AMOTION_EVENT_AXIS_X),
+                    .position.y = coords->getAxisValue(AMOTION_EVENT_AXIS_Y),
+                    .pressure = event.getHistoricalPressure(0, i),
+                    .tilt = event.getHistoricalAxisValue(AMOTION_EVENT_AXIS_TILT, 0, i),
+                    .orientation = event.getHistoricalOrientation(0, i),
+            };
+            mBuffers->pushSample(event.getHistoricalEventTime(i), sample);
+            if (mInferenceMode == InferenceMode::ASYNCHRONOUS) {
+                mPendingSamples.push_back({event.getHistoricalEventTime(i), sample});
+            }
         }
-        const PointerCoords* coords = event.getHistoricalRawPointerCoords(0, i);
-        mBuffers->pushSample(event.getHistoricalEventTime(i),
-                             {
-                                     .position.x = coords->getAxisValue(AMOTION_EVENT_AXIS_X),
-                                     .position.y = coords->getAxisValue(AMOTION_EVENT_AXIS_Y),
-                                     .pressure = event.getHistoricalPressure(0, i),
-                                     .tilt = event.getHistoricalAxisValue(AMOTION_EVENT_AXIS_TILT,
-                                                                          0, i),
-                                     .orientation = event.getHistoricalOrientation(0, i),
-                             });
+    }
+    if (mInferenceMode == InferenceMode::ASYNCHRONOUS) {
+        mInferenceRequested.notify_one();
     }
 
     if (!mLastEvent) {
@@ -136,39 +178,126 @@ android::base::Result<void> MotionPredictor::record(const MotionEvent& event) {
     mLastEvent->copyFrom(&event, /*keepHistory=*/false);
 
     // Pass input event to the MetricsManager.
-    if (!mMetricsManager) {
-        mMetricsManager.emplace(mModel->config().predictionInterval, mModel->outputLength());
-    }
     mMetricsManager->onRecord(event);
 
     return {};
 }
 
+void MotionPredictor::startInferenceThread() {
+    mInferenceThread = std::thread([this]() { runInferenceLoop(); });
+}
+
+void MotionPredictor::runInferenceLoop() {
+#if defined(__linux__)
+    pthread_setname_np(pthread_self(), "MotionPredictor");
+    // The prediction is needed for the next frame, run at the same priority as the display
+    // pipeline. This fails without the permission to raise the priority, which is fine.
+    setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_DISPLAY);
+#endif
+
+    TfLiteMotionPredictorBuffers buffers(mModel->inputLength());
+    std::vector<PendingSample> samples;
+    ModelResult result;
+
+    std::unique_lock lock(mLock);
+    base::ScopedLockAssertion assumeLocked(mLock);
+    while (true) {
+        while (!mStopInference && !mPendingReset && mPendingSamples.empty()) {
+            mInferenceRequested.wait(lock);
+        }
+        if (mStopInference) {
+            return;
+        }
+        if (mPendingReset) {
+            buffers.reset();
+            mPendingReset = false;
+        }
+        // Swap rather than copy, so that neither vector needs to grow again.
+        std::swap(samples, mPendingSamples);
+        const uint64_t gestureId = mGestureId;
+        lock.unlock();
+
+        for (const PendingSample& pending : samples) {
+            buffers.pushSample(pending.timestamp, pending.sample);
+        }
+        samples.clear();
+
+        if (buffers.isReady()) {
+            buffers.copyTo(*mModel);
+            const nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+            LOG_ALWAYS_FATAL_IF(!mModel->invoke());
+            result.invokeDuration = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+            result.axisFrom = buffers.axisFrom().position;
+            result.axisTo = buffers.axisTo().position;
+            result.lastTimestamp = buffers.lastTimestamp();
+            result.r.assign(mModel->outputR().begin(), mModel->outputR().end());
+            result.phi.assign(mModel->outputPhi().begin(), mModel->outputPhi().end());
+            result.pressure.assign(mModel->outputPressure().begin(),
+                                   mModel->outputPressure().end());
+        }
+
+        lock.lock();
+        if (buffers.isReady() && gestureId == mGestureId) {
+            if (!mLatestResult) {
+                mLatestResult = result;
+            } else {
+                // Reuse the capacity of the previous result.
+                std::swap(*mLatestResult, result);
+            }
+            mLatestResultReported = false;
+        }
+    }
+}
+
 std::unique_ptr<MotionEvent> MotionPredictor::predict(nsecs_t timestamp) {
     if (mBuffers == nullptr || !mBuffers->isReady()) {
         return nullptr;
     }
-
     LOG_ALWAYS_FATAL_IF(!mModel);
-    mBuffers->copyTo(*mModel);
-    LOG_ALWAYS_FATAL_IF(!mModel->invoke());
+    LOG_ALWAYS_FATAL_IF(!mMetricsManager);
 
-    // Read out the predictions.
-    const std::span<const float> predictedR = mModel->outputR();
-    const std::span<const float> predictedPhi = mModel->outputPhi();
-    const std::span<const float> predictedPressure = mModel->outputPressure();
+    if (mInferenceMode == InferenceMode::ASYNCHRONOUS) {
+        std::scoped_lock lock(mLock);
+        if (!mLatestResult) {
+            return nullptr;
+        }
+        if (!mLatestResultReported) {
+            mMetricsManager->onModelInvoke(mLatestResult->invokeDuration);
+            mLatestResultReported = true;
+        }
+        return createPrediction(mLatestResult->axisFrom, mLatestResult->axisTo,
+                                mLatestResult->lastTimestamp, mLatestResult->r,
+                                mLatestResult->phi, mLatestResult->pressure, timestamp,
+                                /*notBefore=*/mBuffers->lastTimestamp());
+    }
 
-    TfLiteMotionPredictorSample::Point axisFrom = mBuffers->axisFrom().position;
-    TfLiteMotionPredictorSample::Point axisTo = mBuffers->axisTo().position;
+    mBuffers->copyTo(*mModel);
+    const nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    LOG_ALWAYS_FATAL_IF(!mModel->invoke());
+    mMetricsManager->onModelInvoke(systemTime(SYSTEM_TIME_MONOTONIC) - startTime);
 
     if (isDebug()) {
-        ALOGD("axisFrom: %f, %f", axisFrom.x, axisFrom.y);
-        ALOGD("axisTo: %f, %f", axisTo.x, axisTo.y);
         ALOGD("mInputR: %s", base::Join(mModel->inputR(), ", ").c_str());
         ALOGD("mInputPhi: %s", base::Join(mModel->inputPhi(), ", ").c_str());
         ALOGD("mInputPressure: %s", base::Join(mModel->inputPressure(), ", ").c_str());
         ALOGD("mInputTilt: %s", base::Join(mModel->inputTilt(), ", ").c_str());
         ALOGD("mInputOrientation: %s", base::Join(mModel->inputOrientation(), ", ").c_str());
+    }
+
+    return createPrediction(mBuffers->axisFrom().position, mBuffers->axisTo().position,
+                            mBuffers->lastTimestamp(), mModel->outputR(), mModel->outputPhi(),
+                            mModel->outputPressure(), timestamp,
+                            /*notBefore=*/mBuffers->lastTimestamp());
+}
+
+std::unique_ptr<MotionEvent> MotionPredictor::createPrediction(
+        TfLiteMotionPredictorSample::Point axisFrom, TfLiteMotionPredictorSample::Point axisTo,
+        int64_t lastTimestamp, std::span<const float> predictedR,
+        std::span<const float> predictedPhi, std::span<const float> predictedPressure,
+        nsecs_t timestamp, int64_t notBefore) {
+    if (isDebug()) {
+        ALOGD("axisFrom: %f, %f", axisFrom.x, axisFrom.y);
+        ALOGD("axisTo: %f, %f", axisTo.x, axisTo.y);
         ALOGD("predictedR: %s", base::Join(predictedR, ", ").c_str());
         ALOGD("predictedPhi: %s", base::Join(predictedPhi, ", ").c_str());
         ALOGD("predictedPressure: %s", base::Join(predictedPressure, ", ").c_str());
@@ -178,7 +307,7 @@ std::unique_ptr<MotionEvent> MotionPredictor::predict(nsecs_t timestamp) {
     const MotionEvent& event = *mLastEvent;
     bool hasPredictions = false;
     std::unique_ptr<MotionEvent> prediction = std::make_unique<MotionEvent>();
-    int64_t predictionTime = mBuffers->lastTimestamp();
+    int64_t predictionTime = lastTimestamp;
     const int64_t futureTime = timestamp + mPredictionTimestampOffsetNanos;
 
     for (int i = 0; i < predictedR.size() && predictionTime <= futureTime; ++i) {
@@ -197,6 +326,13 @@ std::unique_ptr<MotionEvent> MotionPredictor::predict(nsecs_t timestamp) {
 
         const TfLiteMotionPredictorSample::Point predictedPoint =
                 convertPrediction(axisFrom, axisTo, predictedR[i], predictedPhi[i]);
+        predictionTime += mModel->config().predictionInterval;
+        axisFrom = axisTo;
+        axisTo = predictedPoint;
+        if (predictionTime <= notBefore) {
+            // The model ran on older samples, and this point has already been recorded.
+            continue;
+        }
 
         ALOGD_IF(isDebug(), "prediction %d: %f, %f", i, predictedPoint.x, predictedPoint.y);
         PointerCoords coords;
@@ -205,8 +341,7 @@ std::unique_ptr<MotionEvent> MotionPredictor::predict(nsecs_t timestamp) {
         coords.setAxisValue(AMOTION_EVENT_AXIS_Y, predictedPoint.y);
         coords.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, predictedPressure[i]);
 
-        predictionTime += mModel->config().predictionInterval;
-        if (i == 0) {
+        if (!hasPredictions) {
             hasPredictions = true;
             prediction->initialize(InputEvent::nextId(), event.getDeviceId(), event.getSource(),
                                    event.getDisplayId(), INVALID_HMAC, AMOTION_EVENT_ACTION_MOVE,
@@ -220,9 +355,6 @@ std::unique_ptr<MotionEvent> MotionPredictor::predict(nsecs_t timestamp) {
         } else {
             prediction->addSample(predictionTime, &coords);
         }
-
-        axisFrom = axisTo;
-        axisTo = predictedPoint;
     }
 
     if (!hasPredictions) {
@@ -230,7 +362,6 @@ std::unique_ptr<MotionEvent> MotionPredictor::predict(nsecs_t timestamp) {
     }
 
     // Pass predictions to the MetricsManager.
-    LOG_ALWAYS_FATAL_IF(!mMetricsManager);
     mMetricsManager->onPredict(*prediction);
 
     return prediction;
@@ -19,8 +19,10 @@
 #include <input/MotionPredictorMetricsManager.h>
 
 #include <algorithm>
+#include <cinttypes>
 
 #include <android-base/logging.h>
+#include <log/log.h>
 
 #include "Eigen/Core"
 #include "Eigen/Geometry"
@@ -32,6 +34,14 @@
 namespace android {
 namespace {
 
+/**
+ * Log debug messages about the metrics reported for each stroke.
+ * Enable this via "adb shell setprop log.tag.MotionPredictorMetricsManager DEBUG"
+ */
+bool isDebug() {
+    return __android_log_is_loggable(ANDROID_LOG_DEBUG, LOG_TAG, ANDROID_LOG_INFO);
+}
+
 inline constexpr int NANOS_PER_SECOND = 1'000'000'000; // nanoseconds per second
 inline constexpr int NANOS_PER_MILLIS = 1'000'000;     // nanoseconds per millisecond
 
@@ -52,7 +62,8 @@ MotionPredictorMetricsManager::MotionPredictorMetricsManager(nsecs_t predictionI
         mMaxNumPredictions(maxNumPredictions),
         mRecentGroundTruthPoints(maxNumPredictions + 1),
         mAggregatedMetrics(maxNumPredictions),
-        mAtomFields(maxNumPredictions) {}
+        mAtomFields(maxNumPredictions),
+        mInvokeDurations(MAX_INVOKE_TIME_SAMPLES) {}
 
 void MotionPredictorMetricsManager::onRecord(const MotionEvent& inputEvent) {
     // Convert MotionEvent to GroundTruthPoint.
@@ -108,9 +119,32 @@ void MotionPredictorMetricsManager::onPredict(const MotionEvent& predictionEvent
     std::sort(mRecentPredictions.begin(), mRecentPredictions.end());
 }
 
+void MotionPredictorMetricsManager::onModelInvoke(nsecs_t invokeDuration) {
+    mInvokeDurations.pushBack(invokeDuration);
+}
+
+std::optional<MotionPredictorMetricsManager::InvokeTimePercentiles>
+MotionPredictorMetricsManager::getInvokeTimePercentiles() const {
+    if (mInvokeDurations.size() == 0) {
+        return std::nullopt;
+    }
+    std::vector<nsecs_t> durations(mInvokeDurations.begin(), mInvokeDurations.end());
+    // Nearest-rank percentiles.
+    const auto percentile = [&durations](size_t p) {
+        const size_t rank = (p * durations.size() + 99) / 100;
+        const auto nth = durations.begin() + (rank == 0 ? 0 : rank - 1);
+        std::nth_element(durations.begin(), nth, durations.end());
+        return *nth;
+    };
+    return InvokeTimePercentiles{.p50 = percentile(50),
+                                 .p90 = percentile(90),
+                                 .p99 = percentile(99)};
+}
+
 void MotionPredictorMetricsManager::clearStrokeData() {
     mRecentGroundTruthPoints.clear();
     mRecentPredictions.clear();
+    mInvokeDurations.clear();
     std::fill(mAggregatedMetrics.begin(), mAggregatedMetrics.end(), AggregatedStrokeMetrics{});
     std::fill(mAtomFields.begin(), mAtomFields.end(), AtomFields{});
 }
@@ -364,6 +398,15 @@ void MotionPredictorMetricsManager::reportMetrics() {
 #endif
     }
 
+    // The atom has no fields for the model performance, so only log it.
+    const std::optional<InvokeTimePercentiles> percentiles =
+            isDebug() ? getInvokeTimePercentiles() : std::nullopt;
+    if (percentiles) {
+        ALOGD("Model invoke time over %zu runs: p50=%" PRId64 "ns p90=%" PRId64 "ns p99=%" PRId64
+              "ns",
+              mInvokeDurations.size(), percentiles->p50, percentiles->p90, percentiles->p99);
+    }
+
     // Set mock atom fields, if available.
     if (mMockLoggedAtomFields != nullptr) {
         *mMockLoggedAtomFields = mAtomFields;
@@ -23,6 +23,7 @@
 #include <limits.h>
 #include <math.h>
 #include <optional>
+#include <span>
 
 #include <android-base/stringprintf.h>
 #include <input/PrintTools.h>
@@ -117,7 +118,7 @@ static std::string vectorToString(const float* a, uint32_t m) {
     return str;
 }
 
-static std::string vectorToString(const std::vector<float>& v) {
+static std::string vectorToString(std::span<const float> v) {
     return vectorToString(v.data(), v.size());
 }
 
@@ -392,6 +393,7 @@ LeastSquaresVelocityTrackerStrategy::~LeastSquaresVelocityTrackerStrategy() {
 void LeastSquaresVelocityTrackerStrategy::clearPointer(int32_t pointerId) {
     mIndex.erase(pointerId);
     mMovements.erase(pointerId);
+    mEstimators.erase(pointerId);
 }
 
 void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, int32_t pointerId,
@@ -420,6 +422,9 @@ void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, int32_t
     Movement& movement = movementIt->second[index];
     movement.eventTime = eventTime;
     movement.position = position;
+
+    // Keep the entry around, so that tracking a pointer doesn't allocate on every sample.
+    mEstimators[pointerId].reset();
 }
 
 /**
@@ -471,8 +476,8 @@ void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, int32_t
  * http://en.wikipedia.org/wiki/Numerical_methods_for_linear_least_squares
  * http://en.wikipedia.org/wiki/Gram-Schmidt
  */
-static bool solveLeastSquares(const std::vector<float>& x, const std::vector<float>& y,
-                              const std::vector<float>& w, uint32_t n,
+static bool solveLeastSquares(std::span<const float> x, std::span<const float> y,
+                              std::span<const float> w, uint32_t n,
                               std::array<float, VelocityTracker::Estimator::MAX_DEGREE + 1>& outB,
                               float* outDet) {
     const size_t m = x.size();
@@ -594,7 +599,7 @@ static bool solveLeastSquares(const std::vector<float>& x, const std::vector<flo
  * the default implementation
  */
 static std::optional<std::array<float, 3>> solveUnweightedLeastSquaresDeg2(
-        const std::vector<float>& x, const std::vector<float>& y) {
+        std::span<const float> x, std::span<const float> y) {
     const size_t count = x.size();
     LOG_ALWAYS_FATAL_IF(count != y.size(), "Mismatching array sizes");
     // Solving y = a*x^2 + b*x + c
@@ -649,15 +654,27 @@ std::optional<VelocityTracker::Estimator> LeastSquaresVelocityTrackerStrategy::g
     if (movementIt == mMovements.end()) {
         return std::nullopt; // no data
     }
+    // The fit only depends on the samples, so it can be reused until the next movement. Apps
+    // commonly query the velocity of every pointer several times per frame.
+    std::optional<VelocityTracker::Estimator>& estimator = mEstimators[pointerId];
+    if (!estimator) {
+        estimator = computeEstimator(pointerId, movementIt->second);
+    }
+    return estimator;
+}
+
+std::optional<VelocityTracker::Estimator> LeastSquaresVelocityTrackerStrategy::computeEstimator(
+        int32_t pointerId, const std::array<Movement, HISTORY_SIZE>& movements) const {
     // Iterate over movement samples in reverse time order and collect samples.
-    std::vector<float> positions;
-    std::vector<float> w;
-    std::vector<float> time;
+    std::array<float, HISTORY_SIZE> positions;
+    std::array<float, HISTORY_SIZE> w;
+    std::array<float, HISTORY_SIZE> time;
+    size_t m = 0;
 
     uint32_t index = mIndex.at(pointerId);
-    const Movement& newestMovement = movementIt->second[index];
+    const Movement& newestMovement = movements[index];
     do {
-        const Movement& movement = movementIt->second[index];
+        const Movement& movement = movements[index];
 
         nsecs_t age = newestMovement.eventTime - movement.eventTime;
         if (age > HORIZON) {
@@ -675,13 +692,14 @@ std::optional<VelocityTracker::Estimator> LeastSquaresVelocityTrackerStrategy::g
             // In practice, time will never be 0.
             break;
         }
-        positions.push_back(movement.position);
-        w.push_back(chooseWeight(pointerId, index));
-        time.push_back(-age * 0.000000001f);
+        positions[m] = movement.position;
+        // Weights are not used by the unweighted fit, don't bother looking up the history.
+        w[m] = mWeighting == Weighting::NONE ? 1.0f : chooseWeight(pointerId, index);
+        time[m] = -age * 0.000000001f;
+        m++;
         index = (index == 0 ? HISTORY_SIZE : index) - 1;
-    } while (positions.size() < HISTORY_SIZE);
+    } while (m < HISTORY_SIZE);
 
-    const size_t m = positions.size();
     if (m == 0) {
         return std::nullopt; // no data
     }
@@ -695,7 +713,8 @@ std::optional<VelocityTracker::Estimator> LeastSquaresVelocityTrackerStrategy::g
     if (degree == 2 && mWeighting == Weighting::NONE) {
         // Optimize unweighted, quadratic polynomial fit
         std::optional<std::array<float, 3>> coeff =
-                solveUnweightedLeastSquaresDeg2(time, positions);
+                solveUnweightedLeastSquaresDeg2(std::span(time).first(m),
+                                                std::span(positions).first(m));
         if (coeff) {
             VelocityTracker::Estimator estimator;
             estimator.time = newestMovement.eventTime;
@@ -711,7 +730,8 @@ std::optional<VelocityTracker::Estimator> LeastSquaresVelocityTrackerStrategy::g
         float det;
         uint32_t n = degree + 1;
         VelocityTracker::Estimator estimator;
-        if (solveLeastSquares(time, positions, w, n, estimator.coeff, &det)) {
+        if (solveLeastSquares(std::span(time).first(m), std::span(positions).first(m),
+                              std::span(w).first(m), n, estimator.coeff, &det)) {
             estimator.time = newestMovement.eventTime;
             estimator.degree = degree;
             estimator.confidence = det;
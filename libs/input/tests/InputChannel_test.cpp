@@ -18,6 +18,7 @@
 
 #include "TestHelpers.h"
 
+#include <sys/socket.h>
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
@@ -227,4 +228,216 @@ TEST_F(InputChannelTest, DuplicateChannelAndAssertEqual) {
     EXPECT_EQ(*serverChannel == *dupChan, true) << "inputchannel should be equal after duplication";
 }
 
+TEST_F(InputChannelTest, SendMessages_DeliversEachMessageSeparately) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    // Mix message types so that messages of different sizes are batched together.
+    std::array<InputMessage, 3> serverMsgs;
+    for (size_t i = 0; i < serverMsgs.size(); i++) {
+        memset(&serverMsgs[i], 0, sizeof(InputMessage));
+        serverMsgs[i].header.seq = i + 1;
+    }
+    serverMsgs[0].header.type = InputMessage::Type::KEY;
+    serverMsgs[1].header.type = InputMessage::Type::MOTION;
+    serverMsgs[1].body.motion.pointerCount = 2;
+    serverMsgs[1].body.motion.pointers[1].coords.setAxisValue(AMOTION_EVENT_AXIS_X, 42);
+    serverMsgs[2].header.type = InputMessage::Type::FOCUS;
+
+    size_t sentCount;
+    EXPECT_EQ(OK, serverChannel->sendMessages(serverMsgs.data(), serverMsgs.size(), &sentCount));
+    EXPECT_EQ(serverMsgs.size(), sentCount);
+
+    for (const InputMessage& serverMsg : serverMsgs) {
+        InputMessage clientMsg;
+        ASSERT_EQ(OK, clientChannel->receiveMessage(&clientMsg))
+                << "client channel should receive one message per sent message";
+        EXPECT_EQ(serverMsg.header.type, clientMsg.header.type);
+        EXPECT_EQ(serverMsg.header.seq, clientMsg.header.seq);
+    }
+    InputMessage clientMsg;
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&clientMsg));
+}
+
+TEST_F(InputChannelTest, SendMessages_WhenChannelFull_ReportsSentMessages) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    // Far more messages than the socket buffer can hold.
+    std::vector<InputMessage> serverMsgs(1000);
+    for (size_t i = 0; i < serverMsgs.size(); i++) {
+        memset(&serverMsgs[i], 0, sizeof(InputMessage));
+        serverMsgs[i].header.type = InputMessage::Type::KEY;
+        serverMsgs[i].header.seq = i + 1;
+    }
+
+    size_t sentCount;
+    EXPECT_EQ(WOULD_BLOCK,
+              serverChannel->sendMessages(serverMsgs.data(), serverMsgs.size(), &sentCount));
+    ASSERT_GT(sentCount, 0u);
+    ASSERT_LT(sentCount, serverMsgs.size());
+
+    for (size_t i = 0; i < sentCount; i++) {
+        InputMessage clientMsg;
+        ASSERT_EQ(OK, clientChannel->receiveMessage(&clientMsg));
+        EXPECT_EQ(serverMsgs[i].header.seq, clientMsg.header.seq);
+    }
+    InputMessage clientMsg;
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&clientMsg))
+            << "messages past sentCount should not have been sent";
+}
+
+namespace {
+
+InputMessage makeKeyMessage(uint32_t seq) {
+    InputMessage msg;
+    memset(&msg, 0, sizeof(InputMessage));
+    msg.header.type = InputMessage::Type::KEY;
+    msg.header.seq = seq;
+    return msg;
+}
+
+} // namespace
+
+TEST_F(InputChannelTest, SharedMemory_SwitchesOverOnceReaderIsAttached) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                                 InputChannel::Transport::SHARED_MEMORY));
+
+    // The client hasn't read anything yet, so the socket is used.
+    InputMessage msg = makeKeyMessage(1);
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    EXPECT_EQ(InputChannel::Transport::SOCKET, serverChannel->getTransport());
+
+    InputMessage clientMsg;
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&clientMsg));
+    EXPECT_EQ(1u, clientMsg.header.seq);
+
+    // Now that the client reads, the server switches to the shared memory, without reordering
+    // messages that are still in the socket.
+    msg = makeKeyMessage(2);
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    EXPECT_EQ(InputChannel::Transport::SHARED_MEMORY, serverChannel->getTransport());
+    msg = makeKeyMessage(3);
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&clientMsg));
+    EXPECT_EQ(2u, clientMsg.header.seq);
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&clientMsg));
+    EXPECT_EQ(3u, clientMsg.header.seq);
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&clientMsg));
+
+    // Replies go back through the shared memory as well, once the server reads.
+    EXPECT_EQ(WOULD_BLOCK, serverChannel->receiveMessage(&msg));
+    InputMessage reply;
+    memset(&reply, 0, sizeof(InputMessage));
+    reply.header.type = InputMessage::Type::FINISHED;
+    reply.header.seq = 3;
+    reply.body.finished.handled = true;
+    ASSERT_EQ(OK, clientChannel->sendMessage(&reply));
+    EXPECT_EQ(InputChannel::Transport::SHARED_MEMORY, clientChannel->getTransport());
+    ASSERT_EQ(OK, serverChannel->receiveMessage(&msg));
+    EXPECT_EQ(InputMessage::Type::FINISHED, msg.header.type);
+    EXPECT_EQ(3u, msg.header.seq);
+    EXPECT_TRUE(msg.body.finished.handled);
+}
+
+TEST_F(InputChannelTest, SharedMemory_CoalescesDoorbells) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                                 InputChannel::Transport::SHARED_MEMORY));
+    InputMessage clientMsg;
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&clientMsg));
+    InputMessage msg = makeKeyMessage(1);
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&clientMsg));
+    ASSERT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&clientMsg));
+
+    // The client is now waiting. A burst of messages must wake it up exactly once.
+    for (uint32_t seq = 2; seq < 6; seq++) {
+        msg = makeKeyMessage(seq);
+        ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    }
+    uint8_t buffer[sizeof(InputMessage)];
+    EXPECT_EQ(1, ::recv(clientChannel->getFd(), buffer, sizeof(buffer), MSG_DONTWAIT));
+    EXPECT_EQ(-1, ::recv(clientChannel->getFd(), buffer, sizeof(buffer), MSG_DONTWAIT));
+    EXPECT_EQ(EAGAIN, errno);
+
+    for (uint32_t seq = 2; seq < 6; seq++) {
+        ASSERT_EQ(OK, clientChannel->receiveMessage(&clientMsg));
+        EXPECT_EQ(seq, clientMsg.header.seq);
+    }
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&clientMsg));
+}
+
+TEST_F(InputChannelTest, SharedMemory_FallsBackToSocketForReadersWithoutSharedMemory) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                                 InputChannel::Transport::SHARED_MEMORY));
+    // Recreating the channel from its fd alone loses the shared memory.
+    std::unique_ptr<InputChannel> socketOnlyClient =
+            InputChannel::create(clientChannel->getName(),
+                                 android::base::unique_fd(::dup(clientChannel->getFd())),
+                                 clientChannel->getConnectionToken());
+    clientChannel.reset();
+
+    InputMessage clientMsg;
+    for (uint32_t seq = 1; seq < 4; seq++) {
+        EXPECT_EQ(WOULD_BLOCK, socketOnlyClient->receiveMessage(&clientMsg));
+        InputMessage msg = makeKeyMessage(seq);
+        ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+        ASSERT_EQ(OK, socketOnlyClient->receiveMessage(&clientMsg));
+        EXPECT_EQ(seq, clientMsg.header.seq);
+    }
+    EXPECT_EQ(InputChannel::Transport::SOCKET, serverChannel->getTransport());
+}
+
+TEST_F(InputChannelTest, SharedMemory_IsKeptWhenParceled) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                                 InputChannel::Transport::SHARED_MEMORY));
+    Parcel parcel;
+    ASSERT_EQ(OK, clientChannel->writeToParcel(&parcel));
+    clientChannel.reset();
+    parcel.setDataPosition(0);
+    InputChannel unparceledClient;
+    ASSERT_EQ(OK, unparceledClient.readFromParcel(&parcel));
+
+    InputMessage clientMsg;
+    EXPECT_EQ(WOULD_BLOCK, unparceledClient.receiveMessage(&clientMsg));
+    InputMessage msg = makeKeyMessage(1);
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    EXPECT_EQ(InputChannel::Transport::SHARED_MEMORY, serverChannel->getTransport());
+    ASSERT_EQ(OK, unparceledClient.receiveMessage(&clientMsg));
+    EXPECT_EQ(1u, clientMsg.header.seq);
+}
+
+TEST_F(InputChannelTest, SharedMemory_ReportsDeadPeer) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                                 InputChannel::Transport::SHARED_MEMORY));
+    InputMessage msg;
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&msg));
+    msg = makeKeyMessage(1);
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    serverChannel.reset();
+
+    // Messages that were already written can still be read, then the closed socket is reported.
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&msg));
+    EXPECT_EQ(DEAD_OBJECT, clientChannel->receiveMessage(&msg));
+}
+
 } // namespace android
@@ -133,6 +133,21 @@ TEST_F(InputDeviceKeyMapTest, keyCharacteMapApplyMultipleOverlaysTest) {
     ASSERT_EQ(*mKeyMap.keyCharacterMap, *frenchOverlaidKeyCharacterMap);
 }
 
+TEST_F(InputDeviceKeyMapTest, reloadingKeyMapsUsesCache) {
+    base::Result<std::shared_ptr<KeyLayoutMap>> layout = KeyLayoutMap::load(mKeyMap.keyLayoutFile);
+    ASSERT_TRUE(layout.ok()) << "Cannot load KeyLayout at " << mKeyMap.keyLayoutFile;
+    // Key layout maps are immutable, so the same instance is shared.
+    ASSERT_EQ(mKeyMap.keyLayoutMap, *layout);
+
+    base::Result<std::shared_ptr<KeyCharacterMap>> characterMap =
+            KeyCharacterMap::load(mKeyMap.keyCharacterMapFile, KeyCharacterMap::Format::BASE);
+    ASSERT_TRUE(characterMap.ok())
+            << "Cannot load KeyCharacterMap at " << mKeyMap.keyCharacterMapFile;
+    // Key character maps can be overlaid, so each load returns its own copy.
+    ASSERT_NE(mKeyMap.keyCharacterMap, *characterMap);
+    ASSERT_EQ(*mKeyMap.keyCharacterMap, **characterMap);
+}
+
 TEST_F(InputDeviceKeyMapTest, keyCharacteMapBadAxisLabel) {
     std::string klPath = base::GetExecutableDirectory() + "/data/bad_axis_label.kl";
 
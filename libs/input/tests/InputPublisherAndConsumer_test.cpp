@@ -559,4 +559,36 @@ TEST_F(InputPublisherAndConsumerTest, PublishMultipleEvents_EndToEnd) {
     ASSERT_NO_FATAL_FAILURE(PublishAndConsumeTouchModeEvent());
 }
 
+TEST_F(InputPublisherAndConsumerTest, PublishBatch_EventsAreWrittenOnEndBatch) {
+    mPublisher->beginBatch();
+    ASSERT_EQ(OK,
+              mPublisher->publishFocusEvent(/*seq=*/1, InputEvent::nextId(), /*hasFocus=*/true));
+    ASSERT_EQ(OK, mPublisher->publishTouchModeEvent(/*seq=*/2, InputEvent::nextId(),
+                                                    /*isInTouchMode=*/true));
+    ASSERT_EQ(OK,
+              mPublisher->publishFocusEvent(/*seq=*/3, InputEvent::nextId(), /*hasFocus=*/false));
+
+    uint32_t consumeSeq;
+    InputEvent* event;
+    ASSERT_EQ(WOULD_BLOCK,
+              mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq, &event))
+            << "batched events should not be written before endBatch";
+
+    size_t publishedCount;
+    ASSERT_EQ(OK, mPublisher->endBatch(&publishedCount));
+    ASSERT_EQ(3u, publishedCount);
+
+    for (uint32_t seq = 1; seq <= 3; seq++) {
+        ASSERT_EQ(OK,
+                  mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq,
+                                     &event));
+        ASSERT_NE(nullptr, event);
+        EXPECT_EQ(seq, consumeSeq) << "batched events should be received in publish order";
+        EXPECT_EQ(seq == 2 ? InputEventType::TOUCH_MODE : InputEventType::FOCUS, event->getType());
+    }
+
+    // Once the batch has ended, events are written immediately again.
+    ASSERT_NO_FATAL_FAILURE(PublishAndConsumeKeyEvent());
+}
+
 } // namespace android
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+#include <benchmark/benchmark.h>
+
+#include <attestation/HmacKeyManager.h>
+#include <gui/constants.h>
+#include <input/InputTransport.h>
+#include <log/log.h>
+
+// Counts the allocations of the benchmarked code.
+static std::atomic<size_t> gAllocations{0};
+
+void* operator new(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = malloc(std::max<size_t>(size, 1));
+    LOG_ALWAYS_FATAL_IF(ptr == nullptr, "Could not allocate %zu bytes", size);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace android {
+
+namespace {
+
+// Number of motion samples published for each connection per frame, e.g. a 240Hz touchscreen
+// with historical samples on a 60Hz display, plus stylus hover.
+constexpr size_t SAMPLES_PER_FRAME = 8;
+
+// A 480Hz touchscreen also delivers 8 samples per frame of a 60Hz display.
+constexpr nsecs_t SAMPLE_INTERVAL_480HZ = 1'000'000'000 / 480;
+
+struct ChannelPair {
+    std::shared_ptr<InputChannel> server;
+    std::shared_ptr<InputChannel> client;
+
+    ChannelPair() {
+        std::unique_ptr<InputChannel> serverChannel, clientChannel;
+        InputChannel::openInputChannelPair("benchmark", serverChannel, clientChannel);
+        server = std::move(serverChannel);
+        client = std::move(clientChannel);
+    }
+
+    void drain(size_t count) {
+        InputMessage msg;
+        for (size_t i = 0; i < count; i++) {
+            client->receiveMessage(&msg);
+        }
+    }
+};
+
+status_t publishSample(InputPublisher& publisher, uint32_t seq, size_t pointerCount,
+                       int32_t action = AMOTION_EVENT_ACTION_MOVE, nsecs_t eventTime = 0) {
+    PointerProperties properties[MAX_POINTERS];
+    PointerCoords coords[MAX_POINTERS];
+    for (size_t i = 0; i < pointerCount; i++) {
+        properties[i].clear();
+        properties[i].id = i;
+        properties[i].toolType = ToolType::FINGER;
+        coords[i].clear();
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_X, 100 + seq);
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, 200 + i * 10);
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 0.5);
+    }
+    const ui::Transform identityTransform;
+    return publisher.publishMotionEvent(seq, InputEvent::nextId(), /*deviceId=*/1,
+                                        AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT,
+                                        INVALID_HMAC, action,
+                                        /*actionButton=*/0, /*flags=*/0, /*edgeFlags=*/0,
+                                        /*metaState=*/0, /*buttonState=*/0,
+                                        MotionClassification::NONE, identityTransform,
+                                        /*xPrecision=*/0, /*yPrecision=*/0,
+                                        AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                        AMOTION_EVENT_INVALID_CURSOR_POSITION, identityTransform,
+                                        /*downTime=*/0, eventTime, pointerCount,
+                                        properties, coords);
+}
+
+} // namespace
+
+// Baseline: one send() per motion sample.
+static void BM_publishMotionEvent(benchmark::State& state) {
+    const size_t pointerCount = static_cast<size_t>(state.range(0));
+    ChannelPair channels;
+    InputPublisher publisher(channels.server);
+    uint32_t seq = 1;
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < SAMPLES_PER_FRAME; i++) {
+            benchmark::DoNotOptimize(publishSample(publisher, seq++, pointerCount));
+        }
+        state.PauseTiming();
+        channels.drain(SAMPLES_PER_FRAME);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLES_PER_FRAME);
+}
+BENCHMARK(BM_publishMotionEvent)->Arg(1)->Arg(2)->Arg(5)->Arg(MAX_POINTERS);
+
+// All samples of a frame written with a single sendmmsg().
+static void BM_publishMotionEventBatch(benchmark::State& state) {
+    const size_t pointerCount = static_cast<size_t>(state.range(0));
+    ChannelPair channels;
+    InputPublisher publisher(channels.server);
+    uint32_t seq = 1;
+
+    for (auto _ : state) {
+        publisher.beginBatch();
+        for (size_t i = 0; i < SAMPLES_PER_FRAME; i++) {
+            benchmark::DoNotOptimize(publishSample(publisher, seq++, pointerCount));
+        }
+        size_t publishedCount;
+        benchmark::DoNotOptimize(publisher.endBatch(&publishedCount));
+        state.PauseTiming();
+        channels.drain(publishedCount);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLES_PER_FRAME);
+}
+BENCHMARK(BM_publishMotionEventBatch)->Arg(1)->Arg(2)->Arg(5)->Arg(MAX_POINTERS);
+
+// The samples of a 480Hz touchscreen that arrive during a frame are appended to a batch, which is
+// consumed as a single MotionEvent, resampled or not, at the frame time.
+static void BM_consumeBatch(benchmark::State& state) {
+    const size_t pointerCount = static_cast<size_t>(state.range(0));
+    const bool resample = state.range(1) != 0;
+    ChannelPair channels;
+    InputPublisher publisher(channels.server);
+    InputConsumer consumer(channels.client, resample);
+    PreallocatedInputEventFactory factory;
+    uint32_t seq = 1;
+    nsecs_t eventTime = SAMPLE_INTERVAL_480HZ;
+    uint32_t consumedSeq;
+    InputEvent* event;
+
+    auto finish = [&]() {
+        consumer.sendFinishedSignal(consumedSeq, /*handled=*/true);
+        while (publisher.receiveConsumerResponse().ok()) {
+        }
+    };
+
+    // Resampling needs the touch state of the gesture.
+    publishSample(publisher, seq++, pointerCount, AMOTION_EVENT_ACTION_DOWN, eventTime);
+    consumer.consume(&factory, /*consumeBatches=*/true, /*frameTime=*/-1, &consumedSeq, &event);
+    finish();
+
+    size_t allocations = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (size_t i = 0; i < SAMPLES_PER_FRAME; i++) {
+            eventTime += SAMPLE_INTERVAL_480HZ;
+            publishSample(publisher, seq++, pointerCount, AMOTION_EVENT_ACTION_MOVE, eventTime);
+        }
+        // Far enough past the last sample that the whole batch is consumed, and resampling
+        // extrapolates.
+        const nsecs_t frameTime = eventTime + 6'000'000;
+        const size_t allocationsBefore = gAllocations.load(std::memory_order_relaxed);
+        state.ResumeTiming();
+
+        // Like the app, first batch the samples as they arrive, then consume on the frame.
+        consumer.consume(&factory, /*consumeBatches=*/false, /*frameTime=*/-1, &consumedSeq,
+                         &event);
+        benchmark::DoNotOptimize(consumer.consume(&factory, /*consumeBatches=*/true, frameTime,
+                                                  &consumedSeq, &event));
+        benchmark::DoNotOptimize(event);
+
+        state.PauseTiming();
+        allocations += gAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+        finish();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLES_PER_FRAME);
+    state.counters["allocs_per_frame"] =
+            benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_consumeBatch)->ArgsProduct({{1, 2, 10}, {false, true}});
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -726,6 +726,33 @@ TEST(MotionPredictorMetricsManagerTest, NoPredictions) {
     EXPECT_EQ(0u, mockLoggedAtomFields.size());
 }
 
+// Model invoke time test:
+//  • Input: invoke times of 1µs, 2µs, ..., 100µs, then a new stroke.
+//  • Expectation: nearest-rank percentiles of the invoke times, which are reset by the new stroke.
+TEST(MotionPredictorMetricsManagerTest, InvokeTimePercentiles) {
+    MotionPredictorMetricsManager metricsManager(TEST_PREDICTION_INTERVAL_NANOS,
+                                                 TEST_MAX_NUM_PREDICTIONS);
+    EXPECT_FALSE(metricsManager.getInvokeTimePercentiles());
+
+    // Out of order, to make sure that the durations are sorted.
+    for (nsecs_t i = 100; i > 0; --i) {
+        metricsManager.onModelInvoke(i * 1000);
+    }
+    std::optional<MotionPredictorMetricsManager::InvokeTimePercentiles> percentiles =
+            metricsManager.getInvokeTimePercentiles();
+    ASSERT_TRUE(percentiles);
+    EXPECT_EQ(50'000, percentiles->p50);
+    EXPECT_EQ(90'000, percentiles->p90);
+    EXPECT_EQ(99'000, percentiles->p99);
+
+    metricsManager.onRecord(
+            MotionEventBuilder(AMOTION_EVENT_ACTION_DOWN, AINPUT_SOURCE_STYLUS)
+                    .eventTime(TEST_INITIAL_TIMESTAMP)
+                    .pointer(PointerBuilder(/*id=*/0, ToolType::STYLUS).x(10).y(20))
+                    .build());
+    EXPECT_FALSE(metricsManager.getInvokeTimePercentiles());
+}
+
 // Perfect predictions test:
 //  • Input: constant input events, perfect predictions matching the input events.
 //  • Expectation: all error metrics should be zero, or NO_DATA_SENTINEL for "unreported" metrics.
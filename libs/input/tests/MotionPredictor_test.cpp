@@ -15,6 +15,7 @@
  */
 
 #include <chrono>
+#include <thread>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -147,4 +148,30 @@ TEST(MotionPredictorTest, FlagDisablesPrediction) {
     ASSERT_FALSE(predictor.isPredictionAvailable(/*deviceId=*/1, AINPUT_SOURCE_TOUCHSCREEN));
 }
 
+TEST(MotionPredictorTest, AsynchronousInference) {
+    MotionPredictor predictor(/*predictionTimestampOffsetNanos=*/1,
+                              []() { return true /*enable prediction*/; },
+                              MotionPredictor::InferenceMode::ASYNCHRONOUS);
+    // Nothing to predict from yet, and none of this must block on the model.
+    EXPECT_EQ(nullptr, predictor.predict(40 * NSEC_PER_MSEC));
+    predictor.record(getMotionEvent(DOWN, 0, 1, 30ms));
+    predictor.record(getMotionEvent(MOVE, 0, 5, 35ms));
+
+    std::unique_ptr<MotionEvent> predicted;
+    for (int attempt = 0; attempt < 100 && predicted == nullptr; attempt++) {
+        predicted = predictor.predict(40 * NSEC_PER_MSEC);
+        if (predicted == nullptr) {
+            std::this_thread::sleep_for(10ms);
+        }
+    }
+    ASSERT_NE(nullptr, predicted);
+    // Only samples after the latest recorded event are predicted.
+    EXPECT_GT(predicted->getHistoricalEventTime(0), 35 * NSEC_PER_MSEC);
+    EXPECT_GE(predicted->getEventTime(), 41);
+
+    // Results of the previous gesture are dropped once it ends.
+    predictor.record(getMotionEvent(UP, 0, 5, 40ms));
+    EXPECT_EQ(nullptr, predictor.predict(45 * NSEC_PER_MSEC));
+}
+
 } // namespace android
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <input/VelocityTracker.h>
+
+namespace android {
+
+namespace {
+
+// Multi-finger drawing: a full history for every pointer.
+constexpr int32_t POINTER_COUNT = 10;
+constexpr nsecs_t SAMPLE_INTERVAL = 4'000'000; // 240Hz
+constexpr size_t SAMPLE_COUNT = 20;
+
+void addSample(VelocityTracker& tracker, nsecs_t eventTime) {
+    for (int32_t pointerId = 0; pointerId < POINTER_COUNT; pointerId++) {
+        const float t = eventTime * 1E-9f;
+        tracker.addMovement(eventTime, pointerId, AMOTION_EVENT_AXIS_X,
+                            100 * pointerId + 500 * t + 2000 * t * t);
+        tracker.addMovement(eventTime, pointerId, AMOTION_EVENT_AXIS_Y,
+                            200 * pointerId - 300 * t);
+    }
+}
+
+} // namespace
+
+// A new sample for every pointer, then the velocities are computed once, as for every frame of an
+// ongoing gesture.
+static void BM_computeVelocityAfterNewSample(benchmark::State& state) {
+    VelocityTracker tracker(VelocityTracker::Strategy::LSQ2);
+    nsecs_t eventTime = SAMPLE_INTERVAL;
+    for (size_t i = 0; i < SAMPLE_COUNT; i++, eventTime += SAMPLE_INTERVAL) {
+        addSample(tracker, eventTime);
+    }
+
+    for (auto _ : state) {
+        addSample(tracker, eventTime);
+        eventTime += SAMPLE_INTERVAL;
+        benchmark::DoNotOptimize(tracker.getComputedVelocity(/*units=*/1000, /*maxVelocity=*/1E6));
+    }
+}
+BENCHMARK(BM_computeVelocityAfterNewSample);
+
+// The velocities are queried repeatedly without new samples, e.g. by nested scrolling containers
+// that each compute the velocity when the gesture ends.
+static void BM_computeVelocityWithoutNewSample(benchmark::State& state) {
+    VelocityTracker tracker(VelocityTracker::Strategy::LSQ2);
+    nsecs_t eventTime = SAMPLE_INTERVAL;
+    for (size_t i = 0; i < SAMPLE_COUNT; i++, eventTime += SAMPLE_INTERVAL) {
+        addSample(tracker, eventTime);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tracker.getComputedVelocity(/*units=*/1000, /*maxVelocity=*/1E6));
+    }
+}
+BENCHMARK(BM_computeVelocityWithoutNewSample);
+
+} // namespace android
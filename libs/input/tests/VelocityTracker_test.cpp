@@ -1275,6 +1275,38 @@ TEST_F(VelocityTrackerTest, LeastSquaresVelocityTrackerStrategyEstimator_Parabol
     computeAndCheckQuadraticEstimate(motions, std::array<float, 3>({0, 0E3, 1E6}));
 }
 
+/*
+ * The estimator is reused between queries, make sure that every new movement is taken into account,
+ * including one that replaces the sample of the same event time.
+ */
+TEST_F(VelocityTrackerTest, LeastSquaresVelocityTrackerStrategyEstimator_UpdatedByNewMovements) {
+    VelocityTracker vt(VelocityTracker::Strategy::LSQ2);
+    const nsecs_t downTime = 100'000'000;
+    vt.addMovement(downTime, /*pointerId=*/0, AMOTION_EVENT_AXIS_X, 0);
+    vt.addMovement(downTime + 1'000'000, /*pointerId=*/0, AMOTION_EVENT_AXIS_X, 1);
+    vt.addMovement(downTime + 2'000'000, /*pointerId=*/0, AMOTION_EVENT_AXIS_X, 2);
+    checkVelocity(vt.getVelocity(AMOTION_EVENT_AXIS_X, 0), 1000);
+    checkVelocity(vt.getVelocity(AMOTION_EVENT_AXIS_X, 0), 1000);
+
+    // Same event time as the previous movement: the last sample is replaced.
+    vt.addMovement(downTime + 2'000'000, /*pointerId=*/0, AMOTION_EVENT_AXIS_X, 4);
+    std::optional<VelocityTracker::Estimator> estimator =
+            vt.getEstimator(AMOTION_EVENT_AXIS_X, /*pointerId=*/0);
+    ASSERT_TRUE(estimator);
+    checkCoefficient(estimator->coeff[0], 4);
+    checkCoefficient(estimator->coeff[1], 4E3);
+    checkCoefficient(estimator->coeff[2], 1E6);
+
+    vt.addMovement(downTime + 3'000'000, /*pointerId=*/0, AMOTION_EVENT_AXIS_X, 9);
+    estimator = vt.getEstimator(AMOTION_EVENT_AXIS_X, /*pointerId=*/0);
+    ASSERT_TRUE(estimator);
+    EXPECT_EQ(downTime + 3'000'000, estimator->time);
+    checkCoefficient(estimator->coeff[0], 9);
+
+    vt.clearPointer(/*pointerId=*/0);
+    EXPECT_FALSE(vt.getVelocity(AMOTION_EVENT_AXIS_X, 0));
+}
+
 // Recorded by hand on sailfish, but only the diffs are taken to test cumulative axis velocity.
 TEST_F(VelocityTrackerTest, AxisScrollVelocity) {
     std::vector<std::pair<std::chrono::nanoseconds, float>> motions = {
@@ -24,6 +24,13 @@
 #include <exception>
 #include <iomanip>
 #include <stdexcept>
+#include <type_traits>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
 #include <math/quat.h>
 #include <math/TVecHelpers.h>
@@ -60,6 +67,131 @@ namespace details {
  */
 
 
+/*
+ * SIMD kernels for 4x4 float matrices, which SurfaceFlinger and RenderEngine go through for
+ * every layer of every frame. The matrices are densely packed in column-major order, so the
+ * kernels work directly on the columns. The products accumulate in the same order as the generic
+ * code, so they give bit-identical results; only the inverse differs in rounding.
+ *
+ * They are selected at compile time for TMat44<float>, everything else uses the generic code.
+ */
+#if defined(__ARM_NEON) || defined(__SSE__)
+#define MATH_MAT4F_SIMD 1
+
+namespace simd {
+
+template <typename MATRIX>
+inline constexpr bool isMat4f = std::is_same<typename MATRIX::value_type, float>::value &&
+        MATRIX::NUM_COLS == 4 && MATRIX::NUM_ROWS == 4;
+
+#if defined(__ARM_NEON)
+using float4 = float32x4_t;
+inline float4 load(const float* p) { return vld1q_f32(p); }
+inline void store(float* p, float4 v) { vst1q_f32(p, v); }
+inline float4 splat(float v) { return vdupq_n_f32(v); }
+inline float4 add(float4 a, float4 b) { return vaddq_f32(a, b); }
+inline float4 sub(float4 a, float4 b) { return vsubq_f32(a, b); }
+// vmlaq_f32 is not fused, but keep the multiply and the add separate to match the generic code.
+inline float4 mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+// {v.y, v.z, v.x, v.w} and {v.z, v.x, v.y, v.w}
+inline float4 yzxw(float4 v) { return __builtin_shufflevector(v, v, 1, 2, 0, 3); }
+inline float4 zxyw(float4 v) { return __builtin_shufflevector(v, v, 2, 0, 1, 3); }
+
+inline void transpose4(float* res, const float* m) {
+    // De-interleaving the 16 floats gives the rows.
+    const float32x4x4_t rows = vld4q_f32(m);
+    vst1q_f32(res, rows.val[0]);
+    vst1q_f32(res + 4, rows.val[1]);
+    vst1q_f32(res + 8, rows.val[2]);
+    vst1q_f32(res + 12, rows.val[3]);
+}
+#else
+using float4 = __m128;
+inline float4 load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, float4 v) { _mm_storeu_ps(p, v); }
+inline float4 splat(float v) { return _mm_set1_ps(v); }
+inline float4 add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+inline float4 sub(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+inline float4 mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+inline float4 yzxw(float4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1)); }
+inline float4 zxyw(float4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 0, 2)); }
+
+inline void transpose4(float* res, const float* m) {
+    float4 c0 = load(m);
+    float4 c1 = load(m + 4);
+    float4 c2 = load(m + 8);
+    float4 c3 = load(m + 12);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    store(res, c0);
+    store(res + 4, c1);
+    store(res + 8, c2);
+    store(res + 12, c3);
+}
+#endif
+
+// lhs * rhs, where lhs holds the 4 columns of a matrix.
+inline float4 mulColumn(const float4 lhs[4], const float* rhs) {
+    // Like TMat44 * TVec4, start from zero so that -0 products round the same way.
+    float4 res = add(splat(0.0f), mul(lhs[0], splat(rhs[0])));
+    res = add(res, mul(lhs[1], splat(rhs[1])));
+    res = add(res, mul(lhs[2], splat(rhs[2])));
+    return add(res, mul(lhs[3], splat(rhs[3])));
+}
+
+// res = lhs * rhs, where rhs has C columns of 4.
+template <size_t C>
+inline void mul4x(float* res, const float* lhs, const float* rhs) {
+    const float4 l[4] = {load(lhs), load(lhs + 4), load(lhs + 8), load(lhs + 12)};
+    for (size_t i = 0; i < C; i++) {
+        store(res + i * 4, mulColumn(l, rhs + i * 4));
+    }
+}
+
+inline float4 cross3(float4 a, float4 b) {
+    return sub(mul(yzxw(a), zxyw(b)), mul(zxyw(a), yzxw(b)));
+}
+
+inline float dot3(float4 a, float4 b) {
+    float p[4];
+    store(p, mul(a, b));
+    return p[0] + p[1] + p[2];
+}
+
+// res = inverse(m). Uses the 3D vector form of the cofactor expansion from Lengyel,
+// "Foundations of Game Engine Development, Volume 1", which maps well onto 4-wide registers.
+inline void inverse4(float* res, const float* m) {
+    // The columns, whose 4th components are x, y, z and w.
+    const float4 a = load(m);
+    const float4 b = load(m + 4);
+    const float4 c = load(m + 8);
+    const float4 d = load(m + 12);
+    const float x = m[3], y = m[7], z = m[11], w = m[15];
+
+    float4 s = cross3(a, b);
+    float4 t = cross3(c, d);
+    float4 u = sub(mul(a, splat(y)), mul(b, splat(x)));
+    float4 v = sub(mul(c, splat(w)), mul(d, splat(z)));
+    const float4 invDet = splat(1.0f / (dot3(s, v) + dot3(t, u)));
+    s = mul(s, invDet);
+    t = mul(t, invDet);
+    u = mul(u, invDet);
+    v = mul(v, invDet);
+
+    float rows[16];
+    store(rows, add(cross3(b, v), mul(t, splat(y))));
+    store(rows + 4, sub(cross3(v, a), mul(t, splat(x))));
+    store(rows + 8, add(cross3(d, u), mul(s, splat(w))));
+    store(rows + 12, sub(cross3(u, c), mul(s, splat(z))));
+    rows[3] = -dot3(b, t);
+    rows[7] = dot3(a, t);
+    rows[11] = -dot3(d, s);
+    rows[15] = dot3(c, s);
+    transpose4(res, rows);
+}
+
+}  // namespace simd
+#endif  // defined(__ARM_NEON) || defined(__SSE__)
+
 /*
  * Matrix utilities
  */
@@ -233,6 +365,15 @@ CONSTEXPR MATRIX PURE fastInverse3(const MATRIX& x) {
 template <typename MATRIX>
 inline constexpr MATRIX PURE inverse(const MATRIX& matrix) {
     static_assert(MATRIX::NUM_ROWS == MATRIX::NUM_COLS, "only square matrices can be inverted");
+#ifdef MATH_MAT4F_SIMD
+    if constexpr (simd::isMat4f<MATRIX>) {
+        if (!__builtin_is_constant_evaluated()) {
+            MATRIX inverted(MATRIX::NO_INIT);
+            simd::inverse4(&inverted[0][0], &matrix[0][0]);
+            return inverted;
+        }
+    }
+#endif
     return (MATRIX::NUM_ROWS == 2) ? fastInverse2<MATRIX>(matrix) :
           ((MATRIX::NUM_ROWS == 3) ? fastInverse3<MATRIX>(matrix) :
                     gaussJordanInverse<MATRIX>(matrix));
@@ -253,6 +394,14 @@ CONSTEXPR MATRIX_R PURE multiply(const MATRIX_A& lhs, const MATRIX_B& rhs) {
             "invalid dimension of matrix multiply result.");
 
     MATRIX_R res(MATRIX_R::NO_INIT);
+#ifdef MATH_MAT4F_SIMD
+    if constexpr (simd::isMat4f<MATRIX_R> && simd::isMat4f<MATRIX_A> && simd::isMat4f<MATRIX_B>) {
+        if (!__builtin_is_constant_evaluated()) {
+            simd::mul4x<4>(&res[0][0], &lhs[0][0], &rhs[0][0]);
+            return res;
+        }
+    }
+#endif
     for (size_t col = 0; col < MATRIX_R::NUM_COLS; ++col) {
         res[col] = lhs * rhs[col];
     }
@@ -265,6 +414,14 @@ CONSTEXPR MATRIX PURE transpose(const MATRIX& m) {
     // for now we only handle square matrix transpose
     static_assert(MATRIX::NUM_COLS == MATRIX::NUM_ROWS, "transpose only supports square matrices");
     MATRIX result(MATRIX::NO_INIT);
+#ifdef MATH_MAT4F_SIMD
+    if constexpr (simd::isMat4f<MATRIX>) {
+        if (!__builtin_is_constant_evaluated()) {
+            simd::transpose4(&result[0][0], &m[0][0]);
+            return result;
+        }
+    }
+#endif
     for (size_t col = 0; col < MATRIX::NUM_COLS; ++col) {
         for (size_t row = 0; row < MATRIX::NUM_ROWS; ++row) {
             result[col][row] = transpose(m[row][col]);
@@ -524,6 +524,14 @@ template <typename T, typename U>
 CONSTEXPR typename TMat44<T>::col_type PURE operator *(const TMat44<T>& lhs, const TVec4<U>& rhs) {
     // Result is initialized to zero.
     typename TMat44<T>::col_type result;
+#ifdef MATH_MAT4F_SIMD
+    if constexpr (std::is_same<T, float>::value && std::is_same<U, float>::value) {
+        if (!__builtin_is_constant_evaluated()) {
+            simd::mul4x<1>(&result[0], &lhs[0][0], &rhs[0]);
+            return result;
+        }
+    }
+#endif
     for (size_t col = 0; col < TMat44<T>::NUM_COLS; ++col) {
         result += lhs[col] * rhs[col];
     }
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <math/mat4.h>
+
+namespace android {
+namespace {
+
+// A color matrix-like transform, the kind SurfaceFlinger composes for each layer.
+const mat4 kLhs(vec4(0.8f, 0.1f, 0.05f, 0), vec4(0.15f, 0.85f, 0.05f, 0),
+                vec4(0.05f, 0.05f, 0.9f, 0), vec4(0.01f, 0.02f, 0.03f, 1));
+const mat4 kRhs(vec4(1, 0, 0, 0), vec4(0, 0.5f, 0.2f, 0), vec4(0, -0.2f, 0.5f, 0),
+                vec4(12, -7, 3, 1));
+
+void BM_Mat4Multiply(benchmark::State& state) {
+    mat4 lhs = kLhs;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs);
+        mat4 result = lhs * kRhs;
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_Mat4Multiply);
+
+void BM_Mat4MultiplyVec4(benchmark::State& state) {
+    vec4 v(0.25f, 0.5f, 0.75f, 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(v);
+        vec4 result = kLhs * v;
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_Mat4MultiplyVec4);
+
+void BM_Mat4Inverse(benchmark::State& state) {
+    mat4 m = kLhs * kRhs;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m);
+        mat4 result = inverse(m);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_Mat4Inverse);
+
+void BM_Mat4Transpose(benchmark::State& state) {
+    mat4 m = kLhs;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m);
+        mat4 result = transpose(m);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_Mat4Transpose);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -17,6 +17,7 @@
 #define LOG_TAG "MatTest"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <limits>
 #include <random>
@@ -150,6 +151,75 @@ TEST_F(MatTest, MiscOps) {
     }
 }
 
+// The float products may use SIMD kernels. They must give exactly the same results as computing
+// each element in order, like the generic code does.
+TEST_F(MatTest, FloatProductsAreExact) {
+    std::default_random_engine generator(171);
+    std::uniform_real_distribution<float> distribution(-100.0, 100.0);
+    for (size_t i = 0; i < 100; ++i) {
+        mat4 lhs;
+        mat4 rhs;
+        vec4 v;
+        for (size_t c = 0; c < 4; ++c) {
+            v[c] = distribution(generator);
+            for (size_t r = 0; r < 4; ++r) {
+                lhs[c][r] = distribution(generator);
+                rhs[c][r] = distribution(generator);
+            }
+        }
+        // Products of -0 must round the same way too.
+        lhs[1][2] = -0.0f;
+        v[3] = -0.0f;
+
+        const mat4 product = lhs * rhs;
+        const vec4 vectorProduct = lhs * v;
+        const mat4 transposed = transpose(lhs);
+        for (size_t c = 0; c < 4; ++c) {
+            for (size_t r = 0; r < 4; ++r) {
+                float expected = 0;
+                for (size_t k = 0; k < 4; ++k) {
+                    expected += lhs[k][r] * rhs[c][k];
+                }
+                EXPECT_EQ(0, memcmp(&expected, &product[c][r], sizeof(float)));
+                EXPECT_EQ(lhs[r][c], transposed[c][r]);
+            }
+            float expected = 0;
+            for (size_t k = 0; k < 4; ++k) {
+                expected += lhs[k][c] * v[k];
+            }
+            EXPECT_EQ(0, memcmp(&expected, &vectorProduct[c], sizeof(float)));
+        }
+    }
+}
+
+// The float inverse may use a SIMD kernel, which rounds differently than the generic code, but
+// must stay as close to the exact inverse.
+TEST_F(MatTest, FloatInverseMatchesDouble) {
+    std::default_random_engine generator(172);
+    std::uniform_real_distribution<float> distribution(-10.0, 10.0);
+    for (size_t i = 0; i < 100; ++i) {
+        mat4 m;
+        mat4d md;
+        for (size_t c = 0; c < 4; ++c) {
+            for (size_t r = 0; r < 4; ++r) {
+                m[c][r] = distribution(generator);
+                md[c][r] = m[c][r];
+            }
+        }
+        // Keep the matrix well conditioned.
+        m += mat4(40);
+        md += mat4d(40);
+
+        const mat4 inverted = inverse(m);
+        const mat4d expected = inverse(md);
+        for (size_t c = 0; c < 4; ++c) {
+            for (size_t r = 0; r < 4; ++r) {
+                EXPECT_NEAR(expected[c][r], inverted[c][r], 1e-6);
+            }
+        }
+    }
+}
+
 TEST_F(MatTest, ElementAccess) {
     mat4 m(vec4(1, 2, 3, 4), vec4(5, 6, 7, 8), vec4(9, 10, 11, 12), vec4(13, 14, 15, 16));
     for (size_t c=0 ; c<4 ; c++) {
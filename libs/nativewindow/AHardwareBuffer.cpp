@@ -475,6 +475,18 @@ int AHardwareBuffer_createFromHandle(const AHardwareBuffer_Desc* desc,
     return NO_ERROR;
 }
 
+int AHardwareBuffer_setPersistentMapping(AHardwareBuffer* buffer, bool enabled) {
+    if (!buffer) return BAD_VALUE;
+    GraphicBuffer* gbuffer = AHardwareBuffer_to_GraphicBuffer(buffer);
+    const uint32_t format =
+            AHardwareBuffer_convertFromPixelFormat(uint32_t(gbuffer->getPixelFormat()));
+    if (enabled && AHardwareBuffer_formatIsYuv(format)) {
+        ALOGE("Persistent mappings are not supported for YUV formats");
+        return INVALID_OPERATION;
+    }
+    return gbuffer->setPersistentCpuMapping(enabled);
+}
+
 // ----------------------------------------------------------------------------
 // Helpers implementation
 // ----------------------------------------------------------------------------
@@ -257,6 +257,8 @@ enum {
     NATIVE_WINDOW_SET_QUERY_INTERCEPTOR           = 47,    /* private */
     NATIVE_WINDOW_SET_FRAME_TIMELINE_INFO         = 48,    /* private */
     NATIVE_WINDOW_GET_LAST_QUEUED_BUFFER2         = 49,    /* private */
+    NATIVE_WINDOW_SET_DEQUEUE_AHEAD               = 50,    /* private */
+    NATIVE_WINDOW_GET_LAST_DEQUEUE_AHEAD_DURATION = 51,    /* private */
     // clang-format on
 };
 
@@ -1095,6 +1097,27 @@ static inline int native_window_set_frame_timeline_info(
     return window->perform(window, NATIVE_WINDOW_SET_FRAME_TIMELINE_INFO, frameTimelineInfo);
 }
 
+/*
+ * native_window_set_dequeue_ahead(..., dequeueAhead)
+ * Enable/disable dequeueing the next buffer on a helper thread as soon as a
+ * buffer is queued, so that the following dequeueBuffer call returns without
+ * waiting for the consumer to release a buffer.
+ */
+static inline int native_window_set_dequeue_ahead(struct ANativeWindow* window,
+                                                  bool dequeueAhead) {
+    return window->perform(window, NATIVE_WINDOW_SET_DEQUEUE_AHEAD, dequeueAhead);
+}
+
+/*
+ * native_window_get_last_dequeue_ahead_duration(..., outDuration)
+ * Returns in nanoseconds how long dequeueing the last dequeued buffer took on
+ * the helper thread, or 0 if it was not dequeued ahead.
+ */
+static inline int native_window_get_last_dequeue_ahead_duration(struct ANativeWindow* window,
+                                                                int64_t* outDuration) {
+    return window->perform(window, NATIVE_WINDOW_GET_LAST_DEQUEUE_AHEAD_DURATION, outDuration);
+}
+
 // ------------------------------------------------------------------------------------------------
 // Candidates for APEX visibility
 // These functions are planned to be made stable for APEX modules, but have not
@@ -59,6 +59,25 @@ int AHardwareBuffer_createFromHandle(const AHardwareBuffer_Desc* _Nonnull desc,
                                      const native_handle_t* _Nonnull handle, int32_t method,
                                      AHardwareBuffer* _Nullable* _Nonnull outBuffer);
 
+/**
+ * Keeps the buffer mapped for CPU access between locks, for buffers that the CPU reads or writes
+ * on every frame.
+ *
+ * While enabled, AHardwareBuffer_lock() only waits for the fence and makes the contents coherent
+ * for the CPU, and AHardwareBuffer_unlock() only makes the CPU writes visible to other devices,
+ * instead of mapping and unmapping the buffer every time. The address returned by every lock is
+ * the same. Locks may only request the CPU usage that the buffer was allocated with.
+ *
+ * The buffer must have been allocated with CPU usage, with a single layer and a format that is not
+ * YUV, and must not be locked when this is called. Disabling it, or releasing the last reference to
+ * the buffer, unmaps the buffer.
+ *
+ * \return 0 on success, -EINVAL if \a buffer is NULL or the buffer has no CPU usage, or
+ * -ENOSYS if the buffer cannot stay mapped, e.g. if its format is YUV or the allocator does not
+ * allow maintaining the CPU caches of a mapped buffer.
+ */
+int AHardwareBuffer_setPersistentMapping(AHardwareBuffer* _Nonnull buffer, bool enabled);
+
 /**
  * Buffer pixel formats.
  */
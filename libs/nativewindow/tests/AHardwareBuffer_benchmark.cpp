@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <vndk/hardware_buffer.h>
+
+#include <string.h>
+
+// Usage: atest AHardwareBuffer_benchmark
+
+namespace android {
+namespace {
+
+AHardwareBuffer* allocate(int64_t size) {
+    const AHardwareBuffer_Desc desc = {
+            .width = static_cast<uint32_t>(size),
+            .height = static_cast<uint32_t>(size),
+            .layers = 1,
+            .format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM,
+            .usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN,
+    };
+    AHardwareBuffer* buffer = nullptr;
+    if (AHardwareBuffer_allocate(&desc, &buffer) != 0) {
+        return nullptr;
+    }
+    return buffer;
+}
+
+// Locks the buffer, writes its first row and unlocks it, like a software renderer updating a
+// buffer on every frame.
+void lockAndWrite(benchmark::State& state, bool persistent) {
+    AHardwareBuffer* buffer = allocate(state.range(0));
+    if (!buffer) {
+        state.SkipWithError("Could not allocate the buffer");
+        return;
+    }
+    if (persistent && AHardwareBuffer_setPersistentMapping(buffer, true) != 0) {
+        AHardwareBuffer_release(buffer);
+        state.SkipWithError("Persistent mappings are not supported");
+        return;
+    }
+
+    const size_t rowSize = static_cast<size_t>(state.range(0)) * 4;
+    for (auto _ : state) {
+        void* address = nullptr;
+        if (AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr,
+                                 &address) != 0) {
+            state.SkipWithError("Could not lock the buffer");
+            break;
+        }
+        memset(address, 0xff, rowSize);
+        benchmark::ClobberMemory();
+        AHardwareBuffer_unlock(buffer, nullptr);
+    }
+
+    AHardwareBuffer_release(buffer);
+}
+
+void BM_LockUnlock(benchmark::State& state) {
+    lockAndWrite(state, false);
+}
+BENCHMARK(BM_LockUnlock)->Arg(64)->Arg(512)->Arg(2048);
+
+void BM_LockUnlockPersistent(benchmark::State& state) {
+    lockAndWrite(state, true);
+}
+BENCHMARK(BM_LockUnlockPersistent)->Arg(64)->Arg(512)->Arg(2048);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -14,12 +14,18 @@
  * limitations under the License.
  */
 
+#include <array>
+#include <atomic>
+#include <map>
 #include <mutex>
+#include <set>
+#include <tuple>
 #include <binder/AppOpsManager.h>
 #include <binder/Binder.h>
 #include <binder/IServiceManager.h>
 
 #include <utils/SystemClock.h>
+#include <utils/Timers.h>
 
 #include <sys/types.h>
 #include <private/android_filesystem_config.h>
@@ -43,6 +49,143 @@ static const sp<IBinder>& getClientId() {
     return gClientId;
 }
 
+namespace {
+
+// Bounds how long a decision is served after a change that was not delivered.
+constexpr nsecs_t kDecisionTimeout = s2ns(5);
+constexpr size_t kDecisionShardCount = 8;
+
+enum class DecisionCall { CHECK, NOTE };
+
+struct DecisionKey {
+    int32_t uid;
+    int32_t op;
+    DecisionCall call;
+    String16 packageName;
+    std::optional<String16> attributionTag;
+
+    bool operator<(const DecisionKey& other) const {
+        return std::tie(uid, op, call, packageName, attributionTag) <
+                std::tie(other.uid, other.op, other.call, other.packageName,
+                         other.attributionTag);
+    }
+};
+
+// Caches the modes returned by the app ops service, sharded by uid. Ops are watched per package
+// the first time a decision for them is cached, and opChanged() drops the decisions of the
+// package, like the ones cached before the service died.
+class DecisionCache : public BnAppOpsCallback, public IBinder::DeathRecipient {
+public:
+    // Returns the generation to pass to put(), which is taken before asking the service, so that
+    // a change reported while the service is asked is not overwritten by the stale decision.
+    uint64_t watch(int32_t op, const String16& packageName, const sp<IAppOpsService>& service) {
+        const uint64_t generation = mGeneration.load(std::memory_order_acquire);
+        std::lock_guard<std::mutex> lock(mWatchLock);
+        const sp<IBinder> binder = IInterface::asBinder(service);
+        if (mService.promote() != binder) {
+            mWatched.clear();
+            mService = binder;
+            binder->linkToDeath(sp<DecisionCache>::fromExisting(this));
+        }
+        if (mWatched.emplace(op, packageName).second) {
+            service->startWatchingModeWithFlags(op, packageName,
+                    AppOpsManager::WATCH_FOREGROUND_CHANGES,
+                    sp<DecisionCache>::fromExisting(this));
+        }
+        return generation;
+    }
+
+    std::optional<int32_t> get(const DecisionKey& key) {
+        Shard& shard = getShard(key.uid);
+        std::lock_guard<std::mutex> lock(shard.lock);
+        const auto it = shard.decisions.find(key);
+        if (it != shard.decisions.end() && systemTime() - it->second.time < kDecisionTimeout) {
+            mHits.fetch_add(1, std::memory_order_relaxed);
+            return it->second.mode;
+        }
+        mMisses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    void put(const DecisionKey& key, int32_t mode, uint64_t generation) {
+        Shard& shard = getShard(key.uid);
+        std::lock_guard<std::mutex> lock(shard.lock);
+        if (mGeneration.load(std::memory_order_acquire) != generation) {
+            return;
+        }
+        shard.decisions[key] = {mode, systemTime()};
+    }
+
+    AppOpsManager::CacheStats getStats() const {
+        return {mHits.load(std::memory_order_relaxed), mMisses.load(std::memory_order_relaxed),
+                mInvalidations.load(std::memory_order_relaxed)};
+    }
+
+    void opChanged(int32_t /*op*/, const String16& packageName) override {
+        // The op reported may be the switch op of the one watched, so drop every op of the
+        // package.
+        invalidate([&](const DecisionKey& key) { return key.packageName == packageName; });
+    }
+
+    void binderDied(const wp<IBinder>& /*who*/) override {
+        {
+            std::lock_guard<std::mutex> lock(mWatchLock);
+            mWatched.clear();
+            mService.clear();
+        }
+        invalidate([](const DecisionKey&) { return true; });
+    }
+
+private:
+    struct Decision {
+        int32_t mode;
+        nsecs_t time;
+    };
+
+    struct Shard {
+        std::mutex lock;
+        std::map<DecisionKey, Decision> decisions;
+    };
+
+    Shard& getShard(int32_t uid) {
+        return mShards[static_cast<uint32_t>(uid) % kDecisionShardCount];
+    }
+
+    template <typename Predicate>
+    void invalidate(Predicate predicate) {
+        mGeneration.fetch_add(1, std::memory_order_acq_rel);
+        for (Shard& shard : mShards) {
+            std::lock_guard<std::mutex> lock(shard.lock);
+            for (auto it = shard.decisions.begin(); it != shard.decisions.end();) {
+                if (predicate(it->first)) {
+                    it = shard.decisions.erase(it);
+                    mInvalidations.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    std::array<Shard, kDecisionShardCount> mShards;
+    std::atomic<uint64_t> mGeneration{0};
+
+    std::mutex mWatchLock;
+    wp<IBinder> mService;
+    std::set<std::pair<int32_t, String16>> mWatched;
+
+    std::atomic<uint64_t> mHits{0};
+    std::atomic<uint64_t> mMisses{0};
+    std::atomic<uint64_t> mInvalidations{0};
+};
+
+DecisionCache& getDecisionCache() {
+    static const sp<DecisionCache> sCache = sp<DecisionCache>::make();
+    return *sCache;
+}
+
+} // namespace
+
 AppOpsManager::AppOpsManager()
 {
 }
@@ -83,6 +226,24 @@ int32_t AppOpsManager::checkOp(int32_t op, int32_t uid, const String16& callingP
             : AppOpsManager::MODE_IGNORED;
 }
 
+int32_t AppOpsManager::checkOpCached(int32_t op, int32_t uid, const String16& callingPackage)
+{
+    DecisionCache& cache = getDecisionCache();
+    const DecisionKey key{uid, op, DecisionCall::CHECK, callingPackage, std::nullopt};
+    if (const auto mode = cache.get(key)) {
+        return *mode;
+    }
+
+    sp<IAppOpsService> service = getService();
+    if (service == nullptr) {
+        return AppOpsManager::MODE_IGNORED;
+    }
+    const uint64_t generation = cache.watch(op, callingPackage, service);
+    const int32_t mode = service->checkOperation(op, uid, callingPackage);
+    cache.put(key, mode, generation);
+    return mode;
+}
+
 int32_t AppOpsManager::checkAudioOpNoThrow(int32_t op, int32_t usage, int32_t uid,
         const String16& callingPackage) {
     sp<IAppOpsService> service = getService();
@@ -107,6 +268,27 @@ int32_t AppOpsManager::noteOp(int32_t op, int32_t uid, const String16& callingPa
     return mode;
 }
 
+int32_t AppOpsManager::noteOpCached(int32_t op, int32_t uid, const String16& callingPackage,
+        const std::optional<String16>& attributionTag, const String16& message) {
+    DecisionCache& cache = getDecisionCache();
+    const DecisionKey key{uid, op, DecisionCall::NOTE, callingPackage, attributionTag};
+    if (const auto mode = cache.get(key)) {
+        return *mode;
+    }
+
+    sp<IAppOpsService> service = getService();
+    if (service == nullptr) {
+        return AppOpsManager::MODE_IGNORED;
+    }
+    const uint64_t generation = cache.watch(op, callingPackage, service);
+    const int32_t mode = service->noteOperation(op, uid, callingPackage, attributionTag,
+            shouldCollectNotes(op), message, uid == AID_SYSTEM);
+    if (mode == AppOpsManager::MODE_ALLOWED) {
+        cache.put(key, mode, generation);
+    }
+    return mode;
+}
+
 int32_t AppOpsManager::startOpNoThrow(int32_t op, int32_t uid, const String16& callingPackage,
         bool startIfModeDefault) {
     return startOpNoThrow(op, uid, callingPackage, startIfModeDefault, {},
@@ -176,6 +358,10 @@ void AppOpsManager::setCameraAudioRestriction(int32_t mode) {
     }
 }
 
+AppOpsManager::CacheStats AppOpsManager::getCacheStats() {
+    return getDecisionCache().getStats();
+}
+
 // check it the appops needs to be collected and cache result
 bool AppOpsManager::shouldCollectNotes(int32_t opcode) {
     // Whether an appop should be collected: 0 == not initialized, 1 == don't note, 2 == note
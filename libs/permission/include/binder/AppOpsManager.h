@@ -155,9 +155,20 @@ public:
         WATCH_FOREGROUND_CHANGES = 1 << 0
     };
 
+    struct CacheStats {
+        uint64_t hits;
+        uint64_t misses;
+        // decisions dropped because the op changed for their package
+        uint64_t invalidations;
+    };
+
     AppOpsManager();
 
     int32_t checkOp(int32_t op, int32_t uid, const String16& callingPackage);
+    // Like checkOp, but serves the decision from a process-wide cache. The cache watches the op
+    // for the package to drop the decision when it changes, and decisions expire after a few
+    // seconds in case a change is missed.
+    int32_t checkOpCached(int32_t op, int32_t uid, const String16& callingPackage);
     int32_t checkAudioOpNoThrow(int32_t op, int32_t usage, int32_t uid,
             const String16& callingPackage);
     // @Deprecated, use noteOp(int32_t, int32_t uid, const String16&, const String16&,
@@ -165,6 +176,10 @@ public:
     int32_t noteOp(int32_t op, int32_t uid, const String16& callingPackage);
     int32_t noteOp(int32_t op, int32_t uid, const String16& callingPackage,
             const std::optional<String16>& attributionTag, const String16& message);
+    // Like noteOp, but only notes an allowed op again once its cached decision expired, so the
+    // access is recorded at that granularity. Rejected ops are always noted.
+    int32_t noteOpCached(int32_t op, int32_t uid, const String16& callingPackage,
+            const std::optional<String16>& attributionTag, const String16& message);
     // @Deprecated, use startOpNoThrow(int32_t, int32_t, const String16&, bool, const String16&,
     //              const String16&) instead
     int32_t startOpNoThrow(int32_t op, int32_t uid, const String16& callingPackage,
@@ -184,6 +199,8 @@ public:
     int32_t permissionToOpCode(const String16& permission);
     void setCameraAudioRestriction(int32_t mode);
 
+    static CacheStats getCacheStats();
+
 private:
     Mutex mLock;
     sp<IAppOpsService> mService;
@@ -23,6 +23,7 @@
 #include <renderengine/LayerSettings.h>
 #include <renderengine/RenderEngine.h>
 #include <renderengine/impl/ExternalTexture.h>
+#include <utils/Timers.h>
 
 #include <mutex>
 
@@ -73,6 +74,14 @@ static void RunSkiaGLThreaded(benchmark::internal::Benchmark* b) {
     AddRenderEngineType(b, RenderEngine::RenderEngineType::SKIA_GL_THREADED);
 }
 
+/**
+ * Run a benchmark once using SKIA_GL_THREADED and once using SKIA_VK_THREADED.
+ */
+static void RunSkiaGLAndVkThreaded(benchmark::internal::Benchmark* b) {
+    AddRenderEngineType(b, RenderEngine::RenderEngineType::SKIA_GL_THREADED);
+    AddRenderEngineType(b, RenderEngine::RenderEngineType::SKIA_VK_THREADED);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //  Helpers for calling drawLayers
 ///////////////////////////////////////////////////////////////////////////////
@@ -189,10 +198,13 @@ static std::shared_ptr<ExternalTexture> copyBuffer(RenderEngine& re,
  * drawLayers, and saving (if --save is used).
  *
  * This times both the CPU and GPU work initiated by drawLayers. All work done
- * outside of the for loop is excluded from the timing measurements.
+ * outside of the for loop is excluded from the timing measurements. The time
+ * until drawLayers returns its fence is reported as the cpu_submit_ms counter,
+ * and the time from then until the fence signals as gpu_ms.
  */
 static void benchDrawLayers(RenderEngine& re, const std::vector<LayerSettings>& layers,
-                            benchmark::State& benchState, const char* saveFileName) {
+                            benchmark::State& benchState, const char* saveFileName,
+                            ui::Dataspace outputDataspace = ui::Dataspace::UNKNOWN) {
     auto [width, height] = getDisplaySize();
     auto outputBuffer = allocateBuffer(re, width, height);
 
@@ -201,16 +213,32 @@ static void benchDrawLayers(RenderEngine& re, const std::vector<LayerSettings>&
             .physicalDisplay = displayRect,
             .clip = displayRect,
             .maxLuminance = 500,
+            .outputDataspace = outputDataspace,
     };
 
+    nsecs_t submitTime = 0;
+    nsecs_t gpuTime = 0;
     // This loop starts and stops the timer.
     for (auto _ : benchState) {
+        const nsecs_t start = systemTime();
         sp<Fence> waitFence = re.drawLayers(display, layers, outputBuffer, kUseFrameBufferCache,
                                             base::unique_fd())
                                       .get()
                                       .value();
+        const nsecs_t submitted = systemTime();
         waitFence->waitForever(LOG_TAG);
+
+        submitTime += submitted - start;
+        if (const nsecs_t signalTime = waitFence->getSignalTime(); signalTime > submitted) {
+            gpuTime += signalTime - submitted;
+        }
     }
+    benchState.counters["cpu_submit_ms"] =
+            benchmark::Counter(static_cast<double>(submitTime) / 1e6,
+                               benchmark::Counter::kAvgIterations);
+    benchState.counters["gpu_ms"] =
+            benchmark::Counter(static_cast<double>(gpuTime) / 1e6,
+                               benchmark::Counter::kAvgIterations);
 
     if (renderenginebench::save() && saveFileName) {
         // Copy to a CPU-accessible buffer so we can encode it.
@@ -228,21 +256,44 @@ static void benchDrawLayers(RenderEngine& re, const std::vector<LayerSettings>&
 //  Benchmarks
 ///////////////////////////////////////////////////////////////////////////////
 
-void BM_blur(benchmark::State& benchState) {
-    auto re = createRenderEngine(static_cast<RenderEngine::RenderEngineType>(benchState.range()));
-
+/**
+ * Decode the homescreen resource into a display sized, GPU-only buffer.
+ */
+static std::shared_ptr<ExternalTexture> loadHomescreen(RenderEngine& re) {
     // Initially use cpu access so we can decode into it with AImageDecoder.
     auto [width, height] = getDisplaySize();
     auto srcBuffer =
-            allocateBuffer(*re, width, height, GRALLOC_USAGE_SW_WRITE_OFTEN, "decoded_source");
-    {
-        std::string srcImage = base::GetExecutableDirectory();
-        srcImage.append("/resources/homescreen.png");
-        renderenginebench::decode(srcImage.c_str(), srcBuffer->getBuffer());
-
-        // Now copy into GPU-only buffer for more realistic timing.
-        srcBuffer = copyBuffer(*re, srcBuffer, 0, "source");
-    }
+            allocateBuffer(re, width, height, GRALLOC_USAGE_SW_WRITE_OFTEN, "decoded_source");
+    std::string srcImage = base::GetExecutableDirectory();
+    srcImage.append("/resources/homescreen.png");
+    renderenginebench::decode(srcImage.c_str(), srcBuffer->getBuffer());
+
+    // Now copy into GPU-only buffer for more realistic timing.
+    return copyBuffer(re, srcBuffer, 0, "source");
+}
+
+static LayerSettings imageLayer(const std::shared_ptr<ExternalTexture>& buffer,
+                                const FloatRect& rect) {
+    return LayerSettings{
+            .geometry =
+                    Geometry{
+                            .boundaries = rect,
+                    },
+            .source =
+                    PixelSource{
+                            .buffer =
+                                    Buffer{
+                                            .buffer = buffer,
+                                    },
+                    },
+            .alpha = half(1.0f),
+    };
+}
+
+static void benchBlur(benchmark::State& benchState, sp<Fence> srcFence, const char* saveFileName) {
+    auto re = createRenderEngine(static_cast<RenderEngine::RenderEngineType>(benchState.range()));
+    auto [width, height] = getDisplaySize();
+    auto srcBuffer = loadHomescreen(*re);
 
     const FloatRect layerRect(0, 0, width, height);
     LayerSettings layer{
@@ -255,6 +306,7 @@ void BM_blur(benchmark::State& benchState) {
                             .buffer =
                                     Buffer{
                                             .buffer = srcBuffer,
+                                            .fence = std::move(srcFence),
                                     },
                     },
             .alpha = half(1.0f),
@@ -270,7 +322,141 @@ void BM_blur(benchmark::State& benchState) {
     };
 
     auto layers = std::vector<LayerSettings>{layer, blurLayer};
-    benchDrawLayers(*re, layers, benchState, "blurred");
+    benchDrawLayers(*re, layers, benchState, saveFileName);
+}
+
+void BM_blur(benchmark::State& benchState) {
+    // Without an acquire fence the content of the source buffer is never assumed to be unchanged,
+    // so it is blurred again in every iteration.
+    benchBlur(benchState, nullptr, "blurred");
+}
+
+void BM_blurUnchangedContent(benchmark::State& benchState) {
+    // The same acquire fence in every iteration, like a static wallpaper behind a blur, lets
+    // RenderEngine reuse the blur of the first iteration.
+    benchBlur(benchState, sp<Fence>::make(), "blurred_unchanged");
 }
 
 BENCHMARK(BM_blur)->Apply(RunSkiaGLThreaded);
+BENCHMARK(BM_blurUnchangedContent)->Apply(RunSkiaGLThreaded);
+
+///////////////////////////////////////////////////////////////////////////////
+//  Client composition scenarios
+//
+//  Layer stacks modeled on the client compositions that are the most
+//  expensive in practice. They run against both the GL and Vulkan backends.
+///////////////////////////////////////////////////////////////////////////////
+
+// The notification shade over an app over the wallpaper: every layer blurs the ones below it, and
+// the shade uses blur regions with rounded corners for its notifications.
+void BM_scenarioBlurStack(benchmark::State& benchState) {
+    auto re = createRenderEngine(static_cast<RenderEngine::RenderEngineType>(benchState.range()));
+    auto [width, height] = getDisplaySize();
+    auto srcBuffer = loadHomescreen(*re);
+
+    const FloatRect displayRect(0, 0, width, height);
+    const FloatRect appRect(0, height / 8.f, width, height);
+    auto app = imageLayer(srcBuffer, appRect);
+    app.backgroundBlurRadius = 30;
+    app.geometry.roundedCornersRadius = {40.f, 40.f};
+    app.geometry.roundedCornersCrop = appRect;
+
+    LayerSettings shade{
+            .geometry = Geometry{.boundaries = displayRect},
+            .source = PixelSource{.solidColor = half3(0.1f, 0.1f, 0.1f)},
+            .alpha = half(0.5f),
+            .backgroundBlurRadius = 60,
+    };
+    for (int i = 0; i < 4; i++) {
+        const float top = height / 4.f + i * height / 8.f;
+        shade.blurRegions.push_back(BlurRegion{.blurRadius = 90,
+                                               .cornerRadiusTL = 30.f,
+                                               .cornerRadiusTR = 30.f,
+                                               .cornerRadiusBL = 30.f,
+                                               .cornerRadiusBR = 30.f,
+                                               .alpha = 1.f,
+                                               .left = static_cast<int>(width / 16),
+                                               .top = static_cast<int>(top),
+                                               .right = static_cast<int>(width * 15 / 16),
+                                               .bottom = static_cast<int>(top + height / 10.f)});
+    }
+
+    auto layers = std::vector<LayerSettings>{imageLayer(srcBuffer, displayRect), app, shade};
+    benchDrawLayers(*re, layers, benchState, "scenario_blur_stack");
+}
+
+// HDR video in a PQ buffer, tone mapped to an sRGB display, below SDR system bars that are dimmed
+// relative to it.
+void BM_scenarioHdrToneMapping(benchmark::State& benchState) {
+    auto re = createRenderEngine(static_cast<RenderEngine::RenderEngineType>(benchState.range()));
+    auto [width, height] = getDisplaySize();
+    auto srcBuffer = loadHomescreen(*re);
+
+    auto video = imageLayer(srcBuffer, FloatRect(0, 0, width, height));
+    video.sourceDataspace = ui::Dataspace::BT2020_ITU_PQ;
+    video.source.buffer.maxLuminanceNits = 1000.f;
+    video.whitePointNits = 1000.f;
+
+    auto statusBar = imageLayer(srcBuffer, FloatRect(0, 0, width, height / 20.f));
+    statusBar.sourceDataspace = ui::Dataspace::V0_SRGB;
+    statusBar.whitePointNits = 200.f;
+    auto navigationBar = imageLayer(srcBuffer, FloatRect(0, height * 19 / 20.f, width, height));
+    navigationBar.sourceDataspace = ui::Dataspace::V0_SRGB;
+    navigationBar.whitePointNits = 200.f;
+
+    auto layers = std::vector<LayerSettings>{video, statusBar, navigationBar};
+    benchDrawLayers(*re, layers, benchState, "scenario_hdr_tone_mapping", ui::Dataspace::V0_SRGB);
+}
+
+// Recents: a grid of task snapshots, each with rounded corners and a shadow.
+void BM_scenarioRoundedCorners(benchmark::State& benchState) {
+    auto re = createRenderEngine(static_cast<RenderEngine::RenderEngineType>(benchState.range()));
+    auto [width, height] = getDisplaySize();
+    auto srcBuffer = loadHomescreen(*re);
+
+    std::vector<LayerSettings> layers{imageLayer(srcBuffer, FloatRect(0, 0, width, height))};
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 2; column++) {
+            const FloatRect rect(width * (column * 2 + 1) / 8.f, height * (row * 3 + 1) / 10.f,
+                                 width * (column * 2 + 2) / 8.f + width / 8.f,
+                                 height * (row * 3 + 3) / 10.f);
+            auto task = imageLayer(srcBuffer, rect);
+            task.geometry.roundedCornersRadius = {48.f, 48.f};
+            task.geometry.roundedCornersCrop = rect;
+            task.shadow = ShadowSettings{
+                    .boundaries = rect,
+                    .ambientColor = vec4(0.f, 0.f, 0.f, 0.04f),
+                    .spotColor = vec4(0.f, 0.f, 0.f, 0.2f),
+                    .lightPos = vec3(width / 2.f, 0.f, 600.f),
+                    .lightRadius = 800.f,
+                    .length = 24.f,
+                    .casterIsTranslucent = false,
+            };
+            layers.push_back(task);
+        }
+    }
+    benchDrawLayers(*re, layers, benchState, "scenario_rounded_corners");
+}
+
+// More layers than the device can compose, e.g. a game with overlays and several floating
+// windows, so that all of them fall back to client composition.
+void BM_scenarioManyLayers(benchmark::State& benchState) {
+    auto re = createRenderEngine(static_cast<RenderEngine::RenderEngineType>(benchState.range()));
+    auto [width, height] = getDisplaySize();
+    auto srcBuffer = loadHomescreen(*re);
+
+    constexpr int kLayerCount = 12;
+    std::vector<LayerSettings> layers;
+    for (int i = 0; i < kLayerCount; i++) {
+        const float inset = i * width / (4.f * kLayerCount);
+        auto layer = imageLayer(srcBuffer, FloatRect(inset, inset, width - inset, height - inset));
+        layer.alpha = half(i == 0 ? 1.f : 0.8f);
+        layers.push_back(layer);
+    }
+    benchDrawLayers(*re, layers, benchState, "scenario_many_layers");
+}
+
+BENCHMARK(BM_scenarioBlurStack)->Apply(RunSkiaGLAndVkThreaded);
+BENCHMARK(BM_scenarioHdrToneMapping)->Apply(RunSkiaGLAndVkThreaded);
+BENCHMARK(BM_scenarioRoundedCorners)->Apply(RunSkiaGLAndVkThreaded);
+BENCHMARK(BM_scenarioManyLayers)->Apply(RunSkiaGLAndVkThreaded);
@@ -51,6 +51,11 @@ struct DisplaySettings {
     // z=1.
     Rect clip = Rect::INVALID_RECT;
 
+    // Area of the logical display, in the same coordinates as clip, that needs to be redrawn. The
+    // rest of the output buffer already holds the result of a previous composition of the same
+    // content. If invalid, the whole buffer is redrawn.
+    Rect damage = Rect::INVALID_RECT;
+
     // Maximum luminance pulled from the display's HDR capabilities.
     float maxLuminance = 1.0f;
 
@@ -89,8 +94,13 @@ struct DisplaySettings {
             aidl::android::hardware::graphics::composer3::RenderIntent::TONE_MAP_COLORIMETRIC;
 
     std::vector<renderengine::BorderRenderInfo> borderInfoList;
+
+    // Whether no upcoming frame is waiting on the output, e.g. when rendering a cached set of
+    // layers. Such work may be rendered on a lower priority context, if RenderEngine has one.
+    bool renderInBackground = false;
 };
 
+// The damage is left out, it only affects how much of the output buffer is redrawn, not the result.
 static inline bool operator==(const DisplaySettings& lhs, const DisplaySettings& rhs) {
     return lhs.namePlusId == rhs.namePlusId && lhs.physicalDisplay == rhs.physicalDisplay &&
             lhs.clip == rhs.clip && lhs.maxLuminance == rhs.maxLuminance &&
@@ -101,7 +111,8 @@ static inline bool operator==(const DisplaySettings& lhs, const DisplaySettings&
             lhs.orientation == rhs.orientation &&
             lhs.targetLuminanceNits == rhs.targetLuminanceNits &&
             lhs.dimmingStage == rhs.dimmingStage && lhs.renderIntent == rhs.renderIntent &&
-            lhs.borderInfoList == rhs.borderInfoList;
+            lhs.borderInfoList == rhs.borderInfoList &&
+            lhs.renderInBackground == rhs.renderInBackground;
 }
 
 static const char* orientation_to_string(uint32_t orientation) {
@@ -133,6 +144,8 @@ static inline void PrintTo(const DisplaySettings& settings, ::std::ostream* os)
     PrintTo(settings.physicalDisplay, os);
     *os << "\n    .clip = ";
     PrintTo(settings.clip, os);
+    *os << "\n    .damage = ";
+    PrintTo(settings.damage, os);
     *os << "\n    .maxLuminance = " << settings.maxLuminance;
     *os << "\n    .currentLuminanceNits = " << settings.currentLuminanceNits;
     *os << "\n    .outputDataspace = ";
@@ -146,6 +159,7 @@ static inline void PrintTo(const DisplaySettings& settings, ::std::ostream* os)
         << aidl::android::hardware::graphics::composer3::toString(settings.dimmingStage).c_str();
     *os << "\n    .renderIntent = "
         << aidl::android::hardware::graphics::composer3::toString(settings.renderIntent).c_str();
+    *os << "\n    .renderInBackground = " << settings.renderInBackground;
     *os << "\n}";
 }
 
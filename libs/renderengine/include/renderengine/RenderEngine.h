@@ -33,6 +33,8 @@
 
 #include <future>
 #include <memory>
+#include <optional>
+#include <string>
 
 /**
  * Allows to set RenderEngine backend to GLES (default) or SkiaGL (NOT yet supported).
@@ -266,6 +268,12 @@ struct RenderEngineCreationArgs {
     bool supportsBackgroundBlur;
     RenderEngine::ContextPriority contextPriority;
     RenderEngine::RenderEngineType renderEngineType;
+    // If set, the backend may create a second context with this priority for the work that
+    // DisplaySettings::renderInBackground marks. Only SkiaVkRenderEngine supports it.
+    std::optional<RenderEngine::ContextPriority> backgroundContextPriority;
+    // File in which the LinearEffects drawn so far are recorded, so that their runtime effects are
+    // built again when the cache is primed after a reboot. Empty if they are not recorded.
+    std::string linearEffectCachePath;
 
     struct Builder;
 
@@ -275,7 +283,10 @@ private:
                              bool _enableProtectedContext, bool _precacheToneMapperShaderOnly,
                              bool _supportsBackgroundBlur,
                              RenderEngine::ContextPriority _contextPriority,
-                             RenderEngine::RenderEngineType _renderEngineType)
+                             RenderEngine::RenderEngineType _renderEngineType,
+                             std::optional<RenderEngine::ContextPriority>
+                                     _backgroundContextPriority,
+                             std::string _linearEffectCachePath)
           : pixelFormat(_pixelFormat),
             imageCacheSize(_imageCacheSize),
             useColorManagement(_useColorManagement),
@@ -283,7 +294,9 @@ private:
             precacheToneMapperShaderOnly(_precacheToneMapperShaderOnly),
             supportsBackgroundBlur(_supportsBackgroundBlur),
             contextPriority(_contextPriority),
-            renderEngineType(_renderEngineType) {}
+            renderEngineType(_renderEngineType),
+            backgroundContextPriority(_backgroundContextPriority),
+            linearEffectCachePath(std::move(_linearEffectCachePath)) {}
     RenderEngineCreationArgs() = delete;
 };
 
@@ -322,10 +335,19 @@ struct RenderEngineCreationArgs::Builder {
         this->renderEngineType = renderEngineType;
         return *this;
     }
+    Builder& setBackgroundContextPriority(RenderEngine::ContextPriority backgroundContextPriority) {
+        this->backgroundContextPriority = backgroundContextPriority;
+        return *this;
+    }
+    Builder& setLinearEffectCachePath(std::string linearEffectCachePath) {
+        this->linearEffectCachePath = std::move(linearEffectCachePath);
+        return *this;
+    }
     RenderEngineCreationArgs build() const {
         return RenderEngineCreationArgs(pixelFormat, imageCacheSize, useColorManagement,
                                         enableProtectedContext, precacheToneMapperShaderOnly,
-                                        supportsBackgroundBlur, contextPriority, renderEngineType);
+                                        supportsBackgroundBlur, contextPriority, renderEngineType,
+                                        backgroundContextPriority, linearEffectCachePath);
     }
 
 private:
@@ -339,6 +361,8 @@ private:
     RenderEngine::ContextPriority contextPriority = RenderEngine::ContextPriority::MEDIUM;
     RenderEngine::RenderEngineType renderEngineType =
             RenderEngine::RenderEngineType::SKIA_GL_THREADED;
+    std::optional<RenderEngine::ContextPriority> backgroundContextPriority;
+    std::string linearEffectCachePath;
 };
 
 } // namespace renderengine
@@ -382,15 +382,26 @@ void Cache::primeShaderCache(SkiaRenderEngine* renderengine) {
                 impl::ExternalTexture>(srcBuffer, *renderengine,
                                        impl::ExternalTexture::Usage::READABLE |
                                                impl::ExternalTexture::Usage::WRITEABLE);
-        drawHolePunchLayer(renderengine, display, dstTexture);
-        drawSolidLayers(renderengine, display, dstTexture);
+        // Steps are logged individually so that the cost of every group of shaders shows up in
+        // the boot log, which makes it easier to tell which ones are worth priming at all.
+        const auto primeStep = [&](const char* name, auto&& draw) {
+            const nsecs_t stepTimeBefore = systemTime();
+            const int stepCountBefore = renderengine->reportShadersCompiled();
+            draw();
+            ALOGD("Shader cache step %s generated %d shaders in %f ms\n", name,
+                  renderengine->reportShadersCompiled() - stepCountBefore,
+                  static_cast<float>(systemTime() - stepTimeBefore) / 1.0E6);
+        };
 
-        drawShadowLayers(renderengine, display, srcTexture);
-        drawShadowLayers(renderengine, p3Display, srcTexture);
-
-        if (renderengine->supportsBackgroundBlur()) {
-            drawBlurLayers(renderengine, display, dstTexture);
-        }
+        // The steps are ordered by how early their shaders are needed after boot: the boot
+        // animation and the launcher are plain solid and image layers, while shadows, blurs, PIP
+        // and hole punches only show up once apps are used. The shadow step runs before the image
+        // steps because it populates the source texture they sample from.
+        primeStep("solid", [&] { drawSolidLayers(renderengine, display, dstTexture); });
+        primeStep("shadow", [&] {
+            drawShadowLayers(renderengine, display, srcTexture);
+            drawShadowLayers(renderengine, p3Display, srcTexture);
+        });
 
         // The majority of skia shaders needed by RenderEngine are related to sampling images.
         // These need to be generated with various source textures.
@@ -422,13 +433,25 @@ void Cache::primeShaderCache(SkiaRenderEngine* renderengine) {
             textures.push_back(f16ExternalTexture);
         }
 
-        for (auto texture : textures) {
-            drawImageLayers(renderengine, display, dstTexture, texture);
-            // Draw layers for b/185569240.
-            drawClippedLayers(renderengine, display, dstTexture, texture);
-        }
+        primeStep("image", [&] {
+            for (auto texture : textures) {
+                drawImageLayers(renderengine, display, dstTexture, texture);
+            }
+        });
+        primeStep("clipped", [&] {
+            for (auto texture : textures) {
+                // Draw layers for b/185569240.
+                drawClippedLayers(renderengine, display, dstTexture, texture);
+            }
+        });
+
+        primeStep("pip",
+                  [&] { drawPIPImageLayer(renderengine, display, dstTexture, externalTexture); });
+        primeStep("holePunch", [&] { drawHolePunchLayer(renderengine, display, dstTexture); });
 
-        drawPIPImageLayer(renderengine, display, dstTexture, externalTexture);
+        if (renderengine->supportsBackgroundBlur()) {
+            primeStep("blur", [&] { drawBlurLayers(renderengine, display, dstTexture); });
+        }
 
         // draw one final layer synchronously to force GL submit
         LayerSettings layer{
@@ -51,7 +51,11 @@
 #include <SkString.h>
 #include <SkSurface.h>
 #include <SkTileMode.h>
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/scopeguard.h>
 #include <android-base/stringprintf.h>
+#include <android-base/strings.h>
 #include <gui/FenceMonitor.h>
 #include <gui/TraceUtils.h>
 #include <pthread.h>
@@ -61,13 +65,17 @@
 #include <ui/DebugUtils.h>
 #include <ui/GraphicBuffer.h>
 #include <ui/HdrRenderTypeUtils.h>
+#include <ui/PixelFormat.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
 #include <deque>
 #include <memory>
 #include <numeric>
+#include <optional>
 
 #include "Cache.h"
 #include "ColorSpaces.h"
@@ -243,13 +251,112 @@ using base::StringAppendF;
 
 std::future<void> SkiaRenderEngine::primeCache() {
     Cache::primeShaderCache(this);
+    precompileLinearEffects();
     return {};
 }
 
+// Bounds the LinearEffect cache file, which holds one effect per line.
+static constexpr size_t kMaxPersistedLinearEffects = 64;
+
+static std::string serializeLinearEffect(const shaders::LinearEffect& effect) {
+    return base::StringPrintf("%d %d %d %d\n", static_cast<int32_t>(effect.inputDataspace),
+                              static_cast<int32_t>(effect.outputDataspace),
+                              effect.undoPremultipliedAlpha ? 1 : 0,
+                              static_cast<int32_t>(effect.fakeOutputDataspace));
+}
+
+static std::optional<shaders::LinearEffect> parseLinearEffect(const std::string& line) {
+    const auto fields = base::Split(line, " ");
+    int32_t inputDataspace, outputDataspace, undoPremultipliedAlpha, fakeOutputDataspace;
+    if (fields.size() != 4 || !base::ParseInt(fields[0], &inputDataspace) ||
+        !base::ParseInt(fields[1], &outputDataspace) ||
+        !base::ParseInt(fields[2], &undoPremultipliedAlpha, 0, 1) ||
+        !base::ParseInt(fields[3], &fakeOutputDataspace)) {
+        return std::nullopt;
+    }
+    return shaders::LinearEffect{.inputDataspace = static_cast<ui::Dataspace>(inputDataspace),
+                                 .outputDataspace = static_cast<ui::Dataspace>(outputDataspace),
+                                 .undoPremultipliedAlpha = undoPremultipliedAlpha != 0,
+                                 .fakeOutputDataspace =
+                                         static_cast<ui::Dataspace>(fakeOutputDataspace)};
+}
+
+void SkiaRenderEngine::loadPersistedLinearEffects() {
+    if (mPersistedLinearEffectsLoaded) {
+        return;
+    }
+    mPersistedLinearEffectsLoaded = true;
+
+    std::string contents;
+    if (mLinearEffectCachePath.empty() ||
+        !base::ReadFileToString(mLinearEffectCachePath, &contents)) {
+        return;
+    }
+    for (const auto& line : base::Split(contents, "\n")) {
+        if (mPersistedLinearEffects.size() >= kMaxPersistedLinearEffects) {
+            break;
+        }
+        if (const auto effect = parseLinearEffect(line)) {
+            mPersistedLinearEffects.insert(*effect);
+        }
+    }
+}
+
+void SkiaRenderEngine::persistLinearEffect(const shaders::LinearEffect& effect) {
+    if (mLinearEffectCachePath.empty()) {
+        return;
+    }
+    loadPersistedLinearEffects();
+    if (mPersistedLinearEffects.size() >= kMaxPersistedLinearEffects ||
+        !mPersistedLinearEffects.insert(effect).second) {
+        return;
+    }
+
+    // The file is rewritten rather than appended to, so that it never holds more than the
+    // recorded set, e.g. if it could not be read when it was loaded.
+    std::string contents;
+    for (const auto& persistedEffect : mPersistedLinearEffects) {
+        contents += serializeLinearEffect(persistedEffect);
+    }
+    const std::string tmpPath = mLinearEffectCachePath + ".tmp";
+    if (!base::WriteStringToFile(contents, tmpPath) ||
+        rename(tmpPath.c_str(), mLinearEffectCachePath.c_str()) != 0) {
+        ALOGW("Failed to record LinearEffect in %s: %s", mLinearEffectCachePath.c_str(),
+              strerror(errno));
+    }
+}
+
+void SkiaRenderEngine::precompileLinearEffects() {
+    loadPersistedLinearEffects();
+    if (mPersistedLinearEffects.empty()) {
+        return;
+    }
+
+    ATRACE_CALL();
+    const nsecs_t timeBefore = systemTime();
+    size_t count = 0;
+    for (const auto& effect : mPersistedLinearEffects) {
+        if (count == kMaxRuntimeEffects) {
+            break;
+        }
+        getRuntimeEffect(effect);
+        count++;
+    }
+    ALOGD("Built %zu recorded runtime effects in %f ms", count,
+          (systemTime() - timeBefore) / 1e6);
+}
+
 sk_sp<SkData> SkiaRenderEngine::SkSLCacheMonitor::load(const SkData& key) {
-    // This "cache" does not actually cache anything. It just allows us to
-    // monitor Skia's internal cache. So this method always returns null.
-    return nullptr;
+    const bool startup = std::chrono::steady_clock::now() - mCreationTime < kStartupPeriod;
+    const auto it = mPrograms.find(std::string(static_cast<const char*>(key.data()), key.size()));
+    if (it == mPrograms.end()) {
+        mMisses++;
+        if (startup) mStartupMisses++;
+        return nullptr;
+    }
+    mHits++;
+    if (startup) mStartupHits++;
+    return it->second;
 }
 
 void SkiaRenderEngine::SkSLCacheMonitor::store(const SkData& key, const SkData& data,
@@ -257,6 +364,25 @@ void SkiaRenderEngine::SkSLCacheMonitor::store(const SkData& key, const SkData&
     mShadersCachedSinceLastCall++;
     mTotalShadersCompiled++;
     ATRACE_FORMAT("SF cache: %i shaders", mTotalShadersCompiled);
+
+    const size_t bytes = key.size() + data.size();
+    if (mCacheBytes + bytes > kMaxCacheBytes) {
+        return;
+    }
+    const auto [it, inserted] =
+            mPrograms.try_emplace(std::string(static_cast<const char*>(key.data()), key.size()),
+                                  SkData::MakeWithCopy(data.data(), data.size()));
+    if (inserted) {
+        mCacheBytes += bytes;
+    }
+}
+
+void SkiaRenderEngine::SkSLCacheMonitor::dump(std::string& result) const {
+    StringAppendF(&result,
+                  "RenderEngine program cache: %zu programs, %zu bytes, %d hits, %d misses "
+                  "(first %llds: %d hits, %d misses)\n",
+                  mPrograms.size(), mCacheBytes, mHits, mMisses,
+                  static_cast<long long>(kStartupPeriod.count()), mStartupHits, mStartupMisses);
 }
 
 int SkiaRenderEngine::reportShadersCompiled() {
@@ -268,10 +394,12 @@ void SkiaRenderEngine::setEnableTracing(bool tracingEnabled) {
 }
 
 SkiaRenderEngine::SkiaRenderEngine(RenderEngineType type, PixelFormat pixelFormat,
-                                   bool useColorManagement, bool supportsBackgroundBlur)
+                                   bool useColorManagement, bool supportsBackgroundBlur,
+                                   std::string linearEffectCachePath)
       : RenderEngine(type),
         mDefaultPixelFormat(pixelFormat),
-        mUseColorManagement(useColorManagement) {
+        mUseColorManagement(useColorManagement),
+        mLinearEffectCachePath(std::move(linearEffectCachePath)) {
     if (supportsBackgroundBlur) {
         ALOGD("Background Blurs Enabled");
         mBlurFilter = new KawaseBlurFilter();
@@ -288,6 +416,8 @@ void SkiaRenderEngine::finishRenderingAndAbandonContext() {
     if (mBlurFilter) {
         delete mBlurFilter;
     }
+    mBlurCache.clear();
+    mBlurCacheBytes = 0;
 
     if (mGrContext) {
         mGrContext->flushAndSubmit(true);
@@ -298,6 +428,11 @@ void SkiaRenderEngine::finishRenderingAndAbandonContext() {
         mProtectedGrContext->flushAndSubmit(true);
         mProtectedGrContext->abandonContext();
     }
+
+    if (mBackgroundGrContext) {
+        mBackgroundGrContext->flushAndSubmit(true);
+        mBackgroundGrContext->abandonContext();
+    }
 }
 
 void SkiaRenderEngine::useProtectedContext(bool useProtectedContext) {
@@ -324,6 +459,9 @@ void SkiaRenderEngine::useProtectedContext(bool useProtectedContext) {
 }
 
 GrDirectContext* SkiaRenderEngine::getActiveGrContext() {
+    if (mInBackgroundContext) {
+        return mBackgroundGrContext.get();
+    }
     return mInProtectedContext ? mProtectedGrContext.get() : mGrContext.get();
 }
 
@@ -384,6 +522,7 @@ void SkiaRenderEngine::ensureGrContextsCreated() {
     options.fReducedShaderVariations = true;
     options.fPersistentCache = &mSkSLCacheMonitor;
     std::tie(mGrContext, mProtectedGrContext) = createDirectContexts(options);
+    mBackgroundGrContext = createBackgroundDirectContext(options);
 }
 
 void SkiaRenderEngine::mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer,
@@ -421,7 +560,35 @@ void SkiaRenderEngine::mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer,
                 std::make_shared<AutoBackendTexture::LocalRef>(grContext,
                                                                buffer->toAHardwareBuffer(),
                                                                isRenderable, mTextureCleanupMgr);
-        cache.insert({buffer->getId(), imageTextureRef});
+        // Formats without a fixed pixel size, such as YUV, are accounted as 32 bit, which
+        // overestimates them.
+        const ssize_t bytesPerPixel = android::bytesPerPixel(buffer->getPixelFormat());
+        const size_t bytes = static_cast<size_t>(buffer->getStride()) * buffer->getHeight() *
+                (bytesPerPixel > 0 ? static_cast<size_t>(bytesPerPixel) : 4);
+        mTextureCacheLru.push_front(buffer->getId());
+        cache.insert({buffer->getId(),
+                      CachedTexture{.ref = std::move(imageTextureRef),
+                                    .bytes = bytes,
+                                    .lruPosition = mTextureCacheLru.begin()}});
+        mTextureCacheBytes += bytes;
+        evictTexturesOverBudget();
+    }
+}
+
+void SkiaRenderEngine::evictTexturesOverBudget() {
+    // The most recently mapped buffer is never evicted, even if it is over budget on its own.
+    auto it = mTextureCacheLru.end();
+    while (mTextureCacheBytes > kTextureCacheBudgetBytes && --it != mTextureCacheLru.begin()) {
+        const auto cached = mTextureCache.find(*it);
+        // A texture that is referenced outside of the cache is used by a draw that is still in
+        // flight, the reference is released once the draw is done.
+        if (cached->second.ref.use_count() > 1) {
+            continue;
+        }
+        mTextureCacheBytes -= cached->second.bytes;
+        mTextureCache.erase(cached);
+        it = mTextureCacheLru.erase(it);
+        mTextureCacheEvictions++;
     }
 }
 
@@ -451,7 +618,12 @@ void SkiaRenderEngine::unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer) {
         useProtectedContext(buffer->getUsage() & GRALLOC_USAGE_PROTECTED);
 
         if (iter->second == 0) {
-            mTextureCache.erase(buffer->getId());
+            if (const auto cached = mTextureCache.find(buffer->getId());
+                cached != mTextureCache.end()) {
+                mTextureCacheBytes -= cached->second.bytes;
+                mTextureCacheLru.erase(cached->second.lruPosition);
+                mTextureCache.erase(cached);
+            }
             mGraphicBufferExternalRefs.erase(buffer->getId());
         }
 
@@ -465,10 +637,12 @@ void SkiaRenderEngine::unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer) {
 
 std::shared_ptr<AutoBackendTexture::LocalRef> SkiaRenderEngine::getOrCreateBackendTexture(
         const sp<GraphicBuffer>& buffer, bool isOutputBuffer) {
-    // Do not lookup the buffer in the cache for protected contexts
-    if (!isProtected()) {
+    // Do not lookup the buffer in the cache for protected or background contexts
+    if (!isProtected() && !isBackground()) {
         if (const auto& it = mTextureCache.find(buffer->getId()); it != mTextureCache.end()) {
-            return it->second;
+            mTextureCacheLru.splice(mTextureCacheLru.begin(), mTextureCacheLru,
+                                    it->second.lruPosition);
+            return it->second.ref;
         }
     }
     return std::make_shared<AutoBackendTexture::LocalRef>(getActiveGrContext(),
@@ -476,6 +650,69 @@ std::shared_ptr<AutoBackendTexture::LocalRef> SkiaRenderEngine::getOrCreateBacke
                                                           isOutputBuffer, mTextureCleanupMgr);
 }
 
+sk_sp<SkImage> SkiaRenderEngine::generateBlur(GrRecordingContext* context, uint32_t radius,
+                                              const sk_sp<SkImage>& blurInput,
+                                              const SkRect& blurRect,
+                                              const DisplaySettings& display,
+                                              const std::vector<LayerSettings>& layers,
+                                              size_t layersBelowCount) {
+    // The cached blurs belong to the main context.
+    if (isBackground()) {
+        return mBlurFilter->generate(context, radius, blurInput, blurRect);
+    }
+
+    // The content of a buffer is identified by its acquire fence, which is replaced whenever new
+    // content is queued. Buffers without a fence of their own cannot be told apart from later
+    // content in the same buffer, so they are always blurred again.
+    std::vector<LayerSettings> layersBelow(layers.begin(), layers.begin() + layersBelowCount);
+    std::vector<uint64_t> bufferIds;
+    bufferIds.reserve(layersBelowCount);
+    for (auto& layer : layersBelow) {
+        auto& buffer = layer.source.buffer;
+        if (!buffer.buffer) {
+            bufferIds.push_back(0);
+            continue;
+        }
+        if (buffer.fence == nullptr || buffer.fence == Fence::NO_FENCE) {
+            mBlurCacheMisses++;
+            return mBlurFilter->generate(context, radius, blurInput, blurRect);
+        }
+        bufferIds.push_back(buffer.buffer->getId());
+        buffer.buffer = nullptr;
+    }
+
+    const auto it = std::find_if(mBlurCache.begin(), mBlurCache.end(), [&](const auto& entry) {
+        return entry.radius == radius && entry.blurRect == blurRect &&
+                entry.bufferIds == bufferIds && entry.display == display &&
+                entry.layers == layersBelow;
+    });
+    if (it != mBlurCache.end()) {
+        mBlurCacheHits++;
+        mBlurCache.splice(mBlurCache.begin(), mBlurCache, it);
+        return it->image;
+    }
+
+    mBlurCacheMisses++;
+    sk_sp<SkImage> image = mBlurFilter->generate(context, radius, blurInput, blurRect);
+    const size_t bytes = image ? image->imageInfo().computeMinByteSize() : 0;
+    if (!image || bytes > kBlurCacheBudgetBytes) {
+        return image;
+    }
+    while (mBlurCacheBytes + bytes > kBlurCacheBudgetBytes) {
+        mBlurCacheBytes -= mBlurCache.back().bytes;
+        mBlurCache.pop_back();
+    }
+    mBlurCache.push_front(CachedBlur{.display = display,
+                                     .layers = std::move(layersBelow),
+                                     .bufferIds = std::move(bufferIds),
+                                     .radius = radius,
+                                     .blurRect = blurRect,
+                                     .image = image,
+                                     .bytes = bytes});
+    mBlurCacheBytes += bytes;
+    return image;
+}
+
 bool SkiaRenderEngine::canSkipPostRenderCleanup() const {
     std::lock_guard<std::mutex> lock(mRenderingMutex);
     return mTextureCleanupMgr.isEmpty();
@@ -487,6 +724,28 @@ void SkiaRenderEngine::cleanupPostRender() {
     mTextureCleanupMgr.cleanup();
 }
 
+sk_sp<SkRuntimeEffect> SkiaRenderEngine::getRuntimeEffect(const shaders::LinearEffect& effect) {
+    const auto effectIter = mRuntimeEffects.find(effect);
+    if (effectIter != mRuntimeEffects.end()) {
+        mRuntimeEffectsLru.splice(mRuntimeEffectsLru.begin(), mRuntimeEffectsLru,
+                                  effectIter->second.lruPosition);
+        return effectIter->second.effect;
+    }
+
+    sk_sp<SkRuntimeEffect> runtimeEffect = buildRuntimeEffect(effect);
+    persistLinearEffect(effect);
+    // Shaders that were created from an evicted effect keep their own reference to it.
+    if (mRuntimeEffects.size() >= kMaxRuntimeEffects) {
+        mRuntimeEffects.erase(mRuntimeEffectsLru.back());
+        mRuntimeEffectsLru.pop_back();
+    }
+    mRuntimeEffectsLru.push_front(effect);
+    mRuntimeEffects.insert(
+            {effect,
+             CachedRuntimeEffect{.effect = runtimeEffect, .lruPosition = mRuntimeEffectsLru.begin()}});
+    return runtimeEffect;
+}
+
 sk_sp<SkShader> SkiaRenderEngine::createRuntimeEffectShader(
         const RuntimeEffectShaderParameters& parameters) {
     // The given surface will be stretched by HWUI via matrix transformation
@@ -510,14 +769,7 @@ sk_sp<SkShader> SkiaRenderEngine::createRuntimeEffectShader(
                                       .undoPremultipliedAlpha = parameters.undoPremultipliedAlpha,
                                       .fakeOutputDataspace = parameters.fakeOutputDataspace};
 
-        auto effectIter = mRuntimeEffects.find(effect);
-        sk_sp<SkRuntimeEffect> runtimeEffect = nullptr;
-        if (effectIter == mRuntimeEffects.end()) {
-            runtimeEffect = buildRuntimeEffect(effect);
-            mRuntimeEffects.insert({effect, runtimeEffect});
-        } else {
-            runtimeEffect = effectIter->second;
-        }
+        const sk_sp<SkRuntimeEffect> runtimeEffect = getRuntimeEffect(effect);
 
         mat4 colorTransform = parameters.layer.colorTransform;
 
@@ -654,6 +906,12 @@ void SkiaRenderEngine::drawLayersInternal(
 
     std::lock_guard<std::mutex> lock(mRenderingMutex);
 
+    // Work that no frame waits on is rendered on the background context if there is one, so that
+    // it does not delay the client composition submitted after it.
+    mInBackgroundContext = display.renderInBackground && mBackgroundGrContext && !isProtected();
+    const auto leaveBackgroundContext =
+            base::make_scope_guard([this] { mInBackgroundContext = false; });
+
     if (buffer == nullptr) {
         ALOGE("No output buffer provided. Aborting GPU composition.");
         resultPromise->set_value(base::unexpected(BAD_VALUE));
@@ -738,10 +996,21 @@ void SkiaRenderEngine::drawLayersInternal(
         }
     }
 
+    // Only the damaged area is redrawn when the rest of the buffer already holds the previous
+    // composition. Blurs are composed in an offscreen surface that starts out empty, so they always
+    // redraw everything.
+    const bool partialUpdate = display.damage.isValid() && activeSurface == dstSurface;
+
     AutoSaveRestore surfaceAutoSaveRestore(canvas);
-    // Clear the entire canvas with a transparent black to prevent ghost images.
-    canvas->clear(SK_ColorTRANSPARENT);
+    if (!partialUpdate) {
+        // Clear the entire canvas with a transparent black to prevent ghost images.
+        canvas->clear(SK_ColorTRANSPARENT);
+    }
     initCanvas(canvas, display);
+    if (partialUpdate) {
+        canvas->clipRect(getSkRect(display.damage));
+        canvas->clear(SK_ColorTRANSPARENT);
+    }
 
     if (kPrintLayerSettings) {
         logSettings(display);
@@ -842,8 +1111,9 @@ void SkiaRenderEngine::drawLayersInternal(
             if (blurRect.width() > 0 && blurRect.height() > 0) {
                 if (layer.backgroundBlurRadius > 0) {
                     ATRACE_NAME("BackgroundBlur");
-                    auto blurredImage = mBlurFilter->generate(grContext, layer.backgroundBlurRadius,
-                                                              blurInput, blurRect);
+                    auto blurredImage =
+                            generateBlur(grContext, layer.backgroundBlurRadius, blurInput, blurRect,
+                                         display, layers, &layer - layers.data());
 
                     cachedBlurs[layer.backgroundBlurRadius] = blurredImage;
 
@@ -856,8 +1126,8 @@ void SkiaRenderEngine::drawLayersInternal(
                     if (cachedBlurs[region.blurRadius] == nullptr) {
                         ATRACE_NAME("BlurRegion");
                         cachedBlurs[region.blurRadius] =
-                                mBlurFilter->generate(grContext, region.blurRadius, blurInput,
-                                                      blurRect);
+                                generateBlur(grContext, region.blurRadius, blurInput, blurRect,
+                                             display, layers, &layer - layers.data());
                     }
 
                     mBlurFilter->drawBlurRegion(canvas, getBlurRRect(region), region.blurRadius,
@@ -1220,8 +1490,11 @@ void SkiaRenderEngine::dump(std::string& result) {
     StringAppendF(&result, "RenderEngine supports protected context: %d\n",
                   supportsProtectedContent());
     StringAppendF(&result, "RenderEngine is in protected context: %d\n", mInProtectedContext);
+    StringAppendF(&result, "RenderEngine has background context: %d\n",
+                  mBackgroundGrContext != nullptr);
     StringAppendF(&result, "RenderEngine shaders cached since last dump/primeCache: %d\n",
                   mSkSLCacheMonitor.shadersCachedSinceLastCall());
+    mSkSLCacheMonitor.dump(result);
 
     std::vector<ResourcePair> cpuResourceMap = {
             {"skia/sk_resource_cache/bitmap_", "Bitmaps"},
@@ -1259,13 +1532,16 @@ void SkiaRenderEngine::dump(std::string& result) {
         for (const auto& [id, refCounts] : mGraphicBufferExternalRefs) {
             StringAppendF(&result, "- 0x%" PRIx64 " - %d refs \n", id, refCounts);
         }
-        StringAppendF(&result, "RenderEngine AHB/BackendTexture cache size: %zu\n",
-                      mTextureCache.size());
-        StringAppendF(&result, "Dumping buffer ids...\n");
-        // TODO(178539829): It would be nice to know which layer these are coming from and what
-        // the texture sizes are.
-        for (const auto& [id, unused] : mTextureCache) {
-            StringAppendF(&result, "- 0x%" PRIx64 "\n", id);
+        StringAppendF(&result,
+                      "RenderEngine AHB/BackendTexture cache size: %zu (%zu of %zu bytes, %zu "
+                      "evictions)\n",
+                      mTextureCache.size(), mTextureCacheBytes, kTextureCacheBudgetBytes,
+                      mTextureCacheEvictions);
+        StringAppendF(&result, "Dumping buffer ids, most recently used first...\n");
+        // TODO(178539829): It would be nice to know which layer these are coming from.
+        for (const auto id : mTextureCacheLru) {
+            StringAppendF(&result, "- 0x%" PRIx64 " - %zu bytes\n", id,
+                          mTextureCache.at(id).bytes);
         }
         StringAppendF(&result, "\n");
 
@@ -1280,6 +1556,11 @@ void SkiaRenderEngine::dump(std::string& result) {
         gpuProtectedReporter.logOutput(result, true);
 
         StringAppendF(&result, "\n");
+        StringAppendF(&result,
+                      "RenderEngine blur cache: %zu entries, %zu of %zu bytes, %zu hits, %zu "
+                      "misses\n",
+                      mBlurCache.size(), mBlurCacheBytes, kBlurCacheBudgetBytes, mBlurCacheHits,
+                      mBlurCacheMisses);
         StringAppendF(&result, "RenderEngine runtime effects: %zu\n", mRuntimeEffects.size());
         for (const auto& [linearEffect, unused] : mRuntimeEffects) {
             StringAppendF(&result, "- inputDataspace: %s\n",
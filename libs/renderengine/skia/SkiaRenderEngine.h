@@ -22,14 +22,19 @@
 
 #include <GrBackendSemaphore.h>
 #include <GrDirectContext.h>
+#include <SkData.h>
 #include <SkSurface.h>
 #include <android-base/thread_annotations.h>
 #include <renderengine/ExternalTexture.h>
 #include <renderengine/RenderEngine.h>
 #include <sys/types.h>
 
+#include <chrono>
+#include <list>
 #include <mutex>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "AutoBackendTexture.h"
 #include "GrContextOptions.h"
@@ -62,7 +67,8 @@ public:
     SkiaRenderEngine(RenderEngineType type,
                      PixelFormat pixelFormat,
                      bool useColorManagement,
-                     bool supportsBackgroundBlur);
+                     bool supportsBackgroundBlur,
+                     std::string linearEffectCachePath = {});
     ~SkiaRenderEngine() override;
 
     std::future<void> primeCache() override final;
@@ -91,6 +97,10 @@ protected:
     // Functions that a given backend (GLES, Vulkan) must implement
     using Contexts = std::pair<sk_sp<GrDirectContext>, sk_sp<GrDirectContext>>;
     virtual Contexts createDirectContexts(const GrContextOptions& options) = 0;
+    // Optionally returns a lower priority context for DisplaySettings::renderInBackground.
+    virtual sk_sp<GrDirectContext> createBackgroundDirectContext(const GrContextOptions&) {
+        return nullptr;
+    }
     virtual bool supportsProtectedContentImpl() const = 0;
     virtual bool useProtectedContextImpl(GrProtected isProtected) = 0;
     virtual void waitFence(GrDirectContext* grContext, base::borrowed_fd fenceFd) = 0;
@@ -102,9 +112,11 @@ protected:
     GrDirectContext* getActiveGrContext();
 
     bool isProtected() const { return mInProtectedContext; }
+    bool isBackground() const { return mInBackgroundContext; }
 
     // Implements PersistentCache as a way to monitor what SkSL shaders Skia has
-    // cached.
+    // cached. Compiled programs are also kept in memory, so that programs evicted
+    // from Skia's own, smaller program cache don't need to be compiled again.
     class SkSLCacheMonitor : public GrContextOptions::PersistentCache {
     public:
         SkSLCacheMonitor() = default;
@@ -122,9 +134,27 @@ protected:
 
         int totalShadersCompiled() const { return mTotalShadersCompiled; }
 
+        void dump(std::string& result) const;
+
     private:
+        // Upper bound for the memory used by the stored programs. Programs are no
+        // longer stored once it's reached, which keeps the ones used early on, such
+        // as the ones compiled by primeCache.
+        static constexpr size_t kMaxCacheBytes = 4 * 1024 * 1024;
+        // Loads in this period after creation are counted separately, since misses
+        // during startup are the ones most likely to cause jank.
+        static constexpr std::chrono::seconds kStartupPeriod{60};
+
         int mShadersCachedSinceLastCall = 0;
         int mTotalShadersCompiled = 0;
+        std::unordered_map<std::string, sk_sp<SkData>> mPrograms;
+        size_t mCacheBytes = 0;
+        const std::chrono::steady_clock::time_point mCreationTime =
+                std::chrono::steady_clock::now();
+        int mHits = 0;
+        int mMisses = 0;
+        int mStartupHits = 0;
+        int mStartupMisses = 0;
     };
 
 private:
@@ -135,6 +165,12 @@ private:
 
     std::shared_ptr<AutoBackendTexture::LocalRef> getOrCreateBackendTexture(
             const sp<GraphicBuffer>& buffer, bool isOutputBuffer) REQUIRES(mRenderingMutex);
+    void evictTexturesOverBudget() REQUIRES(mRenderingMutex);
+    sk_sp<SkImage> generateBlur(GrRecordingContext* context, uint32_t radius,
+                                const sk_sp<SkImage>& blurInput, const SkRect& blurRect,
+                                const DisplaySettings& display,
+                                const std::vector<LayerSettings>& layers, size_t layersBelowCount)
+            REQUIRES(mRenderingMutex);
     void initCanvas(SkCanvas* canvas, const DisplaySettings& display);
     void drawShadow(SkCanvas* canvas, const SkRRect& casterRRect,
                     const ShadowSettings& shadowSettings);
@@ -160,6 +196,16 @@ private:
         const ui::Dataspace fakeOutputDataspace;
     };
     sk_sp<SkShader> createRuntimeEffectShader(const RuntimeEffectShaderParameters&);
+    // Returns the runtime effect from mRuntimeEffects, building it on a miss.
+    sk_sp<SkRuntimeEffect> getRuntimeEffect(const shaders::LinearEffect&);
+
+    // Reads the LinearEffects recorded in mLinearEffectCachePath, once.
+    void loadPersistedLinearEffects();
+    // Records an effect in mLinearEffectCachePath, if it was not recorded before.
+    void persistLinearEffect(const shaders::LinearEffect&);
+    // Builds the runtime effects of the recorded LinearEffects, so that the first frame using
+    // them does not pay for generating and compiling their SkSL.
+    void precompileLinearEffects();
 
     const PixelFormat mDefaultPixelFormat;
     const bool mUseColorManagement;
@@ -171,15 +217,58 @@ private:
     // Number of external holders of ExternalTexture references, per GraphicBuffer ID.
     std::unordered_map<GraphicBufferId, int32_t> mGraphicBufferExternalRefs
             GUARDED_BY(mRenderingMutex);
+    struct CachedTexture {
+        std::shared_ptr<AutoBackendTexture::LocalRef> ref;
+        // Approximate size of the imported buffer.
+        size_t bytes;
+        std::list<GraphicBufferId>::iterator lruPosition;
+    };
     // For GL, this cache is shared between protected and unprotected contexts. For Vulkan, it is
     // only used for the unprotected context, because Vulkan does not allow sharing between
     // contexts, and protected is less common.
-    std::unordered_map<GraphicBufferId, std::shared_ptr<AutoBackendTexture::LocalRef>> mTextureCache
-            GUARDED_BY(mRenderingMutex);
-    std::unordered_map<shaders::LinearEffect, sk_sp<SkRuntimeEffect>, shaders::LinearEffectHasher>
+    std::unordered_map<GraphicBufferId, CachedTexture> mTextureCache GUARDED_BY(mRenderingMutex);
+    // The buffers in mTextureCache, most recently used first. Evicting a buffer only drops the
+    // cached import, it is imported again if it is drawn afterwards.
+    std::list<GraphicBufferId> mTextureCacheLru GUARDED_BY(mRenderingMutex);
+    size_t mTextureCacheBytes GUARDED_BY(mRenderingMutex) = 0;
+    size_t mTextureCacheEvictions GUARDED_BY(mRenderingMutex) = 0;
+    static constexpr size_t kTextureCacheBudgetBytes = 256 * 1024 * 1024;
+
+    struct CachedRuntimeEffect {
+        sk_sp<SkRuntimeEffect> effect;
+        std::list<shaders::LinearEffect>::iterator lruPosition;
+    };
+    std::unordered_map<shaders::LinearEffect, CachedRuntimeEffect, shaders::LinearEffectHasher>
             mRuntimeEffects;
+    // The effects in mRuntimeEffects, most recently used first.
+    std::list<shaders::LinearEffect> mRuntimeEffectsLru;
+    static constexpr size_t kMaxRuntimeEffects = 32;
+
+    const std::string mLinearEffectCachePath;
+    std::unordered_set<shaders::LinearEffect, shaders::LinearEffectHasher> mPersistedLinearEffects;
+    bool mPersistedLinearEffectsLoaded = false;
     AutoBackendTexture::CleanupManager mTextureCleanupMgr GUARDED_BY(mRenderingMutex);
 
+    // Recently generated blurs, most recently used first. The blurred content is identified by
+    // the display and the layers drawn below the blur, e.g. a static wallpaper behind the
+    // notification shade is only blurred once.
+    struct CachedBlur {
+        DisplaySettings display;
+        // The layers below the blur without their buffers, which are identified by bufferIds
+        // instead, so that the cache does not keep the buffers alive.
+        std::vector<LayerSettings> layers;
+        std::vector<uint64_t> bufferIds;
+        uint32_t radius;
+        SkRect blurRect;
+        sk_sp<SkImage> image;
+        size_t bytes;
+    };
+    std::list<CachedBlur> mBlurCache GUARDED_BY(mRenderingMutex);
+    size_t mBlurCacheBytes GUARDED_BY(mRenderingMutex) = 0;
+    size_t mBlurCacheHits GUARDED_BY(mRenderingMutex) = 0;
+    size_t mBlurCacheMisses GUARDED_BY(mRenderingMutex) = 0;
+    static constexpr size_t kBlurCacheBudgetBytes = 8 * 1024 * 1024;
+
     StretchShaderFactory mStretchShaderFactory;
 
     sp<Fence> mLastDrawFence;
@@ -198,6 +287,11 @@ private:
     // Same as above, but for protected content (eg. DRM)
     sk_sp<GrDirectContext> mProtectedGrContext;
     bool mInProtectedContext = false;
+    // Same as mGrContext, but submitting to a lower priority queue. Textures and blurs made in
+    // mGrContext are not used in it, as they cannot be shared between contexts.
+    sk_sp<GrDirectContext> mBackgroundGrContext;
+    // Only set for the duration of a drawLayers call that renders in the background.
+    bool mInBackgroundContext = false;
 };
 
 } // namespace skia
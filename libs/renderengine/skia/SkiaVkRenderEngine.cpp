@@ -33,6 +33,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include <vulkan/vulkan.h>
@@ -72,6 +73,8 @@ struct VulkanInterface {
     VkPhysicalDevice physicalDevice;
     VkDevice device;
     VkQueue queue;
+    // A second queue of the same family with a lower priority, if requested and available.
+    VkQueue backgroundQueue = VK_NULL_HANDLE;
     int queueIndex;
     uint32_t apiVersion;
     GrVkExtensions grExtensions;
@@ -87,12 +90,12 @@ struct VulkanInterface {
     std::vector<std::string> instanceExtensionNames;
     std::vector<std::string> deviceExtensionNames;
 
-    GrVkBackendContext getBackendContext() {
+    GrVkBackendContext getBackendContext(bool background = false) {
         GrVkBackendContext backendContext;
         backendContext.fInstance = instance;
         backendContext.fPhysicalDevice = physicalDevice;
         backendContext.fDevice = device;
-        backendContext.fQueue = queue;
+        backendContext.fQueue = background ? backgroundQueue : queue;
         backendContext.fGraphicsQueueIndex = queueIndex;
         backendContext.fMaxAPIVersion = apiVersion;
         backendContext.fVkExtensions = &grExtensions;
@@ -211,7 +214,10 @@ static GrVkGetProc sGetProc = [](const char* proc_name, VkInstance instance, VkD
     PFN_vk##F vk##F = (PFN_vk##F)vkGetDeviceProcAddr(device, "vk" #F); \
     CHECK_NONNULL(vk##F)
 
-VulkanInterface initVulkanInterface(bool protectedContent = false) {
+// If backgroundQueuePriority is set, a second queue is created with that priority relative to the
+// main queue, provided that the graphics queue family has more than one queue.
+VulkanInterface initVulkanInterface(bool protectedContent = false,
+                                    std::optional<float> backgroundQueuePriority = std::nullopt) {
     VulkanInterface interface;
 
     VK_GET_PROC(EnumerateInstanceVersion);
@@ -432,7 +438,13 @@ VulkanInterface initVulkanInterface(bool protectedContent = false) {
     // Looks like this would slow things down and we can't depend on it on all platforms
     interface.physicalDeviceFeatures2->features.robustBufferAccess = VK_FALSE;
 
-    float queuePriorities[1] = {0.0f};
+    const bool createBackgroundQueue = backgroundQueuePriority &&
+            queueProps[graphicsQueueIndex].queueFamilyProperties.queueCount > 1;
+    float queuePriorities[2] = {0.0f, 0.0f};
+    if (createBackgroundQueue) {
+        queuePriorities[0] = 1.0f;
+        queuePriorities[1] = *backgroundQueuePriority;
+    }
     void* queueNextPtr = nullptr;
 
     VkDeviceQueueGlobalPriorityCreateInfoEXT queuePriorityCreateInfo = {
@@ -454,7 +466,7 @@ VulkanInterface initVulkanInterface(bool protectedContent = false) {
             queueNextPtr,
             deviceQueueCreateFlags,
             (uint32_t)graphicsQueueIndex,
-            1,
+            createBackgroundQueue ? 2u : 1u,
             queuePriorities,
     };
 
@@ -483,6 +495,14 @@ VulkanInterface initVulkanInterface(bool protectedContent = false) {
                                                  (uint32_t)graphicsQueueIndex, 0};
     vkGetDeviceQueue2(device, &deviceQueueInfo2, &graphicsQueue);
 
+    VkQueue backgroundQueue = VK_NULL_HANDLE;
+    if (createBackgroundQueue) {
+        const VkDeviceQueueInfo2 backgroundQueueInfo2 = {VK_STRUCTURE_TYPE_DEVICE_QUEUE_INFO_2,
+                                                         nullptr, deviceQueueCreateFlags,
+                                                         (uint32_t)graphicsQueueIndex, 1};
+        vkGetDeviceQueue2(device, &backgroundQueueInfo2, &backgroundQueue);
+    }
+
     VK_GET_DEV_PROC(device, DeviceWaitIdle);
     VK_GET_DEV_PROC(device, DestroyDevice);
     interface.funcs.vkDeviceWaitIdle = vkDeviceWaitIdle;
@@ -503,6 +523,7 @@ VulkanInterface initVulkanInterface(bool protectedContent = false) {
     interface.physicalDevice = physicalDevice;
     interface.device = device;
     interface.queue = graphicsQueue;
+    interface.backgroundQueue = backgroundQueue;
     interface.queueIndex = graphicsQueueIndex;
     interface.apiVersion = physDevProps.properties.apiVersion;
     // grExtensions already constructed
@@ -548,9 +569,10 @@ void teardownVulkanInterface(VulkanInterface* interface) {
 static VulkanInterface sVulkanInterface;
 static VulkanInterface sProtectedContentVulkanInterface;
 
-static void sSetupVulkanInterface() {
+static void sSetupVulkanInterface(std::optional<float> backgroundQueuePriority) {
     if (!sVulkanInterface.initialized) {
-        sVulkanInterface = initVulkanInterface(false /* no protected content */);
+        sVulkanInterface =
+                initVulkanInterface(false /* no protected content */, backgroundQueuePriority);
         // We will have to abort if non-protected VkDevice creation fails (then nothing works).
         LOG_ALWAYS_FATAL_IF(!sVulkanInterface.initialized,
                             "Could not initialize Vulkan RenderEngine!");
@@ -567,6 +589,23 @@ namespace skia {
 
 using base::StringAppendF;
 
+namespace {
+
+// The priority of the background queue relative to the main queue, which has the highest.
+float toQueuePriority(RenderEngine::ContextPriority priority) {
+    switch (priority) {
+        case RenderEngine::ContextPriority::LOW:
+            return 0.0f;
+        case RenderEngine::ContextPriority::MEDIUM:
+            return 0.5f;
+        case RenderEngine::ContextPriority::HIGH:
+        case RenderEngine::ContextPriority::REALTIME:
+            return 1.0f;
+    }
+}
+
+} // namespace
+
 bool SkiaVkRenderEngine::canSupportSkiaVkRenderEngine() {
     VulkanInterface temp = initVulkanInterface(false /* no protected content */);
     ALOGD("SkiaVkRenderEngine::canSupportSkiaVkRenderEngine(): initialized == %s.",
@@ -592,7 +631,9 @@ std::unique_ptr<SkiaVkRenderEngine> SkiaVkRenderEngine::create(
 
 SkiaVkRenderEngine::SkiaVkRenderEngine(const RenderEngineCreationArgs& args)
       : SkiaRenderEngine(args.renderEngineType, static_cast<PixelFormat>(args.pixelFormat),
-                         args.useColorManagement, args.supportsBackgroundBlur) {}
+                         args.useColorManagement, args.supportsBackgroundBlur,
+                         args.linearEffectCachePath),
+        mBackgroundContextPriority(args.backgroundContextPriority) {}
 
 SkiaVkRenderEngine::~SkiaVkRenderEngine() {
     finishRenderingAndAbandonContext();
@@ -600,7 +641,9 @@ SkiaVkRenderEngine::~SkiaVkRenderEngine() {
 
 SkiaRenderEngine::Contexts SkiaVkRenderEngine::createDirectContexts(
         const GrContextOptions& options) {
-    sSetupVulkanInterface();
+    sSetupVulkanInterface(mBackgroundContextPriority
+                                  ? std::make_optional(toQueuePriority(*mBackgroundContextPriority))
+                                  : std::nullopt);
 
     SkiaRenderEngine::Contexts contexts;
     contexts.first = GrDirectContext::MakeVulkan(sVulkanInterface.getBackendContext(), options);
@@ -613,6 +656,17 @@ SkiaRenderEngine::Contexts SkiaVkRenderEngine::createDirectContexts(
     return contexts;
 }
 
+sk_sp<GrDirectContext> SkiaVkRenderEngine::createBackgroundDirectContext(
+        const GrContextOptions& options) {
+    if (sVulkanInterface.backgroundQueue == VK_NULL_HANDLE) {
+        ALOGD_IF(mBackgroundContextPriority.has_value(),
+                 "No second graphics queue for the background context");
+        return nullptr;
+    }
+    return GrDirectContext::MakeVulkan(sVulkanInterface.getBackendContext(true /* background */),
+                                       options);
+}
+
 bool SkiaVkRenderEngine::supportsProtectedContentImpl() const {
     return sProtectedContentVulkanInterface.initialized;
 }
@@ -709,6 +763,8 @@ void SkiaVkRenderEngine::appendBackendSpecificInfoToDump(std::string& result) {
     StringAppendF(&result, "\n Vulkan device initialized: %d\n", sVulkanInterface.initialized);
     StringAppendF(&result, "\n Vulkan protected device initialized: %d\n",
                   sProtectedContentVulkanInterface.initialized);
+    StringAppendF(&result, "\n Vulkan background queue initialized: %d\n",
+                  sVulkanInterface.backgroundQueue != VK_NULL_HANDLE);
 
     if (!sVulkanInterface.initialized) {
         return;
@@ -38,6 +38,7 @@ protected:
     // Implementations of abstract SkiaRenderEngine functions specific to
     // rendering backend
     virtual SkiaRenderEngine::Contexts createDirectContexts(const GrContextOptions& options);
+    sk_sp<GrDirectContext> createBackgroundDirectContext(const GrContextOptions& options) override;
     bool supportsProtectedContentImpl() const override;
     bool useProtectedContextImpl(GrProtected isProtected) override;
     void waitFence(GrDirectContext* grContext, base::borrowed_fd fenceFd) override;
@@ -49,6 +50,7 @@ private:
     base::unique_fd flush();
 
     GrVkBackendContext mBackendContext;
+    const std::optional<RenderEngine::ContextPriority> mBackgroundContextPriority;
 };
 
 } // namespace skia
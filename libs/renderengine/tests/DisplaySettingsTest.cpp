@@ -66,4 +66,13 @@ TEST(DisplaySettingsTest, renderIntent) {
 
     ASSERT_FALSE(a == b);
 }
+
+TEST(DisplaySettingsTest, renderInBackground) {
+    DisplaySettings a, b;
+    ASSERT_EQ(a, b);
+
+    a.renderInBackground = true;
+
+    ASSERT_FALSE(a == b);
+}
 } // namespace android::renderengine
@@ -49,6 +49,18 @@ TEST_F(RenderEngineThreadedTest, dump) {
     mThreadedRE->dump(testString);
 }
 
+TEST_F(RenderEngineThreadedTest, dump_includesQueueDelay) {
+    EXPECT_CALL(*mRenderEngine, getContextPriority()).WillOnce(Return(1));
+    mThreadedRE->getContextPriority();
+
+    std::string result;
+    EXPECT_CALL(*mRenderEngine, dump(_));
+    mThreadedRE->dump(result);
+    EXPECT_NE(std::string::npos, result.find("getContextPriority"));
+    // Calls that were never made are not listed.
+    EXPECT_EQ(std::string::npos, result.find("drawLayers"));
+}
+
 TEST_F(RenderEngineThreadedTest, primeCache) {
     EXPECT_CALL(*mRenderEngine, primeCache());
     mThreadedRE->primeCache();
@@ -19,7 +19,9 @@
 #include "RenderEngineThreaded.h"
 
 #include <sched.h>
+#include <algorithm>
 #include <chrono>
+#include <cinttypes>
 #include <future>
 
 #include <android-base/stringprintf.h>
@@ -30,6 +32,7 @@
 #include "gl/GLESRenderEngine.h"
 
 using namespace std::chrono_literals;
+using android::base::StringAppendF;
 
 namespace android {
 namespace renderengine {
@@ -100,32 +103,89 @@ void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) NO_THREAD_S
     mInitializedCondition.notify_all();
 
     while (mRunning) {
-        const auto getNextTask = [this]() -> std::optional<Work> {
-            std::scoped_lock lock(mThreadMutex);
-            if (!mFunctionCalls.empty()) {
-                Work task = mFunctionCalls.front();
-                mFunctionCalls.pop();
-                return std::make_optional<Work>(task);
-            }
-            return std::nullopt;
-        };
-
-        const auto task = getNextTask();
-
-        if (task) {
-            (*task)(*mRenderEngine);
+        // Take all pending work at once, so that callers queueing work while it runs do not
+        // contend with the RenderEngine thread for each item. The items are moved rather than
+        // copied, as e.g. the work of drawLayers holds the layer settings of the whole frame.
+        std::queue<Work> tasks;
+        {
+            std::unique_lock<std::mutex> lock(mThreadMutex);
+            mCondition.wait(lock, [this]() REQUIRES(mThreadMutex) {
+                return !mRunning || !mFunctionCalls.empty();
+            });
+            tasks.swap(mFunctionCalls);
         }
 
-        std::unique_lock<std::mutex> lock(mThreadMutex);
-        mCondition.wait(lock, [this]() REQUIRES(mThreadMutex) {
-            return !mRunning || !mFunctionCalls.empty();
-        });
+        while (!tasks.empty()) {
+            Work& task = tasks.front();
+            recordQueueDelay(task.command, systemTime() - task.queueTime);
+            task.function(*mRenderEngine);
+            tasks.pop();
+        }
     }
 
     // we must release the RenderEngine on the thread that created it
     mRenderEngine.reset();
 }
 
+void RenderEngineThreaded::pushWork(Command command, Function&& function) const {
+    {
+        std::lock_guard lock(mThreadMutex);
+        mFunctionCalls.push({command, systemTime(), std::move(function)});
+    }
+    mCondition.notify_one();
+}
+
+void RenderEngineThreaded::recordQueueDelay(Command command, nsecs_t delay) {
+    QueueDelayStats& stats = mQueueDelayStats[static_cast<size_t>(command)];
+    stats.count++;
+    stats.totalDelay += delay;
+    stats.maxDelay = std::max(stats.maxDelay, delay);
+}
+
+void RenderEngineThreaded::dumpQueueDelayStats(std::string& result) const {
+    StringAppendF(&result, "RenderEngineThreaded queue delay (us)\n");
+    StringAppendF(&result, "%28s %10s %8s %8s\n", "command", "count", "mean", "max");
+    for (size_t i = 0; i < kCommandCount; i++) {
+        const QueueDelayStats& stats = mQueueDelayStats[i];
+        if (stats.count == 0) continue;
+        StringAppendF(&result, "%28s %10" PRIu64 " %8" PRId64 " %8" PRId64 "\n",
+                      commandName(static_cast<Command>(i)), stats.count,
+                      ns2us(stats.totalDelay / static_cast<nsecs_t>(stats.count)),
+                      ns2us(stats.maxDelay));
+    }
+}
+
+const char* RenderEngineThreaded::commandName(Command command) {
+    switch (command) {
+        case Command::PrimeCache:
+            return "primeCache";
+        case Command::Dump:
+            return "dump";
+        case Command::GenTextures:
+            return "genTextures";
+        case Command::DeleteTextures:
+            return "deleteTextures";
+        case Command::MapExternalTextureBuffer:
+            return "mapExternalTextureBuffer";
+        case Command::UnmapExternalTextureBuffer:
+            return "unmapExternalTextureBuffer";
+        case Command::CleanupPostRender:
+            return "cleanupPostRender";
+        case Command::DrawLayers:
+            return "drawLayers";
+        case Command::CleanFramebufferCache:
+            return "cleanFramebufferCache";
+        case Command::GetContextPriority:
+            return "getContextPriority";
+        case Command::OnActiveDisplaySizeChanged:
+            return "onActiveDisplaySizeChanged";
+        case Command::GetRenderEngineTid:
+            return "getRenderEngineTid";
+        case Command::SetEnableTracing:
+            return "setEnableTracing";
+    }
+}
+
 void RenderEngineThreaded::waitUntilInitialized() const {
     std::unique_lock<std::mutex> lock(mInitializedMutex);
     mInitializedCondition.wait(lock, [=] { return mIsInitialized; });
@@ -137,23 +197,19 @@ std::future<void> RenderEngineThreaded::primeCache() {
     ATRACE_CALL();
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([resultPromise](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::primeCache");
-            if (setSchedFifo(false) != NO_ERROR) {
-                ALOGW("Couldn't set SCHED_OTHER for primeCache");
-            }
-
-            instance.primeCache();
-            resultPromise->set_value();
-
-            if (setSchedFifo(true) != NO_ERROR) {
-                ALOGW("Couldn't set SCHED_FIFO for primeCache");
-            }
-        });
-    }
-    mCondition.notify_one();
+    pushWork(Command::PrimeCache, [resultPromise](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::primeCache");
+        if (setSchedFifo(false) != NO_ERROR) {
+            ALOGW("Couldn't set SCHED_OTHER for primeCache");
+        }
+
+        instance.primeCache();
+        resultPromise->set_value();
+
+        if (setSchedFifo(true) != NO_ERROR) {
+            ALOGW("Couldn't set SCHED_FIFO for primeCache");
+        }
+    });
 
     return resultFuture;
 }
@@ -161,16 +217,14 @@ std::future<void> RenderEngineThreaded::primeCache() {
 void RenderEngineThreaded::dump(std::string& result) {
     std::promise<std::string> resultPromise;
     std::future<std::string> resultFuture = resultPromise.get_future();
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&resultPromise, &result](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::dump");
-            std::string localResult = result;
-            instance.dump(localResult);
-            resultPromise.set_value(std::move(localResult));
-        });
-    }
-    mCondition.notify_one();
+    pushWork(Command::Dump, [this, &resultPromise, &result](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::dump");
+        std::string localResult = result;
+        instance.dump(localResult);
+        // The stats are only accessed on the RenderEngine thread.
+        dumpQueueDelayStats(localResult);
+        resultPromise.set_value(std::move(localResult));
+    });
     // Note: This is an rvalue.
     result.assign(resultFuture.get());
 }
@@ -183,15 +237,12 @@ void RenderEngineThreaded::genTextures(size_t count, uint32_t* names) {
     }
     std::promise<void> resultPromise;
     std::future<void> resultFuture = resultPromise.get_future();
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&resultPromise, count, names](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::genTextures");
-            instance.genTextures(count, names);
-            resultPromise.set_value();
-        });
-    }
-    mCondition.notify_one();
+    pushWork(Command::GenTextures,
+             [&resultPromise, count, names](renderengine::RenderEngine& instance) {
+                 ATRACE_NAME("REThreaded::genTextures");
+                 instance.genTextures(count, names);
+                 resultPromise.set_value();
+             });
     resultFuture.wait();
 }
 
@@ -203,15 +254,12 @@ void RenderEngineThreaded::deleteTextures(size_t count, uint32_t const* names) {
     }
     std::promise<void> resultPromise;
     std::future<void> resultFuture = resultPromise.get_future();
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&resultPromise, count, &names](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::deleteTextures");
-            instance.deleteTextures(count, names);
-            resultPromise.set_value();
-        });
-    }
-    mCondition.notify_one();
+    pushWork(Command::DeleteTextures,
+             [&resultPromise, count, &names](renderengine::RenderEngine& instance) {
+                 ATRACE_NAME("REThreaded::deleteTextures");
+                 instance.deleteTextures(count, names);
+                 resultPromise.set_value();
+             });
     resultFuture.wait();
 }
 
@@ -220,29 +268,21 @@ void RenderEngineThreaded::mapExternalTextureBuffer(const sp<GraphicBuffer>& buf
     ATRACE_CALL();
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([=](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::mapExternalTextureBuffer");
-            instance.mapExternalTextureBuffer(buffer, isRenderable);
-        });
-    }
-    mCondition.notify_one();
+    pushWork(Command::MapExternalTextureBuffer, [=](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::mapExternalTextureBuffer");
+        instance.mapExternalTextureBuffer(buffer, isRenderable);
+    });
 }
 
 void RenderEngineThreaded::unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer) {
     ATRACE_CALL();
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push(
-                [=, buffer = std::move(buffer)](renderengine::RenderEngine& instance) mutable {
-                    ATRACE_NAME("REThreaded::unmapExternalTextureBuffer");
-                    instance.unmapExternalTextureBuffer(std::move(buffer));
-                });
-    }
-    mCondition.notify_one();
+    pushWork(Command::UnmapExternalTextureBuffer,
+             [=, buffer = std::move(buffer)](renderengine::RenderEngine& instance) mutable {
+                 ATRACE_NAME("REThreaded::unmapExternalTextureBuffer");
+                 instance.unmapExternalTextureBuffer(std::move(buffer));
+             });
 }
 
 size_t RenderEngineThreaded::getMaxTextureSize() const {
@@ -267,14 +307,10 @@ void RenderEngineThreaded::cleanupPostRender() {
 
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([=](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::cleanupPostRender");
-            instance.cleanupPostRender();
-        });
-    }
-    mCondition.notify_one();
+    pushWork(Command::CleanupPostRender, [=](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::cleanupPostRender");
+        instance.cleanupPostRender();
+    });
 }
 
 bool RenderEngineThreaded::canSkipPostRenderCleanup() const {
@@ -299,17 +335,14 @@ ftl::Future<FenceResult> RenderEngineThreaded::drawLayers(
     const auto resultPromise = std::make_shared<std::promise<FenceResult>>();
     std::future<FenceResult> resultFuture = resultPromise->get_future();
     int fd = bufferFence.release();
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([resultPromise, display, layers, buffer, useFramebufferCache,
-                             fd](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::drawLayers");
-            instance.updateProtectedContext(layers, buffer);
-            instance.drawLayersInternal(std::move(resultPromise), display, layers, buffer,
-                                        useFramebufferCache, base::unique_fd(fd));
-        });
-    }
-    mCondition.notify_one();
+    pushWork(Command::DrawLayers,
+             [resultPromise, display, layers, buffer, useFramebufferCache,
+              fd](renderengine::RenderEngine& instance) {
+                 ATRACE_NAME("REThreaded::drawLayers");
+                 instance.updateProtectedContext(layers, buffer);
+                 instance.drawLayersInternal(std::move(resultPromise), display, layers, buffer,
+                                             useFramebufferCache, base::unique_fd(fd));
+             });
     return resultFuture;
 }
 
@@ -317,28 +350,20 @@ void RenderEngineThreaded::cleanFramebufferCache() {
     ATRACE_CALL();
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::cleanFramebufferCache");
-            instance.cleanFramebufferCache();
-        });
-    }
-    mCondition.notify_one();
+    pushWork(Command::CleanFramebufferCache, [](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::cleanFramebufferCache");
+        instance.cleanFramebufferCache();
+    });
 }
 
 int RenderEngineThreaded::getContextPriority() {
     std::promise<int> resultPromise;
     std::future<int> resultFuture = resultPromise.get_future();
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&resultPromise](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::getContextPriority");
-            int priority = instance.getContextPriority();
-            resultPromise.set_value(priority);
-        });
-    }
-    mCondition.notify_one();
+    pushWork(Command::GetContextPriority, [&resultPromise](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::getContextPriority");
+        int priority = instance.getContextPriority();
+        resultPromise.set_value(priority);
+    });
     return resultFuture.get();
 }
 
@@ -350,41 +375,28 @@ bool RenderEngineThreaded::supportsBackgroundBlur() {
 void RenderEngineThreaded::onActiveDisplaySizeChanged(ui::Size size) {
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([size](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::onActiveDisplaySizeChanged");
-            instance.onActiveDisplaySizeChanged(size);
-        });
-    }
-    mCondition.notify_one();
+    pushWork(Command::OnActiveDisplaySizeChanged, [size](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::onActiveDisplaySizeChanged");
+        instance.onActiveDisplaySizeChanged(size);
+    });
 }
 
 std::optional<pid_t> RenderEngineThreaded::getRenderEngineTid() const {
     std::promise<pid_t> tidPromise;
     std::future<pid_t> tidFuture = tidPromise.get_future();
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&tidPromise](renderengine::RenderEngine& instance) {
-            tidPromise.set_value(gettid());
-        });
-    }
-
-    mCondition.notify_one();
+    pushWork(Command::GetRenderEngineTid, [&tidPromise](renderengine::RenderEngine& instance) {
+        tidPromise.set_value(gettid());
+    });
     return std::make_optional(tidFuture.get());
 }
 
 void RenderEngineThreaded::setEnableTracing(bool tracingEnabled) {
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([tracingEnabled](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::setEnableTracing");
-            instance.setEnableTracing(tracingEnabled);
-        });
-    }
-    mCondition.notify_one();
+    pushWork(Command::SetEnableTracing, [tracingEnabled](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::setEnableTracing");
+        instance.setEnableTracing(tracingEnabled);
+    });
 }
 } // namespace threaded
 } // namespace renderengine
@@ -17,6 +17,8 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <utils/Timers.h>
+#include <array>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
@@ -33,7 +35,7 @@ using CreateInstanceFactory = std::function<std::unique_ptr<renderengine::Render
 /**
  * This class extends a basic RenderEngine class. It contains a thread. Each time a function of
  * this class is called, we create a lambda function that is put on a queue. The main thread then
- * executes the functions in order.
+ * executes the functions in order, and records how long each kind of call waited in the queue.
  */
 class RenderEngineThreaded : public RenderEngine {
 public:
@@ -78,7 +80,31 @@ protected:
                             const bool useFramebufferCache, base::unique_fd&& bufferFence) override;
 
 private:
+    // The calls that are forwarded to the RenderEngine thread.
+    enum class Command : size_t {
+        PrimeCache,
+        Dump,
+        GenTextures,
+        DeleteTextures,
+        MapExternalTextureBuffer,
+        UnmapExternalTextureBuffer,
+        CleanupPostRender,
+        DrawLayers,
+        CleanFramebufferCache,
+        GetContextPriority,
+        OnActiveDisplaySizeChanged,
+        GetRenderEngineTid,
+        SetEnableTracing,
+    };
+    static constexpr size_t kCommandCount = static_cast<size_t>(Command::SetEnableTracing) + 1;
+
+    using Function = std::function<void(renderengine::RenderEngine&)>;
+
     void threadMain(CreateInstanceFactory factory);
+    void pushWork(Command, Function&&) const EXCLUDES(mThreadMutex);
+    void recordQueueDelay(Command, nsecs_t delay);
+    void dumpQueueDelayStats(std::string& result) const;
+    static const char* commandName(Command);
     void waitUntilInitialized() const;
     static status_t setSchedFifo(bool enabled);
 
@@ -94,10 +120,23 @@ private:
     std::thread mThread GUARDED_BY(mThreadMutex);
     std::atomic<bool> mRunning = true;
 
-    using Work = std::function<void(renderengine::RenderEngine&)>;
+    struct Work {
+        Command command;
+        // When the work was queued, to measure how long it waited for the RenderEngine thread.
+        nsecs_t queueTime;
+        Function function;
+    };
     mutable std::queue<Work> mFunctionCalls GUARDED_BY(mThreadMutex);
     mutable std::condition_variable mCondition;
 
+    struct QueueDelayStats {
+        uint64_t count = 0;
+        nsecs_t totalDelay = 0;
+        nsecs_t maxDelay = 0;
+    };
+    // Only accessed on the RenderEngine thread.
+    std::array<QueueDelayStats, kCommandCount> mQueueDelayStats;
+
     // Used to allow select thread safe methods to be accessed without requiring the
     // method to be invoked on the RenderEngine thread
     bool mIsInitialized = false;
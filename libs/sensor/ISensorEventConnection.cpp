@@ -27,6 +27,7 @@
 #include <binder/IInterface.h>
 
 #include <sensor/BitTube.h>
+#include <sensor/SensorEventRing.h>
 
 namespace android {
 // ----------------------------------------------------------------------------
@@ -38,6 +39,7 @@ enum {
     FLUSH_SENSOR,
     CONFIGURE_CHANNEL,
     DESTROY,
+    GET_SENSOR_EVENT_RING,
 };
 
 class BpSensorEventConnection : public BpInterface<ISensorEventConnection>
@@ -98,6 +100,20 @@ public:
         return reply.readInt32();
     }
 
+    virtual sp<SensorEventRing> getSensorEventRing() {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISensorEventConnection::getInterfaceDescriptor());
+        if (remote()->transact(GET_SENSOR_EVENT_RING, data, &reply) != NO_ERROR ||
+            reply.readInt32() != NO_ERROR) {
+            return nullptr;
+        }
+        base::unique_fd fd;
+        if (reply.readUniqueFileDescriptor(&fd) != NO_ERROR) {
+            return nullptr;
+        }
+        return SensorEventRing::fromFd(std::move(fd));
+    }
+
     virtual void onLastStrongRef(const void* id) {
         destroy();
         BpInterface<ISensorEventConnection>::onLastStrongRef(id);
@@ -166,6 +182,16 @@ status_t BnSensorEventConnection::onTransact(
             destroy();
             return NO_ERROR;
         }
+        case GET_SENSOR_EVENT_RING: {
+            CHECK_INTERFACE(ISensorEventConnection, data, reply);
+            sp<SensorEventRing> ring(getSensorEventRing());
+            if (ring == nullptr) {
+                reply->writeInt32(NAME_NOT_FOUND);
+                return NO_ERROR;
+            }
+            reply->writeInt32(NO_ERROR);
+            return reply->writeDupFileDescriptor(ring->getFd());
+        }
 
     }
     return BBinder::onTransact(code, data, reply, flags);
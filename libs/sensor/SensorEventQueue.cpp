@@ -27,6 +27,7 @@
 #include <sensor/Sensor.h>
 #include <sensor/BitTube.h>
 #include <sensor/ISensorEventConnection.h>
+#include <sensor/SensorEventRing.h>
 
 #include <android/sensor.h>
 #include <hardware/sensors-base.h>
@@ -50,6 +51,7 @@ SensorEventQueue::~SensorEventQueue() {
 void SensorEventQueue::onFirstRef()
 {
     mSensorChannel = mSensorEventConnection->getSensorChannel();
+    mEventRing = mSensorEventConnection->getSensorEventRing();
 }
 
 int SensorEventQueue::getFd() const
@@ -64,6 +66,9 @@ ssize_t SensorEventQueue::write(const sp<BitTube>& tube,
 }
 
 ssize_t SensorEventQueue::read(ASensorEvent* events, size_t numEvents) {
+    if (mEventRing != nullptr) {
+        return readFromRing(events, numEvents);
+    }
     if (mAvailable == 0) {
         ssize_t err = BitTube::recvObjects(mSensorChannel,
                 mRecBuffer, MAX_RECEIVE_BUFFER_EVENT_COUNT);
@@ -80,6 +85,32 @@ ssize_t SensorEventQueue::read(ASensorEvent* events, size_t numEvents) {
     return static_cast<ssize_t>(count);
 }
 
+ssize_t SensorEventQueue::readFromRing(ASensorEvent* events, size_t numEvents) {
+    bool needsDoorbell;
+    size_t count = mEventRing->read(events, numEvents, &needsDoorbell);
+    if (count == 0 && mEventRing->setReaderWaiting()) {
+        // The ring is empty, consume the doorbells that woke us up so that the fd isn't readable
+        // until new events are written.
+        uint8_t doorbells[16];
+        ssize_t err;
+        while ((err = BitTube::recvObjects(mSensorChannel, doorbells, sizeof(doorbells))) > 0) {
+        }
+        return err;
+    }
+    if (count == 0) {
+        // Events were written while we announced that we were waiting.
+        count = mEventRing->read(events, numEvents, &needsDoorbell);
+    }
+    if (needsDoorbell) {
+        const SensorEventRing::RoomAvailableMessage message =
+                SensorEventRing::kRoomAvailableMessage;
+        ssize_t size = ::send(mSensorChannel->getFd(), &message, sizeof(message),
+                MSG_DONTWAIT | MSG_NOSIGNAL);
+        ALOGE_IF(size < 0, "SensorEventQueue: can't notify the writer (%s)", strerror(errno));
+    }
+    return static_cast<ssize_t>(count);
+}
+
 sp<Looper> SensorEventQueue::getLooper() const
 {
     Mutex::Autolock _l(mLock);
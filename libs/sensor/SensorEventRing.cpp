@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Sensors"
+
+#include <sensor/SensorEventRing.h>
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include <android/sensor.h>
+#include <cutils/ashmem.h>
+#include <log/log.h>
+
+namespace android {
+// ----------------------------------------------------------------------------
+
+static constexpr uint32_t SENSOR_EVENT_RING_MAGIC = 0x53455652; // 'SEVR'
+
+// Keeps the indices well below the range where wrapping around would be ambiguous.
+static constexpr size_t MAX_SENSOR_EVENT_RING_CAPACITY = 1U << 20;
+
+struct SensorEventRing::Header {
+    uint32_t magic;
+    uint32_t capacity;
+    // Written by the writer only.
+    alignas(64) std::atomic<uint32_t> writeIndex;
+    // Set by the writer when the ring is full, cleared by the reader when it makes room.
+    std::atomic<uint32_t> writerWaiting;
+    // Written by the reader only.
+    alignas(64) std::atomic<uint32_t> readIndex;
+    // Set by the reader before it goes to sleep, cleared by the writer when it rings the doorbell.
+    std::atomic<uint32_t> readerWaiting;
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "ring indices must be usable across processes");
+
+size_t SensorEventRing::getEventsOffset() {
+    return (sizeof(Header) + 63) & ~size_t(63);
+}
+
+size_t SensorEventRing::getSize(size_t capacity) {
+    return getEventsOffset() + capacity * sizeof(ASensorEvent);
+}
+
+sp<SensorEventRing> SensorEventRing::create(size_t capacity) {
+    if (capacity == 0 || capacity > MAX_SENSOR_EVENT_RING_CAPACITY) {
+        ALOGE("SensorEventRing: invalid capacity %zu", capacity);
+        return nullptr;
+    }
+    size_t roundedCapacity = 1;
+    while (roundedCapacity < capacity) {
+        roundedCapacity <<= 1;
+    }
+
+    base::unique_fd fd(ashmem_create_region("SensorEventRing", getSize(roundedCapacity)));
+    if (!fd.ok()) {
+        ALOGE("SensorEventRing: can't create shared memory (%s)", strerror(errno));
+        return nullptr;
+    }
+    sp<SensorEventRing> ring = map(std::move(fd), roundedCapacity);
+    if (ring != nullptr) {
+        ring->mHeader->magic = SENSOR_EVENT_RING_MAGIC;
+        ring->mHeader->capacity = static_cast<uint32_t>(roundedCapacity);
+        // The reader waits on its looper before its first read, so the first events must ring the
+        // doorbell.
+        ring->mHeader->readerWaiting.store(1, std::memory_order_relaxed);
+    }
+    return ring;
+}
+
+sp<SensorEventRing> SensorEventRing::fromFd(base::unique_fd fd) {
+    const int size = ashmem_get_size_region(fd.get());
+    if (size < 0 || static_cast<size_t>(size) < getSize(1)) {
+        ALOGE("SensorEventRing: shared memory is too small (%d)", size);
+        return nullptr;
+    }
+    // The header is read once the region is mapped, derive the capacity from the size until then.
+    const size_t capacity = (static_cast<size_t>(size) - getEventsOffset()) / sizeof(ASensorEvent);
+    sp<SensorEventRing> ring = map(std::move(fd), capacity);
+    if (ring == nullptr) {
+        return nullptr;
+    }
+    if (ring->mHeader->magic != SENSOR_EVENT_RING_MAGIC || ring->mHeader->capacity != capacity ||
+        (capacity & (capacity - 1)) != 0) {
+        ALOGE("SensorEventRing: invalid header (magic %#x, capacity %u)", ring->mHeader->magic,
+              ring->mHeader->capacity);
+        return nullptr;
+    }
+    return ring;
+}
+
+sp<SensorEventRing> SensorEventRing::map(base::unique_fd fd, size_t capacity) {
+    const size_t size = getSize(capacity);
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (address == MAP_FAILED) {
+        ALOGE("SensorEventRing: can't map shared memory (%s)", strerror(errno));
+        return nullptr;
+    }
+    return sp<SensorEventRing>(new SensorEventRing(std::move(fd), address, size, capacity));
+}
+
+SensorEventRing::SensorEventRing(base::unique_fd fd, void* address, size_t size,
+                                 size_t capacity)
+    : mFd(std::move(fd)), mHeader(static_cast<Header*>(address)), mSize(size),
+      mCapacity(capacity) {}
+
+SensorEventRing::~SensorEventRing() {
+    munmap(mHeader, mSize);
+}
+
+ASensorEvent* SensorEventRing::getEvents() const {
+    return reinterpret_cast<ASensorEvent*>(reinterpret_cast<uint8_t*>(mHeader) +
+                                           getEventsOffset());
+}
+
+bool SensorEventRing::write(ASensorEvent const* events, size_t count, bool* needsDoorbell) {
+    *needsDoorbell = false;
+    const uint32_t head = mHeader->writeIndex.load(std::memory_order_relaxed);
+    const uint32_t used = head - mHeader->readIndex.load(std::memory_order_acquire);
+    if (used > mCapacity || count > mCapacity - used) {
+        // Full, or corrupted by the reader. Either way, the reader has to catch up first.
+        return false;
+    }
+
+    const size_t start = head & (mCapacity - 1);
+    const size_t firstCount = std::min(count, mCapacity - start);
+    memcpy(getEvents() + start, events, firstCount * sizeof(ASensorEvent));
+    memcpy(getEvents(), events + firstCount, (count - firstCount) * sizeof(ASensorEvent));
+    mHeader->writeIndex.store(head + static_cast<uint32_t>(count), std::memory_order_release);
+
+    // Pairs with the fence in setReaderWaiting: either the reader sees the new events before going
+    // to sleep, or we see that it is waiting and wake it up.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    *needsDoorbell = mHeader->readerWaiting.exchange(0, std::memory_order_seq_cst) != 0;
+    return true;
+}
+
+bool SensorEventRing::setWriterWaiting(size_t count) {
+    mHeader->writerWaiting.store(1, std::memory_order_seq_cst);
+    // Pairs with the fence in read: either we see the room the reader made, or the reader sees
+    // that we are waiting and tells us.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const uint32_t used = mHeader->writeIndex.load(std::memory_order_relaxed) -
+            mHeader->readIndex.load(std::memory_order_seq_cst);
+    return used <= mCapacity && count <= mCapacity - used;
+}
+
+size_t SensorEventRing::read(ASensorEvent* events, size_t count, bool* needsDoorbell) {
+    *needsDoorbell = false;
+    const uint32_t tail = mHeader->readIndex.load(std::memory_order_relaxed);
+    const uint32_t available = mHeader->writeIndex.load(std::memory_order_acquire) - tail;
+    if (available > mCapacity) {
+        ALOGE("SensorEventRing: invalid indices, %u events available", available);
+        return 0;
+    }
+    count = std::min(count, static_cast<size_t>(available));
+    if (count == 0) {
+        return 0;
+    }
+
+    const size_t start = tail & (mCapacity - 1);
+    const size_t firstCount = std::min(count, mCapacity - start);
+    memcpy(events, getEvents() + start, firstCount * sizeof(ASensorEvent));
+    memcpy(events + firstCount, getEvents(), (count - firstCount) * sizeof(ASensorEvent));
+    mHeader->readIndex.store(tail + static_cast<uint32_t>(count), std::memory_order_release);
+
+    // Pairs with the fence in setWriterWaiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    *needsDoorbell = mHeader->writerWaiting.exchange(0, std::memory_order_seq_cst) != 0;
+    return count;
+}
+
+bool SensorEventRing::setReaderWaiting() {
+    mHeader->readerWaiting.store(1, std::memory_order_seq_cst);
+    // Pairs with the fence in write.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mHeader->writeIndex.load(std::memory_order_seq_cst) !=
+        mHeader->readIndex.load(std::memory_order_relaxed)) {
+        mHeader->readerWaiting.store(0, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+}; // namespace android
@@ -43,6 +43,7 @@ namespace android {
 
 class ISensorEventConnection;
 class Sensor;
+class SensorEventRing;
 class Looper;
 
 // ----------------------------------------------------------------------------
@@ -102,8 +103,11 @@ public:
 
 private:
     sp<Looper> getLooper() const;
+    ssize_t readFromRing(ASensorEvent* events, size_t numEvents);
     sp<ISensorEventConnection> mSensorEventConnection;
     sp<BitTube> mSensorChannel;
+    // When set, the events are read from this ring and mSensorChannel only carries doorbells.
+    sp<SensorEventRing> mEventRing;
     mutable Mutex mLock;
     mutable sp<Looper> mLooper;
     ASensorEvent* mRecBuffer;
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <android-base/unique_fd.h>
+#include <utils/RefBase.h>
+
+struct ASensorEvent;
+
+namespace android {
+// ----------------------------------------------------------------------------
+
+/*
+ * A single producer, single consumer ring of sensor events in shared memory.
+ *
+ * SensorService writes the events of a SensorEventConnection to the ring, and the SensorEventQueue
+ * of the client reads them, without copying each event through the BitTube socket. The BitTube is
+ * still used to wake up the other end, which is what the loopers of the clients wait on:
+ *  - the writer sends a doorbell when the reader announced that it is about to wait,
+ *  - the reader sends kRoomAvailableMessage when the writer announced that the ring was full.
+ *
+ * The writer never overwrites events that weren't read, a full ring makes write() fail instead.
+ */
+class SensorEventRing : public RefBase
+{
+public:
+    // Sent by the reader over the BitTube when it made room in the ring while the writer was
+    // waiting. Its size tells it apart from the other messages the client sends.
+    typedef uint64_t RoomAvailableMessage;
+    static constexpr RoomAvailableMessage kRoomAvailableMessage = 1;
+
+    // Create a ring which holds at least capacity events, rounded up to a power of two.
+    static sp<SensorEventRing> create(size_t capacity);
+
+    // Map a ring created by another process.
+    static sp<SensorEventRing> fromFd(base::unique_fd fd);
+
+    virtual ~SensorEventRing();
+
+    int getFd() const { return mFd.get(); }
+    size_t getCapacity() const { return mCapacity; }
+
+    // Writer side. All the events are written, or none if there isn't enough room left. Sets
+    // needsDoorbell if the reader is waiting and has to be woken up.
+    bool write(ASensorEvent const* events, size_t count, bool* needsDoorbell);
+
+    // Writer side. Announce that an earlier write() failed. Returns true if the reader made room for
+    // count events in the meantime, otherwise the reader will send kRoomAvailableMessage once it
+    // reads more events.
+    bool setWriterWaiting(size_t count);
+
+    // Reader side. Returns the number of events read, 0 if the ring is empty. Sets needsDoorbell if
+    // the writer is waiting for room and has to be told about it.
+    size_t read(ASensorEvent* events, size_t count, bool* needsDoorbell);
+
+    // Reader side. Announce that the reader is about to wait for a doorbell. Returns false if
+    // events were written in the meantime, in which case the reader shouldn't wait.
+    bool setReaderWaiting();
+
+private:
+    struct Header;
+
+    SensorEventRing(base::unique_fd fd, void* address, size_t size, size_t capacity);
+
+    static sp<SensorEventRing> map(base::unique_fd fd, size_t capacity);
+
+    static size_t getEventsOffset();
+    static size_t getSize(size_t capacity);
+
+    ASensorEvent* getEvents() const;
+
+    base::unique_fd mFd;
+    Header* mHeader;
+    size_t mSize;
+    size_t mCapacity;
+};
+
+// ----------------------------------------------------------------------------
+}; // namespace android
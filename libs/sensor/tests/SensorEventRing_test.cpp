@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <android/sensor.h>
+#include <sensor/SensorEventRing.h>
+
+namespace android {
+
+namespace {
+
+std::vector<ASensorEvent> makeEvents(size_t count, int64_t firstTimestamp) {
+    std::vector<ASensorEvent> events(count);
+    for (size_t i = 0; i < count; i++) {
+        events[i].timestamp = firstTimestamp + static_cast<int64_t>(i);
+    }
+    return events;
+}
+
+// Maps the ring the way the client does, from a duplicate of its fd.
+sp<SensorEventRing> openReader(const sp<SensorEventRing>& writer) {
+    return SensorEventRing::fromFd(base::unique_fd(dup(writer->getFd())));
+}
+
+} // namespace
+
+TEST(SensorEventRingTest, CapacityIsRoundedUpToPowerOfTwo) {
+    sp<SensorEventRing> ring = SensorEventRing::create(100);
+    ASSERT_NE(nullptr, ring);
+    EXPECT_EQ(128u, ring->getCapacity());
+
+    sp<SensorEventRing> reader = openReader(ring);
+    ASSERT_NE(nullptr, reader);
+    EXPECT_EQ(128u, reader->getCapacity());
+}
+
+TEST(SensorEventRingTest, EventsAreReadInOrderAcrossTheWrapAround) {
+    sp<SensorEventRing> writer = SensorEventRing::create(8);
+    ASSERT_NE(nullptr, writer);
+    sp<SensorEventRing> reader = openReader(writer);
+    ASSERT_NE(nullptr, reader);
+
+    bool needsDoorbell;
+    ASensorEvent received[8];
+    int64_t timestamp = 0;
+    for (int round = 0; round < 5; round++) {
+        std::vector<ASensorEvent> events = makeEvents(5, timestamp);
+        ASSERT_TRUE(writer->write(events.data(), events.size(), &needsDoorbell));
+        ASSERT_EQ(5u, reader->read(received, 8, &needsDoorbell));
+        for (size_t i = 0; i < 5; i++) {
+            EXPECT_EQ(timestamp++, received[i].timestamp);
+        }
+    }
+    EXPECT_EQ(0u, reader->read(received, 8, &needsDoorbell));
+}
+
+TEST(SensorEventRingTest, FullRingRejectsWritesUntilReaderMakesRoom) {
+    sp<SensorEventRing> writer = SensorEventRing::create(8);
+    ASSERT_NE(nullptr, writer);
+    sp<SensorEventRing> reader = openReader(writer);
+    ASSERT_NE(nullptr, reader);
+
+    bool needsDoorbell;
+    std::vector<ASensorEvent> events = makeEvents(6, 0);
+    ASSERT_TRUE(writer->write(events.data(), events.size(), &needsDoorbell));
+    // Writes are all or nothing.
+    EXPECT_FALSE(writer->write(events.data(), 3, &needsDoorbell));
+    EXPECT_FALSE(writer->setWriterWaiting(3));
+
+    ASensorEvent received[4];
+    ASSERT_EQ(4u, reader->read(received, 4, &needsDoorbell));
+    // The reader has to tell the writer that there is room now.
+    EXPECT_TRUE(needsDoorbell);
+    EXPECT_TRUE(writer->write(events.data(), 3, &needsDoorbell));
+}
+
+TEST(SensorEventRingTest, DoorbellOnlyRingsWhenReaderIsWaiting) {
+    sp<SensorEventRing> writer = SensorEventRing::create(8);
+    ASSERT_NE(nullptr, writer);
+    sp<SensorEventRing> reader = openReader(writer);
+    ASSERT_NE(nullptr, reader);
+
+    bool needsDoorbell;
+    std::vector<ASensorEvent> events = makeEvents(2, 0);
+    // The reader waits for its first events.
+    ASSERT_TRUE(writer->write(events.data(), 1, &needsDoorbell));
+    EXPECT_TRUE(needsDoorbell);
+    ASSERT_TRUE(writer->write(events.data(), 1, &needsDoorbell));
+    EXPECT_FALSE(needsDoorbell);
+
+    // Events are pending, so the reader must not wait.
+    EXPECT_FALSE(reader->setReaderWaiting());
+    ASensorEvent received[2];
+    ASSERT_EQ(2u, reader->read(received, 2, &needsDoorbell));
+    EXPECT_TRUE(reader->setReaderWaiting());
+
+    ASSERT_TRUE(writer->write(events.data(), 2, &needsDoorbell));
+    EXPECT_TRUE(needsDoorbell);
+}
+
+TEST(SensorEventRingTest, RejectsInvalidCapacity) {
+    EXPECT_EQ(nullptr, SensorEventRing::create(0));
+}
+
+} // namespace android
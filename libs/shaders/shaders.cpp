@@ -20,6 +20,7 @@
 
 #include <cmath>
 #include <optional>
+#include <string_view>
 
 #include <math/mat4.h>
 #include <system/graphics-base-v1.0.h>
@@ -33,8 +34,9 @@ aidl::android::hardware::graphics::common::Dataspace toAidlDataspace(ui::Dataspa
     return static_cast<aidl::android::hardware::graphics::common::Dataspace>(dataspace);
 }
 
-void generateXYZTransforms(std::string& shader) {
-    shader.append(R"(
+// The shader is put together from constant fragments, which are concatenated at once in
+// buildLinearEffectSkSL, so that building it does not reallocate the string for every fragment.
+constexpr std::string_view kXYZTransforms = R"(
         uniform float3x3 in_rgbToXyz;
         uniform float3x3 in_xyzToSrcRgb;
         uniform float4x4 in_colorTransform;
@@ -49,54 +51,48 @@ void generateXYZTransforms(std::string& shader) {
         float3 ApplyColorTransform(float3 rgb) {
             return (in_colorTransform * float4(rgb, 1.0)).rgb;
         }
-    )");
-}
+    )";
 
 // Conversion from relative light to absolute light
 // Note that 1.0 == 203 nits.
-void generateLuminanceScalesForOOTF(ui::Dataspace inputDataspace, std::string& shader) {
+std::string_view getLuminanceScalesForOOTF(ui::Dataspace inputDataspace) {
     switch (inputDataspace & HAL_DATASPACE_TRANSFER_MASK) {
         case HAL_DATASPACE_TRANSFER_HLG:
             // BT. 2408 says that a signal level of 0.75 == 203 nits for HLG, but that's after
             // applying OOTF. But we haven't applied OOTF yet, so we need to scale by a different
             // constant instead.
-            shader.append(R"(
+            return R"(
                 float3 ScaleLuminance(float3 xyz) {
                     return xyz * 264.96;
                 }
-            )");
-            break;
+            )";
         default:
-            shader.append(R"(
+            return R"(
                 float3 ScaleLuminance(float3 xyz) {
                     return xyz * 203.0;
                 }
-            )");
-            break;
+            )";
     }
 }
 
 // Normalizes from absolute light back to relative light (maps from [0, maxNits] back to [0, 1])
-static void generateLuminanceNormalizationForOOTF(ui::Dataspace inputDataspace,
-                                                  ui::Dataspace outputDataspace,
-                                                  std::string& shader) {
+std::string_view getLuminanceNormalizationForOOTF(ui::Dataspace inputDataspace,
+                                                  ui::Dataspace outputDataspace) {
     switch (outputDataspace & HAL_DATASPACE_TRANSFER_MASK) {
         case HAL_DATASPACE_TRANSFER_ST2084:
-            shader.append(R"(
+            return R"(
                 float3 NormalizeLuminance(float3 xyz) {
                     return xyz / 203.0;
                 }
-            )");
-            break;
+            )";
         case HAL_DATASPACE_TRANSFER_HLG:
             switch (inputDataspace & HAL_DATASPACE_TRANSFER_MASK) {
                 case HAL_DATASPACE_TRANSFER_HLG:
-                    shader.append(R"(
+                    return R"(
                             float3 NormalizeLuminance(float3 xyz) {
                                 return xyz / 264.96;
                             }
-                        )");
-                    break;
+                        )";
                 default:
                     // Transcoding to HLG requires applying the inverse OOTF
                     // with the expectation that the OOTF is then applied during
@@ -107,53 +103,39 @@ static void generateLuminanceNormalizationForOOTF(ui::Dataspace inputDataspace,
                     // rather than 203 nits, because 203 nits == OOTF(invOETF(0.75)), so even though
                     // we originally scaled by 203 nits we need to re-normalize to 264.96 nits when
                     // converting to the correct brightness range.
-                    shader.append(R"(
+                    return R"(
                             float3 NormalizeLuminance(float3 xyz) {
                                 float ootfGain = pow(xyz.y / 1000.0, -0.2 / 1.2);
                                 return xyz * ootfGain / 264.96;
                             }
-                        )");
-                    break;
+                        )";
             }
-            break;
         default:
             switch (inputDataspace & HAL_DATASPACE_TRANSFER_MASK) {
                 case HAL_DATASPACE_TRANSFER_HLG:
                 case HAL_DATASPACE_TRANSFER_ST2084:
                     // libtonemap outputs a range [0, in_libtonemap_displayMaxLuminance], so
                     // normalize back to [0, 1] when the output is SDR.
-                    shader.append(R"(
+                    return R"(
                         float3 NormalizeLuminance(float3 xyz) {
                             return xyz / in_libtonemap_displayMaxLuminance;
                         }
-                    )");
-                    break;
+                    )";
                 default:
                     // Otherwise normalize back down to the range [0, 1]
                     // TODO: get this working for extended range outputs
-                    shader.append(R"(
+                    return R"(
                         float3 NormalizeLuminance(float3 xyz) {
                             return xyz / 203.0;
                         }
-                    )");
-                    break;
+                    )";
             }
     }
 }
 
-void generateOOTF(ui::Dataspace inputDataspace, ui::Dataspace outputDataspace,
-                  std::string& shader) {
-    shader.append(tonemap::getToneMapper()
-                          ->generateTonemapGainShaderSkSL(toAidlDataspace(inputDataspace),
-                                                          toAidlDataspace(outputDataspace))
-                          .c_str());
-
-    generateLuminanceScalesForOOTF(inputDataspace, shader);
-    generateLuminanceNormalizationForOOTF(inputDataspace, outputDataspace, shader);
-
-    // Some tonemappers operate on CIE luminance, other tonemappers operate on linear rgb
-    // luminance in the source gamut.
-    shader.append(R"(
+// Some tonemappers operate on CIE luminance, other tonemappers operate on linear rgb
+// luminance in the source gamut.
+constexpr std::string_view kOOTF = R"(
             float3 OOTF(float3 linearRGB) {
                 float3 scaledLinearRGB = ScaleLuminance(linearRGB);
                 float3 scaledXYZ = ToXYZ(scaledLinearRGB);
@@ -162,63 +144,44 @@ void generateOOTF(ui::Dataspace inputDataspace, ui::Dataspace outputDataspace,
 
                 return NormalizeLuminance(scaledXYZ * gain);
             }
-        )");
-}
+        )";
 
-void generateOETF(std::string& shader) {
-    // Only support gamma 2.2 for now
-    shader.append(R"(
+// Only support gamma 2.2 for now
+constexpr std::string_view kOETF = R"(
         float3 OETF(float3 linear) {
             return sign(linear) * pow(abs(linear), float3(1.0 / 2.2));
         }
-    )");
-}
+    )";
 
-void generateEffectiveOOTF(bool undoPremultipliedAlpha, LinearEffect::SkSLType type,
-                           bool needsCustomOETF, std::string& shader) {
-    switch (type) {
-        case LinearEffect::SkSLType::ColorFilter:
-            shader.append(R"(
+constexpr std::string_view kColorFilterMain = R"(
                 half4 main(half4 inputColor) {
                     float4 c = float4(inputColor);
-            )");
-            break;
-        case LinearEffect::SkSLType::Shader:
-            shader.append(R"(
+            )";
+constexpr std::string_view kShaderMain = R"(
                 uniform shader child;
                 half4 main(float2 xy) {
                     float4 c = float4(child.eval(xy));
-            )");
-            break;
-    }
-    if (undoPremultipliedAlpha) {
-        shader.append(R"(
+            )";
+constexpr std::string_view kUnpremultiply = R"(
             c.rgb = c.rgb / (c.a + 0.0019);
-        )");
-    }
-    // We are using linear sRGB as a working space, with 1.0 == 203 nits
-    shader.append(R"(
+        )";
+// We are using linear sRGB as a working space, with 1.0 == 203 nits
+constexpr std::string_view kApplyOOTF = R"(
         c.rgb = ApplyColorTransform(OOTF(toLinearSrgb(c.rgb)));
-    )");
-    if (needsCustomOETF) {
-        shader.append(R"(
+    )";
+constexpr std::string_view kApplyCustomOETF = R"(
             c.rgb = OETF(c.rgb);
-        )");
-    } else {
-        shader.append(R"(
+        )";
+constexpr std::string_view kApplyOETF = R"(
             c.rgb = fromLinearSrgb(c.rgb);
-        )");
-    }
-    if (undoPremultipliedAlpha) {
-        shader.append(R"(
+        )";
+constexpr std::string_view kPremultiply = R"(
             c.rgb = c.rgb * (c.a + 0.0019);
-        )");
-    }
-    shader.append(R"(
+        )";
+constexpr std::string_view kReturn = R"(
             return c;
         }
-    )");
-}
+    )";
 
 template <typename T, std::enable_if_t<std::is_trivially_copyable<T>::value, bool> = true>
 std::vector<uint8_t> buildUniformValue(T value) {
@@ -231,17 +194,40 @@ std::vector<uint8_t> buildUniformValue(T value) {
 } // namespace
 
 std::string buildLinearEffectSkSL(const LinearEffect& linearEffect) {
-    std::string shaderString;
-    generateXYZTransforms(shaderString);
-    generateOOTF(linearEffect.inputDataspace, linearEffect.outputDataspace, shaderString);
-
+    const std::string toneMapperSkSL =
+            tonemap::getToneMapper()
+                    ->generateTonemapGainShaderSkSL(toAidlDataspace(linearEffect.inputDataspace),
+                                                    toAidlDataspace(linearEffect.outputDataspace));
     const bool needsCustomOETF = (linearEffect.fakeOutputDataspace & HAL_DATASPACE_TRANSFER_MASK) ==
             HAL_DATASPACE_TRANSFER_GAMMA2_2;
-    if (needsCustomOETF) {
-        generateOETF(shaderString);
+    const bool undoPremultipliedAlpha = linearEffect.undoPremultipliedAlpha;
+
+    const std::string_view fragments[] = {
+            kXYZTransforms,
+            std::string_view(toneMapperSkSL.c_str()),
+            getLuminanceScalesForOOTF(linearEffect.inputDataspace),
+            getLuminanceNormalizationForOOTF(linearEffect.inputDataspace,
+                                             linearEffect.outputDataspace),
+            kOOTF,
+            needsCustomOETF ? kOETF : std::string_view(),
+            linearEffect.type == LinearEffect::SkSLType::ColorFilter ? kColorFilterMain
+                                                                      : kShaderMain,
+            undoPremultipliedAlpha ? kUnpremultiply : std::string_view(),
+            kApplyOOTF,
+            needsCustomOETF ? kApplyCustomOETF : kApplyOETF,
+            undoPremultipliedAlpha ? kPremultiply : std::string_view(),
+            kReturn,
+    };
+
+    size_t size = 0;
+    for (const auto fragment : fragments) {
+        size += fragment.size();
+    }
+    std::string shaderString;
+    shaderString.reserve(size);
+    for (const auto fragment : fragments) {
+        shaderString.append(fragment);
     }
-    generateEffectiveOOTF(linearEffect.undoPremultipliedAlpha, linearEffect.type, needsCustomOETF,
-                          shaderString);
     return shaderString;
 }
 
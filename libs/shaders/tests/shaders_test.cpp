@@ -26,6 +26,7 @@ namespace android {
 
 using testing::Contains;
 using testing::HasSubstr;
+using testing::Not;
 
 struct ShadersTest : public ::testing::Test {};
 
@@ -93,4 +94,26 @@ TEST_F(ShadersTest, buildLinearEffectUniforms_selectsGamutTransformMatrices) {
     EXPECT_THAT(uniforms, Contains(UniformNameEq("in_colorTransform")));
 }
 
+TEST_F(ShadersTest, buildLinearEffectSkSL_selectsOETFAndPremultiplication) {
+    const auto premultipliedSkSL = shaders::buildLinearEffectSkSL(
+            shaders::LinearEffect{.inputDataspace = ui::Dataspace::BT2020_ITU_PQ,
+                                  .outputDataspace = ui::Dataspace::V0_SRGB_LINEAR,
+                                  .undoPremultipliedAlpha = true,
+                                  .fakeOutputDataspace = ui::Dataspace::UNKNOWN});
+    EXPECT_THAT(premultipliedSkSL, HasSubstr("uniform shader child;"));
+    EXPECT_THAT(premultipliedSkSL, HasSubstr("c.rgb = c.rgb / (c.a + 0.0019);"));
+    EXPECT_THAT(premultipliedSkSL, HasSubstr("c.rgb = fromLinearSrgb(c.rgb);"));
+    EXPECT_THAT(premultipliedSkSL, Not(HasSubstr("float3 OETF(")));
+
+    const auto gammaSkSL = shaders::buildLinearEffectSkSL(
+            shaders::LinearEffect{.inputDataspace = ui::Dataspace::V0_SRGB,
+                                  .outputDataspace = ui::Dataspace::V0_SRGB_LINEAR,
+                                  .fakeOutputDataspace = ui::Dataspace::TRANSFER_GAMMA2_2});
+    EXPECT_THAT(gammaSkSL, HasSubstr("float3 OETF("));
+    EXPECT_THAT(gammaSkSL, HasSubstr("c.rgb = OETF(c.rgb);"));
+    EXPECT_THAT(gammaSkSL, Not(HasSubstr("c.a + 0.0019")));
+    // The SkSL ends with main, after the functions it calls.
+    EXPECT_LT(gammaSkSL.find("float3 OOTF("), gammaSkSL.find("half4 main("));
+}
+
 } // namespace android
@@ -21,6 +21,8 @@
 #include <android/hardware_buffer.h>
 #include <math/vec3.h>
 
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -154,4 +156,37 @@ public:
 // This instance is globally constructed.
 ToneMapper* getToneMapper();
 
+// Precomputed CPU tonemapping curve of the global tonemapper for a particular source dataspace,
+// destination dataspace and metadata, for tonemapping many colors at once, e.g. the rows of an HDR
+// screenshot.
+//
+// The tonemapping gain of a color only depends on a single luminance value of it, so the curve is
+// tabulated over that value once instead of being evaluated for every color. The gains match
+// ToneMapper::lookupTonemapGain() within a small epsilon. Only the luminances of the metadata are
+// taken into account; the buffer, if any, is ignored.
+class ToneMapLut {
+public:
+    ToneMapLut(aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+               aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+               const Metadata& metadata);
+
+    // Computes the tonemapping gain of each of the count colors into gains.
+    void lookupTonemapGain(const Color* colors, size_t count, float* gains) const;
+
+private:
+    const aidl::android::hardware::graphics::common::Dataspace mSourceDataspace;
+    const aidl::android::hardware::graphics::common::Dataspace mDestinationDataspace;
+    const Metadata mMetadata;
+    // Gains at luminances distributed quadratically over the table range, which puts more of them
+    // into the darker range where the curves change the most.
+    std::vector<float> mGains;
+};
+
+// Retrieves the tonemapping table for the given dataspaces and metadata. Recently used tables are
+// cached, so this is cheap to call for every frame or screenshot.
+std::shared_ptr<const ToneMapLut> getToneMapLut(
+        aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+        aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+        const Metadata& metadata);
+
 } // namespace android::tonemap
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <tonemap/tonemap.h>
+
+#include <vector>
+
+namespace android {
+
+namespace {
+
+using aidl::android::hardware::graphics::common::Dataspace;
+
+// One row of a 1080p HDR screenshot.
+constexpr size_t kRowWidth = 1920;
+
+const tonemap::Metadata kMetadata{.displayMaxLuminance = 500.f,
+                                  .contentMaxLuminance = 1000.f,
+                                  .currentDisplayLuminance = 250.f};
+
+std::vector<tonemap::Color> generateRow() {
+    std::vector<tonemap::Color> colors;
+    colors.reserve(kRowWidth);
+    for (size_t i = 0; i < kRowWidth; i++) {
+        const float luminance = 1000.f * i / kRowWidth;
+        colors.push_back({.linearRGB = vec3(luminance, luminance * 0.8f, luminance * 0.2f),
+                          .xyz = vec3(luminance * 0.7f, luminance * 0.75f, luminance * 0.3f)});
+    }
+    return colors;
+}
+
+} // namespace
+
+static void BM_lookupTonemapGain(benchmark::State& state) {
+    const auto colors = generateRow();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                tonemap::getToneMapper()->lookupTonemapGain(Dataspace::BT2020_ITU_PQ,
+                                                            Dataspace::DISPLAY_P3, colors,
+                                                            kMetadata));
+    }
+    state.SetItemsProcessed(state.iterations() * colors.size());
+}
+BENCHMARK(BM_lookupTonemapGain);
+
+static void BM_toneMapLut(benchmark::State& state) {
+    const auto colors = generateRow();
+    std::vector<float> gains(colors.size());
+    for (auto _ : state) {
+        tonemap::getToneMapLut(Dataspace::BT2020_ITU_PQ, Dataspace::DISPLAY_P3, kMetadata)
+                ->lookupTonemapGain(colors.data(), colors.size(), gains.data());
+        benchmark::DoNotOptimize(gains.data());
+    }
+    state.SetItemsProcessed(state.iterations() * colors.size());
+}
+BENCHMARK(BM_toneMapLut);
+
+// Cost of building a table, paid once per dataspace and metadata combination.
+static void BM_createToneMapLut(benchmark::State& state) {
+    for (auto _ : state) {
+        tonemap::ToneMapLut lut(Dataspace::BT2020_ITU_PQ, Dataspace::DISPLAY_P3, kMetadata);
+        benchmark::DoNotOptimize(&lut);
+    }
+}
+BENCHMARK(BM_createToneMapLut);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -18,6 +18,7 @@
 #include <gtest/gtest.h>
 #include <tonemap/tonemap.h>
 #include <cmath>
+#include <vector>
 
 namespace android {
 
@@ -85,4 +86,52 @@ TEST_F(TonemapTest, generateTonemapGainShaderSkSL_containsEntryPointForHLG) {
     EXPECT_THAT(shader, HasSubstr("float libtonemap_LookupTonemapGain(vec3 linearRGB, vec3 xyz)"));
 }
 
+TEST_F(TonemapTest, toneMapLut_matchesLookupTonemapGain) {
+    using aidl::android::hardware::graphics::common::Dataspace;
+    const tonemap::Metadata metadata{.displayMaxLuminance = 500.f,
+                                     .contentMaxLuminance = 1000.f,
+                                     .currentDisplayLuminance = 250.f};
+
+    std::vector<tonemap::Color> colors;
+    for (float luminance = 0.f; luminance < 12000.f; luminance = luminance * 1.1f + 0.01f) {
+        colors.push_back({.linearRGB = vec3(luminance, luminance * 0.5f, 0.f),
+                          .xyz = vec3(luminance * 0.4f, luminance * 0.6f, luminance * 0.2f)});
+    }
+
+    for (const auto [source, destination] :
+         {std::make_pair(Dataspace::BT2020_ITU_PQ, Dataspace::DISPLAY_P3),
+          std::make_pair(Dataspace::BT2020_ITU_HLG, Dataspace::DISPLAY_P3),
+          std::make_pair(Dataspace::DISPLAY_P3, Dataspace::BT2020_ITU_PQ)}) {
+        const auto expected =
+                tonemap::getToneMapper()->lookupTonemapGain(source, destination, colors, metadata);
+        std::vector<float> gains(colors.size());
+        tonemap::getToneMapLut(source, destination, metadata)
+                ->lookupTonemapGain(colors.data(), colors.size(), gains.data());
+
+        for (size_t i = 0; i < colors.size(); i++) {
+            EXPECT_NEAR(expected[i], gains[i], std::abs(expected[i]) * 0.01 + 1e-6)
+                    << "luminance " << colors[i].linearRGB.r << " source "
+                    << static_cast<int>(source) << " destination "
+                    << static_cast<int>(destination);
+        }
+    }
+}
+
+TEST_F(TonemapTest, getToneMapLut_reusesTableForSameMetadata) {
+    using aidl::android::hardware::graphics::common::Dataspace;
+    const tonemap::Metadata metadata{.displayMaxLuminance = 500.f, .contentMaxLuminance = 1000.f};
+    const tonemap::Metadata brighterMetadata{.displayMaxLuminance = 1000.f,
+                                             .contentMaxLuminance = 1000.f};
+
+    const auto lut = tonemap::getToneMapLut(Dataspace::BT2020_ITU_PQ, Dataspace::DISPLAY_P3,
+                                            metadata);
+    EXPECT_EQ(lut,
+              tonemap::getToneMapLut(Dataspace::BT2020_ITU_PQ, Dataspace::DISPLAY_P3, metadata));
+    EXPECT_NE(lut,
+              tonemap::getToneMapLut(Dataspace::BT2020_ITU_PQ, Dataspace::DISPLAY_P3,
+                                     brighterMetadata));
+    EXPECT_NE(lut,
+              tonemap::getToneMapLut(Dataspace::BT2020_ITU_HLG, Dataspace::DISPLAY_P3, metadata));
+}
+
 } // namespace android
@@ -17,6 +17,7 @@
 #include <tonemap/tonemap.h>
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <mutex>
 #include <type_traits>
@@ -35,6 +36,14 @@ static const constexpr auto kToneMapAlgorithm = ToneMapAlgorithm::Android13;
 
 static const constexpr auto kTransferMask =
         static_cast<int32_t>(aidl::android::hardware::graphics::common::Dataspace::TRANSFER_MASK);
+// Number of entries of a ToneMapLut, and the highest luminance it covers. The gain of brighter
+// colors is computed without the table.
+static const constexpr size_t kLutSize = 4096;
+static const constexpr float kLutMaxLuminance = 10000.f;
+
+// Number of ToneMapLuts kept by getToneMapLut().
+static const constexpr size_t kLutCacheSize = 4;
+
 static const constexpr auto kTransferST2084 =
         static_cast<int32_t>(aidl::android::hardware::graphics::common::Dataspace::TRANSFER_ST2084);
 static const constexpr auto kTransferHLG =
@@ -746,4 +755,108 @@ ToneMapper* getToneMapper() {
 
     return sToneMapper.get();
 }
+
+ToneMapLut::ToneMapLut(aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+                       aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+                       const Metadata& metadata)
+      : mSourceDataspace(sourceDataspace),
+        mDestinationDataspace(destinationDataspace),
+        mMetadata(metadata) {
+    // Grey colors, whose luminance and largest channel are the same, so that the table works for
+    // every tonemapping algorithm.
+    std::vector<Color> colors(kLutSize);
+    for (size_t i = 0; i < kLutSize; i++) {
+        const float position = static_cast<float>(i) / (kLutSize - 1);
+        // The gain of black is special cased, use the limit towards it instead.
+        const float luminance = i == 0 ? 1e-4f : position * position * kLutMaxLuminance;
+        colors[i] = Color{.linearRGB = vec3(luminance), .xyz = vec3(luminance)};
+    }
+
+    const auto gains =
+            getToneMapper()->lookupTonemapGain(sourceDataspace, destinationDataspace, colors,
+                                               metadata);
+    mGains.assign(gains.begin(), gains.end());
+}
+
+void ToneMapLut::lookupTonemapGain(const Color* colors, size_t count, float* gains) const {
+    // The input of the curve of each algorithm, see lookupTonemapGain().
+    const auto gainInput = [](const Color& color) {
+        return kToneMapAlgorithm == ToneMapAlgorithm::AndroidO
+                ? color.xyz.y
+                : std::max({color.linearRGB.r, color.linearRGB.g, color.linearRGB.b});
+    };
+
+    // Kept free of calls and branches other than the rare fallback, so that it can be
+    // vectorized.
+    const float* const table = mGains.data();
+    for (size_t i = 0; i < count; i++) {
+        const float input = gainInput(colors[i]);
+        if (input <= 0.f) {
+            gains[i] = 1.f;
+            continue;
+        }
+        if (input >= kLutMaxLuminance) {
+            gains[i] = static_cast<float>(
+                    getToneMapper()
+                            ->lookupTonemapGain(mSourceDataspace, mDestinationDataspace,
+                                                {colors[i]}, mMetadata)
+                            .front());
+            continue;
+        }
+        const float position = std::sqrt(input / kLutMaxLuminance) * (kLutSize - 1);
+        const size_t index = std::min(static_cast<size_t>(position), kLutSize - 2);
+        const float fraction = position - static_cast<float>(index);
+        gains[i] = table[index] + (table[index + 1] - table[index]) * fraction;
+    }
+}
+
+std::shared_ptr<const ToneMapLut> getToneMapLut(
+        aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+        aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+        const Metadata& metadata) {
+    struct Entry {
+        aidl::android::hardware::graphics::common::Dataspace sourceDataspace;
+        aidl::android::hardware::graphics::common::Dataspace destinationDataspace;
+        float displayMaxLuminance;
+        float contentMaxLuminance;
+        float currentDisplayLuminance;
+        aidl::android::hardware::graphics::composer3::RenderIntent renderIntent;
+        std::shared_ptr<const ToneMapLut> lut;
+    };
+    static std::mutex sMutex;
+    // Most recently used last.
+    static std::vector<Entry> sCache;
+
+    std::lock_guard lock(sMutex);
+    const auto it = std::find_if(sCache.begin(), sCache.end(), [&](const Entry& entry) {
+        return entry.sourceDataspace == sourceDataspace &&
+                entry.destinationDataspace == destinationDataspace &&
+                entry.displayMaxLuminance == metadata.displayMaxLuminance &&
+                entry.contentMaxLuminance == metadata.contentMaxLuminance &&
+                entry.currentDisplayLuminance == metadata.currentDisplayLuminance &&
+                entry.renderIntent == metadata.renderIntent;
+    });
+    if (it != sCache.end()) {
+        std::rotate(it, it + 1, sCache.end());
+        return sCache.back().lut;
+    }
+
+    if (sCache.size() == kLutCacheSize) {
+        sCache.erase(sCache.begin());
+    }
+    Metadata lutMetadata = metadata;
+    lutMetadata.buffer = nullptr;
+    sCache.push_back(Entry{
+            .sourceDataspace = sourceDataspace,
+            .destinationDataspace = destinationDataspace,
+            .displayMaxLuminance = metadata.displayMaxLuminance,
+            .contentMaxLuminance = metadata.contentMaxLuminance,
+            .currentDisplayLuminance = metadata.currentDisplayLuminance,
+            .renderIntent = metadata.renderIntent,
+            .lut = std::make_shared<const ToneMapLut>(sourceDataspace, destinationDataspace,
+                                                      lutMetadata),
+    });
+    return sCache.back().lut;
+}
+
 } // namespace android::tonemap
@@ -27,6 +27,7 @@
 #include <sync/sync.h>
 #pragma clang diagnostic pop
 
+#include <errno.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <utils/Log.h>
@@ -122,11 +123,30 @@ int Fence::dup() const {
     return ::dup(mFenceFd);
 }
 
+namespace {
+std::atomic<uint64_t> gSignalTimeQueries = 0;
+std::atomic<uint64_t> gSignalTimeFileInfoQueries = 0;
+} // namespace
+
 nsecs_t Fence::getSignalTime() const {
     if (mFenceFd == -1) {
         return SIGNAL_TIME_INVALID;
     }
 
+    gSignalTimeQueries.fetch_add(1, std::memory_order_relaxed);
+    nsecs_t signalTime = mSignalTime.load(std::memory_order_relaxed);
+    if (signalTime != SIGNAL_TIME_PENDING) {
+        return signalTime;
+    }
+
+    // Polling the fence is much cheaper than sync_file_info, so only ask for
+    // the timestamps once the fence reports that it has signaled. Errors fall
+    // through so that sync_file_info can report them.
+    if (sync_wait(mFenceFd, 0) < 0 && errno == ETIME) {
+        return SIGNAL_TIME_PENDING;
+    }
+
+    gSignalTimeFileInfoQueries.fetch_add(1, std::memory_order_relaxed);
     struct sync_file_info* finfo = sync_file_info(mFenceFd);
     if (finfo == nullptr) {
         ALOGE("sync_file_info returned NULL for fd %d", mFenceFd.get());
@@ -150,9 +170,18 @@ nsecs_t Fence::getSignalTime() const {
     }
 
     sync_file_info_free(finfo);
+    // A signaled fence never changes its timestamp.
+    mSignalTime.store(nsecs_t(timestamp), std::memory_order_relaxed);
     return nsecs_t(timestamp);
 }
 
+Fence::SignalTimeStats Fence::getSignalTimeStats() {
+    SignalTimeStats stats;
+    stats.queries = gSignalTimeQueries.load(std::memory_order_relaxed);
+    stats.fileInfoQueries = gSignalTimeFileInfoQueries.load(std::memory_order_relaxed);
+    return stats;
+}
+
 size_t Fence::getFlattenedSize() const {
     return 4;
 }
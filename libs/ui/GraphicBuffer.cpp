@@ -19,10 +19,18 @@
 
 #include <ui/GraphicBuffer.h>
 
+#include <errno.h>
+#include <inttypes.h>
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
+
+#include <mutex>
+
 #include <cutils/atomic.h>
 
 #include <grallocusage/GrallocUsageConversion.h>
 
+#include <ui/Fence.h>
 #include <ui/GraphicBufferAllocator.h>
 #include <ui/GraphicBufferMapper.h>
 #include <utils/Trace.h>
@@ -60,6 +68,34 @@ AHardwareBuffer const* GraphicBuffer::toAHardwareBuffer() const {
     return reinterpret_cast<AHardwareBuffer const*>(this);
 }
 
+// The buffer stays locked through the mapper, and the CPU caches are maintained through the
+// dma-buf of the buffer instead.
+struct GraphicBuffer::PersistentCpuMapping {
+    std::mutex mutex;
+    void* address = nullptr;
+    uint64_t usage = 0;
+    int32_t bytesPerPixel = -1;
+    int32_t bytesPerStride = -1;
+    // The DMA_BUF_SYNC_* direction of the current lock, or 0 while unlocked.
+    uint64_t lockedFlags = 0;
+};
+
+static int syncDmaBuf(int fd, uint64_t flags) {
+    struct dma_buf_sync sync = {.flags = flags};
+    int err;
+    do {
+        err = ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+    } while (err < 0 && (errno == EINTR || errno == EAGAIN));
+    return err < 0 ? -errno : 0;
+}
+
+static uint64_t getDmaBufSyncDirection(uint64_t usage) {
+    uint64_t flags = 0;
+    if (usage & GRALLOC_USAGE_SW_READ_MASK) flags |= DMA_BUF_SYNC_READ;
+    if (usage & GRALLOC_USAGE_SW_WRITE_MASK) flags |= DMA_BUF_SYNC_WRITE;
+    return flags;
+}
+
 GraphicBuffer::GraphicBuffer()
     : BASE(), mOwner(ownData), mBufferMapper(GraphicBufferMapper::get()),
       mInitCheck(NO_ERROR), mId(getUniqueId()), mGenerationNumber(0)
@@ -119,6 +155,7 @@ GraphicBuffer::~GraphicBuffer()
 
 void GraphicBuffer::free_handle()
 {
+    releasePersistentCpuMapping();
     if (mOwner == ownHandle) {
         mBufferMapper.freeBuffer(handle);
     } else if (mOwner == ownData) {
@@ -158,6 +195,7 @@ status_t GraphicBuffer::reallocate(uint32_t inWidth, uint32_t inHeight,
         return NO_ERROR;
 
     if (handle) {
+        releasePersistentCpuMapping();
         GraphicBufferAllocator& allocator(GraphicBufferAllocator::get());
         allocator.free(handle);
         handle = nullptr;
@@ -255,6 +293,10 @@ status_t GraphicBuffer::lock(uint32_t inUsage, const Rect& rect, void** vaddr,
         return BAD_VALUE;
     }
 
+    if (mPersistentCpuMapping) {
+        return lockPersistentCpuMapping(inUsage, vaddr, -1, outBytesPerPixel, outBytesPerStride);
+    }
+
     status_t res = getBufferMapper().lock(handle, inUsage, rect, vaddr, outBytesPerPixel,
                                           outBytesPerStride);
 
@@ -278,12 +320,19 @@ status_t GraphicBuffer::lockYCbCr(uint32_t inUsage, const Rect& rect,
                 width, height);
         return BAD_VALUE;
     }
+    if (mPersistentCpuMapping) {
+        ALOGE("lockYCbCr is not supported with a persistent CPU mapping");
+        return INVALID_OPERATION;
+    }
     status_t res = getBufferMapper().lockYCbCr(handle, inUsage, rect, ycbcr);
     return res;
 }
 
 status_t GraphicBuffer::unlock()
 {
+    if (mPersistentCpuMapping) {
+        return unlockPersistentCpuMapping(nullptr);
+    }
     status_t res = getBufferMapper().unlock(handle);
     return res;
 }
@@ -312,6 +361,11 @@ status_t GraphicBuffer::lockAsync(uint64_t inProducerUsage, uint64_t inConsumerU
         return BAD_VALUE;
     }
 
+    if (mPersistentCpuMapping) {
+        return lockPersistentCpuMapping(inProducerUsage | inConsumerUsage, vaddr, fenceFd,
+                                        outBytesPerPixel, outBytesPerStride);
+    }
+
     status_t res = getBufferMapper().lockAsync(handle, inProducerUsage, inConsumerUsage, rect,
                                                vaddr, fenceFd, outBytesPerPixel, outBytesPerStride);
 
@@ -336,16 +390,131 @@ status_t GraphicBuffer::lockAsyncYCbCr(uint32_t inUsage, const Rect& rect,
                 width, height);
         return BAD_VALUE;
     }
+    if (mPersistentCpuMapping) {
+        ALOGE("lockAsyncYCbCr is not supported with a persistent CPU mapping");
+        if (fenceFd >= 0) {
+            close(fenceFd);
+        }
+        return INVALID_OPERATION;
+    }
     status_t res = getBufferMapper().lockAsyncYCbCr(handle, inUsage, rect, ycbcr, fenceFd);
     return res;
 }
 
 status_t GraphicBuffer::unlockAsync(int *fenceFd)
 {
+    if (mPersistentCpuMapping) {
+        return unlockPersistentCpuMapping(fenceFd);
+    }
     status_t res = getBufferMapper().unlockAsync(handle, fenceFd);
     return res;
 }
 
+status_t GraphicBuffer::setPersistentCpuMapping(bool enabled) {
+    if (!enabled) {
+        if (mPersistentCpuMapping && mPersistentCpuMapping->lockedFlags) {
+            ALOGE("Cannot disable the persistent CPU mapping while the buffer is locked");
+            return INVALID_OPERATION;
+        }
+        releasePersistentCpuMapping();
+        return NO_ERROR;
+    }
+    if (mPersistentCpuMapping) {
+        return NO_ERROR;
+    }
+
+    const uint64_t cpuUsage = usage & (GRALLOC_USAGE_SW_READ_MASK | GRALLOC_USAGE_SW_WRITE_MASK);
+    if (!handle || !cpuUsage || layerCount != 1 || handle->numFds < 1) {
+        ALOGE("A persistent CPU mapping requires a single layer buffer with CPU usage");
+        return BAD_VALUE;
+    }
+
+    ATRACE_CALL();
+    auto mapping = std::make_unique<PersistentCpuMapping>();
+    mapping->usage = cpuUsage;
+    status_t res = getBufferMapper().lockAsync(handle, cpuUsage, cpuUsage, Rect(width, height),
+                                               &mapping->address, -1, &mapping->bytesPerPixel,
+                                               &mapping->bytesPerStride);
+    if (res != NO_ERROR) {
+        return res;
+    }
+
+    // The buffer may not be backed by a dma-buf, in which case the caches cannot be maintained
+    // while it stays mapped.
+    const int fd = handle->data[0];
+    const uint64_t direction = getDmaBufSyncDirection(cpuUsage);
+    if (syncDmaBuf(fd, DMA_BUF_SYNC_START | direction) != 0 ||
+        syncDmaBuf(fd, DMA_BUF_SYNC_END | direction) != 0) {
+        ALOGE("Cannot maintain the CPU caches of buffer %" PRIu64 ": %s", mId, strerror(errno));
+        getBufferMapper().unlock(handle);
+        return INVALID_OPERATION;
+    }
+
+    mPersistentCpuMapping = std::move(mapping);
+    return NO_ERROR;
+}
+
+status_t GraphicBuffer::lockPersistentCpuMapping(uint64_t inUsage, void** vaddr, int fenceFd,
+                                                 int32_t* outBytesPerPixel,
+                                                 int32_t* outBytesPerStride) {
+    PersistentCpuMapping& mapping = *mPersistentCpuMapping;
+    if (fenceFd >= 0) {
+        status_t res = sp<Fence>::make(fenceFd)->waitForever("GraphicBuffer::lockAsync");
+        if (res != NO_ERROR) {
+            return res;
+        }
+    }
+
+    const uint64_t direction = getDmaBufSyncDirection(inUsage);
+    if (!direction || (direction & ~getDmaBufSyncDirection(mapping.usage))) {
+        ALOGE("Usage %#" PRIx64 " is not covered by the persistent CPU mapping (%#" PRIx64 ")",
+              inUsage, mapping.usage);
+        return BAD_VALUE;
+    }
+
+    std::lock_guard lock(mapping.mutex);
+    if (mapping.lockedFlags) {
+        ALOGE("Buffer %" PRIu64 " is already locked", mId);
+        return INVALID_OPERATION;
+    }
+    if (int err = syncDmaBuf(handle->data[0], DMA_BUF_SYNC_START | direction); err != 0) {
+        return err;
+    }
+    mapping.lockedFlags = direction;
+
+    *vaddr = mapping.address;
+    if (outBytesPerPixel) *outBytesPerPixel = mapping.bytesPerPixel;
+    if (outBytesPerStride) *outBytesPerStride = mapping.bytesPerStride;
+    return NO_ERROR;
+}
+
+status_t GraphicBuffer::unlockPersistentCpuMapping(int* fenceFd) {
+    PersistentCpuMapping& mapping = *mPersistentCpuMapping;
+    if (fenceFd) {
+        *fenceFd = -1;
+    }
+
+    std::lock_guard lock(mapping.mutex);
+    if (!mapping.lockedFlags) {
+        ALOGE("Buffer %" PRIu64 " is not locked", mId);
+        return BAD_VALUE;
+    }
+    const uint64_t direction = mapping.lockedFlags;
+    mapping.lockedFlags = 0;
+    return syncDmaBuf(handle->data[0], DMA_BUF_SYNC_END | direction);
+}
+
+void GraphicBuffer::releasePersistentCpuMapping() {
+    if (!mPersistentCpuMapping) {
+        return;
+    }
+    if (mPersistentCpuMapping->lockedFlags) {
+        syncDmaBuf(handle->data[0], DMA_BUF_SYNC_END | mPersistentCpuMapping->lockedFlags);
+    }
+    getBufferMapper().unlock(handle);
+    mPersistentCpuMapping.reset();
+}
+
 status_t GraphicBuffer::isSupported(uint32_t inWidth, uint32_t inHeight, PixelFormat inFormat,
                                     uint32_t inLayerCount, uint64_t inUsage,
                                     bool* outSupported) const {
@@ -23,6 +23,10 @@
 #include <limits.h>
 #include <stdio.h>
 
+#include <algorithm>
+#include <optional>
+#include <thread>
+
 #include <grallocusage/GrallocUsageConversion.h>
 
 #include <android-base/stringprintf.h>
@@ -104,6 +108,22 @@ void GraphicBufferAllocator::dump(std::string& result, bool less) const {
     StringAppendF(&result, "Total allocated by GraphicBufferAllocator (estimate): %.2f KB\n",
                   static_cast<double>(total) / 1024.0);
 
+    {
+        std::lock_guard poolLock(mPoolMutex);
+        const uint64_t requests = mPoolHits + mPoolMisses;
+        StringAppendF(&result,
+                      "Buffer pool: %zu buffers, %.2f KB of %.2f KB, %" PRIu64 " hits, %" PRIu64
+                      " misses (%.1f%% hit rate)\n",
+                      mPool.size(), static_cast<double>(mPoolBytes) / 1024.0,
+                      static_cast<double>(mPoolCapacity) / 1024.0, mPoolHits, mPoolMisses,
+                      requests ? 100.0 * static_cast<double>(mPoolHits) / requests : 0.0);
+    }
+
+    const auto metadataStats = mMapper.getMetadataCacheStats();
+    StringAppendF(&result,
+                  "Metadata cache: %zu buffers, %" PRIu64 " hits, %" PRIu64 " misses\n",
+                  metadataStats.bufferCount, metadataStats.hits, metadataStats.misses);
+
     result.append(mAllocator->dumpDebugInfo(less));
 }
 
@@ -116,7 +136,8 @@ void GraphicBufferAllocator::dumpToSystemLog(bool less) {
 status_t GraphicBufferAllocator::allocateHelper(uint32_t width, uint32_t height, PixelFormat format,
                                                 uint32_t layerCount, uint64_t usage,
                                                 buffer_handle_t* handle, uint32_t* stride,
-                                                std::string requestorName, bool importBuffer) {
+                                                std::string requestorName, bool importBuffer,
+                                                bool usePool) {
     ATRACE_CALL();
 
     // make sure to not allocate a N x 0 or 0 x N buffer, since this is
@@ -140,6 +161,16 @@ status_t GraphicBufferAllocator::allocateHelper(uint32_t width, uint32_t height,
     // TODO(b/72323293, b/72703005): Remove these invalid bits from callers
     usage &= ~static_cast<uint64_t>((1 << 10) | (1 << 13));
 
+    const pool_key_t key = {width, height, format, layerCount, usage};
+    if (importBuffer && usePool && takeFromPool(key, handle, stride)) {
+        Mutex::Autolock _l(sLock);
+        const ssize_t index = sAllocList.indexOfKey(*handle);
+        if (index >= 0) {
+            sAllocList.editValueAt(index).requestorName = std::move(requestorName);
+        }
+        return NO_ERROR;
+    }
+
     status_t error = mAllocator->allocate(requestorName, width, height, format, layerCount, usage,
                                           1, stride, handle, importBuffer);
     if (error != NO_ERROR) {
@@ -207,15 +238,140 @@ status_t GraphicBufferAllocator::free(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
-    // We allocated a buffer from the allocator and imported it into the
-    // mapper to get the handle.  We just need to free the handle now.
-    mMapper.freeBuffer(handle);
+    std::optional<alloc_rec_t> rec;
+    {
+        Mutex::Autolock _l(sLock);
+        const ssize_t index = sAllocList.indexOfKey(handle);
+        if (index >= 0) {
+            rec = sAllocList.valueAt(index);
+        }
+    }
+
+    // Protected buffers are never recycled, since their contents must not outlive the requestor.
+    if (rec && rec->size > 0 && !(rec->usage & GRALLOC_USAGE_PROTECTED)) {
+        const pool_key_t key = {rec->width, rec->height, rec->format, rec->layerCount, rec->usage};
+        if (addToPool(key, handle, rec->stride, rec->size)) {
+            return NO_ERROR;
+        }
+    }
+
+    releaseBuffers({handle});
+    return NO_ERROR;
+}
+
+void GraphicBufferAllocator::releaseBuffers(const std::vector<buffer_handle_t>& handles) {
+    for (const buffer_handle_t handle : handles) {
+        // We allocated a buffer from the allocator and imported it into the
+        // mapper to get the handle.  We just need to free the handle now.
+        mMapper.freeBuffer(handle);
+    }
 
     Mutex::Autolock _l(sLock);
     KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
-    list.removeItem(handle);
+    for (const buffer_handle_t handle : handles) {
+        list.removeItem(handle);
+    }
+}
 
-    return NO_ERROR;
+bool GraphicBufferAllocator::takeFromPool(const pool_key_t& key, buffer_handle_t* handle,
+                                          uint32_t* stride) {
+    std::vector<buffer_handle_t> evicted;
+    bool hit = false;
+    {
+        std::lock_guard lock(mPoolMutex);
+        if (mPoolCapacity == 0) return false;
+
+        trimPoolLocked(systemTime(), evicted);
+
+        // Prefer the most recently freed buffer, which is the most likely to still be cached.
+        const auto it = std::find_if(mPool.rbegin(), mPool.rend(),
+                                     [&key](const pooled_buffer_t& buffer) {
+                                         return buffer.key == key;
+                                     });
+        if (it != mPool.rend()) {
+            *handle = it->handle;
+            *stride = it->stride;
+            mPoolBytes -= it->size;
+            mPool.erase(std::next(it).base());
+            mPoolHits++;
+            hit = true;
+        } else {
+            mPoolMisses++;
+        }
+    }
+
+    releaseBuffers(evicted);
+    return hit;
+}
+
+bool GraphicBufferAllocator::addToPool(const pool_key_t& key, buffer_handle_t handle,
+                                       uint32_t stride, size_t size) {
+    std::vector<buffer_handle_t> evicted;
+    {
+        std::lock_guard lock(mPoolMutex);
+        if (size > mPoolCapacity) return false;
+
+        mPool.push_back({key, handle, stride, size, systemTime()});
+        mPoolBytes += size;
+        trimPoolLocked(systemTime(), evicted);
+    }
+
+    releaseBuffers(evicted);
+    return true;
+}
+
+void GraphicBufferAllocator::trimPoolLocked(nsecs_t now, std::vector<buffer_handle_t>& evicted) {
+    // The pool is ordered by free time, so the oldest buffers are evicted first.
+    size_t count = 0;
+    uint64_t bytes = mPoolBytes;
+    while (count < mPool.size() &&
+           (bytes > mPoolCapacity || now - mPool[count].freeTime > kPoolMaxAge)) {
+        bytes -= mPool[count].size;
+        evicted.push_back(mPool[count].handle);
+        count++;
+    }
+    mPool.erase(mPool.begin(), mPool.begin() + static_cast<ptrdiff_t>(count));
+    mPoolBytes = bytes;
+}
+
+void GraphicBufferAllocator::setPoolCapacity(uint64_t capacityBytes) {
+    std::vector<buffer_handle_t> evicted;
+    {
+        std::lock_guard lock(mPoolMutex);
+        mPoolCapacity = capacityBytes;
+        trimPoolLocked(systemTime(), evicted);
+    }
+    releaseBuffers(evicted);
+}
+
+void GraphicBufferAllocator::preallocate(uint32_t width, uint32_t height, PixelFormat format,
+                                         uint32_t layerCount, uint64_t usage, uint32_t count,
+                                         std::string requestorName) {
+    {
+        std::lock_guard lock(mPoolMutex);
+        if (mPoolCapacity == 0) return;
+    }
+
+    // The allocator is a process-wide singleton, so it outlives the thread.
+    std::thread([=, this, requestorName = std::move(requestorName)] {
+        for (uint32_t i = 0; i < count; i++) {
+            buffer_handle_t handle;
+            uint32_t stride;
+            if (allocateHelper(width, height, format, layerCount, usage, &handle, &stride,
+                               requestorName, true, false) != NO_ERROR) {
+                return;
+            }
+            free(handle);
+        }
+    }).detach();
+}
+
+GraphicBufferAllocator::PoolStats GraphicBufferAllocator::getPoolStats() const {
+    std::lock_guard lock(mPoolMutex);
+    return {.bufferCount = mPool.size(),
+            .bytes = mPoolBytes,
+            .hits = mPoolHits,
+            .misses = mPoolMisses};
 }
 
 // ---------------------------------------------------------------------------
@@ -41,6 +41,8 @@
 
 #include <system/graphics.h>
 
+#include <initializer_list>
+
 namespace android {
 // ---------------------------------------------------------------------------
 
@@ -120,6 +122,72 @@ status_t GraphicBufferMapper::importBufferNoValidate(const native_handle_t* rawH
     return mMapper->importBuffer(rawHandle, outHandle);
 }
 
+void GraphicBufferMapper::invalidateMetadata(buffer_handle_t bufferHandle) {
+    std::lock_guard lock(mMetadataMutex);
+    mMetadataCache.erase(bufferHandle);
+}
+
+template <typename T, typename Getter>
+status_t GraphicBufferMapper::getCachedMetadata(buffer_handle_t bufferHandle,
+                                                std::optional<T> CachedMetadata::*field,
+                                                T* outValue, Getter&& getter) {
+    {
+        std::lock_guard lock(mMetadataMutex);
+        if (const auto it = mMetadataCache.find(bufferHandle); it != mMetadataCache.end()) {
+            if (const auto& value = it->second.*field) {
+                *outValue = *value;
+                mMetadataHits++;
+                return NO_ERROR;
+            }
+        }
+        mMetadataMisses++;
+    }
+
+    // Query the HAL without holding the lock, since it may be slow.
+    T value;
+    const status_t error = getter(&value);
+    if (error != NO_ERROR) {
+        return error;
+    }
+
+    {
+        std::lock_guard lock(mMetadataMutex);
+        mMetadataCache[bufferHandle].*field = value;
+    }
+    *outValue = std::move(value);
+    return NO_ERROR;
+}
+
+status_t GraphicBufferMapper::getMetadata(buffer_handle_t bufferHandle,
+                                          BufferMetadata* outMetadata) {
+    BufferMetadata metadata;
+    for (const status_t error :
+         {getBufferId(bufferHandle, &metadata.bufferId), getWidth(bufferHandle, &metadata.width),
+          getHeight(bufferHandle, &metadata.height),
+          getLayerCount(bufferHandle, &metadata.layerCount),
+          getPixelFormatRequested(bufferHandle, &metadata.pixelFormatRequested),
+          getPixelFormatFourCC(bufferHandle, &metadata.pixelFormatFourCC),
+          getPixelFormatModifier(bufferHandle, &metadata.pixelFormatModifier),
+          getUsage(bufferHandle, &metadata.usage),
+          getAllocationSize(bufferHandle, &metadata.allocationSize),
+          getProtectedContent(bufferHandle, &metadata.protectedContent),
+          getCompression(bufferHandle, &metadata.compression),
+          getPlaneLayouts(bufferHandle, &metadata.planeLayouts)}) {
+        if (error != NO_ERROR) {
+            return error;
+        }
+    }
+    *outMetadata = std::move(metadata);
+    return NO_ERROR;
+}
+
+GraphicBufferMapper::MetadataCacheStats GraphicBufferMapper::getMetadataCacheStats() const {
+    std::lock_guard lock(mMetadataMutex);
+    return {.bufferCount = mMetadataCache.size(),
+            .hits = mMetadataHits,
+            .misses = mMetadataMisses};
+}
+
 void GraphicBufferMapper::getTransportSize(buffer_handle_t handle,
             uint32_t* outTransportNumFds, uint32_t* outTransportNumInts)
 {
@@ -130,6 +198,7 @@ status_t GraphicBufferMapper::freeBuffer(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
+    invalidateMetadata(handle);
     mMapper->freeBuffer(handle);
 
     return NO_ERROR;
@@ -201,7 +270,10 @@ status_t GraphicBufferMapper::isSupported(uint32_t width, uint32_t height,
 }
 
 status_t GraphicBufferMapper::getBufferId(buffer_handle_t bufferHandle, uint64_t* outBufferId) {
-    return mMapper->getBufferId(bufferHandle, outBufferId);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::bufferId, outBufferId,
+                             [&](uint64_t* value) {
+                                 return mMapper->getBufferId(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getName(buffer_handle_t bufferHandle, std::string* outName) {
@@ -209,44 +281,73 @@ status_t GraphicBufferMapper::getName(buffer_handle_t bufferHandle, std::string*
 }
 
 status_t GraphicBufferMapper::getWidth(buffer_handle_t bufferHandle, uint64_t* outWidth) {
-    return mMapper->getWidth(bufferHandle, outWidth);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::width, outWidth,
+                             [&](uint64_t* value) {
+                                 return mMapper->getWidth(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getHeight(buffer_handle_t bufferHandle, uint64_t* outHeight) {
-    return mMapper->getHeight(bufferHandle, outHeight);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::height, outHeight,
+                             [&](uint64_t* value) {
+                                 return mMapper->getHeight(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getLayerCount(buffer_handle_t bufferHandle, uint64_t* outLayerCount) {
-    return mMapper->getLayerCount(bufferHandle, outLayerCount);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::layerCount, outLayerCount,
+                             [&](uint64_t* value) {
+                                 return mMapper->getLayerCount(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getPixelFormatRequested(buffer_handle_t bufferHandle,
                                                       ui::PixelFormat* outPixelFormatRequested) {
-    return mMapper->getPixelFormatRequested(bufferHandle, outPixelFormatRequested);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::pixelFormatRequested,
+                             outPixelFormatRequested,
+                             [&](ui::PixelFormat* value) {
+                                 return mMapper->getPixelFormatRequested(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getPixelFormatFourCC(buffer_handle_t bufferHandle,
                                                    uint32_t* outPixelFormatFourCC) {
-    return mMapper->getPixelFormatFourCC(bufferHandle, outPixelFormatFourCC);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::pixelFormatFourCC, outPixelFormatFourCC,
+                             [&](uint32_t* value) {
+                                 return mMapper->getPixelFormatFourCC(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getPixelFormatModifier(buffer_handle_t bufferHandle,
                                                      uint64_t* outPixelFormatModifier) {
-    return mMapper->getPixelFormatModifier(bufferHandle, outPixelFormatModifier);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::pixelFormatModifier,
+                             outPixelFormatModifier,
+                             [&](uint64_t* value) {
+                                 return mMapper->getPixelFormatModifier(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getUsage(buffer_handle_t bufferHandle, uint64_t* outUsage) {
-    return mMapper->getUsage(bufferHandle, outUsage);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::usage, outUsage,
+                             [&](uint64_t* value) {
+                                 return mMapper->getUsage(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getAllocationSize(buffer_handle_t bufferHandle,
                                                 uint64_t* outAllocationSize) {
-    return mMapper->getAllocationSize(bufferHandle, outAllocationSize);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::allocationSize, outAllocationSize,
+                             [&](uint64_t* value) {
+                                 return mMapper->getAllocationSize(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getProtectedContent(buffer_handle_t bufferHandle,
                                                   uint64_t* outProtectedContent) {
-    return mMapper->getProtectedContent(bufferHandle, outProtectedContent);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::protectedContent, outProtectedContent,
+                             [&](uint64_t* value) {
+                                 return mMapper->getProtectedContent(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getCompression(
@@ -257,7 +358,10 @@ status_t GraphicBufferMapper::getCompression(
 
 status_t GraphicBufferMapper::getCompression(buffer_handle_t bufferHandle,
                                              ui::Compression* outCompression) {
-    return mMapper->getCompression(bufferHandle, outCompression);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::compression, outCompression,
+                             [&](ui::Compression* value) {
+                                 return mMapper->getCompression(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getInterlaced(
@@ -284,7 +388,10 @@ status_t GraphicBufferMapper::getChromaSiting(buffer_handle_t bufferHandle,
 
 status_t GraphicBufferMapper::getPlaneLayouts(buffer_handle_t bufferHandle,
                                               std::vector<ui::PlaneLayout>* outPlaneLayouts) {
-    return mMapper->getPlaneLayouts(bufferHandle, outPlaneLayouts);
+    return getCachedMetadata(bufferHandle, &CachedMetadata::planeLayouts, outPlaneLayouts,
+                             [&](std::vector<ui::PlaneLayout>* value) {
+                                 return mMapper->getPlaneLayouts(bufferHandle, value);
+                             });
 }
 
 status_t GraphicBufferMapper::getDataspace(buffer_handle_t bufferHandle,
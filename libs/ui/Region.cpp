@@ -19,6 +19,12 @@
 #include <inttypes.h>
 #include <limits.h>
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <android-base/stringprintf.h>
 
 #include <utils/Log.h>
@@ -465,6 +471,42 @@ const Region Region::operation(const Region& rhs, int dx, int dy, uint32_t op) c
 
 // ----------------------------------------------------------------------------
 
+// Returns true if the first |count| rects of |p| and |q| have the same left and right edges.
+// This is the inner loop of the vertical span merge, so it compares both edges of a rect at
+// once where the platform allows it. Rect is laid out as {left, top, right, bottom}.
+static inline bool haveSameHorizontalExtents(const Rect* p, const Rect* q, size_t count) {
+    static_assert(sizeof(Rect) == 4 * sizeof(int32_t), "Rect must be four packed int32_t");
+#if defined(__aarch64__)
+    const uint32x4_t mask = {~0u, 0u, ~0u, 0u};
+    for (size_t i = 0; i < count; i++) {
+        const uint32x4_t eq = vceqq_s32(vld1q_s32(&p[i].left), vld1q_s32(&q[i].left));
+        // A lane of |diff| is non-zero where left or right differ.
+        const uint32x4_t diff = vbicq_u32(mask, eq);
+        if (vmaxvq_u32(diff) != 0) {
+            return false;
+        }
+    }
+    return true;
+#elif defined(__SSE2__)
+    for (size_t i = 0; i < count; i++) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&p[i]));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&q[i]));
+        // Lanes 0 (left) and 2 (right) map to bits 0 and 2 of the movemask.
+        if ((_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))) & 0x5) != 0x5) {
+            return false;
+        }
+    }
+    return true;
+#else
+    for (size_t i = 0; i < count; i++) {
+        if ((p[i].left != q[i].left) || (p[i].right != q[i].right)) {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
 // This is our region rasterizer, which merges rects and spans together
 // to obtain an optimal region.
 class Region::rasterizer : public region_operator<Rect>::region_rasterizer
@@ -535,15 +577,7 @@ void Region::rasterizer::flushSpan()
         Rect const* p = span.data();
         Rect const* q = head;
         if (p->top == q->bottom) {
-            merge = true;
-            while (q != tail) {
-                if ((p->left != q->left) || (p->right != q->right)) {
-                    merge = false;
-                    break;
-                }
-                p++;
-                q++;
-            }
+            merge = haveSameHorizontalExtents(p, q, span.size());
         }
     }
     if (merge) {
@@ -643,10 +677,78 @@ bool Region::validate(const Region& reg, const char* name, bool silent)
     return result;
 }
 
+// Handles the boolean operations whose result is empty, one of the operands, or a single rect,
+// without running the rasterizer. These are by far the most common cases in SurfaceFlinger
+// (e.g. clipping against a display or layer bounds). |rhsBounds| must already be translated.
+// Returns false if the general path must be taken.
+static bool trivialBooleanOperation(uint32_t op, Region& dst, const Region& lhs,
+                                    const Rect& rhsBounds, bool rhsIsRect) {
+    const Rect lhsBounds = lhs.getBounds();
+    const bool lhsEmpty = lhsBounds.isEmpty();
+    const bool rhsEmpty = rhsBounds.isEmpty();
+    Rect intersection;
+    const bool intersects =
+            !lhsEmpty && !rhsEmpty && lhsBounds.intersect(rhsBounds, &intersection);
+    const bool rhsContainsLhs = rhsIsRect && intersects && intersection == lhsBounds;
+
+    switch (op) {
+        case op_and:
+            if (!intersects) {
+                dst.clear();
+                return true;
+            }
+            if (rhsContainsLhs) {
+                dst = lhs;
+                return true;
+            }
+            if (rhsIsRect && lhs.isRect()) {
+                dst.set(intersection);
+                return true;
+            }
+            return false;
+        case op_nand:
+            if (lhsEmpty || rhsContainsLhs) {
+                dst.clear();
+                return true;
+            }
+            if (!intersects) {
+                dst = lhs;
+                return true;
+            }
+            return false;
+        case op_or:
+        case op_xor:
+            if (rhsEmpty) {
+                if (lhsEmpty) {
+                    dst.clear();
+                } else {
+                    dst = lhs;
+                }
+                return true;
+            }
+            if (op == op_or && rhsContainsLhs) {
+                dst.set(rhsBounds);
+                return true;
+            }
+            return false;
+    }
+    return false;
+}
+
 void Region::boolean_operation(uint32_t op, Region& dst,
         const Region& lhs,
         const Region& rhs, int dx, int dy)
 {
+#if !VALIDATE_WITH_CORECG && !defined(VALIDATE_REGIONS)
+    if (rhs.isRect() && rhs.getBounds().isValid()) {
+        boolean_operation(op, dst, lhs, rhs.getBounds(), dx, dy);
+        return;
+    }
+    if (trivialBooleanOperation(op, dst, lhs, rhs.getBounds().offsetBy(dx, dy), false)) {
+        return;
+    }
+#endif
+
 #if defined(VALIDATE_REGIONS)
     validate(lhs, "boolean_operation (before): lhs");
     validate(rhs, "boolean_operation (before): rhs");
@@ -767,6 +869,10 @@ void Region::boolean_operation(uint32_t op, Region& dst,
 #if VALIDATE_WITH_CORECG || defined(VALIDATE_REGIONS)
     boolean_operation(op, dst, lhs, Region(rhs), dx, dy);
 #else
+    if (trivialBooleanOperation(op, dst, lhs, Rect(rhs).offsetBy(dx, dy), true)) {
+        return;
+    }
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
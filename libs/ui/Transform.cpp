@@ -67,6 +67,15 @@ Transform Transform::operator*(const Transform& rhs) const {
     if (rhs.mType == IDENTITY)
         return r;
 
+    if (type() <= TRANSLATE && rhs.type() <= TRANSLATE) {
+        // Two translations, which is what most layer hierarchies are made of. The generic
+        // multiply below adds the translations as well, so the result is bit-identical.
+        r.mMatrix[2][0] = mMatrix[2][0] + rhs.mMatrix[2][0];
+        r.mMatrix[2][1] = mMatrix[2][1] + rhs.mMatrix[2][1];
+        r.mType = (isZero(r.mMatrix[2][0]) && isZero(r.mMatrix[2][1])) ? IDENTITY : TRANSLATE;
+        return r;
+    }
+
     // TODO: we could use mType to optimize the matrix multiply
     const mat33& A(mMatrix);
     const mat33& B(rhs.mMatrix);
@@ -247,12 +256,44 @@ vec2 Transform::transform(float x, float y) const {
     return transform(vec2(x, y));
 }
 
+static Rect makeRect(float left, float top, float right, float bottom, bool roundOutwards) {
+    Rect r;
+    if (roundOutwards) {
+        r.left   = static_cast<int32_t>(floorf(left));
+        r.top    = static_cast<int32_t>(floorf(top));
+        r.right  = static_cast<int32_t>(ceilf(right));
+        r.bottom = static_cast<int32_t>(ceilf(bottom));
+    } else {
+        r.left   = static_cast<int32_t>(floorf(left + 0.5f));
+        r.top    = static_cast<int32_t>(floorf(top + 0.5f));
+        r.right  = static_cast<int32_t>(floorf(right + 0.5f));
+        r.bottom = static_cast<int32_t>(floorf(bottom + 0.5f));
+    }
+    return r;
+}
+
 Rect Transform::makeBounds(int w, int h) const {
     return transform( Rect(w, h) );
 }
 
 Rect Transform::transform(const Rect& bounds, bool roundOutwards) const {
-    Rect r;
+    if (CC_LIKELY(!(type() & ((ROT_90 | ROT_INVALID) << 8)))) {
+        // No rotation or skew, so each edge only depends on the matching edge of the source and
+        // two corners are enough. The products are kept in their own statements so that they are
+        // rounded exactly like in the generic path below.
+        const mat33& M(mMatrix);
+        const float sx0 = M[0][0] * bounds.left;
+        const float sx1 = M[0][0] * bounds.right;
+        const float sy0 = M[1][1] * bounds.top;
+        const float sy1 = M[1][1] * bounds.bottom;
+        const float x0 = sx0 + M[2][0];
+        const float x1 = sx1 + M[2][0];
+        const float y0 = sy0 + M[2][1];
+        const float y1 = sy1 + M[2][1];
+        return makeRect(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1),
+                        roundOutwards);
+    }
+
     vec2 lt( bounds.left,  bounds.top    );
     vec2 rt( bounds.right, bounds.top    );
     vec2 lb( bounds.left,  bounds.bottom );
@@ -263,19 +304,9 @@ Rect Transform::transform(const Rect& bounds, bool roundOutwards) const {
     lb = transform(lb);
     rb = transform(rb);
 
-    if (roundOutwards) {
-        r.left   = static_cast<int32_t>(floorf(std::min({lt[0], rt[0], lb[0], rb[0]})));
-        r.top    = static_cast<int32_t>(floorf(std::min({lt[1], rt[1], lb[1], rb[1]})));
-        r.right  = static_cast<int32_t>(ceilf(std::max({lt[0], rt[0], lb[0], rb[0]})));
-        r.bottom = static_cast<int32_t>(ceilf(std::max({lt[1], rt[1], lb[1], rb[1]})));
-    } else {
-        r.left   = static_cast<int32_t>(floorf(std::min({lt[0], rt[0], lb[0], rb[0]}) + 0.5f));
-        r.top    = static_cast<int32_t>(floorf(std::min({lt[1], rt[1], lb[1], rb[1]}) + 0.5f));
-        r.right  = static_cast<int32_t>(floorf(std::max({lt[0], rt[0], lb[0], rb[0]}) + 0.5f));
-        r.bottom = static_cast<int32_t>(floorf(std::max({lt[1], rt[1], lb[1], rb[1]}) + 0.5f));
-    }
-
-    return r;
+    return makeRect(std::min({lt[0], rt[0], lb[0], rb[0]}), std::min({lt[1], rt[1], lb[1], rb[1]}),
+                    std::max({lt[0], rt[0], lb[0], rb[0]}), std::max({lt[1], rt[1], lb[1], rb[1]}),
+                    roundOutwards);
 }
 
 FloatRect Transform::transform(const FloatRect& bounds) const {
@@ -375,7 +406,7 @@ Transform Transform::inverse() const {
     // followed by a translation: T*M, therefore:
     // (T*M)^-1 = M^-1 * T^-1
     Transform result;
-    if (mType <= TRANSLATE) {
+    if (type() <= TRANSLATE) {
         // 1 0 0
         // 0 1 0
         // x y 1
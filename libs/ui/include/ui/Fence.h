@@ -19,6 +19,8 @@
 
 #include <stdint.h>
 
+#include <atomic>
+
 #include <android-base/unique_fd.h>
 #include <utils/Flattenable.h>
 #include <utils/RefBase.h>
@@ -113,8 +115,20 @@ public:
     // fence transitioned to the signaled state.  If the fence is not signaled
     // then SIGNAL_TIME_PENDING is returned.  If the fence is invalid or if an
     // error occurs then SIGNAL_TIME_INVALID is returned.
+    // Once the fence has signaled the time is cached, so every later call on
+    // this Fence, including those made through different FenceTimes wrapping
+    // it, is answered without a syscall.
     virtual nsecs_t getSignalTime() const;
 
+    // Process-wide counters for getSignalTime. queries counts every call on a
+    // valid fence and fileInfoQueries counts the sync_file_info ioctls that
+    // were actually needed to answer them.
+    struct SignalTimeStats {
+        uint64_t queries = 0;
+        uint64_t fileInfoQueries = 0;
+    };
+    static SignalTimeStats getSignalTimeStats();
+
     enum class Status {
         Invalid,     // Fence is invalid
         Unsignaled,  // Fence is valid but has not yet signaled
@@ -154,6 +168,9 @@ private:
     friend class mock::MockFence;
 
     base::unique_fd mFenceFd;
+
+    // SIGNAL_TIME_PENDING until the fence has been seen signaled.
+    mutable std::atomic<nsecs_t> mSignalTime = SIGNAL_TIME_PENDING;
 };
 
 }; // namespace android
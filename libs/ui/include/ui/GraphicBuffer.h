@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -195,6 +196,17 @@ public:
             android_ycbcr *ycbcr, int fenceFd);
     status_t unlockAsync(int *fenceFd);
 
+    // Keeps the buffer locked for CPU access through the mapper until this is disabled or the
+    // buffer is freed. Meanwhile, lock and lockAsync only wait for the fence and prepare the CPU
+    // caches through the dma-buf of the buffer, and unlock only flushes them, rather than mapping
+    // and unmapping the buffer every time. This is meant for buffers that the CPU accesses on
+    // every frame.
+    //
+    // Requires a buffer with CPU usage whose first fd is a dma-buf. The YCbCr locks are not
+    // supported while this is enabled. This must not be called while the buffer is locked, nor
+    // concurrently with the lock functions.
+    status_t setPersistentCpuMapping(bool enabled);
+
     status_t isSupported(uint32_t inWidth, uint32_t inHeight, PixelFormat inFormat,
                          uint32_t inLayerCount, uint64_t inUsage, bool* outSupported) const;
 
@@ -251,6 +263,12 @@ private:
 
     void free_handle();
 
+    struct PersistentCpuMapping;
+    status_t lockPersistentCpuMapping(uint64_t inUsage, void** vaddr, int fenceFd,
+                                      int32_t* outBytesPerPixel, int32_t* outBytesPerStride);
+    status_t unlockPersistentCpuMapping(int* fenceFd);
+    void releasePersistentCpuMapping();
+
     GraphicBufferMapper& mBufferMapper;
     ssize_t mInitCheck;
 
@@ -281,6 +299,9 @@ private:
     // and informs SurfaceFlinger that it should drop its strong pointer reference to the buffer.
     std::vector<std::pair<GraphicBufferDeathCallback, void* /*mDeathCallbackContext*/>>
             mDeathCallbacks;
+
+    // Set while setPersistentCpuMapping is enabled.
+    std::unique_ptr<PersistentCpuMapping> mPersistentCpuMapping;
 };
 
 }; // namespace android
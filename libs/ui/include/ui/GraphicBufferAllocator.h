@@ -21,7 +21,9 @@
 #include <stdint.h>
 
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <cutils/native_handle.h>
 
@@ -31,6 +33,7 @@
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/Singleton.h>
+#include <utils/Timers.h>
 
 namespace android {
 
@@ -72,6 +75,30 @@ public:
 
     status_t free(buffer_handle_t handle);
 
+    /**
+     * Sets the number of bytes of freed buffers that may be kept around for reuse by later
+     * allocations with the same dimensions, format, layer count and usage. Pooled buffers are
+     * released once they have been unused for a few seconds. A capacity of 0, the default,
+     * disables pooling and releases any pooled buffers.
+     */
+    void setPoolCapacity(uint64_t capacityBytes);
+
+    /**
+     * Asynchronously allocates count buffers into the pool, so that a later allocation with the
+     * same parameters does not wait on the allocator. Does nothing if pooling is disabled.
+     */
+    void preallocate(uint32_t w, uint32_t h, PixelFormat format, uint32_t layerCount,
+                     uint64_t usage, uint32_t count, std::string requestorName);
+
+    struct PoolStats {
+        size_t bufferCount = 0;
+        uint64_t bytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    PoolStats getPoolStats() const;
+
     uint64_t getTotalSize() const;
 
     void dump(std::string& res, bool less = true) const;
@@ -91,11 +118,48 @@ protected:
 
     status_t allocateHelper(uint32_t w, uint32_t h, PixelFormat format, uint32_t layerCount,
                             uint64_t usage, buffer_handle_t* handle, uint32_t* stride,
-                            std::string requestorName, bool importBuffer);
+                            std::string requestorName, bool importBuffer, bool usePool = true);
+
+    struct pool_key_t {
+        uint32_t width;
+        uint32_t height;
+        PixelFormat format;
+        uint32_t layerCount;
+        uint64_t usage;
+
+        bool operator==(const pool_key_t& other) const {
+            return width == other.width && height == other.height && format == other.format &&
+                    layerCount == other.layerCount && usage == other.usage;
+        }
+    };
+
+    struct pooled_buffer_t {
+        pool_key_t key;
+        buffer_handle_t handle;
+        uint32_t stride;
+        size_t size;
+        nsecs_t freeTime;
+    };
+
+    // Pooled buffers unused for longer than this are released.
+    static constexpr nsecs_t kPoolMaxAge = 3'000'000'000;
+
+    bool takeFromPool(const pool_key_t& key, buffer_handle_t* handle, uint32_t* stride);
+    bool addToPool(const pool_key_t& key, buffer_handle_t handle, uint32_t stride, size_t size);
+    // Removes pooled buffers past kPoolMaxAge or beyond the capacity, appending them to evicted.
+    void trimPoolLocked(nsecs_t now, std::vector<buffer_handle_t>& evicted);
+    void releaseBuffers(const std::vector<buffer_handle_t>& handles);
 
     static Mutex sLock;
     static KeyedVector<buffer_handle_t, alloc_rec_t> sAllocList;
 
+    mutable std::mutex mPoolMutex;
+    std::vector<pooled_buffer_t> mPool;
+    uint64_t mPoolBytes = 0;
+    uint64_t mPoolCapacity = 0;
+    uint64_t mPoolHits = 0;
+    uint64_t mPoolMisses = 0;
+
     friend class Singleton<GraphicBufferAllocator>;
     GraphicBufferAllocator();
     ~GraphicBufferAllocator();
@@ -21,6 +21,10 @@
 #include <sys/types.h>
 
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
 #include <ui/GraphicTypes.h>
 #include <ui/PixelFormat.h>
@@ -138,6 +142,38 @@ public:
     status_t setSmpte2094_10(buffer_handle_t bufferHandle,
                              std::optional<std::vector<uint8_t>> smpte2094_10);
 
+    /**
+     * Metadata that is fixed when the buffer is allocated. The getters above for these types are
+     * answered from a per-buffer cache after the first query, until the buffer is freed. Metadata
+     * with setters, such as the dataspace, may be changed by other processes and is never cached.
+     */
+    struct BufferMetadata {
+        uint64_t bufferId = 0;
+        uint64_t width = 0;
+        uint64_t height = 0;
+        uint64_t layerCount = 0;
+        ui::PixelFormat pixelFormatRequested{};
+        uint32_t pixelFormatFourCC = 0;
+        uint64_t pixelFormatModifier = 0;
+        uint64_t usage = 0;
+        uint64_t allocationSize = 0;
+        uint64_t protectedContent = 0;
+        ui::Compression compression{};
+        std::vector<ui::PlaneLayout> planeLayouts;
+    };
+
+    // Gets all of the BufferMetadata in one call, going to the HAL only for the types that are
+    // not cached yet.
+    status_t getMetadata(buffer_handle_t bufferHandle, BufferMetadata* outMetadata);
+
+    struct MetadataCacheStats {
+        size_t bufferCount = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    MetadataCacheStats getMetadataCacheStats() const;
+
     const GrallocMapper& getGrallocMapper() const {
         return reinterpret_cast<const GrallocMapper&>(*mMapper);
     }
@@ -149,9 +185,35 @@ private:
 
     GraphicBufferMapper();
 
+    struct CachedMetadata {
+        std::optional<uint64_t> bufferId;
+        std::optional<uint64_t> width;
+        std::optional<uint64_t> height;
+        std::optional<uint64_t> layerCount;
+        std::optional<ui::PixelFormat> pixelFormatRequested;
+        std::optional<uint32_t> pixelFormatFourCC;
+        std::optional<uint64_t> pixelFormatModifier;
+        std::optional<uint64_t> usage;
+        std::optional<uint64_t> allocationSize;
+        std::optional<uint64_t> protectedContent;
+        std::optional<ui::Compression> compression;
+        std::optional<std::vector<ui::PlaneLayout>> planeLayouts;
+    };
+
+    template <typename T, typename Getter>
+    status_t getCachedMetadata(buffer_handle_t bufferHandle,
+                               std::optional<T> CachedMetadata::*field, T* outValue,
+                               Getter&& getter);
+    void invalidateMetadata(buffer_handle_t bufferHandle);
+
     std::unique_ptr<const GrallocMapper> mMapper;
 
     Version mMapperVersion;
+
+    mutable std::mutex mMetadataMutex;
+    std::unordered_map<buffer_handle_t, CachedMetadata> mMetadataCache;
+    uint64_t mMetadataHits = 0;
+    uint64_t mMetadataMisses = 0;
 };
 
 // ---------------------------------------------------------------------------
@@ -113,4 +113,32 @@ TEST_F(GraphicBufferAllocatorTest, AllocateLargeStride) {
     ASSERT_EQ(NO_ERROR, err);
     ASSERT_EQ(expectedStride, stride);
 }
+
+TEST_F(GraphicBufferAllocatorTest, FreedBufferIsReused) {
+    mAllocator.setPoolCapacity(kTestWidth * kTestHeight * 4);
+    // Expect a single call to the gralloc allocator.
+    mAllocator.setUpAllocateExpectations(NO_ERROR, kTestWidth);
+    android::PixelFormat format = PIXEL_FORMAT_RGBA_8888;
+    uint32_t stride = 0;
+    // The mock does not produce a handle, so provide one that is never dereferenced.
+    buffer_handle_t handle = reinterpret_cast<buffer_handle_t>(0x1);
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, format, kTestLayerCount, kTestUsage,
+                                  &handle, &stride, "GraphicBufferAllocatorTest"));
+    ASSERT_EQ(NO_ERROR, mAllocator.free(handle));
+    EXPECT_EQ(1u, mAllocator.getPoolStats().bufferCount);
+
+    buffer_handle_t reusedHandle = nullptr;
+    uint32_t reusedStride = 0;
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, format, kTestLayerCount, kTestUsage,
+                                  &reusedHandle, &reusedStride, "GraphicBufferAllocatorTest"));
+    EXPECT_EQ(handle, reusedHandle);
+    EXPECT_EQ(stride, reusedStride);
+
+    const auto stats = mAllocator.getPoolStats();
+    EXPECT_EQ(0u, stats.bufferCount);
+    EXPECT_EQ(1u, stats.hits);
+    EXPECT_EQ(1u, stats.misses);
+}
 } // namespace android
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+
+#include <vector>
+
+// Usage: atest Region_benchmark
+
+namespace android {
+namespace {
+
+const Rect kDisplayBounds(0, 0, 1080, 2400);
+
+// A stack of app windows, a status bar and a navigation bar, roughly what SurfaceFlinger sees
+// when computing visible regions on a multi-window device.
+std::vector<Rect> makeLayerBounds(int64_t numLayers) {
+    std::vector<Rect> bounds;
+    bounds.push_back(Rect(0, 0, 1080, 100));
+    bounds.push_back(Rect(0, 2300, 1080, 2400));
+    for (int64_t i = 0; i < numLayers; i++) {
+        const int32_t offset = static_cast<int32_t>(i * 37 % 400);
+        bounds.push_back(Rect(offset, 100 + offset, 680 + offset, 1200 + offset));
+    }
+    return bounds;
+}
+
+// Walks layers top to bottom, accumulating the covered region and deriving each layer's visible
+// region from it, like SurfaceFlinger's visible region computation does.
+void BM_VisibleRegions(benchmark::State& state) {
+    const std::vector<Rect> layers = makeLayerBounds(state.range(0));
+    for (auto _ : state) {
+        Region aboveCoveredLayers;
+        for (const Rect& bounds : layers) {
+            Region visibleRegion(bounds);
+            visibleRegion.andSelf(kDisplayBounds);
+            visibleRegion.subtractSelf(aboveCoveredLayers);
+            aboveCoveredLayers.orSelf(bounds);
+            benchmark::DoNotOptimize(visibleRegion);
+        }
+        benchmark::DoNotOptimize(aboveCoveredLayers);
+    }
+}
+BENCHMARK(BM_VisibleRegions)->Arg(4)->Arg(16)->Arg(64);
+
+// Damage regions are usually a single rect clipped against display or layer bounds, which
+// should not need the general band sweep.
+void BM_ClipSingleRect(benchmark::State& state) {
+    const Region damage(Rect(100, 200, 400, 600));
+    for (auto _ : state) {
+        Region clipped = damage.intersect(kDisplayBounds);
+        clipped.subtractSelf(Rect(2000, 2000, 2100, 2100));
+        benchmark::DoNotOptimize(clipped);
+    }
+}
+BENCHMARK(BM_ClipSingleRect);
+
+// Merging stacked windows of equal width exercises the vertical span merge.
+void BM_MergeAlignedSpans(benchmark::State& state) {
+    const int64_t numRects = state.range(0);
+    Region columns;
+    for (int64_t i = 0; i < numRects; i++) {
+        const int32_t left = static_cast<int32_t>(i * 40);
+        columns.orSelf(Rect(left, 0, left + 20, 10));
+    }
+    for (auto _ : state) {
+        Region merged(columns);
+        for (int32_t top = 10; top < 400; top += 10) {
+            merged.orSelf(columns, 0, top);
+        }
+        benchmark::DoNotOptimize(merged);
+    }
+}
+BENCHMARK(BM_MergeAlignedSpans)->Arg(4)->Arg(16)->Arg(27);
+
+void BM_TJunctionFreeRegion(benchmark::State& state) {
+    Region region;
+    for (const Rect& bounds : makeLayerBounds(state.range(0))) {
+        region.orSelf(bounds);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Region::createTJunctionFreeRegion(region));
+    }
+}
+BENCHMARK(BM_TJunctionFreeRegion)->Arg(4)->Arg(16);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -179,5 +179,49 @@ TEST_F(RegionTest, RegionHash) {
     EXPECT_NE(std::hash<Region>{}(region1), std::hash<Region>{}(region2));
 }
 
+TEST_F(RegionTest, TrivialIntersect) {
+    const Region lhs(Rect(0, 0, 100, 100));
+
+    EXPECT_TRUE(lhs.intersect(Rect(200, 200, 300, 300)).isEmpty());
+    EXPECT_TRUE(lhs.intersect(Region()).isEmpty());
+    EXPECT_TRUE(lhs.hasSameRects(lhs.intersect(Rect(-10, -10, 110, 110))));
+    EXPECT_TRUE(Region(Rect(50, 50, 100, 100)).hasSameRects(lhs.intersect(Rect(50, 50, 150, 150))));
+
+    Region twoRects;
+    twoRects.orSelf(Rect(0, 0, 10, 10));
+    twoRects.orSelf(Rect(20, 20, 30, 30));
+    EXPECT_TRUE(twoRects.hasSameRects(twoRects.intersect(lhs)));
+    EXPECT_TRUE(twoRects.intersect(Rect(10, 10, 20, 20)).isEmpty());
+    // Not trivial: the result only keeps one of the rects
+    EXPECT_TRUE(Region(Rect(0, 0, 10, 10)).hasSameRects(twoRects.intersect(Rect(0, 0, 15, 15))));
+}
+
+TEST_F(RegionTest, TrivialSubtract) {
+    const Region lhs(Rect(0, 0, 100, 100));
+
+    EXPECT_TRUE(lhs.subtract(Rect(-10, -10, 110, 110)).isEmpty());
+    EXPECT_TRUE(lhs.hasSameRects(lhs.subtract(Rect(200, 200, 300, 300))));
+    EXPECT_TRUE(lhs.hasSameRects(lhs.subtract(Region())));
+    EXPECT_TRUE(Region().subtract(lhs).isEmpty());
+    // Translated rhs that no longer overlaps
+    EXPECT_TRUE(lhs.hasSameRects(lhs.subtract(lhs, 100, 0)));
+    EXPECT_TRUE(Region(Rect(0, 0, 50, 100)).hasSameRects(lhs.subtract(lhs, 50, 0)));
+}
+
+TEST_F(RegionTest, TrivialMerge) {
+    const Region lhs(Rect(10, 10, 20, 20));
+
+    EXPECT_TRUE(lhs.hasSameRects(lhs.merge(Region())));
+    EXPECT_TRUE(lhs.hasSameRects(lhs.merge(Rect::INVALID_RECT)));
+    EXPECT_TRUE(Region(Rect(0, 0, 30, 30)).hasSameRects(lhs.merge(Rect(0, 0, 30, 30))));
+    EXPECT_TRUE(lhs.hasSameRects(lhs.mergeExclusive(Region())));
+
+    const Region merged = lhs.merge(Rect(30, 30, 40, 40));
+    EXPECT_EQ(2, merged.end() - merged.begin());
+    EXPECT_TRUE(merged.contains(15, 15));
+    EXPECT_TRUE(merged.contains(35, 35));
+    EXPECT_FALSE(merged.contains(25, 25));
+}
+
 }; // namespace android
 
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <ui/Transform.h>
+
+#include <vector>
+
+// Usage: atest Transform_benchmark
+
+namespace android::ui {
+namespace {
+
+enum class LayerKind : int64_t {
+    // Windows positioned by their parents, which is what nearly every layer looks like.
+    Translate,
+    // Scaled surfaces, e.g. video or compat-scaled apps.
+    Scale,
+    // A rotated buffer, which takes the generic path.
+    Rotate,
+};
+
+// A hierarchy of layers, each positioned inside its parent, like the ones that SurfaceFlinger
+// composes when it computes the geometry of each layer snapshot.
+std::vector<Transform> makeLayerStack(LayerKind kind, int64_t depth) {
+    std::vector<Transform> stack;
+    for (int64_t i = 0; i < depth; i++) {
+        Transform t;
+        if (kind == LayerKind::Scale && i % 2 == 1) {
+            t.set(0.5f, 0.f, 0.f, 0.75f);
+        } else if (kind == LayerKind::Rotate && i == 1) {
+            t.set(Transform::ROT_90, 1080, 2400);
+        }
+        t.set(static_cast<float>(i * 16), static_cast<float>(i * 40));
+        stack.push_back(t);
+    }
+    return stack;
+}
+
+// Composes the stack and maps each layer's bounds and damage to display space.
+void BM_LayerStackGeometry(benchmark::State& state) {
+    const std::vector<Transform> stack =
+            makeLayerStack(static_cast<LayerKind>(state.range(0)), state.range(1));
+    Region damage(Rect(0, 0, 200, 100));
+    damage.orSelf(Rect(300, 400, 700, 900));
+    for (auto _ : state) {
+        Transform parent;
+        for (const Transform& local : stack) {
+            const Transform layerTransform = parent * local;
+            const Transform inverse = layerTransform.inverse();
+            benchmark::DoNotOptimize(layerTransform.makeBounds(1080, 2400));
+            benchmark::DoNotOptimize(inverse.transform(Rect(100, 100, 500, 900)));
+            benchmark::DoNotOptimize(layerTransform.transform(damage));
+            parent = layerTransform;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * stack.size());
+}
+BENCHMARK(BM_LayerStackGeometry)
+        ->ArgsProduct({{static_cast<int64_t>(LayerKind::Translate),
+                        static_cast<int64_t>(LayerKind::Scale),
+                        static_cast<int64_t>(LayerKind::Rotate)},
+                       {4, 16}});
+
+} // namespace
+} // namespace android::ui
+
+BENCHMARK_MAIN();
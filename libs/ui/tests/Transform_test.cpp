@@ -46,4 +46,37 @@ TEST(TransformTest, inverseRotation_hasCorrectType) {
     testRotationFlagsForInverse(Transform::FLIP_V, Transform::FLIP_V, false);
 }
 
+TEST(TransformTest, composedTranslations_areTranslations) {
+    Transform a;
+    a.set(10.5f, -4.f);
+    Transform b;
+    b.set(-10.5f, 4.f);
+    EXPECT_EQ(Transform::IDENTITY, (a * b).getType());
+
+    b.set(2.f, 3.f);
+    const Transform ab = a * b;
+    EXPECT_EQ(Transform::TRANSLATE, ab.getType());
+    EXPECT_EQ(12.5f, ab.tx());
+    EXPECT_EQ(-1.f, ab.ty());
+    EXPECT_EQ(Transform::IDENTITY, (ab * ab.inverse()).getType());
+}
+
+TEST(TransformTest, transformRect_axisAligned) {
+    Transform t;
+    t.set(2.f, 0.f, 0.f, 0.5f);
+    t.set(10.f, 20.f);
+    EXPECT_EQ(Rect(30, 25, 50, 30), t.transform(Rect(10, 10, 20, 20)));
+    EXPECT_EQ(Rect(30, 25, 50, 30), t.transform(Rect(10, 10, 20, 20), /*roundOutwards=*/true));
+    EXPECT_EQ(Rect(30, 25, 50, 31), t.transform(Rect(10, 11, 20, 21), /*roundOutwards=*/true));
+
+    // Flips swap the edges.
+    const Transform flip(Transform::FLIP_H, 100, 100);
+    EXPECT_EQ(Rect(80, 10, 90, 20), flip.transform(Rect(10, 10, 20, 20)));
+}
+
+TEST(TransformTest, transformRect_rotated) {
+    const Transform rot(Transform::ROT_90, 100, 200);
+    EXPECT_EQ(Rect(80, 10, 90, 30), rot.transform(Rect(10, 10, 30, 20)));
+}
+
 } // namespace android::ui
@@ -49,6 +49,8 @@ void UltraHdrDecFuzzer::process() {
     jpegr_info_struct info{0, 0, &iccData, &exifData};
     JpegR jpegHdr;
     (void)jpegHdr.getJPEGRInfo(&jpegImgR, &info);
+    jpegr_probe_struct probe;
+    (void)jpegHdr.probeJPEGR(&jpegImgR, &probe);
 //#define DUMP_PARAM
 #ifdef DUMP_PARAM
     std::cout << "input buffer size " << jpegImgR.length << std::endl;
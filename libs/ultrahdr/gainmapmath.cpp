@@ -18,6 +18,10 @@
 #include <vector>
 #include <ultrahdr/gainmapmath.h>
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 namespace android::ultrahdr {
 
 static const std::vector<float> kPqOETF = [] {
@@ -644,14 +648,75 @@ Color getP010Pixel(jr_uncompressed_ptr image, size_t x, size_t y) {
              (static_cast<float>(v_uint) - 64.0f) / 896.0f - 0.5f }}};
 }
 
-typedef Color (*getPixelFn)(jr_uncompressed_ptr, size_t, size_t);
+void getYuv420RowAsRgb601(jr_uncompressed_ptr image, size_t y, Color* dest) {
+  const size_t width = image->width;
+  const size_t pixel_count = image->width * image->height;
+  const uint8_t* y_row = reinterpret_cast<uint8_t*>(image->data) + y * width;
+  const uint8_t* u_row = reinterpret_cast<uint8_t*>(image->data) + pixel_count
+                       + (y / 2) * (width / 2);
+  const uint8_t* v_row = reinterpret_cast<uint8_t*>(image->data) + pixel_count * 5 / 4
+                       + (y / 2) * (width / 2);
+
+  size_t x = 0;
+#if defined(__aarch64__)
+  // 16 pixels, sharing 8 chroma samples, per iteration.
+  const float32x4_t kScale = vdupq_n_f32(1.0f / 255.0f);
+  const float32x4_t kZero = vdupq_n_f32(0.0f);
+  const float32x4_t kOne = vdupq_n_f32(kMaxPixelFloat);
+  const int16x8_t kBias = vdupq_n_s16(128);
+  for (; x + 16 <= width; x += 16) {
+    const uint8x16_t y_u8 = vld1q_u8(y_row + x);
+    const uint8x8_t u_u8 = vld1_u8(u_row + x / 2);
+    const uint8x8_t v_u8 = vld1_u8(v_row + x / 2);
+    // Every chroma sample covers two pixels of the row.
+    const uint8x8x2_t u_dup = vzip_u8(u_u8, u_u8);
+    const uint8x8x2_t v_dup = vzip_u8(v_u8, v_u8);
+
+    const uint16x8_t y_u16[2] = { vmovl_u8(vget_low_u8(y_u8)), vmovl_u8(vget_high_u8(y_u8)) };
+    const int16x8_t u_s16[2] = {
+        vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u_dup.val[0])), kBias),
+        vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u_dup.val[1])), kBias) };
+    const int16x8_t v_s16[2] = {
+        vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v_dup.val[0])), kBias),
+        vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v_dup.val[1])), kBias) };
+
+    for (size_t i = 0; i < 4; ++i) {
+      const uint16x8_t y_half = y_u16[i / 2];
+      const int16x8_t u_half = u_s16[i / 2];
+      const int16x8_t v_half = v_s16[i / 2];
+      const bool high = i % 2 != 0;
+      const float32x4_t y_f = vmulq_f32(vcvtq_f32_u32(
+          high ? vmovl_high_u16(y_half) : vmovl_u16(vget_low_u16(y_half))), kScale);
+      const float32x4_t u_f = vmulq_f32(vcvtq_f32_s32(
+          high ? vmovl_high_s16(u_half) : vmovl_s16(vget_low_s16(u_half))), kScale);
+      const float32x4_t v_f = vmulq_f32(vcvtq_f32_s32(
+          high ? vmovl_high_s16(v_half) : vmovl_s16(vget_low_s16(v_half))), kScale);
+
+      float32x4x3_t rgb;
+      rgb.val[0] = vfmaq_n_f32(y_f, v_f, kP3Cr);
+      rgb.val[1] = vfmsq_n_f32(vfmsq_n_f32(y_f, u_f, kP3GCb), v_f, kP3GCr);
+      rgb.val[2] = vfmaq_n_f32(y_f, u_f, kP3Cb);
+      for (size_t c = 0; c < 3; ++c) {
+        rgb.val[c] = vminq_f32(vmaxq_f32(rgb.val[c], kZero), kOne);
+      }
+      vst3q_f32(&dest[x + i * 4].r, rgb);
+    }
+  }
+#endif
+  for (; x < width; ++x) {
+    dest[x] = p3YuvToRgb(getYuv420Pixel(image, x, y));
+  }
+}
 
-static Color samplePixels(jr_uncompressed_ptr image, size_t map_scale_factor, size_t x, size_t y,
-                          getPixelFn get_pixel_fn) {
+// Templated rather than taking a function pointer so that the pixel getter is inlined, this is
+// called for every pixel of the image while generating the gain map.
+template <Color (*getPixel)(jr_uncompressed_ptr, size_t, size_t)>
+static Color samplePixels(jr_uncompressed_ptr image, size_t map_scale_factor, size_t x,
+                          size_t y) {
   Color e = {{{ 0.0f, 0.0f, 0.0f }}};
   for (size_t dy = 0; dy < map_scale_factor; ++dy) {
     for (size_t dx = 0; dx < map_scale_factor; ++dx) {
-      e += get_pixel_fn(image, x * map_scale_factor + dx, y * map_scale_factor + dy);
+      e += getPixel(image, x * map_scale_factor + dx, y * map_scale_factor + dy);
     }
   }
 
@@ -659,11 +724,11 @@ static Color samplePixels(jr_uncompressed_ptr image, size_t map_scale_factor, si
 }
 
 Color sampleYuv420(jr_uncompressed_ptr image, size_t map_scale_factor, size_t x, size_t y) {
-  return samplePixels(image, map_scale_factor, x, y, getYuv420Pixel);
+  return samplePixels<getYuv420Pixel>(image, map_scale_factor, x, y);
 }
 
 Color sampleP010(jr_uncompressed_ptr image, size_t map_scale_factor, size_t x, size_t y) {
-  return samplePixels(image, map_scale_factor, x, y, getP010Pixel);
+  return samplePixels<getP010Pixel>(image, map_scale_factor, x, y);
 }
 
 // TODO: do we need something more clever for filtering either the map or images
@@ -440,6 +440,15 @@ Color applyGainLUT(Color e, float gain, GainLUT& gainLUT);
  */
 Color getYuv420Pixel(jr_uncompressed_ptr image, size_t x, size_t y);
 
+/*
+ * Convert row y of a YUV 420 image to OETF'd RGB using the Rec.601 coefficients, writing
+ * image->width pixels to dest.
+ *
+ * Matches p3YuvToRgb(getYuv420Pixel(image, x, y)) for every x of the row, but converts multiple
+ * pixels at a time where the CPU supports it.
+ */
+void getYuv420RowAsRgb601(jr_uncompressed_ptr image, size_t y, Color* dest);
+
 /*
  * Helper for sampling from P010 images.
  *
@@ -24,6 +24,7 @@ extern "C" {
 #include <jpeglib.h>
 }
 #include <utils/Errors.h>
+#include <functional>
 #include <vector>
 
 static const int kMaxWidth = 8192;
@@ -44,6 +45,19 @@ public:
      * Returns false if decompressing the image fails.
      */
     bool decompressImage(const void* image, int length, bool decodeToRGBA = false);
+    /*
+     * Receives rows [rowStart, rowStart + rowCount) of the image being decompressed by
+     * decompressImageRows(), as a YUV420 planar image of getDecompressedImageWidth() by rowCount
+     * pixels. The rows are only valid during the call. Returns false to stop decompressing.
+     */
+    using RowCallback = std::function<bool(const uint8_t* rows, size_t rowStart, size_t rowCount)>;
+    /*
+     * Decompresses a YUV420 JPEG image a batch of rows at a time, without ever holding the whole
+     * decompressed image in memory. The decompressed image buffer stays empty, the other getters
+     * work as after decompressImage(). Stopping early from the callback is not a failure.
+     * Returns false if decompressing the image fails.
+     */
+    bool decompressImageRows(const void* image, int length, const RowCallback& callback);
     /*
      * Returns the decompressed raw image buffer pointer. This method must be called only after
      * calling decompressImage().
@@ -100,12 +114,16 @@ public:
                                       std::vector<uint8_t>* exifData);
 
 private:
-    bool decode(const void* image, int length, bool decodeToRGBA);
+    bool decode(const void* image, int length, bool decodeToRGBA,
+                const RowCallback* rowCallback = nullptr);
     // Returns false if errors occur.
     bool decompress(jpeg_decompress_struct* cinfo, const uint8_t* dest, bool isSingleChannel);
     bool decompressYUV(jpeg_decompress_struct* cinfo, const uint8_t* dest);
     bool decompressRGBA(jpeg_decompress_struct* cinfo, const uint8_t* dest);
     bool decompressSingleChannel(jpeg_decompress_struct* cinfo, const uint8_t* dest);
+    // Returns false if errors occur, sets stopped if the callback stopped decompressing.
+    bool decompressYUVRows(jpeg_decompress_struct* cinfo, const RowCallback& callback,
+                           bool* stopped);
     // Process 16 lines of Y and 16 lines of U/V each time.
     // We must pass at least 16 scanlines according to libjpeg documentation.
     static const int kCompressBatchSize = 16;
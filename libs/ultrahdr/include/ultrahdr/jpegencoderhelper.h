@@ -30,14 +30,30 @@ extern "C" {
 
 namespace android::ultrahdr {
 
+/*
+ * Interface of converters from raw image (YUV420planer or grey-scale) to JPEG format, so that
+ * devices can provide encoders backed by dedicated hardware. See JpegEncoderHelper for the
+ * software implementation and the contract of the methods.
+ */
+class JpegEncoder {
+public:
+    virtual ~JpegEncoder() = default;
+
+    virtual bool compressImage(const void* image, int width, int height, int quality,
+                               const void* iccBuffer, unsigned int iccSize,
+                               bool isSingleChannel = false) = 0;
+    virtual void* getCompressedImagePtr() = 0;
+    virtual size_t getCompressedImageSize() = 0;
+};
+
 /*
  * Encapsulates a converter from raw image (YUV420planer or grey-scale) to JPEG format.
  * This class is not thread-safe.
  */
-class JpegEncoderHelper {
+class JpegEncoderHelper : public JpegEncoder {
 public:
     JpegEncoderHelper();
-    ~JpegEncoderHelper();
+    ~JpegEncoderHelper() override;
 
     /*
      * Compresses YUV420Planer image to JPEG format. After calling this method, call
@@ -47,19 +63,20 @@ public:
      * Returns false if errors occur during compression.
      */
     bool compressImage(const void* image, int width, int height, int quality,
-                       const void* iccBuffer, unsigned int iccSize, bool isSingleChannel = false);
+                       const void* iccBuffer, unsigned int iccSize,
+                       bool isSingleChannel = false) override;
 
     /*
      * Returns the compressed JPEG buffer pointer. This method must be called only after calling
      * compressImage().
      */
-    void* getCompressedImagePtr();
+    void* getCompressedImagePtr() override;
 
     /*
      * Returns the compressed JPEG buffer size. This method must be called only after calling
      * compressImage().
      */
-    size_t getCompressedImageSize();
+    size_t getCompressedImageSize() override;
 
     /*
      * Process 16 lines of Y and 16 lines of U/V each time.
@@ -21,6 +21,9 @@
 #include "jpegrerrorcode.h"
 #include "ultrahdr.h"
 
+#include <functional>
+#include <memory>
+
 #ifndef FLT_MAX
 #define FLT_MAX 0x1.fffffep127f
 #endif
@@ -34,6 +37,20 @@ struct jpegr_info_struct {
     std::vector<uint8_t>* exifData;
 };
 
+/*
+ * Holds what JpegR::probeJPEGR() reads from the headers of a JPEG/R image.
+ */
+struct jpegr_probe_struct {
+    // Dimensions of the primary image in pixels.
+    size_t width;
+    size_t height;
+    // Offset and length in bytes of the compressed gain map in the JPEG/R image.
+    size_t gainMapOffset;
+    size_t gainMapLength;
+    // Gain map metadata.
+    ultrahdr_metadata_struct metadata;
+};
+
 /*
  * Holds information for uncompressed image or gain map.
  */
@@ -86,13 +103,50 @@ struct jpegr_exif_struct {
     int length;
 };
 
+/*
+ * Holds a rectangular region of an image.
+ */
+struct jpegr_region_struct {
+    // Left and top edges of the region in pixels, inclusive.
+    int left;
+    int top;
+    // Right and bottom edges of the region in pixels, exclusive.
+    int right;
+    int bottom;
+};
+
 typedef struct jpegr_uncompressed_struct* jr_uncompressed_ptr;
 typedef struct jpegr_compressed_struct* jr_compressed_ptr;
 typedef struct jpegr_exif_struct* jr_exif_ptr;
 typedef struct jpegr_info_struct* jr_info_ptr;
+typedef struct jpegr_probe_struct* jr_probe_ptr;
+typedef struct jpegr_region_struct* jr_region_ptr;
+
+/*
+ * Receives a strip of rows of an image decoded by JpegR::decodeJPEGRStrips(). The width of the
+ * strip is the width of the decoded region and its height the number of rows in the strip. row is
+ * the index of the first row of the strip in the image. The strip data is only valid during the
+ * call. Returns false to stop decoding.
+ */
+typedef std::function<bool(jr_uncompressed_ptr strip, int row)> jr_strip_callback;
 
 class JpegR {
 public:
+    /*
+     * Creates the encoder for the gain map (is_gain_map true) or the primary image of a JPEGR
+     * image. The gain map and the primary image may be encoded concurrently, so every call must
+     * return a distinct encoder. Returning nullptr, or an encoder failing to compress its image,
+     * falls back to the software encoder.
+     */
+    typedef std::function<std::unique_ptr<JpegEncoder>(bool is_gain_map)> JpegEncoderFactory;
+
+    JpegR() = default;
+    /*
+     * Uses encoders from encoder_factory to compress the images, e.g. to use a hardware JPEG
+     * encoder.
+     */
+    explicit JpegR(JpegEncoderFactory encoder_factory);
+
     /*
      * Experimental only
      *
@@ -266,6 +320,33 @@ public:
                          jr_uncompressed_ptr gain_map = nullptr,
                          ultrahdr_metadata_ptr metadata = nullptr);
 
+    /*
+     * Decompress JPEGR image one strip of rows at a time.
+     *
+     * Unlike decodeJPEGR(), the primary image is never fully held in memory: each strip of it is
+     * decoded, has the gain map applied and is handed to the callback before the next one is
+     * decoded, so memory use is proportional to the gain map and the strip size rather than to
+     * the image size. This suits thumbnails and tiled viewers, which only need part of the image
+     * or can consume it incrementally.
+     *
+     * @param compressed_jpegr_image compressed JPEGR image.
+     * @param callback receives the decoded strips, from top to bottom.
+     * @param max_display_boost (optional) the maximum available boost supported by a display,
+     *                          the value must be greater than or equal to 1.0.
+     * @param output_format flag for setting output color format, see decodeJPEGR(). Only HDR
+     *                      formats are supported.
+     * @param region (optional) region of the image to decode. Strips only contain its columns,
+     *               and decoding stops after its last row. The default value is NULL where the
+     *               whole image is decoded.
+     * @return NO_ERROR if decoding succeeds or is stopped by the callback, error code if error
+     *         occurs.
+     */
+    status_t decodeJPEGRStrips(jr_compressed_ptr compressed_jpegr_image,
+                               const jr_strip_callback& callback,
+                               float max_display_boost = FLT_MAX,
+                               ultrahdr_output_format output_format = ULTRAHDR_OUTPUT_HDR_LINEAR,
+                               jr_region_ptr region = nullptr);
+
     /*
     * Gets Info from JPEGR file without decoding it.
     *
@@ -280,6 +361,22 @@ public:
     */
     status_t getJPEGRInfo(jr_compressed_ptr compressed_jpegr_image,
                           jr_info_ptr jpegr_info);
+
+    /*
+     * Checks whether an image is JPEG/R and reads its gain map metadata, without decoding it.
+     *
+     * Unlike getJPEGRInfo(), this only walks the marker segments in the headers of the primary
+     * image and of the gain map, which the MPF package of the primary image locates. Neither
+     * image is decoded and no memory is allocated for them, so this suits scanning many files,
+     * and compressed_jpegr_image may point to a read-only mapping of a file.
+     *
+     * @param compressed_jpegr_image compressed JPEGR image
+     * @param jpegr_probe destination of the dimensions, gain map location and gain map metadata
+     * @return NO_ERROR if the image is JPEG/R, ERROR_JPEGR_GAIN_MAP_IMAGE_NOT_FOUND if it is a
+     *         JPEG image without gain map, in which case only the dimensions are filled, error
+     *         code otherwise
+     */
+    status_t probeJPEGR(jr_compressed_ptr compressed_jpegr_image, jr_probe_ptr jpegr_probe);
 protected:
     /*
      * This method is called in the encoding pipeline. It will take the uncompressed 8-bit and
@@ -331,11 +428,33 @@ private:
      * This method is called in the encoding pipeline. It will encode the gain map.
      *
      * @param uncompressed_gain_map uncompressed gain map
-     * @param resource to compress gain map
+     * @param jpeg_encoder destination of the encoder holding the compressed gain map
      * @return NO_ERROR if encoding succeeds, error code if error occurs.
      */
     status_t compressGainMap(jr_uncompressed_ptr uncompressed_gain_map,
-                             JpegEncoderHelper* jpeg_encoder);
+                             std::unique_ptr<JpegEncoder>* jpeg_encoder);
+
+    /*
+     * This method is called in the encoding pipeline. It will encode the Bt.601 primary image.
+     *
+     * @param uncompressed_yuv_420_image uncompressed primary image in YUV_420 color format
+     * @param quality target quality of the JPEG encoding
+     * @param icc ICC package to add to the compressed image
+     * @param icc_size length in bytes of ICC package
+     * @param jpeg_encoder destination of the encoder holding the compressed primary image
+     * @return NO_ERROR if encoding succeeds, error code if error occurs.
+     */
+    status_t compressPrimaryImage(jr_uncompressed_ptr uncompressed_yuv_420_image, int quality,
+                                  const void* icc, size_t icc_size,
+                                  std::unique_ptr<JpegEncoder>* jpeg_encoder);
+
+    /*
+     * Compresses an image with an encoder from mEncoderFactory, falling back to the software
+     * encoder. Returns nullptr if compressing fails.
+     */
+    std::unique_ptr<JpegEncoder> compressImage(const void* image, int width, int height,
+                                               int quality, const void* icc, size_t icc_size,
+                                               bool is_gain_map);
 
     /*
      * This methoud is called to separate primary image and gain map image from JPEGR
@@ -436,6 +555,8 @@ private:
                                      ultrahdr_transfer_function hdr_tf,
                                      jr_compressed_ptr dest,
                                      int quality);
+
+    JpegEncoderFactory mEncoderFactory;
 };
 
 } // namespace android::ultrahdr
@@ -59,6 +59,19 @@ size_t calculateMpfSize();
 sp<DataStruct> generateMpf(int primary_image_size, int primary_image_offset,
                            int secondary_image_size, int secondary_image_offset);
 
+/*
+ * Finds the secondary image in an MPF package, as written by generateMpf().
+ *
+ * @param mpf_data MPF package, starting with the MPF signature
+ * @param mpf_size length in bytes of the MPF package
+ * @param secondary_image_offset destination of the offset of the secondary image, relative to
+ *                               the endianness field that follows the signature
+ * @param secondary_image_size destination of the length in bytes of the secondary image
+ * @return true if the package is valid and has a secondary image, false otherwise
+ */
+bool findSecondaryImageInMpf(const uint8_t* mpf_data, size_t mpf_size,
+                             size_t* secondary_image_offset, size_t* secondary_image_size);
+
 }  // namespace android::ultrahdr
 
 #endif //ANDROID_ULTRAHDR_MULTIPICTUREFORMAT_H
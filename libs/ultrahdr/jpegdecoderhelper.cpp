@@ -18,6 +18,7 @@
 
 #include <utils/Log.h>
 
+#include <algorithm>
 #include <errno.h>
 #include <setjmp.h>
 #include <string>
@@ -113,6 +114,18 @@ bool JpegDecoderHelper::decompressImage(const void* image, int length, bool deco
     return true;
 }
 
+bool JpegDecoderHelper::decompressImageRows(const void* image, int length,
+                                            const RowCallback& callback) {
+    if (image == nullptr || length <= 0) {
+        ALOGE("Image size can not be handled: %d", length);
+        return false;
+    }
+
+    mResultBuffer.clear();
+    mXMPBuffer.clear();
+    return decode(image, length, false /* decodeToRGBA */, &callback);
+}
+
 void* JpegDecoderHelper::getDecompressedImagePtr() {
     return mResultBuffer.data();
 }
@@ -153,11 +166,13 @@ size_t JpegDecoderHelper::getDecompressedImageHeight() {
     return mHeight;
 }
 
-bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA) {
+bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA,
+                               const RowCallback* rowCallback) {
     jpeg_decompress_struct cinfo;
     jpegr_source_mgr mgr(static_cast<const uint8_t*>(image), length);
     jpegrerror_mgr myerr;
     bool status = true;
+    bool stopped = false;
 
     cinfo.err = jpeg_std_error(&myerr.pub);
     myerr.pub.error_exit = jpegrerror_exit;
@@ -226,6 +241,12 @@ bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA)
     mWidth = cinfo.image_width;
     mHeight = cinfo.image_height;
 
+    if (rowCallback != nullptr && cinfo.jpeg_color_space != JCS_YCbCr) {
+        status = false;
+        ALOGE("%s: decoding rows is only supported for YUV images", __func__);
+        goto CleanUp;
+    }
+
     if (decodeToRGBA) {
         if (cinfo.jpeg_color_space == JCS_GRAYSCALE) {
             // We don't intend to support decoding grayscale to RGBA
@@ -248,7 +269,9 @@ bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA)
                 ALOGE("%s: decoding to YUV only supports 4:2:0 subsampling", __func__);
                 goto CleanUp;
             }
-            mResultBuffer.resize(cinfo.image_width * cinfo.image_height * 3 / 2, 0);
+            if (rowCallback == nullptr) {
+                mResultBuffer.resize(cinfo.image_width * cinfo.image_height * 3 / 2, 0);
+            }
         } else if (cinfo.jpeg_color_space == JCS_GRAYSCALE) {
             mResultBuffer.resize(cinfo.image_width * cinfo.image_height, 0);
         }
@@ -260,6 +283,13 @@ bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA)
 
     jpeg_start_decompress(&cinfo);
 
+    if (rowCallback != nullptr) {
+        if (!decompressYUVRows(&cinfo, *rowCallback, &stopped)) {
+            status = false;
+        }
+        goto CleanUp;
+    }
+
     if (!decompress(&cinfo, static_cast<const uint8_t*>(mResultBuffer.data()),
             cinfo.jpeg_color_space == JCS_GRAYSCALE)) {
         status = false;
@@ -267,7 +297,12 @@ bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA)
     }
 
 CleanUp:
-    jpeg_finish_decompress(&cinfo);
+    if (stopped) {
+        // Finishing requires all scanlines to have been read.
+        jpeg_abort_decompress(&cinfo);
+    } else {
+        jpeg_finish_decompress(&cinfo);
+    }
     jpeg_destroy_decompress(&cinfo);
 
     return status;
@@ -448,6 +483,61 @@ bool JpegDecoderHelper::decompressYUV(jpeg_decompress_struct* cinfo, const uint8
     return true;
 }
 
+bool JpegDecoderHelper::decompressYUVRows(jpeg_decompress_struct* cinfo,
+                                          const RowCallback& callback, bool* stopped) {
+    // libjpeg writes whole MCUs, so decompress into rows of the aligned width and pack them into
+    // a batch of rows of the image width for the callback.
+    const size_t width = cinfo->image_width;
+    const size_t aligned_width = ALIGNM(width, kCompressBatchSize);
+    std::unique_ptr<uint8_t[]> buffer_intrm =
+            std::make_unique<uint8_t[]>(aligned_width * kCompressBatchSize * 3 / 2);
+    uint8_t* y_plane_intrm = buffer_intrm.get();
+    uint8_t* u_plane_intrm = y_plane_intrm + aligned_width * kCompressBatchSize;
+    uint8_t* v_plane_intrm = u_plane_intrm + aligned_width * kCompressBatchSize / 4;
+    JSAMPROW y_intrm[kCompressBatchSize];
+    JSAMPROW cb_intrm[kCompressBatchSize / 2];
+    JSAMPROW cr_intrm[kCompressBatchSize / 2];
+    JSAMPARRAY planes_intrm[3] {y_intrm, cb_intrm, cr_intrm};
+    for (int i = 0; i < kCompressBatchSize; ++i) {
+        y_intrm[i] = y_plane_intrm + i * aligned_width;
+    }
+    for (int i = 0; i < kCompressBatchSize / 2; ++i) {
+        cb_intrm[i] = u_plane_intrm + i * (aligned_width / 2);
+        cr_intrm[i] = v_plane_intrm + i * (aligned_width / 2);
+    }
+
+    // Sized for a full batch even when fewer rows are packed into it, so that sampling the chroma
+    // of an odd last row stays within the buffer.
+    std::vector<uint8_t> rows(width * kCompressBatchSize * 3 / 2);
+    while (cinfo->output_scanline < cinfo->image_height) {
+        const size_t row_start = cinfo->output_scanline;
+        const size_t row_count = std::min(static_cast<size_t>(kCompressBatchSize),
+                                          cinfo->image_height - row_start);
+        int processed = jpeg_read_raw_data(cinfo, planes_intrm, kCompressBatchSize);
+        if (processed != kCompressBatchSize) {
+            ALOGE("Number of processed lines does not equal input lines.");
+            return false;
+        }
+
+        // Same layout as a YUV420 image of row_count rows, see getYuv420Pixel().
+        uint8_t* y_plane = rows.data();
+        uint8_t* u_plane = y_plane + width * row_count;
+        uint8_t* v_plane = y_plane + width * row_count * 5 / 4;
+        for (size_t i = 0; i < row_count; ++i) {
+            memcpy(y_plane + i * width, y_intrm[i], width);
+        }
+        for (size_t i = 0; i < row_count / 2; ++i) {
+            memcpy(u_plane + i * (width / 2), cb_intrm[i], width / 2);
+            memcpy(v_plane + i * (width / 2), cr_intrm[i], width / 2);
+        }
+        if (!callback(rows.data(), row_start, row_count)) {
+            *stopped = cinfo->output_scanline < cinfo->image_height;
+            return true;
+        }
+    }
+    return true;
+}
+
 bool JpegDecoderHelper::decompressSingleChannel(jpeg_decompress_struct* cinfo, const uint8_t* dest) {
     JSAMPROW y[kCompressBatchSize];
     JSAMPARRAY planes[1] {y};
@@ -36,6 +36,8 @@
 #include <cmath>
 #include <condition_variable>
 #include <deque>
+#include <fstream>
+#include <future>
 #include <mutex>
 #include <thread>
 #include <unistd.h>
@@ -96,6 +98,37 @@ int GetCPUCoreCount() {
   return cpuCoreCount;
 }
 
+// Upper bound on the number of threads generating or applying a gain map.
+static const int kMaxWorkerThreads = 8;
+
+// Number of threads to split gain map generation and application across. Rows are handed out in
+// equally sized jobs, so cores much slower than the fastest ones, like the little cores of a
+// heterogeneous system, tend to finish their last job well after the others and end up delaying
+// the whole operation. Those are left out based on the capacity the kernel reports for each core.
+int GetWorkerThreadCount() {
+  static const int workerThreadCount = [] {
+    const int cpuCoreCount = GetCPUCoreCount();
+    int maxCapacity = 0;
+    std::vector<int> capacities;
+    for (int cpu = 0; cpu < cpuCoreCount; cpu++) {
+      std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpu_capacity");
+      int capacity = 0;
+      if (!(file >> capacity)) {
+        // No topology information, e.g. on the host or on symmetric systems.
+        return std::clamp(cpuCoreCount, 1, kMaxWorkerThreads);
+      }
+      capacities.push_back(capacity);
+      maxCapacity = std::max(maxCapacity, capacity);
+    }
+    const int performanceCoreCount = std::count_if(capacities.begin(), capacities.end(),
+        [maxCapacity](int capacity) { return capacity * 2 >= maxCapacity; });
+    return std::clamp(performanceCoreCount, 1, kMaxWorkerThreads);
+  }();
+  return workerThreadCount;
+}
+
+JpegR::JpegR(JpegEncoderFactory encoder_factory) : mEncoderFactory(std::move(encoder_factory)) {}
+
 status_t JpegR::areInputArgumentsValid(jr_uncompressed_ptr uncompressed_p010_image,
                                        jr_uncompressed_ptr uncompressed_yuv_420_image,
                                        ultrahdr_transfer_function hdr_tf,
@@ -247,13 +280,13 @@ status_t JpegR::encodeJPEGR(jr_uncompressed_ptr uncompressed_p010_image,
   std::unique_ptr<uint8_t[]> map_data;
   map_data.reset(reinterpret_cast<uint8_t*>(map.data));
 
-  JpegEncoderHelper jpeg_encoder_gainmap;
-  JPEGR_CHECK(compressGainMap(&map, &jpeg_encoder_gainmap));
-  jpegr_compressed_struct compressed_map;
-  compressed_map.maxLength = jpeg_encoder_gainmap.getCompressedImageSize();
-  compressed_map.length = compressed_map.maxLength;
-  compressed_map.data = jpeg_encoder_gainmap.getCompressedImagePtr();
-  compressed_map.colorGamut = ULTRAHDR_COLORGAMUT_UNSPECIFIED;
+  // The gain map and the primary image are independent, so compress the gain map concurrently
+  // with preparing and compressing the primary image.
+  std::unique_ptr<JpegEncoder> jpeg_encoder_gainmap;
+  std::future<status_t> compress_gain_map_result =
+      std::async(std::launch::async, [this, &map, &jpeg_encoder_gainmap] {
+        return compressGainMap(&map, &jpeg_encoder_gainmap);
+      });
 
   sp<DataStruct> icc = IccHelper::writeIccProfile(ULTRAHDR_TF_SRGB,
                                                   uncompressed_yuv_420_image.colorGamut);
@@ -262,16 +295,19 @@ status_t JpegR::encodeJPEGR(jr_uncompressed_ptr uncompressed_p010_image,
   JPEGR_CHECK(convertYuv(&uncompressed_yuv_420_image, uncompressed_yuv_420_image.colorGamut,
                          ULTRAHDR_COLORGAMUT_P3));
 
-  JpegEncoderHelper jpeg_encoder;
-  if (!jpeg_encoder.compressImage(uncompressed_yuv_420_image.data,
-                                  uncompressed_yuv_420_image.width,
-                                  uncompressed_yuv_420_image.height, quality,
-                                  icc->getData(), icc->getLength())) {
-    return ERROR_JPEGR_ENCODE_ERROR;
-  }
+  std::unique_ptr<JpegEncoder> jpeg_encoder;
+  JPEGR_CHECK(compressPrimaryImage(&uncompressed_yuv_420_image, quality, icc->getData(),
+                                   icc->getLength(), &jpeg_encoder));
   jpegr_compressed_struct jpeg;
-  jpeg.data = jpeg_encoder.getCompressedImagePtr();
-  jpeg.length = jpeg_encoder.getCompressedImageSize();
+  jpeg.data = jpeg_encoder->getCompressedImagePtr();
+  jpeg.length = jpeg_encoder->getCompressedImageSize();
+
+  JPEGR_CHECK(compress_gain_map_result.get());
+  jpegr_compressed_struct compressed_map;
+  compressed_map.maxLength = jpeg_encoder_gainmap->getCompressedImageSize();
+  compressed_map.length = compressed_map.maxLength;
+  compressed_map.data = jpeg_encoder_gainmap->getCompressedImagePtr();
+  compressed_map.colorGamut = ULTRAHDR_COLORGAMUT_UNSPECIFIED;
 
   // No ICC since JPEG encode already did it
   JPEGR_CHECK(appendGainMap(&jpeg, &compressed_map, exif, /* icc */ nullptr, /* icc size */ 0,
@@ -312,13 +348,13 @@ status_t JpegR::encodeJPEGR(jr_uncompressed_ptr uncompressed_p010_image,
   std::unique_ptr<uint8_t[]> map_data;
   map_data.reset(reinterpret_cast<uint8_t*>(map.data));
 
-  JpegEncoderHelper jpeg_encoder_gainmap;
-  JPEGR_CHECK(compressGainMap(&map, &jpeg_encoder_gainmap));
-  jpegr_compressed_struct compressed_map;
-  compressed_map.maxLength = jpeg_encoder_gainmap.getCompressedImageSize();
-  compressed_map.length = compressed_map.maxLength;
-  compressed_map.data = jpeg_encoder_gainmap.getCompressedImagePtr();
-  compressed_map.colorGamut = ULTRAHDR_COLORGAMUT_UNSPECIFIED;
+  // The gain map and the primary image are independent, so compress the gain map concurrently
+  // with preparing and compressing the primary image.
+  std::unique_ptr<JpegEncoder> jpeg_encoder_gainmap;
+  std::future<status_t> compress_gain_map_result =
+      std::async(std::launch::async, [this, &map, &jpeg_encoder_gainmap] {
+        return compressGainMap(&map, &jpeg_encoder_gainmap);
+      });
 
   sp<DataStruct> icc = IccHelper::writeIccProfile(ULTRAHDR_TF_SRGB,
                                                   uncompressed_yuv_420_image->colorGamut);
@@ -335,16 +371,19 @@ status_t JpegR::encodeJPEGR(jr_uncompressed_ptr uncompressed_p010_image,
   JPEGR_CHECK(convertYuv(&yuv_420_bt601_image, yuv_420_bt601_image.colorGamut,
                          ULTRAHDR_COLORGAMUT_P3));
 
-  JpegEncoderHelper jpeg_encoder;
-  if (!jpeg_encoder.compressImage(yuv_420_bt601_image.data,
-                                  yuv_420_bt601_image.width,
-                                  yuv_420_bt601_image.height, quality,
-                                  icc->getData(), icc->getLength())) {
-    return ERROR_JPEGR_ENCODE_ERROR;
-  }
+  std::unique_ptr<JpegEncoder> jpeg_encoder;
+  JPEGR_CHECK(compressPrimaryImage(&yuv_420_bt601_image, quality, icc->getData(),
+                                   icc->getLength(), &jpeg_encoder));
   jpegr_compressed_struct jpeg;
-  jpeg.data = jpeg_encoder.getCompressedImagePtr();
-  jpeg.length = jpeg_encoder.getCompressedImageSize();
+  jpeg.data = jpeg_encoder->getCompressedImagePtr();
+  jpeg.length = jpeg_encoder->getCompressedImageSize();
+
+  JPEGR_CHECK(compress_gain_map_result.get());
+  jpegr_compressed_struct compressed_map;
+  compressed_map.maxLength = jpeg_encoder_gainmap->getCompressedImageSize();
+  compressed_map.length = compressed_map.maxLength;
+  compressed_map.data = jpeg_encoder_gainmap->getCompressedImagePtr();
+  compressed_map.colorGamut = ULTRAHDR_COLORGAMUT_UNSPECIFIED;
 
   // No ICC since jpeg encode already did it
   JPEGR_CHECK(appendGainMap(&jpeg, &compressed_map, exif, /* icc */ nullptr, /* icc size */ 0,
@@ -383,12 +422,12 @@ status_t JpegR::encodeJPEGR(jr_uncompressed_ptr uncompressed_p010_image,
   std::unique_ptr<uint8_t[]> map_data;
   map_data.reset(reinterpret_cast<uint8_t*>(map.data));
 
-  JpegEncoderHelper jpeg_encoder_gainmap;
+  std::unique_ptr<JpegEncoder> jpeg_encoder_gainmap;
   JPEGR_CHECK(compressGainMap(&map, &jpeg_encoder_gainmap));
   jpegr_compressed_struct compressed_map;
-  compressed_map.maxLength = jpeg_encoder_gainmap.getCompressedImageSize();
+  compressed_map.maxLength = jpeg_encoder_gainmap->getCompressedImageSize();
   compressed_map.length = compressed_map.maxLength;
-  compressed_map.data = jpeg_encoder_gainmap.getCompressedImagePtr();
+  compressed_map.data = jpeg_encoder_gainmap->getCompressedImagePtr();
   compressed_map.colorGamut = ULTRAHDR_COLORGAMUT_UNSPECIFIED;
 
   // We just want to check if ICC is present, so don't do a full decode. Note,
@@ -456,12 +495,12 @@ status_t JpegR::encodeJPEGR(jr_uncompressed_ptr uncompressed_p010_image,
   std::unique_ptr<uint8_t[]> map_data;
   map_data.reset(reinterpret_cast<uint8_t*>(map.data));
 
-  JpegEncoderHelper jpeg_encoder_gainmap;
+  std::unique_ptr<JpegEncoder> jpeg_encoder_gainmap;
   JPEGR_CHECK(compressGainMap(&map, &jpeg_encoder_gainmap));
   jpegr_compressed_struct compressed_map;
-  compressed_map.maxLength = jpeg_encoder_gainmap.getCompressedImageSize();
+  compressed_map.maxLength = jpeg_encoder_gainmap->getCompressedImageSize();
   compressed_map.length = compressed_map.maxLength;
-  compressed_map.data = jpeg_encoder_gainmap.getCompressedImagePtr();
+  compressed_map.data = jpeg_encoder_gainmap->getCompressedImagePtr();
   compressed_map.colorGamut = ULTRAHDR_COLORGAMUT_UNSPECIFIED;
 
   // We just want to check if ICC is present, so don't do a full decode. Note,
@@ -556,6 +595,129 @@ status_t JpegR::getJPEGRInfo(jr_compressed_ptr compressed_jpegr_image, jr_info_p
   return status;
 }
 
+// Calls visitor with the marker and the payload of every marker segment in the headers of the
+// JPEG image at data, until the visitor returns false or the first scan starts. The entropy-coded
+// data is never read. Returns false if the headers are malformed.
+template <typename Visitor>
+static bool walkJpegHeaders(const uint8_t* data, size_t length, const Visitor& visitor) {
+  constexpr uint8_t kSOS = 0xda;
+  constexpr uint8_t kEOI = 0xd9;
+  constexpr uint8_t kTEM = 0x01;
+  constexpr uint8_t kRST0 = 0xd0;
+  constexpr uint8_t kRST7 = 0xd7;
+
+  if (length < 2 || data[0] != JpegMarker::kStart || data[1] != JpegMarker::kSOI) {
+    return false;
+  }
+  size_t pos = 2;
+  while (true) {
+    if (pos + 2 > length || data[pos] != JpegMarker::kStart) {
+      return false;
+    }
+    const uint8_t marker = data[pos + 1];
+    if (marker == JpegMarker::kStart) {
+      // Fill byte.
+      pos++;
+      continue;
+    }
+    if (marker == kSOS || marker == kEOI) {
+      return true;
+    }
+    if (marker == kTEM || (marker >= kRST0 && marker <= kRST7)) {
+      // Markers without segment.
+      pos += 2;
+      continue;
+    }
+    if (pos + 4 > length) {
+      return false;
+    }
+    const size_t segment_length = (data[pos + 2] << 8) | data[pos + 3];
+    if (segment_length < 2 || segment_length > length - pos - 2) {
+      return false;
+    }
+    if (!visitor(marker, data + pos + 4, segment_length - 2)) {
+      return true;
+    }
+    pos += 2 + segment_length;
+  }
+}
+
+status_t JpegR::probeJPEGR(jr_compressed_ptr compressed_jpegr_image, jr_probe_ptr jpegr_probe) {
+  if (compressed_jpegr_image == nullptr || compressed_jpegr_image->data == nullptr) {
+    ALOGE("received nullptr for compressed jpegr image");
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+
+  if (jpegr_probe == nullptr) {
+    ALOGE("received nullptr for compressed jpegr probe struct");
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+
+  if (compressed_jpegr_image->length <= 0) {
+    ALOGE("received bad compressed jpegr image length %d", compressed_jpegr_image->length);
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+
+  const uint8_t* data = static_cast<const uint8_t*>(compressed_jpegr_image->data);
+  const size_t length = compressed_jpegr_image->length;
+  const string xmp_name_space = "http://ns.adobe.com/xap/1.0/";
+
+  // The primary image has the frame header and the MPF package that locates the gain map.
+  bool found_frame = false;
+  bool found_gain_map = false;
+  const auto visitPrimaryImage = [&](uint8_t marker, const uint8_t* payload, size_t size) {
+    if (marker == JpegMarker::kAPP2 && !found_gain_map) {
+      size_t offset, gain_map_length;
+      if (findSecondaryImageInMpf(payload, size, &offset, &gain_map_length)) {
+        offset += payload - data + sizeof(kMpfSig);
+        if (offset < length && gain_map_length <= length - offset) {
+          jpegr_probe->gainMapOffset = offset;
+          jpegr_probe->gainMapLength = gain_map_length;
+          found_gain_map = true;
+        }
+      }
+    } else if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 &&
+               marker != 0xcc) {
+      // Start of frame; 0xc4, 0xc8 and 0xcc are DHT, JPG and DAC.
+      if (size < 5) {
+        return false;
+      }
+      jpegr_probe->height = (payload[1] << 8) | payload[2];
+      jpegr_probe->width = (payload[3] << 8) | payload[4];
+      found_frame = true;
+    }
+    return true;
+  };
+  if (!walkJpegHeaders(data, length, visitPrimaryImage) || !found_frame) {
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+  if (!found_gain_map) {
+    return ERROR_JPEGR_GAIN_MAP_IMAGE_NOT_FOUND;
+  }
+
+  // The gain map has the XMP package with the metadata.
+  bool found_metadata = false;
+  bool valid_metadata = false;
+  const auto visitGainMap = [&](uint8_t marker, const uint8_t* payload, size_t size) {
+    if (marker == JpegMarker::kAPP1 && size > xmp_name_space.size() &&
+        !memcmp(payload, xmp_name_space.c_str(), xmp_name_space.size() + 1)) {
+      found_metadata = true;
+      valid_metadata = getMetadataFromXMP(const_cast<uint8_t*>(payload), size,
+                                          &jpegr_probe->metadata);
+    }
+    return !found_metadata;
+  };
+  if (!walkJpegHeaders(data + jpegr_probe->gainMapOffset, jpegr_probe->gainMapLength,
+                       visitGainMap)) {
+    return ERROR_JPEGR_GAIN_MAP_IMAGE_NOT_FOUND;
+  }
+  if (!valid_metadata) {
+    return ERROR_JPEGR_INVALID_METADATA;
+  }
+
+  return NO_ERROR;
+}
+
 /* Decode API */
 status_t JpegR::decodeJPEGR(jr_compressed_ptr compressed_jpegr_image,
                             jr_uncompressed_ptr dest,
@@ -689,20 +851,64 @@ status_t JpegR::decodeJPEGR(jr_compressed_ptr compressed_jpegr_image,
   return NO_ERROR;
 }
 
+std::unique_ptr<JpegEncoder> JpegR::compressImage(const void* image, int width, int height,
+                                                  int quality, const void* icc, size_t icc_size,
+                                                  bool is_gain_map) {
+  if (mEncoderFactory) {
+    std::unique_ptr<JpegEncoder> encoder = mEncoderFactory(is_gain_map);
+    if (encoder != nullptr
+     && encoder->compressImage(image, width, height, quality, icc, icc_size,
+                               is_gain_map /* isSingleChannel */)) {
+      return encoder;
+    }
+    ALOGW("Encoder from factory failed to compress %s, using the software encoder",
+          is_gain_map ? "gain map" : "primary image");
+  }
+
+  std::unique_ptr<JpegEncoder> encoder = std::make_unique<JpegEncoderHelper>();
+  if (!encoder->compressImage(image, width, height, quality, icc, icc_size,
+                              is_gain_map /* isSingleChannel */)) {
+    return nullptr;
+  }
+  return encoder;
+}
+
 status_t JpegR::compressGainMap(jr_uncompressed_ptr uncompressed_gain_map,
-                                JpegEncoderHelper* jpeg_encoder) {
+                                std::unique_ptr<JpegEncoder>* jpeg_encoder) {
   if (uncompressed_gain_map == nullptr || jpeg_encoder == nullptr) {
     return ERROR_JPEGR_INVALID_NULL_PTR;
   }
 
   // Don't need to convert YUV to Bt601 since single channel
-  if (!jpeg_encoder->compressImage(uncompressed_gain_map->data,
-                                   uncompressed_gain_map->width,
-                                   uncompressed_gain_map->height,
-                                   kMapCompressQuality,
-                                   nullptr,
-                                   0,
-                                   true /* isSingleChannel */)) {
+  *jpeg_encoder = compressImage(uncompressed_gain_map->data,
+                                uncompressed_gain_map->width,
+                                uncompressed_gain_map->height,
+                                kMapCompressQuality,
+                                nullptr,
+                                0,
+                                true /* is_gain_map */);
+  if (*jpeg_encoder == nullptr) {
+    return ERROR_JPEGR_ENCODE_ERROR;
+  }
+
+  return NO_ERROR;
+}
+
+status_t JpegR::compressPrimaryImage(jr_uncompressed_ptr uncompressed_yuv_420_image, int quality,
+                                     const void* icc, size_t icc_size,
+                                     std::unique_ptr<JpegEncoder>* jpeg_encoder) {
+  if (uncompressed_yuv_420_image == nullptr || jpeg_encoder == nullptr) {
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+
+  *jpeg_encoder = compressImage(uncompressed_yuv_420_image->data,
+                                uncompressed_yuv_420_image->width,
+                                uncompressed_yuv_420_image->height,
+                                quality,
+                                icc,
+                                icc_size,
+                                false /* is_gain_map */);
+  if (*jpeg_encoder == nullptr) {
     return ERROR_JPEGR_ENCODE_ERROR;
   }
 
@@ -886,7 +1092,7 @@ status_t JpegR::generateGainMap(jr_uncompressed_ptr uncompressed_yuv_420_image,
   }
 
   std::mutex mutex;
-  const int threads = std::clamp(GetCPUCoreCount(), 1, 4);
+  const int threads = GetWorkerThreadCount();
   size_t rowStep = threads == 1 ? image_height : kJobSzInRows;
   JobQueue jobQueue;
 
@@ -945,19 +1151,8 @@ status_t JpegR::generateGainMap(jr_uncompressed_ptr uncompressed_yuv_420_image,
   return NO_ERROR;
 }
 
-status_t JpegR::applyGainMap(jr_uncompressed_ptr uncompressed_yuv_420_image,
-                             jr_uncompressed_ptr uncompressed_gain_map,
-                             ultrahdr_metadata_ptr metadata,
-                             ultrahdr_output_format output_format,
-                             float max_display_boost,
-                             jr_uncompressed_ptr dest) {
-  if (uncompressed_yuv_420_image == nullptr
-   || uncompressed_gain_map == nullptr
-   || metadata == nullptr
-   || dest == nullptr) {
-    return ERROR_JPEGR_INVALID_NULL_PTR;
-  }
-
+// Checks that the gain map metadata only uses features that applying gain maps supports.
+static status_t checkGainMapMetadata(ultrahdr_metadata_ptr metadata) {
   if (metadata->version.compare("1.0")) {
       ALOGE("Unsupported metadata version: %s", metadata->version.c_str());
       return ERROR_JPEGR_UNSUPPORTED_METADATA;
@@ -977,108 +1172,166 @@ status_t JpegR::applyGainMap(jr_uncompressed_ptr uncompressed_yuv_420_image,
             metadata->hdrCapacityMax);
       return ERROR_JPEGR_UNSUPPORTED_METADATA;
   }
+  return NO_ERROR;
+}
 
+// Checks that the gain map has the dimensions generateGainMap() gives it for an image of the
+// given dimensions.
+static status_t checkGainMapDimensions(size_t image_width, size_t image_height,
+                                       jr_uncompressed_ptr gain_map) {
   // TODO: remove once map scaling factor is computed based on actual map dims
-  size_t image_width = uncompressed_yuv_420_image->width;
-  size_t image_height = uncompressed_yuv_420_image->height;
   size_t map_width = image_width / kMapDimensionScaleFactor;
   size_t map_height = image_height / kMapDimensionScaleFactor;
   map_width = static_cast<size_t>(
           floor((map_width + kJpegBlock - 1) / kJpegBlock)) * kJpegBlock;
   map_height = ((map_height + 1) >> 1) << 1;
-  if (map_width != uncompressed_gain_map->width
-   || map_height != uncompressed_gain_map->height) {
+  if (map_width != gain_map->width
+   || map_height != gain_map->height) {
     ALOGE("gain map dimensions and primary image dimensions are not to scale");
     return ERROR_JPEGR_INVALID_INPUT_TYPE;
   }
+  return NO_ERROR;
+}
 
-  dest->width = uncompressed_yuv_420_image->width;
-  dest->height = uncompressed_yuv_420_image->height;
-  ShepardsIDW idwTable(kMapDimensionScaleFactor);
-  float display_boost = std::min(max_display_boost, metadata->maxContentBoost);
-  GainLUT gainLUT(metadata, display_boost);
+// Applies a gain map to rows of an SDR image, shared by applyGainMap() and decodeJPEGRStrips().
+class GainMapApplier {
+ public:
+  GainMapApplier(jr_uncompressed_ptr gain_map, ultrahdr_metadata_ptr metadata,
+                 ultrahdr_output_format output_format, float max_display_boost)
+        : mGainMap(gain_map),
+          mMetadata(metadata),
+          mOutputFormat(output_format),
+          mDisplayBoost(std::min(max_display_boost, metadata->maxContentBoost)),
+          mIdwTable(kMapDimensionScaleFactor),
+          mGainLUT(metadata, mDisplayBoost) {}
+
+  // Computes columns [left, right) of the image rows [rowStart, rowEnd). yuv holds the image
+  // rows starting at yuvRow, and dest the output rows starting at destRow with pixel left of the
+  // image as its first column. rowBuffer is scratch space for a single row.
+  void applyToRows(jr_uncompressed_ptr yuv, size_t yuvRow, size_t left, size_t right,
+                   size_t rowStart, size_t rowEnd, jr_uncompressed_ptr dest, size_t destRow,
+                   std::vector<Color>& rowBuffer);
 
-  JobQueue jobQueue;
-  std::function<void()> applyRecMap = [uncompressed_yuv_420_image, uncompressed_gain_map,
-                                       metadata, dest, &jobQueue, &idwTable, output_format,
-                                       &gainLUT, display_boost]() -> void {
-    size_t width = uncompressed_yuv_420_image->width;
-    size_t height = uncompressed_yuv_420_image->height;
+ private:
+  jr_uncompressed_ptr mGainMap;
+  ultrahdr_metadata_ptr mMetadata;
+  ultrahdr_output_format mOutputFormat;
+  float mDisplayBoost;
+  ShepardsIDW mIdwTable;
+  GainLUT mGainLUT;
+};
 
-    size_t rowStart, rowEnd;
-    while (jobQueue.dequeueJob(rowStart, rowEnd)) {
-      for (size_t y = rowStart; y < rowEnd; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-          Color yuv_gamma_sdr = getYuv420Pixel(uncompressed_yuv_420_image, x, y);
-          // Assuming the sdr image is a decoded JPEG, we should always use Rec.601 YUV coefficients
-          Color rgb_gamma_sdr = p3YuvToRgb(yuv_gamma_sdr);
-          // We are assuming the SDR base image is always sRGB transfer.
+void GainMapApplier::applyToRows(jr_uncompressed_ptr yuv, size_t yuvRow, size_t left,
+                                 size_t right, size_t rowStart, size_t rowEnd,
+                                 jr_uncompressed_ptr dest, size_t destRow,
+                                 std::vector<Color>& rowBuffer) {
+  rowBuffer.resize(yuv->width);
+  const size_t dest_width = dest->width;
+  for (size_t y = rowStart; y < rowEnd; ++y) {
+    // Assuming the sdr image is a decoded JPEG, we should always use Rec.601 YUV coefficients
+    getYuv420RowAsRgb601(yuv, y - yuvRow, rowBuffer.data());
+    for (size_t x = left; x < right; ++x) {
+      Color rgb_gamma_sdr = rowBuffer[x];
+      // We are assuming the SDR base image is always sRGB transfer.
 #if USE_SRGB_INVOETF_LUT
-          Color rgb_sdr = srgbInvOetfLUT(rgb_gamma_sdr);
+      Color rgb_sdr = srgbInvOetfLUT(rgb_gamma_sdr);
 #else
-          Color rgb_sdr = srgbInvOetf(rgb_gamma_sdr);
+      Color rgb_sdr = srgbInvOetf(rgb_gamma_sdr);
 #endif
-          float gain;
-          // TODO: determine map scaling factor based on actual map dims
-          size_t map_scale_factor = kMapDimensionScaleFactor;
-          // TODO: If map_scale_factor is guaranteed to be an integer, then remove the following.
-          // Currently map_scale_factor is of type size_t, but it could be changed to a float
-          // later.
-          if (map_scale_factor != floorf(map_scale_factor)) {
-            gain = sampleMap(uncompressed_gain_map, map_scale_factor, x, y);
-          } else {
-            gain = sampleMap(uncompressed_gain_map, map_scale_factor, x, y, idwTable);
-          }
+      float gain;
+      // TODO: determine map scaling factor based on actual map dims
+      size_t map_scale_factor = kMapDimensionScaleFactor;
+      // TODO: If map_scale_factor is guaranteed to be an integer, then remove the following.
+      // Currently map_scale_factor is of type size_t, but it could be changed to a float
+      // later.
+      if (map_scale_factor != floorf(map_scale_factor)) {
+        gain = sampleMap(mGainMap, map_scale_factor, x, y);
+      } else {
+        gain = sampleMap(mGainMap, map_scale_factor, x, y, mIdwTable);
+      }
 
 #if USE_APPLY_GAIN_LUT
-          Color rgb_hdr = applyGainLUT(rgb_sdr, gain, gainLUT);
+      Color rgb_hdr = applyGainLUT(rgb_sdr, gain, mGainLUT);
 #else
-          Color rgb_hdr = applyGain(rgb_sdr, gain, metadata, display_boost);
+      Color rgb_hdr = applyGain(rgb_sdr, gain, mMetadata, mDisplayBoost);
 #endif
-          rgb_hdr = rgb_hdr / display_boost;
-          size_t pixel_idx = x + y * width;
-
-          switch (output_format) {
-            case ULTRAHDR_OUTPUT_HDR_LINEAR:
-            {
-              uint64_t rgba_f16 = colorToRgbaF16(rgb_hdr);
-              reinterpret_cast<uint64_t*>(dest->data)[pixel_idx] = rgba_f16;
-              break;
-            }
-            case ULTRAHDR_OUTPUT_HDR_HLG:
-            {
+      rgb_hdr = rgb_hdr / mDisplayBoost;
+      size_t pixel_idx = (x - left) + (y - destRow) * dest_width;
+
+      switch (mOutputFormat) {
+        case ULTRAHDR_OUTPUT_HDR_LINEAR:
+        {
+          uint64_t rgba_f16 = colorToRgbaF16(rgb_hdr);
+          reinterpret_cast<uint64_t*>(dest->data)[pixel_idx] = rgba_f16;
+          break;
+        }
+        case ULTRAHDR_OUTPUT_HDR_HLG:
+        {
 #if USE_HLG_OETF_LUT
-              ColorTransformFn hdrOetf = hlgOetfLUT;
+          ColorTransformFn hdrOetf = hlgOetfLUT;
 #else
-              ColorTransformFn hdrOetf = hlgOetf;
+          ColorTransformFn hdrOetf = hlgOetf;
 #endif
-              Color rgb_gamma_hdr = hdrOetf(rgb_hdr);
-              uint32_t rgba_1010102 = colorToRgba1010102(rgb_gamma_hdr);
-              reinterpret_cast<uint32_t*>(dest->data)[pixel_idx] = rgba_1010102;
-              break;
-            }
-            case ULTRAHDR_OUTPUT_HDR_PQ:
-            {
+          Color rgb_gamma_hdr = hdrOetf(rgb_hdr);
+          uint32_t rgba_1010102 = colorToRgba1010102(rgb_gamma_hdr);
+          reinterpret_cast<uint32_t*>(dest->data)[pixel_idx] = rgba_1010102;
+          break;
+        }
+        case ULTRAHDR_OUTPUT_HDR_PQ:
+        {
 #if USE_HLG_OETF_LUT
-              ColorTransformFn hdrOetf = pqOetfLUT;
+          ColorTransformFn hdrOetf = pqOetfLUT;
 #else
-              ColorTransformFn hdrOetf = pqOetf;
+          ColorTransformFn hdrOetf = pqOetf;
 #endif
-              Color rgb_gamma_hdr = hdrOetf(rgb_hdr);
-              uint32_t rgba_1010102 = colorToRgba1010102(rgb_gamma_hdr);
-              reinterpret_cast<uint32_t*>(dest->data)[pixel_idx] = rgba_1010102;
-              break;
-            }
-            default:
-            {}
-              // Should be impossible to hit after input validation.
-          }
+          Color rgb_gamma_hdr = hdrOetf(rgb_hdr);
+          uint32_t rgba_1010102 = colorToRgba1010102(rgb_gamma_hdr);
+          reinterpret_cast<uint32_t*>(dest->data)[pixel_idx] = rgba_1010102;
+          break;
         }
+        default:
+        {}
+          // Should be impossible to hit after input validation.
       }
     }
+  }
+}
+
+status_t JpegR::applyGainMap(jr_uncompressed_ptr uncompressed_yuv_420_image,
+                             jr_uncompressed_ptr uncompressed_gain_map,
+                             ultrahdr_metadata_ptr metadata,
+                             ultrahdr_output_format output_format,
+                             float max_display_boost,
+                             jr_uncompressed_ptr dest) {
+  if (uncompressed_yuv_420_image == nullptr
+   || uncompressed_gain_map == nullptr
+   || metadata == nullptr
+   || dest == nullptr) {
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+
+  JPEGR_CHECK(checkGainMapMetadata(metadata));
+  JPEGR_CHECK(checkGainMapDimensions(uncompressed_yuv_420_image->width,
+                                     uncompressed_yuv_420_image->height, uncompressed_gain_map));
+
+  dest->width = uncompressed_yuv_420_image->width;
+  dest->height = uncompressed_yuv_420_image->height;
+  GainMapApplier applier(uncompressed_gain_map, metadata, output_format, max_display_boost);
+
+  JobQueue jobQueue;
+  std::function<void()> applyRecMap = [uncompressed_yuv_420_image, dest, &jobQueue,
+                                       &applier]() -> void {
+    size_t width = uncompressed_yuv_420_image->width;
+
+    size_t rowStart, rowEnd;
+    std::vector<Color> rgb_gamma_sdr_row;
+    while (jobQueue.dequeueJob(rowStart, rowEnd)) {
+      applier.applyToRows(uncompressed_yuv_420_image, 0, 0, width, rowStart, rowEnd, dest, 0,
+                          rgb_gamma_sdr_row);
+    }
   };
 
-  const int threads = std::clamp(GetCPUCoreCount(), 1, 4);
+  const int threads = GetWorkerThreadCount();
   std::vector<std::thread> workers;
   for (int th = 0; th < threads - 1; th++) {
     workers.push_back(std::thread(applyRecMap));
@@ -1095,6 +1348,104 @@ status_t JpegR::applyGainMap(jr_uncompressed_ptr uncompressed_yuv_420_image,
   return NO_ERROR;
 }
 
+status_t JpegR::decodeJPEGRStrips(jr_compressed_ptr compressed_jpegr_image,
+                                  const jr_strip_callback& callback,
+                                  float max_display_boost,
+                                  ultrahdr_output_format output_format,
+                                  jr_region_ptr region) {
+  if (compressed_jpegr_image == nullptr || compressed_jpegr_image->data == nullptr) {
+    ALOGE("received nullptr for compressed jpegr image");
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+
+  if (max_display_boost < 1.0f) {
+    ALOGE("received bad value for max_display_boost %f", max_display_boost);
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+
+  if (output_format <= ULTRAHDR_OUTPUT_SDR || output_format > ULTRAHDR_OUTPUT_MAX) {
+    ALOGE("received bad value for output format %d", output_format);
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+
+  jpegr_compressed_struct primary_image, gainmap_image;
+  JPEGR_CHECK(extractPrimaryImageAndGainMap(compressed_jpegr_image, &primary_image,
+                                            &gainmap_image));
+
+  JpegDecoderHelper jpeg_decoder;
+  size_t image_width, image_height;
+  if (!jpeg_decoder.getCompressedImageParameters(primary_image.data, primary_image.length,
+                                                 &image_width, &image_height, nullptr, nullptr)) {
+    return ERROR_JPEGR_DECODE_ERROR;
+  }
+
+  jpegr_region_struct full_image = { 0, 0, static_cast<int>(image_width),
+                                     static_cast<int>(image_height) };
+  if (region == nullptr) {
+    region = &full_image;
+  } else if (region->left < 0 || region->top < 0 || region->left >= region->right
+          || region->top >= region->bottom || region->right > static_cast<int>(image_width)
+          || region->bottom > static_cast<int>(image_height)) {
+    ALOGE("received bad region %d, %d, %d, %d for image of %zu x %zu", region->left, region->top,
+          region->right, region->bottom, image_width, image_height);
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+
+  // The gain map is a sixteenth of the image, so it is decoded up front.
+  JpegDecoderHelper gain_map_decoder;
+  if (!gain_map_decoder.decompressImage(gainmap_image.data, gainmap_image.length)) {
+    return ERROR_JPEGR_DECODE_ERROR;
+  }
+  if ((gain_map_decoder.getDecompressedImageWidth() *
+       gain_map_decoder.getDecompressedImageHeight()) >
+      gain_map_decoder.getDecompressedImageSize()) {
+    return ERROR_JPEGR_CALCULATION_ERROR;
+  }
+
+  jpegr_uncompressed_struct map;
+  map.data = gain_map_decoder.getDecompressedImagePtr();
+  map.width = gain_map_decoder.getDecompressedImageWidth();
+  map.height = gain_map_decoder.getDecompressedImageHeight();
+
+  ultrahdr_metadata_struct uhdr_metadata;
+  if (!getMetadataFromXMP(static_cast<uint8_t*>(gain_map_decoder.getXMPPtr()),
+                          gain_map_decoder.getXMPSize(), &uhdr_metadata)) {
+    return ERROR_JPEGR_INVALID_METADATA;
+  }
+  JPEGR_CHECK(checkGainMapMetadata(&uhdr_metadata));
+  JPEGR_CHECK(checkGainMapDimensions(image_width, image_height, &map));
+
+  GainMapApplier applier(&map, &uhdr_metadata, output_format, max_display_boost);
+  const size_t bytes_per_pixel = output_format == ULTRAHDR_OUTPUT_HDR_LINEAR ? 8 : 4;
+  std::vector<uint8_t> strip_data;
+  std::vector<Color> row_buffer;
+  const auto decodeStrip = [&](const uint8_t* rows, size_t row_start, size_t row_count) {
+    const int top = std::max(static_cast<int>(row_start), region->top);
+    const int bottom = std::min(static_cast<int>(row_start + row_count), region->bottom);
+    if (top < bottom) {
+      jpegr_uncompressed_struct yuv = { const_cast<uint8_t*>(rows),
+                                        static_cast<int>(image_width),
+                                        static_cast<int>(row_count),
+                                        ULTRAHDR_COLORGAMUT_UNSPECIFIED };
+      jpegr_uncompressed_struct strip = { nullptr, region->right - region->left, bottom - top,
+                                          ULTRAHDR_COLORGAMUT_UNSPECIFIED };
+      strip_data.resize(strip.width * strip.height * bytes_per_pixel);
+      strip.data = strip_data.data();
+      applier.applyToRows(&yuv, row_start, region->left, region->right, top, bottom, &strip,
+                          top, row_buffer);
+      if (!callback(&strip, top)) {
+        return false;
+      }
+    }
+    return bottom < region->bottom;
+  };
+  if (!jpeg_decoder.decompressImageRows(primary_image.data, primary_image.length,
+                                        decodeStrip)) {
+    return ERROR_JPEGR_DECODE_ERROR;
+  }
+  return NO_ERROR;
+}
+
 status_t JpegR::extractPrimaryImageAndGainMap(jr_compressed_ptr compressed_jpegr_image,
                                               jr_compressed_ptr primary_image,
                                               jr_compressed_ptr gain_map) {
@@ -16,6 +16,8 @@
 #include <ultrahdr/multipictureformat.h>
 #include <ultrahdr/jpegrutils.h>
 
+#include <cstring>
+
 namespace android::ultrahdr {
 size_t calculateMpfSize() {
     return sizeof(kMpfSig) +                 // Signature
@@ -91,4 +93,65 @@ sp<DataStruct> generateMpf(int primary_image_size, int primary_image_offset,
     return dataStruct;
 }
 
+bool findSecondaryImageInMpf(const uint8_t* mpf_data, size_t mpf_size,
+                             size_t* secondary_image_offset, size_t* secondary_image_size) {
+    if (mpf_size < sizeof(kMpfSig) + kMpEndianSize ||
+        memcmp(mpf_data, kMpfSig, sizeof(kMpfSig)) != 0) {
+        return false;
+    }
+
+    // All offsets in the package are relative to the endianness field.
+    const uint8_t* header = mpf_data + sizeof(kMpfSig);
+    const size_t header_size = mpf_size - sizeof(kMpfSig);
+    bool big_endian;
+    if (memcmp(header, kMpBigEndian, kMpEndianSize) == 0) {
+        big_endian = true;
+    } else if (memcmp(header, kMpLittleEndian, kMpEndianSize) == 0) {
+        big_endian = false;
+    } else {
+        return false;
+    }
+    const auto read16 = [&](size_t pos) -> uint16_t {
+        return big_endian ? (header[pos] << 8) | header[pos + 1]
+                          : header[pos] | (header[pos + 1] << 8);
+    };
+    const auto read32 = [&](size_t pos) -> uint32_t {
+        return big_endian ? (static_cast<uint32_t>(read16(pos)) << 16) | read16(pos + 2)
+                          : read16(pos) | (static_cast<uint32_t>(read16(pos + 2)) << 16);
+    };
+
+    if (header_size < kMpEndianSize + sizeof(uint32_t)) {
+        return false;
+    }
+    const size_t index_ifd_offset = read32(kMpEndianSize);
+    if (index_ifd_offset > header_size - sizeof(uint16_t)) {
+        return false;
+    }
+    const size_t tag_count = read16(index_ifd_offset);
+    const size_t tags_offset = index_ifd_offset + sizeof(uint16_t);
+    if (tag_count > (header_size - tags_offset) / kTagSize) {
+        return false;
+    }
+
+    for (size_t i = 0; i < tag_count; i++) {
+        const size_t tag_offset = tags_offset + i * kTagSize;
+        if (read16(tag_offset) != kMPEntryTag) {
+            continue;
+        }
+        // The count of the MP entry tag is the size of all entries, and its value their offset.
+        const size_t entries_size = read32(tag_offset + 4);
+        const size_t entries_offset = read32(tag_offset + 8);
+        if (entries_size < kNumPictures * kMPEntrySize || entries_offset > header_size ||
+            kNumPictures * kMPEntrySize > header_size - entries_offset) {
+            return false;
+        }
+        // Each entry holds the attribute, the size and the offset of the image.
+        const size_t entry_offset = entries_offset + kMPEntrySize;
+        *secondary_image_size = read32(entry_offset + 4);
+        *secondary_image_offset = read32(entry_offset + 8);
+        return *secondary_image_size != 0 && *secondary_image_offset != 0;
+    }
+    return false;
+}
+
 } // namespace android::ultrahdr
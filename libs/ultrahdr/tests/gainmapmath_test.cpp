@@ -15,6 +15,7 @@
  */
 
 #include <cmath>
+#include <vector>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include <ultrahdr/gainmapmath.h>
@@ -1053,6 +1054,24 @@ TEST_F(GainMapMathTest, GetYuv420Pixel) {
   }
 }
 
+TEST_F(GainMapMathTest, GetYuv420RowAsRgb601) {
+  // Wide enough to cover both the vectorized conversion and the remaining pixels of each row.
+  const size_t kWidth = 36, kHeight = 4;
+  std::vector<uint8_t> pixels(kWidth * kHeight * 3 / 2);
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = static_cast<uint8_t>(i * 37 + 11);
+  }
+  jpegr_uncompressed_struct image = { pixels.data(), kWidth, kHeight, ULTRAHDR_COLORGAMUT_P3 };
+
+  std::vector<Color> row(kWidth);
+  for (size_t y = 0; y < kHeight; ++y) {
+    getYuv420RowAsRgb601(&image, y, row.data());
+    for (size_t x = 0; x < kWidth; ++x) {
+      EXPECT_RGB_NEAR(row[x], p3YuvToRgb(getYuv420Pixel(&image, x, y)));
+    }
+  }
+}
+
 TEST_F(GainMapMathTest, GetP010Pixel) {
   jpegr_uncompressed_struct image = P010Image();
   Color (*colors)[4] = P010Colors();
@@ -17,9 +17,11 @@
 #include <ultrahdr/jpegr.h>
 #include <ultrahdr/jpegrutils.h>
 #include <ultrahdr/gainmapmath.h>
+#include <atomic>
 #include <fcntl.h>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <utils/Log.h>
 
@@ -171,8 +173,10 @@ public:
                                ultrahdr_metadata_ptr metadata, jr_uncompressed_ptr map);
  void BenchmarkApplyGainMap(jr_uncompressed_ptr yuv420Image, jr_uncompressed_ptr map,
                             ultrahdr_metadata_ptr metadata, jr_uncompressed_ptr dest);
+ void BenchmarkProbe(jr_compressed_ptr jpegR);
 private:
  const int kProfileCount = 10;
+ const int kProbeProfileCount = 1000;
 };
 
 void JpegRBenchmark::BenchmarkGenerateGainMap(jr_uncompressed_ptr yuv420Image,
@@ -192,9 +196,10 @@ void JpegRBenchmark::BenchmarkGenerateGainMap(jr_uncompressed_ptr yuv420Image,
   }
   timerStop(&genRecMapTime);
 
-  ALOGE("Generate Gain Map:- Res = %i x %i, time = %f ms",
-        yuv420Image->width, yuv420Image->height,
-        elapsedTime(&genRecMapTime) / (kProfileCount * 1000.f));
+  const float timeMs = elapsedTime(&genRecMapTime) / (kProfileCount * 1000.f);
+  ALOGE("Generate Gain Map:- Res = %i x %i, time = %f ms, %f MP/s",
+        yuv420Image->width, yuv420Image->height, timeMs,
+        yuv420Image->width * yuv420Image->height / (timeMs * 1000.f));
 
 }
 
@@ -211,9 +216,37 @@ void JpegRBenchmark::BenchmarkApplyGainMap(jr_uncompressed_ptr yuv420Image,
   }
   timerStop(&applyRecMapTime);
 
-  ALOGE("Apply Gain Map:- Res = %i x %i, time = %f ms",
-        yuv420Image->width, yuv420Image->height,
-        elapsedTime(&applyRecMapTime) / (kProfileCount * 1000.f));
+  const float timeMs = elapsedTime(&applyRecMapTime) / (kProfileCount * 1000.f);
+  ALOGE("Apply Gain Map:- Res = %i x %i, time = %f ms, %f MP/s",
+        yuv420Image->width, yuv420Image->height, timeMs,
+        yuv420Image->width * yuv420Image->height / (timeMs * 1000.f));
+}
+
+void JpegRBenchmark::BenchmarkProbe(jr_compressed_ptr jpegR) {
+  Timer probeTime;
+
+  timerStart(&probeTime);
+  for (auto i = 0; i < kProbeProfileCount; i++) {
+      jpegr_probe_struct probe;
+      ASSERT_EQ(OK, probeJPEGR(jpegR, &probe));
+  }
+  timerStop(&probeTime);
+
+  float timeMs = elapsedTime(&probeTime) / (kProbeProfileCount * 1000.f);
+  ALOGE("Probe JPEG/R:- Size = %i bytes, time = %f ms, %f photos/s", jpegR->length, timeMs,
+        1000.f / timeMs);
+
+  timerStart(&probeTime);
+  for (auto i = 0; i < kProbeProfileCount; i++) {
+      jpegr_info_struct info = { .width = 0, .height = 0, .iccData = nullptr,
+                                 .exifData = nullptr };
+      ASSERT_EQ(OK, getJPEGRInfo(jpegR, &info));
+  }
+  timerStop(&probeTime);
+
+  timeMs = elapsedTime(&probeTime) / (kProbeProfileCount * 1000.f);
+  ALOGE("Get JPEG/R info:- Size = %i bytes, time = %f ms, %f photos/s", jpegR->length, timeMs,
+        1000.f / timeMs);
 }
 
 TEST_F(JpegRTest, build) {
@@ -1015,6 +1048,78 @@ TEST_F(JpegRTest, encodeFromP010) {
   free(jpegRWithChromaData.data);
 }
 
+// Encoder that always fails, to check the fallback to the software encoder.
+class FailingJpegEncoder : public JpegEncoder {
+public:
+  bool compressImage(const void*, int, int, int, const void*, unsigned int, bool) override {
+    return false;
+  }
+  void* getCompressedImagePtr() override { return nullptr; }
+  size_t getCompressedImageSize() override { return 0; }
+};
+
+/* Test Encode API-0 with encoders from a factory */
+TEST_F(JpegRTest, encodeFromP010WithEncoderFactory) {
+  int ret;
+
+  mRawP010Image.width = TEST_IMAGE_WIDTH;
+  mRawP010Image.height = TEST_IMAGE_HEIGHT;
+  mRawP010Image.colorGamut = ultrahdr_color_gamut::ULTRAHDR_COLORGAMUT_BT2100;
+  // Load input files.
+  if (!loadP010Image(RAW_P010_IMAGE, &mRawP010Image, true)) {
+    FAIL() << "Load file " << RAW_P010_IMAGE << " failed";
+  }
+
+  JpegR jpegRCodec;
+  jpegr_compressed_struct jpegR;
+  jpegR.maxLength = TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT * sizeof(uint8_t);
+  jpegR.data = malloc(jpegR.maxLength);
+  ret = jpegRCodec.encodeJPEGR(
+      &mRawP010Image, ultrahdr_transfer_function::ULTRAHDR_TF_HLG, &jpegR, DEFAULT_JPEG_QUALITY,
+      nullptr);
+  if (ret != OK) {
+    FAIL() << "Error code is " << ret;
+  }
+
+  // Both the gain map and the primary image come from the factory.
+  std::atomic<int> gainMapEncoders = 0, primaryImageEncoders = 0;
+  JpegR softwareFactoryCodec([&](bool is_gain_map) -> std::unique_ptr<JpegEncoder> {
+    (is_gain_map ? gainMapEncoders : primaryImageEncoders)++;
+    return std::make_unique<JpegEncoderHelper>();
+  });
+  jpegr_compressed_struct jpegRFromFactory;
+  jpegRFromFactory.maxLength = jpegR.maxLength;
+  jpegRFromFactory.data = malloc(jpegRFromFactory.maxLength);
+  ret = softwareFactoryCodec.encodeJPEGR(
+      &mRawP010Image, ultrahdr_transfer_function::ULTRAHDR_TF_HLG, &jpegRFromFactory,
+      DEFAULT_JPEG_QUALITY, nullptr);
+  if (ret != OK) {
+    FAIL() << "Error code is " << ret;
+  }
+  EXPECT_EQ(1, gainMapEncoders);
+  EXPECT_EQ(1, primaryImageEncoders);
+  ASSERT_EQ(jpegR.length, jpegRFromFactory.length);
+  ASSERT_EQ(0, memcmp(jpegR.data, jpegRFromFactory.data, jpegR.length));
+
+  // Failing encoders fall back to the software encoder.
+  JpegR failingFactoryCodec([](bool) { return std::make_unique<FailingJpegEncoder>(); });
+  jpegr_compressed_struct jpegRWithFallback;
+  jpegRWithFallback.maxLength = jpegR.maxLength;
+  jpegRWithFallback.data = malloc(jpegRWithFallback.maxLength);
+  ret = failingFactoryCodec.encodeJPEGR(
+      &mRawP010Image, ultrahdr_transfer_function::ULTRAHDR_TF_HLG, &jpegRWithFallback,
+      DEFAULT_JPEG_QUALITY, nullptr);
+  if (ret != OK) {
+    FAIL() << "Error code is " << ret;
+  }
+  ASSERT_EQ(jpegR.length, jpegRWithFallback.length);
+  ASSERT_EQ(0, memcmp(jpegR.data, jpegRWithFallback.data, jpegR.length));
+
+  free(jpegR.data);
+  free(jpegRFromFactory.data);
+  free(jpegRWithFallback.data);
+}
+
 /* Test Encode API-0 and decode */
 TEST_F(JpegRTest, encodeFromP010ThenDecode) {
   int ret;
@@ -1069,6 +1174,74 @@ TEST_F(JpegRTest, encodeFromP010ThenDecode) {
   free(decodedJpegR.data);
 }
 
+/* Test Encode API-0 and decode a region in strips */
+TEST_F(JpegRTest, encodeFromP010ThenDecodeStrips) {
+  int ret;
+
+  // Load input files.
+  if (!loadFile(RAW_P010_IMAGE, mRawP010Image.data, nullptr)) {
+    FAIL() << "Load file " << RAW_P010_IMAGE << " failed";
+  }
+  mRawP010Image.width = TEST_IMAGE_WIDTH;
+  mRawP010Image.height = TEST_IMAGE_HEIGHT;
+  mRawP010Image.colorGamut = ultrahdr_color_gamut::ULTRAHDR_COLORGAMUT_BT2100;
+
+  JpegR jpegRCodec;
+
+  jpegr_compressed_struct jpegR;
+  jpegR.maxLength = TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT * sizeof(uint8_t);
+  jpegR.data = malloc(jpegR.maxLength);
+  ret = jpegRCodec.encodeJPEGR(
+      &mRawP010Image, ultrahdr_transfer_function::ULTRAHDR_TF_HLG, &jpegR, DEFAULT_JPEG_QUALITY,
+      nullptr);
+  if (ret != OK) {
+    FAIL() << "Error code is " << ret;
+  }
+
+  jpegr_uncompressed_struct decodedJpegR;
+  const int bytesPerPixel = 8;
+  decodedJpegR.data = malloc(TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT * bytesPerPixel);
+  ret = jpegRCodec.decodeJPEGR(&jpegR, &decodedJpegR);
+  if (ret != OK) {
+    FAIL() << "Error code is " << ret;
+  }
+
+  // Strips of the region must match the corresponding part of the fully decoded image.
+  jpegr_region_struct region = { 100, 50, 900, 600 };
+  int nextRow = region.top;
+  ret = jpegRCodec.decodeJPEGRStrips(
+      &jpegR, [&](jr_uncompressed_ptr strip, int row) {
+        EXPECT_EQ(nextRow, row);
+        EXPECT_EQ(region.right - region.left, strip->width);
+        for (int y = 0; y < strip->height; y++) {
+          const uint8_t* expected = static_cast<uint8_t*>(decodedJpegR.data)
+              + ((row + y) * TEST_IMAGE_WIDTH + region.left) * bytesPerPixel;
+          const uint8_t* actual = static_cast<uint8_t*>(strip->data)
+              + y * strip->width * bytesPerPixel;
+          EXPECT_EQ(0, memcmp(expected, actual, strip->width * bytesPerPixel)) << "row "
+                                                                                << row + y;
+        }
+        nextRow = row + strip->height;
+        return true;
+      }, FLT_MAX, ULTRAHDR_OUTPUT_HDR_LINEAR, &region);
+  if (ret != OK) {
+    FAIL() << "Error code is " << ret;
+  }
+  EXPECT_EQ(region.bottom, nextRow);
+
+  // Decoding stops as soon as the callback asks for it.
+  int stripCount = 0;
+  ret = jpegRCodec.decodeJPEGRStrips(&jpegR, [&](jr_uncompressed_ptr, int) {
+    stripCount++;
+    return false;
+  });
+  EXPECT_EQ(OK, ret);
+  EXPECT_EQ(1, stripCount);
+
+  free(jpegR.data);
+  free(decodedJpegR.data);
+}
+
 /* Test Encode API-0 (with stride) and decode */
 TEST_F(JpegRTest, encodeFromP010WithStrideThenDecode) {
   int ret;
@@ -1332,6 +1505,104 @@ TEST_F(JpegRTest, encodeFromJpegThenDecode) {
   free(decodedJpegR.data);
 }
 
+/* Test Encode API-0 and probe */
+TEST_F(JpegRTest, encodeFromP010ThenProbe) {
+  int ret;
+
+  // Load input files.
+  if (!loadFile(RAW_P010_IMAGE, mRawP010Image.data, nullptr)) {
+    FAIL() << "Load file " << RAW_P010_IMAGE << " failed";
+  }
+  mRawP010Image.width = TEST_IMAGE_WIDTH;
+  mRawP010Image.height = TEST_IMAGE_HEIGHT;
+  mRawP010Image.colorGamut = ultrahdr_color_gamut::ULTRAHDR_COLORGAMUT_BT2100;
+
+  JpegR jpegRCodec;
+
+  jpegr_compressed_struct jpegR;
+  jpegR.maxLength = TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT * sizeof(uint8_t);
+  jpegR.data = malloc(jpegR.maxLength);
+  ret = jpegRCodec.encodeJPEGR(
+      &mRawP010Image, ultrahdr_transfer_function::ULTRAHDR_TF_HLG, &jpegR, DEFAULT_JPEG_QUALITY,
+      nullptr);
+  if (ret != OK) {
+    FAIL() << "Error code is " << ret;
+  }
+
+  jpegr_probe_struct probe;
+  ASSERT_EQ(OK, jpegRCodec.probeJPEGR(&jpegR, &probe));
+  EXPECT_EQ(static_cast<size_t>(TEST_IMAGE_WIDTH), probe.width);
+  EXPECT_EQ(static_cast<size_t>(TEST_IMAGE_HEIGHT), probe.height);
+  EXPECT_GT(probe.gainMapLength, 0u);
+  EXPECT_LE(probe.gainMapOffset + probe.gainMapLength, static_cast<size_t>(jpegR.length));
+  EXPECT_EQ("1.0", probe.metadata.version);
+  EXPECT_GT(probe.metadata.maxContentBoost, 1.0f);
+
+  // The gain map it finds is the one decoding uses.
+  ultrahdr_metadata_struct metadata;
+  jpegr_uncompressed_struct decodedJpegR;
+  decodedJpegR.data = malloc(TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT * 8);
+  ASSERT_EQ(OK, jpegRCodec.decodeJPEGR(&jpegR, &decodedJpegR, FLT_MAX, nullptr,
+                                       ULTRAHDR_OUTPUT_HDR_LINEAR, nullptr, &metadata));
+  EXPECT_EQ(metadata.maxContentBoost, probe.metadata.maxContentBoost);
+  EXPECT_EQ(metadata.minContentBoost, probe.metadata.minContentBoost);
+
+  // A JPEG image without gain map only has its dimensions probed.
+  if (!loadFile(JPEG_IMAGE, mJpegImage.data, &mJpegImage.length)) {
+    FAIL() << "Load file " << JPEG_IMAGE << " failed";
+  }
+  ASSERT_EQ(ERROR_JPEGR_GAIN_MAP_IMAGE_NOT_FOUND, jpegRCodec.probeJPEGR(&mJpegImage, &probe));
+  EXPECT_EQ(static_cast<size_t>(TEST_IMAGE_WIDTH), probe.width);
+  EXPECT_EQ(static_cast<size_t>(TEST_IMAGE_HEIGHT), probe.height);
+
+  // Nor is a truncated image.
+  jpegr_compressed_struct truncated = jpegR;
+  truncated.length = 1;
+  EXPECT_EQ(ERROR_JPEGR_INVALID_INPUT_TYPE, jpegRCodec.probeJPEGR(&truncated, &probe));
+
+  free(jpegR.data);
+  free(decodedJpegR.data);
+}
+
+/* Profile probing a JPEG/R file that is mapped in memory, as when scanning a photo library */
+TEST_F(JpegRTest, ProfileProbeJpegR) {
+  // Load input files.
+  if (!loadFile(RAW_P010_IMAGE, mRawP010Image.data, nullptr)) {
+    FAIL() << "Load file " << RAW_P010_IMAGE << " failed";
+  }
+  mRawP010Image.width = TEST_IMAGE_WIDTH;
+  mRawP010Image.height = TEST_IMAGE_HEIGHT;
+  mRawP010Image.colorGamut = ultrahdr_color_gamut::ULTRAHDR_COLORGAMUT_BT2100;
+
+  JpegRBenchmark benchmark;
+
+  jpegr_compressed_struct jpegR;
+  jpegR.maxLength = TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT * sizeof(uint8_t);
+  jpegR.data = malloc(jpegR.maxLength);
+  ASSERT_EQ(OK, benchmark.encodeJPEGR(&mRawP010Image, ultrahdr_transfer_function::ULTRAHDR_TF_HLG,
+                                      &jpegR, DEFAULT_JPEG_QUALITY, nullptr));
+
+  std::string filePath = "/sdcard/Documents/probe_input.jpgr";
+  {
+    std::ofstream imageFile(filePath.c_str(), std::ofstream::binary);
+    ASSERT_TRUE(imageFile.is_open()) << "Unable to create file " << filePath;
+    imageFile.write((const char*)jpegR.data, jpegR.length);
+  }
+  free(jpegR.data);
+
+  int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+  ASSERT_GE(fd, 0) << "Unable to open file " << filePath;
+  jpegr_compressed_struct mappedJpegR = {};
+  mappedJpegR.length = getFileSize(fd);
+  mappedJpegR.data = mmap(nullptr, mappedJpegR.length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  ASSERT_NE(MAP_FAILED, mappedJpegR.data);
+
+  benchmark.BenchmarkProbe(&mappedJpegR);
+
+  munmap(mappedJpegR.data, mappedJpegR.length);
+}
+
 TEST_F(JpegRTest, ProfileGainMapFuncs) {
   const size_t kWidth = TEST_IMAGE_WIDTH;
   const size_t kHeight = TEST_IMAGE_HEIGHT;
@@ -0,0 +1,170 @@
+#include "libbroadcastring/broadcast_ring.h"
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <atomic>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <private/gui/BitTube.h>
+
+namespace android {
+namespace dvr {
+namespace {
+
+// A telemetry sample that fills one cache line.
+struct alignas(8) Sample {
+  int64_t timestamp_ns;
+  float values[14];
+};
+
+struct WakeReadersTraits : public DefaultRingTraits {
+  static constexpr bool kWakeReaders = true;
+};
+
+constexpr uint32_t kRecordCount = 256;
+
+// Large enough for the biggest batch, which BitTube sends as one packet.
+constexpr size_t kBitTubeBufferSize = 64 * 1024;
+
+// How often the echo threads check whether the benchmark is done.
+constexpr int64_t kEchoTimeoutNs = 10000000;
+
+template <typename Ring>
+class MappedRing {
+ public:
+  MappedRing() : size_(Ring::MemorySize(kRecordCount)) {
+    base_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                 MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+    CHECK(base_ != MAP_FAILED);
+    ring_ = Ring::Create(base_, size_, kRecordCount);
+  }
+  ~MappedRing() { munmap(base_, size_); }
+
+  Ring& ring() { return ring_; }
+
+ private:
+  size_t size_;
+  void* base_;
+  Ring ring_;
+};
+
+void BM_BroadcastRing_Get(benchmark::State& state) {
+  using Ring = BroadcastRing<Sample>;
+  MappedRing<Ring> mapped;
+  Ring& ring = mapped.ring();
+  const uint32_t batch = state.range(0);
+  const Sample sample = {};
+  uint32_t sequence = ring.GetNextSequence();
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < batch; ++i) ring.Put(sample);
+    Sample record;
+    while (ring.Get(&sequence, &record)) {
+      benchmark::DoNotOptimize(record);
+      sequence++;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_BroadcastRing_Get)->Arg(1)->Arg(8)->Arg(64);
+
+void BM_BroadcastRing_GetRange(benchmark::State& state) {
+  using Ring = BroadcastRing<Sample>;
+  MappedRing<Ring> mapped;
+  Ring& ring = mapped.ring();
+  const uint32_t batch = state.range(0);
+  const Sample sample = {};
+  std::vector<Sample> records(batch);
+  uint32_t sequence = ring.GetNextSequence();
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < batch; ++i) ring.Put(sample);
+    uint32_t count;
+    while ((count = ring.GetRange(&sequence, records.data(), batch))) {
+      benchmark::DoNotOptimize(records.data());
+      sequence += count;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_BroadcastRing_GetRange)->Arg(1)->Arg(8)->Arg(64);
+
+void BM_BitTube_SendRecv(benchmark::State& state) {
+  gui::BitTube tube(kBitTubeBufferSize);
+  const uint32_t batch = state.range(0);
+  const std::vector<Sample> samples(batch);
+  std::vector<Sample> records(batch);
+  for (auto _ : state) {
+    gui::BitTube::sendObjects(&tube, samples.data(), batch);
+    gui::BitTube::recvObjects(&tube, records.data(), batch);
+    benchmark::DoNotOptimize(records.data());
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_BitTube_SendRecv)->Arg(1)->Arg(8)->Arg(64);
+
+// Measures the round trip to a blocked reader thread that echoes each record.
+void BM_BroadcastRing_WakeLatency(benchmark::State& state) {
+  using Ring = BroadcastRing<Sample, WakeReadersTraits>;
+  MappedRing<Ring> ping;
+  MappedRing<Ring> pong;
+  std::atomic<bool> quit(false);
+  std::thread echo([&ping, &pong, &quit,
+                    sequence = ping.ring().GetNextSequence()]() mutable {
+    Sample record;
+    while (!quit.load(std::memory_order_relaxed)) {
+      if (!ping.ring().Wait(sequence, kEchoTimeoutNs)) continue;
+      while (ping.ring().Get(&sequence, &record)) {
+        pong.ring().Put(record);
+        sequence++;
+      }
+    }
+  });
+
+  const Sample sample = {};
+  uint32_t sequence = pong.ring().GetNextSequence();
+  for (auto _ : state) {
+    ping.ring().Put(sample);
+    Sample record;
+    while (!pong.ring().Get(&sequence, &record))
+      pong.ring().Wait(sequence, -1);
+    sequence++;
+  }
+
+  quit.store(true, std::memory_order_relaxed);
+  echo.join();
+}
+BENCHMARK(BM_BroadcastRing_WakeLatency);
+
+void BM_BitTube_WakeLatency(benchmark::State& state) {
+  gui::BitTube ping(kBitTubeBufferSize);
+  gui::BitTube pong(kBitTubeBufferSize);
+  std::atomic<bool> quit(false);
+  std::thread echo([&ping, &pong, &quit]() {
+    pollfd fd = {ping.getFd(), POLLIN, 0};
+    Sample record;
+    while (!quit.load(std::memory_order_relaxed)) {
+      if (poll(&fd, 1, kEchoTimeoutNs / 1000000) <= 0) continue;
+      while (gui::BitTube::recvObjects(&ping, &record, 1) > 0)
+        gui::BitTube::sendObjects(&pong, &record, 1);
+    }
+  });
+
+  const Sample sample = {};
+  pollfd fd = {pong.getFd(), POLLIN, 0};
+  for (auto _ : state) {
+    gui::BitTube::sendObjects(&ping, &sample, 1);
+    Sample record;
+    while (gui::BitTube::recvObjects(&pong, &record, 1) <= 0) poll(&fd, 1, -1);
+  }
+
+  quit.store(true, std::memory_order_relaxed);
+  echo.join();
+}
+BENCHMARK(BM_BitTube_WakeLatency);
+
+}  // namespace
+}  // namespace dvr
+}  // namespace android
+
+BENCHMARK_MAIN();
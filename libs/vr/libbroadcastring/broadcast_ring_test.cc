@@ -1,8 +1,11 @@
 #include "libbroadcastring/broadcast_ring.h"
 
 #include <stdlib.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
 #include <memory>
 #include <thread>  // NOLINT
+#include <vector>
 #include <sys/mman.h>
 
 #include <gtest/gtest.h>
@@ -87,6 +90,14 @@ struct TraitsStatic
   static uint32_t MinCount() { return StaticCount; }
 };
 
+template <typename Record, uint32_t RecordAlignment, bool WakeReaders = false>
+struct TraitsOptions : public Traits<Record, false, 0, 1, 7> {
+  using Ring = BroadcastRing<Record, TraitsOptions>;
+  static constexpr uint32_t kRecordAlignment = RecordAlignment;
+  static constexpr bool kWakeReaders = WakeReaders;
+  static uint32_t MinCount() { return 8; }
+};
+
 using Dynamic_8_NxM = TraitsDynamic<Sized<8>>;
 using Dynamic_16_NxM = TraitsDynamic<Sized<16>>;
 using Dynamic_32_NxM = TraitsDynamic<Sized<32>>;
@@ -103,6 +114,9 @@ using Static_16_16x16 = TraitsStatic<Sized<16>, 16>;
 using Static_16_16x32 = TraitsStatic<Sized<16>, 32>;
 using Static_32_Nx8 = TraitsStatic<Sized<32>, 8, false>;
 
+using Padded_16_NxM_64 = TraitsOptions<Sized<16>, 64>;
+using Dynamic_16_NxM_Wake = TraitsOptions<Sized<16>, 0, true>;
+
 using TraitsList = ::testing::Types<Dynamic_8_NxM,           //
                                     Dynamic_16_NxM,          //
                                     Dynamic_32_NxM,          //
@@ -286,6 +300,53 @@ TYPED_TEST(BroadcastRingTest, FillTwice) {
   }
 }
 
+TYPED_TEST(BroadcastRingTest, GetRange) {
+  using Record = typename TypeParam::Record;
+  using Ring = typename TypeParam::Ring;
+  Ring ring;
+  auto mmap = CreateRing(&ring, Ring::Traits::MinCount());
+  const uint32_t next_sequence_at_start = ring.GetNextSequence();
+  std::vector<Record> records(ring.record_count() + 1);
+  {
+    uint32_t sequence = next_sequence_at_start;
+    EXPECT_EQ(0U, ring.GetRange(&sequence, records.data(), records.size()));
+    EXPECT_EQ(next_sequence_at_start, sequence);
+  }
+  for (uint32_t i = 0; i < ring.record_count(); ++i)
+    ring.Put(Record(FillChar(i)));
+  {
+    uint32_t sequence = ring.GetOldestSequence();
+    EXPECT_EQ(ring.record_count(),
+              ring.GetRange(&sequence, records.data(), records.size()));
+    EXPECT_EQ(next_sequence_at_start, sequence);
+    for (uint32_t i = 0; i < ring.record_count(); ++i)
+      EXPECT_EQ(Record(FillChar(i)), records[i]);
+  }
+  {
+    uint32_t sequence = next_sequence_at_start + 1;
+    const uint32_t expected_count = std::min(2U, ring.record_count() - 1);
+    EXPECT_EQ(expected_count, ring.GetRange(&sequence, records.data(), 2));
+    EXPECT_EQ(next_sequence_at_start + 1, sequence);
+    for (uint32_t i = 0; i < expected_count; ++i)
+      EXPECT_EQ(Record(FillChar(i + 1)), records[i]);
+  }
+  ring.Put(Record(FillChar(ring.record_count())));
+  {
+    // The first record has been overwritten, so the range starts after it.
+    uint32_t sequence = next_sequence_at_start;
+    EXPECT_EQ(ring.record_count(),
+              ring.GetRange(&sequence, records.data(), records.size()));
+    EXPECT_EQ(next_sequence_at_start + 1, sequence);
+    for (uint32_t i = 0; i < ring.record_count(); ++i)
+      EXPECT_EQ(Record(FillChar(i + 1)), records[i]);
+  }
+  {
+    uint32_t sequence = ring.GetNextSequence();
+    EXPECT_EQ(0U, ring.GetRange(&sequence, records.data(), records.size()));
+    EXPECT_EQ(ring.GetNextSequence(), sequence);
+  }
+}
+
 TYPED_TEST(BroadcastRingTest, Import) {
   using Record = typename TypeParam::Record;
   using Ring = typename TypeParam::Ring;
@@ -673,6 +734,69 @@ TEST(BroadcastRingTest, ShouldDieIfCreationMmapMisaligned) {
   }
 }
 
+TEST(BroadcastRingTest, PaddedRecords) {
+  using Ring = Padded_16_NxM_64::Ring;
+  using Record = Ring::Record;
+  static_assert(Ring::mmap_alignment() == 64, "Bad padded alignment");
+
+  uint32_t record_count = Ring::Traits::MinCount();
+  size_t ring_size = Ring::MemorySize(record_count);
+  EXPECT_EQ(64U + 64U * record_count, ring_size);
+
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t mmap_size = (ring_size + (page_size - 1)) & ~(page_size - 1);
+  void* mmap_base = mmap(nullptr, mmap_size, PROT_READ | PROT_WRITE,
+                         MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  ASSERT_NE(MAP_FAILED, mmap_base);
+
+  Ring ring = Ring::Create(mmap_base, mmap_size, record_count);
+  EXPECT_EQ(64U, ring.record_size());
+  EXPECT_EQ(record_count, ring.record_count());
+  for (uint32_t i = 0; i < record_count; ++i) ring.Put(Record(FillChar(i)));
+
+  // Each record starts on its own cache line after the header's.
+  const char* records_base = static_cast<const char*>(mmap_base) + 64;
+  for (uint32_t i = 0; i < record_count; ++i) {
+    const Record expected_record(FillChar(i));
+    const uint32_t index = (ring.GetOldestSequence() + i) % record_count;
+    EXPECT_EQ(0, memcmp(&expected_record, records_base + index * 64,
+                        sizeof(Record)));
+  }
+
+  {
+    Ring imported_ring;
+    bool import_ok;
+    std::tie(imported_ring, import_ok) = Ring::Import(mmap_base, mmap_size);
+    EXPECT_TRUE(import_ok);
+    EXPECT_EQ(ring.record_size(), imported_ring.record_size());
+
+    uint32_t sequence = imported_ring.GetOldestSequence();
+    std::vector<Record> records(record_count);
+    EXPECT_EQ(record_count,
+              imported_ring.GetRange(&sequence, records.data(), record_count));
+    for (uint32_t i = 0; i < record_count; ++i)
+      EXPECT_EQ(Record(FillChar(i)), records[i]);
+  }
+
+  ASSERT_EQ(0, munmap(mmap_base, mmap_size));
+}
+
+TEST(BroadcastRingTest, WaitTimesOut) {
+  using Ring = Dynamic_16_NxM::Ring;
+  using Record = Ring::Record;
+  Ring ring;
+  auto mmap = CreateRing(&ring, Ring::Traits::MinCount());
+
+  const uint32_t sequence = ring.GetNextSequence();
+  EXPECT_FALSE(ring.Wait(sequence, 0));
+  EXPECT_FALSE(ring.Wait(sequence, 1000000));
+
+  ring.Put(Record(3));
+  EXPECT_TRUE(ring.Wait(sequence, 0));
+  EXPECT_TRUE(ring.Wait(sequence, -1));
+  EXPECT_FALSE(ring.Wait(sequence + 1, 0));
+}
+
 template <typename Ring>
 std::unique_ptr<std::thread> CopyTask(std::atomic<bool>* quit, void* in_base,
                                       size_t in_size, void* out_base,
@@ -854,6 +978,25 @@ void ThreadedOverwriteTorture() {
   }
 }
 
+TEST(BroadcastRingTest, ThreadedWaitWakesReader) {
+  using Ring = Dynamic_16_NxM_Wake::Ring;
+  using Record = Ring::Record;
+  Ring ring;
+  auto mmap = CreateRing(&ring, Ring::Traits::MinCount());
+
+  uint32_t sequence = ring.GetNextSequence();
+  std::thread writer([&ring]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ring.Put(Record(5));
+  });
+
+  EXPECT_TRUE(ring.Wait(sequence, -1));
+  Record record;
+  EXPECT_TRUE(ring.Get(&sequence, &record));
+  EXPECT_EQ(Record(5), record);
+  writer.join();
+}
+
 TEST(BroadcastRingTest, ThreadedOverwriteTortureSmall) {
   ThreadedOverwriteTorture<Dynamic_16_NxM_1plus0::Ring>();
 }
@@ -2,8 +2,15 @@
 #define ANDROID_DVR_BROADCAST_RING_H_
 
 #include <inttypes.h>
+#include <limits.h>
+#include <linux/futex.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
 #include <atomic>
 #include <limits>
 #include <tuple>
@@ -31,8 +38,47 @@ struct DefaultRingTraits {
 
   // Set this to the min number of records that must be readable.
   static constexpr uint32_t kMinAvailableRecords = 1;
+
+  // Set this to a power of two larger than 8, e.g. the cache line size, to pad
+  // each record and the header to a multiple of it. The writer and all readers
+  // must agree on this value since it changes the layout of the ring.
+  static constexpr uint32_t kRecordAlignment = 0;
+
+  // Set this to true to wake readers blocked in Wait() on each Put(). This
+  // costs the writer a futex syscall per put.
+  static constexpr bool kWakeReaders = false;
+};
+
+namespace detail {
+
+// Always require 8 byte alignment so that the same record sizes are legal on
+// 32 and 64 bit builds.
+constexpr uint32_t kMinRecordAlignment = 8;
+
+// The traits above were added over time; these fall back to the defaults for
+// traits that predate them.
+template <typename T, typename = void>
+struct RecordAlignmentTrait {
+  static constexpr uint32_t value = DefaultRingTraits::kRecordAlignment;
+};
+
+template <typename T>
+struct RecordAlignmentTrait<T, decltype(void(T::kRecordAlignment))> {
+  static constexpr uint32_t value = T::kRecordAlignment;
 };
 
+template <typename T, typename = void>
+struct WakeReadersTrait {
+  static constexpr bool value = DefaultRingTraits::kWakeReaders;
+};
+
+template <typename T>
+struct WakeReadersTrait<T, decltype(void(T::kWakeReaders))> {
+  static constexpr bool value = T::kWakeReaders;
+};
+
+}  // namespace detail
+
 // Nonblocking ring suitable for concurrent single-writer, multi-reader access.
 //
 // Readers never block the writer and thus this is a nondeterministically lossy
@@ -40,7 +86,9 @@ struct DefaultRingTraits {
 // transport when deterministic behavior is required.
 //
 // Readers may have a read-only mapping; each reader's state is a single local
-// sequence number.
+// sequence number. Readers that need to block until new records arrive may use
+// Wait(), which also works with a read-only mapping; the writer only wakes them
+// when kWakeReaders is set in the traits.
 //
 // The implementation takes care to avoid data races on record access.
 // Inconsistent data can only be returned if at least 2^32 records are written
@@ -123,6 +171,13 @@ struct DefaultRingTraits {
 //         ProcessRecord(sequence, record);
 //         sequence++;
 //       }
+//     } else if (you_want_to_process_records_in_batches) {
+//       Record records[kMyBatchSize];
+//       uint32_t count;
+//       while ((count = ring.GetRange(&sequence, records, kMyBatchSize))) {
+//         ProcessRecords(sequence, records, count);
+//         sequence += count;
+//       }
 //     } else if (you_want_to_skip_to_the_newest_record) {
 //       if (ring.GetNewest(&sequence, &record)) {
 //         ProcessRecord(sequence, record);
@@ -151,12 +206,29 @@ class BroadcastRing {
     // If both record size and count are static then the overall size is too.
     static constexpr bool kIsStaticSize =
         BaseTraits::kUseStaticRecordSize && kUseStaticRecordCount;
+
+    // Whether records are padded beyond the minimum alignment.
+    static constexpr bool kUsePaddedRecords =
+        detail::RecordAlignmentTrait<BaseTraits>::value >
+        detail::kMinRecordAlignment;
+
+    // Alignment of records in the mmap area.
+    static constexpr uint32_t kRecordAlignment =
+        kUsePaddedRecords ? detail::RecordAlignmentTrait<BaseTraits>::value
+                          : detail::kMinRecordAlignment;
+
+    static constexpr bool kWakeReaders =
+        detail::WakeReadersTrait<BaseTraits>::value;
   };
 
   static constexpr bool IsPowerOfTwo(uint32_t size) {
     return (size & (size - 1)) == 0;
   }
 
+  static constexpr size_t RoundUp(size_t size, size_t alignment) {
+    return (size + alignment - 1) & ~(alignment - 1);
+  }
+
   // Sanity check the options provided in Traits.
   static_assert(Traits::kMinRecordCount >= 1, "Min record count too small");
   static_assert(!Traits::kUseStaticRecordCount ||
@@ -165,6 +237,8 @@ class BroadcastRing {
   static_assert(!Traits::kStaticRecordCount ||
                     IsPowerOfTwo(Traits::kStaticRecordCount),
                 "Static record count is not a power of two");
+  static_assert(IsPowerOfTwo(Traits::kRecordAlignment),
+                "Record alignment is not a power of two");
   static_assert(std::is_standard_layout<Record>::value,
                 "Record type must be standard layout");
 
@@ -177,8 +251,8 @@ class BroadcastRing {
   static BroadcastRing Create(void* mmap, size_t mmap_size,
                               uint32_t record_count) {
     BroadcastRing ring(mmap);
-    CHECK(ring.ValidateGeometry(mmap_size, sizeof(Record), record_count));
-    ring.InitializeHeader(sizeof(Record), record_count);
+    CHECK(ring.ValidateGeometry(mmap_size, kRecordSize, record_count));
+    ring.InitializeHeader(kRecordSize, record_count);
     return ring;
   }
 
@@ -217,7 +291,7 @@ class BroadcastRing {
   //
   // Use this function for dynamically sized rings.
   static constexpr size_t MemorySize(uint32_t record_count) {
-    return sizeof(Header) + sizeof(Record) * record_count;
+    return kRecordsOffset + kRecordSize * record_count;
   }
 
   // Calculates the space necessary for a statically sized ring.
@@ -246,11 +320,11 @@ class BroadcastRing {
   //
   // The header size has been taken into account.
   static uint32_t GetRecordCount(size_t mmap_size) {
-    if (mmap_size <= sizeof(Header)) {
+    if (mmap_size <= kRecordsOffset) {
       return 0;
     }
     uint32_t count =
-        static_cast<uint32_t>((mmap_size - sizeof(Header)) / sizeof(Record));
+        static_cast<uint32_t>((mmap_size - kRecordsOffset) / kRecordSize);
     return IsPowerOfTwo(count) ? count : (NextPowerOf2(count) / 2);
   }
 
@@ -355,6 +429,110 @@ class BroadcastRing {
     }
   }
 
+  // Copies up to |max_count| consecutive records to |records|, starting with
+  // the oldest available record with sequence at least |*sequence|.
+  //
+  // Returns the number of records copied, which is zero if there is no recent
+  // enough record available.
+  //
+  // Updates |*sequence| with the sequence number of the first record returned.
+  // To get the following records, increment this number by the count returned.
+  //
+  // This synchronizes like Get(), but validates the whole batch against a
+  // single load of |head|, so it is cheaper than repeated calls to Get(). If
+  // the writer overwrites some of the records while they are copied, only the
+  // records that are still intact are returned rather than re-trying.
+  uint32_t GetRange(uint32_t* sequence /*inout*/, Record* records /*out*/,
+                    uint32_t max_count) const {
+    if (max_count == 0) return 0;
+
+    for (;;) {
+      uint32_t tail = std::atomic_load_explicit(&header_mmap()->tail,
+                                                std::memory_order_acquire);
+      uint32_t head = std::atomic_load_explicit(&header_mmap()->head,
+                                                std::memory_order_relaxed);
+
+      if (tail - head > record_count())
+        continue;  // Concurrent modification; re-try.
+
+      if (*sequence - head > tail - head)
+        *sequence = head;  // Out of window, skip forward to first available.
+
+      if (*sequence == tail) return 0;  // No new records available.
+
+      uint32_t count = std::min(tail - *sequence, max_count);
+      for (uint32_t i = 0; i < count; ++i) {
+        uint32_t index = SequenceToIndex(*sequence + i, record_count());
+        GetRecordInternal(record_mmap_reader(index), &records[i]);
+      }
+
+      // NB: It is not sufficient to change this to a load-acquire of |head|.
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      uint32_t final_head = std::atomic_load_explicit(
+          &header_mmap()->head, std::memory_order_relaxed);
+
+      if (final_head - head > *sequence - head) {
+        // The records before |final_head| may have been overwritten; drop them
+        // and keep the rest, which are valid by the same argument as in Get().
+        uint32_t overwritten = final_head - *sequence;
+        if (overwritten >= count)
+          continue;  // Concurrent modification; re-try.
+
+        count -= overwritten;
+        memmove(records, records + overwritten, count * sizeof(Record));
+        *sequence = final_head;
+      }
+
+      return count;
+    }
+  }
+
+  // Blocks until a record with sequence |sequence| or later is published, or
+  // until |timeout_ns| nanoseconds have elapsed. A negative timeout waits
+  // indefinitely.
+  //
+  // Returns true if Get() with |sequence| may return a record, i.e. if the
+  // next sequence is no longer |sequence|, and false on timeout.
+  //
+  // The writer only wakes blocked readers when kWakeReaders is set in the
+  // traits; otherwise this returns no earlier than the timeout.
+  bool Wait(uint32_t sequence, int64_t timeout_ns) const {
+    constexpr int64_t kNanosPerSecond = 1000000000;
+    timespec deadline;
+    if (timeout_ns >= 0) {
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      int64_t deadline_ns =
+          deadline.tv_sec * kNanosPerSecond + deadline.tv_nsec + timeout_ns;
+      deadline.tv_sec = deadline_ns / kNanosPerSecond;
+      deadline.tv_nsec = deadline_ns % kNanosPerSecond;
+    }
+
+    for (;;) {
+      if (std::atomic_load_explicit(&header_mmap()->tail,
+                                    std::memory_order_acquire) != sequence)
+        return true;
+
+      timespec timeout;
+      if (timeout_ns >= 0) {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t remaining_ns =
+            (deadline.tv_sec - now.tv_sec) * kNanosPerSecond +
+            (deadline.tv_nsec - now.tv_nsec);
+        if (remaining_ns <= 0) return false;
+        timeout.tv_sec = remaining_ns / kNanosPerSecond;
+        timeout.tv_nsec = remaining_ns % kNanosPerSecond;
+      }
+
+      // The futex is not private since the ring is usually shared between
+      // processes. The kernel only re-checks |tail| and returns if it is no
+      // longer |sequence|, so a concurrent Put() cannot be missed.
+      syscall(SYS_futex, &header_mmap()->tail, FUTEX_WAIT, sequence,
+              timeout_ns >= 0 ? &timeout : nullptr, nullptr, 0);
+    }
+  }
+
   // Copies the newest available record with sequence at least |*sequence| to
   // |record|.
   //
@@ -374,7 +552,10 @@ class BroadcastRing {
 
   uint32_t record_count() const { return record_count_internal(); }
   uint32_t record_size() const { return record_size_internal(); }
-  static constexpr uint32_t mmap_alignment() { return alignof(Mmap); }
+  static constexpr uint32_t mmap_alignment() {
+    return Traits::kUsePaddedRecords ? Traits::kRecordAlignment
+                                     : alignof(Mmap);
+  }
 
  private:
   struct Header {
@@ -406,12 +587,13 @@ class BroadcastRing {
   // Store using the standard word size.
   using StorageType = long;  // NOLINT
 
-  // Always require 8 byte alignment so that the same record sizes are legal on
-  // 32 and 64 bit builds.
-  static constexpr size_t kRecordAlignment = 8;
-  static_assert(kRecordAlignment % sizeof(StorageType) == 0,
+  static_assert(detail::kMinRecordAlignment % sizeof(StorageType) == 0,
                 "Bad record alignment");
 
+  // Size of each record in the mmap area, including padding.
+  static constexpr uint32_t kRecordSize =
+      RoundUp(sizeof(Record), Traits::kRecordAlignment);
+
   struct RecordStorage {
     // This is accessed with relaxed atomics to prevent data races on the
     // contained data, which would be undefined behavior.
@@ -448,12 +630,20 @@ class BroadcastRing {
   // Mmap area layout.
   //
   // Readers should not index directly into |records| as this is not valid when
-  // dynamic record sizes are used; use record_mmap_reader() instead.
+  // dynamic record sizes or padded records are used; use record_mmap_reader()
+  // instead.
   struct Mmap {
     Header header;
     RecordStorage records[];
   };
 
+  // Offset of the first record, which is padded to the record alignment so
+  // that padded records do not share a cache line with the header.
+  static constexpr size_t kRecordsOffset =
+      Traits::kUsePaddedRecords
+          ? RoundUp(sizeof(Header), Traits::kRecordAlignment)
+          : offsetof(Mmap, records);
+
   static_assert(std::is_standard_layout<Mmap>::value,
                 "Mmap must be standard layout");
   static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
@@ -462,7 +652,7 @@ class BroadcastRing {
                 "Lockless atomics contain extra state");
 
   explicit BroadcastRing(void* mmap) {
-    CHECK_EQ(0U, reinterpret_cast<uintptr_t>(mmap) % alignof(Mmap));
+    CHECK_EQ(0U, reinterpret_cast<uintptr_t>(mmap) % mmap_alignment());
     data_.mmap = reinterpret_cast<Mmap*>(mmap);
   }
 
@@ -493,13 +683,13 @@ class BroadcastRing {
     if (record_count() != header_record_count) return false;
     if (record_count() < Traits::kMinRecordCount) return false;
     if (record_size() < sizeof(Record)) return false;
-    if (record_size() % kRecordAlignment != 0) return false;
+    if (record_size() % Traits::kRecordAlignment != 0) return false;
     if (!IsPowerOfTwo(record_count())) return false;
 
     size_t memory_size = record_count() * record_size();
     if (memory_size / record_size() != record_count()) return false;
-    if (memory_size + sizeof(Header) < memory_size) return false;
-    if (memory_size + sizeof(Header) > mmap_size) return false;
+    if (memory_size + kRecordsOffset < memory_size) return false;
+    if (memory_size + kRecordsOffset > mmap_size) return false;
 
     return true;
   }
@@ -541,7 +731,7 @@ class BroadcastRing {
     Geometry geometry;
     geometry.record_count = record_count;
     geometry.record_size = record_size;
-    DCHECK_EQ(0U, geometry.record_size % kRecordAlignment);
+    DCHECK_EQ(0U, geometry.record_size % Traits::kRecordAlignment);
     geometry.head = head;
     geometry.tail = tail;
     geometry.head_index = SequenceToIndex(head, record_count);
@@ -594,23 +784,32 @@ class BroadcastRing {
     std::atomic_store_explicit(&header_mmap()->tail,
                                geometry.tail + publish_count,
                                std::memory_order_release);
+    if (Traits::kWakeReaders) {
+      syscall(SYS_futex, &header_mmap()->tail, FUTEX_WAKE, INT_MAX, nullptr,
+              nullptr, 0);
+    }
   }
 
   // Helpers to compute addresses in mmap area.
   Mmap* mmap() const { return data_.mmap; }
   Header* header_mmap() const { return &data_.mmap->header; }
+  char* records_mmap() const {
+    return reinterpret_cast<char*>(data_.mmap) + kRecordsOffset;
+  }
   RecordStorage* record_mmap_writer(uint32_t index) const {
-    DCHECK_EQ(sizeof(Record), record_size());
-    return &data_.mmap->records[index];
+    DCHECK_EQ(kRecordSize, record_size());
+    return reinterpret_cast<RecordStorage*>(records_mmap() +
+                                            index * kRecordSize);
   }
   RecordStorage* record_mmap_reader(uint32_t index) const {
     if (Traits::kUseStaticRecordSize) {
-      return &data_.mmap->records[index];
+      return reinterpret_cast<RecordStorage*>(records_mmap() +
+                                              index * kRecordSize);
     } else {
       // Calculate the location of a record in the ring without assuming that
-      // sizeof(Record) == record_size.
-      return reinterpret_cast<RecordStorage*>(
-          reinterpret_cast<char*>(data_.mmap->records) + index * record_size());
+      // kRecordSize == record_size.
+      return reinterpret_cast<RecordStorage*>(records_mmap() +
+                                              index * record_size());
     }
   }
 
@@ -623,7 +822,7 @@ class BroadcastRing {
   template <typename T = Traits>
   typename std::enable_if<T::kUseStaticRecordSize, uint32_t>::type
   record_size_internal() const {
-    return sizeof(Record);
+    return kRecordSize;
   }
 
   template <typename T = Traits>
@@ -9,8 +9,10 @@
 #include <vector>
 
 #include <pdx/rpc/argument_encoder.h>
+#include <pdx/rpc/blob_view.h>
 #include <pdx/rpc/message_buffer.h>
 #include <pdx/rpc/payload.h>
+#include <pdx/rpc/serializable.h>
 #include <pdx/utility.h>
 
 using namespace android::pdx::rpc;
@@ -26,6 +28,48 @@ namespace {
 
 constexpr size_t kMaxStaticBufferSize = 20480;
 
+// Small message serialized member by member.
+struct SerializableMessage {
+  int32_t id;
+  uint32_t flags;
+  int64_t timestamp;
+  std::array<float, 4> position;
+
+  bool operator==(const SerializableMessage& other) const {
+    return id == other.id && flags == other.flags &&
+           timestamp == other.timestamp && position == other.position;
+  }
+  bool operator!=(const SerializableMessage& other) const { return !(*this == other); }
+
+ private:
+  PDX_SERIALIZABLE_MEMBERS(SerializableMessage, id, flags, timestamp,
+                           position);
+};
+
+// The same message with a fixed layout, serialized as a single blob.
+struct FixedLayoutMessage {
+  int32_t id;
+  uint32_t flags;
+  int64_t timestamp;
+  std::array<float, 4> position;
+
+  bool operator==(const FixedLayoutMessage& other) const {
+    return id == other.id && flags == other.flags &&
+           timestamp == other.timestamp && position == other.position;
+  }
+  bool operator!=(const FixedLayoutMessage& other) const { return !(*this == other); }
+};
+
+template <typename Message>
+Message MakeMessage(size_t index) {
+  Message message;
+  message.id = index;
+  message.flags = 0x8000 | index;
+  message.timestamp = 1000000000LL * index;
+  message.position = {1.0f, 2.0f, 3.0f, 1.0f};
+  return message;
+}
+
 // Provide numpunct facet that formats numbers with ',' as thousands separators.
 class CommaNumPunct : public std::numpunct<char> {
  protected:
@@ -150,6 +194,27 @@ std::chrono::nanoseconds DeserializeTestRunner(
   return stop - start;
 }
 
+// Deserializes the serialized |value| into a BlobView, which refers to the
+// input buffer instead of copying the data out of it.
+template <typename T>
+std::chrono::nanoseconds DeserializeBlobViewTestRunner(
+    MessageReader* reader, MessageWriter* writer, size_t iterations,
+    ResetFunc* read_reset, ResetFunc* write_reset, void* reset_data,
+    const std::vector<T>& value) {
+  write_reset(reset_data);
+  Serialize(value, writer);
+  BlobView<T> output_data;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    read_reset(reset_data);
+    Deserialize(&output_data, reader);
+  }
+  auto stop = std::chrono::high_resolution_clock::now();
+  if (output_data.size() != value.size())
+    return start - stop;  // Return negative value to indicate error.
+  return stop - start;
+}
+
 // Special version of SerializeTestRunner that doesn't perform any serialization
 // but does all the same setup steps and moves data of size |data_size| into
 // the output buffer. Useful to determine the baseline to calculate time used
@@ -447,6 +512,35 @@ int main(int /*argc*/, char** /*argv*/) {
                         std::move(int_vector));
   }
 
+  // Messages with the same members, serialized member by member and as blobs.
+  test_runner.AddTest("SerializableMessage",
+                      MakeMessage<SerializableMessage>(1));
+  test_runner.AddTest("FixedLayoutMessage", MakeMessage<FixedLayoutMessage>(1));
+
+  for (size_t len : {1, 8, 64, 256}) {
+    std::vector<SerializableMessage> serializable_messages;
+    std::vector<FixedLayoutMessage> fixed_layout_messages;
+    for (size_t i = 0; i < len; i++) {
+      serializable_messages.push_back(MakeMessage<SerializableMessage>(i));
+      fixed_layout_messages.push_back(MakeMessage<FixedLayoutMessage>(i));
+    }
+    test_runner.AddTest(
+        GenerateContainerName("vector<SerializableMessage>", len),
+        std::move(serializable_messages));
+
+    const size_t data_size = GetSerializedSize(fixed_layout_messages);
+    auto deserialize_view_test =
+        std::bind(&DeserializeBlobViewTestRunner<FixedLayoutMessage>, _1, _2,
+                  _3, _4, _5, _6, fixed_layout_messages);
+    test_runner.AddTestFunc(
+        GenerateContainerName("BlobView<FixedLayoutMessage>", len), {},
+        std::move(deserialize_view_test), data_size);
+
+    test_runner.AddTest(
+        GenerateContainerName("vector<FixedLayoutMessage>", len),
+        std::move(fixed_layout_messages));
+  }
+
   std::vector<std::string> vector_of_strings = {
       "012345678901234567890123456789", "012345678901234567890123456789",
       "012345678901234567890123456789", "012345678901234567890123456789",
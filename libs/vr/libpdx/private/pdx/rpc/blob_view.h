@@ -0,0 +1,70 @@
+#ifndef ANDROID_PDX_RPC_BLOB_VIEW_H_
+#define ANDROID_PDX_RPC_BLOB_VIEW_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace android {
+namespace pdx {
+namespace rpc {
+
+// Read-only view of an array of trivially copyable values stored as raw bytes,
+// providing an interface suitable for SerializeObject and DeserializeObject.
+// This class serializes to the same BIN format as BufferWrapper and containers
+// of fixed-layout types.
+//
+// Deserializing into a BlobView does not copy the payload: the view refers to
+// the bytes in the receive buffer, and is only valid as long as the message
+// being read. The bytes are not necessarily aligned for T, so elements are
+// read by value rather than by reference.
+template <typename T>
+class BlobView {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "BlobView requires a trivially copyable type");
+
+ public:
+  typedef T value_type;
+  typedef std::size_t size_type;
+
+  BlobView() : data_(nullptr), size_(0) {}
+  BlobView(const void* data, size_type size) : data_(data), size_(size) {}
+  explicit BlobView(const std::vector<T>& vector)
+      : BlobView(vector.data(), vector.size()) {}
+
+  const void* data() const { return data_; }
+  size_type size() const { return size_; }
+  size_type size_bytes() const { return size_ * sizeof(T); }
+  bool empty() const { return size_ == 0; }
+
+  T operator[](size_type index) const {
+    T value;
+    memcpy(&value, static_cast<const std::uint8_t*>(data_) + index * sizeof(T),
+           sizeof(T));
+    return value;
+  }
+
+  // Copies the elements into |dest|, which must hold at least size() elements.
+  void CopyTo(T* dest) const {
+    if (size_ > 0)
+      memcpy(dest, data_, size_bytes());
+  }
+
+  std::vector<T> ToVector() const {
+    std::vector<T> result(size_);
+    CopyTo(result.data());
+    return result;
+  }
+
+ private:
+  const void* data_;
+  size_type size_;
+};
+
+}  // namespace rpc
+}  // namespace pdx
+}  // namespace android
+
+#endif  // ANDROID_PDX_RPC_BLOB_VIEW_H_
@@ -1,6 +1,7 @@
 #ifndef ANDROID_PDX_RPC_SERIALIZATION_H_
 #define ANDROID_PDX_RPC_SERIALIZATION_H_
 
+#include <array>
 #include <cstdint>
 #include <cstring>
 #include <iterator>
@@ -22,6 +23,7 @@
 #include <pdx/utility.h>
 
 #include "array_wrapper.h"
+#include "blob_view.h"
 #include "default_initialization_allocator.h"
 #include "encoding.h"
 #include "pointer_wrapper.h"
@@ -59,6 +61,14 @@ namespace rpc {
 //   * BufferWrapper of any POD type.
 //   * StringWrapper of any supported char type.
 //   * User types with correctly defined SerializableMembers member type.
+//   * Fixed-layout types: trivially copyable, standard layout structs/classes
+//     without SerializableMembers. These, and std::vector, std::array, and
+//     ArrayWrapper of them, are encoded as a single BIN blob of raw bytes.
+//   * BlobView of any trivially copyable type, which deserializes a BIN blob
+//     without copying it out of the receive buffer.
+//
+// Fixed-layout types are copied as is between processes, so they must have the
+// same layout on every ABI: use fixed width members and explicit padding.
 //
 // Planned support for:
 //   * std::basic_string with all supported char types.
@@ -111,6 +121,34 @@ template <typename T, typename ReturnType = void>
 using EnableIfEnum =
     typename std::enable_if<std::is_enum<T>::value, ReturnType>::type;
 
+// Determines whether type T is serialized as a blob of its bytes, rather than
+// member by member.
+template <typename T>
+struct IsFixedLayout
+    : std::integral_constant<bool, std::is_class<T>::value &&
+                                       std::is_trivially_copyable<T>::value &&
+                                       std::is_standard_layout<T>::value &&
+                                       !HasSerializableMembers<T>::value> {};
+
+// Trivially copyable library types with their own encoding.
+template <typename T, std::size_t Size>
+struct IsFixedLayout<std::array<T, Size>> : std::false_type {};
+template <typename T, typename U>
+struct IsFixedLayout<std::pair<T, U>> : std::false_type {};
+template <typename... T>
+struct IsFixedLayout<std::tuple<T...>> : std::false_type {};
+template <typename T>
+struct IsFixedLayout<PointerWrapper<T>> : std::false_type {};
+template <typename T>
+struct IsFixedLayout<BlobView<T>> : std::false_type {};
+template <>
+struct IsFixedLayout<EmptyVariant> : std::false_type {};
+
+// Utility to simplify overload enable expressions for fixed-layout types.
+template <typename T, typename ReturnType = void>
+using EnableIfFixedLayout =
+    typename std::enable_if<IsFixedLayout<T>::value, ReturnType>::type;
+
 ///////////////////////////////////////////////////////////////////////////////
 // Error Reporting //
 ///////////////////////////////////////////////////////////////////////////////
@@ -245,6 +283,18 @@ inline EnableIfEnum<T, std::size_t> GetSerializedSize(T v) {
   return GetSerializedSize(static_cast<std::underlying_type_t<T>>(v));
 }
 
+// Gets the size of a BIN blob of |size| bytes.
+inline constexpr std::size_t GetBlobSize(std::size_t size) {
+  return GetEncodingSize(EncodeBinType(size)) + size;
+}
+
+// Overload for fixed-layout types.
+template <typename T>
+inline constexpr EnableIfFixedLayout<T, std::size_t> GetSerializedSize(
+    const T& /*value*/) {
+  return GetBlobSize(sizeof(T));
+}
+
 // Forward declaration for nested definitions.
 inline std::size_t GetSerializedSize(const EmptyVariant&);
 template <typename... Types>
@@ -258,6 +308,8 @@ template <typename T>
 inline constexpr std::size_t GetSerializedSize(const StringWrapper<T>&);
 template <typename T>
 inline constexpr std::size_t GetSerializedSize(const BufferWrapper<T>&);
+template <typename T>
+inline constexpr std::size_t GetSerializedSize(const BlobView<T>&);
 template <FileHandleMode Mode>
 inline constexpr std::size_t GetSerializedSize(const FileHandle<Mode>&);
 template <ChannelHandleMode Mode>
@@ -326,6 +378,12 @@ inline constexpr std::size_t GetSerializedSize(const BufferWrapper<T>& b) {
          b.size() * sizeof(typename BufferWrapper<T>::value_type);
 }
 
+// Overload for BlobView types.
+template <typename T>
+inline constexpr std::size_t GetSerializedSize(const BlobView<T>& b) {
+  return GetBlobSize(b.size_bytes());
+}
+
 // Overload for FileHandle. FileHandle is encoded as a FIXEXT2, with a type code
 // of "FileHandle" and a signed 16-bit offset into the pushed fd array. Empty
 // FileHandles are encoded with an array index of -1.
@@ -346,6 +404,8 @@ inline constexpr std::size_t GetSerializedSize(
 // Overload for standard vector types.
 template <typename T, typename Allocator>
 inline std::size_t GetSerializedSize(const std::vector<T, Allocator>& v) {
+  if constexpr (IsFixedLayout<T>::value)
+    return GetBlobSize(v.size() * sizeof(T));
   return std::accumulate(v.begin(), v.end(), GetEncodingSize(EncodeType(v)),
                          [](const std::size_t& sum, const T& object) {
                            return sum + GetSerializedSize(object);
@@ -380,6 +440,8 @@ inline std::size_t GetSerializedSize(
 // Overload for ArrayWrapper types.
 template <typename T>
 inline std::size_t GetSerializedSize(const ArrayWrapper<T>& v) {
+  if constexpr (IsFixedLayout<T>::value)
+    return GetBlobSize(v.size() * sizeof(T));
   return std::accumulate(v.begin(), v.end(), GetEncodingSize(EncodeType(v)),
                          [](const std::size_t& sum, const T& object) {
                            return sum + GetSerializedSize(object);
@@ -389,6 +451,8 @@ inline std::size_t GetSerializedSize(const ArrayWrapper<T>& v) {
 // Overload for std::array types.
 template <typename T, std::size_t Size>
 inline std::size_t GetSerializedSize(const std::array<T, Size>& v) {
+  if constexpr (IsFixedLayout<T>::value)
+    return GetBlobSize(Size * sizeof(T));
   return std::accumulate(v.begin(), v.end(), GetEncodingSize(EncodeType(v)),
                          [](const std::size_t& sum, const T& object) {
                            return sum + GetSerializedSize(object);
@@ -565,6 +629,13 @@ inline void SerializeBinEncoding(EncodingType encoding, std::size_t size,
   }
 }
 
+// Serializes |size| bytes as a BIN blob.
+inline void SerializeBlob(const void* data, std::size_t size, void*& buffer) {
+  SerializeBinEncoding(EncodeBinType(size), size, buffer);
+  if (size > 0)
+    WriteRawData(buffer, data, size);
+}
+
 // Serializes the type code for BufferWrapper types.
 template <typename T>
 inline void SerializeType(const BufferWrapper<T>& value, void*& buffer) {
@@ -834,6 +905,14 @@ inline EnableIfEnum<T> SerializeObject(const T& value, MessageWriter* writer,
                   buffer);
 }
 
+// Serialize fixed-layout types.
+template <typename T>
+inline EnableIfFixedLayout<T> SerializeObject(const T& value,
+                                              MessageWriter* /*writer*/,
+                                              void*& buffer) {
+  SerializeBlob(&value, sizeof(T), buffer);
+}
+
 // Forward declaration for nested definitions.
 inline void SerializeObject(const EmptyVariant&, MessageWriter*, void*&);
 template <typename... Types>
@@ -850,6 +929,8 @@ template <typename T, typename Allocator>
 inline void SerializeObject(const BufferWrapper<std::vector<T, Allocator>>&, MessageWriter*, void*&);
 template <typename T>
 inline void SerializeObject(const BufferWrapper<T*>&, MessageWriter*, void*&);
+template <typename T>
+inline void SerializeObject(const BlobView<T>&, MessageWriter*, void*&);
 inline void SerializeObject(const std::string&, MessageWriter*, void*&);
 template <typename T>
 inline void SerializeObject(const StringWrapper<T>&, MessageWriter*, void*&);
@@ -941,6 +1022,13 @@ inline void SerializeObject(const BufferWrapper<T*>& b,
   WriteRawData(buffer, b.data(), b.size() * value_type_size);
 }
 
+// Serializes the payload of BlobView types.
+template <typename T>
+inline void SerializeObject(const BlobView<T>& b, MessageWriter* /*writer*/,
+                            void*& buffer) {
+  SerializeBlob(b.data(), b.size_bytes(), buffer);
+}
+
 // Serializes the payload of string types.
 template <typename StringType>
 inline void SerializeString(const StringType& s, void*& buffer) {
@@ -961,10 +1049,16 @@ inline void SerializeObject(const StringWrapper<T>& s,
   SerializeString(s, buffer);
 }
 
-// Serializes the payload of array types.
+// Serializes the payload of array types. Arrays of fixed-layout types are
+// serialized as a single blob, rather than element by element.
 template <typename ArrayType>
 inline void SerializeArray(const ArrayType& v, MessageWriter* writer,
                            void*& buffer) {
+  using ValueType = typename ArrayType::value_type;
+  if constexpr (IsFixedLayout<ValueType>::value) {
+    SerializeBlob(v.data(), v.size() * sizeof(ValueType), buffer);
+    return;
+  }
   SerializeType(v, buffer);
   for (const auto& element : v)
     SerializeObject(element, writer, buffer);
@@ -1397,6 +1491,13 @@ inline ErrorType DeserializeObject(BufferWrapper<std::vector<T, Allocator>>*,
 template <typename T>
 inline ErrorType DeserializeObject(BufferWrapper<T*>*, MessageReader*,
                                    const void*&, const void*&);
+template <typename T>
+inline ErrorType DeserializeObject(BlobView<T>*, MessageReader*, const void*&,
+                                   const void*&);
+template <typename T>
+inline EnableIfFixedLayout<T, ErrorType> DeserializeObject(T*, MessageReader*,
+                                                           const void*&,
+                                                           const void*&);
 inline ErrorType DeserializeObject(std::string*, MessageReader*, const void*&,
                                    const void*&);
 template <typename T>
@@ -1609,6 +1710,85 @@ inline ErrorType DeserializeObject(BufferWrapper<T*>* value,
   }
 }
 
+// Deserializes a BIN blob of exactly |size| bytes into |dest|.
+inline ErrorType DeserializeBlob(void* dest, std::size_t size,
+                                 MessageReader* reader, const void*& start,
+                                 const void*& end) {
+  EncodingType encoding;
+  std::size_t blob_size;
+
+  if (const auto error =
+          DeserializeBinType(&encoding, &blob_size, reader, start, end)) {
+    return error;
+  } else if (blob_size != size) {
+    return ErrorType(ErrorCode::UNEXPECTED_TYPE_SIZE, ENCODING_CLASS_BINARY,
+                     encoding);
+  } else if (size == 0U) {
+    return ErrorCode::NO_ERROR;
+  } else {
+    return ReadRawData(dest, reader, start, end, size);
+  }
+}
+
+// Deserializes a BIN blob into a resizable array of fixed-layout types.
+template <typename ArrayType>
+inline ErrorType DeserializeBlobArray(ArrayType* value, MessageReader* reader,
+                                      const void*& start, const void*& end) {
+  const auto value_type_size = sizeof(typename ArrayType::value_type);
+  EncodingType encoding;
+  std::size_t size;
+
+  if (const auto error =
+          DeserializeBinType(&encoding, &size, reader, start, end))
+    return error;
+
+  if (size % value_type_size != 0) {
+    return ErrorType(ErrorCode::UNEXPECTED_TYPE_SIZE, ENCODING_CLASS_BINARY,
+                     encoding);
+  }
+
+  // Try to resize the array to the size of the payload.
+  value->resize(size / value_type_size);
+
+  if (size > value->size() * value_type_size) {
+    return ErrorCode::INSUFFICIENT_DESTINATION_SIZE;
+  } else if (size == 0U) {
+    return ErrorCode::NO_ERROR;
+  } else {
+    return ReadRawData(value->data(), reader, start, end, size);
+  }
+}
+
+// Overload of DeserializeObject() for fixed-layout types.
+template <typename T>
+inline EnableIfFixedLayout<T, ErrorType> DeserializeObject(
+    T* value, MessageReader* reader, const void*& start, const void*& end) {
+  return DeserializeBlob(value, sizeof(T), reader, start, end);
+}
+
+// Overload of DeserializeObject() for BlobView types. The view refers to the
+// payload in the receive buffer instead of copying it.
+template <typename T>
+inline ErrorType DeserializeObject(BlobView<T>* value, MessageReader* reader,
+                                   const void*& start, const void*& end) {
+  EncodingType encoding;
+  std::size_t size;
+
+  if (const auto error =
+          DeserializeBinType(&encoding, &size, reader, start, end)) {
+    return error;
+  } else if (size % sizeof(T) != 0) {
+    return ErrorType(ErrorCode::UNEXPECTED_TYPE_SIZE, ENCODING_CLASS_BINARY,
+                     encoding);
+  } else if (PDX_UNLIKELY(AdvancePointer(start, size) > end)) {
+    return ErrorCode::INSUFFICIENT_BUFFER;
+  } else {
+    *value = BlobView<T>(start, size / sizeof(T));
+    start = AdvancePointer(start, size);
+    return ErrorCode::NO_ERROR;
+  }
+}
+
 // Deserializes the type code and size for string types.
 inline ErrorType DeserializeStringType(EncodingType* encoding,
                                        std::size_t* size, MessageReader* reader,
@@ -1717,6 +1897,9 @@ template <typename T, typename Allocator>
 inline ErrorType DeserializeObject(std::vector<T, Allocator>* value,
                                    MessageReader* reader, const void*& start,
                                    const void*& end) {
+  if constexpr (IsFixedLayout<T>::value)
+    return DeserializeBlobArray(value, reader, start, end);
+
   EncodingType encoding;
   std::size_t size;
 
@@ -1841,6 +2024,9 @@ template <typename T>
 inline ErrorType DeserializeObject(ArrayWrapper<T>* value,
                                    MessageReader* reader, const void*& start,
                                    const void*& end) {
+  if constexpr (IsFixedLayout<T>::value)
+    return DeserializeBlobArray(value, reader, start, end);
+
   EncodingType encoding;
   std::size_t size;
 
@@ -1870,6 +2056,9 @@ template <typename T, std::size_t Size>
 inline ErrorType DeserializeObject(std::array<T, Size>* value,
                                    MessageReader* reader, const void*& start,
                                    const void*& end) {
+  if constexpr (IsFixedLayout<T>::value)
+    return DeserializeBlob(value->data(), Size * sizeof(T), reader, start, end);
+
   EncodingType encoding;
   std::size_t size;
 
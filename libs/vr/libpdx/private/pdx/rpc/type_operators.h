@@ -10,6 +10,7 @@
 #include <pdx/channel_handle.h>
 #include <pdx/file_handle.h>
 #include <pdx/rpc/array_wrapper.h>
+#include <pdx/rpc/blob_view.h>
 #include <pdx/rpc/buffer_wrapper.h>
 #include <pdx/rpc/copy_cv_reference.h>
 #include <pdx/rpc/pointer_wrapper.h>
@@ -44,7 +45,9 @@ struct And<A, B, Rest...> : And<A, And<B, Rest...>> {};
 //    5. BufferWrapper<T*> is convertible to BufferWrapper<std::vector<T,
 //    Any...>>.
 //    6. BufferWrapper<std::vector<T, ...>> is convertible to BufferWrapper<T*>.
-//    7. The value type T of A and B must match.
+//    7. BlobView<T> is convertible to BufferWrapper<T*> and
+//    BufferWrapper<std::vector<T, Any...>>, and vice versa.
+//    8. The value type T of A and B must match.
 
 // Compares A and B for convertibility. This base type determines convertibility
 // by equivalence of the underlying types of A and B. Specializations of this
@@ -146,6 +149,19 @@ template <typename A, typename B>
 struct IsConvertible<BufferWrapper<A*>, BufferWrapper<B*>>
     : IsEquivalent<A, B> {};
 
+// Compares BlobView<A> and BufferWrapper<B*> or BufferWrapper<std::vector<B>>;
+// these are convertible if A and B are equivalent.
+template <typename A, typename B>
+struct IsConvertible<BlobView<A>, BufferWrapper<B*>> : IsEquivalent<A, B> {};
+template <typename A, typename B>
+struct IsConvertible<BufferWrapper<A*>, BlobView<B>> : IsEquivalent<A, B> {};
+template <typename A, typename B, typename Allocator>
+struct IsConvertible<BlobView<A>, BufferWrapper<std::vector<B, Allocator>>>
+    : IsEquivalent<A, B> {};
+template <typename A, typename B, typename Allocator>
+struct IsConvertible<BufferWrapper<std::vector<A, Allocator>>, BlobView<B>>
+    : IsEquivalent<A, B> {};
+
 // Compares std::basic_string<A, ...> and StringWrapper<B>; these are
 // convertible if A and B are equivalent.
 template <typename A, typename B, typename... Any>
@@ -10,6 +10,7 @@
 #include <gtest/gtest.h>
 #include <pdx/rpc/argument_encoder.h>
 #include <pdx/rpc/array_wrapper.h>
+#include <pdx/rpc/blob_view.h>
 #include <pdx/rpc/default_initialization_allocator.h>
 #include <pdx/rpc/payload.h>
 #include <pdx/rpc/serializable.h>
@@ -80,6 +81,17 @@ struct TestTemplateType {
   PDX_SERIALIZABLE_MEMBERS(TestTemplateType<FileHandleType>, fd);
 };
 
+// Trivially copyable type without SerializableMembers, serialized as a blob.
+struct TestFixedLayoutType {
+  std::uint8_t a;
+  std::uint8_t b;
+  std::uint16_t c;
+
+  bool operator==(const TestFixedLayoutType& other) const {
+    return a == other.a && b == other.b && c == other.c;
+  }
+};
+
 // Utilities to generate test maps and payloads.
 template <typename MapType>
 MapType MakeMap(std::size_t size) {
@@ -1233,6 +1245,52 @@ TEST(SerializationTest, Serializable) {
   EXPECT_EQ(expected, result);
 }
 
+TEST(SerializationTest, FixedLayout) {
+  Payload result;
+  Payload expected;
+
+  TestFixedLayoutType value{1, 2, 0x0403};
+  Serialize(value, &result);
+  expected = {ENCODING_TYPE_BIN8, 4, 1, 2, 3, 4};
+  EXPECT_EQ(expected, result);
+  result.Clear();
+
+  // Arrays of fixed-layout types are a single blob.
+  std::vector<TestFixedLayoutType> vector{{1, 2, 0x0403}, {5, 6, 0x0807}};
+  Serialize(vector, &result);
+  expected = {ENCODING_TYPE_BIN8, 8, 1, 2, 3, 4, 5, 6, 7, 8};
+  EXPECT_EQ(expected, result);
+  result.Clear();
+
+  ArrayWrapper<TestFixedLayoutType> wrapper(vector.data(), vector.size());
+  Serialize(wrapper, &result);
+  EXPECT_EQ(expected, result);
+  result.Clear();
+
+  std::array<TestFixedLayoutType, 2> array{{{1, 2, 0x0403}, {5, 6, 0x0807}}};
+  Serialize(array, &result);
+  EXPECT_EQ(expected, result);
+  result.Clear();
+
+  BlobView<TestFixedLayoutType> view(vector);
+  Serialize(view, &result);
+  EXPECT_EQ(expected, result);
+  result.Clear();
+
+  vector.clear();
+  Serialize(vector, &result);
+  expected = {ENCODING_TYPE_BIN8, 0};
+  EXPECT_EQ(expected, result);
+  result.Clear();
+
+  // Arrays of primitive types keep their element by element encoding.
+  std::vector<std::uint16_t> primitives{1, 2};
+  Serialize(primitives, &result);
+  expected = {ENCODING_TYPE_FIXARRAY_MIN + 2, 1, 2};
+  EXPECT_EQ(expected, result);
+  result.Clear();
+}
+
 TEST(SerializationTest, Variant) {
   Payload result;
   Payload expected;
@@ -2365,6 +2423,95 @@ TEST(DeserializationTest, Serializable) {
   EXPECT_EQ(TestTemplateType<LocalHandle>(LocalHandle(-1)), tt);
 }
 
+TEST(DeserializationTest, FixedLayout) {
+  Payload buffer;
+  ErrorType error;
+
+  TestFixedLayoutType value;
+  buffer = {ENCODING_TYPE_BIN8, 4, 1, 2, 3, 4};
+  error = Deserialize(&value, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ((TestFixedLayoutType{1, 2, 0x0403}), value);
+
+  buffer = {ENCODING_TYPE_BIN8, 3, 1, 2, 3};
+  error = Deserialize(&value, &buffer);
+  EXPECT_EQ(ErrorCode::UNEXPECTED_TYPE_SIZE, error);
+
+  const std::vector<TestFixedLayoutType> expected{{1, 2, 0x0403},
+                                                  {5, 6, 0x0807}};
+  buffer = {ENCODING_TYPE_BIN8, 8, 1, 2, 3, 4, 5, 6, 7, 8};
+
+  std::vector<TestFixedLayoutType> vector;
+  error = Deserialize(&vector, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(expected, vector);
+
+  buffer.Rewind();
+  std::array<TestFixedLayoutType, 2> array;
+  error = Deserialize(&array, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(expected[0], array[0]);
+  EXPECT_EQ(expected[1], array[1]);
+
+  buffer.Rewind();
+  TestFixedLayoutType storage[2];
+  ArrayWrapper<TestFixedLayoutType> wrapper(storage, 2, 0);
+  error = Deserialize(&wrapper, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  ASSERT_EQ(2u, wrapper.size());
+  EXPECT_EQ(expected[1], wrapper[1]);
+
+  buffer.Rewind();
+  std::array<TestFixedLayoutType, 3> wrong_size_array;
+  error = Deserialize(&wrong_size_array, &buffer);
+  EXPECT_EQ(ErrorCode::UNEXPECTED_TYPE_SIZE, error);
+
+  buffer = {ENCODING_TYPE_BIN8, 6, 1, 2, 3, 4, 5, 6};
+  error = Deserialize(&vector, &buffer);
+  EXPECT_EQ(ErrorCode::UNEXPECTED_TYPE_SIZE, error);
+}
+
+TEST(DeserializationTest, BlobView) {
+  Payload buffer;
+  ErrorType error;
+  BlobView<TestFixedLayoutType> view;
+
+  buffer = {ENCODING_TYPE_BIN8, 8, 1, 2, 3, 4, 5, 6, 7, 8};
+  error = Deserialize(&view, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  // The view refers to the payload instead of a copy.
+  EXPECT_EQ(buffer.Data() + 2, view.data());
+  ASSERT_EQ(2u, view.size());
+  EXPECT_EQ((TestFixedLayoutType{1, 2, 0x0403}), view[0]);
+  EXPECT_EQ((TestFixedLayoutType{5, 6, 0x0807}), view[1]);
+
+  // A view of a BufferWrapper payload.
+  BlobView<std::uint16_t> primitives;
+  buffer.Rewind();
+  error = Deserialize(&primitives, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ((std::vector<std::uint16_t>{0x0201, 0x0403, 0x0605, 0x0807}),
+            primitives.ToVector());
+
+  buffer = {ENCODING_TYPE_BIN8, 0};
+  error = Deserialize(&view, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_TRUE(view.empty());
+
+  buffer = {ENCODING_TYPE_BIN8, 8, 1, 2, 3, 4};
+  error = Deserialize(&view, &buffer);
+  EXPECT_EQ(ErrorCode::INSUFFICIENT_BUFFER, error);
+
+  buffer = {ENCODING_TYPE_BIN8, 3, 1, 2, 3};
+  error = Deserialize(&view, &buffer);
+  EXPECT_EQ(ErrorCode::UNEXPECTED_TYPE_SIZE, error);
+
+  buffer = {ENCODING_TYPE_FIXARRAY_MIN};
+  error = Deserialize(&view, &buffer);
+  EXPECT_EQ(ErrorCode::UNEXPECTED_ENCODING, error);
+  EXPECT_EQ(ENCODING_CLASS_BINARY, error.encoding_class());
+}
+
 TEST(DeserializationTest, Variant) {
   Payload buffer;
   ErrorType error;
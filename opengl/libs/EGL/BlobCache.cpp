@@ -25,8 +25,6 @@
 #include <log/log.h>
 #include <utils/Trace.h>
 
-#include <chrono>
-
 namespace android {
 
 // BlobCache::Header::mMagicNumber value
@@ -42,17 +40,7 @@ BlobCache::BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize
       : mMaxTotalSize(maxTotalSize),
         mMaxKeySize(maxKeySize),
         mMaxValueSize(maxValueSize),
-        mTotalSize(0) {
-    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
-#ifdef _WIN32
-    srand(now);
-#else
-    mRandState[0] = (now >> 0) & 0xFFFF;
-    mRandState[1] = (now >> 16) & 0xFFFF;
-    mRandState[2] = (now >> 32) & 0xFFFF;
-#endif
-    ALOGV("initializing random seed using %lld", (unsigned long long)now);
-}
+        mTotalSize(0) {}
 
 BlobCache::InsertResult BlobCache::set(const void* key, size_t keySize, const void* value,
                                        size_t valueSize) {
@@ -81,59 +69,42 @@ BlobCache::InsertResult BlobCache::set(const void* key, size_t keySize, const vo
         return InsertResult::kInvalidValueSize;
     }
 
-    std::shared_ptr<Blob> cacheKey(new Blob(key, keySize, false));
-    CacheEntry cacheEntry(cacheKey, nullptr);
+    const std::string_view cacheKey(static_cast<const char*>(key), keySize);
 
     bool didClean = false;
     while (true) {
-        auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), cacheEntry);
-        if (index == mCacheEntries.end() || cacheEntry < *index) {
-            // Create a new cache entry.
-            std::shared_ptr<Blob> keyBlob(new Blob(key, keySize, true));
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
-            size_t newTotalSize = mTotalSize + keySize + valueSize;
-            if (mMaxTotalSize < newTotalSize) {
-                if (isCleanable()) {
-                    // Clean the cache and try again.
-                    clean();
-                    didClean = true;
-                    continue;
-                } else {
-                    ALOGV("set: not caching new key/value pair because the "
-                          "total cache size limit would be exceeded: %zu "
-                          "(limit: %zu)",
-                          keySize + valueSize, mMaxTotalSize);
-                    return InsertResult::kNotEnoughSpace;
-                }
-            }
-            mCacheEntries.insert(index, CacheEntry(keyBlob, valueBlob));
-            mTotalSize = newTotalSize;
-            ALOGV("set: created new cache entry with %zu byte key and %zu byte value", keySize,
-                  valueSize);
-        } else {
-            // Update the existing cache entry.
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
-            std::shared_ptr<Blob> oldValueBlob(index->getValue());
-            size_t newTotalSize = mTotalSize + valueSize - oldValueBlob->getSize();
-            if (mMaxTotalSize < newTotalSize) {
-                if (isCleanable()) {
-                    // Clean the cache and try again.
-                    clean();
-                    didClean = true;
-                    continue;
-                } else {
-                    ALOGV("set: not caching new value because the total cache "
-                          "size limit would be exceeded: %zu (limit: %zu)",
-                          keySize + valueSize, mMaxTotalSize);
-                    return InsertResult::kNotEnoughSpace;
-                }
+        auto index = mCacheIndex.find(cacheKey);
+        const bool exists = index != mCacheIndex.end();
+        size_t newTotalSize = mTotalSize + keySize + valueSize;
+        if (exists) {
+            newTotalSize -= index->second->getSize();
+        }
+        if (mMaxTotalSize < newTotalSize) {
+            if (isCleanable()) {
+                // Clean the cache and try again.
+                clean();
+                didClean = true;
+                continue;
+            } else {
+                ALOGV("set: not caching new key/value pair because the "
+                      "total cache size limit would be exceeded: %zu "
+                      "(limit: %zu)",
+                      keySize + valueSize, mMaxTotalSize);
+                return InsertResult::kNotEnoughSpace;
             }
-            index->setValue(valueBlob);
-            mTotalSize = newTotalSize;
-            ALOGV("set: updated existing cache entry with %zu byte key and %zu byte "
-                  "value",
-                  keySize, valueSize);
         }
+        if (exists) {
+            // Replace the existing cache entry. The index refers to the key
+            // stored in the entry, so drop it first.
+            auto entry = index->second;
+            mCacheIndex.erase(index);
+            mCacheEntries.erase(entry);
+        }
+        mCacheEntries.emplace_front(key, keySize, value, valueSize);
+        mCacheIndex.emplace(mCacheEntries.front().getKey(), mCacheEntries.begin());
+        mTotalSize = newTotalSize;
+        ALOGV("set: %s cache entry with %zu byte key and %zu byte value",
+              exists ? "updated existing" : "created new", keySize, valueSize);
         return didClean ? InsertResult::kDidClean : InsertResult::kInserted;
     }
 }
@@ -144,21 +115,20 @@ size_t BlobCache::get(const void* key, size_t keySize, void* value, size_t value
               mMaxKeySize);
         return 0;
     }
-    std::shared_ptr<Blob> cacheKey(new Blob(key, keySize, false));
-    CacheEntry cacheEntry(cacheKey, nullptr);
-    auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), cacheEntry);
-    if (index == mCacheEntries.end() || cacheEntry < *index) {
+    auto index = mCacheIndex.find(std::string_view(static_cast<const char*>(key), keySize));
+    if (index == mCacheIndex.end()) {
         ALOGV("get: no cache entry found for key of size %zu", keySize);
         return 0;
     }
 
-    // The key was found. Return the value if the caller's buffer is large
-    // enough.
-    std::shared_ptr<Blob> valueBlob(index->getValue());
-    size_t valueBlobSize = valueBlob->getSize();
+    // The key was found. Mark the entry as the most recently used one and
+    // return the value if the caller's buffer is large enough.
+    mCacheEntries.splice(mCacheEntries.begin(), mCacheEntries, index->second);
+    const CacheEntry& entry = *index->second;
+    size_t valueBlobSize = entry.getValueSize();
     if (valueBlobSize <= valueSize) {
         ALOGV("get: copying %zu bytes to caller's buffer", valueBlobSize);
-        memcpy(value, valueBlob->getData(), valueBlobSize);
+        memcpy(value, entry.getValueData(), valueBlobSize);
     } else {
         ALOGV("get: caller's buffer is too small for value: %zu (needs %zu)", valueSize,
               valueBlobSize);
@@ -174,9 +144,7 @@ size_t BlobCache::getFlattenedSize() const {
     auto buildId = base::GetProperty("ro.build.id", "");
     size_t size = align4(sizeof(Header) + buildId.size());
     for (const CacheEntry& e : mCacheEntries) {
-        std::shared_ptr<Blob> const& keyBlob = e.getKey();
-        std::shared_ptr<Blob> const& valueBlob = e.getValue();
-        size += align4(sizeof(EntryHeader) + keyBlob->getSize() + valueBlob->getSize());
+        size += align4(sizeof(EntryHeader) + e.getSize());
     }
     return size;
 }
@@ -196,14 +164,13 @@ int BlobCache::flatten(void* buffer, size_t size) const {
     header->mBuildIdLength = buildId.size();
     memcpy(header->mBuildId, buildId.c_str(), header->mBuildIdLength);
 
-    // Write cache entries
+    // Write cache entries, least recently used first
     uint8_t* byteBuffer = reinterpret_cast<uint8_t*>(buffer);
     off_t byteOffset = align4(sizeof(Header) + header->mBuildIdLength);
-    for (const CacheEntry& e : mCacheEntries) {
-        std::shared_ptr<Blob> const& keyBlob = e.getKey();
-        std::shared_ptr<Blob> const& valueBlob = e.getValue();
-        size_t keySize = keyBlob->getSize();
-        size_t valueSize = valueBlob->getSize();
+    for (auto it = mCacheEntries.rbegin(); it != mCacheEntries.rend(); ++it) {
+        const CacheEntry& e = *it;
+        size_t keySize = e.getKeySize();
+        size_t valueSize = e.getValueSize();
 
         size_t entrySize = sizeof(EntryHeader) + keySize + valueSize;
         size_t totalSize = align4(entrySize);
@@ -216,8 +183,8 @@ int BlobCache::flatten(void* buffer, size_t size) const {
         eheader->mKeySize = keySize;
         eheader->mValueSize = valueSize;
 
-        memcpy(eheader->mData, keyBlob->getData(), keySize);
-        memcpy(eheader->mData + keySize, valueBlob->getData(), valueSize);
+        memcpy(eheader->mData, e.getKeyData(), keySize);
+        memcpy(eheader->mData + keySize, e.getValueData(), valueSize);
 
         if (totalSize > entrySize) {
             // We have padding bytes. Those will get written to storage, and contribute to the CRC,
@@ -288,88 +255,40 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
     return 0;
 }
 
-long int BlobCache::blob_random() {
-#ifdef _WIN32
-    return rand();
-#else
-    return nrand48(mRandState);
-#endif
-}
-
 void BlobCache::clean() {
     ATRACE_NAME("BlobCache::clean");
 
-    // Remove a random cache entry until the total cache size gets below half
-    // the maximum total cache size.
+    // Remove the least recently used cache entry until the total cache size
+    // gets below half the maximum total cache size.
     while (mTotalSize > mMaxTotalSize / 2) {
-        size_t i = size_t(blob_random() % (mCacheEntries.size()));
-        const CacheEntry& entry(mCacheEntries[i]);
-        mTotalSize -= entry.getKey()->getSize() + entry.getValue()->getSize();
-        mCacheEntries.erase(mCacheEntries.begin() + i);
-    }
-}
-
-bool BlobCache::isCleanable() const {
-    return mTotalSize > mMaxTotalSize / 2;
-}
-
-BlobCache::Blob::Blob(const void* data, size_t size, bool copyData)
-      : mData(copyData ? malloc(size) : data), mSize(size), mOwnsData(copyData) {
-    if (data != nullptr && copyData) {
-        memcpy(const_cast<void*>(mData), data, size);
-    }
-}
-
-BlobCache::Blob::~Blob() {
-    if (mOwnsData) {
-        free(const_cast<void*>(mData));
+        const CacheEntry& entry = mCacheEntries.back();
+        mTotalSize -= entry.getSize();
+        mCacheIndex.erase(entry.getKey());
+        mCacheEntries.pop_back();
     }
 }
 
-bool BlobCache::Blob::operator<(const Blob& rhs) const {
-    if (mSize == rhs.mSize) {
-        return memcmp(mData, rhs.mData, mSize) < 0;
-    } else {
-        return mSize < rhs.mSize;
+void BlobCache::forEachEntry(const std::function<void(const void* key, size_t keySize,
+                                                     const void* value, size_t valueSize)>& fn)
+        const {
+    for (auto it = mCacheEntries.rbegin(); it != mCacheEntries.rend(); ++it) {
+        fn(it->getKeyData(), it->getKeySize(), it->getValueData(), it->getValueSize());
     }
 }
 
-const void* BlobCache::Blob::getData() const {
-    return mData;
-}
-
-size_t BlobCache::Blob::getSize() const {
-    return mSize;
-}
-
-BlobCache::CacheEntry::CacheEntry() {}
-
-BlobCache::CacheEntry::CacheEntry(const std::shared_ptr<Blob>& key,
-                                  const std::shared_ptr<Blob>& value)
-      : mKey(key), mValue(value) {}
-
-BlobCache::CacheEntry::CacheEntry(const CacheEntry& ce) : mKey(ce.mKey), mValue(ce.mValue) {}
-
-bool BlobCache::CacheEntry::operator<(const CacheEntry& rhs) const {
-    return *mKey < *rhs.mKey;
-}
-
-const BlobCache::CacheEntry& BlobCache::CacheEntry::operator=(const CacheEntry& rhs) {
-    mKey = rhs.mKey;
-    mValue = rhs.mValue;
-    return *this;
-}
-
-std::shared_ptr<BlobCache::Blob> BlobCache::CacheEntry::getKey() const {
-    return mKey;
+bool BlobCache::isCleanable() const {
+    return mTotalSize > mMaxTotalSize / 2;
 }
 
-std::shared_ptr<BlobCache::Blob> BlobCache::CacheEntry::getValue() const {
-    return mValue;
+BlobCache::CacheEntry::CacheEntry(const void* key, size_t keySize, const void* value,
+                                  size_t valueSize)
+      : mData(new uint8_t[keySize + valueSize]), mKeySize(keySize), mValueSize(valueSize) {
+    memcpy(mData.get(), key, keySize);
+    memcpy(mData.get() + keySize, value, valueSize);
 }
 
-void BlobCache::CacheEntry::setValue(const std::shared_ptr<Blob>& value) {
-    mValue = value;
+std::string_view BlobCache::CacheEntry::getKey() const {
+    return std::string_view(reinterpret_cast<const char*>(mData.get()), mKeySize);
 }
 
 } // namespace android
@@ -19,14 +19,21 @@
 
 #include <stddef.h>
 
+#include <functional>
+#include <list>
 #include <memory>
-#include <vector>
+#include <string_view>
+#include <unordered_map>
 
 namespace android {
 
 // A BlobCache is an in-memory cache for binary key/value pairs.  A BlobCache
 // does NOT provide any thread-safety guarantees.
 //
+// Entries are indexed by a hash of their key and kept in least recently used
+// order, so that lookups and insertions take constant time and eviction drops
+// the entries that have gone unused the longest.
+//
 // The cache contents can be serialized to an in-memory buffer or mmap'd file
 // and then reloaded in a subsequent execution of the program.  This
 // serialization is non-portable and the data should only be used by the device
@@ -39,6 +46,8 @@ public:
     // (key sizes plus value sizes) will not exceed maxTotalSize.
     BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize);
 
+    virtual ~BlobCache() = default;
+
     // Return value from set(), below.
     enum class InsertResult {
         // The key is larger than maxKeySize specified in the constructor.
@@ -67,14 +76,15 @@ public:
     // put in the cache (based on the maxKeySize, maxValueSize, and maxTotalSize
     // values specified to the BlobCache constructor), then the key/value pair
     // will be in the cache after set returns.  Note, however, that a subsequent
-    // call to set may evict old key/value pairs from the cache.
+    // call to set may evict old key/value pairs from the cache, starting with
+    // the least recently used ones.
     //
     // Preconditions:
     //   key != NULL
     //   0 < keySize
     //   value != NULL
     //   0 < valueSize
-    InsertResult set(const void* key, size_t keySize, const void* value, size_t valueSize);
+    virtual InsertResult set(const void* key, size_t keySize, const void* value, size_t valueSize);
 
     // get retrieves from the cache the binary value associated with a given
     // binary key.  If the key is present in the cache then the length of the
@@ -82,7 +92,8 @@ public:
     // is non-NULL and the size of the cached value is less than valueSize bytes
     // then the cached value is copied into the buffer pointed to by the value
     // argument.  If the key is not present in the cache then 0 is returned and
-    // the buffer pointed to by the value argument is not modified.
+    // the buffer pointed to by the value argument is not modified.  A
+    // successful lookup marks the entry as the most recently used one.
     //
     // Note that when calling get multiple times with the same key, the later
     // calls may fail, returning 0, even if earlier calls succeeded.  The return
@@ -92,7 +103,7 @@ public:
     //   key != NULL
     //   0 < keySize
     //   0 <= valueSize
-    size_t get(const void* key, size_t keySize, void* value, size_t valueSize);
+    virtual size_t get(const void* key, size_t keySize, void* value, size_t valueSize);
 
     // getFlattenedSize returns the number of bytes needed to store the entire
     // serialized cache.
@@ -101,7 +112,8 @@ public:
     // flatten serializes the current contents of the cache into the memory
     // pointed to by 'buffer'.  The serialized cache contents can later be
     // loaded into a BlobCache object using the unflatten method.  The contents
-    // of the BlobCache object will not be modified.
+    // of the BlobCache object will not be modified.  Entries are written from
+    // least to most recently used so that unflatten restores their order.
     //
     // Preconditions:
     //   size >= this.getFlattenedSize()
@@ -118,11 +130,22 @@ public:
     // clear flushes out all contents of the cache then the BlobCache, leaving
     // it in an empty state.
     void clear() {
+        mCacheIndex.clear();
         mCacheEntries.clear();
         mTotalSize = 0;
     }
 
 protected:
+    // getTotalSize returns the combined size of all keys and values currently
+    // in the cache.
+    size_t getTotalSize() const { return mTotalSize; }
+
+    // forEachEntry calls fn with the key and value of every entry in the
+    // cache, from least to most recently used.  The cache must not be modified
+    // from within fn.
+    void forEachEntry(const std::function<void(const void* key, size_t keySize, const void* value,
+                                               size_t valueSize)>& fn) const;
+
     // mMaxTotalSize is the maximum size that all cache entries can occupy. This
     // includes space for both keys and values. When a call to BlobCache::set
     // would otherwise cause this limit to be exceeded, either the key/value
@@ -135,10 +158,7 @@ private:
     BlobCache(const BlobCache&);
     void operator=(const BlobCache&);
 
-    // A random function helper to get around MinGW not having nrand48()
-    long int blob_random();
-
-    // clean evicts a randomly chosen set of entries from the cache such that
+    // clean evicts the least recently used entries from the cache such that
     // the total size of all remaining entries is less than mMaxTotalSize/2.
     void clean();
 
@@ -146,54 +166,33 @@ private:
     // to have some effect, and false otherwise.
     bool isCleanable() const;
 
-    // A Blob is an immutable sized unstructured data blob.
-    class Blob {
-    public:
-        Blob(const void* data, size_t size, bool copyData);
-        ~Blob();
-
-        bool operator<(const Blob& rhs) const;
-
-        const void* getData() const;
-        size_t getSize() const;
-
-    private:
-        // Copying is not allowed.
-        Blob(const Blob&);
-        void operator=(const Blob&);
-
-        // mData points to the buffer containing the blob data.
-        const void* mData;
-
-        // mSize is the size of the blob data in bytes.
-        size_t mSize;
-
-        // mOwnsData indicates whether or not this Blob object should free the
-        // memory pointed to by mData when the Blob gets destructed.
-        bool mOwnsData;
-    };
-
-    // A CacheEntry is a single key/value pair in the cache.
+    // A CacheEntry is a single key/value pair in the cache. The key and value
+    // are stored back to back in a single buffer owned by the entry.
     class CacheEntry {
     public:
-        CacheEntry();
-        CacheEntry(const std::shared_ptr<Blob>& key, const std::shared_ptr<Blob>& value);
-        CacheEntry(const CacheEntry& ce);
+        CacheEntry(const void* key, size_t keySize, const void* value, size_t valueSize);
 
-        bool operator<(const CacheEntry& rhs) const;
-        const CacheEntry& operator=(const CacheEntry&);
+        // getKey returns a view of the key bytes, which stays valid for the
+        // lifetime of the entry.
+        std::string_view getKey() const;
 
-        std::shared_ptr<Blob> getKey() const;
-        std::shared_ptr<Blob> getValue() const;
+        const uint8_t* getKeyData() const { return mData.get(); }
+        size_t getKeySize() const { return mKeySize; }
+        const uint8_t* getValueData() const { return mData.get() + mKeySize; }
+        size_t getValueSize() const { return mValueSize; }
 
-        void setValue(const std::shared_ptr<Blob>& value);
+        // getSize returns the combined size of the key and the value.
+        size_t getSize() const { return mKeySize + mValueSize; }
 
     private:
-        // mKey is the key that identifies the cache entry.
-        std::shared_ptr<Blob> mKey;
+        // mData contains the key followed immediately by the value.
+        std::unique_ptr<uint8_t[]> mData;
+
+        // mKeySize is the size of the key in bytes.
+        size_t mKeySize;
 
-        // mValue is the cached data associated with the key.
-        std::shared_ptr<Blob> mValue;
+        // mValueSize is the size of the value in bytes.
+        size_t mValueSize;
     };
 
     // A Header is the header for the entire BlobCache serialization format. No
@@ -256,13 +255,15 @@ private:
     // the cache.
     size_t mTotalSize;
 
-    // mRandState is the pseudo-random number generator state. It is passed to
-    // nrand48 to generate random numbers when needed.
-    unsigned short mRandState[3];
+    // mCacheEntries stores all the cache entries that are resident in memory,
+    // ordered from most to least recently used. Cache entries are added to the
+    // front by the 'set' method and moved back there by the 'get' method.
+    std::list<CacheEntry> mCacheEntries;
 
-    // mCacheEntries stores all the cache entries that are resident in memory.
-    // Cache entries are added to it by the 'set' method.
-    std::vector<CacheEntry> mCacheEntries;
+    // mCacheIndex maps the key of every entry in mCacheEntries to that entry.
+    // The keys are views into the entries themselves, so an entry must be
+    // removed from the index before it is erased from mCacheEntries.
+    std::unordered_map<std::string_view, std::list<CacheEntry>::iterator> mCacheIndex;
 };
 
 } // namespace android
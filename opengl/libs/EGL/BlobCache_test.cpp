@@ -294,6 +294,53 @@ TEST_F(BlobCacheTest, ExceedingTotalLimitHalvesCacheSize) {
     ASSERT_EQ(maxEntries / 2 + 1, numCached);
 }
 
+TEST_F(BlobCacheTest, ExceedingTotalLimitEvictsLeastRecentlyUsed) {
+    // Fill up the entire cache with 1 char key/value pairs.
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set(&k, 1, "x", 1));
+    }
+    // Use the oldest half of the entries so that the newer ones become the
+    // least recently used.
+    for (int i = 0; i < maxEntries / 2; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+    // Insert one more entry, causing a cache overflow.
+    {
+        uint8_t k = maxEntries;
+        ASSERT_EQ(BlobCache::InsertResult::kDidClean, mBC->set(&k, 1, "x", 1));
+    }
+    for (int i = 0; i < maxEntries + 1; i++) {
+        uint8_t k = i;
+        const bool expectCached = i < maxEntries / 2 || i == maxEntries;
+        ASSERT_EQ(expectCached ? size_t(1) : size_t(0), mBC->get(&k, 1, nullptr, 0)) << i;
+    }
+}
+
+TEST_F(BlobCacheTest, UpdatingValueMarksEntryAsRecentlyUsed) {
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set(&k, 1, "x", 1));
+    }
+    {
+        uint8_t k = 0;
+        ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set(&k, 1, "y", 1));
+    }
+    {
+        uint8_t k = maxEntries;
+        ASSERT_EQ(BlobCache::InsertResult::kDidClean, mBC->set(&k, 1, "x", 1));
+    }
+    uint8_t k = 0;
+    unsigned char buf[1] = {0xee};
+    ASSERT_EQ(size_t(1), mBC->get(&k, 1, buf, 1));
+    ASSERT_EQ('y', buf[0]);
+    k = 1;
+    ASSERT_EQ(size_t(0), mBC->get(&k, 1, nullptr, 0));
+}
+
 TEST_F(BlobCacheTest, InvalidKeySize) {
     ASSERT_EQ(BlobCache::InsertResult::kInvalidKeySize, mBC->set("", 0, "efgh", 4));
 }
@@ -355,6 +402,33 @@ TEST_F(BlobCacheFlattenTest, FlattenFullCache) {
     }
 }
 
+TEST_F(BlobCacheFlattenTest, FlattenPreservesRecencyOrder) {
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        mBC->set(&k, 1, &k, 1);
+    }
+    // Make the first entry the most recently used one.
+    {
+        uint8_t k = 0;
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+
+    roundTrip();
+
+    // Overflow the deserialized cache; the most recently used entries survive.
+    {
+        uint8_t k = maxEntries;
+        ASSERT_EQ(BlobCache::InsertResult::kDidClean, mBC2->set(&k, 1, &k, 1));
+    }
+    uint8_t k = 0;
+    ASSERT_EQ(size_t(1), mBC2->get(&k, 1, nullptr, 0));
+    k = maxEntries - 1;
+    ASSERT_EQ(size_t(1), mBC2->get(&k, 1, nullptr, 0));
+    k = 1;
+    ASSERT_EQ(size_t(0), mBC2->get(&k, 1, nullptr, 0));
+}
+
 TEST_F(BlobCacheFlattenTest, FlattenDoesntChangeCache) {
     // Fill up the entire cache with 1 char key/value pairs.
     const int maxEntries = MAX_TOTAL_SIZE / 2;
@@ -18,6 +18,7 @@
 
 #include "FileBlobCache.h"
 
+#include <android-base/properties.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
@@ -28,12 +29,87 @@
 #include <log/log.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 // Cache file header
 static const char* cacheFileMagic = "EGL$";
-static const size_t cacheFileHeaderSize = 8;
+
+// Cache file format version. Version 1 files contained a single CRC followed
+// by a flattened BlobCache.
+static const uint32_t cacheFileVersion = 2;
 
 namespace android {
 
+namespace {
+
+// The cache file starts with a FileHeader followed by a sequence of records.
+// Each record begins on a 4-byte boundary.  Records are only ever appended, so
+// a record for a given key supersedes all earlier records for the same key.
+struct FileHeader {
+    // mMagic must always contain cacheFileMagic.
+    char mMagic[4];
+
+    // mVersion is the file format version, cacheFileVersion.
+    uint32_t mVersion;
+
+    // mBuildIdLength is the length of mBuildId. The build id of the device
+    // that wrote the file is used to invalidate the cache after an update.
+    uint32_t mBuildIdLength;
+    char mBuildId[];
+};
+
+// A RecordHeader is followed immediately by the key and then the value data.
+struct RecordHeader {
+    // mCrc is the CRC of the key and value data.
+    uint32_t mCrc;
+
+    // mKeySize is the size of the key in bytes.
+    uint32_t mKeySize;
+
+    // mValueSize is the size of the value in bytes.
+    uint32_t mValueSize;
+
+    uint8_t mData[];
+};
+
+inline size_t align4(size_t size) {
+    return (size + 3) & ~3;
+}
+
+size_t headerSize(size_t buildIdLength) {
+    return align4(sizeof(FileHeader) + buildIdLength);
+}
+
+size_t recordSize(size_t keySize, size_t valueSize) {
+    return align4(sizeof(RecordHeader) + keySize + valueSize);
+}
+
+const RecordHeader* asRecord(const uint8_t* data) {
+    return reinterpret_cast<const RecordHeader*>(data);
+}
+
+// writeRecord serializes a key/value pair into dst and returns the number of
+// bytes written.
+size_t writeRecord(uint8_t* dst, const void* key, size_t keySize, const void* value,
+                   size_t valueSize) {
+    RecordHeader* record = reinterpret_cast<RecordHeader*>(dst);
+    record->mKeySize = keySize;
+    record->mValueSize = valueSize;
+    memcpy(record->mData, key, keySize);
+    memcpy(record->mData + keySize, value, valueSize);
+    record->mCrc = crc32c(record->mData, keySize + valueSize);
+
+    // Zero the padding bytes so that the file contents are reproducible.
+    size_t size = recordSize(keySize, valueSize);
+    memset(record->mData + keySize + valueSize, 0,
+           size - sizeof(RecordHeader) - keySize - valueSize);
+    return size;
+}
+
+} // namespace
+
 uint32_t crc32c(const uint8_t* buf, size_t len) {
     const uint32_t polyBits = 0x82F63B78;
     uint32_t r = 0;
@@ -53,148 +129,380 @@ uint32_t crc32c(const uint8_t* buf, size_t len) {
 FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
         const std::string& filename)
         : BlobCache(maxKeySize, maxValueSize, maxTotalSize)
-        , mFilename(filename) {
+        , mFilename(filename)
+        , mMapping(nullptr)
+        , mMappingSize(0)
+        , mFileSize(0)
+        , mMappedSize(0)
+        , mNeedsRewrite(false) {
     ATRACE_CALL();
 
     if (mFilename.length() > 0) {
-        size_t headerSize = cacheFileHeaderSize;
+        mapFile();
+    }
+}
 
-        int fd = open(mFilename.c_str(), O_RDONLY, 0);
-        if (fd == -1) {
-            if (errno != ENOENT) {
-                ALOGE("error opening cache file %s: %s (%d)", mFilename.c_str(),
-                        strerror(errno), errno);
-            }
-            return;
-        }
+FileBlobCache::~FileBlobCache() {
+    unmapFile();
+}
 
-        struct stat statBuf;
-        if (fstat(fd, &statBuf) == -1) {
-            ALOGE("error stat'ing cache file: %s (%d)", strerror(errno), errno);
-            close(fd);
-            return;
+BlobCache::InsertResult FileBlobCache::set(const void* key, size_t keySize, const void* value,
+        size_t valueSize) {
+    InsertResult result = BlobCache::set(key, keySize, value, valueSize);
+    if (result == InsertResult::kInserted || result == InsertResult::kDidClean) {
+        // The new value supersedes the one in the file, if any.
+        auto it = mMappedEntries.find(std::string_view(static_cast<const char*>(key), keySize));
+        if (it != mMappedEntries.end()) {
+            eraseMappedEntry(it);
         }
-
-        // Check the size before trying to mmap it.
-        size_t fileSize = statBuf.st_size;
-        if (fileSize > mMaxTotalSize * 2) {
-            ALOGE("cache file is too large: %#" PRIx64,
-                  static_cast<off64_t>(statBuf.st_size));
-            close(fd);
-            return;
+        if (result == InsertResult::kDidClean) {
+            // Entries evicted from memory may have superseded records in the
+            // file, which must not come back on the next load.
+            mNeedsRewrite = true;
         }
+        if (mMappedSize + getTotalSize() > mMaxTotalSize) {
+            trimMappedEntries();
+        }
+    }
+    return result;
+}
 
-        uint8_t* buf = reinterpret_cast<uint8_t*>(mmap(nullptr, fileSize,
-                PROT_READ, MAP_PRIVATE, fd, 0));
-        if (buf == MAP_FAILED) {
-            ALOGE("error mmaping cache file: %s (%d)", strerror(errno),
-                    errno);
-            close(fd);
-            return;
+size_t FileBlobCache::get(const void* key, size_t keySize, void* value, size_t valueSize) {
+    size_t size = BlobCache::get(key, keySize, value, valueSize);
+    if (size > 0) {
+        return size;
+    }
+
+    auto it = mMappedEntries.find(std::string_view(static_cast<const char*>(key), keySize));
+    if (it == mMappedEntries.end() || !validateMappedEntry(it)) {
+        return 0;
+    }
+    const RecordHeader* record = asRecord(it->second.mRecord);
+    size_t recordValueSize = record->mValueSize;
+    if (recordValueSize <= valueSize) {
+        memcpy(value, record->mData + record->mKeySize, recordValueSize);
+    }
+    return recordValueSize;
+}
+
+void FileBlobCache::mapFile() {
+    ATRACE_CALL();
+
+    unmapFile();
+
+    int fd = open(mFilename.c_str(), O_RDONLY, 0);
+    if (fd == -1) {
+        if (errno != ENOENT) {
+            ALOGE("error opening cache file %s: %s (%d)", mFilename.c_str(),
+                    strerror(errno), errno);
         }
+        return;
+    }
 
-        // Check the file magic and CRC
-        size_t cacheSize = fileSize - headerSize;
-        if (memcmp(buf, cacheFileMagic, 4) != 0) {
-            ALOGE("cache file has bad mojo");
-            close(fd);
-            return;
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) == -1) {
+        ALOGE("error stat'ing cache file: %s (%d)", strerror(errno), errno);
+        close(fd);
+        return;
+    }
+
+    // Check the size before trying to mmap it.
+    size_t fileSize = statBuf.st_size;
+    if (fileSize > mMaxTotalSize * 2) {
+        ALOGE("cache file is too large: %#" PRIx64,
+              static_cast<off64_t>(statBuf.st_size));
+        close(fd);
+        return;
+    }
+    if (fileSize < sizeof(FileHeader)) {
+        ALOGE("cache file is too small: %zu", fileSize);
+        close(fd);
+        return;
+    }
+
+    uint8_t* buf = reinterpret_cast<uint8_t*>(mmap(nullptr, fileSize,
+            PROT_READ, MAP_PRIVATE, fd, 0));
+    // The mapping remains valid after the file is closed.
+    close(fd);
+    if (buf == MAP_FAILED) {
+        ALOGE("error mmaping cache file: %s (%d)", strerror(errno),
+                errno);
+        return;
+    }
+    mMapping = buf;
+    mMappingSize = fileSize;
+
+    // Check the file magic, version and build id
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(buf);
+    if (memcmp(header->mMagic, cacheFileMagic, 4) != 0) {
+        ALOGE("cache file has bad mojo");
+        unmapFile();
+        return;
+    }
+    auto buildId = base::GetProperty("ro.build.id", "");
+    if (header->mVersion != cacheFileVersion || header->mBuildIdLength != buildId.size() ||
+        headerSize(buildId.size()) > fileSize ||
+        memcmp(header->mBuildId, buildId.c_str(), buildId.size()) != 0) {
+        // We treat version mismatches as an empty cache.
+        unmapFile();
+        return;
+    }
+
+    // Index the records. Only the record headers and keys are touched here,
+    // the values are paged in and validated when they are first looked up.
+    size_t offset = headerSize(buildId.size());
+    while (offset + sizeof(RecordHeader) <= fileSize) {
+        const RecordHeader* record = asRecord(buf + offset);
+        size_t keySize = record->mKeySize;
+        size_t valueSize = record->mValueSize;
+        if (keySize == 0 || valueSize == 0 || keySize > mMaxTotalSize ||
+            valueSize > mMaxTotalSize - keySize ||
+            recordSize(keySize, valueSize) > fileSize - offset) {
+            // This is typically a record that was only partially appended.
+            // It and everything after it will be overwritten by the next
+            // append.
+            ALOGW("cache file has an invalid record at offset %zu", offset);
+            break;
         }
-        uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
-        if (crc32c(buf + headerSize, cacheSize) != *crc) {
-            ALOGE("cache file failed CRC check");
-            close(fd);
-            return;
+
+        std::string_view key(reinterpret_cast<const char*>(record->mData), keySize);
+        auto [it, inserted] = mMappedEntries.try_emplace(key, MappedEntry{buf + offset, false});
+        if (!inserted) {
+            const RecordHeader* superseded = asRecord(it->second.mRecord);
+            mMappedSize -= superseded->mKeySize + superseded->mValueSize;
+            it->second = MappedEntry{buf + offset, false};
         }
+        mMappedSize += keySize + valueSize;
+        offset += recordSize(keySize, valueSize);
+    }
+    mFileSize = offset;
 
-        int err = unflatten(buf + headerSize, cacheSize);
-        if (err < 0) {
-            ALOGE("error reading cache contents: %s (%d)", strerror(-err),
-                    -err);
-            munmap(buf, fileSize);
-            close(fd);
-            return;
+    if (mMappedSize > mMaxTotalSize) {
+        trimMappedEntries();
+    }
+}
+
+void FileBlobCache::unmapFile() {
+    mMappedEntries.clear();
+    mMappedSize = 0;
+    mFileSize = 0;
+    if (mMapping != nullptr) {
+        munmap(mMapping, mMappingSize);
+        mMapping = nullptr;
+        mMappingSize = 0;
+    }
+}
+
+bool FileBlobCache::validateMappedEntry(
+        std::unordered_map<std::string_view, MappedEntry>::iterator it) {
+    MappedEntry& entry = it->second;
+    if (!entry.mValidated) {
+        const RecordHeader* record = asRecord(entry.mRecord);
+        if (crc32c(record->mData, record->mKeySize + record->mValueSize) != record->mCrc) {
+            ALOGE("cache file entry failed CRC check");
+            eraseMappedEntry(it);
+            mNeedsRewrite = true;
+            return false;
         }
+        entry.mValidated = true;
+    }
+    return true;
+}
 
-        munmap(buf, fileSize);
-        close(fd);
+void FileBlobCache::eraseMappedEntry(
+        std::unordered_map<std::string_view, MappedEntry>::iterator it) {
+    const RecordHeader* record = asRecord(it->second.mRecord);
+    mMappedSize -= record->mKeySize + record->mValueSize;
+    mMappedEntries.erase(it);
+}
+
+void FileBlobCache::trimMappedEntries() {
+    ATRACE_CALL();
+
+    // Records are appended to the file, so the ones at lower offsets are the
+    // oldest.
+    std::vector<std::unordered_map<std::string_view, MappedEntry>::iterator> entries;
+    entries.reserve(mMappedEntries.size());
+    for (auto it = mMappedEntries.begin(); it != mMappedEntries.end(); ++it) {
+        entries.push_back(it);
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const auto& lhs, const auto& rhs) {
+                  return lhs->second.mRecord < rhs->second.mRecord;
+              });
+    for (auto it : entries) {
+        if (mMappedSize + getTotalSize() <= mMaxTotalSize / 2) {
+            break;
+        }
+        eraseMappedEntry(it);
     }
+    mNeedsRewrite = true;
+}
+
+size_t FileBlobCache::getPendingSize() const {
+    size_t size = 0;
+    forEachEntry([&size](const void*, size_t keySize, const void*, size_t valueSize) {
+        size += recordSize(keySize, valueSize);
+    });
+    return size;
 }
 
 void FileBlobCache::writeToFile() {
     ATRACE_CALL();
 
     if (mFilename.length() > 0) {
-        size_t cacheSize = getFlattenedSize();
-        size_t headerSize = cacheFileHeaderSize;
-        const char* fname = mFilename.c_str();
-
-        // Try to create the file with no permissions so we can write it
-        // without anyone trying to read it.
-        int fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
-        if (fd == -1) {
-            if (errno == EEXIST) {
-                // The file exists, delete it and try again.
-                if (unlink(fname) == -1) {
-                    // No point in retrying if the unlink failed.
-                    ALOGE("error unlinking cache file %s: %s (%d)", fname,
-                            strerror(errno), errno);
-                    return;
-                }
-                // Retry now that we've unlinked the file.
-                fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
-            }
-            if (fd == -1) {
-                ALOGE("error creating cache file %s: %s (%d)", fname,
-                        strerror(errno), errno);
-                return;
-            }
+        if (getTotalSize() == 0 && !mNeedsRewrite && mFileSize > 0) {
+            // Everything is already on disk.
+            return;
         }
 
-        size_t fileSize = headerSize + cacheSize;
+        // Append to the file unless it needs to be replaced, or superseded
+        // records would make up more than half of it.
+        size_t pendingSize = getPendingSize();
+        size_t liveSize = 0;
+        if (mFileSize > 0) {
+            liveSize = headerSize(reinterpret_cast<const FileHeader*>(mMapping)->mBuildIdLength);
+        }
+        for (const auto& [key, entry] : mMappedEntries) {
+            const RecordHeader* record = asRecord(entry.mRecord);
+            liveSize += recordSize(record->mKeySize, record->mValueSize);
+        }
+        size_t newFileSize = mFileSize + pendingSize;
+        bool rewrite = mFileSize == 0 || mNeedsRewrite || newFileSize > mMaxTotalSize * 2 ||
+                newFileSize > (liveSize + pendingSize) * 2;
 
-        uint8_t* buf = new uint8_t [fileSize];
-        if (!buf) {
-            ALOGE("error allocating buffer for cache contents: %s (%d)",
-                    strerror(errno), errno);
-            close(fd);
-            unlink(fname);
-            return;
+        if ((!rewrite && appendToFile()) || rewriteFile()) {
+            // The in-memory entries are now in the file, serve them from there.
+            clear();
+            mNeedsRewrite = false;
+            mapFile();
         }
+    }
+}
 
-        int err = flatten(buf + headerSize, cacheSize);
-        if (err < 0) {
-            ALOGE("error writing cache contents: %s (%d)", strerror(-err),
-                    -err);
-            delete [] buf;
-            close(fd);
-            unlink(fname);
-            return;
+bool FileBlobCache::appendToFile() {
+    ATRACE_CALL();
+
+    size_t pendingSize = getPendingSize();
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[pendingSize]);
+    size_t offset = 0;
+    forEachEntry([&](const void* key, size_t keySize, const void* value, size_t valueSize) {
+        offset += writeRecord(buf.get() + offset, key, keySize, value, valueSize);
+    });
+
+    const char* fname = mFilename.c_str();
+    int fd = open(fname, O_WRONLY, 0);
+    if (fd == -1) {
+        ALOGE("error opening cache file %s for appending: %s (%d)", fname,
+                strerror(errno), errno);
+        return false;
+    }
+
+    // Overwrite any partially written record left behind by a previous
+    // append, then drop whatever follows the new records.
+    if (pwrite(fd, buf.get(), pendingSize, mFileSize) != static_cast<ssize_t>(pendingSize) ||
+        ftruncate(fd, mFileSize + pendingSize) == -1) {
+        ALOGE("error appending to cache file: %s (%d)", strerror(errno),
+                errno);
+        close(fd);
+        return false;
+    }
+
+    close(fd);
+    return true;
+}
+
+bool FileBlobCache::rewriteFile() {
+    ATRACE_CALL();
+
+    // Gather the live records of the current file, oldest first, dropping the
+    // ones that fail their CRC check.
+    std::vector<std::unordered_map<std::string_view, MappedEntry>::iterator> entries;
+    entries.reserve(mMappedEntries.size());
+    for (auto it = mMappedEntries.begin(); it != mMappedEntries.end(); ++it) {
+        entries.push_back(it);
+    }
+    std::vector<const uint8_t*> records;
+    records.reserve(entries.size());
+    for (auto it : entries) {
+        const uint8_t* record = it->second.mRecord;
+        if (validateMappedEntry(it)) {
+            records.push_back(record);
         }
+    }
+    std::sort(records.begin(), records.end());
+
+    auto buildId = base::GetProperty("ro.build.id", "");
+    size_t fileSize = headerSize(buildId.size()) + getPendingSize();
+    for (const uint8_t* record : records) {
+        fileSize += recordSize(asRecord(record)->mKeySize, asRecord(record)->mValueSize);
+    }
 
-        // Write the file magic and CRC
-        memcpy(buf, cacheFileMagic, 4);
-        uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
-        *crc = crc32c(buf + headerSize, cacheSize);
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[fileSize]);
+    FileHeader* header = reinterpret_cast<FileHeader*>(buf.get());
+    memcpy(header->mMagic, cacheFileMagic, 4);
+    header->mVersion = cacheFileVersion;
+    header->mBuildIdLength = buildId.size();
+    memcpy(header->mBuildId, buildId.c_str(), buildId.size());
+    size_t offset = headerSize(buildId.size());
+    memset(header->mBuildId + buildId.size(), 0, offset - sizeof(FileHeader) - buildId.size());
 
-        if (write(fd, buf, fileSize) == -1) {
-            ALOGE("error writing cache file: %s (%d)", strerror(errno),
-                    errno);
-            delete [] buf;
-            close(fd);
-            unlink(fname);
-            return;
+    // Entries that are still in the file come first, followed by the newer
+    // in-memory ones, so that the file stays ordered from oldest to newest.
+    for (const uint8_t* record : records) {
+        size_t size = recordSize(asRecord(record)->mKeySize, asRecord(record)->mValueSize);
+        memcpy(buf.get() + offset, record, size);
+        offset += size;
+    }
+    forEachEntry([&](const void* key, size_t keySize, const void* value, size_t valueSize) {
+        offset += writeRecord(buf.get() + offset, key, keySize, value, valueSize);
+    });
+
+    // Try to create the file with no permissions so we can write it
+    // without anyone trying to read it.
+    const char* fname = mFilename.c_str();
+    int fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
+    if (fd == -1) {
+        if (errno == EEXIST) {
+            // The file exists, delete it and try again. The current mapping
+            // stays valid until it is replaced.
+            if (unlink(fname) == -1) {
+                // No point in retrying if the unlink failed.
+                ALOGE("error unlinking cache file %s: %s (%d)", fname,
+                        strerror(errno), errno);
+                return false;
+            }
+            // Retry now that we've unlinked the file.
+            fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
         }
+        if (fd == -1) {
+            ALOGE("error creating cache file %s: %s (%d)", fname,
+                    strerror(errno), errno);
+            return false;
+        }
+    }
 
-        delete [] buf;
-        fchmod(fd, S_IRUSR);
+    if (write(fd, buf.get(), fileSize) == -1) {
+        ALOGE("error writing cache file: %s (%d)", strerror(errno),
+                errno);
         close(fd);
+        unlink(fname);
+        return false;
     }
+
+    // The file must stay writable by its owner so that new records can be
+    // appended to it.
+    fchmod(fd, S_IRUSR | S_IWUSR);
+    close(fd);
+    return true;
 }
 
 size_t FileBlobCache::getSize() {
     if (mFilename.length() > 0) {
-        return getFlattenedSize() + cacheFileHeaderSize;
+        size_t fileSize = mFileSize > 0
+                ? mFileSize
+                : headerSize(base::GetProperty("ro.build.id", "").size());
+        return fileSize + getPendingSize();
     }
     return 0;
 }
@@ -19,28 +19,106 @@
 
 #include "BlobCache.h"
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 namespace android {
 
 uint32_t crc32c(const uint8_t* buf, size_t len);
 
+// A FileBlobCache is a BlobCache that is backed by a file.
+//
+// The file is a journal of key/value records.  It is mmap'd when the cache is
+// created and only the record keys are read at that time; values are paged in
+// and checked against their CRC the first time they are looked up.  Entries
+// inserted with set are kept in memory until writeToFile appends them to the
+// file.  When the file accumulates too many superseded records, or the cache
+// grows past its size limit, writeToFile rewrites it from scratch instead.
 class FileBlobCache : public BlobCache {
 public:
-    // FileBlobCache attempts to load the saved cache contents from disk into
-    // BlobCache.
+    // FileBlobCache attempts to map the saved cache contents from disk.
     FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
             const std::string& filename);
 
-    // writeToFile attempts to save the current contents of BlobCache to
-    // disk.
+    ~FileBlobCache() override;
+
+    InsertResult set(const void* key, size_t keySize, const void* value,
+            size_t valueSize) override;
+
+    size_t get(const void* key, size_t keySize, void* value, size_t valueSize) override;
+
+    // writeToFile attempts to save the entries inserted since the last call to
+    // disk, compacting the file if needed.
     void writeToFile();
 
     // Return the total size of the cache
     size_t getSize();
 
 private:
+    // A MappedEntry is an entry whose record lives in the mapped cache file.
+    struct MappedEntry {
+        // mRecord points to the record header inside the mapping.
+        const uint8_t* mRecord;
+
+        // mValidated is set once the record has passed its CRC check.
+        bool mValidated;
+    };
+
+    // mapFile maps the cache file and indexes the records it contains,
+    // replacing any previous mapping.
+    void mapFile();
+
+    // unmapFile drops the mapping and every entry that refers to it.
+    void unmapFile();
+
+    // validateMappedEntry checks the CRC of a mapped record the first time it
+    // is used, and erases the entry if the check fails.
+    bool validateMappedEntry(std::unordered_map<std::string_view, MappedEntry>::iterator it);
+
+    // eraseMappedEntry removes a mapped entry from the index.
+    void eraseMappedEntry(std::unordered_map<std::string_view, MappedEntry>::iterator it);
+
+    // trimMappedEntries drops the oldest mapped entries until the whole cache
+    // fits in half of mMaxTotalSize, mirroring what BlobCache::clean does.
+    void trimMappedEntries();
+
+    // appendToFile appends the in-memory entries to the end of the file.
+    bool appendToFile();
+
+    // rewriteFile writes all live entries to a new file that replaces the
+    // current one.
+    bool rewriteFile();
+
+    // getPendingSize returns the number of bytes the in-memory entries will
+    // occupy once written to the file.
+    size_t getPendingSize() const;
+
     // mFilename is the name of the file for storing cache contents.
     std::string mFilename;
+
+    // mMapping is the read-only mapping of the cache file, or nullptr if the
+    // file could not be mapped.
+    uint8_t* mMapping;
+
+    // mMappingSize is the size of mMapping in bytes.
+    size_t mMappingSize;
+
+    // mFileSize is the size of the valid part of the cache file, i.e. the
+    // offset at which new records will be appended.  It is 0 when the file is
+    // missing or invalid and needs to be rewritten.
+    size_t mFileSize;
+
+    // mMappedEntries indexes the live records of the mapping by key.  The keys
+    // are views into the mapping itself.
+    std::unordered_map<std::string_view, MappedEntry> mMappedEntries;
+
+    // mMappedSize is the combined size of the keys and values of all entries
+    // in mMappedEntries.
+    size_t mMappedSize;
+
+    // mNeedsRewrite is set when the file contains entries that were dropped
+    // from the index, so that the next writeToFile discards them.
+    bool mNeedsRewrite;
 };
 
 } // namespace android
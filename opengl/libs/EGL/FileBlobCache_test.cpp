@@ -0,0 +1,231 @@
+/*
+ ** Copyright 2023, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include "FileBlobCache.h"
+
+#include <android-base/test_utils.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+
+namespace android {
+
+constexpr size_t kMaxKeySize = 16;
+constexpr size_t kMaxValueSize = 64;
+constexpr size_t kMaxTotalSize = 512;
+
+class FileBlobCacheTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mTempFile.reset(new TemporaryFile());
+        // Start without a cache file, the way a freshly installed app does.
+        unlink(&mTempFile->path[0]);
+        reopen();
+    }
+
+    virtual void TearDown() { mFBC.reset(); }
+
+    // reopen drops the current cache and loads a new one from the file.
+    void reopen() {
+        mFBC.reset();
+        mFBC.reset(new FileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize,
+                                     &mTempFile->path[0]));
+    }
+
+    off_t getFileSize() {
+        struct stat statBuf;
+        if (stat(&mTempFile->path[0], &statBuf) == -1) {
+            return -1;
+        }
+        return statBuf.st_size;
+    }
+
+    // stompFile overwrites the byte at the given offset from the end of the file.
+    void stompFile(off_t offsetFromEnd) {
+        int fd = open(&mTempFile->path[0], O_WRONLY);
+        ASSERT_NE(-1, fd);
+        char stomp = 0x5a;
+        ASSERT_EQ(1, pwrite(fd, &stomp, 1, getFileSize() - offsetFromEnd));
+        close(fd);
+    }
+
+    std::unique_ptr<TemporaryFile> mTempFile;
+    std::unique_ptr<FileBlobCache> mFBC;
+};
+
+TEST_F(FileBlobCacheTest, EntriesSurviveReload) {
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    mFBC->set("abcd", 4, "efgh", 4);
+    mFBC->set("ijkl", 4, "mnop", 4);
+    mFBC->writeToFile();
+    reopen();
+
+    ASSERT_EQ(size_t(4), mFBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ('h', buf[3]);
+    ASSERT_EQ(size_t(4), mFBC->get("ijkl", 4, buf, 4));
+    ASSERT_EQ('m', buf[0]);
+    ASSERT_EQ('p', buf[3]);
+}
+
+TEST_F(FileBlobCacheTest, EntriesAreServedFromFileAfterWrite) {
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    mFBC->set("abcd", 4, "efgh", 4);
+    mFBC->writeToFile();
+
+    // The entry moved from memory to the file but is still found.
+    ASSERT_EQ(size_t(4), mFBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ('h', buf[3]);
+    ASSERT_EQ(size_t(getFileSize()), mFBC->getSize());
+}
+
+TEST_F(FileBlobCacheTest, WritesAppendNewEntries) {
+    mFBC->set("abcd", 4, "efgh", 4);
+    mFBC->writeToFile();
+    off_t initialSize = getFileSize();
+    ASSERT_GT(initialSize, 0);
+
+    mFBC->set("ijkl", 4, "mnop", 4);
+    size_t expectedSize = mFBC->getSize();
+    mFBC->writeToFile();
+
+    // Only the new record was added to the file.
+    ASSERT_EQ(off_t(expectedSize), getFileSize());
+    ASSERT_LT(getFileSize(), 2 * initialSize);
+
+    reopen();
+    ASSERT_EQ(size_t(4), mFBC->get("abcd", 4, nullptr, 0));
+    ASSERT_EQ(size_t(4), mFBC->get("ijkl", 4, nullptr, 0));
+}
+
+TEST_F(FileBlobCacheTest, LaterRecordSupersedesEarlierOne) {
+    unsigned char buf[2] = {0xee, 0xee};
+    mFBC->set("ab", 2, "cd", 2);
+    mFBC->writeToFile();
+    mFBC->set("ab", 2, "ef", 2);
+    mFBC->writeToFile();
+    reopen();
+
+    ASSERT_EQ(size_t(2), mFBC->get("ab", 2, buf, 2));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ('f', buf[1]);
+}
+
+TEST_F(FileBlobCacheTest, SupersededRecordsAreCompacted) {
+    uint8_t value = 0;
+    for (int i = 0; i < 64; i++) {
+        value = i;
+        mFBC->set("ab", 2, &value, 1);
+        mFBC->writeToFile();
+    }
+
+    // The file never holds much more than the single live entry.
+    off_t singleEntrySize;
+    {
+        std::unique_ptr<TemporaryFile> otherFile(new TemporaryFile());
+        unlink(&otherFile->path[0]);
+        FileBlobCache other(kMaxKeySize, kMaxValueSize, kMaxTotalSize, &otherFile->path[0]);
+        other.set("ab", 2, &value, 1);
+        singleEntrySize = other.getSize();
+    }
+    ASSERT_LE(getFileSize(), 2 * singleEntrySize);
+
+    reopen();
+    uint8_t buf = 0xee;
+    ASSERT_EQ(size_t(1), mFBC->get("ab", 2, &buf, 1));
+    ASSERT_EQ(value, buf);
+}
+
+TEST_F(FileBlobCacheTest, CorruptValueMisses) {
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    mFBC->set("abcd", 4, "efgh", 4);
+    mFBC->writeToFile();
+    mFBC->set("ijkl", 4, "mnop", 4);
+    mFBC->writeToFile();
+
+    // Modify the value of the last record.
+    stompFile(1);
+    reopen();
+
+    ASSERT_EQ(size_t(0), mFBC->get("ijkl", 4, buf, 4));
+    ASSERT_EQ(0xee, buf[0]);
+    ASSERT_EQ(size_t(4), mFBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+}
+
+TEST_F(FileBlobCacheTest, BadMagicMisses) {
+    mFBC->set("abcd", 4, "efgh", 4);
+    mFBC->writeToFile();
+
+    stompFile(getFileSize());
+    reopen();
+
+    ASSERT_EQ(size_t(0), mFBC->get("abcd", 4, nullptr, 0));
+}
+
+TEST_F(FileBlobCacheTest, TruncatedRecordIsDiscarded) {
+    mFBC->set("abcd", 4, "efgh", 4);
+    mFBC->writeToFile();
+    mFBC->set("ijkl", 4, "mnop", 4);
+    mFBC->writeToFile();
+
+    // Simulate an append that was interrupted half way through.
+    ASSERT_EQ(0, truncate(&mTempFile->path[0], getFileSize() - 3));
+    reopen();
+    ASSERT_EQ(size_t(4), mFBC->get("abcd", 4, nullptr, 0));
+    ASSERT_EQ(size_t(0), mFBC->get("ijkl", 4, nullptr, 0));
+
+    // The next append replaces the partial record.
+    mFBC->set("qrst", 4, "uvwx", 4);
+    mFBC->writeToFile();
+    reopen();
+    ASSERT_EQ(size_t(4), mFBC->get("abcd", 4, nullptr, 0));
+    ASSERT_EQ(size_t(4), mFBC->get("qrst", 4, nullptr, 0));
+}
+
+TEST_F(FileBlobCacheTest, CacheSizeDoesntExceedTotalLimit) {
+    uint8_t value[kMaxValueSize] = {};
+    for (int i = 0; i < 64; i++) {
+        uint8_t k = i;
+        mFBC->set(&k, 1, value, sizeof(value));
+        if (i % 4 == 0) {
+            mFBC->writeToFile();
+        }
+    }
+    mFBC->writeToFile();
+    reopen();
+
+    int numCached = 0;
+    for (int i = 0; i < 64; i++) {
+        uint8_t k = i;
+        if (mFBC->get(&k, 1, nullptr, 0) == sizeof(value)) {
+            numCached++;
+        }
+    }
+    ASSERT_GT(numCached, 0);
+    ASSERT_LE(numCached * (1 + sizeof(value)), kMaxTotalSize);
+
+    // The most recently inserted entry is kept.
+    uint8_t k = 63;
+    ASSERT_EQ(sizeof(value), mFBC->get(&k, 1, nullptr, 0));
+}
+
+} // namespace android
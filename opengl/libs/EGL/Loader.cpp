@@ -26,6 +26,7 @@
 #include <dlfcn.h>
 #include <graphicsenv/GraphicsEnv.h>
 #include <log/log.h>
+#include <unistd.h>
 #include <utils/Timers.h>
 #include <vndksupport/linker.h>
 
@@ -345,6 +346,7 @@ void* Loader::open(egl_connection_t* cnx) {
 
     android::GraphicsEnv::getInstance().setDriverLoaded(android::GpuStatsInfo::Api::API_GL, true,
                                                         systemTime() - openTime);
+    cnx->loadingPid = getpid();
 
     return (void*)hnd;
 }
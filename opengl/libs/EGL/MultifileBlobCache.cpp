@@ -42,6 +42,10 @@ using namespace std::literals;
 constexpr uint32_t kMultifileMagic = 'MFB$';
 constexpr uint32_t kCrcPlaceholder = 0;
 
+// Limit on the size of the entries waiting to be written. Callers of set are blocked when it is
+// reached, so that a burst of large entries can't grow memory usage without bounds.
+constexpr size_t kMaxPendingWriteBytes = 4 * 1024 * 1024;
+
 namespace {
 
 // Helper function to close entries or free them
@@ -70,7 +74,8 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
         mTotalCacheSize(0),
         mHotCacheLimit(0),
         mHotCacheSize(0),
-        mWorkerThreadIdle(true) {
+        mPendingWriteBytes(0),
+        mBusyWorkerCount(0) {
     if (baseDir.empty()) {
         ALOGV("INIT: no baseDir provided in MultifileBlobCache constructor, returning early.");
         return;
@@ -89,8 +94,10 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
     // Initialize our cache with the contents of the directory
     mTotalCacheSize = 0;
 
-    // Create the worker thread
-    mTaskThread = std::thread(&MultifileBlobCache::processTasks, this);
+    // Create the worker threads
+    for (size_t i = 0; i < kWorkerThreadCount; i++) {
+        mTaskThreads[i] = std::thread(&MultifileBlobCache::processTasks, this, i);
+    }
 
     // See if the dir exists, and initialize using its contents
     struct stat st;
@@ -219,6 +226,11 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
                 }
             }
             closedir(dir);
+
+            // Order the entries by their last access time, most recent first
+            mLruList.sort([this](uint32_t lhs, uint32_t rhs) {
+                return mEntryStats[lhs].accessTime > mEntryStats[rhs].accessTime;
+            });
         } else {
             ALOGE("Unable to open filename: %s", mMultifileDirName.c_str());
         }
@@ -237,16 +249,23 @@ MultifileBlobCache::~MultifileBlobCache() {
         return;
     }
 
-    // Inform the worker thread we're done
-    ALOGV("DESCTRUCTOR: Shutting down worker thread");
-    DeferredTask task(TaskCommand::Exit);
-    queueTask(std::move(task));
+    // Inform the worker threads we're done
+    ALOGV("DESCTRUCTOR: Shutting down worker threads");
+    {
+        std::lock_guard<std::mutex> queueLock(mWorkerMutex);
+        for (size_t i = 0; i < kWorkerThreadCount; i++) {
+            mTasks[i].emplace(TaskCommand::Exit);
+        }
+        mWorkAvailableCondition.notify_all();
+    }
 
-    // Wait for it to complete
-    ALOGV("DESCTRUCTOR: Waiting for worker thread to complete");
+    // Wait for them to complete
+    ALOGV("DESCTRUCTOR: Waiting for worker threads to complete");
     waitForWorkComplete();
-    if (mTaskThread.joinable()) {
-        mTaskThread.join();
+    for (size_t i = 0; i < kWorkerThreadCount; i++) {
+        if (mTaskThreads[i].joinable()) {
+            mTaskThreads[i].join();
+        }
     }
 }
 
@@ -291,6 +310,12 @@ void MultifileBlobCache::set(const void* key, EGLsizeiANDROID keySize, const voi
 
     std::string fullPath = mMultifileDirName + "/" + std::to_string(entryHash);
 
+    // If the entry is being replaced, stop accounting for the old one
+    if (contains(entryHash)) {
+        decreaseTotalCacheSize(getEntryStats(entryHash).fileSize);
+        removeFromHotCache(entryHash);
+    }
+
     // Track the size and access time for quick recall
     trackEntry(entryHash, valueSize, fileSize, time(0));
 
@@ -311,8 +336,20 @@ void MultifileBlobCache::set(const void* key, EGLsizeiANDROID keySize, const voi
     // Include the buffer to handle the case when multiple writes are pending for an entry
     {
         // Synchronize access to deferred write status
-        std::lock_guard<std::mutex> lock(mDeferredWriteStatusMutex);
-        mDeferredWrites.insert(std::make_pair(entryHash, buffer));
+        std::unique_lock<std::mutex> lock(mDeferredWriteStatusMutex);
+
+        // Apply backpressure if the worker threads are falling behind. A single entry is always
+        // accepted, even if it is larger than the limit.
+        if (mPendingWriteBytes > 0 && mPendingWriteBytes + fileSize > kMaxPendingWriteBytes) {
+            ALOGV("SET: %zu bytes pending, waiting for writes to complete", mPendingWriteBytes);
+            mDeferredWriteStatusCondition.wait(lock, [this, fileSize] {
+                return mPendingWriteBytes == 0 ||
+                        mPendingWriteBytes + fileSize <= kMaxPendingWriteBytes;
+            });
+        }
+
+        mDeferredWrites.insert(std::make_pair(entryHash, DeferredWrite{buffer, fileSize, false}));
+        mPendingWriteBytes += fileSize;
     }
 
     // Create deferred task to write to storage
@@ -336,6 +373,15 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
         return 0;
     }
 
+    // Entries shared by all processes don't need to be loaded from disk
+    if (mSharedCache) {
+        EGLsizeiANDROID sharedValueSize = mSharedCache->get(key, keySize, value, valueSize);
+        if (sharedValueSize > 0) {
+            ALOGV("GET: Shared cache HIT");
+            return sharedValueSize;
+        }
+    }
+
     // Generate a hash of the key and use it to track this entry
     uint32_t entryHash = android::JenkinsHashMixBytes(0, static_cast<const uint8_t*>(key), keySize);
 
@@ -358,6 +404,7 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
 
     // We have the file and have enough room to write it out, return the entry
     ALOGV("GET: Cache HIT - cache contains entry: %u", entryHash);
+    markEntryUsed(entryHash);
 
     // Look up the size of the file
     size_t fileSize = entryStats.fileSize;
@@ -381,17 +428,7 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
         ALOGV("GET: HotCache MISS for entry: %u", entryHash);
 
         // Wait for writes to complete if there is an outstanding write for this entry
-        bool wait = false;
-        {
-            // Synchronize access to deferred write status
-            std::lock_guard<std::mutex> lock(mDeferredWriteStatusMutex);
-            wait = mDeferredWrites.find(entryHash) != mDeferredWrites.end();
-        }
-
-        if (wait) {
-            ALOGV("GET: Waiting for write to complete for %u", entryHash);
-            waitForWorkComplete();
-        }
+        waitForEntryWrites(entryHash);
 
         // Open the entry file
         int fd = open(fullPath.c_str(), O_RDONLY);
@@ -473,6 +510,45 @@ void MultifileBlobCache::trackEntry(uint32_t entryHash, EGLsizeiANDROID valueSiz
                                     time_t accessTime) {
     mEntries.insert(entryHash);
     mEntryStats[entryHash] = {valueSize, fileSize, accessTime};
+    markEntryUsed(entryHash);
+}
+
+bool MultifileBlobCache::removeEntry(uint32_t entryHash) {
+    auto statsIter = mEntryStats.find(entryHash);
+    if (statsIter == mEntryStats.end()) {
+        return false;
+    }
+
+    // Track the overall size
+    decreaseTotalCacheSize(statsIter->second.fileSize);
+
+    // Remove it from hot cache if present
+    removeFromHotCache(entryHash);
+
+    // Delete the entry from our tracking
+    auto lruIter = mLruPositions.find(entryHash);
+    if (lruIter != mLruPositions.end()) {
+        mLruList.erase(lruIter->second);
+        mLruPositions.erase(lruIter);
+    }
+    mEntryStats.erase(statsIter);
+    mEntries.erase(entryHash);
+
+    // Remove it from the system. This is queued behind any pending write of the entry.
+    DeferredTask task(TaskCommand::RemoveFromDisk);
+    task.initRemoveFromDisk(entryHash, mMultifileDirName + "/" + std::to_string(entryHash));
+    queueTask(std::move(task));
+
+    return true;
+}
+
+void MultifileBlobCache::markEntryUsed(uint32_t entryHash) {
+    auto lruIter = mLruPositions.find(entryHash);
+    if (lruIter != mLruPositions.end()) {
+        mLruList.splice(mLruList.begin(), mLruList, lruIter->second);
+    } else {
+        mLruPositions[entryHash] = mLruList.insert(mLruList.begin(), entryHash);
+    }
 }
 
 bool MultifileBlobCache::contains(uint32_t hashEntry) const {
@@ -502,10 +578,6 @@ bool MultifileBlobCache::addToHotCache(uint32_t newEntryHash, int newFd, uint8_t
               "(%zu), freeing up space for %u",
               mHotCacheSize, newEntrySize, mHotCacheLimit, newEntryHash);
 
-        // Wait for all the files to complete writing so our hot cache is accurate
-        ALOGV("HOTCACHE(ADD): Waiting for work to complete for %u", newEntryHash);
-        waitForWorkComplete();
-
         // Free up old entries until under the limit
         for (auto hotCacheIter = mHotCache.begin(); hotCacheIter != mHotCache.end();) {
             uint32_t oldEntryHash = hotCacheIter->first;
@@ -539,13 +611,9 @@ bool MultifileBlobCache::removeFromHotCache(uint32_t entryHash) {
     if (mHotCache.find(entryHash) != mHotCache.end()) {
         ALOGV("HOTCACHE(REMOVE): Removing %u from hot cache", entryHash);
 
-        // Wait for all the files to complete writing so our hot cache is accurate
-        ALOGV("HOTCACHE(REMOVE): Waiting for work to complete for %u", entryHash);
-        waitForWorkComplete();
-
         ALOGV("HOTCACHE(REMOVE): Closing hot cache entry for %u", entryHash);
         MultifileHotCache entry = mHotCache[entryHash];
-        freeHotCacheEntry(entry);
+        releaseHotCacheEntry(entryHash, entry);
 
         // Delete the entry from our tracking
         mHotCacheSize -= entry.entrySize;
@@ -557,33 +625,33 @@ bool MultifileBlobCache::removeFromHotCache(uint32_t entryHash) {
     return false;
 }
 
-bool MultifileBlobCache::applyLRU(size_t cacheLimit) {
-    // Walk through our map of sorted last access times and remove files until under the limit
-    for (auto cacheEntryIter = mEntryStats.begin(); cacheEntryIter != mEntryStats.end();) {
-        uint32_t entryHash = cacheEntryIter->first;
-
-        ALOGV("LRU: Removing entryHash %u", entryHash);
-
-        // Track the overall size
-        MultifileEntryStats entryStats = getEntryStats(entryHash);
-        decreaseTotalCacheSize(entryStats.fileSize);
-
-        // Remove it from hot cache if present
-        removeFromHotCache(entryHash);
-
-        // Remove it from the system
-        std::string entryPath = mMultifileDirName + "/" + std::to_string(entryHash);
-        if (remove(entryPath.c_str()) != 0) {
-            ALOGE("LRU: Error removing %s: %s", entryPath.c_str(), std::strerror(errno));
-            return false;
+void MultifileBlobCache::releaseHotCacheEntry(uint32_t entryHash, MultifileHotCache& entry) {
+    if (entry.entryFd == -1) {
+        // Entries added during SET may still be waiting to be written, hand those over to the
+        // worker thread rather than waiting for it
+        std::lock_guard<std::mutex> lock(mDeferredWriteStatusMutex);
+        auto iterPair = mDeferredWrites.equal_range(entryHash);
+        for (auto it = iterPair.first; it != iterPair.second; ++it) {
+            if (it->second.buffer == entry.entryBuffer) {
+                ALOGV("HOTCACHE(REMOVE): Write pending for %u, worker will free %p", entryHash,
+                      entry.entryBuffer);
+                it->second.releaseWhenWritten = true;
+                return;
+            }
         }
+    }
 
-        // Increment the iterator before clearing the entry
-        cacheEntryIter++;
+    freeHotCacheEntry(entry);
+}
 
-        // Delete the entry from our tracking
-        size_t count = mEntryStats.erase(entryHash);
-        if (count != 1) {
+bool MultifileBlobCache::applyLRU(size_t cacheLimit) {
+    // Remove the least recently used entries until under the limit. Only our tracking is updated
+    // here, the files are removed by the worker threads.
+    while (!mLruList.empty()) {
+        uint32_t entryHash = mLruList.back();
+
+        ALOGV("LRU: Removing entryHash %u", entryHash);
+        if (!removeEntry(entryHash)) {
             ALOGE("LRU: Failed to remove entryHash (%u) from mEntryStats", entryHash);
             return false;
         }
@@ -607,10 +675,6 @@ constexpr uint32_t kCacheLimitDivisor = 2;
 
 // Calculate the cache size and remove old entries until under the limit
 void MultifileBlobCache::trimCache() {
-    // Wait for all deferred writes to complete
-    ALOGV("TRIM: Waiting for work to complete.");
-    waitForWorkComplete();
-
     ALOGV("TRIM: Reducing multifile cache size to %zu", mMaxTotalSize / kCacheLimitDivisor);
     if (!applyLRU(mMaxTotalSize / kCacheLimitDivisor)) {
         ALOGE("Error when clearing multifile shader cache");
@@ -618,7 +682,7 @@ void MultifileBlobCache::trimCache() {
     }
 }
 
-// This function performs a task.  It only knows how to write files to disk,
+// This function performs a task.  It knows how to write files to disk and remove them,
 // but it could be expanded if needed.
 void MultifileBlobCache::processTask(DeferredTask& task) {
     switch (task.getTaskCommand()) {
@@ -637,6 +701,7 @@ void MultifileBlobCache::processTask(DeferredTask& task) {
             if (fd == -1) {
                 ALOGE("Cache error in SET - failed to open fullPath: %s, error: %s",
                       fullPath.c_str(), std::strerror(errno));
+                completeDeferredWrite(entryHash, buffer);
                 return;
             }
 
@@ -651,29 +716,19 @@ void MultifileBlobCache::processTask(DeferredTask& task) {
             if (result != bufferSize) {
                 ALOGE("Error writing fileSize to cache entry (%s): %s", fullPath.c_str(),
                       std::strerror(errno));
-                return;
+            } else {
+                ALOGV("DEFERRED: Completed write for: %s", fullPath.c_str());
             }
-
-            ALOGV("DEFERRED: Completed write for: %s", fullPath.c_str());
             close(fd);
 
-            // Erase the entry from mDeferredWrites
-            // Since there could be multiple outstanding writes for an entry, find the matching one
-            {
-                // Synchronize access to deferred write status
-                std::lock_guard<std::mutex> lock(mDeferredWriteStatusMutex);
-                typedef std::multimap<uint32_t, uint8_t*>::iterator entryIter;
-                std::pair<entryIter, entryIter> iterPair = mDeferredWrites.equal_range(entryHash);
-                for (entryIter it = iterPair.first; it != iterPair.second; ++it) {
-                    if (it->second == buffer) {
-                        ALOGV("DEFERRED: Marking write complete for %u at %p", it->first,
-                              it->second);
-                        mDeferredWrites.erase(it);
-                        break;
-                    }
-                }
+            completeDeferredWrite(entryHash, buffer);
+            return;
+        }
+        case TaskCommand::RemoveFromDisk: {
+            std::string& fullPath = task.getFullPath();
+            if (remove(fullPath.c_str()) != 0 && errno != ENOENT) {
+                ALOGE("DEFERRED: Error removing %s: %s", fullPath.c_str(), std::strerror(errno));
             }
-
             return;
         }
         default: {
@@ -683,59 +738,104 @@ void MultifileBlobCache::processTask(DeferredTask& task) {
     }
 }
 
-// This function will wait until tasks arrive, then execute them
+// Erase the entry from mDeferredWrites and wake anyone waiting on it
+void MultifileBlobCache::completeDeferredWrite(uint32_t entryHash, uint8_t* buffer) {
+    // Synchronize access to deferred write status
+    std::lock_guard<std::mutex> lock(mDeferredWriteStatusMutex);
+
+    // Since there could be multiple outstanding writes for an entry, find the matching one
+    auto iterPair = mDeferredWrites.equal_range(entryHash);
+    for (auto it = iterPair.first; it != iterPair.second; ++it) {
+        if (it->second.buffer == buffer) {
+            ALOGV("DEFERRED: Marking write complete for %u at %p", it->first, buffer);
+            if (it->second.releaseWhenWritten) {
+                // The hot cache is done with the buffer
+                delete[] buffer;
+            }
+            mPendingWriteBytes -= it->second.bufferSize;
+            mDeferredWrites.erase(it);
+            break;
+        }
+    }
+    mDeferredWriteStatusCondition.notify_all();
+}
+
+// This function will wait until tasks arrive, then execute all of them
 // If the exit command is submitted, the loop will terminate
-void MultifileBlobCache::processTasksImpl(bool* exitThread) {
-    while (true) {
+void MultifileBlobCache::processTasksImpl(size_t workerIndex, bool* exitThread) {
+    std::queue<DeferredTask> tasks;
+    {
         std::unique_lock<std::mutex> lock(mWorkerMutex);
-        if (mTasks.empty()) {
+        if (mTasks[workerIndex].empty()) {
             ALOGV("WORKER: No tasks available, waiting");
-            mWorkerThreadIdle = true;
-            mWorkerIdleCondition.notify_all();
-            // Only wake if notified and command queue is not empty
-            mWorkAvailableCondition.wait(lock, [this] { return !mTasks.empty(); });
+            // Only wake if notified and our command queue is not empty
+            mWorkAvailableCondition.wait(lock, [this, workerIndex] {
+                return !mTasks[workerIndex].empty();
+            });
         }
 
-        ALOGV("WORKER: Task available, waking up.");
-        mWorkerThreadIdle = false;
-        DeferredTask task = std::move(mTasks.front());
-        mTasks.pop();
+        // Take the whole queue, so the lock isn't needed again until it has been worked through
+        ALOGV("WORKER: %zu tasks available, waking up.", mTasks[workerIndex].size());
+        std::swap(tasks, mTasks[workerIndex]);
+        mBusyWorkerCount++;
+    }
+
+    while (!tasks.empty()) {
+        DeferredTask task = std::move(tasks.front());
+        tasks.pop();
 
         if (task.getTaskCommand() == TaskCommand::Exit) {
             ALOGV("WORKER: Exiting work loop.");
             *exitThread = true;
-            mWorkerThreadIdle = true;
-            mWorkerIdleCondition.notify_one();
-            return;
+            break;
         }
 
-        lock.unlock();
         processTask(task);
     }
+
+    std::lock_guard<std::mutex> lock(mWorkerMutex);
+    mBusyWorkerCount--;
+    mWorkerIdleCondition.notify_all();
 }
 
 // Process tasks until the exit task is submitted
-void MultifileBlobCache::processTasks() {
+void MultifileBlobCache::processTasks(size_t workerIndex) {
     while (true) {
         bool exitThread = false;
-        processTasksImpl(&exitThread);
+        processTasksImpl(workerIndex, &exitThread);
         if (exitThread) {
             break;
         }
     }
 }
 
-// Add a task to the queue to be processed by the worker thread
+// Add a task to the queue of the worker thread responsible for its entry
 void MultifileBlobCache::queueTask(DeferredTask&& task) {
     std::lock_guard<std::mutex> queueLock(mWorkerMutex);
-    mTasks.emplace(std::move(task));
-    mWorkAvailableCondition.notify_one();
+    mTasks[task.getEntryHash() % kWorkerThreadCount].emplace(std::move(task));
+    // The workers share the condition, wake all of them so the right one sees the task
+    mWorkAvailableCondition.notify_all();
 }
 
 // Wait until all tasks have been completed
 void MultifileBlobCache::waitForWorkComplete() {
     std::unique_lock<std::mutex> lock(mWorkerMutex);
-    mWorkerIdleCondition.wait(lock, [this] { return (mTasks.empty() && mWorkerThreadIdle); });
+    mWorkerIdleCondition.wait(lock, [this] {
+        return mBusyWorkerCount == 0 &&
+                std::all_of(std::begin(mTasks), std::end(mTasks),
+                            [](const std::queue<DeferredTask>& tasks) { return tasks.empty(); });
+    });
+}
+
+// Wait until the outstanding writes for an entry have been completed
+void MultifileBlobCache::waitForEntryWrites(uint32_t entryHash) {
+    std::unique_lock<std::mutex> lock(mDeferredWriteStatusMutex);
+    if (mDeferredWrites.find(entryHash) != mDeferredWrites.end()) {
+        ALOGV("GET: Waiting for write to complete for %u", entryHash);
+        mDeferredWriteStatusCondition.wait(lock, [this, entryHash] {
+            return mDeferredWrites.find(entryHash) == mDeferredWrites.end();
+        });
+    }
 }
 
 }; // namespace android
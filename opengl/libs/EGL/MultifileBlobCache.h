@@ -22,7 +22,9 @@
 
 #include <android-base/thread_annotations.h>
 #include <future>
+#include <list>
 #include <map>
+#include <memory>
 #include <queue>
 #include <string>
 #include <thread>
@@ -30,6 +32,7 @@
 #include <unordered_set>
 
 #include "FileBlobCache.h"
+#include "SharedBlobCache.h"
 
 namespace android {
 
@@ -55,6 +58,7 @@ struct MultifileHotCache {
 enum class TaskCommand {
     Invalid = 0,
     WriteToDisk,
+    RemoveFromDisk,
     Exit,
 };
 
@@ -74,6 +78,12 @@ public:
         mBufferSize = bufferSize;
     }
 
+    void initRemoveFromDisk(uint32_t entryHash, std::string fullPath) {
+        mCommand = TaskCommand::RemoveFromDisk;
+        mEntryHash = entryHash;
+        mFullPath = std::move(fullPath);
+    }
+
     uint32_t getEntryHash() { return mEntryHash; }
     std::string& getFullPath() { return mFullPath; }
     uint8_t* getBuffer() { return mBuffer; }
@@ -82,7 +92,7 @@ public:
 private:
     TaskCommand mCommand;
 
-    // Parameters for WriteToDisk
+    // Parameters for WriteToDisk and RemoveFromDisk
     uint32_t mEntryHash;
     std::string mFullPath;
     uint8_t* mBuffer;
@@ -104,6 +114,17 @@ public:
 
     size_t getTotalSize() const { return mTotalCacheSize; }
 
+    // Attach the read-only tier shared by all processes. It is consulted before
+    // the entries of this cache.
+    void setSharedCache(std::unique_ptr<SharedBlobCache> sharedCache) {
+        mSharedCache = std::move(sharedCache);
+    }
+
+    // Return the statistics of the shared tier, all zero if there is none
+    SharedBlobCacheStats getSharedCacheStats() const {
+        return mSharedCache ? mSharedCache->getStats() : SharedBlobCacheStats{0, 0};
+    }
+
 private:
     void trackEntry(uint32_t entryHash, EGLsizeiANDROID valueSize, size_t fileSize,
                     time_t accessTime);
@@ -117,9 +138,15 @@ private:
     void increaseTotalCacheSize(size_t fileSize);
     void decreaseTotalCacheSize(size_t fileSize);
 
+    // Move an entry to the front of the LRU list
+    void markEntryUsed(uint32_t entryHash);
+
     bool addToHotCache(uint32_t entryHash, int fd, uint8_t* entryBufer, size_t entrySize);
     bool removeFromHotCache(uint32_t entryHash);
 
+    // Free a hot cache entry, or leave it to the worker thread if it is still being written
+    void releaseHotCacheEntry(uint32_t entryHash, MultifileHotCache& entry);
+
     void trimCache();
     bool applyLRU(size_t cacheLimit);
 
@@ -130,6 +157,10 @@ private:
     std::unordered_map<uint32_t, MultifileEntryStats> mEntryStats;
     std::unordered_map<uint32_t, MultifileHotCache> mHotCache;
 
+    // Entries ordered from most to least recently used, trimming starts at the back
+    std::list<uint32_t> mLruList;
+    std::unordered_map<uint32_t, std::list<uint32_t>::iterator> mLruPositions;
+
     size_t mMaxKeySize;
     size_t mMaxValueSize;
     size_t mMaxTotalSize;
@@ -138,35 +169,60 @@ private:
     size_t mHotCacheEntryLimit;
     size_t mHotCacheSize;
 
+    std::unique_ptr<SharedBlobCache> mSharedCache;
+
     // Below are the components used for deferred writes
 
+    struct DeferredWrite {
+        uint8_t* buffer;
+        size_t bufferSize;
+        // Set once the hot cache no longer uses the buffer, the worker thread frees it after
+        // writing it out
+        bool releaseWhenWritten;
+    };
+
     // Track whether we have pending writes for an entry
     std::mutex mDeferredWriteStatusMutex;
-    std::multimap<uint32_t, uint8_t*> mDeferredWrites GUARDED_BY(mDeferredWriteStatusMutex);
+    std::multimap<uint32_t, DeferredWrite> mDeferredWrites GUARDED_BY(mDeferredWriteStatusMutex);
+
+    // Total size of the buffers in mDeferredWrites, set blocks while this is over the limit
+    size_t mPendingWriteBytes GUARDED_BY(mDeferredWriteStatusMutex);
+
+    // This condition is signaled each time a deferred write completes
+    std::condition_variable mDeferredWriteStatusCondition;
 
     // Functions to work through tasks in the queue
-    void processTasks();
-    void processTasksImpl(bool* exitThread);
+    void processTasks(size_t workerIndex);
+    void processTasksImpl(size_t workerIndex, bool* exitThread);
     void processTask(DeferredTask& task);
+    void completeDeferredWrite(uint32_t entryHash, uint8_t* buffer);
 
-    // Used by main thread to create work for the worker thread
+    // Used by main thread to create work for the worker threads. Tasks for a given entry always
+    // go to the same worker, so that they are performed in order.
     void queueTask(DeferredTask&& task);
 
-    // Used by main thread to wait for worker thread to complete all outstanding work.
+    // Used by main thread to wait for worker threads to complete all outstanding work.
     void waitForWorkComplete();
 
-    std::thread mTaskThread;
-    std::queue<DeferredTask> mTasks;
+    // Used by main thread to wait for the pending writes of a single entry.
+    void waitForEntryWrites(uint32_t entryHash);
+
+    // Entries are written by several threads, as storage handles concurrent writes to
+    // different files well
+    static constexpr size_t kWorkerThreadCount = 2;
+
+    std::thread mTaskThreads[kWorkerThreadCount];
+    std::queue<DeferredTask> mTasks[kWorkerThreadCount];
     std::mutex mWorkerMutex;
 
-    // This condition will block the worker thread until a task is queued
+    // This condition will block the worker threads until a task is queued
     std::condition_variable mWorkAvailableCondition;
 
-    // This condition will block the main thread while the worker thread still has tasks
+    // This condition will block the main thread while the worker threads still have tasks
     std::condition_variable mWorkerIdleCondition;
 
-    // This bool will track whether all tasks have been completed
-    bool mWorkerThreadIdle;
+    // Number of worker threads currently processing tasks
+    size_t mBusyWorkerCount;
 };
 
 }; // namespace android
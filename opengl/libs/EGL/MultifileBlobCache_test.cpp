@@ -22,6 +22,7 @@
 #include <stdio.h>
 
 #include <memory>
+#include <vector>
 
 namespace android {
 
@@ -83,6 +84,28 @@ TEST_F(MultifileBlobCacheTest, GetSetTwiceSucceeds) {
     ASSERT_EQ('f', buf[1]);
 }
 
+TEST_F(MultifileBlobCacheTest, SharedCacheIsUsedFirst) {
+    std::string sharedPath = std::string(&mTempFile->path[0]) + ".shared";
+    SharedBlobCache::Entry entry = {{'a', 'b', 'c', 'd'}, {'s', 'h', 'r', 'd'}};
+    ASSERT_TRUE(SharedBlobCache::write(sharedPath, "driver", {entry}));
+    mMBC->setSharedCache(std::make_unique<SharedBlobCache>(sharedPath, "driver"));
+
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    ASSERT_EQ(size_t(4), mMBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('s', buf[0]);
+    ASSERT_EQ('d', buf[3]);
+
+    // Entries that are not shared still come from the per-app cache
+    mMBC->set("efgh", 4, "ijkl", 4);
+    ASSERT_EQ(size_t(4), mMBC->get("efgh", 4, buf, 4));
+    ASSERT_EQ('i', buf[0]);
+
+    SharedBlobCacheStats stats = mMBC->getSharedCacheStats();
+    ASSERT_EQ(1u, stats.hits);
+    ASSERT_EQ(1u, stats.misses);
+    unlink(sharedPath.c_str());
+}
+
 TEST_F(MultifileBlobCacheTest, GetOnlyWritesInsideBounds) {
     unsigned char buf[6] = {0xee, 0xee, 0xee, 0xee, 0xee, 0xee};
     mMBC->set("abcd", 4, "efgh", 4);
@@ -218,6 +241,68 @@ TEST_F(MultifileBlobCacheTest, CacheMinKeyAndValueSizeSucceeds) {
     ASSERT_EQ('y', buf[0]);
 }
 
+TEST_F(MultifileBlobCacheTest, ReplacingValueDoesntGrowCache) {
+    mMBC->set("ab", 2, "cd", 2);
+    size_t totalSize = mMBC->getTotalSize();
+    mMBC->set("ab", 2, "ef", 2);
+    ASSERT_EQ(totalSize, mMBC->getTotalSize());
+}
+
+TEST_F(MultifileBlobCacheTest, TrimEvictsLeastRecentlyUsedEntries) {
+    constexpr int kNumEntries = 7;
+    constexpr size_t kValueSize = 4 * 1024;
+    std::vector<uint8_t> value(kValueSize, 0xdd);
+    for (int i = 0; i < kNumEntries; i++) {
+        mMBC->set(&i, sizeof(i), value.data(), kValueSize);
+    }
+
+    // Use the first entry, so that it is the most recently used one
+    int key = 0;
+    ASSERT_EQ(kValueSize, mMBC->get(&key, sizeof(key), value.data(), kValueSize));
+
+    // This entry doesn't fit, so the cache is trimmed to half its size
+    key = kNumEntries;
+    mMBC->set(&key, sizeof(key), value.data(), kValueSize);
+    ASSERT_LE(mMBC->getTotalSize(), kMaxTotalSize);
+
+    key = 0;
+    ASSERT_EQ(kValueSize, mMBC->get(&key, sizeof(key), value.data(), kValueSize));
+    key = 1;
+    ASSERT_EQ(size_t(0), mMBC->get(&key, sizeof(key), value.data(), kValueSize));
+    key = kNumEntries;
+    ASSERT_EQ(kValueSize, mMBC->get(&key, sizeof(key), value.data(), kValueSize));
+
+    // The evicted entry must also be gone from disk
+    mMBC->finish();
+    mMBC.reset(
+            new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, &mTempFile->path[0]));
+    key = 1;
+    ASSERT_EQ(size_t(0), mMBC->get(&key, sizeof(key), value.data(), kValueSize));
+    key = 0;
+    ASSERT_EQ(kValueSize, mMBC->get(&key, sizeof(key), value.data(), kValueSize));
+}
+
+TEST_F(MultifileBlobCacheTest, RepeatedSetsPersistLatestValues) {
+    // Several writes of each entry are queued, the last one must end up on disk
+    constexpr int kNumEntries = 4;
+    constexpr int kNumRounds = 4;
+    std::vector<uint8_t> value(kMaxValueSize);
+    for (int round = 0; round < kNumRounds; round++) {
+        for (int i = 0; i < kNumEntries; i++) {
+            std::fill(value.begin(), value.end(), round * kNumEntries + i);
+            mMBC->set(&i, sizeof(i), value.data(), value.size());
+        }
+    }
+
+    mMBC->finish();
+    mMBC.reset(
+            new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, &mTempFile->path[0]));
+    for (int i = 0; i < kNumEntries; i++) {
+        ASSERT_EQ(value.size(), mMBC->get(&i, sizeof(i), value.data(), value.size()));
+        ASSERT_EQ((kNumRounds - 1) * kNumEntries + i, value[0]);
+    }
+}
+
 int MultifileBlobCacheTest::getFileDescriptorCount() {
     DIR* directory = opendir("/proc/self/fd");
 
@@ -0,0 +1,253 @@
+/*
+ ** Copyright 2023, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+
+#include "SharedBlobCache.h"
+
+#include <fcntl.h>
+#include <log/log.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <utils/JenkinsHash.h>
+
+#include "FileBlobCache.h"
+
+constexpr uint32_t kSharedMagic = 'SBC$';
+constexpr uint32_t kSharedVersion = 1;
+
+namespace {
+
+size_t align4(size_t size) {
+    return (size + 3) & ~3;
+}
+
+size_t getIndexOffset(size_t driverIdLength) {
+    return align4(sizeof(android::SharedBlobCacheHeader) + driverIdLength);
+}
+
+uint32_t hashKey(const void* key, size_t keySize) {
+    return android::JenkinsHashMixBytes(0, static_cast<const uint8_t*>(key), keySize);
+}
+
+} // namespace
+
+namespace android {
+
+SharedBlobCache::SharedBlobCache(const std::string& filename, const std::string& driverId)
+      : mMapping(nullptr), mMappingSize(0), mIndex(nullptr), mNumEntries(0), mStats{0, 0} {
+    if (filename.empty()) {
+        return;
+    }
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        if (errno != ENOENT) {
+            ALOGE("SHARED: Failed to open %s, error: %s", filename.c_str(), std::strerror(errno));
+        }
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SharedBlobCacheHeader))) {
+        ALOGE("SHARED: %s is too small or could not be stat'd", filename.c_str());
+        close(fd);
+        return;
+    }
+
+    // Note: Converting from off_t (signed) to size_t (unsigned)
+    size_t fileSize = static_cast<size_t>(st.st_size);
+    uint8_t* mapping =
+            reinterpret_cast<uint8_t*>(mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0));
+
+    // We can close the file now and the mmap will remain
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        ALOGE("SHARED: Failed to mmap %s, error: %s", filename.c_str(), std::strerror(errno));
+        return;
+    }
+
+    const SharedBlobCacheHeader* header = reinterpret_cast<const SharedBlobCacheHeader*>(mapping);
+    if (header->magic != kSharedMagic || header->version != kSharedVersion) {
+        ALOGE("SHARED: %s has bad magic (%u) or version (%u)", filename.c_str(), header->magic,
+              header->version);
+        munmap(mapping, fileSize);
+        return;
+    }
+
+    size_t indexOffset = getIndexOffset(driverId.size());
+    const char* fileDriverId = reinterpret_cast<const char*>(mapping + sizeof(*header));
+    if (header->driverIdLength != driverId.size() || indexOffset > fileSize ||
+        memcmp(fileDriverId, driverId.c_str(), driverId.size()) != 0) {
+        // The entries were produced by another driver, they are of no use to us.
+        ALOGV("SHARED: %s was written for another driver", filename.c_str());
+        munmap(mapping, fileSize);
+        return;
+    }
+
+    if (header->numEntries > (fileSize - indexOffset) / sizeof(SharedBlobCacheIndexEntry)) {
+        ALOGE("SHARED: %s is truncated, %u entries don't fit", filename.c_str(),
+              header->numEntries);
+        munmap(mapping, fileSize);
+        return;
+    }
+
+    mMapping = mapping;
+    mMappingSize = fileSize;
+    mIndex = reinterpret_cast<const SharedBlobCacheIndexEntry*>(mapping + indexOffset);
+    mNumEntries = header->numEntries;
+    mEntryStates.resize(mNumEntries, EntryState::Unchecked);
+
+    ALOGV("SHARED: Mapped %zu entries from %s", mNumEntries, filename.c_str());
+}
+
+SharedBlobCache::~SharedBlobCache() {
+    if (mMapping != nullptr) {
+        munmap(mMapping, mMappingSize);
+    }
+}
+
+EGLsizeiANDROID SharedBlobCache::get(const void* key, EGLsizeiANDROID keySize, void* value,
+                                     EGLsizeiANDROID valueSize) {
+    if (mMapping == nullptr || keySize <= 0 || valueSize < 0) {
+        return 0;
+    }
+
+    uint32_t hash = hashKey(key, keySize);
+    const SharedBlobCacheIndexEntry* end = mIndex + mNumEntries;
+    const SharedBlobCacheIndexEntry* it =
+            std::lower_bound(mIndex, end, hash,
+                             [](const SharedBlobCacheIndexEntry& entry, uint32_t target) {
+                                 return entry.hash < target;
+                             });
+
+    // Walk all the entries with this hash to handle collisions
+    for (; it != end && it->hash == hash; ++it) {
+        size_t index = it - mIndex;
+        if (it->keySize != static_cast<uint32_t>(keySize) || !validateEntry(index) ||
+            memcmp(mMapping + it->offset, key, keySize) != 0) {
+            continue;
+        }
+
+        ALOGV("SHARED: Cache HIT for entry %u", hash);
+        mStats.hits++;
+        if (it->valueSize <= static_cast<uint32_t>(valueSize)) {
+            memcpy(value, mMapping + it->offset + it->keySize, it->valueSize);
+        }
+        return it->valueSize;
+    }
+
+    ALOGV("SHARED: Cache MISS for entry %u", hash);
+    mStats.misses++;
+    return 0;
+}
+
+bool SharedBlobCache::validateEntry(size_t index) {
+    if (mEntryStates[index] == EntryState::Unchecked) {
+        const SharedBlobCacheIndexEntry& entry = mIndex[index];
+        // Use 64-bit math, the sizes come from the file
+        uint64_t entryEnd = uint64_t(entry.offset) + entry.keySize + entry.valueSize;
+        bool valid = entry.keySize > 0 && entryEnd <= mMappingSize &&
+                crc32c(mMapping + entry.offset, entry.keySize + entry.valueSize) == entry.crc;
+        if (!valid) {
+            ALOGE("SHARED: Entry %u failed validation, ignoring it", entry.hash);
+        }
+        mEntryStates[index] = valid ? EntryState::Valid : EntryState::Invalid;
+    }
+    return mEntryStates[index] == EntryState::Valid;
+}
+
+bool SharedBlobCache::write(const std::string& filename, const std::string& driverId,
+                            const std::vector<Entry>& entries) {
+    size_t indexOffset = getIndexOffset(driverId.size());
+    size_t dataOffset = indexOffset + entries.size() * sizeof(SharedBlobCacheIndexEntry);
+    size_t fileSize = dataOffset;
+    for (const Entry& entry : entries) {
+        if (entry.key.empty() || entry.value.empty()) {
+            ALOGE("SHARED: Refusing to write an entry with an empty key or value");
+            return false;
+        }
+        fileSize += entry.key.size() + entry.value.size();
+    }
+    if (fileSize > UINT32_MAX) {
+        ALOGE("SHARED: Entries are too large for a shared cache file (%zu)", fileSize);
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(fileSize, 0);
+    SharedBlobCacheHeader header = {kSharedMagic, kSharedVersion,
+                                    static_cast<uint32_t>(entries.size()),
+                                    static_cast<uint32_t>(driverId.size())};
+    memcpy(buffer.data(), &header, sizeof(header));
+    memcpy(buffer.data() + sizeof(header), driverId.c_str(), driverId.size());
+
+    std::vector<SharedBlobCacheIndexEntry> index;
+    index.reserve(entries.size());
+    size_t offset = dataOffset;
+    for (const Entry& entry : entries) {
+        uint8_t* data = buffer.data() + offset;
+        memcpy(data, entry.key.data(), entry.key.size());
+        memcpy(data + entry.key.size(), entry.value.data(), entry.value.size());
+        size_t entrySize = entry.key.size() + entry.value.size();
+        index.push_back({hashKey(entry.key.data(), entry.key.size()), crc32c(data, entrySize),
+                         static_cast<uint32_t>(offset), static_cast<uint32_t>(entry.key.size()),
+                         static_cast<uint32_t>(entry.value.size())});
+        offset += entrySize;
+    }
+    std::stable_sort(index.begin(), index.end(),
+                     [](const SharedBlobCacheIndexEntry& lhs,
+                        const SharedBlobCacheIndexEntry& rhs) { return lhs.hash < rhs.hash; });
+    memcpy(buffer.data() + indexOffset, index.data(),
+           index.size() * sizeof(SharedBlobCacheIndexEntry));
+
+    // Write to a temporary file and rename it over the old one, so that the
+    // mappings of processes still using the old file stay intact.
+    std::string tempPath = filename + ".tmp";
+    // Every process needs to be able to read the file.
+    int fd = open(tempPath.c_str(), O_CREAT | O_TRUNC | O_WRONLY,
+                  S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd == -1) {
+        ALOGE("SHARED: Failed to create %s, error: %s", tempPath.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    ssize_t result = ::write(fd, buffer.data(), buffer.size());
+    if (result != static_cast<ssize_t>(buffer.size()) || fsync(fd) != 0) {
+        ALOGE("SHARED: Failed to write %s, error: %s", tempPath.c_str(), std::strerror(errno));
+        close(fd);
+        unlink(tempPath.c_str());
+        return false;
+    }
+    close(fd);
+
+    if (rename(tempPath.c_str(), filename.c_str()) != 0) {
+        ALOGE("SHARED: Failed to rename %s to %s, error: %s", tempPath.c_str(), filename.c_str(),
+              std::strerror(errno));
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+}; // namespace android
@@ -0,0 +1,116 @@
+/*
+ ** Copyright 2023, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef ANDROID_SHARED_BLOB_CACHE_H
+#define ANDROID_SHARED_BLOB_CACHE_H
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+
+struct SharedBlobCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numEntries;
+    uint32_t driverIdLength;
+};
+
+// An index entry of a shared cache file. The index is sorted by hash.
+struct SharedBlobCacheIndexEntry {
+    uint32_t hash;
+    uint32_t crc;
+    // Offset of the key from the start of the file, the value follows the key.
+    uint32_t offset;
+    uint32_t keySize;
+    uint32_t valueSize;
+};
+
+struct SharedBlobCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+};
+
+// A SharedBlobCache is a read-only cache tier shared by all processes.
+//
+// The cache file is produced by a system component using write(), with
+// shaders that are common to many apps (system UI, WebView, Skia, ...).  Every
+// process maps the same file, so the entries are backed by a single copy in the
+// page cache.  The file layout is a SharedBlobCacheHeader, the driver id, the
+// index sorted by key hash and finally the keys and values, which lets lookups
+// binary search the mapping directly without building any per-process state.
+//
+// The entries are only used if they were produced for the driver the process
+// is running with, identified by an opaque driver id string.
+class SharedBlobCache {
+public:
+    // Map the shared cache file. If the file is missing, invalid or was
+    // written for another driver id, the cache stays empty.
+    SharedBlobCache(const std::string& filename, const std::string& driverId);
+    ~SharedBlobCache();
+
+    // Return true if entries were mapped from the shared cache file.
+    bool isValid() const { return mMapping != nullptr; }
+
+    // Look up the value for a key. Like MultifileBlobCache::get, this returns
+    // the size of the value if the key is found, even if the caller's buffer is
+    // too small to receive it, and 0 otherwise.
+    EGLsizeiANDROID get(const void* key, EGLsizeiANDROID keySize, void* value,
+                        EGLsizeiANDROID valueSize);
+
+    SharedBlobCacheStats getStats() const { return mStats; }
+
+    struct Entry {
+        std::vector<uint8_t> key;
+        std::vector<uint8_t> value;
+    };
+
+    // Write a shared cache file containing the given entries. This is meant to
+    // be used by the system component that populates the shared tier.  Keys are
+    // expected to be unique.  The file is replaced atomically, so processes that
+    // still map the previous version are not affected.
+    static bool write(const std::string& filename, const std::string& driverId,
+                      const std::vector<Entry>& entries);
+
+private:
+    enum class EntryState : uint8_t {
+        Unchecked,
+        Valid,
+        Invalid,
+    };
+
+    // Check the bounds and the CRC of an entry the first time it is used.
+    bool validateEntry(size_t index);
+
+    uint8_t* mMapping;
+    size_t mMappingSize;
+
+    // Points into mMapping
+    const SharedBlobCacheIndexEntry* mIndex;
+    size_t mNumEntries;
+
+    std::vector<EntryState> mEntryStates;
+    SharedBlobCacheStats mStats;
+};
+
+}; // namespace android
+
+#endif // ANDROID_SHARED_BLOB_CACHE_H
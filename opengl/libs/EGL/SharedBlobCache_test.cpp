@@ -0,0 +1,135 @@
+/*
+ ** Copyright 2023, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include "SharedBlobCache.h"
+
+#include <android-base/test_utils.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+namespace android {
+
+constexpr const char* kDriverId = "fingerprint/vendor/1.0";
+
+class SharedBlobCacheTest : public ::testing::Test {
+protected:
+    virtual void SetUp() { mTempFile.reset(new TemporaryFile()); }
+
+    virtual void TearDown() { mTempFile.reset(); }
+
+    static SharedBlobCache::Entry makeEntry(const std::string& key, const std::string& value) {
+        return {std::vector<uint8_t>(key.begin(), key.end()),
+                std::vector<uint8_t>(value.begin(), value.end())};
+    }
+
+    bool writeEntries(const std::vector<SharedBlobCache::Entry>& entries) {
+        return SharedBlobCache::write(&mTempFile->path[0], kDriverId, entries);
+    }
+
+    std::unique_ptr<TemporaryFile> mTempFile;
+};
+
+TEST_F(SharedBlobCacheTest, WrittenEntriesAreFound) {
+    ASSERT_TRUE(writeEntries({makeEntry("abcd", "efgh"), makeEntry("ij", "klmnop")}));
+    SharedBlobCache cache(&mTempFile->path[0], kDriverId);
+    ASSERT_TRUE(cache.isValid());
+
+    unsigned char buf[6] = {0xee, 0xee, 0xee, 0xee, 0xee, 0xee};
+    ASSERT_EQ(4, cache.get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ('h', buf[3]);
+    ASSERT_EQ(6, cache.get("ij", 2, buf, 6));
+    ASSERT_EQ('k', buf[0]);
+    ASSERT_EQ('p', buf[5]);
+    ASSERT_EQ(0, cache.get("qrst", 4, buf, 6));
+
+    SharedBlobCacheStats stats = cache.getStats();
+    ASSERT_EQ(2u, stats.hits);
+    ASSERT_EQ(1u, stats.misses);
+}
+
+TEST_F(SharedBlobCacheTest, GetOnlyWritesIfBufferIsLargeEnough) {
+    ASSERT_TRUE(writeEntries({makeEntry("abcd", "efgh")}));
+    SharedBlobCache cache(&mTempFile->path[0], kDriverId);
+
+    unsigned char buf[3] = {0xee, 0xee, 0xee};
+    ASSERT_EQ(4, cache.get("abcd", 4, buf, 3));
+    ASSERT_EQ(0xee, buf[0]);
+    ASSERT_EQ(4, cache.get("abcd", 4, nullptr, 0));
+}
+
+TEST_F(SharedBlobCacheTest, KeysMustMatchExactly) {
+    ASSERT_TRUE(writeEntries({makeEntry("abcd", "efgh")}));
+    SharedBlobCache cache(&mTempFile->path[0], kDriverId);
+
+    ASSERT_EQ(0, cache.get("abc", 3, nullptr, 0));
+    ASSERT_EQ(0, cache.get("abcde", 5, nullptr, 0));
+    ASSERT_EQ(0, cache.get("abce", 4, nullptr, 0));
+}
+
+TEST_F(SharedBlobCacheTest, OtherDriverEntriesAreIgnored) {
+    ASSERT_TRUE(writeEntries({makeEntry("abcd", "efgh")}));
+    SharedBlobCache cache(&mTempFile->path[0], "fingerprint/vendor/2.0");
+
+    ASSERT_FALSE(cache.isValid());
+    ASSERT_EQ(0, cache.get("abcd", 4, nullptr, 0));
+}
+
+TEST_F(SharedBlobCacheTest, MissingFileIsEmpty) {
+    SharedBlobCache cache(std::string(&mTempFile->path[0]) + ".missing", kDriverId);
+
+    ASSERT_FALSE(cache.isValid());
+    ASSERT_EQ(0, cache.get("abcd", 4, nullptr, 0));
+}
+
+TEST_F(SharedBlobCacheTest, CorruptEntryMisses) {
+    ASSERT_TRUE(writeEntries({makeEntry("abcd", "efgh"), makeEntry("ijkl", "mnop")}));
+
+    // Entries are stored in the order they were given, modify the last value.
+    struct stat st;
+    ASSERT_EQ(0, stat(&mTempFile->path[0], &st));
+    int fd = open(&mTempFile->path[0], O_WRONLY);
+    ASSERT_NE(-1, fd);
+    ASSERT_EQ(1, pwrite(fd, "X", 1, st.st_size - 1));
+    close(fd);
+
+    SharedBlobCache cache(&mTempFile->path[0], kDriverId);
+    ASSERT_EQ(4, cache.get("abcd", 4, nullptr, 0));
+    ASSERT_EQ(0, cache.get("ijkl", 4, nullptr, 0));
+}
+
+TEST_F(SharedBlobCacheTest, RewriteDoesntAffectExistingMappings) {
+    ASSERT_TRUE(writeEntries({makeEntry("abcd", "efgh")}));
+    SharedBlobCache oldCache(&mTempFile->path[0], kDriverId);
+
+    ASSERT_TRUE(writeEntries({makeEntry("ijkl", "mnop")}));
+    SharedBlobCache newCache(&mTempFile->path[0], kDriverId);
+
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    ASSERT_EQ(4, oldCache.get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ(0, newCache.get("abcd", 4, nullptr, 0));
+    ASSERT_EQ(4, newCache.get("ijkl", 4, buf, 4));
+    ASSERT_EQ('m', buf[0]);
+}
+
+} // namespace android
@@ -16,8 +16,11 @@
 
 #include <EGL/egl.h>
 #include <android-base/properties.h>
+#include <graphicsenv/GraphicsEnv.h>
 #include <log/log.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <utils/Timers.h>
 
 #include "../egl_impl.h"
 #include "CallStack.h"
@@ -160,6 +163,32 @@ EGLBoolean egl_init_drivers() {
     return res;
 }
 
+// Report how long the first eglGetDisplay of the process took, and whether the driver was loaded
+// by zygote. When zygote preloads the driver, children inherit it along with the resolved hooks
+// and eglGetDisplay doesn't need to go through the loader again.
+void egl_report_get_display_time(nsecs_t getDisplayTime) {
+    // Zygote calls eglGetDisplay too, compare pids so that forked children still report
+    static pid_t sReportedPid = 0;
+
+    const pid_t pid = getpid();
+    pthread_mutex_lock(&sInitDriverMutex);
+    const bool alreadyReported = sReportedPid == pid;
+    sReportedPid = pid;
+    const bool driverPreloaded = gEGLImpl.dso && gEGLImpl.loadingPid != pid;
+    pthread_mutex_unlock(&sInitDriverMutex);
+
+    if (alreadyReported) {
+        return;
+    }
+
+    if (driverPreloaded) {
+        android::GraphicsEnv::getInstance().setTargetStats(
+                android::GpuStatsInfo::Stats::GL_DRIVER_PRELOADED);
+    }
+    android::GraphicsEnv::getInstance().setTargetStats(
+            android::GpuStatsInfo::Stats::EGL_GET_DISPLAY_TIME, getDisplayTime);
+}
+
 static pthread_mutex_t sLogPrintMutex = PTHREAD_MUTEX_INITIALIZER;
 static std::chrono::steady_clock::time_point sLogPrintTime;
 static constexpr std::chrono::seconds DURATION(1);
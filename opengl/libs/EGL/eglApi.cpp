@@ -18,6 +18,7 @@
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
+#include <utils/Timers.h>
 
 #include "../egl_impl.h"
 #include "egl_layers.h"
@@ -30,6 +31,7 @@ using namespace android;
 namespace android {
 
 extern EGLBoolean egl_init_drivers();
+extern void egl_report_get_display_time(nsecs_t getDisplayTime);
 
 } // namespace android
 
@@ -39,6 +41,7 @@ static inline void clearError() {
 
 EGLDisplay eglGetDisplay(EGLNativeDisplayType display) {
     ATRACE_CALL();
+    const nsecs_t startTime = systemTime();
 
     if (egl_init_drivers() == EGL_FALSE) {
         return setError(EGL_BAD_PARAMETER, EGL_NO_DISPLAY);
@@ -48,12 +51,15 @@ EGLDisplay eglGetDisplay(EGLNativeDisplayType display) {
     // but may also be routed through layers
     clearError();
     egl_connection_t* const cnx = &gEGLImpl;
-    return cnx->platform.eglGetDisplay(display);
+    EGLDisplay dpy = cnx->platform.eglGetDisplay(display);
+    egl_report_get_display_time(systemTime() - startTime);
+    return dpy;
 }
 
 EGLDisplay eglGetPlatformDisplay(EGLenum platform, EGLNativeDisplayType display,
                                  const EGLAttrib* attrib_list) {
     ATRACE_CALL();
+    const nsecs_t startTime = systemTime();
 
     if (egl_init_drivers() == EGL_FALSE) {
         return setError(EGL_BAD_PARAMETER, EGL_NO_DISPLAY);
@@ -63,7 +69,9 @@ EGLDisplay eglGetPlatformDisplay(EGLenum platform, EGLNativeDisplayType display,
     // but may also be routed through layers
     clearError();
     egl_connection_t* const cnx = &gEGLImpl;
-    return cnx->platform.eglGetPlatformDisplay(platform, display, attrib_list);
+    EGLDisplay dpy = cnx->platform.eglGetPlatformDisplay(platform, display, attrib_list);
+    egl_report_get_display_time(systemTime() - startTime);
+    return dpy;
 }
 
 EGLBoolean eglInitialize(EGLDisplay dpy, EGLint* major, EGLint* minor) {
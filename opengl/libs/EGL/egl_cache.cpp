@@ -108,6 +108,13 @@ void egl_cache_t::initialize(egl_display_t* display) {
                       "%#x",
                       err);
             }
+
+            // Shaders are only interchangeable between identical builds of
+            // the same driver.
+            const char* vendor = display->disp.queryString.vendor;
+            const char* version = display->disp.queryString.version;
+            mDriverId = base::GetProperty("ro.build.fingerprint", "") + "/" +
+                    (vendor ? vendor : "") + "/" + (version ? version : "");
         }
     }
 
@@ -124,6 +131,11 @@ void egl_cache_t::terminate() {
         mMultifileBlobCache->finish();
     }
     mMultifileBlobCache = nullptr;
+    if (mInitialized) {
+        ALOGV("terminate: %" PRIu64 " cache hits, %" PRIu64 " misses (hit rate %.2f)",
+              mCacheStats.hits, mCacheStats.misses, mCacheStats.getHitRate());
+    }
+    mCacheStats = CacheStats();
     mInitialized = false;
 }
 
@@ -174,13 +186,20 @@ EGLsizeiANDROID egl_cache_t::getBlob(const void* key, EGLsizeiANDROID keySize, v
     updateMode();
 
     if (mInitialized) {
+        EGLsizeiANDROID result;
         if (mMultifileMode) {
             MultifileBlobCache* mbc = getMultifileBlobCacheLocked();
-            return mbc->get(key, keySize, value, valueSize);
+            result = mbc->get(key, keySize, value, valueSize);
         } else {
             BlobCache* bc = getBlobCacheLocked();
-            return bc->get(key, keySize, value, valueSize);
+            result = bc->get(key, keySize, value, valueSize);
+        }
+        if (result > 0) {
+            mCacheStats.hits++;
+        } else {
+            mCacheStats.misses++;
         }
+        return result;
     }
 
     return 0;
@@ -220,6 +239,20 @@ size_t egl_cache_t::getCacheSize() {
     return 0;
 }
 
+egl_cache_t::CacheStats egl_cache_t::getCacheStats() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    CacheStats stats = mCacheStats;
+    if (mMultifileBlobCache) {
+        stats.sharedHits = mMultifileBlobCache->getSharedCacheStats().hits;
+    }
+    return stats;
+}
+
+std::string egl_cache_t::getDriverId() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mDriverId;
+}
+
 void egl_cache_t::updateMode() {
     // We don't set the mode in the constructor because these checks have
     // a non-trivial cost, and not all processes that instantiate egl_cache_t
@@ -262,6 +295,19 @@ void egl_cache_t::updateMode() {
         }
 
         ALOGV("Using multifile EGL blobcache limit of %zu bytes", mCacheByteLimit);
+
+        // The shared tier is populated by the system, look it up where the
+        // device config says it lives
+        mSharedCacheFilename = base::GetProperty("ro.egl.blobcache.multifile_shared", "");
+
+        // Check for a debug value, "none" disables the shared cache
+        std::string debugSharedCache =
+                base::GetProperty("debug.egl.blobcache.multifile_shared", "");
+        if (!debugSharedCache.empty()) {
+            ALOGV("Overriding shared cache %s with %s from debug.egl.blobcache.multifile_shared",
+                  mSharedCacheFilename.c_str(), debugSharedCache.c_str());
+            mSharedCacheFilename = debugSharedCache == "none" ? "" : debugSharedCache;
+        }
     }
 }
 
@@ -278,6 +324,10 @@ MultifileBlobCache* egl_cache_t::getMultifileBlobCacheLocked() {
         mMultifileBlobCache.reset(new MultifileBlobCache(kMaxMultifileKeySize,
                                                          kMaxMultifileValueSize, mCacheByteLimit,
                                                          mFilename));
+        if (!mSharedCacheFilename.empty()) {
+            mMultifileBlobCache->setSharedCache(
+                    std::make_unique<SharedBlobCache>(mSharedCacheFilename, mDriverId));
+        }
     }
     return mMultifileBlobCache.get();
 }
@@ -79,6 +79,32 @@ public:
     // Return the byte total for cache file(s)
     size_t getCacheSize();
 
+    // CacheStats counts the getBlob lookups served by the cache since it was
+    // last terminated.  A lookup is a hit whenever a value was found for the
+    // key, even if the caller's buffer was too small to receive it.
+    struct CacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+
+        // sharedHits is the number of hits that were served by the read-only
+        // tier shared by all processes.  They are included in hits.
+        uint64_t sharedHits = 0;
+
+        // getHitRate returns the fraction of lookups that were hits, or 0 if
+        // there were no lookups.
+        float getHitRate() const {
+            const uint64_t lookups = hits + misses;
+            return lookups == 0 ? 0.0f : static_cast<float>(hits) / lookups;
+        }
+    };
+
+    // Return the lookup statistics of the cache
+    CacheStats getCacheStats();
+
+    // Return the driver id the entries of the shared cache tier must have been
+    // written with to be used by this process, see SharedBlobCache::write.
+    std::string getDriverId();
+
 private:
     // Creation and (the lack of) destruction is handled internally.
     egl_cache_t();
@@ -142,6 +168,18 @@ private:
 
     // Cache limit
     size_t mCacheByteLimit;
+
+    // mSharedCacheFilename is the file of the read-only tier shared by all
+    // processes, used in multifile mode.  An empty string disables it.
+    std::string mSharedCacheFilename;
+
+    // mDriverId identifies the driver the process runs with, entries of
+    // the shared tier are only used if they were produced by the same driver.
+    std::string mDriverId;
+
+    // mCacheStats holds the lookup statistics reported by getCacheStats.  It is
+    // updated by getBlob while the cache is initialized and reset by terminate.
+    CacheStats mCacheStats;
 };
 
 }; // namespace android
@@ -25,6 +25,8 @@
 #include <configstore/Utils.h>
 #include <dlfcn.h>
 #include <graphicsenv/GraphicsEnv.h>
+#include <inttypes.h>
+#include <sched.h>
 
 #include "../egl_impl.h"
 #include "EGL/eglext_angle.h"
@@ -79,6 +81,8 @@ egl_display_t egl_display_t::sDisplay[NUM_DISPLAYS];
 #else
 std::map<EGLDisplay, std::unique_ptr<egl_display_t>> egl_display_t::displayMap;
 std::mutex egl_display_t::displayMapLock;
+std::atomic<const egl_display_t::DisplaySnapshot*> egl_display_t::displaySnapshot{nullptr};
+std::vector<std::unique_ptr<const egl_display_t::DisplaySnapshot>> egl_display_t::displaySnapshots;
 #endif
 
 egl_display_t::egl_display_t()
@@ -86,7 +90,8 @@ egl_display_t::egl_display_t()
         finishOnSwap(false),
         traceGpuCompletion(false),
         refs(0),
-        eglIsInitialized(false) {}
+        eglIsInitialized(false),
+        dumpContention(false) {}
 
 egl_display_t::~egl_display_t() {
     magic = 0;
@@ -101,32 +106,149 @@ egl_display_t* egl_display_t::get(EGLDisplay dpy) {
 #ifdef EGL_DISPLAY_ARRAY
     uintptr_t index = uintptr_t(dpy) - 1U;
     if (index >= NUM_DISPLAYS || !sDisplay[index].isValid()) {
-#else
-    const std::lock_guard<std::mutex> lock(displayMapLock);
-    auto search = displayMap.find(dpy);
-    if (search == displayMap.end() || !search->second->isValid()) {
-#endif
         return nullptr;
     }
-#ifdef EGL_DISPLAY_ARRAY
     return &sDisplay[index];
 #else
-    return search->second.get();
+    const DisplaySnapshot* snapshot = displaySnapshot.load(std::memory_order_acquire);
+    if (snapshot) {
+        for (const auto& [key, display] : *snapshot) {
+            if (key == dpy) {
+                return display->isValid() ? display : nullptr;
+            }
+        }
+    }
+    return nullptr;
 #endif
 }
 
+std::unique_lock<std::mutex> egl_display_t::acquireLock(std::mutex& mutex, LockSite site) const {
+    LockStats& stats = mLockStats[site];
+    std::unique_lock<std::mutex> _l(mutex, std::try_to_lock);
+    if (!_l.owns_lock()) {
+        stats.contended.fetch_add(1, std::memory_order_relaxed);
+        _l.lock();
+    }
+    stats.acquired.fetch_add(1, std::memory_order_relaxed);
+    return _l;
+}
+
+size_t egl_display_t::getObjectSlotIndex(const egl_object_t* object) {
+    // objects are at least 8-byte aligned, so drop the low bits before mixing
+    uint64_t hash = uint64_t(uintptr_t(object) >> 3) * 0x9E3779B97F4A7C15ull;
+    return size_t(hash >> 32) % kObjectTableSize;
+}
+
+bool egl_display_t::getTableObject(egl_object_t* object) const {
+    size_t index = getObjectSlotIndex(object);
+    for (size_t probe = 0; probe < kObjectTableSize; probe++) {
+        ObjectSlot& slot = const_cast<ObjectSlot&>(mObjectTable[index]);
+        egl_object_t* const slotObject = slot.object.load(std::memory_order_acquire);
+        if (slotObject == nullptr) {
+            break;
+        }
+        if (slotObject == object) {
+            // the pin keeps removeObject from completing until we hold a reference
+            const uint32_t state = slot.state.fetch_add(1, std::memory_order_acq_rel);
+            const bool live = (state & kSlotLive) &&
+                    slot.object.load(std::memory_order_relaxed) == object;
+            if (live) {
+                object->incRef();
+            }
+            slot.state.fetch_sub(1, std::memory_order_release);
+            if (live) {
+                return true;
+            }
+            // a tombstone; the same address may have been added again further along
+        }
+        index = (index + 1) % kObjectTableSize;
+    }
+    return false;
+}
+
+bool egl_display_t::addTableObject(egl_object_t* object) {
+    size_t index = getObjectSlotIndex(object);
+    for (size_t probe = 0; probe < kObjectTableSize; probe++) {
+        ObjectSlot& slot = mObjectTable[index];
+        egl_object_t* const slotObject = slot.object.load(std::memory_order_relaxed);
+        if (slotObject == nullptr || !(slot.state.load(std::memory_order_relaxed) & kSlotLive)) {
+            if (slotObject == nullptr) {
+                if (mObjectTableUsed >= kObjectTableMaxUsed) {
+                    return false;
+                }
+                mObjectTableUsed++;
+            }
+            slot.object.store(object, std::memory_order_relaxed);
+            slot.state.fetch_or(kSlotLive, std::memory_order_release);
+            return true;
+        }
+        index = (index + 1) % kObjectTableSize;
+    }
+    return false;
+}
+
+void egl_display_t::unpublishSlot(ObjectSlot& slot) {
+    slot.state.fetch_and(~kSlotLive, std::memory_order_acq_rel);
+    // readers only hold a pin for the duration of an incRef()
+    while (slot.state.load(std::memory_order_acquire) & kSlotPinMask) {
+        sched_yield();
+    }
+}
+
+bool egl_display_t::removeTableObject(egl_object_t* object) {
+    size_t index = getObjectSlotIndex(object);
+    for (size_t probe = 0; probe < kObjectTableSize; probe++) {
+        ObjectSlot& slot = mObjectTable[index];
+        egl_object_t* const slotObject = slot.object.load(std::memory_order_relaxed);
+        if (slotObject == nullptr) {
+            return false;
+        }
+        if (slotObject == object && (slot.state.load(std::memory_order_relaxed) & kSlotLive)) {
+            unpublishSlot(slot);
+            // Tombstones that end a probe sequence are not needed to keep it intact, so empty
+            // them, walking back from the one just made.
+            if (mObjectTable[(index + 1) % kObjectTableSize].object.load(
+                        std::memory_order_relaxed) == nullptr) {
+                while (mObjectTable[index].object.load(std::memory_order_relaxed) != nullptr &&
+                       !(mObjectTable[index].state.load(std::memory_order_relaxed) &
+                         kSlotLive)) {
+                    mObjectTable[index].object.store(nullptr, std::memory_order_release);
+                    mObjectTableUsed--;
+                    index = (index + kObjectTableSize - 1) % kObjectTableSize;
+                }
+            }
+            return true;
+        }
+        index = (index + 1) % kObjectTableSize;
+    }
+    return false;
+}
+
 void egl_display_t::addObject(egl_object_t* object) {
-    std::lock_guard<std::mutex> _l(lock);
-    objects.insert(object);
+    std::unique_lock<std::mutex> _l = acquireLock(lock, LOCK_SITE_ADD_OBJECT);
+    if (!addTableObject(object)) {
+        objects.insert(object);
+        mFallbackObjectCount.store(objects.size(), std::memory_order_release);
+    }
 }
 
 void egl_display_t::removeObject(egl_object_t* object) {
-    std::lock_guard<std::mutex> _l(lock);
-    objects.erase(object);
+    std::unique_lock<std::mutex> _l = acquireLock(lock, LOCK_SITE_REMOVE_OBJECT);
+    if (!removeTableObject(object)) {
+        objects.erase(object);
+        mFallbackObjectCount.store(objects.size(), std::memory_order_release);
+    }
 }
 
 bool egl_display_t::getObject(egl_object_t* object) const {
-    std::lock_guard<std::mutex> _l(lock);
+    if (getTableObject(object)) {
+        // the table only holds objects of this display
+        return true;
+    }
+    if (mFallbackObjectCount.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    std::unique_lock<std::mutex> _l = acquireLock(lock, LOCK_SITE_GET_OBJECT);
     if (objects.find(object) != objects.end()) {
         if (object->getDisplay() == this) {
             object->incRef();
@@ -136,6 +258,24 @@ bool egl_display_t::getObject(egl_object_t* object) const {
     return false;
 }
 
+void egl_display_t::dump(std::string& result) const {
+    static const char* const sLockSiteNames[LOCK_SITE_COUNT] = {
+            "addObject",   "removeObject", "getObject", "makeCurrent",
+            "loseCurrent", "initialize",   "terminate",
+    };
+
+    char line[128];
+    snprintf(line, sizeof(line), "display %p: %zu table slots used, %zu fallback objects\n",
+             disp.dpy, mObjectTableUsed, mFallbackObjectCount.load(std::memory_order_relaxed));
+    result.append(line);
+    for (size_t site = 0; site < LOCK_SITE_COUNT; site++) {
+        snprintf(line, sizeof(line), "  %-12s acquired %" PRIu64 ", contended %" PRIu64 "\n",
+                 sLockSiteNames[site], mLockStats[site].acquired.load(std::memory_order_relaxed),
+                 mLockStats[site].contended.load(std::memory_order_relaxed));
+        result.append(line);
+    }
+}
+
 EGLDisplay egl_display_t::getFromNativeDisplay(EGLNativeDisplayType disp,
                                                const EGLAttrib* attrib_list) {
     if (uintptr_t(disp) >= NUM_DISPLAYS) return nullptr;
@@ -250,6 +390,14 @@ EGLDisplay egl_display_t::getPlatformDisplay(EGLNativeDisplayType display,
                 auto d = std::make_unique<egl_display_t>();
                 d->disp.dpy = dpy;
                 displayMap[dpy] = std::move(d);
+
+                auto snapshot = std::make_unique<DisplaySnapshot>();
+                snapshot->reserve(displayMap.size());
+                for (const auto& [key, display] : displayMap) {
+                    snapshot->emplace_back(key, display.get());
+                }
+                displaySnapshot.store(snapshot.get(), std::memory_order_release);
+                displaySnapshots.push_back(std::move(snapshot));
             }
             return dpy;
         }
@@ -265,7 +413,7 @@ EGLDisplay egl_display_t::getPlatformDisplay(EGLNativeDisplayType display,
 
 EGLBoolean egl_display_t::initialize(EGLint* major, EGLint* minor) {
     { // scope for refLock
-        std::unique_lock<std::mutex> _l(refLock);
+        std::unique_lock<std::mutex> _l = acquireLock(refLock, LOCK_SITE_INITIALIZE);
         refs++;
         if (refs > 1) {
             // We don't know what to report until we know what the
@@ -290,7 +438,7 @@ EGLBoolean egl_display_t::initialize(EGLint* major, EGLint* minor) {
     }
 
     { // scope for lock
-        std::lock_guard<std::mutex> _l(lock);
+        std::unique_lock<std::mutex> _l = acquireLock(lock, LOCK_SITE_INITIALIZE);
 
         setGLHooksThreadSpecific(&gHooksNoContext);
 
@@ -416,6 +564,7 @@ EGLBoolean egl_display_t::initialize(EGLint* major, EGLint* minor) {
 
         finishOnSwap = base::GetBoolProperty("debug.egl.finish", false);
         traceGpuCompletion = base::GetBoolProperty("debug.egl.traceGpuCompletion", false);
+        dumpContention = base::GetBoolProperty("debug.egl.dump_contention", false);
 
         // TODO: If device doesn't provide 1.4 or 1.5 then we'll be
         // changing the behavior from the past where we always advertise
@@ -436,7 +585,7 @@ EGLBoolean egl_display_t::initialize(EGLint* major, EGLint* minor) {
 
 EGLBoolean egl_display_t::terminate() {
     { // scope for refLock
-        std::unique_lock<std::mutex> _rl(refLock);
+        std::unique_lock<std::mutex> _rl = acquireLock(refLock, LOCK_SITE_TERMINATE);
         if (refs == 0) {
             /*
              * From the EGL spec (3.2):
@@ -457,7 +606,7 @@ EGLBoolean egl_display_t::terminate() {
     EGLBoolean res = EGL_FALSE;
 
     { // scope for lock
-        std::lock_guard<std::mutex> _l(lock);
+        std::unique_lock<std::mutex> _l = acquireLock(lock, LOCK_SITE_TERMINATE);
 
         egl_connection_t* const cnx = &gEGLImpl;
         if (cnx->dso && disp.state == egl_display_t::INITIALIZED) {
@@ -478,17 +627,37 @@ EGLBoolean egl_display_t::terminate() {
         // reinitialized.
         mExtensionString.clear();
 
+        if (dumpContention) {
+            std::string result;
+            dump(result);
+            ALOGD("eglTerminate() lock contention, %s", result.c_str());
+        }
+
+        // Unpublish all objects remaining in the table, which marks their handles as
+        // "terminated", before dropping the references of the table.
+        std::vector<egl_object_t*> remaining(objects.begin(), objects.end());
+        for (ObjectSlot& slot : mObjectTable) {
+            egl_object_t* const o = slot.object.load(std::memory_order_relaxed);
+            if (o && (slot.state.load(std::memory_order_relaxed) & kSlotLive)) {
+                unpublishSlot(slot);
+                remaining.push_back(o);
+            }
+        }
+        for (ObjectSlot& slot : mObjectTable) {
+            slot.object.store(nullptr, std::memory_order_relaxed);
+        }
+        mObjectTableUsed = 0;
+        objects.clear();
+        mFallbackObjectCount.store(0, std::memory_order_release);
+
         // Mark all objects remaining in the list as terminated, unless
         // there are no reference to them, it which case, we're free to
         // delete them.
-        size_t count = objects.size();
+        size_t count = remaining.size();
         ALOGW_IF(count, "eglTerminate() called w/ %zu objects remaining", count);
-        for (auto o : objects) {
+        for (auto o : remaining) {
             o->destroy();
         }
-
-        // this marks all object handles are "terminated"
-        objects.clear();
     }
 
     { // scope for refLock
@@ -517,7 +686,7 @@ void egl_display_t::loseCurrentImpl(egl_context_t* cur_c) {
     SurfaceRef _cur_d(cur_c ? get_surface(cur_c->draw) : nullptr);
 
     { // scope for the lock
-        std::lock_guard<std::mutex> _l(lock);
+        std::unique_lock<std::mutex> _l = acquireLock(lock, LOCK_SITE_LOSE_CURRENT);
         cur_c->onLooseCurrent();
     }
 
@@ -541,7 +710,7 @@ EGLBoolean egl_display_t::makeCurrent(egl_context_t* c, egl_context_t* cur_c, EG
     SurfaceRef _cur_d(cur_c ? get_surface(cur_c->draw) : nullptr);
 
     { // scope for the lock
-        std::lock_guard<std::mutex> _l(lock);
+        std::unique_lock<std::mutex> _l = acquireLock(lock, LOCK_SITE_MAKE_CURRENT);
         if (c) {
             result = c->cnx->egl.eglMakeCurrent(disp.dpy, impl_draw, impl_read, impl_ctx);
             if (result == EGL_TRUE) {
@@ -22,10 +22,14 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
 #ifndef EGL_DISPLAY_ARRAY
 #include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 #endif
 #include <mutex>
 #include <string>
@@ -49,6 +53,13 @@ class EGLAPI egl_display_t { // marked as EGLAPI for testing purposes
 #else
     static std::map<EGLDisplay, std::unique_ptr<egl_display_t>> displayMap;
     static std::mutex displayMapLock;
+
+    // Immutable copy of displayMap, which get() reads without taking displayMapLock. A new copy
+    // is published when a display is added. Displays are never removed, so the retired copies
+    // are kept rather than reclaimed, since a reader may still be walking them.
+    using DisplaySnapshot = std::vector<std::pair<EGLDisplay, egl_display_t*>>;
+    static std::atomic<const DisplaySnapshot*> displaySnapshot;
+    static std::vector<std::unique_ptr<const DisplaySnapshot>> displaySnapshots;
 #endif
     EGLDisplay getDisplay(EGLNativeDisplayType display);
 #ifdef EGL_DISPLAY_ARRAY
@@ -100,6 +111,10 @@ public:
 
     inline uint32_t getRefsCount() const { return refs; }
 
+    // appends the lock contention of this display, see debug.egl.dump_contention.
+    // must be called with lock held.
+    void dump(std::string& result) const;
+
     struct strings_t {
         char const* vendor;
         char const* version;
@@ -124,12 +139,64 @@ public:
     bool hasColorSpaceSupport;
 
 private:
+    // The call sites taking lock or refLock, whose contention is counted.
+    enum LockSite {
+        LOCK_SITE_ADD_OBJECT,
+        LOCK_SITE_REMOVE_OBJECT,
+        LOCK_SITE_GET_OBJECT,
+        LOCK_SITE_MAKE_CURRENT,
+        LOCK_SITE_LOSE_CURRENT,
+        LOCK_SITE_INITIALIZE,
+        LOCK_SITE_TERMINATE,
+        LOCK_SITE_COUNT
+    };
+
+    struct LockStats {
+        std::atomic<uint64_t> acquired{0};
+        std::atomic<uint64_t> contended{0};
+    };
+
+    // Objects are looked up in an open-addressed table of kObjectTableSize slots, so that
+    // validating a handle on every EGL call never takes lock. Only addObject, removeObject and
+    // terminate write to the table, with lock held.
+    //
+    // A slot is empty while its object is null. Otherwise, it holds a live object while
+    // kSlotLive is set in its state, and is a tombstone that keeps the probe sequence intact
+    // otherwise. Readers pin the slot by incrementing its state while taking a reference, and
+    // removeObject waits for the pins to drain after clearing kSlotLive, so a reader never takes
+    // a reference on an object that was removed.
+    //
+    // Once the table is kObjectTableMaxUsed full, objects fall back to the objects set, which is
+    // only read with lock held.
+    static constexpr size_t kObjectTableSize = 1024;
+    static constexpr size_t kObjectTableMaxUsed = kObjectTableSize / 4 * 3;
+    static constexpr uint32_t kSlotLive = 1u << 31;
+    static constexpr uint32_t kSlotPinMask = kSlotLive - 1;
+
+    struct ObjectSlot {
+        std::atomic<egl_object_t*> object{nullptr};
+        std::atomic<uint32_t> state{0};
+    };
+
+    std::unique_lock<std::mutex> acquireLock(std::mutex& mutex, LockSite site) const;
+
+    static size_t getObjectSlotIndex(const egl_object_t* object);
+    bool getTableObject(egl_object_t* object) const;
+    bool addTableObject(egl_object_t* object);
+    bool removeTableObject(egl_object_t* object);
+    void unpublishSlot(ObjectSlot& slot);
+
     uint32_t refs;
     bool eglIsInitialized;
+    bool dumpContention; // property: debug.egl.dump_contention
     mutable std::mutex lock;
     mutable std::mutex refLock;
     mutable std::condition_variable refCond;
     std::unordered_set<egl_object_t*> objects;
+    std::atomic<size_t> mFallbackObjectCount{0};
+    std::array<ObjectSlot, kObjectTableSize> mObjectTable;
+    size_t mObjectTableUsed = 0;
+    mutable std::array<LockStats, LOCK_SITE_COUNT> mLockStats;
     std::string mVendorString;
     std::string mVersionString;
     std::string mClientApiString;
@@ -18,6 +18,7 @@
 #define ANDROID_EGLDEFS_H
 
 #include <log/log.h>
+#include <sys/types.h>
 
 #include "../hooks.h"
 #include "egl_platform_entries.h"
@@ -42,7 +43,8 @@ struct egl_connection_t {
             libGles1(nullptr),
             libGles2(nullptr),
             systemDriverUnloaded(false),
-            angleLoaded(false) {
+            angleLoaded(false),
+            loadingPid(0) {
         const char* const* entries = platform_names;
         EGLFuncPointer* curr = reinterpret_cast<EGLFuncPointer*>(&platform);
         while (*entries) {
@@ -75,6 +77,8 @@ struct egl_connection_t {
 
     bool systemDriverUnloaded;
     bool angleLoaded; // Was ANGLE successfully loaded
+    // Process which loaded the driver. This is zygote for children inheriting a preloaded driver.
+    pid_t loadingPid;
 };
 
 extern gl_hooks_t gHooks[2];
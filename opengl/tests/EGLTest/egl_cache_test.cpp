@@ -92,6 +92,30 @@ TEST_P(EGLCacheTest, TerminatedCacheAlwaysMisses) {
     ASSERT_EQ(0xee, buf[3]);
 }
 
+TEST_P(EGLCacheTest, CacheStatsCountHitsAndMisses) {
+    uint8_t buf[4] = { 0xee, 0xee, 0xee, 0xee };
+    mCache->initialize(egl_display_t::get(EGL_DEFAULT_DISPLAY));
+    ASSERT_EQ(0u, mCache->getCacheStats().hits);
+    ASSERT_EQ(0u, mCache->getCacheStats().misses);
+
+    mCache->setBlob("abcd", 4, "efgh", 4);
+    ASSERT_EQ(4, mCache->getBlob("abcd", 4, buf, 4));
+    ASSERT_EQ(4, mCache->getBlob("abcd", 4, buf, 4));
+    ASSERT_EQ(0, mCache->getBlob("ijkl", 4, buf, 4));
+
+    egl_cache_t::CacheStats stats = mCache->getCacheStats();
+    ASSERT_EQ(2u, stats.hits);
+    ASSERT_EQ(1u, stats.misses);
+    ASSERT_FLOAT_EQ(2.0f / 3.0f, stats.getHitRate());
+
+    // Terminating the cache resets the statistics.
+    mCache->terminate();
+    stats = mCache->getCacheStats();
+    ASSERT_EQ(0u, stats.hits);
+    ASSERT_EQ(0u, stats.misses);
+    ASSERT_EQ(0.0f, stats.getHitRate());
+}
+
 TEST_P(EGLCacheTest, ReinitializedCacheContainsValues) {
     uint8_t buf[4] = { 0xee, 0xee, 0xee, 0xee };
     mCache->initialize(egl_display_t::get(EGL_DEFAULT_DISPLAY));
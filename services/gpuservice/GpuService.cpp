@@ -139,6 +139,35 @@ std::string GpuService::getUpdatableDriverPath() {
     return mDeveloperDriverPath;
 }
 
+status_t GpuService::getGpuMemSnapshot(std::vector<GpuMemInfo>* outGpuMemInfos) {
+    ATRACE_CALL();
+
+    IPCThreadState* ipc = IPCThreadState::self();
+    const int pid = ipc->getCallingPid();
+    const int uid = ipc->getCallingUid();
+
+    // The memory usage of other processes is as sensitive as the dumpsys output.
+    if (uid != AID_SYSTEM && uid != AID_SHELL &&
+        !PermissionCache::checkPermission(sDump, pid, uid)) {
+        ALOGE("Permission Denial: can't get gpu memory snapshot from pid=%d, uid=%d\n", pid, uid);
+        return PERMISSION_DENIED;
+    }
+
+    if (!mGpuMem->isInitialized()) return NO_INIT;
+
+    outGpuMemInfos->clear();
+    mGpuMem->traverseGpuMemUsage(
+            [outGpuMemInfos](uint32_t gpuId, uint32_t procPid, uint64_t size, uint64_t peakSize) {
+                GpuMemInfo info;
+                info.gpuId = gpuId;
+                info.pid = procPid;
+                info.size = size;
+                info.peakSize = peakSize;
+                outGpuMemInfos->push_back(info);
+            });
+    return OK;
+}
+
 status_t GpuService::shellCommand(int /*in*/, int out, int err, std::vector<String16>& args) {
     ATRACE_CALL();
 
@@ -32,6 +32,16 @@
 DEFINE_BPF_MAP_GRO(gpu_mem_total_map, HASH, uint64_t, uint64_t, GPU_MEM_TOTAL_MAP_SIZE,
                    AID_GRAPHICS);
 
+/*
+ * This map maintains the peak of the counters above since the process started using
+ * gpu memory, to tell leaks from transient spikes.
+ *
+ * The KEY and VAL are the same as gpu_mem_total_map. The tracepoint reports absolute
+ * totals rather than deltas, so a per-cpu map would not help here.
+ */
+DEFINE_BPF_MAP_GRO(gpu_mem_peak_map, HASH, uint64_t, uint64_t, GPU_MEM_TOTAL_MAP_SIZE,
+                   AID_GRAPHICS);
+
 /* This struct aligns with the fields offsets of the raw tracepoint format */
 struct gpu_mem_total_args {
     uint64_t ignore;
@@ -46,13 +56,14 @@ struct gpu_mem_total_args {
  * {KEY, VAL} pair used to update the corresponding bpf map.
  *
  * Pass AID_GRAPHICS as gid since gpuservice is in the graphics group.
- * Upon seeing size 0, the corresponding KEY needs to be cleaned up.
+ * Upon seeing size 0, the corresponding KEY needs to be cleaned up in both maps.
  */
 DEFINE_BPF_PROG("tracepoint/gpu_mem/gpu_mem_total", AID_ROOT, AID_GRAPHICS, tp_gpu_mem_total)
 (struct gpu_mem_total_args* args) {
     uint64_t key = 0;
     uint64_t cur_val = 0;
     uint64_t* prev_val = NULL;
+    uint64_t* peak_val = NULL;
 
     /* The upper 32 bits are for gpu_id while the lower is the pid */
     key = ((uint64_t)args->gpu_id << 32) | args->pid;
@@ -60,6 +71,7 @@ DEFINE_BPF_PROG("tracepoint/gpu_mem/gpu_mem_total", AID_ROOT, AID_GRAPHICS, tp_g
 
     if (!cur_val) {
         bpf_gpu_mem_total_map_delete_elem(&key);
+        bpf_gpu_mem_peak_map_delete_elem(&key);
         return 0;
     }
 
@@ -69,6 +81,13 @@ DEFINE_BPF_PROG("tracepoint/gpu_mem/gpu_mem_total", AID_ROOT, AID_GRAPHICS, tp_g
     } else {
         bpf_gpu_mem_total_map_update_elem(&key, &cur_val, BPF_NOEXIST);
     }
+
+    peak_val = bpf_gpu_mem_peak_map_lookup_elem(&key);
+    if (peak_val) {
+        if (cur_val > *peak_val) *peak_val = cur_val;
+    } else {
+        bpf_gpu_mem_peak_map_update_elem(&key, &cur_val, BPF_NOEXIST);
+    }
     return 0;
 }
 
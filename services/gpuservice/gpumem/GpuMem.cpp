@@ -28,6 +28,7 @@
 #include <utils/Timers.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <unordered_map>
 #include <vector>
 
@@ -74,6 +75,16 @@ void GpuMem::initialize() {
     }
     setGpuMemTotalMap(map);
 
+    // The peak map is only used for reporting, carry on without it.
+    errno = 0;
+    auto peakMap = bpf::BpfMapRO<uint64_t, uint64_t>(kGpuMemPeakMapPath);
+    if (peakMap.isValid()) {
+        setGpuMemPeakMap(peakMap);
+    } else {
+        ALOGW("Failed to create bpf map from %s [%d(%s)]", kGpuMemPeakMapPath, errno,
+              strerror(errno));
+    }
+
     mInitialized.store(true);
 }
 
@@ -81,6 +92,18 @@ void GpuMem::setGpuMemTotalMap(bpf::BpfMap<uint64_t, uint64_t>& map) {
     mGpuMemTotalMap = std::move(map);
 }
 
+void GpuMem::setGpuMemPeakMap(bpf::BpfMap<uint64_t, uint64_t>& map) {
+    mGpuMemPeakMap = std::move(map);
+}
+
+uint64_t GpuMem::readGpuMemPeak(uint64_t key, uint64_t size) {
+    if (!mGpuMemPeakMap.isValid()) return size;
+
+    auto res = mGpuMemPeakMap.readValue(key);
+    // The peak is updated after the total, it may lag behind for an instant.
+    return res.ok() ? std::max(res.value(), size) : size;
+}
+
 // Dump the snapshots of global and per process memory usage on all gpus
 void GpuMem::dump(const Vector<String16>& /* args */, std::string* result) {
     ATRACE_CALL();
@@ -96,8 +119,13 @@ void GpuMem::dump(const Vector<String16>& /* args */, std::string* result) {
         return;
     }
     uint64_t key = res.value();
-    // unordered_map<gpu_id, vector<pair<pid, size>>>
-    std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, uint64_t>>> dumpMap;
+    struct ProcMem {
+        uint32_t pid;
+        uint64_t size;
+        uint64_t peakSize;
+    };
+    // unordered_map<gpu_id, vector<ProcMem>>
+    std::unordered_map<uint32_t, std::vector<ProcMem>> dumpMap;
     while (true) {
         uint32_t gpu_id = key >> 32;
         uint32_t pid = key;
@@ -106,7 +134,7 @@ void GpuMem::dump(const Vector<String16>& /* args */, std::string* result) {
         if (!res.ok()) break;
         uint64_t size = res.value();
 
-        dumpMap[gpu_id].emplace_back(pid, size);
+        dumpMap[gpu_id].push_back({pid, size, readGpuMemPeak(key, size)});
 
         res = mGpuMemTotalMap.getNextKey(key);
         if (!res.ok()) break;
@@ -118,19 +146,28 @@ void GpuMem::dump(const Vector<String16>& /* args */, std::string* result) {
         StringAppendF(result, "Memory snapshot for GPU %u:\n", gpu.first);
 
         std::sort(gpu.second.begin(), gpu.second.end(),
-                  [](auto& l, auto& r) { return l.first < r.first; });
+                  [](auto& l, auto& r) { return l.pid < r.pid; });
 
         int i = 0;
-        if (gpu.second[0].first != 0) {
+        if (gpu.second[0].pid != 0) {
             StringAppendF(result, "Global total: N/A\n");
         } else {
-            StringAppendF(result, "Global total: %" PRIu64 "\n", gpu.second[0].second);
+            StringAppendF(result, "Global total: %" PRIu64 "\n", gpu.second[0].size);
             i++;
         }
+        uint64_t procsTotal = 0;
         for (; i < gpu.second.size(); i++) {
-            StringAppendF(result, "Proc %u total: %" PRIu64 "\n", gpu.second[i].first,
-                          gpu.second[i].second);
+            StringAppendF(result, "Proc %u total: %" PRIu64 "\n", gpu.second[i].pid,
+                          gpu.second[i].size);
+            if (mGpuMemPeakMap.isValid()) {
+                StringAppendF(result, "Proc %u peak: %" PRIu64 "\n", gpu.second[i].pid,
+                              gpu.second[i].peakSize);
+            }
+            procsTotal += gpu.second[i].size;
         }
+        // Memory the driver doesn't attribute to any process shows up as the difference between
+        // the global total and this one.
+        StringAppendF(result, "Sum of proc totals: %" PRIu64 "\n", procsTotal);
     }
 }
 
@@ -154,4 +191,25 @@ void GpuMem::traverseGpuMemTotals(const std::function<void(int64_t ts, uint32_t
     }
 }
 
+void GpuMem::traverseGpuMemUsage(const std::function<void(uint32_t gpuId, uint32_t pid,
+                                                          uint64_t size, uint64_t peakSize)>&
+                                         callback) {
+    auto res = mGpuMemTotalMap.getFirstKey();
+    if (!res.ok()) return;
+    uint64_t key = res.value();
+    while (true) {
+        uint32_t gpu_id = key >> 32;
+        uint32_t pid = key;
+
+        res = mGpuMemTotalMap.readValue(key);
+        if (!res.ok()) break;
+        uint64_t size = res.value();
+
+        callback(gpu_id, pid, size, readGpuMemPeak(key, size));
+        res = mGpuMemTotalMap.getNextKey(key);
+        if (!res.ok()) break;
+        key = res.value();
+    }
+}
+
 } // namespace android
@@ -38,6 +38,10 @@ public:
     // Traverse the gpu memory total map to feed the callback function.
     void traverseGpuMemTotals(const std::function<void(int64_t ts, uint32_t gpuId, uint32_t pid,
                                                        uint64_t size)>& callback);
+    // Traverse the gpu memory total map to feed the callback function with the total and the
+    // peak total of each entry. The peak is the total if it isn't tracked.
+    void traverseGpuMemUsage(const std::function<void(uint32_t gpuId, uint32_t pid, uint64_t size,
+                                                      uint64_t peakSize)>& callback);
 
 private:
     // Friend class for testing.
@@ -45,11 +49,17 @@ private:
 
     // set gpu memory total map
     void setGpuMemTotalMap(bpf::BpfMap<uint64_t, uint64_t>& map);
+    // set gpu memory peak map
+    void setGpuMemPeakMap(bpf::BpfMap<uint64_t, uint64_t>& map);
+    // read the peak total of a gpu memory total map entry
+    uint64_t readGpuMemPeak(uint64_t key, uint64_t size);
 
     // indicate whether ebpf has been initialized
     std::atomic<bool> mInitialized = false;
     // bpf map for GPU memory total data
     android::bpf::BpfMap<uint64_t, uint64_t> mGpuMemTotalMap;
+    // bpf map for GPU memory peak total data, optional
+    android::bpf::BpfMap<uint64_t, uint64_t> mGpuMemPeakMap;
 
     // gpu memory tracepoint event category
     static constexpr char kGpuMemTraceGroup[] = "gpu_mem";
@@ -60,6 +70,8 @@ private:
             "/sys/fs/bpf/prog_gpuMem_tracepoint_gpu_mem_gpu_mem_total";
     // pinned gpu memory total bpf map path in bpf sysfs
     static constexpr char kGpuMemTotalMapPath[] = "/sys/fs/bpf/map_gpuMem_gpu_mem_total_map";
+    // pinned gpu memory peak total bpf map path in bpf sysfs
+    static constexpr char kGpuMemPeakMapPath[] = "/sys/fs/bpf/map_gpuMem_gpu_mem_peak_map";
     // 30 seconds timeout for trying to attach bpf program to tracepoint
     static constexpr int kGpuWaitTimeout = 30;
 };
@@ -26,17 +26,38 @@
 #include <statslog.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <functional>
 #include <unordered_set>
 
 namespace android {
 
 GpuStats::~GpuStats() {
+    {
+        std::lock_guard<std::mutex> lock(mPurgeLock);
+        mStopPurging = true;
+    }
+    mPurgeCv.notify_one();
+    if (mPurgeThread.joinable()) {
+        mPurgeThread.join();
+    }
+
     if (mStatsdRegistered) {
         AStatsManager_clearPullAtomCallback(android::util::GPU_STATS_GLOBAL_INFO);
         AStatsManager_clearPullAtomCallback(android::util::GPU_STATS_APP_INFO);
     }
 }
 
+static size_t hashAppPackageName(const std::string& appPackageName) {
+    return std::hash<std::string>{}(appPackageName);
+}
+
+static size_t getAppStatsKey(size_t appPackageNameHash, uint64_t driverVersionCode) {
+    return appPackageNameHash ^
+            (std::hash<uint64_t>{}(driverVersionCode) + 0x9e3779b9 + (appPackageNameHash << 6) +
+             (appPackageNameHash >> 2));
+}
+
 static void addLoadingCount(GpuStatsInfo::Driver driver, bool isDriverLoaded,
                             GpuStatsGlobalInfo* const outGlobalInfo) {
     switch (driver) {
@@ -84,36 +105,93 @@ static void addLoadingTime(GpuStatsInfo::Driver driver, int64_t driverLoadingTim
     }
 }
 
+GpuStatsAppInfo* GpuStats::findAppStatsLocked(AppStatsShard& shard, size_t appStatsKey,
+                                              const std::string& appPackageName,
+                                              uint64_t driverVersionCode) {
+    auto [begin, end] = shard.appStats.equal_range(appStatsKey);
+    for (auto it = begin; it != end; ++it) {
+        if (it->second.driverVersionCode == driverVersionCode &&
+            it->second.appPackageName == appPackageName) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+void GpuStats::clearAppStats() {
+    for (AppStatsShard& shard : mAppStatsShards) {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        mNumAppRecords -= shard.appStats.size();
+        shard.appStats.clear();
+    }
+}
+
+void GpuStats::requestPurge() {
+    std::lock_guard<std::mutex> lock(mPurgeLock);
+    if (mStopPurging) {
+        return;
+    }
+    if (!mPurgeThread.joinable()) {
+        mPurgeThread = std::thread(&GpuStats::purgeLoop, this);
+    }
+    mPurgeRequested = true;
+    mPurgeCv.notify_one();
+}
+
+void GpuStats::purgeLoop() {
+    std::unique_lock<std::mutex> lock(mPurgeLock);
+    while (true) {
+        mPurgeCv.wait(lock, [this] { return mPurgeRequested || mStopPurging; });
+        if (mStopPurging) {
+            return;
+        }
+        mPurgeRequested = false;
+
+        lock.unlock();
+        while (mNumAppRecords > MAX_NUM_APP_RECORDS) {
+            ALOGV("GpuStatsAppInfo has reached maximum size. Removing old stats to make room.");
+            purgeOldDriverStats();
+        }
+        lock.lock();
+    }
+}
+
 void GpuStats::purgeOldDriverStats() {
-    ALOG_ASSERT(mAppStats.size() == MAX_NUM_APP_RECORDS);
+    ATRACE_CALL();
+
+    // The oldest apps can be in any shard, so hold all of them. Shards are always locked in
+    // index order.
+    std::array<std::unique_lock<std::mutex>, NUM_APP_STATS_SHARDS> locks;
+    for (size_t i = 0; i < NUM_APP_STATS_SHARDS; i++) {
+        locks[i] = std::unique_lock<std::mutex>(mAppStatsShards[i].lock);
+    }
 
     struct GpuStatsApp {
-        // Key is <app package name>+<driver version code>.
-        const std::string *appStatsKey = nullptr;
-        const std::chrono::time_point<std::chrono::system_clock> *lastAccessTime = nullptr;
+        AppStatsShard* shard;
+        std::unordered_multimap<size_t, GpuStatsAppInfo>::iterator appStats;
     };
-    std::vector<GpuStatsApp> gpuStatsApps(MAX_NUM_APP_RECORDS);
-
-    // Create a list of pointers to package names and their last access times.
-    int index = 0;
-    for (const auto & [appStatsKey, gpuStatsAppInfo] : mAppStats) {
-        GpuStatsApp &gpuStatsApp = gpuStatsApps[index];
-        gpuStatsApp.appStatsKey = &appStatsKey;
-        gpuStatsApp.lastAccessTime = &gpuStatsAppInfo.lastAccessTime;
-        ++index;
+    std::vector<GpuStatsApp> gpuStatsApps;
+    gpuStatsApps.reserve(mNumAppRecords);
+    for (AppStatsShard& shard : mAppStatsShards) {
+        for (auto it = shard.appStats.begin(); it != shard.appStats.end(); ++it) {
+            gpuStatsApps.push_back({&shard, it});
+        }
     }
 
-    // Sort the list with the oldest access times at the front.
-    std::sort(gpuStatsApps.begin(), gpuStatsApps.end(), [](GpuStatsApp a, GpuStatsApp b) -> bool {
-        return *a.lastAccessTime < *b.lastAccessTime;
-    });
-
-    // Remove the oldest packages from mAppStats to make room for new apps.
-    for (int i = 0; i < APP_RECORD_HEADROOM; ++i) {
-        mAppStats.erase(*gpuStatsApps[i].appStatsKey);
-        gpuStatsApps[i].appStatsKey = nullptr;
-        gpuStatsApps[i].lastAccessTime = nullptr;
+    // Move the oldest access times to the front.
+    const size_t numToRemove = gpuStatsApps.size() < APP_RECORD_HEADROOM ? gpuStatsApps.size()
+                                                                          : APP_RECORD_HEADROOM;
+    std::partial_sort(gpuStatsApps.begin(), gpuStatsApps.begin() + numToRemove,
+                      gpuStatsApps.end(), [](const GpuStatsApp& a, const GpuStatsApp& b) {
+                          return a.appStats->second.lastAccessTime <
+                                  b.appStats->second.lastAccessTime;
+                      });
+
+    // Remove the oldest packages to make room for new apps.
+    for (size_t i = 0; i < numToRemove; ++i) {
+        gpuStatsApps[i].shard->appStats.erase(gpuStatsApps[i].appStats);
     }
+    mNumAppRecords -= numToRemove;
 }
 
 void GpuStats::insertDriverStats(const std::string& driverPackageName,
@@ -123,7 +201,6 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
                                  bool isDriverLoaded, int64_t driverLoadingTime) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
     registerStatsdCallbacksIfNeeded();
     ALOGV("Received:\n"
           "\tdriverPackageName[%s]\n"
@@ -139,37 +216,43 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
           appPackageName.c_str(), vulkanVersion, static_cast<int32_t>(driver), isDriverLoaded,
           driverLoadingTime);
 
-    if (!mGlobalStats.count(driverVersionCode)) {
-        GpuStatsGlobalInfo globalInfo;
-        addLoadingCount(driver, isDriverLoaded, &globalInfo);
-        globalInfo.driverPackageName = driverPackageName;
-        globalInfo.driverVersionName = driverVersionName;
-        globalInfo.driverVersionCode = driverVersionCode;
-        globalInfo.driverBuildTime = driverBuildTime;
-        globalInfo.vulkanVersion = vulkanVersion;
-        mGlobalStats.insert({driverVersionCode, globalInfo});
-    } else {
-        addLoadingCount(driver, isDriverLoaded, &mGlobalStats[driverVersionCode]);
-    }
-
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-    if (!mAppStats.count(appStatsKey)) {
-        if (mAppStats.size() >= MAX_NUM_APP_RECORDS) {
-            ALOGV("GpuStatsAppInfo has reached maximum size. Removing old stats to make room.");
-            purgeOldDriverStats();
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (!mGlobalStats.count(driverVersionCode)) {
+            GpuStatsGlobalInfo globalInfo;
+            addLoadingCount(driver, isDriverLoaded, &globalInfo);
+            globalInfo.driverPackageName = driverPackageName;
+            globalInfo.driverVersionName = driverVersionName;
+            globalInfo.driverVersionCode = driverVersionCode;
+            globalInfo.driverBuildTime = driverBuildTime;
+            globalInfo.vulkanVersion = vulkanVersion;
+            mGlobalStats.insert({driverVersionCode, globalInfo});
+        } else {
+            addLoadingCount(driver, isDriverLoaded, &mGlobalStats[driverVersionCode]);
         }
+    }
 
-        GpuStatsAppInfo appInfo;
-        addLoadingTime(driver, driverLoadingTime, &appInfo);
-        appInfo.appPackageName = appPackageName;
-        appInfo.driverVersionCode = driverVersionCode;
-        appInfo.angleInUse = driverPackageName == "angle";
-        appInfo.lastAccessTime = std::chrono::system_clock::now();
-        mAppStats.insert({appStatsKey, appInfo});
-    } else {
-        mAppStats[appStatsKey].angleInUse = driverPackageName == "angle";
-        addLoadingTime(driver, driverLoadingTime, &mAppStats[appStatsKey]);
-        mAppStats[appStatsKey].lastAccessTime = std::chrono::system_clock::now();
+    const size_t appPackageNameHash = hashAppPackageName(appPackageName);
+    const size_t appStatsKey = getAppStatsKey(appPackageNameHash, driverVersionCode);
+    AppStatsShard& shard = mAppStatsShards[appPackageNameHash % NUM_APP_STATS_SHARDS];
+    bool purgeNeeded = false;
+    {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        GpuStatsAppInfo* appInfo =
+                findAppStatsLocked(shard, appStatsKey, appPackageName, driverVersionCode);
+        if (!appInfo) {
+            appInfo = &shard.appStats.emplace(appStatsKey, GpuStatsAppInfo())->second;
+            appInfo->appPackageName = appPackageName;
+            appInfo->driverVersionCode = driverVersionCode;
+            purgeNeeded = ++mNumAppRecords > MAX_NUM_APP_RECORDS;
+        }
+        appInfo->angleInUse = driverPackageName == "angle";
+        addLoadingTime(driver, driverLoadingTime, appInfo);
+        appInfo->lastAccessTime = std::chrono::system_clock::now();
+    }
+
+    if (purgeNeeded) {
+        requestPurge();
     }
 }
 
@@ -184,17 +267,20 @@ void GpuStats::insertTargetStatsArray(const std::string& appPackageName,
                                  const uint64_t* values, const uint32_t valueCount) {
     ATRACE_CALL();
 
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-
-    std::lock_guard<std::mutex> lock(mLock);
     registerStatsdCallbacksIfNeeded();
 
-    const auto foundApp = mAppStats.find(appStatsKey);
-    if (foundApp == mAppStats.end()) {
+    const size_t appPackageNameHash = hashAppPackageName(appPackageName);
+    const size_t appStatsKey = getAppStatsKey(appPackageNameHash, driverVersionCode);
+    AppStatsShard& shard = mAppStatsShards[appPackageNameHash % NUM_APP_STATS_SHARDS];
+
+    std::lock_guard<std::mutex> lock(shard.lock);
+    GpuStatsAppInfo* const foundApp =
+            findAppStatsLocked(shard, appStatsKey, appPackageName, driverVersionCode);
+    if (!foundApp) {
         return;
     }
 
-    GpuStatsAppInfo& targetAppStats = foundApp->second;
+    GpuStatsAppInfo& targetAppStats = *foundApp;
 
     if (stats == GpuStatsInfo::Stats::VULKAN_INSTANCE_EXTENSION
         || stats == GpuStatsInfo::Stats::VULKAN_DEVICE_EXTENSION) {
@@ -248,6 +334,24 @@ void GpuStats::insertTargetStatsArray(const std::string& appPackageName,
                     // Merge all requested feature bits together for this app
                     targetAppStats.vulkanDeviceFeaturesEnabled |= value;
                     break;
+                case GpuStatsInfo::Stats::GL_DRIVER_PRELOADED:
+                    targetAppStats.glDriverPreloaded = true;
+                    break;
+                case GpuStatsInfo::Stats::EGL_GET_DISPLAY_TIME:
+                    if (targetAppStats.eglGetDisplayTime.size() < MAX_NUM_LOADING_TIMES) {
+                        targetAppStats.eglGetDisplayTime.emplace_back(int64_t(value));
+                    }
+                    break;
+                case GpuStatsInfo::Stats::VULKAN_LAYER_DISCOVERY_TIME:
+                    if (targetAppStats.vkLayerDiscoveryTime.size() < MAX_NUM_LOADING_TIMES) {
+                        targetAppStats.vkLayerDiscoveryTime.emplace_back(int64_t(value));
+                    }
+                    break;
+                case GpuStatsInfo::Stats::VULKAN_SWAPCHAIN_CREATE_TIME:
+                    if (targetAppStats.vkSwapchainCreateTime.size() < MAX_NUM_LOADING_TIMES) {
+                        targetAppStats.vkSwapchainCreateTime.emplace_back(int64_t(value));
+                    }
+                    break;
                 default:
                     break;
             }
@@ -266,13 +370,13 @@ void GpuStats::interceptSystemDriverStatsLocked() {
 }
 
 void GpuStats::registerStatsdCallbacksIfNeeded() {
-    if (!mStatsdRegistered) {
+    std::call_once(mStatsdRegisterOnce, [this] {
         AStatsManager_setPullAtomCallback(android::util::GPU_STATS_GLOBAL_INFO, nullptr,
                                          GpuStats::pullAtomCallback, this);
         AStatsManager_setPullAtomCallback(android::util::GPU_STATS_APP_INFO, nullptr,
                                          GpuStats::pullAtomCallback, this);
         mStatsdRegistered = true;
-    }
+    });
 }
 
 void GpuStats::dump(const Vector<String16>& args, std::string* result) {
@@ -299,13 +403,13 @@ void GpuStats::dump(const Vector<String16>& args, std::string* result) {
 
     const bool dumpApp = argsSet.count("--app") != 0;
     if (dumpApp) {
-        dumpAppLocked(result);
+        dumpApp(result);
         dumpAll = false;
     }
 
     if (dumpAll) {
         dumpGlobalLocked(result);
-        dumpAppLocked(result);
+        dumpApp(result);
     }
 
     if (argsSet.count("--clear")) {
@@ -317,13 +421,13 @@ void GpuStats::dump(const Vector<String16>& args, std::string* result) {
         }
 
         if (dumpApp) {
-            mAppStats.clear();
+            clearAppStats();
             clearAll = false;
         }
 
         if (clearAll) {
             mGlobalStats.clear();
-            mAppStats.clear();
+            clearAppStats();
         }
     }
 }
@@ -337,10 +441,13 @@ void GpuStats::dumpGlobalLocked(std::string* result) {
     }
 }
 
-void GpuStats::dumpAppLocked(std::string* result) {
-    for (const auto& ele : mAppStats) {
-        result->append(ele.second.toString());
-        result->append("\n");
+void GpuStats::dumpApp(std::string* result) {
+    for (AppStatsShard& shard : mAppStatsShards) {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        for (const auto& ele : shard.appStats) {
+            result->append(ele.second.toString());
+            result->append("\n");
+        }
     }
 }
 
@@ -376,10 +483,17 @@ static std::string int64VectorToProtoByteString(const std::vector<int64_t>& valu
 AStatsManager_PullAtomCallbackReturn GpuStats::pullAppInfoAtom(AStatsEventList* data) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
+    for (AppStatsShard& shard : mAppStatsShards) {
+        // Take the stats out of the shard, so that apps don't wait while they are formatted.
+        std::unordered_multimap<size_t, GpuStatsAppInfo> appStats;
+        {
+            std::lock_guard<std::mutex> lock(shard.lock);
+            appStats.swap(shard.appStats);
+            mNumAppRecords -= appStats.size();
+        }
+        if (!data) continue;
 
-    if (data) {
-        for (const auto& ele : mAppStats) {
+        for (const auto& ele : appStats) {
             std::string glDriverBytes = int64VectorToProtoByteString(
                 ele.second.glDriverLoadingTime);
             std::string vkDriverBytes = int64VectorToProtoByteString(
@@ -412,20 +526,22 @@ AStatsManager_PullAtomCallbackReturn GpuStats::pullAppInfoAtom(AStatsEventList*
         }
     }
 
-    mAppStats.clear();
-
     return AStatsManager_PULL_SUCCESS;
 }
 
 AStatsManager_PullAtomCallbackReturn GpuStats::pullGlobalInfoAtom(AStatsEventList* data) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
-    // flush cpuVulkanVersion and glesVersion to builtin driver stats
-    interceptSystemDriverStatsLocked();
+    std::unordered_map<uint64_t, GpuStatsGlobalInfo> globalStats;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        // flush cpuVulkanVersion and glesVersion to builtin driver stats
+        interceptSystemDriverStatsLocked();
+        globalStats.swap(mGlobalStats);
+    }
 
     if (data) {
-        for (const auto& ele : mGlobalStats) {
+        for (const auto& ele : globalStats) {
           android::util::addAStatsEvent(
                   data,
                   android::util::GPU_STATS_GLOBAL_INFO,
@@ -445,8 +561,6 @@ AStatsManager_PullAtomCallbackReturn GpuStats::pullGlobalInfoAtom(AStatsEventLis
         }
     }
 
-    mGlobalStats.clear();
-
     return AStatsManager_PULL_SUCCESS;
 }
 
@@ -22,7 +22,11 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -52,8 +56,11 @@ public:
     // Below limits the memory usage of GpuStats to be less than 10KB. This is
     // the preferred number for statsd while maintaining nice data quality.
     static const size_t MAX_NUM_APP_RECORDS = 100;
-    // The number of apps to remove when mAppStats fills up.
+    // The number of apps to remove when the app stats fill up.
     static const size_t APP_RECORD_HEADROOM = 10;
+    // The app stats are split into independently locked shards by package name, so that apps
+    // starting in parallel rarely wait for each other.
+    static const size_t NUM_APP_STATS_SHARDS = 8;
 
 private:
     // Friend class for testing.
@@ -64,7 +71,24 @@ private:
                                                                  AStatsEventList* data,
                                                                  void* cookie);
 
-    // Remove old packages from mAppStats.
+    struct AppStatsShard {
+        std::mutex lock;
+        // Key is the hash of <app package name, driver version code>. The package name is only
+        // stored in GpuStatsAppInfo, which lookups compare against.
+        std::unordered_multimap<size_t, GpuStatsAppInfo> appStats;
+    };
+
+    // Returns the stats of the app in the shard, or nullptr. Requires shard.lock.
+    static GpuStatsAppInfo* findAppStatsLocked(AppStatsShard& shard, size_t appStatsKey,
+                                               const std::string& appPackageName,
+                                               uint64_t driverVersionCode);
+    // Remove all app stats.
+    void clearAppStats();
+
+    // Wakes up the purge thread, starting it if needed.
+    void requestPurge();
+    void purgeLoop();
+    // Remove old packages from the app stats.
     void purgeOldDriverStats();
 
     // Pull global into into global atom.
@@ -74,20 +98,30 @@ private:
     // Dump global stats
     void dumpGlobalLocked(std::string* result);
     // Dump app stats
-    void dumpAppLocked(std::string* result);
+    void dumpApp(std::string* result);
     // Append cpuVulkanVersion and glesVersion to system driver stats
     void interceptSystemDriverStatsLocked();
     // Registers statsd callbacks if they have not already been registered
     void registerStatsdCallbacksIfNeeded();
 
-    // GpuStats access should be guarded by mLock.
+    // Global stats access should be guarded by mLock.
     std::mutex mLock;
+    std::once_flag mStatsdRegisterOnce;
     // True if statsd callbacks have been registered.
-    bool mStatsdRegistered = false;
+    std::atomic<bool> mStatsdRegistered = false;
     // Key is driver version code.
     std::unordered_map<uint64_t, GpuStatsGlobalInfo> mGlobalStats;
-    // Key is <app package name>+<driver version code>.
-    std::unordered_map<std::string, GpuStatsAppInfo> mAppStats;
+    // Shard is chosen by the hash of the app package name.
+    std::array<AppStatsShard, NUM_APP_STATS_SHARDS> mAppStatsShards;
+    // Number of app stats across all shards.
+    std::atomic<size_t> mNumAppRecords = 0;
+
+    // Old app stats are purged on a separate thread, so that inserting stats never waits for it.
+    std::mutex mPurgeLock;
+    std::condition_variable mPurgeCv;
+    bool mPurgeRequested = false;
+    bool mStopPurging = false;
+    std::thread mPurgeThread;
 };
 
 } // namespace android
@@ -32,6 +32,8 @@
 #include <utils/Timers.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <array>
 #include <bit>
 #include <chrono>
 #include <cstdint>
@@ -46,6 +48,11 @@
 
 #define ONE_MS_IN_NS (10000000)
 
+static constexpr char kGpuWorkPeriodRingbufPath[] =
+        "/sys/fs/bpf/map_gpuWork_gpu_work_period_ringbuf";
+static constexpr char kGpuWorkPeriodStreamProgPath[] =
+        "/sys/fs/bpf/prog_gpuWork_tracepoint_power_gpu_work_period_stream";
+
 namespace android {
 namespace gpuwork {
 
@@ -89,6 +96,17 @@ inline int32_t bitcast_int32<uint32_t>(uint32_t source) {
     return result;
 }
 
+uint64_t streamedWorkKey(uint32_t gpuId, uint32_t uid) {
+    return (static_cast<uint64_t>(gpuId) << 32) | uid;
+}
+
+// Returns the log2 histogram bucket of a period with |activeDurationNs| of GPU
+// work; see |GpuWork::kNumActiveTimeBuckets|.
+size_t activeTimeBucket(uint64_t activeDurationNs, size_t numBuckets) {
+    const uint64_t activeDurationMs = activeDurationNs / 1000000;
+    return std::min(static_cast<size_t>(std::bit_width(activeDurationMs)), numBuckets - 1);
+}
+
 } // namespace
 
 using base::StringAppendF;
@@ -107,6 +125,12 @@ GpuWork::~GpuWork() {
         mMapClearerThread.join();
     }
 
+    // The consumer thread is only created after the clearer thread, and waits on
+    // the same condition variable.
+    if (mStreamConsumerThread.joinable()) {
+        mStreamConsumerThread.join();
+    }
+
     {
         std::scoped_lock<std::mutex> lock(mMutex);
         if (mStatsdRegistered) {
@@ -150,6 +174,8 @@ void GpuWork::initialize() {
 
     mMapClearerThread.swap(thread);
 
+    initializeStreaming();
+
     {
         std::lock_guard<std::mutex> lock(mMutex);
         AStatsManager_setPullAtomCallback(int32_t{android::util::GPU_WORK_PER_UID}, nullptr,
@@ -170,6 +196,7 @@ void GpuWork::dump(const Vector<String16>& /* args */, std::string* result) {
 
     // Ordered map ensures output data is sorted.
     std::map<GpuIdUid, UidTrackingInfo, decltype(lessThanGpuIdUid)*> dumpMap(&lessThanGpuIdUid);
+    std::map<uint64_t, std::array<uint64_t, kNumActiveTimeBuckets>> histogramMap;
 
     {
         std::lock_guard<std::mutex> lock(mMutex);
@@ -198,6 +225,11 @@ void GpuWork::dump(const Vector<String16>& /* args */, std::string* result) {
                     dumpMap[key] = value;
                     return {};
                 });
+
+        drainWorkPeriods();
+        for (const auto& [key, info] : mStreamedWork) {
+            histogramMap[key] = info.activeTimeHistogram;
+        }
     }
 
     // Dump work information.
@@ -221,6 +253,122 @@ void GpuWork::dump(const Vector<String16>& /* args */, std::string* result) {
                       idToUidInfo.second.total_active_duration_ns,
                       idToUidInfo.second.total_inactive_duration_ns);
     }
+
+    if (histogramMap.empty()) {
+        return;
+    }
+
+    // Dump the histograms of the active time of the streamed work periods.
+    // E.g.
+    // GPU work period active time histograms.
+    // gpu_id uid <1ms <2ms <4ms ... <512ms >=512ms
+    // 0 1003 12 4 1 0 0 0 0 0 0 0 0
+    result->append("GPU work period active time histograms.\ngpu_id uid <1ms");
+    for (size_t i = 1; i + 1 < kNumActiveTimeBuckets; ++i) {
+        StringAppendF(result, " <%dms", 1 << i);
+    }
+    StringAppendF(result, " >=%dms\n", 1 << (kNumActiveTimeBuckets - 2));
+
+    for (const auto& [key, histogram] : histogramMap) {
+        StringAppendF(result, "%" PRIu32 " %" PRIu32, static_cast<uint32_t>(key >> 32),
+                      static_cast<uint32_t>(key));
+        for (uint64_t count : histogram) {
+            StringAppendF(result, " %" PRIu64, count);
+        }
+        result->append("\n");
+    }
+}
+
+void GpuWork::initializeStreaming() {
+    // Streaming needs BPF ring buffers, which are only available from kernel
+    // 5.8. Without them, we keep pulling atoms from |mGpuWorkMap|.
+    auto ringbuf = BpfRingbuf<GpuWorkPeriod>::Create(kGpuWorkPeriodRingbufPath);
+    if (!ringbuf.ok()) {
+        ALOGI("GPU work period streaming is not available: %s",
+              ringbuf.error().message().c_str());
+        return;
+    }
+
+    if (!attachTracepoint(kGpuWorkPeriodStreamProgPath, "power", "gpu_work_period")) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mGpuWorkPeriodRingbuf = std::move(ringbuf.value());
+    }
+
+    std::thread thread([this]() { consumeWorkPeriods(); });
+    mStreamConsumerThread.swap(thread);
+}
+
+void GpuWork::consumeWorkPeriods() {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (!mIsTerminating) {
+        drainWorkPeriods();
+        mIsTerminatingConditionVariable.wait_for(lock,
+                                                 std::chrono::milliseconds{
+                                                         kStreamPollIntervalMs});
+    }
+}
+
+void GpuWork::drainWorkPeriods() {
+    if (!mGpuWorkPeriodRingbuf) {
+        return;
+    }
+
+    // The callback runs while we hold |mMutex|, but thread safety analysis
+    // cannot see that through the lambda.
+    auto& streamedWork = mStreamedWork;
+    std::unordered_set<uint64_t> updatedKeys;
+    auto result = mGpuWorkPeriodRingbuf->ConsumeAll([&](const GpuWorkPeriod& period) {
+        const uint64_t key = streamedWorkKey(period.gpu_id, period.uid);
+        StreamedUidInfo& info = streamedWork[key];
+        UidTrackingInfo& trackingInfo = info.trackingInfo;
+
+        // Same accounting as the |mGpuWorkMap| BPF program: gaps of up to 1
+        // second since the previous active period count as inactive time.
+        trackingInfo.total_active_duration_ns += period.total_active_duration_ns;
+        if (trackingInfo.previous_active_end_time_ns > period.start_time_ns) {
+            ++trackingInfo.error_count;
+        } else {
+            const uint64_t gapNs =
+                    period.start_time_ns - trackingInfo.previous_active_end_time_ns;
+            trackingInfo.previous_active_end_time_ns = period.end_time_ns;
+            if (gapNs <= kSmallTimeGapLimitNs) {
+                trackingInfo.total_inactive_duration_ns += gapNs;
+            }
+        }
+        const uint64_t periodDurationNs = period.end_time_ns - period.start_time_ns;
+        if (period.total_active_duration_ns > periodDurationNs) {
+            ++trackingInfo.error_count;
+        } else {
+            trackingInfo.total_inactive_duration_ns +=
+                    periodDurationNs - period.total_active_duration_ns;
+        }
+
+        ++info.activeTimeHistogram[activeTimeBucket(period.total_active_duration_ns,
+                                                    kNumActiveTimeBuckets)];
+        updatedKeys.insert(key);
+    });
+    if (!result.ok()) {
+        ALOGW("Failed to consume GPU work periods: %s", result.error().message().c_str());
+        return;
+    }
+
+    // Give every UID with new work its own counter track, so that traces show
+    // which apps are keeping the GPU busy.
+    if (ATRACE_ENABLED()) {
+        for (uint64_t key : updatedKeys) {
+            const std::string trackName =
+                    base::StringPrintf("GPU %" PRIu32 " UID %" PRIu32 " active ns",
+                                       static_cast<uint32_t>(key >> 32),
+                                       static_cast<uint32_t>(key));
+            ATRACE_INT64(trackName.c_str(),
+                         mStreamedWork[key].trackingInfo.total_active_duration_ns);
+        }
+    }
 }
 
 bool GpuWork::attachTracepoint(const char* programPath, const char* tracepointGroup,
@@ -291,12 +439,23 @@ AStatsManager_PullAtomCallbackReturn GpuWork::pullWorkAtoms(AStatsEventList* dat
     // the returned value is not being concurrently accessed by the BPF program
     // (no atomic reads needed below).
 
-    mGpuWorkMap.iterateWithValue([&workMap](const GpuIdUid& key, const UidTrackingInfo& value,
-                                            const android::bpf::BpfMap<GpuIdUid, UidTrackingInfo>&)
-                                         -> base::Result<void> {
-        workMap[key] = value;
-        return {};
-    });
+    if (mGpuWorkPeriodRingbuf) {
+        // When streaming, the work is already aggregated in |mStreamedWork|, so
+        // we only need the periods that were not consumed yet.
+        drainWorkPeriods();
+        for (const auto& [key, info] : mStreamedWork) {
+            workMap[GpuIdUid{static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key)}] =
+                    info.trackingInfo;
+        }
+    } else {
+        mGpuWorkMap.iterateWithValue(
+                [&workMap](const GpuIdUid& key, const UidTrackingInfo& value,
+                           const android::bpf::BpfMap<GpuIdUid, UidTrackingInfo>&)
+                        -> base::Result<void> {
+                    workMap[key] = value;
+                    return {};
+                });
+    }
 
     // Get a list of just the UIDs; the order does not matter.
     std::vector<Uid> uids;
@@ -519,6 +678,8 @@ void GpuWork::clearMap() {
     globalData.value().num_map_entries = 0;
     mGpuWorkGlobalDataMap.writeValue(0, globalData.value(), BPF_ANY);
 
+    mStreamedWork.clear();
+
     // Update |mPreviousMapClearTimePoint| so we know when we started collecting
     // the stats.
     mPreviousMapClearTimePoint = std::chrono::steady_clock::now();
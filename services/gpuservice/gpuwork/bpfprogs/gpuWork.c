@@ -28,6 +28,10 @@
 
 #define S_IN_NS (1000000000)
 #define SMALL_TIME_GAP_LIMIT_NS (S_IN_NS)
+// The size of |gpu_work_period_ringbuf| in bytes, which must be a power of two
+// multiple of the page size. This holds ~2000 periods, which user space drains
+// several times per second.
+#define GPU_WORK_PERIOD_RINGBUF_SIZE (64 * 1024)
 
 // A map from GpuIdUid (GPU ID and application UID) to |UidTrackingInfo|.
 DEFINE_BPF_MAP_GRW(gpu_work_map, HASH, GpuIdUid, UidTrackingInfo, kMaxTrackedGpuIdUids,
@@ -36,6 +40,12 @@ DEFINE_BPF_MAP_GRW(gpu_work_map, HASH, GpuIdUid, UidTrackingInfo, kMaxTrackedGpu
 // A map containing a single entry of |GlobalData|.
 DEFINE_BPF_MAP_GRW(gpu_work_global_data, ARRAY, uint32_t, GlobalData, 1, AID_GRAPHICS);
 
+// A ring buffer of |GpuWorkPeriod|s, so user space can consume work periods
+// incrementally instead of iterating |gpu_work_map|. Ring buffers need kernel
+// 5.8; on older kernels only |gpu_work_map| is available.
+DEFINE_BPF_RINGBUF(gpu_work_period_ringbuf, GpuWorkPeriod, GPU_WORK_PERIOD_RINGBUF_SIZE,
+                   AID_ROOT, AID_GRAPHICS, 0440);
+
 // Defines the structure of the kernel tracepoint:
 //
 //  /sys/kernel/tracing/events/power/gpu_work_period/
@@ -285,4 +295,34 @@ DEFINE_BPF_PROG("tracepoint/power/gpu_work_period", AID_ROOT, AID_GRAPHICS, tp_g
     return ALLOW;
 }
 
+// A second program on the same tracepoint that streams the valid periods to
+// |gpu_work_period_ringbuf|. It is a separate program so that |tp_gpu_work_period|
+// still loads on kernels without ring buffer support.
+DEFINE_BPF_PROG_KVER("tracepoint/power/gpu_work_period_stream", AID_ROOT, AID_GRAPHICS,
+                     tp_gpu_work_period_stream, KVER(5, 8, 0))
+(GpuWorkPeriodEvent* const period) {
+    // Return 1 to avoid blocking simpleperf from receiving events.
+    const int ALLOW = 1;
+
+    // Invalid periods are counted as errors by |tp_gpu_work_period|, and
+    // periods without GPU work have nothing to report.
+    if (period->start_time_ns >= period->end_time_ns ||
+        (period->end_time_ns - period->start_time_ns) > S_IN_NS ||
+        period->total_active_duration_ns == 0) {
+        return ALLOW;
+    }
+
+    GpuWorkPeriod work_period;
+    __builtin_memset(&work_period, 0, sizeof(work_period));
+    work_period.gpu_id = period->gpu_id;
+    work_period.uid = period->uid;
+    work_period.start_time_ns = period->start_time_ns;
+    work_period.end_time_ns = period->end_time_ns;
+    work_period.total_active_duration_ns = period->total_active_duration_ns;
+
+    // If user space falls behind, the period is dropped from the stream.
+    bpf_gpu_work_period_ringbuf_output(&work_period);
+    return ALLOW;
+}
+
 LICENSE("Apache 2.0");
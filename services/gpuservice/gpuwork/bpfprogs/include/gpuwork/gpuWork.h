@@ -63,6 +63,16 @@ typedef struct {
 // The maximum number of tracked GPU ID and UID pairs (|GpuIdUid|).
 static const uint32_t kMaxTrackedGpuIdUids = 512;
 
+// A valid GPU work period, as streamed to user space through the
+// |gpu_work_period_ringbuf| ring buffer.
+typedef struct {
+    uint32_t gpu_id;
+    uint32_t uid;
+    uint64_t start_time_ns;
+    uint64_t end_time_ns;
+    uint64_t total_active_duration_ns;
+} GpuWorkPeriod;
+
 #ifdef __cplusplus
 } // namespace gpuwork
 } // namespace android
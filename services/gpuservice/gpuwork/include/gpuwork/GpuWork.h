@@ -17,15 +17,19 @@
 #pragma once
 
 #include <bpf/BpfMap.h>
+#include <bpf/BpfRingbuf.h>
 #include <stats_pull_atom_callback.h>
 #include <utils/Mutex.h>
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <array>
 #include <condition_variable>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <thread>
+#include <unordered_map>
 
 #include "gpuwork/gpuWork.h"
 
@@ -69,9 +73,37 @@ private:
     // it.
     void clearMapIfNeeded() REQUIRES(mMutex);
 
-    // Clears the |mGpuWorkMap| map.
+    // Clears the |mGpuWorkMap| map, and the work aggregated from
+    // |mGpuWorkPeriodRingbuf|.
     void clearMap() REQUIRES(mMutex);
 
+    // Attaches the streaming BPF program and starts |mStreamConsumerThread|, if
+    // the kernel supports BPF ring buffers.
+    void initializeStreaming();
+
+    // Drains |mGpuWorkPeriodRingbuf| every |kStreamPollIntervalMs| until we are
+    // destructed.
+    //
+    // Thread safety analysis is skipped because we need to use
+    // |std::unique_lock|, which is not currently supported by thread safety
+    // analysis.
+    void consumeWorkPeriods() NO_THREAD_SAFETY_ANALYSIS;
+
+    // Consumes the periods available in |mGpuWorkPeriodRingbuf|.
+    void drainWorkPeriods() REQUIRES(mMutex);
+
+    // The number of buckets of |StreamedUidInfo::activeTimeHistogram|. Bucket 0
+    // counts the periods with less than 1ms of GPU work, bucket i the periods
+    // with [2^(i-1), 2^i) ms and the last bucket the longer ones; periods are
+    // at most 1 second.
+    static constexpr size_t kNumActiveTimeBuckets = 11;
+
+    // Work aggregated from the streamed periods of a GPU ID and UID pair.
+    struct StreamedUidInfo {
+        UidTrackingInfo trackingInfo = {};
+        std::array<uint64_t, kNumActiveTimeBuckets> activeTimeHistogram = {};
+    };
+
     // Waits for required permissions to become set. This seems to be needed
     // because platform service permissions might not be set when a service
     // first starts. See b/214085769.
@@ -93,8 +125,20 @@ private:
     // BPF map containing a single element for global data.
     bpf::BpfMap<uint32_t, GlobalData> mGpuWorkGlobalDataMap GUARDED_BY(mMutex);
 
-    // When true, we are being destructed, so |mMapClearerThread| should stop.
-    bool mIsTerminating GUARDED_BY(mMutex);
+    // Ring buffer of GPU work periods, only set if the kernel supports it.
+    std::unique_ptr<BpfRingbuf<GpuWorkPeriod>> mGpuWorkPeriodRingbuf GUARDED_BY(mMutex);
+
+    // A thread that consumes |mGpuWorkPeriodRingbuf|.
+    std::thread mStreamConsumerThread;
+
+    // Work aggregated incrementally from |mGpuWorkPeriodRingbuf|, keyed by
+    // (gpu_id << 32) | uid. When streaming, atoms are pulled from this instead
+    // of iterating |mGpuWorkMap|.
+    std::unordered_map<uint64_t, StreamedUidInfo> mStreamedWork GUARDED_BY(mMutex);
+
+    // When true, we are being destructed, so |mMapClearerThread| and
+    // |mStreamConsumerThread| should stop.
+    bool mIsTerminating GUARDED_BY(mMutex) = false;
 
     // A condition variable for |mIsTerminating|.
     std::condition_variable mIsTerminatingConditionVariable GUARDED_BY(mMutex);
@@ -106,6 +150,13 @@ private:
     // every ~1 hour.
     static constexpr uint32_t kMapClearerWaitDurationSeconds = 60 * 60;
 
+    // How often |mStreamConsumerThread| drains |mGpuWorkPeriodRingbuf|.
+    static constexpr uint32_t kStreamPollIntervalMs = 250;
+
+    // Gaps between streamed periods of up to this long count as inactive time,
+    // like |SMALL_TIME_GAP_LIMIT_NS| in the BPF program.
+    static constexpr uint64_t kSmallTimeGapLimitNs = 1000000000;
+
     // Whether our |pullAtomCallback| function is registered.
     bool mStatsdRegistered GUARDED_BY(mMutex) = false;
 
@@ -64,6 +64,7 @@ private:
     void setUpdatableDriverPath(const std::string& driverPath) override;
     std::string getUpdatableDriverPath() override;
     void toggleAngleAsSystemDriver(bool enabled) override;
+    status_t getGpuMemSnapshot(std::vector<GpuMemInfo>* outGpuMemInfos) override;
 
     /*
      * IBinder interface
@@ -40,6 +40,7 @@ constexpr uint64_t TEST_GLOBAL_KEY = 0;
 constexpr uint64_t TEST_GLOBAL_VAL = 123;
 constexpr uint64_t TEST_PROC_KEY_1 = 1;
 constexpr uint64_t TEST_PROC_VAL_1 = 234;
+constexpr uint64_t TEST_PROC_PEAK_1 = 456;
 constexpr uint64_t TEST_PROC_KEY_2 = 4294967298; // (1 << 32) + 2
 constexpr uint64_t TEST_PROC_VAL_2 = 345;
 constexpr uint32_t TEST_KEY_MASK = 0x1 | 0x2 | 0x4;
@@ -92,6 +93,7 @@ TEST_F(GpuMemTest, validGpuMemTotalBpfPaths) {
     EXPECT_EQ(mTestableGpuMem.getGpuMemTotalProgPath(),
               "/sys/fs/bpf/prog_gpuMem_tracepoint_gpu_mem_gpu_mem_total");
     EXPECT_EQ(mTestableGpuMem.getGpuMemTotalMapPath(), "/sys/fs/bpf/map_gpuMem_gpu_mem_total_map");
+    EXPECT_EQ(mTestableGpuMem.getGpuMemPeakMapPath(), "/sys/fs/bpf/map_gpuMem_gpu_mem_peak_map");
 }
 
 TEST_F(GpuMemTest, bpfInitializationFailed) {
@@ -137,6 +139,52 @@ TEST_F(GpuMemTest, procMemTotal) {
                                        TEST_PROC_VAL_2)));
 }
 
+TEST_F(GpuMemTest, procMemPeak) {
+    ASSERT_RESULT_OK(mTestMap.writeValue(TEST_GLOBAL_KEY, TEST_GLOBAL_VAL, BPF_ANY));
+    ASSERT_RESULT_OK(mTestMap.writeValue(TEST_PROC_KEY_1, TEST_PROC_VAL_1, BPF_ANY));
+    mTestableGpuMem.setGpuMemTotalMap(mTestMap);
+    auto peakMap = bpf::BpfMap<uint64_t, uint64_t>(BPF_MAP_TYPE_HASH, TEST_MAP_SIZE,
+                                                    BPF_F_NO_PREALLOC);
+    ASSERT_TRUE(peakMap.isValid());
+    ASSERT_RESULT_OK(peakMap.writeValue(TEST_PROC_KEY_1, TEST_PROC_PEAK_1, BPF_ANY));
+    mTestableGpuMem.setGpuMemPeakMap(peakMap);
+
+    EXPECT_THAT(dumpsys(),
+                HasSubstr(StringPrintf("Proc %u peak: %" PRIu64 "\n", (uint32_t)TEST_PROC_KEY_1,
+                                       TEST_PROC_PEAK_1)));
+    EXPECT_THAT(dumpsys(),
+                HasSubstr(StringPrintf("Sum of proc totals: %" PRIu64 "\n", TEST_PROC_VAL_1)));
+}
+
+TEST_F(GpuMemTest, traverseGpuMemUsage) {
+    ASSERT_RESULT_OK(mTestMap.writeValue(TEST_PROC_KEY_1, TEST_PROC_VAL_1, BPF_ANY));
+    ASSERT_RESULT_OK(mTestMap.writeValue(TEST_PROC_KEY_2, TEST_PROC_VAL_2, BPF_ANY));
+    mTestableGpuMem.setGpuMemTotalMap(mTestMap);
+    auto peakMap = bpf::BpfMap<uint64_t, uint64_t>(BPF_MAP_TYPE_HASH, TEST_MAP_SIZE,
+                                                    BPF_F_NO_PREALLOC);
+    ASSERT_TRUE(peakMap.isValid());
+    ASSERT_RESULT_OK(peakMap.writeValue(TEST_PROC_KEY_1, TEST_PROC_PEAK_1, BPF_ANY));
+    mTestableGpuMem.setGpuMemPeakMap(peakMap);
+
+    uint32_t count = 0;
+    mGpuMem->traverseGpuMemUsage([&count](uint32_t gpuId, uint32_t pid, uint64_t size,
+                                          uint64_t peakSize) {
+        const uint64_t key = ((uint64_t)gpuId << 32) | pid;
+        if (key == TEST_PROC_KEY_1) {
+            EXPECT_EQ(size, TEST_PROC_VAL_1);
+            EXPECT_EQ(peakSize, TEST_PROC_PEAK_1);
+        } else {
+            // Entries without a peak report their total as the peak.
+            EXPECT_EQ(key, TEST_PROC_KEY_2);
+            EXPECT_EQ(size, TEST_PROC_VAL_2);
+            EXPECT_EQ(peakSize, TEST_PROC_VAL_2);
+        }
+        count++;
+    });
+
+    EXPECT_EQ(count, 2u);
+}
+
 TEST_F(GpuMemTest, traverseGpuMemTotals) {
     ASSERT_RESULT_OK(mTestMap.writeValue(TEST_GLOBAL_KEY, TEST_GLOBAL_VAL, BPF_ANY));
     ASSERT_RESULT_OK(mTestMap.writeValue(TEST_PROC_KEY_1, TEST_PROC_VAL_1, BPF_ANY));
@@ -32,6 +32,10 @@ public:
         mGpuMem->setGpuMemTotalMap(map);
     }
 
+    void setGpuMemPeakMap(bpf::BpfMap<uint64_t, uint64_t>& map) {
+        mGpuMem->setGpuMemPeakMap(map);
+    }
+
     std::string getGpuMemTraceGroup() { return mGpuMem->kGpuMemTraceGroup; }
 
     std::string getGpuMemTotalTracepoint() { return mGpuMem->kGpuMemTotalTracepoint; }
@@ -40,6 +44,8 @@ public:
 
     std::string getGpuMemTotalMapPath() { return mGpuMem->kGpuMemTotalMapPath; }
 
+    std::string getGpuMemPeakMapPath() { return mGpuMem->kGpuMemPeakMapPath; }
+
 private:
     GpuMem *mGpuMem;
 };
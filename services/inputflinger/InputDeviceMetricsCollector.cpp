@@ -19,6 +19,8 @@
 
 #include "KeyCodeClassifications.h"
 
+#include <algorithm>
+
 #include <android-base/stringprintf.h>
 #include <input/PrintTools.h>
 #include <linux/input.h>
@@ -104,6 +106,52 @@ class : public InputDeviceMetricsLogger {
     }
 } sStatsdLogger;
 
+size_t toIndex(InputDeviceUsageSource source) {
+    return static_cast<size_t>(ftl::to_underlying(source));
+}
+
+InputDeviceUsageSource getUsageSourceForPointer(uint32_t source, ToolType toolType) {
+    if (isFromSource(source, AINPUT_SOURCE_MOUSE)) {
+        if (toolType == ToolType::MOUSE) {
+            return InputDeviceUsageSource::MOUSE;
+        }
+        if (toolType == ToolType::FINGER) {
+            return InputDeviceUsageSource::TOUCHPAD;
+        }
+        if (isStylusToolType(toolType)) {
+            return InputDeviceUsageSource::STYLUS_INDIRECT;
+        }
+    }
+    if (isFromSource(source, AINPUT_SOURCE_MOUSE_RELATIVE) && toolType == ToolType::MOUSE) {
+        return InputDeviceUsageSource::MOUSE_CAPTURED;
+    }
+    if (isFromSource(source, AINPUT_SOURCE_TOUCHPAD) && toolType == ToolType::FINGER) {
+        return InputDeviceUsageSource::TOUCHPAD_CAPTURED;
+    }
+    if (isFromSource(source, AINPUT_SOURCE_BLUETOOTH_STYLUS) && isStylusToolType(toolType)) {
+        return InputDeviceUsageSource::STYLUS_FUSED;
+    }
+    if (isFromSource(source, AINPUT_SOURCE_STYLUS) && isStylusToolType(toolType)) {
+        return InputDeviceUsageSource::STYLUS_DIRECT;
+    }
+    if (isFromSource(source, AINPUT_SOURCE_TOUCH_NAVIGATION)) {
+        return InputDeviceUsageSource::TOUCH_NAVIGATION;
+    }
+    if (isFromSource(source, AINPUT_SOURCE_JOYSTICK)) {
+        return InputDeviceUsageSource::JOYSTICK;
+    }
+    if (isFromSource(source, AINPUT_SOURCE_ROTARY_ENCODER)) {
+        return InputDeviceUsageSource::ROTARY_ENCODER;
+    }
+    if (isFromSource(source, AINPUT_SOURCE_TRACKBALL)) {
+        return InputDeviceUsageSource::TRACKBALL;
+    }
+    if (isFromSource(source, AINPUT_SOURCE_TOUCHSCREEN)) {
+        return InputDeviceUsageSource::TOUCHSCREEN;
+    }
+    return InputDeviceUsageSource::UNKNOWN;
+}
+
 bool isIgnoredInputDeviceId(int32_t deviceId) {
     switch (deviceId) {
         case INVALID_INPUT_DEVICE_ID:
@@ -144,61 +192,20 @@ std::set<InputDeviceUsageSource> getUsageSourcesForMotionArgs(const NotifyMotion
     std::set<InputDeviceUsageSource> sources;
 
     for (uint32_t i = 0; i < motionArgs.getPointerCount(); i++) {
-        const auto toolType = motionArgs.pointerProperties[i].toolType;
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_MOUSE)) {
-            if (toolType == ToolType::MOUSE) {
-                sources.emplace(InputDeviceUsageSource::MOUSE);
-                continue;
-            }
-            if (toolType == ToolType::FINGER) {
-                sources.emplace(InputDeviceUsageSource::TOUCHPAD);
-                continue;
-            }
-            if (isStylusToolType(toolType)) {
-                sources.emplace(InputDeviceUsageSource::STYLUS_INDIRECT);
-                continue;
-            }
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_MOUSE_RELATIVE) &&
-            toolType == ToolType::MOUSE) {
-            sources.emplace(InputDeviceUsageSource::MOUSE_CAPTURED);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_TOUCHPAD) &&
-            toolType == ToolType::FINGER) {
-            sources.emplace(InputDeviceUsageSource::TOUCHPAD_CAPTURED);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_BLUETOOTH_STYLUS) &&
-            isStylusToolType(toolType)) {
-            sources.emplace(InputDeviceUsageSource::STYLUS_FUSED);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_STYLUS) && isStylusToolType(toolType)) {
-            sources.emplace(InputDeviceUsageSource::STYLUS_DIRECT);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_TOUCH_NAVIGATION)) {
-            sources.emplace(InputDeviceUsageSource::TOUCH_NAVIGATION);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_JOYSTICK)) {
-            sources.emplace(InputDeviceUsageSource::JOYSTICK);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_ROTARY_ENCODER)) {
-            sources.emplace(InputDeviceUsageSource::ROTARY_ENCODER);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_TRACKBALL)) {
-            sources.emplace(InputDeviceUsageSource::TRACKBALL);
-            continue;
-        }
-        if (isFromSource(motionArgs.source, AINPUT_SOURCE_TOUCHSCREEN)) {
-            sources.emplace(InputDeviceUsageSource::TOUCHSCREEN);
-            continue;
-        }
-        sources.emplace(InputDeviceUsageSource::UNKNOWN);
+        sources.emplace(getUsageSourceForPointer(motionArgs.source,
+                                                 motionArgs.pointerProperties[i].toolType));
+    }
+
+    return sources;
+}
+
+InputDeviceUsageSourceSet getUsageSourceSetForMotionArgs(const NotifyMotionArgs& motionArgs) {
+    LOG_ALWAYS_FATAL_IF(motionArgs.getPointerCount() < 1, "Received motion args without pointers");
+    InputDeviceUsageSourceSet sources;
+
+    for (uint32_t i = 0; i < motionArgs.getPointerCount(); i++) {
+        sources.set(toIndex(getUsageSourceForPointer(motionArgs.source,
+                                                     motionArgs.pointerProperties[i].toolType)));
     }
 
     return sources;
@@ -233,7 +240,7 @@ void InputDeviceMetricsCollector::notifyConfigurationChanged(
 void InputDeviceMetricsCollector::notifyKey(const NotifyKeyArgs& args) {
     reportCompletedSessions();
     const SourceProvider getSources = [&args](const InputDeviceInfo& info) {
-        return std::set{getUsageSourceForKeyArgs(info, args)};
+        return InputDeviceUsageSourceSet().set(toIndex(getUsageSourceForKeyArgs(info, args)));
     };
     onInputDeviceUsage(DeviceId{args.deviceId}, nanoseconds(args.eventTime), getSources);
 
@@ -243,7 +250,7 @@ void InputDeviceMetricsCollector::notifyKey(const NotifyKeyArgs& args) {
 void InputDeviceMetricsCollector::notifyMotion(const NotifyMotionArgs& args) {
     reportCompletedSessions();
     onInputDeviceUsage(DeviceId{args.deviceId}, nanoseconds(args.eventTime),
-                       [&args](const auto&) { return getUsageSourcesForMotionArgs(args); });
+                       [&args](const auto&) { return getUsageSourceSetForMotionArgs(args); });
 
     mNextListener.notify(args);
 }
@@ -279,7 +286,7 @@ void InputDeviceMetricsCollector::notifyDeviceInteraction(int32_t deviceId, nsec
     if (isIgnoredInputDeviceId(deviceId)) {
         return;
     }
-    mInteractionsQueue.push(DeviceId{deviceId}, timestamp, uids);
+    mInteractionsQueue.push(DeviceId{deviceId}, nanoseconds(timestamp), uids);
 }
 
 void InputDeviceMetricsCollector::dump(std::string& dump) {
@@ -335,9 +342,13 @@ void InputDeviceMetricsCollector::onInputDeviceUsage(DeviceId deviceId, nanoseco
 
     auto [sessionIt, _] =
             mActiveUsageSessions.try_emplace(deviceId, mUsageSessionTimeout, eventTime);
-    for (InputDeviceUsageSource source : getSources(infoIt->second)) {
-        sessionIt->second.recordUsage(eventTime, source);
+    const InputDeviceUsageSourceSet sources = getSources(infoIt->second);
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (sources.test(i)) {
+            sessionIt->second.recordUsage(eventTime, static_cast<InputDeviceUsageSource>(i));
+        }
     }
+    mNextExpiryTime = std::min(mNextExpiryTime, eventTime + mUsageSessionTimeout);
 }
 
 void InputDeviceMetricsCollector::onInputDeviceInteraction(const Interaction& interaction) {
@@ -347,6 +358,8 @@ void InputDeviceMetricsCollector::onInputDeviceInteraction(const Interaction& in
     }
 
     activeSessionIt->second.recordInteraction(interaction);
+    mNextExpiryTime =
+            std::min(mNextExpiryTime, std::get<nanoseconds>(interaction) + mUsageSessionTimeout);
 }
 
 void InputDeviceMetricsCollector::reportCompletedSessions() {
@@ -357,6 +370,9 @@ void InputDeviceMetricsCollector::reportCompletedSessions() {
     }
 
     const auto currentTime = mLogger.getCurrentTime();
+    if (currentTime < mNextExpiryTime) {
+        return;
+    }
     std::vector<DeviceId> completedUsageSessions;
 
     // Process usages for all active session to determine if any sessions have expired.
@@ -377,6 +393,11 @@ void InputDeviceMetricsCollector::reportCompletedSessions() {
         mLogger.logInputDeviceUsageReported(infoIt->second, activeSession.finishSession());
         mActiveUsageSessions.erase(activeSessionIt);
     }
+
+    mNextExpiryTime = nanoseconds::max();
+    for (const auto& [_, activeSession] : mActiveUsageSessions) {
+        mNextExpiryTime = std::min(mNextExpiryTime, activeSession.getNextExpiryTime());
+    }
 }
 
 // --- InputDeviceMetricsCollector::ActiveSession ---
@@ -389,10 +410,11 @@ void InputDeviceMetricsCollector::ActiveSession::recordUsage(nanoseconds eventTi
                                                              InputDeviceUsageSource source) {
     // We assume that event times for subsequent events are always monotonically increasing for each
     // input device.
-    auto [activeSourceIt, inserted] =
-            mActiveSessionsBySource.try_emplace(source, eventTime, eventTime);
-    if (!inserted) {
-        activeSourceIt->second.end = eventTime;
+    std::optional<UsageSession>& sourceSession = mActiveSessionsBySource[toIndex(source)];
+    if (sourceSession) {
+        sourceSession->end = eventTime;
+    } else {
+        sourceSession = UsageSession{eventTime, eventTime};
     }
     mDeviceSession.end = eventTime;
 }
@@ -416,17 +438,19 @@ void InputDeviceMetricsCollector::ActiveSession::recordInteraction(const Interac
 
 bool InputDeviceMetricsCollector::ActiveSession::checkIfCompletedAt(nanoseconds timestamp) {
     const auto sessionExpiryTime = timestamp - mUsageSessionTimeout;
-    std::vector<InputDeviceUsageSource> completedSourceSessionsForDevice;
-    for (auto& [source, session] : mActiveSessionsBySource) {
-        if (session.end <= sessionExpiryTime) {
-            completedSourceSessionsForDevice.emplace_back(source);
+    bool hasActiveSourceSessions = false;
+    for (size_t i = 0; i < mActiveSessionsBySource.size(); i++) {
+        std::optional<UsageSession>& session = mActiveSessionsBySource[i];
+        if (!session) {
+            continue;
+        }
+        if (session->end <= sessionExpiryTime) {
+            mSourceUsageBreakdown.emplace_back(static_cast<InputDeviceUsageSource>(i),
+                                               session->end - session->start);
+            session.reset();
+        } else {
+            hasActiveSourceSessions = true;
         }
-    }
-    for (InputDeviceUsageSource source : completedSourceSessionsForDevice) {
-        auto it = mActiveSessionsBySource.find(source);
-        const auto& [_, session] = *it;
-        mSourceUsageBreakdown.emplace_back(source, session.end - session.start);
-        mActiveSessionsBySource.erase(it);
     }
 
     std::vector<Uid> completedUidSessionsForDevice;
@@ -443,17 +467,34 @@ bool InputDeviceMetricsCollector::ActiveSession::checkIfCompletedAt(nanoseconds
     }
 
     // This active session has expired if there are no more active source sessions tracked.
-    return mActiveSessionsBySource.empty();
+    return !hasActiveSourceSessions;
+}
+
+nanoseconds InputDeviceMetricsCollector::ActiveSession::getNextExpiryTime() const {
+    nanoseconds earliestEnd = nanoseconds::max();
+    for (const std::optional<UsageSession>& session : mActiveSessionsBySource) {
+        if (session) {
+            earliestEnd = std::min(earliestEnd, session->end);
+        }
+    }
+    for (const auto& [_, session] : mActiveSessionsByUid) {
+        earliestEnd = std::min(earliestEnd, session.end);
+    }
+    return earliestEnd == nanoseconds::max() ? earliestEnd : earliestEnd + mUsageSessionTimeout;
 }
 
 InputDeviceMetricsLogger::DeviceUsageReport
 InputDeviceMetricsCollector::ActiveSession::finishSession() {
     const auto deviceUsageDuration = mDeviceSession.end - mDeviceSession.start;
 
-    for (const auto& [source, sourceSession] : mActiveSessionsBySource) {
-        mSourceUsageBreakdown.emplace_back(source, sourceSession.end - sourceSession.start);
+    for (size_t i = 0; i < mActiveSessionsBySource.size(); i++) {
+        std::optional<UsageSession>& sourceSession = mActiveSessionsBySource[i];
+        if (sourceSession) {
+            mSourceUsageBreakdown.emplace_back(static_cast<InputDeviceUsageSource>(i),
+                                               sourceSession->end - sourceSession->start);
+            sourceSession.reset();
+        }
     }
-    mActiveSessionsBySource.clear();
 
     for (const auto& [uid, uidSession] : mActiveSessionsByUid) {
         mUidUsageBreakdown.emplace_back(uid, uidSession.end - uidSession.start);
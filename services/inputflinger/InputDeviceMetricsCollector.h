@@ -18,15 +18,19 @@
 
 #include "InputListener.h"
 #include "NotifyArgs.h"
-#include "SyncQueue.h"
+#include "SpscQueue.h"
 
+#include <ftl/enum.h>
 #include <ftl/mixins.h>
 #include <gui/WindowInfo.h>
 #include <input/InputDevice.h>
 #include <statslog.h>
+#include <array>
+#include <bitset>
 #include <chrono>
 #include <functional>
 #include <map>
+#include <optional>
 #include <set>
 #include <vector>
 
@@ -41,7 +45,7 @@ class InputDeviceMetricsCollectorInterface : public InputListenerInterface {
 public:
     /**
      * Notify the metrics collector that there was an input device interaction with apps.
-     * Called from the InputDispatcher thread.
+     * Called from the InputDispatcher thread, and must not be called from any other thread.
      */
     virtual void notifyDeviceInteraction(int32_t deviceId, nsecs_t timestamp,
                                          const std::set<gui::Uid>& uids) = 0;
@@ -78,11 +82,16 @@ enum class InputDeviceUsageSource : int32_t {
     ftl_last = TRACKBALL,
 };
 
+/** A set of InputDeviceUsageSources, indexed by their values. */
+using InputDeviceUsageSourceSet =
+        std::bitset<ftl::to_underlying(InputDeviceUsageSource::ftl_last) + 1>;
+
 /** Returns the InputDeviceUsageSource that corresponds to the key event. */
 InputDeviceUsageSource getUsageSourceForKeyArgs(const InputDeviceInfo&, const NotifyKeyArgs&);
 
 /** Returns the InputDeviceUsageSources that correspond to the motion event. */
 std::set<InputDeviceUsageSource> getUsageSourcesForMotionArgs(const NotifyMotionArgs&);
+InputDeviceUsageSourceSet getUsageSourceSetForMotionArgs(const NotifyMotionArgs&);
 
 /** The logging interface for the metrics collector, injected for testing. */
 class InputDeviceMetricsLogger {
@@ -157,7 +166,8 @@ private:
     std::map<DeviceId, InputDeviceInfo> mLoggedDeviceInfos;
 
     using Interaction = std::tuple<DeviceId, std::chrono::nanoseconds, std::set<Uid>>;
-    SyncQueue<Interaction> mInteractionsQueue;
+    // Written by the dispatcher thread, and drained on every event without taking a lock.
+    SpscQueue<Interaction> mInteractionsQueue;
 
     class ActiveSession {
     public:
@@ -166,6 +176,8 @@ private:
         void recordUsage(std::chrono::nanoseconds eventTime, InputDeviceUsageSource source);
         void recordInteraction(const Interaction&);
         bool checkIfCompletedAt(std::chrono::nanoseconds timestamp);
+        // The earliest time at which checkIfCompletedAt can complete a source or uid session.
+        std::chrono::nanoseconds getNextExpiryTime() const;
         InputDeviceMetricsLogger::DeviceUsageReport finishSession();
 
     private:
@@ -177,7 +189,9 @@ private:
         const std::chrono::nanoseconds mUsageSessionTimeout;
         UsageSession mDeviceSession{};
 
-        std::map<InputDeviceUsageSource, UsageSession> mActiveSessionsBySource{};
+        // Indexed by source, so that recording the usage of a source takes constant time.
+        std::array<std::optional<UsageSession>, InputDeviceUsageSourceSet().size()>
+                mActiveSessionsBySource{};
         InputDeviceMetricsLogger::SourceUsageBreakdown mSourceUsageBreakdown{};
 
         std::map<Uid, UsageSession> mActiveSessionsByUid{};
@@ -187,9 +201,13 @@ private:
     // The input devices that currently have active usage sessions.
     std::map<DeviceId, ActiveSession> mActiveUsageSessions;
 
+    // No active session, nor any source or uid session in them, expires before this time, so
+    // until then, events skip looking for completed sessions.
+    std::chrono::nanoseconds mNextExpiryTime = std::chrono::nanoseconds::max();
+
     void onInputDevicesChanged(const std::vector<InputDeviceInfo>& infos);
     void onInputDeviceRemoved(DeviceId deviceId, const InputDeviceInfo& info);
-    using SourceProvider = std::function<std::set<InputDeviceUsageSource>(const InputDeviceInfo&)>;
+    using SourceProvider = std::function<InputDeviceUsageSourceSet(const InputDeviceInfo&)>;
     void onInputDeviceUsage(DeviceId deviceId, std::chrono::nanoseconds eventTime,
                             const SourceProvider& getSources);
     void onInputDeviceInteraction(const Interaction&);
@@ -69,7 +69,23 @@ NotifyMotionArgs::NotifyMotionArgs(
         int32_t edgeFlags, uint32_t pointerCount, const PointerProperties* pointerProperties,
         const PointerCoords* pointerCoords, float xPrecision, float yPrecision,
         float xCursorPosition, float yCursorPosition, nsecs_t downTime,
-        const std::vector<TouchVideoFrame>& videoFrames)
+        std::vector<TouchVideoFrame> videoFrames)
+      : NotifyMotionArgs(id, eventTime, readTime, deviceId, source, displayId, policyFlags, action,
+                         actionButton, flags, metaState, buttonState, classification, edgeFlags,
+                         std::vector<PointerProperties>(pointerProperties,
+                                                        pointerProperties + pointerCount),
+                         std::vector<PointerCoords>(pointerCoords, pointerCoords + pointerCount),
+                         xPrecision, yPrecision, xCursorPosition, yCursorPosition, downTime,
+                         std::move(videoFrames)) {}
+
+NotifyMotionArgs::NotifyMotionArgs(
+        int32_t id, nsecs_t eventTime, nsecs_t readTime, int32_t deviceId, uint32_t source,
+        int32_t displayId, uint32_t policyFlags, int32_t action, int32_t actionButton,
+        int32_t flags, int32_t metaState, int32_t buttonState, MotionClassification classification,
+        int32_t edgeFlags, std::vector<PointerProperties> pointerProperties,
+        std::vector<PointerCoords> pointerCoords, float xPrecision, float yPrecision,
+        float xCursorPosition, float yCursorPosition, nsecs_t downTime,
+        std::vector<TouchVideoFrame> videoFrames)
       : id(id),
         eventTime(eventTime),
         deviceId(deviceId),
@@ -83,18 +99,15 @@ NotifyMotionArgs::NotifyMotionArgs(
         buttonState(buttonState),
         classification(classification),
         edgeFlags(edgeFlags),
+        pointerProperties(std::move(pointerProperties)),
+        pointerCoords(std::move(pointerCoords)),
         xPrecision(xPrecision),
         yPrecision(yPrecision),
         xCursorPosition(xCursorPosition),
         yCursorPosition(yCursorPosition),
         downTime(downTime),
         readTime(readTime),
-        videoFrames(videoFrames) {
-    for (uint32_t i = 0; i < pointerCount; i++) {
-        this->pointerProperties.push_back(pointerProperties[i]);
-        this->pointerCoords.push_back(pointerCoords[i]);
-    }
-}
+        videoFrames(std::move(videoFrames)) {}
 
 static inline bool isCursorPositionEqual(float lhs, float rhs) {
     return (isnan(lhs) && isnan(rhs)) || lhs == rhs;
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <vector>
+
+namespace android {
+
+/**
+ * A lock-free FIFO queue with a fixed capacity, for one producer thread and one consumer thread.
+ *
+ * Unlike SyncQueue, neither side takes a lock, so the consumer can poll the queue on a hot path.
+ * Storage for all elements is allocated up front.
+ */
+template <class T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : mSlots(capacity) {}
+
+    /**
+     * Retrieve and remove the oldest object. Returns std::nullopt if the queue is empty.
+     * Must only be called from the consumer thread.
+     */
+    std::optional<T> pop() {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        if (head == mTail.load(std::memory_order_acquire)) {
+            return {};
+        }
+        std::optional<T>& slot = mSlots[head % mSlots.size()];
+        std::optional<T> t = std::move(slot);
+        slot.reset();
+        mHead.store(head + 1, std::memory_order_release);
+        return t;
+    }
+
+    /**
+     * Add a new object to the queue.
+     * Return true if an element was successfully added.
+     * Return false if the queue is full.
+     * Must only be called from the producer thread.
+     */
+    template <class... Args>
+    bool push(Args&&... args) {
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) == mSlots.size()) {
+            return false;
+        }
+        mSlots[tail % mSlots.size()].emplace(std::forward<Args>(args)...);
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<std::optional<T>> mSlots;
+    // The number of objects ever popped, written by the consumer.
+    std::atomic<size_t> mHead{0};
+    // The number of objects ever pushed, written by the producer.
+    std::atomic<size_t> mTail{0};
+};
+
+} // namespace android
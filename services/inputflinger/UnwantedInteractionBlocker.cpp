@@ -15,6 +15,7 @@
  */
 
 #define LOG_TAG "UnwantedInteractionBlocker"
+#define ATRACE_TAG ATRACE_TAG_INPUT
 #include "UnwantedInteractionBlocker.h"
 
 #include <android-base/stringprintf.h>
@@ -23,7 +24,9 @@
 #include <inttypes.h>
 #include <linux/input-event-codes.h>
 #include <linux/input.h>
+#include <pthread.h>
 #include <server_configurable_flags/get_flags.h>
+#include <utils/Trace.h>
 
 #include "ui/events/ozone/evdev/touch_filter/neural_stylus_palm_detection_filter.h"
 #include "ui/events/ozone/evdev/touch_filter/palm_model/onedevice_train_palm_detection_filter_model.h"
@@ -71,6 +74,11 @@ static const char* INPUT_NATIVE_BOOT = "input_native_boot";
  * 'true' (not case sensitive) or '1'. To disable, specify any other value.
  */
 static const char* PALM_REJECTION_ENABLED = "palm_rejection_enabled";
+/**
+ * Feature flag name. This flag determines whether the palm rejection model runs on its own thread
+ * instead of on the reader thread. To enable, specify 'true' (not case sensitive) or '1'.
+ */
+static const char* PALM_REJECTION_ASYNC = "palm_rejection_async";
 
 static std::string toLower(std::string s) {
     std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
@@ -99,6 +107,28 @@ static bool isPalmRejectionEnabled() {
     return false;
 }
 
+/**
+ * Return true if the palm rejection model should run on its own thread. Return false otherwise.
+ */
+static bool isAsyncPalmRejectionEnabled() {
+    std::string value = toLower(
+            server_configurable_flags::GetServerConfigurableFlag(INPUT_NATIVE_BOOT,
+                                                                 PALM_REJECTION_ASYNC, "0"));
+    return value == "1" || value == "true";
+}
+
+/**
+ * Return true if the palm rejector should not look at this event. Hover events, button events and
+ * scroll are not processed for now.
+ */
+static bool isIgnoredByPalmRejector(int32_t action) {
+    return action == AMOTION_EVENT_ACTION_HOVER_ENTER ||
+            action == AMOTION_EVENT_ACTION_HOVER_MOVE ||
+            action == AMOTION_EVENT_ACTION_HOVER_EXIT ||
+            action == AMOTION_EVENT_ACTION_BUTTON_PRESS ||
+            action == AMOTION_EVENT_ACTION_BUTTON_RELEASE || action == AMOTION_EVENT_ACTION_SCROLL;
+}
+
 static int getLinuxToolCode(ToolType toolType) {
     switch (toolType) {
         case ToolType::STYLUS:
@@ -323,11 +353,15 @@ std::vector<NotifyMotionArgs> cancelSuppressedPointers(
 }
 
 UnwantedInteractionBlocker::UnwantedInteractionBlocker(InputListenerInterface& listener)
-      : UnwantedInteractionBlocker(listener, isPalmRejectionEnabled()){};
+      : UnwantedInteractionBlocker(listener, isPalmRejectionEnabled(),
+                                   isAsyncPalmRejectionEnabled()){};
 
 UnwantedInteractionBlocker::UnwantedInteractionBlocker(InputListenerInterface& listener,
-                                                       bool enablePalmRejection)
-      : mQueuedListener(listener), mEnablePalmRejection(enablePalmRejection) {}
+                                                       bool enablePalmRejection,
+                                                       bool asyncPalmRejection)
+      : mQueuedListener(listener),
+        mEnablePalmRejection(enablePalmRejection),
+        mAsyncPalmRejection(asyncPalmRejection) {}
 
 void UnwantedInteractionBlocker::notifyConfigurationChanged(
         const NotifyConfigurationChangedArgs& args) {
@@ -360,15 +394,21 @@ void UnwantedInteractionBlocker::enqueueOutboundMotionLocked(const NotifyMotionA
     mQueuedListener.notifyMotion(args);
 }
 
-void UnwantedInteractionBlocker::notifyMotionLocked(const NotifyMotionArgs& args) {
-    auto it = mPalmRejectors.find(args.deviceId);
-    const bool sendToPalmRejector = it != mPalmRejectors.end() && isFromTouchscreen(args.source);
+template <typename T>
+static std::vector<NotifyMotionArgs> processWithPalmRejector(std::map<int32_t, T>& palmRejectors,
+                                                             const NotifyMotionArgs& args) {
+    auto it = palmRejectors.find(args.deviceId);
+    const bool sendToPalmRejector = it != palmRejectors.end() && isFromTouchscreen(args.source);
     if (!sendToPalmRejector) {
-        enqueueOutboundMotionLocked(args);
-        return;
+        return {args};
     }
+    return it->second.processMotion(args);
+}
 
-    std::vector<NotifyMotionArgs> processedArgs = it->second.processMotion(args);
+void UnwantedInteractionBlocker::notifyMotionLocked(const NotifyMotionArgs& args) {
+    std::vector<NotifyMotionArgs> processedArgs = mAsyncPalmRejection
+            ? processWithPalmRejector(mAsyncPalmRejectors, args)
+            : processWithPalmRejector(mPalmRejectors, args);
     for (const NotifyMotionArgs& loopArgs : processedArgs) {
         enqueueOutboundMotionLocked(loopArgs);
     }
@@ -388,16 +428,22 @@ void UnwantedInteractionBlocker::notifyVibratorState(const NotifyVibratorStateAr
     mQueuedListener.notifyVibratorState(args);
     mQueuedListener.flush();
 }
+template <typename T>
+static void resetPalmRejector(std::map<int32_t, T>& palmRejectors, int32_t deviceId) {
+    auto it = palmRejectors.find(deviceId);
+    if (it != palmRejectors.end()) {
+        AndroidPalmFilterDeviceInfo info = it->second.getPalmFilterDeviceInfo();
+        // Re-create the object instead of resetting it
+        palmRejectors.erase(it);
+        palmRejectors.emplace(deviceId, info);
+    }
+}
+
 void UnwantedInteractionBlocker::notifyDeviceReset(const NotifyDeviceResetArgs& args) {
     { // acquire lock
         std::scoped_lock lock(mLock);
-        auto it = mPalmRejectors.find(args.deviceId);
-        if (it != mPalmRejectors.end()) {
-            AndroidPalmFilterDeviceInfo info = it->second.getPalmFilterDeviceInfo();
-            // Re-create the object instead of resetting it
-            mPalmRejectors.erase(it);
-            mPalmRejectors.emplace(args.deviceId, info);
-        }
+        resetPalmRejector(mPalmRejectors, args.deviceId);
+        resetPalmRejector(mAsyncPalmRejectors, args.deviceId);
         mQueuedListener.notifyDeviceReset(args);
         mPreferStylusOverTouchBlocker.notifyDeviceReset(args);
     } // release lock
@@ -418,14 +464,9 @@ void UnwantedInteractionBlocker::notifyInputDevicesChanged(
     mQueuedListener.flush();
 }
 
-void UnwantedInteractionBlocker::onInputDevicesChanged(
-        const std::vector<InputDeviceInfo>& inputDevices) {
-    std::scoped_lock lock(mLock);
-    if (!mEnablePalmRejection) {
-        // Palm rejection is disabled. Don't create any palm rejector objects.
-        return;
-    }
-
+template <typename T>
+static void updatePalmRejectors(std::map<int32_t, T>& palmRejectors,
+                                const std::vector<InputDeviceInfo>& inputDevices) {
     // Let's see which of the existing devices didn't change, so that we can keep them
     // and prevent event stream disruption
     std::set<int32_t /*deviceId*/> devicesToKeep;
@@ -435,19 +476,34 @@ void UnwantedInteractionBlocker::onInputDevicesChanged(
             continue;
         }
 
-        auto [it, emplaced] = mPalmRejectors.try_emplace(device.getId(), *info);
+        auto [it, emplaced] = palmRejectors.try_emplace(device.getId(), *info);
         if (!emplaced && *info != it->second.getPalmFilterDeviceInfo()) {
             // Re-create the PalmRejector because the device info has changed.
-            mPalmRejectors.erase(it);
-            mPalmRejectors.emplace(device.getId(), *info);
+            palmRejectors.erase(it);
+            palmRejectors.emplace(device.getId(), *info);
         }
         devicesToKeep.insert(device.getId());
     }
     // Delete all devices that we don't need to keep
-    std::erase_if(mPalmRejectors, [&devicesToKeep](const auto& item) {
+    std::erase_if(palmRejectors, [&devicesToKeep](const auto& item) {
         auto const& [deviceId, _] = item;
         return devicesToKeep.find(deviceId) == devicesToKeep.end();
     });
+}
+
+void UnwantedInteractionBlocker::onInputDevicesChanged(
+        const std::vector<InputDeviceInfo>& inputDevices) {
+    std::scoped_lock lock(mLock);
+    if (!mEnablePalmRejection) {
+        // Palm rejection is disabled. Don't create any palm rejector objects.
+        return;
+    }
+
+    if (mAsyncPalmRejection) {
+        updatePalmRejectors(mAsyncPalmRejectors, inputDevices);
+    } else {
+        updatePalmRejectors(mPalmRejectors, inputDevices);
+    }
     mPreferStylusOverTouchBlocker.notifyInputDevicesChanged(inputDevices);
 }
 
@@ -460,11 +516,20 @@ void UnwantedInteractionBlocker::dump(std::string& dump) {
                          std::to_string(mEnablePalmRejection).c_str());
     dump += StringPrintf("  isPalmRejectionEnabled (flag value): %s\n",
                          std::to_string(isPalmRejectionEnabled()).c_str());
+    dump += StringPrintf("  mAsyncPalmRejection: %s\n",
+                         std::to_string(mAsyncPalmRejection).c_str());
     dump += mPalmRejectors.empty() ? "  mPalmRejectors: None\n" : "  mPalmRejectors:\n";
     for (const auto& [deviceId, palmRejector] : mPalmRejectors) {
         dump += StringPrintf("    deviceId = %" PRId32 ":\n", deviceId);
         dump += addLinePrefix(palmRejector.dump(), "      ");
     }
+    if (!mAsyncPalmRejectors.empty()) {
+        dump += "  mAsyncPalmRejectors:\n";
+    }
+    for (auto& [deviceId, palmRejector] : mAsyncPalmRejectors) {
+        dump += StringPrintf("    deviceId = %" PRId32 ":\n", deviceId);
+        dump += addLinePrefix(palmRejector.dump(), "      ");
+    }
 }
 
 void UnwantedInteractionBlocker::monitor() {
@@ -679,13 +744,7 @@ std::vector<NotifyMotionArgs> PalmRejector::processMotion(const NotifyMotionArgs
     if (mPalmDetectionFilter == nullptr) {
         return {args};
     }
-    const bool skipThisEvent = args.action == AMOTION_EVENT_ACTION_HOVER_ENTER ||
-            args.action == AMOTION_EVENT_ACTION_HOVER_MOVE ||
-            args.action == AMOTION_EVENT_ACTION_HOVER_EXIT ||
-            args.action == AMOTION_EVENT_ACTION_BUTTON_PRESS ||
-            args.action == AMOTION_EVENT_ACTION_BUTTON_RELEASE ||
-            args.action == AMOTION_EVENT_ACTION_SCROLL;
-    if (skipThisEvent) {
+    if (isIgnoredByPalmRejector(args.action)) {
         // Lets not process hover events, button events, or scroll for now.
         return {args};
     }
@@ -727,6 +786,10 @@ const AndroidPalmFilterDeviceInfo& PalmRejector::getPalmFilterDeviceInfo() const
     return mDeviceInfo;
 }
 
+const std::set<int32_t>& PalmRejector::getSuppressedPointerIds() const {
+    return mSuppressedPointerIds;
+}
+
 std::string PalmRejector::dump() const {
     std::string out;
     out += "mDeviceInfo:\n";
@@ -748,4 +811,137 @@ std::string PalmRejector::dump() const {
     return out;
 }
 
+AsyncPalmRejector::AsyncPalmRejector(const AndroidPalmFilterDeviceInfo& info,
+                                     std::unique_ptr<::ui::PalmDetectionFilter> filter)
+      : mDeviceInfo(info), mModel(info, std::move(filter)) {
+    mThread = std::thread(&AsyncPalmRejector::threadLoop, this);
+    pthread_setname_np(mThread.native_handle(), "PalmRejector");
+}
+
+AsyncPalmRejector::~AsyncPalmRejector() {
+    { // acquire lock
+        std::scoped_lock lock(mLock);
+        mExiting = true;
+    } // release lock
+    mCondition.notify_all();
+    mThread.join();
+}
+
+void AsyncPalmRejector::threadLoop() {
+    while (true) {
+        std::pair<uint64_t, NotifyMotionArgs> event;
+        { // acquire lock
+            std::unique_lock lock(mLock);
+            base::ScopedLockAssertion assumeLocked(mLock);
+            mCondition.wait(lock, [this]() REQUIRES(mLock) {
+                return mExiting || !mPendingEvents.empty();
+            });
+            if (mExiting) {
+                return;
+            }
+            event = std::move(mPendingEvents.front());
+            mPendingEvents.pop_front();
+        } // release lock
+
+        std::set<int32_t> suppressedPointerIds;
+        { // acquire lock
+            ATRACE_NAME("PalmRejector::processMotion");
+            std::scoped_lock lock(mModelLock);
+            mModel.processMotion(event.second);
+            suppressedPointerIds = mModel.getSuppressedPointerIds();
+        } // release lock
+
+        { // acquire lock
+            std::scoped_lock lock(mLock);
+            mModelSuppressedPointerIds = std::move(suppressedPointerIds);
+            mModelSeq = event.first;
+        } // release lock
+        mCondition.notify_all();
+    }
+}
+
+std::vector<NotifyMotionArgs> AsyncPalmRejector::processMotion(const NotifyMotionArgs& args) {
+    if (isIgnoredByPalmRejector(args.action)) {
+        return {args};
+    }
+    const uint64_t seq = mNextSeq++;
+    const int32_t actionMasked = MotionEvent::getActionMasked(args.action);
+    const int32_t actionPointerId =
+            args.pointerProperties[MotionEvent::getActionIndex(args.action)].id;
+    if (actionMasked == AMOTION_EVENT_ACTION_DOWN) {
+        mPointerDownSeqs.clear();
+        mCanceledPointerIds.clear();
+    }
+    if (actionMasked == AMOTION_EVENT_ACTION_DOWN ||
+        actionMasked == AMOTION_EVENT_ACTION_POINTER_DOWN) {
+        mPointerDownSeqs[actionPointerId] = seq;
+    }
+
+    std::set<int32_t> canceledPointerIds = mCanceledPointerIds;
+    { // acquire lock
+        std::unique_lock lock(mLock);
+        base::ScopedLockAssertion assumeLocked(mLock);
+        if (mPendingEvents.size() >= MAX_PENDING_EVENTS) {
+            // Don't let the model fall too far behind, otherwise the palms would be canceled
+            // after they have already done damage.
+            ATRACE_NAME("AsyncPalmRejector stall");
+            mNumStalls++;
+            mCondition.wait(lock, [this]() REQUIRES(mLock) {
+                return mPendingEvents.size() < MAX_PENDING_EVENTS;
+            });
+        }
+        mPendingEvents.emplace_back(seq, args);
+        mLastQueuedSeq = seq;
+
+        for (int32_t pointerId : mModelSuppressedPointerIds) {
+            auto it = mPointerDownSeqs.find(pointerId);
+            if (it != mPointerDownSeqs.end() && it->second <= mModelSeq) {
+                canceledPointerIds.insert(pointerId);
+            }
+        }
+    } // release lock
+    mCondition.notify_all();
+
+    std::vector<NotifyMotionArgs> argsWithoutUnwantedPointers =
+            cancelSuppressedPointers(args, mCanceledPointerIds, canceledPointerIds);
+    for (const NotifyMotionArgs& checkArgs : argsWithoutUnwantedPointers) {
+        LOG_ALWAYS_FATAL_IF(checkArgs.action == ACTION_UNKNOWN, "%s", checkArgs.dump().c_str());
+    }
+
+    mCanceledPointerIds = std::move(canceledPointerIds);
+    if (actionMasked == AMOTION_EVENT_ACTION_POINTER_UP) {
+        mPointerDownSeqs.erase(actionPointerId);
+        mCanceledPointerIds.erase(actionPointerId);
+    } else if (actionMasked == AMOTION_EVENT_ACTION_UP ||
+               actionMasked == AMOTION_EVENT_ACTION_CANCEL) {
+        mPointerDownSeqs.clear();
+        mCanceledPointerIds.clear();
+    }
+    return argsWithoutUnwantedPointers;
+}
+
+const AndroidPalmFilterDeviceInfo& AsyncPalmRejector::getPalmFilterDeviceInfo() const {
+    return mDeviceInfo;
+}
+
+void AsyncPalmRejector::waitForIdle() {
+    std::unique_lock lock(mLock);
+    base::ScopedLockAssertion assumeLocked(mLock);
+    mCondition.wait(lock, [this]() REQUIRES(mLock) { return mModelSeq == mLastQueuedSeq; });
+}
+
+std::string AsyncPalmRejector::dump() {
+    std::string out;
+    { // acquire lock
+        std::scoped_lock lock(mLock);
+        out += StringPrintf("mPendingEvents: %zu, mModelSeq: %" PRIu64 ", mNumStalls: %zu\n",
+                            mPendingEvents.size(), mModelSeq, mNumStalls);
+    } // release lock
+    out += "mCanceledPointerIds: " + dumpSet(mCanceledPointerIds) + "\n";
+    std::scoped_lock lock(mModelLock);
+    out += "mModel:\n";
+    out += addLinePrefix(mModel.dump(), "  ");
+    return out;
+}
+
 } // namespace android
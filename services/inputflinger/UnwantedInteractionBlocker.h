@@ -16,8 +16,11 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <set>
+#include <thread>
 
 #include <android-base/thread_annotations.h>
 #include "include/UnwantedInteractionBlockerInterface.h"
@@ -74,6 +77,7 @@ std::string toString(const ::ui::InProgressTouchEvdev& touch);
 // --- Main classes and interfaces ---
 
 class PalmRejector;
+class AsyncPalmRejector;
 
 // --- Implementations ---
 
@@ -88,7 +92,8 @@ class PalmRejector;
 class UnwantedInteractionBlocker : public UnwantedInteractionBlockerInterface {
 public:
     explicit UnwantedInteractionBlocker(InputListenerInterface& listener);
-    explicit UnwantedInteractionBlocker(InputListenerInterface& listener, bool enablePalmRejection);
+    explicit UnwantedInteractionBlocker(InputListenerInterface& listener, bool enablePalmRejection,
+                                        bool asyncPalmRejection = false);
 
     void notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs& args) override;
     void notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) override;
@@ -111,6 +116,8 @@ private:
 
     QueuedInputListener mQueuedListener;
     const bool mEnablePalmRejection;
+    // Run the palm rejection model on a separate thread, instead of on the reader thread
+    const bool mAsyncPalmRejection;
 
     // When stylus is down, ignore touch
     PreferStylusOverTouchBlocker mPreferStylusOverTouchBlocker GUARDED_BY(mLock);
@@ -118,6 +125,8 @@ private:
     // Detect and reject unwanted palms on screen
     // Use a separate palm rejector for every touch device.
     std::map<int32_t /*deviceId*/, PalmRejector> mPalmRejectors GUARDED_BY(mLock);
+    // Used instead of mPalmRejectors when mAsyncPalmRejection is set.
+    std::map<int32_t /*deviceId*/, AsyncPalmRejector> mAsyncPalmRejectors GUARDED_BY(mLock);
     // TODO(b/210159205): delete this when simultaneous stylus and touch is supported
     void notifyMotionLocked(const NotifyMotionArgs& args) REQUIRES(mLock);
 
@@ -169,6 +178,8 @@ public:
 
     // Get the device info of this device, for comparison purposes
     const AndroidPalmFilterDeviceInfo& getPalmFilterDeviceInfo() const;
+    // The pointers of the current gesture that the model has classified as palms
+    const std::set<int32_t>& getSuppressedPointerIds() const;
     std::string dump() const;
 
 private:
@@ -192,4 +203,62 @@ private:
     SlotState mSlotState;
 };
 
+/**
+ * Runs a PalmRejector on its own thread, so that the cost of the model is not paid on the reader
+ * thread for every touch frame.
+ *
+ * Touches are passed through as soon as they arrive. Once the model has classified a pointer as a
+ * palm, that pointer is canceled on the next event of the gesture, in the same way as PalmRejector
+ * would have done it. The model is allowed to fall behind the event stream by at most
+ * MAX_PENDING_EVENTS events; beyond that, processMotion waits for it to catch up.
+ */
+class AsyncPalmRejector {
+public:
+    explicit AsyncPalmRejector(const AndroidPalmFilterDeviceInfo& info,
+                               std::unique_ptr<::ui::PalmDetectionFilter> filter = nullptr);
+    ~AsyncPalmRejector();
+
+    std::vector<NotifyMotionArgs> processMotion(const NotifyMotionArgs& args);
+
+    const AndroidPalmFilterDeviceInfo& getPalmFilterDeviceInfo() const;
+    // Block until the model has processed all of the events passed to processMotion so far
+    void waitForIdle();
+    std::string dump();
+
+private:
+    AsyncPalmRejector(const AsyncPalmRejector&) = delete;
+    AsyncPalmRejector& operator=(const AsyncPalmRejector&) = delete;
+
+    static constexpr size_t MAX_PENDING_EVENTS = 8;
+
+    void threadLoop();
+
+    const AndroidPalmFilterDeviceInfo mDeviceInfo;
+
+    // Only accessed from the thread calling processMotion.
+    uint64_t mNextSeq = 1;
+    // The sequence number of the event that put each pointer of the current gesture down. A
+    // classification made by the model only applies to a pointer if the model has seen that
+    // event, because pointer ids can be reused within a gesture.
+    std::map<int32_t /*pointerId*/, uint64_t /*seq*/> mPointerDownSeqs;
+    std::set<int32_t> mCanceledPointerIds;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<std::pair<uint64_t /*seq*/, NotifyMotionArgs>> mPendingEvents GUARDED_BY(mLock);
+    // The result of the model after processing the event with sequence number mModelSeq
+    std::set<int32_t> mModelSuppressedPointerIds GUARDED_BY(mLock);
+    uint64_t mModelSeq GUARDED_BY(mLock) = 0;
+    uint64_t mLastQueuedSeq GUARDED_BY(mLock) = 0;
+    // How many times processMotion had to wait for the model to catch up
+    size_t mNumStalls GUARDED_BY(mLock) = 0;
+    bool mExiting GUARDED_BY(mLock) = false;
+
+    // Held by the model thread while it runs the model
+    std::mutex mModelLock;
+    PalmRejector mModel GUARDED_BY(mModelLock);
+
+    std::thread mThread;
+};
+
 } // namespace android
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <set>
+#include <vector>
+
+#include <gui/constants.h>
+#include <log/log.h>
+#include "../InputDeviceMetricsCollector.h"
+
+namespace android {
+
+namespace {
+
+using std::chrono::nanoseconds;
+
+constexpr int32_t DEVICE_ID = 3;
+constexpr nsecs_t EVENT_INTERVAL = 4'000'000; // 240Hz touch report rate
+constexpr size_t EVENTS_PER_GESTURE = 64;
+const std::set<gui::Uid> INTERACTION_UIDS = {gui::Uid{10001}};
+
+// Stands in for the dispatcher, so that only the collector is measured.
+class NoopListener : public InputListenerInterface {
+    void notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs&) override {}
+    void notifyConfigurationChanged(const NotifyConfigurationChangedArgs&) override {}
+    void notifyKey(const NotifyKeyArgs&) override {}
+    void notifyMotion(const NotifyMotionArgs&) override {}
+    void notifySwitch(const NotifySwitchArgs&) override {}
+    void notifySensor(const NotifySensorArgs&) override {}
+    void notifyVibratorState(const NotifyVibratorStateArgs&) override {}
+    void notifyDeviceReset(const NotifyDeviceResetArgs&) override {}
+    void notifyPointerCaptureChanged(const NotifyPointerCaptureChangedArgs&) override {}
+};
+
+// Follows the event times, like the clock would if the events were processed as they arrive.
+class FakeMetricsLogger : public InputDeviceMetricsLogger {
+public:
+    nanoseconds currentTime{0};
+    size_t reportCount = 0;
+
+    nanoseconds getCurrentTime() override { return currentTime; }
+    void logInputDeviceUsageReported(const InputDeviceInfo&, const DeviceUsageReport&) override {
+        reportCount++;
+    }
+};
+
+InputDeviceInfo generateTouchscreenInfo() {
+    InputDeviceInfo info;
+    info.initialize(DEVICE_ID, /*generation=*/1, /*controllerNumber=*/1, InputDeviceIdentifier(),
+                    "touchscreen", /*isExternal=*/false, /*hasMic=*/false, ADISPLAY_ID_NONE);
+    info.addSource(AINPUT_SOURCE_TOUCHSCREEN);
+    return info;
+}
+
+NotifyMotionArgs generateMotionArgs(nsecs_t eventTime, int32_t action) {
+    PointerProperties pointerProperties;
+    pointerProperties.clear();
+    pointerProperties.id = 0;
+    pointerProperties.toolType = ToolType::FINGER;
+    PointerCoords pointerCoords;
+    pointerCoords.clear();
+    pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_X, 100);
+    pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_Y, 200);
+    return NotifyMotionArgs(/*id=*/0, eventTime, /*readTime=*/eventTime, DEVICE_ID,
+                            AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT,
+                            POLICY_FLAG_PASS_TO_USER, action, /*actionButton=*/0, /*flags=*/0,
+                            AMETA_NONE, /*buttonState=*/0, MotionClassification::NONE,
+                            AMOTION_EVENT_EDGE_FLAG_NONE, /*pointerCount=*/1, &pointerProperties,
+                            &pointerCoords, /*xPrecision=*/0, /*yPrecision=*/0,
+                            AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                            AMOTION_EVENT_INVALID_CURSOR_POSITION, /*downTime=*/eventTime,
+                            /*videoFrames=*/{});
+}
+
+} // namespace
+
+/**
+ * The time that the reader thread spends in the metrics collector for each motion event, before
+ * the event is passed on. With arg 1, the dispatcher reports an interaction for each event, like
+ * it does while a window receives a gesture, and the collector processes them along with the
+ * events. The device is used continuously, so no usage session expires.
+ */
+static void benchmarkMetricsCollectorNotifyMotion(benchmark::State& state) {
+    const bool withInteractions = state.range(0) != 0;
+    NoopListener nextListener;
+    FakeMetricsLogger logger;
+    InputDeviceMetricsCollector collector(nextListener, logger, std::chrono::minutes(2));
+    collector.notifyInputDevicesChanged({/*id=*/0, {generateTouchscreenInfo()}});
+
+    std::vector<NotifyMotionArgs> gesture;
+    for (size_t i = 0; i < EVENTS_PER_GESTURE; i++) {
+        const int32_t action = i == 0 ? AMOTION_EVENT_ACTION_DOWN
+                : i == EVENTS_PER_GESTURE - 1 ? AMOTION_EVENT_ACTION_UP
+                                              : AMOTION_EVENT_ACTION_MOVE;
+        gesture.push_back(generateMotionArgs(i * EVENT_INTERVAL, action));
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        if (withInteractions) {
+            for (const NotifyMotionArgs& args : gesture) {
+                collector.notifyDeviceInteraction(DEVICE_ID, args.eventTime, INTERACTION_UIDS);
+            }
+        }
+        state.ResumeTiming();
+
+        for (const NotifyMotionArgs& args : gesture) {
+            logger.currentTime = nanoseconds(args.eventTime);
+            collector.notifyMotion(args);
+        }
+
+        state.PauseTiming();
+        for (NotifyMotionArgs& args : gesture) {
+            args.eventTime += EVENTS_PER_GESTURE * EVENT_INTERVAL;
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * gesture.size());
+    LOG_ALWAYS_FATAL_IF(logger.reportCount != 0, "Usage was reported during the benchmark");
+}
+
+BENCHMARK(benchmarkMetricsCollectorNotifyMotion)->Arg(0)->Arg(1);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -20,8 +20,8 @@
 #include <binder/Binder.h>
 #include <gui/constants.h>
 #include "../dispatcher/InputDispatcher.h"
+#include "InputDispatcherFakes.h"
 
-using android::base::Result;
 using android::gui::WindowInfo;
 using android::gui::WindowInfoHandle;
 using android::os::IInputConstants;
@@ -35,173 +35,7 @@ namespace {
 // An arbitrary device id.
 constexpr int32_t DEVICE_ID = 1;
 
-// The default pid and uid for windows created by the test.
-constexpr gui::Pid WINDOW_PID{999};
-constexpr gui::Uid WINDOW_UID{1001};
-
 static constexpr std::chrono::duration INJECT_EVENT_TIMEOUT = 5s;
-static constexpr std::chrono::nanoseconds DISPATCHING_TIMEOUT = 100ms;
-
-static nsecs_t now() {
-    return systemTime(SYSTEM_TIME_MONOTONIC);
-}
-
-// --- FakeInputDispatcherPolicy ---
-
-class FakeInputDispatcherPolicy : public InputDispatcherPolicyInterface {
-public:
-    FakeInputDispatcherPolicy() = default;
-    virtual ~FakeInputDispatcherPolicy() = default;
-
-private:
-    void notifyConfigurationChanged(nsecs_t) override {}
-
-    void notifyNoFocusedWindowAnr(
-            const std::shared_ptr<InputApplicationHandle>& applicationHandle) override {
-        ALOGE("There is no focused window for %s", applicationHandle->getName().c_str());
-    }
-
-    void notifyWindowUnresponsive(const sp<IBinder>& connectionToken, std::optional<gui::Pid> pid,
-                                  const std::string& reason) override {
-        ALOGE("Window is not responding: %s", reason.c_str());
-    }
-
-    void notifyWindowResponsive(const sp<IBinder>& connectionToken,
-                                std::optional<gui::Pid> pid) override {}
-
-    void notifyInputChannelBroken(const sp<IBinder>&) override {}
-
-    void notifyFocusChanged(const sp<IBinder>&, const sp<IBinder>&) override {}
-
-    void notifySensorEvent(int32_t deviceId, InputDeviceSensorType sensorType,
-                           InputDeviceSensorAccuracy accuracy, nsecs_t timestamp,
-                           const std::vector<float>& values) override {}
-
-    void notifySensorAccuracy(int32_t deviceId, InputDeviceSensorType sensorType,
-                              InputDeviceSensorAccuracy accuracy) override {}
-
-    void notifyVibratorState(int32_t deviceId, bool isOn) override {}
-
-    InputDispatcherConfiguration getDispatcherConfiguration() override { return mConfig; }
-
-    bool filterInputEvent(const InputEvent& inputEvent, uint32_t policyFlags) override {
-        return true; // dispatch event normally
-    }
-
-    void interceptKeyBeforeQueueing(const KeyEvent&, uint32_t&) override {}
-
-    void interceptMotionBeforeQueueing(int32_t, nsecs_t, uint32_t&) override {}
-
-    nsecs_t interceptKeyBeforeDispatching(const sp<IBinder>&, const KeyEvent&, uint32_t) override {
-        return 0;
-    }
-
-    std::optional<KeyEvent> dispatchUnhandledKey(const sp<IBinder>&, const KeyEvent&,
-                                                 uint32_t) override {
-        return {};
-    }
-
-    void notifySwitch(nsecs_t, uint32_t, uint32_t, uint32_t) override {}
-
-    void pokeUserActivity(nsecs_t, int32_t, int32_t) override {}
-
-    void onPointerDownOutsideFocus(const sp<IBinder>& newToken) override {}
-
-    void setPointerCapture(const PointerCaptureRequest&) override {}
-
-    void notifyDropWindow(const sp<IBinder>&, float x, float y) override {}
-
-    void notifyDeviceInteraction(int32_t deviceId, nsecs_t timestamp,
-                                 const std::set<gui::Uid>& uids) override {}
-
-    InputDispatcherConfiguration mConfig;
-};
-
-class FakeApplicationHandle : public InputApplicationHandle {
-public:
-    FakeApplicationHandle() {}
-    virtual ~FakeApplicationHandle() {}
-
-    virtual bool updateInfo() {
-        mInfo.dispatchingTimeoutMillis =
-                std::chrono::duration_cast<std::chrono::milliseconds>(DISPATCHING_TIMEOUT).count();
-        return true;
-    }
-};
-
-class FakeInputReceiver {
-public:
-    void consumeEvent() {
-        uint32_t consumeSeq = 0;
-        InputEvent* event;
-
-        std::chrono::time_point start = std::chrono::steady_clock::now();
-        status_t result = WOULD_BLOCK;
-        while (result == WOULD_BLOCK) {
-            std::chrono::duration elapsed = std::chrono::steady_clock::now() - start;
-            if (elapsed > 10ms) {
-                ALOGE("Waited too long for consumer to produce an event, giving up");
-                break;
-            }
-            result = mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq,
-                                        &event);
-        }
-        if (result != OK) {
-            ALOGE("Received result = %d from consume()", result);
-        }
-        result = mConsumer->sendFinishedSignal(consumeSeq, true);
-        if (result != OK) {
-            ALOGE("Received result = %d from sendFinishedSignal", result);
-        }
-    }
-
-protected:
-    explicit FakeInputReceiver(InputDispatcher& dispatcher, const std::string name) {
-        Result<std::unique_ptr<InputChannel>> channelResult = dispatcher.createInputChannel(name);
-        LOG_ALWAYS_FATAL_IF(!channelResult.ok());
-        mClientChannel = std::move(*channelResult);
-        mConsumer = std::make_unique<InputConsumer>(mClientChannel);
-    }
-
-    virtual ~FakeInputReceiver() {}
-
-    std::shared_ptr<InputChannel> mClientChannel;
-    std::unique_ptr<InputConsumer> mConsumer;
-    PreallocatedInputEventFactory mEventFactory;
-};
-
-class FakeWindowHandle : public WindowInfoHandle, public FakeInputReceiver {
-public:
-    static const int32_t WIDTH = 200;
-    static const int32_t HEIGHT = 200;
-
-    FakeWindowHandle(const std::shared_ptr<InputApplicationHandle>& inputApplicationHandle,
-                     InputDispatcher& dispatcher, const std::string name)
-          : FakeInputReceiver(dispatcher, name), mFrame(Rect(0, 0, WIDTH, HEIGHT)) {
-        inputApplicationHandle->updateInfo();
-        updateInfo();
-        mInfo.applicationInfo = *inputApplicationHandle->getInfo();
-    }
-
-    void updateInfo() {
-        mInfo.token = mClientChannel->getConnectionToken();
-        mInfo.name = "FakeWindowHandle";
-        mInfo.dispatchingTimeout = DISPATCHING_TIMEOUT;
-        mInfo.frameLeft = mFrame.left;
-        mInfo.frameTop = mFrame.top;
-        mInfo.frameRight = mFrame.right;
-        mInfo.frameBottom = mFrame.bottom;
-        mInfo.globalScaleFactor = 1.0;
-        mInfo.touchableRegion.clear();
-        mInfo.addTouchableRegion(mFrame);
-        mInfo.ownerPid = WINDOW_PID;
-        mInfo.ownerUid = WINDOW_UID;
-        mInfo.displayId = ADISPLAY_ID_DEFAULT;
-    }
-
-protected:
-    Rect mFrame;
-};
 
 static MotionEvent generateMotionEvent() {
     PointerProperties pointerProperties[1];
@@ -293,6 +127,142 @@ static void benchmarkNotifyMotion(benchmark::State& state) {
     dispatcher.stop();
 }
 
+// Measures how long the reader thread is blocked inside notifyMotion while the dispatcher thread
+// is busy dispatching the previous event. The ACTION_UP is sent while the ACTION_DOWN is still
+// being hit-tested against state.range(0) windows, so it contends with the dispatcher for its
+// lock. Reported as the average and worst time spent in a notifyMotion call.
+static void benchmarkNotifyMotionReaderBlocking(benchmark::State& state) {
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    // Stack windows that don't contain the touch above the one that does, so that each DOWN is
+    // tested against all of them.
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    std::vector<sp<WindowInfoHandle>> windows;
+    for (int64_t i = 1; i < state.range(0); i++) {
+        sp<FakeWindowHandle> window =
+                sp<FakeWindowHandle>::make(application, dispatcher, "Obscuring Window");
+        const int32_t left = FakeWindowHandle::WIDTH + static_cast<int32_t>(i);
+        window->setFrame(Rect(left, 0, left + FakeWindowHandle::WIDTH, FakeWindowHandle::HEIGHT));
+        windows.push_back(window);
+    }
+    sp<FakeWindowHandle> window =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Fake Window");
+    windows.push_back(window);
+
+    dispatcher.setInputWindows({{ADISPLAY_ID_DEFAULT, windows}});
+
+    NotifyMotionArgs motionArgs = generateMotionArgs();
+    std::chrono::nanoseconds totalBlocked{0};
+    std::chrono::nanoseconds worstBlocked{0};
+    int64_t calls = 0;
+    const auto timedNotifyMotion = [&]() {
+        const auto start = std::chrono::steady_clock::now();
+        dispatcher.notifyMotion(motionArgs);
+        const std::chrono::nanoseconds blocked = std::chrono::steady_clock::now() - start;
+        totalBlocked += blocked;
+        worstBlocked = std::max(worstBlocked, blocked);
+        calls++;
+    };
+
+    for (auto _ : state) {
+        motionArgs.action = AMOTION_EVENT_ACTION_DOWN;
+        motionArgs.downTime = now();
+        motionArgs.eventTime = motionArgs.downTime;
+        timedNotifyMotion();
+
+        motionArgs.action = AMOTION_EVENT_ACTION_UP;
+        motionArgs.eventTime = now();
+        timedNotifyMotion();
+
+        window->consumeEvent();
+        window->consumeEvent();
+    }
+
+    state.counters["avg_blocked_ns"] = static_cast<double>(totalBlocked.count()) / calls;
+    state.counters["max_blocked_ns"] = static_cast<double>(worstBlocked.count());
+    dispatcher.stop();
+}
+
+// A touch with one finger in the middle of each of the first 'pointerCount' windows, where the
+// windows are laid out side by side.
+static NotifyMotionArgs generateSplitMotionArgs(int32_t action, size_t pointerCount,
+                                                nsecs_t downTime, float yOffset) {
+    std::vector<PointerProperties> pointerProperties(pointerCount);
+    std::vector<PointerCoords> pointerCoords(pointerCount);
+    for (size_t i = 0; i < pointerCount; i++) {
+        pointerProperties[i].clear();
+        pointerProperties[i].id = i;
+        pointerProperties[i].toolType = ToolType::FINGER;
+
+        pointerCoords[i].clear();
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X,
+                                      FakeWindowHandle::WIDTH * i + FakeWindowHandle::WIDTH / 2);
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, 50 + yOffset);
+    }
+    const nsecs_t currentTime = now();
+    return NotifyMotionArgs(IInputConstants::INVALID_INPUT_EVENT_ID, currentTime, currentTime,
+                            DEVICE_ID, AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT,
+                            POLICY_FLAG_PASS_TO_USER, action, /*actionButton=*/0, /*flags=*/0,
+                            AMETA_NONE, /*buttonState=*/0, MotionClassification::NONE,
+                            AMOTION_EVENT_EDGE_FLAG_NONE, std::move(pointerProperties),
+                            std::move(pointerCoords), /*xPrecision=*/0, /*yPrecision=*/0,
+                            AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                            AMOTION_EVENT_INVALID_CURSOR_POSITION, downTime,
+                            /*videoFrames=*/{});
+}
+
+// Measures the dispatch of ACTION_MOVE events when each of state.range(0) windows has one finger
+// on it, so that every MOVE is split into one event per window.
+static void benchmarkSplitTouchMove(benchmark::State& state) {
+    const size_t windowCount = state.range(0);
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    std::vector<sp<FakeWindowHandle>> windows;
+    std::vector<sp<WindowInfoHandle>> windowHandles;
+    for (size_t i = 0; i < windowCount; i++) {
+        sp<FakeWindowHandle> window =
+                sp<FakeWindowHandle>::make(application, dispatcher, "Split Window");
+        const int32_t left = FakeWindowHandle::WIDTH * i;
+        window->setFrame(Rect(left, 0, left + FakeWindowHandle::WIDTH, FakeWindowHandle::HEIGHT));
+        windows.push_back(window);
+        windowHandles.push_back(window);
+    }
+    dispatcher.setInputWindows({{ADISPLAY_ID_DEFAULT, windowHandles}});
+
+    // Put one finger down on each window. Every window that already has a finger receives a MOVE
+    // for each new finger, and the new window receives a DOWN.
+    const nsecs_t downTime = now();
+    dispatcher.notifyMotion(generateSplitMotionArgs(AMOTION_EVENT_ACTION_DOWN, 1, downTime, 0));
+    windows[0]->consumeEvent();
+    for (size_t i = 1; i < windowCount; i++) {
+        const int32_t action = AMOTION_EVENT_ACTION_POINTER_DOWN |
+                (i << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
+        dispatcher.notifyMotion(generateSplitMotionArgs(action, i + 1, downTime, 0));
+        for (size_t j = 0; j <= i; j++) {
+            windows[j]->consumeEvent();
+        }
+    }
+
+    float yOffset = 0;
+    for (auto _ : state) {
+        yOffset = yOffset >= 100 ? 0 : yOffset + 1;
+        dispatcher.notifyMotion(generateSplitMotionArgs(AMOTION_EVENT_ACTION_MOVE, windowCount,
+                                                        downTime, yOffset));
+        for (const sp<FakeWindowHandle>& window : windows) {
+            window->consumeEvent();
+        }
+    }
+
+    dispatcher.stop();
+}
+
 static void benchmarkInjectMotion(benchmark::State& state) {
     // Create dispatcher
     FakeInputDispatcherPolicy fakePolicy;
@@ -353,11 +323,58 @@ static void benchmarkOnWindowInfosChanged(benchmark::State& state) {
     dispatcher.stop();
 }
 
+// Mirrors what the reader does for every sync of a ten finger gesture: gather the cooked pointers
+// into NotifyMotionArgs and append them to the list of args that is handed to the listener.
+static void benchmarkGatherTenFingerMotionArgs(benchmark::State& state) {
+    constexpr size_t kPointerCount = 10;
+    constexpr size_t kFrameCount = 64;
+    std::array<PointerProperties, MAX_POINTERS> properties{};
+    std::vector<std::array<PointerCoords, MAX_POINTERS>> frames(kFrameCount);
+    for (size_t i = 0; i < kPointerCount; i++) {
+        properties[i].id = i;
+        properties[i].toolType = ToolType::FINGER;
+        for (size_t frame = 0; frame < kFrameCount; frame++) {
+            PointerCoords& coords = frames[frame][i];
+            coords.setAxisValue(AMOTION_EVENT_AXIS_X, 100 + i * 50 + frame);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_Y, 500 + frame * 3);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 0.5);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_SIZE, 0.1);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, 10);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, 8);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, 0);
+        }
+    }
+
+    size_t frame = 0;
+    for (auto _ : state) {
+        std::vector<PointerProperties> pointerProperties(properties.begin(),
+                                                         properties.begin() + kPointerCount);
+        std::vector<PointerCoords> pointerCoords(frames[frame].begin(),
+                                                 frames[frame].begin() + kPointerCount);
+        std::list<NotifyArgs> out;
+        out.push_back(NotifyMotionArgs(IInputConstants::INVALID_INPUT_EVENT_ID, frame, frame,
+                                       DEVICE_ID, AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT,
+                                       POLICY_FLAG_PASS_TO_USER, AMOTION_EVENT_ACTION_MOVE,
+                                       /*actionButton=*/0, /*flags=*/0, AMETA_NONE,
+                                       /*buttonState=*/0, MotionClassification::NONE,
+                                       AMOTION_EVENT_EDGE_FLAG_NONE, std::move(pointerProperties),
+                                       std::move(pointerCoords), /*xPrecision=*/0,
+                                       /*yPrecision=*/0, AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                       AMOTION_EVENT_INVALID_CURSOR_POSITION, /*downTime=*/0,
+                                       /*videoFrames=*/{}));
+        benchmark::DoNotOptimize(out);
+        frame = (frame + 1) % kFrameCount;
+    }
+}
+
 } // namespace
 
 BENCHMARK(benchmarkNotifyMotion);
+BENCHMARK(benchmarkNotifyMotionReaderBlocking)->Arg(1)->Arg(16)->Arg(64);
+BENCHMARK(benchmarkSplitTouchMove)->Arg(2)->Arg(4);
 BENCHMARK(benchmarkInjectMotion);
 BENCHMARK(benchmarkOnWindowInfosChanged);
+BENCHMARK(benchmarkGatherTenFingerMotionArgs);
 
 } // namespace android::inputdispatcher
 
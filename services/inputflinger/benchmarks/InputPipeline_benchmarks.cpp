@@ -0,0 +1,535 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <linux/input-event-codes.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include <android/gui/FocusRequest.h>
+#include <gui/constants.h>
+#include "../InputProcessor.h"
+#include "../UnwantedInteractionBlocker.h"
+#include "../tests/FakeEventHub.h"
+#include "../tests/FakeInputReaderPolicy.h"
+#include "../tests/FakePointerController.h"
+#include "../tests/InstrumentedInputReader.h"
+#include "InputDispatcherFakes.h"
+
+// Every allocation made by any thread, so that the benchmarks can report the allocations of the
+// whole pipeline.
+static std::atomic<size_t> gAllocations{0};
+
+void* operator new(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = malloc(std::max<size_t>(size, 1));
+    LOG_ALWAYS_FATAL_IF(ptr == nullptr, "Could not allocate %zu bytes", size);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace android {
+
+using inputdispatcher::FakeApplicationHandle;
+using inputdispatcher::FakeInputDispatcherPolicy;
+using inputdispatcher::FakeWindowHandle;
+using inputdispatcher::InputDispatcher;
+
+namespace {
+
+constexpr int32_t EVENTHUB_ID = 1;
+constexpr int32_t DISPLAY_WIDTH = 1080;
+constexpr int32_t DISPLAY_HEIGHT = 1920;
+constexpr int32_t SLOT_COUNT = 10;
+// How long to wait for the window to receive an event, after the reader processed its frame.
+constexpr std::chrono::nanoseconds RECEIVE_TIMEOUT = 100ms;
+
+enum class DeviceKind {
+    TOUCHSCREEN,
+    STYLUS,
+    TOUCHPAD,
+    KEYBOARD,
+};
+
+/**
+ * The evdev events that a device reports, split into frames that each end with a SYN_REPORT.
+ * Timestamps start at 0.
+ */
+using EvdevFrames = std::vector<std::vector<RawEvent>>;
+
+class EvdevStream {
+public:
+    void report(int32_t type, int32_t code, int32_t value) {
+        RawEvent event;
+        event.deviceId = EVENTHUB_ID;
+        event.type = type;
+        event.code = code;
+        event.value = value;
+        mFrame.push_back(event);
+    }
+
+    // Ends the frame with a SYN_REPORT, and stamps all of its events with 'when'.
+    void sync(nsecs_t when) {
+        report(EV_SYN, SYN_REPORT, 0);
+        for (RawEvent& event : mFrame) {
+            event.when = when;
+            event.readTime = when;
+        }
+        mFrames.push_back(std::move(mFrame));
+        mFrame.clear();
+    }
+
+    EvdevFrames frames() && { return std::move(mFrames); }
+
+private:
+    std::vector<RawEvent> mFrame;
+    EvdevFrames mFrames;
+};
+
+struct Touch {
+    int32_t x;
+    int32_t y;
+};
+
+/**
+ * Reports the touches on a multi-touch device with the slots protocol, the way the kernel does for
+ * each kind of device. Touches keep their slot for as long as they stay down.
+ */
+class MultiTouchStream : public EvdevStream {
+public:
+    explicit MultiTouchStream(DeviceKind kind) : mKind(kind) {}
+
+    void frame(nsecs_t when, const std::vector<Touch>& touches, int32_t pressure = 60) {
+        for (size_t slot = 0; slot < std::max(touches.size(), mLastTouchCount); slot++) {
+            report(EV_ABS, ABS_MT_SLOT, slot);
+            if (slot >= touches.size()) {
+                report(EV_ABS, ABS_MT_TRACKING_ID, -1);
+                continue;
+            }
+            if (slot >= mLastTouchCount) {
+                report(EV_ABS, ABS_MT_TRACKING_ID, mNextTrackingId++);
+                if (mKind == DeviceKind::STYLUS) {
+                    report(EV_ABS, ABS_MT_TOOL_TYPE, MT_TOOL_PEN);
+                }
+                report(EV_ABS, ABS_MT_TOUCH_MAJOR, mKind == DeviceKind::STYLUS ? 4 : 40);
+            }
+            report(EV_ABS, ABS_MT_POSITION_X, touches[slot].x);
+            report(EV_ABS, ABS_MT_POSITION_Y, touches[slot].y);
+            // The kernel drops values that did not change, and only a stylus varies its pressure.
+            if (slot >= mLastTouchCount || mKind == DeviceKind::STYLUS) {
+                report(EV_ABS, ABS_MT_PRESSURE, pressure);
+            }
+        }
+        const bool down = !touches.empty();
+        if (down != (mLastTouchCount > 0)) {
+            report(EV_KEY, BTN_TOUCH, down);
+            if (mKind == DeviceKind::STYLUS) {
+                report(EV_KEY, BTN_TOOL_PEN, down);
+            }
+        }
+        if (mKind == DeviceKind::TOUCHPAD) {
+            if (touches.size() != mLastTouchCount) {
+                if (mLastTouchCount > 0) {
+                    report(EV_KEY, mLastTouchCount == 1 ? BTN_TOOL_FINGER : BTN_TOOL_DOUBLETAP, 0);
+                }
+                if (down) {
+                    report(EV_KEY, touches.size() == 1 ? BTN_TOOL_FINGER : BTN_TOOL_DOUBLETAP, 1);
+                }
+            }
+            report(EV_MSC, MSC_TIMESTAMP, ns2us(when));
+        }
+        sync(when);
+        mLastTouchCount = touches.size();
+    }
+
+private:
+    const DeviceKind mKind;
+    int32_t mNextTrackingId = 0;
+    size_t mLastTouchCount = 0;
+};
+
+/**
+ * One second of a 120Hz touchscreen: a one finger scroll, then a two finger pinch, each followed
+ * by a lift.
+ */
+EvdevFrames generateTouchscreenFrames() {
+    constexpr nsecs_t interval = 1'000'000'000 / 120;
+    MultiTouchStream stream(DeviceKind::TOUCHSCREEN);
+    nsecs_t when = 0;
+    for (int32_t i = 0; i < 59; i++) {
+        stream.frame(when += interval, {{540, 1500 - 15 * i}});
+    }
+    stream.frame(when += interval, {});
+    for (int32_t i = 0; i < 59; i++) {
+        stream.frame(when += interval, {{440 - 3 * i, 960 - 3 * i}, {640 + 3 * i, 960 + 3 * i}});
+    }
+    stream.frame(when += interval, {});
+    return std::move(stream).frames();
+}
+
+/**
+ * One second of a 240Hz stylus on a touchscreen: four handwritten strokes with varying pressure.
+ */
+EvdevFrames generateStylusFrames() {
+    constexpr nsecs_t interval = 1'000'000'000 / 240;
+    MultiTouchStream stream(DeviceKind::STYLUS);
+    nsecs_t when = 0;
+    for (int32_t stroke = 0; stroke < 4; stroke++) {
+        for (int32_t i = 0; i < 59; i++) {
+            stream.frame(when += interval, {{200 + 10 * i, 400 + 300 * stroke + (i % 10) * 4}},
+                         /*pressure=*/100 + i);
+        }
+        stream.frame(when += interval, {});
+    }
+    return std::move(stream).frames();
+}
+
+/**
+ * One second of a 250Hz touchpad: the pointer is moved with one finger, then the content is
+ * scrolled with two, each followed by a lift.
+ */
+EvdevFrames generateTouchpadFrames() {
+    constexpr nsecs_t interval = 1'000'000'000 / 250;
+    MultiTouchStream stream(DeviceKind::TOUCHPAD);
+    nsecs_t when = 0;
+    for (int32_t i = 0; i < 124; i++) {
+        stream.frame(when += interval, {{300 + 4 * i, 400 + 2 * i}});
+    }
+    stream.frame(when += interval, {});
+    for (int32_t i = 0; i < 124; i++) {
+        stream.frame(when += interval, {{500, 700 - 3 * i}, {800, 700 - 3 * i}});
+    }
+    stream.frame(when += interval, {});
+    return std::move(stream).frames();
+}
+
+// The scan codes typed on the keyboard, with the key codes that the fake EventHub maps them to.
+constexpr std::pair<int32_t, int32_t> TYPED_KEYS[] = {
+        {KEY_H, AKEYCODE_H}, {KEY_E, AKEYCODE_E}, {KEY_L, AKEYCODE_L}, {KEY_L, AKEYCODE_L},
+        {KEY_O, AKEYCODE_O}, {KEY_SPACE, AKEYCODE_SPACE}, {KEY_W, AKEYCODE_W},
+        {KEY_O, AKEYCODE_O}, {KEY_R, AKEYCODE_R}, {KEY_L, AKEYCODE_L}, {KEY_D, AKEYCODE_D},
+};
+
+/**
+ * One second of typing on a keyboard: "hello world" twice, with each key held for 30ms.
+ */
+EvdevFrames generateKeyboardFrames() {
+    constexpr nsecs_t interval = 45'000'000;
+    constexpr nsecs_t holdTime = 30'000'000;
+    EvdevStream stream;
+    nsecs_t when = 0;
+    for (int repeat = 0; repeat < 2; repeat++) {
+        for (const auto& [scanCode, _] : TYPED_KEYS) {
+            when += interval;
+            stream.report(EV_KEY, scanCode, 1);
+            stream.sync(when);
+            stream.report(EV_KEY, scanCode, 0);
+            stream.sync(when + holdTime);
+        }
+    }
+    return std::move(stream).frames();
+}
+
+EvdevFrames generateFrames(DeviceKind kind) {
+    switch (kind) {
+        case DeviceKind::TOUCHSCREEN:
+            return generateTouchscreenFrames();
+        case DeviceKind::STYLUS:
+            return generateStylusFrames();
+        case DeviceKind::TOUCHPAD:
+            return generateTouchpadFrames();
+        case DeviceKind::KEYBOARD:
+            return generateKeyboardFrames();
+    }
+}
+
+/**
+ * Sits in front of a stage of the pipeline, and adds the thread CPU time spent in that stage and
+ * all the stages after it to its total. Also counts the events that pass through.
+ */
+class StageTimer : public InputListenerInterface {
+public:
+    explicit StageTimer(InputListenerInterface& next) : mNext(next) {}
+
+    void notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs& args) override {
+        timed([&] { mNext.notifyInputDevicesChanged(args); });
+    }
+    void notifyConfigurationChanged(const NotifyConfigurationChangedArgs& args) override {
+        timed([&] { mNext.notifyConfigurationChanged(args); });
+    }
+    void notifyKey(const NotifyKeyArgs& args) override {
+        mEventCount++;
+        timed([&] { mNext.notifyKey(args); });
+    }
+    void notifyMotion(const NotifyMotionArgs& args) override {
+        mEventCount++;
+        timed([&] { mNext.notifyMotion(args); });
+    }
+    void notifySwitch(const NotifySwitchArgs& args) override {
+        timed([&] { mNext.notifySwitch(args); });
+    }
+    void notifySensor(const NotifySensorArgs& args) override {
+        timed([&] { mNext.notifySensor(args); });
+    }
+    void notifyVibratorState(const NotifyVibratorStateArgs& args) override {
+        timed([&] { mNext.notifyVibratorState(args); });
+    }
+    void notifyDeviceReset(const NotifyDeviceResetArgs& args) override {
+        timed([&] { mNext.notifyDeviceReset(args); });
+    }
+    void notifyPointerCaptureChanged(const NotifyPointerCaptureChangedArgs& args) override {
+        timed([&] { mNext.notifyPointerCaptureChanged(args); });
+    }
+
+    nsecs_t getCpuTime() const { return mCpuTime; }
+
+    size_t takeEventCount() { return std::exchange(mEventCount, 0); }
+
+private:
+    template <typename F>
+    void timed(F&& notify) {
+        const nsecs_t start = systemTime(SYSTEM_TIME_THREAD);
+        notify();
+        mCpuTime += systemTime(SYSTEM_TIME_THREAD) - start;
+    }
+
+    InputListenerInterface& mNext;
+    nsecs_t mCpuTime = 0;
+    size_t mEventCount = 0;
+};
+
+/**
+ * The pipeline that InputManager sets up, minus the metrics collector, with a fake EventHub as its
+ * source and a full screen window as its sink. The reader runs on the caller's thread, and the
+ * dispatcher on its own.
+ */
+class InputPipeline {
+public:
+    explicit InputPipeline(DeviceKind kind)
+          : mDispatcher(mDispatcherPolicy),
+            mDispatcherStage(mDispatcher),
+            mProcessor(mDispatcherStage),
+            mProcessorStage(mProcessor),
+            mBlocker(mProcessorStage),
+            mBlockerStage(mBlocker),
+            mFakeEventHub(std::make_shared<FakeEventHub>()),
+            mFakePolicy(sp<FakeInputReaderPolicy>::make()),
+            mReader(mFakeEventHub, mFakePolicy, mBlockerStage) {
+        mDispatcher.setInputDispatchMode(/*enabled=*/true, /*frozen=*/false);
+        mDispatcher.start();
+
+        // The keyboard needs a focused window, so the window is focused for all devices.
+        std::shared_ptr<FakeApplicationHandle> application =
+                std::make_shared<FakeApplicationHandle>();
+        mWindow = sp<FakeWindowHandle>::make(application, mDispatcher, "Pipeline Window");
+        mWindow->setFrame(Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT));
+        mDispatcher.setInputWindows({{ADISPLAY_ID_DEFAULT, {mWindow}}});
+        gui::FocusRequest request;
+        request.token = mWindow->getToken();
+        request.windowName = mWindow->getName();
+        request.timestamp = inputdispatcher::now();
+        request.displayId = ADISPLAY_ID_DEFAULT;
+        mDispatcher.setFocusedWindow(request);
+        mWindow->consumeEvent();
+
+        mFakePolicy->addDisplayViewport(ADISPLAY_ID_DEFAULT, DISPLAY_WIDTH, DISPLAY_HEIGHT,
+                                        ui::ROTATION_0, /*isActive=*/true, "local:0",
+                                        /*physicalPort=*/std::nullopt, ViewportType::INTERNAL);
+        mReader.requestRefreshConfiguration(InputReaderConfiguration::Change::DISPLAY_INFO);
+        addDevice(kind);
+        mFakeEventHub->finishDeviceScan();
+        mReader.loopOnce();
+        mReader.loopOnce();
+        mDispatcherStage.takeEventCount();
+    }
+
+    ~InputPipeline() { mDispatcher.stop(); }
+
+    /**
+     * Processes one frame of evdev events, then waits for the window to receive what the
+     * dispatcher sends it for the frame. Returns the number of events that reached the dispatcher.
+     */
+    size_t processFrame(const std::vector<RawEvent>& frame, nsecs_t timeOffset) {
+        for (const RawEvent& event : frame) {
+            mFakeEventHub->enqueueEvent(event.when + timeOffset, event.readTime + timeOffset,
+                                        event.deviceId, event.type, event.code, event.value);
+        }
+        const nsecs_t start = systemTime(SYSTEM_TIME_THREAD);
+        mReader.loopOnce();
+        mReaderCpuTime += systemTime(SYSTEM_TIME_THREAD) - start;
+
+        const size_t eventCount = mDispatcherStage.takeEventCount();
+        for (size_t i = 0; i < eventCount; i++) {
+            if (!mWindow->receiveEvent(RECEIVE_TIMEOUT)) {
+                ALOGE("The window did not receive event %zu of %zu", i + 1, eventCount);
+                break;
+            }
+        }
+        // Also drain the events that the dispatcher synthesized, like HOVER_ENTER.
+        while (mWindow->receiveEvent(0ns)) {
+        }
+        return eventCount;
+    }
+
+    // The thread CPU time spent in each stage alone.
+    nsecs_t getReaderCpuTime() const { return mReaderCpuTime - mBlockerStage.getCpuTime(); }
+    nsecs_t getBlockerCpuTime() const {
+        return mBlockerStage.getCpuTime() - mProcessorStage.getCpuTime();
+    }
+    nsecs_t getProcessorCpuTime() const {
+        return mProcessorStage.getCpuTime() - mDispatcherStage.getCpuTime();
+    }
+    // Only the time to queue the events. Dispatching them happens on the dispatcher thread.
+    nsecs_t getDispatcherNotifyCpuTime() const { return mDispatcherStage.getCpuTime(); }
+
+private:
+    void addDevice(DeviceKind kind) {
+        switch (kind) {
+            case DeviceKind::TOUCHSCREEN:
+            case DeviceKind::STYLUS:
+                mFakeEventHub->addDevice(EVENTHUB_ID, "touchscreen",
+                                         InputDeviceClass::TOUCH | InputDeviceClass::TOUCH_MT);
+                mFakeEventHub->addConfigurationProperty(EVENTHUB_ID, "touch.deviceType",
+                                                        "touchScreen");
+                addMultiTouchAxes(/*resolution=*/0);
+                mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_TOOL_TYPE, 0, MT_TOOL_MAX, 0,
+                                               0);
+                mFakeEventHub->addKey(EVENTHUB_ID, BTN_TOOL_PEN, 0, AKEYCODE_UNKNOWN, 0);
+                break;
+            case DeviceKind::TOUCHPAD:
+                mFakeEventHub->addDevice(EVENTHUB_ID, "touchpad",
+                                         InputDeviceClass::TOUCHPAD | InputDeviceClass::TOUCH_MT);
+                addMultiTouchAxes(/*resolution=*/11);
+                mFakeEventHub->addKey(EVENTHUB_ID, BTN_TOOL_FINGER, 0, AKEYCODE_UNKNOWN, 0);
+                mFakeEventHub->addKey(EVENTHUB_ID, BTN_TOOL_DOUBLETAP, 0, AKEYCODE_UNKNOWN, 0);
+                mFakeEventHub->setMscEvent(EVENTHUB_ID, MSC_TIMESTAMP);
+                mFakePointerController = std::make_shared<FakePointerController>();
+                mFakePointerController->setBounds(0, 0, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1);
+                mFakePolicy->setPointerController(mFakePointerController);
+                break;
+            case DeviceKind::KEYBOARD:
+                mFakeEventHub->addDevice(EVENTHUB_ID, "keyboard",
+                                         InputDeviceClass::KEYBOARD | InputDeviceClass::ALPHAKEY);
+                for (const auto& [scanCode, keyCode] : TYPED_KEYS) {
+                    mFakeEventHub->addKey(EVENTHUB_ID, scanCode, 0, keyCode, 0);
+                }
+                break;
+        }
+    }
+
+    void addMultiTouchAxes(int32_t resolution) {
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_SLOT, 0, SLOT_COUNT - 1, 0, 0);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_TRACKING_ID, 0, 65535, 0, 0);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_POSITION_X, 0, DISPLAY_WIDTH - 1, 0, 0,
+                                       resolution);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_POSITION_Y, 0, DISPLAY_HEIGHT - 1, 0, 0,
+                                       resolution);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_TOUCH_MAJOR, 0, 255, 0, 0);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_PRESSURE, 0, 255, 0, 0);
+        mFakeEventHub->addKey(EVENTHUB_ID, BTN_TOUCH, 0, AKEYCODE_UNKNOWN, 0);
+    }
+
+    FakeInputDispatcherPolicy mDispatcherPolicy;
+    InputDispatcher mDispatcher;
+    StageTimer mDispatcherStage;
+    InputProcessor mProcessor;
+    StageTimer mProcessorStage;
+    UnwantedInteractionBlocker mBlocker;
+    StageTimer mBlockerStage;
+    std::shared_ptr<FakeEventHub> mFakeEventHub;
+    sp<FakeInputReaderPolicy> mFakePolicy;
+    InstrumentedInputReader mReader;
+    std::shared_ptr<FakePointerController> mFakePointerController;
+    sp<FakeWindowHandle> mWindow;
+    nsecs_t mReaderCpuTime = 0;
+};
+
+nsecs_t percentile(std::vector<nsecs_t>& values, size_t percent) {
+    if (values.empty()) return 0;
+    auto nth = values.begin() + (values.size() - 1) * percent / 100;
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+
+} // namespace
+
+/**
+ * Replays one second of input from a device through the whole pipeline, frame by frame, from the
+ * EventHub to the InputConsumer of a window. Besides the time per second of input, reports per
+ * frame:
+ *  - the CPU time of each stage on the reader thread,
+ *  - the CPU time of all other threads, which is nearly all spent by the dispatcher thread,
+ *  - the allocations on all threads, and
+ *  - percentiles of the latency from queueing the frame in the EventHub until the window received
+ *    all of its events.
+ * The stage times include reading the thread clock at each stage, which is the same for all runs.
+ */
+static void benchmarkInputPipeline(benchmark::State& state, DeviceKind kind) {
+    const EvdevFrames frames = generateFrames(kind);
+    const nsecs_t streamDuration = frames.back().back().when;
+    InputPipeline pipeline(kind);
+
+    std::vector<nsecs_t> latencies;
+    nsecs_t timeOffset = 0;
+    const size_t allocationsBefore = gAllocations.load(std::memory_order_relaxed);
+    const nsecs_t otherThreadsBefore =
+            systemTime(SYSTEM_TIME_PROCESS) - systemTime(SYSTEM_TIME_THREAD);
+    for (auto _ : state) {
+        // Timestamps follow the clock, as for a real device, so the dispatcher does not drop the
+        // events as stale. As the replay is faster than real time, they may run ahead of it.
+        timeOffset = std::max(inputdispatcher::now(), timeOffset + streamDuration);
+        for (const std::vector<RawEvent>& frame : frames) {
+            const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+            if (pipeline.processFrame(frame, timeOffset) > 0) {
+                latencies.push_back(systemTime(SYSTEM_TIME_MONOTONIC) - start);
+            }
+        }
+    }
+    const nsecs_t otherThreads =
+            systemTime(SYSTEM_TIME_PROCESS) - systemTime(SYSTEM_TIME_THREAD) - otherThreadsBefore;
+    const size_t allocations = gAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+    const double frameCount = static_cast<double>(state.iterations() * frames.size());
+    state.counters["reader_ns"] = pipeline.getReaderCpuTime() / frameCount;
+    state.counters["blocker_ns"] = pipeline.getBlockerCpuTime() / frameCount;
+    state.counters["processor_ns"] = pipeline.getProcessorCpuTime() / frameCount;
+    state.counters["dispatcher_notify_ns"] = pipeline.getDispatcherNotifyCpuTime() / frameCount;
+    state.counters["other_threads_ns"] = otherThreads / frameCount;
+    state.counters["allocs_per_frame"] = allocations / frameCount;
+    state.counters["latency_p50_ns"] = percentile(latencies, 50);
+    state.counters["latency_p90_ns"] = percentile(latencies, 90);
+    state.counters["latency_p99_ns"] = percentile(latencies, 99);
+}
+
+BENCHMARK_CAPTURE(benchmarkInputPipeline, touchscreen, DeviceKind::TOUCHSCREEN);
+BENCHMARK_CAPTURE(benchmarkInputPipeline, stylus, DeviceKind::STYLUS);
+BENCHMARK_CAPTURE(benchmarkInputPipeline, touchpad, DeviceKind::TOUCHPAD);
+BENCHMARK_CAPTURE(benchmarkInputPipeline, keyboard, DeviceKind::KEYBOARD);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <linux/input-event-codes.h>
+#include <algorithm>
+#include <list>
+#include <vector>
+
+#include "../reader/mapper/TouchpadInputMapper.h"
+#include "../tests/FakeEventHub.h"
+#include "../tests/FakeInputReaderPolicy.h"
+#include "../tests/FakePointerController.h"
+#include "../tests/InstrumentedInputReader.h"
+#include "../tests/TestInputListener.h"
+
+namespace android {
+
+namespace {
+
+constexpr int32_t DEVICE_ID = END_RESERVED_ID + 1000;
+constexpr int32_t EVENTHUB_ID = 1;
+constexpr int32_t SLOT_COUNT = 5;
+// Precision touchpads report at up to 250Hz.
+constexpr nsecs_t FRAME_INTERVAL = 4'000'000;
+constexpr size_t FRAMES_PER_SECOND = 250;
+
+struct Touch {
+    int32_t x;
+    int32_t y;
+};
+
+/**
+ * Convert a list of frames, each listing the touches on the pad, into the evdev events that the
+ * kernel reports for them with the slots protocol. Touches keep their slot for as long as they
+ * stay down.
+ */
+std::vector<RawEvent> framesToRawEvents(const std::vector<std::vector<Touch>>& frames) {
+    std::vector<RawEvent> events;
+    nsecs_t when = 0;
+    int32_t nextTrackingId = 0;
+    size_t lastTouchCount = 0;
+    const auto push = [&](int32_t type, int32_t code, int32_t value) {
+        RawEvent event;
+        event.when = when;
+        event.readTime = when;
+        event.deviceId = EVENTHUB_ID;
+        event.type = type;
+        event.code = code;
+        event.value = value;
+        events.push_back(event);
+    };
+    for (const std::vector<Touch>& frame : frames) {
+        for (size_t slot = 0; slot < std::max(frame.size(), lastTouchCount); slot++) {
+            push(EV_ABS, ABS_MT_SLOT, slot);
+            if (slot >= frame.size()) {
+                push(EV_ABS, ABS_MT_TRACKING_ID, -1);
+                continue;
+            }
+            if (slot >= lastTouchCount) {
+                push(EV_ABS, ABS_MT_TRACKING_ID, nextTrackingId++);
+                push(EV_ABS, ABS_MT_TOUCH_MAJOR, 40);
+                push(EV_ABS, ABS_MT_PRESSURE, 60);
+            }
+            push(EV_ABS, ABS_MT_POSITION_X, frame[slot].x);
+            push(EV_ABS, ABS_MT_POSITION_Y, frame[slot].y);
+        }
+        if ((frame.size() > 0) != (lastTouchCount > 0)) {
+            push(EV_KEY, BTN_TOUCH, frame.size() > 0 ? 1 : 0);
+        }
+        if (frame.size() != lastTouchCount) {
+            if (lastTouchCount > 0) {
+                push(EV_KEY, lastTouchCount == 1 ? BTN_TOOL_FINGER : BTN_TOOL_DOUBLETAP, 0);
+            }
+            if (frame.size() > 0) {
+                push(EV_KEY, frame.size() == 1 ? BTN_TOOL_FINGER : BTN_TOOL_DOUBLETAP, 1);
+            }
+        }
+        push(EV_MSC, MSC_TIMESTAMP, ns2us(when));
+        push(EV_SYN, SYN_REPORT, 0);
+        lastTouchCount = frame.size();
+        when += FRAME_INTERVAL;
+    }
+    return events;
+}
+
+/**
+ * One second of input: the pointer is moved with one finger, then the content is scrolled with
+ * two, followed by a lift.
+ */
+std::vector<RawEvent> generateMoveAndScroll() {
+    std::vector<std::vector<Touch>> frames;
+    for (size_t i = 0; i < FRAMES_PER_SECOND / 2; i++) {
+        frames.push_back({{int32_t(300 + 4 * i), int32_t(400 + 2 * i)}});
+    }
+    frames.push_back({});
+    for (size_t i = 0; frames.size() < FRAMES_PER_SECOND - 1; i++) {
+        frames.push_back({{500, int32_t(700 - 3 * i)}, {800, int32_t(700 - 3 * i)}});
+    }
+    frames.push_back({});
+    return framesToRawEvents(frames);
+}
+
+class TouchpadFixture {
+public:
+    TouchpadFixture()
+          : mFakeEventHub(std::make_shared<FakeEventHub>()),
+            mFakePolicy(sp<FakeInputReaderPolicy>::make()),
+            mReader(mFakeEventHub, mFakePolicy, mFakeListener) {
+        mFakeEventHub->addDevice(EVENTHUB_ID, "touchpad", InputDeviceClass::TOUCHPAD, /*bus=*/0);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_SLOT, 0, SLOT_COUNT - 1, 0, 0, 0);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_TRACKING_ID, 0, 65535, 0, 0, 0);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_POSITION_X, 0, 1500, 0, 0, 11);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_POSITION_Y, 0, 1000, 0, 0, 11);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_TOUCH_MAJOR, 0, 255, 0, 0, 0);
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_PRESSURE, 0, 255, 0, 0, 0);
+        mFakeEventHub->addKey(EVENTHUB_ID, BTN_TOUCH, 0, AKEYCODE_UNKNOWN, 0);
+        mFakeEventHub->addKey(EVENTHUB_ID, BTN_TOOL_FINGER, 0, AKEYCODE_UNKNOWN, 0);
+        mFakeEventHub->addKey(EVENTHUB_ID, BTN_TOOL_DOUBLETAP, 0, AKEYCODE_UNKNOWN, 0);
+
+        mFakePointerController = std::make_shared<FakePointerController>();
+        mFakePointerController->setBounds(0, 0, 1920 - 1, 1080 - 1);
+        mFakePolicy->setPointerController(mFakePointerController);
+
+        InputDeviceIdentifier identifier;
+        identifier.name = "touchpad";
+        mDevice = std::make_shared<InputDevice>(mReader.getContext(), DEVICE_ID,
+                                                /*generation=*/2, identifier);
+        mDevice->addEmptyEventHubDevice(EVENTHUB_ID);
+        const InputReaderConfiguration& config = mFakePolicy->getReaderConfiguration();
+        mMapper = &mDevice->constructAndAddMapper<TouchpadInputMapper>(EVENTHUB_ID, config);
+        std::list<NotifyArgs> unused = mDevice->configure(/*when=*/0, config, /*changes=*/{});
+        unused += mDevice->reset(/*when=*/0);
+    }
+
+    std::list<NotifyArgs> process(const RawEvent& event, nsecs_t timeOffset) {
+        RawEvent shifted = event;
+        shifted.when += timeOffset;
+        shifted.readTime += timeOffset;
+        return mMapper->process(&shifted);
+    }
+
+private:
+    std::shared_ptr<FakeEventHub> mFakeEventHub;
+    sp<FakeInputReaderPolicy> mFakePolicy;
+    TestInputListener mFakeListener;
+    InstrumentedInputReader mReader;
+    std::shared_ptr<FakePointerController> mFakePointerController;
+    std::shared_ptr<InputDevice> mDevice;
+    TouchpadInputMapper* mMapper;
+};
+
+} // namespace
+
+/**
+ * The reader thread time spent converting a second of touchpad input into NotifyArgs, through the
+ * gestures library. The "InputSecondsPerSecond" counter is the inverse of the share of a core that
+ * the touchpad takes, so a higher number is better.
+ */
+static void benchmarkTouchpadMoveAndScroll(benchmark::State& state) {
+    const std::vector<RawEvent> events = generateMoveAndScroll();
+    TouchpadFixture touchpad;
+    size_t notifyArgsCount = 0;
+    nsecs_t timeOffset = 0;
+    for (auto _ : state) {
+        for (const RawEvent& event : events) {
+            std::list<NotifyArgs> args = touchpad.process(event, timeOffset);
+            notifyArgsCount += args.size();
+            benchmark::DoNotOptimize(args);
+        }
+        // Keep time moving forward, as it would for a real device.
+        timeOffset += FRAMES_PER_SECOND * FRAME_INTERVAL;
+    }
+    state.SetItemsProcessed(state.iterations() * events.size());
+    state.counters["InputSecondsPerSecond"] =
+            benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+    state.counters["NotifyArgsPerInputSecond"] =
+            benchmark::Counter(notifyArgsCount, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(benchmarkTouchpadMoveAndScroll);
+
+} // namespace android
+
+BENCHMARK_MAIN();
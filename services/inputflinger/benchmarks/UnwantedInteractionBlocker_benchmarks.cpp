@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <gui/constants.h>
+#include "../UnwantedInteractionBlocker.h"
+
+namespace android {
+
+namespace {
+
+constexpr int32_t DEVICE_ID = 3;
+constexpr nsecs_t FRAME_INTERVAL = 8'000'000; // 120Hz touch report rate
+
+struct PointerData {
+    float x;
+    float y;
+    float major;
+};
+
+// Frames recorded from a touchscreen while a palm rested on it. The second pointer goes down at
+// the 5th frame.
+const std::vector<std::vector<PointerData>> RECORDED_PALM_FRAMES = {
+        {{1342.0, 613.0, 79.0}},
+        {{1406.0, 650.0, 52.0}},
+        {{1429.0, 672.0, 46.0}},
+        {{1417.0, 685.0, 41.0}},
+        {{1417.0, 685.0, 41.0}, {1062.0, 697.0, 10.0}},
+        {{1414.0, 702.0, 41.0}, {1059.0, 731.0, 12.0}},
+        {{1415.0, 719.0, 44.0}, {1060.0, 760.0, 11.0}},
+        {{1421.0, 733.0, 42.0}, {1065.0, 769.0, 13.0}},
+        {{1426.0, 742.0, 43.0}, {1068.0, 771.0, 13.0}},
+        {{1430.0, 748.0, 45.0}, {1069.0, 772.0, 13.0}},
+        {{1432.0, 750.0, 44.0}, {1069.0, 772.0, 13.0}},
+        {{1433.0, 751.0, 44.0}, {1070.0, 771.0, 13.0}},
+        {{1433.0, 751.0, 42.0}, {1071.0, 770.0, 13.0}},
+        {{1433.0, 751.0, 45.0}, {1072.0, 769.0, 13.0}},
+        {{1433.0, 751.0, 43.0}, {1072.0, 768.0, 13.0}},
+        {{1433.0, 751.0, 45.0}, {1072.0, 767.0, 13.0}},
+};
+
+NotifyMotionArgs generateMotionArgs(nsecs_t eventTime, int32_t action,
+                                    const std::vector<PointerData>& points) {
+    const size_t pointerCount = points.size();
+    PointerProperties pointerProperties[pointerCount];
+    PointerCoords pointerCoords[pointerCount];
+    for (size_t i = 0; i < pointerCount; i++) {
+        pointerProperties[i].clear();
+        pointerProperties[i].id = i;
+        pointerProperties[i].toolType = ToolType::FINGER;
+
+        pointerCoords[i].clear();
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X, points[i].x);
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, points[i].y);
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, points[i].major);
+    }
+    return NotifyMotionArgs(/*id=*/0, eventTime, /*readTime=*/eventTime, DEVICE_ID,
+                            AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT,
+                            POLICY_FLAG_PASS_TO_USER, action, /*actionButton=*/0, /*flags=*/0,
+                            AMETA_NONE, /*buttonState=*/0, MotionClassification::NONE,
+                            AMOTION_EVENT_EDGE_FLAG_NONE, pointerCount, pointerProperties,
+                            pointerCoords, /*xPrecision=*/0, /*yPrecision=*/0,
+                            AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                            AMOTION_EVENT_INVALID_CURSOR_POSITION, /*downTime=*/0,
+                            /*videoFrames=*/{});
+}
+
+/**
+ * Turn a list of frames into a consistent gesture. Pointers going down or up between two frames
+ * get their own POINTER_DOWN or POINTER_UP event.
+ */
+std::vector<NotifyMotionArgs> framesToGesture(const std::vector<std::vector<PointerData>>& frames) {
+    std::vector<NotifyMotionArgs> gesture;
+    nsecs_t eventTime = 0;
+    size_t pointerCount = 0;
+    for (const std::vector<PointerData>& frame : frames) {
+        if (pointerCount == 0) {
+            gesture.push_back(generateMotionArgs(eventTime, AMOTION_EVENT_ACTION_DOWN,
+                                                 {frame.front()}));
+            pointerCount = 1;
+        }
+        while (pointerCount < frame.size()) {
+            const int32_t action = AMOTION_EVENT_ACTION_POINTER_DOWN |
+                    (pointerCount << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
+            gesture.push_back(generateMotionArgs(eventTime, action,
+                                                 {frame.begin(),
+                                                  frame.begin() + pointerCount + 1}));
+            pointerCount++;
+        }
+        gesture.push_back(generateMotionArgs(eventTime, AMOTION_EVENT_ACTION_MOVE, frame));
+        eventTime += FRAME_INTERVAL;
+    }
+    const std::vector<PointerData>& lastFrame = frames.back();
+    while (pointerCount > 1) {
+        pointerCount--;
+        const int32_t action = AMOTION_EVENT_ACTION_POINTER_UP |
+                (pointerCount << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
+        gesture.push_back(generateMotionArgs(eventTime, action,
+                                             {lastFrame.begin(),
+                                              lastFrame.begin() + pointerCount + 1}));
+    }
+    gesture.push_back(generateMotionArgs(eventTime, AMOTION_EVENT_ACTION_UP, {lastFrame.front()}));
+    return gesture;
+}
+
+// A swipe with the given number of fingers, spread horizontally across the screen.
+std::vector<NotifyMotionArgs> generateSwipe(size_t fingerCount) {
+    std::vector<std::vector<PointerData>> frames;
+    for (size_t frame = 0; frame < 30; frame++) {
+        std::vector<PointerData> pointers;
+        for (size_t finger = 0; finger < fingerCount; finger++) {
+            pointers.push_back({100.0f + 150.0f * finger, 2000.0f - 40.0f * frame, 10.0f});
+        }
+        frames.push_back(std::move(pointers));
+    }
+    return framesToGesture(frames);
+}
+
+AndroidPalmFilterDeviceInfo generatePalmFilterDeviceInfo() {
+    InputDeviceInfo info;
+    info.initialize(DEVICE_ID, /*generation=*/1, /*controllerNumber=*/1, InputDeviceIdentifier(),
+                    "touchscreen", /*isExternal=*/false, /*hasMic=*/false, ADISPLAY_ID_NONE);
+    info.addSource(AINPUT_SOURCE_TOUCHSCREEN);
+    info.addMotionRange(AMOTION_EVENT_AXIS_X, AINPUT_SOURCE_TOUCHSCREEN, 0, 1599, /*flat=*/0,
+                        /*fuzz=*/0, /*resolution=*/11);
+    info.addMotionRange(AMOTION_EVENT_AXIS_Y, AINPUT_SOURCE_TOUCHSCREEN, 0, 2559, /*flat=*/0,
+                        /*fuzz=*/0, /*resolution=*/11);
+    info.addMotionRange(AMOTION_EVENT_AXIS_TOUCH_MAJOR, AINPUT_SOURCE_TOUCHSCREEN, 0, 255,
+                        /*flat=*/0, /*fuzz=*/0, /*resolution=*/1);
+    return *createPalmFilterDeviceInfo(info);
+}
+
+std::vector<NotifyMotionArgs> getGesture(const benchmark::State& state) {
+    // Arg 0 replays the recorded palm; any other value is a swipe with that many fingers.
+    return state.range(0) == 0 ? framesToGesture(RECORDED_PALM_FRAMES)
+                               : generateSwipe(state.range(0));
+}
+
+} // namespace
+
+/**
+ * The time that the reader thread spends in the palm rejector for each event, when the model runs
+ * on the reader thread.
+ */
+static void benchmarkPalmRejectorSync(benchmark::State& state) {
+    const std::vector<NotifyMotionArgs> gesture = getGesture(state);
+    for (auto _ : state) {
+        state.PauseTiming();
+        PalmRejector palmRejector(generatePalmFilterDeviceInfo());
+        state.ResumeTiming();
+        for (const NotifyMotionArgs& args : gesture) {
+            benchmark::DoNotOptimize(palmRejector.processMotion(args));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * gesture.size());
+}
+
+/**
+ * The time that the reader thread spends in the palm rejector for each event, when the model runs
+ * on its own thread. The model is given time to catch up after every event, like it would at the
+ * touch report rate, so this does not include any time spent waiting for it.
+ */
+static void benchmarkPalmRejectorAsync(benchmark::State& state) {
+    const std::vector<NotifyMotionArgs> gesture = getGesture(state);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto palmRejector = std::make_unique<AsyncPalmRejector>(generatePalmFilterDeviceInfo());
+        state.ResumeTiming();
+        for (const NotifyMotionArgs& args : gesture) {
+            benchmark::DoNotOptimize(palmRejector->processMotion(args));
+            state.PauseTiming();
+            palmRejector->waitForIdle();
+            state.ResumeTiming();
+        }
+        state.PauseTiming();
+        palmRejector.reset(); // joins the model thread
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * gesture.size());
+}
+
+BENCHMARK(benchmarkPalmRejectorSync)->Arg(0)->Arg(1)->Arg(5)->Arg(10);
+BENCHMARK(benchmarkPalmRejectorAsync)->Arg(0)->Arg(1)->Arg(5)->Arg(10);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -16,6 +16,8 @@
 
 #include "AnrTracker.h"
 
+#include <limits>
+
 namespace android::inputdispatcher {
 
 template <typename T>
@@ -24,6 +26,7 @@ static T max(const T& a, const T& b) {
 }
 
 void AnrTracker::insert(nsecs_t timeoutTime, sp<IBinder> token) {
+    mTimeoutsByToken.insert(std::make_pair(token, timeoutTime));
     mAnrTimeouts.insert(std::make_pair(timeoutTime, std::move(token)));
 }
 
@@ -36,17 +39,19 @@ void AnrTracker::erase(nsecs_t timeoutTime, const sp<IBinder>& token) {
     auto it = mAnrTimeouts.find(pair);
     if (it != mAnrTimeouts.end()) {
         mAnrTimeouts.erase(it);
+        mTimeoutsByToken.erase(mTimeoutsByToken.find(std::make_pair(token, timeoutTime)));
     }
 }
 
 void AnrTracker::eraseToken(const sp<IBinder>& token) {
-    for (auto it = mAnrTimeouts.begin(); it != mAnrTimeouts.end();) {
-        if (it->second == token) {
-            it = mAnrTimeouts.erase(it);
-        } else {
-            ++it;
-        }
+    const auto begin = mTimeoutsByToken.lower_bound(
+            std::make_pair(token, std::numeric_limits<nsecs_t>::min()));
+    const auto end = mTimeoutsByToken.upper_bound(
+            std::make_pair(token, std::numeric_limits<nsecs_t>::max()));
+    for (auto it = begin; it != end; ++it) {
+        mAnrTimeouts.erase(mAnrTimeouts.find(std::make_pair(it->second, token)));
     }
+    mTimeoutsByToken.erase(begin, end);
 }
 
 bool AnrTracker::empty() const {
@@ -68,6 +73,7 @@ const sp<IBinder>& AnrTracker::firstToken() const {
 
 void AnrTracker::clear() {
     mAnrTimeouts.clear();
+    mTimeoutsByToken.clear();
 }
 
 } // namespace android::inputdispatcher
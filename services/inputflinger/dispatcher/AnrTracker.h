@@ -52,6 +52,10 @@ private:
     // from the same connection and same timestamp, but different sequence numbers.
     // We are not tracking sequence numbers, and just allow duplicates to exist.
     std::multiset<std::pair<nsecs_t /*timeoutTime*/, sp<IBinder> /*connectionToken*/>> mAnrTimeouts;
+    // The same entries ordered by token, so that all the timeouts of a connection can be found
+    // without scanning every entry.
+    std::multiset<std::pair<sp<IBinder> /*connectionToken*/, nsecs_t /*timeoutTime*/>>
+            mTimeoutsByToken;
 };
 
 } // namespace android::inputdispatcher
@@ -18,6 +18,8 @@
 
 #include "Entry.h"
 
+#include <algorithm>
+
 namespace android::inputdispatcher {
 
 Connection::Connection(const std::shared_ptr<InputChannel>& inputChannel, bool monitor,
@@ -47,4 +49,22 @@ std::deque<DispatchEntry*>::iterator Connection::findWaitQueueEntry(uint32_t seq
     return waitQueue.end();
 }
 
+void Connection::recordResponseTime(nsecs_t responseTime) {
+    // Weigh the latest response at 1/8, so a single slow event does not dominate.
+    averageResponseTime = averageResponseTime == 0
+            ? responseTime
+            : averageResponseTime + (responseTime - averageResponseTime) / 8;
+}
+
+bool Connection::isFallingBehind(nsecs_t currentTime) const {
+    // A few frames. Applications that keep up finish their events within a frame or two, since
+    // InputConsumer batches moves until the next frame.
+    static constexpr nsecs_t MAX_PENDING_TIME = 100'000'000; // 100 ms
+
+    if (waitQueue.empty()) {
+        return false;
+    }
+    return currentTime - waitQueue.front()->deliveryTime > MAX_PENDING_TIME;
+}
+
 } // namespace android::inputdispatcher
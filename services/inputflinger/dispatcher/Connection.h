@@ -59,6 +59,14 @@ public:
     // yet received a "finished" response from the application.
     std::deque<DispatchEntry*> waitQueue;
 
+    // Moving average of the time the application takes to finish an event, or 0 before the
+    // first response.
+    nsecs_t averageResponseTime = 0;
+
+    // Number of motion events that were replaced by a newer one before being published,
+    // because the application was falling behind.
+    uint64_t coalescedMotionCount = 0;
+
     Connection(const std::shared_ptr<InputChannel>& inputChannel, bool monitor,
                const IdGenerator& idGenerator);
 
@@ -67,6 +75,12 @@ public:
     const std::string getWindowName() const;
 
     std::deque<DispatchEntry*>::iterator findWaitQueueEntry(uint32_t seq);
+
+    void recordResponseTime(nsecs_t responseTime);
+
+    // Returns true if the oldest event awaiting a response has been pending for long enough that
+    // sending the application more moves would only add to its backlog.
+    bool isFallingBehind(nsecs_t currentTime) const;
 };
 
 } // namespace android::inputdispatcher
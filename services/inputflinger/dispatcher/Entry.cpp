@@ -57,6 +57,68 @@ VerifiedMotionEvent verifiedMotionEventFromMotionEntry(const MotionEntry& entry,
             entry.buttonState};
 }
 
+// --- EntryPool ---
+
+EntryPool::EntryPool(const char* name, size_t blockSize) : mName(name), mBlockSize(blockSize) {
+    mFreeBlocks.reserve(MAX_FREE_BLOCKS);
+}
+
+void* EntryPool::allocate(size_t size) {
+    if (size == mBlockSize) {
+        std::scoped_lock lock(mLock);
+        mAllocations++;
+        if (!mFreeBlocks.empty()) {
+            void* block = mFreeBlocks.back();
+            mFreeBlocks.pop_back();
+            mReuses++;
+            return block;
+        }
+    }
+    return ::operator new(size);
+}
+
+void EntryPool::deallocate(void* block, size_t size) {
+    if (size == mBlockSize) {
+        std::scoped_lock lock(mLock);
+        if (mFreeBlocks.size() < MAX_FREE_BLOCKS) {
+            mFreeBlocks.push_back(block);
+            return;
+        }
+    }
+    ::operator delete(block);
+}
+
+std::string EntryPool::dump() const {
+    std::scoped_lock lock(mLock);
+    return StringPrintf("%s: blockSize=%zu, freeBlocks=%zu, allocations=%" PRIu64
+                        ", reused=%" PRIu64 "\n",
+                        mName, mBlockSize, mFreeBlocks.size(), mAllocations, mReuses);
+}
+
+namespace {
+
+// The pools are never destroyed, since entries may outlive static destruction.
+EntryPool& keyEntryPool() {
+    static EntryPool* pool = new EntryPool("KeyEntry", sizeof(KeyEntry));
+    return *pool;
+}
+
+EntryPool& motionEntryPool() {
+    static EntryPool* pool = new EntryPool("MotionEntry", sizeof(MotionEntry));
+    return *pool;
+}
+
+EntryPool& dispatchEntryPool() {
+    static EntryPool* pool = new EntryPool("DispatchEntry", sizeof(DispatchEntry));
+    return *pool;
+}
+
+} // namespace
+
+std::string dumpEntryPools() {
+    return keyEntryPool().dump() + motionEntryPool().dump() + dispatchEntryPool().dump();
+}
+
 // --- EventEntry ---
 
 EventEntry::EventEntry(int32_t id, Type type, nsecs_t eventTime, uint32_t policyFlags)
@@ -172,6 +234,14 @@ KeyEntry::KeyEntry(int32_t id, nsecs_t eventTime, int32_t deviceId, uint32_t sou
 
 KeyEntry::~KeyEntry() {}
 
+void* KeyEntry::operator new(size_t size) {
+    return keyEntryPool().allocate(size);
+}
+
+void KeyEntry::operator delete(void* ptr, size_t size) {
+    keyEntryPool().deallocate(ptr, size);
+}
+
 std::string KeyEntry::getDescription() const {
     if (!IS_DEBUGGABLE_BUILD) {
         return "KeyEvent";
@@ -242,6 +312,14 @@ MotionEntry::MotionEntry(int32_t id, nsecs_t eventTime, int32_t deviceId, uint32
 
 MotionEntry::~MotionEntry() {}
 
+void* MotionEntry::operator new(size_t size) {
+    return motionEntryPool().allocate(size);
+}
+
+void MotionEntry::operator delete(void* ptr, size_t size) {
+    motionEntryPool().deallocate(ptr, size);
+}
+
 std::string MotionEntry::getDescription() const {
     if (!IS_DEBUGGABLE_BUILD) {
         return "MotionEvent";
@@ -323,6 +401,14 @@ DispatchEntry::DispatchEntry(std::shared_ptr<EventEntry> eventEntry,
         resolvedAction(0),
         resolvedFlags(0) {}
 
+void* DispatchEntry::operator new(size_t size) {
+    return dispatchEntryPool().allocate(size);
+}
+
+void DispatchEntry::operator delete(void* ptr, size_t size) {
+    dispatchEntryPool().deallocate(ptr, size);
+}
+
 uint32_t DispatchEntry::nextSeq() {
     // Sequence number 0 is reserved and will never be returned.
     uint32_t seq;
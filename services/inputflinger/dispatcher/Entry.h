@@ -19,15 +19,47 @@
 #include "InjectionState.h"
 #include "InputTarget.h"
 
+#include <android-base/thread_annotations.h>
 #include <gui/InputApplication.h>
 #include <input/Input.h>
 #include <stdint.h>
 #include <utils/Timers.h>
 #include <functional>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace android::inputdispatcher {
 
+/**
+ * Keeps the memory of freed entries of one type for reuse. Key, motion and dispatch entries are
+ * allocated for every event and every target, so recycling them avoids allocator churn at high
+ * input rates.
+ */
+class EntryPool {
+public:
+    EntryPool(const char* name, size_t blockSize);
+
+    void* allocate(size_t size);
+    void deallocate(void* block, size_t size);
+
+    std::string dump() const;
+
+private:
+    static constexpr size_t MAX_FREE_BLOCKS = 64;
+
+    const char* const mName;
+    const size_t mBlockSize;
+
+    mutable std::mutex mLock;
+    std::vector<void*> mFreeBlocks GUARDED_BY(mLock);
+    uint64_t mAllocations GUARDED_BY(mLock) = 0;
+    uint64_t mReuses GUARDED_BY(mLock) = 0;
+};
+
+// Returns the statistics of the pools backing KeyEntry, MotionEntry and DispatchEntry.
+std::string dumpEntryPools();
+
 struct EventEntry {
     enum class Type {
         CONFIGURATION_CHANGED,
@@ -156,6 +188,9 @@ struct KeyEntry : EventEntry {
     void recycle();
 
     ~KeyEntry() override;
+
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
 };
 
 struct MotionEntry : EventEntry {
@@ -187,6 +222,9 @@ struct MotionEntry : EventEntry {
     std::string getDescription() const override;
 
     ~MotionEntry() override;
+
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
 };
 
 struct SensorEntry : EventEntry {
@@ -248,6 +286,9 @@ struct DispatchEntry {
 
     inline bool isSplit() const { return targetFlags.test(InputTarget::Flags::SPLIT); }
 
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+
 private:
     static volatile int32_t sNextSeqAtomic;
 
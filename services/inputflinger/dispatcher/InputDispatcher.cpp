@@ -113,6 +113,13 @@ constexpr int LOGTAG_INPUT_INTERACTION = 62000;
 constexpr int LOGTAG_INPUT_FOCUS = 62001;
 constexpr int LOGTAG_INPUT_CANCEL = 62003;
 
+// Transport of the input channels created for windows. Shared memory avoids a round trip through
+// the kernel for every event and finished signal, at the cost of a few pages per channel.
+const InputChannel::Transport WINDOW_CHANNEL_TRANSPORT =
+        android::base::GetBoolProperty("ro.input.shared_memory_channels", false)
+        ? InputChannel::Transport::SHARED_MEMORY
+        : InputChannel::Transport::SOCKET;
+
 const ui::Transform kIdentityTransform;
 
 inline nsecs_t now() {
@@ -486,6 +493,43 @@ bool shouldReportFinishedEvent(const DispatchEntry& dispatchEntry, const Connect
     return true;
 }
 
+/**
+ * Returns true if the entry is a move that may be held back and replaced by a newer move while the
+ * application is falling behind. Injected events are never coalesced, since the injector may be
+ * waiting for their result.
+ */
+bool isCoalescableMotion(const DispatchEntry& entry) {
+    return entry.eventEntry->type == EventEntry::Type::MOTION &&
+            (entry.resolvedAction == AMOTION_EVENT_ACTION_MOVE ||
+             entry.resolvedAction == AMOTION_EVENT_ACTION_HOVER_MOVE) &&
+            !entry.eventEntry->isInjected();
+}
+
+/**
+ * Returns true if the queued entry is a move that the new entry supersedes, i.e. both are moves
+ * of the same gesture with the same pointers, delivered the same way.
+ */
+bool canReplaceStaleMotion(const DispatchEntry& queued, const DispatchEntry& next) {
+    if (!isCoalescableMotion(queued) || !isCoalescableMotion(next) ||
+        queued.resolvedAction != next.resolvedAction || queued.targetFlags != next.targetFlags ||
+        queued.resolvedFlags != next.resolvedFlags) {
+        return false;
+    }
+    const MotionEntry& queuedMotion = static_cast<const MotionEntry&>(*queued.eventEntry);
+    const MotionEntry& nextMotion = static_cast<const MotionEntry&>(*next.eventEntry);
+    if (queuedMotion.deviceId != nextMotion.deviceId || queuedMotion.source != nextMotion.source ||
+        queuedMotion.displayId != nextMotion.displayId ||
+        queuedMotion.pointerCount != nextMotion.pointerCount) {
+        return false;
+    }
+    for (uint32_t i = 0; i < queuedMotion.pointerCount; i++) {
+        if (queuedMotion.pointerProperties[i].id != nextMotion.pointerProperties[i].id) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /**
  * Connection is responsive if it has no events in the waitQueue that are older than the
  * current time.
@@ -1253,12 +1297,9 @@ InputDispatcher::findTouchedWindowAtLocked(int32_t displayId, float x, float y,
                                            bool ignoreDragWindow,
                                            bool isFromCrossDevice) const {
 #endif
-    // Traverse windows from front to back to find touched window.
-    std::vector<InputTarget> outsideTargets;
-    const auto& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+    const auto isSkipped = [&](const sp<WindowInfoHandle>& windowHandle) {
         if (ignoreDragWindow && haveSameToken(windowHandle, mDragState->dragWindow)) {
-            continue;
+            return true;
         }
 #ifndef DISABLE_DEVICE_INTEGRATION
         const WindowInfo* windowInfo = windowHandle->getInfo();
@@ -1266,13 +1307,54 @@ InputDispatcher::findTouchedWindowAtLocked(int32_t displayId, float x, float y,
         bool bypassBlackScreen = (windowInfo->layoutParamsType == WindowInfo::Type::SYSTEM_BLACKSCREEN_OVERLAY)
                                             && isFromCrossDevice;
         if (bypassBlackScreen) {
-            continue;
+            return true;
         }
 #endif
+        return false;
+    };
+
+    const ui::Transform displayTransform = getTransformLocked(displayId);
+    const auto& windowHandles = getWindowHandlesLocked(displayId);
+    std::vector<InputTarget> outsideTargets;
+    const WindowHitTestIndex* index = getHitTestIndexLocked(displayId);
+    if (index != nullptr && index->getDisplayTransform() == displayTransform) {
+        // Only the windows whose touchable bounds contain the point can be the touched window.
+        std::optional<size_t> touchedIndex;
+        for (size_t i : index->getTouchCandidatesAt(x, y)) {
+            const sp<WindowInfoHandle>& windowHandle = windowHandles[i];
+            const WindowInfo& info = *windowHandle->getInfo();
+            if (!isSkipped(windowHandle) && !info.isSpy() &&
+                windowAcceptsTouchAt(info, displayId, x, y, isStylus, displayTransform)) {
+                touchedIndex = i;
+                break;
+            }
+        }
+        if (!touchedIndex) {
+            return {nullptr, {}};
+        }
+        // Every window above the touched one that watches for outside touches gets notified.
+        for (size_t i : index->getOutsideTouchWatchers()) {
+            if (i >= *touchedIndex) {
+                break;
+            }
+            if (!isSkipped(windowHandles[i])) {
+                addWindowTargetLocked(windowHandles[i], InputTarget::Flags::DISPATCH_AS_OUTSIDE,
+                                      /*pointerIds=*/{}, /*firstDownTimeInTarget=*/std::nullopt,
+                                      outsideTargets);
+            }
+        }
+        return {windowHandles[*touchedIndex], outsideTargets};
+    }
+
+    // Traverse windows from front to back to find touched window.
+    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+        if (isSkipped(windowHandle)) {
+            continue;
+        }
 
         const WindowInfo& info = *windowHandle->getInfo();
         if (!info.isSpy() &&
-            windowAcceptsTouchAt(info, displayId, x, y, isStylus, getTransformLocked(displayId))) {
+            windowAcceptsTouchAt(info, displayId, x, y, isStylus, displayTransform)) {
             return {windowHandle, outsideTargets};
         }
 
@@ -1289,18 +1371,36 @@ std::vector<sp<WindowInfoHandle>> InputDispatcher::findTouchedSpyWindowsAtLocked
         int32_t displayId, float x, float y, bool isStylus) const {
     // Traverse windows from front to back and gather the touched spy windows.
     std::vector<sp<WindowInfoHandle>> spyWindows;
+    const ui::Transform displayTransform = getTransformLocked(displayId);
     const auto& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+    const auto visit = [&](const sp<WindowInfoHandle>& windowHandle) {
         const WindowInfo& info = *windowHandle->getInfo();
 
-        if (!windowAcceptsTouchAt(info, displayId, x, y, isStylus, getTransformLocked(displayId))) {
-            continue;
+        if (!windowAcceptsTouchAt(info, displayId, x, y, isStylus, displayTransform)) {
+            return true;
         }
         if (!info.isSpy()) {
             // The first touched non-spy window was found, so return the spy windows touched so far.
-            return spyWindows;
+            return false;
         }
         spyWindows.push_back(windowHandle);
+        return true;
+    };
+
+    const WindowHitTestIndex* index = getHitTestIndexLocked(displayId);
+    if (index != nullptr && index->getDisplayTransform() == displayTransform) {
+        for (size_t i : index->getTouchCandidatesAt(x, y)) {
+            if (!visit(windowHandles[i])) {
+                break;
+            }
+        }
+        return spyWindows;
+    }
+
+    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+        if (!visit(windowHandle)) {
+            break;
+        }
     }
     return spyWindows;
 }
@@ -2016,6 +2116,7 @@ void InputDispatcher::dispatchEventLocked(nsecs_t currentTime,
             }
         }
     }
+    mSplitMotionCache.clear();
 }
 
 void InputDispatcher::cancelEventsForAnrLocked(const std::shared_ptr<Connection>& connection) {
@@ -3013,6 +3114,35 @@ static bool canBeObscuredBy(const sp<WindowInfoHandle>& windowHandle,
     return true;
 }
 
+/**
+ * Returns the windows above the given window, front to back, whose frame may contain the point.
+ * If the window is not on its display (e.g. it has been removed), all candidates are returned.
+ */
+std::vector<sp<WindowInfoHandle>> InputDispatcher::getWindowsAboveAtPointLocked(
+        const sp<WindowInfoHandle>& windowHandle, int32_t x, int32_t y) const {
+    const int32_t displayId = windowHandle->getInfo()->displayId;
+    const std::vector<sp<WindowInfoHandle>>& windowHandles = getWindowHandlesLocked(displayId);
+    std::vector<sp<WindowInfoHandle>> windowsAbove;
+    const WindowHitTestIndex* index = getHitTestIndexLocked(displayId);
+    if (index != nullptr) {
+        const size_t zOrder = index->getZOrder(windowHandle).value_or(windowHandles.size());
+        for (size_t i : index->getFrameCandidatesAt(x, y)) {
+            if (i >= zOrder) {
+                break; // All future windows are below us. Exit early.
+            }
+            windowsAbove.push_back(windowHandles[i]);
+        }
+        return windowsAbove;
+    }
+    for (const sp<WindowInfoHandle>& otherHandle : windowHandles) {
+        if (windowHandle == otherHandle) {
+            break; // All future windows are below us. Exit early.
+        }
+        windowsAbove.push_back(otherHandle);
+    }
+    return windowsAbove;
+}
+
 /**
  * Returns touch occlusion information in the form of TouchOcclusionInfo. To check if the touch is
  * untrusted, one should check:
@@ -3033,17 +3163,13 @@ static bool canBeObscuredBy(const sp<WindowInfoHandle>& windowHandle,
 InputDispatcher::TouchOcclusionInfo InputDispatcher::computeTouchOcclusionInfoLocked(
         const sp<WindowInfoHandle>& windowHandle, int32_t x, int32_t y) const {
     const WindowInfo* windowInfo = windowHandle->getInfo();
-    int32_t displayId = windowInfo->displayId;
-    const std::vector<sp<WindowInfoHandle>>& windowHandles = getWindowHandlesLocked(displayId);
     TouchOcclusionInfo info;
     info.hasBlockingOcclusion = false;
     info.obscuringOpacity = 0;
     info.obscuringUid = gui::Uid::INVALID;
     std::map<gui::Uid, float> opacityByUid;
-    for (const sp<WindowInfoHandle>& otherHandle : windowHandles) {
-        if (windowHandle == otherHandle) {
-            break; // All future windows are below us. Exit early.
-        }
+    for (const sp<WindowInfoHandle>& otherHandle :
+         getWindowsAboveAtPointLocked(windowHandle, x, y)) {
         const WindowInfo* otherInfo = otherHandle->getInfo();
         if (canBeObscuredBy(windowHandle, otherHandle) && otherInfo->frameContainsPoint(x, y) &&
             !haveSameApplicationToken(windowInfo, otherInfo)) {
@@ -3117,12 +3243,8 @@ bool InputDispatcher::isTouchTrustedLocked(const TouchOcclusionInfo& occlusionIn
 
 bool InputDispatcher::isWindowObscuredAtPointLocked(const sp<WindowInfoHandle>& windowHandle,
                                                     int32_t x, int32_t y) const {
-    int32_t displayId = windowHandle->getInfo()->displayId;
-    const std::vector<sp<WindowInfoHandle>>& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& otherHandle : windowHandles) {
-        if (windowHandle == otherHandle) {
-            break; // All future windows are below us. Exit early.
-        }
+    for (const sp<WindowInfoHandle>& otherHandle :
+         getWindowsAboveAtPointLocked(windowHandle, x, y)) {
         const WindowInfo* otherInfo = otherHandle->getInfo();
 #ifdef DISABLE_DEVICE_INTEGRATION
         if (canBeObscuredBy(windowHandle, otherHandle) &&
@@ -3297,9 +3419,9 @@ void InputDispatcher::prepareDispatchCycleLocked(nsecs_t currentTime,
                            << connection->getInputChannelName() << " for "
                            << originalMotionEntry.getDescription();
             }
-            std::unique_ptr<MotionEntry> splitMotionEntry =
-                    splitMotionEvent(originalMotionEntry, inputTarget.pointerIds,
-                                     inputTarget.firstDownTimeInTarget.value());
+            std::shared_ptr<MotionEntry> splitMotionEntry =
+                    getSplitMotionEventLocked(originalMotionEntry, inputTarget.pointerIds,
+                                              inputTarget.firstDownTimeInTarget.value());
             if (!splitMotionEntry) {
                 return; // split event was dropped
             }
@@ -3313,8 +3435,7 @@ void InputDispatcher::prepareDispatchCycleLocked(nsecs_t currentTime,
                       connection->getInputChannelName().c_str());
                 logOutboundMotionDetails("  ", *splitMotionEntry);
             }
-            enqueueDispatchEntriesLocked(currentTime, connection, std::move(splitMotionEntry),
-                                         inputTarget);
+            enqueueDispatchEntriesLocked(currentTime, connection, splitMotionEntry, inputTarget);
             return;
         }
     }
@@ -3498,6 +3619,16 @@ void InputDispatcher::enqueueDispatchEntryLocked(const std::shared_ptr<Connectio
         incrementPendingForegroundDispatches(newEntry);
     }
 
+    // A move that is still in the outbound queue is being held back because the application is
+    // falling behind, or because its socket is full. This one supersedes it, so replace it rather
+    // than growing the backlog.
+    if (!connection->outboundQueue.empty() &&
+        canReplaceStaleMotion(*connection->outboundQueue.back(), *dispatchEntry)) {
+        releaseDispatchEntry(connection->outboundQueue.back());
+        connection->outboundQueue.pop_back();
+        connection->coalescedMotionCount++;
+    }
+
     // Enqueue the dispatch entry.
     connection->outboundQueue.push_back(dispatchEntry.release());
     traceOutboundQueueLength(*connection);
@@ -3671,6 +3802,15 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
 
     while (connection->status == Connection::Status::NORMAL && !connection->outboundQueue.empty()) {
         DispatchEntry* dispatchEntry = connection->outboundQueue.front();
+        if (isCoalescableMotion(*dispatchEntry) && connection->isFallingBehind(currentTime)) {
+            // Keep the move in the outbound queue, where newer moves will replace it, instead of
+            // adding to the backlog of the application. Dispatch resumes when it catches up.
+            if (DEBUG_DISPATCH_CYCLE) {
+                ALOGD("channel '%s' ~ Holding back move because the application is behind",
+                      connection->getInputChannelName().c_str());
+            }
+            return;
+        }
         dispatchEntry->deliveryTime = currentTime;
         const std::chrono::nanoseconds timeout = getDispatchingTimeoutLocked(connection);
         dispatchEntry->timeoutTime = currentTime + timeout.count();
@@ -4175,14 +4315,33 @@ void InputDispatcher::synthesizeCancelationEventsForWindowLocked(
     }
 }
 
+std::shared_ptr<MotionEntry> InputDispatcher::getSplitMotionEventLocked(
+        const MotionEntry& originalMotionEntry, std::bitset<MAX_POINTER_ID + 1> pointerIds,
+        nsecs_t splitDownTime) {
+    // With split touch, a window and the windows that mirror it or its wallpaper often receive
+    // the same subset of pointers. They can all share the same split entry, because entries are
+    // not modified after they are enqueued.
+    for (const SplitMotionCacheEntry& cached : mSplitMotionCache) {
+        if (cached.pointerIds == pointerIds && cached.splitDownTime == splitDownTime) {
+            return cached.entry;
+        }
+    }
+    std::shared_ptr<MotionEntry> splitMotionEntry =
+            splitMotionEvent(originalMotionEntry, pointerIds, splitDownTime);
+    if (splitMotionEntry != nullptr) {
+        mSplitMotionCache.push_back({pointerIds, splitDownTime, splitMotionEntry});
+    }
+    return splitMotionEntry;
+}
+
 std::unique_ptr<MotionEntry> InputDispatcher::splitMotionEvent(
         const MotionEntry& originalMotionEntry, std::bitset<MAX_POINTER_ID + 1> pointerIds,
         nsecs_t splitDownTime) {
     ALOG_ASSERT(pointerIds.any());
 
+    // Only record which of the original pointers are kept. The pointer data is copied once,
+    // straight into the new entry, after we know that the event will not be dropped.
     uint32_t splitPointerIndexMap[MAX_POINTERS];
-    PointerProperties splitPointerProperties[MAX_POINTERS];
-    PointerCoords splitPointerCoords[MAX_POINTERS];
 
     uint32_t originalPointerCount = originalMotionEntry.pointerCount;
     uint32_t splitPointerCount = 0;
@@ -4194,9 +4353,6 @@ std::unique_ptr<MotionEntry> InputDispatcher::splitMotionEvent(
         uint32_t pointerId = uint32_t(pointerProperties.id);
         if (pointerIds.test(pointerId)) {
             splitPointerIndexMap[splitPointerCount] = originalPointerIndex;
-            splitPointerProperties[splitPointerCount].copyFrom(pointerProperties);
-            splitPointerCoords[splitPointerCount].copyFrom(
-                    originalMotionEntry.pointerCoords[originalPointerIndex]);
             splitPointerCount += 1;
         }
     }
@@ -4233,7 +4389,7 @@ std::unique_ptr<MotionEntry> InputDispatcher::splitMotionEvent(
             } else {
                 // A secondary pointer went down/up.
                 uint32_t splitPointerIndex = 0;
-                while (pointerId != uint32_t(splitPointerProperties[splitPointerIndex].id)) {
+                while (splitPointerIndexMap[splitPointerIndex] != uint32_t(originalPointerIndex)) {
                     splitPointerIndex += 1;
                 }
                 action = maskedAction |
@@ -4273,8 +4429,17 @@ std::unique_ptr<MotionEntry> InputDispatcher::splitMotionEvent(
                                           originalMotionEntry.yPrecision,
                                           originalMotionEntry.xCursorPosition,
                                           originalMotionEntry.yCursorPosition, splitDownTime,
-                                          splitPointerCount, splitPointerProperties,
-                                          splitPointerCoords);
+                                          /*pointerCount=*/0, /*pointerProperties=*/nullptr,
+                                          /*pointerCoords=*/nullptr);
+    splitMotionEntry->pointerCount = splitPointerCount;
+    for (uint32_t splitPointerIndex = 0; splitPointerIndex < splitPointerCount;
+         splitPointerIndex++) {
+        const uint32_t originalPointerIndex = splitPointerIndexMap[splitPointerIndex];
+        splitMotionEntry->pointerProperties[splitPointerIndex].copyFrom(
+                originalMotionEntry.pointerProperties[originalPointerIndex]);
+        splitMotionEntry->pointerCoords[splitPointerIndex].copyFrom(
+                originalMotionEntry.pointerCoords[originalPointerIndex]);
+    }
 
     if (originalMotionEntry.injectionState) {
         splitMotionEntry->injectionState = originalMotionEntry.injectionState;
@@ -4481,6 +4646,19 @@ void InputDispatcher::notifyMotion(const NotifyMotionArgs& args) {
               std::to_string(t.duration().count()).c_str());
     }
 
+    // Build the entry before taking the lock: copying the pointer data can be significant for
+    // multi-touch and stylus events, and the reader thread should hold mLock as briefly as
+    // possible since it contends with dispatching. The policy flags are finalized below.
+    std::unique_ptr<MotionEntry> newEntry =
+            std::make_unique<MotionEntry>(args.id, args.eventTime, args.deviceId, args.source,
+                                          args.displayId, policyFlags, args.action,
+                                          args.actionButton, args.flags, args.metaState,
+                                          args.buttonState, args.classification, args.edgeFlags,
+                                          args.xPrecision, args.yPrecision, args.xCursorPosition,
+                                          args.yCursorPosition, args.downTime,
+                                          args.getPointerCount(), args.pointerProperties.data(),
+                                          args.pointerCoords.data());
+
     bool needWake = false;
     { // acquire lock
         mLock.lock();
@@ -4522,22 +4700,14 @@ void InputDispatcher::notifyMotion(const NotifyMotionArgs& args) {
         }
 
         // Just enqueue a new motion event.
-        std::unique_ptr<MotionEntry> newEntry =
-                std::make_unique<MotionEntry>(args.id, args.eventTime, args.deviceId, args.source,
-                                              args.displayId, policyFlags, args.action,
-                                              args.actionButton, args.flags, args.metaState,
-                                              args.buttonState, args.classification, args.edgeFlags,
-                                              args.xPrecision, args.yPrecision,
-                                              args.xCursorPosition, args.yCursorPosition,
-                                              args.downTime, args.getPointerCount(),
-                                              args.pointerProperties.data(),
-                                              args.pointerCoords.data());
+        newEntry->policyFlags = policyFlags;
 
         if (args.id != android::os::IInputConstants::INVALID_INPUT_EVENT_ID &&
             IdGenerator::getSource(args.id) == IdGenerator::Source::INPUT_READER &&
             !mInputFilterEnabled) {
             const bool isDown = args.action == AMOTION_EVENT_ACTION_DOWN;
-            mLatencyTracker.trackListener(args.id, isDown, args.eventTime, args.readTime);
+            mLatencyTracker.trackListener(args.id, isDown, args.eventTime, args.readTime,
+                                          args.deviceId);
         }
 
         needWake = enqueueInboundEventLocked(std::move(newEntry));
@@ -5063,6 +5233,11 @@ ui::Transform InputDispatcher::getTransformLocked(int32_t displayId) const {
                                                 : kIdentityTransform;
 }
 
+const WindowHitTestIndex* InputDispatcher::getHitTestIndexLocked(int32_t displayId) const {
+    const auto it = mHitTestIndexByDisplay.find(displayId);
+    return it != mHitTestIndexByDisplay.end() ? &it->second : nullptr;
+}
+
 bool InputDispatcher::canWindowReceiveMotionLocked(const sp<WindowInfoHandle>& window,
                                                    const MotionEntry& motionEntry) const {
     const WindowInfo& info = *window->getInfo();
@@ -5132,6 +5307,7 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     if (windowInfoHandles.empty()) {
         // Remove all handles on a display if there are no windows left.
         mWindowHandlesByDisplay.erase(displayId);
+        mHitTestIndexByDisplay.erase(displayId);
         return;
     }
 
@@ -5176,7 +5352,10 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     }
 
     // Insert or replace
-    mWindowHandlesByDisplay[displayId] = newHandles;
+    mHitTestIndexByDisplay.insert_or_assign(displayId,
+                                            WindowHitTestIndex(newHandles,
+                                                               getTransformLocked(displayId)));
+    mWindowHandlesByDisplay[displayId] = std::move(newHandles);
 }
 
 void InputDispatcher::setInputWindows(
@@ -5893,12 +6072,16 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) const {
         dump += INDENT "Connections:\n";
         for (const auto& [token, connection] : mConnectionsByToken) {
             dump += StringPrintf(INDENT2 "%i: channelName='%s', windowName='%s', "
-                                         "status=%s, monitor=%s, responsive=%s\n",
+                                         "status=%s, monitor=%s, responsive=%s, "
+                                         "averageResponseTime=%" PRId64 "ms, "
+                                         "coalescedMotions=%" PRIu64 "\n",
                                  connection->inputChannel->getFd().get(),
                                  connection->getInputChannelName().c_str(),
                                  connection->getWindowName().c_str(),
                                  ftl::enum_string(connection->status).c_str(),
-                                 toString(connection->monitor), toString(connection->responsive));
+                                 toString(connection->monitor), toString(connection->responsive),
+                                 ns2ms(connection->averageResponseTime),
+                                 connection->coalescedMotionCount);
 
             if (!connection->outboundQueue.empty()) {
                 dump += StringPrintf(INDENT3 "OutboundQueue: length=%zu\n",
@@ -5944,6 +6127,8 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) const {
                          ns2ms(mConfig.keyRepeatTimeout));
     dump += mLatencyTracker.dump(INDENT2);
     dump += mLatencyAggregator.dump(INDENT2);
+    dump += INDENT "EntryPools:\n";
+    dump += addLinePrefix(dumpEntryPools(), INDENT2);
 }
 
 void InputDispatcher::dumpMonitors(std::string& dump, const std::vector<Monitor>& monitors) const {
@@ -5972,7 +6157,8 @@ Result<std::unique_ptr<InputChannel>> InputDispatcher::createInputChannel(const
 
     std::unique_ptr<InputChannel> serverChannel;
     std::unique_ptr<InputChannel> clientChannel;
-    status_t result = InputChannel::openInputChannelPair(name, serverChannel, clientChannel);
+    status_t result = InputChannel::openInputChannelPair(name, serverChannel, clientChannel,
+                                                         WINDOW_CHANNEL_TRANSPORT);
 
     if (result) {
         return base::Error(result) << "Failed to open input channel pair with name " << name;
@@ -5990,6 +6176,7 @@ Result<std::unique_ptr<InputChannel>> InputDispatcher::createInputChannel(const
             ALOGE("Created a new connection, but the token %p is already known", token.get());
         }
         mConnectionsByToken.emplace(token, connection);
+        mLatencyAggregator.addConnection(token, name);
 
         std::function<int(int events)> callback = std::bind(&InputDispatcher::handleReceiveCallback,
                                                             this, std::placeholders::_1, token);
@@ -6241,6 +6428,7 @@ std::string InputDispatcher::getConnectionNameLocked(const sp<IBinder>& connecti
 
 void InputDispatcher::removeConnectionLocked(const std::shared_ptr<Connection>& connection) {
     mAnrTracker.eraseToken(connection->inputChannel->getConnectionToken());
+    mLatencyAggregator.removeConnection(connection->inputChannel->getConnectionToken());
     mConnectionsByToken.erase(connection->inputChannel->getConnectionToken());
 }
 
@@ -6255,6 +6443,7 @@ void InputDispatcher::doDispatchCycleFinishedCommand(nsecs_t finishTime,
     }
     DispatchEntry* dispatchEntry = *dispatchEntryIt;
     const nsecs_t eventDuration = finishTime - dispatchEntry->deliveryTime;
+    connection->recordResponseTime(eventDuration);
     if (eventDuration > SLOW_EVENT_PROCESSING_WARNING_TIMEOUT) {
         ALOGI("%s spent %" PRId64 "ms processing %s", connection->getWindowName().c_str(),
               ns2ms(eventDuration), dispatchEntry->eventEntry->getDescription().c_str());
@@ -6263,6 +6452,8 @@ void InputDispatcher::doDispatchCycleFinishedCommand(nsecs_t finishTime,
         mLatencyTracker.trackFinishedEvent(dispatchEntry->eventEntry->id,
                                            connection->inputChannel->getConnectionToken(),
                                            dispatchEntry->deliveryTime, consumeTime, finishTime);
+        mLatencyTracker.trackDeliveryLatency(connection->inputChannel->getTransport(),
+                                             dispatchEntry->deliveryTime, consumeTime);
     }
 
     bool restartEvent;
@@ -33,6 +33,7 @@
 #include "Monitor.h"
 #include "TouchState.h"
 #include "TouchedWindow.h"
+#include "WindowHitTestIndex.h"
 
 #include <attestation/HmacKeyManager.h>
 #include <gui/InputApplication.h>
@@ -375,6 +376,9 @@ private:
             mWindowHandlesByDisplay GUARDED_BY(mLock);
     std::unordered_map<int32_t /*displayId*/, android::gui::DisplayInfo> mDisplayInfos
             GUARDED_BY(mLock);
+    // Spatial index over mWindowHandlesByDisplay, rebuilt whenever the handles of a display change.
+    std::unordered_map<int32_t /*displayId*/, WindowHitTestIndex> mHitTestIndexByDisplay
+            GUARDED_BY(mLock);
     void setInputWindowsLocked(
             const std::vector<sp<android::gui::WindowInfoHandle>>& inputWindowHandles,
             int32_t displayId) REQUIRES(mLock);
@@ -384,6 +388,8 @@ private:
     sp<android::gui::WindowInfoHandle> getWindowHandleLocked(
             const sp<IBinder>& windowHandleToken) const REQUIRES(mLock);
     ui::Transform getTransformLocked(int32_t displayId) const REQUIRES(mLock);
+    // Get the hit test index of a display, or nullptr if the display has no windows.
+    const WindowHitTestIndex* getHitTestIndexLocked(int32_t displayId) const REQUIRES(mLock);
 
     // Same function as above, but faster. Since displayId is provided, this avoids the need
     // to loop through all displays.
@@ -597,6 +603,9 @@ private:
     bool isTouchTrustedLocked(const TouchOcclusionInfo& occlusionInfo) const REQUIRES(mLock);
     bool isWindowObscuredAtPointLocked(const sp<android::gui::WindowInfoHandle>& windowHandle,
                                        int32_t x, int32_t y) const REQUIRES(mLock);
+    std::vector<sp<android::gui::WindowInfoHandle>> getWindowsAboveAtPointLocked(
+            const sp<android::gui::WindowInfoHandle>& windowHandle, int32_t x, int32_t y) const
+            REQUIRES(mLock);
     bool isWindowObscuredLocked(const sp<android::gui::WindowInfoHandle>& windowHandle) const
             REQUIRES(mLock);
     std::string dumpWindowForTouchOcclusion(const android::gui::WindowInfo* info,
@@ -663,6 +672,18 @@ private:
     std::unique_ptr<MotionEntry> splitMotionEvent(const MotionEntry& originalMotionEntry,
                                                   std::bitset<MAX_POINTER_ID + 1> pointerIds,
                                                   nsecs_t splitDownTime) REQUIRES(mLock);
+    // Same as splitMotionEvent, but reuses the split entry already created for another target of
+    // the event that is currently being dispatched, if it has the same pointers and down time.
+    std::shared_ptr<MotionEntry> getSplitMotionEventLocked(
+            const MotionEntry& originalMotionEntry, std::bitset<MAX_POINTER_ID + 1> pointerIds,
+            nsecs_t splitDownTime) REQUIRES(mLock);
+    struct SplitMotionCacheEntry {
+        std::bitset<MAX_POINTER_ID + 1> pointerIds;
+        nsecs_t splitDownTime;
+        std::shared_ptr<MotionEntry> entry;
+    };
+    // Only valid while dispatchEventLocked is running, and cleared at the end of it.
+    std::vector<SplitMotionCacheEntry> mSplitMotionCache GUARDED_BY(mLock);
 
     // Reset and drop everything the dispatcher is doing.
     void resetAndDropEverythingLocked(const char* reason) REQUIRES(mLock);
@@ -73,10 +73,11 @@ private:
 };
 
 struct InputEventTimeline {
-    InputEventTimeline(bool isDown, nsecs_t eventTime, nsecs_t readTime);
+    InputEventTimeline(bool isDown, nsecs_t eventTime, nsecs_t readTime, int32_t deviceId = -1);
     const bool isDown; // True if this is an ACTION_DOWN event
     const nsecs_t eventTime;
     const nsecs_t readTime;
+    const int32_t deviceId;
 
     struct IBinderHash {
         std::size_t operator()(const sp<IBinder>& b) const {
@@ -123,6 +123,15 @@ AStatsManager_PullAtomCallbackReturn LatencyAggregator::pullAtomCallback(int32_t
 void LatencyAggregator::processTimeline(const InputEventTimeline& timeline) {
     processStatistics(timeline);
     processSlowEvent(timeline);
+    mLatencyBreakdown.processTimeline(timeline);
+}
+
+void LatencyAggregator::addConnection(const sp<IBinder>& connectionToken, std::string name) {
+    mLatencyBreakdown.addConnection(connectionToken, std::move(name));
+}
+
+void LatencyAggregator::removeConnection(const sp<IBinder>& connectionToken) {
+    mLatencyBreakdown.removeConnection(connectionToken);
 }
 
 void LatencyAggregator::processStatistics(const InputEventTimeline& timeline) {
@@ -276,7 +285,8 @@ std::string LatencyAggregator::dump(const char* prefix) const {
             StringPrintf("%s  mLastSlowEventTime=%" PRId64 "\n", prefix, mLastSlowEventTime) +
             StringPrintf("%s  mNumEventsSinceLastSlowEventReport = %zu\n", prefix,
                          mNumEventsSinceLastSlowEventReport) +
-            StringPrintf("%s  mNumSkippedSlowEvents = %zu\n", prefix, mNumSkippedSlowEvents);
+            StringPrintf("%s  mNumSkippedSlowEvents = %zu\n", prefix, mNumSkippedSlowEvents) +
+            mLatencyBreakdown.dump((std::string(prefix) + "  ").c_str());
 }
 
 } // namespace android::inputdispatcher
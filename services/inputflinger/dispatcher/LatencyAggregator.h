@@ -21,6 +21,7 @@
 #include <utils/Timers.h>
 
 #include "InputEventTimeline.h"
+#include "LatencyBreakdown.h"
 
 namespace android::inputdispatcher {
 
@@ -55,6 +56,11 @@ public:
      * Record a complete event timeline
      */
     void processTimeline(const InputEventTimeline& timeline) override;
+    /**
+     * Start or stop breaking down the latency of the events received by a connection.
+     */
+    void addConnection(const sp<IBinder>& connectionToken, std::string name);
+    void removeConnection(const sp<IBinder>& connectionToken);
 
     std::string dump(const char* prefix) const;
 
@@ -82,6 +88,9 @@ private:
             mMoveSketches;
     // How many events have been processed so far
     size_t mNumSketchEventsProcessed = 0;
+
+    // ---------- Per-device and per-window breakdown ----------
+    LatencyBreakdown mLatencyBreakdown;
 };
 
 } // namespace android::inputdispatcher
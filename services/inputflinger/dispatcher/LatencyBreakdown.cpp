@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LatencyBreakdown"
+#define ATRACE_TAG ATRACE_TAG_INPUT
+
+#include "LatencyBreakdown.h"
+
+#include <inttypes.h>
+#include <cmath>
+
+#include <android-base/stringprintf.h>
+#include <utils/Trace.h>
+
+using android::base::StringPrintf;
+
+namespace android::inputdispatcher {
+
+void LatencyBreakdown::Histogram::add(nsecs_t latency) {
+    if (latency < 0) {
+        // Some of the times are reported by the app, don't let them skew the histogram.
+        return;
+    }
+    const nsecs_t latencyUs = ns2us(latency);
+    size_t bucket = 0;
+    while (bucket + 1 < NUM_BUCKETS && (latencyUs >> (bucket + 1)) > 0) {
+        bucket++;
+    }
+    mBuckets[bucket]++;
+    mCount++;
+}
+
+nsecs_t LatencyBreakdown::Histogram::percentile(float percent) const {
+    if (mCount == 0) {
+        return 0;
+    }
+    const uint64_t target = std::max<uint64_t>(1, std::ceil(mCount * percent / 100.f));
+    uint64_t seen = 0;
+    size_t bucket = 0;
+    for (; bucket + 1 < NUM_BUCKETS; bucket++) {
+        seen += mBuckets[bucket];
+        if (seen >= target) {
+            break;
+        }
+    }
+    return us2ns(int64_t(1) << (bucket + 1));
+}
+
+void LatencyBreakdown::addConnection(const sp<IBinder>& connectionToken, std::string name) {
+    std::string traceName = "Input latency " + name;
+    mConnectionStats[connectionToken] = {std::move(name), std::move(traceName), {}};
+}
+
+void LatencyBreakdown::removeConnection(const sp<IBinder>& connectionToken) {
+    mConnectionStats.erase(connectionToken);
+}
+
+void LatencyBreakdown::processTimeline(const InputEventTimeline& timeline) {
+    StageHistograms* deviceHistograms = nullptr;
+    if (auto it = mDeviceHistograms.find(timeline.deviceId); it != mDeviceHistograms.end()) {
+        deviceHistograms = &it->second;
+    } else if (mDeviceHistograms.size() < MAX_DEVICES) {
+        deviceHistograms = &mDeviceHistograms[timeline.deviceId];
+    }
+
+    const auto add = [&](StageHistograms* connectionHistograms, Stage stage, nsecs_t latency) {
+        if (deviceHistograms != nullptr) {
+            (*deviceHistograms)[ftl::to_underlying(stage)].add(latency);
+        }
+        if (connectionHistograms != nullptr) {
+            (*connectionHistograms)[ftl::to_underlying(stage)].add(latency);
+        }
+    };
+
+    add(nullptr, Stage::EVENT_TO_READ, timeline.readTime - timeline.eventTime);
+
+    for (const auto& [connectionToken, connectionTimeline] : timeline.connectionTimelines) {
+        if (!connectionTimeline.isComplete()) {
+            continue;
+        }
+        const auto statsIt = mConnectionStats.find(connectionToken);
+        StageHistograms* connectionHistograms = nullptr;
+        if (statsIt != mConnectionStats.end()) {
+            connectionHistograms = &statsIt->second.histograms;
+            (*connectionHistograms)[ftl::to_underlying(Stage::EVENT_TO_READ)].add(
+                    timeline.readTime - timeline.eventTime);
+        }
+
+        const nsecs_t gpuCompletedTime =
+                connectionTimeline.graphicsTimeline[GraphicsTimeline::GPU_COMPLETED_TIME];
+        const nsecs_t presentTime =
+                connectionTimeline.graphicsTimeline[GraphicsTimeline::PRESENT_TIME];
+        add(connectionHistograms, Stage::READ_TO_DELIVER,
+            connectionTimeline.deliveryTime - timeline.readTime);
+        add(connectionHistograms, Stage::DELIVER_TO_CONSUME,
+            connectionTimeline.consumeTime - connectionTimeline.deliveryTime);
+        add(connectionHistograms, Stage::CONSUME_TO_FINISH,
+            connectionTimeline.finishTime - connectionTimeline.consumeTime);
+        add(connectionHistograms, Stage::CONSUME_TO_GPU_COMPLETE,
+            gpuCompletedTime - connectionTimeline.consumeTime);
+        add(connectionHistograms, Stage::GPU_COMPLETE_TO_PRESENT, presentTime - gpuCompletedTime);
+        add(connectionHistograms, Stage::END_TO_END, presentTime - timeline.eventTime);
+
+        if (statsIt != mConnectionStats.end() && ATRACE_ENABLED()) {
+            ATRACE_INT64(statsIt->second.traceName.c_str(),
+                         ns2us(presentTime - timeline.eventTime));
+        }
+    }
+}
+
+const LatencyBreakdown::StageHistograms* LatencyBreakdown::getDeviceHistograms(
+        int32_t deviceId) const {
+    const auto it = mDeviceHistograms.find(deviceId);
+    return it == mDeviceHistograms.end() ? nullptr : &it->second;
+}
+
+const LatencyBreakdown::StageHistograms* LatencyBreakdown::getConnectionHistograms(
+        const sp<IBinder>& connectionToken) const {
+    const auto it = mConnectionStats.find(connectionToken);
+    return it == mConnectionStats.end() ? nullptr : &it->second.histograms;
+}
+
+static std::string dumpStageHistograms(const LatencyBreakdown::StageHistograms& histograms,
+                                       const char* prefix) {
+    std::string dump;
+    for (LatencyBreakdown::Stage stage : ftl::enum_range<LatencyBreakdown::Stage>()) {
+        const LatencyBreakdown::Histogram& histogram = histograms[ftl::to_underlying(stage)];
+        if (histogram.count() == 0) {
+            continue;
+        }
+        dump += StringPrintf("%s%s: count=%" PRIu64 " p50=%" PRId64 "us p90=%" PRId64
+                             "us p99=%" PRId64 "us\n",
+                             prefix, ftl::enum_string(stage).c_str(), histogram.count(),
+                             ns2us(histogram.percentile(50)), ns2us(histogram.percentile(90)),
+                             ns2us(histogram.percentile(99)));
+    }
+    return dump;
+}
+
+std::string LatencyBreakdown::dump(const char* prefix) const {
+    const std::string stagePrefix = std::string(prefix) + "      ";
+    std::string dump = StringPrintf("%sLatencyBreakdown:\n", prefix);
+    dump += StringPrintf("%s  By device:\n", prefix);
+    for (const auto& [deviceId, histograms] : mDeviceHistograms) {
+        dump += StringPrintf("%s    deviceId=%" PRId32 "\n", prefix, deviceId);
+        dump += dumpStageHistograms(histograms, stagePrefix.c_str());
+    }
+    dump += StringPrintf("%s  By window:\n", prefix);
+    for (const auto& [_, stats] : mConnectionStats) {
+        if (stats.histograms[ftl::to_underlying(Stage::END_TO_END)].count() == 0) {
+            continue;
+        }
+        dump += StringPrintf("%s    %s\n", prefix, stats.name.c_str());
+        dump += dumpStageHistograms(stats.histograms, stagePrefix.c_str());
+    }
+    return dump;
+}
+
+} // namespace android::inputdispatcher
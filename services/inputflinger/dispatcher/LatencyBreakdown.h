@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include <binder/IBinder.h>
+#include <ftl/enum.h>
+#include <utils/Timers.h>
+
+#include "InputEventTimeline.h"
+
+namespace android::inputdispatcher {
+
+/**
+ * Keeps always-on histograms of the time input events spend in each stage of their lifecycle,
+ * broken down by input device and by the window that received them, so that they can be
+ * inspected with dumpsys input. The end-to-end latency of each window is also emitted as a trace
+ * counter, which shows up as a per-window track in perfetto.
+ *
+ * Only the connections registered with addConnection are tracked.
+ *
+ * Not thread-safe.
+ */
+class LatencyBreakdown {
+public:
+    enum class Stage : size_t {
+        EVENT_TO_READ,
+        READ_TO_DELIVER,
+        DELIVER_TO_CONSUME,
+        CONSUME_TO_FINISH,
+        CONSUME_TO_GPU_COMPLETE,
+        GPU_COMPLETE_TO_PRESENT,
+        END_TO_END,
+
+        ftl_last = END_TO_END
+    };
+
+    /**
+     * Bucket i counts the latencies in [2^i, 2^(i+1)) microseconds. The first bucket also includes
+     * anything faster, and the last one anything slower.
+     */
+    class Histogram {
+    public:
+        void add(nsecs_t latency);
+        // Returns the upper bound of the bucket that holds the given percentile, or 0 if empty.
+        nsecs_t percentile(float percent) const;
+        uint64_t count() const { return mCount; }
+
+    private:
+        static constexpr size_t NUM_BUCKETS = 24;
+        std::array<uint32_t, NUM_BUCKETS> mBuckets{};
+        uint64_t mCount = 0;
+    };
+
+    using StageHistograms = std::array<Histogram, ftl::enum_size_v<Stage>>;
+
+    void addConnection(const sp<IBinder>& connectionToken, std::string name);
+    void removeConnection(const sp<IBinder>& connectionToken);
+
+    void processTimeline(const InputEventTimeline& timeline);
+
+    const StageHistograms* getDeviceHistograms(int32_t deviceId) const;
+    const StageHistograms* getConnectionHistograms(const sp<IBinder>& connectionToken) const;
+
+    std::string dump(const char* prefix) const;
+
+private:
+    // Devices beyond this number are not tracked, to bound the memory used by fuzzed or
+    // misbehaving device ids.
+    static constexpr size_t MAX_DEVICES = 32;
+
+    struct ConnectionStats {
+        std::string name;
+        std::string traceName;
+        StageHistograms histograms;
+    };
+
+    std::map<int32_t /*deviceId*/, StageHistograms> mDeviceHistograms;
+    std::unordered_map<sp<IBinder>, ConnectionStats, InputEventTimeline::IBinderHash>
+            mConnectionStats;
+};
+
+} // namespace android::inputdispatcher
@@ -66,7 +66,7 @@ LatencyTracker::LatencyTracker(InputEventTimelineProcessor* processor)
 }
 
 void LatencyTracker::trackListener(int32_t inputEventId, bool isDown, nsecs_t eventTime,
-                                   nsecs_t readTime) {
+                                   nsecs_t readTime, int32_t deviceId) {
     reportAndPruneMatureRecords(eventTime);
     const auto it = mTimelines.find(inputEventId);
     if (it != mTimelines.end()) {
@@ -78,7 +78,7 @@ void LatencyTracker::trackListener(int32_t inputEventId, bool isDown, nsecs_t ev
         eraseByValue(mEventTimes, inputEventId);
         return;
     }
-    mTimelines.emplace(inputEventId, InputEventTimeline(isDown, eventTime, readTime));
+    mTimelines.emplace(inputEventId, InputEventTimeline(isDown, eventTime, readTime, deviceId));
     mEventTimes.emplace(eventTime, inputEventId);
 }
 
@@ -140,6 +140,20 @@ void LatencyTracker::trackGraphicsLatency(
     }
 }
 
+void LatencyTracker::trackDeliveryLatency(InputChannel::Transport transport, nsecs_t deliveryTime,
+                                          nsecs_t consumeTime) {
+    if (consumeTime < deliveryTime) {
+        // The consume time is reported by the app, don't let it skew the histogram.
+        return;
+    }
+    const nsecs_t latencyUs = ns2us(consumeTime - deliveryTime);
+    size_t bucket = 0;
+    while (bucket + 1 < DELIVERY_LATENCY_BUCKETS && (latencyUs >> (bucket + 1)) > 0) {
+        bucket++;
+    }
+    mDeliveryLatencyHistograms[ftl::to_underlying(transport)][bucket]++;
+}
+
 /**
  * We should use the current time 'now()' here to determine the age of the event, but instead we
  * are using the latest 'eventTime' for efficiency since this time is already acquired, and
@@ -166,9 +180,21 @@ void LatencyTracker::reportAndPruneMatureRecords(nsecs_t newEventTime) {
 }
 
 std::string LatencyTracker::dump(const char* prefix) const {
-    return StringPrintf("%sLatencyTracker:\n", prefix) +
+    std::string dump = StringPrintf("%sLatencyTracker:\n", prefix) +
             StringPrintf("%s  mTimelines.size() = %zu\n", prefix, mTimelines.size()) +
             StringPrintf("%s  mEventTimes.size() = %zu\n", prefix, mEventTimes.size());
+    for (size_t i = 0; i < mDeliveryLatencyHistograms.size(); i++) {
+        const auto transport = static_cast<InputChannel::Transport>(i);
+        dump += StringPrintf("%s  Delivery latency histogram (%s):", prefix,
+                             ftl::enum_string(transport).c_str());
+        for (size_t bucket = 0; bucket < DELIVERY_LATENCY_BUCKETS; bucket++) {
+            const uint64_t lowerBoundUs = bucket == 0 ? 0 : uint64_t(1) << bucket;
+            dump += StringPrintf(" %" PRIu64 "us:%" PRIu64, lowerBoundUs,
+                                 mDeliveryLatencyHistograms[i][bucket]);
+        }
+        dump += "\n";
+    }
+    return dump;
 }
 
 } // namespace android::inputdispatcher
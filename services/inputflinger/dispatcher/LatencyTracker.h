@@ -16,11 +16,14 @@
 
 #pragma once
 
+#include <array>
 #include <map>
 #include <unordered_map>
 
 #include <binder/IBinder.h>
+#include <ftl/enum.h>
 #include <input/Input.h>
+#include <input/InputTransport.h>
 
 #include "InputEventTimeline.h"
 
@@ -49,11 +52,19 @@ public:
      * duplicate events that happen to have the same eventTime and inputEventId. Therefore, we
      * must drop all duplicate data.
      */
-    void trackListener(int32_t inputEventId, bool isDown, nsecs_t eventTime, nsecs_t readTime);
+    void trackListener(int32_t inputEventId, bool isDown, nsecs_t eventTime, nsecs_t readTime,
+                       int32_t deviceId = -1);
     void trackFinishedEvent(int32_t inputEventId, const sp<IBinder>& connectionToken,
                             nsecs_t deliveryTime, nsecs_t consumeTime, nsecs_t finishTime);
     void trackGraphicsLatency(int32_t inputEventId, const sp<IBinder>& connectionToken,
                               std::array<nsecs_t, GraphicsTimeline::SIZE> timeline);
+    /**
+     * Record how long an event spent between being published to an input channel and being
+     * consumed by the app, for the transport that the channel used. The distribution for each
+     * transport is shown in the dump.
+     */
+    void trackDeliveryLatency(InputChannel::Transport transport, nsecs_t deliveryTime,
+                              nsecs_t consumeTime);
 
     std::string dump(const char* prefix) const;
 
@@ -75,6 +86,16 @@ private:
      */
     std::multimap<nsecs_t /*eventTime*/, int32_t /*inputEventId*/> mEventTimes;
 
+    /**
+     * Delivery latency histograms, indexed by transport. Bucket i counts the latencies in
+     * [2^i, 2^(i+1)) microseconds. The first bucket also includes anything faster, and the last one
+     * anything slower.
+     */
+    static constexpr size_t DELIVERY_LATENCY_BUCKETS = 16;
+    std::array<std::array<uint64_t, DELIVERY_LATENCY_BUCKETS>,
+               ftl::enum_size_v<InputChannel::Transport>>
+            mDeliveryLatencyHistograms{};
+
     InputEventTimelineProcessor* mTimelineProcessor;
     void reportAndPruneMatureRecords(nsecs_t newEventTime);
 };
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "WindowHitTestIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using android::gui::WindowInfo;
+using android::gui::WindowInfoHandle;
+
+namespace android::inputdispatcher {
+
+namespace {
+
+// Number of cells along each axis of the grid. Window layouts are dominated by a few large windows
+// and many small ones (status bar, navigation bar, bubbles, pip), so a modest grid is enough to
+// separate them without making rebuilds expensive.
+constexpr int64_t GRID_SIZE = 16;
+
+std::vector<Rect> computeTouchableBounds(const std::vector<sp<WindowInfoHandle>>& windowHandles,
+                                         const ui::Transform& displayTransform) {
+    std::vector<Rect> bounds;
+    bounds.reserve(windowHandles.size());
+    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+        const WindowInfo& info = *windowHandle->getInfo();
+        if (info.inputConfig.test(WindowInfo::InputConfig::NOT_VISIBLE)) {
+            // Invisible windows never accept touches, so leave them out of the grid.
+            bounds.push_back(Rect::EMPTY_RECT);
+            continue;
+        }
+        // Hit tests are performed in the logical display space, see windowAcceptsTouchAt.
+        bounds.push_back(displayTransform.transform(info.touchableRegion).getBounds());
+    }
+    return bounds;
+}
+
+std::vector<Rect> computeFrameBounds(const std::vector<sp<WindowInfoHandle>>& windowHandles) {
+    std::vector<Rect> bounds;
+    bounds.reserve(windowHandles.size());
+    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+        const WindowInfo& info = *windowHandle->getInfo();
+        bounds.emplace_back(info.frameLeft, info.frameTop, info.frameRight, info.frameBottom);
+    }
+    return bounds;
+}
+
+} // namespace
+
+WindowHitTestIndex::Grid::Grid(const std::vector<Rect>& bounds) : mBounds(Rect::EMPTY_RECT) {
+    for (const Rect& rect : bounds) {
+        if (rect.isEmpty()) {
+            continue;
+        }
+        if (mBounds.isEmpty()) {
+            mBounds = rect;
+        } else {
+            mBounds.left = std::min(mBounds.left, rect.left);
+            mBounds.top = std::min(mBounds.top, rect.top);
+            mBounds.right = std::max(mBounds.right, rect.right);
+            mBounds.bottom = std::max(mBounds.bottom, rect.bottom);
+        }
+    }
+    if (mBounds.isEmpty()) {
+        return;
+    }
+
+    // Use 64-bit math, the bounds of unbounded touchable regions can span the whole int32 range.
+    const int64_t width = int64_t(mBounds.right) - mBounds.left;
+    const int64_t height = int64_t(mBounds.bottom) - mBounds.top;
+    mCellWidth = (width + GRID_SIZE - 1) / GRID_SIZE;
+    mCellHeight = (height + GRID_SIZE - 1) / GRID_SIZE;
+    mColumns = static_cast<size_t>((width + mCellWidth - 1) / mCellWidth);
+    mRows = static_cast<size_t>((height + mCellHeight - 1) / mCellHeight);
+
+    struct CellRange {
+        size_t firstColumn, lastColumn, firstRow, lastRow;
+    };
+    const auto cellRangeOf = [this](const Rect& rect) {
+        return CellRange{static_cast<size_t>((int64_t(rect.left) - mBounds.left) / mCellWidth),
+                         static_cast<size_t>((int64_t(rect.right) - 1 - mBounds.left) /
+                                             mCellWidth),
+                         static_cast<size_t>((int64_t(rect.top) - mBounds.top) / mCellHeight),
+                         static_cast<size_t>((int64_t(rect.bottom) - 1 - mBounds.top) /
+                                             mCellHeight)};
+    };
+
+    // Count the entries of every cell first so that all of them can live in a single array.
+    mCellStarts.assign(mColumns * mRows + 1, 0);
+    for (const Rect& rect : bounds) {
+        if (rect.isEmpty()) {
+            continue;
+        }
+        const CellRange range = cellRangeOf(rect);
+        for (size_t row = range.firstRow; row <= range.lastRow; row++) {
+            for (size_t column = range.firstColumn; column <= range.lastColumn; column++) {
+                mCellStarts[row * mColumns + column + 1]++;
+            }
+        }
+    }
+    for (size_t i = 1; i < mCellStarts.size(); i++) {
+        mCellStarts[i] += mCellStarts[i - 1];
+    }
+
+    // Windows are visited in z-order, so the entries of every cell end up sorted front to back.
+    mEntries.resize(mCellStarts.back());
+    std::vector<size_t> cellEnds(mCellStarts.begin(), mCellStarts.end() - 1);
+    for (size_t i = 0; i < bounds.size(); i++) {
+        if (bounds[i].isEmpty()) {
+            continue;
+        }
+        const CellRange range = cellRangeOf(bounds[i]);
+        for (size_t row = range.firstRow; row <= range.lastRow; row++) {
+            for (size_t column = range.firstColumn; column <= range.lastColumn; column++) {
+                mEntries[cellEnds[row * mColumns + column]++] = i;
+            }
+        }
+    }
+}
+
+std::span<const size_t> WindowHitTestIndex::Grid::at(int32_t x, int32_t y) const {
+    if (x < mBounds.left || x >= mBounds.right || y < mBounds.top || y >= mBounds.bottom) {
+        return {};
+    }
+    const size_t column = static_cast<size_t>((int64_t(x) - mBounds.left) / mCellWidth);
+    const size_t row = static_cast<size_t>((int64_t(y) - mBounds.top) / mCellHeight);
+    const size_t cell = row * mColumns + column;
+    return std::span<const size_t>(mEntries).subspan(mCellStarts[cell],
+                                                     mCellStarts[cell + 1] - mCellStarts[cell]);
+}
+
+WindowHitTestIndex::WindowHitTestIndex(const std::vector<sp<WindowInfoHandle>>& windowHandles,
+                                       const ui::Transform& displayTransform)
+      : mDisplayTransform(displayTransform),
+        mTouchableBounds(computeTouchableBounds(windowHandles, displayTransform)),
+        mFrameBounds(computeFrameBounds(windowHandles)) {
+    for (size_t i = 0; i < windowHandles.size(); i++) {
+        if (windowHandles[i]->getInfo()->inputConfig.test(
+                    WindowInfo::InputConfig::WATCH_OUTSIDE_TOUCH)) {
+            mOutsideTouchWatchers.push_back(i);
+        }
+        mZOrderByHandle.emplace(windowHandles[i].get(), i);
+    }
+}
+
+std::span<const size_t> WindowHitTestIndex::getTouchCandidatesAt(float x, float y) const {
+    // Mirror the rounding done by windowAcceptsTouchAt.
+    const auto p = mDisplayTransform.transform(x, y);
+    const float px = std::floor(p.x);
+    const float py = std::floor(p.y);
+    constexpr float kMin = static_cast<float>(std::numeric_limits<int32_t>::min());
+    constexpr float kMax = static_cast<float>(std::numeric_limits<int32_t>::max());
+    if (!(px >= kMin && px < kMax && py >= kMin && py < kMax)) {
+        return {};
+    }
+    return mTouchableBounds.at(static_cast<int32_t>(px), static_cast<int32_t>(py));
+}
+
+std::span<const size_t> WindowHitTestIndex::getFrameCandidatesAt(int32_t x, int32_t y) const {
+    return mFrameBounds.at(x, y);
+}
+
+std::optional<size_t> WindowHitTestIndex::getZOrder(
+        const sp<WindowInfoHandle>& windowHandle) const {
+    const auto it = mZOrderByHandle.find(windowHandle.get());
+    if (it == mZOrderByHandle.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <gui/WindowInfo.h>
+#include <ui/Rect.h>
+#include <ui/Transform.h>
+
+namespace android::inputdispatcher {
+
+// Coarse spatial index over the windows of a single display, used to narrow down the windows
+// that need to be hit tested for a given touch location.
+//
+// The index is built from the window handles of a display in z-order (front to back) and refers
+// to windows by their position in that list. Lookups return the positions of the windows whose
+// bounds contain the queried point, in ascending order, so callers can walk them exactly like
+// they would walk the full list. The bounds are only a conservative approximation of the
+// windows' shapes, so callers must still perform the precise hit test on every candidate.
+//
+// The index must be rebuilt whenever the window handles of the display or the display transform
+// change.
+class WindowHitTestIndex {
+public:
+    WindowHitTestIndex(const std::vector<sp<gui::WindowInfoHandle>>& windowHandles,
+                       const ui::Transform& displayTransform);
+
+    // The display transform the touchable bounds were computed with.
+    const ui::Transform& getDisplayTransform() const { return mDisplayTransform; }
+
+    // Windows whose touchable region may contain the given point in display space.
+    std::span<const size_t> getTouchCandidatesAt(float x, float y) const;
+
+    // Windows whose frame may contain the given point. Frames are not transformed, so the point is
+    // in the same coordinate space as WindowInfo::frameContainsPoint.
+    std::span<const size_t> getFrameCandidatesAt(int32_t x, int32_t y) const;
+
+    // Windows that have WATCH_OUTSIDE_TOUCH set, regardless of their bounds.
+    std::span<const size_t> getOutsideTouchWatchers() const { return mOutsideTouchWatchers; }
+
+    // The z-order position of the given window, or nullopt if the window is not part of the index.
+    std::optional<size_t> getZOrder(const sp<gui::WindowInfoHandle>& windowHandle) const;
+
+    size_t size() const { return mZOrderByHandle.size(); }
+
+private:
+    // Uniform grid over the union of all bounds, storing per cell the positions of the windows
+    // whose bounds intersect it. Cells are stored contiguously to keep rebuilds allocation-light.
+    class Grid {
+    public:
+        explicit Grid(const std::vector<Rect>& bounds);
+        std::span<const size_t> at(int32_t x, int32_t y) const;
+
+    private:
+        Rect mBounds;
+        int64_t mCellWidth = 1;
+        int64_t mCellHeight = 1;
+        size_t mColumns = 0;
+        size_t mRows = 0;
+        // Entries for cell i are mEntries[mCellStarts[i], mCellStarts[i + 1]).
+        std::vector<size_t> mCellStarts;
+        std::vector<size_t> mEntries;
+    };
+
+    ui::Transform mDisplayTransform;
+    Grid mTouchableBounds;
+    Grid mFrameBounds;
+    std::vector<size_t> mOutsideTouchWatchers;
+    std::unordered_map<const gui::WindowInfoHandle*, size_t> mZOrderByHandle;
+};
+
+} // namespace android::inputdispatcher
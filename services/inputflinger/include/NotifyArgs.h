@@ -129,10 +129,21 @@ struct NotifyMotionArgs {
                      const PointerProperties* pointerProperties, const PointerCoords* pointerCoords,
                      float xPrecision, float yPrecision, float xCursorPosition,
                      float yCursorPosition, nsecs_t downTime,
-                     const std::vector<TouchVideoFrame>& videoFrames);
+                     std::vector<TouchVideoFrame> videoFrames);
+
+    NotifyMotionArgs(int32_t id, nsecs_t eventTime, nsecs_t readTime, int32_t deviceId,
+                     uint32_t source, int32_t displayId, uint32_t policyFlags, int32_t action,
+                     int32_t actionButton, int32_t flags, int32_t metaState, int32_t buttonState,
+                     MotionClassification classification, int32_t edgeFlags,
+                     std::vector<PointerProperties> pointerProperties,
+                     std::vector<PointerCoords> pointerCoords, float xPrecision, float yPrecision,
+                     float xCursorPosition, float yCursorPosition, nsecs_t downTime,
+                     std::vector<TouchVideoFrame> videoFrames);
 
     NotifyMotionArgs(const NotifyMotionArgs& other) = default;
+    NotifyMotionArgs(NotifyMotionArgs&& other) = default;
     NotifyMotionArgs& operator=(const android::NotifyMotionArgs&) = default;
+    NotifyMotionArgs& operator=(android::NotifyMotionArgs&&) = default;
 
     bool operator==(const NotifyMotionArgs& rhs) const;
 
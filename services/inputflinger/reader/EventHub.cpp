@@ -1753,12 +1753,15 @@ std::optional<int32_t> EventHub::getBatteryStatus(int32_t deviceId, int32_t batt
     return std::nullopt;
 }
 
-std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
+void EventHub::getEvents(int timeoutMillis, std::vector<RawEvent>& events) {
     std::scoped_lock _l(mLock);
 
     std::array<input_event, EVENT_BUFFER_SIZE> readBuffer;
 
-    std::vector<RawEvent> events;
+    // Never hold more than EVENT_BUFFER_SIZE events, so the caller's buffer stops growing after
+    // the first few calls.
+    events.clear();
+    events.reserve(EVENT_BUFFER_SIZE);
     bool awoken = false;
     for (;;) {
         nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
@@ -1900,14 +1903,22 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
             }
             // This must be an input event
             if (eventItem.events & EPOLLIN) {
+                // Only read as many events as there is room for. The rest stays in the kernel
+                // buffer and is read on the next call, without waiting in epoll again.
+                const size_t capacity =
+                        events.size() < readBuffer.size() ? readBuffer.size() - events.size() : 0;
+                if (capacity == 0) {
+                    mPendingEventIndex -= 1;
+                    break;
+                }
                 int32_t readSize =
                         read(device->fd, readBuffer.data(),
-                             sizeof(decltype(readBuffer)::value_type) * readBuffer.size());
+                             sizeof(decltype(readBuffer)::value_type) * capacity);
                 if (readSize == 0 || (readSize < 0 && errno == ENODEV)) {
                     // Device was removed before INotify noticed.
                     ALOGW("could not get event, removed? (fd: %d size: %" PRId32
                           " capacity: %zu errno: %d)\n",
-                          device->fd, readSize, readBuffer.size(), errno);
+                          device->fd, readSize, capacity, errno);
                     deviceChanged = true;
                     closeDeviceLocked(*device);
                 } else if (readSize < 0) {
@@ -1918,13 +1929,17 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
                     ALOGE("could not get event (wrong size: %d)", readSize);
                 } else {
                     const int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
+                    device->readCount++;
+                    device->readBytes += readSize;
 
+                    // All of these events were read at the same time.
+                    const nsecs_t readTime = systemTime(SYSTEM_TIME_MONOTONIC);
                     const size_t count = size_t(readSize) / sizeof(struct input_event);
                     for (size_t i = 0; i < count; i++) {
                         struct input_event& iev = readBuffer[i];
                         events.push_back({
                                 .when = processEventTimestamp(iev),
-                                .readTime = systemTime(SYSTEM_TIME_MONOTONIC),
+                                .readTime = readTime,
                                 .deviceId = deviceId,
                                 .type = iev.type,
                                 .code = iev.code,
@@ -2803,6 +2818,8 @@ void EventHub::dump(std::string& dump) const {
                                  device->associatedDevice
                                          ? device->associatedDevice->sysfsRootPath.c_str()
                                          : "<none>");
+            dump += StringPrintf(INDENT3 "Reads: count=%" PRIu64 ", bytes=%" PRIu64 "\n",
+                                 device->readCount, device->readBytes);
         }
 
         dump += INDENT "Unattached video devices:\n";
@@ -118,6 +118,10 @@ void InputDevice::dump(std::string& dump, const std::string& eventHubDevStr) {
                          inputEventSourceToString(deviceInfo.getSources()).c_str());
     dump += StringPrintf(INDENT2 "KeyboardType: %d\n", deviceInfo.getKeyboardType());
     dump += StringPrintf(INDENT2 "ControllerNum: %d\n", deviceInfo.getControllerNumber());
+    dump += StringPrintf(INDENT2 "ProcessingTime: batches=%zu, events=%zu, total=%.3fms, "
+                                 "max=%.3fms\n",
+                         mProcessedBatchCount, mProcessedEventCount,
+                         mTotalProcessingTime * 0.000001f, mMaxProcessingTime * 0.000001f);
 
     const std::vector<InputDeviceInfo::MotionRange>& ranges = deviceInfo.getMotionRanges();
     if (!ranges.empty()) {
@@ -347,6 +351,9 @@ std::list<NotifyArgs> InputDevice::process(const RawEvent* rawEvents, size_t cou
     // have side-effects that must be interleaved.  For example, joystick movement events and
     // gamepad button presses are handled by different mappers but they should be dispatched
     // in the order received.
+    const nsecs_t processingStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    mProcessedBatchCount++;
+    mProcessedEventCount += count;
     std::list<NotifyArgs> out;
     for (const RawEvent* rawEvent = rawEvents; count != 0; rawEvent++) {
         if (debugRawEvents()) {
@@ -376,6 +383,9 @@ std::list<NotifyArgs> InputDevice::process(const RawEvent* rawEvents, size_t cou
         }
         --count;
     }
+    const nsecs_t processingTime = systemTime(SYSTEM_TIME_MONOTONIC) - processingStartTime;
+    mTotalProcessingTime += processingTime;
+    mMaxProcessingTime = std::max(mMaxProcessingTime, processingTime);
     return out;
 }
 
@@ -133,14 +133,14 @@ void InputReader::loopOnce() {
         }
     } // release lock
 
-    std::vector<RawEvent> events = mEventHub->getEvents(timeoutMillis);
+    mEventHub->getEvents(timeoutMillis, mRawEvents);
 
     { // acquire lock
         std::scoped_lock _l(mLock);
         mReaderIsAliveCondition.notify_all();
 
-        if (!events.empty()) {
-            mPendingArgs += processEventsLocked(events.data(), events.size());
+        if (!mRawEvents.empty()) {
+            mPendingArgs += processEventsLocked(mRawEvents.data(), mRawEvents.size());
         }
 
         if (mNextTimeout != LLONG_MAX) {
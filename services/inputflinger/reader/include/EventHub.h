@@ -303,9 +303,10 @@ public:
      * The timeout is advisory only.  If the device is asleep, it will not wake just to
      * service the timeout.
      *
-     * Returns the number of events obtained, or 0 if the timeout expired.
+     * The events replace the contents of outEvents, which is left empty if the timeout expired.
+     * The caller should pass the same vector on every call so that its storage is reused.
      */
-    virtual std::vector<RawEvent> getEvents(int timeoutMillis) = 0;
+    virtual void getEvents(int timeoutMillis, std::vector<RawEvent>& outEvents) = 0;
     virtual std::vector<TouchVideoFrame> getVideoFrames(int32_t deviceId) = 0;
     virtual base::Result<std::pair<InputDeviceSensorType, int32_t>> mapSensor(
             int32_t deviceId, int32_t absCode) const = 0;
@@ -530,7 +531,7 @@ public:
     bool markSupportedKeyCodes(int32_t deviceId, const std::vector<int32_t>& keyCodes,
                                uint8_t* outFlags) const override final;
 
-    std::vector<RawEvent> getEvents(int timeoutMillis) override final;
+    void getEvents(int timeoutMillis, std::vector<RawEvent>& outEvents) override final;
     std::vector<TouchVideoFrame> getVideoFrames(int32_t deviceId) override final;
 
     bool hasScanCode(int32_t deviceId, int32_t scanCode) const override final;
@@ -626,6 +627,10 @@ private:
 
         int32_t controllerNumber;
 
+        // Number of successful reads from the device, and the number of bytes they returned.
+        uint64_t readCount = 0;
+        uint64_t readBytes = 0;
+
         Device(int fd, int32_t id, std::string path, InputDeviceIdentifier identifier,
                std::shared_ptr<const AssociatedDevice> assocDev);
         ~Device();
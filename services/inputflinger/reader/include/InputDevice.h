@@ -199,6 +199,13 @@ private:
     bool mHasMic;
     bool mDropUntilNextSync;
 
+    // Time spent processing raw events for this device, reported in dumps. Devices with expensive
+    // mappers delay the events of all other devices since they share the reader thread.
+    size_t mProcessedBatchCount = 0;
+    size_t mProcessedEventCount = 0;
+    nsecs_t mTotalProcessingTime = 0;
+    nsecs_t mMaxProcessingTime = 0;
+
     typedef int32_t (InputMapper::*GetStateFunc)(uint32_t sourceMask, int32_t code);
     int32_t getState(uint32_t sourceMask, int32_t code, GetStateFunc getStateFunc);
 
@@ -175,6 +175,10 @@ private:
     std::shared_ptr<EventHubInterface> mEventHub;
     sp<InputReaderPolicyInterface> mPolicy;
 
+    // The events read from the EventHub by the last loopOnce(). Only used by the reader thread,
+    // kept around so that its storage is reused.
+    std::vector<RawEvent> mRawEvents;
+
     // The next stage that should receive the events generated inside InputReader.
     InputListenerInterface& mNextListener;
     // As various events are generated inside InputReader, they are stored inside this list. The
@@ -119,6 +119,47 @@ void RawPointerData::getCentroidOfTouchingPointers(float* outX, float* outY) con
     *outY = y;
 }
 
+// --- CookedPointerData ---
+
+CookedPointerData& CookedPointerData::operator=(const CookedPointerData& other) {
+    if (this == &other) {
+        return *this;
+    }
+    for (uint32_t i = 0; i < other.pointerCount; i++) {
+        pointerProperties[i] = other.pointerProperties[i];
+        // PointerCoords packs the values of its axes at the front, copy just those.
+        const PointerCoords& in = other.pointerCoords[i];
+        PointerCoords& out = pointerCoords[i];
+        out.bits = in.bits;
+        out.isResampled = in.isResampled;
+        std::copy_n(in.values.begin(), BitSet64::count(in.bits), out.values.begin());
+    }
+    for (uint32_t i = other.pointerCount; i < pointerCount; i++) {
+        pointerProperties[i] = PointerProperties{};
+        pointerCoords[i] = PointerCoords{};
+    }
+    pointerCount = other.pointerCount;
+    hoveringIdBits = other.hoveringIdBits;
+    touchingIdBits = other.touchingIdBits;
+    canceledIdBits = other.canceledIdBits;
+    validIdBits = other.validIdBits;
+    idToIndex = other.idToIndex;
+    return *this;
+}
+
+void CookedPointerData::clear() {
+    for (uint32_t i = 0; i < pointerCount; i++) {
+        pointerProperties[i] = PointerProperties{};
+        pointerCoords[i] = PointerCoords{};
+    }
+    pointerCount = 0;
+    hoveringIdBits.clear();
+    touchingIdBits.clear();
+    canceledIdBits.clear();
+    validIdBits.clear();
+    idToIndex = {};
+}
+
 // --- TouchInputMapper ---
 
 TouchInputMapper::TouchInputMapper(InputDeviceContext& deviceContext,
@@ -3788,21 +3829,22 @@ NotifyMotionArgs TouchInputMapper::dispatchMotion(
         int32_t edgeFlags, const PropertiesArray& properties, const CoordsArray& coords,
         const IdToIndexArray& idToIndex, BitSet32 idBits, int32_t changedId, float xPrecision,
         float yPrecision, nsecs_t downTime, MotionClassification classification) {
-    PointerCoords pointerCoords[MAX_POINTERS];
-    PointerProperties pointerProperties[MAX_POINTERS];
-    uint32_t pointerCount = 0;
+    // Gather the pointers straight into the storage of the outgoing args.
+    std::vector<PointerProperties> pointerProperties;
+    std::vector<PointerCoords> pointerCoords;
+    pointerProperties.reserve(idBits.count());
+    pointerCoords.reserve(idBits.count());
     while (!idBits.isEmpty()) {
         uint32_t id = idBits.clearFirstMarkedBit();
         uint32_t index = idToIndex[id];
-        pointerProperties[pointerCount].copyFrom(properties[index]);
-        pointerCoords[pointerCount].copyFrom(coords[index]);
-
         if (changedId >= 0 && id == uint32_t(changedId)) {
-            action |= pointerCount << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
+            action |= static_cast<int32_t>(pointerProperties.size())
+                    << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
         }
-
-        pointerCount += 1;
+        pointerProperties.push_back(properties[index]);
+        pointerCoords.push_back(coords[index]);
     }
+    const uint32_t pointerCount = pointerProperties.size();
 
     ALOG_ASSERT(pointerCount != 0);
 
@@ -3829,7 +3871,8 @@ NotifyMotionArgs TouchInputMapper::dispatchMotion(
 
     const int32_t displayId = getAssociatedDisplayId().value_or(ADISPLAY_ID_NONE);
     const bool showDirectStylusPointer = mConfig.stylusPointerIconEnabled &&
-            mDeviceMode == DeviceMode::DIRECT && isStylusEvent(source, action, pointerProperties) &&
+            mDeviceMode == DeviceMode::DIRECT &&
+            isStylusEvent(source, action, pointerProperties.data()) &&
             mPointerController && displayId != ADISPLAY_ID_NONE &&
             displayId == mPointerController->getDisplayId();
     if (showDirectStylusPointer) {
@@ -3861,9 +3904,9 @@ NotifyMotionArgs TouchInputMapper::dispatchMotion(
                   [this](TouchVideoFrame& frame) { frame.rotate(this->mInputDeviceOrientation); });
     return NotifyMotionArgs(getContext()->getNextId(), when, readTime, deviceId, source, displayId,
                             policyFlags, action, actionButton, flags, metaState, buttonState,
-                            classification, edgeFlags, pointerCount, pointerProperties,
-                            pointerCoords, xPrecision, yPrecision, xCursorPosition, yCursorPosition,
-                            downTime, std::move(frames));
+                            classification, edgeFlags, std::move(pointerProperties),
+                            std::move(pointerCoords), xPrecision, yPrecision, xCursorPosition,
+                            yCursorPosition, downTime, std::move(frames));
 }
 
 std::list<NotifyArgs> TouchInputMapper::cancelTouch(nsecs_t when, nsecs_t readTime) {
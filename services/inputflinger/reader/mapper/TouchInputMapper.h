@@ -119,7 +119,14 @@ struct CookedPointerData {
     BitSet32 hoveringIdBits{}, touchingIdBits{}, canceledIdBits{}, validIdBits{};
     IdToIndexArray idToIndex{};
 
-    inline void clear() { *this = CookedPointerData(); }
+    CookedPointerData() = default;
+    CookedPointerData(const CookedPointerData& other) = default;
+    // Only the first pointerCount entries of the arrays are in use, and the cooked state is copied
+    // on every sync, so only those entries and the axes they carry are copied.
+    CookedPointerData& operator=(const CookedPointerData& other);
+
+    // Entries past pointerCount are always kept cleared, so only the ones in use are reset.
+    void clear();
 
     inline const PointerCoords& pointerCoordsForId(uint32_t id) const {
         return pointerCoords[idToIndex[id]];
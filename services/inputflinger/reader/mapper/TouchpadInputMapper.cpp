@@ -300,6 +300,8 @@ TouchpadInputMapper::TouchpadInputMapper(InputDeviceContext& deviceContext,
               deviceContext.getName().c_str());
     }
     mMotionAccumulator.configure(deviceContext, slotAxisInfo.maxValue + 1, true);
+    mLastFrameTrackingIds.reserve(mMotionAccumulator.getSlotCount());
+    mCurrentFrameTrackingIds.reserve(mMotionAccumulator.getSlotCount());
 
     mGestureInterpreter->Initialize(GESTURES_DEVCLASS_TOUCHPAD);
     mGestureInterpreter->SetHardwareProperties(createHardwareProperties(deviceContext));
@@ -442,8 +444,8 @@ std::list<NotifyArgs> TouchpadInputMapper::process(const RawEvent* rawEvent) {
     if (mPointerCaptured) {
         return mCapturedEventConverter.process(*rawEvent);
     }
-    std::optional<SelfContainedHardwareState> state = mStateConverter.processRawEvent(rawEvent);
-    if (state) {
+    SelfContainedHardwareState* state = mStateConverter.processRawEvent(rawEvent);
+    if (state != nullptr) {
         updatePalmDetectionMetrics();
         return sendHardwareState(rawEvent->when, rawEvent->readTime, *state);
     } else {
@@ -452,33 +454,35 @@ std::list<NotifyArgs> TouchpadInputMapper::process(const RawEvent* rawEvent) {
 }
 
 void TouchpadInputMapper::updatePalmDetectionMetrics() {
-    std::set<int32_t> currentTrackingIds;
+    mCurrentFrameTrackingIds.clear();
     for (size_t i = 0; i < mMotionAccumulator.getSlotCount(); i++) {
         const MultiTouchMotionAccumulator::Slot& slot = mMotionAccumulator.getSlot(i);
         if (!slot.isInUse()) {
             continue;
         }
-        currentTrackingIds.insert(slot.getTrackingId());
+        mCurrentFrameTrackingIds.push_back(slot.getTrackingId());
         if (slot.getToolType() == ToolType::PALM) {
             mPalmTrackingIds.insert(slot.getTrackingId());
         }
     }
-    std::vector<int32_t> liftedTouches;
-    std::set_difference(mLastFrameTrackingIds.begin(), mLastFrameTrackingIds.end(),
-                        currentTrackingIds.begin(), currentTrackingIds.end(),
-                        std::inserter(liftedTouches, liftedTouches.begin()));
-    for (int32_t trackingId : liftedTouches) {
+    std::sort(mCurrentFrameTrackingIds.begin(), mCurrentFrameTrackingIds.end());
+    for (int32_t trackingId : mLastFrameTrackingIds) {
+        if (std::binary_search(mCurrentFrameTrackingIds.begin(), mCurrentFrameTrackingIds.end(),
+                               trackingId)) {
+            continue;
+        }
+        // The touch was lifted.
         if (mPalmTrackingIds.erase(trackingId) > 0) {
             MetricsAccumulator::getInstance().recordPalm(mMetricsId);
         } else {
             MetricsAccumulator::getInstance().recordFinger(mMetricsId);
         }
     }
-    mLastFrameTrackingIds = currentTrackingIds;
+    std::swap(mLastFrameTrackingIds, mCurrentFrameTrackingIds);
 }
 
 std::list<NotifyArgs> TouchpadInputMapper::sendHardwareState(nsecs_t when, nsecs_t readTime,
-                                                             SelfContainedHardwareState schs) {
+                                                             SelfContainedHardwareState& schs) {
     ALOGD_IF(DEBUG_TOUCHPAD_GESTURES, "New hardware state: %s", schs.state.String().c_str());
     mProcessing = true;
     mGestureInterpreter->PushHardwareState(&schs.state);
@@ -505,7 +509,7 @@ std::list<NotifyArgs> TouchpadInputMapper::processGestures(nsecs_t when, nsecs_t
     std::list<NotifyArgs> out = {};
     MetricsAccumulator& metricsAccumulator = MetricsAccumulator::getInstance();
     for (Gesture& gesture : mGesturesToProcess) {
-        out += mGestureConverter.handleGesture(when, readTime, gesture);
+        mGestureConverter.handleGesture(when, readTime, gesture, out);
         metricsAccumulator.processGesture(mMetricsId, gesture);
     }
     mGesturesToProcess.clear();
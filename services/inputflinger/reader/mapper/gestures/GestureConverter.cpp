@@ -124,28 +124,45 @@ void GestureConverter::populateMotionRanges(InputDeviceInfo& info) const {
 
 std::list<NotifyArgs> GestureConverter::handleGesture(nsecs_t when, nsecs_t readTime,
                                                       const Gesture& gesture) {
+    std::list<NotifyArgs> out;
+    handleGesture(when, readTime, gesture, out);
+    return out;
+}
+
+void GestureConverter::handleGesture(nsecs_t when, nsecs_t readTime, const Gesture& gesture,
+                                     std::list<NotifyArgs>& out) {
     switch (gesture.type) {
         case kGestureTypeMove:
-            return {handleMove(when, readTime, gesture)};
+            // Moves are by far the most frequent gesture, so construct the args in place rather
+            // than going through an intermediate list.
+            out.emplace_back(handleMove(when, readTime, gesture));
+            break;
         case kGestureTypeButtonsChange:
-            return handleButtonsChange(when, readTime, gesture);
+            out += handleButtonsChange(when, readTime, gesture);
+            break;
         case kGestureTypeScroll:
-            return handleScroll(when, readTime, gesture);
+            out += handleScroll(when, readTime, gesture);
+            break;
         case kGestureTypeFling:
-            return handleFling(when, readTime, gesture);
+            out += handleFling(when, readTime, gesture);
+            break;
         case kGestureTypeSwipe:
-            return handleMultiFingerSwipe(when, readTime, 3, gesture.details.swipe.dx,
+            out += handleMultiFingerSwipe(when, readTime, 3, gesture.details.swipe.dx,
                                           gesture.details.swipe.dy);
+            break;
         case kGestureTypeFourFingerSwipe:
-            return handleMultiFingerSwipe(when, readTime, 4, gesture.details.four_finger_swipe.dx,
+            out += handleMultiFingerSwipe(when, readTime, 4, gesture.details.four_finger_swipe.dx,
                                           gesture.details.four_finger_swipe.dy);
+            break;
         case kGestureTypeSwipeLift:
         case kGestureTypeFourFingerSwipeLift:
-            return handleMultiFingerSwipeLift(when, readTime);
+            out += handleMultiFingerSwipeLift(when, readTime);
+            break;
         case kGestureTypePinch:
-            return handlePinch(when, readTime, gesture);
+            out += handlePinch(when, readTime, gesture);
+            break;
         default:
-            return {};
+            break;
     }
 }
 
@@ -310,7 +327,7 @@ std::list<NotifyArgs> GestureConverter::handleScroll(nsecs_t when, nsecs_t readT
                                mButtonState, /* pointerCount= */ 1, mFingerProps.data(),
                                mFakeFingerCoords.data(), xCursorPosition, yCursorPosition);
         args.flags |= AMOTION_EVENT_FLAG_IS_GENERATED_GESTURE;
-        out.push_back(args);
+        out.push_back(std::move(args));
     }
     float deltaX = gesture.details.scroll.dx;
     float deltaY = gesture.details.scroll.dy;
@@ -326,7 +343,7 @@ std::list<NotifyArgs> GestureConverter::handleScroll(nsecs_t when, nsecs_t readT
                            mButtonState, /* pointerCount= */ 1, mFingerProps.data(),
                            mFakeFingerCoords.data(), xCursorPosition, yCursorPosition);
     args.flags |= AMOTION_EVENT_FLAG_IS_GENERATED_GESTURE;
-    out.push_back(args);
+    out.push_back(std::move(args));
     return out;
 }
 
@@ -521,9 +538,11 @@ NotifyMotionArgs GestureConverter::endScroll(nsecs_t when, nsecs_t readTime) {
     mFakeFingerCoords[1].setAxisValue(AMOTION_EVENT_AXIS_X,
                                       xCursorPosition + mPinchFingerSeparation / 2);
     mFakeFingerCoords[1].setAxisValue(AMOTION_EVENT_AXIS_Y, yCursorPosition);
-    return {makeMotionArgs(when, readTime, AMOTION_EVENT_ACTION_MOVE, /*actionButton=*/0,
-                           mButtonState, /*pointerCount=*/2, mFingerProps.data(),
-                           mFakeFingerCoords.data(), xCursorPosition, yCursorPosition)};
+    std::list<NotifyArgs> out;
+    out.emplace_back(makeMotionArgs(when, readTime, AMOTION_EVENT_ACTION_MOVE, /*actionButton=*/0,
+                                    mButtonState, /*pointerCount=*/2, mFingerProps.data(),
+                                    mFakeFingerCoords.data(), xCursorPosition, yCursorPosition));
+    return out;
 }
 
 std::list<NotifyArgs> GestureConverter::endPinch(nsecs_t when, nsecs_t readTime) {
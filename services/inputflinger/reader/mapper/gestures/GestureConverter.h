@@ -50,6 +50,10 @@ public:
 
     [[nodiscard]] std::list<NotifyArgs> handleGesture(nsecs_t when, nsecs_t readTime,
                                                       const Gesture& gesture);
+    // Same as above, but appends the resulting events to out, so that the caller does not need to
+    // merge a separate list for every gesture.
+    void handleGesture(nsecs_t when, nsecs_t readTime, const Gesture& gesture,
+                       std::list<NotifyArgs>& out);
 
 private:
     [[nodiscard]] NotifyMotionArgs handleMove(nsecs_t when, nsecs_t readTime,
@@ -54,6 +54,26 @@ TEST(AnrTrackerTest, MultipleEntries_RemoveToken) {
     ASSERT_EQ(2, tracker.firstTimeout());
 }
 
+TEST(AnrTrackerTest, EraseThenRemoveToken_Empty) {
+    AnrTracker tracker;
+
+    sp<IBinder> token1 = sp<BBinder>::make();
+    sp<IBinder> token2 = sp<BBinder>::make();
+
+    tracker.insert(1, token1);
+    tracker.insert(1, token1);
+    tracker.insert(2, token2);
+    tracker.insert(3, token1);
+
+    tracker.erase(1, token1);
+    tracker.eraseToken(token1);
+    ASSERT_EQ(2, tracker.firstTimeout());
+    ASSERT_EQ(token2, tracker.firstToken());
+
+    tracker.eraseToken(token2);
+    ASSERT_TRUE(tracker.empty());
+}
+
 TEST(AnrTrackerTest, AddAndRemove_Empty) {
     AnrTracker tracker;
 
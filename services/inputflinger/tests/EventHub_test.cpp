@@ -106,6 +106,7 @@ protected:
 
 std::vector<RawEvent> EventHubTest::getEvents(std::optional<size_t> expectedEvents) {
     std::vector<RawEvent> events;
+    std::vector<RawEvent> newEvents;
 
     while (true) {
         std::chrono::milliseconds timeout = 0s;
@@ -113,7 +114,7 @@ std::vector<RawEvent> EventHubTest::getEvents(std::optional<size_t> expectedEven
             timeout = 2s;
         }
 
-        std::vector<RawEvent> newEvents = mEventHub->getEvents(timeout.count());
+        mEventHub->getEvents(timeout.count(), newEvents);
         if (newEvents.empty()) {
             break;
         }
@@ -218,6 +219,27 @@ TEST_F(EventHubTest, InputEvent_TimestampIsMonotonic) {
     }
 }
 
+/**
+ * Ensure that the reads from each device are accounted for in the dump.
+ */
+TEST_F(EventHubTest, Dump_ReportsReadsPerDevice) {
+    ASSERT_NO_FATAL_FAILURE(mKeyboard->pressAndReleaseHomeKey());
+    std::vector<RawEvent> events = getEvents(4);
+    ASSERT_EQ(4U, events.size()) << "Expected to receive 2 keys and 2 syncs, total of 4 events";
+
+    std::string dump;
+    mEventHub->dump(dump);
+    const size_t deviceStart = dump.find(mKeyboard->getName());
+    ASSERT_NE(std::string::npos, deviceStart) << dump;
+    const size_t readsStart = dump.find("Reads: ", deviceStart);
+    ASSERT_NE(std::string::npos, readsStart) << dump;
+    const std::string reads = dump.substr(readsStart, dump.find('\n', readsStart) - readsStart);
+    EXPECT_EQ(std::string::npos, reads.find("count=0")) << reads;
+    EXPECT_NE(std::string::npos,
+              reads.find("bytes=" + std::to_string(4 * sizeof(struct input_event))))
+            << reads;
+}
+
 // --- BitArrayTest ---
 class BitArrayTest : public testing::Test {
 protected:
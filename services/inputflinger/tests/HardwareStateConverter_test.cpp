@@ -72,11 +72,11 @@ protected:
         event.type = type;
         event.code = code;
         event.value = value;
-        std::optional<SelfContainedHardwareState> schs = mConverter->processRawEvent(&event);
-        EXPECT_FALSE(schs.has_value());
+        const SelfContainedHardwareState* schs = mConverter->processRawEvent(&event);
+        EXPECT_EQ(nullptr, schs);
     }
 
-    std::optional<SelfContainedHardwareState> processSync(nsecs_t when) {
+    const SelfContainedHardwareState* processSync(nsecs_t when) {
         RawEvent event;
         event.when = when;
         event.readTime = READ_TIME;
@@ -115,9 +115,9 @@ TEST_F(HardwareStateConverterTest, OneFinger) {
 
     processAxis(time, EV_KEY, BTN_TOUCH, 1);
     processAxis(time, EV_KEY, BTN_TOOL_FINGER, 1);
-    std::optional<SelfContainedHardwareState> schs = processSync(time);
+    const SelfContainedHardwareState* schs = processSync(time);
 
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     const HardwareState& state = schs->state;
     EXPECT_NEAR(1.5, state.timestamp, EPSILON);
     EXPECT_EQ(0, state.buttons_down);
@@ -167,9 +167,9 @@ TEST_F(HardwareStateConverterTest, TwoFingers) {
 
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOUCH, 1);
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOOL_DOUBLETAP, 1);
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
 
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     ASSERT_EQ(2, schs->state.finger_cnt);
     const FingerState& finger1 = schs->state.fingers[0];
     EXPECT_EQ(123, finger1.tracking_id);
@@ -201,8 +201,8 @@ TEST_F(HardwareStateConverterTest, OnePalm) {
 
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOUCH, 1);
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOOL_FINGER, 1);
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(0, schs->state.touch_cnt);
     EXPECT_EQ(0, schs->state.finger_cnt);
 }
@@ -217,8 +217,8 @@ TEST_F(HardwareStateConverterTest, OneFingerTurningIntoAPalm) {
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOUCH, 1);
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOOL_FINGER, 1);
 
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(1, schs->state.touch_cnt);
     EXPECT_EQ(1, schs->state.finger_cnt);
 
@@ -227,7 +227,7 @@ TEST_F(HardwareStateConverterTest, OneFingerTurningIntoAPalm) {
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_Y, 99);
 
     schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(0, schs->state.touch_cnt);
     ASSERT_EQ(0, schs->state.finger_cnt);
 
@@ -235,7 +235,7 @@ TEST_F(HardwareStateConverterTest, OneFingerTurningIntoAPalm) {
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_Y, 97);
 
     schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(0, schs->state.touch_cnt);
     EXPECT_EQ(0, schs->state.finger_cnt);
 
@@ -243,7 +243,7 @@ TEST_F(HardwareStateConverterTest, OneFingerTurningIntoAPalm) {
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_X, 55);
     processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_Y, 95);
     schs = processSync(ARBITRARY_TIME);
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(1, schs->state.touch_cnt);
     ASSERT_EQ(1, schs->state.finger_cnt);
     const FingerState& newFinger = schs->state.fingers[0];
@@ -254,17 +254,17 @@ TEST_F(HardwareStateConverterTest, OneFingerTurningIntoAPalm) {
 
 TEST_F(HardwareStateConverterTest, ButtonPressed) {
     processAxis(ARBITRARY_TIME, EV_KEY, BTN_LEFT, 1);
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
 
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_EQ(GESTURES_BUTTON_LEFT, schs->state.buttons_down);
 }
 
 TEST_F(HardwareStateConverterTest, MscTimestamp) {
     processAxis(ARBITRARY_TIME, EV_MSC, MSC_TIMESTAMP, 1200000);
-    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
+    const SelfContainedHardwareState* schs = processSync(ARBITRARY_TIME);
 
-    ASSERT_TRUE(schs.has_value());
+    ASSERT_NE(nullptr, schs);
     EXPECT_NEAR(1.2, schs->state.msc_timestamp, EPSILON);
 }
 
@@ -2322,6 +2322,40 @@ TEST_F(InputDispatcherTest, HoverWhileWindowAppears) {
  * Same test as 'HoverWhileWindowAppears' above, but here, we also send some HOVER_MOVE events to
  * the obscuring window.
  */
+/**
+ * While a window has not finished an event for a while, hover moves for it are held back by the
+ * dispatcher, and each new one replaces the previous. Once the window catches up, only the latest
+ * move is delivered.
+ */
+TEST_F(InputDispatcherTest, HoverMovesAreCoalescedWhileWindowIsBehind) {
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    sp<FakeWindowHandle> window =
+            sp<FakeWindowHandle>::make(application, mDispatcher, "Window", ADISPLAY_ID_DEFAULT);
+    window->setFrame(Rect(0, 0, 200, 200));
+    window->setDispatchingTimeout(2s); // Set a long ANR timeout to prevent it from triggering
+    mDispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {window}}});
+
+    mDispatcher->notifyMotion(MotionArgsBuilder(ACTION_HOVER_ENTER, AINPUT_SOURCE_STYLUS)
+                                      .pointer(PointerBuilder(0, ToolType::STYLUS).x(100).y(100))
+                                      .build());
+    std::optional<uint32_t> enterSequenceNum = window->receiveEvent();
+    ASSERT_TRUE(enterSequenceNum);
+
+    // Don't finish the event, so that the window looks like it is falling behind.
+    std::this_thread::sleep_for(150ms);
+    for (float position : {110, 120, 130}) {
+        mDispatcher->notifyMotion(
+                MotionArgsBuilder(ACTION_HOVER_MOVE, AINPUT_SOURCE_STYLUS)
+                        .pointer(PointerBuilder(0, ToolType::STYLUS).x(position).y(position))
+                        .build());
+    }
+    window->assertNoEvents();
+
+    window->finishEvent(*enterSequenceNum);
+    window->consumeMotionEvent(AllOf(WithMotionAction(ACTION_HOVER_MOVE), WithCoords(130, 130)));
+    window->assertNoEvents();
+}
+
 TEST_F(InputDispatcherTest, HoverMoveWhileWindowAppears) {
     std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
     sp<FakeWindowHandle> window =
@@ -2709,6 +2709,23 @@ TEST_F(InputDeviceTest, DumpDoesNotCrash) {
     device.dump(dumpStr, eventHubDevStr);
 }
 
+TEST_F(InputDeviceTest, DumpIncludesProcessingTime) {
+    mDevice->addMapper<FakeInputMapper>(EVENTHUB_ID, mFakePolicy->getReaderConfiguration(),
+                                        AINPUT_SOURCE_KEYBOARD);
+    const RawEvent events[] = {
+            {.when = ARBITRARY_TIME, .deviceId = EVENTHUB_ID, .type = EV_KEY, .code = KEY_A,
+             .value = 1},
+            {.when = ARBITRARY_TIME, .deviceId = EVENTHUB_ID, .type = EV_SYN, .code = SYN_REPORT,
+             .value = 0},
+    };
+    std::list<NotifyArgs> unused = mDevice->process(events, std::size(events));
+    unused += mDevice->process(events, 1);
+
+    std::string dumpStr, eventHubDevStr;
+    mDevice->dump(dumpStr, eventHubDevStr);
+    ASSERT_THAT(dumpStr, testing::HasSubstr("ProcessingTime: batches=2, events=3,"));
+}
+
 TEST_F(InputDeviceTest, GetBluetoothAddress) {
     const auto& address = mReader->getBluetoothAddress(DEVICE_ID);
     ASSERT_TRUE(address);
@@ -4925,6 +4942,50 @@ TEST_F(BluetoothCursorInputMapperTest, TimestampSmootheningNotUsed) {
                   WithEventTime(expectedEventTime))));
 }
 
+// --- CookedPointerDataTest ---
+
+TEST(CookedPointerDataTest, AssignmentOnlyKeepsPointersInUse) {
+    CookedPointerData twoPointers;
+    twoPointers.pointerCount = 2;
+    for (uint32_t i = 0; i < 2; i++) {
+        twoPointers.pointerProperties[i].id = i + 3;
+        twoPointers.pointerProperties[i].toolType = ToolType::FINGER;
+        twoPointers.pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X, 10 * i);
+        twoPointers.pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, 20 * i);
+        twoPointers.idToIndex[i + 3] = i;
+        twoPointers.touchingIdBits.markBit(i + 3);
+        twoPointers.validIdBits.markBit(i + 3);
+    }
+
+    CookedPointerData onePointer;
+    onePointer.pointerCount = 1;
+    onePointer.pointerProperties[0] = twoPointers.pointerProperties[1];
+    onePointer.pointerCoords[0] = twoPointers.pointerCoords[1];
+    onePointer.idToIndex[4] = 0;
+    onePointer.touchingIdBits.markBit(4);
+    onePointer.validIdBits.markBit(4);
+
+    CookedPointerData data;
+    data = twoPointers;
+    ASSERT_EQ(2u, data.pointerCount);
+    ASSERT_EQ(twoPointers.pointerCoordsForId(3), data.pointerCoordsForId(3));
+    ASSERT_EQ(twoPointers.pointerCoordsForId(4), data.pointerCoordsForId(4));
+    ASSERT_EQ(twoPointers.validIdBits, data.validIdBits);
+
+    data = onePointer;
+    ASSERT_EQ(1u, data.pointerCount);
+    ASSERT_EQ(twoPointers.pointerCoordsForId(4), data.pointerCoordsForId(4));
+    ASSERT_EQ(onePointer.touchingIdBits, data.touchingIdBits);
+    // The entry that is no longer in use is reset.
+    ASSERT_EQ(PointerProperties{}, data.pointerProperties[1]);
+    ASSERT_TRUE(data.pointerCoords[1].isEmpty());
+
+    data.clear();
+    ASSERT_EQ(0u, data.pointerCount);
+    ASSERT_TRUE(data.validIdBits.isEmpty());
+    ASSERT_TRUE(data.pointerCoords[0].isEmpty());
+}
+
 // --- TouchInputMapperTest ---
 
 class TouchInputMapperTest : public InputMapperTest {
@@ -73,7 +73,7 @@ public:
     MOCK_METHOD(status_t, mapAxis, (int32_t deviceId, int scanCode, AxisInfo* outAxisInfo),
                 (const));
     MOCK_METHOD(void, setExcludedDevices, (const std::vector<std::string>& devices));
-    MOCK_METHOD(std::vector<RawEvent>, getEvents, (int timeoutMillis));
+    MOCK_METHOD(void, getEvents, (int timeoutMillis, std::vector<RawEvent>& outEvents));
     MOCK_METHOD(std::vector<TouchVideoFrame>, getVideoFrames, (int32_t deviceId));
     MOCK_METHOD((base::Result<std::pair<InputDeviceSensorType, int32_t>>), mapSensor,
                 (int32_t deviceId, int32_t absCode), (const, override));
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../dispatcher/LatencyBreakdown.h"
+
+#include <binder/Binder.h>
+#include <gtest/gtest.h>
+
+namespace android::inputdispatcher {
+
+using Stage = LatencyBreakdown::Stage;
+
+constexpr int32_t DEVICE_ID = 3;
+
+static InputEventTimeline createTimeline(const sp<IBinder>& token) {
+    InputEventTimeline t(/*isDown=*/true, /*eventTime=*/0, /*readTime=*/ms2ns(1), DEVICE_ID);
+    ConnectionTimeline ct(/*deliveryTime=*/ms2ns(2), /*consumeTime=*/ms2ns(4),
+                          /*finishTime=*/ms2ns(5));
+    std::array<nsecs_t, GraphicsTimeline::SIZE> graphicsTimeline;
+    graphicsTimeline[GraphicsTimeline::GPU_COMPLETED_TIME] = ms2ns(10);
+    graphicsTimeline[GraphicsTimeline::PRESENT_TIME] = ms2ns(20);
+    ct.setGraphicsTimeline(std::move(graphicsTimeline));
+    t.connectionTimelines.emplace(token, std::move(ct));
+    return t;
+}
+
+static const LatencyBreakdown::Histogram& getStage(
+        const LatencyBreakdown::StageHistograms* histograms, Stage stage) {
+    return (*histograms)[ftl::to_underlying(stage)];
+}
+
+TEST(LatencyBreakdownTest, HistogramPercentileIsBucketUpperBound) {
+    LatencyBreakdown::Histogram histogram;
+    ASSERT_EQ(0, histogram.percentile(50));
+    histogram.add(us2ns(1500));
+    histogram.add(us2ns(100));
+    histogram.add(-1);
+    ASSERT_EQ(2u, histogram.count());
+    ASSERT_EQ(us2ns(128), histogram.percentile(50));
+    ASSERT_EQ(us2ns(2048), histogram.percentile(99));
+}
+
+TEST(LatencyBreakdownTest, TracksDevicesAndRegisteredConnections) {
+    LatencyBreakdown breakdown;
+    sp<IBinder> tracked = sp<BBinder>::make();
+    sp<IBinder> untracked = sp<BBinder>::make();
+    breakdown.addConnection(tracked, "tracked window");
+
+    breakdown.processTimeline(createTimeline(tracked));
+    breakdown.processTimeline(createTimeline(untracked));
+
+    const LatencyBreakdown::StageHistograms* device = breakdown.getDeviceHistograms(DEVICE_ID);
+    ASSERT_NE(nullptr, device);
+    ASSERT_EQ(2u, getStage(device, Stage::EVENT_TO_READ).count());
+    ASSERT_EQ(2u, getStage(device, Stage::END_TO_END).count());
+    ASSERT_EQ(ms2ns(2) + us2ns(48), getStage(device, Stage::DELIVER_TO_CONSUME).percentile(50));
+
+    const LatencyBreakdown::StageHistograms* connection =
+            breakdown.getConnectionHistograms(tracked);
+    ASSERT_NE(nullptr, connection);
+    ASSERT_EQ(1u, getStage(connection, Stage::END_TO_END).count());
+    ASSERT_EQ(nullptr, breakdown.getConnectionHistograms(untracked));
+
+    breakdown.removeConnection(tracked);
+    ASSERT_EQ(nullptr, breakdown.getConnectionHistograms(tracked));
+}
+
+TEST(LatencyBreakdownTest, IgnoresIncompleteTimelines) {
+    LatencyBreakdown breakdown;
+    sp<IBinder> token = sp<BBinder>::make();
+    breakdown.addConnection(token, "window");
+
+    InputEventTimeline t(/*isDown=*/false, /*eventTime=*/0, /*readTime=*/ms2ns(1), DEVICE_ID);
+    t.connectionTimelines.emplace(token,
+                                  ConnectionTimeline(/*deliveryTime=*/ms2ns(2),
+                                                     /*consumeTime=*/ms2ns(3),
+                                                     /*finishTime=*/ms2ns(4)));
+    breakdown.processTimeline(t);
+
+    ASSERT_EQ(0u, getStage(breakdown.getConnectionHistograms(token), Stage::END_TO_END).count());
+    ASSERT_EQ(0u, getStage(breakdown.getDeviceHistograms(DEVICE_ID), Stage::END_TO_END).count());
+}
+
+TEST(LatencyBreakdownTest, DumpListsWindowsWithData) {
+    LatencyBreakdown breakdown;
+    sp<IBinder> token = sp<BBinder>::make();
+    breakdown.addConnection(token, "some window");
+    breakdown.processTimeline(createTimeline(token));
+
+    const std::string dump = breakdown.dump("");
+    ASSERT_NE(std::string::npos, dump.find("deviceId=3"));
+    ASSERT_NE(std::string::npos, dump.find("some window"));
+    ASSERT_NE(std::string::npos, dump.find("END_TO_END"));
+}
+
+} // namespace android::inputdispatcher
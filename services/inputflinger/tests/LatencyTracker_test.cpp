@@ -295,4 +295,24 @@ TEST_F(LatencyTrackerTest, EventsAreTracked_WhenTrackListenerIsCalledFirst) {
             InputEventTimeline{expected.isDown, expected.eventTime, expected.readTime});
 }
 
+TEST_F(LatencyTrackerTest, TrackDeliveryLatency_IsDumpedPerTransport) {
+    // 3us and 100us over the socket, 1us over shared memory.
+    mTracker->trackDeliveryLatency(InputChannel::Transport::SOCKET, /*deliveryTime=*/1000,
+                                   /*consumeTime=*/4000);
+    mTracker->trackDeliveryLatency(InputChannel::Transport::SOCKET, /*deliveryTime=*/1000,
+                                   /*consumeTime=*/101000);
+    mTracker->trackDeliveryLatency(InputChannel::Transport::SHARED_MEMORY, /*deliveryTime=*/1000,
+                                   /*consumeTime=*/2000);
+    // Ignored, the app can report anything as the consume time.
+    mTracker->trackDeliveryLatency(InputChannel::Transport::SHARED_MEMORY, /*deliveryTime=*/1000,
+                                   /*consumeTime=*/0);
+
+    const std::string dump = mTracker->dump("");
+    EXPECT_NE(std::string::npos,
+              dump.find("Delivery latency histogram (SOCKET): 0us:0 2us:1 4us:0 8us:0 16us:0 "
+                        "32us:0 64us:1 "));
+    EXPECT_NE(std::string::npos,
+              dump.find("Delivery latency histogram (SHARED_MEMORY): 0us:1 2us:0 "));
+}
+
 } // namespace android::inputdispatcher
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../SpscQueue.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+
+namespace android {
+
+// --- SpscQueueTest ---
+
+// Validate basic pop and push operation.
+TEST(SpscQueueTest, AddAndRemove) {
+    SpscQueue<int> queue(/*capacity=*/2);
+
+    queue.push(1);
+    ASSERT_EQ(queue.pop(), 1);
+
+    queue.push(3);
+    ASSERT_EQ(queue.pop(), 3);
+
+    ASSERT_EQ(std::nullopt, queue.pop());
+}
+
+// Make sure the queue maintains FIFO order, also when it wraps around.
+TEST(SpscQueueTest, isFIFO) {
+    constexpr size_t capacity = 3;
+    SpscQueue<int> queue(capacity);
+
+    constexpr int numItems = 10;
+    for (int i = 0; i < numItems; i++) {
+        ASSERT_TRUE(queue.push(i));
+        if (i % 2 == 1) {
+            ASSERT_EQ(queue.pop(), i - 1);
+            ASSERT_EQ(queue.pop(), i);
+        }
+    }
+    ASSERT_EQ(std::nullopt, queue.pop());
+}
+
+// Make sure the queue has strict capacity limits, and frees up space when popped.
+TEST(SpscQueueTest, QueueReachesCapacity) {
+    constexpr size_t capacity = 3;
+    SpscQueue<int> queue(capacity);
+
+    // First 3 elements should be added successfully
+    ASSERT_TRUE(queue.push(1));
+    ASSERT_TRUE(queue.push(2));
+    ASSERT_TRUE(queue.push(3));
+    ASSERT_FALSE(queue.push(4)) << "Queue should reach capacity at size " << capacity;
+
+    ASSERT_EQ(queue.pop(), 1);
+    ASSERT_TRUE(queue.push(4));
+}
+
+// Popped objects are not kept alive by the queue.
+TEST(SpscQueueTest, ReleasesPoppedObjects) {
+    SpscQueue<std::shared_ptr<int>> queue(/*capacity=*/1);
+    auto object = std::make_shared<int>(42);
+
+    queue.push(object);
+    ASSERT_EQ(object.use_count(), 2);
+    queue.pop();
+    ASSERT_EQ(object.use_count(), 1);
+}
+
+TEST(SpscQueueTest, AllowsProducerAndConsumerThreads) {
+    // Smaller than the number of items, so that the producer has to wait for the consumer.
+    SpscQueue<int> queue(/*capacity=*/10);
+
+    // Test with a large number of items to increase likelihood that threads overlap
+    constexpr int numItems = 1000;
+
+    // Fill queue from a different thread
+    std::thread fillQueue([&queue]() {
+        for (int i = 0; i < numItems; i++) {
+            while (!queue.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Make sure all elements are received in correct order
+    for (int i = 0; i < numItems; i++) {
+        // Since popping races with the thread that's filling the queue,
+        // keep popping until we get something back
+        std::optional<int> popped;
+        while (!(popped = queue.pop())) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(popped, i);
+    }
+
+    fillQueue.join();
+}
+
+} // namespace android
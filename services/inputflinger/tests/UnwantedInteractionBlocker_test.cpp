@@ -1095,4 +1095,91 @@ TEST_F(PalmRejectorFakeFilterTest, CancelTwoPointers) {
     ASSERT_EQ(CANCEL, argsList[0].action);
 }
 
+/**
+ * When the model runs asynchronously, touches are passed through immediately, and a pointer is
+ * canceled on the first event after the model classified it as a palm. Use the same data as in
+ * PalmRejectorTest.TwoPointersAreCanceled, where the pointers are canceled at 88ms and 120ms.
+ */
+TEST(AsyncPalmRejectorTest, PalmsAreCanceledOnTheNextEvent) {
+    AsyncPalmRejector palmRejector(generatePalmFilterDeviceInfo());
+    const nsecs_t downTime = toNs(0ms);
+    std::vector<NotifyMotionArgs> argsList;
+    auto process = [&](const NotifyMotionArgs& args) {
+        argsList = palmRejector.processMotion(args);
+        palmRejector.waitForIdle();
+    };
+
+    process(generateMotionArgs(downTime, downTime, DOWN, {{1342.0, 613.0, 79.0}}));
+    ASSERT_EQ(1u, argsList.size());
+    ASSERT_EQ(DOWN, argsList[0].action);
+    process(generateMotionArgs(downTime, toNs(8ms), MOVE, {{1406.0, 650.0, 52.0}}));
+    process(generateMotionArgs(downTime, toNs(16ms), MOVE, {{1429.0, 672.0, 46.0}}));
+    process(generateMotionArgs(downTime, toNs(24ms), MOVE, {{1417.0, 685.0, 41.0}}));
+    process(generateMotionArgs(downTime, toNs(32ms), POINTER_1_DOWN,
+                               {{1417.0, 685.0, 41.0}, {1062.0, 697.0, 10.0}}));
+    process(generateMotionArgs(downTime, toNs(40ms), MOVE,
+                               {{1414.0, 702.0, 41.0}, {1059.0, 731.0, 12.0}}));
+    process(generateMotionArgs(downTime, toNs(48ms), MOVE,
+                               {{1415.0, 719.0, 44.0}, {1060.0, 760.0, 11.0}}));
+    process(generateMotionArgs(downTime, toNs(56ms), MOVE,
+                               {{1421.0, 733.0, 42.0}, {1065.0, 769.0, 13.0}}));
+    process(generateMotionArgs(downTime, toNs(64ms), MOVE,
+                               {{1426.0, 742.0, 43.0}, {1068.0, 771.0, 13.0}}));
+    process(generateMotionArgs(downTime, toNs(72ms), MOVE,
+                               {{1430.0, 748.0, 45.0}, {1069.0, 772.0, 13.0}}));
+    process(generateMotionArgs(downTime, toNs(80ms), MOVE,
+                               {{1432.0, 750.0, 44.0}, {1069.0, 772.0, 13.0}}));
+    // The model rejects pointer 0 here, but the event has already been passed through.
+    process(generateMotionArgs(downTime, toNs(88ms), MOVE,
+                               {{1433.0, 751.0, 44.0}, {1070.0, 771.0, 13.0}}));
+    ASSERT_EQ(1u, argsList.size());
+    ASSERT_EQ(MOVE, argsList[0].action);
+    ASSERT_EQ(2u, argsList[0].getPointerCount());
+
+    process(generateMotionArgs(downTime, toNs(96ms), MOVE,
+                               {{1433.0, 751.0, 42.0}, {1071.0, 770.0, 13.0}}));
+    ASSERT_EQ(2u, argsList.size());
+    ASSERT_EQ(POINTER_0_UP, argsList[0].action);
+    ASSERT_EQ(FLAG_CANCELED, argsList[0].flags);
+    ASSERT_EQ(MOVE, argsList[1].action);
+    ASSERT_EQ(1u, argsList[1].getPointerCount());
+    ASSERT_EQ(0, argsList[1].flags);
+
+    process(generateMotionArgs(downTime, toNs(104ms), MOVE,
+                               {{1433.0, 751.0, 45.0}, {1072.0, 769.0, 13.0}}));
+    process(generateMotionArgs(downTime, toNs(112ms), MOVE,
+                               {{1433.0, 751.0, 43.0}, {1072.0, 768.0, 13.0}}));
+    process(generateMotionArgs(downTime, toNs(120ms), MOVE,
+                               {{1433.0, 751.0, 45.0}, {1072.0, 767.0, 13.0}}));
+    ASSERT_EQ(1u, argsList.size());
+    ASSERT_EQ(MOVE, argsList[0].action);
+
+    process(generateMotionArgs(downTime, toNs(128ms), MOVE,
+                               {{1433.0, 751.0, 43.0}, {1072.0, 766.0, 13.0}}));
+    ASSERT_EQ(1u, argsList.size());
+    ASSERT_EQ(CANCEL, argsList[0].action);
+    // The rest of the gesture is dropped
+    process(generateMotionArgs(downTime, toNs(136ms), MOVE,
+                               {{1433.0, 750.0, 44.0}, {1072.0, 765.0, 13.0}}));
+    ASSERT_EQ(0u, argsList.size());
+}
+
+/**
+ * Events are still passed through when palm rejection runs asynchronously.
+ */
+TEST(AsyncPalmRejectorTest, BlockerPassesEventsThrough) {
+    TestInputListener testListener;
+    UnwantedInteractionBlocker blocker(testListener, /*enablePalmRejection=*/true,
+                                       /*asyncPalmRejection=*/true);
+    blocker.notifyInputDevicesChanged({/*id=*/0, {generateTestDeviceInfo()}});
+    testListener.assertNotifyInputDevicesChangedWasCalled();
+
+    NotifyMotionArgs args = generateMotionArgs(/*downTime=*/0, /*eventTime=*/0, DOWN, {{1, 2, 3}});
+    blocker.notifyMotion(args);
+    ASSERT_NO_FATAL_FAILURE(testListener.assertNotifyMotionWasCalled(testing::Eq(args)));
+    args = generateMotionArgs(/*downTime=*/0, /*eventTime=*/1, UP, {{1, 2, 3}});
+    blocker.notifyMotion(args);
+    ASSERT_NO_FATAL_FAILURE(testListener.assertNotifyMotionWasCalled(testing::Eq(args)));
+}
+
 } // namespace android
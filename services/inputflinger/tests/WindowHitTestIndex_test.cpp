@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "../dispatcher/WindowHitTestIndex.h"
+
+// atest inputflinger_tests:WindowHitTestIndexTest
+
+using android::gui::WindowInfo;
+using android::gui::WindowInfoHandle;
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+namespace android::inputdispatcher {
+
+namespace {
+
+class FakeWindowHandle : public WindowInfoHandle {
+public:
+    FakeWindowHandle(const std::string& name, const Rect& frame) {
+        mInfo.name = name;
+        mInfo.frameLeft = frame.left;
+        mInfo.frameTop = frame.top;
+        mInfo.frameRight = frame.right;
+        mInfo.frameBottom = frame.bottom;
+        mInfo.touchableRegion = Region(frame);
+    }
+
+    void setTouchableRegion(const Region& region) { mInfo.touchableRegion = region; }
+    void setInputConfig(WindowInfo::InputConfig config, bool value) {
+        mInfo.setInputConfig(config, value);
+    }
+};
+
+std::vector<size_t> toVector(std::span<const size_t> span) {
+    return std::vector<size_t>(span.begin(), span.end());
+}
+
+} // namespace
+
+TEST(WindowHitTestIndexTest, EmptyIndexHasNoCandidates) {
+    WindowHitTestIndex index({}, ui::Transform());
+
+    EXPECT_EQ(0u, index.size());
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(10, 10)), IsEmpty());
+    EXPECT_THAT(toVector(index.getFrameCandidatesAt(10, 10)), IsEmpty());
+    EXPECT_THAT(toVector(index.getOutsideTouchWatchers()), IsEmpty());
+}
+
+TEST(WindowHitTestIndexTest, CandidatesAreInZOrder) {
+    sp<FakeWindowHandle> statusBar = sp<FakeWindowHandle>::make("status", Rect(0, 0, 1000, 100));
+    sp<FakeWindowHandle> bubble = sp<FakeWindowHandle>::make("bubble", Rect(800, 800, 900, 900));
+    sp<FakeWindowHandle> app = sp<FakeWindowHandle>::make("app", Rect(0, 0, 1000, 2000));
+    WindowHitTestIndex index({statusBar, bubble, app}, ui::Transform());
+
+    EXPECT_EQ(3u, index.size());
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(50, 50)), ElementsAre(0, 2));
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(850, 850)), ElementsAre(1, 2));
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(500, 1500)), ElementsAre(2));
+    EXPECT_THAT(toVector(index.getFrameCandidatesAt(850, 50)), ElementsAre(0, 2));
+
+    EXPECT_EQ(std::make_optional<size_t>(1), index.getZOrder(bubble));
+    EXPECT_EQ(std::nullopt,
+              index.getZOrder(sp<FakeWindowHandle>::make("other", Rect(0, 0, 10, 10))));
+}
+
+TEST(WindowHitTestIndexTest, PointsOutsideAllWindowsHaveNoCandidates) {
+    sp<FakeWindowHandle> window = sp<FakeWindowHandle>::make("window", Rect(100, 100, 200, 200));
+    WindowHitTestIndex index({window}, ui::Transform());
+
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(150, 150)), ElementsAre(0));
+    // Right and bottom edges are exclusive, as in WindowInfo::frameContainsPoint.
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(200, 150)), IsEmpty());
+    EXPECT_THAT(toVector(index.getFrameCandidatesAt(150, 200)), IsEmpty());
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(-1, -1)), IsEmpty());
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(NAN, 150)), IsEmpty());
+}
+
+TEST(WindowHitTestIndexTest, TouchableRegionIsSeparateFromFrame) {
+    sp<FakeWindowHandle> window = sp<FakeWindowHandle>::make("window", Rect(0, 0, 500, 500));
+    window->setTouchableRegion(Region(Rect(0, 0, 100, 100)));
+    sp<FakeWindowHandle> invisible = sp<FakeWindowHandle>::make("invisible", Rect(0, 0, 500, 500));
+    invisible->setInputConfig(WindowInfo::InputConfig::NOT_VISIBLE, true);
+    WindowHitTestIndex index({window, invisible}, ui::Transform());
+
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(400, 400)), IsEmpty());
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(50, 50)), ElementsAre(0));
+    EXPECT_THAT(toVector(index.getFrameCandidatesAt(400, 400)), ElementsAre(0, 1));
+}
+
+TEST(WindowHitTestIndexTest, TouchableBoundsUseDisplayTransform) {
+    // Touchable regions and touch locations are both in display space, but the hit test is done in
+    // the rotated logical display space.
+    ui::Transform displayTransform(ui::Transform::ROT_90, 2000, 1000);
+    sp<FakeWindowHandle> window = sp<FakeWindowHandle>::make("window", Rect(0, 0, 100, 200));
+    WindowHitTestIndex index({window}, displayTransform);
+
+    EXPECT_EQ(displayTransform, index.getDisplayTransform());
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(50, 100)), ElementsAre(0));
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(150, 100)), IsEmpty());
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(50, 250)), IsEmpty());
+}
+
+TEST(WindowHitTestIndexTest, OutsideTouchWatchersAreTrackedRegardlessOfBounds) {
+    sp<FakeWindowHandle> top = sp<FakeWindowHandle>::make("top", Rect(0, 0, 10, 10));
+    top->setInputConfig(WindowInfo::InputConfig::WATCH_OUTSIDE_TOUCH, true);
+    sp<FakeWindowHandle> middle = sp<FakeWindowHandle>::make("middle", Rect(0, 0, 10, 10));
+    sp<FakeWindowHandle> bottom = sp<FakeWindowHandle>::make("bottom", Rect(0, 0, 1000, 1000));
+    bottom->setInputConfig(WindowInfo::InputConfig::WATCH_OUTSIDE_TOUCH, true);
+    WindowHitTestIndex index({top, middle, bottom}, ui::Transform());
+
+    EXPECT_THAT(toVector(index.getOutsideTouchWatchers()), ElementsAre(0, 2));
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(500, 500)), ElementsAre(2));
+}
+
+TEST(WindowHitTestIndexTest, HandlesUnboundedTouchableRegions) {
+    sp<FakeWindowHandle> window = sp<FakeWindowHandle>::make("window", Rect(0, 0, 100, 100));
+    window->setTouchableRegion(Region(Rect(INT32_MIN / 2, INT32_MIN / 2, INT32_MAX / 2,
+                                           INT32_MAX / 2)));
+    sp<FakeWindowHandle> small = sp<FakeWindowHandle>::make("small", Rect(10, 10, 20, 20));
+    WindowHitTestIndex index({window, small}, ui::Transform());
+
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(15, 15)), ElementsAre(0, 1));
+    EXPECT_THAT(toVector(index.getTouchCandidatesAt(-100000, 100000)), ElementsAre(0));
+}
+
+} // namespace android::inputdispatcher
@@ -114,8 +114,8 @@ public:
         return mFdp->ConsumeIntegral<status_t>();
     }
     void setExcludedDevices(const std::vector<std::string>& devices) override {}
-    std::vector<RawEvent> getEvents(int timeoutMillis) override {
-        std::vector<RawEvent> events;
+    void getEvents(int timeoutMillis, std::vector<RawEvent>& events) override {
+        events.clear();
         const size_t count = mFdp->ConsumeIntegralInRange<size_t>(0, kMaxSize);
         for (size_t i = 0; i < count; ++i) {
             int32_t type = mFdp->ConsumeBool() ? mFdp->PickValueInArray(kValidTypes)
@@ -131,7 +131,6 @@ public:
                     .value = mFdp->ConsumeIntegral<int32_t>(),
             });
         }
-        return events;
     }
     std::vector<TouchVideoFrame> getVideoFrames(int32_t deviceId) override { return mVideoFrames; }
 
@@ -24,6 +24,10 @@
 #include <powermanager/PowerHalLoader.h>
 #include <utils/Log.h>
 
+#include <algorithm>
+#include <optional>
+#include <vector>
+
 using namespace android::hardware::power;
 
 namespace android {
@@ -58,6 +62,19 @@ void HalConnector::reset() {
 
 // -------------------------------------------------------------------------------------------------
 
+PowerHalController::~PowerHalController() {
+    std::thread dispatchThread;
+    {
+        std::lock_guard<std::mutex> lock(mDispatchMutex);
+        mDispatchStopped = true;
+        dispatchThread = std::move(mDispatchThread);
+    }
+    mDispatchCondition.notify_all();
+    if (dispatchThread.joinable()) {
+        dispatchThread.join();
+    }
+}
+
 void PowerHalController::init() {
     initHal();
 }
@@ -102,6 +119,101 @@ HalResult<void> PowerHalController::setMode(Mode mode, bool enabled) {
     return processHalResult(result, "setMode");
 }
 
+void PowerHalController::setBoostAsync(Boost boost, int32_t durationMs) {
+    {
+        std::lock_guard<std::mutex> lock(mDispatchMutex);
+        if (mDispatchStopped || mUnsupportedBoosts.count(boost) > 0) {
+            return;
+        }
+        auto [it, inserted] = mPendingBoosts.try_emplace(boost, durationMs);
+        if (!inserted) {
+            it->second = std::max(it->second, durationMs);
+            return;
+        }
+        startDispatchLocked();
+    }
+    mDispatchCondition.notify_one();
+}
+
+void PowerHalController::setModeAsync(Mode mode, bool enabled) {
+    {
+        std::lock_guard<std::mutex> lock(mDispatchMutex);
+        if (mDispatchStopped || mUnsupportedModes.count(mode) > 0) {
+            return;
+        }
+        mPendingModes[mode] = enabled;
+        startDispatchLocked();
+    }
+    mDispatchCondition.notify_one();
+}
+
+void PowerHalController::startDispatchLocked() {
+    if (!mDispatchThread.joinable()) {
+        mDispatchThread = std::thread(&PowerHalController::dispatchLoop, this);
+    }
+}
+
+// Sends the pending requests to the HAL. Boosts sent within the last boost interval stay pending
+// until the interval elapsed, so a burst of requests results in one call at its start and one at
+// its end.
+void PowerHalController::dispatchLoop() {
+    std::unique_lock<std::mutex> lock(mDispatchMutex);
+    while (!mDispatchStopped) {
+        const auto now = std::chrono::steady_clock::now();
+        std::vector<std::pair<Boost, int32_t>> boosts;
+        std::optional<std::chrono::steady_clock::time_point> nextDispatchTime;
+        for (auto it = mPendingBoosts.begin(); it != mPendingBoosts.end();) {
+            auto lastTime = mLastBoostTimes.find(it->first);
+            if (lastTime != mLastBoostTimes.end() && lastTime->second + mBoostInterval > now) {
+                const auto dispatchTime = lastTime->second + mBoostInterval;
+                if (!nextDispatchTime || dispatchTime < *nextDispatchTime) {
+                    nextDispatchTime = dispatchTime;
+                }
+                ++it;
+                continue;
+            }
+            boosts.push_back(*it);
+            mLastBoostTimes[it->first] = now;
+            it = mPendingBoosts.erase(it);
+        }
+        std::vector<std::pair<Mode, bool>> modes(mPendingModes.begin(), mPendingModes.end());
+        mPendingModes.clear();
+
+        if (boosts.empty() && modes.empty()) {
+            if (nextDispatchTime) {
+                mDispatchCondition.wait_until(lock, *nextDispatchTime);
+            } else {
+                mDispatchCondition.wait(lock);
+            }
+            continue;
+        }
+
+        lock.unlock();
+        std::vector<Boost> unsupportedBoosts;
+        for (const auto& [boost, durationMs] : boosts) {
+            if (setBoost(boost, durationMs).isUnsupported()) {
+                unsupportedBoosts.push_back(boost);
+            }
+        }
+        std::vector<Mode> unsupportedModes;
+        for (const auto& [mode, enabled] : modes) {
+            if (setMode(mode, enabled).isUnsupported()) {
+                unsupportedModes.push_back(mode);
+            }
+        }
+        lock.lock();
+
+        mUnsupportedBoosts.insert(unsupportedBoosts.begin(), unsupportedBoosts.end());
+        mUnsupportedModes.insert(unsupportedModes.begin(), unsupportedModes.end());
+        for (Boost boost : unsupportedBoosts) {
+            mPendingBoosts.erase(boost);
+        }
+        for (Mode mode : unsupportedModes) {
+            mPendingModes.erase(mode);
+        }
+    }
+}
+
 HalResult<sp<IPowerHintSession>> PowerHalController::createHintSession(
         int32_t tgid, int32_t uid, const std::vector<int32_t>& threadIds, int64_t durationNanos) {
     std::shared_ptr<HalWrapper> handle = initHal();
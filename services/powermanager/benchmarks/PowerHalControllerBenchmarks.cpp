@@ -98,6 +98,18 @@ static void BM_PowerHalControllerBenchmarks_setBoostCached(benchmark::State& sta
     runCachedBenchmark(state, &PowerHalController::setBoost, boost, 0);
 }
 
+// Measures the latency on the caller thread, to compare with setBoostCached. Requests are coalesced
+// by the dispatcher, so there is no need to delay them.
+static void BM_PowerHalControllerBenchmarks_setBoostAsyncCached(benchmark::State& state) {
+    Boost boost = static_cast<Boost>(state.range(0));
+    PowerHalController controller;
+    controller.init();
+
+    while (state.KeepRunning()) {
+        controller.setBoostAsync(boost, 0);
+    }
+}
+
 static void BM_PowerHalControllerBenchmarks_setMode(benchmark::State& state) {
     Mode mode = static_cast<Mode>(state.range(0));
     runBenchmark(state, &PowerHalController::setMode, mode, false);
@@ -108,9 +120,22 @@ static void BM_PowerHalControllerBenchmarks_setModeCached(benchmark::State& stat
     runCachedBenchmark(state, &PowerHalController::setMode, mode, false);
 }
 
+static void BM_PowerHalControllerBenchmarks_setModeAsyncCached(benchmark::State& state) {
+    Mode mode = static_cast<Mode>(state.range(0));
+    PowerHalController controller;
+    controller.init();
+
+    while (state.KeepRunning()) {
+        controller.setModeAsync(mode, false);
+    }
+}
+
 BENCHMARK(BM_PowerHalControllerBenchmarks_init);
 BENCHMARK(BM_PowerHalControllerBenchmarks_initCached);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setBoost)->DenseRange(FIRST_BOOST, LAST_BOOST, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setBoostCached)->DenseRange(FIRST_BOOST, LAST_BOOST, 1);
+BENCHMARK(BM_PowerHalControllerBenchmarks_setBoostAsyncCached)
+        ->DenseRange(FIRST_BOOST, LAST_BOOST, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setMode)->DenseRange(FIRST_MODE, LAST_MODE, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setModeCached)->DenseRange(FIRST_MODE, LAST_MODE, 1);
+BENCHMARK(BM_PowerHalControllerBenchmarks_setModeAsyncCached)->DenseRange(FIRST_MODE, LAST_MODE, 1);
@@ -24,6 +24,7 @@
 #include <powermanager/PowerHalController.h>
 #include <utils/Log.h>
 
+#include <atomic>
 #include <thread>
 
 using android::hardware::power::Boost;
@@ -278,3 +279,47 @@ TEST_F(PowerHalControllerTest, TestMultiThreadWithFailureReconnectIsThreadSafe)
     int powerHalResetCount = mHalConnector->getResetCount();
     EXPECT_THAT(powerHalResetCount, Le(10));
 }
+
+TEST_F(PowerHalControllerTest, TestAsyncBoostsAreCoalescedWithinBoostInterval) {
+    mHalController = std::make_unique<PowerHalController>(
+            std::make_unique<TestPowerHalConnector>(mMockHal), 200ms);
+
+    std::atomic<int32_t> lastDurationMs = 0;
+    EXPECT_CALL(*mMockHal.get(), powerHint(Eq(PowerHint::INTERACTION), _))
+            .Times(Between(1, 2))
+            .WillRepeatedly([&](PowerHint, int32_t durationMs) {
+                lastDurationMs = durationMs;
+                return hardware::Void();
+            });
+
+    for (int32_t durationMs = 1; durationMs <= 100; durationMs++) {
+        mHalController->setBoostAsync(Boost::INTERACTION, durationMs);
+    }
+
+    // The burst is sent at most at its start and once the boost interval elapsed, with the
+    // longest duration requested.
+    std::this_thread::sleep_for(500ms);
+    mHalController = nullptr;
+    EXPECT_EQ(lastDurationMs, 100);
+}
+
+TEST_F(PowerHalControllerTest, TestAsyncModesSendLatestRequest) {
+    std::atomic<int32_t> lastLaunchData = -1;
+    EXPECT_CALL(*mMockHal.get(), powerHint(Eq(PowerHint::LAUNCH), _))
+            .Times(Between(1, 2))
+            .WillRepeatedly([&](PowerHint, int32_t data) {
+                lastLaunchData = data;
+                return hardware::Void();
+            });
+    EXPECT_CALL(*mMockHal.get(), powerHint(Eq(PowerHint::LOW_POWER), Eq(1))).Times(Exactly(1));
+
+    mHalController->setModeAsync(Mode::LAUNCH, true);
+    mHalController->setModeAsync(Mode::LOW_POWER, true);
+    mHalController->setModeAsync(Mode::LAUNCH, false);
+    // Unsupported by the HAL, so never sent.
+    mHalController->setModeAsync(Mode::CAMERA_STREAMING_HIGH, true);
+
+    std::this_thread::sleep_for(100ms);
+    mHalController = nullptr;
+    EXPECT_EQ(lastLaunchData, 0);
+}
@@ -55,14 +55,10 @@ bool GravitySensor::process(sensors_event_t* outEvent,
         const sensors_event_t& event)
 {
     if (event.type == SENSOR_TYPE_ACCELEROMETER) {
-        vec3_t g;
-        if (!mSensorFusion.hasEstimate(FUSION_NOMAG))
+        if (!mSensorFusion.hasEstimate(FUSION_NOMAG) ||
+                !mSensorFusion.shouldReport(this, event.timestamp))
             return false;
-        const mat33_t R(mSensorFusion.getRotationMatrix(FUSION_NOMAG));
-        // FIXME: we need to estimate the length of gravity because
-        // the accelerometer may have a small scaling error. This
-        // translates to an offset in the linear-acceleration sensor.
-        g = R[2] * GRAVITY_EARTH;
+        const vec3_t& g(mSensorFusion.getOutput(FUSION_NOMAG).gravity);
 
         *outEvent = event;
         outEvent->data[0] = g.x;
@@ -76,10 +72,14 @@ bool GravitySensor::process(sensors_event_t* outEvent,
 }
 
 status_t GravitySensor::activate(void* ident, bool enabled) {
+    if (!enabled) {
+        mSensorFusion.removeReportPeriod(this, ident);
+    }
     return mSensorFusion.activate(FUSION_NOMAG, ident, enabled);
 }
 
 status_t GravitySensor::setDelay(void* ident, int /*handle*/, int64_t ns) {
+    mSensorFusion.setReportPeriod(this, ident, ns);
     return mSensorFusion.setDelay(FUSION_NOMAG, ident, ns);
 }
 
@@ -22,6 +22,8 @@
 
 #include <android-base/logging.h>
 
+#include <cstring>
+
 using android::hardware::hidl_vec;
 using android::hardware::sensors::V1_0::RateLevel;
 using android::hardware::sensors::V1_0::Result;
@@ -68,6 +70,36 @@ enum EventQueueFlagBitsInternal : uint32_t {
     INTERNAL_WAKE = 1 << 16,
 };
 
+// The HIDL payload of these sensor types has the same layout as the sensors_event_t one, so the
+// events of the common continuous sensors can be converted with a single copy instead of going
+// through convertToSensorEvent() field by field.
+static_assert(sizeof(Event::u) == sizeof(sensors_event_t::data));
+static_assert(offsetof(hardware::sensors::V1_0::Vec3, status) == offsetof(sensors_vec_t, status));
+static_assert(sizeof(hardware::sensors::V1_0::Uncal) == sizeof(uncalibrated_event_t));
+
+bool hasSensorEventLayout(int32_t type) {
+    switch (type) {
+        case SENSOR_TYPE_ACCELEROMETER:
+        case SENSOR_TYPE_MAGNETIC_FIELD:
+        case SENSOR_TYPE_GYROSCOPE:
+        case SENSOR_TYPE_GRAVITY:
+        case SENSOR_TYPE_LINEAR_ACCELERATION:
+        case SENSOR_TYPE_ROTATION_VECTOR:
+        case SENSOR_TYPE_GAME_ROTATION_VECTOR:
+        case SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR:
+        case SENSOR_TYPE_MAGNETIC_FIELD_UNCALIBRATED:
+        case SENSOR_TYPE_GYROSCOPE_UNCALIBRATED:
+        case SENSOR_TYPE_ACCELEROMETER_UNCALIBRATED:
+        case SENSOR_TYPE_LIGHT:
+        case SENSOR_TYPE_PRESSURE:
+        case SENSOR_TYPE_PROXIMITY:
+        case SENSOR_TYPE_STEP_COUNTER:
+            return true;
+        default:
+            return false;
+    }
+}
+
 } // anonymous namespace
 
 void SensorsHalDeathReceiver::serviceDied(
@@ -216,7 +248,21 @@ ssize_t HidlSensorHalWrapper::pollFmq(sensors_event_t* buffer, size_t maxNumEven
             }
 
             for (size_t i = 0; i < eventsToRead; i++) {
-                convertToSensorEvent(mEventBuffer[i], &buffer[i]);
+                const Event& src = mEventBuffer[i];
+                const int32_t type = static_cast<int32_t>(src.sensorType);
+                if (!hasSensorEventLayout(type)) {
+                    convertToSensorEvent(src, &buffer[i]);
+                    continue;
+                }
+                sensors_event_t& dst = buffer[i];
+                dst.version = sizeof(sensors_event_t);
+                dst.sensor = src.sensorHandle;
+                dst.type = type;
+                dst.reserved0 = 0;
+                dst.timestamp = src.timestamp;
+                memcpy(dst.data, &src.u, sizeof(dst.data));
+                dst.flags = 0;
+                memset(dst.reserved1, 0, sizeof(dst.reserved1));
             }
             eventsRead = eventsToRead;
         } else {
@@ -48,15 +48,9 @@ bool OrientationSensor::process(sensors_event_t* outEvent,
         const sensors_event_t& event)
 {
     if (event.type == SENSOR_TYPE_ACCELEROMETER) {
-        if (mSensorFusion.hasEstimate()) {
-            vec3_t g;
-            const float rad2deg = 180 / M_PI;
-            const mat33_t R(mSensorFusion.getRotationMatrix());
-            g[0] = atan2f(-R[1][0], R[0][0])    * rad2deg;
-            g[1] = atan2f(-R[2][1], R[2][2])    * rad2deg;
-            g[2] = asinf ( R[2][0])             * rad2deg;
-            if (g[0] < 0)
-                g[0] += 360;
+        if (mSensorFusion.hasEstimate() &&
+                mSensorFusion.shouldReport(this, event.timestamp)) {
+            const vec3_t& g(mSensorFusion.getOutput().orientation);
 
             *outEvent = event;
             outEvent->orientation.azimuth = g.x;
@@ -72,10 +66,14 @@ bool OrientationSensor::process(sensors_event_t* outEvent,
 }
 
 status_t OrientationSensor::activate(void* ident, bool enabled) {
+    if (!enabled) {
+        mSensorFusion.removeReportPeriod(this, ident);
+    }
     return mSensorFusion.activate(FUSION_9AXIS, ident, enabled);
 }
 
 status_t OrientationSensor::setDelay(void* ident, int /*handle*/, int64_t ns) {
+    mSensorFusion.setReportPeriod(this, ident, ns);
     return mSensorFusion.setDelay(FUSION_9AXIS, ident, ns);
 }
 
@@ -22,6 +22,7 @@
 #include <utils/Timers.h>
 
 #include <inttypes.h>
+#include <string.h>
 
 namespace android {
 namespace SensorServiceUtil {
@@ -34,36 +35,72 @@ namespace {
 
 RecentEventLogger::RecentEventLogger(int sensorType) :
         mSensorType(sensorType), mEventSize(eventSizeBySensorType(mSensorType)),
-        mRecentEvents(logSizeBySensorType(sensorType)), mMaskData(false),
-        mIsLastEventCurrent(false) {
+        mMaskData(false), mIsLastEventCurrent(false),
+        mCapacity(logSizeBySensorType(sensorType)), mSlots(new Slot[mCapacity]),
+        mEventCount(0) {
     // blank
 }
 
 void RecentEventLogger::addEvent(const sensors_event_t& event) {
-    std::lock_guard<std::mutex> lk(mLock);
-    mRecentEvents.emplace(event);
-    mIsLastEventCurrent = true;
+    // Only called by the sensor thread, no other writer can race with this.
+    const uint64_t sequence = mEventCount.load(std::memory_order_relaxed);
+    Slot& slot = mSlots[sequence % mCapacity];
+
+    slot.mSequence.store(WRITING, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.mLog.mEvent = event;
+    clock_gettime(CLOCK_REALTIME, &slot.mLog.mWallTime);
+    slot.mSequence.store(sequence, std::memory_order_release);
+
+    mEventCount.store(sequence + 1, std::memory_order_release);
+    mIsLastEventCurrent.store(true, std::memory_order_relaxed);
+}
+
+bool RecentEventLogger::readSlot(uint64_t sequence, SensorEventLog* log) const {
+    const Slot& slot = mSlots[sequence % mCapacity];
+    if (slot.mSequence.load(std::memory_order_acquire) != sequence) {
+        return false;
+    }
+    // The slot may be overwritten while it is copied, the copy is only kept if the sequence
+    // number didn't change.
+    memcpy(log, &slot.mLog, sizeof(*log));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.mSequence.load(std::memory_order_relaxed) == sequence;
+}
+
+std::vector<RecentEventLogger::SensorEventLog> RecentEventLogger::getRecentEvents() const {
+    std::vector<SensorEventLog> events;
+    const uint64_t count = mEventCount.load(std::memory_order_acquire);
+    const uint64_t oldest = count > mCapacity ? count - mCapacity : 0;
+    events.reserve(count - oldest);
+    for (uint64_t sequence = count; sequence > oldest; --sequence) {
+        SensorEventLog log;
+        if (!readSlot(sequence - 1, &log)) {
+            // Overwritten by a newer event, the older ones are gone too.
+            break;
+        }
+        events.push_back(log);
+    }
+    return events;
 }
 
 bool RecentEventLogger::isEmpty() const {
-    return mRecentEvents.size() == 0;
+    return mEventCount.load(std::memory_order_relaxed) == 0;
 }
 
 void RecentEventLogger::setLastEventStale() {
-    std::lock_guard<std::mutex> lk(mLock);
-    mIsLastEventCurrent = false;
+    mIsLastEventCurrent.store(false, std::memory_order_relaxed);
 }
 
 std::string RecentEventLogger::dump() const {
-    std::lock_guard<std::mutex> lk(mLock);
+    const std::vector<SensorEventLog> recentEvents = getRecentEvents();
 
     //TODO: replace String8 with std::string completely in this function
     String8 buffer;
 
-    buffer.appendFormat("last %zu events\n", mRecentEvents.size());
+    buffer.appendFormat("last %zu events\n", recentEvents.size());
     int j = 0;
-    for (int i = mRecentEvents.size() - 1; i >= 0; --i) {
-        const auto& ev = mRecentEvents[i];
+    for (const auto& ev : recentEvents) {
         struct tm * timeinfo = localtime(&(ev.mWallTime.tv_sec));
         buffer.appendFormat("\t%2d (ts=%.9f, wall=%02d:%02d:%02d.%03d) ",
                 ++j, ev.mEvent.timestamp/1e9, timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec,
@@ -95,11 +132,10 @@ std::string RecentEventLogger::dump() const {
  */
 void RecentEventLogger::dump(util::ProtoOutputStream* proto) const {
     using namespace service::SensorEventsProto;
-    std::lock_guard<std::mutex> lk(mLock);
+    const std::vector<SensorEventLog> recentEvents = getRecentEvents();
 
-    proto->write(RecentEventsLog::RECENT_EVENTS_COUNT, int(mRecentEvents.size()));
-    for (int i = mRecentEvents.size() - 1; i >= 0; --i) {
-        const auto& ev = mRecentEvents[i];
+    proto->write(RecentEventsLog::RECENT_EVENTS_COUNT, int(recentEvents.size()));
+    for (const auto& ev : recentEvents) {
         const uint64_t token = proto->start(RecentEventsLog::EVENTS);
         proto->write(Event::TIMESTAMP_SEC, float(ev.mEvent.timestamp) / 1e9f);
         proto->write(Event::WALL_TIMESTAMP_MS, ev.mWallTime.tv_sec * 1000LL
@@ -129,15 +165,17 @@ void RecentEventLogger::setFormat(std::string format) {
 }
 
 bool RecentEventLogger::populateLastEventIfCurrent(sensors_event_t *event) const {
-    std::lock_guard<std::mutex> lk(mLock);
-
-    if (mIsLastEventCurrent && mRecentEvents.size()) {
-        // Index 0 contains the latest event emplace()'ed
-        *event = mRecentEvents[0].mEvent;
-        return true;
-    } else {
-        return false;
+    if (mIsLastEventCurrent.load(std::memory_order_relaxed)) {
+        // Retry if the sensor thread overwrote the latest event while it was copied.
+        for (uint64_t count; (count = mEventCount.load(std::memory_order_acquire)) != 0;) {
+            SensorEventLog log;
+            if (readSlot(count - 1, &log)) {
+                *event = log.mEvent;
+                return true;
+            }
+        }
     }
+    return false;
 }
 
 
@@ -154,9 +192,5 @@ size_t RecentEventLogger::logSizeBySensorType(int sensorType) {
     return LOG_SIZE;
 }
 
-RecentEventLogger::SensorEventLog::SensorEventLog(const sensors_event_t& e) : mEvent(e) {
-    clock_gettime(CLOCK_REALTIME, &mWallTime);
-}
-
 } // namespace SensorServiceUtil
 } // namespace android
@@ -17,13 +17,14 @@
 #ifndef ANDROID_SENSOR_SERVICE_UTIL_RECENT_EVENT_LOGGER_H
 #define ANDROID_SENSOR_SERVICE_UTIL_RECENT_EVENT_LOGGER_H
 
-#include "RingBuffer.h"
 #include "SensorServiceUtils.h"
 
 #include <hardware/sensors.h>
 #include <utils/String8.h>
 
-#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 namespace android {
 namespace SensorServiceUtil {
@@ -33,6 +34,10 @@ namespace SensorServiceUtil {
 // generated from the sensor are stored in this buffer.  The buffer is NOT cleared when the sensor
 // unregisters and as a result very old data in the dumpsys output can be seen, which is an intended
 // behavior.
+//
+// Events are only added by the sensor thread. The buffer is a single writer ring where each slot
+// is protected by a seqlock, so that dump readers never block the sensor thread and the sensor
+// thread never waits for a reader.
 class RecentEventLogger : public Dumpable {
 public:
     explicit RecentEventLogger(int sensorType);
@@ -53,22 +58,38 @@ public:
 
 protected:
     struct SensorEventLog {
-        explicit SensorEventLog(const sensors_event_t& e);
         timespec mWallTime;
         sensors_event_t mEvent;
     };
 
+    // Copy the recorded events that are still in the buffer, latest first.
+    std::vector<SensorEventLog> getRecentEvents() const;
+
     const int mSensorType;
     const size_t mEventSize;
 
-    mutable std::mutex mLock;
-    RingBuffer<SensorEventLog> mRecentEvents;
-
     bool mMaskData;
-    bool mIsLastEventCurrent;
+    std::atomic<bool> mIsLastEventCurrent;
 
 private:
     static size_t logSizeBySensorType(int sensorType);
+
+    // mSequence is the number of the event stored in the slot, or WRITING while the sensor thread
+    // is overwriting it. A reader keeps its copy of a slot only if the number is the one it
+    // expects both before and after copying it.
+    static constexpr uint64_t WRITING = UINT64_MAX;
+    struct Slot {
+        std::atomic<uint64_t> mSequence{WRITING};
+        SensorEventLog mLog;
+    };
+
+    // Copy the event with the given number, returns false if it was overwritten.
+    bool readSlot(uint64_t sequence, SensorEventLog* log) const;
+
+    const size_t mCapacity;
+    std::unique_ptr<Slot[]> mSlots;
+    // Number of events added so far, the latest one is mEventCount - 1.
+    std::atomic<uint64_t> mEventCount;
 };
 
 } // namespace SensorServiceUtil
@@ -47,7 +47,8 @@ bool RotationVectorSensor::process(sensors_event_t* outEvent,
         const sensors_event_t& event)
 {
     if (event.type == SENSOR_TYPE_ACCELEROMETER) {
-        if (mSensorFusion.hasEstimate(mMode)) {
+        if (mSensorFusion.hasEstimate(mMode) &&
+                mSensorFusion.shouldReport(this, event.timestamp)) {
             const vec4_t q(mSensorFusion.getAttitude(mMode));
             *outEvent = event;
             outEvent->data[0] = q.x;
@@ -63,10 +64,14 @@ bool RotationVectorSensor::process(sensors_event_t* outEvent,
 }
 
 status_t RotationVectorSensor::activate(void* ident, bool enabled) {
+    if (!enabled) {
+        mSensorFusion.removeReportPeriod(this, ident);
+    }
     return mSensorFusion.activate(mMode, ident, enabled);
 }
 
 status_t RotationVectorSensor::setDelay(void* ident, int /*handle*/, int64_t ns) {
+    mSensorFusion.setReportPeriod(this, ident, ns);
     return mSensorFusion.setDelay(mMode, ident, ns);
 }
 
@@ -133,7 +138,8 @@ bool GyroDriftSensor::process(sensors_event_t* outEvent,
         const sensors_event_t& event)
 {
     if (event.type == SENSOR_TYPE_ACCELEROMETER) {
-        if (mSensorFusion.hasEstimate()) {
+        if (mSensorFusion.hasEstimate() &&
+                mSensorFusion.shouldReport(this, event.timestamp)) {
             const vec3_t b(mSensorFusion.getGyroBias());
             *outEvent = event;
             outEvent->data[0] = b.x;
@@ -148,10 +154,14 @@ bool GyroDriftSensor::process(sensors_event_t* outEvent,
 }
 
 status_t GyroDriftSensor::activate(void* ident, bool enabled) {
+    if (!enabled) {
+        mSensorFusion.removeReportPeriod(this, ident);
+    }
     return mSensorFusion.activate(FUSION_9AXIS, ident, enabled);
 }
 
 status_t GyroDriftSensor::setDelay(void* ident, int /*handle*/, int64_t ns) {
+    mSensorFusion.setReportPeriod(this, ident, ns);
     return mSensorFusion.setDelay(FUSION_9AXIS, ident, ns);
 }
 
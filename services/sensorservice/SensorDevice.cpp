@@ -36,7 +36,9 @@
 #include <chrono>
 #include <cinttypes>
 #include <cstddef>
+#include <map>
 #include <thread>
+#include <utility>
 
 using namespace android::hardware::sensors;
 using android::util::ProtoOutputStream;
@@ -63,6 +65,20 @@ enum DevicePrivateBase : int32_t {
     DEVICE_PRIVATE_BASE = 65536,
 };
 
+// Nominal event rate of a direct report rate level, see ASENSOR_DIRECT_RATE_*.
+int directReportRateHz(int32_t rateLevel) {
+    switch (rateLevel) {
+        case SENSOR_DIRECT_RATE_NORMAL:
+            return 50;
+        case SENSOR_DIRECT_RATE_FAST:
+            return 200;
+        case SENSOR_DIRECT_RATE_VERY_FAST:
+            return 800;
+        default:
+            return 0;
+    }
+}
+
 } // anonymous namespace
 
 SensorDevice::SensorDevice() {
@@ -298,6 +314,35 @@ std::string SensorDevice::dump() const {
         result.appendFormat("}, selected = %.2f ms\n", info.bestBatchParams.mTBatch / 1e6f);
     }
 
+    // Every direct channel gets its own copy of the events from the HAL, even when another
+    // channel receives the same sensor at the same rate.
+    std::map<std::pair<int32_t /* sensorHandle */, int32_t /* rateLevel */>, size_t> directReports;
+    for (const auto& [channelHandle, rates] : mDirectChannelRates) {
+        for (const auto& [sensorHandle, rateLevel] : rates) {
+            directReports[{sensorHandle, rateLevel}]++;
+        }
+    }
+    size_t duplicateBytesPerSecond = 0;
+    for (const auto& [report, channelCount] : directReports) {
+        const auto& [sensorHandle, rateLevel] = report;
+        if (channelCount < 2) continue;
+        result.appendFormat("0x%08x) direct report rate level %d into %zu channels\n",
+                            sensorHandle, rateLevel, channelCount);
+        duplicateBytesPerSecond +=
+                (channelCount - 1) * directReportRateHz(rateLevel) * sizeof(sensors_event_t);
+    }
+    result.appendFormat("Direct report: %zu channels, %zu sensor reports, %zu bytes/s of "
+                        "duplicate HAL writes\n",
+                        mDirectChannelRates.size(), directReports.size(),
+                        duplicateBytesPerSecond);
+
+    const uint64_t polls = mPollStats.polls.load(std::memory_order_relaxed);
+    const uint64_t events = mPollStats.events.load(std::memory_order_relaxed);
+    result.appendFormat("HAL poll: %" PRIu64 " events in %" PRIu64 " polls (%.1f per poll), "
+                        "%" PRIu64 " polls filled the buffer\n",
+                        events, polls, polls > 0 ? double(events) / polls : 0.0,
+                        mPollStats.fullPolls.load(std::memory_order_relaxed));
+
     return result.string();
 }
 
@@ -362,8 +407,21 @@ ssize_t SensorDevice::poll(sensors_event_t* buffer, size_t count) {
     }
 
     if (eventsRead > 0) {
+        mPollStats.polls.fetch_add(1, std::memory_order_relaxed);
+        mPollStats.events.fetch_add(eventsRead, std::memory_order_relaxed);
+        if (size_t(eventsRead) == count) {
+            mPollStats.fullPolls.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Batches usually have runs of events of the same sensor, only search the sensor list
+        // when the handle changes.
+        int32_t lastHandle = 0;
+        float resolution = 0;
         for (ssize_t i = 0; i < eventsRead; i++) {
-            float resolution = getResolutionForSensor(buffer[i].sensor);
+            if (i == 0 || buffer[i].sensor != lastHandle) {
+                lastHandle = buffer[i].sensor;
+                resolution = getResolutionForSensor(lastHandle);
+            }
             android::SensorDeviceUtils::quantizeSensorEventValues(&buffer[i], resolution);
 
             if (buffer[i].type == SENSOR_TYPE_DYNAMIC_SENSOR_META) {
@@ -785,6 +843,9 @@ int32_t SensorDevice::registerDirectChannel(const sensors_direct_mem_t* memory)
 
 void SensorDevice::unregisterDirectChannel(int32_t channelHandle) {
     mHalWrapper->unregisterDirectChannel(channelHandle);
+
+    Mutex::Autolock _l(mLock);
+    mDirectChannelRates.erase(channelHandle);
 }
 
 int32_t SensorDevice::configureDirectChannel(int32_t sensorHandle, int32_t channelHandle,
@@ -792,7 +853,20 @@ int32_t SensorDevice::configureDirectChannel(int32_t sensorHandle, int32_t chann
     if (mHalWrapper == nullptr) return NO_INIT;
     Mutex::Autolock _l(mLock);
 
-    return mHalWrapper->configureDirectChannel(sensorHandle, channelHandle, config);
+    int32_t ret = mHalWrapper->configureDirectChannel(sensorHandle, channelHandle, config);
+    if (config->rate_level == SENSOR_DIRECT_RATE_STOP) {
+        if (ret == NO_ERROR) {
+            // A sensor handle of -1 stops all the sensors of the channel.
+            auto it = mDirectChannelRates.find(channelHandle);
+            if (it != mDirectChannelRates.end()) {
+                if (sensorHandle != -1) it->second.erase(sensorHandle);
+                if (sensorHandle == -1 || it->second.empty()) mDirectChannelRates.erase(it);
+            }
+        }
+    } else if (ret > 0) {
+        mDirectChannelRates[channelHandle][sensorHandle] = config->rate_level;
+    }
+    return ret;
 }
 
 // ---------------------------------------------------------------------------
@@ -35,6 +35,7 @@
 #include <utils/Timers.h>
 
 #include <algorithm> //std::max std::min
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -225,6 +226,20 @@ private:
     float getResolutionForSensor(int sensorHandle);
 
     bool mIsDirectReportSupported;
+
+    // Depth of the HAL event queue as seen by poll(). A poll that fills the buffer means that
+    // events were left in the queue for the next one.
+    // Rate level of each sensor the HAL reports into each direct channel, as configured through
+    // configureDirectChannel. Protected by mLock.
+    std::unordered_map<int32_t /* channelHandle */,
+                       std::unordered_map<int32_t /* sensorHandle */, int32_t /* rateLevel */>>
+            mDirectChannelRates;
+
+    struct PollStats {
+        std::atomic<uint64_t> polls{0};
+        std::atomic<uint64_t> events{0};
+        std::atomic<uint64_t> fullPolls{0};
+    } mPollStats;
 };
 
 // ---------------------------------------------------------------------------
@@ -90,8 +90,8 @@ void SensorService::SensorEventConnection::dump(String8& result) {
         result.append("NORMAL\n");
     }
     result.appendFormat("\t %s | WakeLockRefCount %d | uid %d | cache size %d | "
-            "max cache size %d\n", mPackageName.string(), mWakeLockRefCount, mUid, mCacheSize,
-            mMaxCacheSize);
+            "max cache size %d | %s\n", mPackageName.string(), mWakeLockRefCount, mUid, mCacheSize,
+            mMaxCacheSize, mEventRing != nullptr ? "shared memory ring" : "socket");
     for (auto& it : mSensorInfo) {
         const FlushInfo& flushInfo = it.second;
         result.appendFormat("\t %s 0x%08x | status: %s | pending flush events %d \n",
@@ -241,7 +241,10 @@ void SensorService::SensorEventConnection::updateLooperRegistrationLocked(
     return; }
 
     int looper_flags = 0;
-    if (mCacheSize > 0) looper_flags |= ALOOPER_EVENT_OUTPUT;
+    // With a ring, the reader tells us over the socket when there is room for the cached events.
+    if (mCacheSize > 0) {
+        looper_flags |= mEventRing != nullptr ? ALOOPER_EVENT_INPUT : ALOOPER_EVENT_OUTPUT;
+    }
     if (mDataInjectionMode) looper_flags |= ALOOPER_EVENT_INPUT;
     for (auto& it : mSensorInfo) {
         const int handle = it.first;
@@ -372,6 +375,55 @@ status_t SensorService::SensorEventConnection::sendEvents(
         }
     }
 
+    return sendFilteredEventsLocked(scratch, count);
+}
+
+status_t SensorService::SensorEventConnection::sendEvents(
+        sensors_event_t const* buffer, const std::vector<size_t>& eventIndices,
+        sensors_event_t* scratch,
+        wp<const SensorEventConnection> const* mapFlushEventsToConnections,
+        bool hasWakeUpEvents) {
+    int count = 0;
+    Mutex::Autolock _l(mConnectionLock);
+    // The access can't change while we hold mConnectionLock, only check it once per batch.
+    const bool sensorAccess = !eventIndices.empty() && hasSensorAccess();
+    for (size_t i : eventIndices) {
+        const sensors_event_t& event = buffer[i];
+        const bool isFlushComplete = event.type == SENSOR_TYPE_META_DATA;
+        // buffer[i].sensor is zero for meta_data events.
+        const int32_t sensor_handle = isFlushComplete ? event.meta_data.sensor : event.sensor;
+        auto it = mSensorInfo.find(sensor_handle);
+        if (it == mSensorInfo.end()) {
+            continue;
+        }
+
+        // Same filtering as above: drop the events until the first flush complete event of this
+        // connection, and only keep the flush complete events of its own flush() calls.
+        FlushInfo& flushInfo = it->second;
+        const bool flushIsForThis = isFlushComplete && mapFlushEventsToConnections[i] == this;
+        if (flushIsForThis && flushInfo.mFirstFlushPending) {
+            flushInfo.mFirstFlushPending = false;
+            ALOGD_IF(DEBUG_CONNECTIONS, "First flush event for sensor==%d ", sensor_handle);
+            continue;
+        }
+        if (flushInfo.mFirstFlushPending) {
+            continue;
+        }
+        if (isFlushComplete) {
+            if (flushIsForThis) {
+                scratch[count++] = event;
+            }
+        } else if (sensorAccess && noteOpIfRequired(event)) {
+            scratch[count++] = event;
+        }
+    }
+
+    return sendFilteredEventsLocked(scratch, count, hasWakeUpEvents);
+}
+
+status_t SensorService::SensorEventConnection::sendFilteredEventsLocked(sensors_event_t* scratch,
+                                                                        int count,
+                                                                        bool mayHaveWakeUpEvents) {
     sendPendingFlushEventsLocked();
     // Early return if there are no events for this connection.
     if (count == 0) {
@@ -385,11 +437,12 @@ status_t SensorService::SensorEventConnection::sendEvents(
         // There are some events in the cache which need to be sent first. Copy this buffer to
         // the end of cache.
         appendEventsToCacheLocked(scratch, count);
+        flushCacheIfRingHasRoomLocked();
         return status_t(NO_ERROR);
     }
 
     int index_wake_up_event = -1;
-    if (hasSensorAccess()) {
+    if (mayHaveWakeUpEvents && hasSensorAccess()) {
         index_wake_up_event = findWakeUpSensorEventLocked(scratch, count);
         if (index_wake_up_event >= 0) {
             BatteryService::noteWakeupSensorEvent(scratch[index_wake_up_event].timestamp,
@@ -403,8 +456,7 @@ status_t SensorService::SensorEventConnection::sendEvents(
     }
 
     // NOTE: ASensorEvent and sensors_event_t are the same type.
-    ssize_t size = SensorEventQueue::write(mChannel,
-                                    reinterpret_cast<ASensorEvent const*>(scratch), count);
+    ssize_t size = writeEventsLocked(reinterpret_cast<ASensorEvent const*>(scratch), count);
     if (size < 0) {
         // Write error, copy events to local cache.
         if (index_wake_up_event >= 0) {
@@ -428,6 +480,7 @@ status_t SensorService::SensorEventConnection::sendEvents(
         // Add this file descriptor to the looper to get a callback when this fd is available for
         // writing.
         updateLooperRegistrationLocked(mService->getLooper());
+        flushCacheIfRingHasRoomLocked();
         return size;
     }
 
@@ -440,6 +493,47 @@ status_t SensorService::SensorEventConnection::sendEvents(
     return size < 0 ? status_t(size) : status_t(NO_ERROR);
 }
 
+ssize_t SensorService::SensorEventConnection::writeEventsLocked(ASensorEvent const* events,
+                                                                size_t count) {
+    if (mEventRing == nullptr) {
+        return SensorEventQueue::write(mChannel, events, count);
+    }
+
+    bool needsDoorbell;
+    if (!mEventRing->write(events, count, &needsDoorbell)) {
+        // Handled like a full socket, the events are cached until the reader makes room.
+        return -EAGAIN;
+    }
+    if (needsDoorbell) {
+        const uint8_t doorbell = 0;
+        // If this fails, the socket is full of doorbells the reader hasn't consumed yet, so it
+        // will wake up anyway.
+        BitTube::sendObjects(mChannel, &doorbell, 1);
+    }
+    return static_cast<ssize_t>(count);
+}
+
+void SensorService::SensorEventConnection::flushCacheIfRingHasRoomLocked() {
+    // The reader tells us when it makes room in the ring, unless it did so before it could see that
+    // we are waiting. In that case we have to flush the cache ourselves.
+    if (mEventRing != nullptr && mCacheSize > 0 &&
+        mEventRing->setWriterWaiting(std::min(mCacheSize, getMaxWriteSizeFromCache()))) {
+        writeToSocketFromCacheLocked();
+    }
+}
+
+sp<SensorEventRing> SensorService::SensorEventConnection::getSensorEventRing() {
+    Mutex::Autolock _l(mConnectionLock);
+    // Events are only written to one transport, so this can only change before the first event.
+    // Data injection connections receive nothing, they keep the BitTube.
+    if (mEventRing == nullptr && !mDataInjectionMode && mSensorInfo.empty() && mCacheSize == 0) {
+        const size_t capacity = std::max<size_t>(SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT,
+                mService->mSocketBufferSize / sizeof(sensors_event_t));
+        mEventRing = SensorEventRing::create(capacity);
+    }
+    return mEventRing;
+}
+
 bool SensorService::SensorEventConnection::hasSensorAccess() {
     return mService->isUidActive(mUid)
         && !mService->mSensorPrivacyPolicy->isSensorPrivacyEnabled();
@@ -468,9 +562,9 @@ bool SensorService::SensorEventConnection::noteOpIfRequired(const sensors_event_
             String16 noteMsg("Sensor event (");
             noteMsg.append(String16(mService->getSensorStringType(sensorHandle)));
             noteMsg.append(String16(")"));
-            int32_t appOpMode = mService->sAppOpsManager.noteOp(iter->second, mUid,
-                                                                mOpPackageName, mAttributionTag,
-                                                                noteMsg);
+            int32_t appOpMode = mService->sAppOpsManager.noteOpCached(iter->second, mUid,
+                                                                      mOpPackageName,
+                                                                      mAttributionTag, noteMsg);
             success = (appOpMode == AppOpsManager::MODE_ALLOWED);
         }
     }
@@ -570,7 +664,7 @@ void SensorService::SensorEventConnection::sendPendingFlushEventsLocked() {
                ++mWakeLockRefCount;
                flushCompleteEvent.flags |= WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
             }
-            ssize_t size = SensorEventQueue::write(mChannel, &flushCompleteEvent, 1);
+            ssize_t size = writeEventsLocked(&flushCompleteEvent, 1);
             if (size < 0) {
                 if (wakeUpSensor) --mWakeLockRefCount;
                 return;
@@ -582,12 +676,20 @@ void SensorService::SensorEventConnection::sendPendingFlushEventsLocked() {
     }
 }
 
-void SensorService::SensorEventConnection::writeToSocketFromCache() {
+int SensorService::SensorEventConnection::getMaxWriteSizeFromCache() const {
     // At a time write at most half the size of the receiver buffer in SensorEventQueue OR
     // half the size of the socket buffer allocated in BitTube whichever is smaller.
-    const int maxWriteSize = helpers::min(SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT/2,
+    return helpers::min(SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT/2,
             int(mService->mSocketBufferSize/(sizeof(sensors_event_t)*2)));
+}
+
+void SensorService::SensorEventConnection::writeToSocketFromCache() {
     Mutex::Autolock _l(mConnectionLock);
+    writeToSocketFromCacheLocked();
+}
+
+void SensorService::SensorEventConnection::writeToSocketFromCacheLocked() {
+    const int maxWriteSize = getMaxWriteSizeFromCache();
     // Send pending flush complete events (if any)
     sendPendingFlushEventsLocked();
     for (int numEventsSent = 0; numEventsSent < mCacheSize;) {
@@ -606,9 +708,9 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
             }
         }
 
-        ssize_t size = SensorEventQueue::write(mChannel,
-                          reinterpret_cast<ASensorEvent const*>(mEventCache + numEventsSent),
-                          numEventsToWrite);
+        ssize_t size = writeEventsLocked(
+                reinterpret_cast<ASensorEvent const*>(mEventCache + numEventsSent),
+                numEventsToWrite);
         if (size < 0) {
             if (index_wake_up_event >= 0) {
                 // If there was a wake_up sensor_event, reset the flag.
@@ -626,6 +728,12 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
             ALOGD_IF(DEBUG_CONNECTIONS, "wrote %d events from cache size==%d ",
                     numEventsSent, mCacheSize);
             mCacheSize -= numEventsSent;
+            if (mEventRing != nullptr &&
+                mEventRing->setWriterWaiting(helpers::min(mCacheSize, maxWriteSize))) {
+                // The reader made room before it could see that we are waiting, keep going.
+                numEventsSent = 0;
+                continue;
+            }
             return;
         }
         numEventsSent += numEventsToWrite;
@@ -843,6 +951,7 @@ int SensorService::SensorEventConnection::handleEvent(int fd, int events, void*
     if (events & ALOOPER_EVENT_INPUT) {
         unsigned char buf[sizeof(sensors_event_t)];
         ssize_t numBytesRead = ::recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        bool ringHasRoom = false;
         {
             Mutex::Autolock _l(mConnectionLock);
             if (numBytesRead == sizeof(sensors_event_t)) {
@@ -885,11 +994,18 @@ int SensorService::SensorEventConnection::handleEvent(int fd, int events, void*
 #if DEBUG_CONNECTIONS
                 mTotalAcksReceived += numAcks;
 #endif
+            } else if (numBytesRead == sizeof(SensorEventRing::RoomAvailableMessage) &&
+                       mEventRing != nullptr) {
+                ringHasRoom = true;
            } else {
                // Read error, reset wakelock refcount.
                mWakeLockRefCount = 0;
            }
         }
+        if (ringHasRoom) {
+            // send sensor data that is stored in mEventCache for this connection.
+            mService->sendEventsFromCache(this);
+        }
         // Check if wakelock can be released by sensorservice. mConnectionLock needs to be released
         // here as checkWakeLockState() will need it.
         if (mWakeLockRefCount == 0) {
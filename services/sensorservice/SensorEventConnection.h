@@ -37,6 +37,7 @@
 #include <sensor/BitTube.h>
 #include <sensor/ISensorServer.h>
 #include <sensor/ISensorEventConnection.h>
+#include <sensor/SensorEventRing.h>
 
 #include "SensorService.h"
 
@@ -56,6 +57,13 @@ public:
 
     status_t sendEvents(sensors_event_t const* buffer, size_t count, sensors_event_t* scratch,
                         wp<const SensorEventConnection> const * mapFlushEventsToConnections = nullptr);
+    // Same as above, but only looks at the events of buffer at eventIndices, which must be sorted.
+    // SensorService uses this with the events it already partitioned by sensor handle.
+    // hasWakeUpEvents is false if none of the events at eventIndices is from a wake up sensor.
+    status_t sendEvents(sensors_event_t const* buffer, const std::vector<size_t>& eventIndices,
+                        sensors_event_t* scratch,
+                        wp<const SensorEventConnection> const* mapFlushEventsToConnections,
+                        bool hasWakeUpEvents);
     bool hasSensor(int32_t handle) const;
     bool hasAnySensor() const;
     bool hasOneShotSensors() const;
@@ -83,8 +91,15 @@ private:
     virtual status_t setEventRate(int handle, nsecs_t samplingPeriodNs);
     virtual status_t flush();
     virtual int32_t configureChannel(int handle, int rateLevel);
+    virtual sp<SensorEventRing> getSensorEventRing();
     virtual void destroy();
 
+    // Send the count events of scratch that were selected for this connection, along with the
+    // pending flush complete events. The events are only searched for a wake up event if
+    // mayHaveWakeUpEvents.
+    status_t sendFilteredEventsLocked(sensors_event_t* scratch, int count,
+                                      bool mayHaveWakeUpEvents = true);
+
     // Count the number of flush complete events which are about to be dropped in the buffer.
     // Increment mPendingFlushEventsToSend in mSensorInfo. These flush complete events will be sent
     // separately before the next batch of events.
@@ -101,8 +116,21 @@ private:
     // emulates the behavior of flush().
     void sendPendingFlushEventsLocked();
 
-    // Writes events from mEventCache to the socket.
+    // Writes events from mEventCache to the socket, or to the ring if the connection has one.
     void writeToSocketFromCache();
+    void writeToSocketFromCacheLocked();
+
+    // The maximum number of events written from mEventCache at once.
+    int getMaxWriteSizeFromCache() const;
+
+    // Writes events to mEventRing if the connection has one, ringing the doorbell of the reader
+    // when needed, or to mChannel otherwise. Like SensorEventQueue::write, returns the number of
+    // events written or a negative error, -EAGAIN when there is no room left.
+    ssize_t writeEventsLocked(ASensorEvent const* events, size_t count);
+
+    // Writes the cached events right away if the reader made room in mEventRing before it could
+    // see that we were waiting for it.
+    void flushCacheIfRingHasRoomLocked();
 
     // Compute the approximate cache size from the FIFO sizes of various sensors registered for this
     // connection. Wake up and non-wake up sensors have separate FIFOs but FIFO may be shared
@@ -148,6 +176,9 @@ private:
     void uncapRates();
     sp<SensorService> const mService;
     sp<BitTube> mChannel;
+    // Replaces mChannel for the events when the client asked for it, mChannel then only carries
+    // the doorbells of the ring and the messages from the client.
+    sp<SensorEventRing> mEventRing;
     uid_t mUid;
     mutable Mutex mConnectionLock;
     // Number of events from wake up sensors which are still pending and haven't been delivered to
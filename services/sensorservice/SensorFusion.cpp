@@ -14,6 +14,12 @@
  * limitations under the License.
  */
 
+#include <math.h>
+
+#include <algorithm>
+
+#include <hardware/sensors.h>
+
 #include "SensorDevice.h"
 #include "SensorFusion.h"
 #include "SensorService.h"
@@ -113,6 +119,7 @@ void SensorFusion::process(const sensors_event_t& event) {
                 if (mEnabled[i]) {
                     mFusions[i].handleAcc(acc, dT);
                     mAttitudes[i] = mFusions[i].getAttitude();
+                    updateOutput(i);
                 }
             }
         }
@@ -120,6 +127,70 @@ void SensorFusion::process(const sensors_event_t& event) {
     }
 }
 
+void SensorFusion::updateOutput(int mode) {
+    if (!mFusions[mode].hasEstimate()) {
+        return;
+    }
+    FusedOutput& output(mOutputs[mode]);
+    const mat33_t& R(output.rotation = mFusions[mode].getRotationMatrix());
+    // FIXME: we need to estimate the length of gravity because
+    // the accelerometer may have a small scaling error. This
+    // translates to an offset in the linear-acceleration sensor.
+    output.gravity = R[2] * GRAVITY_EARTH;
+
+    const float rad2deg = 180 / M_PI;
+    output.orientation[0] = atan2f(-R[1][0], R[0][0]) * rad2deg;
+    output.orientation[1] = atan2f(-R[2][1], R[2][2]) * rad2deg;
+    output.orientation[2] = asinf ( R[2][0])          * rad2deg;
+    if (output.orientation[0] < 0)
+        output.orientation[0] += 360;
+}
+
+void SensorFusion::ReportDecimator::updatePeriod() {
+    int64_t fastestPeriodNs = INT64_MAX;
+    for (const auto& [ident, clientPeriodNs] : periodsNs) {
+        fastestPeriodNs = std::min(fastestPeriodNs, clientPeriodNs);
+    }
+    if (fastestPeriodNs != periodNs) {
+        periodNs = fastestPeriodNs;
+        nextReportNs = 0;
+    }
+}
+
+void SensorFusion::setReportPeriod(const void* sensor, void* ident, int64_t ns) {
+    ReportDecimator& decimator(mDecimators[sensor]);
+    decimator.periodsNs[ident] = ns;
+    decimator.updatePeriod();
+}
+
+void SensorFusion::removeReportPeriod(const void* sensor, void* ident) {
+    auto it = mDecimators.find(sensor);
+    if (it == mDecimators.end() || it->second.periodsNs.erase(ident) == 0) {
+        return;
+    }
+    if (it->second.periodsNs.empty()) {
+        mDecimators.erase(it);
+    } else {
+        it->second.updatePeriod();
+    }
+}
+
+bool SensorFusion::shouldReport(const void* sensor, int64_t timestamp) {
+    auto it = mDecimators.find(sensor);
+    if (it == mDecimators.end() || it->second.periodNs <= 0) {
+        return true;
+    }
+    ReportDecimator& decimator(it->second);
+    // Accept some jitter on the timestamps, so that an event arriving slightly
+    // early doesn't halve the rate.
+    const int64_t toleranceNs = decimator.periodNs / 8;
+    if (timestamp + toleranceNs < decimator.nextReportNs) {
+        return false;
+    }
+    decimator.nextReportNs = timestamp + decimator.periodNs;
+    return true;
+}
+
 template <typename T> inline T min(T a, T b) { return a<b ? a : b; }
 template <typename T> inline T max(T a, T b) { return a>b ? a : b; }
 
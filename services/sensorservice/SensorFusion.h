@@ -20,6 +20,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <unordered_map>
+
 #include <utils/SortedVector.h>
 #include <utils/Singleton.h>
 #include <utils/String8.h>
@@ -38,6 +40,20 @@ class SensorDevice;
 class SensorFusion : public Singleton<SensorFusion> {
     friend class Singleton<SensorFusion>;
 
+public:
+    /*
+     * Quantities derived from the attitude of a fusion mode. They are
+     * computed once per accelerometer update and shared by all the virtual
+     * sensors using that mode.
+     */
+    struct FusedOutput {
+        mat33_t rotation;
+        vec3_t gravity;     // in m/s^2
+        vec3_t orientation; // azimuth, pitch and roll in degrees
+    };
+
+private:
+
     SensorDevice& mSensorDevice;
     Sensor mAcc;
     Sensor mMag;
@@ -49,6 +65,7 @@ class SensorFusion : public Singleton<SensorFusion> {
 
     vec4_t &mAttitude;
     vec4_t mAttitudes[NUM_FUSION_MODE];
+    FusedOutput mOutputs[NUM_FUSION_MODE];
 
     SortedVector<void*> mClients[3];
 
@@ -58,7 +75,22 @@ class SensorFusion : public Singleton<SensorFusion> {
     nsecs_t mGyroTime;
     nsecs_t mAccTime;
 
+    /*
+     * The fusion of a mode runs at the fastest rate requested by any of its
+     * clients. Each virtual sensor only reports at the fastest rate requested
+     * by its own clients, it's keyed by the sensor object.
+     */
+    struct ReportDecimator {
+        std::unordered_map<void*, int64_t> periodsNs; // by client
+        int64_t periodNs = 0;
+        int64_t nextReportNs = 0;
+
+        void updatePeriod();
+    };
+    std::unordered_map<const void*, ReportDecimator> mDecimators;
+
     SensorFusion();
+    void updateOutput(int mode);
 
 public:
     void process(const sensors_event_t& event);
@@ -74,7 +106,11 @@ public:
     }
 
     mat33_t getRotationMatrix(int mode = FUSION_9AXIS) const {
-        return mFusions[mode].getRotationMatrix();
+        return mOutputs[mode].rotation;
+    }
+
+    const FusedOutput& getOutput(int mode = FUSION_9AXIS) const {
+        return mOutputs[mode];
     }
 
     vec4_t getAttitude(int mode = FUSION_9AXIS) const {
@@ -87,6 +123,12 @@ public:
     status_t activate(int mode, void* ident, bool enabled);
     status_t setDelay(int mode, void* ident, int64_t ns);
 
+    // Decimation of the events reported by the virtual sensor "sensor".
+    void setReportPeriod(const void* sensor, void* ident, int64_t ns);
+    void removeReportPeriod(const void* sensor, void* ident);
+    // Returns whether the sensor should report an event with this timestamp.
+    bool shouldReport(const void* sensor, int64_t timestamp);
+
     float getPowerUsage(int mode=FUSION_9AXIS) const;
     int32_t getMinDelay() const;
 
@@ -63,6 +63,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <ctime>
 #include <future>
 #include <string>
@@ -160,7 +161,7 @@ static bool isAutomotive() {
 
 SensorService::SensorService()
     : mInitCheck(NO_INIT), mSocketBufferSize(SOCKET_BUFFER_SIZE_NON_BATCHED),
-      mWakeLockAcquired(false), mLastReportedProxIsActive(false) {
+      mWakeLockAcquired(false), mWakeLockReleaseTimeNs(0), mLastReportedProxIsActive(false) {
     mUidPolicy = new UidPolicy(this);
     mSensorPrivacyPolicy = new SensorPrivacyPolicy(this);
     mMicSensorPrivacyPolicy = new MicrophonePrivacyPolicy(this);
@@ -214,6 +215,7 @@ status_t SensorService::unregisterRuntimeSensor(int handle) {
     for (const sp<SensorEventConnection>& connection : connLock.getActiveConnections()) {
         connection->removeSensor(handle);
     }
+    mSensorSubscribers.erase(handle);
 
     // If this was the last sensor for this device, remove its callback.
     bool deviceHasSensors = false;
@@ -634,8 +636,18 @@ status_t SensorService::dump(int fd, const Vector<String16>& args) {
 
             result.appendFormat("Socket Buffer size = %zd events\n",
                                 mSocketBufferSize/sizeof(sensors_event_t));
-            result.appendFormat("WakeLock Status: %s \n", mWakeLockAcquired ? "acquired" :
-                    "not held");
+            result.appendFormat("WakeLock Status: %s%s \n", mWakeLockAcquired ? "acquired" :
+                    "not held", mWakeLockReleaseTimeNs != 0 ? " (release pending)" : "");
+            // The stats are only updated on toggles, account for the minutes without any.
+            const nsecs_t windowAgeNs = systemTime(SYSTEM_TIME_MONOTONIC) -
+                    mWakeLockStats.windowStartNs;
+            const uint32_t lastMinuteToggles = windowAgeNs >= 2 * 60 * 1000000000LL ? 0
+                    : windowAgeNs >= 60 * 1000000000LL ? mWakeLockStats.windowToggles
+                    : mWakeLockStats.lastMinuteToggles;
+            result.appendFormat("WakeLock toggles: %" PRIu64 " total, %u in the last minute, "
+                                "max %u per minute\n",
+                                mWakeLockStats.toggles, lastMinuteToggles,
+                                mWakeLockStats.maxTogglesPerMinute);
             result.appendFormat("Mode :");
             switch(mCurrentOperatingMode) {
                case NORMAL:
@@ -658,6 +670,19 @@ status_t SensorService::dump(int fd, const Vector<String16>& args) {
             result.appendFormat("Sensor Privacy: %s\n",
                     mSensorPrivacyPolicy->isSensorPrivacyEnabled() ? "enabled" : "disabled");
 
+            result.appendFormat("Event fan-out: last %" PRId64 " us, max %" PRId64
+                                " us, average %" PRId64 " us over %" PRIu64 " batches\n",
+                                ns2us(mFanOutStats.lastNs), ns2us(mFanOutStats.maxNs),
+                                mFanOutStats.count > 0
+                                        ? ns2us(mFanOutStats.totalNs / mFanOutStats.count)
+                                        : 0,
+                                mFanOutStats.count);
+
+            const AppOpsManager::CacheStats appOpsStats = AppOpsManager::getCacheStats();
+            result.appendFormat("App ops cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64
+                                " invalidations\n",
+                                appOpsStats.hits, appOpsStats.misses, appOpsStats.invalidations);
+
             const auto& activeConnections = connLock.getActiveConnections();
             result.appendFormat("%zd active connections\n", activeConnections.size());
             for (size_t i=0 ; i < activeConnections.size() ; i++) {
@@ -1045,7 +1070,11 @@ bool SensorService::threadLoop() {
     // aggressive, but guaranteed to be enough.
     const size_t vcount = mSensors.getVirtualSensors().size();
     const size_t minBufferSize = SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT;
-    const size_t numEventMax = minBufferSize / (1 + vcount);
+    // Only the active virtual sensors produce events, size the next read from the HAL for them so
+    // that bursts of batched events are read with fewer polls. This is updated at the end of each
+    // iteration; if a virtual sensor is enabled during a poll, the checks below drop the events
+    // that don't fit rather than overflowing the buffer.
+    size_t numEventMax = minBufferSize / (1 + vcount);
 
     SensorDevice& device(SensorDevice::getInstance());
 
@@ -1073,9 +1102,20 @@ bool SensorService::threadLoop() {
         // sending events to clients (incrementing SensorEventConnection::mWakeLockRefCount) should
         // not be interleaved with decrementing SensorEventConnection::mWakeLockRefCount and
         // releasing the wakelock.
+        // Batches usually have runs of events of the same sensor, only look the sensor up when the
+        // handle changes.
         uint32_t wakeEvents = 0;
+        int lastHandle = 0;
+        bool lastIsWakeUp = false;
         for (int i = 0; i < count; i++) {
-            if (isWakeUpSensorEvent(mSensorEventBuffer[i])) {
+            const sensors_event_t& event = mSensorEventBuffer[i];
+            const int handle =
+                    event.type == SENSOR_TYPE_META_DATA ? event.meta_data.sensor : event.sensor;
+            if (i == 0 || handle != lastHandle) {
+                lastHandle = handle;
+                lastIsWakeUp = isWakeUpSensorEvent(event);
+            }
+            if (lastIsWakeUp) {
                 wakeEvents++;
             }
         }
@@ -1084,6 +1124,8 @@ bool SensorService::threadLoop() {
             if (!mWakeLockAcquired) {
                 setWakeLockAcquiredLocked(true);
             }
+            // The new events need to be acknowledged before the wakelock can be released.
+            mWakeLockReleaseTimeNs = 0;
             device.writeWakeLockHandled(wakeEvents);
         }
         recordLastValueLocked(mSensorEventBuffer, count);
@@ -1095,13 +1137,23 @@ bool SensorService::threadLoop() {
             if (!mActiveVirtualSensors.empty()) {
                 size_t k = 0;
                 SensorFusion& fusion(SensorFusion::getInstance());
-                if (fusion.isEnabled()) {
-                    for (size_t i=0 ; i<size_t(count) ; i++) {
-                        fusion.process(event[i]);
+                const bool fusionEnabled = fusion.isEnabled();
+                mActiveVirtualSensorInterfaces.clear();
+                for (int handle : mActiveVirtualSensors) {
+                    std::shared_ptr<SensorInterface> si = getSensorInterfaceFromHandle(handle);
+                    if (si == nullptr) {
+                        ALOGE("handle %d is not an valid virtual sensor", handle);
+                        continue;
                     }
+                    mActiveVirtualSensorInterfaces.push_back(std::move(si));
                 }
                 for (size_t i=0 ; i<size_t(count) && k<minBufferSize ; i++) {
-                    for (int handle : mActiveVirtualSensors) {
+                    // Run the fusion one event at a time, so that the virtual sensors see the
+                    // outputs of the update triggered by the event they are processing.
+                    if (fusionEnabled) {
+                        fusion.process(event[i]);
+                    }
+                    for (const auto& si : mActiveVirtualSensorInterfaces) {
                         if (count + k >= minBufferSize) {
                             ALOGE("buffer too small to hold all events: "
                                     "count=%zd, k=%zu, size=%zu",
@@ -1109,12 +1161,6 @@ bool SensorService::threadLoop() {
                             break;
                         }
                         sensors_event_t out;
-                        std::shared_ptr<SensorInterface> si = getSensorInterfaceFromHandle(handle);
-                        if (si == nullptr) {
-                            ALOGE("handle %d is not an valid virtual sensor", handle);
-                            continue;
-                        }
-
                         if (si->process(&out, event[i])) {
                             mSensorEventBuffer[count + k] = out;
                             k++;
@@ -1225,16 +1271,26 @@ bool SensorService::threadLoop() {
                     for (const sp<SensorEventConnection>& connection : activeConnections) {
                         connection->removeSensor(handle);
                     }
+                    mSensorSubscribers.erase(handle);
                 }
             }
         }
 
         // Send our events to clients. Check the state of wake lock for each client and release the
-        // lock if none of the clients need it.
+        // lock if none of the clients need it. Each connection only gets the indices of the events
+        // of the sensors it subscribed to, so it doesn't have to scan the whole batch. Connections
+        // without events are still called to send their pending flush complete events.
+        const nsecs_t fanOutStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        partitionEventsLocked(count);
+        static const std::vector<size_t> kNoEvents;
         bool needsWakeLock = false;
         for (const sp<SensorEventConnection>& connection : activeConnections) {
-            connection->sendEvents(mSensorEventBuffer, count, mSensorEventScratch,
-                    mMapFlushEventsToConnections);
+            auto indices = mEventIndicesByConnection.find(connection.get());
+            connection->sendEvents(mSensorEventBuffer,
+                                   indices != mEventIndicesByConnection.end() ? indices->second
+                                                                              : kNoEvents,
+                                   mSensorEventScratch, mMapFlushEventsToConnections,
+                                   mConnectionsWithWakeUpEvents.count(connection.get()) != 0);
             needsWakeLock |= connection->needsWakeLock();
             // If the connection has one-shot sensors, it may be cleaned up after first trigger.
             // Early check for one-shot sensors.
@@ -1243,9 +1299,17 @@ bool SensorService::threadLoop() {
             }
         }
 
+        const nsecs_t fanOutDurationNs = systemTime(SYSTEM_TIME_MONOTONIC) - fanOutStartNs;
+        mFanOutStats.lastNs = fanOutDurationNs;
+        mFanOutStats.maxNs = std::max(mFanOutStats.maxNs, fanOutDurationNs);
+        mFanOutStats.totalNs += fanOutDurationNs;
+        mFanOutStats.count++;
+
         if (mWakeLockAcquired && !needsWakeLock) {
-            setWakeLockAcquiredLocked(false);
+            requestWakeLockReleaseLocked();
         }
+
+        numEventMax = minBufferSize / (1 + mActiveVirtualSensors.size());
     } while (!Thread::exitPending());
 
     ALOGW("Exiting SensorService::threadLoop => aborting...");
@@ -1253,6 +1317,72 @@ bool SensorService::threadLoop() {
     return false;
 }
 
+void SensorService::partitionEventsLocked(size_t count) {
+    for (auto& [handle, indices] : mEventIndicesByHandle) {
+        indices.clear();
+    }
+    for (auto& [connection, indices] : mEventIndicesByConnection) {
+        indices.clear();
+    }
+    mConnectionsWithWakeUpEvents.clear();
+
+    for (size_t i = 0; i < count; i++) {
+        const sensors_event_t& event = mSensorEventBuffer[i];
+        // Flush complete events belong to the sensor in meta_data.sensor.
+        const int handle =
+                event.type == SENSOR_TYPE_META_DATA ? event.meta_data.sensor : event.sensor;
+        mEventIndicesByHandle[handle].push_back(i);
+    }
+
+    for (const auto& [handle, handleIndices] : mEventIndicesByHandle) {
+        if (handleIndices.empty()) {
+            continue;
+        }
+        auto subscribers = mSensorSubscribers.find(handle);
+        if (subscribers == mSensorSubscribers.end()) {
+            continue;
+        }
+        // All the events of a handle come from the same sensor.
+        const bool isWakeUp = isWakeUpSensorEvent(mSensorEventBuffer[handleIndices.front()]);
+        for (const wp<SensorEventConnection>& subscriber : subscribers->second) {
+            // The pointer is only used as a key, it is never dereferenced.
+            if (isWakeUp) {
+                mConnectionsWithWakeUpEvents.insert(subscriber.unsafe_get());
+            }
+            std::vector<size_t>& indices = mEventIndicesByConnection[subscriber.unsafe_get()];
+            const size_t previousSize = indices.size();
+            indices.insert(indices.end(), handleIndices.begin(), handleIndices.end());
+            // Keep the events of connections with several sensors in the batch order.
+            if (previousSize > 0) {
+                std::inplace_merge(indices.begin(), indices.begin() + previousSize,
+                                   indices.end());
+            }
+        }
+    }
+}
+
+void SensorService::addSensorSubscriberLocked(int handle,
+                                              const sp<SensorEventConnection>& connection) {
+    mSensorSubscribers[handle].push_back(connection);
+}
+
+void SensorService::removeSensorSubscriberLocked(int handle,
+                                                 const SensorEventConnection* connection) {
+    auto subscribers = mSensorSubscribers.find(handle);
+    if (subscribers == mSensorSubscribers.end()) {
+        return;
+    }
+    auto& connections = subscribers->second;
+    connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                     [connection](const wp<SensorEventConnection>& subscriber) {
+                                         return subscriber.unsafe_get() == connection;
+                                     }),
+                      connections.end());
+    if (subscribers->second.empty()) {
+        mSensorSubscribers.erase(subscribers);
+    }
+}
+
 sp<Looper> SensorService::getLooper() const {
     return mLooper;
 }
@@ -1266,20 +1396,75 @@ void SensorService::resetAllWakeLockRefCounts() {
 }
 
 void SensorService::setWakeLockAcquiredLocked(bool acquire) {
+    mWakeLockReleaseTimeNs = 0;
     if (acquire) {
         if (!mWakeLockAcquired) {
             acquire_wake_lock(PARTIAL_WAKE_LOCK, WAKE_LOCK_NAME);
             mWakeLockAcquired = true;
+            noteWakeLockToggleLocked();
         }
         mLooper->wake();
     } else {
         if (mWakeLockAcquired) {
             release_wake_lock(WAKE_LOCK_NAME);
             mWakeLockAcquired = false;
+            noteWakeLockToggleLocked();
         }
     }
 }
 
+void SensorService::requestWakeLockReleaseLocked() {
+    if (!mWakeLockAcquired || mWakeLockReleaseTimeNs != 0) {
+        return;
+    }
+    mWakeLockReleaseTimeNs = systemTime(SYSTEM_TIME_MONOTONIC) + WAKE_LOCK_RELEASE_DELAY_NS;
+    // Let SensorEventAckReceiver pick up the new timeout.
+    mLooper->wake();
+}
+
+int SensorService::getWakeLockTimeoutMs(bool* releasePending) {
+    Mutex::Autolock _l(mLock);
+    *releasePending = mWakeLockReleaseTimeNs != 0;
+    if (*releasePending) {
+        return toMillisecondTimeoutDelay(systemTime(SYSTEM_TIME_MONOTONIC),
+                                         mWakeLockReleaseTimeNs);
+    }
+    return mWakeLockAcquired ? 5000 : -1;
+}
+
+void SensorService::releaseWakeLockIfDue() {
+    ConnectionSafeAutolock connLock = mConnectionHolder.lock(mLock);
+    if (mWakeLockReleaseTimeNs == 0 ||
+        systemTime(SYSTEM_TIME_MONOTONIC) < mWakeLockReleaseTimeNs) {
+        return;
+    }
+    mWakeLockReleaseTimeNs = 0;
+    for (const sp<SensorEventConnection>& connection : connLock.getActiveConnections()) {
+        if (connection->needsWakeLock()) {
+            // Events were sent since the release was requested, the next acknowledgement will
+            // request it again.
+            return;
+        }
+    }
+    setWakeLockAcquiredLocked(false);
+}
+
+void SensorService::noteWakeLockToggleLocked() {
+    const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    const nsecs_t minuteNs = 60 * 1000000000LL;
+    WakeLockStats& stats = mWakeLockStats;
+    const nsecs_t windowAgeNs = now - stats.windowStartNs;
+    if (windowAgeNs >= minuteNs) {
+        // Only report the previous window if it was the last minute.
+        stats.lastMinuteToggles = windowAgeNs < 2 * minuteNs ? stats.windowToggles : 0;
+        stats.windowStartNs = now;
+        stats.windowToggles = 0;
+    }
+    stats.toggles++;
+    stats.windowToggles++;
+    stats.maxTogglesPerMinute = std::max(stats.maxTogglesPerMinute, stats.windowToggles);
+}
+
 bool SensorService::isWakeLockAcquired() {
     Mutex::Autolock _l(mLock);
     return mWakeLockAcquired;
@@ -1289,11 +1474,12 @@ bool SensorService::SensorEventAckReceiver::threadLoop() {
     ALOGD("new thread SensorEventAckReceiver");
     sp<Looper> looper = mService->getLooper();
     do {
-        bool wakeLockAcquired = mService->isWakeLockAcquired();
-        int timeout = -1;
-        if (wakeLockAcquired) timeout = 5000;
+        bool releasePending = false;
+        int timeout = mService->getWakeLockTimeoutMs(&releasePending);
         int ret = looper->pollOnce(timeout);
-        if (ret == ALOOPER_POLL_TIMEOUT) {
+        if (releasePending) {
+            mService->releaseWakeLockIfDue();
+        } else if (ret == ALOOPER_POLL_TIMEOUT) {
            mService->resetAllWakeLockRefCounts();
         }
     } while(!Thread::exitPending());
@@ -1786,6 +1972,7 @@ void SensorService::cleanupConnection(SensorEventConnection* c) {
             if (c->removeSensor(handle)) {
                 BatteryService::disableSensor(c->getUid(), handle);
             }
+            removeSensorSubscriberLocked(handle, c);
         }
         SensorRecord* rec = mActiveSensors.valueAt(i);
         ALOGE_IF(!rec, "mActiveSensors[%zu] is null (handle=0x%08x)!", i, handle);
@@ -1805,6 +1992,7 @@ void SensorService::cleanupConnection(SensorEventConnection* c) {
     }
     c->updateLooperRegistration(mLooper);
     mConnectionHolder.removeEventConnection(connection);
+    mEventIndicesByConnection.erase(c);
     if (c->needsWakeLock()) {
         checkWakeLockStateLocked(&connLock);
     }
@@ -1992,6 +2180,7 @@ status_t SensorService::enable(const sp<SensorEventConnection>& connection,
 
     if (connection->addSensor(handle)) {
         BatteryService::enableSensor(connection->getUid(), handle);
+        addSensorSubscriberLocked(handle, connection);
         // the sensor was added (which means it wasn't already there)
         // so, see if this connection becomes active
         mConnectionHolder.addEventConnectionIfNotPresent(connection);
@@ -2096,9 +2285,11 @@ status_t SensorService::cleanupWithoutDisableLocked(
         if (connection->removeSensor(handle)) {
             BatteryService::disableSensor(connection->getUid(), handle);
         }
+        removeSensorSubscriberLocked(handle, connection.get());
         if (connection->hasAnySensor() == false) {
             connection->updateLooperRegistration(mLooper);
             mConnectionHolder.removeEventConnection(connection);
+            mEventIndicesByConnection.erase(connection.get());
         }
         // see if this sensor becomes inactive
         if (rec->removeConnection(connection)) {
@@ -2209,7 +2400,7 @@ bool SensorService::canAccessSensor(const Sensor& sensor, const char* operation,
     } else if (hasPermissionForSensor(sensor)) {
         // Ensure that the AppOp is allowed, or that there is no necessary app op for the sensor
         if (opCode >= 0) {
-            const int32_t appOpMode = sAppOpsManager.checkOp(opCode,
+            const int32_t appOpMode = sAppOpsManager.checkOpCached(opCode,
                     IPCThreadState::self()->getCallingUid(), opPackageName);
             canAccess = (appOpMode == AppOpsManager::MODE_ALLOWED);
         } else {
@@ -2386,7 +2577,7 @@ void SensorService::checkWakeLockStateLocked(ConnectionSafeAutolock* connLock) {
         }
     }
     if (releaseLock) {
-        setWakeLockAcquiredLocked(false);
+        requestWakeLockReleaseLocked();
     }
 }
 
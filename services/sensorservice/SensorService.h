@@ -361,6 +361,9 @@ private:
     };
 
     static const char* WAKE_LOCK_NAME;
+    // How long the wakelock is kept after the last wake up event was acknowledged, so that
+    // back to back batches of wake up events don't acquire and release it for each batch.
+    static constexpr nsecs_t WAKE_LOCK_RELEASE_DELAY_NS = 100 * 1000000LL;
     virtual ~SensorService();
 
     virtual void onFirstRef();
@@ -401,6 +404,12 @@ private:
     status_t cleanupWithoutDisableLocked(const sp<SensorEventConnection>& connection, int handle);
     void cleanupAutoDisabledSensorLocked(const sp<SensorEventConnection>& connection,
             sensors_event_t const* buffer, const int count);
+    // Keep mSensorSubscribers in sync with the sensors registered by each SensorEventConnection.
+    void addSensorSubscriberLocked(int handle, const sp<SensorEventConnection>& connection);
+    void removeSensorSubscriberLocked(int handle, const SensorEventConnection* connection);
+    // Split the first count events of mSensorEventBuffer by sensor handle, and gather the indices
+    // of the events each subscriber should receive in mEventIndicesByConnection.
+    void partitionEventsLocked(size_t count);
     bool canAccessSensor(const Sensor& sensor, const char* operation,
             const String16& opPackageName);
     void addSensorIfAccessible(const String16& opPackageName, const Sensor& sensor,
@@ -430,6 +439,15 @@ private:
     // seconds and wake the looper.
     void setWakeLockAcquiredLocked(bool acquire);
 
+    // Release the wakelock after WAKE_LOCK_RELEASE_DELAY_NS, unless new wake up events are sent in
+    // the meantime. SensorEventAckReceiver does the release.
+    void requestWakeLockReleaseLocked();
+    // Timeout for SensorEventAckReceiver's poll. releasePending is set if the timeout is the time
+    // of a pending release rather than the acknowledgement timeout.
+    int getWakeLockTimeoutMs(bool* releasePending);
+    void releaseWakeLockIfDue();
+    void noteWakeLockToggleLocked();
+
     // Send events from the event cache for this particular connection.
     void sendEventsFromCache(const sp<SensorEventConnection>& connection);
 
@@ -517,12 +535,42 @@ private:
     mutable Mutex mLock;
     DefaultKeyedVector<int, SensorRecord*> mActiveSensors;
     std::unordered_set<int> mActiveVirtualSensors;
+    // Interfaces of mActiveVirtualSensors, looked up once per batch of events.
+    std::vector<std::shared_ptr<SensorInterface>> mActiveVirtualSensorInterfaces;
     SensorConnectionHolder mConnectionHolder;
     bool mWakeLockAcquired;
+    // Time at which the wakelock is released, 0 if no release is pending.
+    nsecs_t mWakeLockReleaseTimeNs;
+    // Number of times the wakelock was acquired or released, reported by dump to make power
+    // regressions visible.
+    struct WakeLockStats {
+        uint64_t toggles = 0;
+        nsecs_t windowStartNs = 0;
+        uint32_t windowToggles = 0;
+        uint32_t lastMinuteToggles = 0;
+        uint32_t maxTogglesPerMinute = 0;
+    } mWakeLockStats;
     sensors_event_t *mSensorEventBuffer, *mSensorEventScratch;
     // WARNING: these SensorEventConnection instances must not be promoted to sp, except via
     // modification to add support for them in ConnectionSafeAutolock
     wp<const SensorEventConnection> * mMapFlushEventsToConnections;
+    // The SensorEventConnections that registered each sensor handle. This may briefly include
+    // connections that no longer have the sensor, SensorEventConnection::sendEvents filters them.
+    std::unordered_map<int, std::vector<wp<SensorEventConnection>>> mSensorSubscribers;
+    // Indices of the events of the current poll batch, by sensor handle and by subscriber. The
+    // vectors are cleared, not released, between batches to avoid reallocating them.
+    std::unordered_map<int, std::vector<size_t>> mEventIndicesByHandle;
+    std::unordered_map<const SensorEventConnection*, std::vector<size_t>>
+            mEventIndicesByConnection;
+    // Subscribers that have events from wake up sensors in the current poll batch.
+    std::unordered_set<const SensorEventConnection*> mConnectionsWithWakeUpEvents;
+    // Time spent by threadLoop() sending each batch to the active connections.
+    struct FanOutStats {
+        nsecs_t lastNs = 0;
+        nsecs_t maxNs = 0;
+        nsecs_t totalNs = 0;
+        uint64_t count = 0;
+    } mFanOutStats;
     std::unordered_map<int, SensorServiceUtil::RecentEventLogger*> mRecentEvent;
     Mode mCurrentOperatingMode;
     std::queue<sensors_event_t> mRuntimeSensorEventQueue;
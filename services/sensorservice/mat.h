@@ -17,6 +17,12 @@
 #ifndef ANDROID_MAT_H
 #define ANDROID_MAT_H
 
+#include <type_traits>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "vec.h"
 #include "traits.h"
 
@@ -29,6 +35,48 @@ class mat;
 
 namespace helpers {
 
+#if defined(__ARM_NEON)
+// Fixed-size kernels for the float matrices used by the sensor fusion. The
+// matrices are densely packed in column-major order, so they work directly on
+// the columns; the caller guarantees that res doesn't alias lhs or rhs.
+
+// res = lhs * rhs, 3x3
+inline void mul33(float* res, const float* lhs, const float* rhs) {
+    const float32x4_t l0 = vld1q_f32(lhs);
+    const float32x4_t l1 = vld1q_f32(lhs + 3);
+    // don't read past the end of lhs
+    const float32x4_t l2 = vcombine_f32(vld1_f32(lhs + 6),
+            vld1_lane_f32(lhs + 8, vdup_n_f32(0), 0));
+    float32x4_t c[3];
+    for (size_t i=0 ; i<3 ; i++) {
+        c[i] = vmulq_n_f32(l0, rhs[i*3]);
+        c[i] = vmlaq_n_f32(c[i], l1, rhs[i*3 + 1]);
+        c[i] = vmlaq_n_f32(c[i], l2, rhs[i*3 + 2]);
+    }
+    // the 4th lane of each column is overwritten by the next store
+    vst1q_f32(res, c[0]);
+    vst1q_f32(res + 3, c[1]);
+    vst1_f32(res + 6, vget_low_f32(c[2]));
+    vst1q_lane_f32(res + 8, c[2], 2);
+}
+
+// res = lhs * rhs, where rhs has C columns of 4
+template <size_t C>
+inline void mul4x(float* res, const float* lhs, const float* rhs) {
+    const float32x4_t l0 = vld1q_f32(lhs);
+    const float32x4_t l1 = vld1q_f32(lhs + 4);
+    const float32x4_t l2 = vld1q_f32(lhs + 8);
+    const float32x4_t l3 = vld1q_f32(lhs + 12);
+    for (size_t i=0 ; i<C ; i++) {
+        float32x4_t c = vmulq_n_f32(l0, rhs[i*4]);
+        c = vmlaq_n_f32(c, l1, rhs[i*4 + 1]);
+        c = vmlaq_n_f32(c, l2, rhs[i*4 + 2]);
+        c = vmlaq_n_f32(c, l3, rhs[i*4 + 3]);
+        vst1q_f32(res + i*4, c);
+    }
+}
+#endif
+
 template <typename TYPE, size_t C, size_t R>
 mat<TYPE, C, R>& doAssign(
         mat<TYPE, C, R>& lhs,
@@ -45,6 +93,15 @@ mat<TYPE, C, R> PURE doMul(
         const mat<TYPE, C, D>& rhs)
 {
     mat<TYPE, C, R> res;
+#if defined(__ARM_NEON)
+    if constexpr (std::is_same<TYPE, float>::value && C == 3 && R == 3 && D == 3) {
+        mul33(&res[0][0], &lhs[0][0], &rhs[0][0]);
+        return res;
+    } else if constexpr (std::is_same<TYPE, float>::value && C == 4 && R == 4 && D == 4) {
+        mul4x<4>(&res[0][0], &lhs[0][0], &rhs[0][0]);
+        return res;
+    }
+#endif
     for (size_t c=0 ; c<C ; c++) {
         for (size_t r=0 ; r<R ; r++) {
             TYPE v(0);
@@ -63,6 +120,12 @@ vec<TYPE, R> PURE doMul(
         const vec<TYPE, D>& rhs)
 {
     vec<TYPE, R> res;
+#if defined(__ARM_NEON)
+    if constexpr (std::is_same<TYPE, float>::value && R == 4 && D == 4) {
+        mul4x<1>(&res[0], &lhs[0][0], &rhs[0]);
+        return res;
+    }
+#endif
     for (size_t r=0 ; r<R ; r++) {
         TYPE v(0);
         for (size_t k=0 ; k<D ; k++) {
@@ -335,6 +398,23 @@ mat<TYPE, SIZE, 1> PURE transpose(const VEC<TYPE, SIZE>& v) {
 // "dumb" matrix inversion
 template<typename T, size_t N>
 mat<T, N, N> PURE invert(const mat<T, N, N>& src) {
+    if constexpr (N == 3) {
+        // closed form, this is the innovation covariance inverse of the fusion
+        const mat<T, N, N>& m(src);
+        mat<T, N, N> inverse;
+        inverse[0][0] = m[1][1]*m[2][2] - m[2][1]*m[1][2];
+        inverse[0][1] = m[2][1]*m[0][2] - m[0][1]*m[2][2];
+        inverse[0][2] = m[0][1]*m[1][2] - m[1][1]*m[0][2];
+        inverse[1][0] = m[2][0]*m[1][2] - m[1][0]*m[2][2];
+        inverse[1][1] = m[0][0]*m[2][2] - m[2][0]*m[0][2];
+        inverse[1][2] = m[1][0]*m[0][2] - m[0][0]*m[1][2];
+        inverse[2][0] = m[1][0]*m[2][1] - m[2][0]*m[1][1];
+        inverse[2][1] = m[2][0]*m[0][1] - m[0][0]*m[2][1];
+        inverse[2][2] = m[0][0]*m[1][1] - m[1][0]*m[0][1];
+        const T det = m[0][0]*inverse[0][0] + m[1][0]*inverse[0][1] + m[2][0]*inverse[0][2];
+        return inverse * (1 / det);
+    }
+
     T t;
     size_t swap;
     mat<T, N, N> tmp(src);
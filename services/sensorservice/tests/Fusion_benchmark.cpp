@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <math.h>
+
+#include "../Fusion.h"
+
+namespace android {
+
+namespace {
+
+// 200Hz gyro with accelerometer and magnetometer updates at the same rate.
+constexpr float SAMPLE_PERIOD = 0.005f;
+
+mat33_t makeMatrix(float seed) {
+    mat33_t m;
+    for (size_t c = 0; c < 3; c++) {
+        for (size_t r = 0; r < 3; r++) {
+            m[c][r] = seed + c * 3 + r + (c == r ? 10.f : 0.f);
+        }
+    }
+    return m;
+}
+
+// The generic loops from mat.h, used as the baseline for the specialized kernels.
+template <typename TYPE, size_t C, size_t R, size_t D>
+mat<TYPE, C, R> referenceMul(const mat<TYPE, D, R>& lhs, const mat<TYPE, C, D>& rhs) {
+    mat<TYPE, C, R> res;
+    for (size_t c = 0; c < C; c++) {
+        for (size_t r = 0; r < R; r++) {
+            TYPE v(0);
+            for (size_t k = 0; k < D; k++) {
+                v += lhs[k][r] * rhs[c][k];
+            }
+            res[c][r] = v;
+        }
+    }
+    return res;
+}
+
+void feedSample(Fusion& fusion, size_t i) {
+    // Slowly rotate around a tilted axis so that predict() and update() do real work.
+    const float t = i * SAMPLE_PERIOD;
+    const vec3_t w(0.1f * sinf(t), 0.2f, 0.05f * cosf(t));
+    const vec3_t a(0.5f * sinf(t), 0.5f * cosf(t), 9.7f);
+    const vec3_t m(20.f, 5.f * sinf(t), -40.f);
+    fusion.handleGyro(w, SAMPLE_PERIOD);
+    fusion.handleAcc(a, SAMPLE_PERIOD);
+    fusion.handleMag(m);
+}
+
+} // namespace
+
+static void BM_fusionSample(benchmark::State& state) {
+    Fusion fusion;
+    fusion.init(static_cast<int>(state.range(0)));
+    size_t i = 0;
+    // Get past the initialization phase.
+    while (!fusion.hasEstimate()) {
+        feedSample(fusion, i++);
+    }
+
+    for (auto _ : state) {
+        feedSample(fusion, i++);
+        benchmark::DoNotOptimize(fusion.getAttitude());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_fusionSample)->Arg(FUSION_9AXIS)->Arg(FUSION_NOMAG)->Arg(FUSION_NOGYRO);
+
+static void BM_mul33Reference(benchmark::State& state) {
+    const mat33_t lhs(makeMatrix(1.f));
+    mat33_t rhs(makeMatrix(2.f));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(rhs = referenceMul(lhs, rhs) * 0.01f);
+    }
+}
+BENCHMARK(BM_mul33Reference);
+
+static void BM_mul33(benchmark::State& state) {
+    const mat33_t lhs(makeMatrix(1.f));
+    mat33_t rhs(makeMatrix(2.f));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(rhs = lhs * rhs * 0.01f);
+    }
+}
+BENCHMARK(BM_mul33);
+
+static void BM_covariancePropagation(benchmark::State& state) {
+    // P = Phi*P*transpose(Phi) on the 6x6 block covariance, as in Fusion::predict().
+    mat<mat33_t, 2, 2> Phi;
+    mat<mat33_t, 2, 2> P;
+    Phi[0][0] = makeMatrix(0.1f) * 0.01f;
+    Phi[1][0] = makeMatrix(0.2f) * 0.01f;
+    Phi[0][1] = 0;
+    Phi[1][1] = 1;
+    P = 1;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(P = Phi * P * transpose(Phi));
+    }
+}
+BENCHMARK(BM_covariancePropagation);
+
+static void BM_invert33(benchmark::State& state) {
+    const mat33_t m(makeMatrix(1.f));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(invert(m));
+    }
+}
+BENCHMARK(BM_invert33);
+
+} // namespace android
+
+BENCHMARK_MAIN();
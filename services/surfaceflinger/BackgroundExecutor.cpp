@@ -19,7 +19,10 @@
 #define LOG_TAG "BackgroundExecutor"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <android-base/stringprintf.h>
 #include <utils/Log.h>
+#include <algorithm>
+#include <cinttypes>
 #include <mutex>
 
 #include "BackgroundExecutor.h"
@@ -31,47 +34,217 @@ ANDROID_SINGLETON_STATIC_INSTANCE(BackgroundExecutor);
 BackgroundExecutor::BackgroundExecutor() : Singleton<BackgroundExecutor>() {
     // mSemaphore must be initialized before any calls to
     // BackgroundExecutor::sendCallbacks. For this reason, we initialize it
-    // within the constructor instead of within mThread.
+    // within the constructor instead of within the worker threads.
     LOG_ALWAYS_FATAL_IF(sem_init(&mSemaphore, 0, 0), "sem_init failed");
-    mThread = std::thread([&]() {
-        while (!mDone) {
-            LOG_ALWAYS_FATAL_IF(sem_wait(&mSemaphore), "sem_wait failed (%d)", errno);
-            auto callbacks = mCallbacksQueue.pop();
-            if (!callbacks) {
-                continue;
-            }
-            for (auto& callback : *callbacks) {
-                callback();
-            }
-        }
-    });
+    for (size_t i = 0; i < kWorkerCount; i++) {
+        mWorkers[i].thread = std::thread([this, i]() { loop(i); });
+    }
 }
 
 BackgroundExecutor::~BackgroundExecutor() {
     mDone = true;
-    LOG_ALWAYS_FATAL_IF(sem_post(&mSemaphore), "sem_post failed");
-    if (mThread.joinable()) {
-        mThread.join();
+    for (size_t i = 0; i < kWorkerCount; i++) {
+        LOG_ALWAYS_FATAL_IF(sem_post(&mSemaphore), "sem_post failed");
+    }
+    bool joined = false;
+    for (Worker& worker : mWorkers) {
+        if (worker.thread.joinable()) {
+            worker.thread.join();
+            joined = true;
+        }
+    }
+    if (joined) {
         LOG_ALWAYS_FATAL_IF(sem_destroy(&mSemaphore), "sem_destroy failed");
     }
 }
 
-void BackgroundExecutor::sendCallbacks(Callbacks&& tasks) {
-    mCallbacksQueue.push(std::move(tasks));
+void BackgroundExecutor::sendCallbacks(Callbacks&& tasks, Priority priority) {
+    if (tasks.empty()) {
+        return;
+    }
+    const nsecs_t now = systemTime();
+    {
+        std::scoped_lock lock{mStatsMutex};
+        mStats[ftl::to_underlying(priority)].pending += tasks.size();
+    }
+
+    Strand& strand = mStrands[ftl::to_underlying(priority)];
+    bool schedule;
+    {
+        std::scoped_lock lock{strand.mutex};
+        for (auto& task : tasks) {
+            strand.callbacks.push_back({std::move(task), now});
+        }
+        schedule = !std::exchange(strand.scheduled, true);
+    }
+    if (schedule) {
+        push({nullptr, now}, priority);
+    }
+}
+
+void BackgroundExecutor::sendUnorderedCallbacks(Callbacks&& tasks, Priority priority) {
+    if (tasks.empty()) {
+        return;
+    }
+    const nsecs_t now = systemTime();
+    {
+        std::scoped_lock lock{mStatsMutex};
+        mStats[ftl::to_underlying(priority)].pending += tasks.size();
+    }
+    {
+        std::scoped_lock lock{mUnorderedMutex};
+        mUnorderedPending += tasks.size();
+    }
+    for (auto& task : tasks) {
+        push({std::move(task), now}, priority);
+    }
+}
+
+void BackgroundExecutor::execute(std::function<void()> task) {
+    sendUnorderedCallbacks({std::move(task)}, Priority::LatencyCritical);
+}
+
+void BackgroundExecutor::push(Task task, Priority priority) {
+    Worker& worker = mWorkers[mNextWorker++ % kWorkerCount];
+    {
+        std::scoped_lock lock{worker.mutex};
+        worker.queues[ftl::to_underlying(priority)].push_back(std::move(task));
+    }
+    LOG_ALWAYS_FATAL_IF(sem_post(&mSemaphore), "sem_post failed");
+}
+
+void BackgroundExecutor::loop(size_t workerIndex) {
+    while (true) {
+        LOG_ALWAYS_FATAL_IF(sem_wait(&mSemaphore), "sem_wait failed (%d)", errno);
+        if (mDone) {
+            return;
+        }
+        auto [task, priority] = take(workerIndex);
+        if (!task.callback) {
+            runOrdered(workerIndex, priority);
+            continue;
+        }
+        run(task, priority);
+        std::scoped_lock lock{mUnorderedMutex};
+        if (--mUnorderedPending == 0) {
+            mUnorderedCondition.notify_all();
+        }
+    }
+}
+
+std::pair<BackgroundExecutor::Task, BackgroundExecutor::Priority> BackgroundExecutor::take(
+        size_t workerIndex) {
+    // Each post of the semaphore accounts for one task, so one is queued for this worker to take,
+    // though possibly not yet visible to it if another worker took the one it was about to see.
+    while (true) {
+        for (Priority priority : ftl::enum_range<Priority>()) {
+            // The worker's own queue first, oldest task first. Then steal the newest task of the
+            // other workers, which is the least likely to be taken by its owner soon.
+            for (size_t i = 0; i < kWorkerCount; i++) {
+                Worker& worker = mWorkers[(workerIndex + i) % kWorkerCount];
+                std::scoped_lock lock{worker.mutex};
+                auto& queue = worker.queues[ftl::to_underlying(priority)];
+                if (queue.empty()) {
+                    continue;
+                }
+                Task task;
+                if (i == 0) {
+                    task = std::move(queue.front());
+                    queue.pop_front();
+                } else {
+                    task = std::move(queue.back());
+                    queue.pop_back();
+                }
+                return {std::move(task), priority};
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void BackgroundExecutor::runOrdered(size_t workerIndex, Priority priority) {
+    Strand& strand = mStrands[ftl::to_underlying(priority)];
+    Task task;
+    {
+        std::scoped_lock lock{strand.mutex};
+        task = std::move(strand.callbacks.front());
+        strand.callbacks.pop_front();
+    }
+    run(task, priority);
+
+    // Run one callback at a time, so that pending latency-critical callbacks are picked before the
+    // rest of the bulk ones.
+    {
+        std::scoped_lock lock{strand.mutex};
+        if (strand.callbacks.empty()) {
+            strand.scheduled = false;
+            return;
+        }
+    }
+    Worker& worker = mWorkers[workerIndex];
+    {
+        std::scoped_lock lock{worker.mutex};
+        worker.queues[ftl::to_underlying(priority)].push_front({nullptr, systemTime()});
+    }
     LOG_ALWAYS_FATAL_IF(sem_post(&mSemaphore), "sem_post failed");
 }
 
+void BackgroundExecutor::run(Task& task, Priority priority) {
+    const nsecs_t startTime = systemTime();
+    task.callback();
+    // Release what the callback captured before it is accounted for as done.
+    task.callback = nullptr;
+    const nsecs_t endTime = systemTime();
+
+    const nsecs_t waitTime = startTime - task.queueTime;
+    const nsecs_t runTime = endTime - startTime;
+    std::scoped_lock lock{mStatsMutex};
+    Stats& stats = mStats[ftl::to_underlying(priority)];
+    stats.pending--;
+    stats.count++;
+    stats.totalWaitTime += waitTime;
+    stats.maxWaitTime = std::max(stats.maxWaitTime, waitTime);
+    stats.totalRunTime += runTime;
+    stats.maxRunTime = std::max(stats.maxRunTime, runTime);
+}
+
 void BackgroundExecutor::flushQueue() {
     std::mutex mutex;
     std::condition_variable cv;
-    bool flushComplete = false;
-    sendCallbacks({[&]() {
-        std::scoped_lock lock{mutex};
-        flushComplete = true;
-        cv.notify_one();
-    }});
-    std::unique_lock<std::mutex> lock{mutex};
-    cv.wait(lock, [&]() { return flushComplete; });
+    size_t remaining = kPriorityCount;
+    for (Priority priority : ftl::enum_range<Priority>()) {
+        sendCallbacks({[&]() {
+                          std::scoped_lock lock{mutex};
+                          if (--remaining == 0) {
+                              cv.notify_one();
+                          }
+                      }},
+                      priority);
+    }
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        cv.wait(lock, [&]() { return remaining == 0; });
+    }
+    std::unique_lock<std::mutex> lock{mUnorderedMutex};
+    mUnorderedCondition.wait(lock, [this]() REQUIRES(mUnorderedMutex) {
+        return mUnorderedPending == 0;
+    });
+}
+
+void BackgroundExecutor::dump(std::string& result) const {
+    using base::StringAppendF;
+    StringAppendF(&result, "BackgroundExecutor: %zu workers\n", kWorkerCount);
+    std::scoped_lock lock{mStatsMutex};
+    for (Priority priority : ftl::enum_range<Priority>()) {
+        const Stats& stats = mStats[ftl::to_underlying(priority)];
+        const uint64_t count = std::max<uint64_t>(stats.count, 1);
+        StringAppendF(&result,
+                      "  %s: pending=%zu ran=%" PRIu64 " wait(avg/max)=%" PRId64 "/%" PRId64
+                      "us run(avg/max)=%" PRId64 "/%" PRId64 "us\n",
+                      ftl::enum_string(priority).c_str(), stats.pending, stats.count,
+                      ns2us(stats.totalWaitTime / count), ns2us(stats.maxWaitTime),
+                      ns2us(stats.totalRunTime / count), ns2us(stats.maxRunTime));
+    }
 }
 
 } // namespace android
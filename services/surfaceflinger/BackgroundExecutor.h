@@ -16,32 +16,105 @@
 
 #pragma once
 
+#include <android-base/thread_annotations.h>
+#include <ftl/enum.h>
+#include <ftl/executor.h>
 #include <ftl/small_vector.h>
 #include <semaphore.h>
 #include <utils/Singleton.h>
+#include <utils/Timers.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
 #include <thread>
 
-#include "LocklessQueue.h"
-
 namespace android {
 
-// Executes tasks off the main thread.
-class BackgroundExecutor : public Singleton<BackgroundExecutor> {
+// Executes tasks off the main thread, on a small pool of worker threads. Each worker has its own
+// queues, and steals from the other workers when those are empty.
+//
+// Callbacks are either ordered or unordered. Ordered callbacks of a given priority run one at a
+// time, in the order that they were queued, so they may share state without locking. Unordered
+// callbacks may run concurrently with any other. Workers pick latency-critical callbacks before bulk
+// ones, so a slow bulk callback only holds up the worker that runs it.
+class BackgroundExecutor : public Singleton<BackgroundExecutor>, public ftl::Executor {
 public:
+    enum class Priority { LatencyCritical, Bulk, ftl_last = Bulk };
+
     BackgroundExecutor();
     ~BackgroundExecutor();
     using Callbacks = ftl::SmallVector<std::function<void()>, 10>;
-    // Queues callbacks onto a work queue to be executed by a background thread.
+    // Queues callbacks onto a work queue to be executed by a background thread, after the ordered
+    // callbacks of the same priority that were queued before them.
     // This is safe to call from multiple threads.
-    void sendCallbacks(Callbacks&& tasks);
+    void sendCallbacks(Callbacks&& tasks, Priority priority = Priority::LatencyCritical);
+    // Queues callbacks that may run in any order, and concurrently with any other callbacks.
+    void sendUnorderedCallbacks(Callbacks&& tasks, Priority priority = Priority::Bulk);
+    // Blocks until the callbacks queued before the call have run, as well as unordered callbacks
+    // queued meanwhile.
     void flushQueue();
 
+    // ftl::Executor, so that ftl::AsyncFuture continuations can be scheduled in the background.
+    // Continuations are unordered and latency-critical.
+    void execute(std::function<void()> task) override;
+
+    void dump(std::string& result) const;
+
 private:
+    static constexpr size_t kWorkerCount = 2;
+    static constexpr size_t kPriorityCount = ftl::enum_size_v<Priority>;
+
+    struct Task {
+        // Empty for the task that runs the next ordered callback.
+        std::function<void()> callback;
+        nsecs_t queueTime;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::array<std::deque<Task>, kPriorityCount> queues GUARDED_BY(mutex);
+        std::thread thread;
+    };
+
+    // The ordered callbacks of a priority. At most one task to run them is queued or running.
+    struct Strand {
+        std::mutex mutex;
+        std::deque<Task> callbacks GUARDED_BY(mutex);
+        bool scheduled GUARDED_BY(mutex) = false;
+    };
+
+    struct Stats {
+        // Callbacks queued or running.
+        size_t pending = 0;
+        uint64_t count = 0;
+        nsecs_t totalWaitTime = 0;
+        nsecs_t maxWaitTime = 0;
+        nsecs_t totalRunTime = 0;
+        nsecs_t maxRunTime = 0;
+    };
+
+    void push(Task task, Priority priority);
+    void loop(size_t workerIndex);
+    std::pair<Task, Priority> take(size_t workerIndex);
+    void runOrdered(size_t workerIndex, Priority priority);
+    void run(Task& task, Priority priority);
+
     sem_t mSemaphore;
     std::atomic_bool mDone = false;
+    std::atomic_size_t mNextWorker = 0;
+
+    std::array<Worker, kWorkerCount> mWorkers;
+    std::array<Strand, kPriorityCount> mStrands;
+
+    std::mutex mUnorderedMutex;
+    std::condition_variable mUnorderedCondition;
+    size_t mUnorderedPending GUARDED_BY(mUnorderedMutex) = 0;
 
-    LocklessQueue<Callbacks> mCallbacksQueue;
-    std::thread mThread;
+    mutable std::mutex mStatsMutex;
+    std::array<Stats, kPriorityCount> mStats GUARDED_BY(mStatsMutex);
 };
 
 } // namespace android
@@ -19,6 +19,7 @@
 #define LOG_TAG "ClientCache"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <algorithm>
 #include <cinttypes>
 
 #include <android-base/stringprintf.h>
@@ -33,23 +34,51 @@ ANDROID_SINGLETON_STATIC_INSTANCE(ClientCache);
 
 ClientCache::ClientCache() : mDeathRecipient(sp<CacheDeathRecipient>::make()) {}
 
-bool ClientCache::getBuffer(const client_cache_t& cacheId,
-                            ClientCacheBuffer** outClientCacheBuffer) {
-    auto& [processToken, id] = cacheId;
-    if (processToken == nullptr) {
-        ALOGE_AND_TRACE("ClientCache::getBuffer - invalid (nullptr) process token");
-        return false;
+std::shared_ptr<ClientCache::ProcessCache> ClientCache::getProcessCache(
+        const wp<IBinder>& processToken) {
+    std::shared_lock lock(mProcessesMutex);
+    auto it = mProcesses.find(processToken);
+    return it == mProcesses.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<ClientCache::ProcessCache> ClientCache::getOrAddProcessCache(
+        const wp<IBinder>& processToken) {
+    if (auto cache = getProcessCache(processToken)) {
+        return cache;
     }
-    auto it = mBuffers.find(processToken);
-    if (it == mBuffers.end()) {
-        ALOGE_AND_TRACE("ClientCache::getBuffer - invalid process token");
-        return false;
+
+    std::unique_lock lock(mProcessesMutex);
+    // Another thread may have added the process meanwhile.
+    if (auto it = mProcesses.find(processToken); it != mProcesses.end()) {
+        return it->second;
+    }
+
+    // If this is a new process token, set a death recipient. If the client process dies, we will
+    // get a callback through binderDied.
+    sp<IBinder> token = processToken.promote();
+    if (!token) {
+        ALOGE_AND_TRACE("ClientCache::add - invalid token");
+        return nullptr;
     }
 
-    auto& processBuffers = it->second.second;
+    // Only call linkToDeath if not a local binder
+    if (token->localBinder() == nullptr) {
+        status_t err = token->linkToDeath(mDeathRecipient);
+        if (err != NO_ERROR) {
+            ALOGE_AND_TRACE("ClientCache::add - could not link to death");
+            return nullptr;
+        }
+    }
+    auto [it, success] =
+            mProcesses.emplace(processToken, std::make_shared<ProcessCache>(std::move(token)));
+    LOG_ALWAYS_FATAL_IF(!success, "failed to insert new process into client cache");
+    return it->second;
+}
 
-    auto bufItr = processBuffers.find(id);
-    if (bufItr == processBuffers.end()) {
+bool ClientCache::getBuffer(ProcessCache& cache, uint64_t id,
+                            ClientCacheBuffer** outClientCacheBuffer) {
+    auto bufItr = cache.buffers.find(id);
+    if (bufItr == cache.buffers.end()) {
         ALOGE_AND_TRACE("ClientCache::getBuffer - invalid buffer id");
         return false;
     }
@@ -72,38 +101,18 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
         return base::unexpected(AddError::Unspecified);
     }
 
-    std::lock_guard lock(mMutex);
-    sp<IBinder> token;
-
-    // If this is a new process token, set a death recipient. If the client process dies, we will
-    // get a callback through binderDied.
-    auto it = mBuffers.find(processToken);
-    if (it == mBuffers.end()) {
-        token = processToken.promote();
-        if (!token) {
-            ALOGE_AND_TRACE("ClientCache::add - invalid token");
-            return base::unexpected(AddError::Unspecified);
-        }
-
-        // Only call linkToDeath if not a local binder
-        if (token->localBinder() == nullptr) {
-            status_t err = token->linkToDeath(mDeathRecipient);
-            if (err != NO_ERROR) {
-                ALOGE_AND_TRACE("ClientCache::add - could not link to death");
-                return base::unexpected(AddError::Unspecified);
-            }
-        }
-        auto [itr, success] =
-                mBuffers.emplace(processToken,
-                                 std::make_pair(token,
-                                                std::unordered_map<uint64_t, ClientCacheBuffer>()));
-        LOG_ALWAYS_FATAL_IF(!success, "failed to insert new process into client cache");
-        it = itr;
+    const auto cache = getOrAddProcessCache(processToken);
+    if (!cache) {
+        return base::unexpected(AddError::Unspecified);
     }
 
-    auto& processBuffers = it->second.second;
+    std::lock_guard lock(cache->mutex);
+    if (cache->removed) {
+        ALOGE_AND_TRACE("ClientCache::add - process was removed");
+        return base::unexpected(AddError::Unspecified);
+    }
 
-    if (processBuffers.size() > BUFFER_CACHE_MAX_SIZE) {
+    if (cache->buffers.size() > BUFFER_CACHE_MAX_SIZE) {
         ALOGE_AND_TRACE("ClientCache::add - cache is full");
         return base::unexpected(AddError::CacheFull);
     }
@@ -112,47 +121,92 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
                         "Attempted to build the ClientCache before a RenderEngine instance was "
                         "ready!");
 
-    return (processBuffers[id].buffer = std::make_shared<
+    return (cache->buffers[id].buffer = std::make_shared<
                     renderengine::impl::ExternalTexture>(buffer, *mRenderEngine,
                                                          renderengine::impl::ExternalTexture::
                                                                  Usage::READABLE));
 }
 
-sp<GraphicBuffer> ClientCache::erase(const client_cache_t& cacheId) {
-    sp<GraphicBuffer> buffer;
-    auto& [processToken, id] = cacheId;
-    std::vector<sp<ErasedRecipient>> pendingErase;
-    {
-        std::lock_guard lock(mMutex);
-        ClientCacheBuffer* buf = nullptr;
-        if (!getBuffer(cacheId, &buf)) {
-            ALOGE("failed to erase buffer, could not retrieve buffer");
-            return nullptr;
-        }
+sp<GraphicBuffer> ClientCache::eraseBuffer(ProcessCache& cache, const client_cache_t& cacheId,
+                                           PendingErase& pendingErase) {
+    ClientCacheBuffer* buf = nullptr;
+    if (!getBuffer(cache, cacheId.id, &buf)) {
+        ALOGE("failed to erase buffer, could not retrieve buffer");
+        return nullptr;
+    }
 
-        buffer = buf->buffer->getBuffer();
+    sp<GraphicBuffer> buffer = buf->buffer->getBuffer();
 
-        for (auto& recipient : buf->recipients) {
-            sp<ErasedRecipient> erasedRecipient = recipient.promote();
-            if (erasedRecipient) {
-                pendingErase.push_back(erasedRecipient);
-            }
+    for (auto& recipient : buf->recipients) {
+        sp<ErasedRecipient> erasedRecipient = recipient.promote();
+        if (erasedRecipient) {
+            pendingErase[erasedRecipient].push_back(cacheId);
         }
+    }
+
+    cache.buffers.erase(cacheId.id);
+    return buffer;
+}
 
-        mBuffers[processToken].second.erase(id);
+void ClientCache::notifyErased(const PendingErase& pendingErase) {
+    for (auto& [recipient, cacheIds] : pendingErase) {
+        if (cacheIds.size() == 1) {
+            recipient->bufferErased(cacheIds.front());
+        } else {
+            recipient->buffersErased(cacheIds);
+        }
     }
+}
+
+sp<GraphicBuffer> ClientCache::erase(const client_cache_t& cacheId) {
+    std::vector<sp<GraphicBuffer>> buffers = erase(std::vector<client_cache_t>{cacheId});
+    return buffers.empty() ? nullptr : std::move(buffers.front());
+}
+
+std::vector<sp<GraphicBuffer>> ClientCache::erase(const std::vector<client_cache_t>& cacheIds) {
+    std::vector<sp<GraphicBuffer>> buffers;
+    buffers.reserve(cacheIds.size());
+    PendingErase pendingErase;
+
+    // Transactions uncache the buffers of one process, so there is usually a single run.
+    auto it = cacheIds.begin();
+    while (it != cacheIds.end()) {
+        const wp<IBinder>& processToken = it->token;
+        const auto runEnd = std::find_if(it, cacheIds.end(), [&processToken](const auto& cacheId) {
+            return cacheId.token != processToken;
+        });
+
+        const auto cache = processToken == nullptr ? nullptr : getProcessCache(processToken);
+        if (!cache) {
+            ALOGE_AND_TRACE("ClientCache::erase - invalid process token");
+            it = runEnd;
+            continue;
+        }
 
-    for (auto& recipient : pendingErase) {
-        recipient->bufferErased(cacheId);
+        std::lock_guard lock(cache->mutex);
+        for (; it != runEnd; ++it) {
+            if (sp<GraphicBuffer> buffer = eraseBuffer(*cache, *it, pendingErase)) {
+                buffers.push_back(std::move(buffer));
+            }
+        }
     }
-    return buffer;
+
+    notifyErased(pendingErase);
+    return buffers;
 }
 
 std::shared_ptr<renderengine::ExternalTexture> ClientCache::get(const client_cache_t& cacheId) {
-    std::lock_guard lock(mMutex);
+    auto& [processToken, id] = cacheId;
+    const auto cache = processToken == nullptr ? nullptr : getProcessCache(processToken);
+    if (!cache) {
+        ALOGE("failed to get buffer, invalid process token");
+        return nullptr;
+    }
+
+    std::lock_guard lock(cache->mutex);
 
     ClientCacheBuffer* buf = nullptr;
-    if (!getBuffer(cacheId, &buf)) {
+    if (!getBuffer(*cache, id, &buf)) {
         ALOGE("failed to get buffer, could not retrieve buffer");
         return nullptr;
     }
@@ -162,10 +216,16 @@ std::shared_ptr<renderengine::ExternalTexture> ClientCache::get(const client_cac
 
 bool ClientCache::registerErasedRecipient(const client_cache_t& cacheId,
                                           const wp<ErasedRecipient>& recipient) {
-    std::lock_guard lock(mMutex);
+    const auto cache = cacheId.token == nullptr ? nullptr : getProcessCache(cacheId.token);
+    if (!cache) {
+        ALOGV("failed to register erased recipient, invalid process token");
+        return false;
+    }
+
+    std::lock_guard lock(cache->mutex);
 
     ClientCacheBuffer* buf = nullptr;
-    if (!getBuffer(cacheId, &buf)) {
+    if (!getBuffer(*cache, cacheId.id, &buf)) {
         ALOGV("failed to register erased recipient, could not retrieve buffer");
         return false;
     }
@@ -175,10 +235,16 @@ bool ClientCache::registerErasedRecipient(const client_cache_t& cacheId,
 
 void ClientCache::unregisterErasedRecipient(const client_cache_t& cacheId,
                                             const wp<ErasedRecipient>& recipient) {
-    std::lock_guard lock(mMutex);
+    const auto cache = cacheId.token == nullptr ? nullptr : getProcessCache(cacheId.token);
+    if (!cache) {
+        ALOGE("failed to unregister erased recipient, invalid process token");
+        return;
+    }
+
+    std::lock_guard lock(cache->mutex);
 
     ClientCacheBuffer* buf = nullptr;
-    if (!getBuffer(cacheId, &buf)) {
+    if (!getBuffer(*cache, cacheId.id, &buf)) {
         ALOGE("failed to unregister erased recipient");
         return;
     }
@@ -187,34 +253,40 @@ void ClientCache::unregisterErasedRecipient(const client_cache_t& cacheId,
 }
 
 void ClientCache::removeProcess(const wp<IBinder>& processToken) {
-    std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>> pendingErase;
+    if (processToken == nullptr) {
+        ALOGE("failed to remove process, invalid (nullptr) process token");
+        return;
+    }
+
+    std::shared_ptr<ProcessCache> cache;
     {
-        if (processToken == nullptr) {
-            ALOGE("failed to remove process, invalid (nullptr) process token");
-            return;
-        }
-        std::lock_guard lock(mMutex);
-        auto itr = mBuffers.find(processToken);
-        if (itr == mBuffers.end()) {
+        std::unique_lock lock(mProcessesMutex);
+        auto itr = mProcesses.find(processToken);
+        if (itr == mProcesses.end()) {
             ALOGE("failed to remove process, could not find process");
             return;
         }
+        cache = std::move(itr->second);
+        mProcesses.erase(itr);
+    }
 
-        for (auto& [id, clientCacheBuffer] : itr->second.second) {
+    PendingErase pendingErase;
+    {
+        std::lock_guard lock(cache->mutex);
+        cache->removed = true;
+        for (auto& [id, clientCacheBuffer] : cache->buffers) {
             client_cache_t cacheId = {processToken, id};
             for (auto& recipient : clientCacheBuffer.recipients) {
                 sp<ErasedRecipient> erasedRecipient = recipient.promote();
                 if (erasedRecipient) {
-                    pendingErase.emplace_back(erasedRecipient, cacheId);
+                    pendingErase[erasedRecipient].push_back(cacheId);
                 }
             }
         }
-        mBuffers.erase(itr);
+        cache->buffers.clear();
     }
 
-    for (auto& [recipient, cacheId] : pendingErase) {
-        recipient->bufferErased(cacheId);
-    }
+    notifyErased(pendingErase);
 }
 
 void ClientCache::CacheDeathRecipient::binderDied(const wp<IBinder>& who) {
@@ -222,11 +294,12 @@ void ClientCache::CacheDeathRecipient::binderDied(const wp<IBinder>& who) {
 }
 
 void ClientCache::dump(std::string& result) {
-    std::lock_guard lock(mMutex);
-    for (const auto& [_, cache] : mBuffers) {
-        base::StringAppendF(&result, " Cache owner: %p\n", cache.first.get());
+    std::shared_lock processesLock(mProcessesMutex);
+    for (const auto& [_, cache] : mProcesses) {
+        base::StringAppendF(&result, " Cache owner: %p\n", cache->token.get());
 
-        for (const auto& [id, entry] : cache.second) {
+        std::lock_guard lock(cache->mutex);
+        for (const auto& [id, entry] : cache->buffers) {
             const auto& buffer = entry.buffer->getBuffer();
             base::StringAppendF(&result, "\tID: %" PRIu64 ", size: %ux%u\n", id, buffer->getWidth(),
                                 buffer->getHeight());
@@ -25,9 +25,12 @@
 #include <utils/Singleton.h>
 
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <unordered_map>
+#include <vector>
 
 // 4096 is based on 64 buffers * 64 layers. Once this limit is reached, the least recently used
 // buffer is uncached before the new buffer is cached.
@@ -46,6 +49,9 @@ namespace android {
 // both the SurfaceFlinger side of this other cache, as well as Composer HAL's
 // side of the cache.
 //
+// Each process has its own table and lock, so that transactions from different processes do not
+// contend. The table of processes is only locked exclusively when a process is added or removed.
+//
 class ClientCache : public Singleton<ClientCache> {
 public:
     ClientCache();
@@ -57,6 +63,10 @@ public:
 
     sp<GraphicBuffer> erase(const client_cache_t& cacheId);
 
+    // Erases a batch of buffers, taking each process's lock once per run of its buffers, and
+    // notifies each recipient once for all of its buffers. Returns the erased buffers.
+    std::vector<sp<GraphicBuffer>> erase(const std::vector<client_cache_t>& cacheIds);
+
     std::shared_ptr<renderengine::ExternalTexture> get(const client_cache_t& cacheId);
 
     // Always called immediately after setup. Will be set to non-null, and then should never be
@@ -68,6 +78,13 @@ public:
     class ErasedRecipient : public virtual RefBase {
     public:
         virtual void bufferErased(const client_cache_t& clientCacheId) = 0;
+
+        // Called instead of bufferErased when buffers are erased in a batch.
+        virtual void buffersErased(const std::vector<client_cache_t>& clientCacheIds) {
+            for (const auto& clientCacheId : clientCacheIds) {
+                bufferErased(clientCacheId);
+            }
+        }
     };
 
     bool registerErasedRecipient(const client_cache_t& cacheId,
@@ -78,16 +95,29 @@ public:
     void dump(std::string& result);
 
 private:
-    std::mutex mMutex;
-
     struct ClientCacheBuffer {
         std::shared_ptr<renderengine::ExternalTexture> buffer;
         std::set<wp<ErasedRecipient>> recipients;
     };
-    std::map<wp<IBinder> /*caching process*/,
-             std::pair<sp<IBinder> /*strong ref to caching process*/,
-                       std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer>>>
-            mBuffers GUARDED_BY(mMutex);
+
+    // The buffers cached by one process.
+    struct ProcessCache {
+        explicit ProcessCache(sp<IBinder> token) : token(std::move(token)) {}
+
+        // Strong ref to the caching process.
+        const sp<IBinder> token;
+
+        std::mutex mutex;
+        std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer> buffers GUARDED_BY(mutex);
+        // Set once the process has been removed, for callers that looked it up before that.
+        bool removed GUARDED_BY(mutex) = false;
+    };
+
+    using PendingErase = std::map<sp<ErasedRecipient>, std::vector<client_cache_t>>;
+
+    std::shared_mutex mProcessesMutex;
+    std::map<wp<IBinder> /*caching process*/, std::shared_ptr<ProcessCache>> mProcesses
+            GUARDED_BY(mProcessesMutex);
 
     class CacheDeathRecipient : public IBinder::DeathRecipient {
     public:
@@ -97,8 +127,19 @@ private:
     sp<CacheDeathRecipient> mDeathRecipient;
     renderengine::RenderEngine* mRenderEngine = nullptr;
 
-    bool getBuffer(const client_cache_t& cacheId, ClientCacheBuffer** outClientCacheBuffer)
-            REQUIRES(mMutex);
+    std::shared_ptr<ProcessCache> getProcessCache(const wp<IBinder>& processToken);
+
+    // Returns the process's cache, after adding it if this is the first buffer it caches.
+    std::shared_ptr<ProcessCache> getOrAddProcessCache(const wp<IBinder>& processToken);
+
+    bool getBuffer(ProcessCache& cache, uint64_t id, ClientCacheBuffer** outClientCacheBuffer)
+            REQUIRES(cache.mutex);
+
+    // Erases a buffer, and returns it. Its live recipients are added to pendingErase.
+    sp<GraphicBuffer> eraseBuffer(ProcessCache& cache, const client_cache_t& cacheId,
+                                  PendingErase& pendingErase) REQUIRES(cache.mutex);
+
+    static void notifyErased(const PendingErase& pendingErase);
 };
 
 }; // namespace android
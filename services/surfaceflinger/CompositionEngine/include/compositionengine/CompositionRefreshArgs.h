@@ -29,6 +29,8 @@
 
 namespace android::compositionengine {
 
+class LayerStackVisibility;
+
 using Layers = std::vector<sp<compositionengine::LayerFE>>;
 using Outputs = std::vector<std::shared_ptr<compositionengine::Output>>;
 
@@ -107,6 +109,18 @@ struct CompositionRefreshArgs {
     bool hasTrustedPresentationListener = false;
 
     ICEPowerCallback* powerCallback = nullptr;
+
+    // If true, the outputs prepare their composition state in parallel before being presented
+    // one after another. This requires the HWC to accept commands for different displays from
+    // different threads.
+    bool parallelOutputComposition = false;
+
+    // Set by the CompositionEngine so that outputs which include the same layers share the layer
+    // stack space part of their visibility computation.
+    LayerStackVisibility* layerStackVisibility = nullptr;
+
+    // Set by the CompositionEngine once the outputs are prepared, before they are presented.
+    nsecs_t prepareEndTime{0};
 };
 
 } // namespace android::compositionengine
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+#include <compositionengine/LayerFE.h>
+#include <compositionengine/LayerFECompositionState.h>
+#include <compositionengine/Output.h>
+#include <ui/FloatRect.h>
+#include <ui/LayerStack.h>
+#include <ui/Region.h>
+#include <ui/Transform.h>
+
+namespace android::compositionengine {
+
+// Computes the visibility of layers in layer stack space, as the outputs evaluate them from front
+// to back. The regions of a layer only depend on its geometry and on the coverage of the layers
+// above it, so they are:
+//  - shared by the outputs that include the same layers, e.g. a display and the virtual displays
+//    mirroring or recording it, which then only derive their output space regions through their
+//    own projection.
+//  - reused across geometry updates while those inputs do not change. When a layer changes, the
+//    layers below it are recomputed until the coverage converges to what it was, e.g. below the
+//    layer that covers a cursor that moved, after which the remaining layers match again.
+//
+// Results are keyed by the layer filter of the output, so that outputs that include different
+// layers of the same layer stack do not evict each other's results.
+class LayerStackVisibility {
+public:
+    struct Layer {
+        // Inputs
+        ui::Transform layerTransform;
+        FloatRect layerBounds;
+        float shadowRadius = 0.f;
+        bool isOpaque = false;
+        Region transparentRegionHint;
+        bool computeAboveCoveredExcludingOverlays = false;
+        Region aboveCoveredLayers;
+        Region aboveOpaqueLayers;
+        Region aboveCoveredLayersExcludingOverlays;
+
+        // Results for the layer, which are only set if visibleRegion is not empty. See
+        // OutputLayerCompositionState for their meaning.
+        Region visibleRegion;
+        Region visibleNonTransparentRegion;
+        Region visibleNonShadowRegion;
+        Region coveredRegion;
+        Region transparentRegion;
+        Region shadowRegion;
+        std::optional<Region> coveredRegionExcludingDisplayOverlays;
+
+        // Coverage for the layers below.
+        Region aboveCoveredLayersBelow;
+        Region aboveOpaqueLayersBelow;
+        std::optional<Region> aboveCoveredLayersExcludingOverlaysBelow;
+
+        // The update in which the layer was last requested.
+        uint64_t update = 0;
+    };
+
+    struct Stats {
+        size_t recomputed = 0;
+        size_t reused = 0;
+    };
+
+    // Returns the visibility of a layer included by the filter, given the coverage of the layers
+    // above it, and counts whether it was recomputed into stats.
+    const Layer& getLayer(ui::LayerFilter, const LayerFE&, const LayerFECompositionState&,
+                          const Output::CoverageState&, bool computeAboveCoveredExcludingOverlays,
+                          Stats&);
+
+    // Forgets the layers that were not requested since the previous call, e.g. because they were
+    // removed. Called once all outputs have been evaluated for a geometry update.
+    void prune();
+
+    size_t getLayerCount() const { return mLayers.size(); }
+
+private:
+    struct LayerKey {
+        ui::LayerFilter filter;
+        int32_t sequence;
+
+        bool operator==(const LayerKey& other) const {
+            return filter.layerStack == other.filter.layerStack &&
+                    filter.toInternalDisplay == other.filter.toInternalDisplay &&
+                    sequence == other.sequence;
+        }
+    };
+
+    struct LayerKeyHash {
+        size_t operator()(const LayerKey& key) const {
+            const uint64_t value = static_cast<uint64_t>(key.filter.layerStack.id) << 32 |
+                    static_cast<uint32_t>(key.sequence);
+            return std::hash<uint64_t>{}(value) ^ static_cast<size_t>(key.filter.toInternalDisplay);
+        }
+    };
+
+    static bool isCurrent(const Layer&, const LayerFECompositionState&,
+                          const Output::CoverageState&, bool computeAboveCoveredExcludingOverlays);
+    static Layer computeLayer(const LayerFE&, const LayerFECompositionState&,
+                              const Output::CoverageState&,
+                              bool computeAboveCoveredExcludingOverlays);
+
+    std::unordered_map<LayerKey, Layer, LayerKeyHash> mLayers;
+    uint64_t mUpdate = 0;
+};
+
+} // namespace android::compositionengine
@@ -49,6 +49,7 @@ namespace compositionengine {
 
 class DisplayColorProfile;
 class LayerFE;
+class LayerStackVisibility;
 class RenderSurface;
 class OutputLayer;
 
@@ -157,6 +158,8 @@ public:
         // only has a value if there's something needing it, like when a TrustedPresentationListener
         // is set
         std::optional<Region> aboveCoveredLayersExcludingOverlays;
+        // The layer stack space visibility shared with the other outputs, if any
+        LayerStackVisibility* layerStackVisibility = nullptr;
     };
 
     virtual ~Output();
@@ -267,6 +270,13 @@ public:
     // Presents the output, finalizing all composition details
     virtual void present(const CompositionRefreshArgs&) = 0;
 
+    // present() is split into two phases so that outputs can be presented concurrently.
+    // prepareCompositionState() updates and writes the per-layer composition state. It only
+    // reads the shared LayerFE state, so it can run for different outputs in parallel.
+    virtual void prepareCompositionState(const CompositionRefreshArgs&) = 0;
+    // finishPresent() runs the rest of present() and must be called in output order.
+    virtual void finishPresent(const CompositionRefreshArgs&) = 0;
+
     // Enables predicting composition strategy to run client composition earlier
     virtual void setPredictCompositionStrategy(bool) = 0;
 
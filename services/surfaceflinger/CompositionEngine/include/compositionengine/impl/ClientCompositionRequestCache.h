@@ -18,6 +18,7 @@
 
 #include <cstdint>
 #include <deque>
+#include <string>
 
 #include <compositionengine/LayerFE.h>
 #include <renderengine/DisplaySettings.h>
@@ -41,14 +42,20 @@ class ClientCompositionRequestCache {
 public:
     explicit ClientCompositionRequestCache(uint32_t cacheSize) : mMaxCacheSize(cacheSize){};
     ~ClientCompositionRequestCache() = default;
+    // Looks up whether the request was rendered into the buffer. Lookups are counted as hits and
+    // misses for dump().
     bool exists(uint64_t bufferId, const renderengine::DisplaySettings& display,
-                const std::vector<LayerFE::LayerSettings>& layerSettings) const;
+                const std::vector<LayerFE::LayerSettings>& layerSettings);
     void add(uint64_t bufferId, const renderengine::DisplaySettings& display,
              const std::vector<LayerFE::LayerSettings>& layerSettings);
     void remove(uint64_t bufferId);
 
+    void dump(std::string& out) const;
+
 private:
     uint32_t mMaxCacheSize;
+    size_t mHitCount = 0;
+    size_t mMissCount = 0;
     struct ClientCompositionRequest {
         renderengine::DisplaySettings display;
         std::vector<LayerFE::LayerSettings> layerSettings;
@@ -17,6 +17,8 @@
 #pragma once
 
 #include <compositionengine/CompositionEngine.h>
+#include <compositionengine/LayerStackVisibility.h>
+#include <compositionengine/impl/HwcAsyncWorker.h>
 
 namespace android::compositionengine::impl {
 
@@ -57,6 +59,11 @@ public:
     void setNeedsAnotherUpdateForTest(bool);
 
 private:
+    void presentOutputsInParallel(CompositionRefreshArgs&);
+
+    // Workers used to prepare the composition state of all but the first output in parallel.
+    std::vector<std::unique_ptr<HwcAsyncWorker>> mOutputWorkers;
+    LayerStackVisibility mLayerStackVisibility;
     std::unique_ptr<HWComposer> mHwComposer;
     renderengine::RenderEngine* mRenderEngine;
     std::shared_ptr<TimeStats> mTimeStats;
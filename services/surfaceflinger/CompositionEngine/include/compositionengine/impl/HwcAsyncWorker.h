@@ -34,9 +34,12 @@ namespace android::compositionengine::impl {
 // was successful otherwise the client composition is re-executed.
 //
 // Note: This does not alter the sequence between HWC and surfaceflinger.
+//
+// SurfaceFlinger also uses it to run the composition engine off the main thread, in which case
+// the thread is given another name.
 class HwcAsyncWorker final {
 public:
-    HwcAsyncWorker();
+    explicit HwcAsyncWorker(const char* threadName = "HwcAsyncWorker");
     ~HwcAsyncWorker();
     // Runs the provided function which calls hwc validate and returns the requested
     // device changes as a future.
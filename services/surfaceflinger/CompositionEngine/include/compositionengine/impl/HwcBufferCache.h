@@ -56,6 +56,16 @@ struct HwcSlotAndBuffer {
 // since it eliminates the overhead to transfer the buffer handle over IPC and
 // the overhead for the HAL to clone the handle.
 //
+// When the slots are exhausted, the evicted buffer is chosen by predicting which cached buffer will
+// be needed furthest in the future:
+//  - Buffers from an older BufferQueue generation than the incoming buffer are evicted first, since
+//    the producer has reallocated and will not queue them again.
+//  - If the incoming buffer was recently evicted, and its reuse distance shows that the producer
+//    cycles through more buffers than there are slots, the most recently used buffer is evicted.
+//    Evicting the least recently used one would evict the next buffer in the ring, so every frame
+//    would miss and send a full handle.
+//  - Otherwise, the least recently used buffer is evicted.
+//
 class HwcBufferCache {
 private:
     static const constexpr size_t kMaxLayerBufferCount = BufferQueue::NUM_BUFFER_SLOTS;
@@ -94,7 +104,8 @@ public:
 
 private:
     uint32_t cache(const sp<GraphicBuffer>& buffer);
-    uint32_t getLeastRecentlyUsedSlot();
+    uint32_t getSlotToReplace(const sp<GraphicBuffer>& buffer);
+    void rememberEvicted(uint64_t bufferId, uint64_t lruCounter);
 
     struct Cache {
         sp<GraphicBuffer> buffer;
@@ -107,7 +118,11 @@ private:
     std::unordered_map<uint64_t, Cache> mCacheByBufferId;
     sp<GraphicBuffer> mLastOverrideBuffer;
     std::stack<uint32_t> mFreeSlots;
-    uint64_t mLeastRecentlyUsedCounter;
+    uint64_t mLeastRecentlyUsedCounter = 0;
+
+    // The last use of recently evicted buffers, from which the reuse distance of a buffer that
+    // comes back is derived. Holds at most kMaxLayerBufferCount entries.
+    std::unordered_map<uint64_t /*buffer id*/, uint64_t /*lruCounter*/> mEvictedBufferIds;
 };
 
 } // namespace compositionengine::impl
@@ -18,6 +18,7 @@
 
 #include <compositionengine/CompositionEngine.h>
 #include <compositionengine/LayerFECompositionState.h>
+#include <compositionengine/LayerStackVisibility.h>
 #include <compositionengine/Output.h>
 #include <compositionengine/impl/ClientCompositionRequestCache.h>
 #include <compositionengine/impl/GpuCompositionResult.h>
@@ -29,6 +30,8 @@
 #include <renderengine/LayerSettings.h>
 
 #include <memory>
+#include <optional>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -85,6 +88,8 @@ public:
 
     void prepare(const CompositionRefreshArgs&, LayerFESet&) override;
     void present(const CompositionRefreshArgs&) override;
+    void prepareCompositionState(const CompositionRefreshArgs&) override;
+    void finishPresent(const CompositionRefreshArgs&) override;
 
     void uncacheBuffers(const std::vector<uint64_t>& bufferIdsToUncache) override;
     void rebuildLayerStacks(const CompositionRefreshArgs&, LayerFESet&) override;
@@ -119,6 +124,9 @@ public:
 #endif
     // Testing
     const ReleasedLayers& getReleasedLayersForTest() const;
+    const LayerStackVisibility::Stats& getLayerVisibilityStatsForTest() const {
+        return mLayerVisibilityStats;
+    }
     void setDisplayColorProfileForTest(std::unique_ptr<compositionengine::DisplayColorProfile>);
     void setRenderSurfaceForTest(std::unique_ptr<compositionengine::RenderSurface>);
     bool plannerEnabled() const { return mPlanner != nullptr; }
@@ -165,6 +173,31 @@ protected:
     const std::string& getNamePlusId() const { return mNamePlusId; }
 
 private:
+    // The output space regions of a layer, derived from its layer stack space regions through
+    // the projection of this output.
+    struct ProjectedVisibility {
+        // Inputs
+        Region visibleNonTransparentRegion;
+        Region visibleNonShadowRegion;
+        Region transparentRegion;
+        bool isDisplayDecoration = false;
+        ui::Transform outputTransform;
+        Rect displayBounds;
+        Rect layerStackContent;
+
+        // Results
+        bool drawRegionEmpty = true;
+        Region outputSpaceVisibleRegion;
+        Region outputSpaceBlockingRegionHint;
+
+        // The geometry update in which the layer was last seen.
+        uint64_t geometryUpdate = 0;
+    };
+
+    const ProjectedVisibility& getProjectedVisibility(const compositionengine::LayerFE&,
+                                                      const LayerFECompositionState&,
+                                                      const LayerStackVisibility::Layer&);
+
     void dirtyEntireOutput();
 #ifndef DISABLE_DEVICE_INTEGRATION
     // Device Integration: is black screen layer 
@@ -173,6 +206,12 @@ private:
     void updateCompositionStateForBorder(const compositionengine::CompositionRefreshArgs&);
     compositionengine::OutputLayer* findLayerRequestingBackgroundComposition() const;
     void finishPrepareFrame();
+    void recordCompositionStrategy(const std::optional<DeviceRequestedChanges>&, bool success);
+    bool restoreCompositionStrategy(uint64_t outputLayerHash);
+    Rect computeClientTargetDamage(uint64_t bufferId, const renderengine::DisplaySettings&,
+                                   const std::vector<LayerFE::LayerSettings>&,
+                                   const std::vector<LayerFE*>&, bool flashing);
+    void recordClientTargetDamage();
     ui::Dataspace getBestDataspace(ui::Dataspace*, bool*) const;
     compositionengine::Output::ColorProfile pickColorProfile(
             const compositionengine::CompositionRefreshArgs&) const;
@@ -189,8 +228,52 @@ private:
     std::unique_ptr<planner::Planner> mPlanner;
     std::unique_ptr<HwcAsyncWorker> mHwComposerAsyncWorker;
 
+    // The device requested changes of the most recent distinct layer stacks, keyed by their
+    // output layer hash, oldest first. Used to predict the composition strategy of a layer stack
+    // that differs from the previous frame but was composed recently, e.g. when a layer is
+    // toggled on and off.
+    struct CompositionStrategyHistoryEntry {
+        uint64_t outputLayerHash;
+        DeviceRequestedChanges changes;
+    };
+    std::vector<CompositionStrategyHistoryEntry> mCompositionStrategyHistory;
+
+    // The client composition of the current frame, recorded into the damage history once the
+    // frame is presented.
+    struct ClientTargetComposition {
+        uint64_t bufferId;
+        // False if the buffer holds something other than the composition, e.g. flashed regions.
+        bool contentValid;
+        // The area, in layer stack space, in which the composition may differ from the one of the
+        // previous frame.
+        Region damage;
+        renderengine::DisplaySettings display;
+        std::vector<const LayerFE*> layers;
+    };
+    std::optional<ClientTargetComposition> mPendingClientTargetComposition;
+    renderengine::DisplaySettings mLastClientTargetDisplay;
+    std::vector<const LayerFE*> mLastClientTargetLayers;
+
+    // The damage of the most recent frames, oldest first, and the client target buffer each of
+    // them was composed into, or 0 if none. A buffer that is composed into again only needs the
+    // damage of the frames since it was last composed to be redrawn, which is what EGL buffer age
+    // is used for.
+    struct ClientTargetDamageEntry {
+        uint64_t bufferId;
+        Region damage;
+    };
+    std::vector<ClientTargetDamageEntry> mClientTargetDamageHistory;
+
     // Whether the content must be recomposed this frame.
     bool mMustRecompose = false;
+
+    // Used if the CompositionEngine does not share a LayerStackVisibility between its outputs.
+    LayerStackVisibility mLayerStackVisibility;
+    LayerStackVisibility::Stats mLayerVisibilityStats;
+
+    // The output space regions of the layers on this output, keyed by layer sequence.
+    std::unordered_map<int32_t, ProjectedVisibility> mProjectedVisibility;
+    uint64_t mGeometryUpdateCount = 0;
 };
 
 // This template factory function standardizes the implementation details of the
@@ -161,6 +161,24 @@ struct OutputCompositionState {
     CompositionStrategyPredictionState strategyPrediction =
             CompositionStrategyPredictionState::DISABLED;
 
+    // Number of consecutive frames the composition strategy prediction failed for, and the number
+    // of frames to wait before predicting again once too many predictions in a row have failed.
+    uint32_t strategyPredictionMissStreak = 0;
+    uint32_t strategyPredictionBackoffFrames = 0;
+
+    // Composition strategy prediction outcomes since the output was created. Misses also count
+    // a client composition that had to be redone, so they approximate the wasted GPU work.
+    uint64_t strategyPredictionHits = 0;
+    uint64_t strategyPredictionMisses = 0;
+    // Predictions made from the strategy history rather than the previous frame.
+    uint64_t strategyPredictionsFromHistory = 0;
+
+    // Client compositions rendered since the output was created, how many of them only redrew the
+    // damaged area of the client target, and the number of pixels they redrew in total.
+    uint64_t clientCompositionFrames = 0;
+    uint64_t partialClientCompositionFrames = 0;
+    uint64_t clientCompositionPixels = 0;
+
     bool treat170mAsSrgb = false;
 
     std::vector<renderengine::BorderRenderInfo> borderInfoList;
@@ -72,6 +72,8 @@ public:
 
         static const constexpr std::chrono::milliseconds kDefaultActiveLayerTimeout = 150ms;
 
+        static const constexpr std::chrono::milliseconds kDefaultSettledActiveLayerTimeout = 50ms;
+
         static const constexpr bool kDefaultEnableHolePunch = true;
 
         // Threshold for determing whether a layer is active. A layer whose properties, including
@@ -85,14 +87,27 @@ public:
 
         // True if the hole punching feature should be enabled.
         const bool mEnableHolePunch;
+
+        // Threshold used instead of mActiveLayerTimeout for layer stacks whose geometry was
+        // recently flattened. Such stacks tend to settle the same way again, e.g. when returning
+        // to the launcher, so their cached set is rendered ahead of the usual timeout. If not
+        // set, mActiveLayerTimeout is used for every layer stack.
+        const std::optional<std::chrono::milliseconds> mSettledActiveLayerTimeout;
     };
 
+    // Number of recently flattened geometries remembered for mSettledActiveLayerTimeout.
+    static constexpr size_t kMaxSettledGeometries = 8;
+
     // Constants not yet backed by a sysprop
     // CachedSets that contain no more than this many layers may be considered inactive on the basis
     // of FPS.
     static constexpr int kNumLayersFpsConsideration = 1;
     // Frames/Second threshold below which these CachedSets may be considered inactive.
     static constexpr float kFpsActiveThreshold = 1.f;
+    // Time without a geometry change or a new CachedSet after which the textures idling in the
+    // TexturePool are released. A settled layer stack keeps using the texture of its CachedSet,
+    // so the other textures would otherwise pin several display-sized buffers.
+    static constexpr std::chrono::seconds kTexturePoolIdleTimeout = 5s;
 
     Flattener(renderengine::RenderEngine& renderEngine, const Tunables& tunables);
 
@@ -126,6 +141,12 @@ private:
     bool mergeWithCachedSets(const std::vector<const LayerState*>& layers,
                              std::chrono::steady_clock::time_point now);
 
+    // Remembers that the current geometry was flattened into a cached set.
+    void recordSettledGeometry();
+
+    // The threshold for considering layers of the current geometry inactive.
+    std::chrono::milliseconds getActiveLayerTimeout() const;
+
     // A Run is a sequence of CachedSets, which is a candidate for flattening into a single
     // CachedSet. Because it is wasteful to flatten 1 CachedSet, a run must contain more than
     // 1 CachedSet or be used for a hole punch.
@@ -243,9 +264,13 @@ private:
 
     NonBufferHash mCurrentGeometry;
     std::chrono::steady_clock::time_point mLastGeometryUpdate;
+    std::chrono::steady_clock::time_point mLastCachedSetCreation;
 
     std::vector<CachedSet> mLayers;
 
+    // Geometries that were recently flattened, the most recent one last.
+    std::vector<NonBufferHash> mSettledGeometries;
+
     // Statistics
     size_t mUnflattenedDisplayCost = 0;
     size_t mFlattenedDisplayCost = 0;
@@ -253,6 +278,7 @@ private:
     std::unordered_map<size_t, size_t> mFinalLayerCounts;
     size_t mCachedSetCreationCount = 0;
     size_t mCachedSetCreationCost = 0;
+    size_t mSettledCachedSetCreationCount = 0;
     std::unordered_map<size_t, size_t> mInvalidatedCachedSetAges;
 };
 
@@ -83,6 +83,10 @@ public:
     // be held by the pool. This is useful when the active display changes.
     void setEnabled(bool enable);
 
+    // Releases the textures held by the pool. Borrowed textures are not affected, and the pool
+    // grows back on demand, up to its maximum size.
+    void releaseIdleTextures();
+
     void dump(std::string& out) const;
 
 protected:
@@ -106,6 +110,13 @@ private:
     renderengine::RenderEngine& mRenderEngine;
     ui::Size mSize;
     bool mEnabled;
+
+    // Statistics
+    size_t mAllocatedCount = 0;
+    size_t mBorrowedCount = 0;
+    size_t mStarvedCount = 0;
+    size_t mReleasedIdleCount = 0;
+    size_t mDroppedCount = 0;
 };
 
 } // namespace android::compositionengine::impl::planner
@@ -81,6 +81,8 @@ public:
 
     MOCK_METHOD2(prepare, void(const compositionengine::CompositionRefreshArgs&, LayerFESet&));
     MOCK_METHOD1(present, void(const compositionengine::CompositionRefreshArgs&));
+    MOCK_METHOD1(prepareCompositionState, void(const compositionengine::CompositionRefreshArgs&));
+    MOCK_METHOD1(finishPresent, void(const compositionengine::CompositionRefreshArgs&));
 
     MOCK_METHOD1(uncacheBuffers, void(const std::vector<uint64_t>&));
     MOCK_METHOD2(rebuildLayerStacks,
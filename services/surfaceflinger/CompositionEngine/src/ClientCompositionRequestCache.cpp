@@ -16,6 +16,7 @@
 
 #include <algorithm>
 
+#include <android-base/stringprintf.h>
 #include <compositionengine/impl/ClientCompositionRequestCache.h>
 #include <renderengine/DisplaySettings.h>
 #include <renderengine/LayerSettings.h>
@@ -88,19 +89,22 @@ bool ClientCompositionRequestCache::ClientCompositionRequest::equals(
 
 bool ClientCompositionRequestCache::exists(
         uint64_t bufferId, const renderengine::DisplaySettings& display,
-        const std::vector<LayerFE::LayerSettings>& layerSettings) const {
+        const std::vector<LayerFE::LayerSettings>& layerSettings) {
     for (const auto& [cachedBufferId, cachedRequest] : mCache) {
         if (cachedBufferId == bufferId) {
-            return cachedRequest.equals(display, layerSettings);
+            const bool hit = cachedRequest.equals(display, layerSettings);
+            ++(hit ? mHitCount : mMissCount);
+            return hit;
         }
     }
+    ++mMissCount;
     return false;
 }
 
 void ClientCompositionRequestCache::add(uint64_t bufferId,
                                         const renderengine::DisplaySettings& display,
                                         const std::vector<LayerFE::LayerSettings>& layerSettings) {
-    const ClientCompositionRequest request(display, layerSettings);
+    ClientCompositionRequest request(display, layerSettings);
     for (auto& [cachedBufferId, cachedRequest] : mCache) {
         if (cachedBufferId == bufferId) {
             cachedRequest = std::move(request);
@@ -124,4 +128,15 @@ void ClientCompositionRequestCache::remove(uint64_t bufferId) {
     }
 }
 
+void ClientCompositionRequestCache::dump(std::string& out) const {
+    const size_t lookupCount = mHitCount + mMissCount;
+    const float hitRate = lookupCount > 0
+            ? 100.f * static_cast<float>(mHitCount) / static_cast<float>(lookupCount)
+            : 0.f;
+    base::StringAppendF(&out,
+                        "   Client composition cache: %zu/%u entries, %zu hits, %zu misses "
+                        "(%.1f%% hit rate)\n",
+                        mCache.size(), mMaxCacheSize, mHitCount, mMissCount, hitRate);
+}
+
 } // namespace android::compositionengine::impl
@@ -100,9 +100,23 @@ void CompositionEngine::present(CompositionRefreshArgs& args) {
         // needed for anything else.
         LayerFESet latchedLayers;
 
+        // Outputs that include the same layers, e.g. mirrored displays, share the visibility
+        // computed by the first of them.
+        args.layerStackVisibility = &mLayerStackVisibility;
+
         for (const auto& output : args.outputs) {
             output->prepare(args, latchedLayers);
         }
+
+        if (args.updatingOutputGeometryThisFrame) {
+            mLayerStackVisibility.prune();
+        }
+    }
+    args.prepareEndTime = systemTime();
+
+    if (args.parallelOutputComposition && args.outputs.size() > 1) {
+        presentOutputsInParallel(args);
+        return;
     }
 
     for (const auto& output : args.outputs) {
@@ -110,6 +124,34 @@ void CompositionEngine::present(CompositionRefreshArgs& args) {
     }
 }
 
+void CompositionEngine::presentOutputsInParallel(CompositionRefreshArgs& args) {
+    ATRACE_CALL();
+
+    while (mOutputWorkers.size() < args.outputs.size() - 1) {
+        mOutputWorkers.push_back(std::make_unique<HwcAsyncWorker>());
+    }
+
+    // The LayerFE state is only read while the outputs prepare their composition state, so the
+    // first output is prepared on this thread while the workers prepare the rest.
+    std::vector<std::future<bool>> futures;
+    futures.reserve(args.outputs.size() - 1);
+    for (size_t i = 1; i < args.outputs.size(); i++) {
+        futures.push_back(mOutputWorkers[i - 1]->send([&args, output = args.outputs[i].get()] {
+            output->prepareCompositionState(args);
+            return true;
+        }));
+    }
+    args.outputs.front()->prepareCompositionState(args);
+    for (auto& future : futures) {
+        future.wait();
+    }
+
+    // Present in output order so that the HWC sees a deterministic sequence of presents.
+    for (const auto& output : args.outputs) {
+        output->finishPresent(args);
+    }
+}
+
 void CompositionEngine::updateCursorAsync(CompositionRefreshArgs& args) {
     std::unordered_map<compositionengine::LayerFE*, compositionengine::LayerFECompositionState*>
             uniqueVisibleLayers;
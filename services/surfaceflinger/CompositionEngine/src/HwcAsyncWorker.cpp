@@ -27,9 +27,9 @@
 
 namespace android::compositionengine::impl {
 
-HwcAsyncWorker::HwcAsyncWorker() {
+HwcAsyncWorker::HwcAsyncWorker(const char* threadName) {
     mThread = std::thread(&HwcAsyncWorker::run, this);
-    pthread_setname_np(mThread.native_handle(), "HwcAsyncWorker");
+    pthread_setname_np(mThread.native_handle(), threadName);
 }
 
 HwcAsyncWorker::~HwcAsyncWorker() {
@@ -19,6 +19,8 @@
 #include <gui/BufferQueue.h>
 #include <ui/GraphicBuffer.h>
 
+#include <algorithm>
+
 namespace android::compositionengine::impl {
 
 HwcBufferCache::HwcBufferCache() {
@@ -46,6 +48,9 @@ HwcSlotAndBuffer HwcBufferCache::getOverrideHwcSlotAndBuffer(const sp<GraphicBuf
 }
 
 uint32_t HwcBufferCache::uncache(uint64_t bufferId) {
+    // The client discarded the buffer, so it will not come back.
+    mEvictedBufferIds.erase(bufferId);
+
     if (auto i = mCacheByBufferId.find(bufferId); i != mCacheByBufferId.end()) {
         uint32_t slot = i->second.slot;
         mCacheByBufferId.erase(i);
@@ -61,24 +66,46 @@ uint32_t HwcBufferCache::uncache(uint64_t bufferId) {
 
 uint32_t HwcBufferCache::cache(const sp<GraphicBuffer>& buffer) {
     Cache cache;
-    cache.slot = getLeastRecentlyUsedSlot();
+    cache.slot = getSlotToReplace(buffer);
     cache.lruCounter = mLeastRecentlyUsedCounter++;
     cache.buffer = buffer;
     mCacheByBufferId.emplace(buffer->getId(), cache);
     return cache.slot;
 }
 
-uint32_t HwcBufferCache::getLeastRecentlyUsedSlot() {
+uint32_t HwcBufferCache::getSlotToReplace(const sp<GraphicBuffer>& buffer) {
     if (mFreeSlots.empty()) {
         assert(!mCacheByBufferId.empty());
-        // evict the least recently used cache entry
+
+        // The producer cycles through more buffers than there are slots if this buffer was used
+        // more than kMaxLayerBufferCount buffers ago. The buffer needed furthest in the future is
+        // then the one used last.
+        bool cycling = false;
+        if (const auto i = mEvictedBufferIds.find(buffer->getId()); i != mEvictedBufferIds.end()) {
+            cycling = mLeastRecentlyUsedCounter - i->second > kMaxLayerBufferCount;
+            mEvictedBufferIds.erase(i);
+        }
+
+        const uint32_t generation = buffer->getGenerationNumber();
+        const auto isStale = [generation](const Cache& cache) {
+            return cache.buffer->getGenerationNumber() != generation;
+        };
+
+        // Whether a should be evicted rather than b.
+        const auto evictFirst = [&](const Cache& a, const Cache& b) {
+            if (isStale(a) != isStale(b)) return isStale(a);
+            if (isStale(a) || !cycling) return a.lruCounter < b.lruCounter;
+            return a.lruCounter > b.lruCounter;
+        };
+
         auto cacheToErase = mCacheByBufferId.begin();
         for (auto i = cacheToErase; i != mCacheByBufferId.end(); ++i) {
-            if (i->second.lruCounter < cacheToErase->second.lruCounter) {
+            if (evictFirst(i->second, cacheToErase->second)) {
                 cacheToErase = i;
             }
         }
         uint32_t slot = cacheToErase->second.slot;
+        rememberEvicted(cacheToErase->first, cacheToErase->second.lruCounter);
         mCacheByBufferId.erase(cacheToErase);
         mFreeSlots.push(slot);
     }
@@ -87,4 +114,16 @@ uint32_t HwcBufferCache::getLeastRecentlyUsedSlot() {
     return slot;
 }
 
+void HwcBufferCache::rememberEvicted(uint64_t bufferId, uint64_t lruCounter) {
+    if (mEvictedBufferIds.size() >= kMaxLayerBufferCount) {
+        // Forget the buffer evicted longest ago.
+        const auto oldest = std::min_element(mEvictedBufferIds.begin(), mEvictedBufferIds.end(),
+                                             [](const auto& a, const auto& b) {
+                                                 return a.second < b.second;
+                                             });
+        mEvictedBufferIds.erase(oldest);
+    }
+    mEvictedBufferIds.emplace(bufferId, lruCounter);
+}
+
 } // namespace android::compositionengine::impl
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/LayerStackVisibility.h>
+#include <cutils/compiler.h>
+#include <log/log.h>
+
+#include <cmath>
+
+namespace android::compositionengine {
+
+namespace {
+
+// Regions that were carried over from the cached result of the layer above are trivially equal,
+// so comparing the coverage is usually cheap.
+bool isEqual(const Region& lhs, const Region& rhs) {
+    return lhs.isTriviallyEqual(rhs) || lhs.hasSameRects(rhs);
+}
+
+} // namespace
+
+const LayerStackVisibility::Layer& LayerStackVisibility::getLayer(
+        ui::LayerFilter filter, const LayerFE& layerFE, const LayerFECompositionState& layerFEState,
+        const Output::CoverageState& coverage, bool computeAboveCoveredExcludingOverlays,
+        Stats& stats) {
+    auto [it, inserted] = mLayers.try_emplace(LayerKey{filter, layerFE.getSequence()});
+    Layer& layer = it->second;
+
+    if (!inserted &&
+        isCurrent(layer, layerFEState, coverage, computeAboveCoveredExcludingOverlays)) {
+        layer.update = mUpdate;
+        stats.reused++;
+        return layer;
+    }
+
+    Layer result =
+            computeLayer(layerFE, layerFEState, coverage, computeAboveCoveredExcludingOverlays);
+    result.update = mUpdate;
+
+    // If the coverage below this layer did not change, e.g. because this layer is only partially
+    // covered by a small layer that moved, then keep the previous regions, so that the layers below
+    // match their cached results trivially.
+    if (!inserted) {
+        if (result.aboveCoveredLayersBelow.hasSameRects(layer.aboveCoveredLayersBelow)) {
+            result.aboveCoveredLayersBelow = layer.aboveCoveredLayersBelow;
+        }
+        if (result.aboveOpaqueLayersBelow.hasSameRects(layer.aboveOpaqueLayersBelow)) {
+            result.aboveOpaqueLayersBelow = layer.aboveOpaqueLayersBelow;
+        }
+    }
+
+    stats.recomputed++;
+    layer = std::move(result);
+    return layer;
+}
+
+void LayerStackVisibility::prune() {
+    for (auto it = mLayers.begin(); it != mLayers.end();) {
+        if (it->second.update != mUpdate) {
+            it = mLayers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    mUpdate++;
+}
+
+bool LayerStackVisibility::isCurrent(const Layer& layer,
+                                     const LayerFECompositionState& layerFEState,
+                                     const Output::CoverageState& coverage,
+                                     bool computeAboveCoveredExcludingOverlays) {
+    if (!(layer.layerTransform == layerFEState.geomLayerTransform) ||
+        !(layer.layerBounds == layerFEState.geomLayerBounds) ||
+        layer.shadowRadius != layerFEState.shadowRadius ||
+        layer.isOpaque != layerFEState.isOpaque ||
+        !isEqual(layer.transparentRegionHint, layerFEState.transparentRegionHint)) {
+        return false;
+    }
+
+    if (layer.computeAboveCoveredExcludingOverlays != computeAboveCoveredExcludingOverlays ||
+        (computeAboveCoveredExcludingOverlays &&
+         !isEqual(layer.aboveCoveredLayersExcludingOverlays,
+                  *coverage.aboveCoveredLayersExcludingOverlays))) {
+        return false;
+    }
+
+    return isEqual(layer.aboveCoveredLayers, coverage.aboveCoveredLayers) &&
+            isEqual(layer.aboveOpaqueLayers, coverage.aboveOpaqueLayers);
+}
+
+LayerStackVisibility::Layer LayerStackVisibility::computeLayer(
+        const LayerFE& layerFE, const LayerFECompositionState& layerFEState,
+        const Output::CoverageState& coverage, bool computeAboveCoveredExcludingOverlays) {
+    Layer layer;
+    layer.layerTransform = layerFEState.geomLayerTransform;
+    layer.layerBounds = layerFEState.geomLayerBounds;
+    layer.shadowRadius = layerFEState.shadowRadius;
+    layer.isOpaque = layerFEState.isOpaque;
+    layer.transparentRegionHint = layerFEState.transparentRegionHint;
+    layer.computeAboveCoveredExcludingOverlays = computeAboveCoveredExcludingOverlays;
+    layer.aboveCoveredLayers = coverage.aboveCoveredLayers;
+    layer.aboveOpaqueLayers = coverage.aboveOpaqueLayers;
+    if (computeAboveCoveredExcludingOverlays) {
+        layer.aboveCoveredLayersExcludingOverlays = *coverage.aboveCoveredLayersExcludingOverlays;
+    }
+
+    // Unless the layer turns out to be visible, it does not affect the layers below.
+    layer.aboveCoveredLayersBelow = coverage.aboveCoveredLayers;
+    layer.aboveOpaqueLayersBelow = coverage.aboveOpaqueLayers;
+    layer.aboveCoveredLayersExcludingOverlaysBelow = coverage.aboveCoveredLayersExcludingOverlays;
+
+    /*
+     * opaqueRegion: area of a surface that is fully opaque.
+     */
+    Region opaqueRegion;
+
+    /*
+     * visibleRegion: area of a surface that is visible on screen and not fully
+     * transparent. This is essentially the layer's footprint minus the opaque
+     * regions above it. Areas covered by a translucent surface are considered
+     * visible.
+     */
+    Region visibleRegion;
+
+    /*
+     * coveredRegion: area of a surface that is covered by all visible regions
+     * above it (which includes the translucent areas).
+     */
+    Region coveredRegion;
+
+    /*
+     * transparentRegion: area of a surface that is hinted to be completely
+     * transparent.
+     * This is used to tell when the layer has no visible non-transparent
+     * regions and can be removed from the layer list. It does not affect the
+     * visibleRegion of this layer or any layers beneath it. The hint may not
+     * be correct if apps don't respect the SurfaceView restrictions (which,
+     * sadly, some don't).
+     *
+     * In addition, it is used on DISPLAY_DECORATION layers to specify the
+     * blockingRegion, allowing the DPU to skip it to save power. Once we have
+     * hardware that supports a blockingRegion on frames with AFBC, it may be
+     * useful to use this for other layers, too, so long as we can prevent
+     * regressions on b/7179570.
+     */
+    Region transparentRegion;
+
+    /*
+     * shadowRegion: Region cast by the layer's shadow.
+     */
+    Region shadowRegion;
+
+    /**
+     * covered region above excluding internal display overlay layers
+     */
+    std::optional<Region> coveredRegionExcludingDisplayOverlays = std::nullopt;
+
+    const ui::Transform& tr = layerFEState.geomLayerTransform;
+
+    // Get the visible region
+    // TODO(b/121291683): Is it worth creating helper methods on LayerFEState
+    // for computations like this?
+    const Rect visibleRect(tr.transform(layerFEState.geomLayerBounds));
+    visibleRegion.set(visibleRect);
+
+    if (layerFEState.shadowRadius > 0.0f) {
+        // if the layer casts a shadow, offset the layers visible region and
+        // calculate the shadow region.
+        const auto inset = static_cast<int32_t>(ceilf(layerFEState.shadowRadius) * -1.0f);
+        Rect visibleRectWithShadows(visibleRect);
+        visibleRectWithShadows.inset(inset, inset, inset, inset);
+        visibleRegion.set(visibleRectWithShadows);
+        shadowRegion = visibleRegion.subtract(visibleRect);
+    }
+
+    if (visibleRegion.isEmpty()) {
+        return layer;
+    }
+
+    // Remove the transparent area from the visible region
+    if (!layerFEState.isOpaque) {
+        if (tr.preserveRects()) {
+            // Clip the transparent region to geomLayerBounds first
+            // The transparent region may be influenced by applications, for
+            // instance, by overriding ViewGroup#gatherTransparentRegion with a
+            // custom view. Once the layer stack -> display mapping is known, we
+            // must guard against very wrong inputs to prevent underflow or
+            // overflow errors. We do this here by constraining the transparent
+            // region to be within the pre-transform layer bounds, since the
+            // layer bounds are expected to play nicely with the full
+            // transform.
+            const Region clippedTransparentRegionHint =
+                    layerFEState.transparentRegionHint.intersect(
+                            Rect(layerFEState.geomLayerBounds));
+
+            if (clippedTransparentRegionHint.isEmpty()) {
+                if (!layerFEState.transparentRegionHint.isEmpty()) {
+                    ALOGD("Layer: %s had an out of bounds transparent region",
+                          layerFE.getDebugName());
+                    layerFEState.transparentRegionHint.dump("transparentRegionHint");
+                }
+                transparentRegion.clear();
+            } else {
+                transparentRegion = tr.transform(clippedTransparentRegionHint);
+            }
+        } else {
+            // transformation too complex, can't do the
+            // transparent region optimization.
+            transparentRegion.clear();
+        }
+    }
+
+    // compute the opaque region
+    const auto layerOrientation = tr.getOrientation();
+    if (layerFEState.isOpaque && ((layerOrientation & ui::Transform::ROT_INVALID) == 0)) {
+        // If we one of the simple category of transforms (0/90/180/270 rotation
+        // + any flip), then the opaque region is the layer's footprint.
+        // Otherwise we don't try and compute the opaque region since there may
+        // be errors at the edges, and we treat the entire layer as
+        // translucent.
+        opaqueRegion.set(visibleRect);
+    }
+
+    // Clip the covered region to the visible region
+    coveredRegion = coverage.aboveCoveredLayers.intersect(visibleRegion);
+
+    // Update accumAboveCoveredLayers for next (lower) layer
+    layer.aboveCoveredLayersBelow = coverage.aboveCoveredLayers.merge(visibleRegion);
+
+    if (CC_UNLIKELY(computeAboveCoveredExcludingOverlays)) {
+        coveredRegionExcludingDisplayOverlays =
+                coverage.aboveCoveredLayersExcludingOverlays->intersect(visibleRegion);
+        layer.aboveCoveredLayersExcludingOverlaysBelow =
+                coverage.aboveCoveredLayersExcludingOverlays->merge(visibleRegion);
+    }
+
+    // subtract the opaque region covered by the layers above us
+    visibleRegion.subtractSelf(coverage.aboveOpaqueLayers);
+
+    if (visibleRegion.isEmpty()) {
+        return layer;
+    }
+
+    // Update accumAboveOpaqueLayers for next (lower) layer
+    layer.aboveOpaqueLayersBelow = coverage.aboveOpaqueLayers.merge(opaqueRegion);
+
+    layer.visibleRegion = visibleRegion;
+    layer.visibleNonTransparentRegion = visibleRegion.subtract(transparentRegion);
+    layer.visibleNonShadowRegion = visibleRegion.subtract(shadowRegion);
+    layer.coveredRegion = coveredRegion;
+    layer.transparentRegion = transparentRegion;
+    layer.shadowRegion = shadowRegion;
+    layer.coveredRegionExcludingDisplayOverlays = std::move(coveredRegionExcludingDisplayOverlays);
+    return layer;
+}
+
+} // namespace android::compositionengine
@@ -32,6 +32,7 @@
 #include <ftl/future.h>
 #include <gui/TraceUtils.h>
 
+#include <algorithm>
 #include <optional>
 #include <thread>
 
@@ -67,6 +68,20 @@ using CompositionStrategyPredictionState =
         OutputCompositionState::CompositionStrategyPredictionState;
 namespace {
 
+// After this many consecutive composition strategy prediction misses, the display is assumed to
+// be changing its strategy every frame, and prediction is paused for a while. A miss costs a
+// second prepareFrame and a wasted client composition, so predicting is only worth it when the
+// strategy is stable.
+constexpr uint32_t kMaxStrategyPredictionMissStreak = 3;
+constexpr uint32_t kStrategyPredictionBackoffFrames = 30;
+
+// Number of distinct layer stacks whose composition strategy is remembered for prediction.
+constexpr size_t kCompositionStrategyHistorySize = 4;
+
+// Number of frames whose client target damage is remembered. Client targets are at most triple
+// buffered, so this covers the age of every buffer that is still in rotation.
+constexpr size_t kClientTargetDamageHistorySize = 4;
+
 template <typename T>
 class Reversed {
 public:
@@ -327,6 +342,16 @@ void Output::dumpBase(std::string& out) const {
         out.append("    No render surface!\n");
     }
 
+    if (mClientCompositionRequestCache) {
+        out += '\n';
+        mClientCompositionRequestCache->dump(out);
+    }
+
+    base::StringAppendF(&out,
+                        "\n   Visible regions in last geometry update: %zu recomputed, %zu "
+                        "reused\n",
+                        mLayerVisibilityStats.recomputed, mLayerVisibilityStats.reused);
+
     base::StringAppendF(&out, "\n   %zu Layers\n", getOutputLayerCount());
     for (const auto* outputLayer : getOutputLayersOrderedByZ()) {
         if (!outputLayer) {
@@ -440,10 +465,24 @@ void Output::present(const compositionengine::CompositionRefreshArgs& refreshArg
     ATRACE_FORMAT("%s for %s", __func__, mNamePlusId.c_str());
     ALOGV(__FUNCTION__);
 
+    prepareCompositionState(refreshArgs);
+    finishPresent(refreshArgs);
+}
+
+void Output::prepareCompositionState(const compositionengine::CompositionRefreshArgs& refreshArgs) {
+    ATRACE_FORMAT("%s for %s", __func__, mNamePlusId.c_str());
+    ALOGV(__FUNCTION__);
+
     updateColorProfile(refreshArgs);
     updateCompositionState(refreshArgs);
     planComposition();
     writeCompositionState(refreshArgs);
+}
+
+void Output::finishPresent(const compositionengine::CompositionRefreshArgs& refreshArgs) {
+    ATRACE_FORMAT("%s for %s", __func__, mNamePlusId.c_str());
+    ALOGV(__FUNCTION__);
+
     setColorTransform(refreshArgs);
     beginFrame();
 
@@ -482,13 +521,30 @@ void Output::rebuildLayerStacks(const compositionengine::CompositionRefreshArgs&
         return;
     }
 
+    mGeometryUpdateCount++;
+    mLayerVisibilityStats = {};
+
     // Process the layers to determine visibility and coverage
     compositionengine::Output::CoverageState coverage{layerFESet};
     coverage.aboveCoveredLayersExcludingOverlays = refreshArgs.hasTrustedPresentationListener
             ? std::make_optional<Region>()
             : std::nullopt;
+    coverage.layerStackVisibility = refreshArgs.layerStackVisibility;
     collectVisibleLayers(refreshArgs, coverage);
 
+    // Forget the layers that are no longer on this output. The shared layer stack visibility is
+    // pruned by the CompositionEngine once all outputs have been evaluated.
+    if (!refreshArgs.layerStackVisibility) {
+        mLayerStackVisibility.prune();
+    }
+    for (auto it = mProjectedVisibility.begin(); it != mProjectedVisibility.end();) {
+        if (it->second.geometryUpdate != mGeometryUpdateCount) {
+            it = mProjectedVisibility.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
     // Compute the resulting coverage for this output, and store it for later
     const ui::Transform& tr = outputState.transform;
     Region undefinedRegion{outputState.displaySpace.getBoundsAsRect()};
@@ -560,136 +616,26 @@ void Output::ensureOutputLayerIfVisible(sp<compositionengine::LayerFE>& layerFE,
         return;
     }
 
-    bool computeAboveCoveredExcludingOverlays = coverage.aboveCoveredLayersExcludingOverlays &&
+    const bool computeAboveCoveredExcludingOverlays =
+            coverage.aboveCoveredLayersExcludingOverlays &&
             !layerFEState->outputFilter.toInternalDisplay;
 
-    /*
-     * opaqueRegion: area of a surface that is fully opaque.
-     */
-    Region opaqueRegion;
-
-    /*
-     * visibleRegion: area of a surface that is visible on screen and not fully
-     * transparent. This is essentially the layer's footprint minus the opaque
-     * regions above it. Areas covered by a translucent surface are considered
-     * visible.
-     */
-    Region visibleRegion;
-
-    /*
-     * coveredRegion: area of a surface that is covered by all visible regions
-     * above it (which includes the translucent areas).
-     */
-    Region coveredRegion;
-
-    /*
-     * transparentRegion: area of a surface that is hinted to be completely
-     * transparent.
-     * This is used to tell when the layer has no visible non-transparent
-     * regions and can be removed from the layer list. It does not affect the
-     * visibleRegion of this layer or any layers beneath it. The hint may not
-     * be correct if apps don't respect the SurfaceView restrictions (which,
-     * sadly, some don't).
-     *
-     * In addition, it is used on DISPLAY_DECORATION layers to specify the
-     * blockingRegion, allowing the DPU to skip it to save power. Once we have
-     * hardware that supports a blockingRegion on frames with AFBC, it may be
-     * useful to use this for other layers, too, so long as we can prevent
-     * regressions on b/7179570.
-     */
-    Region transparentRegion;
-
-    /*
-     * shadowRegion: Region cast by the layer's shadow.
-     */
-    Region shadowRegion;
-
-    /**
-     * covered region above excluding internal display overlay layers
-     */
-    std::optional<Region> coveredRegionExcludingDisplayOverlays = std::nullopt;
-
-    const ui::Transform& tr = layerFEState->geomLayerTransform;
-
-    // Get the visible region
-    // TODO(b/121291683): Is it worth creating helper methods on LayerFEState
-    // for computations like this?
-    const Rect visibleRect(tr.transform(layerFEState->geomLayerBounds));
-    visibleRegion.set(visibleRect);
-
-    if (layerFEState->shadowRadius > 0.0f) {
-        // if the layer casts a shadow, offset the layers visible region and
-        // calculate the shadow region.
-        const auto inset = static_cast<int32_t>(ceilf(layerFEState->shadowRadius) * -1.0f);
-        Rect visibleRectWithShadows(visibleRect);
-        visibleRectWithShadows.inset(inset, inset, inset, inset);
-        visibleRegion.set(visibleRectWithShadows);
-        shadowRegion = visibleRegion.subtract(visibleRect);
-    }
-
-    if (visibleRegion.isEmpty()) {
-        return;
-    }
-
-    // Remove the transparent area from the visible region
-    if (!layerFEState->isOpaque) {
-        if (tr.preserveRects()) {
-            // Clip the transparent region to geomLayerBounds first
-            // The transparent region may be influenced by applications, for
-            // instance, by overriding ViewGroup#gatherTransparentRegion with a
-            // custom view. Once the layer stack -> display mapping is known, we
-            // must guard against very wrong inputs to prevent underflow or
-            // overflow errors. We do this here by constraining the transparent
-            // region to be within the pre-transform layer bounds, since the
-            // layer bounds are expected to play nicely with the full
-            // transform.
-            const Region clippedTransparentRegionHint =
-                    layerFEState->transparentRegionHint.intersect(
-                            Rect(layerFEState->geomLayerBounds));
-
-            if (clippedTransparentRegionHint.isEmpty()) {
-                if (!layerFEState->transparentRegionHint.isEmpty()) {
-                    ALOGD("Layer: %s had an out of bounds transparent region",
-                          layerFE->getDebugName());
-                    layerFEState->transparentRegionHint.dump("transparentRegionHint");
-                }
-                transparentRegion.clear();
-            } else {
-                transparentRegion = tr.transform(clippedTransparentRegionHint);
-            }
-        } else {
-            // transformation too complex, can't do the
-            // transparent region optimization.
-            transparentRegion.clear();
-        }
-    }
-
-    // compute the opaque region
-    const auto layerOrientation = tr.getOrientation();
-    if (layerFEState->isOpaque && ((layerOrientation & ui::Transform::ROT_INVALID) == 0)) {
-        // If we one of the simple category of transforms (0/90/180/270 rotation
-        // + any flip), then the opaque region is the layer's footprint.
-        // Otherwise we don't try and compute the opaque region since there may
-        // be errors at the edges, and we treat the entire layer as
-        // translucent.
-        opaqueRegion.set(visibleRect);
-    }
-
-    // Clip the covered region to the visible region
-    coveredRegion = coverage.aboveCoveredLayers.intersect(visibleRegion);
+    LayerStackVisibility& layerStackVisibility =
+            coverage.layerStackVisibility ? *coverage.layerStackVisibility : mLayerStackVisibility;
+    const LayerStackVisibility::Layer& visibility =
+            layerStackVisibility.getLayer(getState().layerFilter, *layerFE, *layerFEState, coverage,
+                                          computeAboveCoveredExcludingOverlays,
+                                          mLayerVisibilityStats);
 
     // Update accumAboveCoveredLayers for next (lower) layer
-    coverage.aboveCoveredLayers.orSelf(visibleRegion);
-
+    coverage.aboveCoveredLayers = visibility.aboveCoveredLayersBelow;
     if (CC_UNLIKELY(computeAboveCoveredExcludingOverlays)) {
-        coveredRegionExcludingDisplayOverlays =
-                coverage.aboveCoveredLayersExcludingOverlays->intersect(visibleRegion);
-        coverage.aboveCoveredLayersExcludingOverlays->orSelf(visibleRegion);
+        coverage.aboveCoveredLayersExcludingOverlays =
+                visibility.aboveCoveredLayersExcludingOverlaysBelow;
     }
 
-    // subtract the opaque region covered by the layers above us
-    visibleRegion.subtractSelf(coverage.aboveOpaqueLayers);
-
+    const Region& visibleRegion = visibility.visibleRegion;
+    const Region& coveredRegion = visibility.coveredRegion;
     if (visibleRegion.isEmpty()) {
         return;
     }
@@ -739,22 +685,15 @@ void Output::ensureOutputLayerIfVisible(sp<compositionengine::LayerFE>& layerFE,
     coverage.dirtyRegion.orSelf(dirty);
 
     // Update accumAboveOpaqueLayers for next (lower) layer
-    coverage.aboveOpaqueLayers.orSelf(opaqueRegion);
-
-    // Compute the visible non-transparent region
-    Region visibleNonTransparentRegion = visibleRegion.subtract(transparentRegion);
+    coverage.aboveOpaqueLayers = visibility.aboveOpaqueLayersBelow;
 
     // Perform the final check to see if this layer is visible on this output
-    // TODO(b/121291683): Why does this not use visibleRegion? (see outputSpaceVisibleRegion below)
-    const auto& outputState = getState();
-    Region drawRegion(outputState.transform.transform(visibleNonTransparentRegion));
-    drawRegion.andSelf(outputState.displaySpace.getBoundsAsRect());
-    if (drawRegion.isEmpty()) {
+    const ProjectedVisibility& projected =
+            getProjectedVisibility(*layerFE, *layerFEState, visibility);
+    if (projected.drawRegionEmpty) {
         return;
     }
 
-    Region visibleNonShadowRegion = visibleRegion.subtract(shadowRegion);
-
     // The layer is visible. Either reuse the existing outputLayer if we have
     // one, or create a new one if we do not.
     auto result = ensureOutputLayer(prevOutputLayerIndex, layerFE);
@@ -763,22 +702,63 @@ void Output::ensureOutputLayerIfVisible(sp<compositionengine::LayerFE>& layerFE,
     // is useful later.
     auto& outputLayerState = result->editState();
     outputLayerState.visibleRegion = visibleRegion;
-    outputLayerState.visibleNonTransparentRegion = visibleNonTransparentRegion;
+    outputLayerState.visibleNonTransparentRegion = visibility.visibleNonTransparentRegion;
     outputLayerState.coveredRegion = coveredRegion;
-    outputLayerState.outputSpaceVisibleRegion = outputState.transform.transform(
-            visibleNonShadowRegion.intersect(outputState.layerStackSpace.getContent()));
-    outputLayerState.shadowRegion = shadowRegion;
-    outputLayerState.outputSpaceBlockingRegionHint =
-            layerFEState->compositionType == Composition::DISPLAY_DECORATION
-            ? outputState.transform.transform(
-                      transparentRegion.intersect(outputState.layerStackSpace.getContent()))
-            : Region();
+    outputLayerState.outputSpaceVisibleRegion = projected.outputSpaceVisibleRegion;
+    outputLayerState.shadowRegion = visibility.shadowRegion;
+    outputLayerState.outputSpaceBlockingRegionHint = projected.outputSpaceBlockingRegionHint;
     if (CC_UNLIKELY(computeAboveCoveredExcludingOverlays)) {
         outputLayerState.coveredRegionExcludingDisplayOverlays =
-                std::move(coveredRegionExcludingDisplayOverlays);
+                visibility.coveredRegionExcludingDisplayOverlays;
     }
 }
 
+const Output::ProjectedVisibility& Output::getProjectedVisibility(
+        const compositionengine::LayerFE& layerFE, const LayerFECompositionState& layerFEState,
+        const LayerStackVisibility::Layer& layer) {
+    const auto& outputState = getState();
+    const bool isDisplayDecoration =
+            layerFEState.compositionType == Composition::DISPLAY_DECORATION;
+
+    auto [it, inserted] = mProjectedVisibility.try_emplace(layerFE.getSequence());
+    ProjectedVisibility& projected = it->second;
+    projected.geometryUpdate = mGeometryUpdateCount;
+
+    // The layer stack space regions are usually carried over from the previous update, or from
+    // another output showing the same layers, so they are trivially equal.
+    if (!inserted && projected.visibleNonTransparentRegion.isTriviallyEqual(
+                             layer.visibleNonTransparentRegion) &&
+        projected.visibleNonShadowRegion.isTriviallyEqual(layer.visibleNonShadowRegion) &&
+        projected.transparentRegion.isTriviallyEqual(layer.transparentRegion) &&
+        projected.isDisplayDecoration == isDisplayDecoration &&
+        projected.outputTransform == outputState.transform &&
+        projected.displayBounds == outputState.displaySpace.getBoundsAsRect() &&
+        projected.layerStackContent == outputState.layerStackSpace.getContent()) {
+        return projected;
+    }
+
+    projected.visibleNonTransparentRegion = layer.visibleNonTransparentRegion;
+    projected.visibleNonShadowRegion = layer.visibleNonShadowRegion;
+    projected.transparentRegion = layer.transparentRegion;
+    projected.isDisplayDecoration = isDisplayDecoration;
+    projected.outputTransform = outputState.transform;
+    projected.displayBounds = outputState.displaySpace.getBoundsAsRect();
+    projected.layerStackContent = outputState.layerStackSpace.getContent();
+
+    // TODO(b/121291683): Why does this not use visibleRegion? (see outputSpaceVisibleRegion below)
+    Region drawRegion(outputState.transform.transform(layer.visibleNonTransparentRegion));
+    drawRegion.andSelf(outputState.displaySpace.getBoundsAsRect());
+    projected.drawRegionEmpty = drawRegion.isEmpty();
+
+    projected.outputSpaceVisibleRegion = outputState.transform.transform(
+            layer.visibleNonShadowRegion.intersect(outputState.layerStackSpace.getContent()));
+    projected.outputSpaceBlockingRegionHint = isDisplayDecoration
+            ? outputState.transform.transform(
+                      layer.transparentRegion.intersect(outputState.layerStackSpace.getContent()))
+            : Region();
+    return projected;
+}
+
 void Output::setReleasedLayers(const compositionengine::CompositionRefreshArgs&) {
     // The base class does nothing with this call.
 }
@@ -1115,6 +1095,7 @@ void Output::prepareFrame() {
     outputState.strategyPrediction = CompositionStrategyPredictionState::DISABLED;
     outputState.previousDeviceRequestedChanges = changes;
     outputState.previousDeviceRequestedSuccess = success;
+    recordCompositionStrategy(changes, success);
     if (success) {
         applyCompositionStrategy(changes);
     }
@@ -1159,6 +1140,11 @@ GpuCompositionResult Output::prepareFrameAsync() {
                                                    : CompositionStrategyPredictionState::FAIL;
     if (!predictionSucceeded) {
         ATRACE_NAME("CompositionStrategyPredictionMiss");
+        state.strategyPredictionMisses++;
+        if (++state.strategyPredictionMissStreak >= kMaxStrategyPredictionMissStreak) {
+            state.strategyPredictionMissStreak = 0;
+            state.strategyPredictionBackoffFrames = kStrategyPredictionBackoffFrames;
+        }
         resetCompositionStrategy();
         if (chooseCompositionSuccess) {
             applyCompositionStrategy(changes);
@@ -1168,7 +1154,10 @@ GpuCompositionResult Output::prepareFrameAsync() {
         compositionResult.buffer = buffer;
     } else {
         ATRACE_NAME("CompositionStrategyPredictionHit");
+        state.strategyPredictionHits++;
+        state.strategyPredictionMissStreak = 0;
     }
+    recordCompositionStrategy(changes, chooseCompositionSuccess);
     state.previousDeviceRequestedChanges = std::move(changes);
     state.previousDeviceRequestedSuccess = chooseCompositionSuccess;
     return compositionResult;
@@ -1310,7 +1299,12 @@ std::optional<base::unique_fd> Output::composeSurfaces(
             generateClientCompositionRequests(supportsProtectedContent,
                                               clientCompositionDisplay.outputDataspace,
                                               clientCompositionLayersFE);
+    const size_t requestCount = clientCompositionLayers.size();
     appendRegionFlashRequests(debugRegion, clientCompositionLayers);
+    clientCompositionDisplay.damage =
+            computeClientTargetDamage(tex->getBuffer()->getId(), clientCompositionDisplay,
+                                      clientCompositionLayers, clientCompositionLayersFE,
+                                      clientCompositionLayers.size() != requestCount);
 
     OutputCompositionState& outputCompositionState = editState();
     // Check if the client composition requests were rendered into the provided graphic buffer. If
@@ -1362,14 +1356,27 @@ std::optional<base::unique_fd> Output::composeSurfaces(
     // over to RenderEngine, in which case this flag can be removed from the drawLayers interface.
     const bool useFramebufferCache = outputState.layerFilter.toInternalDisplay;
 
+    const Rect& drawnRect = clientCompositionDisplay.damage.isValid()
+            ? clientCompositionDisplay.damage
+            : clientCompositionDisplay.clip;
+    outputCompositionState.clientCompositionFrames++;
+    if (clientCompositionDisplay.damage.isValid()) {
+        outputCompositionState.partialClientCompositionFrames++;
+    }
+    outputCompositionState.clientCompositionPixels +=
+            static_cast<uint64_t>(drawnRect.width()) * static_cast<uint64_t>(drawnRect.height());
+
     auto fenceResult = renderEngine
                                .drawLayers(clientCompositionDisplay, clientRenderEngineLayers, tex,
                                            useFramebufferCache, std::move(fd))
                                .get();
 
-    if (mClientCompositionRequestCache && fenceStatus(fenceResult) != NO_ERROR) {
+    if (fenceStatus(fenceResult) != NO_ERROR) {
         // If rendering was not successful, remove the request from the cache.
-        mClientCompositionRequestCache->remove(tex->getBuffer()->getId());
+        if (mClientCompositionRequestCache) {
+            mClientCompositionRequestCache->remove(tex->getBuffer()->getId());
+        }
+        mPendingClientTargetComposition->contentValid = false;
     }
 
     const auto fence = std::move(fenceResult).value_or(Fence::NO_FENCE);
@@ -1448,16 +1455,7 @@ std::vector<LayerFE::LayerSettings> Output::generateClientCompositionRequests(
         const auto* layerFEState = layer->getLayerFE().getCompositionState();
         auto& layerFE = layer->getLayerFE();
         layerFE.setWasClientComposed(nullptr);
-
-        const Region clip(viewportRegion.intersect(layerState.visibleRegion));
         ALOGV("Layer: %s", layerFE.getDebugName());
-        if (clip.isEmpty()) {
-            ALOGV("  Skipping for empty clip");
-            firstLayer = false;
-            continue;
-        }
-
-        disableBlurs |= layerFEState->sidebandStream != nullptr;
 
         const bool clientComposition = layer->requiresClientComposition();
 
@@ -1469,12 +1467,33 @@ std::vector<LayerFE::LayerSettings> Output::generateClientCompositionRequests(
         const bool clearClientComposition =
                 layerState.clearClientTarget && layerFEState->isOpaque && !firstLayer;
 
+        // Most layers are composed by the HWC, in which case there is nothing to prepare and
+        // the clip does not need to be computed, unless the layer disables blurs for the layers
+        // above it.
+        const bool hasSidebandStream = layerFEState->sidebandStream != nullptr;
+        if (!clientComposition && !clearClientComposition && !hasSidebandStream) {
+            ALOGV("  Skipping device composited layer");
+            firstLayer = false;
+            continue;
+        }
+
+        const Region clip(viewportRegion.intersect(layerState.visibleRegion));
+        if (clip.isEmpty()) {
+            ALOGV("  Skipping for empty clip");
+            firstLayer = false;
+            continue;
+        }
+
+        disableBlurs |= hasSidebandStream;
+
         ALOGV("  Composition type: client %d clear %d", clientComposition, clearClientComposition);
 
         // If the layer casts a shadow but the content casting the shadow is occluded, skip
         // composing the non-shadow content and only draw the shadows.
         const bool realContentIsVisible = clientComposition &&
-                !layerState.visibleRegion.subtract(layerState.shadowRegion).isEmpty();
+                (layerState.shadowRegion.isEmpty()
+                         ? !layerState.visibleRegion.isEmpty()
+                         : !layerState.visibleRegion.subtract(layerState.shadowRegion).isEmpty());
 
         if (clientComposition || clearClientComposition) {
             if (auto overrideSettings = layer->getOverrideCompositionSettings()) {
@@ -1564,6 +1583,7 @@ void Output::postFramebuffer() {
         return;
     }
 
+    recordClientTargetDamage();
     auto& outputState = editState();
     outputState.dirtyRegion.clear();
 
@@ -1650,6 +1670,7 @@ void Output::setPredictCompositionStrategy(bool predict) {
         mHwComposerAsyncWorker = std::make_unique<HwcAsyncWorker>();
     } else {
         mHwComposerAsyncWorker.reset(nullptr);
+        mCompositionStrategyHistory.clear();
     }
 }
 
@@ -1672,6 +1693,12 @@ bool Output::canPredictCompositionStrategy(const CompositionRefreshArgs& refresh
         return false;
     }
 
+    if (getState().strategyPredictionBackoffFrames > 0) {
+        ALOGV("canPredictCompositionStrategy backing off after repeated misses");
+        editState().strategyPredictionBackoffFrames--;
+        return false;
+    }
+
     if (!mRenderSurface->supportsCompositionStrategyPrediction()) {
         ALOGV("canPredictCompositionStrategy surface does not support");
         return false;
@@ -1682,11 +1709,6 @@ bool Output::canPredictCompositionStrategy(const CompositionRefreshArgs& refresh
         return false;
     }
 
-    if (lastOutputLayerHash != outputLayerHash) {
-        ALOGV("canPredictCompositionStrategy output layers changed");
-        return false;
-    }
-
     // If no layer uses clientComposition, then don't predict composition strategy
     // because we have less work to do in parallel.
     if (!anyLayersRequireClientComposition()) {
@@ -1694,9 +1716,134 @@ bool Output::canPredictCompositionStrategy(const CompositionRefreshArgs& refresh
         return false;
     }
 
+    if (lastOutputLayerHash != outputLayerHash && !restoreCompositionStrategy(outputLayerHash)) {
+        ALOGV("canPredictCompositionStrategy output layers changed");
+        return false;
+    }
+
     return true;
 }
 
+void Output::recordCompositionStrategy(const std::optional<DeviceRequestedChanges>& changes,
+                                       bool success) {
+    if (!mHwComposerAsyncWorker) {
+        return;
+    }
+
+    const uint64_t outputLayerHash = getState().outputLayerHash;
+    auto& history = mCompositionStrategyHistory;
+    history.erase(std::remove_if(history.begin(), history.end(),
+                                 [&](const auto& entry) {
+                                     return entry.outputLayerHash == outputLayerHash;
+                                 }),
+                  history.end());
+    if (!success || !changes) {
+        return;
+    }
+
+    if (history.size() == kCompositionStrategyHistorySize) {
+        history.erase(history.begin());
+    }
+    history.push_back({outputLayerHash, *changes});
+}
+
+bool Output::restoreCompositionStrategy(uint64_t outputLayerHash) {
+    const auto it = std::find_if(mCompositionStrategyHistory.begin(),
+                                 mCompositionStrategyHistory.end(), [&](const auto& entry) {
+                                     return entry.outputLayerHash == outputLayerHash;
+                                 });
+    if (it == mCompositionStrategyHistory.end()) {
+        return false;
+    }
+
+    auto& state = editState();
+    state.previousDeviceRequestedChanges = it->changes;
+    state.previousDeviceRequestedSuccess = true;
+    state.strategyPredictionsFromHistory++;
+    return true;
+}
+
+Rect Output::computeClientTargetDamage(uint64_t bufferId,
+                                       const renderengine::DisplaySettings& display,
+                                       const std::vector<LayerFE::LayerSettings>& layers,
+                                       const std::vector<LayerFE*>& layerFEs, bool flashing) {
+    const auto& outputState = getState();
+    const Rect& content = outputState.layerStackSpace.getContent();
+
+    // The dirty region only tracks changes of the layers themselves. A layer that switches
+    // between client and device composition, or a display setting change, can change every pixel
+    // of the client target. Blurs depend on everything below them, so they may change outside of
+    // the dirty region as well.
+    const bool contentChanged = flashing || display != mLastClientTargetDisplay ||
+            !std::equal(layerFEs.begin(), layerFEs.end(), mLastClientTargetLayers.begin(),
+                        mLastClientTargetLayers.end()) ||
+            std::any_of(layers.begin(), layers.end(), [](const auto& layer) {
+                return layer.backgroundBlurRadius > 0 || !layer.blurRegions.empty();
+            });
+    // A buffer that is composed into twice in the same frame, after a failed composition strategy
+    // prediction, holds a composition that is not in the history.
+    const bool composedThisFrame = mPendingClientTargetComposition &&
+            mPendingClientTargetComposition->bufferId == bufferId;
+
+    const Region dirty = getDirtyRegion();
+    mPendingClientTargetComposition = ClientTargetComposition{
+            .bufferId = bufferId,
+            .contentValid = !flashing,
+            .damage = contentChanged ? Region(content) : dirty,
+            .display = display,
+            .layers = std::vector<const LayerFE*>(layerFEs.begin(), layerFEs.end()),
+    };
+
+    // Only the buffers of internal displays are known to be left untouched by their consumer.
+    if (!outputState.layerFilter.toInternalDisplay || contentChanged || composedThisFrame) {
+        return Rect::INVALID_RECT;
+    }
+
+    const auto& history = mClientTargetDamageHistory;
+    const auto lastComposition =
+            std::find_if(history.rbegin(), history.rend(),
+                         [bufferId](const auto& entry) { return entry.bufferId == bufferId; });
+    if (lastComposition == history.rend()) {
+        return Rect::INVALID_RECT;
+    }
+
+    Region damage = dirty;
+    for (auto entry = history.rbegin(); entry != lastComposition; ++entry) {
+        damage.orSelf(entry->damage);
+    }
+    return damage.intersect(content).getBounds();
+}
+
+void Output::recordClientTargetDamage() {
+    auto& history = mClientTargetDamageHistory;
+    ClientTargetDamageEntry entry{.bufferId = 0, .damage = getDirtyRegion()};
+    if (mPendingClientTargetComposition) {
+        auto& composition = *mPendingClientTargetComposition;
+        if (composition.contentValid) {
+            entry.bufferId = composition.bufferId;
+        } else {
+            // Whatever was composed into the buffer before is gone.
+            for (auto& previousEntry : history) {
+                if (previousEntry.bufferId == composition.bufferId) {
+                    previousEntry.bufferId = 0;
+                }
+            }
+        }
+        entry.damage = std::move(composition.damage);
+        mLastClientTargetDisplay = std::move(composition.display);
+        mLastClientTargetLayers = std::move(composition.layers);
+        mPendingClientTargetComposition.reset();
+    } else {
+        mLastClientTargetDisplay = {};
+        mLastClientTargetLayers.clear();
+    }
+
+    if (history.size() == kClientTargetDamageHistorySize) {
+        history.erase(history.begin());
+    }
+    history.push_back(std::move(entry));
+}
+
 bool Output::anyLayersRequireClientComposition() const {
     const auto layers = getOutputLayersOrderedByZ();
     return std::any_of(layers.begin(), layers.end(),
@@ -64,6 +64,17 @@ void OutputCompositionState::dump(std::string& out) const {
     dumpVal(out, "displayBrightness", displayBrightness);
     out.append("\n   ");
     dumpVal(out, "compositionStrategyPredictionState", ftl::enum_string(strategyPrediction));
+    dumpVal(out, "strategyPredictionMissStreak", strategyPredictionMissStreak);
+    dumpVal(out, "strategyPredictionBackoffFrames", strategyPredictionBackoffFrames);
+    out.append("\n   ");
+    dumpVal(out, "strategyPredictionHits", strategyPredictionHits);
+    dumpVal(out, "strategyPredictionMisses", strategyPredictionMisses);
+    dumpVal(out, "strategyPredictionsFromHistory", strategyPredictionsFromHistory);
+    out.append("\n   ");
+    dumpVal(out, "clientCompositionFrames", clientCompositionFrames);
+    dumpVal(out, "partialClientCompositionFrames", partialClientCompositionFrames);
+    dumpVal(out, "averageClientCompositionPixels",
+            clientCompositionFrames ? clientCompositionPixels / clientCompositionFrames : 0);
     out.append("\n   ");
 
     out.append("\n   ");
@@ -178,6 +178,8 @@ void CachedSet::render(renderengine::RenderEngine& renderEngine, TexturePool& te
             .deviceHandlesColorTransform = deviceHandlesColorTransform,
             .orientation = orientation,
             .targetLuminanceNits = outputState.displayBrightnessNits,
+            // No frame waits on a cached set, it is only used once rendered.
+            .renderInBackground = true,
     };
 
     LayerFE::ClientCompositionTargetSettings
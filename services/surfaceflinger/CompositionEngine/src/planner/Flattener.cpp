@@ -25,6 +25,8 @@
 
 #include <gui/TraceUtils.h>
 
+#include <algorithm>
+
 using time_point = std::chrono::steady_clock::time_point;
 using namespace std::chrono_literals;
 
@@ -89,6 +91,10 @@ NonBufferHash Flattener::flattenLayers(const std::vector<const LayerState*>& lay
 
     ++mFinalLayerCounts[mLayers.size()];
 
+    if (now - std::max(mLastGeometryUpdate, mLastCachedSetCreation) > kTexturePoolIdleTimeout) {
+        mTexturePool.releaseIdleTextures();
+    }
+
     if (alreadyHadCachedSets) {
         buildCachedSets(now);
         hash = computeLayersHash();
@@ -188,6 +194,8 @@ void Flattener::dump(std::string& result) const {
     base::StringAppendF(&result, "\n    Cached sets created: %zd\n", mCachedSetCreationCount);
     base::StringAppendF(&result, "    Cost: %.2f\n",
                         static_cast<float>(mCachedSetCreationCost) / displayArea);
+    base::StringAppendF(&result, "    Created for settled geometries: %zd (%zd remembered)\n",
+                        mSettledCachedSetCreationCount, mSettledGeometries.size());
 
     const auto lastUpdate =
             std::chrono::duration_cast<std::chrono::milliseconds>(now - mLastGeometryUpdate);
@@ -338,6 +346,7 @@ bool Flattener::mergeWithCachedSets(const std::vector<const LayerState*>& layers
                 priorBlurLayer = mNewCachedSet->getBlurLayer();
                 merged.emplace_back(std::move(*mNewCachedSet));
                 mNewCachedSet = std::nullopt;
+                recordSettledGeometry();
                 continue;
             }
         }
@@ -402,8 +411,33 @@ bool Flattener::mergeWithCachedSets(const std::vector<const LayerState*>& layers
     return true;
 }
 
+void Flattener::recordSettledGeometry() {
+    if (!mTunables.mSettledActiveLayerTimeout) {
+        return;
+    }
+
+    if (const auto it = std::find(mSettledGeometries.begin(), mSettledGeometries.end(),
+                                  mCurrentGeometry);
+        it != mSettledGeometries.end()) {
+        mSettledGeometries.erase(it);
+    } else if (mSettledGeometries.size() == kMaxSettledGeometries) {
+        mSettledGeometries.erase(mSettledGeometries.begin());
+    }
+    mSettledGeometries.push_back(mCurrentGeometry);
+}
+
+std::chrono::milliseconds Flattener::getActiveLayerTimeout() const {
+    if (mTunables.mSettledActiveLayerTimeout &&
+        std::find(mSettledGeometries.begin(), mSettledGeometries.end(), mCurrentGeometry) !=
+                mSettledGeometries.end()) {
+        return std::min(*mTunables.mSettledActiveLayerTimeout, mTunables.mActiveLayerTimeout);
+    }
+    return mTunables.mActiveLayerTimeout;
+}
+
 std::vector<Flattener::Run> Flattener::findCandidateRuns(time_point now) const {
     ATRACE_CALL();
+    const std::chrono::milliseconds activeLayerTimeout = getActiveLayerTimeout();
     std::vector<Run> runs;
     bool isPartOfRun = false;
     Run::Builder builder;
@@ -411,7 +445,7 @@ std::vector<Flattener::Run> Flattener::findCandidateRuns(time_point now) const {
     bool runHasFirstLayer = false;
 
     for (auto currentSet = mLayers.cbegin(); currentSet != mLayers.cend(); ++currentSet) {
-        bool layerIsInactive = now - currentSet->getLastUpdate() > mTunables.mActiveLayerTimeout;
+        bool layerIsInactive = now - currentSet->getLastUpdate() > activeLayerTimeout;
         const bool layerHasBlur = currentSet->hasBlurBehind();
         const bool layerDeniedFromCaching = currentSet->cachingHintExcludesLayers();
 
@@ -541,6 +575,10 @@ void Flattener::buildCachedSets(time_point now) {
 
     ++mCachedSetCreationCount;
     mCachedSetCreationCost += mNewCachedSet->getCreationCost();
+    mLastCachedSetCreation = now;
+    if (getActiveLayerTimeout() != mTunables.mActiveLayerTimeout) {
+        ++mSettledCachedSetCreationCount;
+    }
 
     // note the compiler should strip the follow no-op statements when ALOGV is off
     const auto dumper = [&] {
@@ -61,10 +61,16 @@ Flattener::Tunables buildFlattenerTuneables() {
     const auto enableHolePunch =
             base::GetBoolProperty(std::string("debug.sf.enable_hole_punch_pip"),
                                   Flattener::Tunables::kDefaultEnableHolePunch);
+    const auto settledActiveLayerTimeout = std::chrono::milliseconds(base::GetIntProperty<
+            int32_t>(std::string("debug.sf.layer_caching_settled_active_layer_timeout_ms"),
+                     Flattener::Tunables::kDefaultSettledActiveLayerTimeout.count()));
     return Flattener::Tunables{
             .mActiveLayerTimeout = activeLayerTimeout,
             .mRenderScheduling = buildRenderSchedulingTunables(),
             .mEnableHolePunch = enableHolePunch,
+            .mSettledActiveLayerTimeout = settledActiveLayerTimeout > 0ms
+                    ? std::make_optional(settledActiveLayerTimeout)
+                    : std::nullopt,
     };
 }
 
@@ -44,7 +44,9 @@ void TexturePool::setDisplaySize(ui::Size size) {
 }
 
 std::shared_ptr<TexturePool::AutoTexture> TexturePool::borrowTexture() {
+    ++mBorrowedCount;
     if (mPool.empty()) {
+        ++mStarvedCount;
         return std::make_shared<AutoTexture>(*this, genTexture(), nullptr);
     }
 
@@ -67,6 +69,7 @@ void TexturePool::returnTexture(std::shared_ptr<renderengine::ExternalTexture>&&
               "current: (%dx%d))",
               texture->getBuffer()->getWidth(), texture->getBuffer()->getHeight(), mSize.getWidth(),
               mSize.getHeight());
+        ++mDroppedCount;
         return;
     }
 
@@ -74,6 +77,7 @@ void TexturePool::returnTexture(std::shared_ptr<renderengine::ExternalTexture>&&
     if (mPool.size() == kMaxPoolSize) {
         ALOGD("Deallocating texture from Planner's pool - max size [%" PRIu64 "] reached",
               static_cast<uint64_t>(kMaxPoolSize));
+        ++mDroppedCount;
         return;
     }
 
@@ -82,6 +86,7 @@ void TexturePool::returnTexture(std::shared_ptr<renderengine::ExternalTexture>&&
 
 std::shared_ptr<renderengine::ExternalTexture> TexturePool::genTexture() {
     LOG_ALWAYS_FATAL_IF(!mSize.isValid(), "Attempted to generate texture with invalid size");
+    ++mAllocatedCount;
     return std::make_shared<
             renderengine::impl::
                     ExternalTexture>(sp<GraphicBuffer>::
@@ -103,10 +108,24 @@ void TexturePool::setEnabled(bool enabled) {
     allocatePool();
 }
 
+void TexturePool::releaseIdleTextures() {
+    if (mPool.empty()) {
+        return;
+    }
+    ALOGV("Deallocating %zu idle textures from Planner's pool", mPool.size());
+    mReleasedIdleCount += mPool.size();
+    mPool.clear();
+}
+
 void TexturePool::dump(std::string& out) const {
     base::StringAppendF(&out,
                         "TexturePool (%s) has %zu buffers of size [%" PRId32 ", %" PRId32 "]\n",
                         mEnabled ? "enabled" : "disabled", mPool.size(), mSize.width, mSize.height);
+    base::StringAppendF(&out,
+                        "  allocated: %zu borrowed: %zu (starved: %zu) released idle: %zu "
+                        "dropped: %zu\n",
+                        mAllocatedCount, mBorrowedCount, mStarvedCount, mReleasedIdleCount,
+                        mDroppedCount);
 }
 
 } // namespace android::compositionengine::impl::planner
\ No newline at end of file
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/impl/ClientCompositionRequestCache.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace android::compositionengine {
+namespace {
+
+using testing::HasSubstr;
+
+constexpr uint64_t kBufferId = 1;
+constexpr uint64_t kOtherBufferId = 2;
+
+class ClientCompositionRequestCacheTest : public testing::Test {
+public:
+    ClientCompositionRequestCacheTest() {
+        mLayer.geometry.boundaries = FloatRect{1, 2, 3, 4};
+        mLayer.bufferId = 42;
+        mLayer.frameNumber = 7;
+    }
+
+protected:
+    impl::ClientCompositionRequestCache mCache{2};
+    renderengine::DisplaySettings mDisplay;
+    LayerFE::LayerSettings mLayer;
+};
+
+TEST_F(ClientCompositionRequestCacheTest, matchesRequestsRenderedIntoTheSameBuffer) {
+    EXPECT_FALSE(mCache.exists(kBufferId, mDisplay, {mLayer}));
+    mCache.add(kBufferId, mDisplay, {mLayer});
+
+    EXPECT_TRUE(mCache.exists(kBufferId, mDisplay, {mLayer}));
+    EXPECT_FALSE(mCache.exists(kOtherBufferId, mDisplay, {mLayer}));
+
+    LayerFE::LayerSettings newFrame = mLayer;
+    newFrame.frameNumber++;
+    EXPECT_FALSE(mCache.exists(kBufferId, mDisplay, {newFrame}));
+
+    mCache.remove(kBufferId);
+    EXPECT_FALSE(mCache.exists(kBufferId, mDisplay, {mLayer}));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, evictsOldestBuffer) {
+    mCache.add(kBufferId, mDisplay, {mLayer});
+    mCache.add(kOtherBufferId, mDisplay, {mLayer});
+    mCache.add(kOtherBufferId + 1, mDisplay, {mLayer});
+
+    EXPECT_FALSE(mCache.exists(kBufferId, mDisplay, {mLayer}));
+    EXPECT_TRUE(mCache.exists(kOtherBufferId, mDisplay, {mLayer}));
+    EXPECT_TRUE(mCache.exists(kOtherBufferId + 1, mDisplay, {mLayer}));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, dumpsHitsAndMisses) {
+    mCache.add(kBufferId, mDisplay, {mLayer});
+    EXPECT_TRUE(mCache.exists(kBufferId, mDisplay, {mLayer}));
+    EXPECT_TRUE(mCache.exists(kBufferId, mDisplay, {mLayer}));
+    EXPECT_TRUE(mCache.exists(kBufferId, mDisplay, {mLayer}));
+    EXPECT_FALSE(mCache.exists(kOtherBufferId, mDisplay, {mLayer}));
+
+    std::string dump;
+    mCache.dump(dump);
+    EXPECT_THAT(dump, HasSubstr("1/2 entries, 3 hits, 1 misses (75.0% hit rate)"));
+}
+
+} // namespace
+} // namespace android::compositionengine
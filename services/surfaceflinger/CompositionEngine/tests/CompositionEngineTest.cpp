@@ -31,11 +31,13 @@ namespace {
 
 using ::testing::_;
 using ::testing::DoAll;
+using ::testing::Expectation;
 using ::testing::InSequence;
 using ::testing::Ref;
 using ::testing::Return;
 using ::testing::ReturnRef;
 using ::testing::SaveArg;
+using ::testing::Sequence;
 using ::testing::StrictMock;
 
 struct CompositionEngineTest : public testing::Test {
@@ -116,6 +118,41 @@ TEST_F(CompositionEnginePresentTest, worksAsExpected) {
     mEngine.present(mRefreshArgs);
 }
 
+TEST_F(CompositionEnginePresentTest, parallelOutputCompositionPresentsInOrder) {
+    EXPECT_CALL(mEngine, preComposition(Ref(mRefreshArgs)));
+
+    EXPECT_CALL(*mOutput1, prepare(Ref(mRefreshArgs), _));
+    EXPECT_CALL(*mOutput2, prepare(Ref(mRefreshArgs), _));
+    EXPECT_CALL(*mOutput3, prepare(Ref(mRefreshArgs), _));
+
+    // The composition state of each output can be prepared in any order, but all of them must
+    // be prepared before any output is presented.
+    Expectation prepared1 = EXPECT_CALL(*mOutput1, prepareCompositionState(Ref(mRefreshArgs)));
+    Expectation prepared2 = EXPECT_CALL(*mOutput2, prepareCompositionState(Ref(mRefreshArgs)));
+    Expectation prepared3 = EXPECT_CALL(*mOutput3, prepareCompositionState(Ref(mRefreshArgs)));
+
+    Sequence presentSequence;
+    EXPECT_CALL(*mOutput1, finishPresent(Ref(mRefreshArgs)))
+            .After(prepared1, prepared2, prepared3)
+            .InSequence(presentSequence);
+    EXPECT_CALL(*mOutput2, finishPresent(Ref(mRefreshArgs))).InSequence(presentSequence);
+    EXPECT_CALL(*mOutput3, finishPresent(Ref(mRefreshArgs))).InSequence(presentSequence);
+
+    mRefreshArgs.parallelOutputComposition = true;
+    mRefreshArgs.outputs = {mOutput1, mOutput2, mOutput3};
+    mEngine.present(mRefreshArgs);
+}
+
+TEST_F(CompositionEnginePresentTest, parallelOutputCompositionWithSingleOutputPresents) {
+    EXPECT_CALL(mEngine, preComposition(Ref(mRefreshArgs)));
+    EXPECT_CALL(*mOutput1, prepare(Ref(mRefreshArgs), _));
+    EXPECT_CALL(*mOutput1, present(Ref(mRefreshArgs)));
+
+    mRefreshArgs.parallelOutputComposition = true;
+    mRefreshArgs.outputs = {mOutput1};
+    mEngine.present(mRefreshArgs);
+}
+
 /*
  * CompositionEngine::updateCursorAsync
  */
@@ -19,6 +19,8 @@
 #include <gui/BufferQueue.h>
 #include <ui/GraphicBuffer.h>
 
+#include <vector>
+
 namespace android::compositionengine {
 namespace {
 
@@ -85,6 +87,56 @@ TEST_F(HwcBufferCacheTest, getHwcSlotAndBuffer_whenSlotsFull_evictsOldestCachedB
     EXPECT_EQ(cache.uncache(graphicBuffers[0]->getId()), UINT32_MAX);
 }
 
+TEST_F(HwcBufferCacheTest, getHwcSlotAndBuffer_whenCyclingMoreBuffersThanSlots_missesOncePerCycle) {
+    HwcBufferCache cache;
+
+    // A producer that cycles through one more buffer than there are slots.
+    constexpr size_t kRingSize = HwcBufferCache::kOverrideBufferSlot + 1;
+    std::vector<sp<GraphicBuffer>> graphicBuffers;
+    for (size_t i = 0; i < kRingSize; ++i) {
+        graphicBuffers.push_back(
+                sp<GraphicBuffer>::make(1u, 1u, HAL_PIXEL_FORMAT_RGBA_8888, 1u, 0u));
+        cache.getHwcSlotAndBuffer(graphicBuffers.back());
+    }
+
+    for (int cycle = 0; cycle < 3; ++cycle) {
+        int misses = 0;
+        for (const auto& buffer : graphicBuffers) {
+            if (cache.getHwcSlotAndBuffer(buffer).buffer != nullptr) {
+                ++misses;
+            }
+        }
+        EXPECT_LE(misses, 2);
+    }
+}
+
+TEST_F(HwcBufferCacheTest, getHwcSlotAndBuffer_whenSlotsFull_evictsOlderGenerationFirst) {
+    HwcBufferCache cache;
+
+    sp<GraphicBuffer> staleBuffer =
+            sp<GraphicBuffer>::make(1u, 1u, HAL_PIXEL_FORMAT_RGBA_8888, 1u, 0u);
+    staleBuffer->setGenerationNumber(1);
+    const HwcSlotAndBuffer staleSlotAndBuffer = cache.getHwcSlotAndBuffer(staleBuffer);
+
+    std::vector<sp<GraphicBuffer>> graphicBuffers;
+    for (size_t i = 1; i < HwcBufferCache::kOverrideBufferSlot; ++i) {
+        graphicBuffers.push_back(
+                sp<GraphicBuffer>::make(1u, 1u, HAL_PIXEL_FORMAT_RGBA_8888, 1u, 0u));
+        graphicBuffers.back()->setGenerationNumber(2);
+        cache.getHwcSlotAndBuffer(graphicBuffers.back());
+    }
+
+    // The stale buffer is the most recently used one, but is evicted anyway.
+    cache.getHwcSlotAndBuffer(staleBuffer);
+
+    sp<GraphicBuffer> newBuffer =
+            sp<GraphicBuffer>::make(1u, 1u, HAL_PIXEL_FORMAT_RGBA_8888, 1u, 0u);
+    newBuffer->setGenerationNumber(2);
+    EXPECT_EQ(cache.getHwcSlotAndBuffer(newBuffer).slot, staleSlotAndBuffer.slot);
+    EXPECT_EQ(cache.uncache(staleBuffer->getId()), UINT32_MAX);
+    EXPECT_NE(cache.uncache(graphicBuffers.front()->getId()), UINT32_MAX);
+}
+
 TEST_F(HwcBufferCacheTest, uncache_whenCached_returnsSlotNumber) {
     HwcBufferCache cache;
     sp<GraphicBuffer> outBuffer;
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/LayerFECompositionState.h>
+#include <compositionengine/LayerStackVisibility.h>
+#include <compositionengine/mock/LayerFE.h>
+#include <gtest/gtest.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+
+#include "RegionMatcher.h"
+
+namespace android::compositionengine {
+namespace {
+
+using testing::Return;
+using testing::StrictMock;
+
+constexpr ui::LayerFilter kLayerFilter{ui::LayerStack{1u}, false};
+constexpr ui::LayerFilter kInternalLayerFilter{ui::LayerStack{1u}, true};
+
+struct TestLayer {
+    explicit TestLayer(int32_t sequence, const Rect& bounds) {
+        EXPECT_CALL(*layerFE, getSequence()).WillRepeatedly(Return(sequence));
+        EXPECT_CALL(*layerFE, getDebugName()).WillRepeatedly(Return("TestLayer"));
+
+        layerFEState.isVisible = true;
+        layerFEState.isOpaque = true;
+        layerFEState.geomLayerBounds = bounds.toFloatRect();
+    }
+
+    sp<StrictMock<mock::LayerFE>> layerFE = sp<StrictMock<mock::LayerFE>>::make();
+    LayerFECompositionState layerFEState;
+};
+
+class LayerStackVisibilityTest : public testing::Test {
+protected:
+    // Evaluates the layers from front to back, like an output does.
+    void evaluate(ui::LayerFilter filter) {
+        Output::CoverageState coverage{mLatchedLayers};
+        for (TestLayer* layer : {&mTop, &mBottom}) {
+            const auto& visibility = mVisibility.getLayer(filter, *layer->layerFE,
+                                                          layer->layerFEState, coverage, false,
+                                                          mStats);
+            coverage.aboveCoveredLayers = visibility.aboveCoveredLayersBelow;
+            coverage.aboveOpaqueLayers = visibility.aboveOpaqueLayersBelow;
+        }
+    }
+
+    const LayerStackVisibility::Layer& getBottom(ui::LayerFilter filter) {
+        Output::CoverageState coverage{mLatchedLayers};
+        const auto& top = mVisibility.getLayer(filter, *mTop.layerFE, mTop.layerFEState, coverage,
+                                               false, mStats);
+        coverage.aboveCoveredLayers = top.aboveCoveredLayersBelow;
+        coverage.aboveOpaqueLayers = top.aboveOpaqueLayersBelow;
+        return mVisibility.getLayer(filter, *mBottom.layerFE, mBottom.layerFEState, coverage, false,
+                                    mStats);
+    }
+
+    LayerFESet mLatchedLayers;
+    LayerStackVisibility mVisibility;
+    LayerStackVisibility::Stats mStats;
+
+    TestLayer mTop{1, Rect(0, 0, 100, 100)};
+    TestLayer mBottom{2, Rect(0, 0, 200, 200)};
+};
+
+TEST_F(LayerStackVisibilityTest, computesVisibleAndCoveredRegions) {
+    const auto& bottom = getBottom(kLayerFilter);
+
+    const Region expectedVisible = Region(Rect(0, 0, 200, 200)).subtract(Rect(0, 0, 100, 100));
+    EXPECT_THAT(bottom.visibleRegion, RegionEq(expectedVisible));
+    EXPECT_THAT(bottom.coveredRegion, RegionEq(Region(Rect(0, 0, 100, 100))));
+    EXPECT_THAT(bottom.aboveOpaqueLayersBelow, RegionEq(Region(Rect(0, 0, 200, 200))));
+    EXPECT_EQ(2u, mStats.recomputed);
+}
+
+TEST_F(LayerStackVisibilityTest, sharesVisibilityBetweenOutputsWithSameFilter) {
+    evaluate(kLayerFilter);
+    EXPECT_EQ(2u, mStats.recomputed);
+
+    // A mirrored output evaluates the same layers.
+    evaluate(kLayerFilter);
+    EXPECT_EQ(2u, mStats.recomputed);
+    EXPECT_EQ(2u, mStats.reused);
+
+    // An output with a different filter does not.
+    evaluate(kInternalLayerFilter);
+    EXPECT_EQ(4u, mStats.recomputed);
+    EXPECT_EQ(4u, mVisibility.getLayerCount());
+}
+
+TEST_F(LayerStackVisibilityTest, recomputesFromChangedLayerUntilCoverageConverges) {
+    evaluate(kLayerFilter);
+    const Region previousBelow = getBottom(kLayerFilter).aboveOpaqueLayersBelow;
+    EXPECT_EQ(2u, mStats.reused);
+
+    // Moving the top layer within the bottom one changes the visible region of the bottom layer,
+    // but not the coverage it leaves for the layers below it.
+    mTop.layerFEState.geomLayerBounds = Rect(50, 50, 150, 150).toFloatRect();
+    const auto& bottom = getBottom(kLayerFilter);
+    EXPECT_EQ(4u, mStats.recomputed);
+
+    const Region expectedVisible = Region(Rect(0, 0, 200, 200)).subtract(Rect(50, 50, 150, 150));
+    EXPECT_THAT(bottom.visibleRegion, RegionEq(expectedVisible));
+    EXPECT_TRUE(bottom.aboveOpaqueLayersBelow.isTriviallyEqual(previousBelow));
+}
+
+TEST_F(LayerStackVisibilityTest, pruneForgetsLayersNotRequested) {
+    evaluate(kLayerFilter);
+    mVisibility.prune();
+    EXPECT_EQ(2u, mVisibility.getLayerCount());
+
+    Output::CoverageState coverage{mLatchedLayers};
+    mVisibility.getLayer(kLayerFilter, *mTop.layerFE, mTop.layerFEState, coverage, false, mStats);
+    mVisibility.prune();
+    EXPECT_EQ(1u, mVisibility.getLayerCount());
+}
+
+} // namespace
+} // namespace android::compositionengine
@@ -50,6 +50,7 @@ using testing::DoAll;
 using testing::ElementsAre;
 using testing::ElementsAreArray;
 using testing::Eq;
+using testing::Field;
 using testing::InSequence;
 using testing::Invoke;
 using testing::IsEmpty;
@@ -1007,6 +1008,45 @@ TEST_F(OutputPrepareFrameTest, delegatesToChooseCompositionStrategyAndRenderSurf
     EXPECT_EQ(mOutput.getState().strategyPrediction, CompositionStrategyPredictionState::DISABLED);
 }
 
+TEST_F(OutputPrepareFrameTest, predictsStrategyOfRecentlySeenLayerStack) {
+    mOutput.setPredictCompositionStrategy(true);
+    mOutput.editState().isEnabled = true;
+
+    StrictMock<mock::OutputLayer> layer;
+    EXPECT_CALL(layer, requiresClientComposition()).WillRepeatedly(Return(true));
+    EXPECT_CALL(mOutput, getOutputLayerCount()).WillRepeatedly(Return(1u));
+    EXPECT_CALL(mOutput, getOutputLayerOrderedByZByIndex(0)).WillRepeatedly(Return(&layer));
+    EXPECT_CALL(*mRenderSurface, supportsCompositionStrategyPrediction())
+            .WillRepeatedly(Return(true));
+    EXPECT_CALL(*mRenderSurface, prepareFrame(_, _)).Times(2);
+    EXPECT_CALL(mOutput, resetCompositionStrategy()).Times(2);
+
+    auto firstChanges = std::make_optional<android::HWComposer::DeviceRequestedChanges>({});
+    firstChanges->displayRequests = static_cast<hal::DisplayRequest>(1);
+    auto secondChanges = std::make_optional<android::HWComposer::DeviceRequestedChanges>({});
+    EXPECT_CALL(mOutput, chooseCompositionStrategy(_))
+            .WillOnce(DoAll(SetArgPointee<0>(firstChanges), Return(true)))
+            .WillOnce(DoAll(SetArgPointee<0>(secondChanges), Return(true)));
+
+    mOutput.editState().outputLayerHash = 1;
+    mOutput.prepareFrame();
+    mOutput.editState().outputLayerHash = 2;
+    mOutput.prepareFrame();
+    EXPECT_EQ(secondChanges, mOutput.getState().previousDeviceRequestedChanges);
+
+    // Going back to the first layer stack predicts the strategy HWC chose for it.
+    CompositionRefreshArgs args;
+    mOutput.editState().lastOutputLayerHash = 2;
+    mOutput.editState().outputLayerHash = 1;
+    EXPECT_TRUE(mOutput.canPredictCompositionStrategy(args));
+    EXPECT_EQ(firstChanges, mOutput.getState().previousDeviceRequestedChanges);
+    EXPECT_EQ(1u, mOutput.getState().strategyPredictionsFromHistory);
+
+    // A layer stack that was never composed is not predicted.
+    mOutput.editState().outputLayerHash = 3;
+    EXPECT_FALSE(mOutput.canPredictCompositionStrategy(args));
+}
+
 // Note: Use OutputTest and not OutputPrepareFrameTest, so the real
 // base chooseCompositionStrategy() is invoked.
 TEST_F(OutputTest, prepareFrameSetsClientCompositionOnlyByDefault) {
@@ -1023,6 +1063,20 @@ TEST_F(OutputTest, prepareFrameSetsClientCompositionOnlyByDefault) {
     EXPECT_EQ(mOutput->getState().strategyPrediction, CompositionStrategyPredictionState::DISABLED);
 }
 
+TEST_F(OutputTest, canPredictCompositionStrategyBacksOffAfterRepeatedMisses) {
+    mOutput->setPredictCompositionStrategy(true);
+    mOutput->editState().isEnabled = true;
+    mOutput->editState().previousDeviceRequestedChanges =
+            std::make_optional<android::HWComposer::DeviceRequestedChanges>({});
+    mOutput->editState().strategyPredictionBackoffFrames = 2;
+
+    CompositionRefreshArgs args;
+    EXPECT_FALSE(mOutput->canPredictCompositionStrategy(args));
+    EXPECT_EQ(1u, mOutput->getState().strategyPredictionBackoffFrames);
+    EXPECT_FALSE(mOutput->canPredictCompositionStrategy(args));
+    EXPECT_EQ(0u, mOutput->getState().strategyPredictionBackoffFrames);
+}
+
 struct OutputPrepareFrameAsyncTest : public testing::Test {
     struct OutputPartialMock : public OutputPartialMockBase {
         // Sets up the helper functions called by the function under test to use
@@ -1077,6 +1131,7 @@ TEST_F(OutputPrepareFrameAsyncTest, delegatesToChooseCompositionStrategyAndRende
     impl::GpuCompositionResult result = mOutput.prepareFrameAsync();
     EXPECT_EQ(mOutput.getState().strategyPrediction, CompositionStrategyPredictionState::SUCCESS);
     EXPECT_FALSE(result.bufferAvailable());
+    EXPECT_EQ(0u, mOutput.getState().strategyPredictionMissStreak);
 }
 
 TEST_F(OutputPrepareFrameAsyncTest, skipCompositionOnDequeueFailure) {
@@ -1134,6 +1189,7 @@ TEST_F(OutputPrepareFrameAsyncTest, chooseCompositionStrategyFailureCallsPrepare
 
 TEST_F(OutputPrepareFrameAsyncTest, predictionMiss) {
     mOutput.editState().isEnabled = true;
+    mOutput.editState().strategyPredictionMissStreak = 2;
     mOutput.editState().usesClientComposition = false;
     mOutput.editState().usesDeviceComposition = true;
     mOutput.editState().previousDeviceRequestedChanges =
@@ -1162,6 +1218,9 @@ TEST_F(OutputPrepareFrameAsyncTest, predictionMiss) {
     impl::GpuCompositionResult result = mOutput.prepareFrameAsync();
     EXPECT_EQ(mOutput.getState().strategyPrediction, CompositionStrategyPredictionState::FAIL);
     EXPECT_TRUE(result.bufferAvailable());
+    // Too many misses in a row pause prediction.
+    EXPECT_EQ(0u, mOutput.getState().strategyPredictionMissStreak);
+    EXPECT_GT(mOutput.getState().strategyPredictionBackoffFrames, 0u);
 }
 
 /*
@@ -2004,6 +2063,47 @@ TEST_F(OutputEnsureOutputLayerIfVisibleTest, transparentRegionClipsWhenOutsideBo
                 RegionEq(kTransparentRegionHint));
 }
 
+TEST_F(OutputEnsureOutputLayerIfVisibleTest, reusesVisibilityIfInputsUnchanged) {
+    EXPECT_CALL(mOutput, ensureOutputLayer(Eq(0u), Eq(mLayer.layerFE)))
+            .WillRepeatedly(Return(&mLayer.outputLayer));
+
+    ensureOutputLayerIfVisible();
+    EXPECT_EQ(1u, mOutput.getLayerVisibilityStatsForTest().recomputed);
+
+    // The next geometry update has the same coverage above the layer.
+    Output::CoverageState coverage{mGeomSnapshots};
+    sp<LayerFE> layerFE(mLayer.layerFE);
+    mOutput.ensureOutputLayerIfVisible(layerFE, coverage);
+
+    EXPECT_EQ(1u, mOutput.getLayerVisibilityStatsForTest().recomputed);
+    EXPECT_EQ(1u, mOutput.getLayerVisibilityStatsForTest().reused);
+
+    EXPECT_THAT(coverage.aboveCoveredLayers, RegionEq(kFullBoundsNoRotation));
+    EXPECT_THAT(coverage.aboveOpaqueLayers, RegionEq(kFullBoundsNoRotation));
+    EXPECT_THAT(mLayer.outputLayerState.visibleRegion, RegionEq(kFullBoundsNoRotation));
+    EXPECT_THAT(mLayer.outputLayerState.coveredRegion, RegionEq(kEmptyRegion));
+}
+
+TEST_F(OutputEnsureOutputLayerIfVisibleTest, recomputesVisibilityIfCoverageAboveChanged) {
+    EXPECT_CALL(mOutput, ensureOutputLayer(Eq(0u), Eq(mLayer.layerFE)))
+            .WillRepeatedly(Return(&mLayer.outputLayer));
+
+    ensureOutputLayerIfVisible();
+
+    // An opaque layer above now covers the lower half of the layer.
+    Output::CoverageState coverage{mGeomSnapshots};
+    coverage.aboveCoveredLayers = kRightHalfBoundsNoRotation;
+    coverage.aboveOpaqueLayers = kRightHalfBoundsNoRotation;
+    sp<LayerFE> layerFE(mLayer.layerFE);
+    mOutput.ensureOutputLayerIfVisible(layerFE, coverage);
+
+    EXPECT_EQ(2u, mOutput.getLayerVisibilityStatsForTest().recomputed);
+    EXPECT_EQ(0u, mOutput.getLayerVisibilityStatsForTest().reused);
+
+    EXPECT_THAT(mLayer.outputLayerState.visibleRegion, RegionEq(Region(Rect(0, 0, 100, 100))));
+    EXPECT_THAT(mLayer.outputLayerState.coveredRegion, RegionEq(kRightHalfBoundsNoRotation));
+}
+
 /*
  * Output::present()
  */
@@ -3668,6 +3768,52 @@ TEST_F(OutputComposeSurfacesTest, clientCompositionIfBufferChanges) {
     EXPECT_FALSE(mOutput.mState.reusedClientComposition);
 }
 
+TEST_F(OutputComposeSurfacesTest, redrawsOnlyDamageSinceBufferWasLastComposed) {
+    mOutput.cacheClientCompositionRequests(0);
+    mOutput.mState.isEnabled = true;
+    mOutput.mState.layerFilter.toInternalDisplay = true;
+    const Rect kDirtyRect{1005, 1006, 1006, 1007};
+    const sp<Fence> kNoFence = Fence::NO_FENCE;
+
+    EXPECT_CALL(mOutput, getSkipColorTransform()).WillRepeatedly(Return(false));
+    EXPECT_CALL(*mDisplayColorProfile, hasWideColorGamut()).WillRepeatedly(Return(true));
+    EXPECT_CALL(mRenderEngine, supportsProtectedContent()).WillRepeatedly(Return(false));
+    EXPECT_CALL(mRenderEngine, isProtected()).WillRepeatedly(Return(false));
+    EXPECT_CALL(mOutput, generateClientCompositionRequests(_, kDefaultOutputDataspace, _))
+            .WillRepeatedly(Return(std::vector<LayerFE::LayerSettings>{}));
+    EXPECT_CALL(mOutput, appendRegionFlashRequests(RegionEq(kDebugRegion), _))
+            .WillRepeatedly(Return());
+    EXPECT_CALL(mOutput, setExpensiveRenderingExpected(false)).WillRepeatedly(Return());
+    EXPECT_CALL(mOutput, getOutputLayerCount()).WillRepeatedly(Return(0u));
+    EXPECT_CALL(*mRenderSurface, dequeueBuffer(_)).WillRepeatedly(Return(mOutputBuffer));
+    EXPECT_CALL(*mRenderSurface, getClientTargetAcquireFence()).WillRepeatedly(ReturnRef(kNoFence));
+    EXPECT_CALL(*mRenderSurface, onPresentDisplayCompleted()).WillRepeatedly(Return());
+
+    // The buffer has never been composed into, so all of it is redrawn.
+    mOutput.mState.dirtyRegion = Region(kDefaultOutputViewport);
+    EXPECT_CALL(mRenderEngine,
+                drawLayers(Field(&renderengine::DisplaySettings::damage, Rect::INVALID_RECT), _, _,
+                           true, _))
+            .WillOnce(Return(ByMove(ftl::yield<FenceResult>(Fence::NO_FENCE))));
+    verify().execute().expectAFenceWasReturned();
+    mOutput.postFramebuffer();
+
+    mOutput.mState.dirtyRegion = Region(kDirtyRect);
+    EXPECT_CALL(mRenderEngine,
+                drawLayers(Field(&renderengine::DisplaySettings::damage, kDirtyRect), _, _, true,
+                           _))
+            .WillOnce(Return(ByMove(ftl::yield<FenceResult>(Fence::NO_FENCE))));
+    verify().execute().expectAFenceWasReturned();
+    mOutput.postFramebuffer();
+
+    EXPECT_EQ(2u, mOutput.mState.clientCompositionFrames);
+    EXPECT_EQ(1u, mOutput.mState.partialClientCompositionFrames);
+    EXPECT_EQ(static_cast<uint64_t>(kDefaultOutputViewport.width() *
+                                            kDefaultOutputViewport.height() +
+                                    kDirtyRect.width() * kDirtyRect.height()),
+              mOutput.mState.clientCompositionPixels);
+}
+
 TEST_F(OutputComposeSurfacesTest, clientCompositionIfRequestChanges) {
     LayerFE::LayerSettings r1;
     LayerFE::LayerSettings r2;
@@ -4274,6 +4420,29 @@ MATCHER_P(ClientCompositionTargetSettingsBlurSettingsEq, expectedBlurSetting, ""
     return expectedBlurSetting == arg.blurSetting;
 }
 
+TEST_F(GenerateClientCompositionRequestsTest_ThreeLayers,
+       deviceCompositedSidebandLayerDisablesBlurs) {
+    native_handle_t* const fakeSidebandStream = reinterpret_cast<native_handle_t*>(10);
+    mLayers[0].mLayerFEState.sidebandStream = NativeHandle::create(fakeSidebandStream, false);
+    EXPECT_CALL(mLayers[0].mOutputLayer, requiresClientComposition()).WillOnce(Return(false));
+    EXPECT_CALL(*mLayers[0].mLayerFE, prepareClientComposition(_)).Times(0);
+    EXPECT_CALL(*mLayers[1].mLayerFE,
+                prepareClientComposition(ClientCompositionTargetSettingsBlurSettingsEq(
+                        LayerFE::ClientCompositionTargetSettings::BlurSetting::Disabled)))
+            .WillOnce(Return(std::optional<LayerFE::LayerSettings>(mLayers[1].mLayerSettings)));
+    EXPECT_CALL(*mLayers[2].mLayerFE,
+                prepareClientComposition(ClientCompositionTargetSettingsBlurSettingsEq(
+                        LayerFE::ClientCompositionTargetSettings::BlurSetting::Disabled)))
+            .WillOnce(Return(std::optional<LayerFE::LayerSettings>(mLayers[2].mLayerSettings)));
+
+    auto requests =
+            mOutput.generateClientCompositionRequestsHelper(false /* supportsProtectedContent */,
+                                                            kDisplayDataspace);
+    ASSERT_EQ(2u, requests.size());
+    EXPECT_EQ(mLayers[1].mLayerSettings, requests[0]);
+    EXPECT_EQ(mLayers[2].mLayerSettings, requests[1]);
+}
+
 TEST_F(GenerateClientCompositionRequestsTest_ThreeLayers, overridesBlur) {
     mLayers[2].mOutputLayerState.overrideInfo.disableBackgroundBlur = true;
 
@@ -362,6 +362,7 @@ TEST_F(CachedSetTest, renderUnsecureOutput) {
         EXPECT_EQ(0.5f, layers[0].alpha);
         EXPECT_EQ(0.75f, layers[1].alpha);
         EXPECT_EQ(ui::Dataspace::SRGB, displaySettings.outputDataspace);
+        EXPECT_TRUE(displaySettings.renderInBackground);
         return ftl::yield<FenceResult>(Fence::NO_FENCE);
     };
 
@@ -60,6 +60,7 @@ public:
                     .mActiveLayerTimeout = 100ms,
                     .mRenderScheduling = std::nullopt,
                     .mEnableHolePunch = true,
+                    .mSettledActiveLayerTimeout = std::nullopt,
             }) {}
     void SetUp() override;
 
@@ -1075,7 +1076,8 @@ public:
                                                                          kCachedSetRenderDuration,
                                                                  .maxDeferRenderAttempts =
                                                                          kMaxDeferRenderAttempts},
-                                        .mEnableHolePunch = true}) {}
+                                        .mEnableHolePunch = true,
+                                        .mSettledActiveLayerTimeout = std::nullopt}) {}
 };
 
 TEST_F(FlattenerRenderSchedulingTest, flattenLayers_renderCachedSets_defersUpToMaxAttempts) {
@@ -1416,5 +1418,56 @@ TEST_F(FlattenerTest, flattenLayers_includes_DISPLAY_DECORATION) {
     EXPECT_EQ(overrideBuffer1, overrideBuffer3);
 }
 
+const constexpr std::chrono::milliseconds kSettledActiveLayerTimeout = 20ms;
+
+class FlattenerSettledGeometryTest : public FlattenerTest {
+public:
+    FlattenerSettledGeometryTest()
+          : FlattenerTest(Flattener::Tunables{
+                    .mActiveLayerTimeout = 100ms,
+                    .mRenderScheduling = std::nullopt,
+                    .mEnableHolePunch = true,
+                    .mSettledActiveLayerTimeout = kSettledActiveLayerTimeout,
+            }) {}
+};
+
+TEST_F(FlattenerSettledGeometryTest, flattenLayers_settledGeometryIsFlattenedSooner) {
+    auto& layerState1 = mTestLayers[0]->layerState;
+    auto& layerState2 = mTestLayers[1]->layerState;
+    auto& layerState3 = mTestLayers[2]->layerState;
+
+    const std::vector<const LayerState*> layers = {
+            layerState1.get(),
+            layerState2.get(),
+            layerState3.get(),
+    };
+    const std::vector<const LayerState*> otherLayers = {
+            layerState1.get(),
+            layerState2.get(),
+    };
+
+    // The first time around, the layers are still active after the settled timeout.
+    initializeFlattener(layers);
+    mTime += 50ms;
+    EXPECT_CALL(mRenderEngine, drawLayers(_, _, _, _, _)).Times(0);
+    initializeOverrideBuffer(layers);
+    EXPECT_EQ(getNonBufferHash(layers),
+              mFlattener->flattenLayers(layers, getNonBufferHash(layers), mTime));
+    mFlattener->renderCachedSets(mOutputState, std::nullopt, true);
+
+    mTime += 100ms;
+    expectAllLayersFlattened(layers);
+
+    // Switch to another layer stack and back.
+    mTime += 10ms;
+    initializeFlattener(otherLayers);
+    mTime += 10ms;
+    initializeFlattener(layers);
+
+    // The geometry was flattened before, so the settled timeout applies.
+    mTime += 50ms;
+    expectAllLayersFlattened(layers);
+}
+
 } // namespace
 } // namespace android::compositionengine
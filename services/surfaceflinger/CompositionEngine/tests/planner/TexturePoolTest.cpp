@@ -170,5 +170,25 @@ TEST_F(TexturePoolTest, reallocatesWhenReEnabled) {
     EXPECT_EQ(mTexturePool.getPoolSize(), mTexturePool.getMinPoolSize());
 }
 
+TEST_F(TexturePoolTest, releasesIdleTextures) {
+    auto texture = mTexturePool.borrowTexture();
+    EXPECT_EQ(mTexturePool.getMinPoolSize() - 1, mTexturePool.getPoolSize());
+
+    mTexturePool.releaseIdleTextures();
+    EXPECT_EQ(0u, mTexturePool.getPoolSize());
+
+    // Borrowed textures are still returned to the pool.
+    texture.reset();
+    EXPECT_EQ(1u, mTexturePool.getPoolSize());
+
+    // The pool grows back on demand.
+    std::vector<std::shared_ptr<TexturePool::AutoTexture>> textures;
+    for (size_t i = 0; i < mTexturePool.getMaxPoolSize(); i++) {
+        textures.emplace_back(mTexturePool.borrowTexture());
+    }
+    textures.clear();
+    EXPECT_EQ(mTexturePool.getMaxPoolSize(), mTexturePool.getPoolSize());
+}
+
 } // namespace
 } // namespace android::compositionengine::impl::planner
@@ -277,6 +277,7 @@ bool AidlComposer::isSupported(OptionalFeature feature) const {
         case OptionalFeature::DisplayBrightnessCommand:
         case OptionalFeature::KernelIdleTimer:
         case OptionalFeature::PhysicalDisplayOrientation:
+        case OptionalFeature::ConcurrentDisplayCommands:
             return true;
     }
 }
@@ -100,6 +100,8 @@ public:
         DisplayBrightnessCommand,
         KernelIdleTimer,
         PhysicalDisplayOrientation,
+        // Whether commands for different displays can be written from different threads.
+        ConcurrentDisplayCommands,
     };
 
     virtual bool isSupported(OptionalFeature) const = 0;
@@ -759,8 +759,15 @@ Error Layer::setBlendMode(BlendMode mode)
         return Error::BAD_DISPLAY;
     }
 
+    if (mBlendMode == mode) {
+        return Error::NONE;
+    }
     auto intError = mComposer.setLayerBlendMode(mDisplay->getId(), mId, mode);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mBlendMode = mode;
+    }
+    return error;
 }
 
 Error Layer::setColor(Color color) {
@@ -768,8 +775,15 @@ Error Layer::setColor(Color color) {
         return Error::BAD_DISPLAY;
     }
 
+    if (mColor == color) {
+        return Error::NONE;
+    }
     auto intError = mComposer.setLayerColor(mDisplay->getId(), mId, color);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mColor = color;
+    }
+    return error;
 }
 
 Error Layer::setCompositionType(Composition type)
@@ -868,10 +882,17 @@ Error Layer::setDisplayFrame(const Rect& frame)
         return Error::BAD_DISPLAY;
     }
 
+    if (mDisplayFrame == frame) {
+        return Error::NONE;
+    }
     Hwc2::IComposerClient::Rect hwcRect{frame.left, frame.top,
         frame.right, frame.bottom};
     auto intError = mComposer.setLayerDisplayFrame(mDisplay->getId(), mId, hwcRect);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mDisplayFrame = frame;
+    }
+    return error;
 }
 
 Error Layer::setPlaneAlpha(float alpha)
@@ -880,8 +901,15 @@ Error Layer::setPlaneAlpha(float alpha)
         return Error::BAD_DISPLAY;
     }
 
+    if (mPlaneAlpha == alpha) {
+        return Error::NONE;
+    }
     auto intError = mComposer.setLayerPlaneAlpha(mDisplay->getId(), mId, alpha);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mPlaneAlpha = alpha;
+    }
+    return error;
 }
 
 Error Layer::setSidebandStream(const native_handle_t* stream)
@@ -905,10 +933,17 @@ Error Layer::setSourceCrop(const FloatRect& crop)
         return Error::BAD_DISPLAY;
     }
 
+    if (mSourceCrop == crop) {
+        return Error::NONE;
+    }
     Hwc2::IComposerClient::FRect hwcRect{
         crop.left, crop.top, crop.right, crop.bottom};
     auto intError = mComposer.setLayerSourceCrop(mDisplay->getId(), mId, hwcRect);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mSourceCrop = crop;
+    }
+    return error;
 }
 
 Error Layer::setTransform(Transform transform)
@@ -917,9 +952,16 @@ Error Layer::setTransform(Transform transform)
         return Error::BAD_DISPLAY;
     }
 
+    if (mTransform == transform) {
+        return Error::NONE;
+    }
     auto intTransform = static_cast<Hwc2::Transform>(transform);
     auto intError = mComposer.setLayerTransform(mDisplay->getId(), mId, intTransform);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mTransform = transform;
+    }
+    return error;
 }
 
 Error Layer::setVisibleRegion(const Region& region)
@@ -944,8 +986,15 @@ Error Layer::setZOrder(uint32_t z)
         return Error::BAD_DISPLAY;
     }
 
+    if (mZOrder == z) {
+        return Error::NONE;
+    }
     auto intError = mComposer.setLayerZOrder(mDisplay->getId(), mId, z);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mZOrder = z;
+    }
+    return error;
 }
 
 // Composer HAL 2.3
@@ -984,8 +1033,15 @@ Error Layer::setBrightness(float brightness) {
         return Error::BAD_DISPLAY;
     }
 
+    if (mBrightness == brightness) {
+        return Error::NONE;
+    }
     auto intError = mComposer.setLayerBrightness(mDisplay->getId(), mId, brightness);
-    return static_cast<Error>(intError);
+    Error error = static_cast<Error>(intError);
+    if (error == Error::NONE) {
+        mBrightness = brightness;
+    }
+    return error;
 }
 
 Error Layer::setBlockingRegion(const Region& region) {
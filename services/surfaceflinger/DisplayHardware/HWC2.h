@@ -21,6 +21,7 @@
 #include <ftl/future.h>
 #include <gui/HdrMetadata.h>
 #include <math/mat4.h>
+#include <ui/FloatRect.h>
 #include <ui/HdrCapabilities.h>
 #include <ui/Region.h>
 #include <ui/StaticDisplayInfo.h>
@@ -29,6 +30,7 @@
 #include <utils/Timers.h>
 
 #include <functional>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -416,6 +418,15 @@ private:
     android::HdrMetadata mHdrMetadata;
     android::mat4 mColorMatrix;
     uint32_t mBufferSlot;
+    // Unset until the first successful call, since HWC defaults are not guaranteed.
+    std::optional<hal::BlendMode> mBlendMode;
+    std::optional<aidl::android::hardware::graphics::composer3::Color> mColor;
+    std::optional<android::Rect> mDisplayFrame;
+    std::optional<float> mPlaneAlpha;
+    std::optional<android::FloatRect> mSourceCrop;
+    std::optional<hal::Transform> mTransform;
+    std::optional<uint32_t> mZOrder;
+    std::optional<float> mBrightness;
 };
 
 } // namespace impl
@@ -265,6 +265,8 @@ bool HidlComposer::isSupported(OptionalFeature feature) const {
         case OptionalFeature::DisplayBrightnessCommand:
         case OptionalFeature::KernelIdleTimer:
         case OptionalFeature::PhysicalDisplayOrientation:
+        // HIDL shares a single command writer across all displays.
+        case OptionalFeature::ConcurrentDisplayCommands:
             return false;
     }
 }
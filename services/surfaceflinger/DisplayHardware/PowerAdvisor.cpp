@@ -22,11 +22,14 @@
 #define LOG_TAG "PowerAdvisor"
 
 #include <unistd.h>
+#include <algorithm>
 #include <cinttypes>
 #include <cstdint>
+#include <cstdlib>
 #include <optional>
 
 #include <android-base/properties.h>
+#include <android-base/stringprintf.h>
 #include <utils/Log.h>
 #include <utils/Mutex.h>
 #include <utils/Trace.h>
@@ -170,14 +173,9 @@ void PowerAdvisor::notifyDisplayUpdateImminentAndCpuReset() {
             }
         }
 
-        if (!mHasDisplayUpdateImminent) {
-            ALOGV("Skipped sending DISPLAY_UPDATE_IMMINENT because HAL doesn't support it");
-        } else {
-            auto ret = getPowerHal().setBoost(Boost::DISPLAY_UPDATE_IMMINENT, 0);
-            if (ret.isUnsupported()) {
-                mHasDisplayUpdateImminent = false;
-            }
-        }
+        // Sent from the main thread, so do not wait for the HAL. The controller drops the boost
+        // once the HAL reported that it does not support it.
+        getPowerHal().setBoostAsync(Boost::DISPLAY_UPDATE_IMMINENT, 0);
 
         if (mScreenUpdateTimer) {
             mScreenUpdateTimer->reset();
@@ -250,6 +248,7 @@ void PowerAdvisor::reportActualWorkDuration() {
     }
     actualDuration = std::make_optional(*actualDuration + sTargetSafetyMargin);
     mActualDuration = actualDuration;
+    updateWorkloadModel(*actualDuration);
     WorkDuration duration;
     duration.durationNanos = actualDuration->ns();
     duration.timeStampNanos = TimePoint::now().ns();
@@ -282,6 +281,80 @@ void PowerAdvisor::reportActualWorkDuration() {
     mHintSessionQueue.clear();
 }
 
+float PowerAdvisor::getWorkUnits(const CompositionWorkload& workload) {
+    return static_cast<float>(workload.layerCount) +
+            kClientCompositionWorkUnits * static_cast<float>(workload.clientCompositionLayerCount) +
+            kBlurWorkUnits * static_cast<float>(workload.blurLayerCount) +
+            kShadowWorkUnits * static_cast<float>(workload.shadowLayerCount);
+}
+
+void PowerAdvisor::setCompositionWorkload(const CompositionWorkload& workload) {
+    mCurrentWorkUnits = getWorkUnits(workload);
+    mPredictedDuration.reset();
+    if (!mDurationPerWorkUnit || mCurrentWorkUnits <= 0.f) {
+        return;
+    }
+
+    mPredictedDuration = Duration::fromNs(
+            static_cast<nsecs_t>(*mDurationPerWorkUnit * mCurrentWorkUnits));
+    if (sTraceHintSessionData) ATRACE_INT64("Predicted duration", mPredictedDuration->ns());
+
+    if (mActualDuration &&
+        static_cast<float>(mPredictedDuration->ns()) >
+                static_cast<float>(mActualDuration->ns()) * kLoadUpThreshold) {
+        ATRACE_NAME("PredictedCpuLoadUp");
+        mPredictedLoadUpCount++;
+        notifyCpuLoadUp();
+    }
+}
+
+void PowerAdvisor::updateWorkloadModel(Duration actualDuration) {
+    if (mPredictedDuration) {
+        const Duration error =
+                Duration::fromNs(std::abs(actualDuration.ns() - mPredictedDuration->ns()));
+        const auto bucket =
+                std::find_if(kPredictionErrorBucketBounds.begin(),
+                             kPredictionErrorBucketBounds.end(),
+                             [error](Duration bound) { return error < bound; }) -
+                kPredictionErrorBucketBounds.begin();
+        mPredictionErrorHistogram[static_cast<size_t>(bucket)]++;
+        mPredictedDuration.reset();
+    }
+
+    if (mCurrentWorkUnits > 0.f) {
+        const float durationPerWorkUnit =
+                static_cast<float>(actualDuration.ns()) / mCurrentWorkUnits;
+        mDurationPerWorkUnit = mDurationPerWorkUnit
+                ? *mDurationPerWorkUnit +
+                        kWorkUnitSmoothing * (durationPerWorkUnit - *mDurationPerWorkUnit)
+                : durationPerWorkUnit;
+        mCurrentWorkUnits = 0.f;
+    }
+}
+
+void PowerAdvisor::dump(std::string& result) const {
+    result.append("PowerAdvisor workload prediction:\n");
+    if (!mDurationPerWorkUnit) {
+        result.append("  no frames measured\n");
+        return;
+    }
+    base::StringAppendF(&result, "  duration per work unit: %.0f ns\n", *mDurationPerWorkUnit);
+    base::StringAppendF(&result, "  CPU load ups sent ahead of time: %zu\n",
+                        mPredictedLoadUpCount);
+    result.append("  prediction error histogram:\n");
+    for (size_t i = 0; i < mPredictionErrorHistogram.size(); i++) {
+        if (i < kPredictionErrorBucketBounds.size()) {
+            base::StringAppendF(&result, "    < %6" PRId64 " us: %zu\n",
+                                kPredictionErrorBucketBounds[i].ns() / 1000,
+                                mPredictionErrorHistogram[i]);
+        } else {
+            base::StringAppendF(&result, "    >= %5" PRId64 " us: %zu\n",
+                                kPredictionErrorBucketBounds.back().ns() / 1000,
+                                mPredictionErrorHistogram[i]);
+        }
+    }
+}
+
 void PowerAdvisor::enablePowerHintSession(bool enabled) {
     mHintSessionEnabled = enabled;
 }
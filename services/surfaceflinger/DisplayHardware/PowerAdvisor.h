@@ -16,8 +16,10 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -94,6 +96,19 @@ public:
     virtual void setDisplays(std::vector<DisplayId>& displayIds) = 0;
     // Sets the target duration for the entire pipeline including the gpu
     virtual void setTotalFrameTargetWorkDuration(Duration targetDuration) = 0;
+
+    // The work that the upcoming composition is expected to do
+    struct CompositionWorkload {
+        size_t layerCount = 0;
+        size_t clientCompositionLayerCount = 0;
+        size_t blurLayerCount = 0;
+        size_t shadowLayerCount = 0;
+    };
+    // Predicts the duration of the upcoming frame from its workload, and asks the hint session
+    // for more CPU ahead of time if it is expected to take notably longer than the last frame
+    virtual void setCompositionWorkload(const CompositionWorkload& workload) = 0;
+
+    virtual void dump(std::string& result) const = 0;
 };
 
 namespace impl {
@@ -134,6 +149,8 @@ public:
     void setCompositeEnd(TimePoint compositeEndTime) override;
     void setDisplays(std::vector<DisplayId>& displayIds) override;
     void setTotalFrameTargetWorkDuration(Duration targetDuration) override;
+    void setCompositionWorkload(const CompositionWorkload& workload) override;
+    void dump(std::string& result) const override;
 
 private:
     friend class PowerAdvisorTest;
@@ -219,6 +236,10 @@ private:
     // There are two different targets and actual work durations we care about,
     // this normalizes them together and takes the max of the two
     Duration combineTimingEstimates(Duration totalDuration, Duration flingerDuration);
+    // Converts a workload into work units, a device composited layer without effects being one
+    static float getWorkUnits(const CompositionWorkload& workload);
+    // Updates the workload model with the duration of the frame the last workload was set for
+    void updateWorkloadModel(Duration actualDuration);
 
     std::unordered_map<DisplayId, DisplayTimingData> mDisplayTimingData;
 
@@ -239,6 +260,19 @@ private:
     // Updated list of display IDs
     std::vector<DisplayId> mDisplayIds;
 
+    // Moving average of the actual duration per work unit, in nanoseconds
+    std::optional<float> mDurationPerWorkUnit;
+    // Work units and predicted duration of the frame being composed
+    float mCurrentWorkUnits = 0.f;
+    std::optional<Duration> mPredictedDuration;
+    // Number of frames for which a CPU load up was sent ahead of time
+    size_t mPredictedLoadUpCount = 0;
+    // Histogram of the absolute prediction error. Bucket i counts errors below
+    // kPredictionErrorBucketBounds[i], and the last bucket counts all larger errors.
+    static constexpr std::array<Duration, 5> kPredictionErrorBucketBounds{500us, 1ms, 2ms, 4ms,
+                                                                          8ms};
+    std::array<size_t, kPredictionErrorBucketBounds.size() + 1> mPredictionErrorHistogram{};
+
     // Ensure powerhal connection is initialized
     power::PowerHalController& getPowerHal();
 
@@ -251,7 +285,6 @@ private:
 
     // Initialize to true so we try to call, to check if it's supported
     bool mHasExpensiveRendering = true;
-    bool mHasDisplayUpdateImminent = true;
     // Queue of actual durations saved to report
     std::vector<hardware::power::WorkDuration> mHintSessionQueue;
     // The latest values we have received for target and actual
@@ -277,6 +310,15 @@ private:
     // How long we expect hwc to run after the present call until it waits for the fence
     static constexpr const Duration kFenceWaitStartDelayValidated{150us};
     static constexpr const Duration kFenceWaitStartDelaySkippedValidate{250us};
+
+    // Relative cost of layer features, in work units
+    static constexpr float kClientCompositionWorkUnits = 2.f;
+    static constexpr float kBlurWorkUnits = 6.f;
+    static constexpr float kShadowWorkUnits = 1.f;
+    // Weight of the latest frame in the duration per work unit average
+    static constexpr float kWorkUnitSmoothing = 0.2f;
+    // How much longer than the last frame a frame must be predicted to take to load up the CPU
+    static constexpr float kLoadUpThreshold = 1.25f;
 };
 
 } // namespace impl
@@ -28,6 +28,7 @@
 #include <gui/BufferQueue.h>
 #include <gui/IProducerListener.h>
 #include <system/window.h>
+#include <ui/PixelFormat.h>
 
 #include "HWComposer.h"
 #include "SurfaceFlinger.h"
@@ -69,7 +70,8 @@ VirtualDisplaySurface::VirtualDisplaySurface(HWComposer& hwc, VirtualDisplayId d
         mOutputFence(Fence::NO_FENCE),
         mFbProducerSlot(BufferQueue::INVALID_BUFFER_SLOT),
         mOutputProducerSlot(BufferQueue::INVALID_BUFFER_SLOT),
-        mForceHwcCopy(SurfaceFlinger::useHwcForRgbToYuv),
+        mDirectRender(SurfaceFlinger::useDirectRenderForVirtualDisplays),
+        mForceHwcCopy(SurfaceFlinger::useHwcForRgbToYuv && !mDirectRender),
         mSecure(secure),
         mSinkUsage(0) {
     mSource[SOURCE_SINK] = sink;
@@ -164,7 +166,8 @@ status_t VirtualDisplaySurface::prepareFrame(CompositionType compositionType) {
     }
 
     if (mCompositionType != CompositionType::Gpu &&
-        (mOutputFormat != mDefaultOutputFormat || !(mOutputUsage & GRALLOC_USAGE_HW_COMPOSER))) {
+        ((!mDirectRender && mOutputFormat != mDefaultOutputFormat) ||
+         !(mOutputUsage & GRALLOC_USAGE_HW_COMPOSER))) {
         // We must have just switched from GPU-only to MIXED or HWC
         // composition. Stop using the format and usage requested by the GPU
         // driver; they may be suboptimal when HWC is writing to the output
@@ -175,6 +178,9 @@ status_t VirtualDisplaySurface::prepareFrame(CompositionType compositionType) {
         // If we just switched *to* GPU-only mode, we'll change the
         // format/usage and get a new buffer when the GPU driver calls
         // dequeueBuffer().
+        //
+        // In direct render mode, HWC writes to the buffers in the format the
+        // GPU driver asked for, so they are kept across composition types.
         mOutputFormat = mDefaultOutputFormat;
         setOutputUsage(GRALLOC_USAGE_HW_COMPOSER);
         refreshOutputBuffer();
@@ -247,6 +253,29 @@ void VirtualDisplaySurface::onFrameCommitted() {
                 ftl::enum_string(mDebugState).c_str());
     mDebugState = DebugState::Idle;
 
+    uint64_t copiedBytes = 0;
+    switch (mCompositionType) {
+        case CompositionType::Gpu:
+            mGpuFrames++;
+            break;
+        case CompositionType::Hwc:
+            mHwcFrames++;
+            break;
+        case CompositionType::Mixed:
+            mMixedFrames++;
+            if (mFbProducerSlot >= 0) {
+                // HWC read the client target out of the scratch buffer.
+                const sp<GraphicBuffer>& fbBuffer = mProducerBuffers[mFbProducerSlot];
+                copiedBytes = static_cast<uint64_t>(fbBuffer->getStride()) *
+                        fbBuffer->getHeight() * bytesPerPixel(fbBuffer->getPixelFormat());
+            }
+            break;
+        default:
+            break;
+    }
+    mLastFrameCopiedBytes = copiedBytes;
+    mCopiedBytes += copiedBytes;
+
     sp<Fence> retireFence = mHwc.getPresentFence(*halDisplayId);
     if (mCompositionType == CompositionType::Mixed && mFbProducerSlot >= 0) {
         // release the scratch buffer back to the pool
@@ -286,7 +315,19 @@ void VirtualDisplaySurface::onFrameCommitted() {
     resetPerFrameState();
 }
 
-void VirtualDisplaySurface::dumpAsString(String8& /* result */) const {
+void VirtualDisplaySurface::dumpAsString(String8& result) const {
+    if (GpuVirtualDisplayId::tryCast(mDisplayId)) {
+        return;
+    }
+
+    result.append("   VirtualDisplaySurface\n");
+    result.appendFormat("      directRender=%d forceHwcCopy=%d\n", mDirectRender, mForceHwcCopy);
+    result.appendFormat("      frames: gpu=%" PRIu64 " hwc=%" PRIu64 " mixed=%" PRIu64
+                        ", output buffer refreshes=%" PRIu64 "\n",
+                        mGpuFrames.load(), mHwcFrames.load(), mMixedFrames.load(),
+                        mOutputBufferRefreshes.load());
+    result.appendFormat("      bytes copied: last frame=%" PRIu64 " total=%" PRIu64 "\n",
+                        mLastFrameCopiedBytes.load(), mCopiedBytes.load());
 }
 
 void VirtualDisplaySurface::resizeBuffers(const ui::Size& newSize) {
@@ -635,6 +676,7 @@ status_t VirtualDisplaySurface::refreshOutputBuffer() {
     LOG_ALWAYS_FATAL_IF(GpuVirtualDisplayId::tryCast(mDisplayId).has_value());
 
     if (mOutputProducerSlot >= 0) {
+        mOutputBufferRefreshes++;
         mSource[SOURCE_SINK]->cancelBuffer(
                 mapProducer2SourceSlot(SOURCE_SINK, mOutputProducerSlot),
                 mOutputFence);
@@ -687,6 +729,10 @@ std::string VirtualDisplaySurface::toString(CompositionType type) {
 void VirtualDisplaySurface::setOutputUsage(uint64_t /*flag*/) {
 
     mOutputUsage = mSinkUsage;
+    if (mDirectRender) {
+        // Allocate the output buffers for the GPU driver as well, see RenderSurface.
+        mOutputUsage |= GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE;
+    }
     if (mSecure && (mOutputUsage & GRALLOC_USAGE_HW_VIDEO_ENCODER)) {
         /*TODO: Currently, the framework can only say whether the display
          * and its subsequent session are secure or not. However, there is
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <optional>
 #include <string>
 
@@ -70,6 +71,14 @@ class IProducerListener;
  * buffer for HWC, and a separate buffer is dequeued from the sink and used as
  * the HWC output buffer. When HWC composition is complete, the scratch buffer
  * is released and the output buffer is queued to the sink.
+ *
+ * With SurfaceFlinger::useDirectRenderForVirtualDisplays, output buffers are
+ * allocated with the usage of both the GPU driver and HWC, and in the format
+ * the GPU driver asks for. The same sink buffers then serve every composition
+ * type, so GPU-only frames are never turned into MIXED frames to let HWC copy
+ * them, and switching between composition types does not cancel the output
+ * buffer and dequeue a new one. The only copies left are on genuinely MIXED
+ * frames, where HWC reads the scratch buffer; dumpAsString() reports them.
  */
 class VirtualDisplaySurface : public compositionengine::DisplaySurface,
                               public BnGraphicBufferProducer,
@@ -266,9 +275,23 @@ private:
 
     bool mMustRecompose = false;
 
+    const bool mDirectRender;
     bool mForceHwcCopy;
     bool mSecure;
     int mSinkUsage;
+
+    //
+    // Statistics, written during composition and read by dumpAsString()
+    //
+    std::atomic<uint64_t> mGpuFrames = 0;
+    std::atomic<uint64_t> mHwcFrames = 0;
+    std::atomic<uint64_t> mMixedFrames = 0;
+    // Output buffers canceled and dequeued again within a frame, since they did not match the
+    // format or usage of the composition.
+    std::atomic<uint64_t> mOutputBufferRefreshes = 0;
+    // Bytes of scratch buffers read by HWC into the output buffer on MIXED frames.
+    std::atomic<uint64_t> mLastFrameCopiedBytes = 0;
+    std::atomic<uint64_t> mCopiedBytes = 0;
 };
 
 } // namespace android
@@ -37,6 +37,10 @@ void FlagManager::dump(std::string& result) const {
     base::StringAppendF(&result, "demo_flag: %" PRId64 "\n", demo_flag());
     base::StringAppendF(&result, "use_adpf_cpu_hint: %s\n", use_adpf_cpu_hint() ? "true" : "false");
     base::StringAppendF(&result, "use_skia_tracing: %s\n", use_skia_tracing() ? "true" : "false");
+    base::StringAppendF(&result, "pipelined_composition: %s\n",
+                        pipelined_composition() ? "true" : "false");
+    base::StringAppendF(&result, "vds_direct_render: %s\n",
+                        vds_direct_render() ? "true" : "false");
 }
 
 namespace {
@@ -107,4 +111,16 @@ bool FlagManager::use_skia_tracing() const {
     return getValue("SkiaTracingFeature__use_skia_tracing", sysPropVal, false);
 }
 
+bool FlagManager::pipelined_composition() const {
+    std::optional<bool> sysPropVal =
+            doParse<bool>(base::GetProperty("debug.sf.pipelined_composition", "").c_str());
+    return getValue("PipelinedCompositionFeature__pipelined_composition", sysPropVal, false);
+}
+
+bool FlagManager::vds_direct_render() const {
+    std::optional<bool> sysPropVal =
+            doParse<bool>(base::GetProperty("debug.sf.vds_direct_render", "").c_str());
+    return getValue("VdsDirectRenderFeature__vds_direct_render", sysPropVal, false);
+}
+
 } // namespace android
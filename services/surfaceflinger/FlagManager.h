@@ -35,6 +35,14 @@ public:
 
     bool use_skia_tracing() const;
 
+    // Whether SurfaceFlinger::composite runs the composition engine on a dedicated thread, so
+    // that the main thread can collect the transactions for the next frame meanwhile.
+    bool pipelined_composition() const;
+
+    // Whether virtual displays feeding a sink, e.g. a screen recording encoder, keep GPU composited
+    // frames in the sink's buffers rather than having HWC copy them out of scratch buffers.
+    bool vds_direct_render() const;
+
 private:
     friend class FlagManagerTest;
 
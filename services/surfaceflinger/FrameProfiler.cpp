@@ -0,0 +1,239 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "FrameProfiler"
+
+#include "FrameProfiler.h"
+
+#include <android-base/stringprintf.h>
+#include <timestatsatomsproto/TimeStatsAtomsProtoHeader.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+
+namespace android {
+
+using base::StringAppendF;
+
+namespace {
+
+size_t getBucket(nsecs_t duration) {
+    const auto& limits = FrameProfiler::kBucketLimitsUs;
+    return static_cast<size_t>(std::upper_bound(limits.begin(), limits.end(), ns2us(duration)) -
+                               limits.begin());
+}
+
+} // namespace
+
+nsecs_t FrameProfiler::PhaseStats::percentile(float percent) const {
+    if (count == 0) return 0;
+    const uint64_t target =
+            std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(count * percent / 100.f)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketLimitsUs.size(); i++) {
+        seen += histogram[i];
+        if (seen >= target) {
+            return us2ns(kBucketLimitsUs[i]);
+        }
+    }
+    // Past the last limit, the longest duration is the best bound.
+    return maxDuration;
+}
+
+void FrameProfiler::beginFrame(Fps refreshRate, bool previousFrameMissed) {
+    if (mFrame.slot) {
+        recordFrame(mFrame, previousFrameMissed);
+    }
+    mFrame = {};
+    mFrame.slot = getSlot(refreshRate.getIntValue());
+    if (!mFrame.slot) {
+        mDroppedFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void FrameProfiler::addPhaseDuration(Phase phase, nsecs_t duration) {
+    mFrame.durations[static_cast<size_t>(phase)] += std::max<nsecs_t>(0, duration);
+    mFrame.phases.set(static_cast<size_t>(phase));
+}
+
+std::optional<FrameProfiler::Phase> FrameProfiler::enterPhase(Phase phase) {
+    const nsecs_t now = systemTime();
+    if (mCurrentPhase) {
+        addPhaseDuration(*mCurrentPhase, now - mPhaseStartTime);
+    }
+    const auto previous = mCurrentPhase;
+    mCurrentPhase = phase;
+    mPhaseStartTime = now;
+    return previous;
+}
+
+void FrameProfiler::exitPhase(std::optional<Phase> previous) {
+    const nsecs_t now = systemTime();
+    if (mCurrentPhase) {
+        addPhaseDuration(*mCurrentPhase, now - mPhaseStartTime);
+    }
+    mCurrentPhase = previous;
+    mPhaseStartTime = now;
+}
+
+FrameProfiler::Slot* FrameProfiler::getSlot(int32_t refreshRateHz) {
+    // Only the main thread takes slots, so a free slot cannot be taken concurrently.
+    for (Slot& slot : mSlots) {
+        const int32_t slotRefreshRateHz = slot.refreshRateHz.load(std::memory_order_relaxed);
+        if (slotRefreshRateHz == refreshRateHz) {
+            return &slot;
+        }
+        if (slotRefreshRateHz == 0) {
+            slot.refreshRateHz.store(refreshRateHz, std::memory_order_release);
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void FrameProfiler::recordFrame(const Frame& frame, bool missed) {
+    Slot& slot = *frame.slot;
+    constexpr auto kRelaxed = std::memory_order_relaxed;
+
+    std::optional<size_t> overrunPhase;
+    nsecs_t maxOverrun = 0;
+
+    for (size_t i = 0; i < kPhaseCount; i++) {
+        if (!frame.phases.test(i)) continue;
+        const nsecs_t duration = frame.durations[i];
+        AtomicPhaseStats& phase = slot.phases[i];
+
+        if (missed) {
+            // Compare with the mean before the frame is counted towards it.
+            const uint64_t count = phase.count.load(kRelaxed);
+            const nsecs_t total = phase.totalDuration.load(kRelaxed);
+            const nsecs_t mean = count == 0 ? 0 : total / static_cast<nsecs_t>(count);
+            if (!overrunPhase || duration - mean > maxOverrun) {
+                overrunPhase = i;
+                maxOverrun = duration - mean;
+            }
+        }
+
+        phase.count.fetch_add(1, kRelaxed);
+        phase.totalDuration.fetch_add(duration, kRelaxed);
+        if (duration > phase.maxDuration.load(kRelaxed)) {
+            phase.maxDuration.store(duration, kRelaxed);
+        }
+        phase.histogram[getBucket(duration)].fetch_add(1, kRelaxed);
+    }
+
+    slot.frames.fetch_add(1, kRelaxed);
+    if (missed) {
+        slot.missedFrames.fetch_add(1, kRelaxed);
+        if (overrunPhase) {
+            slot.phases[*overrunPhase].missedFrames.fetch_add(1, kRelaxed);
+        }
+    }
+}
+
+template <typename Slots, typename Read>
+std::vector<FrameProfiler::RefreshRateStats> FrameProfiler::readStats(Slots& slots, Read read) {
+    std::vector<RefreshRateStats> result;
+    for (auto& slot : slots) {
+        const int32_t refreshRateHz = slot.refreshRateHz.load(std::memory_order_acquire);
+        if (refreshRateHz == 0) break;
+
+        RefreshRateStats& stats = result.emplace_back();
+        stats.refreshRateHz = refreshRateHz;
+        stats.frames = read(slot.frames);
+        stats.missedFrames = read(slot.missedFrames);
+        for (size_t i = 0; i < kPhaseCount; i++) {
+            auto& phase = slot.phases[i];
+            PhaseStats& phaseStats = stats.phases[i];
+            phaseStats.count = read(phase.count);
+            phaseStats.totalDuration = read(phase.totalDuration);
+            phaseStats.maxDuration = read(phase.maxDuration);
+            for (size_t bucket = 0; bucket < kBucketCount; bucket++) {
+                phaseStats.histogram[bucket] = read(phase.histogram[bucket]);
+            }
+            phaseStats.missedFrames = read(phase.missedFrames);
+        }
+    }
+    return result;
+}
+
+std::vector<FrameProfiler::RefreshRateStats> FrameProfiler::getStats() const {
+    return readStats(mSlots,
+                     [](const auto& value) { return value.load(std::memory_order_relaxed); });
+}
+
+void FrameProfiler::dump(std::string& result) const {
+    StringAppendF(&result, "Frame profile of the main thread (us), %" PRIu64 " frames dropped\n",
+                  mDroppedFrames.load(std::memory_order_relaxed));
+
+    for (const RefreshRateStats& stats : getStats()) {
+        StringAppendF(&result, "%d Hz: %" PRIu64 " frames, %" PRIu64 " missed\n",
+                      stats.refreshRateHz, stats.frames, stats.missedFrames);
+        StringAppendF(&result, "%24s %10s %8s %8s %8s %8s %8s %8s\n", "phase", "count", "mean",
+                      "p50", "p90", "p99", "max", "missed");
+        for (size_t i = 0; i < kPhaseCount; i++) {
+            const PhaseStats& phase = stats.phases[i];
+            const int64_t mean = phase.count == 0
+                    ? 0
+                    : ns2us(phase.totalDuration / static_cast<nsecs_t>(phase.count));
+            StringAppendF(&result,
+                          "%24s %10" PRIu64 " %8" PRId64 " %8" PRId64 " %8" PRId64 " %8" PRId64
+                          " %8" PRId64 " %8" PRIu64 "\n",
+                          ftl::enum_string(static_cast<Phase>(i)).c_str(), phase.count, mean,
+                          ns2us(phase.percentile(50.f)), ns2us(phase.percentile(90.f)),
+                          ns2us(phase.percentile(99.f)), ns2us(phase.maxDuration),
+                          phase.missedFrames);
+        }
+    }
+}
+
+bool FrameProfiler::populateAtom(std::vector<uint8_t>* pulledData) {
+    const auto stats = readStats(mSlots, [](auto& value) {
+        return value.exchange(0, std::memory_order_relaxed);
+    });
+
+    surfaceflinger::SurfaceflingerFrameProfileWrapper atomList;
+    for (const RefreshRateStats& refreshRateStats : stats) {
+        if (refreshRateStats.frames == 0) continue;
+
+        surfaceflinger::SurfaceflingerFrameProfile* atom = atomList.add_atom();
+        atom->set_refresh_rate_hz(refreshRateStats.refreshRateHz);
+        atom->set_total_frames(static_cast<int64_t>(refreshRateStats.frames));
+        atom->set_missed_frames(static_cast<int64_t>(refreshRateStats.missedFrames));
+        for (size_t i = 0; i < kPhaseCount; i++) {
+            const PhaseStats& phaseStats = refreshRateStats.phases[i];
+            auto* phase = atom->add_phases();
+            // The proto enum reserves 0 for an unspecified phase.
+            phase->set_phase(
+                    static_cast<surfaceflinger::SurfaceflingerFrameProfile::Phase>(i + 1));
+            for (size_t bucket = 0; bucket < kBucketCount; bucket++) {
+                if (phaseStats.histogram[bucket] == 0) continue;
+                // Buckets are reported by their lower bound, as the last one has no upper bound.
+                phase->add_time_micros_buckets(
+                        bucket == 0 ? 0 : static_cast<int32_t>(kBucketLimitsUs[bucket - 1]));
+                phase->add_frame_counts(static_cast<int64_t>(phaseStats.histogram[bucket]));
+            }
+            phase->set_missed_frames(static_cast<int64_t>(phaseStats.missedFrames));
+        }
+    }
+
+    pulledData->resize(atomList.ByteSizeLong());
+    return atomList.SerializeToArray(pulledData->data(), atomList.ByteSizeLong());
+}
+
+} // namespace android
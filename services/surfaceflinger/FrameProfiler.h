@@ -0,0 +1,162 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ftl/enum.h>
+#include <scheduler/Fps.h>
+#include <utils/Timers.h>
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace android {
+
+// FrameProfiler aggregates how long the main thread spends in each phase of a frame, i.e. from
+// SurfaceFlinger::commit through SurfaceFlinger::composite, into histograms per refresh rate of the
+// pacesetter display. The durations of nested phases are only counted towards the innermost one,
+// so the phases of a frame add up to at most its duration.
+//
+// When a frame misses its deadline, it is attributed to the phase that overran its mean duration
+// the most.
+//
+// The main thread is the only writer, and the histograms are atomics, so that recording a frame
+// never contends with dumpsys or statsd reading them.
+class FrameProfiler {
+public:
+    enum class Phase : size_t {
+        FlushTransactionQueues,
+        UpdateLayerSnapshots,
+        UpdateInputFlinger,
+        CompositionPrepare,
+        CompositionPresent,
+        PostComposition,
+        Callbacks,
+        ftl_last = Callbacks
+    };
+
+    static constexpr size_t kPhaseCount = static_cast<size_t>(Phase::ftl_last) + 1;
+
+    // Upper limits of the histogram buckets. The last bucket holds longer durations.
+    static constexpr std::array<int64_t, 10> kBucketLimitsUs = {50,   100,  250,  500,   1000,
+                                                                2000, 4000, 8000, 16000, 32000};
+    static constexpr size_t kBucketCount = kBucketLimitsUs.size() + 1;
+
+    // Frames at further refresh rates are dropped.
+    static constexpr size_t kMaxRefreshRates = 8;
+
+    // The pulled statsd atom that reports the profile, which resets it like the TimeStats atoms.
+    static constexpr int32_t kAtomId = 10240; // SURFACEFLINGER_FRAME_PROFILE
+
+    struct PhaseStats {
+        uint64_t count = 0;
+        nsecs_t totalDuration = 0;
+        nsecs_t maxDuration = 0;
+        std::array<uint64_t, kBucketCount> histogram{};
+        // The missed frames attributed to the phase.
+        uint64_t missedFrames = 0;
+
+        // Returns the upper limit of the bucket holding the given percentile, or 0 if empty.
+        nsecs_t percentile(float percent) const;
+    };
+
+    struct RefreshRateStats {
+        int32_t refreshRateHz = 0;
+        uint64_t frames = 0;
+        uint64_t missedFrames = 0;
+        std::array<PhaseStats, kPhaseCount> phases;
+    };
+
+    // Measures the duration of a phase on the main thread, excluding the phases nested in it.
+    class ScopedPhase {
+    public:
+        ScopedPhase(FrameProfiler& profiler, Phase phase) : mProfiler(profiler) {
+            mPrevious = mProfiler.enterPhase(phase);
+        }
+        ~ScopedPhase() { mProfiler.exitPhase(mPrevious); }
+
+    private:
+        FrameProfiler& mProfiler;
+        std::optional<Phase> mPrevious;
+    };
+
+    // Main thread. Folds the durations of the previous frame into the histograms, and starts a
+    // new frame. Whether the previous frame missed its deadline is only known once its present
+    // fence signaled, i.e. when the next frame begins.
+    void beginFrame(Fps refreshRate, bool previousFrameMissed);
+
+    // Main thread. Adds to the duration of a phase of the current frame.
+    void addPhaseDuration(Phase, nsecs_t duration);
+
+    // Returns the profile of each refresh rate.
+    std::vector<RefreshRateStats> getStats() const;
+
+    void dump(std::string& result) const;
+
+    // Serializes the profile into a SurfaceflingerFrameProfileWrapper, and resets it.
+    bool populateAtom(std::vector<uint8_t>* pulledData);
+
+private:
+    struct AtomicPhaseStats {
+        std::atomic<uint64_t> count = 0;
+        std::atomic<nsecs_t> totalDuration = 0;
+        std::atomic<nsecs_t> maxDuration = 0;
+        std::array<std::atomic<uint64_t>, kBucketCount> histogram{};
+        std::atomic<uint64_t> missedFrames = 0;
+    };
+
+    struct Slot {
+        // 0 until the slot is taken by a refresh rate, after which it never changes.
+        std::atomic<int32_t> refreshRateHz = 0;
+        std::atomic<uint64_t> frames = 0;
+        std::atomic<uint64_t> missedFrames = 0;
+        std::array<AtomicPhaseStats, kPhaseCount> phases;
+    };
+
+    // The frame being recorded by the main thread.
+    struct Frame {
+        Slot* slot = nullptr;
+        std::array<nsecs_t, kPhaseCount> durations{};
+        std::bitset<kPhaseCount> phases;
+    };
+
+    std::optional<Phase> enterPhase(Phase);
+    void exitPhase(std::optional<Phase> previous);
+
+    Slot* getSlot(int32_t refreshRateHz);
+    void recordFrame(const Frame&, bool missed);
+
+    // Reads the slots with read(const std::atomic<T>&) or read(std::atomic<T>&), e.g. to reset
+    // them while reading.
+    template <typename Slots, typename Read>
+    static std::vector<RefreshRateStats> readStats(Slots&, Read read);
+
+    std::array<Slot, kMaxRefreshRates> mSlots;
+    std::atomic<uint64_t> mDroppedFrames = 0;
+
+    // Main thread only.
+    Frame mFrame;
+    std::optional<Phase> mCurrentPhase;
+    nsecs_t mPhaseStartTime = 0;
+};
+
+} // namespace android
@@ -21,11 +21,14 @@
 #include "FrameTimeline.h"
 
 #include <android-base/stringprintf.h>
+#include <android-base/thread_annotations.h>
+#include <pthread.h>
 #include <utils/Log.h>
 #include <utils/Trace.h>
 
 #include <chrono>
 #include <cinttypes>
+#include <iterator>
 #include <numeric>
 #include <unordered_set>
 
@@ -761,14 +764,31 @@ std::optional<TimelineItem> TokenManager::getPredictionsForToken(int64_t token)
 }
 
 FrameTimeline::FrameTimeline(std::shared_ptr<TimeStats> timeStats, pid_t surfaceFlingerPid,
-                             JankClassificationThresholds thresholds, bool useBootTimeClock)
+                             JankClassificationThresholds thresholds, bool useBootTimeClock,
+                             bool classifyAsync)
       : mUseBootTimeClock(useBootTimeClock),
         mMaxDisplayFrames(kDefaultMaxDisplayFrames),
         mTimeStats(std::move(timeStats)),
         mSurfaceFlingerPid(surfaceFlingerPid),
-        mJankClassificationThresholds(thresholds) {
+        mJankClassificationThresholds(thresholds),
+        mClassifyAsync(classifyAsync) {
     mCurrentDisplayFrame =
             std::make_shared<DisplayFrame>(mTimeStats, thresholds, &mTraceCookieCounter);
+    if (mClassifyAsync) {
+        mWorker = std::thread(&FrameTimeline::workerLoop, this);
+        pthread_setname_np(mWorker.native_handle(), "FrameTimeline");
+    }
+}
+
+FrameTimeline::~FrameTimeline() {
+    {
+        std::scoped_lock lock(mWorkerMutex);
+        mWorkerDone = true;
+        mWorkerCv.notify_all();
+    }
+    if (mWorker.joinable()) {
+        mWorker.join();
+    }
 }
 
 void FrameTimeline::onBootFinished() {
@@ -784,31 +804,102 @@ void FrameTimeline::registerDataSource() {
     FrameTimelineDataSource::Register(dsd);
 }
 
+namespace {
+
+// Allocates from a SurfaceFramePool. Every copy holds a reference to the pool, including the one
+// std::allocate_shared stores in the control block, so the pool outlives its SurfaceFrames.
+template <typename T>
+struct SurfaceFrameAllocator {
+    using value_type = T;
+
+    explicit SurfaceFrameAllocator(std::shared_ptr<SurfaceFramePool> pool)
+          : pool(std::move(pool)) {}
+    template <typename U>
+    SurfaceFrameAllocator(const SurfaceFrameAllocator<U>& other) : pool(other.pool) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(pool->allocate(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { pool->deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const SurfaceFrameAllocator<U>& other) const {
+        return pool == other.pool;
+    }
+    template <typename U>
+    bool operator!=(const SurfaceFrameAllocator<U>& other) const {
+        return pool != other.pool;
+    }
+
+    std::shared_ptr<SurfaceFramePool> pool;
+};
+
+} // namespace
+
+SurfaceFramePool::~SurfaceFramePool() {
+    for (void* block : mFreeBlocks) {
+        ::operator delete(block);
+    }
+}
+
+void* SurfaceFramePool::allocate(size_t bytes) {
+    {
+        std::scoped_lock lock(mMutex);
+        if (mBlockSize == 0) {
+            mBlockSize = bytes;
+        }
+        if (bytes == mBlockSize && !mFreeBlocks.empty()) {
+            void* block = mFreeBlocks.back();
+            mFreeBlocks.pop_back();
+            return block;
+        }
+    }
+    return ::operator new(bytes);
+}
+
+void SurfaceFramePool::deallocate(void* block, size_t bytes) {
+    {
+        std::scoped_lock lock(mMutex);
+        if (bytes == mBlockSize && mFreeBlocks.size() < kMaxFreeBlocks) {
+            mFreeBlocks.push_back(block);
+            return;
+        }
+    }
+    ::operator delete(block);
+}
+
+size_t SurfaceFramePool::getFreeBlockCount() const {
+    std::scoped_lock lock(mMutex);
+    return mFreeBlocks.size();
+}
+
+template <typename... Args>
+std::shared_ptr<SurfaceFrame> FrameTimeline::makeSurfaceFrame(Args&&... args) {
+    return std::allocate_shared<SurfaceFrame>(SurfaceFrameAllocator<SurfaceFrame>(
+                                                      mSurfaceFramePool),
+                                              std::forward<Args>(args)...);
+}
+
 std::shared_ptr<SurfaceFrame> FrameTimeline::createSurfaceFrameForToken(
         const FrameTimelineInfo& frameTimelineInfo, pid_t ownerPid, uid_t ownerUid, int32_t layerId,
         std::string layerName, std::string debugName, bool isBuffer, GameMode gameMode) {
     ATRACE_CALL();
     if (frameTimelineInfo.vsyncId == FrameTimelineInfo::INVALID_VSYNC_ID) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                              std::move(layerName), std::move(debugName),
-                                              PredictionState::None, TimelineItem(), mTimeStats,
-                                              mJankClassificationThresholds, &mTraceCookieCounter,
-                                              isBuffer, gameMode);
+        return makeSurfaceFrame(frameTimelineInfo, ownerPid, ownerUid, layerId,
+                                std::move(layerName), std::move(debugName), PredictionState::None,
+                                TimelineItem(), mTimeStats, mJankClassificationThresholds,
+                                &mTraceCookieCounter, isBuffer, gameMode);
     }
     std::optional<TimelineItem> predictions =
             mTokenManager.getPredictionsForToken(frameTimelineInfo.vsyncId);
     if (predictions) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                              std::move(layerName), std::move(debugName),
-                                              PredictionState::Valid, std::move(*predictions),
-                                              mTimeStats, mJankClassificationThresholds,
-                                              &mTraceCookieCounter, isBuffer, gameMode);
+        return makeSurfaceFrame(frameTimelineInfo, ownerPid, ownerUid, layerId,
+                                std::move(layerName), std::move(debugName), PredictionState::Valid,
+                                std::move(*predictions), mTimeStats, mJankClassificationThresholds,
+                                &mTraceCookieCounter, isBuffer, gameMode);
     }
-    return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                          std::move(layerName), std::move(debugName),
-                                          PredictionState::Expired, TimelineItem(), mTimeStats,
-                                          mJankClassificationThresholds, &mTraceCookieCounter,
-                                          isBuffer, gameMode);
+    return makeSurfaceFrame(frameTimelineInfo, ownerPid, ownerUid, layerId, std::move(layerName),
+                            std::move(debugName), PredictionState::Expired, TimelineItem(),
+                            mTimeStats, mJankClassificationThresholds, &mTraceCookieCounter,
+                            isBuffer, gameMode);
 }
 
 FrameTimeline::DisplayFrame::DisplayFrame(std::shared_ptr<TimeStats> timeStats,
@@ -839,6 +930,9 @@ void FrameTimeline::setSfPresent(nsecs_t sfPresentTime,
                                  const std::shared_ptr<FenceTime>& presentFence,
                                  const std::shared_ptr<FenceTime>& gpuFence) {
     ATRACE_CALL();
+    // The previous frames must be classified before presenting further ones, which bounds both the
+    // delay of their JankInfo and the work queued up on the worker.
+    waitForClassification();
     std::scoped_lock lock(mMutex);
     mCurrentDisplayFrame->setActualEndTime(sfPresentTime);
     mCurrentDisplayFrame->setGpuFence(gpuFence);
@@ -848,7 +942,21 @@ void FrameTimeline::setSfPresent(nsecs_t sfPresentTime,
 }
 
 void FrameTimeline::DisplayFrame::addSurfaceFrame(std::shared_ptr<SurfaceFrame> surfaceFrame) {
-    mSurfaceFrames.push_back(surfaceFrame);
+    mSurfaceFrames.push_back(std::move(surfaceFrame));
+}
+
+void FrameTimeline::DisplayFrame::recycle() {
+    mToken = FrameTimelineInfo::INVALID_VSYNC_ID;
+    mSurfaceFlingerPredictions = TimelineItem();
+    mSurfaceFlingerActuals = TimelineItem();
+    mSurfaceFrames.clear();
+    mPredictionState = PredictionState::None;
+    mJankType = JankType::None;
+    mGpuFence = FenceTime::NO_FENCE;
+    mFramePresentMetadata = FramePresentMetadata::UnknownPresent;
+    mFrameReadyMetadata = FrameReadyMetadata::UnknownFinish;
+    mFrameStartMetadata = FrameStartMetadata::UnknownStart;
+    mRefreshRate = Fps();
 }
 
 void FrameTimeline::DisplayFrame::onSfWakeUp(int64_t token, Fps refreshRate,
@@ -1203,19 +1311,20 @@ void FrameTimeline::flushPendingPresentFences() {
             ? (systemTime(SYSTEM_TIME_BOOTTIME) - systemTime(SYSTEM_TIME_MONOTONIC))
             : 0;
 
+    std::vector<PresentedFrame> presentedFrames;
+
     // Present fences are expected to be signaled in order. Mark all the previous
     // pending fences as errors.
     for (size_t i = 0; i < firstSignaledFence.value(); i++) {
-        const auto& pendingPresentFence = *mPendingPresentFences.begin();
+        auto& pendingPresentFence = *mPendingPresentFences.begin();
         const nsecs_t signalTime = Fence::SIGNAL_TIME_INVALID;
-        auto& displayFrame = pendingPresentFence.second;
-        displayFrame->onPresent(signalTime, mPreviousPresentTime);
-        displayFrame->trace(mSurfaceFlingerPid, monoBootOffset);
+        presentedFrames.push_back({std::move(pendingPresentFence.second), signalTime,
+                                   mPreviousPresentTime, monoBootOffset});
         mPendingPresentFences.erase(mPendingPresentFences.begin());
     }
 
     for (size_t i = 0; i < mPendingPresentFences.size(); i++) {
-        const auto& pendingPresentFence = mPendingPresentFences[i];
+        auto& pendingPresentFence = mPendingPresentFences[i];
         nsecs_t signalTime = Fence::SIGNAL_TIME_INVALID;
         if (pendingPresentFence.first && pendingPresentFence.first->isValid()) {
             signalTime = pendingPresentFence.first->getSignalTime();
@@ -1224,25 +1333,110 @@ void FrameTimeline::flushPendingPresentFences() {
             }
         }
 
-        auto& displayFrame = pendingPresentFence.second;
-        displayFrame->onPresent(signalTime, mPreviousPresentTime);
-        displayFrame->trace(mSurfaceFlingerPid, monoBootOffset);
+        presentedFrames.push_back({std::move(pendingPresentFence.second), signalTime,
+                                   mPreviousPresentTime, monoBootOffset});
         mPreviousPresentTime = signalTime;
 
         mPendingPresentFences.erase(mPendingPresentFences.begin() + static_cast<int>(i));
         --i;
     }
+
+    onPresentedFrames(std::move(presentedFrames));
+}
+
+void FrameTimeline::onPresentedFrames(std::vector<PresentedFrame>&& frames) {
+    if (frames.empty()) {
+        return;
+    }
+
+    if (!mClassifyAsync) {
+        for (const auto& frame : frames) {
+            frame.displayFrame->onPresent(frame.signalTime, frame.previousPresentTime);
+            frame.displayFrame->trace(mSurfaceFlingerPid, frame.monoBootOffset);
+        }
+        return;
+    }
+
+    std::scoped_lock lock(mWorkerMutex);
+    std::move(frames.begin(), frames.end(), std::back_inserter(mWorkerQueue));
+    mSubmittedBatches++;
+    mWorkerCv.notify_one();
+}
+
+void FrameTimeline::waitForClassification() {
+    std::unique_lock lock(mWorkerMutex);
+    base::ScopedLockAssertion assumeLocked(mWorkerMutex);
+    if (mClassifiedBatches == mSubmittedBatches) {
+        return;
+    }
+    ATRACE_NAME("waitForClassification");
+    mClassifiedCv.wait(lock, [this]() REQUIRES(mWorkerMutex) {
+        return mClassifiedBatches == mSubmittedBatches;
+    });
+}
+
+void FrameTimeline::workerLoop() {
+    std::vector<PresentedFrame> frames;
+    while (true) {
+        uint64_t batches;
+        {
+            std::unique_lock lock(mWorkerMutex);
+            base::ScopedLockAssertion assumeLocked(mWorkerMutex);
+            mWorkerCv.wait(lock, [this]() REQUIRES(mWorkerMutex) {
+                return mWorkerDone || !mWorkerQueue.empty();
+            });
+            // Frames handed over before destruction are still classified.
+            if (mWorkerQueue.empty()) {
+                return;
+            }
+            std::swap(frames, mWorkerQueue);
+            batches = mSubmittedBatches;
+        }
+
+        {
+            ATRACE_NAME("classifyJank");
+            std::scoped_lock lock(mMutex);
+            for (const auto& frame : frames) {
+                frame.displayFrame->onPresent(frame.signalTime, frame.previousPresentTime);
+            }
+        }
+        {
+            std::scoped_lock lock(mWorkerMutex);
+            mClassifiedBatches = batches;
+        }
+        mClassifiedCv.notify_all();
+
+        // The frames are only read from now on, so dumpsys is not blocked by emitting the packets.
+        for (const auto& frame : frames) {
+            frame.displayFrame->trace(mSurfaceFlingerPid, frame.monoBootOffset);
+        }
+
+        // finalizeCurrentDisplayFrame only recycles a DisplayFrame that nothing else refers to,
+        // which it checks with mMutex held.
+        std::scoped_lock lock(mMutex);
+        frames.clear();
+    }
 }
 
 void FrameTimeline::finalizeCurrentDisplayFrame() {
+    std::shared_ptr<DisplayFrame> recycled;
     while (mDisplayFrames.size() >= mMaxDisplayFrames) {
-        // We maintain only a fixed number of frames' data. Pop older frames
+        // We maintain only a fixed number of frames' data. Pop older frames, and reuse one for the
+        // next frame unless something else, such as a pending present fence, still refers to it.
+        if (mDisplayFrames.front().use_count() == 1) {
+            recycled = std::move(mDisplayFrames.front());
+        }
         mDisplayFrames.pop_front();
     }
-    mDisplayFrames.push_back(mCurrentDisplayFrame);
-    mCurrentDisplayFrame.reset();
-    mCurrentDisplayFrame = std::make_shared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
-                                                          &mTraceCookieCounter);
+    mDisplayFrames.push_back(std::move(mCurrentDisplayFrame));
+    if (recycled) {
+        recycled->recycle();
+        mCurrentDisplayFrame = std::move(recycled);
+    } else {
+        mCurrentDisplayFrame = std::make_shared<DisplayFrame>(mTimeStats,
+                                                              mJankClassificationThresholds,
+                                                              &mTraceCookieCounter);
+    }
 }
 
 nsecs_t FrameTimeline::DisplayFrame::getBaseTime() const {
@@ -18,11 +18,14 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <gui/ISurfaceComposer.h>
 #include <gui/JankInfo.h>
@@ -347,6 +350,28 @@ private:
     static constexpr size_t kMaxTokens = 500;
 };
 
+// Keeps the memory of destroyed SurfaceFrames for reuse. SurfaceFrames are created and destroyed
+// for every layer on every frame and all have the same size, so a free list avoids most trips to
+// the general purpose allocator. Shared between FrameTimeline and the SurfaceFrames it created, so
+// that it outlives all of them.
+class SurfaceFramePool {
+public:
+    ~SurfaceFramePool();
+
+    void* allocate(size_t bytes);
+    void deallocate(void* block, size_t bytes);
+
+    size_t getFreeBlockCount() const;
+
+private:
+    static constexpr size_t kMaxFreeBlocks = 1024;
+
+    mutable std::mutex mMutex;
+    // Only blocks of this size are kept. Set by the first allocation.
+    size_t mBlockSize GUARDED_BY(mMutex) = 0;
+    std::vector<void*> mFreeBlocks GUARDED_BY(mMutex);
+};
+
 class FrameTimeline : public android::frametimeline::FrameTimeline {
 public:
     class FrameTimelineDataSource : public perfetto::DataSource<FrameTimelineDataSource> {
@@ -357,7 +382,8 @@ public:
 
     /*
      * DisplayFrame should be used only internally within FrameTimeline. All members and methods are
-     * guarded by FrameTimeline's mMutex.
+     * guarded by FrameTimeline's mMutex, except that a DisplayFrame is traced without it once it
+     * has been presented, as it is only read from then on.
      */
     class DisplayFrame {
     public:
@@ -385,6 +411,9 @@ public:
         void setActualStartTime(nsecs_t actualStartTime);
         void setActualEndTime(nsecs_t actualEndTime);
         void setGpuFence(const std::shared_ptr<FenceTime>& gpuFence);
+        // Resets the DisplayFrame to its initial state so that it can be reused for a new frame,
+        // keeping the capacity of mSurfaceFrames.
+        void recycle();
 
         // BaseTime is the smallest timestamp in a DisplayFrame.
         // Used for dumping all timestamps relative to the oldest, making it easy to read.
@@ -443,9 +472,12 @@ public:
         TraceCookieCounter& mTraceCookieCounter;
     };
 
+    // Unless classifyAsync is false, DisplayFrames whose present fence signaled are classified and
+    // traced on a worker thread rather than in setSfPresent.
     FrameTimeline(std::shared_ptr<TimeStats> timeStats, pid_t surfaceFlingerPid,
-                  JankClassificationThresholds thresholds = {}, bool useBootTimeClock = true);
-    ~FrameTimeline() = default;
+                  JankClassificationThresholds thresholds = {}, bool useBootTimeClock = true,
+                  bool classifyAsync = true);
+    ~FrameTimeline();
 
     frametimeline::TokenManager* getTokenManager() override { return &mTokenManager; }
     std::shared_ptr<SurfaceFrame> createSurfaceFrameForToken(
@@ -473,9 +505,27 @@ private:
     // Friend class for testing
     friend class android::frametimeline::FrameTimelineTest;
 
+    // A DisplayFrame whose present fence signaled, along with what is needed to classify and
+    // trace it. The DisplayFrame is no longer modified by the main thread.
+    struct PresentedFrame {
+        std::shared_ptr<DisplayFrame> displayFrame;
+        nsecs_t signalTime;
+        nsecs_t previousPresentTime;
+        nsecs_t monoBootOffset;
+    };
+
     void flushPendingPresentFences() REQUIRES(mMutex);
     std::optional<size_t> getFirstSignalFenceIndex() const REQUIRES(mMutex);
     void finalizeCurrentDisplayFrame() REQUIRES(mMutex);
+    // Classifies and traces the frames, or hands them to the worker thread.
+    void onPresentedFrames(std::vector<PresentedFrame>&& frames) REQUIRES(mMutex);
+    // Waits until the worker classified the frames handed to it so far. Frames are handed over in
+    // setSfPresent and classified before the next one, so that their JankInfo reaches
+    // TransactionCallbackInvoker at most one frame later than when classified synchronously.
+    void waitForClassification() EXCLUDES(mMutex, mWorkerMutex);
+    void workerLoop() EXCLUDES(mMutex, mWorkerMutex);
+    template <typename... Args>
+    std::shared_ptr<SurfaceFrame> makeSurfaceFrame(Args&&... args);
     void dumpAll(std::string& result);
     void dumpJank(std::string& result);
 
@@ -484,6 +534,8 @@ private:
     std::vector<std::pair<std::shared_ptr<FenceTime>, std::shared_ptr<DisplayFrame>>>
             mPendingPresentFences GUARDED_BY(mMutex);
     std::shared_ptr<DisplayFrame> mCurrentDisplayFrame GUARDED_BY(mMutex);
+    const std::shared_ptr<SurfaceFramePool> mSurfaceFramePool =
+            std::make_shared<SurfaceFramePool>();
     TokenManager mTokenManager;
     TraceCookieCounter mTraceCookieCounter;
     mutable std::mutex mMutex;
@@ -493,6 +545,18 @@ private:
     const pid_t mSurfaceFlingerPid;
     nsecs_t mPreviousPresentTime = 0;
     const JankClassificationThresholds mJankClassificationThresholds;
+
+    const bool mClassifyAsync;
+    std::mutex mWorkerMutex;
+    std::condition_variable mWorkerCv;
+    std::condition_variable mClassifiedCv;
+    std::vector<PresentedFrame> mWorkerQueue GUARDED_BY(mWorkerMutex);
+    // Number of batches of frames handed to the worker, and classified by it.
+    uint64_t mSubmittedBatches GUARDED_BY(mWorkerMutex) = 0;
+    uint64_t mClassifiedBatches GUARDED_BY(mWorkerMutex) = 0;
+    bool mWorkerDone GUARDED_BY(mWorkerMutex) = false;
+    std::thread mWorker;
+
     static constexpr uint32_t kDefaultMaxDisplayFrames = 64;
     // The initial container size for the vector<SurfaceFrames> inside display frame. Although
     // this number doesn't represent any bounds on the number of surface frames that can go in a
@@ -19,6 +19,9 @@
 #undef LOG_TAG
 #define LOG_TAG "SurfaceFlinger"
 
+#include <memory>
+#include <new>
+
 #include "LayerLifecycleManager.h"
 #include "Client.h" // temporarily needed for LayerCreationArgs
 #include "LayerLog.h"
@@ -29,6 +32,9 @@ namespace android::surfaceflinger::frontend {
 using namespace ftl::flag_operators;
 
 namespace {
+// Bounds the memory held by destroyed layers waiting to be reused.
+constexpr size_t kMaxRecycledLayers = 16;
+
 // Returns true if the layer is root of a display and can be mirrored by mirroringLayer
 bool canMirrorRootLayer(RequestedLayerState& mirroringLayer, RequestedLayerState& rootLayer) {
     return rootLayer.isRoot() && rootLayer.layerStack == mirroringLayer.layerStackToMirror &&
@@ -43,51 +49,56 @@ void LayerLifecycleManager::addLayers(std::vector<std::unique_ptr<RequestedLayer
 
     mGlobalChanges |= RequestedLayerState::Changes::Hierarchy;
     for (auto& newLayer : newLayers) {
-        RequestedLayerState& layer = *newLayer.get();
-        auto [it, inserted] = mIdToLayer.try_emplace(layer.id, References{.owner = layer});
-        if (!inserted) {
-            LOG_ALWAYS_FATAL("Duplicate layer id found. New layer: %s Existing layer: %s",
-                             layer.getDebugString().c_str(),
-                             it->second.owner.getDebugString().c_str());
-        }
-        mAddedLayers.push_back(newLayer.get());
-        mChangedLayers.push_back(newLayer.get());
-        layer.parentId = linkLayer(layer.parentId, layer.id);
-        layer.relativeParentId = linkLayer(layer.relativeParentId, layer.id);
-        if (layer.layerStackToMirror != ui::INVALID_LAYER_STACK) {
-            // Set mirror layer's default layer stack to -1 so it doesn't end up rendered on a
-            // display accidentally.
-            layer.layerStack = ui::INVALID_LAYER_STACK;
-
-            // if this layer is mirroring a display, then walk though all the existing root layers
-            // for the layer stack and add them as children to be mirrored.
-            mDisplayMirroringLayers.emplace_back(layer.id);
-            for (auto& rootLayer : mLayers) {
-                if (canMirrorRootLayer(layer, *rootLayer)) {
-                    layer.mirrorIds.emplace_back(rootLayer->id);
-                    linkLayer(rootLayer->id, layer.id);
-                }
-            }
-        } else {
-            // Check if we are mirroring a single layer, and if so add it to the list of children
-            // to be mirrored.
-            layer.layerIdToMirror = linkLayer(layer.layerIdToMirror, layer.id);
-            if (layer.layerIdToMirror != UNASSIGNED_LAYER_ID) {
-                layer.mirrorIds.emplace_back(layer.layerIdToMirror);
+        addLayer(std::move(newLayer));
+    }
+}
+
+void LayerLifecycleManager::addLayer(std::unique_ptr<RequestedLayerState> newLayer) {
+    RequestedLayerState& layer = *newLayer.get();
+    auto [it, inserted] = mIdToLayer.try_emplace(layer.id, References{.owner = layer});
+    if (!inserted) {
+        LOG_ALWAYS_FATAL("Duplicate layer id found. New layer: %s Existing layer: %s",
+                         layer.getDebugString().c_str(),
+                         it->second.owner.getDebugString().c_str());
+    }
+    mAddedLayers.push_back(newLayer.get());
+    mChangedLayers.push_back(newLayer.get());
+    layer.parentId = linkLayer(layer.parentId, layer.id);
+    layer.relativeParentId = linkLayer(layer.relativeParentId, layer.id);
+    if (layer.layerStackToMirror != ui::INVALID_LAYER_STACK) {
+        // Set mirror layer's default layer stack to -1 so it doesn't end up rendered on a
+        // display accidentally.
+        layer.layerStack = ui::INVALID_LAYER_STACK;
+
+        // if this layer is mirroring a display, then walk though all the existing root layers
+        // for the layer stack and add them as children to be mirrored.
+        mDisplayMirroringLayers.emplace_back(layer.id);
+        for (auto& rootLayer : mLayers) {
+            if (canMirrorRootLayer(layer, *rootLayer)) {
+                layer.mirrorIds.emplace_back(rootLayer->id);
+                linkLayer(rootLayer->id, layer.id);
             }
         }
-        layer.touchCropId = linkLayer(layer.touchCropId, layer.id);
-        if (layer.isRoot()) {
-            updateDisplayMirrorLayers(layer);
+    } else {
+        // Check if we are mirroring a single layer, and if so add it to the list of children
+        // to be mirrored.
+        layer.layerIdToMirror = linkLayer(layer.layerIdToMirror, layer.id);
+        if (layer.layerIdToMirror != UNASSIGNED_LAYER_ID) {
+            layer.mirrorIds.emplace_back(layer.layerIdToMirror);
         }
-        LLOGV(layer.id, "%s", layer.getDebugString().c_str());
-        mLayers.emplace_back(std::move(newLayer));
     }
+    layer.touchCropId = linkLayer(layer.touchCropId, layer.id);
+    if (layer.isRoot()) {
+        updateDisplayMirrorLayers(layer);
+    }
+    LLOGV(layer.id, "%s", layer.getDebugString().c_str());
+    mLayers.emplace_back(std::move(newLayer));
 }
 
 void LayerLifecycleManager::onHandlesDestroyed(const std::vector<uint32_t>& destroyedHandles,
                                                bool ignoreUnknownHandles) {
-    std::vector<uint32_t> layersToBeDestroyed;
+    std::vector<uint32_t>& layersToBeDestroyed = mLayersToBeDestroyed;
+    layersToBeDestroyed.clear();
     for (const auto& layerId : destroyedHandles) {
         auto it = mIdToLayer.find(layerId);
         if (it == mIdToLayer.end()) {
@@ -180,6 +191,7 @@ void LayerLifecycleManager::onHandlesDestroyed(const std::vector<uint32_t>& dest
 
 void LayerLifecycleManager::applyTransactions(const std::vector<TransactionState>& transactions,
                                               bool ignoreUnknownLayers) {
+    mDestroyedBgColorLayers.clear();
     for (const auto& transaction : transactions) {
         for (const auto& resolvedComposerState : transaction.states) {
             const auto& clientState = resolvedComposerState.state;
@@ -225,10 +237,9 @@ void LayerLifecycleManager::applyTransactions(const std::vector<TransactionState
                     backgroundLayerArgs.parentId = layer->id;
                     backgroundLayerArgs.name = layer->name + "BackgroundColorLayer";
                     backgroundLayerArgs.flags = ISurfaceComposerClient::eFXSurfaceEffect;
-                    std::vector<std::unique_ptr<RequestedLayerState>> newLayers;
-                    newLayers.emplace_back(
-                            std::make_unique<RequestedLayerState>(backgroundLayerArgs));
-                    RequestedLayerState* backgroundLayer = newLayers.back().get();
+                    std::unique_ptr<RequestedLayerState> newLayer =
+                            createInternalLayer(backgroundLayerArgs);
+                    RequestedLayerState* backgroundLayer = newLayer.get();
                     backgroundLayer->bgColorLayer = true;
                     backgroundLayer->handleAlive = false;
                     backgroundLayer->parentId = layer->id;
@@ -236,12 +247,15 @@ void LayerLifecycleManager::applyTransactions(const std::vector<TransactionState
                     backgroundLayer->color = layer->bgColor;
                     backgroundLayer->dataspace = layer->bgColorDataspace;
                     layer->bgColorLayerId = backgroundLayer->id;
-                    addLayers({std::move(newLayers)});
+                    mGlobalChanges |= RequestedLayerState::Changes::Hierarchy;
+                    addLayer(std::move(newLayer));
                 } else if (layer->bgColorLayerId != UNASSIGNED_LAYER_ID && layer->bgColor.a == 0) {
                     RequestedLayerState* bgColorLayer = getLayerFromId(layer->bgColorLayerId);
                     layer->bgColorLayerId = UNASSIGNED_LAYER_ID;
                     bgColorLayer->parentId = unlinkLayer(bgColorLayer->parentId, bgColorLayer->id);
-                    onHandlesDestroyed({bgColorLayer->id});
+                    // Nothing can reach the layer anymore, so destroy it with the others below
+                    // instead of compacting mLayers for each one.
+                    mDestroyedBgColorLayers.emplace_back(bgColorLayer->id);
                 } else if (layer->bgColorLayerId != UNASSIGNED_LAYER_ID) {
                     RequestedLayerState* bgColorLayer = getLayerFromId(layer->bgColorLayerId);
                     bgColorLayer->color = layer->bgColor;
@@ -276,6 +290,10 @@ void LayerLifecycleManager::applyTransactions(const std::vector<TransactionState
             mGlobalChanges |= layer->changes;
         }
     }
+
+    if (!mDestroyedBgColorLayers.empty()) {
+        onHandlesDestroyed(mDestroyedBgColorLayers);
+    }
 }
 
 void LayerLifecycleManager::commitChanges() {
@@ -294,12 +312,28 @@ void LayerLifecycleManager::commitChanges() {
         for (auto& listener : mListeners) {
             listener->onLayerDestroyed(*destroyedLayer);
         }
+        // Background color layers come and go with the color of their parent. They hold no
+        // buffers or client objects, so they can be kept around until the next one is created.
+        if (destroyedLayer->bgColorLayer && mRecycledLayers.size() < kMaxRecycledLayers) {
+            mRecycledLayers.emplace_back(std::move(destroyedLayer));
+        }
     }
     mDestroyedLayers.clear();
     mChangedLayers.clear();
     mGlobalChanges.clear();
 }
 
+std::unique_ptr<RequestedLayerState> LayerLifecycleManager::createInternalLayer(
+        const LayerCreationArgs& args) {
+    if (mRecycledLayers.empty()) {
+        return std::make_unique<RequestedLayerState>(args);
+    }
+    RequestedLayerState* storage = mRecycledLayers.back().release();
+    mRecycledLayers.pop_back();
+    std::destroy_at(storage);
+    return std::unique_ptr<RequestedLayerState>(new (storage) RequestedLayerState(args));
+}
+
 void LayerLifecycleManager::addLifecycleListener(std::shared_ptr<ILifecycleListener> listener) {
     mListeners.emplace_back(std::move(listener));
 }
@@ -92,6 +92,9 @@ private:
     std::vector<uint32_t> unlinkLayers(const std::vector<uint32_t>& layerIds, uint32_t linkedLayer);
 
     void updateDisplayMirrorLayers(RequestedLayerState& rootLayer);
+    void addLayer(std::unique_ptr<RequestedLayerState>);
+    // Creates an internal layer, reusing the storage of a previously destroyed one if possible.
+    std::unique_ptr<RequestedLayerState> createInternalLayer(const LayerCreationArgs&);
 
     struct References {
         // Lifetime tied to mLayers
@@ -115,6 +118,12 @@ private:
     std::vector<RequestedLayerState*> mAddedLayers;
     // Keeps track of new and layers with states changes since last commit.
     std::vector<RequestedLayerState*> mChangedLayers;
+    // Destroyed background color layers kept for createInternalLayer, so that toggling a
+    // background color every frame does not allocate.
+    std::vector<std::unique_ptr<RequestedLayerState>> mRecycledLayers;
+    // Scratch space for onHandlesDestroyed and applyTransactions, reused across updates.
+    std::vector<uint32_t> mLayersToBeDestroyed;
+    std::vector<uint32_t> mDestroyedBgColorLayers;
 };
 
 } // namespace android::surfaceflinger::frontend
@@ -126,6 +126,8 @@ struct LayerSnapshot : public compositionengine::LayerFECompositionState {
         ReachableByRelativeParent
     };
     Reachablilty reachablilty;
+    // See LayerSnapshotBuilder::SnapshotHandle
+    uint32_t handle = std::numeric_limits<uint32_t>::max();
 
     static bool isOpaqueFormat(PixelFormat format);
     static bool isTransformValid(const ui::Transform& t);
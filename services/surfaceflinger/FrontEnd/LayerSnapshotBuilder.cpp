@@ -22,6 +22,7 @@
 #include <numeric>
 #include <optional>
 
+#include <android-base/stringprintf.h>
 #include <ftl/small_map.h>
 #include <gui/TraceUtils.h>
 #include <ui/DisplayMap.h>
@@ -374,6 +375,16 @@ LayerSnapshotBuilder::LayerSnapshotBuilder() : mRootSnapshot(getRootSnapshot())
 LayerSnapshotBuilder::LayerSnapshotBuilder(Args args) : LayerSnapshotBuilder() {
     args.forceUpdate = ForceUpdateFlags::ALL;
     updateSnapshots(args);
+    updatePackedStates();
+}
+
+void LayerSnapshotBuilder::PackedSnapshotStates::resize(size_t size) {
+    isVisible.resize(size);
+    hasInputInfo.resize(size);
+    layerStack.resize(size);
+    alpha.resize(size);
+    transformedBounds.resize(size);
+    handle.resize(size);
 }
 
 bool LayerSnapshotBuilder::tryFastUpdate(const Args& args) {
@@ -436,9 +447,26 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
         mRootSnapshot.clientChanges |= layer_state_t::eReparent;
     }
 
-    for (auto& snapshot : mSnapshots) {
-        if (snapshot->reachablilty == LayerSnapshot::Reachablilty::Reachable) {
-            snapshot->reachablilty = LayerSnapshot::Reachablilty::Unreachable;
+    mSkipCleanSubtrees = canUpdateIncrementally(args);
+    mUpdateStats.visitedSnapshots = 0;
+    if (mSkipCleanSubtrees) {
+        mUpdateStats.incrementalUpdates++;
+        collectDirtyLayers(args);
+        // Snapshots in clean subtrees will not be visited so they keep their reachability.
+        for (uint32_t layerId : mDirtyLayerIds) {
+            auto range = mIdToSnapshots.equal_range(layerId);
+            for (auto it = range.first; it != range.second; it++) {
+                if (it->second->reachablilty == LayerSnapshot::Reachablilty::Reachable) {
+                    it->second->reachablilty = LayerSnapshot::Reachablilty::Unreachable;
+                }
+            }
+        }
+    } else {
+        mUpdateStats.fullUpdates++;
+        for (auto& snapshot : mSnapshots) {
+            if (snapshot->reachablilty == LayerSnapshot::Reachablilty::Reachable) {
+                snapshot->reachablilty = LayerSnapshot::Reachablilty::Unreachable;
+            }
         }
     }
 
@@ -454,9 +482,14 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
             LayerHierarchy::ScopedAddToTraversalPath addChildToPath(root,
                                                                     childHierarchy->getLayer()->id,
                                                                     variant);
+            if (canSkipSubtree(root, mRootSnapshot)) {
+                continue;
+            }
             updateSnapshotsInHierarchy(args, *childHierarchy, root, mRootSnapshot, /*depth=*/0);
         }
     }
+    mSkipCleanSubtrees = false;
+    mDirtyLayerIds.clear();
 
     // Update touchable region crops outside the main update pass. This is because a layer could be
     // cropped by any other layer and it requires both snapshots to be updated.
@@ -464,6 +497,7 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
 
     const bool hasUnreachableSnapshots = sortSnapshotsByZ(args);
     clearChanges(mRootSnapshot);
+    mUpdateStats.totalSnapshots = mSnapshots.size();
 
     // Destroy unreachable snapshots for clone layers. And destroy snapshots for non-clone
     // layers if the layer have been destroyed.
@@ -501,6 +535,8 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
                 });
         mIdToSnapshots.erase(matchingSnapshot);
         mNeedsTouchableRegionCrop.erase(traversalPath);
+        mHandleToSnapshot[it->get()->handle] = nullptr;
+        mFreeHandles.push_back(it->get()->handle);
         mSnapshots.back()->globalZ = it->get()->globalZ;
         std::iter_swap(it, mSnapshots.end() - 1);
         mSnapshots.erase(mSnapshots.end() - 1);
@@ -512,10 +548,147 @@ void LayerSnapshotBuilder::update(const Args& args) {
         clearChanges(*snapshot);
     }
 
+    const bool hasChanges = args.layerLifecycleManager.getGlobalChanges().get() != 0 ||
+            args.forceUpdate != ForceUpdateFlags::NONE || args.displayChanges;
     if (tryFastUpdate(args)) {
+        mUpdateStats.fastUpdates++;
+    } else {
+        updateSnapshots(args);
+    }
+    if (hasChanges) {
+        updatePackedStates();
+    }
+}
+
+void LayerSnapshotBuilder::updatePackedStates() {
+    ATRACE_NAME("UpdatePackedStates");
+    mPackedStates.resize(mSnapshots.size());
+    for (size_t i = 0; i < mSnapshots.size(); i++) {
+        const LayerSnapshot& snapshot = *mSnapshots[i];
+        mPackedStates.isVisible[i] = snapshot.isVisible;
+        mPackedStates.hasInputInfo[i] = snapshot.hasInputInfo();
+        mPackedStates.layerStack[i] = snapshot.outputFilter.layerStack;
+        mPackedStates.alpha[i] = snapshot.alpha;
+        mPackedStates.transformedBounds[i] = snapshot.transformedBounds;
+        mPackedStates.handle[i] = snapshot.handle;
+    }
+}
+
+bool LayerSnapshotBuilder::canUpdateIncrementally(const Args& args) const {
+    if (!args.incrementalUpdate || args.forceUpdate != ForceUpdateFlags::NONE ||
+        args.displayChanges || args.parentCrop || mSnapshots.empty() ||
+        !args.layerLifecycleManager.getDestroyedLayers().empty()) {
+        return false;
+    }
+
+    const auto isReachable = [this](uint32_t layerId) {
+        const LayerSnapshot* snapshot = getSnapshot(layerId);
+        return snapshot && snapshot->reachablilty == LayerSnapshot::Reachablilty::Reachable;
+    };
+
+    // Skipped subtrees keep their reachability from the previous update. This is only valid if
+    // every layer that moved in the hierarchy is still attached to a reachable layer. Otherwise
+    // the subtree the layer left behind would need to be marked unreachable.
+    for (const RequestedLayerState* layer : args.layerLifecycleManager.getChangedLayers()) {
+        if (layer->changes.test(RequestedLayerState::Changes::Mirror)) {
+            return false;
+        }
+        if (!layer->changes.any(RequestedLayerState::Changes::Parent |
+                                RequestedLayerState::Changes::RelativeParent)) {
+            continue;
+        }
+        if (!layer->isRoot() && !isReachable(layer->parentId)) {
+            return false;
+        }
+        if (layer->hasValidRelativeParent() && !isReachable(layer->relativeParentId)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LayerSnapshotBuilder::collectDirtyLayers(const Args& args) {
+    mDirtyLayerIds.clear();
+    const LayerLifecycleManager& lifecycleManager = args.layerLifecycleManager;
+    std::vector<uint32_t> pendingLayerIds;
+    const auto markDirty = [&](uint32_t layerId) {
+        pendingLayerIds.push_back(layerId);
+        while (!pendingLayerIds.empty()) {
+            const uint32_t id = pendingLayerIds.back();
+            pendingLayerIds.pop_back();
+            // Once a layer is marked, all the layers it can be reached from are marked as well.
+            if (id == UNASSIGNED_LAYER_ID || !mDirtyLayerIds.insert(id).second) {
+                continue;
+            }
+            const RequestedLayerState* layer = lifecycleManager.getLayerFromId(id);
+            if (!layer) {
+                continue;
+            }
+            pendingLayerIds.push_back(layer->parentId);
+            if (layer->hasValidRelativeParent()) {
+                pendingLayerIds.push_back(layer->relativeParentId);
+            }
+        }
+    };
+
+    for (const RequestedLayerState* layer : lifecycleManager.getChangedLayers()) {
+        markDirty(layer->id);
+    }
+    if (mDirtyLayerIds.empty()) {
         return;
     }
-    updateSnapshots(args);
+
+    // A dirty layer can also be reached through the layers mirroring it. Keep marking mirrors
+    // until there are no new dirty layers since mirrors can mirror other mirrors.
+    std::vector<const RequestedLayerState*> mirrorLayers;
+    for (const auto& layer : lifecycleManager.getLayers()) {
+        if (!layer->mirrorIds.empty()) {
+            mirrorLayers.push_back(layer.get());
+        }
+    }
+    bool markedMirror = true;
+    while (markedMirror) {
+        markedMirror = false;
+        for (const RequestedLayerState* mirror : mirrorLayers) {
+            if (mDirtyLayerIds.count(mirror->id) != 0) {
+                continue;
+            }
+            const bool mirrorsDirtyLayer =
+                    std::any_of(mirror->mirrorIds.begin(), mirror->mirrorIds.end(),
+                                [this](uint32_t id) { return mDirtyLayerIds.count(id) != 0; });
+            if (mirrorsDirtyLayer) {
+                markDirty(mirror->id);
+                markedMirror = true;
+            }
+        }
+    }
+}
+
+bool LayerSnapshotBuilder::canSkipSubtree(const LayerHierarchy::TraversalPath& path,
+                                          const LayerSnapshot& parentSnapshot) const {
+    if (!mSkipCleanSubtrees || mDirtyLayerIds.count(path.id) != 0) {
+        return false;
+    }
+    if (parentSnapshot.changes.any(
+                RequestedLayerState::Changes::Hierarchy | RequestedLayerState::Changes::Geometry |
+                RequestedLayerState::Changes::Visibility | RequestedLayerState::Changes::Metadata |
+                RequestedLayerState::Changes::AffectsChildren |
+                RequestedLayerState::Changes::FrameRate | RequestedLayerState::Changes::GameMode |
+                RequestedLayerState::Changes::Created | RequestedLayerState::Changes::Mirror) ||
+        (parentSnapshot.clientChanges & layer_state_t::AFFECTS_CHILDREN)) {
+        return false;
+    }
+    // New paths, for example clones of a newly mirrored layer, need a snapshot created.
+    return getSnapshot(path) != nullptr;
+}
+
+void LayerSnapshotBuilder::dump(std::string& result) const {
+    base::StringAppendF(&result,
+                        "LayerSnapshotBuilder: visited %zu of %zu snapshots in last walk "
+                        "(fast=%" PRIu64 " incremental=%" PRIu64 " full=%" PRIu64 ")\n",
+                        mUpdateStats.visitedSnapshots, mUpdateStats.totalSnapshots,
+                        mUpdateStats.fastUpdates, mUpdateStats.incrementalUpdates,
+                        mUpdateStats.fullUpdates);
 }
 
 const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
@@ -529,6 +702,7 @@ const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
                          "builder_stack_overflow_transactions.winscope");
     }
 
+    mUpdateStats.visitedSnapshots++;
     const RequestedLayerState* layer = hierarchy.getLayer();
     LayerSnapshot* snapshot = getSnapshot(traversalPath);
     const bool newSnapshot = snapshot == nullptr;
@@ -554,6 +728,9 @@ const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
         LayerHierarchy::ScopedAddToTraversalPath addChildToPath(traversalPath,
                                                                 childHierarchy->getLayer()->id,
                                                                 variant);
+        if (canSkipSubtree(traversalPath, *snapshot)) {
+            continue;
+        }
         const LayerSnapshot& childSnapshot =
                 updateSnapshotsInHierarchy(args, *childHierarchy, traversalPath, *snapshot,
                                            depth + 1);
@@ -579,11 +756,23 @@ LayerSnapshot* LayerSnapshotBuilder::getSnapshot(const LayerHierarchy::Traversal
     return it == mPathToSnapshot.end() ? nullptr : it->second;
 }
 
+LayerSnapshot* LayerSnapshotBuilder::getSnapshotFromHandle(SnapshotHandle handle) const {
+    return handle < mHandleToSnapshot.size() ? mHandleToSnapshot[handle] : nullptr;
+}
+
 LayerSnapshot* LayerSnapshotBuilder::createSnapshot(const LayerHierarchy::TraversalPath& path,
                                                     const RequestedLayerState& layer,
                                                     const LayerSnapshot& parentSnapshot) {
     mSnapshots.emplace_back(std::make_unique<LayerSnapshot>(layer, path));
     LayerSnapshot* snapshot = mSnapshots.back().get();
+    if (mFreeHandles.empty()) {
+        snapshot->handle = static_cast<SnapshotHandle>(mHandleToSnapshot.size());
+        mHandleToSnapshot.push_back(snapshot);
+    } else {
+        snapshot->handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+        mHandleToSnapshot[snapshot->handle] = snapshot;
+    }
     snapshot->globalZ = static_cast<size_t>(mSnapshots.size()) - 1;
     if (path.isClone() && path.variant != LayerHierarchy::Variant::Mirror) {
         snapshot->mirrorRootPath = parentSnapshot.mirrorRootPath;
@@ -957,6 +1146,14 @@ void LayerSnapshotBuilder::updateLayerBounds(LayerSnapshot& snapshot,
             snapshot.geomLayerTransform.transform(geomLayerBoundsWithoutTransparentRegion);
     snapshot.parentTransform = parentSnapshot.geomLayerTransform;
 
+    // Classify the transforms now, so that their fast paths are known up front and the snapshot
+    // is not written to lazily when composition reads it.
+    snapshot.geomLayerTransform.getType();
+    snapshot.geomInverseLayerTransform.getType();
+    snapshot.parentTransform.getType();
+    snapshot.localTransform.getType();
+    snapshot.localTransformInverse.getType();
+
     // Subtract the transparent region and snap to the bounds
     const Rect bounds =
             RequestedLayerState::reduce(snapshot.croppedBufferSize, requested.transparentRegion);
@@ -1079,9 +1276,8 @@ std::vector<std::unique_ptr<LayerSnapshot>>& LayerSnapshotBuilder::getSnapshots(
 
 void LayerSnapshotBuilder::forEachVisibleSnapshot(const ConstVisitor& visitor) const {
     for (int i = 0; i < mNumInterestingSnapshots; i++) {
-        LayerSnapshot& snapshot = *mSnapshots[(size_t)i];
-        if (!snapshot.isVisible) continue;
-        visitor(snapshot);
+        if (!mPackedStates.isVisible[(size_t)i]) continue;
+        visitor(*mSnapshots[(size_t)i]);
     }
 }
 
@@ -1101,17 +1297,15 @@ void LayerSnapshotBuilder::forEachVisibleSnapshot(const ConstVisitor& visitor,
 
 void LayerSnapshotBuilder::forEachVisibleSnapshot(const Visitor& visitor) {
     for (int i = 0; i < mNumInterestingSnapshots; i++) {
-        std::unique_ptr<LayerSnapshot>& snapshot = mSnapshots.at((size_t)i);
-        if (!snapshot->isVisible) continue;
-        visitor(snapshot);
+        if (!mPackedStates.isVisible[(size_t)i]) continue;
+        visitor(mSnapshots.at((size_t)i));
     }
 }
 
 void LayerSnapshotBuilder::forEachInputSnapshot(const ConstVisitor& visitor) const {
     for (int i = mNumInterestingSnapshots - 1; i >= 0; i--) {
-        LayerSnapshot& snapshot = *mSnapshots[(size_t)i];
-        if (!snapshot.hasInputInfo()) continue;
-        visitor(snapshot);
+        if (!mPackedStates.hasInputInfo[(size_t)i]) continue;
+        visitor(*mSnapshots[(size_t)i]);
     }
 }
 
@@ -54,7 +54,39 @@ public:
         std::unordered_set<uint32_t> excludeLayerIds;
         const std::unordered_map<std::string, bool>& supportedLayerGenericMetadata;
         const std::unordered_map<std::string, uint32_t>& genericLayerMetadataKeyMap;
+        // Set to true to skip walking subtrees that have no changes. The builder falls back
+        // to a full traversal if the changes could make existing snapshots unreachable.
+        bool incrementalUpdate = false;
     };
+    // Counters describing how much of the hierarchy was walked by the builder.
+    struct UpdateStats {
+        // Number of snapshots updated by the last hierarchy walk.
+        size_t visitedSnapshots = 0;
+        // Number of snapshots after the last hierarchy walk.
+        size_t totalSnapshots = 0;
+        uint64_t fastUpdates = 0;
+        uint64_t incrementalUpdates = 0;
+        uint64_t fullUpdates = 0;
+    };
+    // Stable index for a snapshot that remains valid until the snapshot is destroyed. Handles
+    // are reused after a snapshot is destroyed.
+    using SnapshotHandle = uint32_t;
+    static constexpr SnapshotHandle INVALID_SNAPSHOT_HANDLE =
+            std::numeric_limits<SnapshotHandle>::max();
+
+    // Fields read by most per-frame passes, packed by z-order index so that the passes can skip
+    // snapshots without dereferencing them. Refreshed after every update with changes.
+    struct PackedSnapshotStates {
+        std::vector<uint8_t> isVisible;
+        std::vector<uint8_t> hasInputInfo;
+        std::vector<ui::LayerStack> layerStack;
+        std::vector<float> alpha;
+        std::vector<FloatRect> transformedBounds;
+        std::vector<SnapshotHandle> handle;
+        size_t size() const { return handle.size(); }
+        void resize(size_t size);
+    };
+
     LayerSnapshotBuilder();
 
     // Rebuild the snapshots from scratch.
@@ -68,6 +100,8 @@ public:
     std::vector<std::unique_ptr<LayerSnapshot>>& getSnapshots();
     LayerSnapshot* getSnapshot(uint32_t layerId) const;
     LayerSnapshot* getSnapshot(const LayerHierarchy::TraversalPath& id) const;
+    LayerSnapshot* getSnapshotFromHandle(SnapshotHandle handle) const;
+    const PackedSnapshotStates& getPackedStates() const { return mPackedStates; }
 
     typedef std::function<void(const LayerSnapshot& snapshot)> ConstVisitor;
 
@@ -84,6 +118,9 @@ public:
     // Visit each snapshot interesting to input reverse z-order
     void forEachInputSnapshot(const ConstVisitor& visitor) const;
 
+    const UpdateStats& getUpdateStats() const { return mUpdateStats; }
+    void dump(std::string& result) const;
+
 private:
     friend class LayerSnapshotTest;
     static LayerSnapshot getRootSnapshot();
@@ -94,6 +131,13 @@ private:
 
     void updateSnapshots(const Args& args);
 
+    // Returns true if the hierarchy walk can skip subtrees without any changes.
+    bool canUpdateIncrementally(const Args& args) const;
+    // Collects the ids of changed layers and all the layers they can be reached from.
+    void collectDirtyLayers(const Args& args);
+    bool canSkipSubtree(const LayerHierarchy::TraversalPath& path,
+                        const LayerSnapshot& parentSnapshot) const;
+
     const LayerSnapshot& updateSnapshotsInHierarchy(const Args&, const LayerHierarchy& hierarchy,
                                                     LayerHierarchy::TraversalPath& traversalPath,
                                                     const LayerSnapshot& parentSnapshot, int depth);
@@ -119,6 +163,7 @@ private:
     void updateChildState(LayerSnapshot& snapshot, const LayerSnapshot& childSnapshot,
                           const Args& args);
     void updateTouchableRegionCrop(const Args& args);
+    void updatePackedStates();
 
     std::unordered_map<LayerHierarchy::TraversalPath, LayerSnapshot*,
                        LayerHierarchy::TraversalPathHash>
@@ -129,9 +174,19 @@ private:
     std::unordered_set<LayerHierarchy::TraversalPath, LayerHierarchy::TraversalPathHash>
             mNeedsTouchableRegionCrop;
     std::vector<std::unique_ptr<LayerSnapshot>> mSnapshots;
+    PackedSnapshotStates mPackedStates;
+    // Indexed by SnapshotHandle. Entries for destroyed snapshots are null.
+    std::vector<LayerSnapshot*> mHandleToSnapshot;
+    std::vector<SnapshotHandle> mFreeHandles;
     LayerSnapshot mRootSnapshot;
     bool mResortSnapshots = false;
     int mNumInterestingSnapshots = 0;
+
+    // Layers with changes and their ancestors, including relative parents and mirrors. Only
+    // valid while walking the hierarchy incrementally.
+    std::unordered_set<uint32_t> mDirtyLayerIds;
+    bool mSkipCleanSubtrees = false;
+    UpdateStats mUpdateStats;
 };
 
 } // namespace android::surfaceflinger::frontend
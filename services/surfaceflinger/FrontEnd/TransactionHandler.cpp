@@ -19,6 +19,7 @@
 #define LOG_TAG "SurfaceFlinger"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <android-base/stringprintf.h>
 #include <cutils/trace.h>
 #include <utils/Log.h>
 #include <utils/Trace.h>
@@ -33,20 +34,27 @@ void TransactionHandler::queueTransaction(TransactionState&& state) {
     ATRACE_INT("TransactionQueue", static_cast<int>(mPendingTransactionCount.load()));
 }
 
-std::vector<TransactionState> TransactionHandler::flushTransactions() {
+void TransactionHandler::collectTransactions() {
     while (!mLocklessTransactionQueue.isEmpty()) {
         auto maybeTransaction = mLocklessTransactionQueue.pop();
         if (!maybeTransaction.has_value()) {
             break;
         }
-        auto transaction = maybeTransaction.value();
+        auto& transaction = *maybeTransaction;
         mPendingTransactionQueues[transaction.applyToken].emplace(std::move(transaction));
     }
+}
+
+std::vector<TransactionState> TransactionHandler::flushTransactions() {
+    mFlushStats = {};
+    const nsecs_t drainStartTime = systemTime();
+    collectTransactions();
 
     // Collect transaction that are ready to be applied.
     std::vector<TransactionState> transactions;
     TransactionFlushState flushState;
     flushState.queueProcessTime = systemTime();
+    mFlushStats.drainDuration = flushState.queueProcessTime - drainStartTime;
     // Transactions with a buffer pending on a barrier may be on a different applyToken
     // than the transaction which satisfies our barrier. In fact this is the exact use case
     // that the primitive is designed for. This means we may first process
@@ -57,15 +65,27 @@ std::vector<TransactionState> TransactionHandler::flushTransactions() {
     // loop through flushPendingTransactionQueues until we perform an iteration
     // where the number of transactionsPendingBarrier doesn't change. This way
     // we can continue to resolve dependency chains of barriers as far as possible.
-    int lastTransactionsPendingBarrier = 0;
-    int transactionsPendingBarrier = 0;
-    do {
-        lastTransactionsPendingBarrier = transactionsPendingBarrier;
-        // Collect transactions that are ready to be applied.
-        transactionsPendingBarrier = flushPendingTransactionQueues(transactions, flushState);
-    } while (lastTransactionsPendingBarrier != transactionsPendingBarrier);
+    // Apart from barriers, the conditions checked by the filters only get stricter as more
+    // transactions are found to be ready (backpressure, latching unsignaled buffers), so after
+    // the first iteration only the queues that are waiting on a barrier need to be evaluated
+    // again. This avoids querying the fence status of every other queue on every iteration.
+    std::vector<sp<IBinder>> queuesPendingBarrier =
+            flushPendingTransactionQueues(transactions, flushState, /*applyTokens=*/nullptr);
+    size_t lastTransactionsPendingBarrier = 0;
+    while (queuesPendingBarrier.size() != lastTransactionsPendingBarrier) {
+        lastTransactionsPendingBarrier = queuesPendingBarrier.size();
+        queuesPendingBarrier =
+                flushPendingTransactionQueues(transactions, flushState, &queuesPendingBarrier);
+    }
 
     applyUnsignaledBufferTransaction(transactions, flushState);
+    mFlushStats.readyTransactions = transactions.size();
+    mFlushStats.pendingQueues = mPendingTransactionQueues.size();
+    mFlushStats.readinessDuration = systemTime() - flushState.queueProcessTime;
+    {
+        std::lock_guard lock(mFlushStatsMutex);
+        mLastFlushStats = mFlushStats;
+    }
 
     mPendingTransactionCount.fetch_sub(transactions.size());
     ATRACE_INT("TransactionQueue", static_cast<int>(mPendingTransactionCount.load()));
@@ -123,6 +143,7 @@ void TransactionHandler::popTransactionFromPending(std::vector<TransactionState>
 
 TransactionHandler::TransactionReadiness TransactionHandler::applyFilters(
         TransactionFlushState& flushState) {
+    mFlushStats.filterEvaluations++;
     auto ready = TransactionReadiness::Ready;
     for (auto& filter : mTransactionReadyFilters) {
         auto perFilterReady = filter(flushState);
@@ -143,29 +164,38 @@ TransactionHandler::TransactionReadiness TransactionHandler::applyFilters(
     return ready;
 }
 
-int TransactionHandler::flushPendingTransactionQueues(std::vector<TransactionState>& transactions,
-                                                      TransactionFlushState& flushState) {
-    int transactionsPendingBarrier = 0;
+std::vector<sp<IBinder>> TransactionHandler::flushPendingTransactionQueues(
+        std::vector<TransactionState>& transactions, TransactionFlushState& flushState,
+        const std::vector<sp<IBinder>>* applyTokens) {
+    mFlushStats.passes++;
+    std::vector<sp<IBinder>> queuesPendingBarrier;
+
+    if (applyTokens) {
+        for (const sp<IBinder>& applyToken : *applyTokens) {
+            auto it = mPendingTransactionQueues.find(applyToken);
+            if (it == mPendingTransactionQueues.end()) {
+                continue;
+            }
+            auto& queue = it->second;
+            const auto ready =
+                    flushPendingTransactionQueue(transactions, flushState, applyToken, queue);
+            if (ready == TransactionReadiness::NotReadyBarrier) {
+                queuesPendingBarrier.push_back(applyToken);
+            }
+            if (queue.empty()) {
+                mPendingTransactionQueues.erase(it);
+            }
+        }
+        return queuesPendingBarrier;
+    }
+
     auto it = mPendingTransactionQueues.begin();
     while (it != mPendingTransactionQueues.end()) {
         auto& [applyToken, queue] = *it;
-        while (!queue.empty()) {
-            auto& transaction = queue.front();
-            flushState.transaction = &transaction;
-            auto ready = applyFilters(flushState);
-            if (ready == TransactionReadiness::NotReadyBarrier) {
-                transactionsPendingBarrier++;
-                break;
-            } else if (ready == TransactionReadiness::NotReady) {
-                break;
-            } else if (ready == TransactionReadiness::NotReadyUnsignaled) {
-                // We maybe able to latch this transaction if it's the only transaction
-                // ready to be applied.
-                flushState.queueWithUnsignaledBuffer = applyToken;
-                break;
-            }
-            // ready == TransactionReadiness::Ready
-            popTransactionFromPending(transactions, flushState, queue);
+        const auto ready =
+                flushPendingTransactionQueue(transactions, flushState, applyToken, queue);
+        if (ready == TransactionReadiness::NotReadyBarrier) {
+            queuesPendingBarrier.push_back(applyToken);
         }
 
         if (queue.empty()) {
@@ -174,7 +204,29 @@ int TransactionHandler::flushPendingTransactionQueues(std::vector<TransactionSta
             it = std::next(it, 1);
         }
     }
-    return transactionsPendingBarrier;
+    return queuesPendingBarrier;
+}
+
+TransactionHandler::TransactionReadiness TransactionHandler::flushPendingTransactionQueue(
+        std::vector<TransactionState>& transactions, TransactionFlushState& flushState,
+        const sp<IBinder>& applyToken, std::queue<TransactionState>& queue) {
+    while (!queue.empty()) {
+        auto& transaction = queue.front();
+        flushState.transaction = &transaction;
+        auto ready = applyFilters(flushState);
+        if (ready == TransactionReadiness::NotReadyBarrier ||
+            ready == TransactionReadiness::NotReady) {
+            return ready;
+        } else if (ready == TransactionReadiness::NotReadyUnsignaled) {
+            // We maybe able to latch this transaction if it's the only transaction
+            // ready to be applied.
+            flushState.queueWithUnsignaledBuffer = applyToken;
+            return ready;
+        }
+        // ready == TransactionReadiness::Ready
+        popTransactionFromPending(transactions, flushState, queue);
+    }
+    return TransactionReadiness::Ready;
 }
 
 void TransactionHandler::addTransactionReadyFilter(TransactionFilter&& filter) {
@@ -207,6 +259,18 @@ TransactionHandler::getStalledTransactionInfo(pid_t pid) {
     return std::nullopt;
 }
 
+void TransactionHandler::dump(std::string& result) const {
+    std::lock_guard lock(mFlushStatsMutex);
+    base::StringAppendF(&result,
+                        "TransactionHandler: %zu pending queues, last flush applied %zu "
+                        "transactions in %zu passes with %zu filter evaluations "
+                        "(drain=%.3fms readiness=%.3fms)\n",
+                        mLastFlushStats.pendingQueues, mLastFlushStats.readyTransactions,
+                        mLastFlushStats.passes, mLastFlushStats.filterEvaluations,
+                        mLastFlushStats.drainDuration / 1e6f,
+                        mLastFlushStats.readinessDuration / 1e6f);
+}
+
 void TransactionHandler::onLayerDestroyed(uint32_t layerId) {
     std::lock_guard lock{mStalledMutex};
     for (auto it = mStalledTransactions.begin(); it != mStalledTransactions.end();) {
@@ -18,7 +18,9 @@
 
 #include <semaphore.h>
 #include <cstdint>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <vector>
 
 #include <LocklessQueue.h>
@@ -59,6 +61,10 @@ public:
     using TransactionFilter = std::function<TransactionReadiness(const TransactionFlushState&)>;
 
     bool hasPendingTransactions();
+    // Moves the queued transactions to the pending queue of their apply token, without checking
+    // whether they are ready. flushTransactions does this first, but the main thread may do it
+    // earlier when it would otherwise be idle.
+    void collectTransactions();
     std::vector<TransactionState> flushTransactions();
     void addTransactionReadyFilter(TransactionFilter&&);
     void queueTransaction(TransactionState&&);
@@ -75,11 +81,21 @@ public:
     std::optional<StalledTransactionInfo> getStalledTransactionInfo(pid_t pid);
     void onLayerDestroyed(uint32_t layerId);
 
+    void dump(std::string& result) const;
+
 private:
     // For unit tests
     friend class ::android::TestableSurfaceFlinger;
 
-    int flushPendingTransactionQueues(std::vector<TransactionState>&, TransactionFlushState&);
+    // Evaluates the queues of the given apply tokens, or all pending queues if applyTokens is
+    // null, and returns the apply tokens of the queues that are left waiting on a barrier.
+    std::vector<sp<IBinder>> flushPendingTransactionQueues(
+            std::vector<TransactionState>&, TransactionFlushState&,
+            const std::vector<sp<IBinder>>* applyTokens);
+    TransactionReadiness flushPendingTransactionQueue(std::vector<TransactionState>&,
+                                                      TransactionFlushState&,
+                                                      const sp<IBinder>& applyToken,
+                                                      std::queue<TransactionState>&);
     void applyUnsignaledBufferTransaction(std::vector<TransactionState>&, TransactionFlushState&);
     void popTransactionFromPending(std::vector<TransactionState>&, TransactionFlushState&,
                                    std::queue<TransactionState>&);
@@ -90,6 +106,21 @@ private:
     std::atomic<size_t> mPendingTransactionCount = 0;
     ftl::SmallVector<TransactionFilter, 2> mTransactionReadyFilters;
 
+    // Work done by flushTransactions, for dumpsys. mFlushStats is only accessed by
+    // flushTransactions and is published to mLastFlushStats once the flush is done, since
+    // dumpsys runs on a binder thread.
+    struct FlushStats {
+        size_t passes = 0;
+        size_t filterEvaluations = 0;
+        size_t readyTransactions = 0;
+        size_t pendingQueues = 0;
+        nsecs_t drainDuration = 0;
+        nsecs_t readinessDuration = 0;
+    };
+    FlushStats mFlushStats;
+    mutable std::mutex mFlushStatsMutex;
+    FlushStats mLastFlushStats GUARDED_BY(mFlushStatsMutex);
+
     std::mutex mStalledMutex;
     std::unordered_map<uint64_t /* transactionId */, StalledTransactionInfo> mStalledTransactions
             GUARDED_BY(mStalledMutex);
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LatencyStageTracker"
+
+#include "LatencyStageTracker.h"
+
+#include <android-base/stringprintf.h>
+#include <ftl/enum.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+
+namespace android {
+
+using base::StringAppendF;
+
+void LatencyStageTracker::Histogram::insert(nsecs_t duration) {
+    // Stages can be reported out of order, e.g. when a buffer is latched unsignaled. Such
+    // durations carry no information.
+    if (duration < 0) return;
+    const size_t bucket = std::min(static_cast<size_t>(duration / kBucketWidth), kNumBuckets - 1);
+    mBuckets[bucket]++;
+    mCount++;
+}
+
+nsecs_t LatencyStageTracker::Histogram::percentile(float percent) const {
+    if (mCount == 0) return 0;
+    const uint64_t target =
+            std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(mCount * percent / 100.f)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kNumBuckets; i++) {
+        seen += mBuckets[i];
+        if (seen >= target) {
+            return static_cast<nsecs_t>(i + 1) * kBucketWidth;
+        }
+    }
+    return static_cast<nsecs_t>(kNumBuckets) * kBucketWidth;
+}
+
+void LatencyStageTracker::onBufferPosted(int32_t layerId, uint64_t frameNumber, nsecs_t postTime,
+                                         nsecs_t applyTime) {
+    std::scoped_lock lock(mMutex);
+    auto& records = mRecords[layerId];
+    if (records.size() >= kMaxRecordsPerLayer) {
+        records.pop_front();
+        mDroppedRecords++;
+    }
+    records.push_back({.frameNumber = frameNumber, .postTime = postTime, .applyTime = applyTime});
+}
+
+void LatencyStageTracker::onBufferLatched(int32_t layerId, uint64_t frameNumber,
+                                          nsecs_t latchTime) {
+    std::scoped_lock lock(mMutex);
+    const auto it = mRecords.find(layerId);
+    if (it == mRecords.end()) return;
+    for (Record& record : it->second) {
+        if (record.frameNumber == frameNumber) {
+            record.latchTime = latchTime;
+            return;
+        }
+    }
+}
+
+std::optional<LatencyStageTracker::Record> LatencyStageTracker::takeRecordLocked(
+        int32_t layerId, uint64_t frameNumber) {
+    const auto it = mRecords.find(layerId);
+    if (it == mRecords.end()) return std::nullopt;
+
+    // Buffers older than the presented one were dropped or replaced, so forget them.
+    auto& records = it->second;
+    while (!records.empty() && records.front().frameNumber < frameNumber) {
+        records.pop_front();
+    }
+    if (records.empty() || records.front().frameNumber != frameNumber ||
+        records.front().latchTime == 0) {
+        return std::nullopt;
+    }
+    const Record record = records.front();
+    records.pop_front();
+    return record;
+}
+
+void LatencyStageTracker::recordPresentLocked(const Record& record, nsecs_t presentTime) {
+    const auto histogram = [this](Interval interval) -> Histogram& {
+        return mHistograms[static_cast<size_t>(interval)];
+    };
+    histogram(Interval::PostToApply).insert(record.applyTime - record.postTime);
+    histogram(Interval::ApplyToLatch).insert(record.latchTime - record.applyTime);
+    histogram(Interval::LatchToPresent).insert(presentTime - record.latchTime);
+    histogram(Interval::PostToPresent).insert(presentTime - record.postTime);
+}
+
+void LatencyStageTracker::onBufferPresented(int32_t layerId, uint64_t frameNumber,
+                                            nsecs_t presentTime) {
+    std::scoped_lock lock(mMutex);
+    if (const auto record = takeRecordLocked(layerId, frameNumber)) {
+        recordPresentLocked(*record, presentTime);
+    }
+}
+
+void LatencyStageTracker::onBufferPresented(int32_t layerId, uint64_t frameNumber,
+                                            const std::shared_ptr<FenceTime>& presentFence) {
+    std::scoped_lock lock(mMutex);
+    flushPresentFencesLocked();
+    const auto record = takeRecordLocked(layerId, frameNumber);
+    if (!record) return;
+    if (mPendingPresents.size() >= kMaxPendingPresents) {
+        mDroppedRecords++;
+        return;
+    }
+    mPendingPresents.push_back({*record, presentFence});
+}
+
+void LatencyStageTracker::onLayerDestroyed(int32_t layerId) {
+    std::scoped_lock lock(mMutex);
+    mRecords.erase(layerId);
+}
+
+void LatencyStageTracker::flushPresentFences() {
+    std::scoped_lock lock(mMutex);
+    flushPresentFencesLocked();
+}
+
+void LatencyStageTracker::flushPresentFencesLocked() {
+    auto it = mPendingPresents.begin();
+    while (it != mPendingPresents.end()) {
+        const nsecs_t presentTime = it->presentFence->getSignalTime();
+        if (presentTime == Fence::SIGNAL_TIME_PENDING) {
+            ++it;
+            continue;
+        }
+        if (presentTime != Fence::SIGNAL_TIME_INVALID) {
+            recordPresentLocked(it->record, presentTime);
+        }
+        it = mPendingPresents.erase(it);
+    }
+}
+
+LatencyStageTracker::Histogram LatencyStageTracker::getHistogram(Interval interval) const {
+    std::scoped_lock lock(mMutex);
+    return mHistograms[static_cast<size_t>(interval)];
+}
+
+void LatencyStageTracker::dump(std::string& result) {
+    std::scoped_lock lock(mMutex);
+    flushPresentFencesLocked();
+
+    StringAppendF(&result,
+                  "Buffer latency by stage (ms), %zu layers tracked, %" PRIu64 " records dropped\n",
+                  mRecords.size(), mDroppedRecords);
+    StringAppendF(&result, "%16s %10s %8s %8s %8s %8s\n", "stage", "count", "p50", "p90", "p99",
+                  "p99.9");
+    for (size_t i = 0; i < mHistograms.size(); i++) {
+        const Histogram& histogram = mHistograms[i];
+        const auto ms = [&histogram](float percent) {
+            return static_cast<float>(histogram.percentile(percent)) / 1e6f;
+        };
+        StringAppendF(&result, "%16s %10" PRIu64 " %8.1f %8.1f %8.1f %8.1f\n",
+                      ftl::enum_string(static_cast<Interval>(i)).c_str(), histogram.count(),
+                      ms(50.f), ms(90.f), ms(99.f), ms(99.9f));
+    }
+}
+
+void LatencyStageTracker::clear() {
+    std::scoped_lock lock(mMutex);
+    mRecords.clear();
+    mPendingPresents.clear();
+    mHistograms = {};
+    mDroppedRecords = 0;
+}
+
+} // namespace android
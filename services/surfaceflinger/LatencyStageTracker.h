@@ -0,0 +1,122 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+#include <ui/FenceTime.h>
+#include <utils/Timers.h>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+
+// LatencyStageTracker attributes the time a buffer spends inside SurfaceFlinger to the stages of
+// its lifecycle:
+//
+//   post     The transaction carrying the buffer was received by SurfaceFlinger.
+//   apply    The transaction was ready and applied to the layer on the main thread.
+//   latch    The buffer was latched for composition.
+//   present  The display present fence of the frame that showed the buffer signaled.
+//
+// Each stage transition is folded into a histogram once the present time is known, so memory
+// stays bounded and the tracker can run always-on. The per-buffer timestamps are also emitted to
+// perfetto by FrameTracer, which this does not duplicate.
+//
+// Thread-safe.
+class LatencyStageTracker {
+public:
+    enum class Interval : size_t {
+        PostToApply,
+        ApplyToLatch,
+        LatchToPresent,
+        PostToPresent,
+        ftl_last = PostToPresent
+    };
+
+    // Histogram of durations in 0.5ms buckets up to kMaxTrackedMs, plus an overflow bucket.
+    class Histogram {
+    public:
+        static constexpr nsecs_t kBucketWidth = 500'000;
+        static constexpr int32_t kMaxTrackedMs = 100;
+        static constexpr size_t kNumBuckets = kMaxTrackedMs * 2 + 1;
+
+        void insert(nsecs_t duration);
+        // Returns the upper bound of the bucket holding the given percentile, in nanoseconds.
+        // Returns 0 if the histogram is empty.
+        nsecs_t percentile(float percent) const;
+        uint64_t count() const { return mCount; }
+
+    private:
+        std::array<uint32_t, kNumBuckets> mBuckets{};
+        uint64_t mCount = 0;
+    };
+
+    void onBufferPosted(int32_t layerId, uint64_t frameNumber, nsecs_t postTime,
+                        nsecs_t applyTime);
+    void onBufferLatched(int32_t layerId, uint64_t frameNumber, nsecs_t latchTime);
+    void onBufferPresented(int32_t layerId, uint64_t frameNumber, nsecs_t presentTime);
+    void onBufferPresented(int32_t layerId, uint64_t frameNumber,
+                           const std::shared_ptr<FenceTime>& presentFence);
+    void onLayerDestroyed(int32_t layerId);
+
+    // Folds the buffers whose present fence has signaled into the histograms.
+    void flushPresentFences();
+
+    Histogram getHistogram(Interval) const;
+    void dump(std::string& result);
+    void clear();
+
+private:
+    struct Record {
+        uint64_t frameNumber = 0;
+        nsecs_t postTime = 0;
+        nsecs_t applyTime = 0;
+        nsecs_t latchTime = 0;
+    };
+
+    struct PendingPresent {
+        Record record;
+        std::shared_ptr<FenceTime> presentFence;
+    };
+
+    // Bounds how many records are kept per layer before a present, and how many presented
+    // buffers wait for their fence.
+    static constexpr size_t kMaxRecordsPerLayer = 8;
+    static constexpr size_t kMaxPendingPresents = 256;
+
+    std::optional<Record> takeRecordLocked(int32_t layerId, uint64_t frameNumber)
+            REQUIRES(mMutex);
+    void recordPresentLocked(const Record&, nsecs_t presentTime) REQUIRES(mMutex);
+    void flushPresentFencesLocked() REQUIRES(mMutex);
+
+    mutable std::mutex mMutex;
+    std::unordered_map<int32_t, std::deque<Record>> mRecords GUARDED_BY(mMutex);
+    std::vector<PendingPresent> mPendingPresents GUARDED_BY(mMutex);
+    std::array<Histogram, static_cast<size_t>(Interval::ftl_last) + 1> mHistograms
+            GUARDED_BY(mMutex);
+    uint64_t mDroppedRecords GUARDED_BY(mMutex) = 0;
+};
+
+} // namespace android
@@ -252,6 +252,7 @@ Layer::~Layer() {
     const int32_t layerId = getSequence();
     mFlinger->mTimeStats->onDestroy(layerId);
     mFlinger->mFrameTracer->onDestroy(layerId);
+    mFlinger->mLatencyStageTracker.onLayerDestroyed(layerId);
 
     mFrameTracker.logAndResetStats(mName);
     mFlinger->onLayerDestroyed(this);
@@ -1694,6 +1695,7 @@ void Layer::onDisconnect() {
     const int32_t layerId = getSequence();
     mFlinger->mTimeStats->onDestroy(layerId);
     mFlinger->mFrameTracer->onDestroy(layerId);
+    mFlinger->mLatencyStageTracker.onLayerDestroyed(layerId);
 }
 
 size_t Layer::getDescendantCount() const {
@@ -3172,6 +3174,8 @@ bool Layer::setBuffer(std::shared_ptr<renderengine::ExternalTexture>& buffer,
     const int32_t layerId = getSequence();
     mFlinger->mTimeStats->setPostTime(layerId, mDrawingState.frameNumber, getName().c_str(),
                                       mOwnerUid, postTime, getGameMode());
+    mFlinger->mLatencyStageTracker.onBufferPosted(layerId, mDrawingState.frameNumber, postTime,
+                                                  systemTime());
 
     if (mFlinger->mLegacyFrontEndEnabled) {
         recordLayerHistoryBufferUpdate(getLayerProps());
@@ -3493,6 +3497,7 @@ void Layer::updateTexImage(nsecs_t latchTime, bool bgColorOnly) {
     const auto acquireFence = std::make_shared<FenceTime>(mDrawingState.acquireFence);
     mFlinger->mTimeStats->setAcquireFence(layerId, frameNumber, acquireFence);
     mFlinger->mTimeStats->setLatchTime(layerId, frameNumber, latchTime);
+    mFlinger->mLatencyStageTracker.onBufferLatched(layerId, frameNumber, latchTime);
 
     mFlinger->mFrameTracer->traceFence(layerId, bufferId, frameNumber, acquireFence,
                                        FrameTracer::FrameEvent::ACQUIRE_FENCE);
@@ -4026,6 +4031,8 @@ void Layer::onPostComposition(const DisplayDevice* display,
         if (presentFence->isValid()) {
             mFlinger->mTimeStats->setPresentFence(layerId, mCurrentFrameNumber, presentFence,
                                                   refreshRate, renderRate, vote, gameMode);
+            mFlinger->mLatencyStageTracker.onBufferPresented(layerId, mCurrentFrameNumber,
+                                                             presentFence);
             mFlinger->mFrameTracer->traceFence(layerId, getCurrentBufferId(), mCurrentFrameNumber,
                                                presentFence,
                                                FrameTracer::FrameEvent::PRESENT_FENCE);
@@ -4042,6 +4049,8 @@ void Layer::onPostComposition(const DisplayDevice* display,
 
             mFlinger->mTimeStats->setPresentTime(layerId, mCurrentFrameNumber, actualPresentTime,
                                                  refreshRate, renderRate, vote, gameMode);
+            mFlinger->mLatencyStageTracker.onBufferPresented(layerId, mCurrentFrameNumber,
+                                                             actualPresentTime);
             mFlinger->mFrameTracer->traceTimestamp(layerId, getCurrentBufferId(),
                                                    mCurrentFrameNumber, actualPresentTime,
                                                    FrameTracer::FrameEvent::PRESENT_FENCE);
@@ -4368,15 +4377,24 @@ void Layer::setIsSmallDirty() {
         mWindowType != WindowInfo::Type::BASE_APPLICATION) {
         return;
     }
-    Rect bounds = mDrawingState.surfaceDamageRegion.getBounds();
-    if (!bounds.isValid()) {
+    const Region& damage = mDrawingState.surfaceDamageRegion;
+    if (!damage.getBounds().isValid()) {
         return;
     }
 
+    // A Region is made of disjoint rects, so the damaged area is the sum of their areas. Unlike the
+    // area of the bounds, this does not count the gaps between damaged rects, e.g. a blinking
+    // cursor and a clock at opposite corners of the window.
+    int64_t damagedArea = 0;
+    for (const Rect& rect : damage) {
+        damagedArea += static_cast<int64_t>(rect.getWidth()) * rect.getHeight();
+    }
+
+    const auto dirtyArea = static_cast<uint32_t>(std::min<int64_t>(damagedArea, UINT32_MAX));
+
     // If the damage region is a small dirty, this could give the hint for the layer history that
     // it could suppress the heuristic rate when calculating.
-    mSmallDirty = mFlinger->mScheduler->isSmallDirtyArea(mOwnerUid,
-                                                         bounds.getWidth() * bounds.getHeight());
+    mSmallDirty = mFlinger->mScheduler->isSmallDirtyArea(mOwnerUid, dirtyArea);
 }
 
 // ---------------------------------------------------------------------------
@@ -23,6 +23,8 @@
 
 #include "LayerProtoHelper.h"
 
+#include <algorithm>
+
 namespace android {
 
 using gui::WindowInfo;
@@ -251,16 +253,168 @@ void LayerProtoHelper::readFromProto(const BlurRegion& proto, android::BlurRegio
     outRegion.bottom = proto.bottom();
 }
 
-LayersProto LayerProtoFromSnapshotGenerator::generate(const frontend::LayerHierarchy& root) {
-    mLayersProto.clear_layers();
-    std::unordered_set<uint64_t> stackIdsToSkip;
-    if ((mTraceFlags & LayerTracing::TRACE_VIRTUAL_DISPLAYS) == 0) {
-        for (const auto& [layerStack, displayInfo] : mDisplayInfos) {
-            if (displayInfo.isVirtual) {
-                stackIdsToSkip.insert(layerStack.id);
-            }
+namespace {
+
+// The *ToStream functions write the same bytes as the LayerProtoHelper::writeToProto overloads
+// with the same arguments would serialize to.
+
+void writeRectToStream(ProtoWireWriter& writer, uint32_t field, const Rect& rect) {
+    const size_t start = writer.beginMessage(field);
+    writer.writeInt32(RectProto::kLeftFieldNumber, rect.left);
+    writer.writeInt32(RectProto::kTopFieldNumber, rect.top);
+    writer.writeInt32(RectProto::kRightFieldNumber, rect.right);
+    writer.writeInt32(RectProto::kBottomFieldNumber, rect.bottom);
+    writer.endMessage(start);
+}
+
+void writeNonEmptyRectToStream(ProtoWireWriter& writer, uint32_t field, const Rect& rect) {
+    if (rect.left != 0 || rect.right != 0 || rect.top != 0 || rect.bottom != 0) {
+        writeRectToStream(writer, field, rect);
+    }
+}
+
+void writeRegionToStream(ProtoWireWriter& writer, uint32_t field, const Region& region) {
+    if (region.isEmpty()) {
+        return;
+    }
+
+    const size_t start = writer.beginMessage(field);
+    for (const Rect& rect : region) {
+        writeRectToStream(writer, RegionProto::kRectFieldNumber, rect);
+    }
+    writer.endMessage(start);
+}
+
+void writeFloatRectToStream(ProtoWireWriter& writer, uint32_t field, const FloatRect& rect) {
+    if (rect.left != 0 || rect.right != 0 || rect.top != 0 || rect.bottom != 0) {
+        const size_t start = writer.beginMessage(field);
+        writer.writeFloat(FloatRectProto::kLeftFieldNumber, rect.left);
+        writer.writeFloat(FloatRectProto::kTopFieldNumber, rect.top);
+        writer.writeFloat(FloatRectProto::kRightFieldNumber, rect.right);
+        writer.writeFloat(FloatRectProto::kBottomFieldNumber, rect.bottom);
+        writer.endMessage(start);
+    }
+}
+
+void writePositionToStream(ProtoWireWriter& writer, uint32_t field, float x, float y) {
+    if (x != 0 || y != 0) {
+        const size_t start = writer.beginMessage(field);
+        writer.writeFloat(PositionProto::kXFieldNumber, x);
+        writer.writeFloat(PositionProto::kYFieldNumber, y);
+        writer.endMessage(start);
+    }
+}
+
+void writeColorToStream(ProtoWireWriter& writer, uint32_t field, const half4& color) {
+    if (color.r != 0 || color.g != 0 || color.b != 0 || color.a != 0) {
+        const size_t start = writer.beginMessage(field);
+        writer.writeFloat(ColorProto::kRFieldNumber, color.r);
+        writer.writeFloat(ColorProto::kGFieldNumber, color.g);
+        writer.writeFloat(ColorProto::kBFieldNumber, color.b);
+        writer.writeFloat(ColorProto::kAFieldNumber, color.a);
+        writer.endMessage(start);
+    }
+}
+
+void writeTransformToStreamDeprecated(ProtoWireWriter& writer, uint32_t field,
+                                      const ui::Transform& transform) {
+    const uint32_t type = transform.getType() | (transform.getOrientation() << 8);
+    const size_t start = writer.beginMessage(field);
+    if (type & (ui::Transform::SCALE | ui::Transform::UNKNOWN)) {
+        writer.writeFloat(TransformProto::kDsdxFieldNumber, transform[0][0]);
+        writer.writeFloat(TransformProto::kDtdxFieldNumber, transform[0][1]);
+        writer.writeFloat(TransformProto::kDsdyFieldNumber, transform[1][0]);
+        writer.writeFloat(TransformProto::kDtdyFieldNumber, transform[1][1]);
+    }
+    writer.writeInt32(TransformProto::kTypeFieldNumber, static_cast<int32_t>(type));
+    writer.endMessage(start);
+}
+
+void writeActiveBufferToStream(ProtoWireWriter& writer, uint32_t field,
+                               const renderengine::ExternalTexture& buffer) {
+    if (buffer.getWidth() != 0 || buffer.getHeight() != 0 || buffer.getUsage() != 0 ||
+        buffer.getPixelFormat() != 0) {
+        const size_t start = writer.beginMessage(field);
+        writer.writeUInt32(ActiveBufferProto::kWidthFieldNumber, buffer.getWidth());
+        writer.writeUInt32(ActiveBufferProto::kHeightFieldNumber, buffer.getHeight());
+        // Matches writeToProto, which reports the usage as the stride.
+        writer.writeUInt32(ActiveBufferProto::kStrideFieldNumber,
+                           static_cast<uint32_t>(buffer.getUsage()));
+        writer.writeInt32(ActiveBufferProto::kFormatFieldNumber, buffer.getPixelFormat());
+        writer.endMessage(start);
+    }
+}
+
+void writeInputWindowInfoToStream(ProtoWireWriter& writer, uint32_t field,
+                                  const WindowInfo& inputInfo) {
+    if (inputInfo.token == nullptr) {
+        return;
+    }
+
+    using InputConfig = gui::WindowInfo::InputConfig;
+    const size_t start = writer.beginMessage(field);
+    writer.writeUInt32(InputWindowInfoProto::kLayoutParamsFlagsFieldNumber,
+                       inputInfo.layoutParamsFlags.get());
+    writer.writeInt32(InputWindowInfoProto::kLayoutParamsTypeFieldNumber,
+                      static_cast<int32_t>(inputInfo.layoutParamsType));
+    writeNonEmptyRectToStream(writer, InputWindowInfoProto::kFrameFieldNumber,
+                              {inputInfo.frameLeft, inputInfo.frameTop, inputInfo.frameRight,
+                               inputInfo.frameBottom});
+    writeRegionToStream(writer, InputWindowInfoProto::kTouchableRegionFieldNumber,
+                        inputInfo.touchableRegion);
+    writer.writeInt32(InputWindowInfoProto::kSurfaceInsetFieldNumber, inputInfo.surfaceInset);
+    writer.writeBool(InputWindowInfoProto::kVisibleFieldNumber,
+                     !inputInfo.inputConfig.test(InputConfig::NOT_VISIBLE));
+    writer.writeBool(InputWindowInfoProto::kFocusableFieldNumber,
+                     !inputInfo.inputConfig.test(InputConfig::NOT_FOCUSABLE));
+    writer.writeBool(InputWindowInfoProto::kHasWallpaperFieldNumber,
+                     inputInfo.inputConfig.test(InputConfig::DUPLICATE_TOUCH_TO_WALLPAPER));
+    writer.writeFloat(InputWindowInfoProto::kGlobalScaleFactorFieldNumber,
+                      inputInfo.globalScaleFactor);
+    writer.writeBool(InputWindowInfoProto::kReplaceTouchableRegionWithCropFieldNumber,
+                     inputInfo.replaceTouchableRegionWithCrop);
+    writeTransformToStreamDeprecated(writer, InputWindowInfoProto::kTransformFieldNumber,
+                                     inputInfo.transform);
+    writer.writeUInt32(InputWindowInfoProto::kInputConfigFieldNumber,
+                       inputInfo.inputConfig.get());
+    writer.endMessage(start);
+}
+
+void writeColorTransformToStream(ProtoWireWriter& writer, uint32_t field, const mat4& matrix) {
+    float values[mat4::ROW_SIZE * mat4::COL_SIZE];
+    for (int i = 0; i < mat4::ROW_SIZE; i++) {
+        for (int j = 0; j < mat4::COL_SIZE; j++) {
+            values[i * mat4::COL_SIZE + j] = matrix[i][j];
         }
     }
+    const size_t start = writer.beginMessage(field);
+    writer.writePackedFloat(ColorTransformProto::kValFieldNumber, values, std::size(values));
+    writer.endMessage(start);
+}
+
+void writeMetadataToStream(ProtoWireWriter& writer, uint32_t field,
+                           const LayerMetadata& metadata) {
+    using Entry = std::pair<int32_t, const std::vector<uint8_t>*>;
+    std::vector<Entry> entries;
+    entries.reserve(metadata.mMap.size());
+    for (const auto& [key, value] : metadata.mMap) {
+        entries.emplace_back(static_cast<int32_t>(key), &value);
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& lhs, const Entry& rhs) { return lhs.first < rhs.first; });
+    for (const auto& [key, value] : entries) {
+        writer.writeInt32BytesMapEntry(field, key,
+                                       std::string_view(reinterpret_cast<const char*>(
+                                                                value->data()),
+                                                        value->size()));
+    }
+}
+
+} // namespace
+
+LayersProto LayerProtoFromSnapshotGenerator::generate(const frontend::LayerHierarchy& root) {
+    mLayersProto.clear_layers();
+    const std::unordered_set<uint64_t> stackIdsToSkip = getStackIdsToSkip();
 
     frontend::LayerHierarchy::TraversalPath path = frontend::LayerHierarchy::TraversalPath::ROOT;
     for (auto& [child, variant] : root.mChildren) {
@@ -296,6 +450,55 @@ LayersProto LayerProtoFromSnapshotGenerator::generate(const frontend::LayerHiera
     return std::move(mLayersProto);
 }
 
+void LayerProtoFromSnapshotGenerator::generateSerialized(const frontend::LayerHierarchy& root,
+                                                         std::string& out) {
+    const std::unordered_set<uint64_t> stackIdsToSkip = getStackIdsToSkip();
+    auto forEachRootLayer = [&](auto&& visit) {
+        frontend::LayerHierarchy::TraversalPath path =
+                frontend::LayerHierarchy::TraversalPath::ROOT;
+        for (auto& [child, variant] : root.mChildren) {
+            if (variant != frontend::LayerHierarchy::Variant::Attached ||
+                stackIdsToSkip.find(child->getLayer()->layerStack.id) != stackIdsToSkip.end()) {
+                continue;
+            }
+            frontend::LayerHierarchy::ScopedAddToTraversalPath addChildToPath(path,
+                                                                              child->getLayer()
+                                                                                      ->id,
+                                                                              variant);
+            visit(*child, path);
+        }
+    };
+
+    // The parent of a layer is only known once the traversal reached its relative parent, but is
+    // written before the layers that follow, so collect it first.
+    forEachRootLayer([this](const frontend::LayerHierarchy& child,
+                            frontend::LayerHierarchy::TraversalPath& path) {
+        collectRelations(child, path);
+    });
+
+    ProtoWireWriter writer(out);
+    forEachRootLayer([this, &writer](const frontend::LayerHierarchy& child,
+                                     frontend::LayerHierarchy::TraversalPath& path) {
+        writeHierarchyToStream(writer, child, path);
+    });
+
+    mDefaultSnapshots.clear();
+    mChildToRelativeParent.clear();
+    mChildToParent.clear();
+}
+
+std::unordered_set<uint64_t> LayerProtoFromSnapshotGenerator::getStackIdsToSkip() const {
+    std::unordered_set<uint64_t> stackIdsToSkip;
+    if ((mTraceFlags & LayerTracing::TRACE_VIRTUAL_DISPLAYS) == 0) {
+        for (const auto& [layerStack, displayInfo] : mDisplayInfos) {
+            if (displayInfo.isVirtual) {
+                stackIdsToSkip.insert(layerStack.id);
+            }
+        }
+    }
+    return stackIdsToSkip;
+}
+
 frontend::LayerSnapshot* LayerProtoFromSnapshotGenerator::getSnapshot(
         frontend::LayerHierarchy::TraversalPath& path, const frontend::RequestedLayerState& layer) {
     frontend::LayerSnapshot* snapshot = mSnapshotBuilder.getSnapshot(path);
@@ -349,6 +552,92 @@ void LayerProtoFromSnapshotGenerator::writeHierarchyToProto(
     }
 }
 
+// Makes the same getSnapshot calls as writeHierarchyToProto, so that the snapshots of layers
+// without one in the builder are the same.
+void LayerProtoFromSnapshotGenerator::collectRelations(
+        const frontend::LayerHierarchy& root, frontend::LayerHierarchy::TraversalPath& path) {
+    using Variant = frontend::LayerHierarchy::Variant;
+    const frontend::RequestedLayerState& layer = *root.getLayer();
+    frontend::LayerSnapshot* snapshot = getSnapshot(path, layer);
+
+    for (const auto& [child, variant] : root.mChildren) {
+        frontend::LayerHierarchy::ScopedAddToTraversalPath addChildToPath(path,
+                                                                          child->getLayer()->id,
+                                                                          variant);
+        frontend::LayerSnapshot* childSnapshot = getSnapshot(path, layer);
+        if (variant == Variant::Attached || variant == Variant::Detached ||
+            variant == Variant::Mirror) {
+            mChildToParent[childSnapshot->uniqueSequence] = snapshot->uniqueSequence;
+        } else if (variant == Variant::Relative) {
+            mChildToRelativeParent[childSnapshot->uniqueSequence] = snapshot->uniqueSequence;
+        }
+    }
+
+    for (const auto& [child, variant] : root.mChildren) {
+        if (variant == Variant::Detached) {
+            continue;
+        }
+        frontend::LayerHierarchy::ScopedAddToTraversalPath addChildToPath(path,
+                                                                          child->getLayer()->id,
+                                                                          variant);
+        collectRelations(*child, path);
+    }
+}
+
+void LayerProtoFromSnapshotGenerator::writeHierarchyToStream(
+        ProtoWireWriter& writer, const frontend::LayerHierarchy& root,
+        frontend::LayerHierarchy::TraversalPath& path) {
+    using Variant = frontend::LayerHierarchy::Variant;
+    const frontend::RequestedLayerState& layer = *root.getLayer();
+    frontend::LayerSnapshot* snapshot = getSnapshot(path, layer);
+
+    LayerProtoHelper::LayerProtoRelations relations;
+    for (const auto& [child, variant] : root.mChildren) {
+        frontend::LayerHierarchy::ScopedAddToTraversalPath addChildToPath(path,
+                                                                          child->getLayer()->id,
+                                                                          variant);
+        frontend::LayerSnapshot* childSnapshot = getSnapshot(path, layer);
+        if (variant == Variant::Attached || variant == Variant::Detached ||
+            variant == Variant::Mirror) {
+            relations.children.push_back(static_cast<int32_t>(childSnapshot->uniqueSequence));
+        } else if (variant == Variant::Relative) {
+            relations.relatives.push_back(static_cast<int32_t>(childSnapshot->uniqueSequence));
+        }
+    }
+
+    const uint32_t id = snapshot->uniqueSequence;
+    if (const auto it = mChildToRelativeParent.find(id); it != mChildToRelativeParent.end()) {
+        relations.zOrderRelativeOf = static_cast<int32_t>(it->second);
+    }
+    if (const auto it = mChildToParent.find(id); it != mChildToParent.end()) {
+        relations.parent = static_cast<int32_t>(it->second);
+    }
+
+    LayerProto compositionState;
+    if (mTraceFlags & LayerTracing::TRACE_COMPOSITION) {
+        auto it = mLegacyLayers.find(layer.id);
+        if (it != mLegacyLayers.end()) {
+            it->second->writeCompositionStateToProto(&compositionState,
+                                                     snapshot->outputFilter.layerStack);
+            relations.compositionState = &compositionState;
+        }
+    }
+
+    LayerProtoHelper::writeSnapshotToStream(writer, LayersProto::kLayersFieldNumber, layer,
+                                            *snapshot, mTraceFlags, relations);
+
+    for (const auto& [child, variant] : root.mChildren) {
+        // avoid visiting relative layers twice
+        if (variant == Variant::Detached) {
+            continue;
+        }
+        frontend::LayerHierarchy::ScopedAddToTraversalPath addChildToPath(path,
+                                                                          child->getLayer()->id,
+                                                                          variant);
+        writeHierarchyToStream(writer, *child, path);
+    }
+}
+
 void LayerProtoHelper::writeSnapshotToProto(LayerProto* layerInfo,
                                             const frontend::RequestedLayerState& requestedState,
                                             const frontend::LayerSnapshot& snapshot,
@@ -446,6 +735,105 @@ void LayerProtoHelper::writeSnapshotToProto(LayerProto* layerInfo,
                                    [&]() { return layerInfo->mutable_destination_frame(); });
 }
 
+void LayerProtoHelper::writeSnapshotToStream(ProtoWireWriter& writer, uint32_t field,
+                                             const frontend::RequestedLayerState& requestedState,
+                                             const frontend::LayerSnapshot& snapshot,
+                                             uint32_t traceFlags,
+                                             const LayerProtoRelations& relations) {
+    // The fields are written in field number order, see ProtoWireWriter.
+    const ui::Transform transform = snapshot.geomLayerTransform;
+    const ui::Transform requestedTransform = requestedState.getTransform(0);
+    const auto& buffer = requestedState.externalTexture;
+    const LayerProto* compositionState = relations.compositionState;
+
+    const size_t start = writer.beginMessage(field);
+    writer.writeInt32(LayerProto::kIdFieldNumber, static_cast<int32_t>(snapshot.uniqueSequence));
+    if (!snapshot.path.isClone()) {
+        writer.writeString(LayerProto::kNameFieldNumber, requestedState.name);
+    } else {
+        writer.writeString(LayerProto::kNameFieldNumber, requestedState.name + "(Mirror)");
+    }
+    writer.writePackedInt32(LayerProto::kChildrenFieldNumber, relations.children);
+    writer.writePackedInt32(LayerProto::kRelativesFieldNumber, relations.relatives);
+    writer.writeString(LayerProto::kTypeFieldNumber, "Layer");
+    writeRegionToStream(writer, LayerProto::kTransparentRegionFieldNumber,
+                        requestedState.transparentRegion);
+    if (compositionState && compositionState->has_visible_region()) {
+        writer.writeBytes(LayerProto::kVisibleRegionFieldNumber,
+                          compositionState->visible_region().SerializeAsString());
+    }
+    writeRegionToStream(writer, LayerProto::kDamageRegionFieldNumber, snapshot.surfaceDamage);
+    writer.writeUInt32(LayerProto::kLayerStackFieldNumber, snapshot.outputFilter.layerStack.id);
+    writer.writeInt32(LayerProto::kZFieldNumber, requestedState.z);
+    writePositionToStream(writer, LayerProto::kPositionFieldNumber, transform.tx(),
+                          transform.ty());
+    writePositionToStream(writer, LayerProto::kRequestedPositionFieldNumber,
+                          requestedTransform.tx(), requestedTransform.ty());
+    writeNonEmptyRectToStream(writer, LayerProto::kCropFieldNumber, requestedState.crop);
+    writer.writeBool(LayerProto::kIsOpaqueFieldNumber, snapshot.contentOpaque);
+    writer.writeBool(LayerProto::kInvalidateFieldNumber, snapshot.contentDirty);
+    writer.writeString(LayerProto::kDataspaceFieldNumber,
+                       dataspaceDetails(static_cast<android_dataspace>(snapshot.dataspace)));
+    if (buffer) {
+        writer.writeString(LayerProto::kPixelFormatFieldNumber,
+                           decodePixelFormat(buffer->getPixelFormat()));
+    }
+    writeColorToStream(writer, LayerProto::kColorFieldNumber, snapshot.color);
+    writeColorToStream(writer, LayerProto::kRequestedColorFieldNumber, requestedState.color);
+    writer.writeUInt32(LayerProto::kFlagsFieldNumber, requestedState.flags);
+    writeTransformToStreamDeprecated(writer, LayerProto::kTransformFieldNumber, transform);
+    writeTransformToStreamDeprecated(writer, LayerProto::kRequestedTransformFieldNumber,
+                                     requestedTransform);
+    writer.writeInt32(LayerProto::kParentFieldNumber, relations.parent);
+    writer.writeInt32(LayerProto::kZOrderRelativeOfFieldNumber, relations.zOrderRelativeOf);
+    if (buffer) {
+        writeActiveBufferToStream(writer, LayerProto::kActiveBufferFieldNumber, *buffer);
+    }
+    if (compositionState) {
+        writer.writeInt32(LayerProto::kHwcCompositionTypeFieldNumber,
+                          static_cast<int32_t>(compositionState->hwc_composition_type()));
+    }
+    writer.writeBool(LayerProto::kIsProtectedFieldNumber, snapshot.hasProtectedContent);
+    writer.writeUInt64(LayerProto::kCurrFrameFieldNumber, requestedState.bufferData->frameNumber);
+    if (buffer) {
+        writeTransformToStreamDeprecated(writer, LayerProto::kBufferTransformFieldNumber,
+                                         ui::Transform(requestedState.bufferTransform));
+    }
+    writer.writeFloat(LayerProto::kCornerRadiusFieldNumber,
+                      static_cast<float>(
+                              (snapshot.roundedCorner.radius.x + snapshot.roundedCorner.radius.y) /
+                              2.0));
+    if (traceFlags & LayerTracing::TRACE_EXTRA) {
+        writeMetadataToStream(writer, LayerProto::kMetadataFieldNumber, requestedState.metadata);
+    }
+    writeFloatRectToStream(writer, LayerProto::kSourceBoundsFieldNumber,
+                           snapshot.croppedBufferSize.toFloatRect());
+    writeFloatRectToStream(writer, LayerProto::kBoundsFieldNumber, snapshot.geomLayerBounds);
+    writeFloatRectToStream(writer, LayerProto::kScreenBoundsFieldNumber,
+                           snapshot.transformedBounds);
+    if ((traceFlags & LayerTracing::TRACE_INPUT) && snapshot.hasInputInfo()) {
+        writeInputWindowInfoToStream(writer, LayerProto::kInputWindowInfoFieldNumber,
+                                     snapshot.inputInfo);
+    }
+    writeFloatRectToStream(writer, LayerProto::kCornerRadiusCropFieldNumber,
+                           snapshot.roundedCorner.cropRect);
+    writer.writeFloat(LayerProto::kShadowRadiusFieldNumber, snapshot.shadowRadius);
+    if (requestedState.hasColorTransform) {
+        writeColorTransformToStream(writer, LayerProto::kColorTransformFieldNumber,
+                                    snapshot.colorTransform);
+    }
+    writer.writeBool(LayerProto::kIsRelativeOfFieldNumber, requestedState.isRelativeOf);
+    writer.writeInt32(LayerProto::kBackgroundBlurRadiusFieldNumber, snapshot.backgroundBlurRadius);
+    writer.writeUInt32(LayerProto::kOwnerUidFieldNumber, requestedState.ownerUid.val());
+    writer.writeBool(LayerProto::kIsTrustedOverlayFieldNumber, snapshot.isTrustedOverlay);
+    writer.writeFloat(LayerProto::kRequestedCornerRadiusFieldNumber, requestedState.cornerRadius);
+    writeNonEmptyRectToStream(writer, LayerProto::kDestinationFrameFieldNumber,
+                              requestedState.destinationFrame);
+    writer.writeUInt32(LayerProto::kOriginalIdFieldNumber,
+                       static_cast<uint32_t>(snapshot.sequence));
+    writer.endMessage(start);
+}
+
 google::protobuf::RepeatedPtrField<DisplayProto> LayerProtoHelper::writeDisplayInfoToProto(
         const frontend::DisplayInfos& displayInfos) {
     google::protobuf::RepeatedPtrField<DisplayProto> displays;
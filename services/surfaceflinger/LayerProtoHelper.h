@@ -26,10 +26,15 @@
 #include <ui/Region.h>
 #include <ui/Transform.h>
 #include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "FrontEnd/DisplayInfo.h"
 #include "FrontEnd/LayerHierarchy.h"
 #include "FrontEnd/LayerSnapshot.h"
+#include "Tracing/ProtoWireWriter.h"
 
 namespace android {
 namespace surfaceflinger {
@@ -66,6 +71,23 @@ public:
     static void writeSnapshotToProto(LayerProto* outProto,
                                      const frontend::RequestedLayerState& requestedState,
                                      const frontend::LayerSnapshot& snapshot, uint32_t traceFlags);
+
+    // The fields of a LayerProto that do not come from the layer's own state.
+    struct LayerProtoRelations {
+        std::vector<int32_t> children;
+        std::vector<int32_t> relatives;
+        int32_t parent = -1;
+        int32_t zOrderRelativeOf = -1;
+        // Holds the fields set by Layer::writeCompositionStateToProto, if traced.
+        const LayerProto* compositionState = nullptr;
+    };
+
+    // Writes the LayerProto that writeSnapshotToProto and the relations would make, as a nested
+    // message, without building it.
+    static void writeSnapshotToStream(ProtoWireWriter& writer, uint32_t field,
+                                      const frontend::RequestedLayerState& requestedState,
+                                      const frontend::LayerSnapshot& snapshot, uint32_t traceFlags,
+                                      const LayerProtoRelations& relations);
     static google::protobuf::RepeatedPtrField<DisplayProto> writeDisplayInfoToProto(
             const frontend::DisplayInfos&);
 };
@@ -82,9 +104,18 @@ public:
             mTraceFlags(traceFlags) {}
     LayersProto generate(const frontend::LayerHierarchy& root);
 
+    // Appends generate(root).SerializeAsString() to out, without building the messages. Metadata
+    // entries are written in key order, as with deterministic serialization.
+    void generateSerialized(const frontend::LayerHierarchy& root, std::string& out);
+
 private:
+    std::unordered_set<uint64_t> getStackIdsToSkip() const;
     void writeHierarchyToProto(const frontend::LayerHierarchy& root,
                                frontend::LayerHierarchy::TraversalPath& path);
+    void collectRelations(const frontend::LayerHierarchy& root,
+                          frontend::LayerHierarchy::TraversalPath& path);
+    void writeHierarchyToStream(ProtoWireWriter& writer, const frontend::LayerHierarchy& root,
+                                frontend::LayerHierarchy::TraversalPath& path);
     frontend::LayerSnapshot* getSnapshot(frontend::LayerHierarchy::TraversalPath& path,
                                          const frontend::RequestedLayerState& layer);
 
@@ -51,7 +51,7 @@ SurfaceControlHolder::~SurfaceControlHolder() {
     // Hand the sp<SurfaceControl> to the helper thread to release the last
     // reference. This makes sure that the SurfaceControl is destructed without
     // SurfaceFlinger::mStateLock held.
-    BackgroundExecutor::getInstance().sendCallbacks(
+    BackgroundExecutor::getInstance().sendUnorderedCallbacks(
             {[sc = std::move(mSurfaceControl)]() mutable { sc.clear(); }});
 }
 
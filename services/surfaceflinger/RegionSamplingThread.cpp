@@ -36,6 +36,7 @@
 #include <ui/DisplayStatInfo.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <string>
 
 #include "DisplayDevice.h"
@@ -63,6 +64,8 @@ constexpr auto defaultRegionSamplingWorkDuration = 3ms;
 constexpr auto defaultRegionSamplingPeriod = 100ms;
 constexpr auto defaultRegionSamplingTimerTimeout = 100ms;
 constexpr auto maxRegionSamplingDelay = 100ms;
+// Linear downscale factor applied to the sampled bounds when capturing them.
+constexpr int32_t kSampleBufferDownscale = 4;
 // TODO: (b/127403193) duration to string conversion could probably be constexpr
 template <typename Rep, typename Per>
 inline std::string toNsString(std::chrono::duration<Rep, Per> t) {
@@ -224,8 +227,38 @@ float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t st
     return accumulatedLuma / (255.0f * pixelCount);
 }
 
+ui::Size getSampleBufferSize(const Rect& sampledBounds) {
+    return {std::max(1, (sampledBounds.getWidth() + kSampleBufferDownscale - 1) /
+                                kSampleBufferDownscale),
+            std::max(1, (sampledBounds.getHeight() + kSampleBufferDownscale - 1) /
+                                kSampleBufferDownscale)};
+}
+
+Rect getSampleBufferArea(const Rect& area, const Rect& sampledBounds, const ui::Size& bufferSize) {
+    const int64_t boundsWidth = sampledBounds.getWidth();
+    const int64_t boundsHeight = sampledBounds.getHeight();
+    if (boundsWidth <= 0 || boundsHeight <= 0) {
+        return Rect::INVALID_RECT;
+    }
+
+    // Round outwards, so that small areas still cover at least one pixel.
+    const Rect relative = area - sampledBounds.leftTop();
+    const auto scaleDown = [](int64_t value, int64_t from, int64_t to) {
+        return static_cast<int32_t>(value * to / from);
+    };
+    const auto scaleUp = [](int64_t value, int64_t from, int64_t to) {
+        return static_cast<int32_t>((value * to + from - 1) / from);
+    };
+    Rect scaled(scaleDown(relative.left, boundsWidth, bufferSize.width),
+                scaleDown(relative.top, boundsHeight, bufferSize.height),
+                scaleUp(relative.right, boundsWidth, bufferSize.width),
+                scaleUp(relative.bottom, boundsHeight, bufferSize.height));
+    scaled.intersect(Rect(bufferSize), &scaled);
+    return scaled;
+}
+
 std::vector<float> RegionSamplingThread::sampleBuffer(
-        const sp<GraphicBuffer>& buffer, const Point& leftTop,
+        const sp<GraphicBuffer>& buffer, const Rect& sampledBounds,
         const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation) {
     void* data_raw = nullptr;
     buffer->lock(GRALLOC_USAGE_SW_READ_OFTEN, &data_raw);
@@ -236,11 +269,13 @@ std::vector<float> RegionSamplingThread::sampleBuffer(
     const int32_t width = buffer->getWidth();
     const int32_t height = buffer->getHeight();
     const int32_t stride = buffer->getStride();
+    const ui::Size bufferSize(width, height);
     std::vector<float> lumas(descriptors.size());
     std::transform(descriptors.begin(), descriptors.end(), lumas.begin(),
                    [&](auto const& descriptor) {
                        return sampleArea(data.get(), width, height, stride, orientation,
-                                         descriptor.area - leftTop);
+                                         getSampleBufferArea(descriptor.area, sampledBounds,
+                                                             bufferSize));
                    });
     return lumas;
 }
@@ -276,11 +311,12 @@ void RegionSamplingThread::captureSample() {
     }
 
     const Rect sampledBounds = sampleRegion.bounds();
+    const ui::Size bufferSize = getSampleBufferSize(sampledBounds);
     constexpr bool kUseIdentityTransform = false;
     constexpr bool kHintForSeamlessTransition = false;
 
     SurfaceFlinger::RenderAreaFuture renderAreaFuture = ftl::defer([=] {
-        return DisplayRenderArea::create(displayWeak, sampledBounds, sampledBounds.getSize(),
+        return DisplayRenderArea::create(displayWeak, sampledBounds, bufferSize,
                                          ui::Dataspace::V0_SRGB, kUseIdentityTransform,
                                          kHintForSeamlessTransition);
     });
@@ -356,14 +392,14 @@ void RegionSamplingThread::captureSample() {
     }
 
     std::shared_ptr<renderengine::ExternalTexture> buffer = nullptr;
-    if (mCachedBuffer && mCachedBuffer->getBuffer()->getWidth() == sampledBounds.getWidth() &&
-        mCachedBuffer->getBuffer()->getHeight() == sampledBounds.getHeight()) {
+    if (mCachedBuffer && mCachedBuffer->getBuffer()->getWidth() == bufferSize.width &&
+        mCachedBuffer->getBuffer()->getHeight() == bufferSize.height) {
         buffer = mCachedBuffer;
     } else {
         const uint32_t usage =
                 GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE;
         sp<GraphicBuffer> graphicBuffer =
-                sp<GraphicBuffer>::make(sampledBounds.getWidth(), sampledBounds.getHeight(),
+                sp<GraphicBuffer>::make(bufferSize.width, bufferSize.height,
                                         PIXEL_FORMAT_RGBA_8888, 1, usage, "RegionSamplingThread");
         const status_t bufferStatus = graphicBuffer->initCheck();
         LOG_ALWAYS_FATAL_IF(bufferStatus != OK, "captureSample: Buffer failed to allocate: %d",
@@ -393,8 +429,8 @@ void RegionSamplingThread::captureSample() {
     }
 
     ALOGV("Sampling %zu descriptors", activeDescriptors.size());
-    std::vector<float> lumas = sampleBuffer(buffer->getBuffer(), sampledBounds.leftTop(),
-                                            activeDescriptors, orientation);
+    std::vector<float> lumas =
+            sampleBuffer(buffer->getBuffer(), sampledBounds, activeDescriptors, orientation);
     if (lumas.size() != activeDescriptors.size()) {
         ALOGW("collected %zu median luma values for %zu descriptors", lumas.size(),
               activeDescriptors.size());
@@ -24,6 +24,7 @@
 #include <sched.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <optional>
@@ -37,6 +38,8 @@
 #include <cutils/compiler.h>
 #include <cutils/sched_policy.h>
 
+#include <ftl/small_map.h>
+
 #include <gui/DisplayEventReceiver.h>
 
 #include <utils/Errors.h>
@@ -211,6 +214,45 @@ binder::Status EventThreadConnection::getLatestVsyncEventData(
     return binder::Status::ok();
 }
 
+binder::Status EventThreadConnection::getVsyncTimeline(
+        std::optional<os::ParcelFileDescriptor>* outFd) {
+    std::scoped_lock lock(mLock);
+    if (!mTimeline) {
+        mTimeline = gui::VsyncTimeline::create();
+        if (!mTimeline) {
+            outFd->reset();
+            return binder::Status::ok();
+        }
+    }
+
+    outFd->emplace(base::unique_fd(dup(mTimeline->getFd())));
+    return binder::Status::ok();
+}
+
+void EventThreadConnection::publishVsync(const DisplayEventReceiver::Event& event,
+                                         std::chrono::nanoseconds workDuration) {
+    std::scoped_lock lock(mLock);
+    if (mTimeline) {
+        mTimeline->publish({.displayId = event.header.displayId,
+                            .timestamp = event.header.timestamp,
+                            .count = event.vsync.count,
+                            .workDuration = workDuration.count(),
+                            .vsyncData = event.vsync.vsyncData});
+    }
+}
+
+void EventThreadConnection::acceptTimelineRequests() {
+    std::scoped_lock lock(mLock);
+    if (mTimeline) {
+        mTimeline->acceptRequests();
+    }
+}
+
+bool EventThreadConnection::consumeTimelineRequest() {
+    std::scoped_lock lock(mLock);
+    return mTimeline && mTimeline->consumeRequest();
+}
+
 status_t EventThreadConnection::postEvent(const DisplayEventReceiver::Event& event) {
     constexpr auto toStatus = [](ssize_t size) {
         return size < 0 ? status_t(size) : status_t(NO_ERROR);
@@ -248,6 +290,7 @@ EventThread::EventThread(const char* name, std::shared_ptr<scheduler::VsyncSched
       : mThreadName(name),
         mVsyncTracer(base::StringPrintf("VSYNC-%s", name), 0),
         mWorkDuration(base::StringPrintf("VsyncWorkDuration-%s", name), workDuration),
+        mVsyncDispatchDuration(base::StringPrintf("VsyncDispatchDuration-%s", name), {}),
         mReadyDuration(readyDuration),
         mVsyncSchedule(std::move(vsyncSchedule)),
         mVsyncRegistration(mVsyncSchedule->getDispatch(), createDispatchCallback(), name),
@@ -553,13 +596,20 @@ bool EventThread::shouldConsumeEvent(const DisplayEventReceiver::Event& event,
                 case VSyncRequest::None:
                     return false;
                 case VSyncRequest::SingleSuppressCallback:
-                    connection->vsyncRequest = VSyncRequest::None;
-                    return false;
+                    if (!connection->consumeTimelineRequest()) {
+                        connection->vsyncRequest = VSyncRequest::None;
+                        return false;
+                    }
+                    // The client requested this vsync through its timeline while handling the
+                    // previous one.
+                    connection->vsyncRequest = VSyncRequest::Single;
+                    [[fallthrough]];
                 case VSyncRequest::Single: {
                     if (throttleVsync()) {
                         return false;
                     }
                     connection->vsyncRequest = VSyncRequest::SingleSuppressCallback;
+                    connection->acceptTimelineRequests();
                     return true;
                 }
                 case VSyncRequest::Periodic:
@@ -653,14 +703,29 @@ void EventThread::generateFrameTimeline(VsyncEventData& outVsyncEventData, nsecs
 
 void EventThread::dispatchEvent(const DisplayEventReceiver::Event& event,
                                 const DisplayEventConsumers& consumers) {
+    const bool isVsync = event.header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC;
+    const nsecs_t dispatchStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    // Consumers mostly share a few frame intervals, e.g. the display rate and the rates of apps
+    // with a frame rate override. Every frame timeline takes a token from mTokenManager, so they
+    // are generated once per frame interval rather than once per consumer.
+    ftl::SmallMap<int64_t, VsyncEventData, 4> vsyncDataByFrameInterval;
+
     for (const auto& consumer : consumers) {
         DisplayEventReceiver::Event copy = event;
-        if (event.header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
+        if (isVsync) {
             const int64_t frameInterval = mGetVsyncPeriodFunction(consumer->mOwnerUid);
-            copy.vsync.vsyncData.frameInterval = frameInterval;
-            generateFrameTimeline(copy.vsync.vsyncData, frameInterval, copy.header.timestamp,
-                                  event.vsync.vsyncData.preferredExpectedPresentationTime(),
-                                  event.vsync.vsyncData.preferredDeadlineTimestamp());
+            const auto [it, inserted] =
+                    vsyncDataByFrameInterval.try_emplace(frameInterval, event.vsync.vsyncData);
+            auto& vsyncData = it->second;
+            if (inserted) {
+                vsyncData.frameInterval = frameInterval;
+                generateFrameTimeline(vsyncData, frameInterval, copy.header.timestamp,
+                                      event.vsync.vsyncData.preferredExpectedPresentationTime(),
+                                      event.vsync.vsyncData.preferredDeadlineTimestamp());
+            }
+            copy.vsync.vsyncData = vsyncData;
+            consumer->publishVsync(copy, mWorkDuration.get());
         }
         switch (consumer->postEvent(copy)) {
             case NO_ERROR:
@@ -677,6 +742,13 @@ void EventThread::dispatchEvent(const DisplayEventReceiver::Event& event,
                 removeDisplayEventConnectionLocked(consumer);
         }
     }
+
+    if (isVsync) {
+        const std::chrono::nanoseconds duration(systemTime(SYSTEM_TIME_MONOTONIC) -
+                                                dispatchStartTime);
+        mVsyncDispatchDuration = duration;
+        mMaxVsyncDispatchDuration = std::max(mMaxVsyncDispatchDuration, duration);
+    }
 }
 
 void EventThread::dump(std::string& result) const {
@@ -696,6 +768,9 @@ void EventThread::dump(std::string& result) const {
     StringAppendF(&result, "mWorkDuration=%.2f mReadyDuration=%.2f last vsync time ",
                   mWorkDuration.get().count() / 1e6f, mReadyDuration.count() / 1e6f);
     StringAppendF(&result, "%.2fms relative to now\n", relativeLastCallTime);
+    StringAppendF(&result, "last vsync dispatch took %.3fms (max %.3fms)\n",
+                  mVsyncDispatchDuration.get().count() / 1e6f,
+                  mMaxVsyncDispatchDuration.count() / 1e6f);
 
     StringAppendF(&result, "  pending events (count=%zu):\n", mPendingEvents.size());
     for (const auto& event : mPendingEvents) {
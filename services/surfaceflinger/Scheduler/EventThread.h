@@ -19,6 +19,7 @@
 #include <android-base/thread_annotations.h>
 #include <android/gui/BnDisplayEventConnection.h>
 #include <gui/DisplayEventReceiver.h>
+#include <gui/VsyncTimeline.h>
 #include <private/gui/BitTube.h>
 #include <sys/types.h>
 #include <utils/Errors.h>
@@ -27,6 +28,7 @@
 #include <condition_variable>
 #include <cstdint>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <thread>
@@ -79,6 +81,17 @@ public:
     binder::Status setVsyncRate(int rate) override;
     binder::Status requestNextVsync() override; // asynchronous
     binder::Status getLatestVsyncEventData(ParcelableVsyncEventData* outVsyncEventData) override;
+    binder::Status getVsyncTimeline(std::optional<os::ParcelFileDescriptor>* outFd) override;
+
+    // Publishes a vsync event to the timeline, if the client mapped it.
+    void publishVsync(const DisplayEventReceiver::Event&, std::chrono::nanoseconds workDuration);
+
+    // Lets the client request the next vsync through the timeline, until
+    // consumeTimelineRequest is called.
+    void acceptTimelineRequests();
+
+    // Returns whether the client requested the next vsync through the timeline.
+    bool consumeTimelineRequest();
 
     // Called in response to requestNextVsync.
     const ResyncCallback resyncCallback;
@@ -95,6 +108,7 @@ private:
     EventThread* const mEventThread;
     std::mutex mLock;
     gui::BitTube mChannel GUARDED_BY(mLock);
+    std::unique_ptr<gui::VsyncTimeline> mTimeline GUARDED_BY(mLock);
 
     std::vector<DisplayEventReceiver::Event> mPendingEvents;
 };
@@ -209,6 +223,9 @@ private:
     const char* const mThreadName;
     TracedOrdinal<int> mVsyncTracer;
     TracedOrdinal<std::chrono::nanoseconds> mWorkDuration GUARDED_BY(mMutex);
+    // Time spent writing the last VSYNC event to all of its consumers, and the longest so far.
+    TracedOrdinal<std::chrono::nanoseconds> mVsyncDispatchDuration GUARDED_BY(mMutex);
+    std::chrono::nanoseconds mMaxVsyncDispatchDuration GUARDED_BY(mMutex) = {};
     std::chrono::nanoseconds mReadyDuration GUARDED_BY(mMutex);
     std::shared_ptr<scheduler::VsyncSchedule> mVsyncSchedule GUARDED_BY(mMutex);
     TimePoint mLastVsyncCallbackTime GUARDED_BY(mMutex) = TimePoint::now();
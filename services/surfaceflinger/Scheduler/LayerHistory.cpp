@@ -147,11 +147,10 @@ void LayerHistory::record(int32_t id, const LayerProps& layerProps, nsecs_t pres
         }
     }
 
-    // Activate layer if inactive.
+    // Activate layer if inactive. Moving the node rather than the value keeps this allocation
+    // free, since layers that post infrequently go through here on almost every frame.
     if (found == LayerStatus::LayerInInactiveMap) {
-        mActiveLayerInfos.insert(
-                {id, std::make_pair(layerPair->first, std::move(layerPair->second))});
-        mInactiveLayerInfos.erase(id);
+        mActiveLayerInfos.insert(mInactiveLayerInfos.extract(id));
     }
 }
 
@@ -224,9 +223,7 @@ void LayerHistory::partitionLayers(nsecs_t now) {
         auto& [layerUnsafe, info] = it->second;
         if (isLayerActive(*info, threshold)) {
             // move this to the active map
-
-            mActiveLayerInfos.insert({it->first, std::move(it->second)});
-            it = mInactiveLayerInfos.erase(it);
+            mActiveLayerInfos.insert(mInactiveLayerInfos.extract(it++));
         } else {
             if (CC_UNLIKELY(mTraceEnabled)) {
                 trace(*info, LayerVoteType::NoVote, 0);
@@ -272,8 +269,7 @@ void LayerHistory::partitionLayers(nsecs_t now) {
             }
             info->onLayerInactive(now);
             // move this to the inactive map
-            mInactiveLayerInfos.insert({it->first, std::move(it->second)});
-            it = mActiveLayerInfos.erase(it);
+            mInactiveLayerInfos.insert(mActiveLayerInfos.extract(it++));
         }
     }
 }
@@ -65,14 +65,37 @@ void LayerInfo::setLastPresentTime(nsecs_t lastPresentTime, nsecs_t now, LayerUp
                                        .queueTime = mLastUpdatedTime,
                                        .pendingModeChange = pendingModeChange,
                                        .isSmallDirty = props.isSmallDirty};
-            mFrameTimes.push_back(frameTime);
-            if (mFrameTimes.size() > HISTORY_SIZE) {
-                mFrameTimes.pop_front();
-            }
+            addFrameTime(frameTime);
             break;
     }
 }
 
+void LayerInfo::addFrameTime(const FrameTimeData& frameTime) {
+    mFrameTimes.push_back(frameTime);
+    countFrameTime(frameTime, 1);
+    if (mFrameTimes.size() > HISTORY_SIZE) {
+        countFrameTime(mFrameTimes.front(), -1);
+        mFrameTimes.pop_front();
+    }
+    mCachedAverageFrameTime.reset();
+}
+
+void LayerInfo::clearFrameTimes() {
+    mFrameTimes.clear();
+    mPendingModeChangeCount = 0;
+    mMissingPresentTimeCount = 0;
+    mCachedAverageFrameTime.reset();
+}
+
+void LayerInfo::countFrameTime(const FrameTimeData& frameTime, int32_t delta) {
+    if (frameTime.pendingModeChange) {
+        mPendingModeChangeCount += delta;
+    }
+    if (frameTime.presentTime == 0) {
+        mMissingPresentTimeCount += delta;
+    }
+}
+
 bool LayerInfo::isFrameTimeValid(const FrameTimeData& frameTime) const {
     return frameTime.queueTime >= std::chrono::duration_cast<std::chrono::nanoseconds>(
                                           mFrameTimeValidSince.time_since_epoch())
@@ -190,17 +213,25 @@ bool LayerInfo::hasEnoughDataForHeuristic() const {
 }
 
 std::optional<nsecs_t> LayerInfo::calculateAverageFrameTime() const {
+    const bool hasReportedRefreshRate = mLastRefreshRate.reported.isValid();
+    if (mCachedAverageFrameTime &&
+        mCachedAverageFrameTime->hasReportedRefreshRate == hasReportedRefreshRate) {
+        return mCachedAverageFrameTime->averageFrameTime;
+    }
+
+    const auto averageFrameTime = calculateAverageFrameTimeUncached();
+    mCachedAverageFrameTime = AverageFrameTime{hasReportedRefreshRate, averageFrameTime};
+    return averageFrameTime;
+}
+
+std::optional<nsecs_t> LayerInfo::calculateAverageFrameTimeUncached() const {
     // Ignore frames captured during a mode change
-    const bool isDuringModeChange =
-            std::any_of(mFrameTimes.begin(), mFrameTimes.end(),
-                        [](const auto& frame) { return frame.pendingModeChange; });
+    const bool isDuringModeChange = mPendingModeChangeCount > 0;
     if (isDuringModeChange) {
         return std::nullopt;
     }
 
-    const bool isMissingPresentTime =
-            std::any_of(mFrameTimes.begin(), mFrameTimes.end(),
-                        [](auto frame) { return frame.presentTime == 0; });
+    const bool isMissingPresentTime = mMissingPresentTimeCount > 0;
     if (isMissingPresentTime && !mLastRefreshRate.reported.isValid()) {
         // If there are no presentation timestamps and we haven't calculated
         // one in the past then we can't calculate the refresh rate
@@ -384,12 +415,36 @@ LayerInfo::RefreshRateHistory::makeHeuristicTraceTagData() const {
 
 void LayerInfo::RefreshRateHistory::clear() {
     mRefreshRates.clear();
+    mMinRefreshRates.clear();
+    mMaxRefreshRates.clear();
 }
 
 bool LayerInfo::RefreshRateHistory::add(Fps refreshRate, nsecs_t now) {
     mRefreshRates.push_back({refreshRate, now});
+
+    // A refresh rate can no longer be the minimum once a lower one is added, as that one leaves
+    // the history later. Likewise for the maximum.
+    const IndexedRefreshRate indexed = {mNextIndex++, refreshRate};
+    while (!mMinRefreshRates.empty() &&
+           mMinRefreshRates.back().refreshRate.getValue() >= refreshRate.getValue()) {
+        mMinRefreshRates.pop_back();
+    }
+    mMinRefreshRates.push_back(indexed);
+    while (!mMaxRefreshRates.empty() &&
+           mMaxRefreshRates.back().refreshRate.getValue() <= refreshRate.getValue()) {
+        mMaxRefreshRates.pop_back();
+    }
+    mMaxRefreshRates.push_back(indexed);
+
     while (mRefreshRates.size() >= HISTORY_SIZE ||
            now - mRefreshRates.front().timestamp > HISTORY_DURATION.count()) {
+        const uint64_t oldestIndex = mNextIndex - mRefreshRates.size();
+        if (mMinRefreshRates.front().index == oldestIndex) {
+            mMinRefreshRates.pop_front();
+        }
+        if (mMaxRefreshRates.front().index == oldestIndex) {
+            mMaxRefreshRates.pop_front();
+        }
         mRefreshRates.pop_front();
     }
 
@@ -407,22 +462,18 @@ bool LayerInfo::RefreshRateHistory::add(Fps refreshRate, nsecs_t now) {
 bool LayerInfo::RefreshRateHistory::isConsistent() const {
     if (mRefreshRates.empty()) return true;
 
-    const auto [min, max] =
-            std::minmax_element(mRefreshRates.begin(), mRefreshRates.end(),
-                                [](const auto& lhs, const auto& rhs) {
-                                    return isStrictlyLess(lhs.refreshRate, rhs.refreshRate);
-                                });
+    const Fps min = mMinRefreshRates.front().refreshRate;
+    const Fps max = mMaxRefreshRates.front().refreshRate;
 
-    const bool consistent =
-            max->refreshRate.getValue() - min->refreshRate.getValue() < MARGIN_CONSISTENT_FPS;
+    const bool consistent = max.getValue() - min.getValue() < MARGIN_CONSISTENT_FPS;
 
     if (CC_UNLIKELY(sTraceEnabled)) {
         if (!mHeuristicTraceTagData.has_value()) {
             mHeuristicTraceTagData = makeHeuristicTraceTagData();
         }
 
-        ATRACE_INT(mHeuristicTraceTagData->max.c_str(), max->refreshRate.getIntValue());
-        ATRACE_INT(mHeuristicTraceTagData->min.c_str(), min->refreshRate.getIntValue());
+        ATRACE_INT(mHeuristicTraceTagData->max.c_str(), max.getIntValue());
+        ATRACE_INT(mHeuristicTraceTagData->min.c_str(), min.getIntValue());
         ATRACE_INT(mHeuristicTraceTagData->consistent.c_str(), consistent);
     }
 
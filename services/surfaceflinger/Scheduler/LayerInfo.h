@@ -187,7 +187,7 @@ public:
 
     void clearHistory(nsecs_t now) {
         onLayerInactive(now);
-        mFrameTimes.clear();
+        clearFrameTimes();
     }
 
 private:
@@ -237,6 +237,12 @@ private:
             nsecs_t timestamp = 0;
         };
 
+        // A refresh rate of mRefreshRates, identified by the order in which it was added.
+        struct IndexedRefreshRate {
+            uint64_t index;
+            Fps refreshRate;
+        };
+
         // Holds tracing strings
         struct HeuristicTraceTagData {
             std::string min;
@@ -251,6 +257,11 @@ private:
         const std::string mName;
         mutable std::optional<HeuristicTraceTagData> mHeuristicTraceTagData;
         std::deque<RefreshRateData> mRefreshRates;
+        // The candidates for the minimum and maximum of mRefreshRates, in increasing and decreasing
+        // order respectively, so that isConsistent does not need to scan the history.
+        std::deque<IndexedRefreshRate> mMinRefreshRates;
+        std::deque<IndexedRefreshRate> mMaxRefreshRates;
+        uint64_t mNextIndex = 0;
         static constexpr float MARGIN_CONSISTENT_FPS = 1.0;
     };
 
@@ -269,8 +280,14 @@ private:
     bool hasEnoughDataForHeuristic() const;
     std::optional<Fps> calculateRefreshRateIfPossible(const RefreshRateSelector&, nsecs_t now);
     std::optional<nsecs_t> calculateAverageFrameTime() const;
+    std::optional<nsecs_t> calculateAverageFrameTimeUncached() const;
     bool isFrameTimeValid(const FrameTimeData&) const;
 
+    // mFrameTimes must only be modified through these, which keep the statistics below up to date.
+    void addFrameTime(const FrameTimeData&);
+    void clearFrameTimes();
+    void countFrameTime(const FrameTimeData&, int32_t delta);
+
     const std::string mName;
     const uid_t mOwnerUid;
 
@@ -297,6 +314,19 @@ private:
     RefreshRateHeuristicData mLastRefreshRate;
 
     std::deque<FrameTimeData> mFrameTimes;
+    // Number of frames in mFrameTimes captured during a mode change, and without a present time.
+    int32_t mPendingModeChangeCount = 0;
+    int32_t mMissingPresentTimeCount = 0;
+
+    // The average frame time only depends on mFrameTimes, and on whether a refresh rate was
+    // reported when there are frames without a present time. Layers are summarized more often than
+    // they post buffers, so it is only recalculated when a frame is added.
+    struct AverageFrameTime {
+        bool hasReportedRefreshRate;
+        std::optional<nsecs_t> averageFrameTime;
+    };
+    mutable std::optional<AverageFrameTime> mCachedAverageFrameTime;
+
     std::chrono::time_point<std::chrono::steady_clock> mFrameTimeValidSince =
             std::chrono::steady_clock::now();
     static constexpr size_t HISTORY_SIZE = RefreshRateHistory::HISTORY_SIZE;
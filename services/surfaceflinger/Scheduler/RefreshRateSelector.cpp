@@ -22,6 +22,7 @@
 #pragma clang diagnostic ignored "-Wextra"
 
 #include <chrono>
+#include <cinttypes>
 #include <cmath>
 #include <deque>
 #include <map>
@@ -421,16 +422,62 @@ auto RefreshRateSelector::getRankedFrameRates(const std::vector<LayerRequirement
                                               GlobalSignals signals) const -> RankedFrameRates {
     std::lock_guard lock(mLock);
 
-    if (mGetRankedFrameRatesCache &&
-        mGetRankedFrameRatesCache->arguments == std::make_pair(layers, signals)) {
-        return mGetRankedFrameRatesCache->result;
+    if (const auto* cachedResult = mGetRankedFrameRatesCache.find(layers, signals)) {
+        return *cachedResult;
     }
 
     const auto result = getRankedFrameRatesLocked(layers, signals);
-    mGetRankedFrameRatesCache = GetRankedFrameRatesCache{{layers, signals}, result};
+    mGetRankedFrameRatesCache.insert(layers, signals, result);
     return result;
 }
 
+size_t RefreshRateSelector::GetRankedFrameRatesCache::hash(
+        const std::vector<LayerRequirement>& layers, GlobalSignals signals) {
+    // Only hash the fields that LayerRequirement::operator== compares exactly, since the desired
+    // refresh rates are compared approximately.
+    size_t hash = std::hash<bool>{}(signals.touch) ^ (std::hash<bool>{}(signals.idle) << 1) ^
+            (std::hash<bool>{}(signals.powerOnImminent) << 2);
+    for (const auto& layer : layers) {
+        const size_t layerHash = std::hash<std::string>{}(layer.name) ^
+                (static_cast<size_t>(layer.vote) << 8) ^
+                (static_cast<size_t>(layer.seamlessness) << 16) ^
+                (std::hash<float>{}(layer.weight) << 1) ^
+                static_cast<size_t>(layer.focused);
+        hash ^= layerHash + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+auto RefreshRateSelector::GetRankedFrameRatesCache::find(
+        const std::vector<LayerRequirement>& layers, GlobalSignals signals)
+        -> const RankedFrameRates* {
+    const size_t argumentsHash = hash(layers, signals);
+    const auto it = std::find_if(mEntries.begin(), mEntries.end(), [&](const Entry& entry) {
+        return entry.hash == argumentsHash && entry.arguments.second == signals &&
+                entry.arguments.first == layers;
+    });
+    if (it == mEntries.end()) {
+        mMissCount++;
+        return nullptr;
+    }
+    mHitCount++;
+    if (it != mEntries.begin()) {
+        Entry entry = std::move(*it);
+        mEntries.erase(it);
+        mEntries.push_front(std::move(entry));
+    }
+    return &mEntries.front().result;
+}
+
+void RefreshRateSelector::GetRankedFrameRatesCache::insert(
+        const std::vector<LayerRequirement>& layers, GlobalSignals signals,
+        RankedFrameRates result) {
+    if (mEntries.size() >= kCapacity) {
+        mEntries.pop_back();
+    }
+    mEntries.push_front({hash(layers, signals), {layers, signals}, std::move(result)});
+}
+
 auto RefreshRateSelector::getRankedFrameRatesLocked(const std::vector<LayerRequirement>& layers,
                                                     GlobalSignals signals) const
         -> RankedFrameRates {
@@ -1051,7 +1098,7 @@ void RefreshRateSelector::setActiveMode(DisplayModeId modeId, Fps renderFrameRat
 
     // Invalidate the cached invocation to getRankedFrameRates. This forces
     // the refresh rate to be recomputed on the next call to getRankedFrameRates.
-    mGetRankedFrameRatesCache.reset();
+    mGetRankedFrameRatesCache.clear();
 
     const auto activeModeOpt = mDisplayModes.get(modeId);
     LOG_ALWAYS_FATAL_IF(!activeModeOpt);
@@ -1090,7 +1137,7 @@ void RefreshRateSelector::updateDisplayModes(DisplayModes modes, DisplayModeId a
 
     // Invalidate the cached invocation to getRankedFrameRates. This forces
     // the refresh rate to be recomputed on the next call to getRankedFrameRates.
-    mGetRankedFrameRatesCache.reset();
+    mGetRankedFrameRatesCache.clear();
 
     mDisplayModes = std::move(modes);
     const auto activeModeOpt = mDisplayModes.get(activeModeId);
@@ -1190,7 +1237,7 @@ auto RefreshRateSelector::setPolicy(const PolicyVariant& policy) -> SetPolicyRes
             return SetPolicyResult::Invalid;
         }
 
-        mGetRankedFrameRatesCache.reset();
+        mGetRankedFrameRatesCache.clear();
 
         if (*getCurrentPolicyLocked() == oldPolicy) {
             return SetPolicyResult::Unchanged;
@@ -1378,6 +1425,17 @@ void RefreshRateSelector::dump(utils::Dumper& dumper) const {
 
     dumper.dump("frameRateOverrideConfig"sv, *ftl::enum_name(mFrameRateOverrideConfig));
 
+    {
+        const uint64_t hits = mGetRankedFrameRatesCache.hitCount();
+        const uint64_t lookups = hits + mGetRankedFrameRatesCache.missCount();
+        dumper.dump("getRankedFrameRatesCache"sv,
+                    base::StringPrintf("%zu/%zu entries, %" PRIu64 "/%" PRIu64
+                                       " hits (%.1f%%)",
+                                       mGetRankedFrameRatesCache.size(),
+                                       GetRankedFrameRatesCache::kCapacity, hits, lookups,
+                                       lookups ? 100.0 * hits / lookups : 0.0));
+    }
+
     dumper.dump("idleTimer"sv);
     {
         utils::Dumper::Indent indent(dumper);
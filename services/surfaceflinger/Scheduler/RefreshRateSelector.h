@@ -17,6 +17,7 @@
 #pragma once
 
 #include <algorithm>
+#include <deque>
 #include <numeric>
 #include <set>
 #include <type_traits>
@@ -514,11 +515,41 @@ private:
 
     Config::FrameRateOverride mFrameRateOverrideConfig;
 
-    struct GetRankedFrameRatesCache {
-        std::pair<std::vector<LayerRequirement>, GlobalSignals> arguments;
-        RankedFrameRates result;
+    // Least recently used cache of getRankedFrameRates invocations. The layer requirements tend
+    // to alternate between a few sets, e.g. as animations start and stop or as touch boost comes
+    // and goes, which a single entry would keep missing. Entries are invalidated whenever the
+    // modes or the policy change, but the hit statistics are kept.
+    class GetRankedFrameRatesCache {
+    public:
+        static constexpr size_t kCapacity = 8;
+
+        struct Entry {
+            size_t hash;
+            std::pair<std::vector<LayerRequirement>, GlobalSignals> arguments;
+            RankedFrameRates result;
+        };
+
+        // Returns the cached result for the arguments, if any, and makes it the most recent entry.
+        const RankedFrameRates* find(const std::vector<LayerRequirement>&, GlobalSignals);
+        void insert(const std::vector<LayerRequirement>&, GlobalSignals, RankedFrameRates);
+        void clear() { mEntries.clear(); }
+
+        bool empty() const { return mEntries.empty(); }
+        size_t size() const { return mEntries.size(); }
+        const Entry& mostRecent() const { return mEntries.front(); }
+
+        uint64_t hitCount() const { return mHitCount; }
+        uint64_t missCount() const { return mMissCount; }
+
+    private:
+        static size_t hash(const std::vector<LayerRequirement>&, GlobalSignals);
+
+        // Ordered from most to least recently used.
+        std::deque<Entry> mEntries;
+        uint64_t mHitCount = 0;
+        uint64_t mMissCount = 0;
     };
-    mutable std::optional<GetRankedFrameRatesCache> mGetRankedFrameRatesCache GUARDED_BY(mLock);
+    mutable GetRankedFrameRatesCache mGetRankedFrameRatesCache GUARDED_BY(mLock);
 
     // Declare mIdleTimer last to ensure its thread joins before the mutex/callbacks are destroyed.
     std::mutex mIdleTimerCallbacksMutex;
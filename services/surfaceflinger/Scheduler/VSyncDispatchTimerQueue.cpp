@@ -16,6 +16,8 @@
 
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <algorithm>
+#include <cinttypes>
 #include <vector>
 
 #include <android-base/stringprintf.h>
@@ -240,6 +242,12 @@ void VSyncDispatchTimerQueue::cancelTimer() {
     mTimeKeeper->alarmCancel();
 }
 
+void VSyncDispatchTimerQueue::recordTimerLateness(nsecs_t lateness) {
+    const auto it = std::upper_bound(kTimerLatenessBucketLimitsUs.begin(),
+                                     kTimerLatenessBucketLimitsUs.end(), ns2us(lateness));
+    mTimerLatenessHistogram[std::distance(kTimerLatenessBucketLimitsUs.begin(), it)]++;
+}
+
 void VSyncDispatchTimerQueue::setTimer(nsecs_t targetTime, nsecs_t /*now*/) {
     mIntendedWakeupTime = targetTime;
     mTimeKeeper->alarmAt(std::bind(&VSyncDispatchTimerQueue::timerCallback, this),
@@ -298,6 +306,9 @@ void VSyncDispatchTimerQueue::timerCallback() {
         std::lock_guard lock(mMutex);
         auto const now = mTimeKeeper->now();
         mLastTimerCallback = now;
+        if (mIntendedWakeupTime != kInvalidTime) {
+            recordTimerLateness(now - mIntendedWakeupTime);
+        }
         for (auto it = mCallbacks.begin(); it != mCallbacks.end(); it++) {
             auto& callback = it->second;
             auto const wakeupTime = callback->wakeupTime();
@@ -436,6 +447,13 @@ void VSyncDispatchTimerQueue::dump(std::string& result) const {
     StringAppendF(&result, "\tmLastTimerCallback: %.2fms ago mLastTimerSchedule: %.2fms ago\n",
                   (mTimeKeeper->now() - mLastTimerCallback) / 1e6f,
                   (mTimeKeeper->now() - mLastTimerSchedule) / 1e6f);
+    StringAppendF(&result, "\tTimer lateness:");
+    for (size_t i = 0; i < kTimerLatenessBucketLimitsUs.size(); i++) {
+        StringAppendF(&result, " <%" PRId64 "us=%zu", kTimerLatenessBucketLimitsUs[i],
+                      mTimerLatenessHistogram[i]);
+    }
+    StringAppendF(&result, " >=%" PRId64 "us=%zu\n", kTimerLatenessBucketLimitsUs.back(),
+                  mTimerLatenessHistogram.back());
     StringAppendF(&result, "\tCallbacks:\n");
     for (const auto& [token, entry] : mCallbacks) {
         entry->dump(result);
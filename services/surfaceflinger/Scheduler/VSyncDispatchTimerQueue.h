@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <array>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -144,6 +145,7 @@ private:
     void rearmTimerSkippingUpdateFor(nsecs_t now, CallbackMap::iterator const& skipUpdate)
             REQUIRES(mMutex);
     void cancelTimer() REQUIRES(mMutex);
+    void recordTimerLateness(nsecs_t lateness) REQUIRES(mMutex);
     ScheduleResult scheduleLocked(CallbackToken, ScheduleTiming) REQUIRES(mMutex);
 
     static constexpr nsecs_t kInvalidTime = std::numeric_limits<int64_t>::max();
@@ -161,6 +163,14 @@ private:
     // For debugging purposes
     nsecs_t mLastTimerCallback GUARDED_BY(mMutex) = kInvalidTime;
     nsecs_t mLastTimerSchedule GUARDED_BY(mMutex) = kInvalidTime;
+
+    // Histogram of how late the timer fired compared to mIntendedWakeupTime. Bucket i counts the
+    // wakeups that were less than kTimerLatenessBucketLimitsUs[i] late, and the last bucket the
+    // ones that were later than all limits.
+    static constexpr std::array<int64_t, 7> kTimerLatenessBucketLimitsUs = {50,   100,  250, 500,
+                                                                             1000, 2000, 4000};
+    std::array<size_t, kTimerLatenessBucketLimitsUs.size() + 1> mTimerLatenessHistogram
+            GUARDED_BY(mMutex){};
 };
 
 } // namespace android::scheduler
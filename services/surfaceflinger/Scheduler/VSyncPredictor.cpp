@@ -129,6 +129,7 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
         mLastTimestampIndex = next(mLastTimestampIndex);
         mTimestamps[mLastTimestampIndex] = timestamp;
     }
+    mOldestTimestamp = *std::min_element(mTimestamps.begin(), mTimestamps.end());
 
     traceInt64If("VSP-ts", timestamp);
 
@@ -153,11 +154,11 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     //
     // intercept = mean(Y) - slope * mean(X)
     //
-    std::vector<nsecs_t> vsyncTS(numSamples);
-    std::vector<nsecs_t> ordinals(numSamples);
+    // The samples are walked twice, first for the means and then for the sums, recomputing the
+    // ordinals rather than storing them to keep this allocation free on every HW vsync.
 
     // Normalizing to the oldest timestamp cuts down on error in calculating the intercept.
-    const auto oldestTS = *std::min_element(mTimestamps.begin(), mTimestamps.end());
+    const auto oldestTS = mOldestTimestamp;
     auto it = mRateMap.find(mIdealPeriod);
     auto const currentPeriod = it->second.slope;
 
@@ -165,34 +166,30 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     // fixed-point arithmetic.
     constexpr int64_t kScalingFactor = 1000;
 
+    const auto ordinalOf = [currentPeriod](nsecs_t vsyncTS) -> nsecs_t {
+        return currentPeriod == 0 ? 0
+                                  : (vsyncTS + currentPeriod / 2) / currentPeriod * kScalingFactor;
+    };
+
     nsecs_t meanTS = 0;
     nsecs_t meanOrdinal = 0;
 
-    for (size_t i = 0; i < numSamples; i++) {
-        const auto timestamp = mTimestamps[i] - oldestTS;
-        vsyncTS[i] = timestamp;
-        meanTS += timestamp;
-
-        const auto ordinal = currentPeriod == 0
-                ? 0
-                : (vsyncTS[i] + currentPeriod / 2) / currentPeriod * kScalingFactor;
-        ordinals[i] = ordinal;
-        meanOrdinal += ordinal;
+    for (const nsecs_t timestamp : mTimestamps) {
+        const auto vsyncTS = timestamp - oldestTS;
+        meanTS += vsyncTS;
+        meanOrdinal += ordinalOf(vsyncTS);
     }
 
     meanTS /= numSamples;
     meanOrdinal /= numSamples;
 
-    for (size_t i = 0; i < numSamples; i++) {
-        vsyncTS[i] -= meanTS;
-        ordinals[i] -= meanOrdinal;
-    }
-
     nsecs_t top = 0;
     nsecs_t bottom = 0;
-    for (size_t i = 0; i < numSamples; i++) {
-        top += vsyncTS[i] * ordinals[i];
-        bottom += ordinals[i] * ordinals[i];
+    for (const nsecs_t timestamp : mTimestamps) {
+        const auto vsyncTS = timestamp - oldestTS;
+        const auto ordinal = ordinalOf(vsyncTS) - meanOrdinal;
+        top += (vsyncTS - meanTS) * ordinal;
+        bottom += ordinal * ordinal;
     }
 
     if (CC_UNLIKELY(bottom == 0)) {
@@ -242,7 +239,7 @@ nsecs_t VSyncPredictor::nextAnticipatedVSyncTimeFromLocked(nsecs_t timePoint) co
         return knownTimestamp + numPeriodsOut * mIdealPeriod;
     }
 
-    auto const oldest = *std::min_element(mTimestamps.begin(), mTimestamps.end());
+    auto const oldest = mOldestTimestamp;
 
     // See b/145667109, the ordinal calculation must take into account the intercept.
     auto const zeroPoint = oldest + intercept;
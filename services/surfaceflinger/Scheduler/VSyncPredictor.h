@@ -109,6 +109,9 @@ private:
 
     size_t mLastTimestampIndex GUARDED_BY(mMutex) = 0;
     std::vector<nsecs_t> mTimestamps GUARDED_BY(mMutex);
+    // The smallest of mTimestamps, which every prediction is relative to. Only valid when
+    // mTimestamps is not empty.
+    nsecs_t mOldestTimestamp GUARDED_BY(mMutex) = 0;
 
     std::optional<Fps> mRenderRate GUARDED_BY(mMutex);
 
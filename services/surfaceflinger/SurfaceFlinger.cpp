@@ -50,6 +50,7 @@
 #include <compositionengine/OutputLayer.h>
 #include <compositionengine/RenderSurface.h>
 #include <compositionengine/impl/DisplayColorProfile.h>
+#include <compositionengine/impl/HwcAsyncWorker.h>
 #include <compositionengine/impl/OutputCompositionState.h>
 #include <compositionengine/impl/OutputLayerCompositionState.h>
 #include <configstore/Utils.h>
@@ -104,6 +105,7 @@
 #include <cmath>
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -292,6 +294,24 @@ void excludeDolbyVisionIf4k30Present(const std::vector<ui::Hdr>& displayHdrTypes
     }
 }
 
+// Accounts for a visible HDR layer shown on the output of the HdrLayerInfo being computed.
+void addHdrLayer(const frontend::LayerSnapshot& snapshot,
+                 const compositionengine::OutputLayer& outputLayer,
+                 HdrLayerInfoReporter::HdrLayerInfo& info, int32_t& maxArea) {
+    const float desiredHdrSdrRatio = snapshot.desiredHdrSdrRatio <= 1.f
+            ? std::numeric_limits<float>::infinity()
+            : snapshot.desiredHdrSdrRatio;
+    info.mergeDesiredRatio(desiredHdrSdrRatio);
+    info.numberOfHdrLayers++;
+    const auto displayFrame = outputLayer.getState().displayFrame;
+    const int32_t area = displayFrame.width() * displayFrame.height();
+    if (area > maxArea) {
+        maxArea = area;
+        info.maxW = displayFrame.width();
+        info.maxH = displayFrame.height();
+    }
+}
+
 HdrCapabilities filterOut4k30(const HdrCapabilities& displayHdrCapabilities) {
     std::vector<ui::Hdr> hdrTypes;
     for (ui::Hdr type : displayHdrCapabilities.getSupportedHdrTypes()) {
@@ -332,6 +352,7 @@ static const int MAX_TRACING_MEMORY = 1024 * 1024 * 1024; // 1GB
 // ---------------------------------------------------------------------------
 int64_t SurfaceFlinger::dispSyncPresentTimeOffset;
 bool SurfaceFlinger::useHwcForRgbToYuv;
+bool SurfaceFlinger::useDirectRenderForVirtualDisplays;
 bool SurfaceFlinger::hasSyncFramework;
 int64_t SurfaceFlinger::maxFrameBufferAcquiredBuffers;
 uint32_t SurfaceFlinger::maxGraphicsWidth;
@@ -497,6 +518,15 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
             base::GetBoolProperty("persist.debug.sf.enable_layer_lifecycle_manager"s, false);
     mLegacyFrontEndEnabled = !mLayerLifecycleManagerEnabled ||
             base::GetBoolProperty("persist.debug.sf.enable_legacy_frontend"s, false);
+    mIncrementalSnapshotUpdateEnabled =
+            base::GetBoolProperty("debug.sf.enable_incremental_snapshot_update"s, false);
+    mParallelOutputComposition =
+            base::GetBoolProperty("debug.sf.enable_parallel_output_composition"s, false);
+    useDirectRenderForVirtualDisplays = mFlagManager.vds_direct_render();
+    if (mFlagManager.pipelined_composition()) {
+        mCompositionWorker =
+                std::make_unique<compositionengine::impl::HwcAsyncWorker>("SfComposition");
+    }
 }
 
 LatchUnsignaledConfig SurfaceFlinger::getLatchUnsignaledConfig() {
@@ -695,6 +725,7 @@ void SurfaceFlinger::bootFinished() {
     }
     const nsecs_t now = systemTime();
     const nsecs_t duration = now - mBootTime;
+    mBootDuration = duration;
     ALOGI("Boot is finished (%ld ms)", long(ns2ms(duration)) );
 
     mFrameTracer->initialize();
@@ -821,6 +852,25 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     addTransactionReadyFilters();
     Mutex::Autolock lock(mStateLock);
 
+    const nsecs_t initStartTime = systemTime();
+    nsecs_t stepStartTime = initStartTime;
+    const auto endInitStep = [&](const char* step) {
+        const nsecs_t now = systemTime();
+        mInitStepDurations.emplace_back(step, now - stepStartTime);
+        stepStartTime = now;
+    };
+
+    // Connecting to the composer HAL may wait for its service to start, so do it while the GPU
+    // context is created. RenderEngine stays on the main thread, as the context of a non-threaded
+    // RenderEngine is bound to the thread creating it.
+    nsecs_t hwcConnectDuration = 0;
+    auto hwComposerFuture = std::async(std::launch::async, [&] {
+        const nsecs_t startTime = systemTime();
+        auto hwComposer = getFactory().createHWComposer(mHwcServiceName);
+        hwcConnectDuration = systemTime() - startTime;
+        return hwComposer;
+    });
+
     // Get a RenderEngine for the given display / config (can't fail)
     // TODO(b/77156734): We need to stop casting and use HAL types when possible.
     // Sending maxFrameBufferAcquiredBuffers as the cache size is tightly tuned to single-display.
@@ -831,6 +881,7 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
                            .setEnableProtectedContext(enable_protected_contents(false))
                            .setPrecacheToneMapperShaderOnly(false)
                            .setSupportsBackgroundBlur(mSupportsBlur)
+                           .setLinearEffectCachePath("/data/misc/surfaceflinger/linear_effects")
                            .setContextPriority(
                                    useContextPriority
                                            ? renderengine::RenderEngine::ContextPriority::REALTIME
@@ -838,10 +889,15 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     if (auto type = chooseRenderEngineTypeViaSysProp()) {
         builder.setRenderEngineType(type.value());
     }
+    // Render cached sets on a lower priority context, so that they do not delay client composition.
+    if (base::GetBoolProperty("debug.renderengine.background_context"s, false)) {
+        builder.setBackgroundContextPriority(renderengine::RenderEngine::ContextPriority::LOW);
+    }
     mRenderEngine = renderengine::RenderEngine::create(builder.build());
     mCompositionEngine->setRenderEngine(mRenderEngine.get());
     mMaxRenderTargetSize =
             std::min(getRenderEngine().getMaxTextureSize(), getRenderEngine().getMaxViewportDims());
+    endInitStep("RenderEngine");
 
     // Set SF main policy after initializing RenderEngine which has its own policy.
     if (!SetTaskProfiles(0, {"SFMainPolicy"})) {
@@ -849,9 +905,12 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     }
 
     mCompositionEngine->setTimeStats(mTimeStats);
-    mCompositionEngine->setHwComposer(getFactory().createHWComposer(mHwcServiceName));
+    mCompositionEngine->setHwComposer(hwComposerFuture.get());
+    mInitStepDurations.emplace_back("HWComposer connection", hwcConnectDuration);
+    endInitStep("HWComposer wait");
     mCompositionEngine->getHwComposer().setCallback(*this);
     ClientCache::getInstance().setRenderEngine(&getRenderEngine());
+    endInitStep("HWComposer callback");
 
     enableLatchUnsignaledConfig = getLatchUnsignaledConfig();
 
@@ -859,9 +918,16 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     mAllowHwcForVDS = mAllowHwcForWFD && base::GetBoolProperty("debug.sf.enable_hwc_vds"s, false);
     mFirstApiLevel = android::base::GetIntProperty("ro.product.first_api_level", 0);
 
+    // Buffers allocated by SurfaceFlinger itself, e.g. for screenshots, are short-lived and tend
+    // to repeat the same parameters, so recycle them rather than going back to gralloc.
+    const int32_t bufferPoolKb = base::GetIntProperty("debug.sf.buffer_pool_size_kb"s, 32 * 1024);
+    GraphicBufferAllocator::get().setPoolCapacity(static_cast<uint64_t>(std::max(bufferPoolKb, 0)) *
+                                                  1024);
+
     // Process hotplug for displays connected at boot.
     LOG_ALWAYS_FATAL_IF(!configureLocked(),
                         "Initial display configuration failed: HWC did not hotplug");
+    endInitStep("Display hotplug");
 
     // Commit primary display.
     sp<const DisplayDevice> display;
@@ -880,6 +946,7 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     LOG_ALWAYS_FATAL_IF(!display, "Failed to configure the primary display");
     LOG_ALWAYS_FATAL_IF(!getHwComposer().isConnected(display->getPhysicalId()),
                         "Primary display is disconnected");
+    endInitStep("Primary display");
 
     // TODO(b/241285876): The Scheduler needlessly depends on creating the CompositionEngine part of
     // the DisplayDevice, hence the above commit of the primary display. Remove that special case by
@@ -887,8 +954,11 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     initScheduler(display);
     dispatchDisplayHotplugEvent(display->getPhysicalId(), true);
 
+    endInitStep("Scheduler");
+
     // Commit secondary display(s).
     processDisplayChangesLocked();
+    endInitStep("Secondary displays");
 
     // initialize our drawing state
     mDrawingState = mCurrentState;
@@ -913,6 +983,7 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
             ALOGW("Can't set SCHED_OTHER for primeCache");
         }
     }
+    endInitStep("Shader cache");
 
     // Inform native graphics APIs whether the present timestamp is supported:
 
@@ -945,6 +1016,7 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
         });
     }
 
+    mInitDuration = systemTime() - initStartTime;
     ALOGV("Done initializing");
 }
 
@@ -1755,6 +1827,10 @@ status_t SurfaceFlinger::overrideHdrTypes(const sp<IBinder>& displayToken,
 
 status_t SurfaceFlinger::onPullAtom(const int32_t atomId, std::vector<uint8_t>* pulledData,
                                     bool* success) {
+    if (atomId == FrameProfiler::kAtomId) {
+        *success = mFrameProfiler.populateAtom(pulledData);
+        return NO_ERROR;
+    }
     *success = mTimeStats->onPullAtom(atomId, pulledData);
     return NO_ERROR;
 }
@@ -2234,6 +2310,7 @@ bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, frontend::Update& upd
                                           bool transactionsFlushed, bool& outTransactionsAreEmpty) {
     using Changes = frontend::RequestedLayerState::Changes;
     ATRACE_CALL();
+    mLayerSnapshotGeneration++;
     {
         mLayerLifecycleManager.addLayers(std::move(update.newLayers));
         mLayerLifecycleManager.applyTransactions(update.transactions);
@@ -2266,7 +2343,8 @@ bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, frontend::Update& upd
                      .forceFullDamage = mForceFullDamage,
                      .supportedLayerGenericMetadata =
                              getHwComposer().getSupportedLayerGenericMetadata(),
-                     .genericLayerMetadataKeyMap = getGenericLayerMetadataKeyMap()};
+                     .genericLayerMetadataKeyMap = getGenericLayerMetadataKeyMap(),
+                     .incrementalUpdate = mIncrementalSnapshotUpdateEnabled};
         mLayerSnapshotBuilder.update(args);
     }
 
@@ -2278,6 +2356,7 @@ bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, frontend::Update& upd
                                                       Changes::Visibility)) {
         mVisibleRegionsDirty = true;
     }
+    updateHdrSnapshots();
     outTransactionsAreEmpty = mLayerLifecycleManager.getGlobalChanges().get() == 0;
     mustComposite |= mLayerLifecycleManager.getGlobalChanges().get() != 0;
 
@@ -2401,6 +2480,9 @@ bool SurfaceFlinger::commit(PhysicalDisplayId pacesetterId,
 
     const Period vsyncPeriod = mScheduler->getVsyncSchedule()->period();
 
+    mFrameProfiler.beginFrame(Fps::fromPeriodNsecs(vsyncPeriod.ns()),
+                              pacesetterFrameTarget.didMissFrame());
+
     // Save this once per commit + composite to ensure consistency
     // TODO (b/240619471): consider removing active display check once AOD is fixed
     const auto activeDisplay = FTL_FAKE_GUARD(mStateLock, getDisplayDeviceLocked(mActiveDisplayId));
@@ -2441,6 +2523,8 @@ bool SurfaceFlinger::commit(PhysicalDisplayId pacesetterId,
         const bool flushTransactions = clearTransactionFlags(eTransactionFlushNeeded);
         frontend::Update updates;
         if (flushTransactions) {
+            FrameProfiler::ScopedPhase phase(mFrameProfiler,
+                                             FrameProfiler::Phase::FlushTransactionQueues);
             updates = flushLifecycleUpdates();
             if (mTransactionTracing) {
                 mTransactionTracing
@@ -2451,13 +2535,17 @@ bool SurfaceFlinger::commit(PhysicalDisplayId pacesetterId,
             }
         }
         bool transactionsAreEmpty;
-        if (mLegacyFrontEndEnabled) {
-            mustComposite |= updateLayerSnapshotsLegacy(vsyncId, updates, flushTransactions,
-                                                        transactionsAreEmpty);
-        }
-        if (mLayerLifecycleManagerEnabled) {
-            mustComposite |=
-                    updateLayerSnapshots(vsyncId, updates, flushTransactions, transactionsAreEmpty);
+        {
+            FrameProfiler::ScopedPhase phase(mFrameProfiler,
+                                             FrameProfiler::Phase::UpdateLayerSnapshots);
+            if (mLegacyFrontEndEnabled) {
+                mustComposite |= updateLayerSnapshotsLegacy(vsyncId, updates, flushTransactions,
+                                                            transactionsAreEmpty);
+            }
+            if (mLayerLifecycleManagerEnabled) {
+                mustComposite |= updateLayerSnapshots(vsyncId, updates, flushTransactions,
+                                                      transactionsAreEmpty);
+            }
         }
 
         if (transactionFlushNeeded()) {
@@ -2466,6 +2554,7 @@ bool SurfaceFlinger::commit(PhysicalDisplayId pacesetterId,
 
         // This has to be called after latchBuffers because we want to include the layers that have
         // been latched in the commit callback
+        FrameProfiler::ScopedPhase phase(mFrameProfiler, FrameProfiler::Phase::Callbacks);
         if (transactionsAreEmpty) {
             // Invoke empty transaction callbacks early.
             mTransactionCallbackInvoker.sendCallbacks(false /* onCommitOnly */);
@@ -2486,7 +2575,10 @@ bool SurfaceFlinger::commit(PhysicalDisplayId pacesetterId,
     }
 
     updateCursorAsync();
-    updateInputFlinger(vsyncId, pacesetterFrameTarget.frameBeginTime());
+    {
+        FrameProfiler::ScopedPhase phase(mFrameProfiler, FrameProfiler::Phase::UpdateInputFlinger);
+        updateInputFlinger(vsyncId, pacesetterFrameTarget.frameBeginTime());
+    }
 
     if (mLayerTracingEnabled && !mLayerTracing.flagIsSet(LayerTracing::TRACE_COMPOSITION)) {
         // This will block and tracing should only be enabled for debugging.
@@ -2605,6 +2697,9 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
     refreshArgs.scheduledFrameTime = mScheduler->getScheduledFrameTime();
     refreshArgs.expectedPresentTime = pacesetterTarget.expectedPresentTime().ns();
     refreshArgs.hasTrustedPresentationListener = mNumTrustedPresentationListeners > 0;
+    refreshArgs.parallelOutputComposition = mParallelOutputComposition &&
+            getHwComposer().getComposer()->isSupported(
+                    Hwc2::Composer::OptionalFeature::ConcurrentDisplayCommands);
 
     // Store the present time just before calling to the composition engine so we could notify
     // the scheduler.
@@ -2613,7 +2708,46 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
     constexpr bool kCursorOnly = false;
     const auto layers = moveSnapshotsToCompositionArgs(refreshArgs, kCursorOnly);
 
-    mCompositionEngine->present(refreshArgs);
+    if (mPowerHintSessionEnabled) {
+        Hwc2::PowerAdvisor::CompositionWorkload workload{.layerCount = layers.size()};
+        for (const auto& [_, layerFE] : layers) {
+            const frontend::LayerSnapshot& snapshot = *layerFE->mSnapshot;
+            if (snapshot.forceClientComposition ||
+                snapshot.compositionType ==
+                        aidl::android::hardware::graphics::composer3::Composition::CLIENT) {
+                workload.clientCompositionLayerCount++;
+            }
+            if (snapshot.backgroundBlurRadius > 0 || !snapshot.blurRegions.empty()) {
+                workload.blurLayerCount++;
+            }
+            if (snapshot.shadowRadius > 0.f) {
+                workload.shadowLayerCount++;
+            }
+        }
+        mPowerAdvisor->setCompositionWorkload(workload);
+    }
+
+    const nsecs_t compositionStartTime = systemTime();
+    if (mCompositionWorker) {
+        // The composition engine only reads the snapshots moved into refreshArgs, so the main
+        // thread can collect the transactions queued for the next frame in the meantime. They are
+        // still only checked for readiness and applied in the next commit.
+        auto presented = mCompositionWorker->send([&] {
+            mCompositionEngine->present(refreshArgs);
+            return true;
+        });
+        mTransactionHandler.collectTransactions();
+        presented.get();
+    } else {
+        mCompositionEngine->present(refreshArgs);
+    }
+    const nsecs_t compositionEndTime = systemTime();
+    const nsecs_t prepareEndTime =
+            std::clamp(refreshArgs.prepareEndTime, compositionStartTime, compositionEndTime);
+    mFrameProfiler.addPhaseDuration(FrameProfiler::Phase::CompositionPrepare,
+                                    prepareEndTime - compositionStartTime);
+    mFrameProfiler.addPhaseDuration(FrameProfiler::Phase::CompositionPresent,
+                                    compositionEndTime - prepareEndTime);
     moveSnapshotsFromCompositionArgs(refreshArgs, layers);
 
     for (auto [layer, layerFE] : layers) {
@@ -2647,7 +2781,10 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
         scheduleComposite(FrameHint::kNone);
     }
 
-    postComposition(pacesetterId, frameTargeters, presentTime);
+    {
+        FrameProfiler::ScopedPhase phase(mFrameProfiler, FrameProfiler::Phase::PostComposition);
+        postComposition(pacesetterId, frameTargeters, presentTime);
+    }
 
     const bool hadGpuComposited =
             multiDisplayUnion(mCompositionCoverage).test(CompositionCoverage::Gpu);
@@ -2736,6 +2873,34 @@ void SurfaceFlinger::updateLayerGeometry() {
     mLayersPendingRefresh.clear();
 }
 
+void SurfaceFlinger::updateHdrSnapshots() {
+    if (mLayerLifecycleManager.getGlobalChanges().get() == 0 && !mFrontEndDisplayInfosChanged) {
+        return;
+    }
+
+    ATRACE_CALL();
+    // Drop the snapshots of destroyed or unreachable layers.
+    for (auto it = mHdrSnapshots.begin(); it != mHdrSnapshots.end();) {
+        if (mLayerSnapshotBuilder.getSnapshot(*it)) {
+            ++it;
+        } else {
+            it = mHdrSnapshots.erase(it);
+            mHdrLayerInfoChanged = true;
+        }
+    }
+    for (const auto& snapshot : mLayerSnapshotBuilder.getSnapshots()) {
+        if (snapshot->changes.get() == 0 && snapshot->clientChanges == 0) continue;
+
+        if (snapshot->isVisible && isHdrLayer(*snapshot)) {
+            mHdrSnapshots.insert(snapshot->path);
+            // The geometry or the desired ratio of the layer may have changed, too.
+            mHdrLayerInfoChanged = true;
+        } else if (mHdrSnapshots.erase(snapshot->path) > 0) {
+            mHdrLayerInfoChanged = true;
+        }
+    }
+}
+
 bool SurfaceFlinger::isHdrLayer(const frontend::LayerSnapshot& snapshot) const {
     // Even though the camera layer may be using an HDR transfer function or otherwise be "HDR"
     // the device may need to avoid boosting the brightness as a result of these layers to
@@ -2932,38 +3097,49 @@ void SurfaceFlinger::postComposition(PhysicalDisplayId pacesetterId,
         for (auto& [compositionDisplay, listener] : hdrInfoListeners) {
             HdrLayerInfoReporter::HdrLayerInfo info;
             int32_t maxArea = 0;
-            mDrawingState.traverse([&, compositionDisplay = compositionDisplay](Layer* layer) {
-                const auto layerFe = layer->getCompositionEngineLayerFE();
-                const frontend::LayerSnapshot& snapshot = *layer->getLayerSnapshot();
-                if (snapshot.isVisible &&
-                    compositionDisplay->includesLayer(snapshot.outputFilter)) {
-                    if (isHdrLayer(snapshot)) {
-                        const auto* outputLayer =
-                            compositionDisplay->getOutputLayerForLayer(layerFe);
-                        if (outputLayer) {
-                            const float desiredHdrSdrRatio = snapshot.desiredHdrSdrRatio <= 1.f
-                                    ? std::numeric_limits<float>::infinity()
-                                    : snapshot.desiredHdrSdrRatio;
-                            info.mergeDesiredRatio(desiredHdrSdrRatio);
-                            info.numberOfHdrLayers++;
-                            const auto displayFrame = outputLayer->getState().displayFrame;
-                            const int32_t area = displayFrame.width() * displayFrame.height();
-                            if (area > maxArea) {
-                                maxArea = area;
-                                info.maxW = displayFrame.width();
-                                info.maxH = displayFrame.height();
+            if (mLayerLifecycleManagerEnabled) {
+                // Only the HDR layers need to be looked at, see updateHdrSnapshots.
+                for (const auto& path : mHdrSnapshots) {
+                    const frontend::LayerSnapshot* snapshot =
+                            mLayerSnapshotBuilder.getSnapshot(path);
+                    if (!snapshot || !compositionDisplay->includesLayer(snapshot->outputFilter)) {
+                        continue;
+                    }
+                    const auto it = mLegacyLayers.find(snapshot->sequence);
+                    if (it == mLegacyLayers.end()) continue;
+                    const auto* outputLayer = compositionDisplay->getOutputLayerForLayer(
+                            it->second->getCompositionEngineLayerFE(path));
+                    if (outputLayer) {
+                        addHdrLayer(*snapshot, *outputLayer, info, maxArea);
+                    }
+                }
+            } else {
+                mDrawingState.traverse([&, compositionDisplay = compositionDisplay](Layer* layer) {
+                    const auto layerFe = layer->getCompositionEngineLayerFE();
+                    const frontend::LayerSnapshot& snapshot = *layer->getLayerSnapshot();
+                    if (snapshot.isVisible &&
+                        compositionDisplay->includesLayer(snapshot.outputFilter)) {
+                        if (isHdrLayer(snapshot)) {
+                            const auto* outputLayer =
+                                    compositionDisplay->getOutputLayerForLayer(layerFe);
+                            if (outputLayer) {
+                                addHdrLayer(snapshot, *outputLayer, info, maxArea);
                             }
                         }
                     }
-                }
-            });
+                });
+            }
+            // At most one dispatch per listener and frame, and only if the info changed.
             listener->dispatchHdrLayerInfo(info);
         }
     }
 
     mHdrLayerInfoChanged = false;
 
-    mTransactionCallbackInvoker.sendCallbacks(false /* onCommitOnly */);
+    {
+        FrameProfiler::ScopedPhase phase(mFrameProfiler, FrameProfiler::Phase::Callbacks);
+        mTransactionCallbackInvoker.sendCallbacks(false /* onCommitOnly */);
+    }
     mTransactionCallbackInvoker.clearCompletedTransactions();
 
     mTimeStats->incrementTotalFrames();
@@ -4538,14 +4714,12 @@ status_t SurfaceFlinger::setTransactionState(
     const int originPid = ipc->getCallingPid();
     const int originUid = ipc->getCallingUid();
     uint32_t permissions = LayerStatePermissions::getTransactionPermissions(originPid, originUid);
-    for (auto composerState : states) {
+    // Sanitize the states in place. Iterating over copies would not only allocate for every
+    // layer_state_t, it would also leave the states that are applied unsanitized.
+    for (auto& composerState : states) {
         composerState.state.sanitize(permissions);
     }
 
-    for (DisplayState display : displays) {
-        display.sanitize(permissions);
-    }
-
     if (!inputWindowCommands.empty() &&
         (permissions & layer_state_t::Permission::ACCESS_SURFACE_FLINGER) == 0) {
         ALOGE("Only privileged callers are allowed to send input commands.");
@@ -4566,10 +4740,11 @@ status_t SurfaceFlinger::setTransactionState(
     const int64_t postTime = systemTime();
 
     std::vector<uint64_t> uncacheBufferIds;
-    uncacheBufferIds.reserve(uncacheBuffers.size());
-    for (const auto& uncacheBuffer : uncacheBuffers) {
-        sp<GraphicBuffer> buffer = ClientCache::getInstance().erase(uncacheBuffer);
-        if (buffer != nullptr) {
+    if (!uncacheBuffers.empty()) {
+        const std::vector<sp<GraphicBuffer>> buffers =
+                ClientCache::getInstance().erase(uncacheBuffers);
+        uncacheBufferIds.reserve(buffers.size());
+        for (const auto& buffer : buffers) {
             uncacheBufferIds.push_back(buffer->getId());
         }
     }
@@ -4626,6 +4801,12 @@ status_t SurfaceFlinger::setTransactionState(
                            transactionId,
                            mergedTransactionIds};
 
+    // The displays are shared with the caller's Vector until they are edited, so sanitize the
+    // TransactionState's copy.
+    for (size_t i = 0; i < state.displays.size(); i++) {
+        state.displays.editItemAt(i).sanitize(permissions);
+    }
+
     if (mTransactionTracing) {
         mTransactionTracing->addQueuedTransaction(state);
     }
@@ -5659,11 +5840,14 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
                 {"--display-id"s, dumper(&SurfaceFlinger::dumpDisplayIdentificationData)},
                 {"--displays"s, dumper(&SurfaceFlinger::dumpDisplays)},
                 {"--edid"s, argsDumper(&SurfaceFlinger::dumpRawDisplayIdentificationData)},
+                {"--boot-timings"s, dumper(&SurfaceFlinger::dumpBootTimings)},
                 {"--events"s, dumper(&SurfaceFlinger::dumpEvents)},
+                {"--frame-profile"s, dumper(&SurfaceFlinger::dumpFrameProfile)},
                 {"--frametimeline"s, argsDumper(&SurfaceFlinger::dumpFrameTimeline)},
                 {"--hwclayers"s, dumper(&SurfaceFlinger::dumpHwcLayersMinidumpLocked)},
                 {"--latency"s, argsDumper(&SurfaceFlinger::dumpStatsLocked)},
                 {"--latency-clear"s, argsDumper(&SurfaceFlinger::clearStatsLocked)},
+                {"--latency-stages"s, dumper(&SurfaceFlinger::dumpLatencyStages)},
                 {"--list"s, dumper(&SurfaceFlinger::listLayersLocked)},
                 {"--planner"s, argsDumper(&SurfaceFlinger::dumpPlannerInfo)},
                 {"--scheduler"s, dumper(&SurfaceFlinger::dumpScheduler)},
@@ -5709,7 +5893,9 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
             }
         }
 
-        if (dumpLayers) {
+        if (dumpLayers && asProto && !mLegacyFrontEndEnabled) {
+            dumpLayersTraceFileProto(result);
+        } else if (dumpLayers) {
             LayersTraceFileProto traceFileProto = mLayerTracing.createTraceFileProto();
             LayersTraceProto* layersTrace = traceFileProto.add_entry();
             LayersProto layersProto = dumpProtoFromMainThread();
@@ -5772,6 +5958,26 @@ void SurfaceFlinger::dumpFrameTimeline(const DumpArgs& args, std::string& result
     mFrameTimeline->parseArgs(args, result);
 }
 
+void SurfaceFlinger::dumpLatencyStages(std::string& result) {
+    mLatencyStageTracker.dump(result);
+}
+
+void SurfaceFlinger::dumpFrameProfile(std::string& result) const {
+    mFrameProfiler.dump(result);
+}
+
+void SurfaceFlinger::dumpBootTimings(std::string& result) const {
+    StringAppendF(&result, "Boot timings (ms)\n");
+    for (const auto& [step, duration] : mInitStepDurations) {
+        StringAppendF(&result, "%24s %8.1f\n", step, static_cast<float>(duration) / 1e6f);
+    }
+    StringAppendF(&result, "%24s %8.1f\n", "init", static_cast<float>(mInitDuration) / 1e6f);
+    if (const nsecs_t bootDuration = mBootDuration.load(); bootDuration > 0) {
+        StringAppendF(&result, "%24s %8.1f\n", "boot finished",
+                      static_cast<float>(bootDuration) / 1e6f);
+    }
+}
+
 void SurfaceFlinger::logFrameStats(TimePoint now) {
     static TimePoint sTimestamp = now;
     if (now - sTimestamp < 30min) return;
@@ -5786,6 +5992,7 @@ void SurfaceFlinger::appendSfConfigString(std::string& result) const {
 
     StringAppendF(&result, " PRESENT_TIME_OFFSET=%" PRId64, dispSyncPresentTimeOffset);
     StringAppendF(&result, " FORCE_HWC_FOR_RBG_TO_YUV=%d", useHwcForRgbToYuv);
+    StringAppendF(&result, " VIRTUAL_DISPLAY_DIRECT_RENDER=%d", useDirectRenderForVirtualDisplays);
     StringAppendF(&result, " MAX_VIRT_DISPLAY_DIM=%zu",
                   getHwComposer().getMaxVirtualDisplayDimension());
     StringAppendF(&result, " RUNNING_WITHOUT_SYNC_FRAMEWORK=%d", !hasSyncFramework);
@@ -6005,6 +6212,36 @@ LayersProto SurfaceFlinger::dumpProtoFromMainThread(uint32_t traceFlags) {
     return mScheduler->schedule([=] { return dumpDrawingStateProto(traceFlags); }).get();
 }
 
+void SurfaceFlinger::dumpSerializedProtoFromMainThread(std::string& out, uint32_t traceFlags) {
+    mScheduler
+            ->schedule([&]() FTL_FAKE_GUARD(kMainThreadContext) {
+                LayerProtoFromSnapshotGenerator(mLayerSnapshotBuilder, mFrontEndDisplayInfos,
+                                                mLegacyLayers, traceFlags)
+                        .generateSerialized(mLayerHierarchyBuilder.getHierarchy(), out);
+            })
+            .get();
+}
+
+void SurfaceFlinger::dumpLayersTraceFileProto(std::string& result) {
+    // Writes the same bytes as serializing the LayersTraceFileProto built by doDump, without
+    // building the LayerProto of every layer first.
+    const LayersTraceFileProto fileProto = mLayerTracing.createTraceFileProto();
+    ProtoWireWriter writer(result);
+    writer.writeFixed64(LayersTraceFileProto::kMagicNumberFieldNumber, fileProto.magic_number());
+
+    const size_t entry = writer.beginMessage(LayersTraceFileProto::kEntryFieldNumber);
+    const size_t layers = writer.beginMessage(LayersTraceProto::kLayersFieldNumber);
+    dumpSerializedProtoFromMainThread(result);
+    writer.endMessage(layers);
+    for (const DisplayProto& display : dumpDisplayProto()) {
+        writer.writeBytes(LayersTraceProto::kDisplaysFieldNumber, display.SerializeAsString());
+    }
+    writer.endMessage(entry);
+
+    writer.writeFixed64(LayersTraceFileProto::kRealToElapsedTimeOffsetNanosFieldNumber,
+                        fileProto.real_to_elapsed_time_offset_nanos());
+}
+
 void SurfaceFlinger::dumpOffscreenLayers(std::string& result) {
     auto future = mScheduler->schedule([this] {
         std::string result;
@@ -6108,6 +6345,11 @@ void SurfaceFlinger::dumpAllLocked(const DumpArgs& args, const std::string& comp
     ClientCache::getInstance().dump(result);
     DebugEGLImageTracker::getInstance()->dump(result);
 
+    if (mLayerLifecycleManagerEnabled) {
+        mLayerSnapshotBuilder.dump(result);
+    }
+    mTransactionHandler.dump(result);
+
     if (const auto display = getDefaultDisplayDeviceLocked()) {
         display->getCompositionDisplay()->getState().undefinedRegion.dump(result,
                                                                           "undefinedRegion");
@@ -6115,6 +6357,15 @@ void SurfaceFlinger::dumpAllLocked(const DumpArgs& args, const std::string& comp
                       toCString(display->getOrientation()), display->isPoweredOn());
     }
     StringAppendF(&result, "  transaction-flags         : %08x\n", mTransactionFlags.load());
+    const auto fenceStats = Fence::getSignalTimeStats();
+    StringAppendF(&result,
+                  "  fence signal time queries : %" PRIu64 " (%" PRIu64 " sync_file_info)\n",
+                  fenceStats.queries, fenceStats.fileInfoQueries);
+    const auto permissionStats = PermissionCache::getStats();
+    StringAppendF(&result,
+                  "  permission cache          : %" PRIu64 " hits, %" PRIu64 " misses (%" PRIu64
+                  " expired)\n",
+                  permissionStats.hits, permissionStats.misses, permissionStats.expirations);
 
     if (const auto display = getDefaultDisplayDeviceLocked()) {
         std::string fps, xDpi, yDpi;
@@ -6186,6 +6437,9 @@ void SurfaceFlinger::dumpAllLocked(const DumpArgs& args, const std::string& comp
     result.append(mTimeStats->miniDump());
     result.append("\n");
 
+    mPowerAdvisor->dump(result);
+    result.append("\n");
+
     result.append("Window Infos:\n");
     auto windowInfosDebug = mWindowInfosListenerInvoker->getDebugInfo();
     StringAppendF(&result, "  max send vsync id: %" PRId64 "\n",
@@ -6194,6 +6448,9 @@ void SurfaceFlinger::dumpAllLocked(const DumpArgs& args, const std::string& comp
                   windowInfosDebug.maxSendDelayDuration);
     StringAppendF(&result, "  unsent messages: %zu\n", windowInfosDebug.pendingMessageCount);
     result.append("\n");
+
+    BackgroundExecutor::getInstance().dump(result);
+    result.append("\n");
 }
 
 mat4 SurfaceFlinger::calculateColorMatrix(float saturation) {
@@ -7304,6 +7561,14 @@ ftl::SharedFuture<FenceResult> SurfaceFlinger::captureScreenCommon(
     const bool supportsProtected = getRenderEngine().supportsProtectedContent();
     bool hasProtectedLayer = false;
     if (allowProtected && supportsProtected) {
+        // Taking the snapshots may require a partial front end update, e.g. for excluded layers,
+        // so keep them for the capture itself and only take them again if the front end was
+        // updated in between.
+        struct CachedLayerSnapshots {
+            uint64_t generation;
+            std::optional<std::vector<std::pair<Layer*, sp<LayerFE>>>> layers;
+        };
+        auto cachedLayers = std::make_shared<CachedLayerSnapshots>();
         hasProtectedLayer = mScheduler
                                     ->schedule([=]() {
                                         bool protectedLayerFound = false;
@@ -7313,9 +7578,23 @@ ftl::SharedFuture<FenceResult> SurfaceFlinger::captureScreenCommon(
                                                     (layerFe->mSnapshot->isVisible &&
                                                      layerFe->mSnapshot->hasProtectedContent);
                                         }
+                                        if (mLayerLifecycleManagerEnabled) {
+                                            cachedLayers->generation = mLayerSnapshotGeneration;
+                                            cachedLayers->layers = std::move(layers);
+                                        }
                                         return protectedLayerFound;
                                     })
                                     .get();
+        getLayerSnapshots = [this, cachedLayers,
+                             getLayerSnapshots = std::move(getLayerSnapshots)]() {
+            if (cachedLayers->layers && cachedLayers->generation == mLayerSnapshotGeneration) {
+                auto layers = std::move(*cachedLayers->layers);
+                cachedLayers->layers.reset();
+                return layers;
+            }
+            cachedLayers->layers.reset();
+            return getLayerSnapshots();
+        };
     }
 
     const uint32_t usage = GRALLOC_USAGE_HW_COMPOSER | GRALLOC_USAGE_HW_RENDER |
@@ -70,12 +70,14 @@
 #include "DisplayIdGenerator.h"
 #include "Effects/Daltonizer.h"
 #include "FlagManager.h"
+#include "FrameProfiler.h"
 #include "FrontEnd/DisplayInfo.h"
 #include "FrontEnd/LayerCreationArgs.h"
 #include "FrontEnd/LayerLifecycleManager.h"
 #include "FrontEnd/LayerSnapshot.h"
 #include "FrontEnd/LayerSnapshotBuilder.h"
 #include "FrontEnd/TransactionHandler.h"
+#include "LatencyStageTracker.h"
 #include "LayerVector.h"
 #include "Scheduler/ISchedulerCallback.h"
 #include "Scheduler/RefreshRateSelector.h"
@@ -151,6 +153,10 @@ class DisplaySurface;
 class OutputLayer;
 
 struct CompositionRefreshArgs;
+
+namespace impl {
+class HwcAsyncWorker;
+} // namespace impl
 } // namespace compositionengine
 
 namespace renderengine {
@@ -223,6 +229,11 @@ public:
     // GL composition.
     static bool useHwcForRgbToYuv;
 
+    // Instructs VirtualDisplaySurface to allocate its output buffers for both GPU and HWC, so that
+    // GPU composited frames stay in the sink's buffer instead of being copied by HWC, and switching
+    // composition types does not reallocate them. Takes precedence over useHwcForRgbToYuv.
+    static bool useDirectRenderForVirtualDisplays;
+
     // Controls the number of buffers SurfaceFlinger will allocate for use in
     // FramebufferSurface
     static int64_t maxFrameBufferAcquiredBuffers;
@@ -1088,6 +1099,9 @@ private:
     void clearStatsLocked(const DumpArgs& args, std::string& result);
     void dumpTimeStats(const DumpArgs& args, bool asProto, std::string& result) const;
     void dumpFrameTimeline(const DumpArgs& args, std::string& result) const;
+    void dumpLatencyStages(std::string& result);
+    void dumpFrameProfile(std::string& result) const;
+    void dumpBootTimings(std::string& result) const;
     void logFrameStats(TimePoint now) REQUIRES(kMainThreadContext);
 
     void dumpScheduler(std::string& result) const REQUIRES(mStateLock);
@@ -1111,6 +1125,12 @@ private:
     void dumpHwc(std::string& result) const;
     LayersProto dumpProtoFromMainThread(uint32_t traceFlags = LayerTracing::TRACE_ALL)
             EXCLUDES(mStateLock);
+    // Appends the serialized LayersProto, which only the new frontend supports.
+    void dumpSerializedProtoFromMainThread(std::string& out,
+                                           uint32_t traceFlags = LayerTracing::TRACE_ALL)
+            EXCLUDES(mStateLock);
+    // Appends the serialized LayersTraceFileProto of the --proto dump.
+    void dumpLayersTraceFileProto(std::string& result) EXCLUDES(mStateLock);
     void dumpOffscreenLayers(std::string& result) EXCLUDES(mStateLock);
     void dumpPlannerInfo(const DumpArgs& args, std::string& result) const REQUIRES(mStateLock);
 
@@ -1142,6 +1162,8 @@ private:
     int getMaxAcquiredBufferCountForRefreshRate(Fps refreshRate) const;
 
     bool isHdrLayer(const frontend::LayerSnapshot& snapshot) const;
+    // Updates mHdrSnapshots from the snapshots that changed in this commit.
+    void updateHdrSnapshots() REQUIRES(kMainThreadContext);
 
     ui::Rotation getPhysicalDisplayOrientation(DisplayId, bool isPrimary) const
             REQUIRES(mStateLock);
@@ -1193,6 +1215,13 @@ private:
     const nsecs_t mBootTime = systemTime();
     bool mIsUserBuild = true;
 
+    // The steps of init and their durations. Only written by init, before SurfaceFlinger is
+    // published to the service manager, so dumpsys reads them without locking.
+    std::vector<std::pair<const char*, nsecs_t>> mInitStepDurations;
+    nsecs_t mInitDuration = 0;
+    // Time from the start of SurfaceFlinger to bootFinished, or 0 until then.
+    std::atomic<nsecs_t> mBootDuration = 0;
+
     // Can only accessed from the main thread, these members
     // don't need synchronization
     State mDrawingState{LayerVector::StateSet::Drawing};
@@ -1200,6 +1229,12 @@ private:
 
     bool mHdrLayerInfoChanged = false;
 
+    // The visible HDR snapshots of the LayerLifecycleManager frontend. Only changed snapshots are
+    // checked for HDR on commit, and only these are accounted for on composite.
+    std::unordered_set<frontend::LayerHierarchy::TraversalPath,
+                       frontend::LayerHierarchy::TraversalPathHash>
+            mHdrSnapshots;
+
     // Used to ensure we omit a callback when HDR layer info listener is newly added but the
     // scene hasn't changed
     bool mAddingHDRLayerInfoListener = false;
@@ -1274,6 +1309,8 @@ private:
     const std::shared_ptr<TimeStats> mTimeStats;
     const std::unique_ptr<FrameTracer> mFrameTracer;
     const std::unique_ptr<frametimeline::FrameTimeline> mFrameTimeline;
+    LatencyStageTracker mLatencyStageTracker;
+    FrameProfiler mFrameProfiler;
 
     VsyncId mLastCommittedVsyncId;
 
@@ -1435,6 +1472,13 @@ private:
 
     bool mLayerLifecycleManagerEnabled = false;
     bool mLegacyFrontEndEnabled = true;
+    // Skip clean subtrees when updating layer snapshots. See LayerSnapshotBuilder::Args.
+    bool mIncrementalSnapshotUpdateEnabled = false;
+    // Prepare the composition state of each display on its own thread.
+    bool mParallelOutputComposition = false;
+    // Runs the composition engine while the main thread collects the transactions for the next
+    // frame. Null unless FlagManager::pipelined_composition.
+    std::unique_ptr<compositionengine::impl::HwcAsyncWorker> mCompositionWorker;
 
     frontend::LayerLifecycleManager mLayerLifecycleManager;
     frontend::LayerHierarchyBuilder mLayerHierarchyBuilder{{}};
@@ -1446,6 +1490,9 @@ private:
     // These classes do not store any client state but help with managing transaction callbacks
     // and stats.
     std::unordered_map<uint32_t, sp<Layer>> mLegacyLayers;
+    // Incremented on every front end update, which may change snapshots and destroy the layers
+    // that screenshot snapshots refer to.
+    uint64_t mLayerSnapshotGeneration = 0;
 
     TransactionHandler mTransactionHandler;
     ui::DisplayMap<ui::LayerStack, frontend::DisplayInfo> mFrontEndDisplayInfos;
@@ -311,6 +311,15 @@ std::string TimeStats::miniDump() {
                                  mTimeStatsTracker.size());
     android::base::StringAppendF(&result, "Number of layers in the stats pool is %zu\n",
                                  mTimeStats.stats.size());
+    android::base::StringAppendF(&result,
+                                 "Number of contended layer updates is %" PRIu64 "\n",
+                                 mContendedLayerUpdates);
+    {
+        std::lock_guard<std::mutex> stagingLock(mStagingMutex);
+        android::base::StringAppendF(&result,
+                                     "Number of dropped layer events is %" PRIu64 "\n",
+                                     mDroppedLayerEvents);
+    }
     return result;
 }
 
@@ -581,7 +590,7 @@ void TimeStats::setPostTime(int32_t layerId, uint64_t frameNumber, const std::st
     ALOGV("[%d]-[%" PRIu64 "]-[%s]-PostTime[%" PRId64 "]", layerId, frameNumber, layerName.c_str(),
           postTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    const auto lock = lockForLayerUpdate();
     if (!canAddNewAggregatedStats(uid, layerName, gameMode)) {
         return;
     }
@@ -624,16 +633,7 @@ void TimeStats::setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latc
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerId, frameNumber, latchTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.latchTime = latchTime;
-    }
+    stageLayerEvent({LayerEvent::Type::Latch, layerId, frameNumber, latchTime, nullptr});
 }
 
 void TimeStats::incrementLatchSkipped(int32_t layerId, LatchSkipReason reason) {
@@ -643,7 +643,7 @@ void TimeStats::incrementLatchSkipped(int32_t layerId, LatchSkipReason reason) {
     ALOGV("[%d]-LatchSkipped-Reason[%d]", layerId,
           static_cast<std::underlying_type<LatchSkipReason>::type>(reason));
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    const auto lock = lockForLayerUpdate();
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
 
@@ -660,7 +660,7 @@ void TimeStats::incrementBadDesiredPresent(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-BadDesiredPresent", layerId);
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    const auto lock = lockForLayerUpdate();
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     layerRecord.badDesiredPresentFrames++;
@@ -672,16 +672,7 @@ void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t de
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerId, frameNumber, desiredTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.desiredTime = desiredTime;
-    }
+    stageLayerEvent({LayerEvent::Type::Desired, layerId, frameNumber, desiredTime, nullptr});
 }
 
 void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t acquireTime) {
@@ -690,16 +681,7 @@ void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t ac
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerId, frameNumber, acquireTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.acquireTime = acquireTime;
-    }
+    stageLayerEvent({LayerEvent::Type::Acquire, layerId, frameNumber, acquireTime, nullptr});
 }
 
 void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
@@ -710,16 +692,61 @@ void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", layerId, frameNumber,
           acquireFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
+    stageLayerEvent({LayerEvent::Type::AcquireFence, layerId, frameNumber, 0, acquireFence});
+}
+
+void TimeStats::stageLayerEvent(LayerEvent&& event) {
+    std::lock_guard<std::mutex> lock(mStagingMutex);
+    if (mStagedLayerEvents.size() >= MAX_NUM_STAGED_LAYER_EVENTS) {
+        mDroppedLayerEvents++;
         return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.acquireFence = acquireFence;
     }
+    mStagedLayerEvents.push_back(std::move(event));
+}
+
+void TimeStats::applyStagedLayerEventsLocked() {
+    {
+        std::lock_guard<std::mutex> lock(mStagingMutex);
+        if (mStagedLayerEvents.empty()) return;
+        std::swap(mStagedLayerEvents, mApplyingLayerEvents);
+    }
+
+    ATRACE_CALL();
+    for (const LayerEvent& event : mApplyingLayerEvents) {
+        if (!mTimeStatsTracker.count(event.layerId)) continue;
+        LayerRecord& layerRecord = mTimeStatsTracker[event.layerId];
+        if (layerRecord.waitData < 0 ||
+            layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
+            continue;
+        TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
+        if (timeRecord.frameTime.frameNumber != event.frameNumber) continue;
+        switch (event.type) {
+            case LayerEvent::Type::Latch:
+                timeRecord.frameTime.latchTime = event.time;
+                break;
+            case LayerEvent::Type::Desired:
+                timeRecord.frameTime.desiredTime = event.time;
+                break;
+            case LayerEvent::Type::Acquire:
+                timeRecord.frameTime.acquireTime = event.time;
+                break;
+            case LayerEvent::Type::AcquireFence:
+                timeRecord.acquireFence = event.fence;
+                break;
+        }
+    }
+    // Keep the capacity around for the next frame.
+    mApplyingLayerEvents.clear();
+}
+
+std::unique_lock<std::mutex> TimeStats::lockForLayerUpdate() {
+    std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        mContendedLayerUpdates++;
+        lock.lock();
+    }
+    applyStagedLayerEventsLocked();
+    return lock;
 }
 
 void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t presentTime,
@@ -730,7 +757,7 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerId, frameNumber, presentTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    const auto lock = lockForLayerUpdate();
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     if (layerRecord.waitData < 0 ||
@@ -757,7 +784,7 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", layerId, frameNumber,
           presentFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    const auto lock = lockForLayerUpdate();
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     if (layerRecord.waitData < 0 ||
@@ -882,7 +909,7 @@ void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-removeTimeRecord", layerId, frameNumber);
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    const auto lock = lockForLayerUpdate();
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     size_t removeAt = 0;
@@ -1090,6 +1117,12 @@ void TimeStats::clearGlobalLocked() {
 void TimeStats::clearLayersLocked() {
     ATRACE_CALL();
 
+    {
+        std::lock_guard<std::mutex> lock(mStagingMutex);
+        mStagedLayerEvents.clear();
+        mDroppedLayerEvents = 0;
+    }
+    mContendedLayerUpdates = 0;
     mTimeStatsTracker.clear();
 
     for (auto& globalRecord : mTimeStats.stats) {
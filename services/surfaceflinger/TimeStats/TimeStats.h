@@ -22,6 +22,7 @@
 #include <optional>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include <android/hardware/graphics/composer/2.4/IComposerClient.h>
 #include <gui/JankInfo.h>
@@ -233,6 +234,17 @@ class TimeStats : public android::TimeStats {
         std::variant<nsecs_t, std::shared_ptr<FenceTime>> endTime;
     };
 
+    // A per-layer timestamp that was recorded without taking mMutex. Staged events are applied
+    // to mTimeStatsTracker, in order, the next time mMutex is taken for a layer update.
+    struct LayerEvent {
+        enum class Type { Latch, Desired, Acquire, AcquireFence };
+        Type type;
+        int32_t layerId;
+        uint64_t frameNumber;
+        nsecs_t time;
+        std::shared_ptr<FenceTime> fence;
+    };
+
     struct GlobalRecord {
         nsecs_t prevPresentTime = 0;
         std::deque<std::shared_ptr<FenceTime>> presentFences;
@@ -302,6 +314,10 @@ private:
     void flushPowerTimeLocked();
     void flushAvailableGlobalRecordsToStatsLocked();
     bool canAddNewAggregatedStats(uid_t uid, const std::string& layerName, GameMode);
+    void stageLayerEvent(LayerEvent&& event);
+    void applyStagedLayerEventsLocked();
+    // Locks mMutex, counting whether it had to wait, and applies the staged layer events.
+    std::unique_lock<std::mutex> lockForLayerUpdate();
 
     void enable();
     void disable();
@@ -317,8 +333,18 @@ private:
     std::unordered_map<int32_t, LayerRecord> mTimeStatsTracker;
     PowerTime mPowerTime;
     GlobalRecord mGlobalRecord;
+    // Times lockForLayerUpdate found mMutex held by another thread.
+    uint64_t mContendedLayerUpdates = 0;
+    // Only used by applyStagedLayerEventsLocked, kept to reuse its capacity.
+    std::vector<LayerEvent> mApplyingLayerEvents;
+
+    std::mutex mStagingMutex;
+    std::vector<LayerEvent> mStagedLayerEvents;
+    // Events dropped because mStagedLayerEvents was full.
+    uint64_t mDroppedLayerEvents = 0;
 
     static const size_t MAX_NUM_LAYER_RECORDS = 200;
+    static const size_t MAX_NUM_STAGED_LAYER_EVENTS = MAX_NUM_LAYER_RECORDS * 8;
 
     static const size_t REFRESH_RATE_BUCKET_WIDTH = 30;
     static const size_t RENDER_RATE_BUCKET_WIDTH = REFRESH_RATE_BUCKET_WIDTH;
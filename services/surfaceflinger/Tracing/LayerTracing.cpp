@@ -32,15 +32,66 @@
 namespace android {
 
 LayerTracing::LayerTracing()
-      : mBuffer(std::make_unique<RingBuffer<LayersTraceFileProto, LayersTraceProto>>()) {}
+      : mBuffer(std::make_unique<RingBuffer<LayersTraceFileProto, LayersTraceProto>>()) {
+    mThread = std::thread(&LayerTracing::loop, this);
+}
+
+LayerTracing::~LayerTracing() {
+    {
+        std::scoped_lock lock(mPendingEntriesLock);
+        mDone = true;
+    }
+    mPendingEntriesCv.notify_all();
+    mThread.join();
+}
+
+void LayerTracing::loop() {
+    while (true) {
+        {
+            std::unique_lock lock(mPendingEntriesLock);
+            base::ScopedLockAssertion assumeLocked(mPendingEntriesLock);
+            mPendingEntriesCv.wait(lock, [&]() REQUIRES(mPendingEntriesLock) {
+                return mDone || !mPendingEntries.empty();
+            });
+            if (mDone) {
+                break;
+            }
+        }
+        // The entries may have been added by a writer in the meantime, in which case this is a
+        // no-op.
+        std::scoped_lock lock(mTraceLock);
+        addPendingEntriesLocked();
+    }
+}
+
+void LayerTracing::addPendingEntriesLocked() {
+    std::vector<LayersTraceProto> entries;
+    {
+        std::scoped_lock lock(mPendingEntriesLock);
+        entries = std::move(mPendingEntries);
+        mPendingEntries.clear();
+    }
+    if (entries.empty()) {
+        return;
+    }
 
-LayerTracing::~LayerTracing() = default;
+    ATRACE_CALL();
+    // Drop entries that raced with disable(), they would otherwise show up in the next trace.
+    if (!mEnabled) {
+        return;
+    }
+    for (LayersTraceProto& entry : entries) {
+        mBuffer->emplace(std::move(entry));
+    }
+}
 
 bool LayerTracing::enable() {
     std::scoped_lock lock(mTraceLock);
     if (mEnabled) {
         return false;
     }
+    // Drop anything left over from the previous trace.
+    addPendingEntriesLocked();
     mBuffer->setSize(mBufferSizeInBytes);
     mEnabled = true;
     return true;
@@ -51,6 +102,7 @@ bool LayerTracing::disable(std::string filename, bool writeToFile) {
     if (!mEnabled) {
         return false;
     }
+    addPendingEntriesLocked();
     mEnabled = false;
     if (writeToFile) {
         LayersTraceFileProto fileProto = createTraceFileProto();
@@ -62,13 +114,13 @@ bool LayerTracing::disable(std::string filename, bool writeToFile) {
 
 void LayerTracing::appendToStream(std::ofstream& out) {
     std::scoped_lock lock(mTraceLock);
+    addPendingEntriesLocked();
     LayersTraceFileProto fileProto = createTraceFileProto();
     mBuffer->appendToStream(fileProto, out);
     mBuffer->reset();
 }
 
 bool LayerTracing::isEnabled() const {
-    std::scoped_lock lock(mTraceLock);
     return mEnabled;
 }
 
@@ -77,6 +129,7 @@ status_t LayerTracing::writeToFile(std::string filename) {
     if (!mEnabled) {
         return STATUS_OK;
     }
+    addPendingEntriesLocked();
     LayersTraceFileProto fileProto = createTraceFileProto();
     return mBuffer->writeToFile(fileProto, filename);
 }
@@ -112,12 +165,14 @@ void LayerTracing::dump(std::string& result) const {
     std::scoped_lock lock(mTraceLock);
     base::StringAppendF(&result, "Tracing state: %s\n", mEnabled ? "enabled" : "disabled");
     mBuffer->dump(result);
+    std::scoped_lock pendingLock(mPendingEntriesLock);
+    base::StringAppendF(&result, "  entries pending serialization: %zu\n",
+                        mPendingEntries.size());
 }
 
 void LayerTracing::notify(bool visibleRegionDirty, int64_t time, int64_t vsyncId,
                           LayersProto* layers, std::string hwcDump,
                           google::protobuf::RepeatedPtrField<DisplayProto>* displays) {
-    std::scoped_lock lock(mTraceLock);
     if (!mEnabled) {
         return;
     }
@@ -134,14 +189,18 @@ void LayerTracing::notify(bool visibleRegionDirty, int64_t time, int64_t vsyncId
     entry.mutable_layers()->Swap(layers);
 
     if (flagIsSet(LayerTracing::TRACE_HWC)) {
-        entry.set_hwc_blob(hwcDump);
+        entry.set_hwc_blob(std::move(hwcDump));
     }
     if (!flagIsSet(LayerTracing::TRACE_COMPOSITION)) {
         entry.set_excludes_composition_state(true);
     }
     entry.mutable_displays()->Swap(displays);
     entry.set_vsync_id(vsyncId);
-    mBuffer->emplace(std::move(entry));
+    {
+        std::scoped_lock lock(mPendingEntriesLock);
+        mPendingEntries.emplace_back(std::move(entry));
+    }
+    mPendingEntriesCv.notify_one();
 }
 
 } // namespace android
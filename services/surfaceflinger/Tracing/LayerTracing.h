@@ -22,8 +22,12 @@
 #include <utils/StrongPointer.h>
 #include <utils/Timers.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 using namespace android::surfaceflinger;
 
@@ -37,6 +41,9 @@ class SurfaceFlinger;
 /*
  * LayerTracing records layer states during surface flinging. Manages tracing state and
  * configuration.
+ *
+ * The main thread hands over the layer protos of every traced frame, and a tracing thread
+ * serializes them into the ring buffer, so the main thread never waits for serialization.
  */
 class LayerTracing {
 public:
@@ -70,10 +77,23 @@ private:
     static constexpr auto FILE_NAME = "/data/misc/wmtrace/layers_trace.winscope";
     uint32_t mFlags = TRACE_INPUT;
     mutable std::mutex mTraceLock;
-    bool mEnabled GUARDED_BY(mTraceLock) = false;
+    // Only changed with mTraceLock held, but read without it so that the main thread does not
+    // block on the tracing thread.
+    std::atomic<bool> mEnabled = false;
     std::unique_ptr<RingBuffer<LayersTraceFileProto, LayersTraceProto>> mBuffer
             GUARDED_BY(mTraceLock);
     size_t mBufferSizeInBytes GUARDED_BY(mTraceLock) = 20 * 1024 * 1024;
+
+    // Entries that have not been serialized into mBuffer yet. Lock ordering is mTraceLock, then
+    // mPendingEntriesLock, so that entries are always added to mBuffer in order.
+    mutable std::mutex mPendingEntriesLock;
+    std::condition_variable mPendingEntriesCv;
+    std::vector<LayersTraceProto> mPendingEntries GUARDED_BY(mPendingEntriesLock);
+    bool mDone GUARDED_BY(mPendingEntriesLock) = false;
+    std::thread mThread;
+
+    void loop();
+    void addPendingEntriesLocked() REQUIRES(mTraceLock) EXCLUDES(mPendingEntriesLock);
 };
 
 } // namespace android
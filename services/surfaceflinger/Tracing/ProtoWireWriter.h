@@ -0,0 +1,167 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace android::surfaceflinger {
+
+// Appends protobuf wire format to a string without building any message objects.
+//
+// To produce the same bytes as MessageLite::SerializeAsString, the caller writes the fields of a
+// message in increasing field number order, and writes a nested message only where the message
+// based code would have set it. Like proto3, the scalar writers skip fields that hold their
+// default value, and repeated scalars are packed.
+class ProtoWireWriter {
+public:
+    explicit ProtoWireWriter(std::string& out) : mOut(out) {}
+
+    void writeInt32(uint32_t field, int32_t value) {
+        // Negative values are sign extended to 64 bits, as protobuf does.
+        if (value != 0) writeVarintField(field, static_cast<uint64_t>(static_cast<int64_t>(value)));
+    }
+    void writeUInt32(uint32_t field, uint32_t value) {
+        if (value != 0) writeVarintField(field, value);
+    }
+    void writeUInt64(uint32_t field, uint64_t value) {
+        if (value != 0) writeVarintField(field, value);
+    }
+    void writeBool(uint32_t field, bool value) {
+        if (value) writeVarintField(field, 1);
+    }
+    void writeFloat(uint32_t field, float value) {
+        // Like protobuf, compare the bits so that -0.0 is written.
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        if (bits != 0) {
+            writeTag(field, kFixed32);
+            writeLittleEndian(bits, sizeof(bits));
+        }
+    }
+    void writeString(uint32_t field, std::string_view value) {
+        if (!value.empty()) writeBytes(field, value);
+    }
+
+    // Written even if 0, as for proto2 optional fields that are set.
+    void writeFixed64(uint32_t field, uint64_t value) {
+        writeTag(field, kFixed64);
+        writeLittleEndian(value, sizeof(value));
+    }
+
+    // Written even if empty, e.g. for map values or already serialized messages.
+    void writeBytes(uint32_t field, std::string_view value) {
+        writeTag(field, kLengthDelimited);
+        writeVarint(value.size());
+        mOut.append(value);
+    }
+
+    // Map entries hold their key and value even if they are the default.
+    void writeInt32BytesMapEntry(uint32_t field, int32_t key, std::string_view value) {
+        const size_t start = beginMessage(field);
+        writeVarintField(kMapKeyField, static_cast<uint64_t>(static_cast<int64_t>(key)));
+        writeBytes(kMapValueField, value);
+        endMessage(start);
+    }
+
+    template <typename Int32s>
+    void writePackedInt32(uint32_t field, const Int32s& values) {
+        if (values.empty()) return;
+        size_t size = 0;
+        for (int32_t value : values) {
+            size += varintSize(static_cast<uint64_t>(static_cast<int64_t>(value)));
+        }
+        writeTag(field, kLengthDelimited);
+        writeVarint(size);
+        for (int32_t value : values) {
+            writeVarint(static_cast<uint64_t>(static_cast<int64_t>(value)));
+        }
+    }
+
+    void writePackedFloat(uint32_t field, const float* values, size_t count) {
+        if (count == 0) return;
+        writeTag(field, kLengthDelimited);
+        writeVarint(count * sizeof(float));
+        for (size_t i = 0; i < count; i++) {
+            uint32_t bits;
+            memcpy(&bits, &values[i], sizeof(bits));
+            writeLittleEndian(bits, sizeof(bits));
+        }
+    }
+
+    // Starts a nested message, whose fields follow until endMessage is called with the returned
+    // offset. The length prefix is inserted then, which only moves the bytes of that message.
+    [[nodiscard]] size_t beginMessage(uint32_t field) {
+        writeTag(field, kLengthDelimited);
+        return mOut.size();
+    }
+    void endMessage(size_t start) {
+        char length[kMaxVarintSize];
+        const size_t lengthSize = encodeVarint(mOut.size() - start, length);
+        mOut.insert(start, length, lengthSize);
+    }
+
+private:
+    enum WireType : uint32_t { kVarint = 0, kFixed64 = 1, kLengthDelimited = 2, kFixed32 = 5 };
+    static constexpr size_t kMaxVarintSize = 10;
+    static constexpr uint32_t kMapKeyField = 1;
+    static constexpr uint32_t kMapValueField = 2;
+
+    static size_t encodeVarint(uint64_t value, char* out) {
+        size_t size = 0;
+        while (value >= 0x80) {
+            out[size++] = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        out[size++] = static_cast<char>(value);
+        return size;
+    }
+
+    static size_t varintSize(uint64_t value) {
+        size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    void writeVarint(uint64_t value) {
+        char bytes[kMaxVarintSize];
+        mOut.append(bytes, encodeVarint(value, bytes));
+    }
+
+    void writeTag(uint32_t field, WireType type) { writeVarint(field << 3 | type); }
+
+    void writeVarintField(uint32_t field, uint64_t value) {
+        writeTag(field, kVarint);
+        writeVarint(value);
+    }
+
+    void writeLittleEndian(uint64_t value, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            mOut.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    std::string& mOut;
+};
+
+} // namespace android::surfaceflinger
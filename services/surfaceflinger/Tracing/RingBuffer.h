@@ -18,11 +18,15 @@
 
 #include <android-base/file.h>
 #include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
 
 #include <log/log.h>
 #include <utils/Errors.h>
 #include <utils/Timers.h>
 #include <utils/Trace.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <chrono>
 #include <fstream>
 #include <queue>
@@ -56,35 +60,28 @@ public:
         }
     }
 
-    status_t writeToFile(FileProto& fileProto, std::string filename) {
+    status_t writeToFile(const FileProto& fileProto, std::string filename) {
         ATRACE_CALL();
-        writeToProto(fileProto);
-        std::string output;
-        if (!fileProto.SerializeToString(&output)) {
-            ALOGE("Could not serialize proto.");
-            return UNKNOWN_ERROR;
-        }
-
         // -rw-r--r--
         const mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
-        if (!android::base::WriteStringToFile(output, filename, mode, getuid(), getgid(), true)) {
+        base::unique_fd fd(TEMP_FAILURE_RETRY(
+                open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode)));
+        if (fd == -1 || fchmod(fd.get(), mode) == -1 ||
+            fchown(fd.get(), getuid(), getgid()) == -1) {
             ALOGE("Could not save the proto file %s", filename.c_str());
             return PERMISSION_DENIED;
         }
-        return NO_ERROR;
+        return writeEntries(fileProto, [&fd](const std::string& data) {
+            return base::WriteFully(fd.get(), data.data(), data.size());
+        });
     }
 
-    status_t appendToStream(FileProto& fileProto, std::ofstream& out) {
+    status_t appendToStream(const FileProto& fileProto, std::ofstream& out) {
         ATRACE_CALL();
-        writeToProto(fileProto);
-        std::string output;
-        if (!fileProto.SerializeToString(&output)) {
-            ALOGE("Could not serialize proto.");
-            return UNKNOWN_ERROR;
-        }
-
-        out << output;
-        return NO_ERROR;
+        return writeEntries(fileProto, [&out](const std::string& data) {
+            out.write(data.data(), static_cast<std::streamsize>(data.size()));
+            return out.good();
+        });
     }
 
     std::vector<std::string> emplace(std::string&& serializedProto) {
@@ -95,11 +92,11 @@ public:
                 return {};
             }
             mUsedInBytes -= static_cast<size_t>(mStorage.front().size());
-            replacedEntries.emplace_back(mStorage.front());
+            replacedEntries.emplace_back(std::move(mStorage.front()));
             mStorage.pop_front();
         }
         mUsedInBytes += protoSize;
-        mStorage.emplace_back(serializedProto);
+        mStorage.emplace_back(std::move(serializedProto));
         return replacedEntries;
     }
 
@@ -125,6 +122,49 @@ public:
     }
 
 private:
+    // Amount of serialized data collected before it is handed to the writer.
+    static constexpr size_t WRITE_CHUNK_SIZE = 64 * 1024;
+
+    static void appendVarint(std::string& output, uint64_t value) {
+        while (value >= 0x80) {
+            output.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        output.push_back(static_cast<char>(value));
+    }
+
+    // Writes fileProto followed by the buffered entries. The entries are already serialized, so
+    // rather than parsing them back into fileProto and serializing the whole trace again, they are
+    // appended as encoded repeated fields, which protobuf merges into fileProto when parsing.
+    template <typename Writer>
+    status_t writeEntries(const FileProto& fileProto, Writer&& writer) const {
+        std::string output;
+        if (!fileProto.SerializeToString(&output)) {
+            ALOGE("Could not serialize proto.");
+            return UNKNOWN_ERROR;
+        }
+
+        // Tag of a length-delimited entry field.
+        constexpr uint64_t entryTag = (uint64_t(FileProto::kEntryFieldNumber) << 3) | 2;
+        for (const std::string& entry : mStorage) {
+            if (output.size() >= WRITE_CHUNK_SIZE) {
+                if (!writer(output)) {
+                    ALOGE("Could not write proto.");
+                    return UNKNOWN_ERROR;
+                }
+                output.clear();
+            }
+            appendVarint(output, entryTag);
+            appendVarint(output, entry.size());
+            output.append(entry);
+        }
+        if (!writer(output)) {
+            ALOGE("Could not write proto.");
+            return UNKNOWN_ERROR;
+        }
+        return NO_ERROR;
+    }
+
     size_t mUsedInBytes = 0U;
     size_t mSizeInBytes = 0U;
     std::deque<std::string> mStorage;
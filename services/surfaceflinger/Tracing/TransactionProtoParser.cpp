@@ -79,6 +79,47 @@ proto::TransactionState TransactionProtoParser::toProto(const TransactionState&
     return proto;
 }
 
+TransactionState TransactionProtoParser::copyForTracing(const TransactionState& t) {
+    TransactionState copy;
+    copy.frameTimelineInfo = t.frameTimelineInfo;
+    copy.states = t.states;
+    copy.displays = t.displays;
+    copy.postTime = t.postTime;
+    copy.originPid = t.originPid;
+    copy.originUid = t.originUid;
+    copy.id = t.id;
+    copy.mergedTransactionIds = t.mergedTransactionIds;
+
+    for (auto& resolvedComposerState : copy.states) {
+        auto& layer = resolvedComposerState.state;
+        if (layer.what & layer_state_t::eBufferChanged) {
+            const auto& texture = resolvedComposerState.externalTexture;
+            auto bufferData = texture
+                    ? std::make_shared<fake::BufferData>(texture->getId(), texture->getWidth(),
+                                                         texture->getHeight(),
+                                                         texture->getPixelFormat(),
+                                                         texture->getUsage())
+                    : std::make_shared<fake::BufferData>(/*bufferId=*/0, /*width=*/0,
+                                                         /*height=*/0, /*pixelFormat=*/0,
+                                                         /*outUsage=*/0);
+            bufferData->frameNumber = layer.bufferData->frameNumber;
+            bufferData->flags = layer.bufferData->flags;
+            bufferData->cachedBuffer.id = layer.bufferData->cachedBuffer.id;
+            layer.bufferData = std::move(bufferData);
+        } else {
+            layer.bufferData = nullptr;
+        }
+        resolvedComposerState.externalTexture = nullptr;
+
+        // The main thread edits the handle it shares with the transaction.
+        if ((layer.what & layer_state_t::eInputInfoChanged) && layer.windowInfoHandle) {
+            layer.windowInfoHandle =
+                    sp<gui::WindowInfoHandle>::make(*layer.windowInfoHandle->getInfo());
+        }
+    }
+    return copy;
+}
+
 proto::TransactionState TransactionProtoParser::toProto(
         const std::map<uint32_t /* layerId */, TracingLayerState>& states) {
     proto::TransactionState proto;
@@ -158,6 +199,14 @@ proto::LayerState TransactionProtoParser::toProto(
             bufferProto->set_pixel_format(static_cast<proto::LayerState_BufferData_PixelFormat>(
                     resolvedComposerState.externalTexture->getPixelFormat()));
             bufferProto->set_usage(resolvedComposerState.externalTexture->getUsage());
+        } else if (layer.bufferData->hasBuffer()) {
+            // Copied by copyForTracing.
+            bufferProto->set_buffer_id(layer.bufferData->getId());
+            bufferProto->set_width(layer.bufferData->getWidth());
+            bufferProto->set_height(layer.bufferData->getHeight());
+            bufferProto->set_pixel_format(static_cast<proto::LayerState_BufferData_PixelFormat>(
+                    layer.bufferData->getPixelFormat()));
+            bufferProto->set_usage(layer.bufferData->getUsage());
         }
         bufferProto->set_frame_number(layer.bufferData->frameNumber);
         bufferProto->set_flags(layer.bufferData->flags.get());
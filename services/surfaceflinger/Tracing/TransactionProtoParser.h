@@ -45,6 +45,10 @@ public:
           : mMapper(std::move(provider)) {}
 
     proto::TransactionState toProto(const TransactionState&);
+    // Copies the parts of a transaction that toProto records, so that it can be converted later
+    // on another thread. Buffers are replaced with their properties, so that the copy does not
+    // keep them alive.
+    static TransactionState copyForTracing(const TransactionState&);
     proto::TransactionState toProto(const std::map<uint32_t /* layerId */, TracingLayerState>&);
     proto::LayerCreationArgs toProto(const LayerCreationArgs& args);
     proto::LayerState toProto(const ResolvedComposerState&);
@@ -89,8 +89,9 @@ void TransactionTracing::dump(std::string& result) const {
 }
 
 void TransactionTracing::addQueuedTransaction(const TransactionState& transaction) {
-    proto::TransactionState* state = new proto::TransactionState(mProtoParser.toProto(transaction));
-    mTransactionQueue.push(state);
+    ATRACE_CALL();
+    mTransactionQueue.push(
+            new TransactionState(TransactionProtoParser::copyForTracing(transaction)));
 }
 
 void TransactionTracing::addCommittedTransactions(int64_t vsyncId, nsecs_t commitTime,
@@ -155,8 +156,7 @@ void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committed
     proto::TransactionTraceEntry entryProto;
 
     while (auto incomingTransaction = mTransactionQueue.pop()) {
-        auto transaction = *incomingTransaction;
-        mQueuedTransactions[incomingTransaction->transaction_id()] = transaction;
+        mQueuedTransactions[incomingTransaction->id] = mProtoParser.toProto(*incomingTransaction);
         delete incomingTransaction;
     }
     for (const CommittedUpdates& update : committedUpdates) {
@@ -206,6 +206,7 @@ void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committed
         entryProto.SerializeToString(&serializedProto);
         entryProto.Clear();
         std::vector<std::string> entries = mBuffer.emplace(std::move(serializedProto));
+        mLastBufferedVsyncId = update.vsyncId;
         removedEntries.reserve(removedEntries.size() + entries.size());
         removedEntries.insert(removedEntries.end(), std::make_move_iterator(entries.begin()),
                               std::make_move_iterator(entries.end()));
@@ -236,12 +237,8 @@ void TransactionTracing::flush() {
     base::ScopedLockAssertion assumeLocked(mTraceLock);
     mTransactionsAddedToBufferCv.wait_for(lock, std::chrono::milliseconds(100),
                                           [&]() REQUIRES(mTraceLock) {
-                                              proto::TransactionTraceEntry entry;
-                                              if (mBuffer.used() > 0) {
-                                                  entry.ParseFromString(mBuffer.back());
-                                              }
                                               return mBuffer.used() > 0 &&
-                                                      entry.vsync_id() >= mLastUpdatedVsyncId;
+                                                      mLastBufferedVsyncId >= mLastUpdatedVsyncId;
                                           });
 }
 
@@ -43,8 +43,9 @@ class TransactionTracingTest;
 /*
  * Records all committed transactions into a ring bufffer.
  *
- * Transactions come in via the binder thread. They are serialized to proto
- * and stored in a map using the transaction id as key. Main thread will
+ * Transactions come in via the binder thread, which only copies them. The
+ * tracing thread serializes them to proto and stores them in a map using the
+ * transaction id as key. Main thread will
  * pass the list of transaction ids that are committed every vsync and notify
  * the tracing thread. The tracing thread will then wake up and add the
  * committed transactions to the ring buffer.
@@ -84,9 +85,12 @@ private:
     RingBuffer<proto::TransactionTraceFile, proto::TransactionTraceEntry> mBuffer
             GUARDED_BY(mTraceLock);
     size_t mBufferSizeInBytes GUARDED_BY(mTraceLock) = CONTINUOUS_TRACING_BUFFER_SIZE;
+    // Vsync id of the newest entry in mBuffer, so flush() does not have to parse it.
+    int64_t mLastBufferedVsyncId GUARDED_BY(mTraceLock) = -1;
     std::unordered_map<uint64_t, proto::TransactionState> mQueuedTransactions
             GUARDED_BY(mTraceLock);
-    LocklessStack<proto::TransactionState> mTransactionQueue;
+    // Copies made by TransactionProtoParser::copyForTracing, not yet serialized.
+    LocklessStack<TransactionState> mTransactionQueue;
     nsecs_t mStartingTimestamp GUARDED_BY(mTraceLock);
     std::unordered_map<int, proto::LayerCreationArgs> mCreatedLayers GUARDED_BY(mTraceLock);
     std::map<uint32_t /* layerId */, TracingLayerState> mStartingStates GUARDED_BY(mTraceLock);
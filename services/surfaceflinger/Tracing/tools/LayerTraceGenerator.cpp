@@ -23,10 +23,14 @@
 #include <log/log.h>
 #include <renderengine/ExternalTexture.h>
 #include <utils/String16.h>
+#include <utils/Timers.h>
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <ios>
 #include <string>
+#include <thread>
 #include <vector>
 #include "FrontEnd/LayerCreationArgs.h"
 #include "FrontEnd/RequestedLayerState.h"
@@ -40,55 +44,35 @@
 namespace android {
 using namespace ftl::flag_operators;
 
-bool LayerTraceGenerator::generate(const proto::TransactionTraceFile& traceFile,
-                                   const char* outputLayersTracePath, bool onlyLastEntry) {
-    if (traceFile.entry_size() == 0) {
-        ALOGD("Trace file is empty");
-        return false;
-    }
-
-    TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+namespace {
 
-    // frontend
-    frontend::LayerLifecycleManager lifecycleManager;
-    frontend::LayerHierarchyBuilder hierarchyBuilder{{}};
-    frontend::LayerSnapshotBuilder snapshotBuilder;
-    ui::DisplayMap<ui::LayerStack, frontend::DisplayInfo> displayInfos;
+struct ParsedEntry {
+    std::vector<std::unique_ptr<frontend::RequestedLayerState>> addedLayers;
+    std::vector<TransactionState> transactions;
+    std::vector<uint32_t> destroyedHandles;
+    bool displayChanged = false;
+};
 
-    renderengine::ShadowSettings globalShadowSettings{.ambientColor = {1, 1, 1, 1}};
-    char value[PROPERTY_VALUE_MAX];
-    property_get("ro.surface_flinger.supports_background_blur", value, "0");
-    bool supportsBlur = atoi(value);
-
-    LayerTracing layerTracing;
-    layerTracing.setTraceFlags(LayerTracing::TRACE_INPUT | LayerTracing::TRACE_BUFFERS);
-    // 10MB buffer size (large enough to hold a single entry)
-    layerTracing.setBufferSize(10 * 1024 * 1024);
-    layerTracing.enable();
-    layerTracing.writeToFile(outputLayersTracePath);
-    std::ofstream out(outputLayersTracePath, std::ios::binary | std::ios::app);
+// The front end of SurfaceFlinger, which the entries of the trace are applied to.
+class FrontEnd {
+public:
+    FrontEnd() {
+        char value[PROPERTY_VALUE_MAX];
+        property_get("ro.surface_flinger.supports_background_blur", value, "0");
+        mSupportsBlur = atoi(value);
+    }
 
-    ALOGD("Generating %d transactions...", traceFile.entry_size());
-    for (int i = 0; i < traceFile.entry_size(); i++) {
-        // parse proto
-        proto::TransactionTraceEntry entry = traceFile.entry(i);
-        ALOGV("    Entry %04d/%04d for time=%" PRId64 " vsyncid=%" PRId64
-              " layers +%d -%d handles -%d transactions=%d",
-              i, traceFile.entry_size(), entry.elapsed_realtime_nanos(), entry.vsync_id(),
-              entry.added_layers_size(), entry.destroyed_layers_size(),
-              entry.destroyed_layer_handles_size(), entry.transactions_size());
-
-        std::vector<std::unique_ptr<frontend::RequestedLayerState>> addedLayers;
-        addedLayers.reserve((size_t)entry.added_layers_size());
+    ParsedEntry parse(TransactionProtoParser& parser, const proto::TransactionTraceEntry& entry) {
+        ParsedEntry parsed;
+        parsed.addedLayers.reserve((size_t)entry.added_layers_size());
         for (int j = 0; j < entry.added_layers_size(); j++) {
             LayerCreationArgs args;
             parser.fromProto(entry.added_layers(j), args);
             ALOGV("       %s", args.getDebugString().c_str());
-            addedLayers.emplace_back(std::make_unique<frontend::RequestedLayerState>(args));
+            parsed.addedLayers.emplace_back(std::make_unique<frontend::RequestedLayerState>(args));
         }
 
-        std::vector<TransactionState> transactions;
-        transactions.reserve((size_t)entry.transactions_size());
+        parsed.transactions.reserve((size_t)entry.transactions_size());
         for (int j = 0; j < entry.transactions_size(); j++) {
             // apply transactions
             TransactionState transaction = parser.fromProto(entry.transactions(j));
@@ -102,62 +86,131 @@ bool LayerTraceGenerator::generate(const proto::TransactionTraceFile& traceFile,
                     }
                 }
             }
-            transactions.emplace_back(std::move(transaction));
+            parsed.transactions.emplace_back(std::move(transaction));
         }
 
         for (int j = 0; j < entry.destroyed_layers_size(); j++) {
             ALOGV("       destroyedHandles=%d", entry.destroyed_layers(j));
         }
 
-        std::vector<uint32_t> destroyedHandles;
-        destroyedHandles.reserve((size_t)entry.destroyed_layer_handles_size());
+        parsed.destroyedHandles.reserve((size_t)entry.destroyed_layer_handles_size());
         for (int j = 0; j < entry.destroyed_layer_handles_size(); j++) {
             ALOGV("       destroyedHandles=%d", entry.destroyed_layer_handles(j));
-            destroyedHandles.push_back(entry.destroyed_layer_handles(j));
+            parsed.destroyedHandles.push_back(entry.destroyed_layer_handles(j));
         }
 
-        bool displayChanged = entry.displays_changed();
-        if (displayChanged) {
-            parser.fromProto(entry.displays(), displayInfos);
+        parsed.displayChanged = entry.displays_changed();
+        if (parsed.displayChanged) {
+            parser.fromProto(entry.displays(), mDisplayInfos);
         }
+        return parsed;
+    }
 
+    // Applies an entry like the main thread of SurfaceFlinger commits it, and returns whether
+    // the visible regions need to be recomputed.
+    bool apply(ParsedEntry parsed) {
         // apply updates
-        lifecycleManager.addLayers(std::move(addedLayers));
-        lifecycleManager.applyTransactions(transactions, /*ignoreUnknownHandles=*/true);
-        lifecycleManager.onHandlesDestroyed(destroyedHandles, /*ignoreUnknownHandles=*/true);
+        mLifecycleManager.addLayers(std::move(parsed.addedLayers));
+        mLifecycleManager.applyTransactions(parsed.transactions, /*ignoreUnknownHandles=*/true);
+        mLifecycleManager.onHandlesDestroyed(parsed.destroyedHandles,
+                                             /*ignoreUnknownHandles=*/true);
 
-        if (lifecycleManager.getGlobalChanges().test(
+        if (mLifecycleManager.getGlobalChanges().test(
                     frontend::RequestedLayerState::Changes::Hierarchy)) {
-            hierarchyBuilder.update(lifecycleManager.getLayers(),
-                                    lifecycleManager.getDestroyedLayers());
+            mHierarchyBuilder.update(mLifecycleManager.getLayers(),
+                                     mLifecycleManager.getDestroyedLayers());
         }
 
-        frontend::LayerSnapshotBuilder::Args args{.root = hierarchyBuilder.getHierarchy(),
-                                                  .layerLifecycleManager = lifecycleManager,
-                                                  .displays = displayInfos,
-                                                  .displayChanges = displayChanged,
-                                                  .globalShadowSettings = globalShadowSettings,
-                                                  .supportsBlur = supportsBlur,
+        frontend::LayerSnapshotBuilder::Args args{.root = mHierarchyBuilder.getHierarchy(),
+                                                  .layerLifecycleManager = mLifecycleManager,
+                                                  .displays = mDisplayInfos,
+                                                  .displayChanges = parsed.displayChanged,
+                                                  .globalShadowSettings = mGlobalShadowSettings,
+                                                  .supportsBlur = mSupportsBlur,
                                                   .forceFullDamage = false,
                                                   .supportedLayerGenericMetadata = {},
                                                   .genericLayerMetadataKeyMap = {}};
-        snapshotBuilder.update(args);
+        mSnapshotBuilder.update(args);
 
-        bool visibleRegionsDirty = lifecycleManager.getGlobalChanges().any(
+        bool visibleRegionsDirty = mLifecycleManager.getGlobalChanges().any(
                 frontend::RequestedLayerState::Changes::VisibleRegion |
                 frontend::RequestedLayerState::Changes::Hierarchy |
                 frontend::RequestedLayerState::Changes::Visibility);
 
-        ALOGV("    layers:%04zu snapshots:%04zu changes:%s", lifecycleManager.getLayers().size(),
-              snapshotBuilder.getSnapshots().size(),
-              lifecycleManager.getGlobalChanges().string().c_str());
+        ALOGV("    layers:%04zu snapshots:%04zu changes:%s", mLifecycleManager.getLayers().size(),
+              mSnapshotBuilder.getSnapshots().size(),
+              mLifecycleManager.getGlobalChanges().string().c_str());
+
+        mLifecycleManager.commitChanges();
+        return visibleRegionsDirty;
+    }
+
+    size_t getLayerCount() const { return mLifecycleManager.getLayers().size(); }
+    size_t getSnapshotCount() const { return mSnapshotBuilder.getSnapshots().size(); }
 
-        lifecycleManager.commitChanges();
+    LayersProto generateLayersProto(uint32_t traceFlags) const {
+        return LayerProtoFromSnapshotGenerator(mSnapshotBuilder, mDisplayInfos, {}, traceFlags)
+                .generate(mHierarchyBuilder.getHierarchy());
+    }
+
+    auto generateDisplayProtos() const {
+        return LayerProtoHelper::writeDisplayInfoToProto(mDisplayInfos);
+    }
 
-        LayersProto layersProto = LayerProtoFromSnapshotGenerator(snapshotBuilder, displayInfos, {},
-                                                                  layerTracing.getFlags())
-                                          .generate(hierarchyBuilder.getHierarchy());
-        auto displayProtos = LayerProtoHelper::writeDisplayInfoToProto(displayInfos);
+private:
+    frontend::LayerLifecycleManager mLifecycleManager;
+    frontend::LayerHierarchyBuilder mHierarchyBuilder{{}};
+    frontend::LayerSnapshotBuilder mSnapshotBuilder;
+    ui::DisplayMap<ui::LayerStack, frontend::DisplayInfo> mDisplayInfos;
+    renderengine::ShadowSettings mGlobalShadowSettings{.ambientColor = {1, 1, 1, 1}};
+    bool mSupportsBlur = false;
+};
+
+void logEntry(const proto::TransactionTraceFile& traceFile, int i,
+              const proto::TransactionTraceEntry& entry) {
+    ALOGV("    Entry %04d/%04d for time=%" PRId64 " vsyncid=%" PRId64
+          " layers +%d -%d handles -%d transactions=%d",
+          i, traceFile.entry_size(), entry.elapsed_realtime_nanos(), entry.vsync_id(),
+          entry.added_layers_size(), entry.destroyed_layers_size(),
+          entry.destroyed_layer_handles_size(), entry.transactions_size());
+}
+
+nsecs_t percentile(std::vector<nsecs_t> durations, size_t percent) {
+    const size_t index = std::min(durations.size() - 1, durations.size() * percent / 100);
+    std::nth_element(durations.begin(), durations.begin() + (ssize_t)index, durations.end());
+    return durations[index];
+}
+
+} // namespace
+
+bool LayerTraceGenerator::generate(const proto::TransactionTraceFile& traceFile,
+                                   const char* outputLayersTracePath, bool onlyLastEntry) {
+    if (traceFile.entry_size() == 0) {
+        ALOGD("Trace file is empty");
+        return false;
+    }
+
+    TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+    FrontEnd frontEnd;
+
+    LayerTracing layerTracing;
+    layerTracing.setTraceFlags(LayerTracing::TRACE_INPUT | LayerTracing::TRACE_BUFFERS);
+    // 10MB buffer size (large enough to hold a single entry)
+    layerTracing.setBufferSize(10 * 1024 * 1024);
+    layerTracing.enable();
+    layerTracing.writeToFile(outputLayersTracePath);
+    std::ofstream out(outputLayersTracePath, std::ios::binary | std::ios::app);
+
+    ALOGD("Generating %d transactions...", traceFile.entry_size());
+    for (int i = 0; i < traceFile.entry_size(); i++) {
+        // parse proto
+        proto::TransactionTraceEntry entry = traceFile.entry(i);
+        logEntry(traceFile, i, entry);
+
+        const bool visibleRegionsDirty = frontEnd.apply(frontEnd.parse(parser, entry));
+
+        LayersProto layersProto = frontEnd.generateLayersProto(layerTracing.getFlags());
+        auto displayProtos = frontEnd.generateDisplayProtos();
         if (!onlyLastEntry || (i == traceFile.entry_size() - 1)) {
             layerTracing.notify(visibleRegionsDirty, entry.elapsed_realtime_nanos(),
                                 entry.vsync_id(), &layersProto, {}, &displayProtos);
@@ -170,4 +223,64 @@ bool LayerTraceGenerator::generate(const proto::TransactionTraceFile& traceFile,
     return true;
 }
 
+bool LayerTraceGenerator::benchmark(const proto::TransactionTraceFile& traceFile,
+                                    const BenchmarkArgs& benchmarkArgs, std::ostream& out,
+                                    BenchmarkSummary* outSummary) {
+    if (traceFile.entry_size() == 0) {
+        ALOGD("Trace file is empty");
+        return false;
+    }
+
+    TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+    FrontEnd frontEnd;
+    std::vector<nsecs_t> durations;
+    durations.reserve((size_t)traceFile.entry_size());
+
+    out << "vsync_id,elapsed_realtime_nanos,main_thread_ns,visible_regions_dirty,layers,snapshots"
+        << std::endl;
+
+    ALOGD("Replaying %d transactions...", traceFile.entry_size());
+    auto nextFrame = std::chrono::steady_clock::now();
+    for (int i = 0; i < traceFile.entry_size(); i++) {
+        const proto::TransactionTraceEntry& entry = traceFile.entry(i);
+        logEntry(traceFile, i, entry);
+
+        // Only applying the entry is measured, since SurfaceFlinger receives the transactions
+        // already unparceled.
+        ParsedEntry parsed = frontEnd.parse(parser, entry);
+        if (benchmarkArgs.vsyncPeriod > 0) {
+            std::this_thread::sleep_until(nextFrame);
+            nextFrame += std::chrono::nanoseconds(benchmarkArgs.vsyncPeriod);
+        }
+
+        const nsecs_t start = systemTime(SYSTEM_TIME_THREAD);
+        const bool visibleRegionsDirty = frontEnd.apply(std::move(parsed));
+        const nsecs_t duration = systemTime(SYSTEM_TIME_THREAD) - start;
+        durations.push_back(duration);
+
+        out << entry.vsync_id() << ',' << entry.elapsed_realtime_nanos() << ',' << duration << ','
+            << visibleRegionsDirty << ',' << frontEnd.getLayerCount() << ','
+            << frontEnd.getSnapshotCount() << '\n';
+    }
+    out.flush();
+
+    nsecs_t total = 0;
+    for (nsecs_t duration : durations) {
+        total += duration;
+    }
+    BenchmarkSummary summary{.frames = durations.size(),
+                             .mean = total / (nsecs_t)durations.size(),
+                             .p50 = percentile(durations, 50),
+                             .p90 = percentile(durations, 90),
+                             .p99 = percentile(durations, 99),
+                             .max = *std::max_element(durations.begin(), durations.end())};
+    ALOGD("Replayed %zu frames: mean=%" PRId64 "ns p50=%" PRId64 "ns p90=%" PRId64
+          "ns p99=%" PRId64 "ns max=%" PRId64 "ns",
+          summary.frames, summary.mean, summary.p50, summary.p90, summary.p99, summary.max);
+    if (outSummary) {
+        *outSummary = summary;
+    }
+    return true;
+}
+
 } // namespace android
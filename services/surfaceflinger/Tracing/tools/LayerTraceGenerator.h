@@ -17,11 +17,36 @@
 #pragma once
 
 #include <Tracing/TransactionTracing.h>
+#include <utils/Timers.h>
+
+#include <ostream>
 
 namespace android {
 class LayerTraceGenerator {
 public:
     bool generate(const proto::TransactionTraceFile&, const char* outputLayersTracePath,
                   bool onlyLastEntry);
+
+    struct BenchmarkArgs {
+        // Applies an entry every period, or every entry as soon as the previous one was applied
+        // if 0.
+        nsecs_t vsyncPeriod = 0;
+    };
+
+    // Per frame main thread time, i.e. the thread CPU time spent applying the entry to the
+    // front end.
+    struct BenchmarkSummary {
+        size_t frames = 0;
+        nsecs_t mean = 0;
+        nsecs_t p50 = 0;
+        nsecs_t p90 = 0;
+        nsecs_t p99 = 0;
+        nsecs_t max = 0;
+    };
+
+    // Replays the entries of the trace through the front end like generate, without writing
+    // layer traces, and writes the main thread time of every frame as CSV to out.
+    bool benchmark(const proto::TransactionTraceFile&, const BenchmarkArgs&, std::ostream& out,
+                   BenchmarkSummary* outSummary);
 };
 } // namespace android
\ No newline at end of file
@@ -17,18 +17,78 @@
 #undef LOG_TAG
 #define LOG_TAG "LayerTraceGenerator"
 
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <string_view>
 
 #include "LayerTraceGenerator.h"
 
 using namespace android;
 
+namespace {
+
+// Usage: layertracegenerator --benchmark [transaction-trace-path] [output-csv-path]
+//                            [--vsync-period-ns=<period>]
+int benchmark(int argc, char** argv) {
+    const char* transactionTracePath =
+            (argc > 2) ? argv[2] : "/data/misc/wmtrace/transactions_trace.winscope";
+    const char* outputPath = (argc > 3) ? argv[3] : "/data/misc/wmtrace/frontend_benchmark.csv";
+
+    LayerTraceGenerator::BenchmarkArgs benchmarkArgs;
+    constexpr std::string_view kVsyncPeriodArg = "--vsync-period-ns=";
+    if (argc > 4) {
+        const std::string_view arg(argv[4]);
+        if (arg.substr(0, kVsyncPeriodArg.size()) != kVsyncPeriodArg) {
+            std::cout << "Error: Unknown argument " << arg << "\n";
+            return -1;
+        }
+        benchmarkArgs.vsyncPeriod = std::atoll(argv[4] + kVsyncPeriodArg.size());
+    }
+
+    std::fstream input(transactionTracePath, std::ios::in | std::ios::binary);
+    if (!input) {
+        std::cout << "Error: Could not open " << transactionTracePath;
+        return -1;
+    }
+    proto::TransactionTraceFile transactionTraceFile;
+    if (!transactionTraceFile.ParseFromIstream(&input)) {
+        std::cout << "Error: Failed to parse " << transactionTracePath;
+        return -1;
+    }
+
+    std::ofstream out(outputPath);
+    if (!out) {
+        std::cout << "Error: Could not open " << outputPath;
+        return -1;
+    }
+
+    LayerTraceGenerator::BenchmarkSummary summary;
+    if (!LayerTraceGenerator().benchmark(transactionTraceFile, benchmarkArgs, out, &summary)) {
+        std::cout << "Error: Failed to replay " << transactionTracePath;
+        return -1;
+    }
+    std::cout << "Replayed " << summary.frames << " frames, main thread time (ns): mean "
+              << summary.mean << " p50 " << summary.p50 << " p90 " << summary.p90 << " p99 "
+              << summary.p99 << " max " << summary.max << "\n";
+    std::cout << "Per frame results written to " << outputPath << "\n";
+    return 0;
+}
+
+} // namespace
+
 int main(int argc, char** argv) {
+    if (argc > 1 && std::string_view(argv[1]) == "--benchmark") {
+        return benchmark(argc, argv);
+    }
+
     if (argc > 4) {
         std::cout << "Usage: " << argv[0]
-                  << " [transaction-trace-path] [output-layers-trace-path] [--last-entry-only]\n";
+                  << " [transaction-trace-path] [output-layers-trace-path] [--last-entry-only]\n"
+                  << "       " << argv[0]
+                  << " --benchmark [transaction-trace-path] [output-csv-path]"
+                     " [--vsync-period-ns=<period>]\n";
         return -1;
     }
 
@@ -27,9 +27,11 @@
 #include "BackgroundExecutor.h"
 
 #include <cinttypes>
+#include <iterator>
 
 #include <binder/IInterface.h>
 #include <utils/RefBase.h>
+#include <utils/Trace.h>
 
 namespace android {
 
@@ -50,6 +52,126 @@ static bool containsOnCommitCallbacks(const std::vector<CallbackId>& callbacks)
     return !callbacks.empty() && callbacks.front().type == CallbackId::Type::ON_COMMIT;
 }
 
+// Queues of completed transactions per listener. A listener has at most one task queued or running
+// to send its transactions, which takes all that are queued when it runs.
+class TransactionCallbackInvoker::Deliveries
+      : public std::enable_shared_from_this<TransactionCallbackInvoker::Deliveries> {
+public:
+    void enqueue(const sp<IBinder>& listener,
+                 std::deque<PendingTransactionStats>&& transactions) {
+        bool schedule;
+        {
+            std::scoped_lock lock(mMutex);
+            auto [it, inserted] = mQueues.try_emplace(listener);
+            auto& queue = it->second;
+            std::move(transactions.begin(), transactions.end(), std::back_inserter(queue));
+            // The entry exists for as long as a task is queued or running for the listener.
+            schedule = inserted;
+        }
+        if (schedule) {
+            BackgroundExecutor::getInstance().sendUnorderedCallbacks(
+                    {[self = shared_from_this(), listener]() { self->drain(listener); }},
+                    BackgroundExecutor::Priority::LatencyCritical);
+        }
+    }
+
+private:
+    void drain(const sp<IBinder>& listener) {
+        std::deque<PendingTransactionStats> transactions;
+        while (true) {
+            {
+                std::scoped_lock lock(mMutex);
+                auto it = mQueues.find(listener);
+                if (it->second.empty()) {
+                    mQueues.erase(it);
+                    return;
+                }
+                transactions = std::move(it->second);
+                it->second.clear();
+            }
+            send(listener, std::move(transactions));
+            transactions.clear();
+        }
+    }
+
+    static void send(const sp<IBinder>& listener,
+                     std::deque<PendingTransactionStats>&& transactions) {
+        ATRACE_CALL();
+        // The listener stored in listenerStats comes from the cross-process setTransactionState
+        // call to SF. This MUST be an ITransactionCompletedListener. We keep it as an IBinder due
+        // to consistency reasons: if we interface_cast at the IPC boundary when reading a Parcel,
+        // we get pointers that compare unequal in the SF process.
+        if (!listener->isBinderAlive()) {
+            return;
+        }
+
+        ListenerStats listenerStats;
+        listenerStats.listener = listener;
+        listenerStats.transactionStats.reserve(transactions.size());
+        for (auto& pending : transactions) {
+            TransactionStats& transactionStats =
+                    listenerStats.transactionStats.emplace_back(pending.callbackIds);
+            transactionStats.latchTime = pending.latchTime;
+            transactionStats.presentFence = std::move(pending.presentFence);
+            transactionStats.surfaceStats.reserve(pending.surfaceStats.size());
+            for (const auto& surface : pending.surfaceStats) {
+                transactionStats.surfaceStats.push_back(makeSurfaceStats(surface));
+            }
+        }
+        interface_cast<ITransactionCompletedListener>(listener)->onTransactionCompleted(
+                std::move(listenerStats));
+    }
+
+    static SurfaceStats makeSurfaceStats(const PendingSurfaceStats& surface) {
+        const CallbackHandle& handle = *surface.handle;
+        sp<Fence> prevFence = nullptr;
+
+        for (const auto& future : handle.previousReleaseFences) {
+            sp<Fence> currentFence = future.get().value_or(Fence::NO_FENCE);
+            if (prevFence == nullptr && currentFence->getStatus() != Fence::Status::Invalid) {
+                prevFence = std::move(currentFence);
+            } else if (prevFence != nullptr) {
+                // If both fences are signaled or both are unsignaled, we need to merge
+                // them to get an accurate timestamp.
+                if (prevFence->getStatus() != Fence::Status::Invalid &&
+                    prevFence->getStatus() == currentFence->getStatus()) {
+                    char fenceName[32] = {};
+                    snprintf(fenceName, 32, "%.28s", handle.name.c_str());
+                    sp<Fence> mergedFence = Fence::merge(fenceName, prevFence, currentFence);
+                    if (mergedFence->isValid()) {
+                        prevFence = std::move(mergedFence);
+                    }
+                } else if (currentFence->getStatus() == Fence::Status::Unsignaled) {
+                    // If one fence has signaled and the other hasn't, the unsignaled
+                    // fence will approximately correspond with the correct timestamp.
+                    // There's a small race if both fences signal at about the same time
+                    // and their statuses are retrieved with unfortunate timing. However,
+                    // by this point, they will have both signaled and only the timestamp
+                    // will be slightly off; any dependencies after this point will
+                    // already have been met.
+                    prevFence = std::move(currentFence);
+                }
+            }
+        }
+
+        FrameEventHistoryStats eventStats(handle.frameNumber, handle.previousFrameNumber,
+                                          handle.gpuCompositionDoneFence->getSnapshot().fence,
+                                          handle.compositorTiming, handle.refreshStartTime,
+                                          handle.dequeueReadyTime);
+        return SurfaceStats(surface.surfaceControl, handle.acquireTimeOrFence, prevFence,
+                            handle.transformHint, handle.currentMaxAcquiredBufferCount, eventStats,
+                            surface.jankData ? *surface.jankData : std::vector<JankData>(),
+                            handle.previousReleaseCallbackId);
+    }
+
+    std::mutex mMutex;
+    std::unordered_map<sp<IBinder>, std::deque<PendingTransactionStats>, IListenerHash> mQueues
+            GUARDED_BY(mMutex);
+};
+
+TransactionCallbackInvoker::TransactionCallbackInvoker()
+      : mDeliveries(std::make_shared<Deliveries>()) {}
+
 void TransactionCallbackInvoker::addEmptyTransaction(const ListenerCallbacks& listenerCallbacks) {
     auto& [listener, callbackIds] = listenerCallbacks;
     auto& transactionStatsDeque = mCompletedTransactions[listener];
@@ -62,13 +184,12 @@ status_t TransactionCallbackInvoker::addOnCommitCallbackHandles(
     if (handles.empty()) {
         return NO_ERROR;
     }
-    const std::vector<JankData>& jankData = std::vector<JankData>();
     for (const auto& handle : handles) {
         if (!containsOnCommitCallbacks(handle->callbackIds)) {
             outRemainingHandles.push_back(handle);
             continue;
         }
-        status_t err = addCallbackHandle(handle, jankData);
+        status_t err = addCallbackHandle(handle, nullptr);
         if (err != NO_ERROR) {
             return err;
         }
@@ -82,8 +203,11 @@ status_t TransactionCallbackInvoker::addCallbackHandles(
     if (handles.empty()) {
         return NO_ERROR;
     }
+    // Shared by the handles, and only copied into each SurfaceStats in the background.
+    const auto sharedJankData =
+            jankData.empty() ? nullptr : std::make_shared<const std::vector<JankData>>(jankData);
     for (const auto& handle : handles) {
-        status_t err = addCallbackHandle(handle, jankData);
+        status_t err = addCallbackHandle(handle, sharedJankData);
         if (err != NO_ERROR) {
             return err;
         }
@@ -92,82 +216,42 @@ status_t TransactionCallbackInvoker::addCallbackHandles(
     return NO_ERROR;
 }
 
-status_t TransactionCallbackInvoker::findOrCreateTransactionStats(
-        const sp<IBinder>& listener, const std::vector<CallbackId>& callbackIds,
-        TransactionStats** outTransactionStats) {
+TransactionCallbackInvoker::PendingTransactionStats&
+TransactionCallbackInvoker::findOrCreateTransactionStats(
+        const sp<IBinder>& listener, const std::vector<CallbackId>& callbackIds) {
     auto& transactionStatsDeque = mCompletedTransactions[listener];
 
     // Search back to front because the most recent transactions are at the back of the deque
     auto itr = transactionStatsDeque.rbegin();
     for (; itr != transactionStatsDeque.rend(); itr++) {
         if (compareCallbackIds(itr->callbackIds, callbackIds) == 0) {
-            *outTransactionStats = &(*itr);
-            return NO_ERROR;
+            return *itr;
         }
     }
-    *outTransactionStats = &transactionStatsDeque.emplace_back(callbackIds);
-    return NO_ERROR;
+    return transactionStatsDeque.emplace_back(callbackIds);
 }
 
 status_t TransactionCallbackInvoker::addCallbackHandle(const sp<CallbackHandle>& handle,
         const std::vector<JankData>& jankData) {
-    // If we can't find the transaction stats something has gone wrong. The client should call
-    // startRegistration before trying to add a callback handle.
-    TransactionStats* transactionStats;
-    status_t err =
-            findOrCreateTransactionStats(handle->listener, handle->callbackIds, &transactionStats);
-    if (err != NO_ERROR) {
-        return err;
-    }
+    return addCallbackHandle(handle,
+                             jankData.empty()
+                                     ? nullptr
+                                     : std::make_shared<const std::vector<JankData>>(jankData));
+}
+
+status_t TransactionCallbackInvoker::addCallbackHandle(
+        const sp<CallbackHandle>& handle,
+        const std::shared_ptr<const std::vector<JankData>>& jankData) {
+    PendingTransactionStats& transactionStats =
+            findOrCreateTransactionStats(handle->listener, handle->callbackIds);
 
-    transactionStats->latchTime = handle->latchTime;
+    transactionStats.latchTime = handle->latchTime;
     // If the layer has already been destroyed, don't add the SurfaceControl to the callback.
     // The client side keeps a sp<> to the SurfaceControl so if the SurfaceControl has been
     // destroyed the client side is dead and there won't be anyone to send the callback to.
     sp<IBinder> surfaceControl = handle->surfaceControl.promote();
     if (surfaceControl) {
-        sp<Fence> prevFence = nullptr;
-
-        for (const auto& future : handle->previousReleaseFences) {
-            sp<Fence> currentFence = future.get().value_or(Fence::NO_FENCE);
-            if (prevFence == nullptr && currentFence->getStatus() != Fence::Status::Invalid) {
-                prevFence = std::move(currentFence);
-            } else if (prevFence != nullptr) {
-                // If both fences are signaled or both are unsignaled, we need to merge
-                // them to get an accurate timestamp.
-                if (prevFence->getStatus() != Fence::Status::Invalid &&
-                    prevFence->getStatus() == currentFence->getStatus()) {
-                    char fenceName[32] = {};
-                    snprintf(fenceName, 32, "%.28s", handle->name.c_str());
-                    sp<Fence> mergedFence = Fence::merge(fenceName, prevFence, currentFence);
-                    if (mergedFence->isValid()) {
-                        prevFence = std::move(mergedFence);
-                    }
-                } else if (currentFence->getStatus() == Fence::Status::Unsignaled) {
-                    // If one fence has signaled and the other hasn't, the unsignaled
-                    // fence will approximately correspond with the correct timestamp.
-                    // There's a small race if both fences signal at about the same time
-                    // and their statuses are retrieved with unfortunate timing. However,
-                    // by this point, they will have both signaled and only the timestamp
-                    // will be slightly off; any dependencies after this point will
-                    // already have been met.
-                    prevFence = std::move(currentFence);
-                }
-            }
-        }
-        handle->previousReleaseFence = prevFence;
-        handle->previousReleaseFences.clear();
-
-        FrameEventHistoryStats eventStats(handle->frameNumber, handle->previousFrameNumber,
-                                          handle->gpuCompositionDoneFence->getSnapshot().fence,
-                                          handle->compositorTiming, handle->refreshStartTime,
-                                          handle->dequeueReadyTime);
-        transactionStats->surfaceStats.emplace_back(surfaceControl, handle->acquireTimeOrFence,
-                                                    handle->previousReleaseFence,
-                                                    handle->transformHint,
-                                                    handle->currentMaxAcquiredBufferCount,
-                                                    eventStats, jankData,
-                                                    handle->previousReleaseCallbackId);
+        transactionStats.surfaceStats.push_back({handle, std::move(surfaceControl), jankData});
     }
     return NO_ERROR;
 }
@@ -178,12 +262,8 @@ void TransactionCallbackInvoker::addPresentFence(sp<Fence> presentFence) {
 
 void TransactionCallbackInvoker::sendCallbacks(bool onCommitOnly) {
     // For each listener
-    auto completedTransactionsItr = mCompletedTransactions.begin();
-    BackgroundExecutor::Callbacks callbacks;
-    while (completedTransactionsItr != mCompletedTransactions.end()) {
-        auto& [listener, transactionStatsDeque] = *completedTransactionsItr;
-        ListenerStats listenerStats;
-        listenerStats.listener = listener;
+    for (auto& [listener, transactionStatsDeque] : mCompletedTransactions) {
+        std::deque<PendingTransactionStats> transactions;
 
         // For each transaction
         auto transactionStatsItr = transactionStatsDeque.begin();
@@ -201,33 +281,18 @@ void TransactionCallbackInvoker::sendCallbacks(bool onCommitOnly) {
             }
 
             // Remove the transaction from completed to the callback
-            listenerStats.transactionStats.push_back(std::move(transactionStats));
+            transactions.push_back(std::move(transactionStats));
             transactionStatsItr = transactionStatsDeque.erase(transactionStatsItr);
         }
         // If the listener has completed transactions
-        if (!listenerStats.transactionStats.empty()) {
-            // If the listener is still alive
-            if (listener->isBinderAlive()) {
-                // Send callback.  The listener stored in listenerStats
-                // comes from the cross-process setTransactionState call to
-                // SF.  This MUST be an ITransactionCompletedListener.  We
-                // keep it as an IBinder due to consistency reasons: if we
-                // interface_cast at the IPC boundary when reading a Parcel,
-                // we get pointers that compare unequal in the SF process.
-                callbacks.emplace_back([stats = std::move(listenerStats)]() {
-                    interface_cast<ITransactionCompletedListener>(stats.listener)
-                            ->onTransactionCompleted(stats);
-                });
-            }
+        if (!transactions.empty()) {
+            mDeliveries->enqueue(listener, std::move(transactions));
         }
-        completedTransactionsItr++;
     }
 
     if (mPresentFence) {
         mPresentFence.clear();
     }
-
-    BackgroundExecutor::getInstance().sendCallbacks(std::move(callbacks));
 }
 
 // -----------------------------------------------------------------------
@@ -18,6 +18,7 @@
 
 #include <condition_variable>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <queue>
@@ -45,7 +46,6 @@ public:
 
     bool releasePreviousBuffer = false;
     std::string name;
-    sp<Fence> previousReleaseFence;
     std::vector<ftl::SharedFuture<FenceResult>> previousReleaseFences;
     std::variant<nsecs_t, sp<Fence>> acquireTimeOrFence = -1;
     nsecs_t latchTime = -1;
@@ -62,6 +62,8 @@ public:
 
 class TransactionCallbackInvoker {
 public:
+    TransactionCallbackInvoker();
+
     status_t addCallbackHandles(const std::deque<sp<CallbackHandle>>& handles,
                                 const std::vector<JankData>& jankData);
     status_t addOnCommitCallbackHandles(const std::deque<sp<CallbackHandle>>& handles,
@@ -71,6 +73,10 @@ public:
 
     void addPresentFence(sp<Fence>);
 
+    // Hands the completed transactions over to be sent in the background. The ListenerStats are
+    // built there, since that waits for release fences. Listeners are sent to in parallel, each in
+    // the order of its transactions, and a listener's transactions are coalesced into one callback
+    // while an earlier callback to it is still being sent.
     void sendCallbacks(bool onCommitOnly);
     void clearCompletedTransactions() {
         mCompletedTransactions.clear();
@@ -81,14 +87,40 @@ public:
 
 
 private:
-    status_t findOrCreateTransactionStats(const sp<IBinder>& listener,
-                                          const std::vector<CallbackId>& callbackIds,
-                                          TransactionStats** outTransactionStats);
+    // A surface's part in a completed transaction, as recorded on the main thread. The handle is
+    // not modified once it has been added.
+    struct PendingSurfaceStats {
+        sp<CallbackHandle> handle;
+        sp<IBinder> surfaceControl;
+        std::shared_ptr<const std::vector<JankData>> jankData;
+    };
+
+    // Immutable once handed over by sendCallbacks.
+    struct PendingTransactionStats {
+        explicit PendingTransactionStats(std::vector<CallbackId> ids)
+              : callbackIds(std::move(ids)) {}
+
+        std::vector<CallbackId> callbackIds;
+        nsecs_t latchTime = -1;
+        sp<Fence> presentFence;
+        std::vector<PendingSurfaceStats> surfaceStats;
+    };
+
+    class Deliveries;
+
+    status_t addCallbackHandle(const sp<CallbackHandle>& handle,
+                               const std::shared_ptr<const std::vector<JankData>>& jankData);
 
-    std::unordered_map<sp<IBinder>, std::deque<TransactionStats>, IListenerHash>
+    PendingTransactionStats& findOrCreateTransactionStats(
+            const sp<IBinder>& listener, const std::vector<CallbackId>& callbackIds);
+
+    std::unordered_map<sp<IBinder>, std::deque<PendingTransactionStats>, IListenerHash>
         mCompletedTransactions;
 
     sp<Fence> mPresentFence;
+
+    // Shared with the background tasks, which may outlive this.
+    const std::shared_ptr<Deliveries> mDeliveries;
 };
 
 } // namespace android
@@ -52,7 +52,7 @@ struct TransactionState {
     TransactionState(const FrameTimelineInfo& frameTimelineInfo,
                      std::vector<ResolvedComposerState>& composerStates,
                      const Vector<DisplayState>& displayStates, uint32_t transactionFlags,
-                     const sp<IBinder>& applyToken, const InputWindowCommands& inputWindowCommands,
+                     const sp<IBinder>& applyToken, InputWindowCommands inputWindowCommands,
                      int64_t desiredPresentTime, bool isAutoTimestamp,
                      std::vector<uint64_t> uncacheBufferIds, int64_t postTime,
                      bool hasListenerCallbacks, std::vector<ListenerCallbacks> listenerCallbacks,
@@ -63,13 +63,13 @@ struct TransactionState {
             displays(displayStates),
             flags(transactionFlags),
             applyToken(applyToken),
-            inputWindowCommands(inputWindowCommands),
+            inputWindowCommands(std::move(inputWindowCommands)),
             desiredPresentTime(desiredPresentTime),
             isAutoTimestamp(isAutoTimestamp),
             uncacheBufferIds(std::move(uncacheBufferIds)),
             postTime(postTime),
             hasListenerCallbacks(hasListenerCallbacks),
-            listenerCallbacks(listenerCallbacks),
+            listenerCallbacks(std::move(listenerCallbacks)),
             originPid(originPid),
             originUid(originUid),
             id(transactionId),
@@ -47,6 +47,7 @@ void WindowInfosListenerInvoker::addWindowInfosListener(sp<IWindowInfosListener>
                 asBinder->linkToDeath(sp<DeathRecipient>::fromExisting(this));
                 mWindowInfosListeners.try_emplace(asBinder,
                                                   std::make_pair(listenerId, std::move(listener)));
+                mListenersNeedingKeyframe.insert(listenerId);
             }});
 }
 
@@ -56,6 +57,9 @@ void WindowInfosListenerInvoker::removeWindowInfosListener(
         ATRACE_NAME("WindowInfosListenerInvoker::removeWindowInfosListener");
         sp<IBinder> asBinder = IInterface::asBinder(listener);
         asBinder->unlinkToDeath(sp<DeathRecipient>::fromExisting(this));
+        if (auto it = mWindowInfosListeners.find(asBinder); it != mWindowInfosListeners.end()) {
+            mListenersNeedingKeyframe.erase(it->second.first);
+        }
         mWindowInfosListeners.erase(asBinder);
     }});
 }
@@ -66,6 +70,7 @@ void WindowInfosListenerInvoker::binderDied(const wp<IBinder>& who) {
         auto it = mWindowInfosListeners.find(who);
         int64_t listenerId = it->second.first;
         mWindowInfosListeners.erase(who);
+        mListenersNeedingKeyframe.erase(listenerId);
 
         std::vector<int64_t> vsyncIds;
         for (auto& [vsyncId, state] : mUnackedState) {
@@ -129,14 +134,32 @@ void WindowInfosListenerInvoker::windowInfosChanged(
     mDelayInfo.reset();
     updateMaxSendDelay();
 
+    std::optional<gui::WindowInfosUpdate> delta;
+    const bool isKeyframe = !mLastSentVsyncId || ++mUpdatesSinceKeyframe >= kKeyframeInterval;
+    if (isKeyframe) {
+        mUpdatesSinceKeyframe = 0;
+        mListenersNeedingKeyframe.clear();
+    } else {
+        ATRACE_NAME("WindowInfosListenerInvoker::makeDelta");
+        delta = gui::WindowInfosUpdate::makeDelta(mLastSentWindowInfos, *mLastSentVsyncId, update);
+    }
+
     // Call the listeners
     for (auto& pair : mWindowInfosListeners) {
         auto& [listenerId, listener] = pair.second;
-        auto status = listener->onWindowInfosChanged(update);
-        if (!status.isOk()) {
+        const bool sendDelta = delta && !mListenersNeedingKeyframe.contains(listenerId);
+        auto status = listener->onWindowInfosChanged(sendDelta ? *delta : update);
+        if (status.isOk()) {
+            mListenersNeedingKeyframe.erase(listenerId);
+        } else {
+            // The listener may have missed this update, so it cannot apply the next delta.
+            mListenersNeedingKeyframe.insert(listenerId);
             ackWindowInfosReceived(update.vsyncId, listenerId);
         }
     }
+
+    mLastSentVsyncId = update.vsyncId;
+    mLastSentWindowInfos = std::move(update.windowInfos);
 }
 
 WindowInfosListenerInvoker::DebugInfo WindowInfosListenerInvoker::getDebugInfo() {
@@ -199,4 +222,12 @@ binder::Status WindowInfosListenerInvoker::ackWindowInfosReceived(int64_t vsyncI
     return binder::Status::ok();
 }
 
+binder::Status WindowInfosListenerInvoker::requestWindowInfosKeyframe(int64_t listenerId) {
+    BackgroundExecutor::getInstance().sendCallbacks({[this, listenerId]() {
+        ATRACE_NAME("WindowInfosListenerInvoker::requestWindowInfosKeyframe");
+        mListenersNeedingKeyframe.insert(listenerId);
+    }});
+    return binder::Status::ok();
+}
+
 } // namespace android
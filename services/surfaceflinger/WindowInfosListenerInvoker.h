@@ -47,6 +47,7 @@ public:
                             bool forceImmediateCall);
 
     binder::Status ackWindowInfosReceived(int64_t, int64_t) override;
+    binder::Status requestWindowInfosKeyframe(int64_t) override;
 
     struct DebugInfo {
         VsyncId maxSendDelayVsyncId;
@@ -65,6 +66,15 @@ private:
                   kStaticCapacity>
             mWindowInfosListeners;
 
+    // Listeners are sent the windows that changed since the previous update, except for
+    // listeners that have not received the previous update, and every kKeyframeInterval
+    // updates, which get all windows.
+    static constexpr size_t kKeyframeInterval = 64;
+    std::vector<gui::WindowInfo> mLastSentWindowInfos;
+    std::optional<int64_t> mLastSentVsyncId;
+    size_t mUpdatesSinceKeyframe = 0;
+    std::unordered_set<int64_t> mListenersNeedingKeyframe;
+
     std::optional<gui::WindowInfosUpdate> mDelayedUpdate;
     WindowInfosReportedListenerSet mReportedListeners;
 
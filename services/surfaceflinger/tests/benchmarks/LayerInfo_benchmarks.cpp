@@ -0,0 +1,99 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Scheduler/LayerInfo.h"
+#include "Scheduler/RefreshRateSelector.h"
+#include "mock/DisplayHardware/MockDisplayMode.h"
+
+namespace android::scheduler {
+namespace {
+
+using android::mock::createDisplayMode;
+
+// Layers are summarized at the refresh rate, and post a buffer every kFramesPerBuffer refreshes,
+// i.e. at 30 Hz.
+constexpr Fps kRefreshRate = 120_Hz;
+constexpr size_t kFramesPerBuffer = 4;
+
+// Holds active layers with enough history for the heuristic, as LayerHistory::summarize sees them.
+class LayerInfoFixture {
+public:
+    explicit LayerInfoFixture(size_t layerCount) {
+        for (size_t i = 0; i < layerCount; i++) {
+            mLayerInfos.push_back(
+                    std::make_unique<LayerInfo>("benchmarklayer" + std::to_string(i), 0,
+                                                LayerHistory::LayerVoteType::Heuristic));
+        }
+        // Fill the history of every layer.
+        const auto frameCount = LayerHistory::kMaxPeriodForHistory.count() /
+                kRefreshRate.getPeriodNsecs();
+        for (nsecs_t frame = 0; frame < frameCount; frame++) {
+            advanceFrame(kFramesPerBuffer);
+        }
+    }
+
+    // Advances by a refresh period, posts buffers if due, and votes as LayerHistory::summarize
+    // does for every active layer.
+    void advanceFrame(size_t framesPerBuffer) {
+        mNow += kRefreshRate.getPeriodNsecs();
+        if (++mFrame % framesPerBuffer == 0) {
+            for (auto& info : mLayerInfos) {
+                info->setLastPresentTime(mNow, mNow, LayerHistory::LayerUpdateType::Buffer,
+                                         /*pendingModeChange*/ false, mProps);
+            }
+        }
+        for (auto& info : mLayerInfos) {
+            benchmark::DoNotOptimize(info->getRefreshRateVote(mSelector, mNow));
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<LayerInfo>> mLayerInfos;
+    RefreshRateSelector mSelector{makeModes(createDisplayMode(DisplayModeId(0), 60_Hz),
+                                            createDisplayMode(DisplayModeId(1), 120_Hz)),
+                                  DisplayModeId(1)};
+    LayerProps mProps{.visible = true};
+    nsecs_t mNow = 0;
+    size_t mFrame = 0;
+};
+
+// Steady layers, most of which did not post a buffer since they were last summarized.
+void BM_SummarizeSteadyLayers(benchmark::State& state) {
+    LayerInfoFixture fixture(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        fixture.advanceFrame(kFramesPerBuffer);
+    }
+}
+
+// Layers that post a buffer every time they are summarized.
+void BM_SummarizeUpdatedLayers(benchmark::State& state) {
+    LayerInfoFixture fixture(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        fixture.advanceFrame(1);
+    }
+}
+
+BENCHMARK(BM_SummarizeSteadyLayers)->Arg(10)->Arg(50)->Arg(200);
+BENCHMARK(BM_SummarizeUpdatedLayers)->Arg(10)->Arg(50)->Arg(200);
+
+} // namespace
+} // namespace android::scheduler
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "FrontEnd/LayerCreationArgs.h"
+#include "FrontEnd/LayerHierarchy.h"
+#include "FrontEnd/LayerLifecycleManager.h"
+#include "FrontEnd/LayerSnapshotBuilder.h"
+
+namespace android::surfaceflinger::frontend {
+namespace {
+
+// Number of children per layer in the generated hierarchy.
+constexpr uint32_t kFanOut = 4;
+
+class SnapshotFixture {
+public:
+    explicit SnapshotFixture(uint32_t layerCount) {
+        std::vector<std::unique_ptr<RequestedLayerState>> layers;
+        std::vector<TransactionState> transactions;
+        transactions.emplace_back();
+        for (uint32_t id = 1; id <= layerCount; id++) {
+            // Ids form a tree where layer n is a child of layer n / kFanOut.
+            const uint32_t parentId = id / kFanOut == 0 ? UNASSIGNED_LAYER_ID : id / kFanOut;
+            LayerCreationArgs args(std::make_optional(id));
+            args.name = "benchmarklayer";
+            args.addToRoot = parentId == UNASSIGNED_LAYER_ID;
+            args.parentId = parentId;
+            layers.emplace_back(std::make_unique<RequestedLayerState>(args));
+
+            // Hide every other leaf so that the visible set is sparse.
+            auto& state = transactions.back().states.emplace_back();
+            state.layerId = id;
+            state.state.what = layer_state_t::eColorChanged | layer_state_t::eFlagsChanged;
+            state.state.color.rgb = {1._hf, 1._hf, 1._hf};
+            state.state.mask = layer_state_t::eLayerHidden;
+            state.state.flags = (id % 2 == 0 && id * kFanOut > layerCount)
+                    ? layer_state_t::eLayerHidden
+                    : 0;
+        }
+        mLifecycleManager.addLayers(std::move(layers));
+        mLifecycleManager.applyTransactions(transactions);
+        mHierarchyBuilder.update(mLifecycleManager.getLayers(),
+                                 mLifecycleManager.getDestroyedLayers());
+
+        LayerSnapshotBuilder::Args args{.root = mHierarchyBuilder.getHierarchy(),
+                                        .layerLifecycleManager = mLifecycleManager,
+                                        .displays = mDisplays,
+                                        .globalShadowSettings = mShadowSettings,
+                                        .supportedLayerGenericMetadata = {},
+                                        .genericLayerMetadataKeyMap = {}};
+        mSnapshotBuilder.update(args);
+        mLifecycleManager.commitChanges();
+    }
+
+    LayerSnapshotBuilder& builder() { return mSnapshotBuilder; }
+
+private:
+    LayerLifecycleManager mLifecycleManager;
+    LayerHierarchyBuilder mHierarchyBuilder{{}};
+    LayerSnapshotBuilder mSnapshotBuilder;
+    DisplayInfos mDisplays;
+    renderengine::ShadowSettings mShadowSettings;
+};
+
+// Baseline: dereference every snapshot to read its visibility.
+void BM_VisibleSnapshotsPointerChase(benchmark::State& state) {
+    SnapshotFixture fixture(static_cast<uint32_t>(state.range(0)));
+    for (auto _ : state) {
+        float alpha = 0.f;
+        for (const auto& snapshot : fixture.builder().getSnapshots()) {
+            if (!snapshot->isVisible) continue;
+            alpha += snapshot->alpha;
+        }
+        benchmark::DoNotOptimize(alpha);
+    }
+}
+
+void BM_VisibleSnapshotsPacked(benchmark::State& state) {
+    SnapshotFixture fixture(static_cast<uint32_t>(state.range(0)));
+    for (auto _ : state) {
+        const auto& packed = fixture.builder().getPackedStates();
+        float alpha = 0.f;
+        for (size_t i = 0; i < packed.size(); i++) {
+            if (!packed.isVisible[i]) continue;
+            alpha += packed.alpha[i];
+        }
+        benchmark::DoNotOptimize(alpha);
+    }
+}
+
+void BM_ForEachVisibleSnapshot(benchmark::State& state) {
+    SnapshotFixture fixture(static_cast<uint32_t>(state.range(0)));
+    for (auto _ : state) {
+        size_t count = 0;
+        fixture.builder().forEachVisibleSnapshot([&count](const LayerSnapshot&) { count++; });
+        benchmark::DoNotOptimize(count);
+    }
+}
+
+void BM_LookupByPath(benchmark::State& state) {
+    const auto layerCount = static_cast<uint32_t>(state.range(0));
+    SnapshotFixture fixture(layerCount);
+    for (auto _ : state) {
+        for (uint32_t id = 1; id <= layerCount; id++) {
+            benchmark::DoNotOptimize(fixture.builder().getSnapshot(id));
+        }
+    }
+}
+
+void BM_LookupByHandle(benchmark::State& state) {
+    SnapshotFixture fixture(static_cast<uint32_t>(state.range(0)));
+    const auto& handles = fixture.builder().getPackedStates().handle;
+    for (auto _ : state) {
+        for (LayerSnapshotBuilder::SnapshotHandle handle : handles) {
+            benchmark::DoNotOptimize(fixture.builder().getSnapshotFromHandle(handle));
+        }
+    }
+}
+
+BENCHMARK(BM_VisibleSnapshotsPointerChase)->Arg(100)->Arg(500)->Arg(2000);
+BENCHMARK(BM_VisibleSnapshotsPacked)->Arg(100)->Arg(500)->Arg(2000);
+BENCHMARK(BM_ForEachVisibleSnapshot)->Arg(100)->Arg(500)->Arg(2000);
+BENCHMARK(BM_LookupByPath)->Arg(100)->Arg(500)->Arg(2000);
+BENCHMARK(BM_LookupByHandle)->Arg(100)->Arg(500)->Arg(2000);
+
+} // namespace
+} // namespace android::surfaceflinger::frontend
+
+BENCHMARK_MAIN();
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include <renderengine/mock/FakeExternalTexture.h>
+
+#include "FrontEnd/Update.h"
+#include "Tracing/TransactionProtoParser.h"
+#include "Tracing/TransactionTracing.h"
+
+namespace android {
+namespace {
+
+// Transactions queued before the benchmark commits them, so that the tracing thread drains
+// the queue like it does every vsync.
+constexpr size_t kTransactionsPerCommit = 64;
+
+// A transaction like an app posts every frame: a buffer and geometry for each of its layers,
+// with input info on the first one.
+TransactionState makeTransaction(size_t layerCount) {
+    TransactionState transaction;
+    transaction.originPid = 1;
+    transaction.originUid = 2;
+    for (size_t i = 0; i < layerCount; i++) {
+        ResolvedComposerState state;
+        state.layerId = static_cast<uint32_t>(i + 1);
+        state.state.what = layer_state_t::eBufferChanged | layer_state_t::ePositionChanged |
+                layer_state_t::eCropChanged | layer_state_t::eMatrixChanged |
+                layer_state_t::eAlphaChanged;
+        state.state.x = 10.f;
+        state.state.y = 20.f;
+        state.state.crop = Rect(0, 0, 1080, 2400);
+        state.state.bufferData = std::make_shared<BufferData>();
+        state.state.bufferData->frameNumber = 1;
+        state.externalTexture =
+                std::make_shared<renderengine::mock::FakeExternalTexture>(1080, 2400, i + 1,
+                                                                          PIXEL_FORMAT_RGBA_8888,
+                                                                          /*usage=*/0);
+        if (i == 0) {
+            state.state.what |= layer_state_t::eInputInfoChanged;
+            state.state.windowInfoHandle->editInfo()->touchableRegion =
+                    Region(Rect(0, 0, 1080, 2400));
+        }
+        transaction.states.emplace_back(std::move(state));
+    }
+    return transaction;
+}
+
+// What setTransactionState spends on a transaction when tracing is on. With tracing off, it
+// spends nothing.
+void BM_AddQueuedTransaction(benchmark::State& state) {
+    TransactionTracing tracing;
+    TransactionState transaction = makeTransaction(static_cast<size_t>(state.range(0)));
+    frontend::Update update;
+    int64_t vsyncId = 0;
+    for (auto _ : state) {
+        transaction.id++;
+        tracing.addQueuedTransaction(transaction);
+
+        update.transactions.push_back(transaction);
+        if (update.transactions.size() == kTransactionsPerCommit) {
+            state.PauseTiming();
+            tracing.addCommittedTransactions(++vsyncId, /*commitTime=*/0, update, {}, false);
+            tracing.flush();
+            update.transactions.clear();
+            state.ResumeTiming();
+        }
+    }
+}
+
+// The serialization that addQueuedTransaction used to do on the binder thread, and which the
+// tracing thread now does instead.
+void BM_SerializeTransaction(benchmark::State& state) {
+    TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+    const TransactionState transaction = makeTransaction(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.toProto(transaction));
+    }
+}
+
+BENCHMARK(BM_AddQueuedTransaction)->Arg(1)->Arg(4)->Arg(16);
+BENCHMARK(BM_SerializeTransaction)->Arg(1)->Arg(4)->Arg(16);
+
+} // namespace
+} // namespace android
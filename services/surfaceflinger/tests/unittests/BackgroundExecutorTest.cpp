@@ -1,5 +1,8 @@
+#include <ftl/async_future.h>
 #include <gtest/gtest.h>
 #include <condition_variable>
+#include <string>
+#include <vector>
 
 #include "BackgroundExecutor.h"
 
@@ -52,6 +55,77 @@ TEST_F(BackgroundExecutorTest, multipleProducers) {
     ASSERT_EQ(backgroundTaskCount, backgroundTaskCompleteCount);
 }
 
+TEST_F(BackgroundExecutorTest, orderedCallbacksRunInOrder) {
+    std::vector<int> order;
+    for (int i = 0; i < 100; i++) {
+        BackgroundExecutor::getInstance().sendCallbacks({[&order, i]() { order.push_back(i); }});
+        BackgroundExecutor::getInstance().sendUnorderedCallbacks({[]() {}});
+    }
+    BackgroundExecutor::getInstance().flushQueue();
+
+    ASSERT_EQ(100u, order.size());
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(i, order[i]);
+    }
+}
+
+TEST_F(BackgroundExecutorTest, bulkDoesNotBlockLatencyCritical) {
+    std::mutex mutex;
+    std::condition_variable condition_variable;
+    bool bulkReleased = false;
+    bool latencyCriticalComplete = false;
+
+    BackgroundExecutor::getInstance().sendCallbacks({[&]() {
+                                                        std::unique_lock<std::mutex> lock{mutex};
+                                                        condition_variable.wait(lock, [&]() {
+                                                            return bulkReleased;
+                                                        });
+                                                    }},
+                                                    BackgroundExecutor::Priority::Bulk);
+    BackgroundExecutor::getInstance().sendCallbacks({[&]() {
+        std::lock_guard<std::mutex> lock{mutex};
+        latencyCriticalComplete = true;
+        condition_variable.notify_all();
+    }});
+
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        condition_variable.wait(lock, [&]() { return latencyCriticalComplete; });
+        bulkReleased = true;
+        condition_variable.notify_all();
+    }
+    BackgroundExecutor::getInstance().flushQueue();
+}
+
+TEST_F(BackgroundExecutorTest, flushQueueWaitsForUnorderedCallbacks) {
+    std::atomic<int> count = 0;
+    for (int i = 0; i < 50; i++) {
+        BackgroundExecutor::getInstance().sendUnorderedCallbacks({[&count]() { count++; }});
+    }
+    BackgroundExecutor::getInstance().flushQueue();
+    ASSERT_EQ(50, count);
+
+    std::string dump;
+    BackgroundExecutor::getInstance().dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("LatencyCritical"));
+    EXPECT_NE(std::string::npos, dump.find("Bulk"));
+}
+
+TEST_F(BackgroundExecutorTest, asyncFutureContinuation) {
+    ftl::Promise<int> promise;
+    std::thread::id continuationThread;
+
+    auto future = promise.get_future().then(BackgroundExecutor::getInstance(),
+                                            [&continuationThread](int value) {
+                                                continuationThread = std::this_thread::get_id();
+                                                return value * 2;
+                                            });
+
+    promise.set_value(21);
+    ASSERT_EQ(42, std::move(future).get());
+    ASSERT_NE(std::this_thread::get_id(), continuationThread);
+}
+
 } // namespace
 
 } // namespace android
@@ -413,6 +413,42 @@ TEST_F(EventThreadTest, requestNextVsyncPostsASingleVSyncEventToTheConnection) {
     expectVSyncCallbackScheduleReceived(false);
 }
 
+TEST_F(EventThreadTest, requestNextVsyncThroughTimelinePostsTheNextVSyncEvent) {
+    setupEventThread(VSYNC_PERIOD);
+
+    std::optional<os::ParcelFileDescriptor> timelineFd;
+    ASSERT_TRUE(mConnection->getVsyncTimeline(&timelineFd).isOk());
+    ASSERT_TRUE(timelineFd);
+    const auto timeline = gui::VsyncTimeline::fromFd(timelineFd->release());
+    ASSERT_NE(nullptr, timeline);
+
+    // The next vsync can only be requested through the timeline while handling a requested one.
+    EXPECT_FALSE(timeline->requestNextVsync());
+
+    mThread->requestNextVsync(mConnection);
+    EXPECT_TRUE(mResyncCallRecorder.waitForCall().has_value());
+    expectVSyncCallbackScheduleReceived(true);
+
+    onVSyncEvent(123, 456, 789);
+    expectThrottleVsyncReceived(456, mConnectionUid);
+    expectVsyncEventReceivedByConnection(123, 1u);
+
+    // The event was published to the timeline.
+    gui::VsyncTimeline::Snapshot snapshot;
+    ASSERT_TRUE(timeline->read(&snapshot));
+    EXPECT_EQ(123, snapshot.timestamp);
+    EXPECT_EQ(1u, snapshot.count);
+
+    // While handling it, the client requests the next vsync through the timeline.
+    EXPECT_TRUE(timeline->requestNextVsync());
+    expectVSyncCallbackScheduleReceived(true);
+
+    onVSyncEvent(456, 789, 0);
+    expectThrottleVsyncReceived(789, mConnectionUid);
+    expectVsyncEventReceivedByConnection(456, 2u);
+    EXPECT_FALSE(mResyncCallRecorder.waitForUnexpectedCall().has_value());
+}
+
 TEST_F(EventThreadTest, requestNextVsyncEventFrameTimelinesCorrect) {
     setupEventThread(VSYNC_PERIOD);
 
@@ -427,6 +463,33 @@ TEST_F(EventThreadTest, requestNextVsyncEventFrameTimelinesCorrect) {
     expectVsyncEventFrameTimelinesCorrect(123, {-1, 789, 456});
 }
 
+TEST_F(EventThreadTest, connectionsWithSameFrameIntervalShareFrameTimelines) {
+    setupEventThread(VSYNC_PERIOD);
+
+    ConnectionEventRecorder secondConnectionEventRecorder{0};
+    sp<MockEventThreadConnection> secondConnection =
+            createConnection(secondConnectionEventRecorder);
+    mThread->requestNextVsync(mConnection);
+    mThread->requestNextVsync(secondConnection);
+
+    expectVSyncCallbackScheduleReceived(true);
+
+    onVSyncEvent(123, 456, 789);
+    auto args = mConnectionEventCallRecorder.waitForCall();
+    ASSERT_TRUE(args.has_value());
+    auto secondArgs = secondConnectionEventRecorder.waitForCall();
+    ASSERT_TRUE(secondArgs.has_value());
+
+    const auto& vsyncData = std::get<0>(args.value()).vsync.vsyncData;
+    const auto& secondVsyncData = std::get<0>(secondArgs.value()).vsync.vsyncData;
+    ASSERT_EQ(vsyncData.frameTimelinesLength, secondVsyncData.frameTimelinesLength);
+    EXPECT_EQ(vsyncData.preferredFrameTimelineIndex, secondVsyncData.preferredFrameTimelineIndex);
+    for (int i = 0; i < vsyncData.frameTimelinesLength; i++) {
+        EXPECT_EQ(vsyncData.frameTimelines[i].vsyncId, secondVsyncData.frameTimelines[i].vsyncId)
+                << "Vsync ID differs for frame timeline " << i;
+    }
+}
+
 TEST_F(EventThreadTest, requestNextVsyncEventFrameTimelinesValidLength) {
     // The VsyncEventData should not have kFrameTimelinesCapacity amount of valid frame timelines,
     // due to longer vsync period and kEarlyLatchMaxThreshold. Use length-2 to avoid decimal
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "FrameProfilerTest"
+
+#include <gtest/gtest.h>
+#include <timestatsatomsproto/TimeStatsAtomsProtoHeader.h>
+
+#include "FrameProfiler.h"
+
+namespace android {
+namespace {
+
+using Phase = FrameProfiler::Phase;
+
+constexpr nsecs_t kUs = 1'000;
+
+size_t index(Phase phase) {
+    return static_cast<size_t>(phase);
+}
+
+TEST(FrameProfilerTest, recordsPhasesPerRefreshRate) {
+    FrameProfiler profiler;
+    profiler.beginFrame(60_Hz, false);
+    profiler.addPhaseDuration(Phase::FlushTransactionQueues, 300 * kUs);
+    profiler.addPhaseDuration(Phase::CompositionPresent, 2500 * kUs);
+    profiler.beginFrame(120_Hz, false);
+    profiler.addPhaseDuration(Phase::FlushTransactionQueues, 40 * kUs);
+    profiler.beginFrame(120_Hz, false);
+
+    const auto stats = profiler.getStats();
+    ASSERT_EQ(2u, stats.size());
+
+    EXPECT_EQ(60, stats[0].refreshRateHz);
+    EXPECT_EQ(1u, stats[0].frames);
+    const auto& flush = stats[0].phases[index(Phase::FlushTransactionQueues)];
+    EXPECT_EQ(1u, flush.count);
+    EXPECT_EQ(300 * kUs, flush.totalDuration);
+    EXPECT_EQ(500 * kUs, flush.percentile(50.f));
+    EXPECT_EQ(4000 * kUs, stats[0].phases[index(Phase::CompositionPresent)].percentile(50.f));
+    // Phases that did not run in a frame are not counted.
+    EXPECT_EQ(0u, stats[0].phases[index(Phase::UpdateInputFlinger)].count);
+
+    EXPECT_EQ(120, stats[1].refreshRateHz);
+    EXPECT_EQ(1u, stats[1].frames);
+    EXPECT_EQ(50 * kUs, stats[1].phases[index(Phase::FlushTransactionQueues)].percentile(50.f));
+}
+
+TEST(FrameProfilerTest, attributesMissedFrameToOverrunPhase) {
+    FrameProfiler profiler;
+    for (int i = 0; i < 4; i++) {
+        profiler.beginFrame(60_Hz, false);
+        profiler.addPhaseDuration(Phase::UpdateLayerSnapshots, 1000 * kUs);
+        profiler.addPhaseDuration(Phase::CompositionPresent, 6000 * kUs);
+    }
+
+    // The composition is still the longest phase, but the snapshots overran the most.
+    profiler.beginFrame(60_Hz, false);
+    profiler.addPhaseDuration(Phase::UpdateLayerSnapshots, 5000 * kUs);
+    profiler.addPhaseDuration(Phase::CompositionPresent, 7000 * kUs);
+    profiler.beginFrame(60_Hz, true);
+
+    const auto stats = profiler.getStats();
+    ASSERT_EQ(1u, stats.size());
+    EXPECT_EQ(5u, stats[0].frames);
+    EXPECT_EQ(1u, stats[0].missedFrames);
+    EXPECT_EQ(1u, stats[0].phases[index(Phase::UpdateLayerSnapshots)].missedFrames);
+    EXPECT_EQ(0u, stats[0].phases[index(Phase::CompositionPresent)].missedFrames);
+}
+
+TEST(FrameProfilerTest, nestedPhasesAreCountedOnce) {
+    FrameProfiler profiler;
+    profiler.beginFrame(60_Hz, false);
+    {
+        FrameProfiler::ScopedPhase outer(profiler, Phase::PostComposition);
+        FrameProfiler::ScopedPhase inner(profiler, Phase::Callbacks);
+    }
+    profiler.beginFrame(60_Hz, false);
+
+    const auto stats = profiler.getStats();
+    ASSERT_EQ(1u, stats.size());
+    EXPECT_EQ(1u, stats[0].phases[index(Phase::PostComposition)].count);
+    EXPECT_EQ(1u, stats[0].phases[index(Phase::Callbacks)].count);
+}
+
+TEST(FrameProfilerTest, populateAtomResetsProfile) {
+    FrameProfiler profiler;
+    profiler.beginFrame(90_Hz, false);
+    profiler.addPhaseDuration(Phase::UpdateInputFlinger, 120 * kUs);
+    profiler.beginFrame(90_Hz, true);
+
+    std::vector<uint8_t> pulledBytes;
+    ASSERT_TRUE(profiler.populateAtom(&pulledBytes));
+
+    android::surfaceflinger::SurfaceflingerFrameProfileWrapper atomList;
+    ASSERT_TRUE(atomList.ParseFromArray(pulledBytes.data(), static_cast<int>(pulledBytes.size())));
+    ASSERT_EQ(1, atomList.atom_size());
+    const auto& atom = atomList.atom(0);
+    EXPECT_EQ(90, atom.refresh_rate_hz());
+    EXPECT_EQ(1, atom.total_frames());
+    EXPECT_EQ(1, atom.missed_frames());
+    ASSERT_EQ(static_cast<int>(FrameProfiler::kPhaseCount), atom.phases_size());
+
+    const auto& input = atom.phases(static_cast<int>(index(Phase::UpdateInputFlinger)));
+    EXPECT_EQ(android::surfaceflinger::SurfaceflingerFrameProfile::UPDATE_INPUT_FLINGER,
+              input.phase());
+    ASSERT_EQ(1, input.time_micros_buckets_size());
+    EXPECT_EQ(100, input.time_micros_buckets(0));
+    EXPECT_EQ(1, input.frame_counts(0));
+    EXPECT_EQ(1, input.missed_frames());
+
+    const auto stats = profiler.getStats();
+    ASSERT_EQ(1u, stats.size());
+    EXPECT_EQ(0u, stats[0].frames);
+    EXPECT_EQ(0u, stats[0].phases[index(Phase::UpdateInputFlinger)].count);
+}
+
+} // namespace
+} // namespace android
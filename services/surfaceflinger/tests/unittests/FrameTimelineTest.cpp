@@ -79,8 +79,10 @@ public:
     void SetUp() override {
         constexpr bool kUseBootTimeClock = true;
         mTimeStats = std::make_shared<mock::TimeStats>();
+        // Most tests check the classification right after setSfPresent, so classify synchronously.
         mFrameTimeline = std::make_unique<impl::FrameTimeline>(mTimeStats, kSurfaceFlingerPid,
-                                                               kTestThresholds, !kUseBootTimeClock);
+                                                               kTestThresholds, !kUseBootTimeClock,
+                                                               !kClassifyAsync);
         mFrameTimeline->registerDataSource();
         mTokenManager = &mFrameTimeline->mTokenManager;
         mTraceCookieCounter = &mFrameTimeline->mTraceCookieCounter;
@@ -179,6 +181,7 @@ public:
     uint32_t* maxDisplayFrames;
     size_t maxTokens;
     static constexpr pid_t kSurfaceFlingerPid = 666;
+    static constexpr bool kClassifyAsync = true;
     static constexpr nsecs_t kPresentThreshold = std::chrono::nanoseconds(2ns).count();
     static constexpr nsecs_t kDeadlineThreshold = std::chrono::nanoseconds(0ns).count();
     static constexpr nsecs_t kStartThreshold = std::chrono::nanoseconds(2ns).count();
@@ -335,6 +338,41 @@ TEST_F(FrameTimelineTest, presentFenceSignaled_presentedFramesUpdated) {
     EXPECT_NE(surfaceFrame2->getJankType(), std::nullopt);
 }
 
+TEST_F(FrameTimelineTest, presentFenceSignaled_asyncClassificationDoneByNextPresent) {
+    EXPECT_CALL(*mTimeStats, incrementJankyFrames(_));
+    mFrameTimeline = std::make_unique<impl::FrameTimeline>(mTimeStats, kSurfaceFlingerPid,
+                                                           kTestThresholds,
+                                                           /*useBootTimeClock*/ false,
+                                                           kClassifyAsync);
+    mTokenManager = &mFrameTimeline->mTokenManager;
+
+    auto presentFence1 = fenceFactory.createFenceTimeForTest(Fence::NO_FENCE);
+    int64_t surfaceFrameToken1 = mTokenManager->generateTokenForPredictions({10, 20, 30});
+    int64_t sfToken1 = mTokenManager->generateTokenForPredictions({22, 26, 30});
+    FrameTimelineInfo ftInfo;
+    ftInfo.vsyncId = surfaceFrameToken1;
+    ftInfo.inputEventId = sInputEventId;
+    auto surfaceFrame1 =
+            mFrameTimeline->createSurfaceFrameForToken(ftInfo, sPidOne, sUidOne, sLayerIdOne,
+                                                       sLayerNameOne, sLayerNameOne,
+                                                       /*isBuffer*/ true, sGameMode);
+    mFrameTimeline->setSfWakeUp(sfToken1, 22, Fps::fromPeriodNsecs(11));
+    surfaceFrame1->setPresentState(SurfaceFrame::PresentState::Presented);
+    mFrameTimeline->addSurfaceFrame(surfaceFrame1);
+    mFrameTimeline->setSfPresent(26, presentFence1);
+    auto displayFrame = getDisplayFrame(0);
+    presentFence1->signalForTest(42);
+
+    // Hands the presented frame over to the worker.
+    addEmptyDisplayFrame();
+    // The worker must have classified it by the time the next frame is presented.
+    addEmptyDisplayFrame();
+
+    EXPECT_EQ(displayFrame->getActuals().presentTime, 42);
+    EXPECT_EQ(surfaceFrame1->getActuals().presentTime, 42);
+    EXPECT_NE(surfaceFrame1->getJankType(), std::nullopt);
+}
+
 TEST_F(FrameTimelineTest, displayFramesSlidingWindowMovesAfterLimit) {
     // Insert kMaxDisplayFrames' count of DisplayFrames to fill the deque
     int frameTimeFactor = 0;
@@ -464,6 +502,46 @@ TEST_F(FrameTimelineTest, setMaxDisplayFramesSetsSizeProperly) {
     EXPECT_EQ(getNumberOfDisplayFrames(), *maxDisplayFrames);
 }
 
+TEST_F(FrameTimelineTest, evictedDisplayFramesAndSurfaceFramesAreReused) {
+    auto presentFence = fenceFactory.createFenceTimeForTest(Fence::NO_FENCE);
+    presentFence->signalForTest(2);
+
+    const auto addFrame = [&] {
+        auto surfaceFrame =
+                mFrameTimeline->createSurfaceFrameForToken({}, sPidOne, sUidOne, sLayerIdOne,
+                                                           sLayerNameOne, sLayerNameOne,
+                                                           /*isBuffer*/ true, sGameMode);
+        int64_t sfToken = mTokenManager->generateTokenForPredictions({22, 26, 30});
+        mFrameTimeline->setSfWakeUp(sfToken, 22, Fps::fromPeriodNsecs(11));
+        surfaceFrame->setPresentState(SurfaceFrame::PresentState::Presented);
+        mFrameTimeline->addSurfaceFrame(surfaceFrame);
+        mFrameTimeline->setSfPresent(27, presentFence);
+    };
+
+    for (size_t i = 0; i < *maxDisplayFrames; i++) {
+        addFrame();
+    }
+    const impl::FrameTimeline::DisplayFrame* oldest = getDisplayFrame(0).get();
+    EXPECT_EQ(0u, mFrameTimeline->mSurfaceFramePool->getFreeBlockCount());
+
+    // Evicting the oldest DisplayFrame makes it the next current one, and frees its SurfaceFrame
+    // back into the pool.
+    addFrame();
+    EXPECT_EQ(getNumberOfDisplayFrames(), *maxDisplayFrames);
+    {
+        std::lock_guard<std::mutex> lock(mFrameTimeline->mMutex);
+        EXPECT_EQ(oldest, mFrameTimeline->mCurrentDisplayFrame.get());
+        EXPECT_TRUE(mFrameTimeline->mCurrentDisplayFrame->getSurfaceFrames().empty());
+        EXPECT_EQ(FramePresentMetadata::UnknownPresent,
+                  mFrameTimeline->mCurrentDisplayFrame->getFramePresentMetadata());
+    }
+    EXPECT_EQ(1u, mFrameTimeline->mSurfaceFramePool->getFreeBlockCount());
+
+    // The next SurfaceFrame takes the freed block.
+    addFrame();
+    EXPECT_EQ(1u, mFrameTimeline->mSurfaceFramePool->getFreeBlockCount());
+}
+
 TEST_F(FrameTimelineTest, presentFenceSignaled_invalidSignalTime) {
     Fps refreshRate = Fps::fromPeriodNsecs(11);
 
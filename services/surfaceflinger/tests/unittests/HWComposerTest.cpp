@@ -271,5 +271,34 @@ TEST_F(HWComposerLayerGenericMetadataTest, forwardsSupportedMetadata) {
     EXPECT_EQ(hal::Error::UNSUPPORTED, result);
 }
 
+struct HWComposerLayerStateCacheTest : public HWComposerLayerTest {
+    HWComposerLayerStateCacheTest() : HWComposerLayerTest({}) {}
+};
+
+TEST_F(HWComposerLayerStateCacheTest, skipsUnchangedState) {
+    EXPECT_CALL(*mHal, setLayerZOrder(kDisplayId, kLayerId, 1u))
+            .WillOnce(Return(hardware::graphics::composer::V2_4::Error::NONE));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setZOrder(1u));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setZOrder(1u));
+
+    EXPECT_CALL(*mHal, setLayerZOrder(kDisplayId, kLayerId, 2u))
+            .WillOnce(Return(hardware::graphics::composer::V2_4::Error::NONE));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setZOrder(2u));
+
+    EXPECT_CALL(*mHal, setLayerPlaneAlpha(kDisplayId, kLayerId, 0.5f))
+            .WillOnce(Return(hardware::graphics::composer::V2_4::Error::NONE));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setPlaneAlpha(0.5f));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setPlaneAlpha(0.5f));
+}
+
+TEST_F(HWComposerLayerStateCacheTest, resendsStateAfterError) {
+    EXPECT_CALL(*mHal, setLayerBrightness(kDisplayId, kLayerId, 0.5f))
+            .WillOnce(Return(hardware::graphics::composer::V2_4::Error::BAD_LAYER))
+            .WillOnce(Return(hardware::graphics::composer::V2_4::Error::NONE));
+    EXPECT_EQ(hal::Error::BAD_LAYER, mLayer.setBrightness(0.5f));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setBrightness(0.5f));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setBrightness(0.5f));
+}
+
 } // namespace
 } // namespace android
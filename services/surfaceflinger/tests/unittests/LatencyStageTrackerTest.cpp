@@ -0,0 +1,95 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LatencyStageTrackerTest"
+
+#include <gtest/gtest.h>
+
+#include "LatencyStageTracker.h"
+
+namespace android {
+namespace {
+
+using Interval = LatencyStageTracker::Interval;
+
+constexpr int32_t kLayerId = 1;
+constexpr nsecs_t kMs = 1'000'000;
+
+TEST(LatencyStageTrackerTest, recordsEachStage) {
+    LatencyStageTracker tracker;
+    tracker.onBufferPosted(kLayerId, 1, 0, 2 * kMs);
+    tracker.onBufferLatched(kLayerId, 1, 5 * kMs);
+    tracker.onBufferPresented(kLayerId, 1, 20 * kMs);
+
+    EXPECT_EQ(1u, tracker.getHistogram(Interval::PostToApply).count());
+    EXPECT_EQ(2 * kMs + kMs / 2, tracker.getHistogram(Interval::PostToApply).percentile(50.f));
+    EXPECT_EQ(3 * kMs + kMs / 2, tracker.getHistogram(Interval::ApplyToLatch).percentile(50.f));
+    EXPECT_EQ(15 * kMs + kMs / 2, tracker.getHistogram(Interval::LatchToPresent).percentile(50.f));
+    EXPECT_EQ(20 * kMs + kMs / 2, tracker.getHistogram(Interval::PostToPresent).percentile(50.f));
+}
+
+TEST(LatencyStageTrackerTest, ignoresUnlatchedAndDroppedBuffers) {
+    LatencyStageTracker tracker;
+    tracker.onBufferPosted(kLayerId, 1, 0, kMs);
+    tracker.onBufferPosted(kLayerId, 2, kMs, 2 * kMs);
+    tracker.onBufferLatched(kLayerId, 2, 3 * kMs);
+
+    // Buffer 1 was never latched, so presenting buffer 2 discards it.
+    tracker.onBufferPresented(kLayerId, 2, 10 * kMs);
+    EXPECT_EQ(1u, tracker.getHistogram(Interval::PostToPresent).count());
+
+    tracker.onBufferPresented(kLayerId, 1, 20 * kMs);
+    EXPECT_EQ(1u, tracker.getHistogram(Interval::PostToPresent).count());
+}
+
+TEST(LatencyStageTrackerTest, waitsForPresentFence) {
+    LatencyStageTracker tracker;
+    tracker.onBufferPosted(kLayerId, 1, 0, kMs);
+    tracker.onBufferLatched(kLayerId, 1, 2 * kMs);
+
+    FenceToFenceTimeMap fenceMap;
+    const auto [fence, fenceTime] = fenceMap.makePendingFenceForTest();
+    tracker.onBufferPresented(kLayerId, 1, fenceTime);
+    tracker.flushPresentFences();
+    EXPECT_EQ(0u, tracker.getHistogram(Interval::PostToPresent).count());
+
+    fenceMap.signalAllForTest(fence, 8 * kMs);
+    tracker.flushPresentFences();
+    EXPECT_EQ(1u, tracker.getHistogram(Interval::PostToPresent).count());
+    EXPECT_EQ(8 * kMs + kMs / 2, tracker.getHistogram(Interval::PostToPresent).percentile(50.f));
+}
+
+TEST(LatencyStageTrackerTest, forgetsDestroyedLayers) {
+    LatencyStageTracker tracker;
+    tracker.onBufferPosted(kLayerId, 1, 0, kMs);
+    tracker.onBufferLatched(kLayerId, 1, 2 * kMs);
+    tracker.onLayerDestroyed(kLayerId);
+    tracker.onBufferPresented(kLayerId, 1, 10 * kMs);
+
+    EXPECT_EQ(0u, tracker.getHistogram(Interval::PostToPresent).count());
+}
+
+TEST(LatencyStageTrackerTest, dumpListsStages) {
+    LatencyStageTracker tracker;
+    std::string result;
+    tracker.dump(result);
+    EXPECT_NE(std::string::npos, result.find("PostToApply"));
+    EXPECT_NE(std::string::npos, result.find("PostToPresent"));
+}
+
+} // namespace
+} // namespace android
@@ -32,7 +32,10 @@ protected:
     using FrameTimeData = LayerInfo::FrameTimeData;
 
     void setFrameTimes(const std::deque<FrameTimeData>& frameTimes) {
-        layerInfo.mFrameTimes = frameTimes;
+        layerInfo.clearFrameTimes();
+        for (const auto& frameTime : frameTimes) {
+            layerInfo.addFrameTime(frameTime);
+        }
     }
 
     void setLastRefreshRate(Fps fps) {
@@ -171,5 +174,23 @@ TEST_F(LayerInfoTest, ignoresLargePeriods) {
     ASSERT_EQ(kExpectedFps, Fps::fromPeriodNsecs(*averageFrameTime));
 }
 
+TEST_F(LayerInfoTest, recalculatesAverageFrameTimeWhenFrameAdded) {
+    std::deque<FrameTimeData> frameTimes;
+    const auto period = (50_Hz).getPeriodNsecs();
+    constexpr int kNumFrames = 10;
+    for (int i = 1; i <= kNumFrames; i++) {
+        frameTimes.push_back(FrameTimeData{.presentTime = period * i,
+                                           .queueTime = period * i,
+                                           .pendingModeChange = false});
+    }
+    setFrameTimes(frameTimes);
+    ASSERT_TRUE(calculateAverageFrameTime().has_value());
+
+    layerInfo.addFrameTime(FrameTimeData{.presentTime = period * (kNumFrames + 1),
+                                         .queueTime = period * (kNumFrames + 1),
+                                         .pendingModeChange = true});
+    ASSERT_FALSE(calculateAverageFrameTime().has_value());
+}
+
 } // namespace
 } // namespace android::scheduler
@@ -389,4 +389,85 @@ TEST_F(LayerLifecycleManagerTest, onParentDestroyDestroysBackgroundLayer) {
     listener->expectLayersDestroyed({1, bgLayerId});
 }
 
+TEST_F(LayerLifecycleManagerTest, canDestroyBackgroundLayersInBatch) {
+    LayerLifecycleManager lifecycleManager;
+    auto listener = std::make_shared<ExpectLayerLifecycleListener>();
+    lifecycleManager.addLifecycleListener(listener);
+
+    std::vector<std::unique_ptr<RequestedLayerState>> layers;
+    layers.emplace_back(rootLayer(1));
+    layers.emplace_back(rootLayer(2));
+    lifecycleManager.addLayers(std::move(layers));
+
+    std::vector<TransactionState> transactions;
+    for (uint32_t layerId : {1, 2}) {
+        transactions.emplace_back();
+        transactions.back().states.push_back({});
+        transactions.back().states.front().state.bgColor.a = 0.5;
+        transactions.back().states.front().state.what = layer_state_t::eBackgroundColorChanged;
+        transactions.back().states.front().layerId = layerId;
+    }
+    lifecycleManager.applyTransactions(transactions);
+    ASSERT_EQ(lifecycleManager.getLayers().size(), 4u);
+    lifecycleManager.commitChanges();
+    ASSERT_EQ(listener->mActualLayersAdded.size(), 4u);
+    auto bgLayerId1 = listener->mActualLayersAdded[2];
+    auto bgLayerId2 = listener->mActualLayersAdded[3];
+    listener->expectLayersAdded({1, 2, bgLayerId1, bgLayerId2});
+
+    for (auto& transaction : transactions) {
+        transaction.states.front().state.bgColor.a = 0;
+    }
+    lifecycleManager.applyTransactions(transactions);
+
+    ASSERT_EQ(lifecycleManager.getLayers().size(), 2u);
+    ASSERT_EQ(lifecycleManager.getDestroyedLayers().size(), 2u);
+    EXPECT_EQ(getRequestedLayerState(lifecycleManager, 1)->bgColorLayerId, UNASSIGNED_LAYER_ID);
+    EXPECT_EQ(getRequestedLayerState(lifecycleManager, 2)->bgColorLayerId, UNASSIGNED_LAYER_ID);
+    EXPECT_TRUE(lifecycleManager.getGlobalChanges().test(RequestedLayerState::Changes::Hierarchy));
+    lifecycleManager.commitChanges();
+    listener->expectLayersAdded({});
+    listener->expectLayersDestroyed({bgLayerId1, bgLayerId2});
+}
+
+TEST_F(LayerLifecycleManagerTest, reusesDestroyedBackgroundLayer) {
+    LayerLifecycleManager lifecycleManager;
+    auto listener = std::make_shared<ExpectLayerLifecycleListener>();
+    lifecycleManager.addLifecycleListener(listener);
+
+    std::vector<std::unique_ptr<RequestedLayerState>> layers;
+    layers.emplace_back(rootLayer(1));
+    lifecycleManager.addLayers(std::move(layers));
+
+    std::vector<TransactionState> transactions;
+    transactions.emplace_back();
+    transactions.back().states.push_back({});
+    transactions.back().states.front().state.what = layer_state_t::eBackgroundColorChanged;
+    transactions.back().states.front().layerId = 1;
+    auto setBackgroundAlpha = [&](float alpha) {
+        transactions.back().states.front().state.bgColor.a = alpha;
+        lifecycleManager.applyTransactions(transactions);
+    };
+
+    setBackgroundAlpha(0.5);
+    const RequestedLayerState* bgLayer =
+            getRequestedLayerState(lifecycleManager,
+                                   getRequestedLayerState(lifecycleManager, 1)->bgColorLayerId);
+    ASSERT_NE(bgLayer, nullptr);
+    const uint32_t bgLayerId = bgLayer->id;
+    lifecycleManager.commitChanges();
+    setBackgroundAlpha(0);
+    lifecycleManager.commitChanges();
+    listener->expectLayersDestroyed({bgLayerId});
+
+    setBackgroundAlpha(0.25);
+    const uint32_t newBgLayerId = getRequestedLayerState(lifecycleManager, 1)->bgColorLayerId;
+    EXPECT_NE(newBgLayerId, bgLayerId);
+    EXPECT_EQ(getRequestedLayerState(lifecycleManager, newBgLayerId), bgLayer);
+    EXPECT_EQ(bgLayer->color.a, 0.25_hf);
+    EXPECT_TRUE(bgLayer->changes.test(RequestedLayerState::Changes::Created));
+    lifecycleManager.commitChanges();
+    listener->expectLayersAdded({1, bgLayerId, newBgLayerId});
+}
+
 } // namespace android::surfaceflinger::frontend
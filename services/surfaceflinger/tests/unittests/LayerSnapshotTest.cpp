@@ -21,6 +21,7 @@
 #include "FrontEnd/LayerLifecycleManager.h"
 #include "FrontEnd/LayerSnapshotBuilder.h"
 #include "LayerHierarchyTest.h"
+#include "LayerProtoHelper.h"
 
 #define UPDATE_AND_VERIFY(BUILDER, ...)                                    \
     ({                                                                     \
@@ -81,7 +82,8 @@ protected:
                                         .globalShadowSettings = globalShadowSettings,
                                         .supportsBlur = true,
                                         .supportedLayerGenericMetadata = {},
-                                        .genericLayerMetadataKeyMap = {}};
+                                        .genericLayerMetadataKeyMap = {},
+                                        .incrementalUpdate = mIncrementalUpdate};
         actualBuilder.update(args);
 
         // rebuild layer snapshots from scratch and verify that it matches the updated state.
@@ -107,6 +109,7 @@ protected:
     LayerSnapshotBuilder mSnapshotBuilder;
     DisplayInfos mFrontEndDisplayInfos;
     renderengine::ShadowSettings globalShadowSettings;
+    bool mIncrementalUpdate = false;
     static const std::vector<uint32_t> STARTING_ZORDER;
 };
 const std::vector<uint32_t> LayerSnapshotTest::STARTING_ZORDER = {1,   11,   111, 12, 121,
@@ -208,6 +211,71 @@ TEST_F(LayerSnapshotTest, childBehindParentCanBeHiddenByParent) {
     UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 12, 121, 122, 1221, 13, 2});
 }
 
+TEST_F(LayerSnapshotTest, incrementalUpdateSkipsCleanSubtrees) {
+    mIncrementalUpdate = true;
+    setCrop(122, Rect(1, 2, 3, 4));
+    UPDATE_AND_VERIFY(mSnapshotBuilder, STARTING_ZORDER);
+    const auto& stats = mSnapshotBuilder.getUpdateStats();
+    // Only the changed layer, its ancestors and its children are updated.
+    EXPECT_EQ(stats.visitedSnapshots, 4u);
+    EXPECT_EQ(stats.totalSnapshots, STARTING_ZORDER.size());
+    EXPECT_EQ(stats.incrementalUpdates, 1u);
+    EXPECT_EQ(getSnapshot(1221)->geomLayerBounds, Rect(1, 2, 3, 4).toFloatRect());
+}
+
+TEST_F(LayerSnapshotTest, incrementalUpdateHandlesZOrderChanges) {
+    mIncrementalUpdate = true;
+    setZ(111, -1);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 111, 11, 12, 121, 122, 1221, 13, 2});
+
+    reparentLayer(121, 13);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 111, 11, 12, 122, 1221, 13, 121, 2});
+    EXPECT_EQ(mSnapshotBuilder.getUpdateStats().incrementalUpdates, 2u);
+    EXPECT_LT(mSnapshotBuilder.getUpdateStats().visitedSnapshots, STARTING_ZORDER.size());
+}
+
+TEST_F(LayerSnapshotTest, incrementalUpdateReparentToHiddenParent) {
+    mIncrementalUpdate = true;
+    hideLayer(11);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 12, 121, 122, 1221, 13, 2});
+
+    reparentLayer(121, 11);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 12, 122, 1221, 13, 2});
+}
+
+TEST_F(LayerSnapshotTest, incrementalUpdateFallsBackWhenLayerIsDetached) {
+    mIncrementalUpdate = true;
+    reparentLayer(122, UNASSIGNED_LAYER_ID);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 11, 111, 12, 121, 13, 2});
+    EXPECT_EQ(mSnapshotBuilder.getUpdateStats().incrementalUpdates, 0u);
+
+    reparentLayer(122, 2);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 11, 111, 12, 121, 13, 2, 122, 1221});
+}
+
+TEST_F(LayerSnapshotTest, snapshotHandlesAreStable) {
+    const auto handle = getSnapshot(122)->handle;
+    EXPECT_EQ(mSnapshotBuilder.getSnapshotFromHandle(handle), getSnapshot(122));
+
+    setZ(122, -1);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 11, 111, 12, 122, 1221, 121, 13, 2});
+    EXPECT_EQ(mSnapshotBuilder.getSnapshotFromHandle(handle), getSnapshot(122));
+    EXPECT_EQ(mSnapshotBuilder.getPackedStates().handle[getSnapshot(122)->globalZ], handle);
+}
+
+TEST_F(LayerSnapshotTest, packedStatesMatchSnapshots) {
+    hideLayer(11);
+    setAlpha(12, 0.5f);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 12, 121, 122, 1221, 13, 2});
+    const auto& packed = mSnapshotBuilder.getPackedStates();
+    ASSERT_EQ(packed.size(), mSnapshotBuilder.getSnapshots().size());
+    for (const auto& snapshot : mSnapshotBuilder.getSnapshots()) {
+        EXPECT_EQ(static_cast<bool>(packed.isVisible[snapshot->globalZ]), snapshot->isVisible);
+        EXPECT_EQ(packed.alpha[snapshot->globalZ], snapshot->alpha);
+        EXPECT_EQ(packed.layerStack[snapshot->globalZ], snapshot->outputFilter.layerStack);
+    }
+}
+
 // relative tests
 TEST_F(LayerSnapshotTest, RelativeParentCanHideChild) {
     reparentRelativeLayer(13, 11);
@@ -467,4 +535,37 @@ TEST_F(LayerSnapshotTest, cleanUpUnreachableSnapshotsAfterLayerDestruction) {
     EXPECT_LE(startingNumSnapshots - 2, mSnapshotBuilder.getSnapshots().size());
 }
 
+TEST_F(LayerSnapshotTest, serializedProtoMatchesGeneratedProto) {
+    reparentRelativeLayer(13, 11);
+    mirrorLayer(/*layer*/ 14, /*parent*/ 1, /*layerToMirror*/ 11);
+    setCrop(111, Rect(0, 0, 100, 100));
+    setZ(121, -5);
+    setTouchableRegion(1221, Region(Rect(0, 0, 50, 50)));
+    setBackgroundBlurRadius(122, 20);
+    setAlpha(12, 0.5f);
+    mHierarchyBuilder.update(mLifecycleManager.getLayers(), mLifecycleManager.getDestroyedLayers());
+    LayerSnapshotBuilder::Args args{.root = mHierarchyBuilder.getHierarchy(),
+                                    .layerLifecycleManager = mLifecycleManager,
+                                    .includeMetadata = false,
+                                    .displays = mFrontEndDisplayInfos,
+                                    .globalShadowSettings = globalShadowSettings,
+                                    .supportedLayerGenericMetadata = {},
+                                    .genericLayerMetadataKeyMap = {}};
+    mSnapshotBuilder.update(args);
+    mLifecycleManager.commitChanges();
+
+    const std::unordered_map<uint32_t, sp<Layer>> legacyLayers;
+    const uint32_t traceFlags = LayerTracing::TRACE_INPUT | LayerTracing::TRACE_EXTRA;
+    const std::string expected =
+            LayerProtoFromSnapshotGenerator(mSnapshotBuilder, mFrontEndDisplayInfos, legacyLayers,
+                                            traceFlags)
+                    .generate(mHierarchyBuilder.getHierarchy())
+                    .SerializeAsString();
+    std::string actual;
+    LayerProtoFromSnapshotGenerator(mSnapshotBuilder, mFrontEndDisplayInfos, legacyLayers,
+                                    traceFlags)
+            .generateSerialized(mHierarchyBuilder.getHierarchy(), actual);
+    EXPECT_EQ(expected, actual);
+}
+
 } // namespace android::surfaceflinger::frontend
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "LocklessQueue.h"
+
+namespace android {
+namespace {
+
+TEST(LocklessQueueTest, popsInPushOrder) {
+    LocklessQueue<int> queue;
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_EQ(std::nullopt, queue.pop());
+
+    queue.push(1);
+    queue.push(2);
+    EXPECT_EQ(1, queue.pop());
+
+    // Values pushed while the pop list is not empty come after it.
+    queue.push(3);
+    EXPECT_EQ(2, queue.pop());
+    EXPECT_EQ(3, queue.pop());
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_EQ(std::nullopt, queue.pop());
+}
+
+TEST(LocklessQueueTest, supportsMoveOnlyValues) {
+    LocklessQueue<std::unique_ptr<int>> queue;
+    queue.push(std::make_unique<int>(1));
+    queue.push(std::make_unique<int>(2));
+
+    auto first = queue.pop();
+    ASSERT_TRUE(first && *first);
+    EXPECT_EQ(1, **first);
+    auto second = queue.pop();
+    ASSERT_TRUE(second && *second);
+    EXPECT_EQ(2, **second);
+}
+
+TEST(LocklessQueueTest, keepsPerProducerOrderWithMultipleProducers) {
+    constexpr int kProducerCount = 8;
+    constexpr int kValuesPerProducer = 1000;
+    LocklessQueue<std::pair<int, int>> queue;
+
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < kProducerCount; producer++) {
+        producers.emplace_back([&queue, producer] {
+            for (int i = 0; i < kValuesPerProducer; i++) {
+                queue.push({producer, i});
+            }
+        });
+    }
+
+    std::vector<int> nextValue(kProducerCount, 0);
+    int popped = 0;
+    while (popped < kProducerCount * kValuesPerProducer) {
+        if (const auto value = queue.pop()) {
+            const auto [producer, i] = *value;
+            EXPECT_EQ(nextValue[producer], i) << "producer " << producer;
+            nextValue[producer] = i + 1;
+            popped++;
+        }
+    }
+
+    for (auto& thread : producers) {
+        thread.join();
+    }
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+} // namespace
+} // namespace android
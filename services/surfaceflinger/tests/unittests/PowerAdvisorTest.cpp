@@ -218,5 +218,53 @@ TEST_F(PowerAdvisorTest, hintSessionUsingSecondaryVirtualDisplays) {
     mPowerAdvisor->reportActualWorkDuration();
 }
 
+TEST_F(PowerAdvisorTest, hintSessionLoadsUpCpuAheadOfHeavierFrames) {
+    mPowerAdvisor->onBootFinished();
+    startPowerHintSession();
+
+    std::vector<DisplayId> displayIds{PhysicalDisplayId::fromPort(42u)};
+
+    // 60hz
+    const Duration vsyncPeriod{std::chrono::nanoseconds(1s) / 60};
+    const Duration presentDuration = 5ms;
+    const Duration postCompDuration = 1ms;
+
+    TimePoint startTime{100ns};
+
+    // advisor only starts on frame 2 so do an initial no-op frame
+    fakeBasicFrameTiming(startTime, vsyncPeriod);
+    setExpectedTiming(vsyncPeriod, startTime + vsyncPeriod);
+    mPowerAdvisor->setDisplays(displayIds);
+    mPowerAdvisor->setSfPresentTiming(startTime, startTime + presentDuration);
+    mPowerAdvisor->setCompositeEnd(startTime + presentDuration + postCompDuration);
+
+    // Measure a frame with a plain workload.
+    startTime += vsyncPeriod;
+    EXPECT_CALL(*mMockPowerHintSession, sendHint(SessionHint::CPU_LOAD_UP)).Times(0);
+    fakeBasicFrameTiming(startTime, vsyncPeriod);
+    setExpectedTiming(vsyncPeriod, startTime + vsyncPeriod);
+    mPowerAdvisor->setDisplays(displayIds);
+    mPowerAdvisor->setCompositionWorkload({.layerCount = 4});
+    mPowerAdvisor->setHwcValidateTiming(displayIds[0], startTime + 1ms, startTime + 1500us);
+    mPowerAdvisor->setHwcPresentTiming(displayIds[0], startTime + 2ms, startTime + 2500us);
+    mPowerAdvisor->setSfPresentTiming(startTime, startTime + presentDuration);
+    mPowerAdvisor->reportActualWorkDuration();
+    mPowerAdvisor->setCompositeEnd(startTime + presentDuration + postCompDuration);
+    Mock::VerifyAndClearExpectations(mMockPowerHintSession.get());
+
+    // A frame with the same layers plus a blur is expected to take notably longer, so the CPU is
+    // loaded up before any work starts.
+    startTime += vsyncPeriod;
+    EXPECT_CALL(*mMockPowerHintSession, sendHint(SessionHint::CPU_LOAD_UP)).Times(1);
+    fakeBasicFrameTiming(startTime, vsyncPeriod);
+    setExpectedTiming(vsyncPeriod, startTime + vsyncPeriod);
+    mPowerAdvisor->setDisplays(displayIds);
+    mPowerAdvisor->setCompositionWorkload({.layerCount = 4, .blurLayerCount = 1});
+
+    std::string dump;
+    mPowerAdvisor->dump(dump);
+    EXPECT_THAT(dump, HasSubstr("CPU load ups sent ahead of time: 1"));
+}
+
 } // namespace
 } // namespace android::Hwc2::impl
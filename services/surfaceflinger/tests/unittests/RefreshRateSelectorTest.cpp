@@ -2279,7 +2279,7 @@ TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_ReadsCache) {
                                                                   {90_Hz, kMode90}}},
                                                           GlobalSignals{.touch = true}};
 
-    selector.mutableGetRankedRefreshRatesCache() = {args, result};
+    selector.mutableGetRankedRefreshRatesCache().insert(args.first, args.second, result);
 
     EXPECT_EQ(result, selector.getRankedFrameRates(args.first, args.second));
 }
@@ -2287,7 +2287,7 @@ TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_ReadsCache) {
 TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_WritesCache) {
     auto selector = createSelector(kModes_30_60_72_90_120, kModeId60);
 
-    EXPECT_FALSE(selector.mutableGetRankedRefreshRatesCache());
+    EXPECT_TRUE(selector.mutableGetRankedRefreshRatesCache().empty());
 
     std::vector<LayerRequirement> layers = {{.weight = 1.f}, {.weight = 0.5f}};
     RefreshRateSelector::GlobalSignals globalSignals{.touch = true, .idle = true};
@@ -2295,10 +2295,53 @@ TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_WritesCache) {
     const auto result = selector.getRankedFrameRates(layers, globalSignals);
 
     const auto& cache = selector.mutableGetRankedRefreshRatesCache();
-    ASSERT_TRUE(cache);
+    ASSERT_EQ(1u, cache.size());
 
-    EXPECT_EQ(cache->arguments, std::make_pair(layers, globalSignals));
-    EXPECT_EQ(cache->result, result);
+    EXPECT_EQ(cache.mostRecent().arguments, std::make_pair(layers, globalSignals));
+    EXPECT_EQ(cache.mostRecent().result, result);
+}
+
+TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_CachesMultipleArguments) {
+    auto selector = createSelector(kModes_30_60_72_90_120, kModeId60);
+    using Cache = TestableRefreshRateSelector::GetRankedFrameRatesCache;
+    const auto& cache = selector.mutableGetRankedRefreshRatesCache();
+
+    std::vector<LayerRequirement> layers = {{.weight = 1.f}};
+    auto& layer = layers[0];
+    layer.vote = LayerVoteType::ExplicitDefault;
+    layer.desiredRefreshRate = 60_Hz;
+    const auto result60 = selector.getRankedFrameRates(layers, {});
+    layer.desiredRefreshRate = 90_Hz;
+    const auto result90 = selector.getRankedFrameRates(layers, {});
+    EXPECT_EQ(2u, cache.missCount());
+
+    // Alternating between the two sets of requirements only hits the cache.
+    layer.desiredRefreshRate = 60_Hz;
+    EXPECT_EQ(result60, selector.getRankedFrameRates(layers, {}));
+    layer.desiredRefreshRate = 90_Hz;
+    EXPECT_EQ(result90, selector.getRankedFrameRates(layers, {}));
+    EXPECT_EQ(2u, cache.hitCount());
+    EXPECT_EQ(2u, cache.missCount());
+
+    // The signals are part of the key.
+    selector.getRankedFrameRates(layers, {.touch = true});
+    EXPECT_EQ(3u, cache.missCount());
+
+    // The least recently used entry is evicted once the cache is full.
+    for (size_t i = 0; i < Cache::kCapacity; i++) {
+        layer.name = "layer" + std::to_string(i);
+        selector.getRankedFrameRates(layers, {});
+    }
+    EXPECT_EQ(Cache::kCapacity, cache.size());
+    layer.name = "";
+    layer.desiredRefreshRate = 60_Hz;
+    selector.getRankedFrameRates(layers, {});
+    EXPECT_EQ(2u, cache.hitCount());
+
+    // Changing the policy invalidates all entries.
+    EXPECT_EQ(SetPolicyResult::Changed,
+              selector.setDisplayManagerPolicy({kModeId90, {30_Hz, 90_Hz}}));
+    EXPECT_TRUE(cache.empty());
 }
 
 TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_ExplicitExactTouchBoost) {
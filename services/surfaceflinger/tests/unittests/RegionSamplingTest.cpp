@@ -106,6 +106,23 @@ TEST_F(RegionSamplingTest, bounds_checking) {
                 testing::Eq(0.0));
 }
 
+TEST_F(RegionSamplingTest, sample_buffer_is_downscaled) {
+    EXPECT_EQ(ui::Size(270, 32), getSampleBufferSize(Rect(0, 2274, 1080, 2400)));
+    EXPECT_EQ(ui::Size(1, 1), getSampleBufferSize(Rect(10, 10, 12, 11)));
+}
+
+TEST_F(RegionSamplingTest, sample_buffer_area_covers_area) {
+    const Rect sampledBounds{100, 200, 500, 600};
+    const ui::Size bufferSize = getSampleBufferSize(sampledBounds);
+
+    EXPECT_EQ(Rect(bufferSize), getSampleBufferArea(sampledBounds, sampledBounds, bufferSize));
+    EXPECT_EQ(Rect(25, 25, 50, 50),
+              getSampleBufferArea(Rect(200, 300, 300, 400), sampledBounds, bufferSize));
+    // Areas smaller than the downscale factor still cover a pixel.
+    EXPECT_EQ(Rect(0, 0, 1, 1),
+              getSampleBufferArea(Rect(101, 201, 102, 202), sampledBounds, bufferSize));
+}
+
 } // namespace android
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
@@ -676,6 +676,27 @@ TEST_F(TimeStatsTest, canInsertOneLayerTimeStats) {
     }
 }
 
+TEST_F(TimeStatsTest, countsDroppedLayerEvents) {
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 1, 1000000);
+    EXPECT_THAT(mTimeStats->miniDump(), HasSubstr("Number of dropped layer events is 0\n"));
+
+    // Nothing takes the TimeStats lock in between, so these stay staged until the buffer is full.
+    constexpr size_t kStagedLimit = 1600;
+    for (size_t i = 0; i < kStagedLimit + 10; i++) {
+        mTimeStats->setLatchTime(LAYER_ID_0, 2, 2000000);
+    }
+    EXPECT_THAT(mTimeStats->miniDump(), HasSubstr("Number of dropped layer events is 10\n"));
+
+    // Staged events are still applied before the next present is folded in.
+    insertTimeRecord(NORMAL_SEQUENCE_2, LAYER_ID_0, 2, 2000000);
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+    ASSERT_EQ(1, globalProto.stats_size());
+    EXPECT_EQ(1, globalProto.stats(0).total_frames());
+}
+
 using LayerProto = SFTimeStatsLayerProto;
 using DeltaProto = SFTimeStatsDeltaProto;
 using BucketProto = SFTimeStatsHistogramBucketProto;
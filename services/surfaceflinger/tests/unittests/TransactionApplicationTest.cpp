@@ -27,6 +27,7 @@
 #include <log/log.h>
 #include <ui/MockFence.h>
 #include <utils/String8.h>
+#include <map>
 #include <vector>
 #include <binder/Binder.h>
 
@@ -37,6 +38,7 @@
 namespace android {
 
 using testing::_;
+using testing::HasSubstr;
 using testing::Return;
 
 using frontend::TransactionHandler;
@@ -1088,6 +1090,44 @@ TEST(TransactionHandlerTest, QueueTransaction) {
     EXPECT_EQ(transactionsReadyToBeApplied.front().id, 42u);
 }
 
+TEST(TransactionHandlerTest, OnlyQueuesWaitingOnBarrierAreReevaluated) {
+    using TransactionReadiness = TransactionHandler::TransactionReadiness;
+    constexpr uint64_t kNotReadyId = 1;
+    constexpr uint64_t kBarrierId = 2;
+    constexpr uint64_t kReadyId = 3;
+
+    TransactionHandler handler;
+    std::map<uint64_t, int> evaluations;
+    handler.addTransactionReadyFilter([&](const TransactionHandler::TransactionFlushState& state) {
+        const uint64_t id = state.transaction->id;
+        evaluations[id]++;
+        if (id == kNotReadyId) {
+            return TransactionReadiness::NotReady;
+        }
+        if (id == kBarrierId && state.firstTransaction) {
+            // Waits until another transaction is ready to be applied.
+            return TransactionReadiness::NotReadyBarrier;
+        }
+        return TransactionReadiness::Ready;
+    });
+
+    for (const uint64_t id : {kNotReadyId, kBarrierId, kReadyId}) {
+        TransactionState transaction;
+        transaction.applyToken = sp<BBinder>::make();
+        transaction.id = id;
+        handler.queueTransaction(std::move(transaction));
+    }
+    std::vector<TransactionState> transactionsReadyToBeApplied = handler.flushTransactions();
+
+    ASSERT_EQ(transactionsReadyToBeApplied.size(), 2u);
+    EXPECT_EQ(evaluations[kNotReadyId], 1);
+    EXPECT_EQ(evaluations[kReadyId], 1);
+
+    std::string dump;
+    handler.dump(dump);
+    EXPECT_THAT(dump, HasSubstr("1 pending queues, last flush applied 2 transactions"));
+}
+
 TEST(TransactionHandlerTest, TransactionsKeepTrackOfDirectMerges) {
     SurfaceComposerClient::Transaction transaction1, transaction2, transaction3, transaction4;
 
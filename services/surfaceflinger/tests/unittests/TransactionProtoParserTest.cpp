@@ -19,6 +19,7 @@
 #include <limits> // std::numeric_limits
 
 #include <gui/SurfaceComposerClient.h>
+#include <renderengine/mock/FakeExternalTexture.h>
 #include <ui/Rotation.h>
 #include "LayerProtoHelper.h"
 
@@ -104,6 +105,38 @@ TEST(TransactionProtoParserTest, parse) {
     ASSERT_EQ(t1.displays[0].token, t2.displays[0].token);
 }
 
+TEST(TransactionProtoParserTest, copyForTracingMatchesTransaction) {
+    TransactionState t1;
+    t1.id = 1;
+    t1.originPid = 2;
+    t1.postTime = 3;
+    t1.mergedTransactionIds = {4, 5};
+
+    ResolvedComposerState s;
+    s.layerId = 6;
+    s.state.what = layer_state_t::eBufferChanged | layer_state_t::ePositionChanged |
+            layer_state_t::eInputInfoChanged;
+    s.state.x = 7;
+    s.state.bufferData = std::make_shared<BufferData>();
+    s.state.bufferData->frameNumber = 8;
+    s.state.bufferData->cachedBuffer.id = 9;
+    s.state.windowInfoHandle->editInfo()->surfaceInset = 10;
+    auto texture = std::make_shared<renderengine::mock::FakeExternalTexture>(
+            /*width=*/11, /*height=*/12, /*id=*/13, PIXEL_FORMAT_RGBA_8888, /*usage=*/14);
+    s.externalTexture = texture;
+    t1.states.emplace_back(s);
+    s.state.bufferData.reset();
+    s.externalTexture.reset();
+
+    const TransactionState copy = TransactionProtoParser::copyForTracing(t1);
+    EXPECT_EQ(t1.states.front().externalTexture.use_count(), 2);
+    EXPECT_EQ(copy.states.front().externalTexture, nullptr);
+    EXPECT_NE(copy.states.front().state.windowInfoHandle, t1.states.front().state.windowInfoHandle);
+
+    TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+    EXPECT_EQ(parser.toProto(t1).SerializeAsString(), parser.toProto(copy).SerializeAsString());
+}
+
 TEST(TransactionProtoParserTest, parseDisplayInfo) {
     frontend::DisplayInfo d1;
     d1.info.displayId = 42;
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <android-base/file.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -91,6 +92,28 @@ protected:
     }
 };
 
+TEST_F(TransactionTracingTest, writeToFileMatchesProto) {
+    mTracing.setBufferSize(SMALL_BUFFER_SIZE);
+    for (int64_t vsyncId = 1; vsyncId <= 20; vsyncId++) {
+        queueAndCommitTransaction(vsyncId);
+    }
+
+    TemporaryFile file;
+    ASSERT_EQ(NO_ERROR, mTracing.writeToFile(file.path));
+    std::string output;
+    ASSERT_TRUE(base::ReadFileToString(file.path, &output));
+
+    proto::TransactionTraceFile fileProto;
+    ASSERT_TRUE(fileProto.ParseFromString(output));
+    const proto::TransactionTraceFile expectedProto = writeToProto();
+    EXPECT_EQ(expectedProto.magic_number(), fileProto.magic_number());
+    ASSERT_EQ(expectedProto.entry().size(), fileProto.entry().size());
+    for (int i = 0; i < fileProto.entry().size(); i++) {
+        EXPECT_EQ(expectedProto.entry(i).SerializeAsString(),
+                  fileProto.entry(i).SerializeAsString());
+    }
+}
+
 TEST_F(TransactionTracingTest, addTransactions) {
     std::vector<TransactionState> transactions;
     transactions.reserve(100);
@@ -334,4 +357,30 @@ TEST(LayerTraceTest, canStreamLayersTrace) {
     // magic?
     EXPECT_EQ(outProto.entry().size(), 3);
 }
+
+TEST(LayerTraceTest, writesNotifiedEntries) {
+    LayerTracing layerTracing;
+    ASSERT_TRUE(layerTracing.enable());
+    for (int64_t vsyncId = 1; vsyncId <= 3; vsyncId++) {
+        LayersProto layers;
+        layers.add_layers()->set_id(static_cast<int32_t>(vsyncId));
+        google::protobuf::RepeatedPtrField<DisplayProto> displays;
+        layerTracing.notify(/*visibleRegionDirty=*/true, /*time=*/vsyncId, vsyncId, &layers,
+                            /*hwcDump=*/"", &displays);
+    }
+
+    // Entries that have not been serialized by the tracing thread yet must still be written.
+    TemporaryFile file;
+    ASSERT_TRUE(layerTracing.disable(file.path));
+    std::string output;
+    ASSERT_TRUE(base::ReadFileToString(file.path, &output));
+    LayersTraceFileProto fileProto;
+    ASSERT_TRUE(fileProto.ParseFromString(output));
+    ASSERT_EQ(3, fileProto.entry().size());
+    for (int i = 0; i < fileProto.entry().size(); i++) {
+        EXPECT_EQ(i + 1, fileProto.entry(i).vsync_id());
+        ASSERT_EQ(1, fileProto.entry(i).layers().layers().size());
+        EXPECT_EQ(i + 1, fileProto.entry(i).layers().layers(0).id());
+    }
+}
 } // namespace android
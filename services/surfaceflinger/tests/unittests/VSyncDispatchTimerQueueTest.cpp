@@ -1311,6 +1311,21 @@ TEST_F(VSyncDispatchTimerQueueEntryTest, runCallbackWithReadyDuration) {
     EXPECT_THAT(*lastCalledTarget, Eq(mPeriod));
 }
 
+TEST_F(VSyncDispatchTimerQueueTest, dumpsTimerLateness) {
+    CountingCallback cb(mDispatch);
+
+    mDispatch->schedule(cb, {.workDuration = 100, .readyDuration = 0, .earliestVsync = 1000});
+    advanceToNextCallback();
+
+    mDispatch->schedule(cb, {.workDuration = 100, .readyDuration = 0, .earliestVsync = 2000});
+    mMockClock.advanceBy(1000 + 300'000);
+    ASSERT_THAT(cb.mCalls.size(), Eq(2));
+
+    std::string dump;
+    mDispatch->dump(dump);
+    EXPECT_THAT(dump, HasSubstr(" <50us=1 <100us=0 <250us=0 <500us=1 <1000us=0 "));
+}
+
 } // namespace android::scheduler
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
@@ -245,4 +245,62 @@ TEST_F(WindowInfosListenerInvokerTest, noListeners) {
     EXPECT_EQ(callCount, 1);
 }
 
+// Test that WindowInfosListenerInvoker#windowInfosChanged only sends the changed windows once a
+// listener has received all windows.
+TEST_F(WindowInfosListenerInvokerTest, sendsDeltaAfterKeyframe) {
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::vector<gui::WindowInfosUpdate> updates;
+
+    gui::WindowInfosListenerInfo listenerInfo;
+    mInvoker->addWindowInfosListener(sp<Listener>::make([&](const gui::WindowInfosUpdate& update) {
+                                         std::scoped_lock lock{mutex};
+                                         updates.push_back(update);
+                                         cv.notify_one();
+
+                                         listenerInfo.windowInfosPublisher
+                                                 ->ackWindowInfosReceived(update.vsyncId,
+                                                                          listenerInfo.listenerId);
+                                     }),
+                                     &listenerInfo);
+
+    const auto makeWindow = [](int32_t id, std::string name) {
+        gui::WindowInfo info;
+        info.id = id;
+        info.name = std::move(name);
+        return info;
+    };
+    BackgroundExecutor::getInstance().sendCallbacks({[&]() {
+        mInvoker->windowInfosChanged({{makeWindow(1, "a"), makeWindow(2, "b")},
+                                      {},
+                                      /* vsyncId= */ 1,
+                                      0},
+                                     {}, false);
+    }});
+    {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return updates.size() == 1; });
+    }
+    BackgroundExecutor::getInstance().sendCallbacks({[&]() {
+        mInvoker->windowInfosChanged({{makeWindow(1, "a"), makeWindow(3, "c")},
+                                      {},
+                                      /* vsyncId= */ 2,
+                                      0},
+                                     {}, false);
+    }});
+    {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return updates.size() == 2; });
+    }
+
+    EXPECT_FALSE(updates[0].isDelta);
+    EXPECT_EQ(updates[0].windowInfos.size(), 2u);
+    EXPECT_TRUE(updates[1].isDelta);
+    EXPECT_EQ(updates[1].baseVsyncId, 1);
+    EXPECT_EQ(updates[1].windowIds, (std::vector<int32_t>{1, 3}));
+    ASSERT_EQ(updates[1].windowInfos.size(), 1u);
+    EXPECT_EQ(updates[1].windowInfos[0].id, 3);
+}
+
 } // namespace android
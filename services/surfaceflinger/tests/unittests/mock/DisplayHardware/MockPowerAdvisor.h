@@ -62,6 +62,8 @@ public:
     MOCK_METHOD(void, setCompositeEnd, (TimePoint compositeEndTime), (override));
     MOCK_METHOD(void, setDisplays, (std::vector<DisplayId> & displayIds), (override));
     MOCK_METHOD(void, setTotalFrameTargetWorkDuration, (Duration targetDuration), (override));
+    MOCK_METHOD(void, setCompositionWorkload, (const CompositionWorkload& workload), (override));
+    MOCK_METHOD(void, dump, (std::string & result), (const, override));
 };
 
 } // namespace android::Hwc2::mock
@@ -42,6 +42,8 @@ public:
     MOCK_METHOD(void, init, (), (override));
     MOCK_METHOD(HalResult<void>, setBoost, (Boost, int32_t), (override));
     MOCK_METHOD(HalResult<void>, setMode, (Mode, bool), (override));
+    MOCK_METHOD(void, setBoostAsync, (Boost, int32_t), (override));
+    MOCK_METHOD(void, setModeAsync, (Mode, bool), (override));
     MOCK_METHOD(HalResult<sp<hardware::power::IPowerHintSession>>, createHintSession,
                 (int32_t, int32_t, const std::vector<int32_t>&, int64_t), (override));
     MOCK_METHOD(HalResult<int64_t>, getHintSessionPreferredRate, (), (override));
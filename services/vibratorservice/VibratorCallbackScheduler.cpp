@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
@@ -23,27 +24,16 @@ namespace android {
 
 namespace vibrator {
 
-// -------------------------------------------------------------------------------------------------
-
-bool DelayedCallback::isExpired() const {
-    return mExpiration <= std::chrono::steady_clock::now();
-}
-
-DelayedCallback::Timestamp DelayedCallback::getExpiration() const {
-    return mExpiration;
-}
+namespace {
 
-void DelayedCallback::run() const {
-    mCallback();
-}
+// Ids keep the slot in their lower bits, so cancel can find it without a lookup table.
+constexpr int kSlotBits = 32;
+constexpr uint64_t kSlotMask = (uint64_t(1) << kSlotBits) - 1;
 
-bool DelayedCallback::operator<(const DelayedCallback& other) const {
-    return mExpiration < other.mExpiration;
-}
+// Cancelled callbacks are only dropped from the heap once they outnumber the pending ones.
+constexpr size_t kMinStaleEntriesToCompact = 32;
 
-bool DelayedCallback::operator>(const DelayedCallback& other) const {
-    return mExpiration > other.mExpiration;
-}
+} // namespace
 
 // -------------------------------------------------------------------------------------------------
 
@@ -59,37 +49,115 @@ CallbackScheduler::~CallbackScheduler() {
 }
 
 void CallbackScheduler::schedule(std::function<void()> callback, std::chrono::milliseconds delay) {
+    scheduleCancellable(std::move(callback), delay);
+}
+
+CallbackScheduler::CallbackId CallbackScheduler::scheduleCancellable(
+        std::function<void()> callback, std::chrono::milliseconds delay) {
+    Timestamp expiration = std::chrono::steady_clock::now() + delay;
+    CallbackId id;
+    bool isNextToExpire;
     {
         std::lock_guard<std::mutex> lock(mMutex);
         if (mCallbackThread == nullptr) {
             mCallbackThread = std::make_unique<std::thread>(&CallbackScheduler::loop, this);
         }
-        mQueue.emplace(DelayedCallback(callback, delay));
+        size_t slot;
+        if (mFreeSlots.empty()) {
+            slot = mSlots.size();
+            mSlots.emplace_back();
+        } else {
+            slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+        id = (mNextId++ << kSlotBits) | slot;
+        mSlots[slot].id = id;
+        mSlots[slot].callback = std::move(callback);
+
+        isNextToExpire = mHeap.empty() || expiration < mHeap.front().expiration;
+        mHeap.push_back({expiration, id, slot});
+        std::push_heap(mHeap.begin(), mHeap.end());
+    }
+    // The callback thread only needs to wake up earlier than it planned to.
+    if (isNextToExpire) {
+        mCondition.notify_all();
+    }
+    return id;
+}
+
+bool CallbackScheduler::cancel(CallbackId id) {
+    std::function<void()> callback;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        size_t slot = id & kSlotMask;
+        if (id == INVALID_CALLBACK_ID || slot >= mSlots.size() || mSlots[slot].id != id) {
+            return false;
+        }
+        callback = std::move(mSlots[slot].callback);
+        releaseSlotLocked(slot);
+
+        if (++mStaleEntries >= kMinStaleEntriesToCompact && mStaleEntries > mHeap.size() / 2) {
+            size_t pending = 0;
+            for (const HeapEntry& entry : mHeap) {
+                if (!isStaleLocked(entry)) {
+                    mHeap[pending++] = entry;
+                }
+            }
+            mHeap.resize(pending);
+            std::make_heap(mHeap.begin(), mHeap.end());
+            mStaleEntries = 0;
+        }
+    }
+    // The callback is destroyed outside the lock, as it may hold the last reference to anything.
+    return true;
+}
+
+bool CallbackScheduler::isStaleLocked(const HeapEntry& entry) const {
+    return mSlots[entry.slot].id != entry.id;
+}
+
+void CallbackScheduler::releaseSlotLocked(size_t slot) {
+    mSlots[slot].id = INVALID_CALLBACK_ID;
+    mSlots[slot].callback = nullptr;
+    mFreeSlots.push_back(slot);
+}
+
+void CallbackScheduler::popStaleEntriesLocked() {
+    while (!mHeap.empty() && isStaleLocked(mHeap.front())) {
+        std::pop_heap(mHeap.begin(), mHeap.end());
+        mHeap.pop_back();
+        mStaleEntries--;
     }
-    mCondition.notify_all();
 }
 
 void CallbackScheduler::loop() {
+    std::unique_lock<std::mutex> lock(mMutex);
     while (true) {
-        std::unique_lock<std::mutex> lock(mMutex);
         if (mFinished) {
             // Destructor was called, so let the callback thread die.
             break;
         }
-        while (!mQueue.empty() && mQueue.top().isExpired()) {
-            DelayedCallback callback = mQueue.top();
-            mQueue.pop();
-            lock.unlock();
-            callback.run();
-            lock.lock();
-        }
-        if (mQueue.empty()) {
+        popStaleEntriesLocked();
+        if (mHeap.empty()) {
             // Wait until a new callback is scheduled.
-            mCondition.wait(mMutex);
-        } else {
-            // Wait until next callback expires, or a new one is scheduled.
-            mCondition.wait_until(mMutex, mQueue.top().getExpiration());
+            mCondition.wait(lock);
+            continue;
+        }
+        const HeapEntry next = mHeap.front();
+        if (next.expiration > std::chrono::steady_clock::now()) {
+            // Wait until next callback expires, or an earlier one is scheduled.
+            mCondition.wait_until(lock, next.expiration);
+            continue;
         }
+        std::pop_heap(mHeap.begin(), mHeap.end());
+        mHeap.pop_back();
+        std::function<void()> callback = std::move(mSlots[next.slot].callback);
+        releaseSlotLocked(next.slot);
+
+        lock.unlock();
+        callback();
+        callback = nullptr;
+        lock.lock();
     }
 }
 
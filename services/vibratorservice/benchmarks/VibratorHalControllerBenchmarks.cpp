@@ -17,8 +17,13 @@
 #define LOG_TAG "VibratorHalControllerBenchmarks"
 
 #include <benchmark/benchmark.h>
+#include <vibratorservice/VibratorCallbackScheduler.h>
 #include <vibratorservice/VibratorHalController.h>
 
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+
 using ::android::enum_range;
 using ::android::hardware::vibrator::CompositeEffect;
 using ::android::hardware::vibrator::CompositePrimitive;
@@ -468,4 +473,67 @@ BENCHMARK_WRAPPER(VibratorPrimitivesBench, performComposedEffect, {
     }
 });
 
+class VibratorSchedulerBench : public Fixture {
+public:
+    static void DefaultConfig(Benchmark* b) { b->Unit(kMicrosecond); }
+
+    static void DefaultArgs(Benchmark* b) {
+        b->ArgNames({"DelayMs"});
+        b->Args({1});
+        b->Args({10});
+    }
+
+protected:
+    vibrator::CallbackScheduler mScheduler;
+
+    auto getDelay(const State& state) const { return std::chrono::milliseconds(state.range(0)); }
+};
+
+BENCHMARK_WRAPPER(VibratorSchedulerBench, scheduleAndCancel, {
+    auto delay = getDelay(state);
+    auto callback = []() {};
+
+    for (auto _ : state) {
+        auto id = mScheduler.scheduleCancellable(callback, delay);
+        mScheduler.cancel(id);
+    }
+});
+
+BENCHMARK_WRAPPER(VibratorSchedulerBench, scheduleLatency, {
+    auto delay = getDelay(state);
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+    std::chrono::steady_clock::time_point runTime;
+    auto callback = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        runTime = std::chrono::steady_clock::now();
+        done = true;
+        condition.notify_all();
+    };
+
+    // How late the callbacks run after their delay, in microseconds.
+    double sum = 0, sumOfSquares = 0, max = 0;
+    for (auto _ : state) {
+        auto expiration = std::chrono::steady_clock::now() + delay;
+        mScheduler.schedule(callback, delay);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&]() { return done; });
+        done = false;
+
+        double latency =
+                std::chrono::duration<double, std::micro>(runTime - expiration).count();
+        sum += latency;
+        sumOfSquares += latency * latency;
+        max = std::max(max, latency);
+    }
+
+    double mean = sum / state.iterations();
+    state.counters["latency_us"] = Counter(mean);
+    state.counters["jitter_us"] =
+            Counter(std::sqrt(std::max(0.0, sumOfSquares / state.iterations() - mean * mean)));
+    state.counters["max_latency_us"] = Counter(max);
+});
+
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -20,44 +20,59 @@
 #include <android-base/thread_annotations.h>
 #include <chrono>
 #include <condition_variable>
-#include <queue>
+#include <functional>
 #include <thread>
+#include <vector>
 
 namespace android {
 
 namespace vibrator {
 
-// Wrapper for a callback to be executed after a delay.
-class DelayedCallback {
+// Schedules callbacks to be executed after a delay.
+//
+// Pending callbacks are kept in a pool of slots that is reused across calls, and ordered by their
+// expiration in a heap of slot references, so scheduling does not allocate once the pool has grown
+// to the number of concurrently pending callbacks. Cancelling only frees the slot, and the stale
+// heap reference is skipped when it reaches the top.
+class CallbackScheduler {
 public:
     using Timestamp = std::chrono::time_point<std::chrono::steady_clock>;
 
-    DelayedCallback(std::function<void()> callback, std::chrono::milliseconds delay)
-          : mCallback(callback), mExpiration(std::chrono::steady_clock::now() + delay) {}
-    ~DelayedCallback() = default;
-
-    void run() const;
-    bool isExpired() const;
-    Timestamp getExpiration() const;
-
-    // Compare by expiration time, where A < B when A expires first.
-    bool operator<(const DelayedCallback& other) const;
-    bool operator>(const DelayedCallback& other) const;
-
-private:
-    std::function<void()> mCallback;
-    Timestamp mExpiration;
-};
+    // Identifies a scheduled callback. Never reused by the same scheduler.
+    using CallbackId = uint64_t;
+    static constexpr CallbackId INVALID_CALLBACK_ID = 0;
 
-// Schedules callbacks to be executed after a delay.
-class CallbackScheduler {
-public:
     CallbackScheduler() : mCallbackThread(nullptr), mFinished(false) {}
     virtual ~CallbackScheduler();
 
     virtual void schedule(std::function<void()> callback, std::chrono::milliseconds delay);
 
+    // Same as schedule, but returns an id that can be used to cancel the callback.
+    CallbackId scheduleCancellable(std::function<void()> callback,
+                                   std::chrono::milliseconds delay);
+
+    // Drops the callback if it did not start running yet. Returns true if it was dropped.
+    bool cancel(CallbackId id);
+
 private:
+    struct Slot {
+        CallbackId id = INVALID_CALLBACK_ID;
+        std::function<void()> callback;
+    };
+
+    struct HeapEntry {
+        Timestamp expiration;
+        CallbackId id;
+        size_t slot;
+
+        // Reverse order, so the heap has the callback that expires first on top, with ties
+        // running in the order they were scheduled.
+        bool operator<(const HeapEntry& other) const {
+            return expiration != other.expiration ? expiration > other.expiration
+                                                  : id > other.id;
+        }
+    };
+
     std::condition_variable_any mCondition;
     std::mutex mMutex;
 
@@ -67,11 +82,16 @@ private:
     // Used to quit the callback thread when this instance is being destroyed.
     bool mFinished GUARDED_BY(mMutex);
 
-    // Priority queue with reverse comparator, so tasks that expire first will be on top.
-    std::priority_queue<DelayedCallback, std::vector<DelayedCallback>,
-                        std::greater<DelayedCallback>>
-            mQueue GUARDED_BY(mMutex);
+    CallbackId mNextId GUARDED_BY(mMutex) = INVALID_CALLBACK_ID + 1;
+    std::vector<Slot> mSlots GUARDED_BY(mMutex);
+    std::vector<size_t> mFreeSlots GUARDED_BY(mMutex);
+    std::vector<HeapEntry> mHeap GUARDED_BY(mMutex);
+    // Heap entries whose callback was cancelled.
+    size_t mStaleEntries GUARDED_BY(mMutex) = 0;
 
+    bool isStaleLocked(const HeapEntry& entry) const REQUIRES(mMutex);
+    void releaseSlotLocked(size_t slot) REQUIRES(mMutex);
+    void popStaleEntriesLocked() REQUIRES(mMutex);
     void loop();
 };
 
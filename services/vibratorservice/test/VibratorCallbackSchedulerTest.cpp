@@ -122,3 +122,38 @@ TEST_F(VibratorCallbackSchedulerTest, TestDestructorDropsPendingCallbacksAndKill
     ASSERT_FALSE(waitForCallbacks(1, 10ms));
     ASSERT_TRUE(getExpiredCallbacks().empty());
 }
+
+TEST_F(VibratorCallbackSchedulerTest, TestCancelDropsCallback) {
+    auto id = mScheduler->scheduleCancellable(createCallback(1), 5ms);
+    mScheduler->schedule(createCallback(2), 10ms);
+    ASSERT_TRUE(mScheduler->cancel(id));
+
+    ASSERT_TRUE(waitForCallbacks(1, 15ms));
+    ASSERT_THAT(getExpiredCallbacks(), ElementsAre(2));
+}
+
+TEST_F(VibratorCallbackSchedulerTest, TestCancelAfterRunOrTwiceFails) {
+    auto id = mScheduler->scheduleCancellable(createCallback(1), 1ms);
+    ASSERT_TRUE(waitForCallbacks(1, 10ms));
+    ASSERT_FALSE(mScheduler->cancel(id));
+    ASSERT_FALSE(mScheduler->cancel(vibrator::CallbackScheduler::INVALID_CALLBACK_ID));
+
+    id = mScheduler->scheduleCancellable(createCallback(2), 5ms);
+    ASSERT_TRUE(mScheduler->cancel(id));
+    ASSERT_FALSE(mScheduler->cancel(id));
+}
+
+TEST_F(VibratorCallbackSchedulerTest, TestCancelManyKeepsPendingOrder) {
+    std::vector<vibrator::CallbackScheduler::CallbackId> ids;
+    for (int i = 0; i < 100; i++) {
+        ids.push_back(mScheduler->scheduleCancellable(createCallback(100 + i), 5ms));
+    }
+    mScheduler->schedule(createCallback(2), 10ms);
+    mScheduler->schedule(createCallback(1), 8ms);
+    for (auto id : ids) {
+        ASSERT_TRUE(mScheduler->cancel(id));
+    }
+
+    ASSERT_TRUE(waitForCallbacks(2, 20ms));
+    ASSERT_THAT(getExpiredCallbacks(), ElementsAre(1, 2));
+}
@@ -1201,7 +1201,6 @@ bool EnsureInitialized() {
 
     init_attempted_for_pid = getpid();
     if (driver::OpenHAL()) {
-        DiscoverLayers();
         initialized = true;
     }
 
@@ -662,6 +662,8 @@ void CreateInfoWrapper::FilterExtension(const char* name) {
             case ProcHook::ANDROID_external_memory_android_hardware_buffer:
             case ProcHook::ANDROID_native_buffer:
             case ProcHook::GOOGLE_display_timing:
+            case ProcHook::KHR_present_id:
+            case ProcHook::KHR_present_wait:
             case ProcHook::KHR_external_fence_fd:
             case ProcHook::EXTENSION_CORE_1_0:
             case ProcHook::EXTENSION_CORE_1_1:
@@ -695,6 +697,8 @@ void CreateInfoWrapper::FilterExtension(const char* name) {
             case ProcHook::KHR_incremental_present:
             case ProcHook::KHR_shared_presentable_image:
             case ProcHook::GOOGLE_display_timing:
+            case ProcHook::KHR_present_id:
+            case ProcHook::KHR_present_wait:
                 hook_extensions_.set(ext_bit);
                 // return now as these extensions do not require HAL support
                 return;
@@ -1163,6 +1167,13 @@ VkResult EnumerateDeviceExtensionProperties(
         loader_extensions.push_back({
                 VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME,
                 VK_GOOGLE_DISPLAY_TIMING_SPEC_VERSION});
+        // VK_KHR_present_wait is implemented with the same frame timestamps
+        loader_extensions.push_back({
+                VK_KHR_PRESENT_ID_EXTENSION_NAME,
+                VK_KHR_PRESENT_ID_SPEC_VERSION});
+        loader_extensions.push_back({
+                VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+                VK_KHR_PRESENT_WAIT_SPEC_VERSION});
     }
 
     // Conditionally add VK_EXT_IMAGE_COMPRESSION_CONTROL* if feature and ANB
@@ -1717,6 +1728,20 @@ void GetPhysicalDeviceFeatures2(VkPhysicalDevice physicalDevice,
                 smf->swapchainMaintenance1 = true;
             } break;
 
+            case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR: {
+                auto pif = reinterpret_cast<VkPhysicalDevicePresentIdFeaturesKHR*>(
+                        pFeats);
+                pif->presentId = android::base::GetBoolProperty(
+                        "service.sf.present_timestamp", false);
+            } break;
+
+            case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR: {
+                auto pwf = reinterpret_cast<VkPhysicalDevicePresentWaitFeaturesKHR*>(
+                        pFeats);
+                pwf->presentWait = android::base::GetBoolProperty(
+                        "service.sf.present_timestamp", false);
+            } break;
+
             default:
                 break;
         }
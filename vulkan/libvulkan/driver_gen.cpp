@@ -171,6 +171,15 @@ VKAPI_ATTR VkResult checkedReleaseSwapchainImagesEXT(VkDevice device, const VkRe
     }
 }
 
+VKAPI_ATTR VkResult checkedWaitForPresentKHR(VkDevice device, VkSwapchainKHR swapchain, uint64_t presentId, uint64_t timeout) {
+    if (GetData(device).hook_extensions[ProcHook::KHR_present_wait]) {
+        return WaitForPresentKHR(device, swapchain, presentId, timeout);
+    } else {
+        Logger(device).Err(device, "VK_KHR_present_wait not enabled. vkWaitForPresentKHR not executed.");
+        return VK_SUCCESS;
+    }
+}
+
 // clang-format on
 
 const ProcHook g_proc_hooks[] = {
@@ -574,6 +583,13 @@ const ProcHook g_proc_hooks[] = {
         reinterpret_cast<PFN_vkVoidFunction>(SetHdrMetadataEXT),
         reinterpret_cast<PFN_vkVoidFunction>(checkedSetHdrMetadataEXT),
     },
+    {
+        "vkWaitForPresentKHR",
+        ProcHook::DEVICE,
+        ProcHook::KHR_present_wait,
+        reinterpret_cast<PFN_vkVoidFunction>(WaitForPresentKHR),
+        reinterpret_cast<PFN_vkVoidFunction>(checkedWaitForPresentKHR),
+    },
     // clang-format on
 };
 
@@ -605,6 +621,8 @@ ProcHook::Extension GetProcHookExtension(const char* name) {
     if (strcmp(name, "VK_KHR_swapchain") == 0) return ProcHook::KHR_swapchain;
     if (strcmp(name, "VK_EXT_swapchain_maintenance1") == 0) return ProcHook::EXT_swapchain_maintenance1;
     if (strcmp(name, "VK_EXT_surface_maintenance1") == 0) return ProcHook::EXT_surface_maintenance1;
+    if (strcmp(name, "VK_KHR_present_id") == 0) return ProcHook::KHR_present_id;
+    if (strcmp(name, "VK_KHR_present_wait") == 0) return ProcHook::KHR_present_wait;
     if (strcmp(name, "VK_ANDROID_external_memory_android_hardware_buffer") == 0) return ProcHook::ANDROID_external_memory_android_hardware_buffer;
     if (strcmp(name, "VK_KHR_bind_memory2") == 0) return ProcHook::KHR_bind_memory2;
     if (strcmp(name, "VK_KHR_get_physical_device_properties2") == 0) return ProcHook::KHR_get_physical_device_properties2;
@@ -23,6 +23,7 @@
 #include <dlfcn.h>
 #include <string.h>
 #include <sys/prctl.h>
+#include <unistd.h>
 
 #include <mutex>
 #include <string>
@@ -35,6 +36,7 @@
 #include <log/log.h>
 #include <nativebridge/native_bridge.h>
 #include <nativeloader/native_loader.h>
+#include <utils/Timers.h>
 #include <utils/Trace.h>
 #include <ziparchive/zip_archive.h>
 
@@ -456,19 +458,39 @@ void* GetLayerGetProcAddr(const Layer& layer,
     return library.GetGPA(layer, gpa_name);
 }
 
-}  // anonymous namespace
-
 void DiscoverLayers() {
     ATRACE_CALL();
 
-    if (android::GraphicsEnv::getInstance().isDebuggable()) {
+    static pid_t discovered_for_pid = 0;
+    static std::mutex discovery_lock;
+
+    std::lock_guard<std::mutex> lock(discovery_lock);
+    if (discovered_for_pid == getpid())
+        return;
+    discovered_for_pid = getpid();
+
+    const bool search_system_dir =
+        android::GraphicsEnv::getInstance().isDebuggable();
+    const std::string& layer_paths =
+        android::GraphicsEnv::getInstance().getLayerPaths();
+    if (!search_system_dir && layer_paths.empty())
+        return;
+
+    const nsecs_t discovery_time = systemTime();
+    if (search_system_dir)
         DiscoverLayersInPathList(kSystemLayerLibraryDir);
-    }
-    if (!android::GraphicsEnv::getInstance().getLayerPaths().empty())
-        DiscoverLayersInPathList(android::GraphicsEnv::getInstance().getLayerPaths());
+    if (!layer_paths.empty())
+        DiscoverLayersInPathList(layer_paths);
+
+    android::GraphicsEnv::getInstance().setTargetStats(
+        android::GpuStatsInfo::Stats::VULKAN_LAYER_DISCOVERY_TIME,
+        systemTime() - discovery_time);
 }
 
+}  // anonymous namespace
+
 uint32_t GetLayerCount() {
+    DiscoverLayers();
     return static_cast<uint32_t>(g_instance_layers.size());
 }
 
@@ -477,6 +499,7 @@ const Layer& GetLayer(uint32_t index) {
 }
 
 const Layer* FindLayer(const char* name) {
+    DiscoverLayers();
     auto layer =
         std::find_if(g_instance_layers.cbegin(), g_instance_layers.cend(),
                      [=](const Layer& entry) {
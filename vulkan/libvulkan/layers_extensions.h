@@ -43,8 +43,8 @@ class LayerRef {
     const Layer* layer_;
 };
 
-void DiscoverLayers();
-
+// Layers are discovered the first time they are looked up, so that processes
+// which don't use any layers never scan the layer paths.
 uint32_t GetLayerCount();
 const Layer& GetLayer(uint32_t index);
 const Layer* FindLayer(const char* name);
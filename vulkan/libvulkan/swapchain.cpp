@@ -32,6 +32,8 @@
 #include <utils/Trace.h>
 
 #include <algorithm>
+#include <deque>
+#include <mutex>
 #include <unordered_set>
 #include <vector>
 
@@ -265,7 +267,12 @@ struct Swapchain {
           frame_timestamps_enabled(false),
           refresh_duration(refresh_duration_),
           acquire_next_image_timeout(-1),
-          shared(IsSharedPresentMode(present_mode)) {
+          shared(IsSharedPresentMode(present_mode)),
+          present_mode(present_mode),
+          buffers_reusable(false),
+          min_undequeued_buffers(0),
+          native_usage(0),
+          completed_present_id(0) {
     }
 
     VkResult get_refresh_duration(uint64_t& outRefreshDuration)
@@ -292,6 +299,20 @@ struct Swapchain {
     nsecs_t acquire_next_image_timeout;
     bool shared;
 
+    // The parameters the gralloc buffers were allocated with. A swapchain
+    // recreated from this one with the same parameters takes over the buffers
+    // instead of reallocating them, see CanReuseSwapchainBuffers.
+    VkPresentModeKHR present_mode;
+    bool buffers_reusable;
+    VkFormat image_format;
+    VkColorSpaceKHR image_color_space;
+    VkExtent2D image_extent;
+    VkImageUsageFlags image_usage;
+    VkSwapchainCreateFlagsKHR create_flags;
+    uint32_t min_image_count;
+    uint32_t min_undequeued_buffers;
+    uint64_t native_usage;
+
     struct Image {
         Image()
             : image(VK_NULL_HANDLE),
@@ -316,6 +337,18 @@ struct Swapchain {
     } images[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
 
     std::vector<TimingInfo> timing;
+
+    // KHR_present_id / KHR_present_wait bookkeeping. Presents that carry an
+    // id are recorded with their native frame id until the frame timestamps
+    // show them on screen. WaitForPresentKHR may be called from another
+    // thread than QueuePresentKHR, so these are guarded by present_id_mutex.
+    struct PendingPresentId {
+        uint64_t present_id;
+        uint64_t native_frame_id;
+    };
+    std::mutex present_id_mutex;
+    std::deque<PendingPresentId> pending_present_ids;
+    uint64_t completed_present_id;
 };
 
 VkSwapchainKHR HandleFromSwapchain(Swapchain* swapchain) {
@@ -409,6 +442,8 @@ void OrphanSwapchain(VkDevice device, Swapchain* swapchain) {
     }
     swapchain->surface.swapchain_handle = VK_NULL_HANDLE;
     swapchain->timing.clear();
+    std::lock_guard<std::mutex> lock(swapchain->present_id_mutex);
+    swapchain->pending_present_ids.clear();
 }
 
 uint32_t get_num_ready_timings(Swapchain& swapchain) {
@@ -1308,6 +1343,55 @@ VkResult GetPhysicalDevicePresentRectanglesKHR(VkPhysicalDevice,
     return VK_SUCCESS;
 }
 
+// Whether the swapchain being created from create_info can take over the gralloc
+// buffers of old_swapchain instead of reconnecting to the native window, which
+// frees all of them. This is the common case when an app recreates its
+// swapchain after a rotation with pre-rotation, or after VK_SUBOPTIMAL_KHR.
+static bool CanReuseSwapchainBuffers(const Swapchain& old_swapchain,
+                                     const VkSwapchainCreateInfoKHR* create_info) {
+    if (!old_swapchain.buffers_reusable ||
+        old_swapchain.present_mode != create_info->presentMode ||
+        old_swapchain.image_format != create_info->imageFormat ||
+        old_swapchain.image_color_space != create_info->imageColorSpace ||
+        old_swapchain.image_extent.width != create_info->imageExtent.width ||
+        old_swapchain.image_extent.height != create_info->imageExtent.height ||
+        old_swapchain.image_usage != create_info->imageUsage ||
+        old_swapchain.create_flags != create_info->flags ||
+        old_swapchain.min_image_count != create_info->minImageCount ||
+        create_info->imageSharingMode != VK_SHARING_MODE_EXCLUSIVE) {
+        return false;
+    }
+
+    // The image compression control struct changes the gralloc usage.
+    for (const VkBaseInStructure* next =
+             reinterpret_cast<const VkBaseInStructure*>(create_info->pNext);
+         next; next = next->pNext) {
+        if (next->sType == VK_STRUCTURE_TYPE_IMAGE_COMPRESSION_CONTROL_EXT) {
+            return false;
+        }
+    }
+
+    // Without reconnecting, buffers the app still holds from the old swapchain
+    // would never be returned to the queue.
+    for (uint32_t i = 0; i < old_swapchain.num_images; i++) {
+        if (old_swapchain.images[i].dequeued || !old_swapchain.images[i].buffer) {
+            return false;
+        }
+    }
+
+    // The window is still configured with the old swapchain's present mode, so
+    // this is the value the new swapchain derives its image count from.
+    ANativeWindow* window = old_swapchain.surface.window.get();
+    int min_undequeued_buffers;
+    if (window->query(window, NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS,
+                      &min_undequeued_buffers) != android::OK ||
+        static_cast<uint32_t>(min_undequeued_buffers) !=
+            old_swapchain.min_undequeued_buffers) {
+        return false;
+    }
+    return true;
+}
+
 static void DestroySwapchainInternal(VkDevice device,
                                      VkSwapchainKHR swapchain_handle,
                                      const VkAllocationCallbacks* allocator) {
@@ -1350,6 +1434,7 @@ VkResult CreateSwapchainKHR(VkDevice device,
                             VkSwapchainKHR* swapchain_handle) {
     ATRACE_CALL();
 
+    const nsecs_t create_start = systemTime();
     int err;
     VkResult result = VK_SUCCESS;
 
@@ -1403,8 +1488,21 @@ VkResult CreateSwapchainKHR(VkDevice device,
               reinterpret_cast<uint64_t>(create_info->oldSwapchain));
         return VK_ERROR_NATIVE_WINDOW_IN_USE_KHR;
     }
-    if (create_info->oldSwapchain != VK_NULL_HANDLE)
-        OrphanSwapchain(device, SwapchainFromHandle(create_info->oldSwapchain));
+
+    // Orphaning the old swapchain drops its references to the buffers, so
+    // take them first if they can be reused.
+    std::vector<android::sp<ANativeWindowBuffer>> reused_buffers;
+    uint64_t reused_native_usage = 0;
+    if (create_info->oldSwapchain != VK_NULL_HANDLE) {
+        Swapchain& old_swapchain = *SwapchainFromHandle(create_info->oldSwapchain);
+        if (CanReuseSwapchainBuffers(old_swapchain, create_info)) {
+            for (uint32_t i = 0; i < old_swapchain.num_images; i++) {
+                reused_buffers.push_back(old_swapchain.images[i].buffer);
+            }
+            reused_native_usage = old_swapchain.native_usage;
+        }
+        OrphanSwapchain(device, &old_swapchain);
+    }
 
     // -- Reset the native window --
     // The native window might have been used previously, and had its properties
@@ -1418,11 +1516,13 @@ VkResult CreateSwapchainKHR(VkDevice device,
     // orphans the previous buffers, getting us back to the state where we can
     // dequeue all buffers.
     //
-    // This is not necessary if the surface was never used previously.
-    //
-    // TODO(http://b/134186185) recycle swapchain images more efficiently
+    // This is not necessary if the surface was never used previously, or if
+    // the buffers of the old swapchain are reused as they are.
     ANativeWindow* window = surface.window.get();
-    if (surface.used_by_swapchain) {
+    if (!reused_buffers.empty()) {
+        // Reconnecting would also have turned the timestamps off.
+        native_window_enable_frame_timestamps(window, false);
+    } else if (surface.used_by_swapchain) {
         err = native_window_api_disconnect(window, NATIVE_WINDOW_API_EGL);
         ALOGW_IF(err != android::OK,
                  "native_window_api_disconnect failed: %s (%d)", strerror(-err),
@@ -1692,6 +1792,24 @@ VkResult CreateSwapchainKHR(VkDevice device,
         return VK_ERROR_SURFACE_LOST_KHR;
     }
 
+    if (!reused_buffers.empty() && reused_native_usage != native_usage) {
+        // This is not expected with identical create parameters. The queue
+        // will hand out new buffers, which AcquireNextImageKHR reports as
+        // VK_ERROR_OUT_OF_DATE_KHR; buffers_reusable stays false below so the
+        // next swapchain reconnects.
+        ALOGW("Swapchain buffers can't be reused: usage %#" PRIx64 " vs %#" PRIx64,
+              reused_native_usage, native_usage);
+    }
+
+    // Start allocating the new buffers while the rest of the swapchain is set
+    // up. Surfaces backed by a BLASTBufferQueue allocate on another thread,
+    // the dequeues below wait for the allocation to complete.
+    if (reused_buffers.empty() &&
+        !(create_info->flags & VK_SWAPCHAIN_CREATE_DEFERRED_MEMORY_ALLOCATION_BIT_EXT) &&
+        !IsSharedPresentMode(create_info->presentMode)) {
+        window->perform(window, NATIVE_WINDOW_ALLOCATE_BUFFERS);
+    }
+
     int transform_hint;
     err = window->query(window, NATIVE_WINDOW_TRANSFORM_HINT, &transform_hint);
     if (err != android::OK) {
@@ -1781,6 +1899,35 @@ VkResult CreateSwapchainKHR(VkDevice device,
                 break;
             }
         }
+    } else if (!reused_buffers.empty()) {
+        // -- Create a VkImage for each buffer of the old swapchain --
+        // The buffers stay in the queue, there is nothing to dequeue.
+        ALOG_ASSERT(reused_buffers.size() == num_images,
+                    "reusing %zu buffers for %u images", reused_buffers.size(), num_images);
+        for (uint32_t i = 0; i < num_images; i++) {
+            Swapchain::Image& img = swapchain->images[i];
+            img.buffer = reused_buffers[i];
+            img.dequeued = false;
+
+            image_native_buffer.handle = img.buffer->handle;
+            image_native_buffer.stride = img.buffer->stride;
+            image_native_buffer.format = img.buffer->format;
+            image_native_buffer.usage = int(img.buffer->usage);
+            android_convertGralloc0To1Usage(int(img.buffer->usage),
+                &image_native_buffer.usage2.producer,
+                &image_native_buffer.usage2.consumer);
+            image_native_buffer.usage3 = img.buffer->usage;
+            image_create.pNext = &image_native_buffer;
+
+            ATRACE_BEGIN("CreateImage");
+            result =
+                dispatch.CreateImage(device, &image_create, nullptr, &img.image);
+            ATRACE_END();
+            if (result != VK_SUCCESS) {
+                ALOGD("vkCreateImage w/ reused native buffer failed: %u", result);
+                break;
+            }
+        }
     } else {
         // -- Dequeue all buffers and create a VkImage for each --
         // Any failures during or after this must cancel the dequeued buffers.
@@ -1853,9 +2000,28 @@ VkResult CreateSwapchainKHR(VkDevice device,
             android::GpuStatsInfo::Stats::FALSE_PREROTATION);
     }
 
+    swapchain->image_format = create_info->imageFormat;
+    swapchain->image_color_space = create_info->imageColorSpace;
+    swapchain->image_extent = create_info->imageExtent;
+    swapchain->image_usage = create_info->imageUsage;
+    swapchain->create_flags = create_info->flags;
+    swapchain->min_image_count = create_info->minImageCount;
+    swapchain->min_undequeued_buffers = min_undequeued_buffers;
+    swapchain->native_usage = native_usage;
+    swapchain->buffers_reusable =
+        !swapchain->shared &&
+        !(create_info->flags & VK_SWAPCHAIN_CREATE_DEFERRED_MEMORY_ALLOCATION_BIT_EXT) &&
+        (reused_buffers.empty() || reused_native_usage == native_usage);
+
     // Set stats for creating a Vulkan swapchain
     android::GraphicsEnv::getInstance().setTargetStats(
         android::GpuStatsInfo::Stats::CREATED_VULKAN_SWAPCHAIN);
+    const nsecs_t create_time = systemTime() - create_start;
+    ALOGV("vkCreateSwapchainKHR took %" PRId64 "ns, %s buffers", create_time,
+          reused_buffers.empty() ? "allocated" : "reused");
+    android::GraphicsEnv::getInstance().setTargetStats(
+        android::GpuStatsInfo::Stats::VULKAN_SWAPCHAIN_CREATE_TIME,
+        static_cast<uint64_t>(create_time));
 
     surface.used_by_swapchain = true;
     surface.swapchain_handle = HandleFromSwapchain(swapchain);
@@ -2143,6 +2309,69 @@ static void SetSwapchainFrameTimestamp(Swapchain &swapchain, const VkPresentTime
     }
 }
 
+// KHR_present_id aspect of QueuePresentKHR
+static void SetSwapchainPresentId(Swapchain &swapchain, uint64_t presentId) {
+    ANativeWindow *window = swapchain.surface.window.get();
+
+    // Present waits are answered from the frame timestamps, enable them on the
+    // BQ the first time an id is supplied.
+    if (!swapchain.frame_timestamps_enabled) {
+        ALOGV("Calling native_window_enable_frame_timestamps(true)");
+        native_window_enable_frame_timestamps(window, true);
+        swapchain.frame_timestamps_enabled = true;
+    }
+
+    uint64_t nativeFrameId = 0;
+    int err = native_window_get_next_frame_id(window, &nativeFrameId);
+    if (err != android::OK) {
+        ALOGE("Failed to get next native frame ID.");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(swapchain.present_id_mutex);
+    swapchain.pending_present_ids.push_back({presentId, nativeFrameId});
+    // The BQ only keeps the timestamps of the last few frames, older entries
+    // can't be resolved anymore and are considered presented.
+    while (swapchain.pending_present_ids.size() > MAX_TIMING_INFOS) {
+        swapchain.completed_present_id = std::max(
+            swapchain.completed_present_id,
+            swapchain.pending_present_ids.front().present_id);
+        swapchain.pending_present_ids.pop_front();
+    }
+}
+
+// Retire the recorded presents whose frames have reached the display, in
+// queue order. Must be called with present_id_mutex held.
+static void UpdateCompletedPresentIds(Swapchain &swapchain) {
+    ANativeWindow *window = swapchain.surface.window.get();
+    while (!swapchain.pending_present_ids.empty()) {
+        const Swapchain::PendingPresentId& pending =
+            swapchain.pending_present_ids.front();
+        int64_t actual_present_time = NATIVE_WINDOW_TIMESTAMP_PENDING;
+        int err = native_window_get_frame_timestamps(
+            window, pending.native_frame_id,
+            nullptr,  //&desired_present_time,
+            nullptr,  //&render_complete_time,
+            nullptr,  //&composition_latch_time,
+            nullptr,  //&first_composition_start_time,
+            nullptr,  //&last_composition_start_time,
+            nullptr,  //&composition_finish_time,
+            &actual_present_time,
+            nullptr,  //&dequeue_ready_time,
+            nullptr /*&reads_done_time*/);
+        // A frame that is no longer in the timestamp history, or that was
+        // dropped (e.g. replaced in mailbox mode), will never be presented and
+        // must not block the waiters.
+        if (err == android::OK &&
+            actual_present_time == NATIVE_WINDOW_TIMESTAMP_PENDING) {
+            break;
+        }
+        swapchain.completed_present_id =
+            std::max(swapchain.completed_present_id, pending.present_id);
+        swapchain.pending_present_ids.pop_front();
+    }
+}
+
 // EXT_swapchain_maintenance1 present mode change
 static bool SetSwapchainPresentMode(ANativeWindow *window, VkPresentModeKHR mode) {
     // There is no dynamic switching between non-shared present modes.
@@ -2167,6 +2396,7 @@ static VkResult PresentOneSwapchain(
         uint32_t imageIndex,
         const VkPresentRegionKHR *pRegion,
         const VkPresentTimeGOOGLE *pTime,
+        uint64_t presentId,
         VkFence presentFence,
         const VkPresentModeKHR *pPresentMode,
         uint32_t waitSemaphoreCount,
@@ -2221,6 +2451,9 @@ static VkResult PresentOneSwapchain(
             if (pTime) {
                 SetSwapchainFrameTimestamp(swapchain, pTime);
             }
+            if (presentId) {
+                SetSwapchainPresentId(swapchain, presentId);
+            }
             if (pPresentMode) {
                 if (!SetSwapchainPresentMode(window, *pPresentMode))
                     swapchain_result = WorstPresentResult(swapchain_result,
@@ -2308,6 +2541,7 @@ VkResult QueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* present_info) {
     const VkPresentTimesInfoGOOGLE* present_times = nullptr;
     const VkSwapchainPresentFenceInfoEXT* present_fences = nullptr;
     const VkSwapchainPresentModeInfoEXT* present_modes = nullptr;
+    const VkPresentIdKHR* present_ids = nullptr;
 
     const VkPresentRegionsKHR* next =
         reinterpret_cast<const VkPresentRegionsKHR*>(present_info->pNext);
@@ -2328,6 +2562,9 @@ VkResult QueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* present_info) {
                 present_modes =
                     reinterpret_cast<const VkSwapchainPresentModeInfoEXT*>(next);
                 break;
+            case VK_STRUCTURE_TYPE_PRESENT_ID_KHR:
+                present_ids = reinterpret_cast<const VkPresentIdKHR*>(next);
+                break;
             default:
                 ALOGV("QueuePresentKHR ignoring unrecognized pNext->sType = %x",
                       next->sType);
@@ -2351,6 +2588,10 @@ VkResult QueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* present_info) {
              present_modes->swapchainCount != present_info->swapchainCount,
              "VkSwapchainPresentModeInfoEXT::swapchainCount != "
              "VkPresentInfo::swapchainCount");
+    ALOGV_IF(present_ids &&
+             present_ids->swapchainCount != present_info->swapchainCount,
+             "VkPresentIdKHR::swapchainCount != "
+             "VkPresentInfo::swapchainCount");
 
     const VkPresentRegionKHR* regions =
         (present_regions) ? present_regions->pRegions : nullptr;
@@ -2367,6 +2608,8 @@ VkResult QueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* present_info) {
             present_info->pImageIndices[sc],
             (regions && !swapchain.mailbox_mode) ? &regions[sc] : nullptr,
             times ? &times[sc] : nullptr,
+            (present_ids && present_ids->pPresentIds)
+                ? present_ids->pPresentIds[sc] : 0,
             present_fences ? present_fences->pFences[sc] : VK_NULL_HANDLE,
             present_modes ? &present_modes->pPresentModes[sc] : nullptr,
             present_info->waitSemaphoreCount,
@@ -2434,6 +2677,41 @@ VkResult GetPastPresentationTimingGOOGLE(
     return result;
 }
 
+VKAPI_ATTR
+VkResult WaitForPresentKHR(
+    VkDevice,
+    VkSwapchainKHR swapchain_handle,
+    uint64_t presentId,
+    uint64_t timeout) {
+    ATRACE_CALL();
+
+    Swapchain& swapchain = *SwapchainFromHandle(swapchain_handle);
+    // There is no completion callback for frame timestamps, poll them at a
+    // fraction of a refresh cycle until the present shows up or times out.
+    constexpr nsecs_t kPollInterval = ms2ns(1);
+    const nsecs_t start = systemTime();
+
+    while (true) {
+        if (swapchain.surface.swapchain_handle != swapchain_handle) {
+            return VK_ERROR_OUT_OF_DATE_KHR;
+        }
+        {
+            std::lock_guard<std::mutex> lock(swapchain.present_id_mutex);
+            UpdateCompletedPresentIds(swapchain);
+            if (swapchain.completed_present_id >= presentId) {
+                return VK_SUCCESS;
+            }
+        }
+
+        const nsecs_t elapsed = systemTime() - start;
+        if (timeout == 0 || static_cast<uint64_t>(elapsed) >= timeout) {
+            return VK_TIMEOUT;
+        }
+        const uint64_t remaining = timeout - static_cast<uint64_t>(elapsed);
+        usleep(ns2us(std::min(static_cast<uint64_t>(kPollInterval), remaining)));
+    }
+}
+
 VKAPI_ATTR
 VkResult GetSwapchainStatusKHR(
     VkDevice,
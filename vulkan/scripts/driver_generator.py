@@ -37,6 +37,8 @@ _INTERCEPTED_EXTENSIONS = [
     'VK_KHR_swapchain',
     'VK_EXT_swapchain_maintenance1',
     'VK_EXT_surface_maintenance1',
+    'VK_KHR_present_id',
+    'VK_KHR_present_wait',
 ]
 
 # Extensions known to vulkan::driver level.